@@ -0,0 +1,391 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/benchharness/Bench.h"
+
+#ifdef __linux__
+
+#include <folly/Conv.h>
+#include <folly/Random.h>
+#include <folly/Utility.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/IOThreadPoolExecutor.h>
+#include <folly/executors/ManualExecutor.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
+#include <atomic>
+#include <cstring>
+#include <optional>
+#include <system_error>
+#include <thread>
+#include "eden/fs/fuse/FuseTypes.h"
+#include "eden/fs/inodes/EdenDispatcherFactory.h"
+#include "eden/fs/inodes/EdenMount.h"
+#include "eden/fs/nfs/NfsDispatcher.h"
+#include "eden/fs/nfs/Nfsd3.h"
+#include "eden/fs/nfs/NfsdRpc.h"
+#include "eden/fs/nfs/rpc/StreamClient.h"
+#include "eden/fs/testharness/FakeFuse.h"
+#include "eden/fs/testharness/FakeTreeBuilder.h"
+#include "eden/fs/testharness/TestMount.h"
+#include "eden/fs/utils/ProcessNameCache.h"
+
+namespace {
+
+using namespace facebook::eden;
+
+constexpr size_t kNumSmallFiles = 1000;
+constexpr size_t kNumLargeDirEntries = 10000;
+constexpr size_t kBigFileSize = 16 * 1024 * 1024;
+constexpr size_t kReadSize = 128 * 1024;
+constexpr size_t kWriteTargetSize = 1024 * 1024;
+constexpr size_t kWriteSize = 4096;
+
+FakeTreeBuilder buildTree() {
+  FakeTreeBuilder builder;
+  for (size_t i = 0; i < kNumSmallFiles; ++i) {
+    builder.setFile(folly::to<std::string>("small/file", i), "contents\n");
+  }
+  for (size_t i = 0; i < kNumLargeDirEntries; ++i) {
+    builder.setFile(folly::to<std::string>("large/entry", i), "");
+  }
+  builder.setFile("big_file", std::string(kBigFileSize, 'b'));
+  builder.setFile("write_target", std::string(kWriteTargetSize, 'w'));
+  return builder;
+}
+
+/**
+ * A TestMount runs the continuations of the inode code on a ManualExecutor.
+ * The channels under test wait on them from their own threads, so this keeps
+ * running it in the background.
+ */
+class ExecutorDriver {
+ public:
+  explicit ExecutorDriver(folly::ManualExecutor& executor)
+      : executor_{executor}, thread_{[this] {
+          while (!stop_.load(std::memory_order_acquire)) {
+            executor_.wait();
+            executor_.run();
+          }
+        }} {}
+
+  ~ExecutorDriver() {
+    stop_.store(true, std::memory_order_release);
+    // Wake the thread up.
+    executor_.add([] {});
+    thread_.join();
+  }
+
+ private:
+  folly::ManualExecutor& executor_;
+  std::atomic<bool> stop_{false};
+  std::thread thread_;
+};
+
+/**
+ * The operations of the benchmarks, as a kernel would send them through
+ * either channel.
+ */
+class ChannelClient {
+ public:
+  explicit ChannelClient(FakeTreeBuilder builder)
+      : mount_{std::move(builder)} {}
+  virtual ~ChannelClient() = default;
+
+  virtual uint64_t lookup(uint64_t parent, folly::StringPiece name) = 0;
+  virtual void getattr(uint64_t ino) = 0;
+  /**
+   * List the whole directory, returning the number of entries.
+   */
+  virtual size_t readdir(uint64_t ino) = 0;
+  virtual size_t read(uint64_t ino, uint64_t offset, uint32_t size) = 0;
+  virtual void write(uint64_t ino, uint64_t offset, folly::ByteRange data) = 0;
+
+  uint64_t getRootIno() const {
+    return kRootNodeId.get();
+  }
+
+ protected:
+  /**
+   * Called once the mount no longer drains its executor itself.
+   */
+  void startExecutorDriver() {
+    driver_ = std::make_unique<ExecutorDriver>(*mount_.getServerExecutor());
+  }
+
+  TestMount mount_;
+  std::unique_ptr<ExecutorDriver> driver_;
+};
+
+class FuseClient : public ChannelClient {
+ public:
+  explicit FuseClient(FakeTreeBuilder builder)
+      : ChannelClient{std::move(builder)}, fuse_{std::make_shared<FakeFuse>()} {
+    mount_.startFuseAndWait(fuse_);
+    startExecutorDriver();
+  }
+
+  ~FuseClient() override {
+    fuse_->close();
+  }
+
+  uint64_t lookup(uint64_t parent, folly::StringPiece name) override {
+    fuse_->sendLookup(parent, name);
+    auto response = receive();
+    fuse_entry_out entry;
+    memcpy(&entry, response.body.data(), sizeof(entry));
+    return entry.nodeid;
+  }
+
+  void getattr(uint64_t ino) override {
+    fuse_getattr_in arg{};
+    fuse_->sendRequest(FUSE_GETATTR, ino, arg);
+    receive();
+  }
+
+  size_t readdir(uint64_t ino) override {
+    size_t entries = 0;
+    fuse_read_in arg{};
+    arg.size = 64 * 1024;
+    while (true) {
+      fuse_->sendRequest(FUSE_READDIR, ino, arg);
+      auto response = receive();
+      if (response.body.empty()) {
+        return entries;
+      }
+      // Walk the fuse_dirent records to resume after the last one.
+      size_t pos = 0;
+      while (pos < response.body.size()) {
+        fuse_dirent dirent;
+        memcpy(&dirent, response.body.data() + pos, sizeof(dirent));
+        arg.offset = dirent.off;
+        pos += FUSE_DIRENT_ALIGN(FUSE_NAME_OFFSET + dirent.namelen);
+        ++entries;
+      }
+    }
+  }
+
+  size_t read(uint64_t ino, uint64_t offset, uint32_t size) override {
+    fuse_read_in arg{};
+    arg.offset = offset;
+    arg.size = size;
+    fuse_->sendRequest(FUSE_READ, ino, arg);
+    return receive().body.size();
+  }
+
+  void write(uint64_t ino, uint64_t offset, folly::ByteRange data) override {
+    fuse_write_in arg{};
+    arg.offset = offset;
+    arg.size = data.size();
+    std::vector<uint8_t> request(sizeof(arg) + data.size());
+    memcpy(request.data(), &arg, sizeof(arg));
+    memcpy(request.data() + sizeof(arg), data.data(), data.size());
+    fuse_->sendRequest(
+        FUSE_WRITE, ino, folly::ByteRange{request.data(), request.size()});
+    receive();
+  }
+
+ private:
+  FakeFuse::Response receive() {
+    auto response = fuse_->recvResponse();
+    if (response.header.error != 0) {
+      throw std::system_error(
+          -response.header.error, std::generic_category(), "FUSE request");
+    }
+    return response;
+  }
+
+  std::shared_ptr<FakeFuse> fuse_;
+};
+
+class NfsClient : public ChannelClient {
+ public:
+  explicit NfsClient(FakeTreeBuilder builder)
+      : ChannelClient{std::move(builder)},
+        threadPool_{std::make_shared<folly::CPUThreadPoolExecutor>(8)},
+        ioPool_{std::make_shared<folly::IOThreadPoolExecutor>(1)} {
+    startExecutorDriver();
+    auto* edenMount = mount_.getEdenMount().get();
+    evbThread_.getEventBase()->runInEventBaseThreadAndWait([&] {
+      nfsd_ = std::make_unique<Nfsd3>(
+          evbThread_.getEventBase(),
+          threadPool_,
+          ioPool_,
+          EdenDispatcherFactory::makeNfsDispatcher(edenMount),
+          &edenMount->getStraceLogger(),
+          std::make_shared<ProcessNameCache>(),
+          /*fsEventLogger=*/nullptr,
+          std::chrono::seconds{60},
+          /*notifications=*/nullptr,
+          kPathMapDefaultCaseSensitive,
+          /*iosize=*/1024 * 1024,
+          /*maxInflightMetadataRequests=*/0,
+          /*maxInflightDataRequests=*/0);
+      nfsd_->initialize(
+          folly::SocketAddress{"127.0.0.1", 0}, /*registerWithRpcbind=*/false);
+    });
+    client_.emplace(nfsd_->getAddr());
+    client_->connect();
+  }
+
+  ~NfsClient() override {
+    client_.reset();
+    evbThread_.getEventBase()->runInEventBaseThreadAndWait(
+        [&] { nfsd_.reset(); });
+  }
+
+  uint64_t lookup(uint64_t parent, folly::StringPiece name) override {
+    auto res = call<LOOKUP3res>(
+        nfsv3Procs::lookup,
+        LOOKUP3args{diropargs3{nfs_fh3{InodeNumber{parent}}, name.str()}});
+    return std::get<LOOKUP3resok>(res.v).object.ino.get();
+  }
+
+  void getattr(uint64_t ino) override {
+    call<GETATTR3res>(
+        nfsv3Procs::getattr, GETATTR3args{nfs_fh3{InodeNumber{ino}}});
+  }
+
+  size_t readdir(uint64_t ino) override {
+    size_t entries = 0;
+    READDIRPLUS3args args{
+        nfs_fh3{InodeNumber{ino}},
+        /*cookie=*/0,
+        /*cookieverf=*/0,
+        /*dircount=*/64 * 1024,
+        /*maxcount=*/64 * 1024};
+    while (true) {
+      auto res = call<READDIRPLUS3res>(nfsv3Procs::readdirplus, args);
+      auto& resok = std::get<READDIRPLUS3resok>(res.v);
+      const auto& list = resok.reply.entries.list;
+      entries += list.size();
+      if (resok.reply.eof || list.empty()) {
+        return entries;
+      }
+      args.cookie = list.back().cookie;
+      args.cookieverf = resok.cookieverf;
+    }
+  }
+
+  size_t read(uint64_t ino, uint64_t offset, uint32_t size) override {
+    auto res = call<READ3res>(
+        nfsv3Procs::read, READ3args{nfs_fh3{InodeNumber{ino}}, offset, size});
+    return std::get<READ3resok>(res.v).count;
+  }
+
+  void write(uint64_t ino, uint64_t offset, folly::ByteRange data) override {
+    call<WRITE3res>(
+        nfsv3Procs::write,
+        WRITE3args{
+            nfs_fh3{InodeNumber{ino}},
+            offset,
+            folly::to_narrow(data.size()),
+            stable_how::UNSTABLE,
+            folly::IOBuf::copyBuffer(data)});
+  }
+
+ private:
+  template <typename Res, typename Args>
+  Res call(nfsv3Procs proc, const Args& args) {
+    auto res = client_->call<Res>(
+        kNfsdProgNumber,
+        kNfsd3ProgVersion,
+        folly::to_underlying(proc),
+        args);
+    if (res.tag != nfsstat3::NFS3_OK) {
+      throw std::runtime_error(folly::to<std::string>(
+          "NFS procedure ",
+          folly::to_underlying(proc),
+          " failed with ",
+          folly::to_underlying(res.tag)));
+    }
+    return res;
+  }
+
+  std::shared_ptr<folly::CPUThreadPoolExecutor> threadPool_;
+  std::shared_ptr<folly::IOThreadPoolExecutor> ioPool_;
+  folly::ScopedEventBaseThread evbThread_;
+  std::unique_ptr<Nfsd3> nfsd_;
+  std::optional<StreamClient> client_;
+};
+
+/**
+ * Look up a file and get its attributes, as every stat(2) of an uncached
+ * path does.
+ */
+template <typename Client>
+void lookup_getattr(benchmark::State& state) {
+  Client client{buildTree()};
+  auto dir = client.lookup(client.getRootIno(), "small");
+  size_t next = 0;
+  for (auto _ : state) {
+    auto ino = client.lookup(
+        dir, folly::to<std::string>("file", next++ % kNumSmallFiles));
+    client.getattr(ino);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+/**
+ * List a directory of kNumLargeDirEntries files.
+ */
+template <typename Client>
+void readdir_large(benchmark::State& state) {
+  Client client{buildTree()};
+  auto dir = client.lookup(client.getRootIno(), "large");
+  size_t entries = 0;
+  for (auto _ : state) {
+    entries += client.readdir(dir);
+  }
+  state.SetItemsProcessed(entries);
+}
+
+/**
+ * Read a large file from start to end in kReadSize chunks, looping over it.
+ */
+template <typename Client>
+void sequential_read(benchmark::State& state) {
+  Client client{buildTree()};
+  auto ino = client.lookup(client.getRootIno(), "big_file");
+  uint64_t offset = 0;
+  size_t bytes = 0;
+  for (auto _ : state) {
+    bytes += client.read(ino, offset, kReadSize);
+    offset = (offset + kReadSize) % kBigFileSize;
+  }
+  state.SetBytesProcessed(bytes);
+}
+
+/**
+ * Write kWriteSize bytes at random aligned offsets of a file.
+ */
+template <typename Client>
+void small_writes(benchmark::State& state) {
+  Client client{buildTree()};
+  auto ino = client.lookup(client.getRootIno(), "write_target");
+  std::string data(kWriteSize, 'x');
+  for (auto _ : state) {
+    auto offset =
+        folly::Random::rand32(kWriteTargetSize / kWriteSize) * kWriteSize;
+    client.write(ino, offset, folly::StringPiece{data});
+  }
+  state.SetBytesProcessed(state.iterations() * kWriteSize);
+}
+
+BENCHMARK_TEMPLATE(lookup_getattr, FuseClient);
+BENCHMARK_TEMPLATE(lookup_getattr, NfsClient);
+BENCHMARK_TEMPLATE(readdir_large, FuseClient)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(readdir_large, NfsClient)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(sequential_read, FuseClient);
+BENCHMARK_TEMPLATE(sequential_read, NfsClient);
+BENCHMARK_TEMPLATE(small_writes, FuseClient);
+BENCHMARK_TEMPLATE(small_writes, NfsClient);
+
+} // namespace
+
+#endif // __linux__
+
+EDEN_BENCHMARK_MAIN();
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <folly/Conv.h>
+#include <sys/resource.h>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <vector>
+#include "eden/fs/benchharness/Bench.h"
+#include "eden/fs/inodes/EdenMount.h"
+#include "eden/fs/model/RootId.h"
+#include "eden/fs/testharness/FakeBackingStore.h"
+#include "eden/fs/testharness/FakeTreeBuilder.h"
+#include "eden/fs/testharness/TestMount.h"
+
+namespace {
+
+using namespace facebook::eden;
+
+/**
+ * The shape of a synthetic source tree: `width` directories per level,
+ * `depth` levels of directories, `filesPerDir` files in each of the deepest
+ * directories, and one file in `churnDivisor` modified between the two
+ * commits.
+ */
+struct TreeShape {
+  size_t width;
+  size_t depth;
+  size_t filesPerDir;
+  size_t churnDivisor;
+};
+
+TreeShape getTreeShape(const benchmark::State& state) {
+  return TreeShape{
+      static_cast<size_t>(state.range(0)),
+      static_cast<size_t>(state.range(1)),
+      static_cast<size_t>(state.range(2)),
+      static_cast<size_t>(state.range(3))};
+}
+
+void addDirs(
+    const TreeShape& shape,
+    size_t depth,
+    const std::string& prefix,
+    std::vector<std::string>& files) {
+  if (depth == shape.depth) {
+    for (size_t i = 0; i < shape.filesPerDir; ++i) {
+      files.push_back(folly::to<std::string>(prefix, "file", i));
+    }
+    return;
+  }
+  for (size_t i = 0; i < shape.width; ++i) {
+    addDirs(
+        shape, depth + 1, folly::to<std::string>(prefix, "d", i, "/"), files);
+  }
+}
+
+std::vector<std::string> getFilePaths(const TreeShape& shape) {
+  std::vector<std::string> files;
+  addDirs(shape, 0, "", files);
+  return files;
+}
+
+/**
+ * The peak resident set size of the process, in bytes.
+ */
+uint64_t getPeakRss() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  // ru_maxrss is in kilobytes on Linux.
+  return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+}
+
+/**
+ * Check out from a synthetic commit "1" to a commit "2" modifying some of its
+ * files, in a fresh mount with no loaded inodes, while every fetch from the
+ * FakeBackingStore takes state.range(4) microseconds.
+ *
+ * The arguments are: width, depth, files per directory, one modified file in
+ * N, and the backing store latency.
+ */
+void checkout(benchmark::State& state) {
+  auto shape = getTreeShape(state);
+  auto latency = std::chrono::microseconds{state.range(4)};
+  auto files = getFilePaths(shape);
+
+  FakeTreeBuilder builder1;
+  for (const auto& file : files) {
+    builder1.setFile(file, file);
+  }
+  auto builder2 = builder1.clone();
+  for (size_t i = 0; i < files.size(); i += shape.churnDivisor) {
+    builder2.replaceFile(files[i], folly::to<std::string>("modified ", i));
+  }
+
+  uint64_t totalFetches = 0;
+  // Kept across iterations so that unmounting isn't timed.
+  std::optional<TestMount> mount;
+  for (auto _ : state) {
+    state.PauseTiming();
+    mount.reset();
+    mount.emplace(builder1.clone());
+    auto commit2Builder = builder2.clone();
+    const auto& backingStore = mount->getBackingStore();
+    commit2Builder.finalize(backingStore, /*setReady=*/true);
+    backingStore->putCommit(RootId{"2"}, commit2Builder)->setReady();
+    backingStore->setLatency(latency);
+    auto fetchesBefore = backingStore->getTotalAccessCount();
+    auto executor = mount->getServerExecutor().get();
+    state.ResumeTiming();
+
+    auto result = mount->getEdenMount()
+                      ->checkout(RootId{"2"}, std::nullopt, __func__)
+                      .waitVia(executor)
+                      .get();
+    benchmark::DoNotOptimize(result);
+
+    state.PauseTiming();
+    totalFetches += backingStore->getTotalAccessCount() - fetchesBefore;
+    state.ResumeTiming();
+  }
+
+  state.counters["files"] = files.size();
+  state.counters["backing_store_fetches"] =
+      static_cast<double>(totalFetches) / state.iterations();
+  state.counters["peak_rss_mb"] =
+      static_cast<double>(getPeakRss()) / (1024 * 1024);
+}
+
+BENCHMARK(checkout)
+    ->Unit(benchmark::kMillisecond)
+    ->ArgNames({"width", "depth", "files", "churn", "latency_us"})
+    ->Args({32, 2, 8, 100, 0})
+    ->Args({32, 2, 8, 10, 0})
+    ->Args({32, 2, 8, 10, 100})
+    ->Args({8, 4, 8, 10, 0})
+    ->Args({1024, 1, 64, 10, 0});
+
+} // namespace
+
+EDEN_BENCHMARK_MAIN();
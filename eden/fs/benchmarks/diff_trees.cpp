@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <folly/Conv.h>
+#include <folly/executors/QueuedImmediateExecutor.h>
+#include "eden/fs/benchharness/Bench.h"
+#include "eden/fs/config/EdenConfig.h"
+#include "eden/fs/config/ReloadableConfig.h"
+#include "eden/fs/model/RootId.h"
+#include "eden/fs/store/Diff.h"
+#include "eden/fs/store/MemoryLocalStore.h"
+#include "eden/fs/store/ObjectStore.h"
+#include "eden/fs/store/TreeCache.h"
+#include "eden/fs/telemetry/NullStructuredLogger.h"
+#include "eden/fs/testharness/FakeBackingStore.h"
+#include "eden/fs/testharness/FakeTreeBuilder.h"
+#include "eden/fs/utils/ProcessNameCache.h"
+
+namespace {
+
+using namespace facebook::eden;
+
+constexpr size_t kNumTopLevelDirs = 32;
+constexpr size_t kNumSubDirs = 32;
+constexpr size_t kNumFiles = 8;
+
+/**
+ * Store two commits in the FakeBackingStore: "1" has kNumTopLevelDirs *
+ * kNumSubDirs directories of kNumFiles files each, and "2" modifies one file
+ * in every other top level directory.
+ */
+void buildCommits(const std::shared_ptr<FakeBackingStore>& backingStore) {
+  FakeTreeBuilder builder;
+  for (size_t i = 0; i < kNumTopLevelDirs; ++i) {
+    for (size_t j = 0; j < kNumSubDirs; ++j) {
+      for (size_t k = 0; k < kNumFiles; ++k) {
+        auto path = folly::to<std::string>("dir", i, "/sub", j, "/file", k);
+        builder.setFile(path, path);
+      }
+    }
+  }
+  builder.finalize(backingStore, /*setReady=*/true);
+  backingStore->putCommit(RootId{"1"}, builder)->setReady();
+
+  auto builder2 = builder.clone();
+  for (size_t i = 0; i < kNumTopLevelDirs; i += 2) {
+    builder2.replaceFile(
+        folly::to<std::string>("dir", i, "/sub0/file0"), "modified");
+  }
+  builder2.finalize(backingStore, /*setReady=*/true);
+  backingStore->putCommit(RootId{"2"}, builder2)->setReady();
+}
+
+/**
+ * Diff the two commits from buildCommits(), fetching at most state.range(0)
+ * trees at once.
+ */
+void diff_commits(benchmark::State& state) {
+  auto rawEdenConfig = EdenConfig::createTestEdenConfig();
+  auto edenConfig = std::make_shared<ReloadableConfig>(
+      rawEdenConfig, ConfigReloadBehavior::NoReload);
+  auto backingStore = std::make_shared<FakeBackingStore>();
+  buildCommits(backingStore);
+
+  for (auto _ : state) {
+    // Start every iteration from empty caches, so that all the trees have to
+    // be fetched from the BackingStore again.
+    state.PauseTiming();
+    auto store = ObjectStore::create(
+        std::make_shared<MemoryLocalStore>(),
+        backingStore,
+        TreeCache::create(edenConfig),
+        std::make_shared<EdenStats>(),
+        &folly::QueuedImmediateExecutor::instance(),
+        std::make_shared<ProcessNameCache>(),
+        std::make_shared<NullStructuredLogger>(),
+        rawEdenConfig);
+    state.ResumeTiming();
+
+    auto status = diffCommitsForStatus(
+                      store.get(), RootId{"1"}, RootId{"2"}, state.range(0))
+                      .get();
+    benchmark::DoNotOptimize(status);
+  }
+}
+
+BENCHMARK(diff_commits)
+    ->Unit(benchmark::kMillisecond)
+    ->Arg(0)
+    ->Arg(1)
+    ->Arg(16)
+    ->Arg(256);
+
+} // namespace
+
+EDEN_BENCHMARK_MAIN();
@@ -31,7 +31,31 @@ void folly_future(benchmark::State& state) {
   state.SetItemsProcessed(std::move(fut).get());
 }
 
+void immediate_future_ready_semi(benchmark::State& state) {
+  ImmediateFuture<uint64_t> fut{folly::makeSemiFuture<uint64_t>(0)};
+
+  for (auto _ : state) {
+    auto newFut = std::move(fut).thenValue(
+        [](uint64_t v) { return folly::makeSemiFuture(v + 1); });
+    fut = std::move(newFut);
+  }
+  state.SetItemsProcessed(std::move(fut).get());
+}
+
+void immediate_future_deferred(benchmark::State& state) {
+  for (auto _ : state) {
+    auto [promise, semiFut] = folly::makePromiseContract<uint64_t>();
+    auto fut = ImmediateFuture<uint64_t>{std::move(semiFut)}
+                   .thenValue([](uint64_t v) { return v + 1; })
+                   .thenValue([](uint64_t v) { return v + 1; });
+    promise.setValue(0);
+    benchmark::DoNotOptimize(std::move(fut).get());
+  }
+}
+
 BENCHMARK(immediate_future);
+BENCHMARK(immediate_future_ready_semi);
+BENCHMARK(immediate_future_deferred);
 BENCHMARK(folly_future);
 } // namespace
 
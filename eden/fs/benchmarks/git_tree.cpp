@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <array>
+#include <cstring>
+
+#include <folly/Conv.h>
+
+#include "eden/fs/benchharness/Bench.h"
+#include "eden/fs/model/FlatTree.h"
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/model/Tree.h"
+#include "eden/fs/model/TreeEntry.h"
+#include "eden/fs/model/git/GitTree.h"
+
+namespace {
+
+using namespace facebook::eden;
+
+Hash makeHash(size_t i) {
+  std::array<uint8_t, Hash::RAW_SIZE> bytes = {0};
+  std::memcpy(bytes.data(), &i, sizeof(i));
+  return Hash{bytes};
+}
+
+/**
+ * Serialize a tree of `entryCount` entries, with names of the length found
+ * in large source directories, and a mix of files and subdirectories.
+ */
+folly::IOBuf makeGitTree(size_t entryCount) {
+  GitTreeSerializer serializer;
+  for (size_t i = 0; i < entryCount; ++i) {
+    auto name = folly::to<std::string>("source_file_", 10000000 + i, ".cpp");
+    auto type = i % 8 == 0 ? TreeEntryType::TREE : TreeEntryType::REGULAR_FILE;
+    serializer.addEntry(TreeEntry{makeHash(i), PathComponent{name}, type});
+  }
+  return serializer.finalize();
+}
+
+/**
+ * Parse a git tree object of state.range(0) entries, as done by
+ * LocalStore::getTree() for every tree stored in the Git format.
+ */
+void deserialize_git_tree(benchmark::State& state) {
+  auto treeData = makeGitTree(state.range(0));
+  treeData.coalesce();
+  auto hash = Hash::sha1(treeData);
+
+  for (auto _ : state) {
+    auto tree = deserializeGitTree(hash, &treeData);
+    benchmark::DoNotOptimize(tree);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(deserialize_git_tree)->Arg(16)->Arg(1024)->Arg(100000);
+
+/**
+ * Read the same tree stored in the flat format, which LocalStore::getTree()
+ * does instead when --localStoreFlatTrees is set.
+ */
+void deserialize_flat_tree(benchmark::State& state) {
+  auto gitTree = makeGitTree(state.range(0));
+  gitTree.coalesce();
+  auto hash = Hash::sha1(gitTree);
+  auto treeData = FlatTreeView::serialize(*deserializeGitTree(hash, &gitTree));
+  auto bytes = treeData.coalesce();
+
+  for (auto _ : state) {
+    auto tree = FlatTreeView{bytes}.toTree(hash);
+    benchmark::DoNotOptimize(tree);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(deserialize_flat_tree)->Arg(16)->Arg(1024)->Arg(100000);
+
+} // namespace
+
+EDEN_BENCHMARK_MAIN();
@@ -0,0 +1,340 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <folly/Conv.h>
+#include <folly/Synchronized.h>
+#include <folly/container/F14Map.h>
+#include <folly/futures/Future.h>
+#include <folly/io/IOBuf.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "eden/fs/benchharness/Bench.h"
+#include "eden/fs/config/ReloadableConfig.h"
+#include "eden/fs/model/Blob.h"
+#include "eden/fs/model/Tree.h"
+#include "eden/fs/store/BackingStoreLogger.h"
+#include "eden/fs/store/MemoryLocalStore.h"
+#include "eden/fs/store/ObjectFetchContext.h"
+#include "eden/fs/store/hg/HgBackingStore.h"
+#include "eden/fs/store/hg/HgDatapackStore.h"
+#include "eden/fs/store/hg/HgProxyHash.h"
+#include "eden/fs/store/hg/HgQueuedBackingStore.h"
+#include "eden/fs/telemetry/EdenStats.h"
+#include "eden/fs/telemetry/NullStructuredLogger.h"
+#include "eden/fs/utils/IDGen.h"
+
+namespace {
+
+using namespace facebook::eden;
+
+constexpr size_t kObjectsPerIteration = 1024;
+// Each object is requested twice at the same time, so that the requests are
+// deduplicated by the queue.
+constexpr size_t kRequestsPerObject = 2;
+constexpr size_t kEntriesPerTree = 16;
+
+Hash uniqueHash() {
+  std::array<uint8_t, Hash::RAW_SIZE> bytes = {0};
+  auto uid = generateUniqueID();
+  std::memcpy(bytes.data(), &uid, sizeof(uid));
+  return Hash{bytes};
+}
+
+/**
+ * A datapack store with nothing available locally, where every batch takes
+ * the same time to fetch whatever its size, like a round trip to the server.
+ */
+class MockDatapackStore final : public HgDatapackStore {
+ public:
+  explicit MockDatapackStore(std::chrono::microseconds batchLatency)
+      : batchLatency_{batchLatency} {}
+
+  std::unique_ptr<Blob> getBlobLocal(const Hash&, const HgProxyHash&)
+      override {
+    return nullptr;
+  }
+
+  std::unique_ptr<Tree>
+  getTreeLocal(const Hash&, const HgProxyHash&, LocalStore&) override {
+    return nullptr;
+  }
+
+  void getBlobBatch(
+      const std::vector<Hash>& ids,
+      const std::vector<HgProxyHash>& hashes,
+      std::vector<folly::Promise<std::shared_ptr<const Blob>>*> promises)
+      override {
+    std::this_thread::sleep_for(batchLatency_);
+    for (size_t i = 0; i < ids.size(); ++i) {
+      promises[i]->setValue(
+          std::make_shared<Blob>(ids[i], hashes[i].path().stringPiece()));
+    }
+  }
+
+  /**
+   * Like the real store, this writes the proxy hashes of the entries and the
+   * trees to the LocalStore.
+   */
+  void getTreeBatch(
+      const std::vector<Hash>& ids,
+      const std::vector<HgProxyHash>& hashes,
+      LocalStore::WriteBatch* writeBatch,
+      std::vector<folly::Promise<std::unique_ptr<Tree>>>* promises) override {
+    std::this_thread::sleep_for(batchLatency_);
+    for (size_t i = 0; i < ids.size(); ++i) {
+      std::vector<TreeEntry> entries;
+      entries.reserve(kEntriesPerTree);
+      for (size_t j = 0; j < kEntriesPerTree; ++j) {
+        PathComponent name{folly::to<std::string>("file", j)};
+        auto proxyHash = HgProxyHash::store(
+            hashes[i].path() + name, uniqueHash(), writeBatch);
+        entries.emplace_back(
+            proxyHash, std::move(name), TreeEntryType::REGULAR_FILE);
+      }
+      auto tree = std::make_unique<Tree>(std::move(entries), ids[i]);
+      auto serialized = LocalStore::serializeTree(*tree);
+      writeBatch->put(KeySpace::TreeFamily, ids[i], serialized.coalesce());
+      (*promises)[i].setValue(std::move(tree));
+    }
+    writeBatch->flush();
+  }
+
+  std::unique_ptr<Tree> getTree(
+      const RelativePath&,
+      const Hash&,
+      const Hash&,
+      LocalStore::WriteBatch*,
+      const std::optional<Hash>&) override {
+    return nullptr;
+  }
+
+  void refresh() override {}
+
+ private:
+  const std::chrono::microseconds batchLatency_;
+};
+
+/**
+ * Collects the QUEUE, START and FINISH events of the imports from the trace
+ * bus of the store, to tell the time spent waiting in the queue from the
+ * time spent importing.
+ */
+class ImportTimes {
+ public:
+  explicit ImportTimes(HgQueuedBackingStore& store)
+      : state_{std::make_shared<State>()},
+        handle_{store.getTraceBus().subscribeFunction(
+            "hg_import_pipeline",
+            // The subscriber may still be called after unsubscribing, so it
+            // shares the ownership of the state.
+            [state = state_](const HgImportTraceEvent& event) {
+              state->record(event);
+            })} {}
+
+  /**
+   * Wait for the trace bus to deliver the FINISH events of `count` requests,
+   * giving up after a second in case some events were dropped.
+   */
+  void waitForFinished(size_t count) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{1};
+    while (state_->finished.load(std::memory_order_acquire) < count &&
+           std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+  }
+
+  /**
+   * Report the average queue wait and service time of the imports that were
+   * started. Deduplicated requests are never started.
+   */
+  void report(benchmark::State& state) {
+    using namespace std::chrono;
+    nanoseconds queueWait{0};
+    nanoseconds service{0};
+    size_t started = 0;
+    for (const auto& [unique, times] : *state_->times.lock()) {
+      if (times.start == steady_clock::time_point{} ||
+          times.queue == steady_clock::time_point{} ||
+          times.finish == steady_clock::time_point{}) {
+        continue;
+      }
+      queueWait += times.start - times.queue;
+      service += times.finish - times.start;
+      ++started;
+    }
+    auto averageUs = [&](nanoseconds total) {
+      return started ? duration<double, std::micro>{total}.count() / started
+                     : 0.0;
+    };
+    state.counters["queue_wait_us"] = averageUs(queueWait);
+    state.counters["service_us"] = averageUs(service);
+    state.counters["imports"] = started;
+  }
+
+ private:
+  struct Times {
+    std::chrono::steady_clock::time_point queue;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point finish;
+  };
+
+  struct State {
+    void record(const HgImportTraceEvent& event) {
+      {
+        auto lockedTimes = times.lock();
+        auto& entry = (*lockedTimes)[event.unique];
+        switch (event.eventType) {
+          case HgImportTraceEvent::QUEUE:
+            entry.queue = event.monotonicTime;
+            break;
+          case HgImportTraceEvent::START:
+            entry.start = event.monotonicTime;
+            break;
+          case HgImportTraceEvent::FINISH:
+            entry.finish = event.monotonicTime;
+            break;
+        }
+      }
+      if (event.eventType == HgImportTraceEvent::FINISH) {
+        finished.fetch_add(1, std::memory_order_release);
+      }
+    }
+
+    folly::Synchronized<folly::F14FastMap<uint64_t, Times>> times;
+    std::atomic<size_t> finished{0};
+  };
+
+  std::shared_ptr<State> state_;
+  TraceBus<HgImportTraceEvent>::SubscriptionHandle handle_;
+};
+
+/**
+ * An HgQueuedBackingStore over a MockDatapackStore, configured from the
+ * benchmark arguments: the batch size, the number of queue workers, the
+ * number of fetch threads and the latency of each batch in microseconds.
+ */
+struct Pipeline {
+  explicit Pipeline(const benchmark::State& state) {
+    auto batchSize = static_cast<uint32_t>(state.range(0));
+    auto workers = static_cast<uint8_t>(state.range(1));
+    auto fetchThreads = static_cast<uint32_t>(state.range(2));
+    auto latency = std::chrono::microseconds{state.range(3)};
+
+    auto rawConfig = EdenConfig::createTestEdenConfig();
+    rawConfig->importBatchSize.setValue(
+        batchSize, ConfigSource::Default, true);
+    rawConfig->importBatchSizeTree.setValue(
+        batchSize, ConfigSource::Default, true);
+    // Use the configured batch sizes rather than adapting them.
+    rawConfig->importBatchTargetLatency.setValue(
+        std::chrono::nanoseconds{0}, ConfigSource::Default, true);
+    rawConfig->maxBlobFetchThreads.setValue(
+        fetchThreads, ConfigSource::Default, true);
+    rawConfig->maxTreeFetchThreads.setValue(
+        fetchThreads, ConfigSource::Default, true);
+    auto config = std::make_shared<ReloadableConfig>(
+        rawConfig, ConfigReloadBehavior::NoReload);
+
+    localStore = std::make_shared<MemoryLocalStore>();
+    auto stats = std::make_shared<EdenStats>();
+    store = std::make_unique<HgQueuedBackingStore>(
+        localStore,
+        stats,
+        std::make_unique<HgBackingStore>(
+            std::make_unique<MockDatapackStore>(latency),
+            localStore,
+            config,
+            stats),
+        config,
+        std::make_shared<NullStructuredLogger>(),
+        std::make_unique<BackingStoreLogger>(),
+        workers);
+  }
+
+  /**
+   * Store the proxy hashes of new objects, as importing their parent trees
+   * would, and return their ids.
+   */
+  std::vector<Hash> makeObjects() {
+    std::vector<Hash> ids;
+    ids.reserve(kObjectsPerIteration);
+    auto writeBatch = localStore->beginWrite();
+    for (size_t i = 0; i < kObjectsPerIteration; ++i) {
+      ids.push_back(HgProxyHash::store(
+          RelativePath{folly::to<std::string>("dir/object", i)},
+          uniqueHash(),
+          writeBatch.get()));
+    }
+    writeBatch->flush();
+    return ids;
+  }
+
+  std::shared_ptr<MemoryLocalStore> localStore;
+  std::unique_ptr<HgQueuedBackingStore> store;
+};
+
+template <typename GetFn>
+void runImports(benchmark::State& state, GetFn getFn) {
+  Pipeline pipeline{state};
+  ImportTimes times{*pipeline.store};
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto ids = pipeline.makeObjects();
+    state.ResumeTiming();
+
+    std::vector<folly::SemiFuture<folly::Unit>> futures;
+    futures.reserve(ids.size() * kRequestsPerObject);
+    for (const auto& id : ids) {
+      for (size_t i = 0; i < kRequestsPerObject; ++i) {
+        futures.push_back(getFn(*pipeline.store, id));
+      }
+    }
+    folly::collectAll(std::move(futures)).wait();
+  }
+
+  state.SetItemsProcessed(state.iterations() * kObjectsPerIteration);
+  times.waitForFinished(
+      state.iterations() * kObjectsPerIteration * kRequestsPerObject);
+  times.report(state);
+}
+
+void import_blobs(benchmark::State& state) {
+  runImports(state, [](HgQueuedBackingStore& store, const Hash& id) {
+    return store.getBlob(id, ObjectFetchContext::getNullContext()).unit();
+  });
+}
+
+void import_trees(benchmark::State& state) {
+  runImports(state, [](HgQueuedBackingStore& store, const Hash& id) {
+    return store.getTree(id, ObjectFetchContext::getNullContext()).unit();
+  });
+}
+
+void pipelineArgs(benchmark::internal::Benchmark* bench) {
+  bench->Unit(benchmark::kMillisecond)
+      ->UseRealTime()
+      ->ArgNames({"batch", "workers", "fetchers", "latency_us"});
+  for (int64_t batchSize : {1, 32, 256}) {
+    for (int64_t fetchThreads : {0, 16}) {
+      bench->Args({batchSize, 8, fetchThreads, 1000});
+    }
+  }
+  bench->Args({32, 1, 16, 1000});
+  bench->Args({32, 32, 16, 1000});
+  bench->Args({32, 8, 16, 0});
+  bench->Args({32, 8, 16, 10000});
+}
+
+BENCHMARK(import_blobs)->Apply(pipelineArgs);
+BENCHMARK(import_trees)->Apply(pipelineArgs);
+
+} // namespace
+
+EDEN_BENCHMARK_MAIN();
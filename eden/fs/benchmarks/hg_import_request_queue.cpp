@@ -32,6 +32,19 @@ std::shared_ptr<HgImportRequest> makeBlobImportRequest(
       hash, std::move(proxyHash), priority);
 }
 
+void makeRequest(benchmark::State& state) {
+  auto proxyHash = HgProxyHash{RelativePath{"some_blob"}, uniqueHash()};
+  auto hash = proxyHash.sha1();
+
+  // Each request is released before the next one is made, this measures the
+  // allocation and release of a request.
+  for (auto _ : state) {
+    auto request = HgImportRequest::makeBlobImportRequest(
+        hash, proxyHash, ImportPriority::kNormal());
+    benchmark::DoNotOptimize(request);
+  }
+}
+
 void enqueue(benchmark::State& state) {
   auto rawEdenConfig = EdenConfig::createTestEdenConfig();
   auto edenConfig = std::make_shared<ReloadableConfig>(
@@ -68,6 +81,12 @@ void dequeue(benchmark::State& state) {
   }
 }
 
+BENCHMARK(makeRequest)
+    ->Unit(benchmark::kNanosecond)
+    ->Threads(1)
+    ->Threads(8)
+    ->Threads(32);
+
 BENCHMARK(enqueue)
     ->Unit(benchmark::kNanosecond)
     ->Threads(1)
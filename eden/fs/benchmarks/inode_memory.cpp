@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <folly/Conv.h>
+#include <folly/memory/MallctlHelper.h>
+#include <folly/memory/Malloc.h>
+#include "eden/fs/benchharness/Bench.h"
+#include "eden/fs/inodes/EdenMount.h"
+#include "eden/fs/inodes/FileInode.h"
+#include "eden/fs/inodes/InodeMap.h"
+#include "eden/fs/inodes/InodeTable.h"
+#include "eden/fs/inodes/TreeInode.h"
+#include "eden/fs/store/BlobCache.h"
+#include "eden/fs/store/TreeCache.h"
+#include "eden/fs/testharness/FakeTreeBuilder.h"
+#include "eden/fs/testharness/TestMount.h"
+
+namespace {
+
+using namespace facebook::eden;
+
+constexpr size_t kFilesPerDir = 100;
+
+/**
+ * Bytes currently allocated through jemalloc across all threads.
+ */
+uint64_t allocatedBytes() {
+  // The statistics are only refreshed when the epoch is bumped.
+  folly::mallctlWrite<uint64_t>("epoch", 1);
+  size_t allocated = 0;
+  folly::mallctlRead("stats.allocated", &allocated);
+  return allocated;
+}
+
+std::string filePath(size_t i) {
+  return folly::to<std::string>("dir", i / kFilesPerDir, "/file", i);
+}
+
+/**
+ * Load state.range(0) FileInodes, spread across directories of kFilesPerDir
+ * files, and report how much memory stays allocated per loaded inode.
+ */
+void load_file_inodes(benchmark::State& state) {
+  if (!folly::usingJEMalloc()) {
+    state.SkipWithError("measuring memory usage requires jemalloc");
+    return;
+  }
+
+  auto numFiles = static_cast<size_t>(state.range(0));
+  FakeTreeBuilder builder;
+  for (size_t i = 0; i < numFiles; ++i) {
+    builder.setFile(filePath(i), "");
+  }
+
+  uint64_t totalBytes = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    TestMount mount{builder.clone()};
+    std::vector<FileInodePtr> inodes;
+    inodes.reserve(numFiles);
+    auto before = allocatedBytes();
+    state.ResumeTiming();
+
+    for (size_t i = 0; i < numFiles; ++i) {
+      inodes.push_back(mount.getFileInode(filePath(i)));
+    }
+
+    state.PauseTiming();
+    totalBytes += allocatedBytes() - before;
+    inodes.clear();
+    state.ResumeTiming();
+  }
+
+  // This includes the TreeInodes of the parent directories and the InodeMap
+  // entries, which is what a loaded file costs in practice.
+  state.counters["bytes_per_inode"] =
+      static_cast<double>(totalBytes) / (state.iterations() * numFiles);
+  state.counters["sizeof_file_inode"] = sizeof(FileInode);
+  state.counters["sizeof_tree_inode"] = sizeof(TreeInode);
+}
+
+BENCHMARK(load_file_inodes)
+    ->Unit(benchmark::kMillisecond)
+    ->Arg(10000)
+    ->Arg(100000);
+
+enum InodeKind : int64_t {
+  // Remembered by the InodeMap because the kernel still references them.
+  Unloaded,
+  LoadedTree,
+  LoadedFile,
+  Materialized,
+};
+
+/**
+ * The memory attributed to each structure, from their estimates.
+ */
+struct MemoryBreakdown {
+  explicit MemoryBreakdown(TestMount& mount) {
+    const auto& edenMount = mount.getEdenMount();
+    auto inodeUsage = edenMount->getInodeMap()->estimateMemoryUsage();
+    inodeMapBytes = inodeUsage.inodeMapBytes;
+    treeInodeBytes = inodeUsage.treeInodeBytes;
+    fileInodeBytes = inodeUsage.fileInodeBytes;
+    inodeMetadataBytes =
+        edenMount->getInodeMetadataTable()->estimateMemoryUsage();
+    treeCacheBytes = mount.getTreeCache()->getStats().totalSizeInBytes;
+    blobCacheBytes = mount.getBlobCache()->getStats().totalSizeInBytes;
+  }
+
+  MemoryBreakdown() = default;
+
+  void add(const MemoryBreakdown& after, const MemoryBreakdown& before) {
+    inodeMapBytes += after.inodeMapBytes - before.inodeMapBytes;
+    treeInodeBytes += after.treeInodeBytes - before.treeInodeBytes;
+    fileInodeBytes += after.fileInodeBytes - before.fileInodeBytes;
+    inodeMetadataBytes += after.inodeMetadataBytes - before.inodeMetadataBytes;
+    treeCacheBytes += after.treeCacheBytes - before.treeCacheBytes;
+    blobCacheBytes += after.blobCacheBytes - before.blobCacheBytes;
+  }
+
+  void report(benchmark::State& state, size_t numObjects) const {
+    auto perObject = [&](int64_t bytes) {
+      return static_cast<double>(bytes) / (state.iterations() * numObjects);
+    };
+    state.counters["inode_map"] = perObject(inodeMapBytes);
+    state.counters["tree_inode"] = perObject(treeInodeBytes);
+    state.counters["file_inode"] = perObject(fileInodeBytes);
+    state.counters["inode_metadata"] = perObject(inodeMetadataBytes);
+    state.counters["tree_cache"] = perObject(treeCacheBytes);
+    state.counters["blob_cache"] = perObject(blobCacheBytes);
+  }
+
+  int64_t inodeMapBytes = 0;
+  int64_t treeInodeBytes = 0;
+  int64_t fileInodeBytes = 0;
+  int64_t inodeMetadataBytes = 0;
+  int64_t treeCacheBytes = 0;
+  int64_t blobCacheBytes = 0;
+};
+
+std::string treePath(size_t i) {
+  return folly::to<std::string>("tree", i);
+}
+
+/**
+ * Bring state.range(1) inodes of the kind state.range(0) into this state,
+ * and report how much memory stays allocated per inode, in total and broken
+ * down by structure.
+ */
+void inodes_by_kind(benchmark::State& state) {
+  if (!folly::usingJEMalloc()) {
+    state.SkipWithError("measuring memory usage requires jemalloc");
+    return;
+  }
+
+  auto kind = static_cast<InodeKind>(state.range(0));
+  auto numObjects = static_cast<size_t>(state.range(1));
+  FakeTreeBuilder builder;
+  for (size_t i = 0; i < numObjects; ++i) {
+    if (kind == LoadedTree) {
+      builder.setFile(treePath(i) + "/file", "");
+    } else {
+      builder.setFile(filePath(i), "contents");
+    }
+  }
+
+  uint64_t totalBytes = 0;
+  MemoryBreakdown breakdown;
+  for (auto _ : state) {
+    state.PauseTiming();
+    TestMount mount{builder.clone()};
+    std::vector<InodePtr> inodes;
+    inodes.reserve(numObjects);
+    MemoryBreakdown before{mount};
+    auto allocatedBefore = allocatedBytes();
+    state.ResumeTiming();
+
+    for (size_t i = 0; i < numObjects; ++i) {
+      switch (kind) {
+        case Unloaded: {
+          auto inode = mount.getFileInode(filePath(i));
+          inode->incFsRefcount();
+          break;
+        }
+        case LoadedTree:
+          inodes.push_back(mount.getTreeInode(treePath(i)));
+          break;
+        case LoadedFile:
+          inodes.push_back(mount.getFileInode(filePath(i)));
+          break;
+        case Materialized:
+          mount.overwriteFile(filePath(i), "modified");
+          inodes.push_back(mount.getFileInode(filePath(i)));
+          break;
+      }
+    }
+    if (kind == Unloaded) {
+      mount.getEdenMount()->getRootInode()->unloadChildrenNow();
+    }
+
+    state.PauseTiming();
+    totalBytes += allocatedBytes() - allocatedBefore;
+    breakdown.add(MemoryBreakdown{mount}, before);
+    inodes.clear();
+    state.ResumeTiming();
+  }
+
+  // This includes the parent TreeInodes of the files, which the breakdown
+  // attributes to tree_inode.
+  state.counters["bytes_per_inode"] =
+      static_cast<double>(totalBytes) / (state.iterations() * numObjects);
+  breakdown.report(state, numObjects);
+}
+
+BENCHMARK(inodes_by_kind)
+    ->Unit(benchmark::kMillisecond)
+    ->ArgNames({"kind", "inodes"})
+    ->Args({Unloaded, 10000})
+    ->Args({LoadedTree, 10000})
+    ->Args({LoadedFile, 10000})
+    ->Args({Materialized, 10000});
+
+} // namespace
+
+EDEN_BENCHMARK_MAIN();
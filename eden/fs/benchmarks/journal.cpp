@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <folly/Conv.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "eden/fs/benchharness/Bench.h"
+#include "eden/fs/journal/Journal.h"
+
+namespace {
+
+using namespace facebook::eden;
+
+constexpr size_t kPathsPerThread = 1000;
+// Each file is changed this many times in a row by its writer, like an
+// editor saving repeatedly, so that the changes can be compacted.
+constexpr size_t kChangesPerFile = 4;
+// How far back the readers query the journal, like a Watchman query since
+// its last clock.
+constexpr Journal::SequenceNumber kReaderWindow = 1000;
+constexpr size_t kMaxLatenciesPerReader = 1000000;
+
+/**
+ * The readers and subscribers of the journal, running on their own threads
+ * while the benchmark threads write to it.
+ */
+class JournalClients {
+ public:
+  JournalClients(Journal& journal, size_t numReaders, size_t numSubscribers)
+      : journal_{journal},
+        readerLatencies_(numReaders),
+        subscribers_(numSubscribers) {
+    for (auto& latencies : readerLatencies_) {
+      threads_.emplace_back([this, &latencies] { runReader(latencies); });
+    }
+    for (auto& subscriber : subscribers_) {
+      subscriber.id = journal_.registerSubscriber(
+          [&subscriber] { subscriber.pending.store(true); });
+      threads_.emplace_back([this, &subscriber] { runSubscriber(subscriber); });
+    }
+  }
+
+  ~JournalClients() {
+    stop();
+  }
+
+  void stop() {
+    if (!running_.exchange(false)) {
+      return;
+    }
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+    threads_.clear();
+    for (auto& subscriber : subscribers_) {
+      journal_.cancelSubscriber(subscriber.id);
+    }
+  }
+
+  void report(benchmark::State& state) {
+    std::vector<uint64_t> latencies;
+    for (const auto& readerLatencies : readerLatencies_) {
+      latencies.insert(
+          latencies.end(), readerLatencies.begin(), readerLatencies.end());
+    }
+    auto percentileUs = [&](size_t percentile) {
+      auto it = latencies.begin() + latencies.size() * percentile / 100;
+      std::nth_element(latencies.begin(), it, latencies.end());
+      return static_cast<double>(*it) / 1000;
+    };
+    if (!latencies.empty()) {
+      state.counters["reader_p50_us"] = percentileUs(50);
+      state.counters["reader_p99_us"] = percentileUs(99);
+    }
+    state.counters["reads"] = latencies.size();
+
+    uint64_t subscriberReads = 0;
+    for (const auto& subscriber : subscribers_) {
+      subscriberReads += subscriber.reads;
+    }
+    state.counters["subscriber_reads"] = subscriberReads;
+  }
+
+ private:
+  struct Subscriber {
+    Journal::SubscriberId id;
+    std::atomic<bool> pending{false};
+    uint64_t reads{0};
+  };
+
+  void runReader(std::vector<uint64_t>& latencies) {
+    while (running_.load()) {
+      auto start = getTime();
+      if (auto latest = journal_.getLatest()) {
+        auto from = latest->sequenceID > kReaderWindow
+            ? latest->sequenceID - kReaderWindow
+            : 1;
+        auto range = journal_.accumulateRange(from);
+        benchmark::DoNotOptimize(range);
+      }
+      if (latencies.size() < kMaxLatenciesPerReader) {
+        latencies.push_back(getTime() - start);
+      }
+    }
+  }
+
+  /**
+   * Like the subscriptions of Watchman, read the changes since the previous
+   * notification whenever notified.
+   */
+  void runSubscriber(Subscriber& subscriber) {
+    Journal::SequenceNumber position = 1;
+    while (running_.load()) {
+      if (!subscriber.pending.exchange(false)) {
+        std::this_thread::sleep_for(std::chrono::microseconds{100});
+        continue;
+      }
+      if (auto range = journal_.accumulateRange(position)) {
+        position = range->toSequence + 1;
+      }
+      ++subscriber.reads;
+    }
+  }
+
+  Journal& journal_;
+  std::atomic<bool> running_{true};
+  std::vector<std::vector<uint64_t>> readerLatencies_;
+  std::vector<Subscriber> subscribers_;
+  std::vector<std::thread> threads_;
+};
+
+// The journal and its clients are set up by the first thread before the
+// benchmark loop, which the other threads only enter once it is done.
+std::optional<Journal> sharedJournal;
+std::optional<JournalClients> sharedClients;
+
+/**
+ * Every benchmark thread records file changes, creations and renames while
+ * state.range(1) threads read the recent changes and state.range(2)
+ * subscribers read the changes they are notified of. The journal is limited
+ * to state.range(0) MB, or the default limit if 0.
+ *
+ * Reports the writes per second, the latency of the readers, the entries
+ * retained per recorded change, which compaction and truncation lower, and
+ * the memory used per entry.
+ */
+void journal_writes(benchmark::State& state) {
+  if (state.thread_index == 0) {
+    sharedClients.reset();
+    sharedJournal.reset();
+    sharedJournal.emplace(std::make_shared<EdenStats>());
+    if (state.range(0) != 0) {
+      sharedJournal->setMemoryLimit(state.range(0) * 1024 * 1024);
+    }
+    sharedClients.emplace(*sharedJournal, state.range(1), state.range(2));
+  }
+
+  std::vector<RelativePath> paths;
+  paths.reserve(kPathsPerThread);
+  for (size_t i = 0; i < kPathsPerThread; ++i) {
+    paths.emplace_back(folly::to<std::string>(
+        "thread", state.thread_index, "/dir", i % 10, "/file", i));
+  }
+  size_t next = 0;
+
+  for (auto _ : state) {
+    auto i = next++;
+    const auto& path = paths[i / kChangesPerFile % kPathsPerThread];
+    switch (i % 16) {
+      case 0:
+        sharedJournal->recordCreated(path);
+        break;
+      case 1:
+        sharedJournal->recordRenamed(path, paths[(i + 1) % kPathsPerThread]);
+        break;
+      default:
+        sharedJournal->recordChanged(path);
+        break;
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  if (state.thread_index == 0) {
+    sharedClients->stop();
+    sharedClients->report(state);
+    if (auto stats = sharedJournal->getStats()) {
+      state.counters["entries_per_record"] =
+          static_cast<double>(stats->entryCount) /
+          (state.iterations() * state.threads);
+      state.counters["bytes_per_entry"] =
+          static_cast<double>(sharedJournal->estimateMemoryUsage()) /
+          stats->entryCount;
+    }
+  }
+}
+
+BENCHMARK(journal_writes)
+    ->Unit(benchmark::kNanosecond)
+    ->ArgNames({"limit_mb", "readers", "subscribers"})
+    ->Args({0, 0, 0})
+    ->Args({0, 1, 0})
+    ->Args({0, 0, 4})
+    ->Args({0, 1, 4})
+    ->Args({16, 1, 4})
+    ->Args({1, 1, 4})
+    ->Threads(1)
+    ->Threads(8)
+    ->Threads(32);
+
+} // namespace
+
+EDEN_BENCHMARK_MAIN();
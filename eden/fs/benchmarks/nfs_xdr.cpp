@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <fmt/format.h>
+#include <folly/io/IOBufQueue.h>
+#include "eden/fs/benchharness/Bench.h"
+#include "eden/fs/nfs/xdr/Xdr.h"
+
+using namespace facebook::eden;
+
+namespace facebook::eden {
+
+// Mimic the attributes returned by GETATTR and LOOKUP, which are fixed size.
+struct BenchTime {
+  uint32_t seconds;
+  uint32_t nseconds;
+};
+EDEN_XDR_SERDE_DECL(BenchTime, seconds, nseconds);
+
+struct BenchAttributes {
+  uint32_t type;
+  uint32_t mode;
+  uint32_t nlink;
+  uint32_t uid;
+  uint32_t gid;
+  uint64_t size;
+  uint64_t used;
+  uint64_t rdev;
+  uint64_t fsid;
+  uint64_t fileid;
+  BenchTime atime;
+  BenchTime mtime;
+  BenchTime ctime;
+};
+EDEN_XDR_SERDE_DECL(
+    BenchAttributes,
+    type,
+    mode,
+    nlink,
+    uid,
+    gid,
+    size,
+    used,
+    rdev,
+    fsid,
+    fileid,
+    atime,
+    mtime,
+    ctime);
+
+// Mimic a READDIR reply, which isn't fixed size.
+struct BenchEntry {
+  uint64_t fileid;
+  std::string name;
+  uint64_t cookie;
+};
+EDEN_XDR_SERDE_DECL(BenchEntry, fileid, name, cookie);
+
+struct BenchDirList {
+  XdrList<BenchEntry> entries;
+  bool eof;
+};
+EDEN_XDR_SERDE_DECL(BenchDirList, entries, eof);
+
+} // namespace facebook::eden
+
+namespace {
+
+constexpr size_t kGrowth = 1024;
+
+BenchAttributes makeAttributes() {
+  return BenchAttributes{1, 0644, 1, 1000, 1000, 4096, 4096, 0, 1, 42, {}, {}};
+}
+
+BenchDirList makeDirList() {
+  BenchDirList list;
+  for (uint64_t i = 0; i < 256; i++) {
+    list.entries.list.push_back(
+        BenchEntry{i, fmt::format("some_file_name_{}", i), i + 1});
+  }
+  list.eof = true;
+  return list;
+}
+
+void xdr_serialize_attributes(benchmark::State& state) {
+  auto attrs = makeAttributes();
+  for (auto _ : state) {
+    folly::IOBufQueue queue{folly::IOBufQueue::cacheChainLength()};
+    folly::io::QueueAppender appender{&queue, kGrowth};
+    XdrTrait<BenchAttributes>::serialize(appender, attrs);
+    benchmark::DoNotOptimize(queue.front());
+  }
+}
+BENCHMARK(xdr_serialize_attributes);
+
+void xdr_serialize_attributes_presized(benchmark::State& state) {
+  auto attrs = makeAttributes();
+  for (auto _ : state) {
+    folly::IOBufQueue queue{folly::IOBufQueue::cacheChainLength()};
+    folly::io::QueueAppender appender{&queue, kGrowth};
+    serializePresized(appender, attrs);
+    benchmark::DoNotOptimize(queue.front());
+  }
+}
+BENCHMARK(xdr_serialize_attributes_presized);
+
+void xdr_serialized_size_attributes(benchmark::State& state) {
+  auto attrs = makeAttributes();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(XdrTrait<BenchAttributes>::serializedSize(attrs));
+  }
+}
+BENCHMARK(xdr_serialized_size_attributes);
+
+void xdr_serialize_dirlist(benchmark::State& state) {
+  auto list = makeDirList();
+  for (auto _ : state) {
+    folly::IOBufQueue queue{folly::IOBufQueue::cacheChainLength()};
+    folly::io::QueueAppender appender{&queue, kGrowth};
+    XdrTrait<BenchDirList>::serialize(appender, list);
+    benchmark::DoNotOptimize(queue.front());
+  }
+}
+BENCHMARK(xdr_serialize_dirlist);
+
+void xdr_serialize_dirlist_presized(benchmark::State& state) {
+  auto list = makeDirList();
+  for (auto _ : state) {
+    folly::IOBufQueue queue{folly::IOBufQueue::cacheChainLength()};
+    folly::io::QueueAppender appender{&queue, kGrowth};
+    serializePresized(appender, list);
+    benchmark::DoNotOptimize(queue.front());
+  }
+}
+BENCHMARK(xdr_serialize_dirlist_presized);
+
+} // namespace
+
+EDEN_BENCHMARK_MAIN();
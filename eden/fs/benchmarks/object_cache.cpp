@@ -0,0 +1,341 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <folly/Conv.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "eden/fs/benchharness/Bench.h"
+#include "eden/fs/config/EdenConfig.h"
+#include "eden/fs/config/ReloadableConfig.h"
+#include "eden/fs/model/Blob.h"
+#include "eden/fs/model/Tree.h"
+#include "eden/fs/store/BlobCache.h"
+#include "eden/fs/store/ObjectCache.h"
+#include "eden/fs/store/TreeCache.h"
+
+namespace {
+
+using namespace facebook::eden;
+
+constexpr size_t kBlobCount = 1024;
+
+Hash makeHash(size_t i) {
+  std::array<uint8_t, Hash::RAW_SIZE> bytes = {0};
+  std::memcpy(bytes.data(), &i, sizeof(i));
+  return Hash{bytes};
+}
+
+/**
+ * Shared by all the benchmark threads. Set up by thread 0 before the
+ * benchmark loop, which the other threads only enter once it is done.
+ */
+std::shared_ptr<BlobCache> sharedCache;
+
+/**
+ * Concurrent lookups of kBlobCount cached blobs in a cache of state.range(0)
+ * shards, as done by every read of a loaded file. Each thread walks the
+ * blobs from a different offset.
+ */
+void get_cached_blobs(benchmark::State& state) {
+  if (state.thread_index == 0) {
+    sharedCache = BlobCache::create(
+        /*maximumCacheSizeBytes=*/1024 * 1024 * 1024,
+        /*minimumEntryCount=*/0,
+        state.range(0));
+    for (size_t i = 0; i < kBlobCount; ++i) {
+      sharedCache->insert(std::make_shared<Blob>(makeHash(i), folly::IOBuf{}));
+    }
+  }
+
+  std::vector<Hash> hashes;
+  hashes.reserve(kBlobCount);
+  for (size_t i = 0; i < kBlobCount; ++i) {
+    hashes.push_back(makeHash(i));
+  }
+  size_t next = state.thread_index * 17;
+
+  for (auto _ : state) {
+    auto result = sharedCache->get(hashes[next++ % kBlobCount]);
+    benchmark::DoNotOptimize(result.object);
+  }
+}
+
+BENCHMARK(get_cached_blobs)
+    ->Unit(benchmark::kNanosecond)
+    ->ArgName("shards")
+    ->Arg(1)
+    ->Arg(16)
+    ->Arg(64)
+    ->Threads(1)
+    ->Threads(8)
+    ->Threads(32)
+    ->Threads(64);
+
+/**
+ * The objects looked up by the workloads: kKeyCount popular ones, followed by
+ * kKeyCount more only ever touched by scans.
+ */
+constexpr size_t kKeyCount = 16384;
+constexpr size_t kBlobSize = 4096;
+constexpr size_t kOpsPerThread = 1 << 16;
+constexpr double kZipfExponent = 0.99;
+
+enum Workload : int64_t {
+  /// Lookups of the popular objects, following a Zipfian distribution.
+  Zipfian,
+  /// Like Zipfian, but a quarter of the lookups scan the other objects in
+  /// order, as a checkout or a recursive grep would.
+  ScanMixed,
+};
+
+/**
+ * The keys one thread looks up, generated before the benchmark loop.
+ */
+std::vector<size_t> generateKeys(Workload workload, size_t seed) {
+  static const std::vector<double> cdf = [] {
+    std::vector<double> weights(kKeyCount);
+    double total = 0;
+    for (size_t i = 0; i < kKeyCount; ++i) {
+      total += 1.0 / std::pow(i + 1, kZipfExponent);
+      weights[i] = total;
+    }
+    for (auto& weight : weights) {
+      weight /= total;
+    }
+    return weights;
+  }();
+
+  std::mt19937_64 rng{seed};
+  std::uniform_real_distribution<double> uniform{0.0, 1.0};
+  std::vector<size_t> keys;
+  keys.reserve(kOpsPerThread);
+  size_t nextScanned = kKeyCount + seed * 997 % kKeyCount;
+  for (size_t i = 0; i < kOpsPerThread; ++i) {
+    if (workload == ScanMixed && i % 4 == 3) {
+      keys.push_back(nextScanned);
+      nextScanned = nextScanned + 1 == 2 * kKeyCount ? kKeyCount
+                                                     : nextScanned + 1;
+      continue;
+    }
+    auto it = std::lower_bound(cdf.begin(), cdf.end(), uniform(rng));
+    keys.push_back(std::min<size_t>(it - cdf.begin(), kKeyCount - 1));
+  }
+  return keys;
+}
+
+std::vector<std::shared_ptr<const Blob>> makeBlobs() {
+  // The blobs share their contents, so that they only cost their headers.
+  static const std::array<char, kBlobSize> contents{};
+  std::vector<std::shared_ptr<const Blob>> blobs;
+  for (size_t i = 0; i < 2 * kKeyCount; ++i) {
+    blobs.push_back(std::make_shared<Blob>(
+        makeHash(i),
+        folly::IOBuf{
+            folly::IOBuf::WRAP_BUFFER, contents.data(), contents.size()}));
+  }
+  return blobs;
+}
+
+std::vector<std::shared_ptr<const Tree>> makeTrees() {
+  std::vector<std::shared_ptr<const Tree>> trees;
+  for (size_t i = 0; i < 2 * kKeyCount; ++i) {
+    std::vector<TreeEntry> entries;
+    for (size_t j = 0; j < 8; ++j) {
+      entries.emplace_back(
+          makeHash(j),
+          PathComponent{folly::to<std::string>("entry", j)},
+          TreeEntryType::REGULAR_FILE);
+    }
+    trees.push_back(std::make_shared<Tree>(std::move(entries), makeHash(i)));
+  }
+  return trees;
+}
+
+/**
+ * Adapts the lookups and insertions of each kind of cache to the workloads.
+ */
+struct SimpleObjectCacheOps {
+  using Object = Blob;
+  using Cache = ObjectCache<Blob, ObjectCacheFlavor::Simple>;
+
+  SimpleObjectCacheOps(size_t maximumSize, ObjectCachePolicy policy)
+      : cache{Cache::create(maximumSize, 0, /*shardCount=*/16, policy)} {}
+
+  static const std::vector<std::shared_ptr<const Blob>>& objects() {
+    static const auto blobs = makeBlobs();
+    return blobs;
+  }
+
+  bool get(const Hash& hash) {
+    return cache->getSimple(hash) != nullptr;
+  }
+
+  void insert(std::shared_ptr<const Blob> blob) {
+    cache->insertSimple(std::move(blob));
+  }
+
+  std::shared_ptr<Cache> cache;
+};
+
+struct InterestHandleObjectCacheOps {
+  using Object = Blob;
+  using Cache = ObjectCache<Blob, ObjectCacheFlavor::InterestHandle>;
+
+  InterestHandleObjectCacheOps(size_t maximumSize, ObjectCachePolicy policy)
+      : cache{Cache::create(maximumSize, 0, /*shardCount=*/16, policy)} {}
+
+  static const std::vector<std::shared_ptr<const Blob>>& objects() {
+    return SimpleObjectCacheOps::objects();
+  }
+
+  bool get(const Hash& hash) {
+    return cache->getInterestHandle(hash).object != nullptr;
+  }
+
+  void insert(std::shared_ptr<const Blob> blob) {
+    cache->insertInterestHandle(std::move(blob));
+  }
+
+  std::shared_ptr<Cache> cache;
+};
+
+struct BlobCacheOps {
+  using Object = Blob;
+
+  BlobCacheOps(size_t maximumSize, ObjectCachePolicy policy)
+      : cache{BlobCache::create(maximumSize, 0, /*shardCount=*/16, policy)} {}
+
+  static const std::vector<std::shared_ptr<const Blob>>& objects() {
+    return SimpleObjectCacheOps::objects();
+  }
+
+  bool get(const Hash& hash) {
+    return cache->get(hash).object != nullptr;
+  }
+
+  void insert(std::shared_ptr<const Blob> blob) {
+    cache->insert(std::move(blob));
+  }
+
+  std::shared_ptr<BlobCache> cache;
+};
+
+struct TreeCacheOps {
+  using Object = Tree;
+
+  TreeCacheOps(size_t maximumSize, ObjectCachePolicy policy) {
+    std::shared_ptr<EdenConfig> config = EdenConfig::createTestEdenConfig();
+    config->inMemoryTreeCacheSize.setValue(
+        maximumSize, ConfigSource::Default, true);
+    config->inMemoryTreeCacheMinElements.setValue(
+        0, ConfigSource::Default, true);
+    config->inMemoryTreeCacheShards.setValue(16, ConfigSource::Default, true);
+    config->inMemoryTreeCacheTinyLFU.setValue(
+        policy == ObjectCachePolicy::TinyLFU, ConfigSource::Default, true);
+    cache = TreeCache::create(std::make_shared<ReloadableConfig>(
+        config, ConfigReloadBehavior::NoReload));
+  }
+
+  static const std::vector<std::shared_ptr<const Tree>>& objects() {
+    static const auto trees = makeTrees();
+    return trees;
+  }
+
+  bool get(const Hash& hash) {
+    return cache->get(hash) != nullptr;
+  }
+
+  void insert(std::shared_ptr<const Tree> tree) {
+    cache->insert(std::move(tree));
+  }
+
+  std::shared_ptr<TreeCache> cache;
+};
+
+/**
+ * Look up objects following the workload state.range(1), in a cache holding
+ * state.range(0) percent of the popular objects, with the LRU policy or the
+ * TinyLFU one if state.range(2) is set. A miss inserts the object, as
+ * fetching it would.
+ *
+ * Reports the lookups per second, the hit rate and the p99 latency of an
+ * operation, averaged over the threads.
+ */
+template <typename Ops>
+void cache_workload(benchmark::State& state) {
+  static std::optional<Ops> sharedOps;
+  const auto& objects = Ops::objects();
+  if (state.thread_index == 0) {
+    size_t popularSize = 0;
+    for (size_t i = 0; i < kKeyCount; ++i) {
+      popularSize += objects[i]->getSizeBytes();
+    }
+    sharedOps.emplace(
+        popularSize * state.range(0) / 100,
+        state.range(2) ? ObjectCachePolicy::TinyLFU : ObjectCachePolicy::LRU);
+  }
+
+  auto keys = generateKeys(
+      static_cast<Workload>(state.range(1)), state.thread_index + 1);
+  std::vector<uint64_t> latencies;
+  latencies.reserve(kOpsPerThread);
+  size_t next = 0;
+  uint64_t hits = 0;
+
+  for (auto _ : state) {
+    const auto& object = objects[keys[next++ % kOpsPerThread]];
+    auto start = getTime();
+    if (sharedOps->get(object->getHash())) {
+      ++hits;
+    } else {
+      sharedOps->insert(object);
+    }
+    if (latencies.size() < kOpsPerThread) {
+      latencies.push_back(getTime() - start);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations());
+  state.counters["hit_rate"] = benchmark::Counter(
+      static_cast<double>(hits) / state.iterations(),
+      benchmark::Counter::kAvgThreads);
+  if (!latencies.empty()) {
+    auto p99 = latencies.begin() + latencies.size() * 99 / 100;
+    std::nth_element(latencies.begin(), p99, latencies.end());
+    state.counters["p99_ns"] =
+        benchmark::Counter(*p99, benchmark::Counter::kAvgThreads);
+  }
+}
+
+void workloadArgs(benchmark::internal::Benchmark* bench) {
+  bench->Unit(benchmark::kNanosecond)
+      ->ArgNames({"size_pct", "workload", "tinylfu"});
+  for (int64_t sizePercent : {10, 50}) {
+    for (int64_t workload : {Zipfian, ScanMixed}) {
+      for (int64_t tinyLFU : {0, 1}) {
+        bench->Args({sizePercent, workload, tinyLFU});
+      }
+    }
+  }
+  bench->Threads(1)->Threads(8)->Threads(32);
+}
+
+BENCHMARK_TEMPLATE(cache_workload, SimpleObjectCacheOps)->Apply(workloadArgs);
+BENCHMARK_TEMPLATE(cache_workload, InterestHandleObjectCacheOps)
+    ->Apply(workloadArgs);
+BENCHMARK_TEMPLATE(cache_workload, BlobCacheOps)->Apply(workloadArgs);
+BENCHMARK_TEMPLATE(cache_workload, TreeCacheOps)->Apply(workloadArgs);
+
+} // namespace
+
+EDEN_BENCHMARK_MAIN();
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <benchmark/benchmark.h>
+#include "eden/fs/benchharness/Bench.h"
+#include "eden/fs/utils/ProcessAccessLog.h"
+#include "eden/fs/utils/ProcessNameCache.h"
+
+namespace {
+
+using namespace facebook::eden;
+
+struct ProcessAccessLogFixture : benchmark::Fixture {
+  std::shared_ptr<ProcessNameCache> processNameCache{
+      std::make_shared<ProcessNameCache>()};
+  ProcessAccessLog processAccessLog{processNameCache};
+};
+
+/**
+ * A high but realistic amount of contention.
+ */
+constexpr size_t kThreadCount = 4;
+
+BENCHMARK_DEFINE_F(ProcessAccessLogFixture, add_self)(benchmark::State& state) {
+  auto myPid = getpid();
+  for (auto _ : state) {
+    processAccessLog.recordAccess(
+        myPid, ProcessAccessLog::AccessType::FsChannelOther);
+  }
+}
+
+BENCHMARK_REGISTER_F(ProcessAccessLogFixture, add_self)
+    ->Threads(1)
+    ->Threads(kThreadCount);
+
+/**
+ * What a filesystem request records: its access, then its duration.
+ */
+BENCHMARK_DEFINE_F(ProcessAccessLogFixture, add_request)
+(benchmark::State& state) {
+  auto myPid = getpid();
+  for (auto _ : state) {
+    processAccessLog.recordAccess(
+        myPid, ProcessAccessLog::AccessType::FsChannelRead);
+    processAccessLog.recordDuration(myPid, std::chrono::microseconds{10});
+  }
+}
+
+BENCHMARK_REGISTER_F(ProcessAccessLogFixture, add_request)
+    ->Threads(1)
+    ->Threads(kThreadCount);
+
+/**
+ * Alternating between pids defeats the cache of the last pid's counts.
+ */
+BENCHMARK_DEFINE_F(ProcessAccessLogFixture, add_alternating_pids)
+(benchmark::State& state) {
+  pid_t pids[] = {getpid(), getppid()};
+  size_t i = 0;
+  for (auto _ : state) {
+    processAccessLog.recordAccess(
+        pids[i++ & 1], ProcessAccessLog::AccessType::FsChannelOther);
+  }
+}
+
+BENCHMARK_REGISTER_F(ProcessAccessLogFixture, add_alternating_pids)
+    ->Threads(1)
+    ->Threads(kThreadCount);
+
+} // namespace
+
+EDEN_BENCHMARK_MAIN();
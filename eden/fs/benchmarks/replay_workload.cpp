@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <fcntl.h>
+#include <folly/Conv.h>
+#include <folly/container/F14Map.h>
+#include <folly/container/F14Set.h>
+#include <folly/init/Init.h>
+#include <folly/json.h>
+#include <folly/stop_watch.h>
+#include <gflags/gflags.h>
+#include <algorithm>
+#include <map>
+#include <thread>
+#include "eden/fs/fuse/DirList.h"
+#include "eden/fs/fuse/FuseDispatcher.h"
+#include "eden/fs/inodes/InodeBase.h"
+#include "eden/fs/inodes/WorkloadTrace.h"
+#include "eden/fs/store/ObjectFetchContext.h"
+#include "eden/fs/testharness/FakeTreeBuilder.h"
+#include "eden/fs/testharness/TestMount.h"
+
+using namespace facebook::eden;
+
+DEFINE_string(trace, "", "Workload trace recorded by WorkloadRecorder");
+DEFINE_double(
+    speed,
+    1.0,
+    "Replay the requests this many times faster than they were recorded, "
+    "or as fast as possible if 0");
+
+namespace {
+
+constexpr size_t kReaddirBufferSize = 4096;
+
+bool isCreation(const WorkloadTraceRecord& record) {
+  return record.op == "FUSE_CREATE" || record.op == "FUSE_MKDIR";
+}
+
+/**
+ * The files and directories the trace uses before creating them, which must
+ * be in the fresh mount it is replayed against.
+ *
+ * Whether a path was a directory isn't recorded, so paths that have children
+ * or are read as directories are directories and the others are files, big
+ * enough for the reads of the trace. The lookups that failed when recorded
+ * therefore succeed when replayed.
+ */
+FakeTreeBuilder buildInitialTree(
+    const std::vector<WorkloadTraceRecord>& records) {
+  folly::F14FastSet<RelativePath> created;
+  std::map<RelativePath, uint64_t> fileSizes;
+  folly::F14FastSet<RelativePath> dirs;
+
+  auto isCreated = [&](RelativePathPiece path) {
+    for (; !path.empty(); path = path.dirname()) {
+      if (created.count(RelativePath{path})) {
+        return true;
+      }
+    }
+    return false;
+  };
+  auto addExisting = [&](RelativePathPiece path, uint64_t size) {
+    if (path.empty() || isCreated(path)) {
+      return;
+    }
+    auto& fileSize = fileSizes[RelativePath{path}];
+    fileSize = std::max(fileSize, size);
+    for (auto parent = path.dirname(); !parent.empty();
+         parent = parent.dirname()) {
+      dirs.insert(RelativePath{parent});
+    }
+  };
+
+  for (const auto& record : records) {
+    if (isCreation(record)) {
+      created.insert(record.path);
+      continue;
+    }
+    addExisting(record.path, record.offset + record.size);
+    if (record.op == "FUSE_READDIR" || record.op == "FUSE_READDIRPLUS") {
+      dirs.insert(record.path);
+    }
+    if (record.newPath) {
+      created.insert(*record.newPath);
+    }
+  }
+
+  FakeTreeBuilder builder;
+  for (const auto& [path, size] : fileSizes) {
+    if (!dirs.count(path)) {
+      builder.setFile(path.stringPiece(), std::string(size, 'x'));
+    }
+  }
+  return builder;
+}
+
+struct OpStats {
+  std::vector<uint64_t> latenciesNs;
+  uint64_t errors{0};
+};
+
+class Replayer {
+ public:
+  explicit Replayer(const std::vector<WorkloadTraceRecord>& records)
+      : mount_{buildInitialTree(records)} {}
+
+  /**
+   * Send the request to the dispatcher of the mount and wait for its result,
+   * returning how long it took.
+   */
+  std::chrono::nanoseconds replay(const WorkloadTraceRecord& record) {
+    auto& context = ObjectFetchContext::getNullContext();
+    auto* dispatcher = mount_.getDispatcher();
+    const auto& op = record.op;
+    auto parent = [&] { return inodeNumber(record.path.dirname()); };
+    auto name = record.path.basename();
+
+    // Resolving the paths isn't timed, as the kernel would have done it.
+    folly::stop_watch<> timer;
+    if (op == "FUSE_LOOKUP") {
+      auto parentIno = parent();
+      timer.reset();
+      wait(dispatcher->lookup(0, parentIno, name, context));
+    } else if (op == "FUSE_GETATTR") {
+      auto ino = inodeNumber(record.path);
+      timer.reset();
+      wait(dispatcher->getattr(ino, context));
+    } else if (op == "FUSE_READ") {
+      auto ino = inodeNumber(record.path);
+      timer.reset();
+      wait(dispatcher->read(ino, record.size, record.offset, context));
+    } else if (op == "FUSE_WRITE") {
+      auto ino = inodeNumber(record.path);
+      std::string data(record.size, 'w');
+      timer.reset();
+      wait(dispatcher->write(ino, data, record.offset, context));
+    } else if (op == "FUSE_READDIR" || op == "FUSE_READDIRPLUS") {
+      auto ino = inodeNumber(record.path);
+      timer.reset();
+      if (op == "FUSE_READDIR") {
+        wait(dispatcher->readdir(
+            ino, FuseDirList{kReaddirBufferSize}, record.offset, 0, context));
+      } else {
+        wait(dispatcher->readdirplus(
+            ino, FuseDirList{kReaddirBufferSize}, record.offset, 0, context));
+      }
+    } else if (op == "FUSE_CREATE") {
+      auto parentIno = parent();
+      timer.reset();
+      wait(dispatcher->create(
+          parentIno, name, S_IFREG | 0644, O_RDWR, context));
+    } else if (op == "FUSE_MKDIR") {
+      auto parentIno = parent();
+      timer.reset();
+      wait(dispatcher->mkdir(parentIno, name, S_IFDIR | 0755, context));
+    } else if (op == "FUSE_UNLINK") {
+      auto parentIno = parent();
+      timer.reset();
+      wait(dispatcher->unlink(parentIno, name, context));
+    } else if (op == "FUSE_RMDIR") {
+      auto parentIno = parent();
+      timer.reset();
+      wait(dispatcher->rmdir(parentIno, name, context));
+    } else if (op == "FUSE_RENAME" && record.newPath) {
+      auto parentIno = parent();
+      auto newParentIno = inodeNumber(record.newPath->dirname());
+      timer.reset();
+      wait(dispatcher->rename(
+          parentIno, name, newParentIno, record.newPath->basename(), context));
+    } else {
+      throw std::invalid_argument(
+          folly::to<std::string>("unsupported request ", op));
+    }
+    return timer.elapsed();
+  }
+
+ private:
+  InodeNumber inodeNumber(RelativePathPiece path) {
+    return mount_.getInode(path)->getNodeId();
+  }
+
+  template <typename T>
+  T wait(ImmediateFuture<T> future) {
+    auto* executor = mount_.getServerExecutor().get();
+    return std::move(future).semi().via(executor).getVia(executor);
+  }
+
+  TestMount mount_;
+};
+
+double percentileUs(std::vector<uint64_t>& latencies, size_t percentile) {
+  if (latencies.empty()) {
+    return 0;
+  }
+  auto it = latencies.begin() + latencies.size() * percentile / 100;
+  std::nth_element(latencies.begin(), it, latencies.end());
+  return static_cast<double>(*it) / 1000;
+}
+
+} // namespace
+
+/**
+ * Replay a workload trace against a fresh TestMount, through its
+ * FuseDispatcher, and print the latencies of each kind of request as lines
+ * of JSON.
+ *
+ * The requests are replayed one at a time in the order they were received,
+ * so the concurrent requests of the recording are serialized.
+ */
+int main(int argc, char* argv[]) {
+  folly::init(&argc, &argv);
+
+  if (FLAGS_trace.empty()) {
+    fprintf(stderr, "error: trace is required\n");
+    return 1;
+  }
+  auto records = readWorkloadTrace(normalizeBestEffort(FLAGS_trace.c_str()));
+  Replayer replayer{records};
+
+  std::map<std::string, OpStats> stats;
+  std::chrono::nanoseconds totalLag{0};
+  folly::stop_watch<> clock;
+  for (const auto& record : records) {
+    if (FLAGS_speed > 0) {
+      auto due = std::chrono::duration_cast<std::chrono::nanoseconds>(
+          record.time / FLAGS_speed);
+      auto now = clock.elapsed();
+      if (now < due) {
+        std::this_thread::sleep_for(due - now);
+      } else {
+        totalLag += now - due;
+      }
+    }
+
+    auto& opStats = stats[record.op];
+    try {
+      opStats.latenciesNs.push_back(replayer.replay(record).count());
+    } catch (const std::exception&) {
+      ++opStats.errors;
+    }
+  }
+  auto elapsed = std::chrono::duration<double>{clock.elapsed()}.count();
+
+  for (auto& [op, opStats] : stats) {
+    auto& latencies = opStats.latenciesNs;
+    folly::dynamic result = folly::dynamic::object("op", op)(
+        "count", latencies.size())("errors", opStats.errors)(
+        "p50_us", percentileUs(latencies, 50))(
+        "p99_us", percentileUs(latencies, 99));
+    printf("%s\n", folly::toJson(result).c_str());
+  }
+  folly::dynamic summary = folly::dynamic::object("requests", records.size())(
+      "seconds", elapsed)("speed", FLAGS_speed)(
+      "average_lag_us",
+      records.empty()
+          ? 0.0
+          : std::chrono::duration<double, std::micro>{totalLag}.count() /
+              records.size());
+  printf("%s\n", folly::toJson(summary).c_str());
+  return 0;
+}
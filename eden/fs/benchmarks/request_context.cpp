@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <benchmark/benchmark.h>
+#include "eden/fs/benchharness/Bench.h"
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/nfs/NfsRequestContext.h"
+#include "eden/fs/telemetry/EdenStats.h"
+#include "eden/fs/telemetry/RequestMetricsScope.h"
+#include "eden/fs/utils/ProcessAccessLog.h"
+#include "eden/fs/utils/ProcessNameCache.h"
+
+namespace {
+
+using namespace facebook::eden;
+
+/**
+ * The bookkeeping of a filesystem request whose objects are all in memory,
+ * like a stat or read of a warm file: everything but the backing store work.
+ */
+struct RequestContextFixture : benchmark::Fixture {
+  std::shared_ptr<ProcessNameCache> processNameCache{
+      std::make_shared<ProcessNameCache>()};
+  ProcessAccessLog processAccessLog{processNameCache};
+  EdenStats stats;
+};
+
+constexpr size_t kThreadCount = 4;
+
+BENCHMARK_DEFINE_F(RequestContextFixture, warm_request)
+(benchmark::State& state) {
+  auto requestWatches = std::make_shared<RequestWatchList>();
+  Hash hash;
+  for (auto _ : state) {
+    NfsRequestContext context{1, "GETATTR", processAccessLog};
+    context.startRequest(&stats, &ChannelThreadStats::getattr, requestWatches);
+
+    // The fetch path only sees the ObjectFetchContext.
+    ObjectFetchContext& fetchContext = context;
+    benchmark::DoNotOptimize(fetchContext.getPriority());
+    benchmark::DoNotOptimize(fetchContext.getCauseDetail());
+    fetchContext.didFetch(
+        ObjectFetchContext::Blob, hash, ObjectFetchContext::FromMemoryCache);
+
+    context.finishRequest();
+  }
+}
+
+BENCHMARK_REGISTER_F(RequestContextFixture, warm_request)
+    ->Threads(1)
+    ->Threads(kThreadCount);
+
+} // namespace
+
+EDEN_BENCHMARK_MAIN();
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <folly/Conv.h>
+#include <optional>
+#include <string>
+#include "eden/fs/benchharness/Bench.h"
+#include "eden/fs/inodes/EdenMount.h"
+#include "eden/fs/model/git/TopLevelIgnores.h"
+#include "eden/fs/store/DiffContext.h"
+#include "eden/fs/store/ScmStatusDiffCallback.h"
+#include "eden/fs/store/StatsFetchContext.h"
+#include "eden/fs/testharness/FakeTreeBuilder.h"
+#include "eden/fs/testharness/TestMount.h"
+
+namespace {
+
+using namespace facebook::eden;
+
+constexpr size_t kNumDirs = 64;
+constexpr size_t kNumFilesPerDir = 64;
+
+std::string dirPath(size_t i) {
+  return folly::to<std::string>("dir", i % kNumDirs);
+}
+
+/**
+ * kNumDirs directories of kNumFilesPerDir files, each with a .gitignore
+ * ignoring *.o files if withGitignores is set.
+ */
+FakeTreeBuilder buildTree(bool withGitignores) {
+  FakeTreeBuilder builder;
+  for (size_t i = 0; i < kNumDirs; ++i) {
+    for (size_t j = 0; j < kNumFilesPerDir; ++j) {
+      auto path = folly::to<std::string>(dirPath(i), "/file", j);
+      builder.setFile(path, path);
+    }
+    if (withGitignores) {
+      builder.setFile(dirPath(i) + "/.gitignore", "*.o\n");
+    }
+  }
+  return builder;
+}
+
+/**
+ * Modify, add and create ignored files, numChanges of each kind spread over
+ * all the directories.
+ */
+void makeChanges(TestMount& mount, size_t numChanges) {
+  for (size_t i = 0; i < numChanges; ++i) {
+    auto dir = dirPath(i);
+    mount.overwriteFile(
+        folly::to<std::string>(dir, "/file", i / kNumDirs % kNumFilesPerDir),
+        "modified");
+    mount.addFile(folly::to<std::string>(dir, "/added", i), "added");
+    mount.addFile(folly::to<std::string>(dir, "/ignored", i, ".o"), "ignored");
+  }
+}
+
+/**
+ * Compute the status of the mount the way getScmStatusV2 does, but through a
+ * DiffContext we own, so that EdenMount's cached status isn't used and the
+ * fetches can be counted.
+ */
+void computeStatus(TestMount& mount, StatsFetchContext& stats) {
+  auto* edenMount = mount.getEdenMount().get();
+  ScmStatusDiffCallback callback;
+  DiffContext diffContext{
+      &callback,
+      /*listIgnored=*/false,
+      kPathMapDefaultCaseSensitive,
+      edenMount->getObjectStore(),
+      std::make_unique<TopLevelIgnores>("", ""),
+      [edenMount](ObjectFetchContext& fetchContext, RelativePathPiece path) {
+        return edenMount->loadFileContentsFromPath(
+            fetchContext, path, CacheHint::LikelyNeededAgain);
+      }};
+  edenMount->diff(&diffContext, edenMount->getParentCommit())
+      .getVia(mount.getServerExecutor().get());
+  auto status = callback.extractStatus();
+  benchmark::DoNotOptimize(status);
+  stats.merge(diffContext.getFetchContext());
+}
+
+void reportFetches(benchmark::State& state, const StatsFetchContext& stats) {
+  auto perIteration = [&](ObjectFetchContext::ObjectType type,
+                          ObjectFetchContext::Origin origin) {
+    return static_cast<double>(
+               stats.countFetchesOfTypeAndOrigin(type, origin)) /
+        state.iterations();
+  };
+  state.counters["trees_from_memory"] = perIteration(
+      ObjectFetchContext::Tree, ObjectFetchContext::FromMemoryCache);
+  state.counters["trees_from_backing_store"] = perIteration(
+      ObjectFetchContext::Tree, ObjectFetchContext::FromBackingStore);
+  state.counters["blobs_from_backing_store"] = perIteration(
+      ObjectFetchContext::Blob, ObjectFetchContext::FromBackingStore);
+  state.counters["sha1s_from_backing_store"] = perIteration(
+      ObjectFetchContext::BlobMetadata, ObjectFetchContext::FromBackingStore);
+}
+
+/**
+ * The first status of a fresh mount with state.range(0) changes of each
+ * kind, with .gitignore files if state.range(1) is set.
+ */
+void status_cold(benchmark::State& state) {
+  auto numChanges = static_cast<size_t>(state.range(0));
+  auto builder = buildTree(state.range(1) != 0);
+
+  StatsFetchContext stats;
+  // Kept across iterations so that unmounting isn't timed.
+  std::optional<TestMount> mount;
+  for (auto _ : state) {
+    state.PauseTiming();
+    mount.reset();
+    mount.emplace(builder.clone());
+    makeChanges(*mount, numChanges);
+    state.ResumeTiming();
+
+    computeStatus(*mount, stats);
+  }
+  reportFetches(state, stats);
+}
+
+/**
+ * Like status_cold, but running status repeatedly on the same mount.
+ */
+void status_warm(benchmark::State& state) {
+  auto numChanges = static_cast<size_t>(state.range(0));
+  TestMount mount{buildTree(state.range(1) != 0)};
+  makeChanges(mount, numChanges);
+  StatsFetchContext warmup;
+  computeStatus(mount, warmup);
+
+  StatsFetchContext stats;
+  for (auto _ : state) {
+    computeStatus(mount, stats);
+  }
+  reportFetches(state, stats);
+}
+
+void statusArgs(benchmark::internal::Benchmark* bench) {
+  bench->Unit(benchmark::kMillisecond)->ArgNames({"changes", "gitignores"});
+  for (int64_t numChanges : {0, 100, 1000}) {
+    for (int64_t withGitignores : {0, 1}) {
+      bench->Args({numChanges, withGitignores});
+    }
+  }
+}
+
+BENCHMARK(status_cold)->Apply(statusArgs);
+BENCHMARK(status_warm)->Apply(statusArgs);
+
+} // namespace
+
+EDEN_BENCHMARK_MAIN();
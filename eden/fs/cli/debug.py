@@ -782,6 +782,44 @@ class ListRecordingsCmd(Subcmd):
         return 0
 
 
+@debug_cmd(
+    "profile_cpu",
+    "Sample the CPU usage of EdenFS and write it as a pprof profile",
+)
+class ProfileCpuCmd(Subcmd):
+    def setup_parser(self, parser: argparse.ArgumentParser) -> None:
+        parser.add_argument(
+            "--duration",
+            type=int,
+            default=30,
+            help="How long to sample for, in seconds (default: %(default)s)",
+        )
+        parser.add_argument(
+            "output",
+            help="The file to write the profile to",
+        )
+
+    def run(self, args: argparse.Namespace) -> int:
+        instance = cmd_util.get_eden_instance(args)
+        output = os.path.abspath(args.output)
+        # The call only returns once the profile is written.
+        with instance.get_thrift_client_legacy(timeout=args.duration + 60) as client:
+            try:
+                result = client.debugProfileCpu(args.duration, output.encode())
+            except EdenError as err:
+                print(err, file=sys.stderr)
+                return 1
+        print(
+            f"Wrote {result.sampleCount} samples to {output}"
+            + (
+                f" ({result.droppedSampleCount} dropped)"
+                if result.droppedSampleCount
+                else ""
+            )
+        )
+        return 0
+
+
 def _print_inode_info(inode_info: TreeInodeDebugInfo, out: IO[bytes]) -> None:
     out.write(inode_info.path + b"\n")
     out.write(b"  Inode number:  %d\n" % inode_info.inodeNumber)
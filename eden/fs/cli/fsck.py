@@ -448,6 +448,18 @@ class FilesystemChecker:
                 inode_info = self._load_inode_info(inode_number)
                 inodes[inode_number] = inode_info
 
+        # The directories written by a log-structured overlay replace the inode
+        # files, which hold the directories from before it was used, if any.
+        for inode_number, tree_data in self.overlay.read_logged_dirs().items():
+            self._update_max_inode_number(inode_number)
+            inodes[inode_number] = InodeInfo(
+                inode_number,
+                InodeType.DIR,
+                self._get_children(tree_data.entries),
+                None,
+                None,
+            )
+
         return inodes
 
     def _link_inode_children(self, inodes: Dict[int, InodeInfo]) -> None:
@@ -523,23 +535,30 @@ class FilesystemChecker:
                 error = ex
 
         if dir_entries is not None:
-            for name, entry in dir_entries.items():
-                if entry.inodeNumber:
-                    self._update_max_inode_number(entry.inodeNumber)
-                children.append(
-                    ChildInfo(
-                        inode_number=entry.inodeNumber or 0,
-                        name=name,
-                        mode=entry.mode,
-                        hash=entry.hash,
-                    )
-                )
+            children = self._get_children(dir_entries)
 
         mtime = None
         if stat_info is not None:
             mtime = stat_info.st_mtime
         return InodeInfo(inode_number, type, children, mtime, error)
 
+    def _get_children(
+        self, dir_entries: Dict[str, overlay_mod.OverlayEntry]
+    ) -> List[ChildInfo]:
+        children: List[ChildInfo] = []
+        for name, entry in dir_entries.items():
+            if entry.inodeNumber:
+                self._update_max_inode_number(entry.inodeNumber)
+            children.append(
+                ChildInfo(
+                    inode_number=entry.inodeNumber or 0,
+                    name=name,
+                    mode=entry.mode,
+                    hash=entry.hash,
+                )
+            )
+        return children
+
     def fix_errors(self, fsck_dir: Optional[Path] = None) -> Optional[Path]:
         """Fix errors found by a previous call to scan_for_errors().
 
@@ -16,9 +16,14 @@ import tempfile
 import time
 import typing
 from pathlib import Path
-from typing import BinaryIO, Iterator, Optional, Tuple
+from typing import BinaryIO, Dict, Iterator, List, Optional, Tuple
 
-from facebook.eden.overlay.ttypes import OverlayDir, OverlayEntry
+from facebook.eden.overlay.ttypes import (
+    OverlayDir,
+    OverlayEntry,
+    OverlayLogOperation,
+    OverlayLogRecord,
+)
 
 from .util import fdatasync
 
@@ -27,6 +32,26 @@ class InvalidOverlayFile(Exception):
     pass
 
 
+def _make_crc32c_table() -> List[int]:
+    table = []
+    for byte in range(256):
+        crc = byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0x82F63B78 if crc & 1 else crc >> 1
+        table.append(crc)
+    return table
+
+
+_CRC32C_TABLE: List[int] = _make_crc32c_table()
+
+
+def _crc32c(data: bytes) -> int:
+    crc = 0xFFFFFFFF
+    for byte in data:
+        crc = _CRC32C_TABLE[(crc ^ byte) & 0xFF] ^ (crc >> 8)
+    return crc ^ 0xFFFFFFFF
+
+
 class NoSuchOverlayFile(Exception):
     def __init__(self, inode_number: int) -> None:
         super().__init__(f"inode {inode_number} is not materialized in the overlay")
@@ -155,6 +180,12 @@ class OverlayHeader:
 class Overlay:
     ROOT_INODE_NUMBER = 1
     NEXT_INODE_NUMBER_PATH = "next-inode-number"
+    # The files of a log-structured overlay. See LogOverlay.h.
+    LOG_SNAPSHOT_PATH = "dir-snapshot"
+    LOG_PATH_PREFIX = "dir-log."
+    LOG_SNAPSHOT_IDENTIFIER = b"OVSN"
+    LOG_IDENTIFIER = b"OVLG"
+    LOG_FORMAT_VERSION = 1
 
     def __init__(self, path: str) -> None:
         self.path = path
@@ -229,6 +260,120 @@ class Overlay:
         Serializer.deserialize(protocol_factory, data, tree_data)
         return tree_data
 
+    def read_logged_dirs(self) -> Dict[int, OverlayDir]:
+        """Read the directories written by a log-structured overlay.
+
+        They are in the snapshot and the logs of directory mutations rather than in
+        inode files, and replace the inode files of the same directories.  Like
+        EdenFS, this stops at the first torn record, and ignores the logs after it.
+        """
+        dirs: Dict[int, OverlayDir] = {}
+        generation = 0
+        snapshot = self._read_log_file(
+            self.LOG_SNAPSHOT_PATH, self.LOG_SNAPSHOT_IDENTIFIER
+        )
+        if snapshot is not None:
+            generation, records, _ = snapshot
+            for record in records:
+                self._apply_log_record(dirs, record)
+
+        while True:
+            log = self._read_log_file(
+                f"{self.LOG_PATH_PREFIX}{generation}", self.LOG_IDENTIFIER
+            )
+            if log is None:
+                break
+            _, records, torn = log
+            for record in records:
+                self._apply_log_record(dirs, record)
+            if torn:
+                break
+            generation += 1
+        return dirs
+
+    def _read_log_file(
+        self, name: str, identifier: bytes
+    ) -> Optional[Tuple[int, List[OverlayLogRecord], bool]]:
+        """Read the records of a snapshot or log.
+
+        Returns the generation of the file, its valid records, and whether it ends
+        with a torn or corrupted record, or None if the file does not exist or has
+        no header.
+        """
+        from thrift.protocol import TCompactProtocol
+        from thrift.util import Serializer
+
+        path = os.path.join(self.path, name)
+        try:
+            with open(path, "rb") as f:
+                data = f.read()
+        except FileNotFoundError:
+            return None
+        if len(data) < 16:
+            return None
+        if data[:4] != identifier:
+            raise InvalidOverlayFile(f"invalid overlay log header in {path}")
+        version, generation = struct.unpack(">IQ", data[4:16])
+        if version != self.LOG_FORMAT_VERSION:
+            raise InvalidOverlayFile(
+                f"unsupported overlay log version {version} in {path}"
+            )
+
+        protocol_factory = TCompactProtocol.TCompactProtocolFactory()
+        records: List[OverlayLogRecord] = []
+        offset = 16
+        while len(data) - offset >= 8:
+            length, checksum = struct.unpack(">II", data[offset : offset + 8])
+            payload = data[offset + 8 : offset + 8 + length]
+            if len(payload) < length or _crc32c(payload) != checksum:
+                break
+            record = OverlayLogRecord()
+            try:
+                Serializer.deserialize(protocol_factory, payload, record)
+            except Exception:
+                break
+            records.append(record)
+            offset += 8 + length
+        return (generation, records, offset != len(data))
+
+    def _apply_log_record(
+        self, dirs: Dict[int, OverlayDir], record: OverlayLogRecord
+    ) -> None:
+        op = record.operation
+        if op == OverlayLogOperation.SAVE_DIR:
+            tree_data = record.dir or OverlayDir()
+            if tree_data.entries is None:
+                tree_data.entries = {}
+            dirs[record.inodeNumber] = tree_data
+        elif op == OverlayLogOperation.REMOVE_DIR:
+            dirs.pop(record.inodeNumber, None)
+        elif op == OverlayLogOperation.ADD_CHILD:
+            entries = self._get_logged_dir(dirs, record.inodeNumber).entries
+            entries[record.name] = record.entry
+        elif op == OverlayLogOperation.REMOVE_CHILD:
+            entries = self._get_logged_dir(dirs, record.inodeNumber).entries
+            entries.pop(record.name, None)
+        elif op == OverlayLogOperation.RENAME_CHILD:
+            entries = self._get_logged_dir(dirs, record.inodeNumber).entries
+            entry = entries.pop(record.name, None)
+            if entry is not None:
+                dst = self._get_logged_dir(dirs, record.dstInodeNumber)
+                dst.entries[record.dstName] = entry
+
+    def _get_logged_dir(
+        self, dirs: Dict[int, OverlayDir], inode_number: int
+    ) -> OverlayDir:
+        tree_data = dirs.get(inode_number)
+        if tree_data is None:
+            # The first mutation of a directory in the log applies to its inode
+            # file, if it has one.
+            try:
+                tree_data = self.read_dir_inode(inode_number)
+            except NoSuchOverlayFile:
+                tree_data = OverlayDir(entries={})
+            dirs[inode_number] = tree_data
+        return tree_data
+
     def open_file_inode(self, inode_number: int) -> BinaryIO:
         return self.open_file_inode_tuple(inode_number)[1]
 
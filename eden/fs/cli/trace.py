@@ -5,6 +5,8 @@
 # GNU General Public License version 2.
 
 import argparse
+import os
+import sys
 
 from . import cmd_util, subcmd as subcmd_mod
 from .subcmd import Subcmd
@@ -29,6 +31,33 @@ class DisableTraceCmd(Subcmd):
         return 0
 
 
+@trace_cmd(
+    "export",
+    "Stream the trace blocks into a Chrome trace file, which chrome://tracing "
+    "and Perfetto can load",
+)
+class ExportTraceCmd(Subcmd):
+    def setup_parser(self, parser: argparse.ArgumentParser) -> None:
+        parser.add_argument(
+            "path", nargs="?", help="The file to write the trace into"
+        )
+        parser.add_argument(
+            "--stop", action="store_true", help="Stop the current export"
+        )
+
+    def run(self, args: argparse.Namespace) -> int:
+        if args.stop == bool(args.path):
+            print("Either a path or --stop must be given", file=sys.stderr)
+            return 1
+        instance = cmd_util.get_eden_instance(args)
+        with instance.get_thrift_client_legacy() as client:
+            if args.stop:
+                client.stopTraceExport()
+            else:
+                client.startTraceExport(os.path.abspath(args.path))
+        return 0
+
+
 @subcmd_mod.subcmd("trace", "Commands for managing EdenFS tracing")
 # pyre-fixme[13]: Attribute `parser` is never initialized.
 class TraceCmd(Subcmd):
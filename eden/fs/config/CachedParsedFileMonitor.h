@@ -35,8 +35,9 @@ class CachedParsedFileMonitor {
  public:
   CachedParsedFileMonitor(
       AbsolutePathPiece filePath,
-      std::chrono::milliseconds throttleDuration)
-      : fileChangeMonitor_{filePath, throttleDuration} {}
+      std::chrono::milliseconds throttleDuration,
+      FileChangeDetection detection = FileChangeDetection::Poll)
+      : fileChangeMonitor_{filePath, throttleDuration, detection} {}
 
   /**
    * Get the parsed file contents.  If the file (or its path) has changed we
@@ -69,6 +70,22 @@ class CachedParsedFileMonitor {
     return parsedData_;
   }
 
+  /**
+   * Reload and parse the file if it (or its path) has changed, without
+   * copying the parsed contents.
+   * @return the number of times the file has been updated (see
+   * getUpdateCount()), for the caller to tell whether its copy of the parsed
+   * contents is still current.
+   */
+  size_t refresh(AbsolutePathPiece filePath) {
+    fileChangeMonitor_.setFilePath(filePath);
+    fileChangeMonitor_.invokeIfUpdated(
+        [this](folly::File&& f, int errorNum, AbsolutePathPiece filePath) {
+          processUpdatedFile(std::move(f), errorNum, filePath);
+        });
+    return updateCount_;
+  }
+
   void processUpdatedFile(
       folly::File&& f,
       int errorNum,
@@ -119,6 +119,11 @@ class CheckoutConfig {
     return enableTreeOverlay_;
   }
 
+  /** Used by tests, the setting is normally read from the config file */
+  void setEnableTreeOverlay(bool enable) {
+    enableTreeOverlay_ = enable;
+  }
+
 #ifdef _WIN32
   /** Guid for that repository */
   Guid getRepoGuid() const {
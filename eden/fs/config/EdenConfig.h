@@ -220,6 +220,26 @@ class EdenConfig : private ConfigSettingManager {
       std::chrono::minutes(5),
       this};
 
+  /**
+   * The maximum number of mounts initialized at once when EdenFS remounts
+   * its checkouts at startup, most recently used first. 0 starts them all at
+   * once.
+   */
+  ConfigSetting<uint32_t> maxConcurrentStartupMounts{
+      "core:max-concurrent-startup-mounts",
+      4,
+      this};
+
+  /**
+   * The number of FUSE requests in flight across all mounts at which the
+   * periodic maintenance tasks, like local store management and inode
+   * unloading, are put off for up to one interval. 0 never puts them off.
+   */
+  ConfigSetting<uint32_t> maintenanceBusyRequests{
+      "core:maintenance-busy-requests",
+      32,
+      this};
+
   // [config]
 
   /**
@@ -246,6 +266,37 @@ class EdenConfig : private ConfigSettingManager {
       true,
       this};
 
+  /**
+   * The minimum interval between two notifications sent to a journal
+   * subscription stream. The changes made in between are coalesced into one
+   * notification, sent once the interval elapsed. Notifications are
+   * coalesced and sent from the server thread pool even when 0.
+   */
+  ConfigSetting<std::chrono::nanoseconds> journalSubscriberMinInterval{
+      "thrift:journal-subscriber-min-interval",
+      std::chrono::nanoseconds::zero(),
+      this};
+
+  /**
+   * The maximum number of expensive requests, such as globs and status, that
+   * a single client process may have in flight. Requests over it fail with an
+   * OVERLOADED error. 0 disables the limit.
+   */
+  ConfigSetting<uint32_t> thriftMaxConcurrentRequestsPerClient{
+      "thrift:max-concurrent-requests-per-client",
+      0,
+      this};
+
+  /**
+   * The maximum number of expensive requests a single client process may
+   * start per second, allowing bursts of up to one second worth of requests.
+   * 0 disables the limit.
+   */
+  ConfigSetting<double> thriftMaxRequestsPerClientPerSecond{
+      "thrift:max-requests-per-client-per-second",
+      0,
+      this};
+
   // [ssl]
 
   ConfigSetting<AbsolutePath> clientCertificate{
@@ -282,6 +333,24 @@ class EdenConfig : private ConfigSettingManager {
       1000,
       this};
 
+  /**
+   * The maximum number of trees whose entries' metadata is fetched in one
+   * request.
+   */
+  ConfigSetting<uint32_t> scsMetadataBatchSize{
+      "scs:metadata-batch-size",
+      100,
+      this};
+
+  /**
+   * The maximum number of tree metadata requests in flight. The trees whose
+   * metadata is needed meanwhile are batched behind them.
+   */
+  ConfigSetting<uint32_t> scsMaxConcurrentMetadataBatches{
+      "scs:max-concurrent-metadata-batches",
+      4,
+      this};
+
   // [store]
 
   /**
@@ -326,6 +395,125 @@ class EdenConfig : private ConfigSettingManager {
       20'000'000,
       this};
 
+  /*
+   * The following settings control how the RocksDB column family of each
+   * key space is tuned. They take effect when the local store is opened.
+   */
+
+  /**
+   * Overrides of the tuning profile of key spaces, as "keyspace:profile"
+   * entries. The profiles are "point-lookup" (small values, the default for
+   * proxy hashes and metadata), "tree" and "blob".
+   */
+  ConfigSetting<std::vector<std::string>> localStoreRocksDbProfiles{
+      "store:rocksdb-profiles",
+      std::vector<std::string>{},
+      this};
+
+  /**
+   * Size of the block cache shared by the column families using the
+   * "point-lookup" and "tree" profiles.
+   */
+  ConfigSetting<uint64_t> localStoreRocksDbBlockCacheSize{
+      "store:rocksdb-block-cache-size",
+      64 * 1024 * 1024,
+      this};
+
+  /**
+   * Size of the block cache of the column families using the "blob" profile.
+   * It is kept small and separate, on the assumption that the kernel caches
+   * file contents anyway.
+   */
+  ConfigSetting<uint64_t> localStoreRocksDbBlobBlockCacheSize{
+      "store:rocksdb-blob-block-cache-size",
+      8 * 1024 * 1024,
+      this};
+
+  /**
+   * Values at least this large in the column families using the "blob"
+   * profile are stored in separate blob files, so that compactions don't
+   * rewrite them. 0 disables blob files.
+   */
+  ConfigSetting<uint64_t> localStoreRocksDbBlobFileMinSize{
+      "store:rocksdb-blob-file-min-size",
+      0,
+      this};
+
+  /**
+   * The automatic garbage collection of the local store evicts the objects
+   * of a key space exceeding its limit that weren't read recently, until it
+   * is back to this fraction of its limit.
+   */
+  ConfigSetting<double> localStoreAutoGCTargetRatio{
+      "store:auto-gc-target-ratio",
+      0.9,
+      this};
+
+  /**
+   * The most bytes the automatic garbage collection evicts from a key space
+   * per management interval, so that it never empties a cache at once.
+   */
+  ConfigSetting<uint64_t> localStoreAutoGCMaxBytesPerRun{
+      "store:auto-gc-max-bytes-per-run",
+      512 * 1024 * 1024,
+      this};
+
+  /**
+   * When non-zero, writes to the RocksDB local store are made by a
+   * background thread, and puts block once this many bytes are waiting to
+   * be written. Read when the local store is opened.
+   */
+  ConfigSetting<uint64_t> localStoreWriteBackLimit{
+      "store:write-back-limit",
+      0,
+      this};
+
+  /**
+   * The memory the ephemeral key spaces of the memory local store may use,
+   * split between them in proportion to their size limits above. 0 means
+   * unbounded.
+   */
+  ConfigSetting<uint64_t> localStoreMemoryLimit{
+      "store:memory-limit",
+      0,
+      this};
+
+  /**
+   * When non-zero, the on-disk local store is fronted by an in-memory cache
+   * of up to this many bytes per cached key space. Read when the local
+   * store is opened.
+   */
+  ConfigSetting<uint64_t> localStoreL1CacheSize{
+      "store:l1-cache-size",
+      0,
+      this};
+
+  /**
+   * The key spaces cached in memory when store:l1-cache-size is set. Blobs
+   * and trees are left out by default, as they have their own caches above
+   * the local store.
+   */
+  ConfigSetting<std::vector<std::string>> localStoreL1CacheKeySpaces{
+      "store:l1-cache-key-spaces",
+      std::vector<std::string>{
+          "blobmeta",
+          "treemeta",
+          "hgproxyhash",
+          "hgcommit2tree",
+          "scsproxyhash"},
+      this};
+
+  /**
+   * When non-zero, one read of the RocksDB local store out of this many is
+   * logged to the eden-access-log file of its directory, from which
+   * eden_store_util estimates hit rates and exports the popular objects.
+   * Read when the local store is opened.
+   */
+  ConfigSetting<uint32_t> localStoreAccessLogSampleDenominator{
+      "store:access-log-sample-denominator",
+      0,
+      this};
+
   ConfigSetting<bool> useEdenNativePrefetch{
       "store:use-eden-native-prefetch",
       false,
@@ -408,6 +596,84 @@ class EdenConfig : private ConfigSettingManager {
    */
   ConfigSetting<uint32_t> maximumFuseRequests{"fuse:max-requests", 1000, this};
 
+  /**
+   * Whether EdenFS should ask the kernel to use FUSE_READDIRPLUS, which
+   * returns the attributes of every directory entry along with the listing
+   * instead of requiring one FUSE_LOOKUP per entry.
+   *
+   * This is only applicable to Linux.
+   */
+  ConfigSetting<bool> fuseUseReaddirplus{"fuse:use-readdirplus", false, this};
+
+  /**
+   * Whether EdenFS should splice(2) read replies into the FUSE device rather
+   * than copying them with writev(). Requires kernel support for
+   * FUSE_SPLICE_WRITE; EdenFS falls back to writev() otherwise.
+   *
+   * This is only applicable to Linux.
+   */
+  ConfigSetting<bool> fuseSpliceReplies{"fuse:splice-replies", false, this};
+
+  /**
+   * Whether each FUSE worker thread should read requests from its own clone
+   * of the FUSE device (FUSE_DEV_IOC_CLONE) instead of all threads sharing a
+   * single file descriptor. Threads fall back to the shared device if the
+   * kernel does not support cloning.
+   *
+   * This is only applicable to Linux.
+   */
+  ConfigSetting<bool> fuseCloneDevicePerThread{
+      "fuse:clone-device-per-thread",
+      false,
+      this};
+
+  /**
+   * Whether EdenFS should ask the kernel to use FUSE_WRITEBACK_CACHE, which
+   * buffers small writes in the page cache instead of sending every write()
+   * to EdenFS synchronously. Checkout first flushes the buffered writes of
+   * every inode the kernel references, which makes it slower when many
+   * inodes are loaded.
+   *
+   * This is only applicable to Linux. It takes effect on the next mount.
+   */
+  ConfigSetting<bool> fuseWritebackCache{"fuse:writeback-cache", false, this};
+
+  /**
+   * The number of FUSE worker threads that always run for each mount. When
+   * zero, the --fuseNumThreads command line flag is used.
+   */
+  ConfigSetting<uint32_t> fuseMinWorkerThreads{
+      "fuse:min-worker-threads",
+      0,
+      this};
+
+  /**
+   * The number of FUSE worker threads a mount may grow to while all of its
+   * worker threads are blocked in request handlers. Extra threads exit again
+   * once the mount has been idle for a while. Values below the minimum number
+   * of worker threads keep the pool at a fixed size.
+   */
+  ConfigSetting<uint32_t> fuseMaxWorkerThreads{
+      "fuse:max-worker-threads",
+      0,
+      this};
+
+  /**
+   * Where the FUSE worker threads of each mount run: "none", "spread",
+   * "pack" or "per-node". With "per-node" and fuse:clone-device-per-thread,
+   * each NUMA node has its own group of threads reading from their own
+   * clones of the FUSE device, so that a request is handled, and its buffers
+   * allocated, on the node of the thread that read it. The CPUs are handed
+   * out in turn to the placed threads of every pool, so that pools don't
+   * pile up on the same CPUs.
+   *
+   * This is only applicable to Linux. It takes effect on the next mount.
+   */
+  ConfigSetting<ThreadPlacement> fuseThreadPlacement{
+      "fuse:thread-placement",
+      ThreadPlacement::None,
+      this};
+
   // [nfs]
 
   /**
@@ -430,6 +696,15 @@ class EdenConfig : private ConfigSettingManager {
    */
   ConfigSetting<uint64_t> numNfsThreads{"nfs:num-servicing-threads", 8, this};
 
+  /**
+   * Where the threads servicing the NFS requests run. See
+   * fuse:thread-placement. Only read on startup.
+   */
+  ConfigSetting<ThreadPlacement> nfsThreadPlacement{
+      "nfs:thread-placement",
+      ThreadPlacement::None,
+      this};
+
   /**
    * Maximum number of pending NFS requests. If more requests are inflight, the
    * NFS code will block.
@@ -439,11 +714,51 @@ class EdenConfig : private ConfigSettingManager {
       1000,
       this};
 
+  /**
+   * Maximum number of NFS metadata requests, that is everything but READ,
+   * WRITE and COMMIT, processed at once by a mount. The requests above it are
+   * queued. When 0, there is no limit.
+   */
+  ConfigSetting<uint64_t> maxNfsInflightMetadataRequests{
+      "nfs:max-inflight-metadata-requests",
+      0,
+      this};
+
+  /**
+   * Maximum number of NFS READ, WRITE and COMMIT requests processed at once by
+   * a mount. These can wait on the backing store for a long time, bounding
+   * them separately keeps the metadata requests flowing during cold builds.
+   * The requests above it are queued. When 0, there is no limit.
+   */
+  ConfigSetting<uint64_t> maxNfsInflightDataRequests{
+      "nfs:max-inflight-data-requests",
+      256,
+      this};
+
+  /**
+   * Number of threads that will read from and write to the NFS sockets. When
+   * 0, all the connections are serviced by the main EventBase.
+   */
+  ConfigSetting<uint64_t> numNfsIoThreads{"nfs:num-io-threads", 0, this};
+
   /**
    * Buffer size for read and writes requests. Default to 1 MiB.
    */
   ConfigSetting<uint32_t> nfsIoSize{"nfs:iosize", 1024 * 1024, this};
 
+  /**
+   * Maximum duration the kernel may cache file and directory attributes for.
+   *
+   * Files that EdenFS didn't materialize only change on checkout, at which
+   * point EdenFS invalidates them. A large value thus lets the kernel answer
+   * most stat(2) from its cache instead of sending GETATTR. When 0, the
+   * kernel default is used.
+   */
+  ConfigSetting<std::chrono::nanoseconds> nfsAttributeCacheMax{
+      "nfs:attribute-cache-max",
+      std::chrono::seconds(0),
+      this};
+
   /**
    * Whether EdenFS NFS sockets should bind themself to unix sockets instead of
    * TCP ones.
@@ -476,6 +791,24 @@ class EdenConfig : private ConfigSettingManager {
       true,
       this};
 
+  /**
+   * Once a directory has been listed, prefetch the content of its files as
+   * they are likely to be read next. This is the maximum number of files
+   * prefetched on behalf of a single process per minute, 0 disables the
+   * prefetching. Only applicable on Windows
+   */
+  ConfigSetting<uint64_t> prjfsPrefetchBudgetPerProcess{
+      "prjfs:prefetch-budget-per-process",
+      0,
+      this};
+
+  // [git]
+
+  /**
+   * The number of threads importing the trees and blobs of git repositories.
+   */
+  ConfigSetting<uint32_t> gitImportThreads{"git:import-threads", 8, this};
+
   // [hg]
 
   /**
@@ -498,6 +831,97 @@ class EdenConfig : private ConfigSettingManager {
       1,
       this};
 
+  /**
+   * The number of proxy hashes of imported trees and their entries kept in
+   * memory, saving a LocalStore read before fetching these objects. Each
+   * takes roughly 150 bytes.
+   */
+  ConfigSetting<uint64_t> hgProxyHashIndexSize{
+      "hg:proxy-hash-index-size",
+      256 * 1024,
+      this};
+
+  /**
+   * How long the objects that EdenFS definitively failed to find in the hg
+   * store keep failing without being fetched again. 0 disables it.
+   */
+  ConfigSetting<std::chrono::nanoseconds> hgMissingObjectCacheTtl{
+      "hg:missing-object-cache-ttl",
+      std::chrono::seconds{10},
+      this};
+
+  /**
+   * The number of missing objects remembered for hg:missing-object-cache-ttl.
+   */
+  ConfigSetting<uint64_t> hgMissingObjectCacheSize{
+      "hg:missing-object-cache-size",
+      16 * 1024,
+      this};
+
+  /**
+   * The number of threads dequeuing import requests and resolving the ones
+   * available locally. Only read when a repository is opened.
+   */
+  ConfigSetting<uint32_t> numQueueWorkers{"hg:num-queue-workers", 32, this};
+
+  /**
+   * The largest number of threads importing the blobs that aren't available
+   * locally, and thus of blob batches waiting on the network at the same
+   * time. These threads are started while all the existing ones are busy,
+   * and exit once idle. Zero imports them on the hg queue workers. Only read
+   * when a repository is opened.
+   */
+  ConfigSetting<uint32_t> maxBlobFetchThreads{
+      "hg:max-blob-fetch-threads",
+      16,
+      this};
+
+  /**
+   * Like hg:max-blob-fetch-threads, for trees.
+   */
+  ConfigSetting<uint32_t> maxTreeFetchThreads{
+      "hg:max-tree-fetch-threads",
+      16,
+      this};
+
+  /**
+   * Like hg:max-blob-fetch-threads, for prefetch requests.
+   */
+  ConfigSetting<uint32_t> maxPrefetchThreads{
+      "hg:max-prefetch-threads",
+      4,
+      this};
+
+  /**
+   * Where the hg queue workers and fetch threads run. See
+   * fuse:thread-placement. Only read when a repository is opened.
+   */
+  ConfigSetting<ThreadPlacement> hgThreadPlacement{
+      "hg:thread-placement",
+      ThreadPlacement::None,
+      this};
+
+  /**
+   * Import batches that take longer than this shrink the following ones,
+   * and batches that are full and faster grow them, up to
+   * hg:import-batch-size and hg:import-batch-size-tree. Zero always uses the
+   * configured batch sizes.
+   */
+  ConfigSetting<std::chrono::nanoseconds> importBatchTargetLatency{
+      "hg:import-batch-target-latency",
+      std::chrono::seconds(1),
+      this};
+
+  /**
+   * How long import requests of a priority may wait without being served
+   * before they are scheduled as if they had the next higher priority, up
+   * to normal. Zero disables aging.
+   */
+  ConfigSetting<std::chrono::nanoseconds> importAgingInterval{
+      "hg:import-aging-interval",
+      std::chrono::seconds(10),
+      this};
+
   // [telemetry]
 
   /**
@@ -555,8 +979,8 @@ class EdenConfig : private ConfigSettingManager {
       this};
 
   /**
-   * Controls the max number of requests per minute per mount that can be sent
-   * for logging.
+   * Controls the max number of requests per minute that can be sent for
+   * logging, shared by all the threads and mounts of the process.
    * A request is first sampled based on its sampling group denominators. Then
    * if we have not reached this cap, the request is sent for logging.
    */
@@ -565,6 +989,16 @@ class EdenConfig : private ConfigSettingManager {
       0,
       this};
 
+  /**
+   * Requests slower than this are logged regardless of their sampling group
+   * denominator and of the request-samples-per-minute cap, except for the
+   * ones in the DropAll group. 0 disables this.
+   */
+  ConfigSetting<std::chrono::nanoseconds> requestSlowThreshold{
+      "telemetry:request-slow-threshold",
+      std::chrono::nanoseconds::zero(),
+      this};
+
   /**
    * Controls which configs we want to send with the request logging.
    * The elements are full config keys, e.g. "hg:import-batch-size".
@@ -577,6 +1011,27 @@ class EdenConfig : private ConfigSettingManager {
       std::vector<std::string>{},
       this};
 
+  /**
+   * The maximum number of process names remembered. Past it, the names
+   * referenced least recently are forgotten first.
+   * Only read at startup.
+   */
+  ConfigSetting<uint32_t> processNameCacheSize{
+      "telemetry:process-name-cache-size",
+      4096,
+      this};
+
+  /**
+   * The maximum number of process names read per second. When more new pids
+   * are seen, the most recently seen ones are read first, as those processes
+   * are the most likely to still be running. 0 disables the limit.
+   * Only read at startup.
+   */
+  ConfigSetting<uint32_t> processNameResolutionsPerSecond{
+      "telemetry:process-name-resolutions-per-second",
+      1000,
+      this};
+
   // [experimental]
 
   /**
@@ -600,6 +1055,130 @@ class EdenConfig : private ConfigSettingManager {
       folly::kIsApple,
       this};
 
+  /**
+   * Maximum number of subtrees that a checkout operation runs concurrently on
+   * the server thread pool. Subtrees over that limit, or all of them when set
+   * to 0, are checked out on the thread that fetched their tree.
+   */
+  ConfigSetting<uint64_t> checkoutMaxParallelSubtrees{
+      "experimental:checkout-max-parallel-subtrees",
+      0,
+      this};
+
+  /**
+   * Number of trees that checkout fetches concurrently when prefetching the
+   * trees that differ between the source and destination commits, before
+   * updating the inodes. 0 disables the prefetch, leaving checkout to fetch
+   * the trees one directory level at a time.
+   */
+  ConfigSetting<uint64_t> checkoutPrefetchTreeBatchSize{
+      "experimental:checkout-prefetch-tree-batch-size",
+      0,
+      this};
+
+  /**
+   * Number of directory levels below the root down to which checkout
+   * prefetches the changed trees. The deeper trees are fetched by the
+   * checkout of the inodes as it reaches them.
+   */
+  ConfigSetting<uint64_t> checkoutPrefetchTreeMaxDepth{
+      "experimental:checkout-prefetch-tree-max-depth",
+      4,
+      this};
+
+  /**
+   * Resident memory, in bytes, above which EdenFS unloads the unreferenced
+   * inodes that were accessed the least recently, a bit more at every
+   * inode-unload-interval until the resident memory is back under the target.
+   * 0 disables unloading inodes on memory pressure.
+   */
+  ConfigSetting<uint64_t> inodeUnloadMemoryTarget{
+      "experimental:inode-unload-memory-target",
+      0,
+      this};
+
+  /**
+   * How often the resident memory is compared against
+   * inode-unload-memory-target.
+   */
+  ConfigSetting<std::chrono::nanoseconds> inodeUnloadInterval{
+      "experimental:inode-unload-interval",
+      std::chrono::minutes(1),
+      this};
+
+  /**
+   * Inodes accessed more recently than this are never unloaded on memory
+   * pressure, as they are likely to be accessed again soon.
+   */
+  ConfigSetting<std::chrono::nanoseconds> inodeUnloadMinAge{
+      "experimental:inode-unload-min-age",
+      std::chrono::minutes(5),
+      this};
+
+  /**
+   * Maximum number of trees that a single diff operation fetches from the
+   * ObjectStore at once. 0 means that all the trees are requested as soon as
+   * they are known.
+   */
+  ConfigSetting<uint64_t> diffMaxConcurrentTreeFetches{
+      "experimental:diff-max-concurrent-tree-fetches",
+      0,
+      this};
+
+  /**
+   * How long the result of a status computation can be reused by the
+   * following status requests against the same commit, as long as the
+   * journal records no change to the working copy in between. Changes to the
+   * user and system ignore files are not journaled, and may take this long to
+   * be reflected in the status. 0 disables reusing status results.
+   */
+  ConfigSetting<std::chrono::nanoseconds> scmStatusCacheMaxAge{
+      "experimental:scm-status-cache-max-age",
+      std::chrono::nanoseconds::zero(),
+      this};
+
+  /**
+   * The number of parsed .gitignore files each mount keeps for the following
+   * status requests. 0 disables the cache, and the ignore files are then
+   * parsed again by every status request.
+   */
+  ConfigSetting<uint64_t> gitIgnoreCacheSize{
+      "experimental:gitignore-cache-size",
+      0,
+      this};
+
+  /**
+   * Once a process looked up the same name in this many sibling directories,
+   * EdenFS looks that name up in all the other siblings in the background,
+   * as build tools do when they look for a build file in every directory.
+   * 0 disables this prefetching.
+   */
+  ConfigSetting<uint64_t> prefetchSiblingLookupThreshold{
+      "experimental:prefetch-sibling-lookup-threshold",
+      0,
+      this};
+
+  /**
+   * The number of paths each mount remembers the inode of, for the Thrift
+   * calls that look the same paths up repeatedly. Renames, unlinks and
+   * checkouts forget all of them. 0 disables the cache.
+   */
+  ConfigSetting<uint64_t> inodePathCacheSize{
+      "experimental:inode-path-cache-size",
+      0,
+      this};
+
+  /**
+   * Whether each mount persists its journal in its client directory, and
+   * restores it across restarts so that the journal positions handed out by
+   * the previous process, such as the ones Watchman holds, stay valid.
+   * Journals are only restored after a clean shutdown or a graceful restart.
+   */
+  ConfigSetting<bool> persistJournal{
+      "experimental:persist-journal",
+      false,
+      this};
+
   // [treecache]
 
   /**
@@ -627,6 +1206,25 @@ class EdenConfig : private ConfigSettingManager {
       16,
       this};
 
+  /**
+   * Number of independently locked shards the tree cache is split into. The
+   * cache size and minimum element count are divided evenly between them.
+   * Only read on startup.
+   */
+  ConfigSetting<size_t> inMemoryTreeCacheShards{
+      "treecache:shards",
+      1,
+      this};
+
+  /**
+   * Whether the tree cache uses the scan-resistant W-TinyLFU policy rather
+   * than LRU, see ObjectCachePolicy. Only read on startup.
+   */
+  ConfigSetting<bool> inMemoryTreeCacheTinyLFU{
+      "treecache:tiny-lfu",
+      false,
+      this};
+
   // [notifications]
 
   /**
@@ -653,6 +1251,32 @@ class EdenConfig : private ConfigSettingManager {
   ConfigSetting<uint64_t> maxLogFileSize{"log:max-file-size", 50000000, this};
   ConfigSetting<uint64_t> maxRotatedLogFiles{"log:num-rotated-logs", 3, this};
 
+  /**
+   * Compress the rotated log files with zstd, in the background.
+   */
+  ConfigSetting<bool> compressRotatedLogs{
+      "log:compress-rotated-logs",
+      true,
+      this};
+
+  /**
+   * The total size of the rotated log files to keep, in addition to their
+   * number. 0 only limits their number.
+   */
+  ConfigSetting<uint64_t> maxRotatedLogBytes{
+      "log:max-rotated-bytes",
+      0,
+      this};
+
+  /**
+   * How fast the rotated log files are read while they are compressed, in
+   * bytes per second. 0 does not throttle the compression.
+   */
+  ConfigSetting<uint64_t> logCompressionBytesPerSecond{
+      "log:compression-bytes-per-second",
+      16 * 1024 * 1024,
+      this};
+
   // [prefetch-profiles]
 
   /**
@@ -730,6 +1354,18 @@ class EdenConfig : private ConfigSettingManager {
       false,
       this};
 
+  /**
+   * Keep the overlay directories in memory, and append their changes to a
+   * log which is replayed on startup, instead of writing a file per
+   * directory. Only used by mounts without the tree overlay, and not on
+   * Windows. Directories changed while this is enabled are lost when it is
+   * disabled again.
+   */
+  ConfigSetting<bool> logStructuredOverlay{
+      "overlay:log-structured-overlay",
+      false,
+      this};
+
   /**
    * The synchronous mode used when using tree overlay. Currently it only
    * supports "off" or "normal". Setting this to off may cause data loss.
@@ -739,6 +1375,38 @@ class EdenConfig : private ConfigSettingManager {
       "normal",
       this};
 
+  /**
+   * How often the modified inode metadata of the mounts is written back to
+   * disk, in one batch per mount. 0 leaves it to the kernel's writeback.
+   */
+  ConfigSetting<std::chrono::nanoseconds> inodeMetadataFlushInterval{
+      "overlay:inode-metadata-flush-interval",
+      std::chrono::minutes(1),
+      this};
+
+  /**
+   * Number of bytes of blob contents kept in the legacy overlay to clone
+   * materialized files from, or 0 to always copy the contents. The least
+   * recently used blobs are evicted when it is full. Only used on Linux,
+   * and read when a checkout is mounted.
+   */
+  ConfigSetting<uint64_t> overlayBlobCacheSize{
+      "overlay:blob-cache-size",
+      0,
+      this};
+
+  /**
+   * Number of bytes of materialized file contents indexed by SHA-1 in the
+   * legacy overlay, so that the files with the same contents share their
+   * storage, or 0 to store every file separately. The least recently used
+   * contents are evicted when it is full. Only used on Linux, and read when
+   * a checkout is mounted.
+   */
+  ConfigSetting<uint64_t> overlayContentIndexSize{
+      "overlay:content-index-size",
+      0,
+      this};
+
   // [clone]
 
   /**
@@ -148,4 +148,16 @@ std::string FieldConverter<MountProtocol>::toDebugString(
   return mountProtocolStr[folly::to_underlying(value)].str();
 }
 
+folly::Expected<ThreadPlacement, std::string>
+FieldConverter<ThreadPlacement>::fromString(
+    folly::StringPiece value,
+    const std::map<std::string, std::string>& /*unused*/) const {
+  return parseThreadPlacement(value);
+}
+
+std::string FieldConverter<ThreadPlacement>::toDebugString(
+    ThreadPlacement value) const {
+  return threadPlacementName(value).str();
+}
+
 } // namespace facebook::eden
@@ -23,6 +23,7 @@
 
 #include "eden/fs/config/MountProtocol.h"
 #include "eden/fs/utils/PathFuncs.h"
+#include "eden/fs/utils/ThreadPlacement.h"
 
 namespace facebook::eden {
 
@@ -205,4 +206,14 @@ class FieldConverter<MountProtocol> {
   std::string toDebugString(MountProtocol value) const;
 };
 
+template <>
+class FieldConverter<ThreadPlacement> {
+ public:
+  folly::Expected<ThreadPlacement, std::string> fromString(
+      folly::StringPiece value,
+      const std::map<std::string, std::string>& convData) const;
+
+  std::string toDebugString(ThreadPlacement value) const;
+};
+
 } // namespace facebook::eden
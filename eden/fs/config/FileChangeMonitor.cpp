@@ -6,7 +6,19 @@
  */
 
 #include <folly/FileUtil.h>
+#include <folly/Synchronized.h>
+#include <folly/container/F14Map.h>
 #include <folly/logging/xlog.h>
+#include <folly/system/ThreadName.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
 
 #include "eden/fs/config/FileChangeMonitor.h"
 #include "eden/fs/utils/StatTimes.h"
@@ -14,6 +26,181 @@
 
 namespace facebook::eden {
 
+namespace detail {
+
+/**
+ * The watch of one FileChangeMonitor. Its changed flag is set by the watcher
+ * thread when an event names the file, and cleared by the monitor when it
+ * stats the file.
+ */
+class FileChangeWatch {
+ public:
+  explicit FileChangeWatch(std::string name) : name{std::move(name)} {}
+
+  bool testAndClearChanged() {
+    return changed.exchange(false, std::memory_order_acq_rel);
+  }
+
+  /**
+   * Whether events are still delivered, which stops once the directory is
+   * removed or renamed.
+   */
+  bool isValid() const {
+    return valid.load(std::memory_order_acquire);
+  }
+
+  const std::string name;
+  int wd{-1};
+  std::atomic<bool> changed{true};
+  std::atomic<bool> valid{true};
+};
+
+} // namespace detail
+
+namespace {
+
+#ifdef __linux__
+/**
+ * Owns the inotify instance of the process, and a thread reading its events.
+ * The directory of each watched file is watched, since the editors usually
+ * replace files by renaming new ones over them.
+ */
+class FileChangeWatcher {
+ public:
+  /**
+   * The watcher of the process, or nullptr if inotify is unavailable.
+   */
+  static FileChangeWatcher* get() {
+    // Leaked, as its thread runs until the process exits.
+    static auto* watcher = [] {
+      int fd = inotify_init1(IN_CLOEXEC);
+      if (fd == -1) {
+        XLOG(WARN) << "inotify_init1 failed, file changes will be polled: "
+                   << folly::errnoStr(errno);
+        return static_cast<FileChangeWatcher*>(nullptr);
+      }
+      return new FileChangeWatcher{folly::File{fd, /*ownsFd=*/true}};
+    }();
+    return watcher;
+  }
+
+  std::shared_ptr<detail::FileChangeWatch> watch(const AbsolutePath& path) {
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0 && S_ISLNK(st.st_mode)) {
+      // The changes of the symlink's target would not be reported.
+      return nullptr;
+    }
+
+    auto watch = std::make_unique<detail::FileChangeWatch>(
+        path.basename().stringPiece().str());
+    auto directory = path.dirname().copy();
+    auto watches = watches_.lock();
+    // Adding a directory already watched returns its existing descriptor.
+    int wd = inotify_add_watch(file_.fd(), directory.c_str(), kMask);
+    if (wd == -1) {
+      XLOG(DBG3) << "unable to watch the directory of " << path << ": "
+                 << folly::errnoStr(errno);
+      return nullptr;
+    }
+    watch->wd = wd;
+    (*watches)[wd].push_back(watch.get());
+    return std::shared_ptr<detail::FileChangeWatch>{
+        watch.release(), [this](detail::FileChangeWatch* watch) {
+          unwatch(watch);
+          delete watch;
+        }};
+  }
+
+ private:
+  static constexpr uint32_t kMask = IN_CREATE | IN_DELETE | IN_MODIFY |
+      IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO |
+      IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR;
+
+  explicit FileChangeWatcher(folly::File file) : file_{std::move(file)} {
+    std::thread{[this] { run(); }}.detach();
+  }
+
+  void unwatch(detail::FileChangeWatch* watch) {
+    auto watches = watches_.lock();
+    auto it = watches->find(watch->wd);
+    if (it == watches->end()) {
+      return;
+    }
+    auto& dirWatches = it->second;
+    dirWatches.erase(
+        std::remove(dirWatches.begin(), dirWatches.end(), watch),
+        dirWatches.end());
+    if (dirWatches.empty()) {
+      // Fails harmlessly if the directory is already gone.
+      inotify_rm_watch(file_.fd(), it->first);
+      watches->erase(it);
+    }
+  }
+
+  void run() {
+    folly::setThreadName("FileChangeWatcher");
+    alignas(struct inotify_event) char buffer[16 * 1024];
+    while (true) {
+      auto bytes = folly::readNoInt(file_.fd(), buffer, sizeof(buffer));
+      if (bytes <= 0) {
+        XLOG(ERR) << "reading inotify events failed, file changes will be "
+                  << "polled: " << folly::errnoStr(errno);
+        invalidateAll();
+        return;
+      }
+
+      auto watches = watches_.lock();
+      for (ssize_t offset = 0; offset < bytes;) {
+        auto* event = reinterpret_cast<struct inotify_event*>(buffer + offset);
+        offset += sizeof(struct inotify_event) + event->len;
+
+        if (event->mask & IN_Q_OVERFLOW) {
+          // Events were lost, any file may have changed.
+          for (auto& entry : *watches) {
+            for (auto* watch : entry.second) {
+              watch->changed.store(true, std::memory_order_release);
+            }
+          }
+          continue;
+        }
+
+        auto it = watches->find(event->wd);
+        if (it == watches->end()) {
+          continue;
+        }
+        bool directoryGone =
+            event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF);
+        for (auto* watch : it->second) {
+          if (directoryGone) {
+            watch->valid.store(false, std::memory_order_release);
+            watch->changed.store(true, std::memory_order_release);
+          } else if (event->len && watch->name == event->name) {
+            watch->changed.store(true, std::memory_order_release);
+          }
+        }
+      }
+    }
+  }
+
+  void invalidateAll() {
+    auto watches = watches_.lock();
+    for (auto& entry : *watches) {
+      for (auto* watch : entry.second) {
+        watch->valid.store(false, std::memory_order_release);
+      }
+    }
+  }
+
+  folly::File file_;
+  folly::Synchronized<
+      folly::F14FastMap<int, std::vector<detail::FileChangeWatch*>>,
+      std::mutex>
+      watches_;
+};
+#endif
+
+} // namespace
+
 FileChangeReason hasFileChanged(
     const struct stat& stat1,
     const struct stat& stat2) noexcept {
@@ -62,6 +249,33 @@ folly::StringPiece FileChangeReason::str() const {
   return "invalid reason value";
 }
 
+FileChangeMonitor::~FileChangeMonitor() = default;
+
+FileChangeMonitor::FileChangeMonitor(const FileChangeMonitor& fcm)
+    : filePath_{fcm.filePath_},
+      fileStat_{fcm.fileStat_},
+      statErrno_{fcm.statErrno_},
+      openErrno_{fcm.openErrno_},
+      throttleDuration_{fcm.throttleDuration_},
+      lastCheck_{fcm.lastCheck_},
+      detection_{fcm.detection_} {
+  startWatching();
+}
+
+FileChangeMonitor& FileChangeMonitor::operator=(const FileChangeMonitor& fcm) {
+  if (this != &fcm) {
+    filePath_ = fcm.filePath_;
+    fileStat_ = fcm.fileStat_;
+    statErrno_ = fcm.statErrno_;
+    openErrno_ = fcm.openErrno_;
+    throttleDuration_ = fcm.throttleDuration_;
+    lastCheck_ = fcm.lastCheck_;
+    detection_ = fcm.detection_;
+    startWatching();
+  }
+  return *this;
+}
+
 AbsolutePath FileChangeMonitor::getFilePath() {
   return filePath_;
 }
@@ -70,7 +284,20 @@ void FileChangeMonitor::setFilePath(AbsolutePathPiece filePath) {
   if (filePath_ != filePath) {
     filePath_ = AbsolutePath{filePath};
     resetToForceChange();
+    startWatching();
+  }
+}
+
+void FileChangeMonitor::startWatching() {
+  watch_.reset();
+  if (detection_ != FileChangeDetection::Watch) {
+    return;
+  }
+#ifdef __linux__
+  if (auto* watcher = FileChangeWatcher::get()) {
+    watch_ = watcher->watch(filePath_);
   }
+#endif
 }
 
 bool FileChangeMonitor::throttle() {
@@ -81,8 +308,22 @@ std::optional<folly::Expected<folly::File, int>>
 FileChangeMonitor::checkIfUpdated(bool noThrottle) {
   std::optional<folly::Expected<folly::File, int>> rslt;
 
-  if (!noThrottle && throttle()) {
-    return rslt;
+  if (watch_ && watch_->isValid()) {
+    // Until the watch reports an event, the file is known to be unchanged.
+    if (!watch_->testAndClearChanged()) {
+      return rslt;
+    }
+  } else {
+    if (!noThrottle && throttle()) {
+      return rslt;
+    }
+    if (detection_ == FileChangeDetection::Watch) {
+      // The directory may have been created, or recreated, since.
+      startWatching();
+      if (watch_) {
+        watch_->testAndClearChanged();
+      }
+    }
   }
 
   // Update lastCheck - we use it for throttling
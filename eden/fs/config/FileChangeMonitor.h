@@ -11,6 +11,7 @@
 #include <sys/stat.h>
 #include <chrono>
 #include <functional>
+#include <memory>
 #include <optional>
 
 #include "eden/fs/utils/PathFuncs.h"
@@ -56,6 +57,23 @@ FileChangeReason hasFileChanged(
     const struct stat& stat1,
     const struct stat& stat2) noexcept;
 
+/**
+ * How a FileChangeMonitor detects changes.
+ */
+enum class FileChangeDetection {
+  /// Stat the file on every check, at most once per throttleDuration.
+  Poll,
+  /// Watch the directory of the file with inotify, and only stat the file
+  /// once an event names it, without throttling. Falls back to polling where
+  /// the watch cannot be established: on other platforms than Linux, when the
+  /// file is a symlink, or while its directory does not exist.
+  Watch,
+};
+
+namespace detail {
+class FileChangeWatch;
+}
+
 /**
  * FileChangeMonitor monitors a file for changes. The "invokeIfUpdated()"
  * method initiates a check and, if the file has changed, will run the
@@ -66,6 +84,8 @@ FileChangeReason hasFileChanged(
  *
  * FileChangeMonitor performs checks on demand. The throttleDuration setting
  * can further limit resource usage (to a maximum of 1 check/throttleDuration).
+ * With FileChangeDetection::Watch, checks are free until the file's directory
+ * reports an event on the file.
  *
  * FileChangeMonitor is not thread safe - users are responsible for locking as
  * necessary.
@@ -78,18 +98,25 @@ class FileChangeMonitor {
    */
   FileChangeMonitor(
       AbsolutePathPiece filePath,
-      std::chrono::milliseconds throttleDuration)
-      : filePath_{filePath}, throttleDuration_{throttleDuration} {
+      std::chrono::milliseconds throttleDuration,
+      FileChangeDetection detection = FileChangeDetection::Poll)
+      : filePath_{filePath},
+        throttleDuration_{throttleDuration},
+        detection_{detection} {
     resetToForceChange();
+    startWatching();
   }
 
-  ~FileChangeMonitor() = default;
+  ~FileChangeMonitor();
 
-  FileChangeMonitor(const FileChangeMonitor& fcm) = default;
+  /**
+   * A copy starts its own watch, as each monitor consumes its events.
+   */
+  FileChangeMonitor(const FileChangeMonitor& fcm);
 
   FileChangeMonitor(FileChangeMonitor&& fcm) = default;
 
-  FileChangeMonitor& operator=(const FileChangeMonitor& fcm) = default;
+  FileChangeMonitor& operator=(const FileChangeMonitor& fcm);
 
   FileChangeMonitor& operator=(FileChangeMonitor&& fcm) = default;
 
@@ -152,6 +179,13 @@ class FileChangeMonitor {
    */
   bool isChanged();
 
+  /**
+   * Start watching the directory of filePath_, if detection_ asks for it.
+   * The new watch reports a change first, for the next check to stat the
+   * file.
+   */
+  void startWatching();
+
   /**
    * Reset to base state. The next call to isChanged will return true
    * (this requires throttle to NOT activate). Useful during initialization and
@@ -176,6 +210,8 @@ class FileChangeMonitor {
   int openErrno_{0};
   std::chrono::milliseconds throttleDuration_;
   std::chrono::steady_clock::time_point lastCheck_;
+  FileChangeDetection detection_;
+  std::shared_ptr<detail::FileChangeWatch> watch_;
 };
 
 } // namespace facebook::eden
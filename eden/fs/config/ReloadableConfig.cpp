@@ -22,11 +22,11 @@ constexpr std::chrono::seconds kEdenConfigMinimumPollDuration{5};
 namespace facebook::eden {
 
 ReloadableConfig::ReloadableConfig(std::shared_ptr<const EdenConfig> config)
-    : state_{ConfigState{config}} {}
+    : config_{std::move(config)} {}
 ReloadableConfig::ReloadableConfig(
     std::shared_ptr<const EdenConfig> config,
     ConfigReloadBehavior reloadBehavior)
-    : state_{ConfigState{config}}, reloadBehavior_{reloadBehavior} {}
+    : config_{std::move(config)}, reloadBehavior_{reloadBehavior} {}
 
 ReloadableConfig::~ReloadableConfig() {}
 
@@ -58,15 +58,33 @@ std::shared_ptr<const EdenConfig> ReloadableConfig::getEdenConfig(
   }
 
   if (!shouldReload) {
-    return state_.rlock()->config;
+    return config_.load(std::memory_order_acquire);
   }
 
-  auto state = state_.wlock();
+  if (reload == ConfigReloadBehavior::AutoReload) {
+    std::unique_lock<std::mutex> lock{reloadLock_, std::try_to_lock};
+    auto lastCheck = std::chrono::steady_clock::time_point{
+        std::chrono::steady_clock::duration{
+            lastCheck_.load(std::memory_order_acquire)}};
+    if (!lock.owns_lock() ||
+        now - lastCheck < kEdenConfigMinimumPollDuration) {
+      // Another thread is checking the config files right now, or just did.
+      return config_.load(std::memory_order_acquire);
+    }
+    return reloadLocked(now);
+  }
+
+  std::lock_guard<std::mutex> lock{reloadLock_};
+  return reloadLocked(now);
+}
 
+std::shared_ptr<const EdenConfig> ReloadableConfig::reloadLocked(
+    std::chrono::steady_clock::time_point now) {
   // Throttle the updates when using ConfigReloadBehavior::AutoReload
   lastCheck_.store(now.time_since_epoch().count(), std::memory_order_release);
 
-  auto& config = state->config;
+  // Only the threads holding reloadLock_ replace the config.
+  auto config = config_.load(std::memory_order_acquire);
 
   auto userConfigChanged = config->hasUserConfigFileChanged();
   auto systemConfigChanged = config->hasSystemConfigFileChanged();
@@ -82,9 +100,10 @@ std::shared_ptr<const EdenConfig> ReloadableConfig::getEdenConfig(
                  << systemConfigChanged.str();
       newConfig->loadSystemConfig();
     }
-    state->config = std::move(newConfig);
+    config = std::move(newConfig);
+    config_.store(config, std::memory_order_release);
   }
-  return state->config;
+  return config;
 }
 
 } // namespace facebook::eden
@@ -7,10 +7,13 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <memory>
+#include <mutex>
+#include <optional>
 
-#include <folly/Synchronized.h>
+#include <folly/concurrency/AtomicSharedPtr.h>
 
 #include "eden/fs/config/gen-cpp2/eden_config_types.h"
 
@@ -21,6 +24,12 @@ class EdenConfig;
 /**
  * An interface that defines how to obtain a possibly reloaded EdenConfig
  * instance.
+ *
+ * The current EdenConfig is published through an atomic shared_ptr, so
+ * reading it never takes a lock. Reloads are serialized by a mutex, which a
+ * reader whose AutoReload check is due only tries: when another thread is
+ * already checking the config files, it returns the current config instead of
+ * waiting.
  */
 class ReloadableConfig {
  public:
@@ -40,13 +49,14 @@ class ReloadableConfig {
       ConfigReloadBehavior reload = ConfigReloadBehavior::AutoReload);
 
  private:
-  struct ConfigState {
-    explicit ConfigState(const std::shared_ptr<const EdenConfig>& config)
-        : config{config} {}
-    std::shared_ptr<const EdenConfig> config;
-  };
+  /**
+   * Reload the config files that changed, with reloadLock_ held.
+   */
+  std::shared_ptr<const EdenConfig> reloadLocked(
+      std::chrono::steady_clock::time_point now);
 
-  folly::Synchronized<ConfigState> state_;
+  folly::atomic_shared_ptr<const EdenConfig> config_;
+  std::mutex reloadLock_;
   std::atomic<std::chrono::steady_clock::time_point::rep> lastCheck_{};
 
   // Reload behavior, when set this overrides reload behavior passed to methods
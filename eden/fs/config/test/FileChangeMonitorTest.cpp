@@ -10,6 +10,7 @@
 #include <folly/experimental/TestUtil.h>
 #include <folly/portability/GTest.h>
 #include <folly/test/TestUtils.h>
+#include <thread>
 
 #include "eden/fs/config/FileChangeMonitor.h"
 #include "eden/fs/utils/FileUtils.h"
@@ -332,6 +333,71 @@ TEST_F(FileChangeMonitorTest, rmFileTest) {
   EXPECT_EQ(fcp.getErrorNum(), ENOENT);
 }
 
+#ifdef __linux__
+namespace {
+/**
+ * The watcher thread sets the changed flag asynchronously, so retry for a
+ * while before declaring that the change was missed.
+ */
+bool invokeOnceUpdated(FileChangeMonitor& fcm, MockFileChangeProcessor& fcp) {
+  for (int i = 0; i < 500; ++i) {
+    if (fcm.invokeIfUpdated(std::ref(fcp))) {
+      return true;
+    }
+    /* sleep override */
+    std::this_thread::sleep_for(10ms);
+  }
+  return false;
+}
+} // namespace
+
+TEST_F(FileChangeMonitorTest, watchDetectsChangesWithoutThrottle) {
+  MockFileChangeProcessor fcp;
+  auto path = AbsolutePath{(rootTestDir_->path() / "Watched.txt").string()};
+  writeFileAtomic(path, dataOne_).throwUnlessValue();
+
+  FileChangeMonitor fcm{path, 1h, facebook::eden::FileChangeDetection::Watch};
+  EXPECT_TRUE(fcm.invokeIfUpdated(std::ref(fcp)));
+  EXPECT_EQ(fcp.getCallbackCount(), 1);
+
+  // Changes to other files of the directory are ignored.
+  writeFileAtomic(pathTwo_, dataOne_).throwUnlessValue();
+  /* sleep override */
+  std::this_thread::sleep_for(100ms);
+  EXPECT_FALSE(fcm.invokeIfUpdated(std::ref(fcp)));
+
+  writeFileAtomic(path, dataTwo_).throwUnlessValue();
+  EXPECT_TRUE(invokeOnceUpdated(fcm, fcp));
+  EXPECT_EQ(fcp.getCallbackCount(), 2);
+  EXPECT_EQ(fcp.getFileContents(), dataTwo_);
+
+  remove(path.c_str());
+  EXPECT_TRUE(invokeOnceUpdated(fcm, fcp));
+  EXPECT_EQ(fcp.getCallbackCount(), 3);
+  EXPECT_EQ(fcp.getErrorNum(), ENOENT);
+}
+
+TEST_F(FileChangeMonitorTest, watchFallsBackToPollingWithoutDirectory) {
+  MockFileChangeProcessor fcp;
+  auto dir = rootTestDir_->path() / "NotYetCreated";
+  auto path = AbsolutePath{(dir / "Watched.txt").string()};
+
+  FileChangeMonitor fcm{path, 0s, facebook::eden::FileChangeDetection::Watch};
+  EXPECT_TRUE(fcm.invokeIfUpdated(std::ref(fcp)));
+  EXPECT_EQ(fcp.getErrorNum(), ENOENT);
+
+  ASSERT_EQ(0, mkdir(dir.string().c_str(), 0755));
+  writeFileAtomic(path, dataOne_).throwUnlessValue();
+  EXPECT_TRUE(invokeOnceUpdated(fcm, fcp));
+  EXPECT_EQ(fcp.getFileContents(), dataOne_);
+
+  // The directory is watched from then on.
+  writeFileAtomic(path, dataTwo_).throwUnlessValue();
+  EXPECT_TRUE(invokeOnceUpdated(fcm, fcp));
+  EXPECT_EQ(fcp.getFileContents(), dataTwo_);
+}
+#endif
+
 TEST_F(FileChangeMonitorTest, processExceptionTest) {
   MockFileChangeProcessor fcp{true};
   auto fcm = std::make_shared<FileChangeMonitor>(pathOne_, 0s);
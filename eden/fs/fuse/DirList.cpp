@@ -9,6 +9,7 @@
 
 #include "eden/fs/fuse/DirList.h"
 
+#include "eden/fs/fuse/FuseRequestPool.h"
 #include "eden/fs/fuse/FuseTypes.h"
 #include "eden/fs/inodes/InodeNumber.h"
 
@@ -16,9 +17,24 @@ using folly::StringPiece;
 
 namespace facebook::eden {
 
+void FuseDirList::BufferDeleter::operator()(char* buf) const noexcept {
+  if (pool) {
+    pool->deallocate(buf, size);
+  } else {
+    delete[] buf;
+  }
+}
+
 FuseDirList::FuseDirList(size_t maxSize)
     : buf_(new char[maxSize]), end_(buf_.get() + maxSize), cur_(buf_.get()) {}
 
+FuseDirList::FuseDirList(size_t maxSize, std::shared_ptr<FuseRequestPool> pool)
+    : buf_(
+          static_cast<char*>(pool->allocate(maxSize)),
+          BufferDeleter{pool, maxSize}),
+      end_(buf_.get() + maxSize),
+      cur_(buf_.get()) {}
+
 bool FuseDirList::add(StringPiece name, ino_t inode, dtype_t type, off_t off) {
   const size_t avail = end_ - cur_;
   const auto entLength = FUSE_NAME_OFFSET + name.size();
@@ -43,6 +59,43 @@ bool FuseDirList::add(StringPiece name, ino_t inode, dtype_t type, off_t off) {
   return true;
 }
 
+#ifdef __linux__
+size_t FuseDirList::direntPlusSize(size_t nameLength) {
+  return FUSE_DIRENT_ALIGN(FUSE_NAME_OFFSET_DIRENTPLUS + nameLength);
+}
+
+bool FuseDirList::addPlus(
+    StringPiece name,
+    const fuse_entry_out& entry,
+    ino_t inode,
+    dtype_t type,
+    off_t off) {
+  const size_t avail = end_ - cur_;
+  const auto entLength = FUSE_NAME_OFFSET_DIRENTPLUS + name.size();
+  const auto fullSize = direntPlusSize(name.size());
+  if (fullSize > avail) {
+    return false;
+  }
+
+  fuse_direntplus* const direntplus = reinterpret_cast<fuse_direntplus*>(cur_);
+  direntplus->entry_out = entry;
+  auto& dirent = direntplus->dirent;
+  dirent.ino = inode;
+  dirent.off = off;
+  dirent.namelen = name.size();
+  dirent.type = static_cast<decltype(dirent.type)>(type);
+  memcpy(dirent.name, name.data(), name.size());
+  if (fullSize > entLength) {
+    // 0 out any padding
+    memset(cur_ + entLength, 0, fullSize - entLength);
+  }
+
+  cur_ += fullSize;
+  XDCHECK_LE(cur_, end_);
+  return true;
+}
+#endif
+
 StringPiece FuseDirList::getBuf() const {
   return StringPiece(buf_.get(), cur_ - buf_.get());
 }
@@ -64,6 +117,28 @@ std::vector<FuseDirList::ExtractedEntry> FuseDirList::extract() const {
   return result;
 }
 
+#ifdef __linux__
+std::vector<FuseDirList::ExtractedEntry> FuseDirList::extractPlus() const {
+  std::vector<FuseDirList::ExtractedEntry> result;
+
+  char* p = buf_.get();
+  while (p != cur_) {
+    auto entry = reinterpret_cast<fuse_direntplus*>(p);
+    const auto& dirent = entry->dirent;
+    result.emplace_back(ExtractedEntry{
+        std::string{dirent.name, dirent.name + dirent.namelen},
+        dirent.ino,
+        static_cast<dtype_t>(dirent.type),
+        static_cast<off_t>(dirent.off),
+        entry->entry_out.nodeid,
+        entry->entry_out.attr.size});
+
+    p += FUSE_DIRENTPLUS_SIZE(entry);
+  }
+  return result;
+}
+#endif
+
 } // namespace facebook::eden
 
 #endif
@@ -11,13 +11,25 @@
 #include <memory>
 #include "eden/fs/utils/DirType.h"
 
+struct fuse_entry_out;
+
 namespace facebook::eden {
 
+class FuseRequestPool;
+
 /**
  * Helper for populating directory listings.
  */
 class FuseDirList {
-  std::unique_ptr<char[]> buf_;
+  struct BufferDeleter {
+    // Set when the buffer was allocated from a pool.
+    std::shared_ptr<FuseRequestPool> pool;
+    size_t size{0};
+
+    void operator()(char* buf) const noexcept;
+  };
+
+  std::unique_ptr<char[], BufferDeleter> buf_;
   char* end_;
   char* cur_;
 
@@ -27,10 +39,19 @@ class FuseDirList {
     ino_t inode;
     dtype_t type;
     off_t offset;
+    // Only populated by extractPlus().
+    uint64_t nodeid{0};
+    uint64_t size{0};
   };
 
   explicit FuseDirList(size_t maxSize);
 
+  /**
+   * Same as above, but the buffer is allocated from pool and returned to it
+   * when the list is destroyed.
+   */
+  FuseDirList(size_t maxSize, std::shared_ptr<FuseRequestPool> pool);
+
   FuseDirList(const FuseDirList&) = delete;
   FuseDirList& operator=(const FuseDirList&) = delete;
   FuseDirList(FuseDirList&&) = default;
@@ -42,6 +63,37 @@ class FuseDirList {
    */
   bool add(folly::StringPiece name, ino_t inode, dtype_t type, off_t off);
 
+#ifdef __linux__
+  /**
+   * Add a new fuse_direntplus to the list, as used by FUSE_READDIRPLUS.
+   *
+   * An entry whose entry.nodeid is 0 only carries the name, inode and type;
+   * the kernel will not take a reference on it and will fall back to a
+   * FUSE_LOOKUP if it needs its attributes.
+   *
+   * Returns true on success or false if the list is full.
+   */
+  bool addPlus(
+      folly::StringPiece name,
+      const fuse_entry_out& entry,
+      ino_t inode,
+      dtype_t type,
+      off_t off);
+
+  /**
+   * Returns the number of bytes that a fuse_direntplus for a name of
+   * nameLength bytes will consume in the list.
+   */
+  static size_t direntPlusSize(size_t nameLength);
+#endif
+
+  /**
+   * Returns the number of bytes that can still be added to the list.
+   */
+  size_t remainingSize() const {
+    return end_ - cur_;
+  }
+
   folly::StringPiece getBuf() const;
 
   /**
@@ -49,6 +101,13 @@ class FuseDirList {
    * parts.
    */
   std::vector<ExtractedEntry> extract() const;
+
+#ifdef __linux__
+  /**
+   * Same as extract(), but for a buffer populated with addPlus().
+   */
+  std::vector<ExtractedEntry> extractPlus() const;
+#endif
 };
 
 } // namespace facebook::eden
@@ -11,17 +11,27 @@
 
 #include <boost/cast.hpp>
 #include <fmt/core.h>
+#include <folly/ScopeGuard.h>
 #include <folly/executors/QueuedImmediateExecutor.h>
 #include <folly/futures/Future.h>
 #include <folly/logging/xlog.h>
+#include <folly/small_vector.h>
 #include <folly/system/ThreadName.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <signal.h>
+#include <sys/ioctl.h>
+#include <algorithm>
 #include <chrono>
+#include <iterator>
 #include <type_traits>
+#include <unordered_set>
 #include "eden/fs/fuse/DirList.h"
 #include "eden/fs/fuse/FuseDispatcher.h"
 #include "eden/fs/fuse/FuseRequestContext.h"
+#include "eden/fs/fuse/FuseRequestPool.h"
 #include "eden/fs/telemetry/FsEventLogger.h"
+#include "eden/fs/telemetry/SamplingProfiler.h"
 #include "eden/fs/utils/Bug.h"
 #include "eden/fs/utils/IDGen.h"
 #include "eden/fs/utils/Synchronized.h"
@@ -177,6 +187,7 @@ std::string readdir(FuseArg arg) {
   return format("offset={}", in.offset);
 }
 
+constexpr RenderFn readdirplus = readdir;
 constexpr RenderFn releasedir = default_render;
 constexpr RenderFn fsyncdir = default_render;
 
@@ -204,19 +215,62 @@ std::string fallocate(FuseArg arg) {
   return format("mode={}, offset={}, length={}", in.mode, in.offset, in.length);
 }
 
+#ifdef __linux__
+std::string lseek(FuseArg arg) {
+  auto& in = arg.read<fuse_lseek_in>();
+  return format("offset={}, whence={}", in.offset, in.whence);
+}
+
+std::string copyfilerange(FuseArg arg) {
+  auto& in = arg.read<fuse_copy_file_range_in>();
+  return format(
+      "off_in={}, nodeid_out={}, off_out={}, len={}",
+      in.off_in,
+      in.nodeid_out,
+      in.off_out,
+      in.len);
+}
+#endif
+
 } // namespace argrender
 
 // These static asserts exist to make explicit the memory usage of the per-mount
-// FUSE TraceBus. TraceBus uses 2 * capacity * sizeof(TraceEvent) memory usage,
-// so limit total memory usage to around 4 MB per mount.
-constexpr size_t kTraceBusCapacity = 25000;
+// FUSE TraceBus. TraceBus uses capacity * sizeof(TraceEvent) memory usage per
+// publishing thread, plus one batch, so limit memory usage to around 4 MB per
+// mount with the default number of FUSE threads.
+constexpr size_t kTraceBusCapacity = 5000;
 static_assert(sizeof(FuseTraceEvent) >= 72);
 static_assert(sizeof(FuseTraceEvent) <= 72);
-static_assert(kTraceBusCapacity * sizeof(FuseTraceEvent) == 1800000);
+static_assert(kTraceBusCapacity * sizeof(FuseTraceEvent) == 360000);
 
 // This is the minimum size used by libfuse so we use it too!
 constexpr size_t MIN_BUFSIZE = 0x21000;
 
+// Worker threads started beyond the configured minimum exit once no request
+// has found every worker thread busy for this long.
+constexpr std::chrono::seconds kWorkerIdleTimeout{30};
+
+// How long an extra worker thread waits for a request before checking again
+// whether it should retire.
+constexpr std::chrono::milliseconds kExtraWorkerPollTimeout{5000};
+
+// The number of freed FuseRequestContext allocations kept for reuse.  This is
+// enough to cover the bursts of concurrent requests seen during stat storms.
+constexpr size_t kMaxPooledRequests = 1024;
+
+// The number of freed directory listing buffers kept for reuse.
+constexpr size_t kMaxPooledDirListBuffers = 256;
+
+using ReplyIovecs = FuseChannel::ReplyIovecs;
+
+void appendToIovecs(const folly::IOBuf& buf, ReplyIovecs& vec) {
+  for (auto range : buf) {
+    if (!range.empty()) {
+      vec.push_back(iovec{const_cast<uint8_t*>(range.data()), range.size()});
+    }
+  }
+}
+
 using Handler = ImmediateFuture<folly::Unit> (FuseChannel::*)(
     FuseRequestContext& request,
     const fuse_in_header& header,
@@ -485,10 +539,26 @@ constexpr auto kFuseHandlers = [] {
       &ChannelThreadStats::fallocate,
       Write};
 #ifdef __linux__
-  handlers[FUSE_READDIRPLUS] = {"FUSE_READDIRPLUS", Read};
+  handlers[FUSE_READDIRPLUS] = {
+      "FUSE_READDIRPLUS",
+      &FuseChannel::fuseReadDirPlus,
+      &argrender::readdirplus,
+      &ChannelThreadStats::readdirplus,
+      Read,
+      SamplingGroup::Three};
   handlers[FUSE_RENAME2] = {"FUSE_RENAME2", Write};
-  handlers[FUSE_LSEEK] = {"FUSE_LSEEK"};
-  handlers[FUSE_COPY_FILE_RANGE] = {"FUSE_COPY_FILE_RANGE", Write};
+  handlers[FUSE_LSEEK] = {
+      "FUSE_LSEEK",
+      &FuseChannel::fuseLseek,
+      &argrender::lseek,
+      &ChannelThreadStats::lseek,
+      Read};
+  handlers[FUSE_COPY_FILE_RANGE] = {
+      "FUSE_COPY_FILE_RANGE",
+      &FuseChannel::fuseCopyFileRange,
+      &argrender::copyfilerange,
+      &ChannelThreadStats::copyfilerange,
+      Write};
   handlers[FUSE_SETUPMAPPING] = {"FUSE_SETUPMAPPING", Read};
   handlers[FUSE_REMOVEMAPPING] = {"FUSE_REMOVEMAPPING", Read};
 #endif
@@ -711,14 +781,17 @@ std::ostream& operator<<(
             << ")";
 }
 
-void FuseChannel::replyError(const fuse_in_header& request, int errorCode) {
+void FuseChannel::replyError(
+    int deviceFd,
+    const fuse_in_header& request,
+    int errorCode) {
   fuse_out_header err;
   err.len = sizeof(err);
   err.error = -errorCode;
   err.unique = request.unique;
   XLOG(DBG7) << "replyError unique=" << err.unique << " error=" << errorCode
              << " " << folly::errnoStr(errorCode);
-  auto res = write(fuseDevice_.fd(), &err, sizeof(err));
+  auto res = write(deviceFd, &err, sizeof(err));
   if (res != sizeof(err)) {
     if (res < 0) {
       throwSystemError("replyError: error writing to fuse device");
@@ -729,33 +802,39 @@ void FuseChannel::replyError(const fuse_in_header& request, int errorCode) {
 }
 
 void FuseChannel::sendReply(
+    int deviceFd,
     const fuse_in_header& request,
-    folly::fbvector<iovec>&& vec) const {
+    ReplyIovecs&& vec) const {
   fuse_out_header out;
   out.unique = request.unique;
   out.error = 0;
 
   vec.insert(vec.begin(), make_iovec(out));
 
-  sendRawReply(vec.data(), vec.size());
+  sendRawReply(deviceFd, vec.data(), vec.size());
 }
 
 void FuseChannel::sendReply(
+    int deviceFd,
     const fuse_in_header& request,
     const folly::IOBuf& buf) const {
+  if (useSpliceReplies_ && trySendSplicedReply(deviceFd, request, buf)) {
+    return;
+  }
+
   fuse_out_header out;
   out.unique = request.unique;
   out.error = 0;
 
-  folly::fbvector<iovec> vec;
-  vec.reserve(1 + buf.countChainElements());
+  ReplyIovecs vec;
   vec.push_back(make_iovec(out));
-  buf.appendToIov(&vec);
+  appendToIovecs(buf, vec);
 
-  sendRawReply(vec.data(), vec.size());
+  sendRawReply(deviceFd, vec.data(), vec.size());
 }
 
 void FuseChannel::sendReply(
+    int deviceFd,
     const fuse_in_header& request,
     folly::ByteRange bytes) const {
   fuse_out_header out;
@@ -768,10 +847,96 @@ void FuseChannel::sendReply(
   iov[1].iov_base = const_cast<uint8_t*>(bytes.data());
   iov[1].iov_len = bytes.size();
 
-  sendRawReply(iov.data(), iov.size());
+  sendRawReply(deviceFd, iov.data(), iov.size());
+}
+
+bool FuseChannel::trySendSplicedReply(
+    int deviceFd,
+    const fuse_in_header& request,
+    const folly::IOBuf& buf) const {
+#ifdef __linux__
+  if (!connInfo_.has_value() || !(connInfo_->flags & FUSE_SPLICE_WRITE) ||
+      spliceDisabled_.load(std::memory_order_relaxed)) {
+    return false;
+  }
+
+  fuse_out_header out;
+  out.unique = request.unique;
+  out.error = 0;
+  out.len = sizeof(out) + buf.computeChainDataLength();
+
+  ReplyIovecs vec;
+  vec.push_back(make_iovec(out));
+  appendToIovecs(buf, vec);
+  if (vec.size() > IOV_MAX) {
+    return false;
+  }
+
+  auto& splicePipe = *splicePipe_;
+  if (!splicePipe.readEnd) {
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC | O_NONBLOCK) != 0) {
+      XLOG(WARN) << "unable to create splice pipe: "
+                 << folly::errnoStr(errno);
+      return false;
+    }
+    splicePipe.readEnd = folly::File{fds[0], /*ownsFd=*/true};
+    splicePipe.writeEnd = folly::File{fds[1], /*ownsFd=*/true};
+    // Size the pipe so a full read reply fits. This may fail if bufferSize_
+    // exceeds /proc/sys/fs/pipe-max-size; large replies will then fall back
+    // to writev() below.
+    (void)fcntl(splicePipe.writeEnd.fd(), F_SETPIPE_SZ, bufferSize_);
+  }
+
+  // The write end is non-blocking: if the pipe cannot hold the whole reply,
+  // vmsplice() returns a short count rather than blocking forever, and the
+  // reply is sent with writev() instead.
+  auto queued = vmsplice(splicePipe.writeEnd.fd(), vec.data(), vec.size(), 0);
+  if (queued != static_cast<ssize_t>(out.len)) {
+    // Discard anything that was partially queued.
+    XLOG(DBG4) << "vmsplice queued " << queued << " of " << out.len
+               << " bytes, falling back to writev";
+    splicePipe = SplicePipe{};
+    return false;
+  }
+
+  auto res = splice(
+      splicePipe.readEnd.fd(),
+      nullptr,
+      deviceFd,
+      nullptr,
+      out.len,
+      SPLICE_F_MOVE);
+  const int err = errno;
+  XLOG(DBG7) << "trySendSplicedReply: unique=" << out.unique
+             << " len=" << out.len << " wrote=" << res;
+  if (res == static_cast<ssize_t>(out.len)) {
+    return true;
+  }
+
+  // Whatever is left in the pipe is garbage now.
+  splicePipe = SplicePipe{};
+  if (res < 0 &&
+      (err == ENOENT || !isFuseDeviceValid(state_.rlock()->stopReason))) {
+    // Same as sendRawReply(): the request was interrupted or the session is
+    // going away, so there is no point in retrying with writev().
+    throwSystemErrorExplicit(err, "error splicing to fuse device");
+  }
+  XLOG(WARN) << "splicing to the fuse device failed ("
+             << (res < 0 ? folly::errnoStr(err) : "short write")
+             << "), disabling spliced replies";
+  spliceDisabled_.store(true, std::memory_order_relaxed);
+  return false;
+#else
+  (void)deviceFd;
+  (void)request;
+  (void)buf;
+  return false;
+#endif
 }
 
-void FuseChannel::sendRawReply(const iovec iov[], size_t count) const {
+void FuseChannel::sendRawReply(int deviceFd, const iovec iov[], size_t count)
+    const {
   // Ensure that the length is set correctly
   XDCHECK_EQ(iov[0].iov_len, sizeof(fuse_out_header));
   const auto header = reinterpret_cast<fuse_out_header*>(iov[0].iov_base);
@@ -780,7 +945,7 @@ void FuseChannel::sendRawReply(const iovec iov[], size_t count) const {
     header->len += iov[i].iov_len;
   }
 
-  const auto res = writev(fuseDevice_.fd(), iov, count);
+  const auto res = writev(deviceFd, iov, count);
   const int err = errno;
   XLOG(DBG7) << "sendRawReply: unique=" << header->unique
              << " header->len=" << header->len << " wrote=" << res;
@@ -810,9 +975,16 @@ FuseChannel::FuseChannel(
     Notifications* notifications,
     CaseSensitivity caseSensitive,
     bool requireUtf8Path,
-    int32_t maximumBackgroundRequests)
+    int32_t maximumBackgroundRequests,
+    bool useReaddirplus,
+    bool useSpliceReplies,
+    bool cloneDevicePerThread,
+    size_t maxThreads,
+    bool useWritebackCache,
+    ThreadPlacement threadPlacement)
     : bufferSize_(std::max(size_t(getpagesize()) + 0x1000, MIN_BUFSIZE)),
       numThreads_(numThreads),
+      maxThreads_(std::max(numThreads, maxThreads)),
       dispatcher_(std::move(dispatcher)),
       straceLogger_(straceLogger),
       mountPath_(mountPath),
@@ -821,6 +993,19 @@ FuseChannel::FuseChannel(
       caseSensitive_{caseSensitive},
       requireUtf8Path_{requireUtf8Path},
       maximumBackgroundRequests_{maximumBackgroundRequests},
+      useReaddirplus_{useReaddirplus},
+      useSpliceReplies_{useSpliceReplies},
+      cloneDevicePerThread_{cloneDevicePerThread},
+      useWritebackCache_{useWritebackCache},
+      threadPlacement_{threadPlacement},
+      requestPool_{std::make_shared<FuseRequestPool>(
+          kMaxPooledRequests,
+          dispatcher_->getStats())},
+      dirListPool_{std::make_shared<FuseRequestPool>(
+          kMaxPooledDirListBuffers,
+          dispatcher_->getStats(),
+          &ChannelThreadStats::bufferAllocated,
+          &ChannelThreadStats::bufferRecycled)},
       fuseDevice_(std::move(fuseDevice)),
       processAccessLog_(std::move(processNameCache)),
       traceDetailedArguments_(std::make_shared<std::atomic<size_t>>(0)),
@@ -915,10 +1100,25 @@ void FuseChannel::startWorkerThreads() {
   }
 
   try {
+    // A thread that is already running (the initialization thread) keeps
+    // reading from fuseDevice_. Clone the device for each of the remaining
+    // threads so that they do not all contend on the same device.
+    if (cloneDevicePerThread_) {
+      cloneFuseDevices(numThreads_ - state->workerThreads.size());
+    }
+
     state->workerThreads.reserve(numThreads_);
+    size_t cloneIndex = 0;
     while (state->workerThreads.size() < numThreads_) {
-      state->workerThreads.emplace_back([this] { fuseWorkerThread(); });
+      int deviceFd = cloneIndex < clonedDevices_.size()
+          ? clonedDevices_[cloneIndex++].fd()
+          : fuseDevice_.fd();
+      state->workerThreads.emplace_back([this, deviceFd] {
+        placeCurrentThread(threadPlacement_);
+        fuseWorkerThread(deviceFd);
+      });
     }
+    liveWorkers_.store(state->workerThreads.size(), std::memory_order_relaxed);
 
     invalidationThread_ = std::thread([this] { invalidationThread(); });
   } catch (const std::exception& ex) {
@@ -930,12 +1130,47 @@ void FuseChannel::startWorkerThreads() {
   }
 }
 
+void FuseChannel::cloneFuseDevices(size_t count) {
+#ifdef __linux__
+  clonedDevices_.reserve(count);
+  while (clonedDevices_.size() < count) {
+    folly::File clone;
+    try {
+      clone = folly::File{"/dev/fuse", O_RDWR | O_CLOEXEC};
+    } catch (const std::system_error& ex) {
+      XLOG(WARN) << "unable to open /dev/fuse to clone the FUSE device, "
+                 << "sharing it among worker threads: " << exceptionStr(ex);
+      return;
+    }
+    uint32_t sourceFd = fuseDevice_.fd();
+    if (ioctl(clone.fd(), FUSE_DEV_IOC_CLONE, &sourceFd) != 0) {
+      // Older kernels, and FUSE devices that are not backed by /dev/fuse
+      // (such as FakeFuse in tests), do not support cloning. The threads
+      // without a clone simply share fuseDevice_.
+      XLOG(WARN) << "FUSE_DEV_IOC_CLONE failed, sharing the FUSE device "
+                 << "among worker threads: " << folly::errnoStr(errno);
+      return;
+    }
+    clonedDevices_.push_back(std::move(clone));
+  }
+  XLOG(DBG2) << "cloned the FUSE device for " << clonedDevices_.size()
+             << " worker threads";
+#else
+  (void)count;
+#endif
+}
+
 void FuseChannel::destroy() {
   std::vector<std::thread> threads;
   {
     auto state = state_.wlock();
     requestSessionExit(state, StopReason::DESTRUCTOR);
     threads.swap(state->workerThreads);
+    std::move(
+        state->retiredThreads.begin(),
+        state->retiredThreads.end(),
+        std::back_inserter(threads));
+    state->retiredThreads.clear();
   }
 
   for (auto& thread : threads) {
@@ -990,6 +1225,15 @@ void FuseChannel::invalidateInodes(folly::Range<InodeNumber*> range) {
     invalidationCV_.notify_one();
   }
 }
+
+bool FuseChannel::isWritebackCacheEnabled() const {
+#ifdef __linux__
+  return connInfo_.has_value() && (connInfo_->flags & FUSE_WRITEBACK_CACHE);
+#else
+  return false;
+#endif
+}
+
 folly::Future<folly::Unit> FuseChannel::flushInvalidations() {
   // Add a promise to the invalidation queue, which the invalidation thread
   // will fulfill once it reaches that element in the queue.
@@ -1000,6 +1244,136 @@ folly::Future<folly::Unit> FuseChannel::flushInvalidations() {
   return result;
 }
 
+size_t FuseChannel::coalesceInvalidations(
+    std::vector<InvalidationEntry>& entries) {
+  // Every entry is queued after the change it describes has been made, and
+  // invalidations are idempotent, so one notification per inode or directory
+  // entry is enough. Entries are never moved across a FLUSH entry, so all
+  // invalidations queued before flushInvalidations() are still sent before
+  // its promise is fulfilled.
+  constexpr int64_t kToEnd = std::numeric_limits<int64_t>::max();
+  auto rangeEnd = [](const DataRange& range) {
+    // A non-positive length invalidates through the end of the file.
+    return range.length <= 0 ? kToEnd : range.offset + range.length;
+  };
+
+  std::vector<InvalidationEntry> coalesced;
+  coalesced.reserve(entries.size());
+  // Indexes into coalesced of the INODE entries since the last FLUSH.
+  std::unordered_map<InodeNumber, std::vector<size_t>> inodeEntries;
+  // The DIR_ENTRY entries since the last FLUSH. The names point into
+  // coalesced, whose elements never move thanks to the reserve() above.
+  std::unordered_map<InodeNumber, std::unordered_set<PathComponentPiece>>
+      dirEntries;
+
+  for (auto& entry : entries) {
+    switch (entry.type) {
+      case InvalidationType::INODE: {
+        auto& indexes = inodeEntries[entry.inode];
+        bool merged = false;
+        for (auto index : indexes) {
+          auto& existing = coalesced[index].range;
+          if (entry.range.offset < 0) {
+            // A negative offset only invalidates attributes, which every inode
+            // invalidation does anyway.
+            merged = true;
+          } else if (existing.offset < 0) {
+            existing = entry.range;
+            merged = true;
+          } else if (
+              entry.range.offset <= rangeEnd(existing) &&
+              existing.offset <= rangeEnd(entry.range)) {
+            auto end = std::max(rangeEnd(existing), rangeEnd(entry.range));
+            existing.offset = std::min(existing.offset, entry.range.offset);
+            existing.length = end == kToEnd ? 0 : end - existing.offset;
+            merged = true;
+          }
+          if (merged) {
+            break;
+          }
+        }
+        if (!merged) {
+          indexes.push_back(coalesced.size());
+          coalesced.push_back(std::move(entry));
+        }
+        break;
+      }
+      case InvalidationType::DIR_ENTRY: {
+        auto& names = dirEntries[entry.inode];
+        if (names.find(entry.name) == names.end()) {
+          coalesced.push_back(std::move(entry));
+          names.insert(coalesced.back().name);
+        }
+        break;
+      }
+      case InvalidationType::FLUSH:
+        coalesced.push_back(std::move(entry));
+        inodeEntries.clear();
+        dirEntries.clear();
+        break;
+    }
+  }
+
+  auto removed = entries.size() - coalesced.size();
+  entries.swap(coalesced);
+  return removed;
+}
+
+FuseChannel::OpcodeLatencies::~OpcodeLatencies() {
+  for (auto& histogram : histograms) {
+    delete histogram.load(std::memory_order_relaxed);
+  }
+}
+
+void FuseChannel::recordLatency(
+    uint32_t opcode,
+    std::chrono::microseconds latency) {
+  if (opcode >= kMaxLatencyOpcodes) {
+    return;
+  }
+  auto& slot = opcodeLatencies_->histograms[opcode];
+  auto* histogram = slot.load(std::memory_order_relaxed);
+  if (!histogram) {
+    histogram = new LatencyHistogram;
+    slot.store(histogram, std::memory_order_release);
+  }
+  histogram->record(latency);
+}
+
+std::unordered_map<std::string, LatencyHistogram::Percentiles>
+FuseChannel::getOpcodeLatencies() const {
+  // Too large for the stack.
+  auto totals =
+      std::make_unique<std::array<LatencyHistogram, kMaxLatencyOpcodes>>();
+  std::array<bool, kMaxLatencyOpcodes> recorded{};
+  for (const auto& latencies : opcodeLatencies_.accessAllThreads()) {
+    for (size_t opcode = 0; opcode < kMaxLatencyOpcodes; ++opcode) {
+      auto* histogram =
+          latencies.histograms[opcode].load(std::memory_order_acquire);
+      if (histogram) {
+        (*totals)[opcode].merge(*histogram);
+        recorded[opcode] = true;
+      }
+    }
+  }
+
+  std::unordered_map<std::string, LatencyHistogram::Percentiles> result;
+  for (size_t opcode = 0; opcode < kMaxLatencyOpcodes; ++opcode) {
+    if (recorded[opcode]) {
+      result.emplace(
+          fuseOpcodeName(opcode).str(), (*totals)[opcode].getPercentiles());
+    }
+  }
+  return result;
+}
+
+FuseChannel::InvalidationCounts FuseChannel::getInvalidationCounts() const {
+  InvalidationCounts counts;
+  counts.sent = invalidationsSent_.load(std::memory_order_relaxed);
+  counts.coalesced = invalidationsCoalesced_.load(std::memory_order_relaxed);
+  return counts;
+}
+
 /**
  * Send an element from the invalidation queue.
  *
@@ -1072,7 +1446,7 @@ void FuseChannel::sendInvalidateInode(
   iov[1].iov_len = sizeof(notify);
 
   try {
-    sendRawReply(iov.data(), iov.size());
+    sendRawReply(fuseDevice_.fd(), iov.data(), iov.size());
     XLOG(DBG7) << "sendInvalidateInode(ino=" << ino << ", off=" << off
                << ", len=" << len << ") OK!";
   } catch (const std::system_error& exc) {
@@ -1131,7 +1505,7 @@ void FuseChannel::sendInvalidateEntry(
   iov[3].iov_len = 1;
 
   try {
-    sendRawReply(iov.data(), iov.size());
+    sendRawReply(fuseDevice_.fd(), iov.data(), iov.size());
   } catch (const std::system_error& exc) {
     // Ignore ENOENT.  This can happen for inode numbers that we allocated on
     // our own and haven't actually told the kernel about yet.
@@ -1226,6 +1600,7 @@ void FuseChannel::initWorkerThread() noexcept {
   try {
     setThreadSigmask();
     setThreadName(to<std::string>("fuse", mountPath_.basename()));
+    placeCurrentThread(threadPlacement_);
 
     // Read the INIT packet
     readInitPacket();
@@ -1245,18 +1620,17 @@ void FuseChannel::initWorkerThread() noexcept {
   initPromise_.setValue(sessionCompletePromise_.getSemiFuture());
 
   // Continue to run like a normal FUSE worker thread.
-  fuseWorkerThread();
+  fuseWorkerThread(fuseDevice_.fd());
 }
 
-void FuseChannel::fuseWorkerThread() noexcept {
+void FuseChannel::fuseWorkerThread(int deviceFd, bool extraWorker) noexcept {
   disablePthreadCancellation();
   setThreadName(to<std::string>("fuse", mountPath_.basename()));
   setThreadSigmask();
-  *(liveRequestWatches_.get()) =
-      std::make_shared<RequestMetricsScope::LockedRequestWatchList>();
+  *(liveRequestWatches_.get()) = std::make_shared<RequestWatchList>();
 
   try {
-    processSession();
+    processSession(deviceFd, extraWorker);
   } catch (const std::exception& ex) {
     XLOG(ERR) << "unexpected error in FUSE worker thread: " << exceptionStr(ex);
     // Request that all other FUSE threads exit.
@@ -1269,7 +1643,24 @@ void FuseChannel::fuseWorkerThread() noexcept {
   // Record that we have shut down.
   {
     auto state = state_.wlock();
-    ++state->stoppedThreads;
+    if (extraWorker) {
+      --state->extraThreads;
+      if (state->stopReason == StopReason::RUNNING) {
+        // We are retiring because the pool is idle.  Nobody else will join
+        // us, so hand our thread over to be joined later.
+        auto& threads = state->workerThreads;
+        auto it = std::find_if(threads.begin(), threads.end(), [](auto& t) {
+          return t.get_id() == std::this_thread::get_id();
+        });
+        XCHECK(it != threads.end());
+        state->retiredThreads.push_back(std::move(*it));
+        threads.erase(it);
+        liveWorkers_.store(threads.size(), std::memory_order_relaxed);
+        return;
+      }
+    } else {
+      ++state->stoppedThreads;
+    }
     XDCHECK(!state->destroyPending) << "destroyPending cannot be set while "
                                        "worker threads are still running";
 
@@ -1278,12 +1669,61 @@ void FuseChannel::fuseWorkerThread() noexcept {
     // but there are still outstanding requests we will invoke
     // sessionComplete() when we process the final stage of the request
     // processing for the last request.
-    if (state->stoppedThreads == numThreads_ && state->pendingRequests == 0) {
+    if (state->stoppedThreads == numThreads_ && state->extraThreads == 0 &&
+        state->pendingRequests == 0) {
       sessionComplete(std::move(state));
     }
   }
 }
 
+void FuseChannel::growWorkerPool() {
+  lastSaturated_.store(
+      std::chrono::steady_clock::now().time_since_epoch().count(),
+      std::memory_order_relaxed);
+
+  auto state = state_.wlock();
+  // Only grow once startWorkerThreads() has started the minimum number of
+  // threads, and never while we are shutting down.
+  if (state->stopReason != StopReason::RUNNING ||
+      state->workerThreads.size() < numThreads_ ||
+      state->workerThreads.size() >= maxThreads_ ||
+      busyWorkers_.load(std::memory_order_relaxed) <
+          state->workerThreads.size()) {
+    return;
+  }
+
+  // The retired threads have already released the lock for the last time, so
+  // joining them here does not block for long.
+  for (auto& thread : state->retiredThreads) {
+    thread.join();
+  }
+  state->retiredThreads.clear();
+
+  try {
+    // Extra threads share fuseDevice_; clones are only made up front.
+    int deviceFd = fuseDevice_.fd();
+    state->workerThreads.emplace_back([this, deviceFd] {
+      placeCurrentThread(threadPlacement_);
+      fuseWorkerThread(deviceFd, /*extraWorker=*/true);
+    });
+  } catch (const std::system_error& ex) {
+    XLOG(WARN) << "unable to grow the FUSE worker pool: " << exceptionStr(ex);
+    return;
+  }
+  ++state->extraThreads;
+  liveWorkers_.store(state->workerThreads.size(), std::memory_order_relaxed);
+  XLOG(DBG3) << "all FUSE worker threads for " << mountPath_
+             << " are busy, grew the pool to " << state->workerThreads.size()
+             << " threads";
+}
+
+bool FuseChannel::workerPoolIsIdle() const {
+  auto lastSaturated =
+      std::chrono::steady_clock::time_point{std::chrono::steady_clock::duration{
+          lastSaturated_.load(std::memory_order_relaxed)}};
+  return std::chrono::steady_clock::now() - lastSaturated > kWorkerIdleTimeout;
+}
+
 void FuseChannel::invalidationThread() noexcept {
   setThreadName(to<std::string>("inval", mountPath_.basename()));
 
@@ -1317,8 +1757,16 @@ void FuseChannel::invalidationThread() noexcept {
       lockedQueue->queue.swap(entries);
     }
 
+    // Large checkouts queue many invalidations for the same inodes while the
+    // previous batch is being sent, so weed out the redundant ones first.
+    invalidationsCoalesced_.fetch_add(
+        coalesceInvalidations(entries), std::memory_order_relaxed);
+
     // Process all of the entries we found
     for (auto& entry : entries) {
+      if (entry.type != InvalidationType::FLUSH) {
+        invalidationsSent_.fetch_add(1, std::memory_order_relaxed);
+      }
       sendInvalidation(entry);
     }
     entries.clear();
@@ -1403,7 +1851,7 @@ void FuseChannel::readInitPacket() {
   }
 
   if (init.header.opcode != FUSE_INIT) {
-    replyError(init.header, EPROTO);
+    replyError(fuseDevice_.fd(), init.header, EPROTO);
     throw std::runtime_error(folly::to<std::string>(
         "expected to receive FUSE_INIT for \"",
         mountPath_,
@@ -1437,9 +1885,8 @@ void FuseChannel::readInitPacket() {
   const auto capable = init.init.flags;
   auto& want = connInfo.flags;
 
-  // TODO: follow up and look at the new flags; particularly
-  // FUSE_DO_READDIRPLUS, FUSE_READDIRPLUS_AUTO. FUSE_SPLICE_XXX are interesting
-  // too, but may not directly benefit eden today.
+  // TODO: follow up and look at the new flags. FUSE_SPLICE_XXX are
+  // interesting, but may not directly benefit eden today.
   //
   // FUSE_ATOMIC_O_TRUNC is a nice optimization when the kernel supports it
   // and the FUSE daemon requires handling open/release for stateful file
@@ -1463,6 +1910,28 @@ void FuseChannel::readInitPacket() {
   want |= FUSE_CACHE_SYMLINKS;
   // We can handle almost any request in parallel.
   want |= FUSE_PARALLEL_DIROPS;
+  if (useSpliceReplies_) {
+    // Allow read replies to be spliced into the FUSE device, instead of
+    // copying them through writev().
+    want |= FUSE_SPLICE_WRITE | FUSE_SPLICE_MOVE;
+  }
+  if (useReaddirplus_) {
+    // Return the attributes of every entry along with the directory listing,
+    // sparing the kernel from sending one FUSE_LOOKUP per entry. With
+    // READDIRPLUS_AUTO the kernel only uses FUSE_READDIRPLUS when it sees
+    // lookups following a readdir, as is the case with `ls -l` or `find`.
+    want |= FUSE_DO_READDIRPLUS | FUSE_READDIRPLUS_AUTO;
+  }
+  if (useWritebackCache_) {
+    // Let the kernel buffer writes in its page cache and send them to us in
+    // large batches.  Checkout flushes the buffered writes before comparing
+    // the working copy; see isWritebackCacheEnabled().
+    want |= FUSE_WRITEBACK_CACHE;
+  }
+#else
+  (void)useReaddirplus_;
+  (void)useSpliceReplies_;
+  (void)useWritebackCache_;
 #endif
 #ifdef FUSE_NO_OPEN_SUPPORT
   // File handles are stateless so the kernel does not need to send open() and
@@ -1494,7 +1963,7 @@ void FuseChannel::readInitPacket() {
              << ", want=" << capsFlagsToLabel(want);
 
   if (init.init.major != FUSE_KERNEL_VERSION) {
-    replyError(init.header, EPROTO);
+    replyError(fuseDevice_.fd(), init.header, EPROTO);
     throw std::runtime_error(folly::to<std::string>(
         "Unsupported FUSE kernel version ",
         init.init.major,
@@ -1519,12 +1988,13 @@ void FuseChannel::readInitPacket() {
       FUSE_KERNEL_MINOR_VERSION > 22,
       "Your kernel headers are too old to build Eden.");
   if (init.init.minor > 22) {
-    sendReply(init.header, connInfo);
+    sendReply(fuseDevice_.fd(), init.header, connInfo);
   } else {
     // If the protocol version predates the expansion of fuse_init_out, only
     // send the start of the packet.
     static_assert(FUSE_COMPAT_22_INIT_OUT_SIZE <= sizeof(connInfo));
     sendReply(
+        fuseDevice_.fd(),
         init.header,
         ByteRange{
             reinterpret_cast<const uint8_t*>(&connInfo),
@@ -1535,22 +2005,42 @@ void FuseChannel::readInitPacket() {
       FUSE_KERNEL_MINOR_VERSION == 19,
       "osxfuse: API/ABI likely changed, may need something like the"
       " linux code above to send the correct response to the kernel");
-  sendReply(init.header, connInfo);
+  sendReply(fuseDevice_.fd(), init.header, connInfo);
 #endif
 
   dispatcher_->initConnection(connInfo);
 }
 
-void FuseChannel::processSession() {
+void FuseChannel::processSession(int deviceFd, bool extraWorker) {
   std::vector<char> buf(bufferSize_);
   // Save this for the sanity check later in the loop to avoid
   // additional syscalls on each loop iteration.
   auto myPid = getpid();
 
   while (!stop_.load(std::memory_order_relaxed)) {
+    if (extraWorker && workerPoolIsIdle()) {
+      XLOG(DBG3) << "FUSE worker pool for " << mountPath_
+                 << " is idle, stopping an extra worker thread";
+      return;
+    }
+    if (extraWorker) {
+      // Don't block in read() without a timeout, or an extra worker would
+      // only notice that it should retire once another request arrives.
+      // Another worker may still take the request between poll() and read(),
+      // in which case this one waits in read() for the next one.
+      struct pollfd pfd {
+        deviceFd, POLLIN, 0
+      };
+      auto ready = poll(&pfd, 1, kExtraWorkerPollTimeout.count());
+      if (ready == 0 || (ready < 0 && errno == EINTR)) {
+        continue;
+      }
+      // Other errors, and unmounts, are reported by read().
+    }
+
     // TODO: FUSE_SPLICE_READ allows using splice(2) here if we enable it.
-    // We can look at turning this on once the main plumbing is complete.
-    auto res = read(fuseDevice_.fd(), buf.data(), buf.size());
+    // Only replies are spliced today; see trySendSplicedReply().
+    auto res = read(deviceFd, buf.data(), buf.size());
     if (UNLIKELY(res < 0)) {
       int error = errno;
       if (stop_.load(std::memory_order_relaxed)) {
@@ -1635,7 +2125,7 @@ void FuseChannel::processSession() {
       bool matched = false;
       for (auto fastTrack : kFastTracks) {
         if (namePiece == fastTrack) {
-          replyError(*header, ENODATA);
+          replyError(deviceFd, *header, ENODATA);
           matched = true;
           break;
         }
@@ -1654,7 +2144,7 @@ void FuseChannel::processSession() {
     // to resolve this deadlock on kernel inode locks without rebooting the
     // system.
     if (UNLIKELY(static_cast<pid_t>(header->pid) == myPid)) {
-      replyError(*header, EIO);
+      replyError(deviceFd, *header, EIO);
       XLOG(CRITICAL) << "Received FUSE request from our own pid: opcode="
                      << header->opcode << " nodeid=" << header->nodeid
                      << " pid=" << header->pid;
@@ -1668,7 +2158,7 @@ void FuseChannel::processSession() {
 
     switch (header->opcode) {
       case FUSE_INIT:
-        replyError(*header, EPROTO);
+        replyError(deviceFd, *header, EPROTO);
         throw std::runtime_error(
             "received FUSE_INIT after we have been initialized!?");
 
@@ -1678,23 +2168,13 @@ void FuseChannel::processSession() {
         // Deliberately not handling locking; this causes
         // the kernel to do it for us
         XLOG(DBG7) << fuseOpcodeName(header->opcode);
-        replyError(*header, ENOSYS);
+        replyError(deviceFd, *header, ENOSYS);
         break;
 
-#ifdef __linux__
-      case FUSE_LSEEK:
-        // We only support stateless file handles, so lseek() is meaningless
-        // for us.  Returning ENOSYS causes the kernel to implement it for us,
-        // and will cause it to stop sending subsequent FUSE_LSEEK requests.
-        XLOG(DBG7) << "FUSE_LSEEK";
-        replyError(*header, ENOSYS);
-        break;
-#endif
-
       case FUSE_POLL:
         // We do not currently implement FUSE_POLL.
         XLOG(DBG7) << "FUSE_POLL";
-        replyError(*header, ENOSYS);
+        replyError(deviceFd, *header, ENOSYS);
         break;
 
       case FUSE_INTERRUPT: {
@@ -1715,7 +2195,7 @@ void FuseChannel::processSession() {
         // we have responded, which in turn blocks our attempt to gracefully
         // unmount, so we respond here.  It doesn't hurt Linux to respond
         // so we do it for both platforms.
-        replyError(*header, 0);
+        replyError(deviceFd, *header, 0);
         break;
 
       case FUSE_NOTIFY_REPLY:
@@ -1728,7 +2208,7 @@ void FuseChannel::processSession() {
       case FUSE_IOCTL:
         // Rather than the default ENOSYS, we need to return ENOTTY
         // to indicate that the requested ioctl is not supported
-        replyError(*header, ENOTTY);
+        replyError(deviceFd, *header, ENOTTY);
         break;
 
       default: {
@@ -1745,11 +2225,20 @@ void FuseChannel::processSession() {
           // This is a shared_ptr because, due to timeouts, the internal request
           // lifetime may not match the FUSE request lifetime, so we capture it
           // in both. I'm sure this could be improved with some cleverness.
-          auto request = std::make_shared<FuseRequestContext>(this, *header);
+          //
+          // Its allocation comes from requestPool_ rather than the heap.
+          // The read buffer itself is owned by this worker thread and reused
+          // for every request it reads.
+          auto request = std::allocate_shared<FuseRequestContext>(
+              FuseRequestPool::Allocator<FuseRequestContext>{requestPool_},
+              this,
+              deviceFd,
+              *header);
 
           ++state_.wlock()->pendingRequests;
 
           auto headerCopy = *header;
+          auto startTime = std::chrono::steady_clock::now();
 
           FB_LOG(*straceLogger_, DBG7, ([&]() -> std::string {
             std::string rendered;
@@ -1764,6 +2253,18 @@ void FuseChannel::processSession() {
                 rendered);
           })());
 
+          // If this request leaves no worker thread reading from the device,
+          // start another one so that new requests are not stuck behind
+          // dispatcher calls that block.
+          const auto busyWorkers = ++busyWorkers_;
+          SCOPE_EXIT {
+            --busyWorkers_;
+          };
+          if (maxThreads_ > numThreads_ &&
+              busyWorkers >= liveWorkers_.load(std::memory_order_relaxed)) {
+            growWorkerPool();
+          }
+
           request
               ->catchErrors(
                   folly::makeFutureWith([&] {
@@ -1771,16 +2272,27 @@ void FuseChannel::processSession() {
                         dispatcher_->getStats(),
                         handlerEntry->stat,
                         *(liveRequestWatches_.get()));
-                    return (this->*handlerEntry->handler)(
-                               *request, request->getReq(), arg)
-                        .semi()
-                        .via(&folly::QueuedImmediateExecutor::instance());
+                    auto allocations = getImmediateFutureAllocationCount();
+                    ProfilerTag profilerTag{handlerEntry->name.data()};
+                    auto semi = (this->*handlerEntry->handler)(
+                                    *request, request->getReq(), arg)
+                                    .semi();
+                    dispatcher_->getStats()
+                        ->getChannelStatsForCurrentThread()
+                        .futureAllocations.addValue(
+                            getImmediateFutureAllocationCount() - allocations);
+                    return std::move(semi).via(
+                        &folly::QueuedImmediateExecutor::instance());
                   }).ensure([request] {
                     }).within(requestTimeout_),
                   notifications_)
-              .ensure([this, request, requestId, headerCopy] {
+              .ensure([this, request, requestId, headerCopy, startTime] {
                 traceBus_->publish(FuseTraceEvent::finish(
                     requestId, headerCopy, request->getResult()));
+                recordLatency(
+                    headerCopy.opcode,
+                    std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - startTime));
 
                 // We may be complete; check to see if all requests are
                 // done and whether there are any threads remaining.
@@ -1788,7 +2300,8 @@ void FuseChannel::processSession() {
                 XCHECK_NE(state->pendingRequests, 0u)
                     << "pendingRequests double decrement";
                 if (--state->pendingRequests == 0 &&
-                    state->stoppedThreads == numThreads_) {
+                    state->stoppedThreads == numThreads_ &&
+                    state->extraThreads == 0) {
                   sessionComplete(std::move(state));
                 }
               });
@@ -1812,7 +2325,7 @@ void FuseChannel::processSession() {
             });
 
         try {
-          replyError(*header, ENOSYS);
+          replyError(deviceFd, *header, ENOSYS);
         } catch (const std::system_error& exc) {
           XLOG(ERR) << "Failed to write error response to fuse: " << exc.what();
           requestSessionExit(StopReason::FUSE_WRITE_ERROR);
@@ -1840,6 +2353,11 @@ void FuseChannel::sessionComplete(folly::Synchronized<State>::LockedPtr state) {
   // Unlock the state before the remaining steps
   state.unlock();
 
+  // All worker threads have exited and every request has been replied to, so
+  // the cloned devices are no longer needed. Closing them does not end the
+  // FUSE session as long as fuseDevice_ remains open.
+  clonedDevices_.clear();
+
   // Stop the invalidation thread.  We do not do this when requestSessionExit()
   // is called since we want to continue to allow invalidation requests to be
   // processed until all outstanding requests complete.
@@ -2320,13 +2838,40 @@ ImmediateFuture<folly::Unit> FuseChannel::fuseReadDir(
   XLOG(DBG7) << "FUSE_READDIR";
   auto ino = InodeNumber{header.nodeid};
   return dispatcher_
-      ->readdir(ino, FuseDirList{read->size}, read->offset, read->fh, request)
+      ->readdir(
+          ino,
+          FuseDirList{read->size, dirListPool_},
+          read->offset,
+          read->fh,
+          request)
       .thenValue([&request](FuseDirList&& list) {
         const auto buf = list.getBuf();
         request.sendReply(StringPiece{buf});
       });
 }
 
+#ifdef __linux__
+ImmediateFuture<folly::Unit> FuseChannel::fuseReadDirPlus(
+    FuseRequestContext& request,
+    const fuse_in_header& header,
+    ByteRange arg) {
+  auto read = reinterpret_cast<const fuse_read_in*>(arg.data());
+  XLOG(DBG7) << "FUSE_READDIRPLUS";
+  auto ino = InodeNumber{header.nodeid};
+  return dispatcher_
+      ->readdirplus(
+          ino,
+          FuseDirList{read->size, dirListPool_},
+          read->offset,
+          read->fh,
+          request)
+      .thenValue([&request](FuseDirList&& list) {
+        const auto buf = list.getBuf();
+        request.sendReply(StringPiece{buf});
+      });
+}
+#endif
+
 ImmediateFuture<folly::Unit> FuseChannel::fuseReleaseDir(
     FuseRequestContext& request,
     const fuse_in_header& header,
@@ -2382,10 +2927,7 @@ ImmediateFuture<folly::Unit> FuseChannel::fuseCreate(
 
         XLOG(DBG7) << "CREATE fh=" << out.fh << " flags=" << out.open_flags;
 
-        folly::fbvector<iovec> vec;
-
-        // 3 to avoid realloc when sendReply prepends a header to the iovec
-        vec.reserve(3);
+        ReplyIovecs vec;
         vec.push_back(make_iovec(entry));
         vec.push_back(make_iovec(out));
 
@@ -2453,6 +2995,52 @@ ImmediateFuture<folly::Unit> FuseChannel::fuseFallocate(
       .thenValue([&request](auto) { request.replyError(0); });
 }
 
+#ifdef __linux__
+ImmediateFuture<folly::Unit> FuseChannel::fuseLseek(
+    FuseRequestContext& request,
+    const fuse_in_header& header,
+    ByteRange arg) {
+  const auto* in = reinterpret_cast<const fuse_lseek_in*>(arg.data());
+  XLOG(DBG7) << "FUSE_LSEEK";
+
+  // The kernel only forwards SEEK_DATA and SEEK_HOLE; since file handles are
+  // stateless, the file position is tracked entirely by the kernel.
+  return dispatcher_
+      ->lseek(InodeNumber{header.nodeid}, in->offset, in->whence, request)
+      .thenValue([&request](off_t offset) {
+        fuse_lseek_out out = {};
+        out.offset = offset;
+        request.sendReply(out);
+      });
+}
+
+ImmediateFuture<folly::Unit> FuseChannel::fuseCopyFileRange(
+    FuseRequestContext& request,
+    const fuse_in_header& header,
+    ByteRange arg) {
+  const auto* in = reinterpret_cast<const fuse_copy_file_range_in*>(arg.data());
+  XLOG(DBG7) << "FUSE_COPY_FILE_RANGE";
+
+  // fuse_write_out can only describe a 32-bit copy. Returning a short count
+  // is fine: callers of copy_file_range(2) loop until everything is copied.
+  auto length =
+      std::min<uint64_t>(in->len, std::numeric_limits<uint32_t>::max());
+  return dispatcher_
+      ->copyFileRange(
+          InodeNumber{header.nodeid},
+          in->off_in,
+          InodeNumber{in->nodeid_out},
+          in->off_out,
+          length,
+          request)
+      .thenValue([&request](size_t copied) {
+        fuse_write_out out = {};
+        out.size = copied;
+        request.sendReply(out);
+      });
+}
+#endif
+
 FuseDeviceUnmountedDuringInitialization::
     FuseDeviceUnmountedDuringInitialization(AbsolutePathPiece mountPath)
     : std::runtime_error{folly::to<string>(
@@ -10,8 +10,10 @@
 #include <folly/File.h>
 #include <folly/Range.h>
 #include <folly/Synchronized.h>
+#include <folly/ThreadLocal.h>
 #include <folly/futures/Future.h>
 #include <folly/futures/Promise.h>
+#include <folly/small_vector.h>
 #include <folly/synchronization/CallOnce.h>
 #include <stdlib.h>
 #include <sys/uio.h>
@@ -28,11 +30,13 @@
 #include "eden/fs/fuse/FuseDispatcher.h"
 #include "eden/fs/fuse/FuseTypes.h"
 #include "eden/fs/inodes/InodeNumber.h"
+#include "eden/fs/telemetry/LatencyHistogram.h"
 #include "eden/fs/telemetry/RequestMetricsScope.h"
 #include "eden/fs/telemetry/TraceBus.h"
 #include "eden/fs/utils/CaseSensitivity.h"
 #include "eden/fs/utils/PathFuncs.h"
 #include "eden/fs/utils/ProcessAccessLog.h"
+#include "eden/fs/utils/ThreadPlacement.h"
 
 namespace folly {
 struct Unit;
@@ -43,6 +47,7 @@ namespace facebook::eden {
 class Notifications;
 class FsEventLogger;
 class FuseRequestContext;
+class FuseRequestPool;
 
 using TraceDetailedArgumentsHandle = std::shared_ptr<void>;
 
@@ -219,6 +224,12 @@ class FuseChannel {
    * The caller is expected to follow up with a call to the
    * initialize() method to perform the handshake with the
    * kernel and set up the thread pool.
+   *
+   * numThreads worker threads always run.  While every one of them is busy
+   * in a dispatcher call, more are started, up to maxThreads in total; the
+   * extra threads exit again once the pool has been idle for a while.
+   * Each worker thread, including the extra ones, is placed according to
+   * threadPlacement when it starts, see placeCurrentThread().
    */
   FuseChannel(
       folly::File&& fuseDevice,
@@ -232,7 +243,13 @@ class FuseChannel {
       Notifications* FOLLY_NULLABLE notifications,
       CaseSensitivity caseSensitive,
       bool requireUtf8Path,
-      int32_t maximumBackgroundRequests);
+      int32_t maximumBackgroundRequests,
+      bool useReaddirplus,
+      bool useSpliceReplies,
+      bool cloneDevicePerThread,
+      size_t maxThreads,
+      bool useWritebackCache,
+      ThreadPlacement threadPlacement);
 
   /**
    * Destroy the FuseChannel.
@@ -353,15 +370,33 @@ class FuseChannel {
    */
   FOLLY_NODISCARD folly::Future<folly::Unit> flushInvalidations();
 
+  /**
+   * Returns true if the kernel agreed to use FUSE_WRITEBACK_CACHE.
+   *
+   * In that mode the kernel buffers writes in its page cache and sends them
+   * to us later, and it keeps its own size and mtime for regular files.  Data
+   * written by a process may therefore not have reached the FileInode yet, so
+   * anything that needs to observe every completed write() must first
+   * invalidate the inodes' pages with invalidateInodes() and wait for
+   * flushInvalidations(): the kernel writes back dirty pages before dropping
+   * them.
+   */
+  bool isWritebackCacheEnabled() const;
+
   /**
    * Sends a reply to a kernel request that consists only of the error
    * status (no additional payload).
    * `err` may be 0 (indicating success) or a positive errno value.
    *
+   * All of the reply functions take the file descriptor of the FUSE device
+   * the request was read from: when the FUSE device is cloned for each
+   * worker thread, the kernel only accepts a reply on the device that the
+   * request was read from.
+   *
    * throws system_error if the write fails.  Writes can fail if the
    * data we send to the kernel is invalid.
    */
-  void replyError(const fuse_in_header& request, int err);
+  void replyError(int deviceFd, const fuse_in_header& request, int err);
 
   /**
    * Sends a raw data packet to the kernel.
@@ -374,7 +409,7 @@ class FuseChannel {
    * throws system_error if the write fails.  Writes can fail if the
    * data we send to the kernel is invalid.
    */
-  void sendRawReply(const iovec iov[], size_t count) const;
+  void sendRawReply(int deviceFd, const iovec iov[], size_t count) const;
 
   /**
    * Sends a range of contiguous bytes as a reply to the kernel.
@@ -385,13 +420,25 @@ class FuseChannel {
    * throws system_error if the write fails.  Writes can fail if the
    * data we send to the kernel is invalid.
    */
-  void sendReply(const fuse_in_header& request, folly::ByteRange bytes) const;
+  void sendReply(
+      int deviceFd,
+      const fuse_in_header& request,
+      folly::ByteRange bytes) const;
 
-  void sendReply(const fuse_in_header& request, folly::StringPiece bytes)
-      const {
-    sendReply(request, folly::ByteRange{bytes});
+  void sendReply(
+      int deviceFd,
+      const fuse_in_header& request,
+      folly::StringPiece bytes) const {
+    sendReply(deviceFd, request, folly::ByteRange{bytes});
   }
 
+  /**
+   * Payload components of a reply, with room for the fuse_out_header that
+   * sendReply() prepends. Replies have few parts, so they are stored inline
+   * rather than on the heap.
+   */
+  using ReplyIovecs = folly::small_vector<iovec, 8>;
+
   /**
    * Sends a reply to a kernel request, consisting of multiple parts.
    * The `vec` parameter holds an array of payload components and is moved
@@ -401,17 +448,26 @@ class FuseChannel {
    * throws system_error if the write fails.  Writes can fail if the
    * data we send to the kernel is invalid.
    */
-  void sendReply(const fuse_in_header& request, folly::fbvector<iovec>&& vec)
-      const;
+  void sendReply(
+      int deviceFd,
+      const fuse_in_header& request,
+      ReplyIovecs&& vec) const;
 
   /**
    * Sends a reply to a kernel request potentially consisting of multiple
    * segments.
    *
+   * When splice replies are enabled and supported by the kernel, the segments
+   * are vmsplice()d into a per-thread pipe and spliced into the FUSE device,
+   * falling back to writev() if that is not possible.
+   *
    * throws system_error if the write fails.  Writes can fail if the
    * data we send to the kernel is invalid.
    */
-  void sendReply(const fuse_in_header& request, const folly::IOBuf& buf) const;
+  void sendReply(
+      int deviceFd,
+      const fuse_in_header& request,
+      const folly::IOBuf& buf) const;
 
   /**
    * Sends a reply to the kernel.
@@ -422,10 +478,12 @@ class FuseChannel {
    * data we send to the kernel is invalid.
    */
   template <typename T>
-  void sendReply(const fuse_in_header& request, const T& payload) const {
+  void sendReply(int deviceFd, const fuse_in_header& request, const T& payload)
+      const {
     static_assert(std::is_standard_layout_v<T>);
     static_assert(std::is_trivial_v<T>);
     sendReply(
+        deviceFd,
         request,
         folly::ByteRange{
             reinterpret_cast<const uint8_t*>(&payload), sizeof(T)});
@@ -461,6 +519,25 @@ class FuseChannel {
 
   size_t getRequestMetric(RequestMetricsScope::RequestMetric metric) const;
 
+  struct InvalidationCounts {
+    /// Invalidation notifications sent to the kernel.
+    uint64_t sent{0};
+    /// Queued invalidations dropped or merged because they duplicated or
+    /// overlapped another queued invalidation.
+    uint64_t coalesced{0};
+  };
+
+  InvalidationCounts getInvalidationCounts() const;
+
+  /**
+   * Returns the latency distribution of every FUSE opcode handled since the
+   * channel started, keyed by opcode name.  The histograms are kept per
+   * thread and combined here, so this is cheap to record but not to call
+   * often.  Latencies recorded by threads that have since exited are lost.
+   */
+  std::unordered_map<std::string, LatencyHistogram::Percentiles>
+  getOpcodeLatencies() const;
+
  private:
   /**
    * All of our mutable state that may be accessed from the worker threads,
@@ -469,6 +546,19 @@ class FuseChannel {
   struct State {
     std::vector<std::thread> workerThreads;
 
+    /**
+     * Extra worker threads that exited because the pool was idle.  They are
+     * joined the next time the pool grows, or when the channel is destroyed.
+     */
+    std::vector<std::thread> retiredThreads;
+
+    /**
+     * The number of worker threads started beyond numThreads_ by
+     * growWorkerPool() that have not exited yet.  These threads do not count
+     * towards stoppedThreads.
+     */
+    size_t extraThreads{0};
+
     /**
      * We count live requests to avoid shutting down the session while responses
      * are pending.
@@ -535,6 +625,15 @@ class FuseChannel {
       folly::Promise<folly::Unit> promise;
     };
   };
+  /**
+   * A pipe used to splice reply data into the FUSE device. One is lazily
+   * created for each thread that sends spliced replies.
+   */
+  struct SplicePipe {
+    folly::File readEnd;
+    folly::File writeEnd;
+  };
+
   struct InvalidationQueue {
     std::vector<InvalidationEntry> queue;
     bool stop{false};
@@ -656,6 +755,12 @@ class FuseChannel {
       FuseRequestContext& request,
       const fuse_in_header& header,
       folly::ByteRange arg);
+#ifdef __linux__
+  ImmediateFuture<folly::Unit> fuseReadDirPlus(
+      FuseRequestContext& request,
+      const fuse_in_header& header,
+      folly::ByteRange arg);
+#endif
   ImmediateFuture<folly::Unit> fuseReleaseDir(
       FuseRequestContext& request,
       const fuse_in_header& header,
@@ -684,17 +789,66 @@ class FuseChannel {
       FuseRequestContext& request,
       const fuse_in_header& header,
       folly::ByteRange arg);
+#ifdef __linux__
+  ImmediateFuture<folly::Unit> fuseLseek(
+      FuseRequestContext& request,
+      const fuse_in_header& header,
+      folly::ByteRange arg);
+  ImmediateFuture<folly::Unit> fuseCopyFileRange(
+      FuseRequestContext& request,
+      const fuse_in_header& header,
+      folly::ByteRange arg);
+#endif
 
  private:
   void setThreadSigmask();
   void initWorkerThread() noexcept;
-  void fuseWorkerThread() noexcept;
+  void fuseWorkerThread(int deviceFd, bool extraWorker = false) noexcept;
+
+  /**
+   * Start one more worker thread if the pool has fewer than maxThreads_
+   * threads.  Called when every worker thread is busy in a dispatcher call.
+   */
+  void growWorkerPool();
+
+  /**
+   * Returns true if no request has found every worker thread busy for
+   * kWorkerIdleTimeout, in which case extra worker threads exit.
+   */
+  bool workerPoolIsIdle() const;
+
+  /**
+   * Clone fuseDevice_ with FUSE_DEV_IOC_CLONE into clonedDevices_ until it
+   * holds `count` devices.  Stops early, leaving the remaining threads
+   * sharing fuseDevice_, if the kernel does not support cloning.
+   */
+  void cloneFuseDevices(size_t count);
   void invalidationThread() noexcept;
   void stopInvalidationThread();
   void sendInvalidation(InvalidationEntry& entry);
+
+  /**
+   * Drop queued invalidations that are made redundant by another entry in the
+   * same batch, and merge overlapping data ranges of the same inode. Returns
+   * the number of entries removed.
+   */
+  static size_t coalesceInvalidations(std::vector<InvalidationEntry>& entries);
   void sendInvalidateInode(InodeNumber ino, int64_t off, int64_t len);
   void sendInvalidateEntry(InodeNumber parent, PathComponentPiece name);
   void readInitPacket();
+
+  /**
+   * Attempt to send a reply through splice(2).
+   *
+   * Returns false, without having sent anything, if the reply could not be
+   * spliced and should be sent with writev() instead.
+   *
+   * throws system_error if the kernel rejects the reply.
+   */
+  bool trySendSplicedReply(
+      int deviceFd,
+      const fuse_in_header& request,
+      const folly::IOBuf& buf) const;
   void startWorkerThreads();
 
   /**
@@ -724,7 +878,7 @@ class FuseChannel {
    * The intent is that this is called from each of the
    * fuse worker threads provided by the MountPoint.
    */
-  void processSession();
+  void processSession(int deviceFd, bool extraWorker);
 
   /**
    * Requests that the worker threads terminate their processing loop.
@@ -739,6 +893,7 @@ class FuseChannel {
    */
   const size_t bufferSize_{0};
   const size_t numThreads_;
+  const size_t maxThreads_;
   std::unique_ptr<FuseDispatcher> dispatcher_;
   const folly::Logger* const straceLogger_;
   const AbsolutePath mountPath_;
@@ -747,6 +902,23 @@ class FuseChannel {
   CaseSensitivity caseSensitive_;
   bool requireUtf8Path_;
   int32_t maximumBackgroundRequests_;
+  bool useReaddirplus_;
+  bool useSpliceReplies_;
+  bool cloneDevicePerThread_;
+  bool useWritebackCache_;
+  const ThreadPlacement threadPlacement_;
+
+  /*
+   * Recycles the FuseRequestContext allocation of each request.  This is
+   * shared with the allocations themselves, since the last request can finish
+   * after the FuseChannel has been destroyed.
+   */
+  const std::shared_ptr<FuseRequestPool> requestPool_;
+
+  /*
+   * Recycles the buffers that READDIR and READDIRPLUS replies are built in.
+   */
+  const std::shared_ptr<FuseRequestPool> dirListPool_;
 
   /*
    * connInfo_ is modified during the initialization process,
@@ -772,6 +944,18 @@ class FuseChannel {
    */
   folly::File fuseDevice_;
 
+  /*
+   * When cloneDevicePerThread_ is set, the clones of fuseDevice_ created with
+   * FUSE_DEV_IOC_CLONE, one per worker thread other than the initial one.
+   *
+   * These are created before the worker threads are started and are only
+   * closed once all worker threads have stopped and all outstanding requests
+   * have completed, since replies must be sent on the device the request was
+   * read from.  Only fuseDevice_ is handed over during a graceful restart; the
+   * new process creates its own clones.
+   */
+  std::vector<folly::File> clonedDevices_;
+
   /*
    * Mutable state that is accessed from the worker threads.
    * All of this state uses locking or other synchronization.
@@ -790,6 +974,17 @@ class FuseChannel {
   // State for sending inode invalidation requests to the kernel
   // These are processed in their own dedicated thread.
   folly::Synchronized<InvalidationQueue, std::mutex> invalidationQueue_;
+  /*
+   * The number of live worker threads, mirroring state_'s workerThreads, and
+   * how many of them are currently inside a dispatcher call.  Used to decide
+   * when to grow the pool without taking the state_ lock on every request.
+   */
+  std::atomic<size_t> liveWorkers_{0};
+  std::atomic<size_t> busyWorkers_{0};
+  std::atomic<std::chrono::steady_clock::rep> lastSaturated_{0};
+
+  std::atomic<uint64_t> invalidationsSent_{0};
+  std::atomic<uint64_t> invalidationsCoalesced_{0};
   std::condition_variable invalidationCV_;
   std::thread invalidationThread_;
 
@@ -802,11 +997,39 @@ class FuseChannel {
   // destroyed when the owning FuseWorkerThread ends if there are outstanding
   // requests as these may outlive the spawning worker thread.
   class ThreadLocalTag {};
-  folly::ThreadLocal<
-      std::shared_ptr<RequestMetricsScope::LockedRequestWatchList>,
-      ThreadLocalTag>
+  folly::ThreadLocal<std::shared_ptr<RequestWatchList>, ThreadLocalTag>
       liveRequestWatches_;
 
+  class SplicePipeTag {};
+  mutable folly::ThreadLocal<SplicePipe, SplicePipeTag> splicePipe_;
+
+  /**
+   * The latency histograms a single thread records into, indexed by opcode.
+   * Each one is allocated the first time the thread completes a request with
+   * that opcode, since most threads only ever see a few opcodes.  Only the
+   * owning thread stores into the array.
+   */
+  static constexpr size_t kMaxLatencyOpcodes = 64;
+  struct OpcodeLatencies {
+    OpcodeLatencies() = default;
+    OpcodeLatencies(const OpcodeLatencies&) = delete;
+    OpcodeLatencies& operator=(const OpcodeLatencies&) = delete;
+    ~OpcodeLatencies();
+
+    std::array<std::atomic<LatencyHistogram*>, kMaxLatencyOpcodes> histograms{};
+  };
+  class OpcodeLatenciesTag {};
+  mutable folly::ThreadLocal<OpcodeLatencies, OpcodeLatenciesTag>
+      opcodeLatencies_;
+
+  void recordLatency(uint32_t opcode, std::chrono::microseconds latency);
+
+  /**
+   * Set once splicing has failed in a way that indicates it will never work
+   * on this FUSE device, after which all replies go through writev().
+   */
+  mutable std::atomic<bool> spliceDisabled_{false};
+
   std::vector<TraceSubscriptionHandle<FuseTraceEvent>>
       traceSubscriptionHandles_;
 
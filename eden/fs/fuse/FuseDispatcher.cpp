@@ -54,6 +54,19 @@ fuse_attr_out FuseDispatcher::Attr::asFuseAttr() const {
   return result;
 }
 
+fuse_entry_out FuseDispatcher::Attr::asFuseEntry() const {
+  fuse_entry_out entry = {};
+  entry.nodeid = st.st_ino;
+  entry.generation = 0;
+  auto fuse_attr = asFuseAttr();
+  entry.attr = fuse_attr.attr;
+  entry.attr_valid = fuse_attr.attr_valid;
+  entry.attr_valid_nsec = fuse_attr.attr_valid_nsec;
+  entry.entry_valid = fuse_attr.attr_valid;
+  entry.entry_valid_nsec = fuse_attr.attr_valid_nsec;
+  return entry;
+}
+
 FuseDispatcher::~FuseDispatcher() {}
 
 FuseDispatcher::FuseDispatcher(EdenStats* stats) : stats_(stats) {}
@@ -196,6 +209,21 @@ ImmediateFuture<folly::Unit> FuseDispatcher::fallocate(
   FUSELL_NOT_IMPL();
 }
 
+ImmediateFuture<size_t> FuseDispatcher::copyFileRange(
+    InodeNumber,
+    off_t,
+    InodeNumber,
+    off_t,
+    size_t,
+    ObjectFetchContext&) {
+  FUSELL_NOT_IMPL();
+}
+
+ImmediateFuture<off_t>
+FuseDispatcher::lseek(InodeNumber, off_t, int, ObjectFetchContext&) {
+  FUSELL_NOT_IMPL();
+}
+
 ImmediateFuture<folly::Unit> FuseDispatcher::fsync(InodeNumber, bool) {
   FUSELL_NOT_IMPL();
 }
@@ -213,6 +241,15 @@ ImmediateFuture<FuseDirList> FuseDispatcher::readdir(
   FUSELL_NOT_IMPL();
 }
 
+ImmediateFuture<FuseDirList> FuseDispatcher::readdirplus(
+    InodeNumber,
+    FuseDirList&&,
+    off_t,
+    uint64_t,
+    ObjectFetchContext&) {
+  FUSELL_NOT_IMPL();
+}
+
 ImmediateFuture<struct fuse_kstatfs> FuseDispatcher::statfs(
     InodeNumber /*ino*/) {
   struct fuse_kstatfs info = {};
@@ -110,6 +110,12 @@ class FuseDispatcher {
         uint64_t timeout = std::numeric_limits<int32_t>::max());
 
     fuse_attr_out asFuseAttr() const;
+
+    /**
+     * Compute the fuse_entry_out that describes this inode, as returned by
+     * FUSE_LOOKUP and friends.
+     */
+    fuse_entry_out asFuseEntry() const;
   };
 
   /**
@@ -351,6 +357,33 @@ class FuseDispatcher {
       uint64_t length,
       ObjectFetchContext& context);
 
+  /**
+   * Copy a range of data from one file to another, as copy_file_range(2).
+   *
+   * Returns the number of bytes copied, which may be fewer than requested.
+   *
+   * Only used on Linux.
+   */
+  FOLLY_NODISCARD virtual ImmediateFuture<size_t> copyFileRange(
+      InodeNumber inoIn,
+      off_t offIn,
+      InodeNumber inoOut,
+      off_t offOut,
+      size_t length,
+      ObjectFetchContext& context);
+
+  /**
+   * Find the next data or hole in a file, for lseek(2) with SEEK_DATA or
+   * SEEK_HOLE. Other whence values are handled by the kernel.
+   *
+   * Only used on Linux.
+   */
+  FOLLY_NODISCARD virtual ImmediateFuture<off_t> lseek(
+      InodeNumber ino,
+      off_t offset,
+      int whence,
+      ObjectFetchContext& context);
+
   /**
    * Ensure file content changes are flushed to disk.
    *
@@ -386,6 +419,25 @@ class FuseDispatcher {
       uint64_t fh,
       ObjectFetchContext& context);
 
+  /**
+   * Read directory, including the attributes of each entry.
+   *
+   * Send a FuseDirList filled using FuseDirList::addPlus().
+   * Send an empty FuseDirList on end of stream.
+   *
+   * The kernel takes a reference on every entry returned with a non-zero
+   * nodeid, exactly as if lookup() had been called on it, so implementations
+   * must account for that reference the same way lookup() does.
+   *
+   * Only used on Linux.
+   */
+  virtual ImmediateFuture<FuseDirList> readdirplus(
+      InodeNumber ino,
+      FuseDirList&& dirList,
+      off_t offset,
+      uint64_t fh,
+      ObjectFetchContext& context);
+
   /**
    * Get file system statistics
    *
@@ -21,9 +21,13 @@ namespace facebook::eden {
 
 FuseRequestContext::FuseRequestContext(
     FuseChannel* channel,
+    int deviceFd,
     const fuse_in_header& fuseHeader)
-    : RequestContext(channel->getProcessAccessLog()),
+    : RequestContext(
+          channel->getProcessAccessLog(),
+          static_cast<pid_t>(fuseHeader.pid)),
       channel_(channel),
+      deviceFd_(deviceFd),
       fuseHeader_(fuseHeader) {}
 
 fuse_in_header FuseRequestContext::stealReqWithResult(int64_t result) {
@@ -78,7 +82,7 @@ void FuseRequestContext::timeoutErrorHandler(
 
 void FuseRequestContext::replyError(int err) {
   XCHECK(err >= 0) << "errno values are positive";
-  channel_->replyError(stealReqWithResult(-err), err);
+  channel_->replyError(deviceFd_, stealReqWithResult(-err), err);
 }
 
 void FuseRequestContext::replyNone() {
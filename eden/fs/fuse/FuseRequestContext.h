@@ -28,21 +28,21 @@ namespace facebook::eden {
  * Unless a member function indicates otherwise, FuseRequestContext may be used
  * from multiple threads, but only by one thread at a time.
  */
-class FuseRequestContext : public RequestContext {
+class FuseRequestContext final : public RequestContext {
  public:
   FuseRequestContext(const FuseRequestContext&) = delete;
   FuseRequestContext& operator=(const FuseRequestContext&) = delete;
   FuseRequestContext(FuseRequestContext&&) = delete;
   FuseRequestContext& operator=(FuseRequestContext&&) = delete;
-  explicit FuseRequestContext(
+  /**
+   * deviceFd is the FUSE device the request was read from, which is where the
+   * reply must be sent.
+   */
+  FuseRequestContext(
       FuseChannel* channel,
+      int deviceFd,
       const fuse_in_header& fuseHeader);
 
-  // Override of `ObjectFetchContext`
-  std::optional<pid_t> getClientPid() const override {
-    return static_cast<pid_t>(fuseHeader_.pid);
-  }
-
   // Override of `ObjectFetchContext`
   std::optional<folly::StringPiece> getCauseDetail() const override {
     return fuseOpcodeName(fuseHeader_.opcode);
@@ -105,7 +105,8 @@ class FuseRequestContext : public RequestContext {
 
   template <typename... T>
   void sendReply(T&&... payload) {
-    channel_->sendReply(stealReqWithResult(0), std::forward<T>(payload)...);
+    channel_->sendReply(
+        deviceFd_, stealReqWithResult(0), std::forward<T>(payload)...);
   }
 
   /**
@@ -115,7 +116,8 @@ class FuseRequestContext : public RequestContext {
    */
   template <typename T>
   void sendReplyWithInode(uint64_t nodeid, T&& reply) {
-    channel_->sendReply(stealReqWithResult(nodeid), std::forward<T>(reply));
+    channel_->sendReply(
+        deviceFd_, stealReqWithResult(nodeid), std::forward<T>(reply));
   }
 
   // Reply with a negative errno value or 0 for success
@@ -130,6 +132,7 @@ class FuseRequestContext : public RequestContext {
   fuse_in_header stealReqWithResult(int64_t result);
 
   FuseChannel* channel_;
+  const int deviceFd_;
   const fuse_in_header fuseHeader_;
 
   std::optional<int64_t> result_;
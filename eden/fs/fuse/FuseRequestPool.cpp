@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#ifndef _WIN32
+
+#include "eden/fs/fuse/FuseRequestPool.h"
+
+#include <algorithm>
+
+namespace facebook::eden {
+
+FuseRequestPool::ThreadBlocks::~ThreadBlocks() {
+  freeBlocks(blocks);
+}
+
+void FuseRequestPool::freeBlocks(const std::vector<void*>& blocks) noexcept {
+  for (auto* block : blocks) {
+    ::operator delete(block);
+  }
+}
+
+FuseRequestPool::FuseRequestPool(
+    size_t maxCachedBlocks,
+    EdenStats* stats,
+    ChannelThreadStats::StatPtr allocatedStat,
+    ChannelThreadStats::StatPtr recycledStat)
+    : maxTransferBatches_{std::max<size_t>(
+          1,
+          maxCachedBlocks / kTransferBatchSize)},
+      stats_{stats},
+      allocatedStat_{allocatedStat},
+      recycledStat_{recycledStat} {
+  // Reserve up front so that deallocate() never has to grow the vector.
+  transferBatches_.lock()->reserve(maxTransferBatches_);
+}
+
+FuseRequestPool::~FuseRequestPool() {
+  // threadBlocks_ frees the blocks of every thread when it is destroyed.
+  for (const auto& batch : *transferBatches_.lock()) {
+    freeBlocks(batch);
+  }
+}
+
+void* FuseRequestPool::allocate(size_t size) {
+  void* block = nullptr;
+  if (size == blockSize_.load(std::memory_order_relaxed)) {
+    auto& blocks = threadBlocks_->blocks;
+    if (blocks.empty()) {
+      auto transferBatches = transferBatches_.lock();
+      if (!transferBatches->empty()) {
+        blocks.swap(transferBatches->back());
+        transferBatches->pop_back();
+      }
+    }
+    if (!blocks.empty()) {
+      block = blocks.back();
+      blocks.pop_back();
+    }
+  }
+
+  if (stats_) {
+    auto& stats = stats_->getChannelStatsForCurrentThread();
+    (stats.*(block ? recycledStat_ : allocatedStat_)).addValue(1);
+  }
+  return block ? block : ::operator new(size);
+}
+
+void FuseRequestPool::deallocate(void* block, size_t size) noexcept {
+  size_t blockSize = 0;
+  if (!blockSize_.compare_exchange_strong(
+          blockSize, size, std::memory_order_relaxed)) {
+    if (size != blockSize) {
+      ::operator delete(block);
+      return;
+    }
+  }
+
+  auto& blocks = threadBlocks_->blocks;
+  if (blocks.size() >= kTransferBatchSize) {
+    std::vector<void*> batch;
+    batch.swap(blocks);
+    {
+      auto transferBatches = transferBatches_.lock();
+      if (transferBatches->size() < maxTransferBatches_) {
+        transferBatches->push_back(std::move(batch));
+        batch.clear();
+      }
+    }
+    // Only left non-empty when the shared list is full.
+    freeBlocks(batch);
+  }
+
+  try {
+    blocks.reserve(kTransferBatchSize);
+    blocks.push_back(block);
+  } catch (const std::bad_alloc&) {
+    ::operator delete(block);
+  }
+}
+
+} // namespace facebook::eden
+
+#endif
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Synchronized.h>
+#include <folly/ThreadLocal.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "eden/fs/telemetry/EdenStats.h"
+
+namespace facebook::eden {
+
+/**
+ * A free list of identically sized memory blocks, used to recycle the
+ * allocations made on the FUSE request path: the FuseRequestContext of every
+ * request and the buffers of directory listings.
+ *
+ * The block size is fixed by the first block returned to the pool; requests
+ * for any other size go straight to the heap.
+ *
+ * Each thread allocates from and frees to its own list without locking.
+ * Since requests are mostly completed on other threads than the ones that
+ * read them, a thread whose list is full hands it over, in one locked
+ * operation, to a shared list that threads with an empty list take from. At
+ * most maxCachedBlocks blocks are kept in the shared list; the rest are
+ * freed.
+ */
+class FuseRequestPool {
+ public:
+  /**
+   * Number of blocks a thread keeps before handing them over to the shared
+   * list, and thus the number of allocations and frees that each lock of the
+   * shared list is amortized over.
+   */
+  static constexpr size_t kTransferBatchSize = 32;
+
+  /**
+   * When stats is set, each allocation is counted in its allocatedStat or
+   * recycledStat, depending on whether it reused a block. stats must outlive
+   * every block allocated from the pool.
+   */
+  FuseRequestPool(
+      size_t maxCachedBlocks,
+      EdenStats* stats,
+      ChannelThreadStats::StatPtr allocatedStat =
+          &ChannelThreadStats::requestAllocated,
+      ChannelThreadStats::StatPtr recycledStat =
+          &ChannelThreadStats::requestRecycled);
+
+  FuseRequestPool(const FuseRequestPool&) = delete;
+  FuseRequestPool& operator=(const FuseRequestPool&) = delete;
+
+  void* allocate(size_t size);
+  void deallocate(void* block, size_t size) noexcept;
+
+  /**
+   * A std::allocator replacement for std::allocate_shared.
+   *
+   * It holds a reference to the pool, so blocks that are released after the
+   * FuseChannel has been destroyed are still returned safely.
+   */
+  template <typename T>
+  class Allocator {
+   public:
+    using value_type = T;
+
+    explicit Allocator(std::shared_ptr<FuseRequestPool> pool)
+        : pool_{std::move(pool)} {}
+
+    template <typename U>
+    /* implicit */ Allocator(const Allocator<U>& other) : pool_{other.pool_} {}
+
+    T* allocate(size_t n) {
+      return static_cast<T*>(pool_->allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept {
+      pool_->deallocate(p, n * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const Allocator<U>& other) const {
+      return pool_ == other.pool_;
+    }
+
+    template <typename U>
+    bool operator!=(const Allocator<U>& other) const {
+      return pool_ != other.pool_;
+    }
+
+   private:
+    template <typename U>
+    friend class Allocator;
+
+    std::shared_ptr<FuseRequestPool> pool_;
+  };
+
+ private:
+  struct ThreadBlocks {
+    ThreadBlocks() = default;
+    ThreadBlocks(const ThreadBlocks&) = delete;
+    ThreadBlocks& operator=(const ThreadBlocks&) = delete;
+    ~ThreadBlocks();
+
+    std::vector<void*> blocks;
+  };
+
+  static void freeBlocks(const std::vector<void*>& blocks) noexcept;
+
+  const size_t maxTransferBatches_;
+  EdenStats* const stats_;
+  const ChannelThreadStats::StatPtr allocatedStat_;
+  const ChannelThreadStats::StatPtr recycledStat_;
+
+  std::atomic<size_t> blockSize_{0};
+
+  class ThreadLocalTag {};
+  folly::ThreadLocal<ThreadBlocks, ThreadLocalTag> threadBlocks_;
+
+  // Batches of kTransferBatchSize blocks handed over between threads.
+  folly::Synchronized<std::vector<std::vector<void*>>, std::mutex>
+      transferBatches_;
+};
+
+} // namespace facebook::eden
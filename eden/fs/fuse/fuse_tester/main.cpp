@@ -138,7 +138,13 @@ int main(int argc, char** argv) {
       /*notifications=*/nullptr,
       CaseSensitivity::Sensitive,
       /*requireUtf8Path=*/true,
-      /*maximumBackgroundRequests=*/12 /* the default on Linux */));
+      /*maximumBackgroundRequests=*/12 /* the default on Linux */,
+      /*useReaddirplus=*/false,
+      /*useSpliceReplies=*/false,
+      /*cloneDevicePerThread=*/false,
+      /*maxThreads=*/0,
+      /*useWritebackCache=*/false,
+      ThreadPlacement::None));
 
   XLOG(INFO) << "Starting FUSE...";
   auto completionFuture = channel->initialize().get();
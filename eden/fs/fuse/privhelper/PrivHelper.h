@@ -68,12 +68,19 @@ class PrivHelper {
       folly::StringPiece mountPath,
       bool readOnly) = 0;
 
+  /**
+   * Ask the privileged helper process to perform an NFS mount.
+   *
+   * When non-zero, attrCacheMax is the maximum number of seconds the kernel
+   * may cache the attributes of files and directories for.
+   */
   FOLLY_NODISCARD virtual folly::Future<folly::Unit> nfsMount(
       folly::StringPiece mountPath,
       folly::SocketAddress mountdAddr,
       folly::SocketAddress nfsdAddr,
       bool readOnly,
-      uint32_t iosize) = 0;
+      uint32_t iosize,
+      uint32_t attrCacheMax) = 0;
 
   /**
    * Ask the privileged helper process to perform a fuse unmount.
@@ -18,6 +18,9 @@
 #include <folly/Format.h>
 #include <folly/SocketAddress.h>
 #include <folly/String.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/SerialExecutor.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/init/Init.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
@@ -59,9 +62,34 @@ using std::string;
 
 namespace facebook::eden {
 
+namespace {
+/**
+ * Enough for the mounts and bind mounts of a devserver to be set up in a few
+ * rounds rather than one at a time.
+ */
+constexpr size_t kNumWorkerThreads = 8;
+} // namespace
+
 PrivHelperServer::PrivHelperServer() {}
 
-PrivHelperServer::~PrivHelperServer() {}
+PrivHelperServer::~PrivHelperServer() {
+  // Wait for the operations still running on the workers, which update
+  // mountPoints_ and post their responses to the EventBase. Left to the
+  // member destructors, workers_ would only be joined after both are gone.
+  // This is a no-op once run() joined them.
+  //
+  // Responses of the operations that completed after the main loop stopped
+  // are queued on the EventBase, and are dropped when it is destroyed. Make
+  // that happen while the rest of this object still exists.
+  stopped_ = true;
+  if (workers_) {
+    // The serial executors hold keep-alive tokens that join() waits for.
+    pathExecutors_.clear();
+    workers_->join();
+  }
+  conn_.reset();
+  eventBase_.reset();
+}
 
 void PrivHelperServer::init(folly::File&& socket, uid_t uid, gid_t gid) {
   initPartial(std::move(socket), uid, gid);
@@ -87,6 +115,9 @@ void PrivHelperServer::initPartial(folly::File&& socket, uid_t uid, gid_t gid) {
   // NotificationQueue code checks to ensure that it isn't used across a fork.
   eventBase_ = std::make_unique<folly::EventBase>();
   conn_ = UnixSocket::makeUnique(eventBase_.get(), std::move(socket));
+  workers_ = std::make_unique<folly::CPUThreadPoolExecutor>(
+      kNumWorkerThreads,
+      std::make_shared<folly::NamedThreadFactory>("privhelper_work"));
   uid_ = uid;
   gid_ = gid;
 
@@ -563,7 +594,8 @@ void PrivHelperServer::nfsMount(
     folly::SocketAddress mountdAddr,
     folly::SocketAddress nfsdAddr,
     bool readOnly,
-    uint32_t iosize) {
+    uint32_t iosize,
+    uint32_t attrCacheMax) {
 #ifdef __APPLE__
   // Hold the attribute list set below.
   auto attrsBuf = folly::IOBufQueue{folly::IOBufQueue::cacheChainLength()};
@@ -574,7 +606,7 @@ void PrivHelperServer::nfsMount(
   // must follow the increasing order of their associated flags.
   uint32_t mattrFlags = 0;
 
-  // Make the client use any source port, disable rdirplus, soft but make the
+  // Make the client use any source port, enable rdirplus, soft but make the
   // mount interruptible. While in theory we would want the mount to be soft,
   // macOS force a maximum timeout of 60s, which in some case is too short for
   // files to be fetched, thus disable it.
@@ -583,7 +615,7 @@ void PrivHelperServer::nfsMount(
       NFS_MATTR_BITMAP_LEN,
       NFS_MFLAG_RESVPORT | NFS_MFLAG_RDIRPLUS | NFS_MFLAG_SOFT | NFS_MFLAG_INTR,
       NFS_MATTR_BITMAP_LEN,
-      NFS_MFLAG_INTR};
+      NFS_MFLAG_RDIRPLUS | NFS_MFLAG_INTR};
   XdrTrait<nfs_mattr_flags>::serialize(attrSer, flags);
 
   mattrFlags |= NFS_MATTR_NFS_VERSION;
@@ -595,6 +627,19 @@ void PrivHelperServer::nfsMount(
   mattrFlags |= NFS_MATTR_WRITE_SIZE;
   XdrTrait<nfs_mattr_wsize>::serialize(attrSer, iosize);
 
+  if (attrCacheMax != 0) {
+    // The kernel scales the attribute cache timeout of a file with the time
+    // since it was last modified. Files that EdenFS didn't materialize keep
+    // stable attributes and can thus be cached up to this maximum.
+    auto maxTime = nfstime32{static_cast<int32_t>(attrCacheMax), 0};
+
+    mattrFlags |= NFS_MATTR_ATTRCACHE_REG_MAX;
+    XdrTrait<nfs_mattr_acregmax>::serialize(attrSer, maxTime);
+
+    mattrFlags |= NFS_MATTR_ATTRCACHE_DIR_MAX;
+    XdrTrait<nfs_mattr_acdirmax>::serialize(attrSer, maxTime);
+  }
+
   mattrFlags |= NFS_MATTR_LOCK_MODE;
   XdrTrait<nfs_mattr_lock_mode>::serialize(
       attrSer, nfs_lock_mode::NFS_LOCK_MODE_LOCAL);
@@ -723,15 +768,21 @@ void PrivHelperServer::nfsMount(
   // Prepare the flags and options to pass to mount(2).
   // Since each mount point will have its own NFS server, we need to manually
   // specify it.
-  // TODO(xavierd): remove nordirplus as this will likely improve performance.
   auto mountOpts = fmt::format(
       "addr={},vers=3,proto=tcp,port={},mountvers=3,mountproto=tcp,mountport={},"
-      "noresvport,nolock,nordirplus,soft,retrans=0,rsize={},wsize={}",
+      "noresvport,nolock,rdirplus,soft,retrans=0,rsize={},wsize={}",
       nfsdAddr.getAddressStr(),
       nfsdAddr.getPort(),
       mountdAddr.getPort(),
       iosize,
       iosize);
+  if (attrCacheMax != 0) {
+    // The kernel grows the attribute cache timeout of a file for as long as
+    // its attributes don't change, which is the case of all the files that
+    // EdenFS didn't materialize.
+    mountOpts += fmt::format(
+        ",acregmax={},acdirmax={}", attrCacheMax, attrCacheMax);
+  }
 
   // The mount flags.
   // We do not use MS_NODEV.  MS_NODEV prevents mount points from being created
@@ -814,67 +865,85 @@ UnixSocket::Message PrivHelperServer::processTakeoverStartupMsg(
   XLOG(DBG3) << "takeover startup for \"" << mountPath << "\"; "
              << bindMounts.size() << " bind mounts";
 
-  mountPoints_.insert(mountPath);
+  mountPoints_.wlock()->insert(mountPath);
   return makeResponse();
 }
 
-UnixSocket::Message PrivHelperServer::processMountMsg(Cursor& cursor) {
+folly::Future<UnixSocket::Message> PrivHelperServer::processMountMsg(
+    Cursor& cursor) {
   string mountPath;
   bool readOnly;
   PrivHelperConn::parseMountRequest(cursor, mountPath, readOnly);
   XLOG(DBG3) << "mount \"" << mountPath << "\"";
 
-  auto fuseDev = fuseMount(mountPath.c_str(), readOnly);
-  mountPoints_.insert(mountPath);
-
-  return makeResponse(std::move(fuseDev));
+  return runOnWorker(mountPath, [this, mountPath, readOnly] {
+    auto fuseDev = fuseMount(mountPath.c_str(), readOnly);
+    mountPoints_.wlock()->insert(mountPath);
+    return makeResponse(std::move(fuseDev));
+  });
 }
 
-UnixSocket::Message PrivHelperServer::processMountNfsMsg(Cursor& cursor) {
+folly::Future<UnixSocket::Message> PrivHelperServer::processMountNfsMsg(
+    Cursor& cursor) {
   string mountPath;
   folly::SocketAddress mountdAddr, nfsdAddr;
   bool readOnly;
   uint32_t iosize;
+  uint32_t attrCacheMax;
   PrivHelperConn::parseMountNfsRequest(
-      cursor, mountPath, mountdAddr, nfsdAddr, readOnly, iosize);
+      cursor, mountPath, mountdAddr, nfsdAddr, readOnly, iosize, attrCacheMax);
   XLOG(DBG3) << "mount.nfs \"" << mountPath << "\"";
 
-  nfsMount(mountPath, mountdAddr, nfsdAddr, readOnly, iosize);
-  mountPoints_.insert(mountPath);
-
-  return makeResponse();
+  return runOnWorker(
+      mountPath,
+      [this,
+       mountPath,
+       mountdAddr,
+       nfsdAddr,
+       readOnly,
+       iosize,
+       attrCacheMax] {
+        nfsMount(
+            mountPath, mountdAddr, nfsdAddr, readOnly, iosize, attrCacheMax);
+        mountPoints_.wlock()->insert(mountPath);
+        return makeResponse();
+      });
 }
 
-UnixSocket::Message PrivHelperServer::processUnmountMsg(Cursor& cursor) {
+folly::Future<UnixSocket::Message> PrivHelperServer::processUnmountMsg(
+    Cursor& cursor) {
   string mountPath;
   PrivHelperConn::parseUnmountRequest(cursor, mountPath);
   XLOG(DBG3) << "unmount \"" << mountPath << "\"";
 
-  const auto it = mountPoints_.find(mountPath);
-  if (it == mountPoints_.end()) {
-    throw std::domain_error(
-        folly::to<string>("No FUSE mount found for ", mountPath));
-  }
+  return runOnWorker(mountPath, [this, mountPath] {
+    if (mountPoints_.rlock()->count(mountPath) == 0) {
+      throw std::domain_error(
+          folly::to<string>("No FUSE mount found for ", mountPath));
+    }
 
-  unmount(mountPath.c_str());
-  mountPoints_.erase(mountPath);
-  return makeResponse();
+    unmount(mountPath.c_str());
+    mountPoints_.wlock()->erase(mountPath);
+    return makeResponse();
+  });
 }
 
-UnixSocket::Message PrivHelperServer::processNfsUnmountMsg(Cursor& cursor) {
+folly::Future<UnixSocket::Message> PrivHelperServer::processNfsUnmountMsg(
+    Cursor& cursor) {
   string mountPath;
   PrivHelperConn::parseNfsUnmountRequest(cursor, mountPath);
   XLOG(DBG3) << "unmount \"" << mountPath << "\"";
 
-  const auto it = mountPoints_.find(mountPath);
-  if (it == mountPoints_.end()) {
-    throw std::domain_error(
-        folly::to<string>("No NFS mount found for ", mountPath));
-  }
+  return runOnWorker(mountPath, [this, mountPath] {
+    if (mountPoints_.rlock()->count(mountPath) == 0) {
+      throw std::domain_error(
+          folly::to<string>("No NFS mount found for ", mountPath));
+    }
 
-  unmount(mountPath.c_str());
-  mountPoints_.erase(mountPath);
-  return makeResponse();
+    unmount(mountPath.c_str());
+    mountPoints_.wlock()->erase(mountPath);
+    return makeResponse();
+  });
 }
 
 UnixSocket::Message PrivHelperServer::processTakeoverShutdownMsg(
@@ -883,18 +952,15 @@ UnixSocket::Message PrivHelperServer::processTakeoverShutdownMsg(
   PrivHelperConn::parseTakeoverShutdownRequest(cursor, mountPath);
   XLOG(DBG3) << "takeover shutdown \"" << mountPath << "\"";
 
-  const auto it = mountPoints_.find(mountPath);
-  if (it == mountPoints_.end()) {
+  if (mountPoints_.wlock()->erase(mountPath) == 0) {
     throw std::domain_error(
         folly::to<string>("No FUSE mount found for ", mountPath));
   }
-
-  mountPoints_.erase(mountPath);
   return makeResponse();
 }
 
 std::string PrivHelperServer::findMatchingMountPrefix(folly::StringPiece path) {
-  for (const auto& mountPoint : mountPoints_) {
+  for (const auto& mountPoint : *mountPoints_.rlock()) {
     if (boost::starts_with(path, mountPoint + "/")) {
       return mountPoint;
     }
@@ -902,7 +968,8 @@ std::string PrivHelperServer::findMatchingMountPrefix(folly::StringPiece path) {
   throw std::domain_error(folly::to<string>("No FUSE mount found for ", path));
 }
 
-UnixSocket::Message PrivHelperServer::processBindMountMsg(Cursor& cursor) {
+folly::Future<UnixSocket::Message> PrivHelperServer::processBindMountMsg(
+    Cursor& cursor) {
   string clientPath;
   string mountPath;
   PrivHelperConn::parseBindMountRequest(cursor, clientPath, mountPath);
@@ -911,13 +978,16 @@ UnixSocket::Message PrivHelperServer::processBindMountMsg(Cursor& cursor) {
   // findMatchingMountPrefix will throw if mountPath doesn't match
   // any known mount.  We perform this check so that we're not a
   // vector for mounting things in arbitrary places.
-  auto key = findMatchingMountPrefix(mountPath);
+  auto parentMount = findMatchingMountPrefix(mountPath);
 
-  bindMount(clientPath.c_str(), mountPath.c_str());
-  return makeResponse();
+  return runOnWorker(parentMount, [this, clientPath, mountPath] {
+    bindMount(clientPath.c_str(), mountPath.c_str());
+    return makeResponse();
+  });
 }
 
-UnixSocket::Message PrivHelperServer::processBindUnMountMsg(Cursor& cursor) {
+folly::Future<UnixSocket::Message> PrivHelperServer::processBindUnMountMsg(
+    Cursor& cursor) {
   string mountPath;
   PrivHelperConn::parseBindUnMountRequest(cursor, mountPath);
   XLOG(DBG3) << "bind unmount \"" << mountPath << "\"";
@@ -925,11 +995,12 @@ UnixSocket::Message PrivHelperServer::processBindUnMountMsg(Cursor& cursor) {
   // findMatchingMountPrefix will throw if mountPath doesn't match
   // any known mount.  We perform this check so that we're not a
   // vector for arbitrarily unmounting things.
-  findMatchingMountPrefix(mountPath);
+  auto parentMount = findMatchingMountPrefix(mountPath);
 
-  bindUnmount(mountPath.c_str());
-
-  return makeResponse();
+  return runOnWorker(parentMount, [this, mountPath] {
+    bindUnmount(mountPath.c_str());
+    return makeResponse();
+  });
 }
 
 UnixSocket::Message PrivHelperServer::processSetLogFileMsg(
@@ -975,7 +1046,9 @@ UnixSocket::Message PrivHelperServer::processSetUseEdenFs(
     folly::io::Cursor& cursor,
     UnixSocket::Message& /* request */) {
   XLOG(DBG3) << "set use /dev/edenfs";
-  PrivHelperConn::parseSetUseEdenFsRequest(cursor, useDevEdenFs_);
+  bool useDevEdenFs;
+  PrivHelperConn::parseSetUseEdenFsRequest(cursor, useDevEdenFs);
+  useDevEdenFs_ = useDevEdenFs;
 
   return makeResponse();
 }
@@ -1050,6 +1123,16 @@ void PrivHelperServer::run() {
   // too.
   XLOG(DBG5) << "privhelper process exiting";
 
+  // Let the operations still running finish before unmounting everything.
+  // The serial executors hold keep-alive tokens that join() waits for, and
+  // the callbacks that would release them only run on the event base.
+  stopped_ = true;
+  pathExecutors_.clear();
+  workers_->join();
+  // Run their completion callbacks, which were queued on the event base, now
+  // rather than when it is destroyed after the state they use.
+  eventBase_->loop();
+
   // Unmount all active mount points
   cleanupMountPoints();
 }
@@ -1068,18 +1151,62 @@ void PrivHelperServer::processAndSendResponse(UnixSocket::Message&& message) {
   const auto xid = cursor.readBE<uint32_t>();
   const auto msgType =
       static_cast<PrivHelperConn::MsgType>(cursor.readBE<uint32_t>());
-  auto responseType = msgType;
 
+  auto future = folly::makeFutureWith(
+      [&] { return processMessage(msgType, cursor, message); });
+  if (future.isReady()) {
+    sendResponse(xid, msgType, std::move(future).result());
+    return;
+  }
+  std::move(future)
+      .via(eventBase_.get())
+      .thenTry([this, xid, msgType](folly::Try<UnixSocket::Message>&& result) {
+        if (stopped_) {
+          return;
+        }
+        sendResponse(xid, msgType, std::move(result));
+      });
+}
+
+folly::Future<UnixSocket::Message> PrivHelperServer::runOnWorker(
+    const std::string& path,
+    folly::Function<UnixSocket::Message()> fn) {
+  auto& pathExecutor = pathExecutors_[path];
+  if (!pathExecutor.executor) {
+    pathExecutor.executor = folly::SerialExecutor::create(
+        folly::getKeepAliveToken(workers_.get()));
+  }
+  ++pathExecutor.pending;
+  return folly::via(pathExecutor.executor, std::move(fn))
+      .via(eventBase_.get())
+      .ensure([this, path] {
+        auto it = pathExecutors_.find(path);
+        if (it != pathExecutors_.end() && --it->second.pending == 0) {
+          pathExecutors_.erase(it);
+        }
+      });
+}
+
+void PrivHelperServer::sendResponse(
+    uint32_t xid,
+    PrivHelperConn::MsgType msgType,
+    folly::Try<UnixSocket::Message>&& result) {
+  auto responseType = msgType;
   UnixSocket::Message response;
-  try {
-    response = processMessage(msgType, cursor, message);
-  } catch (const std::exception& ex) {
+  if (result.hasValue()) {
+    response = std::move(result).value();
+  } else {
+    auto& ew = result.exception();
     XLOG(ERR) << "error processing privhelper request: "
-              << folly::exceptionStr(ex);
+              << folly::exceptionStr(ew);
     responseType = PrivHelperConn::RESP_ERROR;
     response = makeResponse();
     Appender appender(&response.data, 1024);
-    PrivHelperConn::serializeErrorResponse(appender, ex);
+    if (auto* ex = ew.get_exception<std::exception>()) {
+      PrivHelperConn::serializeErrorResponse(appender, *ex);
+    } else {
+      PrivHelperConn::serializeErrorResponse(appender, ew.what());
+    }
   }
 
   // Put the transaction ID and message type in the response.
@@ -1127,7 +1254,7 @@ UnixSocket::Message PrivHelperServer::makeResponse(folly::File&& file) {
   return response;
 }
 
-UnixSocket::Message PrivHelperServer::processMessage(
+folly::Future<UnixSocket::Message> PrivHelperServer::processMessage(
     PrivHelperConn::MsgType msgType,
     Cursor& cursor,
     UnixSocket::Message& request) {
@@ -1178,7 +1305,8 @@ void PrivHelperServer::receiveError(
 }
 
 void PrivHelperServer::cleanupMountPoints() {
-  for (const auto& mountPoint : mountPoints_) {
+  auto mountPoints = mountPoints_.wlock();
+  for (const auto& mountPoint : *mountPoints) {
     try {
       unmount(mountPoint.c_str());
     } catch (const std::exception& ex) {
@@ -1187,7 +1315,7 @@ void PrivHelperServer::cleanupMountPoints() {
     }
   }
 
-  mountPoints_.clear();
+  mountPoints->clear();
 }
 
 } // namespace facebook::eden
@@ -7,7 +7,12 @@
 
 #pragma once
 
+#include <folly/Executor.h>
+#include <folly/Function.h>
+#include <folly/Synchronized.h>
+#include <folly/futures/Future.h>
 #include <sys/types.h>
+#include <atomic>
 #include <limits>
 #include <set>
 #include <string>
@@ -16,6 +21,7 @@
 #include "eden/fs/utils/UnixSocket.h"
 
 namespace folly {
+class CPUThreadPoolExecutor;
 class EventBase;
 class File;
 class SocketAddress;
@@ -36,6 +42,11 @@ namespace facebook::eden {
  *
  * The uid and gid parameters specify the user and group ID of the unprivileged
  * process that will be making requests to us.
+ *
+ * The mount and unmount requests block in the kernel, so they run on a pool
+ * of worker threads, and their responses are sent as they complete. The
+ * requests for any one path still run in the order they were received. The
+ * other requests are handled on the main thread.
  */
 class PrivHelperServer : private UnixSocket::ReceiveCallback {
  public:
@@ -71,19 +82,37 @@ class PrivHelperServer : private UnixSocket::ReceiveCallback {
   void receiveError(const folly::exception_wrapper& ew) noexcept override;
 
   void processAndSendResponse(UnixSocket::Message&& message);
-  UnixSocket::Message processMessage(
+  void sendResponse(
+      uint32_t xid,
+      PrivHelperConn::MsgType msgType,
+      folly::Try<UnixSocket::Message>&& result);
+  folly::Future<UnixSocket::Message> processMessage(
       PrivHelperConn::MsgType msgType,
       folly::io::Cursor& cursor,
       UnixSocket::Message& request);
+
+  /**
+   * Run fn on a worker thread, after the operations on the same path that
+   * were received before it. The operations on a bind mount use the path of
+   * the mount that contains it, so that they are ordered with its unmount.
+   */
+  folly::Future<UnixSocket::Message> runOnWorker(
+      const std::string& path,
+      folly::Function<UnixSocket::Message()> fn);
   UnixSocket::Message makeResponse();
   UnixSocket::Message makeResponse(folly::File&& file);
 
-  UnixSocket::Message processMountMsg(folly::io::Cursor& cursor);
-  UnixSocket::Message processMountNfsMsg(folly::io::Cursor& cursor);
-  UnixSocket::Message processUnmountMsg(folly::io::Cursor& cursor);
-  UnixSocket::Message processNfsUnmountMsg(folly::io::Cursor& cursor);
-  UnixSocket::Message processBindMountMsg(folly::io::Cursor& cursor);
-  UnixSocket::Message processBindUnMountMsg(folly::io::Cursor& cursor);
+  folly::Future<UnixSocket::Message> processMountMsg(folly::io::Cursor& cursor);
+  folly::Future<UnixSocket::Message> processMountNfsMsg(
+      folly::io::Cursor& cursor);
+  folly::Future<UnixSocket::Message> processUnmountMsg(
+      folly::io::Cursor& cursor);
+  folly::Future<UnixSocket::Message> processNfsUnmountMsg(
+      folly::io::Cursor& cursor);
+  folly::Future<UnixSocket::Message> processBindMountMsg(
+      folly::io::Cursor& cursor);
+  folly::Future<UnixSocket::Message> processBindUnMountMsg(
+      folly::io::Cursor& cursor);
   UnixSocket::Message processTakeoverShutdownMsg(folly::io::Cursor& cursor);
   UnixSocket::Message processTakeoverStartupMsg(folly::io::Cursor& cursor);
   UnixSocket::Message processSetLogFileMsg(
@@ -105,7 +134,8 @@ class PrivHelperServer : private UnixSocket::ReceiveCallback {
       folly::SocketAddress mountdPort,
       folly::SocketAddress nfsdPort,
       bool readOnly,
-      uint32_t iosize);
+      uint32_t iosize,
+      uint32_t attrCacheMax);
   virtual void unmount(const char* mountPath);
   // Both clientPath and mountPath must be existing directories.
   virtual void bindMount(const char* clientPath, const char* mountPath);
@@ -117,12 +147,29 @@ class PrivHelperServer : private UnixSocket::ReceiveCallback {
   UnixSocket::UniquePtr conn_;
   uid_t uid_{std::numeric_limits<uid_t>::max()};
   gid_t gid_{std::numeric_limits<gid_t>::max()};
-  std::chrono::nanoseconds fuseTimeout_{std::chrono::seconds(60)};
-  bool useDevEdenFs_{false};
+  std::atomic<std::chrono::nanoseconds> fuseTimeout_{std::chrono::seconds(60)};
+  std::atomic<bool> useDevEdenFs_{false};
+
+  // Like eventBase_, created by init() rather than before the fork.
+  std::unique_ptr<folly::CPUThreadPoolExecutor> workers_;
+
+  struct PathExecutor {
+    folly::Executor::KeepAlive<> executor;
+    // Operations queued or running on executor.
+    size_t pending{0};
+  };
+
+  // A serial executor per path with operations in flight, so that the
+  // operations on a path run in order. An entry is removed once its last
+  // operation completes, so unmounted paths don't accumulate. Only accessed
+  // on the main thread.
+  std::unordered_map<std::string, PathExecutor> pathExecutors_;
+
+  // Set on the main thread once it stopped, after which the responses of the
+  // operations still running are dropped.
+  bool stopped_{false};
 
-  // The privhelper server only has a single thread,
-  // so we don't need to lock the following state
-  std::set<std::string> mountPoints_;
+  folly::Synchronized<std::set<std::string>> mountPoints_;
 };
 
 } // namespace facebook::eden
@@ -289,6 +289,29 @@ TEST_F(PrivHelperTest, multiplePendingFuseMounts) {
   EXPECT_THAT(server_.getUnusedFuseUnmountResults(), UnorderedElementsAre());
 }
 
+TEST_F(PrivHelperTest, slowFuseMountDoesNotBlockOtherMounts) {
+  auto abcPromise = server_.setFuseMountResult("/mnt/abc");
+  auto foobarPromise = server_.setFuseMountResult("/foo/bar");
+  server_.setFuseUnmountResult("/mnt/abc").setValue();
+  server_.setFuseUnmountResult("/foo/bar").setValue();
+
+  auto abcResult = client_->fuseMount("/mnt/abc", false);
+  auto foobarResult = client_->fuseMount("/foo/bar", false);
+
+  // The mount of /foo/bar completes while the one of /mnt/abc, which was
+  // requested first, is still blocked.
+  TemporaryFile tempFile;
+  foobarPromise.setValue(File(tempFile.fd(), /* ownsFD */ false));
+  std::move(foobarResult).get(1s);
+  EXPECT_FALSE(abcResult.isReady());
+
+  abcPromise.setValue(File(tempFile.fd(), /* ownsFD */ false));
+  std::move(abcResult).get(1s);
+
+  cleanup();
+  EXPECT_THAT(server_.getUnusedFuseUnmountResults(), UnorderedElementsAre());
+}
+
 TEST_F(PrivHelperTest, bindMounts) {
   TemporaryFile tempFile;
 
@@ -24,6 +24,7 @@ using namespace facebook::eden;
 using namespace std::chrono_literals;
 using folly::ByteRange;
 using folly::Random;
+using folly::StringPiece;
 using std::unique_ptr;
 
 namespace {
@@ -81,7 +82,13 @@ class FuseChannelTest : public ::testing::Test {
         /*notifications=*/nullptr,
         CaseSensitivity::Sensitive,
         /*requireUtf8Path=*/true,
-        /*maximumBackgroundRequests=*/12));
+        /*maximumBackgroundRequests=*/12,
+        /*useReaddirplus=*/false,
+        /*useSpliceReplies=*/false,
+        /*cloneDevicePerThread=*/false,
+        /*maxThreads=*/0,
+        /*useWritebackCache=*/false,
+        ThreadPlacement::None));
   }
 
   FuseChannel::StopFuture performInit(
@@ -281,6 +288,65 @@ TEST_F(FuseChannelTest, testInitErrorShortPacket) {
       "validate the size in our error message check");
 }
 
+TEST_F(FuseChannelTest, invalidationsAreCoalesced) {
+  auto channel = createChannel();
+
+  // The invalidation thread only starts once the channel is initialized, so
+  // everything queued here is processed as a single batch.
+  for (int i = 0; i < 3; ++i) {
+    channel->invalidateInode(InodeNumber{5}, 0, 0);
+  }
+  channel->invalidateInode(InodeNumber{6}, 0, 10);
+  channel->invalidateInode(InodeNumber{6}, 5, 10);
+  channel->invalidateInode(InodeNumber{6}, 100, 10);
+  channel->invalidateInode(InodeNumber{6}, -1, 0);
+  channel->invalidateEntry(kRootNodeId, PathComponentPiece{"foo"});
+  channel->invalidateEntry(kRootNodeId, PathComponentPiece{"foo"});
+  channel->invalidateEntry(kRootNodeId, PathComponentPiece{"bar"});
+  auto flushed = channel->flushInvalidations();
+  // Entries are not merged across a flush.
+  channel->invalidateEntry(kRootNodeId, PathComponentPiece{"foo"});
+
+  auto completeFuture = performInit(channel.get());
+
+  auto expectInodeInvalidation =
+      [&](uint64_t ino, int64_t off, int64_t len) {
+        auto response = fuse_.recvResponse();
+        EXPECT_EQ(FUSE_NOTIFY_INVAL_INODE, response.header.error);
+        ASSERT_EQ(sizeof(fuse_notify_inval_inode_out), response.body.size());
+        fuse_notify_inval_inode_out notify;
+        memcpy(&notify, response.body.data(), sizeof(notify));
+        EXPECT_EQ(ino, notify.ino);
+        EXPECT_EQ(off, notify.off);
+        EXPECT_EQ(len, notify.len);
+      };
+  auto expectEntryInvalidation = [&](StringPiece name) {
+    auto response = fuse_.recvResponse();
+    EXPECT_EQ(FUSE_NOTIFY_INVAL_ENTRY, response.header.error);
+    ASSERT_EQ(
+        sizeof(fuse_notify_inval_entry_out) + name.size() + 1,
+        response.body.size());
+    EXPECT_EQ(
+        name,
+        StringPiece(
+            reinterpret_cast<const char*>(response.body.data()) +
+                sizeof(fuse_notify_inval_entry_out),
+            name.size()));
+  };
+
+  expectInodeInvalidation(5, 0, 0);
+  expectInodeInvalidation(6, 0, 15);
+  expectInodeInvalidation(6, 100, 10);
+  expectEntryInvalidation("foo");
+  expectEntryInvalidation("bar");
+  std::move(flushed).get(kTimeout);
+  expectEntryInvalidation("foo");
+
+  auto counts = channel->getInvalidationCounts();
+  EXPECT_EQ(6, counts.sent);
+  EXPECT_EQ(5, counts.coalesced);
+}
+
 TEST_F(FuseChannelTest, testDestroyWithPendingRequests) {
   auto channel = createChannel();
   auto completeFuture = performInit(channel.get());
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#ifndef _WIN32
+
+#include "eden/fs/fuse/FuseRequestPool.h"
+
+#include <folly/portability/GTest.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "eden/fs/fuse/DirList.h"
+
+using namespace facebook::eden;
+
+namespace {
+
+struct Payload {
+  explicit Payload(int v) : value{v} {}
+  int value;
+  char padding[120];
+};
+
+} // namespace
+
+TEST(FuseRequestPoolTest, reusesReleasedBlocks) {
+  auto pool = std::make_shared<FuseRequestPool>(4, /*stats=*/nullptr);
+  FuseRequestPool::Allocator<Payload> alloc{pool};
+
+  auto first = std::allocate_shared<Payload>(alloc, 1);
+  const void* firstBlock = first.get();
+  first.reset();
+
+  auto second = std::allocate_shared<Payload>(alloc, 2);
+  EXPECT_EQ(firstBlock, second.get());
+  EXPECT_EQ(2, second->value);
+}
+
+TEST(FuseRequestPoolTest, onlyCachesBlocksOfTheFirstSize) {
+  auto pool = std::make_shared<FuseRequestPool>(4, /*stats=*/nullptr);
+  void* a = pool->allocate(64);
+  pool->deallocate(a, 64);
+  // Blocks of a different size go back to the heap.
+  void* b = pool->allocate(32);
+  pool->deallocate(b, 32);
+
+  EXPECT_EQ(a, pool->allocate(64));
+  pool->deallocate(a, 64);
+}
+
+TEST(FuseRequestPoolTest, recyclesBlocksFreedOnAnotherThread) {
+  auto pool = std::make_shared<FuseRequestPool>(
+      FuseRequestPool::kTransferBatchSize, /*stats=*/nullptr);
+  std::vector<void*> blocks;
+  for (size_t i = 0; i <= FuseRequestPool::kTransferBatchSize; ++i) {
+    blocks.push_back(pool->allocate(64));
+  }
+
+  // The freeing thread's list fills up and is handed over to the shared
+  // list, the block left in its own list is freed when the thread exits.
+  std::thread{[&] {
+    for (auto* block : blocks) {
+      pool->deallocate(block, 64);
+    }
+  }}.join();
+
+  auto* block = pool->allocate(64);
+  EXPECT_NE(
+      blocks.begin() + FuseRequestPool::kTransferBatchSize,
+      std::find(
+          blocks.begin(),
+          blocks.begin() + FuseRequestPool::kTransferBatchSize,
+          block));
+  pool->deallocate(block, 64);
+}
+
+TEST(FuseRequestPoolTest, recyclesDirListBuffers) {
+  auto pool = std::make_shared<FuseRequestPool>(4, /*stats=*/nullptr);
+  const void* buffer;
+  {
+    FuseDirList list{4096, pool};
+    buffer = list.getBuf().data();
+  }
+  FuseDirList list{4096, pool};
+  EXPECT_EQ(buffer, list.getBuf().data());
+}
+
+TEST(FuseRequestPoolTest, outlivesItsOwner) {
+  auto pool = std::make_shared<FuseRequestPool>(4, /*stats=*/nullptr);
+  auto payload = std::allocate_shared<Payload>(
+      FuseRequestPool::Allocator<Payload>{pool}, 3);
+  // The allocation keeps the pool alive after the last other reference goes.
+  pool.reset();
+  EXPECT_EQ(3, payload->value);
+  payload.reset();
+}
+
+#endif
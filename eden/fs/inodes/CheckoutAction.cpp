@@ -10,6 +10,7 @@
 #include <folly/logging/xlog.h>
 
 #include "eden/fs/inodes/CheckoutContext.h"
+#include "eden/fs/inodes/EdenMount.h"
 #include "eden/fs/inodes/FileInode.h"
 #include "eden/fs/inodes/InodeBase.h"
 #include "eden/fs/inodes/TreeInode.h"
@@ -293,6 +294,23 @@ Future<InvalidationRequired> CheckoutAction::doAction() {
           return InvalidationRequired::No;
         }
 
+        if (newBlobSha1_) {
+          // The file already has the new contents. Point it at the new blob
+          // instead of replacing it, so that no data is written and the
+          // kernel's caches stay valid.
+          if (ctx_->isDryRun()) {
+            return InvalidationRequired::No;
+          }
+#ifndef _WIN32
+          if (inode_.asFilePtr()->checkoutIfSameAs(
+                  ctx_->renameLock(),
+                  newScmEntry_->getHash(),
+                  *newBlobSha1_)) {
+            return InvalidationRequired::No;
+          }
+#endif
+        }
+
         // Call TreeInode::checkoutUpdateEntry() to actually do the work.
         //
         // Note that we are moving most of our state into the
@@ -343,22 +361,30 @@ Future<bool> CheckoutAction::hasConflict() {
             oldBlobSha1_.value(),
             oldScmEntry_.value().getType(),
             ctx_->getFetchContext())
-        .thenValue([this](bool isSame) {
+        .thenValue([this, fileInode](bool isSame) -> Future<bool> {
           if (isSame) {
             // no conflict
             return false;
           }
 
-          // The file contents or mode bits are different:
-          // - If the file exists in the new tree but differs from what is
-          //   currently in the working copy, then this is a MODIFIED_MODIFIED
-          //   conflict.
-          // - If the file does not exist in the new tree, then this is a
-          //   MODIFIED_REMOVED conflict.
-          auto conflictType = newScmEntry_ ? ConflictType::MODIFIED_MODIFIED
-                                           : ConflictType::MODIFIED_REMOVED;
-          ctx_->addConflict(conflictType, inode_.get());
-          return true;
+          // A modified file that already matches the new tree, as after a
+          // rebase that includes the local change, is no conflict either.
+          return isSameAsNewBlob(fileInode).thenValue([this](bool isNew) {
+            if (isNew) {
+              return false;
+            }
+
+            // The file contents or mode bits are different:
+            // - If the file exists in the new tree but differs from what is
+            //   currently in the working copy, then this is a
+            //   MODIFIED_MODIFIED conflict.
+            // - If the file does not exist in the new tree, then this is a
+            //   MODIFIED_REMOVED conflict.
+            auto conflictType = newScmEntry_ ? ConflictType::MODIFIED_MODIFIED
+                                             : ConflictType::MODIFIED_REMOVED;
+            ctx_->addConflict(conflictType, inode_.get());
+            return true;
+          });
         });
   }
 
@@ -367,14 +393,20 @@ Future<bool> CheckoutAction::hasConflict() {
   XDCHECK(newScmEntry_) << "If there is no oldScmEntry_, then there must be a "
                            "newScmEntry_.";
 
-  auto localIsFile = inode_.asFilePtrOrNull() != nullptr;
-  if (localIsFile) {
+  auto localFile = inode_.asFilePtrOrNull();
+  if (localFile) {
     auto remoteIsFile = !newScmEntry_->isTree();
     if (remoteIsFile) {
       // This entry is a file that did not exist in the old source control tree,
-      // but it exists as a tracked file in the new tree.
-      ctx_->addConflict(ConflictType::UNTRACKED_ADDED, inode_.get());
-      return true;
+      // but it exists as a tracked file in the new tree. It is only a conflict
+      // if the contents differ.
+      return isSameAsNewBlob(localFile).thenValue([this](bool isNew) {
+        if (isNew) {
+          return false;
+        }
+        ctx_->addConflict(ConflictType::UNTRACKED_ADDED, inode_.get());
+        return true;
+      });
     } else {
       // This entry is a file that did not exist in the old source control tree,
       // but it exists as a tracked directory in the new tree.
@@ -389,5 +421,35 @@ Future<bool> CheckoutAction::hasConflict() {
     return false;
   }
 }
+
+Future<bool> CheckoutAction::isSameAsNewBlob(const FileInodePtr& fileInode) {
+  if (!newScmEntry_ || newScmEntry_->isTree()) {
+    return false;
+  }
+  // Only the SHA-1 is needed, which is usually cached in the blob metadata,
+  // so the new blob itself is not fetched.
+  return fileInode->getMount()
+      ->getObjectStore()
+      ->getBlobSha1(newScmEntry_->getHash(), ctx_->getFetchContext())
+      .thenValue([this, fileInode](Hash newBlobSha1) {
+        return fileInode
+            ->isSameAs(
+                newScmEntry_->getHash(),
+                newBlobSha1,
+                newScmEntry_->getType(),
+                ctx_->getFetchContext())
+            .thenValue([this, newBlobSha1](bool isSame) {
+              if (isSame) {
+                newBlobSha1_ = newBlobSha1;
+              }
+              return isSame;
+            });
+      })
+      .thenError([](const exception_wrapper& ew) {
+        XLOG(DBG2) << "Assuming different from the new blob: "
+                   << folly::exceptionStr(ew);
+        return false;
+      });
+}
 } // namespace eden
 } // namespace facebook
@@ -125,6 +125,13 @@ class CheckoutAction {
   bool ensureDataReady() noexcept;
   folly::Future<bool> hasConflict();
 
+  /**
+   * Return whether the file already has the contents and type of the new
+   * source control entry, in which case it is no conflict, and the file can
+   * be kept instead of replaced. Records the SHA-1 of the new blob if so.
+   */
+  folly::Future<bool> isSameAsNewBlob(const FileInodePtr& fileInode);
+
   /**
    * Return whether the directory's contents have changed and the
    * inode's readdir cache must be flushed.
@@ -184,6 +191,11 @@ class CheckoutAction {
   std::shared_ptr<const Tree> newTree_;
   bool newBlobMarker_ = false;
 
+  /**
+   * The SHA-1 of the new blob, set if the file already has its contents.
+   */
+  std::optional<Hash> newBlobSha1_;
+
   /**
    * The errors vector keeps track of any errors that occurred while trying to
    * load the data needed to perform the checkout action.
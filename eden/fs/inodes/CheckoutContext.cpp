@@ -7,13 +7,17 @@
 
 #include "eden/fs/inodes/CheckoutContext.h"
 
+#include <folly/ScopeGuard.h>
+#include <folly/futures/Future.h>
 #include <folly/logging/xlog.h>
 #include <optional>
 
 #include "eden/fs/config/CheckoutConfig.h"
+#include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/inodes/EdenMount.h"
 #include "eden/fs/inodes/InodePtr.h"
 #include "eden/fs/inodes/TreeInode.h"
+#include "eden/fs/utils/UnboundedQueueExecutor.h"
 
 using folly::Future;
 using std::vector;
@@ -33,7 +37,9 @@ CheckoutContext::CheckoutContext(
       fetchContext_{
           clientPid,
           ObjectFetchContext::Cause::Thrift,
-          thriftMethodName} {}
+          thriftMethodName},
+      maxParallelSubtrees_{
+          mount->getEdenConfig()->checkoutMaxParallelSubtrees.getValue()} {}
 
 CheckoutContext::CheckoutContext(
     EdenMount* mount,
@@ -46,7 +52,9 @@ CheckoutContext::CheckoutContext(
       fetchContext_{
           clientPid,
           ObjectFetchContext::Cause::Thrift,
-          thriftMethodName} {}
+          thriftMethodName},
+      maxParallelSubtrees_{
+          mount->getEdenConfig()->checkoutMaxParallelSubtrees.getValue()} {}
 
 CheckoutContext::~CheckoutContext() {}
 
@@ -72,6 +80,13 @@ Future<vector<CheckoutConflict>> CheckoutContext::finish(RootId newSnapshot) {
                << " to " << newSnapshot;
   }
 
+  auto progress = getProgress();
+  XLOG(DBG2) << "checkout of " << mount_->getPath() << " updated "
+             << progress.treesCompleted << " trees with "
+             << progress.actionsCompleted << " actions, "
+             << progress.subtreesDispatched
+             << " subtrees ran on the server thread pool";
+
   // Release the rename lock.
   // This allows any filesystem unlink() or rename() operations to proceed.
   renameLock_.unlock();
@@ -116,6 +131,40 @@ Future<vector<CheckoutConflict>> CheckoutContext::finish(RootId newSnapshot) {
   return std::move(*conflicts_.wlock());
 }
 
+Future<folly::Unit> CheckoutContext::runSubtreeCheckout(
+    folly::Function<Future<folly::Unit>()> checkout) {
+  auto parallel = parallelSubtrees_.fetch_add(1, std::memory_order_acq_rel);
+  if (parallel >= maxParallelSubtrees_) {
+    parallelSubtrees_.fetch_sub(1, std::memory_order_acq_rel);
+    return checkout();
+  }
+
+  // The slot is released once the subtree has computed and started its
+  // actions, which is the bulk of the work done on the thread, so its own
+  // subtrees can be dispatched as well.
+  subtreesDispatched_.fetch_add(1, std::memory_order_relaxed);
+  return folly::via(
+      mount_->getServerThreadPool().get(),
+      [this, checkout = std::move(checkout)]() mutable {
+        SCOPE_EXIT {
+          parallelSubtrees_.fetch_sub(1, std::memory_order_acq_rel);
+        };
+        return checkout();
+      });
+}
+
+void CheckoutContext::treeCheckoutCompleted(size_t numActions) {
+  treesCompleted_.fetch_add(1, std::memory_order_relaxed);
+  actionsCompleted_.fetch_add(numActions, std::memory_order_relaxed);
+}
+
+CheckoutContext::Progress CheckoutContext::getProgress() const {
+  return Progress{
+      treesCompleted_.load(std::memory_order_relaxed),
+      actionsCompleted_.load(std::memory_order_relaxed),
+      subtreesDispatched_.load(std::memory_order_relaxed)};
+}
+
 void CheckoutContext::addConflict(ConflictType type, RelativePathPiece path) {
   // Errors should be added using addError()
   XCHECK(type != ConflictType::ERROR)
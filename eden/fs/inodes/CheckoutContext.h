@@ -7,8 +7,10 @@
 
 #pragma once
 
+#include <atomic>
 #include <vector>
 
+#include <folly/Function.h>
 #include <folly/Range.h>
 #include <folly/Synchronized.h>
 #include <folly/stop_watch.h>
@@ -118,6 +120,42 @@ class CheckoutContext {
     return fetchContext_;
   }
 
+  /**
+   * Run the checkout of a subtree.
+   *
+   * Up to checkout-max-parallel-subtrees subtrees are queued or running on
+   * the server thread pool at any time, where any idle thread picks them up,
+   * so the work of wide and deep trees is spread over all the threads rather
+   * than done by whichever thread completed the tree fetch. Past that bound,
+   * the subtree is checked out inline.
+   *
+   * The RenameLock is held by this context and thus stays held for the
+   * duration of every subtree checkout, wherever it runs.
+   */
+  folly::Future<folly::Unit> runSubtreeCheckout(
+      folly::Function<folly::Future<folly::Unit>()> checkout);
+
+  /**
+   * Record that the checkout of a single TreeInode completed, after having
+   * run numActions CheckoutAction.
+   */
+  void treeCheckoutCompleted(size_t numActions);
+
+  struct Progress {
+    /** Number of TreeInode whose checkout completed. */
+    uint64_t treesCompleted;
+    /** Number of CheckoutAction that ran for these trees. */
+    uint64_t actionsCompleted;
+    /** Number of subtree checkouts dispatched to the server thread pool. */
+    uint64_t subtreesDispatched;
+  };
+
+  /**
+   * Return the progress made so far by this checkout. This can be called
+   * concurrently with the checkout.
+   */
+  Progress getProgress() const;
+
  private:
   CheckoutMode checkoutMode_;
   EdenMount* const mount_;
@@ -129,6 +167,13 @@ class CheckoutContext {
   // if some data load operations complete asynchronously on other threads.
   // Therefore access to the conflicts list must be synchronized.
   folly::Synchronized<std::vector<CheckoutConflict>> conflicts_;
+
+  const uint64_t maxParallelSubtrees_;
+  std::atomic<uint64_t> parallelSubtrees_{0};
+
+  std::atomic<uint64_t> treesCompleted_{0};
+  std::atomic<uint64_t> actionsCompleted_{0};
+  std::atomic<uint64_t> subtreesDispatched_{0};
 };
 } // namespace eden
 } // namespace facebook
@@ -10,6 +10,7 @@
 #include <folly/Unit.h>
 #include <folly/futures/Future.h>
 #include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
 #include "eden/fs/inodes/EdenMount.h"
 #include "eden/fs/inodes/FileInode.h"
 #include "eden/fs/inodes/TreeInode.h"
@@ -28,6 +29,12 @@ using std::make_unique;
 using std::shared_ptr;
 using std::unique_ptr;
 
+DEFINE_bool(
+    dematerializeRevertedFiles,
+    false,
+    "Dematerialize the files that a diff finds identical to source control, "
+    "so that they are served from the object store again");
+
 namespace facebook {
 namespace eden {
 
@@ -214,19 +221,76 @@ class ModifiedDiffEntry : public DeferredDiffEntry {
       return treeInode->diff(context_, getPath(), nullptr, ignore_, isIgnored_);
     }
 
-    return fileInode
-        ->isSameAs(
-            scmEntry_.getHash(),
-            scmEntry_.getType(),
-            context_->getFetchContext())
-        .thenValue([this](bool isSame) {
-          if (!isSame) {
-            XLOG(DBG5) << "modified file: " << getPath();
-            context_->callback->modifiedFile(getPath());
+    if (fileInode->getBlobHash() == scmEntry_.getHash()) {
+      // The file is not materialized, only its mode can have changed, which
+      // doesn't require fetching anything.
+      return fileInode
+          ->isSameAs(
+              scmEntry_.getHash(),
+              scmEntry_.getType(),
+              context_->getFetchContext())
+          .thenValue([this](bool isSame) { reportIfModified(isSame); });
+    }
+
+    // Fetch the source control SHA-1 along with the other entries of the
+    // DiffContext, and compute the SHA-1 of the file on a CPU thread so that
+    // the files of a directory are hashed in parallel.
+    return context_->getBlobSha1(scmEntry_.getHash())
+        .via(fileInode->getMount()->getServerThreadPool().get())
+        .thenValue([this, fileInode](Hash scmSha1) {
+          return fileInode
+              ->isSameAs(
+                  scmEntry_.getHash(),
+                  scmSha1,
+                  scmEntry_.getType(),
+                  context_->getFetchContext())
+              .thenValue([this, fileInode, scmSha1](bool isSame) {
+                if (isSame && FLAGS_dematerializeRevertedFiles) {
+                  dematerializeReverted(*fileInode, scmSha1);
+                }
+                return isSame;
+              });
+        })
+        .thenTry([this](folly::Try<bool>&& isSame) {
+          if (isSame.hasException()) {
+            XLOG(DBG2) << "Assuming changed: " << isSame.exception();
+            reportIfModified(false);
+          } else {
+            reportIfModified(isSame.value());
           }
         });
   }
 
+  /**
+   * The file has the contents of the source control blob, but it is
+   * materialized, typically because it was edited and then reverted.
+   */
+  void dematerializeReverted(FileInode& fileInode, const Hash& scmSha1) {
+#ifndef _WIN32
+    if (fileInode.getBlobHash().has_value()) {
+      return;
+    }
+    try {
+      if (fileInode.dematerializeIfSameAs(scmEntry_.getHash(), scmSha1)) {
+        XLOG(DBG5) << "dematerialized reverted file: " << getPath();
+      }
+    } catch (const std::exception& ex) {
+      XLOG(WARN) << "unable to dematerialize reverted file " << getPath()
+                 << ": " << folly::exceptionStr(ex);
+    }
+#else
+    (void)fileInode;
+    (void)scmSha1;
+#endif
+  }
+
+  void reportIfModified(bool isSame) {
+    if (!isSame) {
+      XLOG(DBG5) << "modified file: " << getPath();
+      context_->callback->modifiedFile(getPath());
+    }
+  }
+
   const GitIgnoreStack* ignore_{nullptr};
   bool isIgnored_{false};
   TreeEntry scmEntry_;
@@ -247,10 +311,8 @@ class ModifiedBlobDiffEntry : public DeferredDiffEntry {
         currentBlobHash_{currentBlobHash} {}
 
   folly::Future<folly::Unit> run() override {
-    auto f1 = context_->store->getBlobSha1(
-        scmEntry_.getHash(), context_->getFetchContext());
-    auto f2 = context_->store->getBlobSha1(
-        currentBlobHash_, context_->getFetchContext());
+    auto f1 = context_->getBlobSha1(scmEntry_.getHash());
+    auto f2 = context_->getBlobSha1(currentBlobHash_);
     return collectSafe(f1, f2).thenValue(
         [this](const std::tuple<Hash, Hash>& info) {
           const auto& [info1, info2] = info;
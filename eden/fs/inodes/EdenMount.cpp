@@ -51,6 +51,7 @@
 #include "eden/fs/utils/PathFuncs.h"
 #include "eden/fs/utils/SpawnedProcess.h"
 #include "eden/fs/utils/UnboundedQueueExecutor.h"
+#include "eden/fs/utils/WorkStealingTaskQueue.h"
 
 #ifdef _WIN32
 #include "eden/fs/prjfs/PrjfsChannel.h"
@@ -91,6 +92,10 @@ constexpr PathComponentPiece kNfsdSocketName{"nfsd.socket"_pc};
 } // namespace
 #endif
 
+namespace {
+constexpr PathComponentPiece kIgnoreFilename{".gitignore"_pc};
+} // namespace
+
 /**
  * Helper for computing unclean paths when changing parents
  *
@@ -160,14 +165,146 @@ class EdenMount::JournalDiffCallback : public DiffCallback {
   folly::Synchronized<Data> data_;
 };
 
+namespace {
+/**
+ * Fetches the trees that differ between the source and destination commits
+ * of a checkout while the inodes are walked, so that the CheckoutActions find
+ * more of them locally instead of fetching them one directory level at a
+ * time.
+ *
+ * Up to batchSize trees are fetched concurrently, letting the backing store
+ * batch their imports, and only down to maxDepth directories below the root;
+ * the deeper trees are left to the walk. Only the trees of the batch in
+ * flight are held in memory; the rest of the walk is kept as the hashes left
+ * to fetch.
+ *
+ * The prefetcher doesn't keep the checkout alive, since that would hold the
+ * parent commit lock: it stops at the first batch after the checkout
+ * completes.
+ */
+class CheckoutTreePrefetcher
+    : public std::enable_shared_from_this<CheckoutTreePrefetcher> {
+ public:
+  CheckoutTreePrefetcher(
+      std::shared_ptr<ObjectStore> objectStore,
+      const std::shared_ptr<CheckoutContext>& ctx,
+      std::shared_ptr<UnboundedQueueExecutor> executor,
+      size_t batchSize,
+      size_t maxDepth)
+      : objectStore_{std::move(objectStore)},
+        checkout_{ctx},
+        fetchContext_{ctx->getFetchContext()},
+        executor_{std::move(executor)},
+        batchSize_{batchSize},
+        maxDepth_{maxDepth} {}
+
+  void start(const Tree& fromTree, const Tree& toTree) {
+    addChangedSubtrees(&fromTree, toTree, 1);
+    fetchNextBatch();
+  }
+
+ private:
+  /**
+   * The source and destination subtrees at a path, depth directories below
+   * the root. The source is absent when the path isn't a directory in the
+   * source commit.
+   */
+  struct SubtreePair {
+    std::optional<Hash> from;
+    Hash to;
+    size_t depth;
+  };
+  using TreePair =
+      std::tuple<std::shared_ptr<const Tree>, std::shared_ptr<const Tree>>;
+
+  void addChangedSubtrees(
+      const Tree* fromTree,
+      const Tree& toTree,
+      size_t depth) {
+    if (depth > maxDepth_) {
+      return;
+    }
+    for (const auto& toEntry : toTree.getTreeEntries()) {
+      if (!toEntry.isTree()) {
+        continue;
+      }
+      auto* fromEntry =
+          fromTree ? fromTree->getEntryPtr(toEntry.getName()) : nullptr;
+      if (fromEntry && fromEntry->isTree()) {
+        if (fromEntry->getHash() != toEntry.getHash()) {
+          pending_.push_back(
+              SubtreePair{fromEntry->getHash(), toEntry.getHash(), depth});
+        }
+      } else {
+        pending_.push_back(SubtreePair{std::nullopt, toEntry.getHash(), depth});
+      }
+    }
+  }
+
+  void fetchNextBatch() {
+    if (pending_.empty() || checkout_.expired()) {
+      return;
+    }
+
+    // Taking the last subtrees first walks the trees depth first, which
+    // keeps the number of pending subtrees proportional to the depth of the
+    // repository rather than to its width.
+    auto count = std::min(batchSize_, pending_.size());
+    std::vector<folly::Future<TreePair>> fetches;
+    std::vector<size_t> depths;
+    fetches.reserve(count);
+    depths.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+      auto subtrees = std::move(pending_.back());
+      pending_.pop_back();
+      auto fromFuture = subtrees.from
+          ? objectStore_->getTree(*subtrees.from, fetchContext_)
+          : folly::makeFuture(std::shared_ptr<const Tree>{});
+      fetches.push_back(collectSafe(
+          std::move(fromFuture),
+          objectStore_->getTree(subtrees.to, fetchContext_)));
+      depths.push_back(subtrees.depth);
+    }
+
+    folly::collectAll(std::move(fetches))
+        .via(executor_.get())
+        .thenValue([self = shared_from_this(), depths = std::move(depths)](
+                       std::vector<folly::Try<TreePair>>&& results) {
+          for (size_t i = 0; i < results.size(); ++i) {
+            auto& result = results[i];
+            if (result.hasException()) {
+              // The checkout fetches this tree again, and reports the error
+              // if it persists.
+              XLOG(DBG3) << "error prefetching trees for checkout: "
+                         << result.exception().what();
+              continue;
+            }
+            auto& [fromTree, toTree] = result.value();
+            self->addChangedSubtrees(fromTree.get(), *toTree, depths[i] + 1);
+          }
+          self->fetchNextBatch();
+        });
+  }
+
+  std::shared_ptr<ObjectStore> objectStore_;
+  std::weak_ptr<CheckoutContext> checkout_;
+  // A copy of the checkout's context, which must outlive the fetches.
+  StatsFetchContext fetchContext_;
+  std::shared_ptr<UnboundedQueueExecutor> executor_;
+  const size_t batchSize_;
+  const size_t maxDepth_;
+  std::vector<SubtreePair> pending_;
+};
+} // namespace
+
 constexpr int EdenMount::kMaxSymlinkChainDepth;
 static constexpr folly::StringPiece kEdenStracePrefix = "eden.strace.";
 
 // We compute this when the process is initialized, but stash a copy
-// in each EdenMount.  We may in the future manage to propagate enough
-// state across upgrades or restarts that we can preserve this, but
-// as implemented today, a process restart will invalidate any cached
-// mountGeneration that a client may be holding on to.
+// in each EdenMount.  A process restart invalidates any cached
+// mountGeneration that a client may be holding on to, unless the mount
+// restored its journal from disk, in which case it keeps the generation
+// the journal was recorded with.
 // We take the bottom 16-bits of the pid and 32-bits of the current
 // time and shift them up, leaving 16 bits for a mount point generation
 // number.
@@ -211,17 +348,24 @@ EdenMount::EdenMount(
           checkoutConfig_->getOverlayPath(),
           checkoutConfig_->getCaseSensitive(),
           getOverlayType(),
-          serverState_->getStructuredLogger())},
+          serverState_->getStructuredLogger(),
+          getOverlayCacheSizes())},
 #ifndef _WIN32
       overlayFileAccess_{overlay_.get()},
 #endif
       journal_{std::move(journal)},
-      mountGeneration_{globalProcessGeneration | ++mountGeneration},
+      mountGeneration_{journal_->getRestoredMountGeneration().value_or(
+          globalProcessGeneration | ++mountGeneration)},
       straceLogger_{
           kEdenStracePrefix.str() + checkoutConfig_->getMountPath().value()},
       lastCheckoutTime_{EdenTimestamp{serverState_->getClock()->getRealtime()}},
       owner_{Owner{getuid(), getgid()}},
+      inodePathCache_{
+          serverState_->getEdenConfig()->inodePathCacheSize.getValue()},
+      gitIgnoreCache_{
+          serverState_->getEdenConfig()->gitIgnoreCacheSize.getValue()},
       clock_{serverState_->getClock()} {
+  journal_->setMountGeneration(mountGeneration_);
 }
 
 Overlay::OverlayType EdenMount::getOverlayType() {
@@ -234,13 +378,26 @@ Overlay::OverlayType EdenMount::getOverlayType() {
     }
     return Overlay::OverlayType::Tree;
   } else {
+#ifndef _WIN32
+    if (getEdenConfig()->logStructuredOverlay.getValue()) {
+      return Overlay::OverlayType::Log;
+    }
+#endif
     return Overlay::OverlayType::Legacy;
   }
 }
 
+Overlay::CacheSizes EdenMount::getOverlayCacheSizes() {
+  auto config = getEdenConfig();
+  return Overlay::CacheSizes{
+      config->overlayBlobCacheSize.getValue(),
+      config->overlayContentIndexSize.getValue()};
+}
+
 FOLLY_NODISCARD folly::Future<folly::Unit> EdenMount::initialize(
     OverlayChecker::ProgressCallback&& progressCallback,
-    const std::optional<SerializedInodeMap>& takeover) {
+    const std::optional<SerializedInodeMap>& takeover,
+    std::shared_ptr<const InodeMapSnapshot> takeoverSnapshot) {
   transitionState(State::UNINITIALIZED, State::INITIALIZING);
 
   return serverState_->getFaultInjector()
@@ -264,9 +421,17 @@ FOLLY_NODISCARD folly::Future<folly::Unit> EdenMount::initialize(
       })
       .thenValue(
           [this](RootId parent) { return createRootInode(std::move(parent)); })
-      .thenValue([this, takeover](TreeInodePtr initTreeNode) {
+      .thenValue([this,
+                  takeover,
+                  takeoverSnapshot = std::move(takeoverSnapshot)](
+                     TreeInodePtr initTreeNode) mutable {
         if (takeover) {
           inodeMap_->initializeFromTakeover(std::move(initTreeNode), *takeover);
+#ifndef _WIN32
+        } else if (takeoverSnapshot) {
+          inodeMap_->initializeFromSnapshot(
+              std::move(initTreeNode), std::move(takeoverSnapshot));
+#endif
         } else if (isWorkingCopyPersistent()) {
           inodeMap_->initializeFromOverlay(std::move(initTreeNode), *overlay_);
         } else {
@@ -770,6 +935,9 @@ folly::SemiFuture<SerializedInodeMap> EdenMount::shutdownImpl(bool doTakeover) {
         // the mount point.
         overlay_->close();
         XLOG(DBG1) << "successfully closed overlay at " << getPath();
+        // No more changes can be recorded once the inodes are unloaded, so
+        // the next process can restore the journal.
+        journal_->closeLog();
         auto oldState =
             state_.exchange(State::SHUT_DOWN, std::memory_order_acq_rel);
         if (oldState == State::DESTROYING) {
@@ -904,7 +1072,22 @@ InodeNumber EdenMount::getDotEdenInodeNumber() const {
 Future<InodePtr> EdenMount::getInode(
     RelativePathPiece path,
     ObjectFetchContext& context) const {
-  return inodeMap_->getRootInode()->getChildRecursive(path, context);
+  if (auto number = inodePathCache_.get(path)) {
+    // Only loaded inodes are served from the cache, the others have to be
+    // loaded through their parent anyway.
+    auto inode = inodeMap_->lookupLoadedInode(*number);
+    if (inode && !inode->isUnlinked()) {
+      return makeFuture(std::move(inode));
+    }
+  }
+
+  auto generation = inodePathCache_.getGeneration();
+  return inodeMap_->getRootInode()
+      ->getChildRecursive(path, context)
+      .thenValue([this, path = path.copy(), generation](InodePtr inode) {
+        inodePathCache_.insert(path, inode->getNodeId(), generation);
+        return inode;
+      });
 }
 
 folly::Future<std::string> EdenMount::loadFileContentsFromPath(
@@ -1014,6 +1197,24 @@ folly::Future<InodePtr> EdenMount::resolveSymlinkImpl(
 }
 #endif
 
+void EdenMount::startCheckoutTreePrefetch(
+    const std::shared_ptr<CheckoutContext>& ctx,
+    const Tree& fromTree,
+    const Tree& toTree) {
+  auto config = getEdenConfig();
+  auto batchSize = config->checkoutPrefetchTreeBatchSize.getValue();
+  if (batchSize == 0) {
+    return;
+  }
+  auto prefetcher = std::make_shared<CheckoutTreePrefetcher>(
+      objectStore_,
+      ctx,
+      getServerThreadPool(),
+      batchSize,
+      config->checkoutPrefetchTreeMaxDepth.getValue());
+  prefetcher->start(fromTree, toTree);
+}
+
 folly::Future<CheckoutResult> EdenMount::checkout(
     const RootId& snapshotHash,
     std::optional<pid_t> clientPid,
@@ -1021,6 +1222,9 @@ folly::Future<CheckoutResult> EdenMount::checkout(
     CheckoutMode checkoutMode) {
   const folly::stop_watch<> stopWatch;
   auto checkoutTimes = std::make_shared<CheckoutTimes>();
+  // The continuations of the checkout run after the filesystem requests it
+  // would otherwise delay.
+  BackgroundWorkGuard backgroundWork;
 
   // Hold the snapshot lock for the duration of the entire checkout operation.
   //
@@ -1061,6 +1265,13 @@ folly::Future<CheckoutResult> EdenMount::checkout(
   return serverState_->getFaultInjector()
       .checkAsync("checkout", getPath().stringPiece())
       .via(getServerThreadPool().get())
+      .thenValue([this](auto&&) { return waitForPendingNotifications(); })
+      .thenValue([this](auto&&) {
+        // This must complete before we take the rename lock: the kernel's
+        // writeback goes through FileInode::write(), which may need it to
+        // materialize the file.
+        return flushKernelWritebackCache();
+      })
       .thenValue([this, ctx, parent1Hash = oldParent, snapshotHash](auto&&) {
         auto fromTreeFuture =
             objectStore_->getRootTree(parent1Hash, ctx->getFetchContext());
@@ -1072,6 +1283,11 @@ folly::Future<CheckoutResult> EdenMount::checkout(
                      std::tuple<shared_ptr<const Tree>, shared_ptr<const Tree>>
                          treeResults) {
         checkoutTimes->didLookupTrees = stopWatch.elapsed();
+        auto& [fromTree, toTree] = treeResults;
+        // The prefetch runs alongside the journal diff and the inode walk,
+        // neither waits for it.
+        startCheckoutTreePrefetch(ctx, *fromTree, *toTree);
+
         // Call JournalDiffCallback::performDiff() to compute the changes
         // between the original working directory state and the source
         // tree state.
@@ -1079,10 +1295,9 @@ folly::Future<CheckoutResult> EdenMount::checkout(
         // If we are doing a dry-run update we aren't going to create a
         // journal entry, so we can skip this step entirely.
         if (ctx->isDryRun()) {
-          return folly::makeFuture(treeResults);
+          return folly::makeFuture(std::move(treeResults));
         }
 
-        auto& fromTree = std::get<0>(treeResults);
         return journalDiffCallback->performDiff(this, getRootInode(), fromTree)
             .thenValue([ctx, journalDiffCallback, treeResults](
                            const StatsFetchContext& diffFetchContext) {
@@ -1134,8 +1349,10 @@ folly::Future<CheckoutResult> EdenMount::checkout(
               return rootInode->checkout(ctx.get(), fromTree, toTree);
             });
       })
-      .thenValue([ctx, checkoutTimes, stopWatch, snapshotHash](auto&&) {
+      .thenValue([this, ctx, checkoutTimes, stopWatch, snapshotHash](auto&&) {
         checkoutTimes->didCheckout = stopWatch.elapsed();
+        // Entries replaced without loading their inode are not unlinked.
+        inodePathCache_.invalidate();
         // Complete the checkout and save the new snapshot hash
         return ctx->finish(snapshotHash);
       })
@@ -1230,6 +1447,29 @@ folly::Future<folly::Unit> EdenMount::chown(uid_t uid, gid_t gid) {
 }
 #endif
 
+folly::Future<folly::Unit> EdenMount::flushKernelWritebackCache() {
+#ifndef _WIN32
+  auto* fuseChannel = getFuseChannel();
+  if (fuseChannel && fuseChannel->isWritebackCacheEnabled()) {
+    // Only inodes the kernel references can have dirty pages.  Invalidating
+    // their data makes the kernel write those pages back to us first.
+    auto inodesToFlush = getInodeMap()->getReferencedInodes();
+    fuseChannel->invalidateInodes(folly::range(inodesToFlush));
+    return fuseChannel->flushInvalidations();
+  }
+#endif
+  return folly::unit;
+}
+
+folly::Future<folly::Unit> EdenMount::waitForPendingNotifications() const {
+#ifdef _WIN32
+  if (auto* channel = getPrjfsChannel()) {
+    return channel->waitForPendingNotifications();
+  }
+#endif
+  return folly::unit;
+}
+
 /*
 During a diff, we have the possiblility of entering a non-mount aware code path.
 Inside the non-mount aware code path, gitignore files still need to be honored.
@@ -1260,11 +1500,13 @@ std::unique_ptr<DiffContext> EdenMount::createDiffContext(
       getObjectStore(),
       serverState_->getTopLevelIgnores(),
       std::move(loadContents),
-      request);
+      request,
+      getEdenConfig()->diffMaxConcurrentTreeFetches.getValue());
 }
 
 Future<Unit> EdenMount::diff(DiffContext* ctxPtr, const RootId& commitHash)
     const {
+  gitIgnoreCache_.processJournal(*journal_);
   auto rootInode = getRootInode();
   return objectStore_->getRootTree(commitHash, ctxPtr->getFetchContext())
       .thenValue([ctxPtr, rootInode = std::move(rootInode)](
@@ -1283,7 +1525,8 @@ Future<Unit> EdenMount::diff(
     const RootId& commitHash,
     bool listIgnored,
     bool enforceCurrentParent,
-    ResponseChannelRequest* request) const {
+    ResponseChannelRequest* request,
+    const std::vector<RelativePath>& scope) const {
   if (enforceCurrentParent) {
     auto parentInfo = parentCommit_.rlock(std::chrono::milliseconds{500});
 
@@ -1313,15 +1556,24 @@ Future<Unit> EdenMount::diff(
     // starting until we have finished computing this status call.
   }
 
+  BackgroundWorkGuard backgroundWork;
+
   // Create a DiffContext object for this diff operation.
   auto context = createDiffContext(callback, listIgnored, request);
+  if (!scope.empty()) {
+    context->setScope(DiffScope{scope});
+  }
   DiffContext* ctxPtr = context.get();
 
   // stateHolder() exists to ensure that the DiffContext and GitIgnoreStack
   // exists until the diff completes.
   auto stateHolder = [ctx = std::move(context)]() {};
 
-  return diff(ctxPtr, commitHash).ensure(std::move(stateHolder));
+  return waitForPendingNotifications()
+      .thenValue([this, ctxPtr, commitHash](auto&&) {
+        return diff(ctxPtr, commitHash);
+      })
+      .ensure(std::move(stateHolder));
 }
 
 folly::Future<std::unique_ptr<ScmStatus>> EdenMount::diff(
@@ -1329,16 +1581,160 @@ folly::Future<std::unique_ptr<ScmStatus>> EdenMount::diff(
     bool listIgnored,
     bool enforceCurrentParent,
     ResponseChannelRequest* request) {
-  auto callback = std::make_unique<ScmStatusDiffCallback>();
-  auto callbackPtr = callback.get();
-  return this
-      ->diff(
-          callbackPtr, commitHash, listIgnored, enforceCurrentParent, request)
-      .thenValue([callback = std::move(callback)](auto&&) {
-        return std::make_unique<ScmStatus>(callback->extractStatus());
+  auto maxAge = getEdenConfig()->scmStatusCacheMaxAge.getValue();
+  if (maxAge == std::chrono::nanoseconds::zero()) {
+    auto callback = std::make_unique<ScmStatusDiffCallback>();
+    auto callbackPtr = callback.get();
+    return this
+        ->diff(
+            callbackPtr, commitHash, listIgnored, enforceCurrentParent, request)
+        .thenValue([callback = std::move(callback)](auto&&) {
+          return std::make_unique<ScmStatus>(callback->extractStatus());
+        });
+  }
+
+  // The journal sequence number has to be read once all the pending changes
+  // have been recorded, and before the diff starts: a change recorded during
+  // the diff is then diffed again by the next call.
+  return waitForPendingNotifications().thenValue(
+      [this, commitHash, listIgnored, enforceCurrentParent, request, maxAge](
+          auto&&) {
+        auto latest = journal_->getLatest();
+        auto sequenceNumber = latest ? latest->sequenceID : 0;
+        auto now = std::chrono::steady_clock::now();
+
+        auto cached = getCachedScmStatus(
+            commitHash, listIgnored, enforceCurrentParent, now - maxAge);
+        std::vector<RelativePath> changedPaths;
+        if (cached && cached->sequenceNumber != sequenceNumber) {
+          if (auto changes = getScmStatusChanges(cached->sequenceNumber)) {
+            changedPaths = std::move(*changes);
+          } else {
+            cached.reset();
+          }
+        }
+        if (cached && changedPaths.empty()) {
+          return makeFuture(std::make_unique<ScmStatus>(*cached->status));
+        }
+
+        auto callback = std::make_unique<ScmStatusDiffCallback>();
+        auto callbackPtr = callback.get();
+        return this
+            ->diff(
+                callbackPtr,
+                commitHash,
+                listIgnored,
+                enforceCurrentParent,
+                request,
+                changedPaths)
+            .thenValue([this,
+                        callback = std::move(callback),
+                        commitHash,
+                        listIgnored,
+                        sequenceNumber,
+                        now,
+                        cached = std::move(cached),
+                        changedPaths = std::move(changedPaths)](auto&&) {
+              auto diffStatus = callback->extractStatus();
+              std::shared_ptr<const ScmStatus> status;
+              auto computedAt = now;
+              if (cached) {
+                // Replace the cached entries under the changed paths with
+                // the ones just diffed.
+                auto merged = *cached->status;
+                auto& entries = *merged.entries_ref();
+                DiffScope scope{changedPaths};
+                for (auto it = entries.begin(); it != entries.end();) {
+                  if (scope.contains(RelativePathPiece{it->first})) {
+                    it = entries.erase(it);
+                  } else {
+                    ++it;
+                  }
+                }
+                for (auto& [path, fileStatus] : *diffStatus.entries_ref()) {
+                  entries[path] = fileStatus;
+                }
+                merged.errors_ref() = std::move(*diffStatus.errors_ref());
+                status = std::make_shared<const ScmStatus>(std::move(merged));
+                computedAt = cached->computedAt;
+              } else {
+                status = std::make_shared<const ScmStatus>(
+                    std::move(diffStatus));
+              }
+              // A status with errors may be incomplete, compute it again
+              // next time.
+              if (status->errors_ref()->empty()) {
+                *cachedScmStatus_.wlock() = CachedScmStatus{
+                    commitHash,
+                    listIgnored,
+                    sequenceNumber,
+                    computedAt,
+                    status};
+              }
+              return std::make_unique<ScmStatus>(*status);
+            });
       });
 }
 
+std::optional<EdenMount::CachedScmStatus> EdenMount::getCachedScmStatus(
+    const RootId& commitHash,
+    bool listIgnored,
+    bool enforceCurrentParent,
+    std::chrono::steady_clock::time_point computedAfter) const {
+  auto cached = cachedScmStatus_.rlock();
+  if (!cached->has_value()) {
+    return std::nullopt;
+  }
+  const auto& entry = cached->value();
+  if (entry.commitHash != commitHash || entry.listIgnored != listIgnored ||
+      entry.computedAt < computedAfter) {
+    return std::nullopt;
+  }
+
+  if (enforceCurrentParent) {
+    // Let a full diff report the error if the parent has changed or is
+    // being changed by a checkout.
+    auto parentInfo = parentCommit_.rlock(std::chrono::milliseconds{0});
+    if (!parentInfo || *parentInfo != commitHash) {
+      return std::nullopt;
+    }
+  }
+  return entry;
+}
+
+std::optional<std::vector<RelativePath>> EdenMount::getScmStatusChanges(
+    Journal::SequenceNumber sequenceNumber) const {
+  std::vector<RelativePath> paths;
+  auto range = journal_->accumulateRange(sequenceNumber + 1);
+  if (!range) {
+    return paths;
+  }
+  if (range->isTruncated || range->snapshotTransitions.size() > 1) {
+    return std::nullopt;
+  }
+
+  paths.reserve(
+      range->changedFilesInOverlay.size() + range->uncleanPaths.size());
+  auto addPath = [&](const RelativePath& path) {
+    if (!path.empty() && path.basename() == kIgnoreFilename) {
+      return false;
+    }
+    paths.push_back(path);
+    return true;
+  };
+  for (const auto& [path, changeInfo] : range->changedFilesInOverlay) {
+    if (!addPath(path)) {
+      return std::nullopt;
+    }
+  }
+  for (const auto& path : range->uncleanPaths) {
+    if (!addPath(path)) {
+      return std::nullopt;
+    }
+  }
+  return paths;
+}
+
 void EdenMount::resetParent(const RootId& parent) {
   // Hold the snapshot lock around the entire operation.
   auto parentLock = parentCommit_.wlock();
@@ -1368,6 +1764,10 @@ RenameLock EdenMount::acquireRenameLock() {
   return RenameLock{this};
 }
 
+RenameLock EdenMount::tryAcquireRenameLock() {
+  return RenameLock{this, std::try_to_lock};
+}
+
 SharedRenameLock EdenMount::acquireSharedRenameLock() {
   return SharedRenameLock{this};
 }
@@ -1388,6 +1788,12 @@ std::string EdenMount::getCounterName(CounterName name) {
       return folly::to<std::string>("journal.", base, ".duration_secs");
     case CounterName::JOURNAL_MAX_FILES_ACCUMULATED:
       return folly::to<std::string>("journal.", base, ".files_accumulated.max");
+    case CounterName::FUSE_INVALIDATIONS_SENT:
+      return folly::to<std::string>("fuse.", base, ".invalidations.sent");
+    case CounterName::FUSE_INVALIDATIONS_COALESCED:
+      return folly::to<std::string>("fuse.", base, ".invalidations.coalesced");
+    case CounterName::OVERLAY_GC_QUEUE_DEPTH:
+      return folly::to<std::string>("overlay.", base, ".gc_queue_depth");
   }
   EDEN_BUG() << "unknown counter name "
              << static_cast<std::underlying_type_t<CounterName>>(name);
@@ -1403,10 +1809,14 @@ std::unique_ptr<FuseChannel, FuseChannelDeleter> makeFuseChannel(
     EdenMount* mount,
     folly::File fuseFd) {
   auto edenConfig = mount->getEdenConfig();
+  size_t minThreads = edenConfig->fuseMinWorkerThreads.getValue();
+  if (minThreads == 0) {
+    minThreads = FLAGS_fuseNumThreads;
+  }
   return std::unique_ptr<FuseChannel, FuseChannelDeleter>{new FuseChannel(
       std::move(fuseFd),
       mount->getPath(),
-      FLAGS_fuseNumThreads,
+      minThreads,
       EdenDispatcherFactory::makeFuseDispatcher(mount),
       &mount->getStraceLogger(),
       mount->getServerState()->getProcessNameCache(),
@@ -1416,7 +1826,13 @@ std::unique_ptr<FuseChannel, FuseChannelDeleter> makeFuseChannel(
       mount->getServerState()->getNotifications(),
       mount->getCheckoutConfig()->getCaseSensitive(),
       mount->getCheckoutConfig()->getRequireUtf8Path(),
-      edenConfig->fuseMaximumRequests.getValue())};
+      edenConfig->fuseMaximumRequests.getValue(),
+      edenConfig->fuseUseReaddirplus.getValue(),
+      edenConfig->fuseSpliceReplies.getValue(),
+      edenConfig->fuseCloneDevicePerThread.getValue(),
+      edenConfig->fuseMaxWorkerThreads.getValue(),
+      edenConfig->fuseWritebackCache.getValue(),
+      edenConfig->fuseThreadPlacement.getValue())};
 }
 } // namespace
 #endif
@@ -1442,7 +1858,8 @@ folly::Future<folly::Unit> EdenMount::channelMount(bool readOnly) {
                      getCheckoutConfig()->getRepoGuid());
                  channel->start(
                      readOnly,
-                     edenConfig->prjfsUseNegativePathCaching.getValue());
+                     edenConfig->prjfsUseNegativePathCaching.getValue(),
+                     edenConfig->prjfsPrefetchBudgetPerProcess.getValue());
                  return channel;
                })
             .thenTry([this, mountPromise](
@@ -1501,13 +1918,20 @@ folly::Future<folly::Unit> EdenMount::channelMount(bool readOnly) {
                 channel->initialize(
                     makeNfsSocket(std::move(unixSocketPath)), false);
 
+                uint32_t attrCacheMax = folly::to_narrow(
+                    std::chrono::duration_cast<std::chrono::seconds>(
+                        serverState_->getEdenConfig()
+                            ->nfsAttributeCacheMax.getValue())
+                        .count());
+
                 return serverState_->getPrivHelper()
                     ->nfsMount(
                         mountPath.stringPiece(),
                         mountdAddr,
                         channel->getAddr(),
                         readOnly,
-                        iosize)
+                        iosize,
+                        attrCacheMax)
                     .thenTry([this,
                               mountPromise = std::move(mountPromise),
                               channel = std::move(channel)](
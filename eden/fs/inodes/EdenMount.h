@@ -23,10 +23,13 @@
 #include <stdexcept>
 #include "eden/fs/config/CheckoutConfig.h"
 #include "eden/fs/inodes/CacheHint.h"
+#include "eden/fs/inodes/GitIgnoreCache.h"
 #include "eden/fs/inodes/InodeNumber.h"
+#include "eden/fs/inodes/InodePathCache.h"
 #include "eden/fs/inodes/InodePtrFwd.h"
 #include "eden/fs/inodes/InodeTimestamps.h"
 #include "eden/fs/inodes/Overlay.h"
+#include "eden/fs/inodes/SiblingLookupPredictor.h"
 #include "eden/fs/journal/Journal.h"
 #include "eden/fs/model/RootId.h"
 #include "eden/fs/service/gen-cpp2/eden_types.h"
@@ -66,6 +69,7 @@ class BindMount;
 class BlobCache;
 class CheckoutConfig;
 class CheckoutConflict;
+class CheckoutContext;
 class Clock;
 class DiffContext;
 class EdenConfig;
@@ -117,7 +121,21 @@ enum class CounterName {
   /**
    * Represents the maximum deltas iterated over in the Journal's forEachDelta
    */
-  JOURNAL_MAX_FILES_ACCUMULATED
+  JOURNAL_MAX_FILES_ACCUMULATED,
+  /**
+   * Represents the number of invalidation notifications sent to FUSE
+   */
+  FUSE_INVALIDATIONS_SENT,
+  /**
+   * Represents the number of redundant FUSE invalidations that were merged
+   * into another invalidation instead of being sent
+   */
+  FUSE_INVALIDATIONS_COALESCED,
+  /**
+   * Represents the number of forgotten trees waiting for their overlay data
+   * to be removed
+   */
+  OVERLAY_GC_QUEUE_DEPTH
 };
 
 /**
@@ -194,10 +212,13 @@ class EdenMount : public std::enable_shared_from_this<EdenMount> {
    * Asynchronous EdenMount initialization - post instantiation.
    *
    * If takeover data is specified, it is used to initialize the inode map.
+   * A takeover snapshot is given to the inode map, which reads its entries as
+   * they are needed.
    */
   FOLLY_NODISCARD folly::Future<folly::Unit> initialize(
       OverlayChecker::ProgressCallback&& progressCallback = [](auto) {},
-      const std::optional<SerializedInodeMap>& takeover = std::nullopt);
+      const std::optional<SerializedInodeMap>& takeover = std::nullopt,
+      std::shared_ptr<const InodeMapSnapshot> takeoverSnapshot = nullptr);
 
   /**
    * Destroy the EdenMount.
@@ -442,6 +463,9 @@ class EdenMount : public std::enable_shared_from_this<EdenMount> {
    * This may also fail with other exceptions if something else goes wrong
    * besides the path being invalid (for instance, an error loading data from
    * the ObjectStore).
+   *
+   * Paths looked up before are served from the InodePathCache while their
+   * inode is still loaded.
    */
   folly::Future<InodePtr> getInode(
       RelativePathPiece path,
@@ -522,6 +546,12 @@ class EdenMount : public std::enable_shared_from_this<EdenMount> {
    *     and is used to check if the request is still active, because if the
    *     request is no longer active we will cancel this diff operation.
    *
+   * If experimental:scm-status-cache-max-age is set, the result of the last
+   * diff against the same commit is reused: only the paths the journal
+   * recorded a change to since are diffed again. A full diff is done when
+   * the journal was truncated, the commit changed, or a .gitignore file
+   * changed.
+   *
    * @return Returns a folly::Future that will be fulfilled when the diff
    *     operation is complete.  This is marked FOLLY_NODISCARD to
    *     make sure callers do not forget to wait for the operation to complete.
@@ -553,6 +583,12 @@ class EdenMount : public std::enable_shared_from_this<EdenMount> {
    */
   RenameLock acquireRenameLock();
 
+  /**
+   * Acquire the rename lock in exclusive mode if it is not held, otherwise
+   * return a RenameLock that doesn't own it.
+   */
+  RenameLock tryAcquireRenameLock();
+
   /**
    * Acquire the rename lock in shared mode.
    */
@@ -698,6 +734,29 @@ class EdenMount : public std::enable_shared_from_this<EdenMount> {
       TreeInodePtr treeInode,
       ObjectFetchContext& context);
 
+  /**
+   * Tracks the lookups made in this mount to predict which ones are about to
+   * come. See TreeInode::predictSiblingLookups().
+   */
+  SiblingLookupPredictor& getSiblingLookupPredictor() {
+    return siblingLookupPredictor_;
+  }
+
+  /**
+   * The inodes getInode() resolved paths to. Inodes invalidate it when they
+   * are renamed or unlinked.
+   */
+  InodePathCache& getInodePathCache() const {
+    return inodePathCache_;
+  }
+
+  /**
+   * The .gitignore files parsed by the previous diffs of this mount.
+   */
+  GitIgnoreCache& getGitIgnoreCache() const {
+    return gitIgnoreCache_;
+  }
+
   /**
    * Get a weak_ptr to this EdenMount object. EdenMounts are stored as shared
    * pointers inside of EdenServer's MountList.
@@ -772,6 +831,44 @@ class EdenMount : public std::enable_shared_from_this<EdenMount> {
    */
   Overlay::OverlayType getOverlayType();
 
+  /**
+   * Returns the sizes of the overlay's caches based on settings.
+   */
+  Overlay::CacheSizes getOverlayCacheSizes();
+
+  /**
+   * When the FUSE channel uses the kernel's writeback cache, make the kernel
+   * send us every write it is still buffering, so that checkout sees the same
+   * file contents as the processes that wrote them.
+   *
+   * This is a no-op for other channels and when the writeback cache is off.
+   */
+  folly::Future<folly::Unit> flushKernelWritebackCache();
+
+  /**
+   * ProjectedFS notifies EdenFS of changes to the working copy asynchronously,
+   * wait for the notifications received so far to be applied to the inode
+   * tree so that status and checkout observe all of them.
+   *
+   * This is a no-op for the other channels.
+   */
+  folly::Future<folly::Unit> waitForPendingNotifications() const;
+
+  /**
+   * Start fetching the trees that differ between the two commits of a
+   * checkout, up to checkout-prefetch-tree-batch-size at a time and down to
+   * checkout-prefetch-tree-max-depth, so that more of the checkout of the
+   * inodes runs from local data. The prefetch runs in the background and
+   * stops once the checkout completes.
+   *
+   * This is a no-op when checkout-prefetch-tree-batch-size is 0. Fetch
+   * errors are ignored, as the checkout fetches these trees again.
+   */
+  void startCheckoutTreePrefetch(
+      const std::shared_ptr<CheckoutContext>& ctx,
+      const Tree& fromTree,
+      const Tree& toTree);
+
   EdenMount(
       std::unique_ptr<CheckoutConfig> checkoutConfig,
       std::shared_ptr<ObjectStore> objectStore,
@@ -789,6 +886,41 @@ class EdenMount : public std::enable_shared_from_this<EdenMount> {
 
   folly::SemiFuture<SerializedInodeMap> shutdownImpl(bool doTakeover);
 
+  /**
+   * A status computed by diff(), along with what it was computed against.
+   * computedAt is the time of the full diff the status was last derived
+   * from.
+   */
+  struct CachedScmStatus {
+    RootId commitHash;
+    bool listIgnored;
+    Journal::SequenceNumber sequenceNumber;
+    std::chrono::steady_clock::time_point computedAt;
+    std::shared_ptr<const ScmStatus> status;
+  };
+
+  /**
+   * Returns the status cached by diff() if it was computed against
+   * commitHash, with the same listIgnored value, and not before
+   * computedAfter, and if enforceCurrentParent is set, commitHash is still
+   * the parent commit.  Returns std::nullopt otherwise.
+   */
+  std::optional<CachedScmStatus> getCachedScmStatus(
+      const RootId& commitHash,
+      bool listIgnored,
+      bool enforceCurrentParent,
+      std::chrono::steady_clock::time_point computedAfter) const;
+
+  /**
+   * Returns the paths the journal recorded a change to after
+   * sequenceNumber, or std::nullopt if a status computed at sequenceNumber
+   * can't be updated from them: the journal was truncated, the commit
+   * changed, or an ignore file changed, which may change the status of
+   * other paths.
+   */
+  std::optional<std::vector<RelativePath>> getScmStatusChanges(
+      Journal::SequenceNumber sequenceNumber) const;
+
   /**
    * Create a DiffContext to be passed through the TreeInode diff codepath. This
    * will be used to record differences through the callback (in which
@@ -807,14 +939,16 @@ class EdenMount : public std::enable_shared_from_this<EdenMount> {
    * Note that the callback methods may be invoked simultaneously from multiple
    * different threads, and the callback is responsible for performing
    * synchronization (if it is needed). It will be packaged into a DiffContext
-   * and passed through the TreeInode diff() codepath
+   * and passed through the TreeInode diff() codepath. A non-empty scope
+   * restricts the diff to these paths, see DiffScope.
    */
   FOLLY_NODISCARD folly::Future<folly::Unit> diff(
       DiffCallback* callback,
       const RootId& commitHash,
       bool listIgnored,
       bool enforceCurrentParent,
-      apache::thrift::ResponseChannelRequest* FOLLY_NULLABLE request) const;
+      apache::thrift::ResponseChannelRequest* FOLLY_NULLABLE request,
+      const std::vector<RelativePath>& scope = {}) const;
 
   /**
    * Signal to unmount() that fuseMount() or takeoverFuse() has started.
@@ -908,6 +1042,11 @@ class EdenMount : public std::enable_shared_from_this<EdenMount> {
    * This includes rename() operations as well as unlink() and rmdir().
    * Any operation that modifies an existing InodeBase's location_ data must
    * hold the rename lock.
+   *
+   * Renaming a file within a single directory only changes that directory,
+   * so it holds the rename lock in shared mode and relies on the directory's
+   * contents lock instead.  Such renames in different directories proceed
+   * concurrently, while checkout and all other renames still exclude them.
    */
   folly::SharedMutex renameMutex_;
 
@@ -919,9 +1058,16 @@ class EdenMount : public std::enable_shared_from_this<EdenMount> {
   std::unique_ptr<Journal> journal_;
   folly::Synchronized<std::unique_ptr<IActivityRecorder>> activityRecorder_;
 
+  /**
+   * The last status computed by diff().  The next diff() calls start from it
+   * and only diff the paths changed since.
+   */
+  folly::Synchronized<std::optional<CachedScmStatus>> cachedScmStatus_;
+
   /**
    * A number to uniquely identify this particular incarnation of this mount.
-   * We use bits from the process id and the time at which we were mounted.
+   * We use bits from the process id and the time at which we were mounted,
+   * unless the journal was restored with the generation of its positions.
    */
   const uint64_t mountGeneration_;
 
@@ -1006,6 +1152,14 @@ class EdenMount : public std::enable_shared_from_this<EdenMount> {
    */
   std::atomic<uint64_t> numPrefetchesInProgress_{0};
 
+  SiblingLookupPredictor siblingLookupPredictor_;
+
+  // Internally synchronized, and updated by the const getInode().
+  mutable InodePathCache inodePathCache_;
+
+  // Internally synchronized, and updated by the const diff() methods.
+  mutable GitIgnoreCache gitIgnoreCache_;
+
 #ifdef _WIN32
   /**
    * This is the channel between ProjectedFS and rest of Eden.
@@ -1041,6 +1195,10 @@ class RenameLock : public std::unique_lock<folly::SharedMutex> {
   RenameLock() {}
   explicit RenameLock(EdenMount* mount)
       : std::unique_lock<folly::SharedMutex>{mount->renameMutex_} {}
+  RenameLock(EdenMount* mount, std::try_to_lock_t)
+      : std::unique_lock<folly::SharedMutex>{
+            mount->renameMutex_,
+            std::try_to_lock} {}
 
   bool isHeld(EdenMount* mount) const {
     return owns_lock() && (mutex() == &mount->renameMutex_);
@@ -1052,6 +1210,7 @@ class RenameLock : public std::unique_lock<folly::SharedMutex> {
  */
 class SharedRenameLock : public std::shared_lock<folly::SharedMutex> {
  public:
+  SharedRenameLock() {}
   explicit SharedRenameLock(EdenMount* mount)
       : std::shared_lock<folly::SharedMutex>{mount->renameMutex_} {}
 
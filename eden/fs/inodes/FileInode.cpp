@@ -636,6 +636,18 @@ std::optional<Hash> FileInode::getBlobHash() const {
   }
 }
 
+size_t FileInode::estimateMemoryUsage() const {
+  auto state = state_.rlock();
+  auto bytes = sizeof(FileInode);
+  if (state->blobLoadingPromise) {
+    bytes += sizeof(*state->blobLoadingPromise);
+  }
+#ifndef _WIN32
+  bytes += state->readByteRanges.estimateIndirectMemoryUsage();
+#endif
+  return bytes;
+}
+
 void FileInode::materializeInParent() {
   auto renameLock = getMount()->acquireRenameLock();
   auto loc = getLocationInfo(renameLock);
@@ -692,7 +704,14 @@ Future<Hash> FileInode::getSha1(ObjectFetchContext& fetchContext) {
       return folly::makeFutureWith(
           [this] { return getFileSha1(getMaterializedFilePath()); });
 #else
-      return getOverlayFileAccess(state)->getSha1(*this);
+    {
+      auto overlayFileAccess = getOverlayFileAccess(state);
+      auto sha1 = overlayFileAccess->getSha1(*this);
+      // The state lock keeps the file from being written while its storage
+      // is shared.
+      overlayFileAccess->dedupe(*this);
+      return sha1;
+    }
 #endif // _WIN32
   }
 
@@ -773,11 +792,12 @@ void FileInode::updateBlockCount(FOLLY_MAYBE_UNUSED struct stat& st) {
 }
 
 #ifndef _WIN32
-void FileInode::fsync(bool datasync) {
+ImmediateFuture<folly::Unit> FileInode::fsync(bool datasync) {
   auto state = LockedState{this};
   if (state->isMaterialized()) {
-    getOverlayFileAccess(state)->fsync(*this, datasync);
+    return getOverlayFileAccess(state)->fsyncAsync(*this, datasync);
   }
+  return folly::unit;
 }
 
 folly::Future<folly::Unit> FileInode::fallocate(
@@ -860,24 +880,62 @@ void FileInode::materialize() {
 }
 #else
 
+bool FileInode::shouldReadBlobRange(LockedState& state) {
+  // Below this size, loading the whole blob on the first read is cheaper than
+  // fetching it one range at a time.
+  constexpr uint64_t kMinimumRangedReadSize = 64 * 1024 * 1024;
+
+  if (state->tag != State::BLOB_NOT_LOADING ||
+      !getObjectStore()->supportsBlobRanges()) {
+    return false;
+  }
+  auto blobSize = state->nonMaterializedState->size;
+  if (blobSize == FileInodeState::NonMaterializedState::kUnknownSize ||
+      blobSize < kMinimumRangedReadSize) {
+    return false;
+  }
+  return !state.getCachedBlob(getMount(), BlobCache::Interest::WantHandle);
+}
+
 Future<BufVec>
 FileInode::read(size_t size, off_t off, ObjectFetchContext& context) {
   XDCHECK_GE(off, 0);
+  auto state = LockedState{this};
+  if (shouldReadBlobRange(state)) {
+    // The range is read without holding the lock, which is no different from
+    // a read racing with a write.
+    auto hash = state->nonMaterializedState->hash;
+    state.unlock();
+    return getObjectStore()
+        ->getBlobRange(hash, off, size, context)
+        .thenValue([self = inodePtrFromThis()](
+                       std::unique_ptr<folly::IOBuf> buf) {
+          self->updateAtime();
+          return BufVec{std::move(buf)};
+        });
+  }
+
   return runWhileDataLoaded<Future<BufVec>>(
-      LockedState{this},
+      std::move(state),
       BlobCache::Interest::WantHandle,
       // This function is only called by FUSE.
       context,
       nullptr,
       [size, off, self = inodePtrFromThis()](
-          LockedState&& state, std::shared_ptr<const Blob> blob) -> BufVec {
+          LockedState&& state,
+          std::shared_ptr<const Blob> blob) -> Future<BufVec> {
         SCOPE_SUCCESS {
           self->updateAtimeLocked(*state);
         };
 
-        // Materialized either before or during blob load.
+        // Materialized either before or during blob load. The overlay file
+        // may be read after the state lock is released, which is no different
+        // from a read racing with a write.
         if (state->tag == State::MATERIALIZED_IN_OVERLAY) {
-          return self->getOverlayFileAccess(state)->read(*self, size, off);
+          return self->getOverlayFileAccess(state)
+              ->readAsync(*self, size, off)
+              .semi()
+              .toUnsafeFuture();
         }
 
         // runWhileDataLoaded() ensures that the state is either
@@ -968,6 +1026,302 @@ folly::Future<size_t> FileInode::write(
       },
       fetchContext);
 }
+
+namespace {
+/**
+ * The largest amount of data copied by a single copyFileRange() call that
+ * actually moves data. Callers of copy_file_range(2) loop on short copies,
+ * and capping the chunk bounds both the memory used when copying through
+ * memory and how long the state locks of both inodes are held during an
+ * in-kernel copy. Sharing a blob copies nothing and is not capped.
+ */
+constexpr size_t kMaxCopyFileRangeChunk = 1024 * 1024;
+} // namespace
+
+folly::Future<size_t> FileInode::copyFileRange(
+    off_t offIn,
+    FileInodePtr destination,
+    off_t offOut,
+    size_t length,
+    ObjectFetchContext& fetchContext) {
+  if (destination.get() == this) {
+    return copyFileRangeThroughMemory(
+        offIn,
+        std::move(destination),
+        offOut,
+        std::min(length, kMaxCopyFileRangeChunk),
+        fetchContext);
+  }
+
+  auto state = LockedState{this};
+  if (state->isMaterialized()) {
+    state.unlock();
+    // Materialize the destination first, since it can't be done while holding
+    // the state lock of the source.
+    return destination
+        ->runWhileMaterialized(
+            LockedState{destination},
+            nullptr,
+            [](LockedState&&) {},
+            fetchContext)
+        .thenValue([self = inodePtrFromThis(),
+                    offIn,
+                    destination,
+                    offOut,
+                    length,
+                    &fetchContext](folly::Unit) -> folly::Future<size_t> {
+          auto chunk = std::min(length, kMaxCopyFileRangeChunk);
+          if (auto copied = self->copyMaterializedRange(
+                  offIn, *destination, offOut, chunk)) {
+            return *copied;
+          }
+          // One of the files changed state while unlocked.
+          return self->copyFileRangeThroughMemory(
+              offIn, destination, offOut, chunk, fetchContext);
+        });
+  }
+
+  auto blobHash = state->nonMaterializedState->hash;
+  state.unlock();
+  return getObjectStore()
+      ->getBlobSize(blobHash, fetchContext)
+      .thenValue([self = inodePtrFromThis(),
+                  blobHash,
+                  offIn,
+                  destination = std::move(destination),
+                  offOut,
+                  length,
+                  &fetchContext](uint64_t blobSize) -> folly::Future<size_t> {
+        // Copying all of a blob over the start of a file that is no larger
+        // than the blob leaves the destination with exactly the blob's
+        // contents, so it can share the blob rather than copy it. This is the
+        // common case for `cp --reflink=auto`. This is checked against the
+        // full requested length, since sharing the blob needs no chunking.
+        if (offIn == 0 && offOut == 0 && length >= blobSize &&
+            destination->replaceContentsWithBlob(blobHash, blobSize)) {
+          return blobSize;
+        }
+        return self->copyFileRangeThroughMemory(
+            offIn,
+            destination,
+            offOut,
+            std::min(length, kMaxCopyFileRangeChunk),
+            fetchContext);
+      });
+}
+
+folly::Future<size_t> FileInode::copyFileRangeThroughMemory(
+    off_t offIn,
+    FileInodePtr destination,
+    off_t offOut,
+    size_t length,
+    ObjectFetchContext& fetchContext) {
+  return read(length, offIn, fetchContext)
+      .thenValue([destination = std::move(destination), offOut, &fetchContext](
+                     BufVec&& buf) -> folly::Future<size_t> {
+        // Don't materialize the destination just to write nothing into it.
+        if (buf->computeChainDataLength() == 0) {
+          return size_t{0};
+        }
+        return destination->write(std::move(buf), offOut, fetchContext);
+      });
+}
+
+std::optional<size_t> FileInode::copyMaterializedRange(
+    off_t offIn,
+    FileInode& destination,
+    off_t offOut,
+    size_t length) {
+  // Acquire both state locks in inode number order so that concurrent copies
+  // in opposite directions can't deadlock.
+  bool sourceFirst = getNodeId() < destination.getNodeId();
+  auto firstState = LockedState{sourceFirst ? this : &destination};
+  auto secondState = LockedState{sourceFirst ? &destination : this};
+  auto& sourceState = sourceFirst ? firstState : secondState;
+  auto& destState = sourceFirst ? secondState : firstState;
+  if (!sourceState->isMaterialized() || !destState->isMaterialized()) {
+    return std::nullopt;
+  }
+
+  auto copied = getOverlayFileAccess(sourceState)
+                    ->copyFileRange(*this, offIn, destination, offOut, length);
+
+  updateAtimeLocked(*sourceState);
+  if (copied > 0) {
+    destination.updateMtimeAndCtimeLocked(*destState, getNow());
+  }
+  secondState.unlock();
+  firstState.unlock();
+
+  if (copied > 0) {
+    destination.updateJournal();
+  }
+  return copied;
+}
+
+bool FileInode::replaceContentsWithBlob(
+    const Hash& blobHash,
+    uint64_t blobSize) {
+  // Hold the rename lock across both the state change and the parent update,
+  // so that a concurrent write can't materialize this file again and update
+  // the parent before we have recorded the dematerialization.
+  auto renameLock = getMount()->acquireRenameLock();
+  auto state = LockedState{this};
+
+  uint64_t currentSize;
+  switch (state->tag) {
+    case State::BLOB_LOADING:
+      // The pending load is for the current blob.
+      return false;
+    case State::BLOB_NOT_LOADING:
+      currentSize = state->nonMaterializedState->size;
+      if (currentSize == FileInodeState::NonMaterializedState::kUnknownSize) {
+        return false;
+      }
+      break;
+    case State::MATERIALIZED_IN_OVERLAY:
+      currentSize = getOverlayFileAccess(state)->getFileSize(*this);
+      break;
+  }
+  if (currentSize > blobSize) {
+    // Data past the end of the blob would remain after the copy.
+    return false;
+  }
+
+  if (state->isMaterialized()) {
+    // The overlay file is left in place until the inode is removed, and is
+    // replaced if the inode is materialized again.
+    getOverlayFileAccess(state)->forgetFile(getNodeId());
+  }
+  state->tag = State::BLOB_NOT_LOADING;
+  state->nonMaterializedState.emplace(blobHash);
+  state->nonMaterializedState->size = blobSize;
+  state->interestHandle.reset();
+  state->readByteRanges.clear();
+  updateMtimeAndCtimeLocked(*state, getNow());
+  state.unlock();
+
+  auto loc = getLocationInfo(renameLock);
+  if (loc.parent && !loc.unlinked) {
+    loc.parent->childDematerialized(renameLock, loc.name, blobHash);
+  }
+  updateJournal();
+  return true;
+}
+
+bool FileInode::dematerializeIfSameAs(const Hash& blobHash, const Hash& sha1) {
+  // Read and hash the file without holding any lock: that caches its SHA-1,
+  // which a concurrent write clears, so only the cached value is compared
+  // under the locks.
+  folly::Function<Hash()> computeSha1;
+  {
+    auto state = LockedState{this};
+    if (!state->isMaterialized()) {
+      return false;
+    }
+    computeSha1 = getOverlayFileAccess(state)->prepareSha1(*this);
+  }
+  if (computeSha1() != sha1) {
+    return false;
+  }
+
+  // Don't wait for a checkout, which holds the rename lock for a long time:
+  // the file will be dematerialized by a later diff.
+  auto renameLock = getMount()->tryAcquireRenameLock();
+  if (!renameLock.owns_lock()) {
+    return false;
+  }
+  return replaceIfSameAs(
+      renameLock, blobHash, sha1, /*hashMaterialized=*/false);
+}
+
+bool FileInode::checkoutIfSameAs(
+    const RenameLock& renameLock,
+    const Hash& blobHash,
+    const Hash& sha1) {
+  return replaceIfSameAs(renameLock, blobHash, sha1, /*hashMaterialized=*/true);
+}
+
+bool FileInode::replaceIfSameAs(
+    const RenameLock& renameLock,
+    const Hash& blobHash,
+    const Hash& sha1,
+    bool hashMaterialized) {
+  auto state = LockedState{this};
+  uint64_t size;
+  switch (state->tag) {
+    case State::BLOB_LOADING:
+      return false;
+    case State::BLOB_NOT_LOADING:
+      // Its contents cannot have changed without materializing it.
+      if (state->nonMaterializedState->hash == blobHash) {
+        return true;
+      }
+      if (!hashMaterialized) {
+        // It was replaced since it was hashed.
+        return false;
+      }
+      size = state->nonMaterializedState->size;
+      break;
+    case State::MATERIALIZED_IN_OVERLAY: {
+      // The contents may have been written to since they were compared.
+      auto overlayFileAccess = getOverlayFileAccess(state);
+      auto currentSha1 = hashMaterialized
+          ? std::optional<Hash>{overlayFileAccess->getSha1(*this)}
+          : overlayFileAccess->getCachedSha1(*this);
+      if (currentSha1 != sha1) {
+        return false;
+      }
+      size = overlayFileAccess->getFileSize(*this);
+      break;
+    }
+  }
+
+  if (state->isMaterialized()) {
+    // The overlay file is left in place until the inode is removed, and is
+    // replaced if the inode is materialized again.
+    getOverlayFileAccess(state)->forgetFile(getNodeId());
+  }
+  state->tag = State::BLOB_NOT_LOADING;
+  state->nonMaterializedState.emplace(blobHash);
+  state->nonMaterializedState->size = size;
+  state->interestHandle.reset();
+  state->readByteRanges.clear();
+  state.unlock();
+
+  auto loc = getLocationInfo(renameLock);
+  if (loc.parent && !loc.unlinked) {
+    loc.parent->childDematerialized(renameLock, loc.name, blobHash);
+  }
+  return true;
+}
+
+ImmediateFuture<off_t> FileInode::seekDataOrHole(
+    off_t offset,
+    int whence,
+    ObjectFetchContext& fetchContext) {
+  if (whence != SEEK_DATA && whence != SEEK_HOLE) {
+    throw InodeError(EINVAL, inodePtrFromThis(), "unsupported lseek whence");
+  }
+
+  {
+    auto state = LockedState{this};
+    if (state->isMaterialized()) {
+      return getOverlayFileAccess(state)->seek(*this, offset, whence);
+    }
+  }
+
+  // Source control blobs have no holes: the data runs up to the end of the
+  // file, where there is the implicit hole.
+  return stat(fetchContext)
+      .thenValue([self = inodePtrFromThis(), offset, whence](
+                     struct stat st) -> off_t {
+        if (offset < 0 || offset >= st.st_size) {
+          throw InodeError(ENXIO, self, "lseek offset past end of file");
+        }
+        return whence == SEEK_DATA ? offset : st.st_size;
+      });
+}
 #endif
 
 Future<std::shared_ptr<const Blob>> FileInode::startLoadingData(
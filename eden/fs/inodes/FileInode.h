@@ -200,6 +200,35 @@ class FileInode final : public InodeBaseMetadata<FileInodeState> {
       TreeEntryType entryType,
       ObjectFetchContext& fetchContext);
 
+#ifndef _WIN32
+  /**
+   * Dematerialize this file if its contents are those of the blob, so that
+   * a file that was edited and then reverted goes back to being served from
+   * the object store. sha1 is the SHA-1 of the blob's contents.
+   *
+   * Returns false, leaving the file unchanged, if it is not materialized, if
+   * its contents differ, if they are written to while being hashed, or if
+   * the rename lock is held by a concurrent checkout or rename. The
+   * timestamps are left unchanged, since the file contents are.
+   */
+  bool dematerializeIfSameAs(const Hash& blobHash, const Hash& sha1);
+
+  /**
+   * Point this file at blobHash, whose contents have the SHA-1 sha1, so that
+   * a checkout to a commit that already has the file's contents need not
+   * replace it. A materialized file is dematerialized if its contents are
+   * still those of the blob. The caller must hold the rename lock and must
+   * have compared the contents of a non-materialized file.
+   *
+   * Returns false, leaving the file unchanged, if its contents differ or if
+   * its current blob is being loaded.
+   */
+  bool checkoutIfSameAs(
+      const RenameLock& renameLock,
+      const Hash& blobHash,
+      const Hash& sha1);
+#endif // !_WIN32
+
   /**
    * Get the file mode_t value.
    */
@@ -236,6 +265,12 @@ class FileInode final : public InodeBaseMetadata<FileInodeState> {
    */
   std::optional<Hash> getBlobHash() const;
 
+  /**
+   * Estimate the memory used by this FileInode and its state. A loaded blob
+   * is accounted for by the BlobCache rather than here.
+   */
+  size_t estimateMemoryUsage() const;
+
   /**
    * Read the entire file contents, and return them as a string.
    *
@@ -270,11 +305,37 @@ class FileInode final : public InodeBaseMetadata<FileInodeState> {
   folly::Future<size_t>
   write(folly::StringPiece data, off_t off, ObjectFetchContext& fetchContext);
 
-  void fsync(bool datasync);
+  FOLLY_NODISCARD ImmediateFuture<folly::Unit> fsync(bool datasync);
 
   FOLLY_NODISCARD folly::Future<folly::Unit>
   fallocate(uint64_t offset, uint64_t length, ObjectFetchContext& fetchContext);
 
+  /**
+   * Copy up to length bytes at offset offIn of this file to offset offOut of
+   * destination, like copy_file_range(2). Returns the number of bytes copied,
+   * which may be fewer than requested, and is 0 at the end of this file.
+   *
+   * If this file is not materialized and the copy replaces all of
+   * destination's contents, destination is simply pointed at this file's blob
+   * and no data is copied. If both files are materialized the data is copied
+   * between the overlay files in the kernel.
+   */
+  FOLLY_NODISCARD folly::Future<size_t> copyFileRange(
+      off_t offIn,
+      FileInodePtr destination,
+      off_t offOut,
+      size_t length,
+      ObjectFetchContext& fetchContext);
+
+  /**
+   * Find the next data (SEEK_DATA) or hole (SEEK_HOLE) at or after offset,
+   * like lseek(2).
+   *
+   * Throws ENXIO if offset is at or past the end of the file.
+   */
+  FOLLY_NODISCARD ImmediateFuture<off_t>
+  seekDataOrHole(off_t offset, int whence, ObjectFetchContext& fetchContext);
+
 #endif // !_WIN32
 
   ImmediateFuture<struct stat> stat(ObjectFetchContext& context) override;
@@ -304,6 +365,13 @@ class FileInode final : public InodeBaseMetadata<FileInodeState> {
       Fn&& fn);
 
 #ifndef _WIN32
+  /**
+   * Whether read() should fetch only the requested range: the file is a
+   * large, unmaterialized blob, missing from the BlobCache, and the backing
+   * store can fetch part of it.
+   */
+  bool shouldReadBlobRange(LockedState& state);
+
   /**
    * Run a function with the FileInode materialized.
    *
@@ -334,6 +402,18 @@ class FileInode final : public InodeBaseMetadata<FileInodeState> {
       LockedState state,
       Fn&& fn);
 
+  /**
+   * Implements checkoutIfSameAs and dematerializeIfSameAs. Unless
+   * hashMaterialized is set, a materialized file is compared using its
+   * cached SHA-1 only, so that it is never read with the locks held, and a
+   * file that is no longer materialized is left unchanged.
+   */
+  bool replaceIfSameAs(
+      const RenameLock& renameLock,
+      const Hash& blobHash,
+      const Hash& sha1,
+      bool hashMaterialized);
+
 #endif // !_WIN32
 
   /**
@@ -446,6 +526,36 @@ class FileInode final : public InodeBaseMetadata<FileInodeState> {
       const struct iovec* iov,
       size_t numIovecs,
       off_t off);
+
+  /**
+   * copyFileRange() by reading the data and writing it into destination.
+   */
+  folly::Future<size_t> copyFileRangeThroughMemory(
+      off_t offIn,
+      FileInodePtr destination,
+      off_t offOut,
+      size_t length,
+      ObjectFetchContext& fetchContext);
+
+  /**
+   * copyFileRange() between two materialized overlay files. Returns
+   * std::nullopt if either file is not materialized.
+   */
+  std::optional<size_t> copyMaterializedRange(
+      off_t offIn,
+      FileInode& destination,
+      off_t offOut,
+      size_t length);
+
+  /**
+   * Replace this file's contents with the given blob, dematerializing it,
+   * provided the blob is at least as large as the current contents.
+   *
+   * Returns false, leaving the file unchanged, if the file is larger than the
+   * blob or is currently loading.
+   */
+  bool replaceContentsWithBlob(const Hash& blobHash, uint64_t blobSize);
+
 #endif // !_WIN32
 
   /**
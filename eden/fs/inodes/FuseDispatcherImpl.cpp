@@ -31,15 +31,17 @@ namespace {
 /** Compute a fuse_entry_out */
 fuse_entry_out computeEntryParam(const FuseDispatcher::Attr& attr) {
   XDCHECK(attr.st.st_ino) << "We should never return a 0 inode to FUSE";
+  return attr.asFuseEntry();
+}
+
+/**
+ * A successful response with an inode number of 0 and a large entry_valid
+ * time, to let the kernel cache this negative lookup result.
+ */
+fuse_entry_out negativeEntryParam() {
   fuse_entry_out entry = {};
-  entry.nodeid = attr.st.st_ino;
-  entry.generation = 0;
-  auto fuse_attr = attr.asFuseAttr();
-  entry.attr = fuse_attr.attr;
-  entry.attr_valid = fuse_attr.attr_valid;
-  entry.attr_valid_nsec = fuse_attr.attr_valid_nsec;
-  entry.entry_valid = fuse_attr.attr_valid;
-  entry.entry_valid_nsec = fuse_attr.attr_valid_nsec;
+  entry.attr_valid = std::numeric_limits<decltype(entry.attr_valid)>::max();
+  entry.entry_valid = std::numeric_limits<decltype(entry.entry_valid)>::max();
   return entry;
 }
 
@@ -97,9 +99,13 @@ ImmediateFuture<fuse_entry_out> FuseDispatcherImpl::lookup(
   return inodeMap_->lookupTreeInode(parent)
       .thenValue([name = PathComponent(namepiece),
                   &context](const TreeInodePtr& tree) {
-        return tree->getOrLoadChild(name, context).semi();
+        return tree->getOrLoadChildIfExists(name, context).semi();
       })
-      .thenValue([&context](const InodePtr& inode) {
+      .thenValue([&context](
+                     const InodePtr& inode) -> ImmediateFuture<fuse_entry_out> {
+        if (!inode) {
+          return negativeEntryParam();
+        }
         return makeImmediateFutureWith([&]() { return inode->stat(context); })
             .thenTry([inode](folly::Try<struct stat> maybeStat) {
               if (maybeStat.hasValue()) {
@@ -133,15 +139,7 @@ ImmediateFuture<fuse_entry_out> FuseDispatcherImpl::lookup(
       .thenTry([](folly::Try<fuse_entry_out> try_) {
         if (auto* err = try_.tryGetExceptionObject<std::system_error>()) {
           if (isEnoent(*err)) {
-            // Translate ENOENT into a successful response with an
-            // inode number of 0 and a large entry_valid time, to let the kernel
-            // cache this negative lookup result.
-            fuse_entry_out entry = {};
-            entry.attr_valid =
-                std::numeric_limits<decltype(entry.attr_valid)>::max();
-            entry.entry_valid =
-                std::numeric_limits<decltype(entry.entry_valid)>::max();
-            return folly::Try<fuse_entry_out>{entry};
+            return folly::Try<fuse_entry_out>{negativeEntryParam()};
           }
         }
         return try_;
@@ -210,6 +208,12 @@ void FuseDispatcherImpl::forget(InodeNumber ino, unsigned long nlookup) {
 ImmediateFuture<uint64_t> FuseDispatcherImpl::open(
     InodeNumber /*ino*/,
     int /*flags*/) {
+  // FUSE passthrough (registering the overlay file as a backing fd so the
+  // kernel services I/O directly) is not usable for materialized files: every
+  // overlay file begins with a FsOverlay::kHeaderLength byte header, while
+  // passthrough maps file offsets onto the backing file one-to-one. Writes
+  // that bypass FileInode would also skip the journal and leave the cached
+  // size and SHA-1 in OverlayFileAccess stale.
 #ifdef FUSE_NO_OPEN_SUPPORT
   if (getConnInfo().flags & FUSE_NO_OPEN_SUPPORT) {
     // If the kernel understands FUSE_NO_OPEN_SUPPORT, then returning ENOSYS
@@ -283,6 +287,38 @@ ImmediateFuture<folly::Unit> FuseDispatcherImpl::fallocate(
       });
 }
 
+ImmediateFuture<size_t> FuseDispatcherImpl::copyFileRange(
+    InodeNumber inoIn,
+    off_t offIn,
+    InodeNumber inoOut,
+    off_t offOut,
+    size_t length,
+    ObjectFetchContext& context) {
+  return inodeMap_->lookupFileInode(inoIn).thenValue(
+      [inodeMap = inodeMap_, inoOut, offIn, offOut, length, &context](
+          FileInodePtr source) {
+        return inodeMap->lookupFileInode(inoOut).thenValue(
+            [source = std::move(source), offIn, offOut, length, &context](
+                FileInodePtr destination) {
+              return source
+                  ->copyFileRange(
+                      offIn, std::move(destination), offOut, length, context)
+                  .semi();
+            });
+      });
+}
+
+ImmediateFuture<off_t> FuseDispatcherImpl::lseek(
+    InodeNumber ino,
+    off_t offset,
+    int whence,
+    ObjectFetchContext& context) {
+  return inodeMap_->lookupFileInode(ino).thenValue(
+      [offset, whence, &context](FileInodePtr inode) {
+        return inode->seekDataOrHole(offset, whence, context);
+      });
+}
+
 ImmediateFuture<folly::Unit> FuseDispatcherImpl::fsync(
     InodeNumber ino,
     bool datasync) {
@@ -331,6 +367,21 @@ ImmediateFuture<FuseDirList> FuseDispatcherImpl::readdir(
       });
 }
 
+#ifdef __linux__
+ImmediateFuture<FuseDirList> FuseDispatcherImpl::readdirplus(
+    InodeNumber ino,
+    FuseDirList&& dirList,
+    off_t offset,
+    uint64_t /*fh*/,
+    ObjectFetchContext& context) {
+  return inodeMap_->lookupTreeInode(ino).thenValue(
+      [dirList = std::move(dirList), offset, &context](
+          TreeInodePtr inode) mutable {
+        return inode->fuseReaddirPlus(std::move(dirList), offset, context);
+      });
+}
+#endif
+
 ImmediateFuture<fuse_entry_out> FuseDispatcherImpl::mknod(
     InodeNumber parent,
     PathComponentPiece name,
@@ -107,6 +107,18 @@ class FuseDispatcherImpl : public FuseDispatcher {
       uint64_t offset,
       uint64_t length,
       ObjectFetchContext& context) override;
+  ImmediateFuture<size_t> copyFileRange(
+      InodeNumber inoIn,
+      off_t offIn,
+      InodeNumber inoOut,
+      off_t offOut,
+      size_t length,
+      ObjectFetchContext& context) override;
+  ImmediateFuture<off_t> lseek(
+      InodeNumber ino,
+      off_t offset,
+      int whence,
+      ObjectFetchContext& context) override;
   ImmediateFuture<folly::Unit> fsync(InodeNumber ino, bool datasync) override;
   ImmediateFuture<folly::Unit> fsyncdir(InodeNumber ino, bool datasync)
       override;
@@ -117,6 +129,14 @@ class FuseDispatcherImpl : public FuseDispatcher {
       off_t offset,
       uint64_t fh,
       ObjectFetchContext& context) override;
+#ifdef __linux__
+  ImmediateFuture<FuseDirList> readdirplus(
+      InodeNumber ino,
+      FuseDirList&& dirList,
+      off_t offset,
+      uint64_t fh,
+      ObjectFetchContext& context) override;
+#endif
 
   ImmediateFuture<std::string> getxattr(
       InodeNumber ino,
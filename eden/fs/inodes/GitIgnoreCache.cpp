@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/GitIgnoreCache.h"
+
+#include <vector>
+#include "eden/fs/journal/JournalDelta.h"
+#include "eden/fs/model/git/GitIgnore.h"
+
+namespace facebook::eden {
+
+namespace {
+constexpr PathComponentPiece kIgnoreFilename{".gitignore"};
+
+bool isIgnoreFile(RelativePathPiece path) {
+  return !path.empty() && path.basename() == kIgnoreFilename;
+}
+} // namespace
+
+GitIgnoreCache::GitIgnoreCache(size_t maximumEntries)
+    : maximumEntries_{maximumEntries},
+      state_{folly::in_place, maximumEntries} {}
+
+GitIgnoreCache::Lookup GitIgnoreCache::get(
+    InodeNumber ino,
+    const std::optional<Hash>& contentHash) {
+  if (maximumEntries_ == 0) {
+    return Lookup{nullptr, 0};
+  }
+
+  auto state = state_.wlock();
+  auto it = state->entries.find(ino);
+  if (it != state->entries.end() && it->second.contentHash == contentHash) {
+    return Lookup{it->second.ignore, state->generation};
+  }
+  return Lookup{nullptr, state->generation};
+}
+
+void GitIgnoreCache::insert(
+    InodeNumber ino,
+    const std::optional<Hash>& contentHash,
+    std::shared_ptr<const GitIgnore> ignore,
+    uint64_t generation) {
+  if (maximumEntries_ == 0) {
+    return;
+  }
+
+  auto state = state_.wlock();
+  if (!contentHash && generation != state->generation) {
+    return;
+  }
+  state->entries.set(ino, Entry{contentHash, std::move(ignore)});
+}
+
+void GitIgnoreCache::processJournal(Journal& journal) {
+  if (maximumEntries_ == 0) {
+    return;
+  }
+
+  auto state = state_.wlock();
+  if (!state->lastSequence) {
+    // Nothing can be cached before the first diff.
+    auto latest = journal.getLatest();
+    state->lastSequence = latest ? latest->sequenceID : 0;
+    return;
+  }
+
+  auto range = journal.accumulateRange(*state->lastSequence + 1);
+  if (!range) {
+    return;
+  }
+  state->lastSequence = range->toSequence;
+
+  // A truncated range may have lost changes to the ignore files, and a
+  // checkout may have replaced them.
+  bool ignoreFileChanged =
+      range->isTruncated || range->snapshotTransitions.size() > 1;
+  for (const auto& entry : range->changedFilesInOverlay) {
+    if (ignoreFileChanged) {
+      break;
+    }
+    ignoreFileChanged = isIgnoreFile(entry.first);
+  }
+  for (const auto& path : range->uncleanPaths) {
+    if (ignoreFileChanged) {
+      break;
+    }
+    ignoreFileChanged = isIgnoreFile(path);
+  }
+  if (!ignoreFileChanged) {
+    return;
+  }
+
+  ++state->generation;
+  std::vector<InodeNumber> materialized;
+  for (const auto& [ino, entry] : state->entries) {
+    if (!entry.contentHash) {
+      materialized.push_back(ino);
+    }
+  }
+  for (auto ino : materialized) {
+    state->entries.erase(ino);
+  }
+}
+
+} // namespace facebook::eden
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <memory>
+#include <optional>
+#include "eden/fs/inodes/InodeNumber.h"
+#include "eden/fs/journal/Journal.h"
+#include "eden/fs/model/Hash.h"
+
+namespace facebook::eden {
+
+class GitIgnore;
+
+/**
+ * The parsed .gitignore files of a mount, so that successive status calls
+ * don't parse and compile the same ignore rules again.
+ *
+ * Entries are keyed by the inode of the ignore file and by the hash of its
+ * contents. A file that isn't materialized has the hash of its source control
+ * blob, and its entry is valid for as long as the inode keeps that hash. A
+ * materialized file has no hash: its entry is valid until the journal
+ * records a change to an ignore file, see processJournal().
+ *
+ * The least recently used entries are evicted beyond maximumEntries. A
+ * maximumEntries of 0 disables the cache.
+ */
+class GitIgnoreCache {
+ public:
+  explicit GitIgnoreCache(size_t maximumEntries);
+
+  struct Lookup {
+    /**
+     * The cached rules, or nullptr if the file has to be parsed.
+     */
+    std::shared_ptr<const GitIgnore> ignore;
+
+    /**
+     * To be passed to insert() once the file has been parsed.
+     */
+    uint64_t generation;
+  };
+
+  /**
+   * Look up the rules of the ignore file ino, whose contents currently have
+   * the given hash, or std::nullopt if the file is materialized.
+   */
+  Lookup get(InodeNumber ino, const std::optional<Hash>& contentHash);
+
+  /**
+   * Cache the rules parsed from the ignore file ino, after a get() miss that
+   * returned generation.
+   *
+   * The rules of a materialized file are only cached if processJournal()
+   * found no change to an ignore file since that get(): the file may have
+   * been read before the change.
+   */
+  void insert(
+      InodeNumber ino,
+      const std::optional<Hash>& contentHash,
+      std::shared_ptr<const GitIgnore> ignore,
+      uint64_t generation);
+
+  /**
+   * Drop the entries of the materialized ignore files if the journal
+   * recorded a change to an ignore file since the previous call. This must be
+   * called at the start of every diff, once the pending changes have been
+   * recorded in the journal.
+   */
+  void processJournal(Journal& journal);
+
+ private:
+  struct Entry {
+    std::optional<Hash> contentHash;
+    std::shared_ptr<const GitIgnore> ignore;
+  };
+
+  struct State {
+    explicit State(size_t maximumEntries) : entries{maximumEntries} {}
+
+    folly::EvictingCacheMap<InodeNumber, Entry> entries;
+
+    /**
+     * The last journal sequence number seen by processJournal(), unset until
+     * its first call.
+     */
+    std::optional<Journal::SequenceNumber> lastSequence;
+
+    /**
+     * Incremented whenever processJournal() drops the materialized entries.
+     */
+    uint64_t generation{0};
+  };
+
+  const size_t maximumEntries_;
+  folly::Synchronized<State> state_;
+};
+
+} // namespace facebook::eden
@@ -6,8 +6,10 @@
  */
 
 #include "GlobNode.h"
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
+#include <utility>
 #include "eden/fs/inodes/TreeInode.h"
 
 using folly::Future;
@@ -241,6 +243,17 @@ GlobNode::GlobNode(StringPiece pattern, bool includeDotfiles, bool hasSpecials)
               compiled.error()));
     }
     matcher_ = std::move(compiled.value());
+
+    if (hasSpecials) {
+      // Everything before the first, and after the last, special character
+      // is matched literally.  A ']' only closes a bracket expression, but
+      // is treated as special here to keep the suffix outside of it.
+      literalPrefix_ = pattern_.substr(0, pattern_.find_first_of("*?[\\"));
+      auto suffixStart = pattern_.find_last_of("*?[]\\");
+      if (suffixStart != string::npos) {
+        literalSuffix_ = pattern_.substr(suffixStart + 1);
+      }
+    }
   }
 }
 
@@ -283,6 +296,9 @@ void GlobNode::parse(StringPiece pattern) {
       container->emplace_back(
           std::make_unique<GlobNode>(token, includeDotfiles_, hasSpecials));
       node = container->back().get();
+      if (hasSpecials && container == &parent->children_) {
+        parent->indexSpecialChild(node);
+      }
     }
 
     // If there are no more tokens remaining then we have a leaf node
@@ -299,6 +315,58 @@ void GlobNode::parse(StringPiece pattern) {
   }
 }
 
+void GlobNode::indexSpecialChild(GlobNode* node) {
+  if (node->literalSuffix_.empty()) {
+    unsuffixedSpecialChildren_.push_back(node);
+    return;
+  }
+  // Insert after the nodes with the same last character to preserve the
+  // order in which the patterns were parsed.
+  auto it = std::upper_bound(
+      suffixedSpecialChildren_.begin(),
+      suffixedSpecialChildren_.end(),
+      node->literalSuffix_.back(),
+      [](char last, const GlobNode* child) {
+        return last < child->literalSuffix_.back();
+      });
+  suffixedSpecialChildren_.insert(it, node);
+}
+
+template <typename FUNC>
+void GlobNode::forEachMatchingSpecialChild(
+    PathComponentPiece name,
+    FUNC&& func) {
+  auto text = name.stringPiece();
+  auto matches = [text](const GlobNode* node) {
+    return node->alwaysMatch_ ||
+        (text.startsWith(node->literalPrefix_) &&
+         text.endsWith(node->literalSuffix_) && node->matcher_.match(text));
+  };
+
+  for (auto* node : unsuffixedSpecialChildren_) {
+    if (matches(node)) {
+      func(node);
+    }
+  }
+
+  // Path components are never empty.
+  auto last = text.back();
+  auto begin = std::lower_bound(
+      suffixedSpecialChildren_.begin(),
+      suffixedSpecialChildren_.end(),
+      last,
+      [](const GlobNode* child, char ch) {
+        return child->literalSuffix_.back() < ch;
+      });
+  for (auto it = begin; it != suffixedSpecialChildren_.end() &&
+       (*it)->literalSuffix_.back() == last;
+       ++it) {
+    if (matches(*it)) {
+      func(*it);
+    }
+  }
+}
+
 template <typename ROOT>
 Future<vector<GlobNode::GlobResult>> GlobNode::evaluateImpl(
     const ObjectStore* store,
@@ -306,7 +374,8 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateImpl(
     RelativePathPiece rootPath,
     ROOT&& root,
     GlobNode::PrefetchList fileBlobsToPrefetch,
-    const RootId& originRootId) {
+    const RootId& originRootId,
+    const ResultSink* resultSink) {
   vector<GlobResult> results;
   vector<std::pair<PathComponentPiece, GlobNode*>> recurse;
   vector<Future<vector<GlobResult>>> futures;
@@ -319,7 +388,8 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateImpl(
         RelativePathPiece{""},
         root,
         fileBlobsToPrefetch,
-        originRootId));
+        originRootId,
+        resultSink));
   }
 
   auto recurseIfNecessary = [&](PathComponentPiece name,
@@ -337,14 +407,16 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateImpl(
                             &context,
                             innerNode = node,
                             fileBlobsToPrefetch,
-                            &originRootId](std::shared_ptr<const Tree> dir) {
+                            &originRootId,
+                            resultSink](std::shared_ptr<const Tree> dir) {
                   return innerNode->evaluateImpl(
                       store,
                       context,
                       candidateName,
                       TreeRoot(std::move(dir)),
                       fileBlobsToPrefetch,
-                      originRootId);
+                      originRootId,
+                      resultSink);
                 }));
       }
     }
@@ -371,24 +443,27 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateImpl(
           // Not the leaf of a pattern; if this is a dir, we need to recurse
           recurseIfNecessary(name, node.get(), entry);
         }
-      } else {
-        // We need to match it out of the entries in this inode
-        for (auto& entry : root.iterate(contents)) {
-          auto name = root.entryName(entry);
-          if (node->alwaysMatch_ || node->matcher_.match(name.stringPiece())) {
-            if (node->isLeaf_) {
-              results.emplace_back(
-                  root.entryToResult(rootPath + name, entry, originRootId));
-              if (fileBlobsToPrefetch && root.entryShouldPrefetch(entry)) {
-                fileBlobsToPrefetch->wlock()->emplace_back(
-                    root.entryHash(entry));
-              }
+      }
+    }
+
+    // We need to match the remaining nodes out of the entries in this inode.
+    // Walk the entries once, only trying the nodes that may match each name.
+    if (!suffixedSpecialChildren_.empty() ||
+        !unsuffixedSpecialChildren_.empty()) {
+      for (auto& entry : root.iterate(contents)) {
+        auto name = root.entryName(entry);
+        forEachMatchingSpecialChild(name, [&](GlobNode* node) {
+          if (node->isLeaf_) {
+            results.emplace_back(
+                root.entryToResult(rootPath + name, entry, originRootId));
+            if (fileBlobsToPrefetch && root.entryShouldPrefetch(entry)) {
+              fileBlobsToPrefetch->wlock()->emplace_back(root.entryHash(entry));
             }
-            // Not the leaf of a pattern; if this is a dir, we need to
-            // recurse
-            recurseIfNecessary(name, node.get(), entry);
           }
-        }
+          // Not the leaf of a pattern; if this is a dir, we need to
+          // recurse
+          recurseIfNecessary(name, node, entry);
+        });
       }
     }
   }
@@ -402,17 +477,25 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateImpl(
                                          candidateName = rootPath + item.first,
                                          node = item.second,
                                          fileBlobsToPrefetch,
-                                         &originRootId](TreeInodePtr dir) {
+                                         &originRootId,
+                                         resultSink](TreeInodePtr dir) {
                                return node->evaluateImpl(
                                    store,
                                    context,
                                    candidateName,
                                    TreeInodePtrRoot(std::move(dir)),
                                    fileBlobsToPrefetch,
-                                   originRootId);
+                                   originRootId,
+                                   resultSink);
                              }));
   }
 
+  // The children hand over their own matches, so only this directory's
+  // are passed on here.
+  if (resultSink && !results.empty()) {
+    (*resultSink)(std::exchange(results, {}));
+  }
+
   // Note: we use collectAll() rather than collect() here to make sure that
   // we have really finished all computation before we return a result.
   // Our caller may destroy us after we return, so we can't let errors propagate
@@ -438,14 +521,16 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluate(
     RelativePathPiece rootPath,
     TreeInodePtr root,
     GlobNode::PrefetchList fileBlobsToPrefetch,
-    const RootId& originRootId) {
+    const RootId& originRootId,
+    const ResultSink* resultSink) {
   return evaluateImpl(
       store,
       context,
       rootPath,
       TreeInodePtrRoot(std::move(root)),
       fileBlobsToPrefetch,
-      originRootId);
+      originRootId,
+      resultSink);
 }
 
 folly::Future<vector<GlobNode::GlobResult>> GlobNode::evaluate(
@@ -454,14 +539,16 @@ folly::Future<vector<GlobNode::GlobResult>> GlobNode::evaluate(
     RelativePathPiece rootPath,
     std::shared_ptr<const Tree> tree,
     GlobNode::PrefetchList fileBlobsToPrefetch,
-    const RootId& originRootId) {
+    const RootId& originRootId,
+    const ResultSink* resultSink) {
   return evaluateImpl(
       store,
       context,
       rootPath,
       TreeRoot(std::move(tree)),
       fileBlobsToPrefetch,
-      originRootId);
+      originRootId,
+      resultSink);
 }
 
 StringPiece GlobNode::tokenize(StringPiece& pattern, bool* hasSpecials) {
@@ -510,7 +597,8 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateRecursiveComponentImpl(
     RelativePathPiece startOfRecursive,
     ROOT&& root,
     GlobNode::PrefetchList fileBlobsToPrefetch,
-    const RootId& originRootId) {
+    const RootId& originRootId,
+    const ResultSink* resultSink) {
   vector<GlobResult> results;
   vector<RelativePath> subDirNames;
   vector<Future<vector<GlobResult>>> futures;
@@ -546,7 +634,8 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateRecursiveComponentImpl(
                               &context,
                               this,
                               fileBlobsToPrefetch,
-                              &originRootId](std::shared_ptr<const Tree> tree) {
+                              &originRootId,
+                              resultSink](std::shared_ptr<const Tree> tree) {
                     return evaluateRecursiveComponentImpl(
                         store,
                         context,
@@ -554,7 +643,8 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateRecursiveComponentImpl(
                         candidateName,
                         TreeRoot(std::move(tree)),
                         fileBlobsToPrefetch,
-                        originRootId);
+                        originRootId,
+                        resultSink);
                   }));
         }
       }
@@ -573,7 +663,8 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateRecursiveComponentImpl(
                         &context,
                         this,
                         fileBlobsToPrefetch,
-                        &originRootId](TreeInodePtr dir) {
+                        &originRootId,
+                        resultSink](TreeInodePtr dir) {
               return evaluateRecursiveComponentImpl(
                   store,
                   context,
@@ -581,10 +672,17 @@ Future<vector<GlobNode::GlobResult>> GlobNode::evaluateRecursiveComponentImpl(
                   candidateName,
                   TreeInodePtrRoot(std::move(dir)),
                   fileBlobsToPrefetch,
-                  originRootId);
+                  originRootId,
+                  resultSink);
             }));
   }
 
+  // The children hand over their own matches, so only this directory's
+  // are passed on here.
+  if (resultSink && !results.empty()) {
+    (*resultSink)(std::exchange(results, {}));
+  }
+
   // Note: we use collectAll() rather than collect() here to make sure that
   // we have really finished all computation before we return a result.
   // Our caller may destroy us after we return, so we can't let errors propagate
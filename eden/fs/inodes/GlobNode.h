@@ -7,6 +7,7 @@
 
 #pragma once
 #include <folly/futures/Future.h>
+#include <functional>
 #include <ostream>
 #include "eden/fs/inodes/InodePtrFwd.h"
 #include "eden/fs/model/Hash.h"
@@ -27,7 +28,9 @@ namespace eden {
  * as we work through the tree.  Path components that have no glob
  * special characters can be looked up directly from the directory
  * contents as a hash lookup, rather than by repeatedly matching the
- * pattern against each entry.
+ * pattern against each entry.  The remaining components are indexed by
+ * their literal suffix so that each entry is only matched against the
+ * patterns that could possibly match it.
  */
 class GlobNode {
  public:
@@ -78,6 +81,10 @@ class GlobNode {
         : name(std::move(name)), dtype(dtype), originHash(&originHash) {}
   };
 
+  // Receives the matches of each directory as soon as it has been evaluated.
+  // It can be called concurrently from several threads.
+  using ResultSink = std::function<void(std::vector<GlobResult>&&)>;
+
   // Compile and add a new glob pattern to the tree.
   // Compilation splits the pattern into nodes, with one node for each
   // directory separator separated path component.
@@ -95,13 +102,17 @@ class GlobNode {
   // prefetched via the ObjectStore layer.  This will not change the
   // materialization or overlay state for children that already have
   // inodes assigned.
+  // If resultSink is set, the matches are handed to it directory by
+  // directory instead, and the returned vector is empty. The caller is
+  // responsible for ensuring that it exists until the Future is resolved.
   folly::Future<std::vector<GlobResult>> evaluate(
       const ObjectStore* store,
       ObjectFetchContext& context,
       RelativePathPiece rootPath,
       TreeInodePtr root,
       PrefetchList fileBlobsToPrefetch,
-      const RootId& originRootId);
+      const RootId& originRootId,
+      const ResultSink* resultSink = nullptr);
 
   // This is the Tree version of the method above
   folly::Future<std::vector<GlobResult>> evaluate(
@@ -110,7 +121,8 @@ class GlobNode {
       RelativePathPiece rootPath,
       std::shared_ptr<const Tree> tree,
       PrefetchList fileBlobsToPrefetch,
-      const RootId& originRootId);
+      const RootId& originRootId,
+      const ResultSink* resultSink = nullptr);
 
   /**
    * Print a human-readable description of this GlobNode to stderr.
@@ -136,6 +148,16 @@ class GlobNode {
   GlobNode* lookupToken(
       std::vector<std::unique_ptr<GlobNode>>* container,
       folly::StringPiece token);
+  // Add a newly created child with glob special characters to the
+  // specialChildren indices below.
+  void indexSpecialChild(GlobNode* node);
+  // Calls func(node) for each child with glob special characters whose
+  // pattern matches name.
+  // Rather than running every matcher against each directory entry, this
+  // only runs the matchers of the patterns whose literal suffix has the same
+  // last character as name, and whose literal prefix and suffix match name.
+  template <typename FUNC>
+  void forEachMatchingSpecialChild(PathComponentPiece name, FUNC&& func);
   // Evaluates any recursive glob entries associated with this node.
   // This is a recursive function which evaluates the current GlobNode against
   // the recursive set of children.
@@ -151,7 +173,8 @@ class GlobNode {
       RelativePathPiece startOfRecursive,
       ROOT&& root,
       PrefetchList fileBlobsToPrefetch,
-      const RootId& originRootId);
+      const RootId& originRootId,
+      const ResultSink* resultSink);
 
   template <typename ROOT>
   folly::Future<std::vector<GlobResult>> evaluateImpl(
@@ -160,7 +183,8 @@ class GlobNode {
       RelativePathPiece rootPath,
       ROOT&& root,
       PrefetchList fileBlobsToPrefetch,
-      const RootId& originRootId);
+      const RootId& originRootId,
+      const ResultSink* resultSink);
 
   void debugDump(int currentDepth) const;
 
@@ -172,6 +196,16 @@ class GlobNode {
   std::vector<std::unique_ptr<GlobNode>> children_;
   // List of ** child rules
   std::vector<std::unique_ptr<GlobNode>> recursiveChildren_;
+  // The children_ with glob special characters whose pattern ends with a
+  // literal suffix, sorted by the last character of that suffix.
+  std::vector<GlobNode*> suffixedSpecialChildren_;
+  // The children_ with glob special characters and no literal suffix.
+  std::vector<GlobNode*> unsuffixedSpecialChildren_;
+  // The literal text that pattern_ starts and ends with, if any.  Every name
+  // matching the pattern has to start with literalPrefix_ and end with
+  // literalSuffix_, which is much cheaper to check than running matcher_.
+  std::string literalPrefix_;
+  std::string literalSuffix_;
 
   // For a child GlobNode that is added to this GlobNode (presumably via
   // parse()), the GlobMatcher pattern associated with the child node should use
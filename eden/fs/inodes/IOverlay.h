@@ -8,6 +8,8 @@
 #pragma once
 
 #include <optional>
+#include <stdexcept>
+#include <string>
 
 #ifdef __APPLE__
 #include <sys/mount.h>
@@ -18,6 +20,7 @@
 
 #include "eden/fs/inodes/InodeNumber.h"
 #include "eden/fs/inodes/overlay/gen-cpp2/overlay_types.h"
+#include "eden/fs/model/Hash.h"
 #include "eden/fs/utils/PathFuncs.h"
 
 namespace folly {
@@ -68,6 +71,12 @@ class IOverlay {
    */
   virtual void close(std::optional<InodeNumber> nextInodeNumber) = 0;
 
+  /**
+   * Make the changes written so far durable, for implementations that buffer
+   * their writes.
+   */
+  virtual void flush() {}
+
   /**
    * If Overlay initialized - i.e., is cleanup (close) necessary.
    */
@@ -114,6 +123,18 @@ class IOverlay {
       InodeNumber inodeNumber,
       const folly::IOBuf& contents) = 0;
 
+  /**
+   * Helper function to write an overlay file for a FileInode materialized
+   * from the blob with the given hash. Implementations may use the hash to
+   * avoid copying the contents.
+   */
+  virtual folly::File createOverlayFileFromBlob(
+      InodeNumber inodeNumber,
+      const Hash& /* blobHash */,
+      const folly::IOBuf& contents) {
+    return createOverlayFile(inodeNumber, contents);
+  }
+
   /**
    * Helper function that opens an existing overlay file,
    * checks if the file has valid header, and returns the file.
@@ -127,6 +148,50 @@ class IOverlay {
    */
   virtual folly::File openFileNoVerify(InodeNumber inodeNumber) = 0;
 
+  /**
+   * Called with the SHA-1 of the contents of an overlay file after it was
+   * computed. Implementations may use it to share the storage of files with
+   * the same contents.
+   */
+  virtual void dedupeOverlayFile(
+      InodeNumber /* inodeNumber */,
+      const Hash& /* sha1 */) {}
+
+  /**
+   * The largest file whose contents the overlay can store inline with
+   * saveInlineFile() rather than in an overlay file, or std::nullopt if it
+   * can't store files inline.
+   */
+  virtual std::optional<size_t> getInlineFileLimit() const {
+    return std::nullopt;
+  }
+
+  /**
+   * Store the contents of a file inline, replacing its previous inline
+   * contents. Only called when getInlineFileLimit() is set.
+   */
+  virtual void saveInlineFile(
+      InodeNumber /* inodeNumber */,
+      folly::ByteRange /* contents */) {
+    throw std::logic_error("this overlay does not store files inline");
+  }
+
+  /**
+   * Load the contents stored by saveInlineFile(), or std::nullopt if the file
+   * is not stored inline. Inline contents take precedence over the overlay
+   * file left from before the file was dematerialized, if any. Creating an
+   * overlay file removes the inline contents.
+   */
+  virtual std::optional<std::string> loadInlineFile(
+      InodeNumber /* inodeNumber */) {
+    return std::nullopt;
+  }
+
+  /**
+   * Delete the inline contents of a file, if there are any.
+   */
+  virtual void removeInlineFile(InodeNumber /* inodeNumber */) {}
+
   /**
    * call statfs(2) on the filesystem in which the overlay is located
    */
@@ -141,6 +206,24 @@ class IOverlay {
    */
   virtual void updateUsedInodeNumber(uint64_t /* usedInodeNumber */) {}
 
+  /**
+   * Return the inode number reservation saved by saveInodeNumberReservation()
+   * during the previous run, if any, and forget it.
+   *
+   * While a reservation is saved, no inode number at or above it has been
+   * handed out, so it can be used as the next inode number after an unclean
+   * shutdown without scanning the whole overlay.
+   */
+  virtual std::optional<InodeNumber> loadInodeNumberReservation() {
+    return std::nullopt;
+  }
+
+  /**
+   * Durably record that no inode number at or above `limit` will be handed
+   * out before the next call. The reservation is dropped on close().
+   */
+  virtual void saveInodeNumberReservation(InodeNumber /* limit */) {}
+
   virtual void addChild(
       InodeNumber /* parent */,
       PathComponentPiece /* name */,
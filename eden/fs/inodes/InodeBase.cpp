@@ -200,8 +200,23 @@ std::unique_ptr<InodeBase> InodeBase::markUnlinked(
     TreeInode* parent,
     PathComponentPiece name,
     const RenameLock& renameLock) {
-  XLOG(DBG5) << "inode " << this << " unlinked: " << getLogPath();
   XDCHECK(renameLock.isHeld(mount_));
+  return markUnlinkedImpl(parent, name);
+}
+
+std::unique_ptr<InodeBase> InodeBase::markUnlinked(
+    TreeInode* parent,
+    PathComponentPiece name,
+    const SharedRenameLock& renameLock) {
+  XDCHECK(renameLock.isHeld(mount_));
+  XDCHECK(!isDir());
+  return markUnlinkedImpl(parent, name);
+}
+
+std::unique_ptr<InodeBase> InodeBase::markUnlinkedImpl(
+    TreeInode* parent,
+    PathComponentPiece name) {
+  XLOG(DBG5) << "inode " << this << " unlinked: " << getLogPath();
 
   {
     auto loc = location_.wlock();
@@ -209,6 +224,7 @@ std::unique_ptr<InodeBase> InodeBase::markUnlinked(
     XDCHECK_EQ(loc->parent.get(), parent);
     loc->unlinked = true;
   }
+  mount_->getInodePathCache().invalidate();
 
   // Grab the inode map lock, and check if we should unload
   // ourself immediately.
@@ -241,15 +257,34 @@ void InodeBase::updateLocation(
     TreeInodePtr newParent,
     PathComponentPiece newName,
     const RenameLock& renameLock) {
+  XDCHECK(renameLock.isHeld(mount_));
+  updateLocationImpl(std::move(newParent), newName);
+}
+
+void InodeBase::updateLocation(
+    TreeInodePtr newParent,
+    PathComponentPiece newName,
+    const SharedRenameLock& renameLock) {
+  XDCHECK(renameLock.isHeld(mount_));
+  XDCHECK(!isDir());
+  XDCHECK_EQ(location_.rlock()->parent.get(), newParent.get());
+  updateLocationImpl(std::move(newParent), newName);
+}
+
+void InodeBase::updateLocationImpl(
+    TreeInodePtr newParent,
+    PathComponentPiece newName) {
   XLOG(DBG5) << "inode " << this << " renamed: " << getLogPath() << " --> "
              << newParent->getLogPath() << " / \"" << newName << "\"";
-  XDCHECK(renameLock.isHeld(mount_));
   XDCHECK_EQ(mount_, newParent->mount_);
 
-  auto loc = location_.wlock();
-  XDCHECK(!loc->unlinked);
-  loc->parent = newParent;
-  loc->name = newName.copy();
+  {
+    auto loc = location_.wlock();
+    XDCHECK(!loc->unlinked);
+    loc->parent = newParent;
+    loc->name = newName.copy();
+  }
+  mount_->getInodePathCache().invalidate();
 }
 
 void InodeBase::onPtrRefZero() const {
@@ -228,6 +228,16 @@ class InodeBase {
       PathComponentPiece name,
       const RenameLock& renameLock);
 
+  /**
+   * The rename lock only needs to be held in shared mode to unlink or move
+   * a non-directory within its parent, as the parent's contents lock
+   * excludes the other changes to this inode's location.
+   */
+  std::unique_ptr<InodeBase> markUnlinked(
+      TreeInode* parent,
+      PathComponentPiece name,
+      const SharedRenameLock& renameLock);
+
   /**
    * This method should only be called by TreeInode::loadUnlinkedChildInode().
    * Its purpose is to set the unlinked flag to true for inodes that have
@@ -245,6 +255,10 @@ class InodeBase {
       TreeInodePtr newParent,
       PathComponentPiece newName,
       const RenameLock& renameLock);
+  void updateLocation(
+      TreeInodePtr newParent,
+      PathComponentPiece newName,
+      const SharedRenameLock& renameLock);
 
   /**
    * Check to see if the ptrAcquire reference count is zero.
@@ -418,6 +432,13 @@ class InodeBase {
   void updateAtime();
   void updateMtimeAndCtime(EdenTimestamp now);
 
+  // The caller must be holding the rename lock in the mode required by the
+  // public markUnlinked() and updateLocation() overloads.
+  std::unique_ptr<InodeBase> markUnlinkedImpl(
+      TreeInode* parent,
+      PathComponentPiece name);
+  void updateLocationImpl(TreeInodePtr newParent, PathComponentPiece newName);
+
   template <typename InodeType>
   friend class InodePtrImpl;
   friend class InodePtrTestHelper;
@@ -8,9 +8,17 @@
 #pragma once
 #include <folly/ExceptionWrapper.h>
 #include <folly/FBVector.h>
+#include <folly/Function.h>
 #include <folly/MapUtil.h>
+#include <folly/Synchronized.h>
 #include <folly/functional/Invoke.h>
 #include <folly/futures/Future.h>
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <variant>
 #include "eden/fs/inodes/InodePtr.h"
 #include "eden/fs/inodes/TreeInode.h"
 #include "eden/fs/store/ObjectFetchContext.h"
@@ -20,8 +28,97 @@
 namespace facebook {
 namespace eden {
 
+/**
+ * What is known about a path whose inode is not loaded, from the entry of its
+ * parent directory.
+ *
+ * Only entries that are not materialized are resolved this way, so their
+ * contents are the source control object identified by hash.
+ */
+struct UnloadedEntry {
+  InodeNumber inodeNumber;
+  mode_t initialMode;
+  Hash hash;
+
+  dtype_t getDtype() const {
+    return mode_to_dtype(initialMode);
+  }
+};
+
+using InodeOrEntry = std::variant<InodePtr, UnloadedEntry>;
+
+/**
+ * The number of inode loads applyToInodes() and applyToInodesOrEntries() keep
+ * in flight by default.
+ */
+constexpr size_t kDefaultMaxConcurrentInodeLoads = 256;
+
 namespace detail {
 
+/**
+ * Bounds the number of inode loads in flight. The loads past the limit are
+ * queued, and started in order as the earlier ones complete.
+ */
+class InodeLoadThrottle
+    : public std::enable_shared_from_this<InodeLoadThrottle> {
+ public:
+  using Load = folly::Function<folly::Future<folly::Unit>()>;
+
+  explicit InodeLoadThrottle(size_t maxConcurrentLoads)
+      : maxConcurrentLoads_{std::max<size_t>(maxConcurrentLoads, 1)} {}
+
+  void run(Load load) {
+    {
+      auto state = state_.lock();
+      if (state->inFlight >= maxConcurrentLoads_) {
+        state->queue.push_back(std::move(load));
+        return;
+      }
+      ++state->inFlight;
+    }
+    start(std::move(load));
+  }
+
+ private:
+  struct State {
+    size_t inFlight{0};
+    std::deque<Load> queue;
+  };
+
+  void start(Load load) {
+    // Loads of inodes that are already loaded complete immediately, so they
+    // are chained in a loop rather than recursively, to bound the stack depth.
+    while (load) {
+      auto future = folly::makeFutureWith(std::move(load));
+      if (!future.isReady()) {
+        std::move(future).thenTry([self = shared_from_this()](auto&&) {
+          self->start(self->takeNext());
+        });
+        return;
+      }
+      load = takeNext();
+    }
+  }
+
+  /**
+   * Take the next queued load in the slot of the load that completed, or free
+   * the slot if there is none.
+   */
+  Load takeNext() {
+    auto state = state_.lock();
+    if (state->queue.empty()) {
+      --state->inFlight;
+      return Load{};
+    }
+    auto load = std::move(state->queue.front());
+    state->queue.pop_front();
+    return load;
+  }
+
+  const size_t maxConcurrentLoads_;
+  folly::Synchronized<State, std::mutex> state_;
+};
+
 /** InodeLoader is a helper class for minimizing the number
  * of inode load calls that we need to emit when loading a list
  * of paths.
@@ -32,22 +129,9 @@ class InodeLoader {
 
   // Arrange to load the inode for the input path
   folly::Future<InodePtr> load(RelativePathPiece path) {
-    InodeLoader* parent = this;
-
-    // Build out the tree if InodeLoaders to match the input path
-    for (auto name : path.components()) {
-      auto child = parent->getOrCreateChild(name);
-      parent = child;
-    }
-
-    // Whichever node we finished on is the last component
-    // of the input path and thus is one for which we need to
-    // request info.
-    // Note that parent can potentially == this if the input path
-    // is the root.
-
-    parent->promises_.emplace_back();
-    return parent->promises_.back().getFuture();
+    auto* node = getOrCreateNode(path);
+    node->promises_.emplace_back();
+    return node->promises_.back().getFuture();
   }
 
   // Arrange to load the inode for the input path, given
@@ -57,22 +141,43 @@ class InodeLoader {
     return folly::makeFutureWith([&] { return load(RelativePathPiece(path)); });
   }
 
+  // Arrange to resolve the input path, from the entry of its parent if its
+  // inode is neither loaded nor materialized, and by loading the inode
+  // otherwise.
+  folly::Future<InodeOrEntry> lookup(folly::StringPiece path) {
+    return folly::makeFutureWith([&] {
+      auto* node = getOrCreateNode(RelativePathPiece(path));
+      node->entryPromises_.emplace_back();
+      return node->entryPromises_.back().getFuture();
+    });
+  }
+
   // Called to signal that a load attempt has completed.
   // In the success case this will cause any children of
   // this inode to be loaded.
   // In the failure case this will propagate the failure to
   // any children of this node, too.
-  void loaded(folly::Try<InodePtr> inodeTry, ObjectFetchContext& fetchContext) {
+  void loaded(
+      folly::Try<InodePtr> inodeTry,
+      ObjectFetchContext& fetchContext,
+      const std::shared_ptr<InodeLoadThrottle>& throttle) {
     for (auto& promise : promises_) {
       promise.setValue(inodeTry);
     }
+    for (auto& promise : entryPromises_) {
+      if (inodeTry.hasException()) {
+        promise.setException(inodeTry.exception());
+      } else {
+        promise.setValue(InodeOrEntry{*inodeTry});
+      }
+    }
 
     auto tree = inodeTry.hasValue() ? inodeTry->asTreePtrOrNull() : nullptr;
 
     for (auto& entry : children_) {
       if (inodeTry.hasException()) {
         // The attempt failed, so propagate the failure to our children
-        entry.second->loaded(inodeTry, fetchContext);
+        entry.second->loaded(inodeTry, fetchContext, throttle);
       } else {
         // otherwise schedule the next level of lookup
         auto& childName = entry.first;
@@ -85,16 +190,28 @@ class InodeLoader {
               folly::Try<InodePtr>(
                   folly::make_exception_wrapper<std::system_error>(
                       ENOENT, std::generic_category())),
-              fetchContext);
+              fetchContext,
+              throttle);
           continue;
         }
 
-        folly::makeFutureWith(
-            [&] { return tree->getOrLoadChild(childName, fetchContext); })
-            .thenTry([loader = std::move(childLoader),
-                      &fetchContext](folly::Try<InodePtr>&& inode) {
-              loader->loaded(inode, fetchContext);
-            });
+        if (childLoader->lookedUpFromParent(*tree, childName)) {
+          continue;
+        }
+
+        throttle->run([tree,
+                       childName = childName.copy(),
+                       loader = std::move(childLoader),
+                       &fetchContext,
+                       throttle]() mutable {
+          return folly::makeFutureWith([&] {
+                   return tree->getOrLoadChild(childName, fetchContext);
+                 })
+              .thenTry([loader = std::move(loader), &fetchContext, throttle](
+                           folly::Try<InodePtr>&& inode) {
+                loader->loaded(inode, fetchContext, throttle);
+              });
+        });
       }
     }
   }
@@ -107,6 +224,19 @@ class InodeLoader {
   PathMap<std::unique_ptr<InodeLoader>> children_{CaseSensitivity::Sensitive};
   // promises for the inode load attempts
   std::vector<folly::Promise<InodePtr>> promises_;
+  // promises for the lookups, which don't need the inode to be loaded
+  std::vector<folly::Promise<InodeOrEntry>> entryPromises_;
+
+  // Build out the tree of InodeLoaders to match the input path, and return
+  // the node of its last component. Note that this can potentially be this
+  // node if the input path is the root.
+  InodeLoader* getOrCreateNode(RelativePathPiece path) {
+    InodeLoader* node = this;
+    for (auto name : path.components()) {
+      node = node->getOrCreateChild(name);
+    }
+    return node;
+  }
 
   // Helper for building out the plan during parsing
   InodeLoader* getOrCreateChild(PathComponentPiece name) {
@@ -117,6 +247,32 @@ class InodeLoader {
     auto ret = children_.emplace(name, std::make_unique<InodeLoader>());
     return ret.first->second.get();
   }
+
+  // Resolve the lookups of this node from its entry in the parent, without
+  // loading its inode. This is only possible when nothing else needs the
+  // inode, and when the entry is neither loaded nor materialized.
+  bool lookedUpFromParent(const TreeInode& parent, PathComponentPiece name) {
+    if (!promises_.empty() || !children_.empty()) {
+      return false;
+    }
+    std::optional<UnloadedEntry> unloaded;
+    {
+      auto contents = parent.getContents().rlock();
+      auto it = contents->entries.find(name);
+      if (it == contents->entries.end() || it->second.getInode() ||
+          it->second.isMaterialized()) {
+        return false;
+      }
+      unloaded = UnloadedEntry{
+          it->second.getInodeNumber(),
+          it->second.getInitialMode(),
+          it->second.getHash()};
+    }
+    for (auto& promise : entryPromises_) {
+      promise.setValue(InodeOrEntry{*unloaded});
+    }
+    return true;
+  }
 };
 
 } // namespace detail
@@ -127,6 +283,7 @@ class InodeLoader {
  * loading the same inodes over and over again.  In other words, the
  * number of inode load calls is O(number-of-unique-inodes) rather than
  * O(number-of-path-components) in the input set of paths.
+ * At most `maxConcurrentLoads` inode loads are in flight at once.
  * As each matching inode is loaded, `func` is applied to it.
  * This function returns `vector<SemiFuture<Result>>` where `Result`
  * is the return type of `func`.
@@ -138,7 +295,8 @@ auto applyToInodes(
     InodePtr rootInode,
     const std::vector<std::string>& paths,
     Func func,
-    ObjectFetchContext& fetchContext) {
+    ObjectFetchContext& fetchContext,
+    size_t maxConcurrentLoads = kDefaultMaxConcurrentInodeLoads) {
   using FuncRet = folly::invoke_result_t<Func&, InodePtr&>;
   using Result = typename folly::isFutureOrSemiFuture<FuncRet>::Inner;
 
@@ -151,7 +309,43 @@ auto applyToInodes(
         [func](InodePtr&& inode) { return func(inode); }));
   }
 
-  loader.loaded(folly::Try<InodePtr>(rootInode), fetchContext);
+  loader.loaded(
+      folly::Try<InodePtr>(rootInode),
+      fetchContext,
+      std::make_shared<detail::InodeLoadThrottle>(maxConcurrentLoads));
+
+  return results;
+}
+
+/** Like applyToInodes(), but the paths whose inode is neither loaded nor
+ * materialized are resolved from the entry of their parent directory
+ * instead of being loaded, and `func` is applied to that UnloadedEntry.
+ * Only the inodes of the directories leading to the paths are loaded.
+ * `func` is invoked with an `InodeOrEntry`.
+ */
+template <typename Func>
+auto applyToInodesOrEntries(
+    InodePtr rootInode,
+    const std::vector<std::string>& paths,
+    Func func,
+    ObjectFetchContext& fetchContext,
+    size_t maxConcurrentLoads = kDefaultMaxConcurrentInodeLoads) {
+  using FuncRet = folly::invoke_result_t<Func&, InodeOrEntry&>;
+  using Result = typename folly::isFutureOrSemiFuture<FuncRet>::Inner;
+
+  detail::InodeLoader loader;
+
+  std::vector<folly::SemiFuture<Result>> results;
+  results.reserve(paths.size());
+  for (const auto& path : paths) {
+    results.emplace_back(loader.lookup(path).thenValue(
+        [func](InodeOrEntry&& inodeOrEntry) { return func(inodeOrEntry); }));
+  }
+
+  loader.loaded(
+      folly::Try<InodePtr>(rootInode),
+      fetchContext,
+      std::make_shared<detail::InodeLoadThrottle>(maxConcurrentLoads));
 
   return results;
 }
@@ -31,11 +31,13 @@ namespace facebook {
 namespace eden {
 
 InodeMap::UnloadedInode::UnloadedInode(
+    InodeNameTable& names,
     InodeNumber parentNum,
     PathComponentPiece entryName)
-    : parent(parentNum), name(entryName) {}
+    : parent(parentNum), name(names.intern(entryName)) {}
 
 InodeMap::UnloadedInode::UnloadedInode(
+    InodeNameTable& names,
     InodeNumber parentNum,
     PathComponentPiece entryName,
     bool isUnlinked,
@@ -43,52 +45,67 @@ InodeMap::UnloadedInode::UnloadedInode(
     std::optional<Hash> hash,
     uint32_t fsRefcount)
     : parent(parentNum),
-      name(entryName),
-      isUnlinked{isUnlinked},
+      name(names.intern(entryName)),
+      hash{hash.value_or(Hash{})},
       mode{mode},
-      hash{hash},
-      numFsReferences{fsRefcount} {
+      numFsReferences{fsRefcount},
+      isUnlinked{isUnlinked},
+      hasHash{hash.has_value()} {
   if (folly::kIsWindows) {
     XDCHECK_LE(numFsReferences, 1u);
   }
 }
 
 InodeMap::UnloadedInode::UnloadedInode(
+    InodeNameTable& names,
     TreeInode* parent,
     PathComponentPiece entryName,
     bool isUnlinked,
     std::optional<Hash> hash,
     uint32_t fsRefcount)
-    : parent{parent->getNodeId()},
-      name{entryName},
-      isUnlinked{isUnlinked},
-      // There is no asTree->getMode() we can call,
-      // however, directories are always represented with
-      // this specific mode bit pattern in eden so we can
-      // force the value down here.
-      mode{S_IFDIR | 0755},
-      hash{hash},
-      numFsReferences{fsRefcount} {
-  if (folly::kIsWindows) {
-    XDCHECK_LE(numFsReferences, 1u);
-  }
-}
+    : UnloadedInode(
+          names,
+          parent->getNodeId(),
+          entryName,
+          isUnlinked,
+          // There is no asTree->getMode() we can call,
+          // however, directories are always represented with
+          // this specific mode bit pattern in eden so we can
+          // force the value down here.
+          S_IFDIR | 0755,
+          hash,
+          fsRefcount) {}
 
 InodeMap::UnloadedInode::UnloadedInode(
+    InodeNameTable& names,
     FileInode* inode,
     TreeInode* parent,
     PathComponentPiece entryName,
     bool isUnlinked,
     uint32_t fsRefcount)
-    : parent{parent->getNodeId()},
-      name{entryName},
-      isUnlinked{isUnlinked},
-      mode{inode->getMode()},
-      hash{inode->getBlobHash()},
-      numFsReferences{fsRefcount} {
-  if (folly::kIsWindows) {
-    XDCHECK_LE(numFsReferences, 1u);
+    : UnloadedInode(
+          names,
+          parent->getNodeId(),
+          entryName,
+          isUnlinked,
+          inode->getMode(),
+          inode->getBlobHash(),
+          fsRefcount) {}
+
+folly::Promise<InodePtr>& InodeMap::UnloadedInode::addPromise() {
+  if (!promises) {
+    promises = std::make_unique<PromiseVector>();
   }
+  return promises->emplace_back();
+}
+
+InodeMap::PromiseVector InodeMap::UnloadedInode::takePromises() {
+  if (!promises) {
+    return PromiseVector{};
+  }
+  auto result = std::move(*promises);
+  promises.reset();
+  return result;
 }
 
 InodeMap::InodeMap(EdenMount* mount) : mount_{mount} {}
@@ -111,30 +128,48 @@ InodeMap::~InodeMap() {
 }
 
 inline void InodeMap::insertLoadedInode(
-    const folly::Synchronized<Members>::LockedPtr& data,
+    LoadedInodeShard& shard,
     InodeBase* inode) {
-  auto ret = data->loadedInodes_.emplace(inode->getNodeId(), inode);
+  auto ret = shard.loadedInodes_.emplace(inode->getNodeId(), inode);
   XCHECK(ret.second);
   if (inode->getType() == dtype_t::Dir) {
-    ++data->numTreeInodes_;
+    ++shard.numTreeInodes_;
   } else {
-    ++data->numFileInodes_;
+    ++shard.numFileInodes_;
   }
 }
 
 void InodeMap::initializeRoot(
     const folly::Synchronized<Members>::LockedPtr& data,
     TreeInodePtr root) {
-  XCHECK_EQ(data->loadedInodes_.size(), 0ul)
+  XCHECK_EQ(getLoadedInodeCount(), 0ul)
       << "cannot load InodeMap data over a populated instance";
-  XCHECK_EQ(data->unloadedInodes_.size(), 0ul)
+  XCHECK_EQ(data->getUnloadedInodeCount(), 0ul)
       << "cannot load InodeMap data over a populated instance";
 
   XCHECK(!root_);
   root_ = std::move(root);
-  insertLoadedInode(data, root_.get());
-  XDCHECK_EQ(1ul, data->numTreeInodes_);
-  XDCHECK_EQ(0ul, data->numFileInodes_);
+  auto shard = getLoadedShard(root_->getNodeId()).wlock();
+  insertLoadedInode(*shard, root_.get());
+  XDCHECK_EQ(1ul, shard->numTreeInodes_);
+  XDCHECK_EQ(0ul, shard->numFileInodes_);
+}
+
+InodePtr InodeMap::findLoadedInode(InodeNumber number) const {
+  auto shard = getLoadedShard(number).rlock();
+  auto it = shard->loadedInodes_.find(number);
+  if (it == shard->loadedInodes_.end()) {
+    return nullptr;
+  }
+  return it->second.getPtr();
+}
+
+size_t InodeMap::getLoadedInodeCount() const {
+  size_t count = 0;
+  for (const auto& shard : loadedShards_) {
+    count += shard.rlock()->loadedInodes_.size();
+  }
+  return count;
 }
 
 void InodeMap::initialize(TreeInodePtr root) {
@@ -147,7 +182,8 @@ void InodeMap::initializeUnloadedInode(
     InodeNumber parentIno,
     InodeNumber ino,
     Args&&... args) {
-  auto unloadedEntry = UnloadedInode(parentIno, std::forward<Args>(args)...);
+  auto unloadedEntry =
+      UnloadedInode(data->names_, parentIno, std::forward<Args>(args)...);
   auto result = data->unloadedInodes_.emplace(ino, std::move(unloadedEntry));
   if (!result.second) {
     auto message = fmt::format(
@@ -192,6 +228,72 @@ void InodeMap::initializeFromTakeover(
              << " inodes registered";
 }
 
+#ifndef _WIN32
+void InodeMap::initializeFromSnapshot(
+    TreeInodePtr root,
+    std::shared_ptr<const InodeMapSnapshot> snapshot) {
+  auto data = data_.wlock();
+  initializeRoot(data, std::move(root));
+
+  data->snapshotIndex_.reserve(snapshot->size());
+  for (size_t n = 0; n < snapshot->size(); ++n) {
+    auto entry = (*snapshot)[n];
+    if (entry.numFsReferences < 0) {
+      auto message = folly::to<std::string>(
+          "inode number ",
+          entry.inodeNumber,
+          " has a negative numFsReferences number");
+      XLOG(ERR) << message;
+      throw std::runtime_error(message);
+    }
+
+    auto ino = InodeNumber{entry.inodeNumber};
+    if (!data->snapshotIndex_.emplace(ino, n).second) {
+      auto message = fmt::format(
+          "failed to emplace inode number {}; is it already present in the InodeMap?",
+          ino);
+      XLOG(ERR) << message;
+      throw std::runtime_error(message);
+    }
+  }
+  data->snapshot_ = std::move(snapshot);
+
+  XLOG(DBG2) << "InodeMap initialized mount " << mount_->getPath()
+             << " from takeover snapshot, " << data->snapshotIndex_.size()
+             << " inodes registered";
+}
+#endif
+
+bool InodeMap::copyFromSnapshot(
+    FOLLY_MAYBE_UNUSED const folly::Synchronized<Members>::LockedPtr& data,
+    FOLLY_MAYBE_UNUSED InodeNumber number) {
+#ifdef _WIN32
+  return false;
+#else
+  auto indexIt = data->snapshotIndex_.find(number);
+  if (indexIt == data->snapshotIndex_.end()) {
+    return false;
+  }
+  auto entry = (*data->snapshot_)[indexIt->second];
+  initializeUnloadedInode(
+      data,
+      InodeNumber{entry.parentInode},
+      number,
+      PathComponentPiece{entry.name},
+      entry.isUnlinked,
+      entry.mode,
+      entry.hash.empty() ? std::nullopt
+                         : std::optional<Hash>{hashFromThrift(entry.hash)},
+      folly::to<uint32_t>(entry.numFsReferences));
+  data->snapshotIndex_.erase(indexIt);
+  if (data->snapshotIndex_.empty()) {
+    // Every entry was copied, unmap the snapshot.
+    data->snapshot_.reset();
+  }
+  return true;
+#endif
+}
+
 namespace {
 #ifdef _WIN32
 /**
@@ -268,18 +370,26 @@ void InodeMap::initializeFromOverlay(TreeInodePtr root, Overlay& overlay) {
 }
 
 ImmediateFuture<InodePtr> InodeMap::lookupInode(InodeNumber number) {
+  // Fast path: the inode is already loaded, this only needs the shard lock.
+  if (auto inode = findLoadedInode(number)) {
+    return inode;
+  }
+
   // Lock the data.
   // We hold it while doing most of our work below, but explicitly unlock it
   // before triggering inode loading or before fulfilling any Promises.
   auto data = data_.wlock();
 
-  // Check to see if this Inode is already loaded
-  auto loadedIter = data->loadedInodes_.find(number);
-  if (loadedIter != data->loadedInodes_.end()) {
-    return loadedIter->second.getPtr();
+  // Check again now that we hold the data_ lock, the inode may have finished
+  // loading in the meantime. Inodes are only inserted into loadedInodes_ while
+  // holding the data_ lock, except for newly created ones which can't be
+  // in unloadedInodes_.
+  if (auto inode = findLoadedInode(number)) {
+    return inode;
   }
 
   // Look up the data in the unloadedInodes_ map.
+  copyFromSnapshot(data, number);
   auto unloadedIter = data->unloadedInodes_.find(number);
   if (UNLIKELY(unloadedIter == data->unloadedInodes_.end())) {
     // This generally shouldn't happen.  If a InodeNumber has been allocated we
@@ -291,11 +401,10 @@ ImmediateFuture<InodePtr> InodeMap::lookupInode(InodeNumber number) {
 
   // Check to see if anyone else has already started loading this inode.
   auto* unloadedData = &unloadedIter->second;
-  bool alreadyLoading = !unloadedData->promises.empty();
+  bool alreadyLoading = unloadedData->isLoading();
 
   // Add a new entry to the promises list.
-  unloadedData->promises.emplace_back();
-  auto result = unloadedData->promises.back().getSemiFuture();
+  auto result = unloadedData->addPromise().getSemiFuture();
 
   // If someone else has already started loading this inode we are done.
   // The current loading attempt will signal our promise when it completes.
@@ -317,15 +426,14 @@ ImmediateFuture<InodePtr> InodeMap::lookupInode(InodeNumber number) {
   auto childInodeNumber = number;
   while (true) {
     // Check to see if this parent is loaded
-    loadedIter = data->loadedInodes_.find(unloadedData->parent);
-    if (loadedIter != data->loadedInodes_.end()) {
+    InodePtr firstLoadedParent = findLoadedInode(unloadedData->parent);
+    if (firstLoadedParent) {
       // We found a loaded parent.
       // Grab copies of the arguments we need for startChildLookup(),
       // with the lock still held.
-      InodePtr firstLoadedParent = loadedIter->second.getPtr();
-      PathComponent requiredChildName = unloadedData->name;
+      PathComponent requiredChildName{unloadedData->getName()};
       bool isUnlinked = unloadedData->isUnlinked;
-      auto optionalHash = unloadedData->hash;
+      auto optionalHash = unloadedData->getHash();
       auto mode = unloadedData->mode;
       // Unlock the data before starting the child lookup
       data.unlock();
@@ -341,13 +449,18 @@ ImmediateFuture<InodePtr> InodeMap::lookupInode(InodeNumber number) {
     }
 
     // Look up the parent in unloadedInodes_
-    unloadedIter = data->unloadedInodes_.find(unloadedData->parent);
+    auto parentNumber = unloadedData->parent;
+    if (copyFromSnapshot(data, parentNumber)) {
+      // Copying the parent out of the snapshot may have moved the child.
+      unloadedData = &data->unloadedInodes_.find(childInodeNumber)->second;
+    }
+    unloadedIter = data->unloadedInodes_.find(parentNumber);
     if (UNLIKELY(unloadedIter == data->unloadedInodes_.end())) {
       // This shouldn't happen.  We must know about the parent inode number if
       // we knew about the child.
       auto bug = EDEN_BUG_EXCEPTION()
           << "unknown parent inode " << unloadedData->parent << " (of "
-          << unloadedData->name << ")";
+          << unloadedData->getName() << ")";
       // Unlock our data before calling inodeLoadFailed()
       data.unlock();
       inodeLoadFailed(childInodeNumber, bug);
@@ -355,18 +468,17 @@ ImmediateFuture<InodePtr> InodeMap::lookupInode(InodeNumber number) {
     }
 
     auto* parentData = &unloadedIter->second;
-    alreadyLoading = !parentData->promises.empty();
+    alreadyLoading = parentData->isLoading();
 
     // Add a new entry to the promises list.
     // It should kick off loading of the current child inode when
     // it is fulfilled.
-    parentData->promises.emplace_back();
     setupParentLookupPromise(
-        parentData->promises.back(),
-        unloadedData->name,
+        parentData->addPromise(),
+        unloadedData->getName(),
         unloadedData->isUnlinked,
         childInodeNumber,
-        unloadedData->hash,
+        unloadedData->getHash(),
         unloadedData->mode);
 
     if (alreadyLoading) {
@@ -441,16 +553,17 @@ InodeMap::PromiseVector InodeMap::inodeLoadComplete(InodeBase* inode) {
   PromiseVector promises;
   try {
     auto data = data_.wlock();
+    copyFromSnapshot(data, number);
     auto it = data->unloadedInodes_.find(number);
     XCHECK(it != data->unloadedInodes_.end())
         << "failed to find unloaded inode data when finishing load of inode "
         << number << ": " << inode->getLogPath();
-    swap(promises, it->second.promises);
+    promises = it->second.takePromises();
 
     inode->setChannelRefcount(it->second.numFsReferences);
 
     // Insert the entry into loadedInodes_, and remove it from unloadedInodes_
-    insertLoadedInode(data, inode);
+    insertLoadedInode(*getLoadedShard(number).wlock(), inode);
     data->unloadedInodes_.erase(it);
     return promises;
   } catch (const std::exception& ex) {
@@ -479,11 +592,12 @@ InodeMap::PromiseVector InodeMap::extractPendingPromises(InodeNumber number) {
   PromiseVector promises;
   {
     auto data = data_.wlock();
+    copyFromSnapshot(data, number);
     auto it = data->unloadedInodes_.find(number);
     XCHECK(it != data->unloadedInodes_.end())
         << "failed to find unloaded inode data when finishing load of inode "
         << number;
-    swap(promises, it->second.promises);
+    promises = it->second.takePromises();
   }
   return promises;
 }
@@ -499,12 +613,7 @@ ImmediateFuture<FileInodePtr> InodeMap::lookupFileInode(InodeNumber number) {
 }
 
 InodePtr InodeMap::lookupLoadedInode(InodeNumber number) {
-  auto data = data_.rlock();
-  auto it = data->loadedInodes_.find(number);
-  if (it == data->loadedInodes_.end()) {
-    return nullptr;
-  }
-  return it->second.getPtr();
+  return findLoadedInode(number);
 }
 
 TreeInodePtr InodeMap::lookupLoadedTree(InodeNumber number) {
@@ -531,60 +640,89 @@ std::optional<RelativePath> InodeMap::getPathForInode(InodeNumber inodeNumber) {
 std::optional<RelativePath> InodeMap::getPathForInodeHelper(
     InodeNumber inodeNumber,
     const folly::Synchronized<Members>::RLockedPtr& data) {
-  auto loadedIt = data->loadedInodes_.find(inodeNumber);
-  if (loadedIt != data->loadedInodes_.cend()) {
-    // If the inode is loaded, return its RelativePath
-    return loadedIt->second->getPath();
+  {
+    auto shard = getLoadedShard(inodeNumber).rlock();
+    auto loadedIt = shard->loadedInodes_.find(inodeNumber);
+    if (loadedIt != shard->loadedInodes_.cend()) {
+      // If the inode is loaded, return its RelativePath
+      return loadedIt->second->getPath();
+    }
+  }
+
+  bool isUnlinked{false};
+  InodeNumber parent;
+  std::optional<PathComponentPiece> name;
+  auto unloadedIt = data->unloadedInodes_.find(inodeNumber);
+  if (unloadedIt != data->unloadedInodes_.cend()) {
+    isUnlinked = unloadedIt->second.isUnlinked;
+    parent = unloadedIt->second.parent;
+    name = unloadedIt->second.getName();
   } else {
-    auto unloadedIt = data->unloadedInodes_.find(inodeNumber);
-    if (unloadedIt != data->unloadedInodes_.cend()) {
-      if (unloadedIt->second.isUnlinked) {
-        return std::nullopt;
-      }
-      // If the inode is not loaded, return its parent's path as long as it's
-      // parent isn't the root
-      auto parent = unloadedIt->second.parent;
-      if (parent == kRootNodeId) {
-        // The parent is the Eden mount root, just return its name (base case)
-        return RelativePath(unloadedIt->second.name);
-      }
-      auto dir = getPathForInodeHelper(parent, data);
-      if (!dir) {
-        EDEN_BUG() << "unlinked parent inode " << parent
-                   << "appears to contain non-unlinked child " << inodeNumber;
-      }
-      return *dir + unloadedIt->second.name;
-    } else {
+#ifndef _WIN32
+    // Only a read lock is held, the entry is read from the snapshot without
+    // being copied.
+    auto indexIt = data->snapshotIndex_.find(inodeNumber);
+    if (indexIt == data->snapshotIndex_.cend()) {
       throwSystemErrorExplicit(EINVAL, "unknown inode number ", inodeNumber);
     }
+    auto entry = (*data->snapshot_)[indexIt->second];
+    isUnlinked = entry.isUnlinked;
+    parent = InodeNumber{entry.parentInode};
+    name.emplace(entry.name);
+#else
+    throwSystemErrorExplicit(EINVAL, "unknown inode number ", inodeNumber);
+#endif
   }
+
+  if (isUnlinked) {
+    return std::nullopt;
+  }
+  // If the inode is not loaded, return its parent's path as long as it's
+  // parent isn't the root
+  if (parent == kRootNodeId) {
+    // The parent is the Eden mount root, just return its name (base case)
+    return RelativePath(*name);
+  }
+  auto dir = getPathForInodeHelper(parent, data);
+  if (!dir) {
+    EDEN_BUG() << "unlinked parent inode " << parent
+               << "appears to contain non-unlinked child " << inodeNumber;
+  }
+  return *dir + *name;
 }
 
 void InodeMap::decFsRefcount(InodeNumber number, uint32_t count) {
-  auto data = data_.wlock();
-
   if (folly::kIsWindows) {
     XDCHECK_EQ(count, 1u);
   }
 
-  // First check in the loaded inode map
-  auto loadedIter = data->loadedInodes_.find(number);
-  if (loadedIter != data->loadedInodes_.end()) {
-    // Acquire an InodePtr, so that we are always holding a pointer reference
-    // on the inode when we decrement the fs refcount.
-    //
-    // This ensures that onInodeUnreferenced() will be processed at some point
-    // after decrementing the FS refcount to 0, even if there were no
-    // outstanding pointer references before this.
-    auto inode = loadedIter->second.getPtr();
-    // Now release our lock before decrementing the inode's FS reference
-    // count and immediately releasing our pointer reference.
+  // First check in the loaded inode map.
+  //
+  // Acquire an InodePtr, so that we are always holding a pointer reference
+  // on the inode when we decrement the fs refcount.
+  //
+  // This ensures that onInodeUnreferenced() will be processed at some point
+  // after decrementing the FS refcount to 0, even if there were no
+  // outstanding pointer references before this.
+  //
+  // The shard lock is released before decrementing the inode's FS reference
+  // count and immediately releasing our pointer reference.
+  if (auto inode = findLoadedInode(number)) {
+    inode->decFsRefcount(count);
+    return;
+  }
+
+  auto data = data_.wlock();
+
+  // The inode may have been loaded since we checked.
+  if (auto inode = findLoadedInode(number)) {
     data.unlock();
     inode->decFsRefcount(count);
     return;
   }
 
   // If it wasn't loaded, it should be in the unloaded map
+  copyFromSnapshot(data, number);
   auto unloadedIter = data->unloadedInodes_.find(number);
   if (UNLIKELY(unloadedIter == data->unloadedInodes_.end())) {
     EDEN_BUG() << "InodeMap::decFsRefcount() called on unknown inode number "
@@ -598,7 +736,7 @@ void InodeMap::decFsRefcount(InodeNumber number, uint32_t count) {
   if (unloadedEntry.numFsReferences == 0) {
     // We can completely forget about this unloaded inode now.
     XLOG(DBG5) << "forgetting unloaded inode " << number << ": "
-               << unloadedEntry.parent << ":" << unloadedEntry.name;
+               << unloadedEntry.parent << ":" << unloadedEntry.getName();
     data->unloadedInodes_.erase(unloadedIter);
   }
 }
@@ -619,11 +757,12 @@ Future<SerializedInodeMap> InodeMap::shutdown(
         << "shutdown() invoked more than once on InodeMap for "
         << mount_->getPath();
     data->shutdownPromise.emplace(Promise<Unit>{});
+    shuttingDown_.store(true, std::memory_order_release);
     future = data->shutdownPromise->getFuture();
 
     XLOG(DBG3) << "starting InodeMap::shutdown: loadedCount="
-               << data->loadedInodes_.size()
-               << " unloadedCount=" << data->unloadedInodes_.size();
+               << getLoadedInodeCount()
+               << " unloadedCount=" << data->getUnloadedInodeCount();
   }
 
   // If an error occurs during mount point initialization, shutdown() can be
@@ -660,19 +799,19 @@ Future<SerializedInodeMap> InodeMap::shutdown(
     // to them, then let the normal pointer release process be responsible for
     // unloading them.
     std::vector<InodePtr> inodesToUnload;
-    auto data = data_.wlock();
-    for (const auto& entry : data->loadedInodes_) {
-      if (!entry.second->isPtrAcquireCountZero()) {
-        continue;
+    for (auto& lockedShard : loadedShards_) {
+      auto shard = lockedShard.wlock();
+      for (const auto& entry : shard->loadedInodes_) {
+        if (!entry.second->isPtrAcquireCountZero()) {
+          continue;
+        }
+        if (!entry.second->isUnlinked()) {
+          continue;
+        }
+        inodesToUnload.push_back(entry.second.getPtr());
       }
-      if (!entry.second->isUnlinked()) {
-        continue;
-      }
-      inodesToUnload.push_back(entry.second.getPtr());
     }
-    // Release the lock, then release all of our InodePtrs to unload
-    // the inodes.
-    data.unlock();
+    // Release all of our InodePtrs, with no lock held, to unload the inodes.
     inodesToUnload.clear();
   }
 
@@ -700,32 +839,46 @@ Future<SerializedInodeMap> InodeMap::shutdown(
     }
 
     auto data = data_.wlock();
+    auto loadedCount = getLoadedInodeCount();
     XLOG(DBG3)
         << "InodeMap::shutdown after releasing inodesToClear: loadedCount="
-        << data->loadedInodes_.size()
-        << " unloadedCount=" << data->unloadedInodes_.size();
+        << loadedCount << " unloadedCount=" << data->getUnloadedInodeCount();
 
-    if (data->loadedInodes_.size() != 1) {
-      EDEN_BUG() << "After InodeMap::shutdown() finished, "
-                 << data->loadedInodes_.size()
+    if (loadedCount != 1) {
+      EDEN_BUG() << "After InodeMap::shutdown() finished, " << loadedCount
                  << " inodes still loaded; they must all (except the root) "
                  << "have been unloaded for this to succeed!";
     }
 
     SerializedInodeMap result;
-    result.unloadedInodes_ref()->reserve(data->unloadedInodes_.size());
+    result.unloadedInodes_ref()->reserve(data->getUnloadedInodeCount());
     for (const auto& [inodeNumber, entry] : data->unloadedInodes_) {
       SerializedInodeMapEntry serializedEntry;
 
       XLOG(DBG5) << "  serializing unloaded inode " << inodeNumber
-                 << " parent=" << entry.parent.get() << " name=" << entry.name;
+                 << " parent=" << entry.parent.get()
+                 << " name=" << entry.getName();
 
       serializedEntry.inodeNumber_ref() = inodeNumber.get();
       serializedEntry.parentInode_ref() = entry.parent.get();
-      serializedEntry.name_ref() = entry.name.stringPiece().str();
+      serializedEntry.name_ref() = entry.getName().stringPiece().str();
+      serializedEntry.isUnlinked_ref() = entry.isUnlinked;
+      serializedEntry.numFsReferences_ref() = entry.numFsReferences;
+      serializedEntry.hash_ref() = thriftHash(entry.getHash());
+      serializedEntry.mode_ref() = entry.mode;
+
+      result.unloadedInodes_ref()->emplace_back(std::move(serializedEntry));
+    }
+    // The entries never copied out of the snapshot are handed over as is.
+    for (const auto& [inodeNumber, index] : data->snapshotIndex_) {
+      auto entry = (*data->snapshot_)[index];
+      SerializedInodeMapEntry serializedEntry;
+      serializedEntry.inodeNumber_ref() = inodeNumber.get();
+      serializedEntry.parentInode_ref() = entry.parentInode;
+      serializedEntry.name_ref() = entry.name.str();
       serializedEntry.isUnlinked_ref() = entry.isUnlinked;
       serializedEntry.numFsReferences_ref() = entry.numFsReferences;
-      serializedEntry.hash_ref() = thriftHash(entry.hash);
+      serializedEntry.hash_ref() = entry.hash.str();
       serializedEntry.mode_ref() = entry.mode;
 
       result.unloadedInodes_ref()->emplace_back(std::move(serializedEntry));
@@ -754,7 +907,7 @@ void InodeMap::shutdownComplete(
 }
 
 bool InodeMap::isInodeRemembered(InodeNumber ino) const {
-  return data_.rlock()->unloadedInodes_.count(ino) > 0;
+  return data_.rlock()->isUnloadedInodeRemembered(ino);
 }
 
 void InodeMap::onInodeUnreferenced(
@@ -762,8 +915,19 @@ void InodeMap::onInodeUnreferenced(
     ParentInodeInfo&& parentInfo) {
   XLOG(DBG8) << "inode " << inode->getNodeId()
              << " unreferenced: " << inode->getLogPath();
-  // Acquire our lock.
-  auto data = data_.wlock();
+
+  // The inode can only be unloaded below when shutting down or when it is
+  // unlinked, only acquire the data_ lock in these cases so that releasing the
+  // last reference to an inode that stays loaded only needs its shard lock.
+  //
+  // The parent's contents lock is held by parentInfo: if shutdown() starts
+  // after we read shuttingDown_, its walk of the tree will unload this inode.
+  auto data = folly::Synchronized<Members>::LockedPtr{};
+  if (parentInfo.isUnlinked() ||
+      shuttingDown_.load(std::memory_order_acquire)) {
+    data = data_.wlock();
+  }
+  auto shard = getLoadedShard(inode->getNodeId()).wlock();
 
   // Decrement the Inode's acquire count
   auto acquireCount = inode->decPtrAcquireCount();
@@ -775,12 +939,13 @@ void InodeMap::onInodeUnreferenced(
 
   // Decide if we should unload the inode now, or wait until later.
   bool unloadNow = false;
-  bool shuttingDown = data->shutdownPromise.has_value();
+  bool shuttingDown = data && data->shutdownPromise.has_value();
   XDCHECK(shuttingDown || inode != root_.get());
   if (shuttingDown) {
     // Check to see if this was the root inode that got unloaded.
     // This indicates that the shutdown is complete.
     if (inode == root_.get()) {
+      shard.unlock();
       shutdownComplete(std::move(data));
       return;
     }
@@ -788,7 +953,8 @@ void InodeMap::onInodeUnreferenced(
     // Always unload Inode objects immediately when shutting down.
     // We can't destroy the EdenMount until all inodes get unloaded.
     unloadNow = true;
-  } else if (parentInfo.isUnlinked() && inode->getFsRefcount() == 0) {
+  } else if (
+      data && parentInfo.isUnlinked() && inode->getFsRefcount() == 0) {
     // This inode has been unlinked and has no outstanding FS references.
     // This inode can now be completely destroyed and forgotten about.
     unloadNow = true;
@@ -805,7 +971,8 @@ void InodeMap::onInodeUnreferenced(
         parentInfo.getParent().get(),
         parentInfo.getName(),
         parentInfo.isUnlinked(),
-        data);
+        data,
+        *shard);
     if (!parentInfo.isUnlinked()) {
       const auto& parentContents = parentInfo.getParentContents();
       auto it = parentContents->entries.find(parentInfo.getName());
@@ -819,7 +986,10 @@ void InodeMap::onInodeUnreferenced(
   // Deleting it may cause its parent TreeInode to become unreferenced, causing
   // another recursive call to onInodeUnreferenced(), which will need to
   // reacquire the lock.
-  data.unlock();
+  shard.unlock();
+  if (data) {
+    data.unlock();
+  }
   parentInfo.reset();
   if (unloadNow) {
     delete inode;
@@ -827,7 +997,13 @@ void InodeMap::onInodeUnreferenced(
 }
 
 InodeMapLock InodeMap::lockForUnload() {
-  return InodeMapLock{data_.wlock()};
+  auto data = data_.wlock();
+  std::vector<LoadedShardLock> shards;
+  shards.reserve(kNumLoadedShards);
+  for (auto& shard : loadedShards_) {
+    shards.push_back(shard.wlock());
+  }
+  return InodeMapLock{std::move(data), std::move(shards)};
 }
 
 void InodeMap::unloadInode(
@@ -836,7 +1012,8 @@ void InodeMap::unloadInode(
     PathComponentPiece name,
     bool isUnlinked,
     const InodeMapLock& lock) {
-  return unloadInode(inode, parent, name, isUnlinked, lock.data_);
+  auto& shard = lock.shards_[inode->getNodeId().get() % kNumLoadedShards];
+  return unloadInode(inode, parent, name, isUnlinked, lock.data_, *shard);
 }
 
 void InodeMap::unloadInode(
@@ -844,7 +1021,8 @@ void InodeMap::unloadInode(
     TreeInode* parent,
     PathComponentPiece name,
     bool isUnlinked,
-    const folly::Synchronized<Members>::LockedPtr& data) {
+    const folly::Synchronized<Members>::LockedPtr& data,
+    LoadedInodeShard& shard) {
   // Call updateOverlayForUnload() to update the overlay and compute
   // if we need to remember an UnloadedInode entry.
   auto unloadedEntry =
@@ -858,13 +1036,13 @@ void InodeMap::unloadInode(
     XCHECK(ret.second);
   }
 
-  auto numErased = data->loadedInodes_.erase(inode->getNodeId());
+  auto numErased = shard.loadedInodes_.erase(inode->getNodeId());
   XCHECK_EQ(numErased, 1u) << "inconsistent loaded inodes data: "
                            << inode->getLogPath();
   if (inode->getType() == dtype_t::Dir) {
-    --data->numTreeInodes_;
+    --shard.numTreeInodes_;
   } else {
-    --data->numFileInodes_;
+    --shard.numFileInodes_;
   }
 }
 
@@ -927,7 +1105,12 @@ optional<InodeMap::UnloadedInode> InodeMap::updateOverlayForUnload(
                  << " with Fs refcount=" << fsCount << ": "
                  << inode->getLogPath();
       return UnloadedInode(
-          parent, name, isUnlinked, treeContents.treeHash, fsCount);
+          data->names_,
+          parent,
+          name,
+          isUnlinked,
+          treeContents.treeHash,
+          fsCount);
     }
 
     // If any of this inode's childrens are in unloadedInodes_, then this
@@ -935,12 +1118,17 @@ optional<InodeMap::UnloadedInode> InodeMap::updateOverlayForUnload(
     for (const auto& pair : treeContents.entries) {
       const auto& childName = pair.first;
       const auto& entry = pair.second;
-      if (data->unloadedInodes_.count(entry.getInodeNumber())) {
+      if (data->isUnloadedInodeRemembered(entry.getInodeNumber())) {
         XLOG(DBG5) << "remembering inode " << asTree->getNodeId() << " ("
                    << asTree->getLogPath() << ") because its child "
                    << childName << " was remembered";
         return UnloadedInode(
-            parent, name, isUnlinked, treeContents.treeHash, fsCount);
+            data->names_,
+            parent,
+            name,
+            isUnlinked,
+            treeContents.treeHash,
+            fsCount);
       }
     }
     return std::nullopt;
@@ -951,7 +1139,8 @@ optional<InodeMap::UnloadedInode> InodeMap::updateOverlayForUnload(
                  << " with FS refcount=" << fsCount << ": "
                  << inode->getLogPath();
       auto* asFile = boost::polymorphic_downcast<FileInode*>(inode);
-      return UnloadedInode(asFile, parent, name, isUnlinked, fsCount);
+      return UnloadedInode(
+          data->names_, asFile, parent, name, isUnlinked, fsCount);
     } else {
       XLOG(DBG5) << "forgetting unreferenced file inode " << inode->getNodeId()
                  << " : " << inode->getLogPath();
@@ -967,10 +1156,11 @@ bool InodeMap::shouldLoadChild(
     folly::Promise<InodePtr> promise) {
   auto data = data_.wlock();
   UnloadedInode* unloadedData{nullptr};
+  copyFromSnapshot(data, childInode);
   auto iter = data->unloadedInodes_.find(childInode);
   if (iter == data->unloadedInodes_.end()) {
     InodeNumber parentNumber = parent->getNodeId();
-    auto newUnloadedData = UnloadedInode(parentNumber, name);
+    auto newUnloadedData = UnloadedInode(data->names_, parentNumber, name);
     auto ret =
         data->unloadedInodes_.emplace(childInode, std::move(newUnloadedData));
     XDCHECK(ret.second);
@@ -979,10 +1169,10 @@ bool InodeMap::shouldLoadChild(
     unloadedData = &iter->second;
   }
 
-  bool isFirstPromise = unloadedData->promises.empty();
+  bool isFirstPromise = !unloadedData->isLoading();
 
   // Add the promise to the existing list for this inode.
-  unloadedData->promises.push_back(std::move(promise));
+  unloadedData->addPromise() = std::move(promise);
 
   // If this is the very first promise then tell the caller they need
   // to start the load operation.  Otherwise someone else (whoever added the
@@ -993,37 +1183,95 @@ bool InodeMap::shouldLoadChild(
 void InodeMap::inodeCreated(const InodePtr& inode) {
   XLOG(DBG4) << "created new inode " << inode->getNodeId() << ": "
              << inode->getLogPath();
-  auto data = data_.wlock();
-  insertLoadedInode(data, inode.get());
+  // A newly created inode was never in unloadedInodes_, only its shard needs
+  // to be locked.
+  insertLoadedInode(*getLoadedShard(inode->getNodeId()).wlock(), inode.get());
 }
 
 InodeMap::InodeCounts InodeMap::getInodeCounts() const {
   InodeCounts counts;
-  auto data = data_.rlock();
-  XDCHECK_EQ(
-      data->numTreeInodes_ + data->numFileInodes_, data->loadedInodes_.size());
-  counts.treeCount = data->numTreeInodes_;
-  counts.fileCount = data->numFileInodes_;
-  counts.unloadedInodeCount = data->unloadedInodes_.size();
+  for (const auto& lockedShard : loadedShards_) {
+    auto shard = lockedShard.rlock();
+    XDCHECK_EQ(
+        shard->numTreeInodes_ + shard->numFileInodes_,
+        shard->loadedInodes_.size());
+    counts.treeCount += shard->numTreeInodes_;
+    counts.fileCount += shard->numFileInodes_;
+  }
+  counts.unloadedInodeCount = data_.rlock()->getUnloadedInodeCount();
   return counts;
 }
 
-std::vector<InodeNumber> InodeMap::getReferencedInodes() const {
-  std::vector<InodeNumber> inodes;
+InodeMap::MemoryUsage InodeMap::estimateMemoryUsage() const {
+  // Each node of a std::unordered_map has a next pointer and the hash of its
+  // key, and the map has about one bucket pointer per node.
+  constexpr size_t kNodeOverhead = 3 * sizeof(void*);
+  MemoryUsage usage;
+
+  std::vector<InodePtr> inodes;
+  for (const auto& lockedShard : loadedShards_) {
+    auto shard = lockedShard.rlock();
+    usage.inodeMapBytes += shard->loadedInodes_.size() *
+        (sizeof(decltype(shard->loadedInodes_)::value_type) + kNodeOverhead);
+    for (const auto& [number, loadedInode] : shard->loadedInodes_) {
+      inodes.push_back(loadedInode.getPtr());
+    }
+  }
+
   {
     auto data = data_.rlock();
+    usage.unloadedInodeBytes = data->unloadedInodes_.getAllocatedMemorySize() +
+        data->names_.estimateMemoryUsage();
+#ifndef _WIN32
+    usage.unloadedInodeBytes += data->snapshotIndex_.getAllocatedMemorySize();
+#endif
+    for (const auto& [number, unloadedInode] : data->unloadedInodes_) {
+      if (unloadedInode.promises) {
+        usage.unloadedInodeBytes += sizeof(PromiseVector) +
+            unloadedInode.promises->capacity() *
+                sizeof(PromiseVector::value_type);
+      }
+    }
+    usage.inodeMapBytes += usage.unloadedInodeBytes;
+  }
 
-    for (auto& kv : data->loadedInodes_) {
-      auto& loadedInode = kv.second;
+  // The inode locks are acquired before the InodeMap locks, so the inodes
+  // are only inspected once those are released.
+  for (const auto& inode : inodes) {
+    if (auto* tree = inode.asTreeOrNull()) {
+      usage.treeInodeBytes += tree->estimateMemoryUsage();
+    } else {
+      usage.fileInodeBytes += inode.asFileOrNull()->estimateMemoryUsage();
+    }
+  }
+  return usage;
+}
+
+std::vector<InodeNumber> InodeMap::getReferencedInodes() const {
+  std::vector<InodeNumber> inodes;
+  {
+    for (const auto& lockedShard : loadedShards_) {
+      auto shard = lockedShard.rlock();
+      for (auto& kv : shard->loadedInodes_) {
+        auto& loadedInode = kv.second;
 
-      inodes.push_back(loadedInode->getNodeId());
+        inodes.push_back(loadedInode->getNodeId());
+      }
     }
 
+    auto data = data_.rlock();
     for (const auto& [ino, unloadedInode] : data->unloadedInodes_) {
       if (unloadedInode.numFsReferences > 0) {
         inodes.push_back(ino);
       }
     }
+#ifndef _WIN32
+    for (const auto& [ino, index] : data->snapshotIndex_) {
+      if ((*data->snapshot_)[index].numFsReferences > 0) {
+        inodes.push_back(ino);
+      }
+    }
+#endif
   }
 
   return inodes;
@@ -8,16 +8,21 @@
 #pragma once
 
 #include <folly/Synchronized.h>
+#include <folly/container/F14Map.h>
 #include <folly/futures/Future.h>
+#include <array>
+#include <atomic>
 #include <list>
 #include <memory>
 #include <optional>
 #include <unordered_map>
 
+#include "eden/fs/inodes/InodeNameTable.h"
 #include "eden/fs/inodes/InodeNumber.h"
 #include "eden/fs/inodes/InodePtr.h"
 #include "eden/fs/inodes/Overlay.h"
 #include "eden/fs/model/Hash.h"
+#include "eden/fs/takeover/InodeMapSnapshot.h"
 #include "eden/fs/takeover/gen-cpp2/takeover_types.h"
 #include "eden/fs/utils/ImmediateFuture.h"
 #include "eden/fs/utils/PathFuncs.h"
@@ -92,6 +97,18 @@ class InodeMapLock;
  *
  *   We currently always allocate a InodeNumber value for any new Inode object
  *   even if it is not needed yet by the FUSE APIs.
+ *
+ * Locking:
+ * - The loaded inodes are split into shards based on their InodeNumber, each
+ *   protected by its own lock. Looking up an already loaded inode only
+ *   acquires its shard lock in shared mode, so concurrent lookups of loaded
+ *   inodes don't serialize on a single lock.
+ * - The unloaded inodes and the shutdown state are protected by the data_
+ *   lock, which is only needed when an inode is loaded, unloaded or
+ *   forgotten.
+ * - data_ must be acquired before any shard lock, and only one shard lock is
+ *   held at a time, except by lockForUnload() which acquires all of them in
+ *   increasing order.
  */
 class InodeMap {
  public:
@@ -128,6 +145,22 @@ class InodeMap {
       TreeInodePtr root,
       const SerializedInodeMap& takeover);
 
+#ifndef _WIN32
+  /**
+   * Initialize the InodeMap from a snapshot handed over from a process being
+   * taken over.
+   *
+   * Only an index of the snapshot's inode numbers is built here, an entry is
+   * copied into the map the first time its inode is needed. The InodeMap
+   * keeps the snapshot mapped until then.
+   *
+   * This method has the same constraints and concerns as initialize().
+   */
+  void initializeFromSnapshot(
+      TreeInodePtr root,
+      std::shared_ptr<const InodeMapSnapshot> snapshot);
+#endif
+
   /**
    * Initialize the InodeMap from the content of the overlay.
    *
@@ -285,6 +318,11 @@ class InodeMap {
    * unloading.  It should only be called *after* acquring the TreeInode
    * contents lock.
    *
+   * This acquires the data_ lock and all the shard locks: callers check
+   * isPtrAcquireCountZero() on the inodes before unloading them, which
+   * requires that no new reference can be acquired through lookupInode() in
+   * the meantime.
+   *
    * This is an internal API that should not be used by most callers.
    */
   InodeMapLock lockForUnload();
@@ -385,6 +423,24 @@ class InodeMap {
    */
   InodeCounts getInodeCounts() const;
 
+  struct MemoryUsage {
+    /** The entries of the loaded and unloaded inodes. */
+    size_t inodeMapBytes = 0;
+    /** The part of inodeMapBytes used by the unloaded inodes. */
+    size_t unloadedInodeBytes = 0;
+    /** The loaded TreeInodes and their directory entries. */
+    size_t treeInodeBytes = 0;
+    /** The loaded FileInodes and their state. */
+    size_t fileInodeBytes = 0;
+  };
+
+  /**
+   * Estimate the memory used by the InodeMap and the loaded inodes. This
+   * visits every loaded inode and takes its lock, so it is meant for stats
+   * rather than for frequent use.
+   */
+  MemoryUsage estimateMemoryUsage() const;
+
   /*
    * Return all referenced inodes (loaded and unloaded inodes whose
    * fs references is greater than zero).
@@ -396,10 +452,19 @@ class InodeMap {
 
   /**
    * Data about an unloaded inode.
+   *
+   * Millions of these can be remembered after a large crawl, for as long as
+   * the kernel references the inodes, so they are kept small: the name is
+   * interned in the Members' name table, the hash is stored inline, and the
+   * promises are only allocated while the inode is loading.
    */
   struct UnloadedInode {
-    UnloadedInode(InodeNumber parentNum, PathComponentPiece entryName);
     UnloadedInode(
+        InodeNameTable& names,
+        InodeNumber parentNum,
+        PathComponentPiece entryName);
+    UnloadedInode(
+        InodeNameTable& names,
         InodeNumber parentNum,
         PathComponentPiece entryName,
         bool isUnlinked,
@@ -407,49 +472,71 @@ class InodeMap {
         std::optional<Hash> hash,
         uint32_t fsRefcount);
     UnloadedInode(
+        InodeNameTable& names,
         TreeInode* parent,
         PathComponentPiece entryName,
         bool isUnlinked,
         std::optional<Hash> hash,
         uint32_t fsRefcount);
     UnloadedInode(
+        InodeNameTable& names,
         FileInode* inode,
         TreeInode* parent,
         PathComponentPiece entryName,
         bool isUnlinked,
         uint32_t fsRefcount);
 
-    InodeNumber const parent;
-    PathComponent const name;
-
-    /**
-     * A boolean indicating if this inode is unlinked.
-     */
-    bool const isUnlinked{false};
-
-    /** The complete st_mode value for this entry */
-    mode_t const mode{0};
+    PathComponentPiece getName() const {
+      return name.piece();
+    }
 
     /**
      * If the entry is not materialized, this contains the hash
      * identifying the source control Tree (if this is a directory) or Blob
      * (if this is a file) that contains the entry contents.
      *
-     * If the entry is materialized, this field is not set.
+     * If the entry is materialized, this is std::nullopt.
      */
-    std::optional<Hash> const hash;
+    std::optional<Hash> getHash() const {
+      return hasHash ? std::optional<Hash>{hash} : std::nullopt;
+    }
 
     /**
-     * A list of promises waiting on this inode to be loaded.
-     *
-     * If this list is non-empty then the inode is currently in the process of
-     * being loaded.
+     * Whether the inode is currently in the process of being loaded.
+     */
+    bool isLoading() const {
+      return promises && !promises->empty();
+    }
+
+    /**
+     * Add a promise to be fulfilled once the inode is loaded.
+     */
+    folly::Promise<InodePtr>& addPromise();
+
+    /**
+     * Remove the promises waiting on the inode to be loaded.
+     */
+    PromiseVector takePromises();
+
+    InodeNumber const parent;
+    InodeNameTable::Name name;
+
+    /**
+     * A list of promises waiting on this inode to be loaded, allocated
+     * while it is loading.
      *
      * (We could use folly::SharedPromise here instead, but it has extra
      * overhead that we don't really need.  It performs its own locking, but we
      * are already protected by the data_ lock.)
      */
-    PromiseVector promises;
+    std::unique_ptr<PromiseVector> promises;
+
+    /** The source control hash, if hasHash is set. */
+    Hash const hash;
+
+    /** The complete st_mode value for this entry */
+    mode_t const mode{0};
+
     /**
      * The number of times we have returned this inode number to FUSE via
      * lookup() calls that have not yet been released with a corresponding
@@ -457,6 +544,13 @@ class InodeMap {
      * placeholder for that inode that hasn't been invalided.
      */
     uint32_t numFsReferences{0};
+
+    /**
+     * A boolean indicating if this inode is unlinked.
+     */
+    bool const isUnlinked{false};
+
+    bool const hasHash{false};
   };
 
   struct LoadedInode {
@@ -473,7 +567,7 @@ class InodeMap {
 
     InodePtr getPtr() const {
       // Calling InodePtr::newPtrLocked is safe because interacting with
-      // LoadedInode implies the data_ lock is held.
+      // LoadedInode implies the lock of its shard is held.
       return InodePtr::newPtrLocked(inode_);
     }
 
@@ -492,9 +586,9 @@ class InodeMap {
     InodeBase* inode_{nullptr};
   };
 
-  struct Members {
+  struct LoadedInodeShard {
     /**
-     * The map of loaded inodes
+     * The map of loaded inodes of this shard.
      *
      * This map stores raw pointers rather than InodePtr objects.  The InodeMap
      * itself does not hold a reference to the Inode objects.  When an Inode is
@@ -503,19 +597,6 @@ class InodeMap {
      */
     std::unordered_map<InodeNumber, LoadedInode> loadedInodes_;
 
-    /**
-     * The map of currently unloaded inodes
-     */
-    std::unordered_map<InodeNumber, UnloadedInode> unloadedInodes_;
-
-    /**
-     * Indicates if the FS mount point has been unmounted.
-     *
-     * If this is true then the FS refcount on all inodes should be treated
-     * as 0, and we can forget all inodes while shutting down.
-     */
-    bool isUnmounted_{false};
-
     /**
      * The number of loaded TreeInode objects
      */
@@ -529,6 +610,64 @@ class InodeMap {
      * hold true to make sure our calculations are correct.
      */
     size_t numFileInodes_{0};
+  };
+
+  using LoadedShardLock = folly::Synchronized<LoadedInodeShard>::LockedPtr;
+
+  struct Members {
+    /**
+     * The names of the unloaded inodes. Declared first so that it outlives
+     * the entries of unloadedInodes_.
+     */
+    InodeNameTable names_;
+
+    /**
+     * The map of currently unloaded inodes, stored inline in the map's
+     * table rather than in a node per inode.
+     */
+    folly::F14ValueMap<InodeNumber, UnloadedInode> unloadedInodes_;
+
+#ifndef _WIN32
+    /**
+     * The inode map handed over at takeover, see initializeFromSnapshot().
+     */
+    std::shared_ptr<const InodeMapSnapshot> snapshot_;
+
+    /**
+     * The index in snapshot_ of the unloaded inodes not yet copied into
+     * unloadedInodes_. An inode number is never in both.
+     */
+    folly::F14FastMap<InodeNumber, size_t> snapshotIndex_;
+#endif
+
+    /**
+     * Whether the inode is unloaded but still remembered, whether it was
+     * already copied out of the snapshot or not.
+     */
+    bool isUnloadedInodeRemembered(InodeNumber ino) const {
+#ifndef _WIN32
+      if (snapshotIndex_.count(ino) > 0) {
+        return true;
+      }
+#endif
+      return unloadedInodes_.count(ino) > 0;
+    }
+
+    size_t getUnloadedInodeCount() const {
+#ifndef _WIN32
+      return unloadedInodes_.size() + snapshotIndex_.size();
+#else
+      return unloadedInodes_.size();
+#endif
+    }
+
+    /**
+     * Indicates if the FS mount point has been unmounted.
+     *
+     * If this is true then the FS refcount on all inodes should be treated
+     * as 0, and we can forget all inodes while shutting down.
+     */
+    bool isUnmounted_{false};
 
     /**
      * A promise to fulfill once shutdown() completes.
@@ -547,6 +686,29 @@ class InodeMap {
   InodeMap(InodeMap const&) = delete;
   InodeMap& operator=(InodeMap const&) = delete;
 
+  /**
+   * Number of shards the loaded inodes are split into.
+   */
+  static constexpr size_t kNumLoadedShards = 32;
+
+  folly::Synchronized<LoadedInodeShard>& getLoadedShard(InodeNumber number) {
+    return loadedShards_[number.get() % kNumLoadedShards];
+  }
+  const folly::Synchronized<LoadedInodeShard>& getLoadedShard(
+      InodeNumber number) const {
+    return loadedShards_[number.get() % kNumLoadedShards];
+  }
+
+  /**
+   * Lookup an inode in the loaded shards, returns nullptr if it isn't loaded.
+   */
+  InodePtr findLoadedInode(InodeNumber number) const;
+
+  /**
+   * Total number of loaded inodes, this locks each shard in turn.
+   */
+  size_t getLoadedInodeCount() const;
+
   void shutdownComplete(folly::Synchronized<Members>::LockedPtr&& data);
 
   void setupParentLookupPromise(
@@ -577,21 +739,31 @@ class InodeMap {
       InodeNumber inodeNumber,
       const folly::Synchronized<Members>::RLockedPtr& data);
 
+  /**
+   * If the unloaded inode is still only in the takeover snapshot, copy it
+   * into unloadedInodes_. Returns true if it was copied, which may move the
+   * other entries of unloadedInodes_.
+   */
+  bool copyFromSnapshot(
+      const folly::Synchronized<Members>::LockedPtr& data,
+      InodeNumber number);
+
   /**
    * Unload an inode
    *
-   * This simply removes it from the loadedInodes_ map and, if it is still
-   * referenced by the FS, adds it to the unloadedInodes_ map.
+   * This simply removes it from the loadedInodes_ map of its shard and, if it
+   * is still referenced by the FS, adds it to the unloadedInodes_ map.
    *
    * The caller is responsible for actually deleting the Inode object after
-   * releasing the InodeMap lock.
+   * releasing the InodeMap locks.
    */
   void unloadInode(
       InodeBase* inode,
       TreeInode* parent,
       PathComponentPiece name,
       bool isUnlinked,
-      const folly::Synchronized<Members>::LockedPtr& lock);
+      const folly::Synchronized<Members>::LockedPtr& lock,
+      LoadedInodeShard& shard);
 
   /**
    * Update the overlay data for an inode before unloading it.
@@ -607,9 +779,7 @@ class InodeMap {
       bool isUnlinked,
       const folly::Synchronized<Members>::LockedPtr& lock);
 
-  void insertLoadedInode(
-      const folly::Synchronized<Members>::LockedPtr& data,
-      InodeBase* inode);
+  void insertLoadedInode(LoadedInodeShard& shard, InodeBase* inode);
 
   /**
    * Verify the InodeMap precondition and initialize the root_ member.
@@ -647,15 +817,34 @@ class InodeMap {
    */
   TreeInodePtr root_;
 
+  /**
+   * Whether shutdown() has been called.
+   *
+   * This mirrors data_->shutdownPromise so that onInodeUnreferenced() can tell
+   * whether it may need to unload the inode before deciding to acquire the
+   * data_ lock. It is only written while holding the data_ lock.
+   */
+  std::atomic<bool> shuttingDown_{false};
+
+  /**
+   * The loaded inodes, sharded by InodeNumber.
+   *
+   * The same rules as for data_ apply, and no other lock may be acquired
+   * while holding a shard lock.
+   */
+  std::array<folly::Synchronized<LoadedInodeShard>, kNumLoadedShards>
+      loadedShards_;
+
   /**
    * The locked data.
    *
    * Note: be very careful to hold this lock only when necessary.  No other
-   * locks should be acquired when holding this lock.  In particular this means
-   * that we should never access any InodeBase objects while holding the lock,
-   * since we should not hold our lock while an InodeBase acquires its own
-   * internal lock.  (This makes it safe for InodeBase to perform operations on
-   * the InodeMap while holding their own lock.)
+   * locks than the shard locks should be acquired when holding this lock.  In
+   * particular this means that we should never access any InodeBase objects
+   * while holding the lock, since we should not hold our lock while an
+   * InodeBase acquires its own internal lock.  (This makes it safe for
+   * InodeBase to perform operations on the InodeMap while holding their own
+   * lock.)
    */
   folly::Synchronized<Members> data_;
 };
@@ -669,17 +858,20 @@ class InodeMap {
  */
 class InodeMapLock {
  public:
-  explicit InodeMapLock(
-      folly::Synchronized<InodeMap::Members>::LockedPtr&& data)
-      : data_(std::move(data)) {}
+  InodeMapLock(
+      folly::Synchronized<InodeMap::Members>::LockedPtr&& data,
+      std::vector<InodeMap::LoadedShardLock>&& shards)
+      : data_(std::move(data)), shards_(std::move(shards)) {}
 
   void unlock() {
+    shards_.clear();
     data_.unlock();
   }
 
  private:
   friend class InodeMap;
   folly::Synchronized<InodeMap::Members>::LockedPtr data_;
+  std::vector<InodeMap::LoadedShardLock> shards_;
 };
 } // namespace eden
 } // namespace facebook
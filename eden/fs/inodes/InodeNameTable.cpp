@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/InodeNameTable.h"
+
+#include <folly/logging/xlog.h>
+
+#include "eden/fs/utils/Memory.h"
+
+namespace facebook {
+namespace eden {
+
+InodeNameTable::Name& InodeNameTable::Name::operator=(Name&& other) noexcept {
+  if (this != &other) {
+    if (node_) {
+      node_->table->release(node_);
+    }
+    node_ = other.node_;
+    other.node_ = nullptr;
+  }
+  return *this;
+}
+
+InodeNameTable::Name::~Name() {
+  if (node_) {
+    node_->table->release(node_);
+  }
+}
+
+PathComponentPiece InodeNameTable::Name::piece() const {
+  XDCHECK(node_);
+  return node_->name;
+}
+
+InodeNameTable::Name InodeNameTable::intern(PathComponentPiece name) {
+  auto it = names_.find(name.stringPiece());
+  if (it == names_.end()) {
+    auto node = std::make_unique<Node>(this, name);
+    auto key = node->name.stringPiece();
+    it = names_.emplace(key, std::move(node)).first;
+  }
+  auto* node = it->second.get();
+  ++node->refcount;
+  return Name{node};
+}
+
+void InodeNameTable::release(Node* node) {
+  XDCHECK_GT(node->refcount, 0u);
+  if (--node->refcount == 0) {
+    // Erased by iterator, since the key refers to the node being destroyed.
+    names_.erase(names_.find(node->name.stringPiece()));
+  }
+}
+
+size_t InodeNameTable::estimateMemoryUsage() const {
+  size_t usage = names_.getAllocatedMemorySize();
+  for (const auto& [key, node] : names_) {
+    usage += sizeof(Node) + estimateIndirectMemoryUsage(node->name);
+  }
+  return usage;
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <folly/container/F14Map.h>
+#include <memory>
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Interns the names of the inodes the InodeMap remembers while they are
+ * unloaded. A large repository has many entries with the same name, such as
+ * "src" or "BUCK", which then share one copy.
+ *
+ * The table is not thread safe: the InodeMap only uses it, and the Names it
+ * returns, under its data_ lock. It must outlive its Names.
+ */
+class InodeNameTable {
+  struct Node;
+
+ public:
+  /**
+   * A reference to an interned name, the size of a pointer. The name is
+   * removed from the table once its last reference is destroyed.
+   */
+  class Name {
+   public:
+    Name(Name&& other) noexcept : node_{other.node_} {
+      other.node_ = nullptr;
+    }
+    Name& operator=(Name&& other) noexcept;
+    Name(const Name&) = delete;
+    Name& operator=(const Name&) = delete;
+    ~Name();
+
+    PathComponentPiece piece() const;
+
+   private:
+    friend class InodeNameTable;
+    explicit Name(Node* node) : node_{node} {}
+
+    Node* node_;
+  };
+
+  InodeNameTable() = default;
+  InodeNameTable(const InodeNameTable&) = delete;
+  InodeNameTable& operator=(const InodeNameTable&) = delete;
+
+  Name intern(PathComponentPiece name);
+
+  /**
+   * The number of distinct names in the table.
+   */
+  size_t size() const {
+    return names_.size();
+  }
+
+  size_t estimateMemoryUsage() const;
+
+ private:
+  struct Node {
+    Node(InodeNameTable* table, PathComponentPiece name)
+        : table{table}, name{name} {}
+
+    InodeNameTable* const table;
+    size_t refcount{0};
+    const PathComponent name;
+  };
+
+  void release(Node* node);
+
+  /**
+   * Keyed by the name each node holds, which does not move.
+   */
+  folly::F14FastMap<folly::StringPiece, std::unique_ptr<Node>> names_;
+};
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/InodePathCache.h"
+
+namespace facebook {
+namespace eden {
+
+InodePathCache::InodePathCache(size_t maxPaths) : maxPaths_{maxPaths} {}
+
+std::optional<InodeNumber> InodePathCache::get(RelativePathPiece path) const {
+  if (maxPaths_ == 0) {
+    return std::nullopt;
+  }
+  auto generation = getGeneration();
+  auto paths = paths_.rlock();
+  auto iter = paths->find(path.stringPiece());
+  if (iter == paths->end() || iter->second.generation != generation) {
+    return std::nullopt;
+  }
+  return iter->second.number;
+}
+
+void InodePathCache::insert(
+    RelativePathPiece path,
+    InodeNumber number,
+    uint64_t generation) {
+  if (maxPaths_ == 0) {
+    return;
+  }
+  auto paths = paths_.wlock();
+  // Entries of an older generation are never returned, so skip them.
+  if (generation != getGeneration()) {
+    return;
+  }
+  if (paths->size() >= maxPaths_) {
+    paths->clear();
+  }
+  paths->insert_or_assign(path.stringPiece().str(), Entry{number, generation});
+}
+
+} // namespace eden
+} // namespace facebook
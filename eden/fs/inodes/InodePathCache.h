@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/SharedMutex.h>
+#include <folly/Synchronized.h>
+#include <folly/container/F14Map.h>
+#include <atomic>
+#include <optional>
+#include <string>
+#include "eden/fs/inodes/InodeNumber.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Remembers the inode numbers that EdenMount::getInode() resolved paths to,
+ * so that repeated lookups of the same path skip the walk from the root.
+ *
+ * Rather than tracking which paths a change affects, any rename, unlink or
+ * checkout in the mount bumps a generation counter and thereby invalidates
+ * every path remembered before it.
+ *
+ * Once maxPaths paths are remembered the cache starts over. 0 disables it.
+ */
+class InodePathCache {
+ public:
+  explicit InodePathCache(size_t maxPaths);
+
+  /**
+   * The current generation. A lookup that started walking in it may insert
+   * its result once it is done.
+   */
+  uint64_t getGeneration() const {
+    return generation_.load(std::memory_order_acquire);
+  }
+
+  /**
+   * Forget all the remembered paths.
+   */
+  void invalidate() {
+    generation_.fetch_add(1, std::memory_order_acq_rel);
+  }
+
+  /**
+   * The inode number path resolved to, if it was resolved in the current
+   * generation.
+   */
+  std::optional<InodeNumber> get(RelativePathPiece path) const;
+
+  /**
+   * Remember that path resolved to number, unless the paths changed since
+   * generation.
+   */
+  void insert(RelativePathPiece path, InodeNumber number, uint64_t generation);
+
+ private:
+  struct Entry {
+    InodeNumber number;
+    uint64_t generation;
+  };
+
+  const size_t maxPaths_;
+  std::atomic<uint64_t> generation_{0};
+  folly::Synchronized<folly::F14FastMap<std::string, Entry>, folly::SharedMutex>
+      paths_;
+};
+
+} // namespace eden
+} // namespace facebook
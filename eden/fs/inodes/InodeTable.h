@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <folly/Synchronized.h>
+#include <folly/container/F14Map.h>
 #include <optional>
 #include "eden/fs/inodes/InodeMetadata.h"
 #include "eden/fs/inodes/InodeNumber.h"
@@ -88,12 +90,32 @@ class InodeTable {
 
   /**
    * Create or open an InodeTable at the specified path.
+   *
+   * With useHugePages, the table is mapped with transparent huge pages, see
+   * MappedDiskVector::adviseHugePages().
    */
   template <typename... OldRecords>
-  static std::unique_ptr<InodeTable> open(folly::StringPiece path) {
-    return std::unique_ptr<InodeTable>{
-        new InodeTable{MappedDiskVector<Entry>::template open<
-            detail::InodeTableEntry<OldRecords>...>(path, true)}};
+  static std::unique_ptr<InodeTable> open(
+      folly::StringPiece path,
+      bool useHugePages = false) {
+    auto storage = MappedDiskVector<Entry>::template open<
+        detail::InodeTableEntry<OldRecords>...>(path, true);
+    if (useHugePages) {
+      storage.adviseHugePages();
+    }
+    return std::unique_ptr<InodeTable>{new InodeTable{std::move(storage)}};
+  }
+
+  /**
+   * Write the records modified since the last flush back to the file, and
+   * wait for the writes to complete.
+   *
+   * The records can be read and modified during the flush, but no inode can
+   * be added or freed: adding one may grow the file and move its mapping,
+   * which must stay in place until msync returns.
+   */
+  void flush() {
+    state_.rlock()->storage.flush();
   }
 
   /**
@@ -166,6 +188,16 @@ class InodeTable {
     });
   }
 
+  /**
+   * Estimate the memory used by the records, which are mapped from the file,
+   * and by the index from inode number to record.
+   */
+  size_t estimateMemoryUsage() {
+    auto state = state_.rlock();
+    return state->storage.size() * sizeof(Entry) +
+        state->indices.getAllocatedMemorySize();
+  }
+
   /**
    * Calls a function that can modify the data at the given InodeNumber.  Throws
    * std::out_of_range if there is no record.
@@ -184,7 +216,6 @@ class InodeTable {
       auto index = iter->second;
       XCHECK_LT(index, state.storage.size());
       fn(state.storage[index].record);
-      // TODO: maybe trigger a background msync
       return state.storage[index].record;
     });
   }
@@ -326,7 +357,7 @@ class InodeTable {
     mutable MappedDiskVector<Entry> storage;
 
     /// Maintains an index from inode number to index in storage_.
-    std::unordered_map<InodeNumber, size_t> indices;
+    folly::F14FastMap<InodeNumber, size_t> indices;
   };
 
   folly::Synchronized<State> state_;
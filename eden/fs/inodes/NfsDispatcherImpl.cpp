@@ -54,23 +54,29 @@ ImmediateFuture<InodeNumber> NfsDispatcherImpl::getParent(
       });
 }
 
-ImmediateFuture<std::tuple<InodeNumber, struct stat>> NfsDispatcherImpl::lookup(
+ImmediateFuture<NfsDispatcher::LookupRes> NfsDispatcherImpl::lookup(
     InodeNumber dir,
     PathComponent name,
     ObjectFetchContext& context) {
   return inodeMap_->lookupTreeInode(dir)
       .thenValue([name = std::move(name), &context](const TreeInodePtr& inode) {
-        return inode->getOrLoadChild(name, context).semi();
+        return inode->getOrLoadChildIfExists(name, context).semi();
       })
-      .thenValue([&context](InodePtr&& inode) {
-        auto statFut = inode->stat(context);
-        return std::move(statFut).thenValue(
-            [inode = std::move(inode)](
-                struct stat stat) -> std::tuple<InodeNumber, struct stat> {
-              inode->incFsRefcount();
-              return {inode->getNodeId(), stat};
-            });
-      });
+      .thenValue(
+          [&context](InodePtr&& inode) -> ImmediateFuture<LookupRes> {
+            if (!inode) {
+              return LookupRes{};
+            }
+
+            auto statFut = inode->stat(context);
+            return std::move(statFut)
+                .thenValue([inode = std::move(inode)](
+                               struct stat stat) -> LookupRes {
+                  inode->incFsRefcount();
+                  return std::make_tuple(inode->getNodeId(), stat);
+                })
+                .semi();
+          });
 }
 
 ImmediateFuture<std::string> NfsDispatcherImpl::readlink(
@@ -121,6 +127,15 @@ ImmediateFuture<NfsDispatcher::WriteRes> NfsDispatcherImpl::write(
       });
 }
 
+ImmediateFuture<folly::Unit> NfsDispatcherImpl::commit(
+    InodeNumber ino,
+    ObjectFetchContext& /*context*/) {
+  return inodeMap_->lookupFileInode(ino).thenValue(
+      [](const FileInodePtr& inode) {
+        return inode->fsync(/*datasync=*/false);
+      });
+}
+
 ImmediateFuture<NfsDispatcher::CreateRes> NfsDispatcherImpl::create(
     InodeNumber dir,
     PathComponent name,
@@ -294,6 +309,25 @@ ImmediateFuture<NfsDispatcher::ReaddirRes> NfsDispatcherImpl::readdir(
       });
 }
 
+ImmediateFuture<NfsDispatcher::ReaddirplusRes> NfsDispatcherImpl::readdirplus(
+    InodeNumber dir,
+    off_t offset,
+    uint32_t dircount,
+    uint32_t maxcount,
+    ObjectFetchContext& context) {
+  return inodeMap_->lookupTreeInode(dir).thenValue(
+      [&context, offset, dircount, maxcount](const TreeInodePtr& inode) {
+        return inode
+            ->nfsReaddirPlus(
+                NfsDirPlusList{dircount, maxcount}, offset, context)
+            .thenValue([](auto&& result) {
+              auto& [dirList, attributes, isEof] = result;
+              return ReaddirplusRes{
+                  std::move(dirList), std::move(attributes), isEof};
+            });
+      });
+}
+
 ImmediateFuture<struct statfs> NfsDispatcherImpl::statfs(
     InodeNumber /*dir*/,
     ObjectFetchContext& /*context*/) {
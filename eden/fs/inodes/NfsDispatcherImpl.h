@@ -32,7 +32,7 @@ class NfsDispatcherImpl : public NfsDispatcher {
       InodeNumber ino,
       ObjectFetchContext& context) override;
 
-  ImmediateFuture<std::tuple<InodeNumber, struct stat>> lookup(
+  ImmediateFuture<LookupRes> lookup(
       InodeNumber dir,
       PathComponent name,
       ObjectFetchContext& context) override;
@@ -53,6 +53,10 @@ class NfsDispatcherImpl : public NfsDispatcher {
       off_t offset,
       ObjectFetchContext& context) override;
 
+  ImmediateFuture<folly::Unit> commit(
+      InodeNumber ino,
+      ObjectFetchContext& context) override;
+
   ImmediateFuture<NfsDispatcher::CreateRes> create(
       InodeNumber ino,
       PathComponent name,
@@ -101,6 +105,13 @@ class NfsDispatcherImpl : public NfsDispatcher {
       uint32_t count,
       ObjectFetchContext& context) override;
 
+  ImmediateFuture<NfsDispatcher::ReaddirplusRes> readdirplus(
+      InodeNumber dir,
+      off_t offset,
+      uint32_t dircount,
+      uint32_t maxcount,
+      ObjectFetchContext& context) override;
+
   ImmediateFuture<struct statfs> statfs(
       InodeNumber ino,
       ObjectFetchContext& context) override;
@@ -9,15 +9,20 @@
 
 #include <boost/filesystem.hpp>
 #include <algorithm>
+#include <functional>
 
 #include <folly/Exception.h>
 #include <folly/File.h>
 #include <folly/FileUtil.h>
 #include <folly/Range.h>
+#include <folly/ScopeGuard.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 #include <folly/logging/xlog.h>
 #include <folly/stop_watch.h>
+#include <gflags/gflags.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 #include "eden/fs/inodes/DirEntry.h"
 #include "eden/fs/inodes/InodeBase.h"
@@ -30,8 +35,65 @@
 #ifndef _WIN32
 #include "eden/fs/inodes/InodeTable.h"
 #include "eden/fs/inodes/OverlayFile.h"
+#include "eden/fs/inodes/overlay/LogOverlay.h"
 #endif // !_WIN32
 
+DEFINE_bool(
+    overlayDeferFsck,
+    false,
+    "After an unclean shutdown, start serving requests before checking the "
+    "overlay for errors, and check it in the background instead. This "
+    "requires the overlay to have been used with this flag before the crash.");
+DEFINE_uint32(
+    treeOverlayMaxBatchedWrites,
+    0,
+    "If non-zero, group up to this many concurrent tree overlay mutations "
+    "into a single SQLite transaction. Each mutation waits for the "
+    "transaction holding it to commit.");
+DEFINE_uint32(
+    treeOverlayMaxBatchDelayMs,
+    5,
+    "How long batched tree overlay mutations may wait before being committed, "
+    "when --treeOverlayMaxBatchedWrites is set.");
+DEFINE_uint64(
+    treeOverlayInlineFileBytes,
+    0,
+    "If non-zero, the tree overlay stores the contents of the files up to "
+    "this size in its database rather than in overlay files. A file written "
+    "past this size is moved to an overlay file.");
+DEFINE_uint32(
+    overlayGcThreads,
+    4,
+    "Number of threads removing the overlay data of forgotten trees. With a "
+    "single thread, the trees are collected sequentially by the overlay's "
+    "own background thread.");
+DEFINE_uint64(
+    logOverlayCompactionBytes,
+    64 * 1024 * 1024,
+    "Size of the log of a log-structured overlay past which its directories "
+    "are written to a new snapshot.");
+DEFINE_uint64(
+    logOverlayMaxDirs,
+    256 * 1024,
+    "Number of directories a log-structured overlay keeps in memory, past "
+    "which its compaction writes some of them back to the file overlay.");
+DEFINE_bool(
+    inodeMetadataHugePages,
+    false,
+    "Map the inode metadata tables with transparent huge pages, to cut the "
+    "TLB misses of mounts with millions of inodes.");
+DEFINE_uint32(
+    overlayFsckThreads,
+    8,
+    "Number of threads scanning the overlay for errors after an unclean "
+    "shutdown.");
+DEFINE_uint32(
+    overlayInodeNumberBlockSize,
+    64,
+    "How many inode numbers each thread takes at once. Larger blocks make "
+    "concurrent inode creation cheaper, and skip more inode numbers when "
+    "EdenFS is not shut down cleanly.");
+
 namespace facebook {
 namespace eden {
 
@@ -39,23 +101,48 @@ namespace {
 constexpr uint64_t ioCountMask = 0x7FFFFFFFFFFFFFFFull;
 constexpr uint64_t ioClosedMask = 1ull << 63;
 
+/**
+ * How many inode numbers to reserve at once when FLAGS_overlayDeferFsck is
+ * set. Each reservation costs an atomic file write.
+ */
+constexpr uint64_t kInodeNumberReservationSize = 1 << 20;
+
 std::unique_ptr<IOverlay> makeOverlay(
     AbsolutePathPiece localDir,
-    Overlay::OverlayType overlayType) {
+    Overlay::OverlayType overlayType,
+    Overlay::CacheSizes cacheSizes) {
+  std::unique_ptr<TreeOverlay> treeOverlay;
   if (overlayType == Overlay::OverlayType::Tree) {
-    return std::make_unique<TreeOverlay>(localDir);
+    treeOverlay = std::make_unique<TreeOverlay>(localDir);
   } else if (overlayType == Overlay::OverlayType::TreeInMemory) {
     XLOG(WARN) << "In-memory overlay requested. This will cause data loss.";
-    return std::make_unique<TreeOverlay>(
+    treeOverlay = std::make_unique<TreeOverlay>(
         std::make_unique<SqliteDatabase>(SqliteDatabase::inMemory));
   } else if (overlayType == Overlay::OverlayType::TreeSynchronousOff) {
-    return std::make_unique<TreeOverlay>(
+    treeOverlay = std::make_unique<TreeOverlay>(
         localDir, TreeOverlayStore::SynchronousMode::Off);
   }
+  if (treeOverlay) {
+    if (FLAGS_treeOverlayMaxBatchedWrites > 0) {
+      treeOverlay->enableWriteBatching(
+          FLAGS_treeOverlayMaxBatchedWrites,
+          std::chrono::milliseconds{FLAGS_treeOverlayMaxBatchDelayMs});
+    }
+    if (FLAGS_treeOverlayInlineFileBytes > 0 &&
+        overlayType != Overlay::OverlayType::TreeInMemory) {
+      treeOverlay->enableInlineFiles(FLAGS_treeOverlayInlineFileBytes);
+    }
+    return treeOverlay;
+  }
 #ifdef _WIN32
   return std::make_unique<SqliteOverlay>(localDir);
 #else
-  return std::make_unique<FsOverlay>(localDir);
+  if (overlayType == Overlay::OverlayType::Log) {
+    return std::make_unique<LogOverlay>(
+        localDir, FLAGS_logOverlayCompactionBytes, FLAGS_logOverlayMaxDirs);
+  }
+  return std::make_unique<FsOverlay>(
+      localDir, cacheSizes.blobCache, cacheSizes.contentIndex);
 #endif
 }
 } // namespace
@@ -67,26 +154,29 @@ std::shared_ptr<Overlay> Overlay::create(
     AbsolutePathPiece localDir,
     CaseSensitivity caseSensitive,
     OverlayType overlayType,
-    std::shared_ptr<StructuredLogger> logger) {
+    std::shared_ptr<StructuredLogger> logger,
+    CacheSizes cacheSizes) {
   // This allows us to access the private constructor.
   struct MakeSharedEnabler : public Overlay {
     explicit MakeSharedEnabler(
         AbsolutePathPiece localDir,
         CaseSensitivity caseSensitive,
         OverlayType overlayType,
-        std::shared_ptr<StructuredLogger> logger)
-        : Overlay(localDir, caseSensitive, overlayType, logger) {}
+        std::shared_ptr<StructuredLogger> logger,
+        CacheSizes cacheSizes)
+        : Overlay(localDir, caseSensitive, overlayType, logger, cacheSizes) {}
   };
   return std::make_shared<MakeSharedEnabler>(
-      localDir, caseSensitive, overlayType, logger);
+      localDir, caseSensitive, overlayType, logger, cacheSizes);
 }
 
 Overlay::Overlay(
     AbsolutePathPiece localDir,
     CaseSensitivity caseSensitive,
     OverlayType overlayType,
-    std::shared_ptr<StructuredLogger> logger)
-    : backingOverlay_{makeOverlay(localDir, overlayType)},
+    std::shared_ptr<StructuredLogger> logger,
+    CacheSizes cacheSizes)
+    : backingOverlay_{makeOverlay(localDir, overlayType, cacheSizes)},
       supportsSemanticOperations_{
           backingOverlay_->supportsSemanticOperations()},
       caseSensitive_{caseSensitive},
@@ -104,6 +194,9 @@ void Overlay::close() {
   if (gcThread_.joinable()) {
     gcThread_.join();
   }
+  // The GC thread waits for the trees it hands to the workers, so they are
+  // idle by now.
+  gcExecutor_.reset();
 
   // Make sure everything is shut down in reverse of construction order.
   // Cleanup is not necessary if overlay was not initialized
@@ -116,9 +209,9 @@ void Overlay::close() {
   // ensure this, so it is okay for us to still use relaxed access to
   // nextInodeNumber_.
   std::optional<InodeNumber> optNextInodeNumber;
-  auto nextInodeNumber = nextInodeNumber_.load(std::memory_order_relaxed);
-  if (nextInodeNumber) {
-    optNextInodeNumber = InodeNumber{nextInodeNumber};
+  // The inode numbers that threads took but did not hand out are skipped.
+  if (nextInodeNumber_.load(std::memory_order_relaxed)) {
+    optNextInodeNumber = InodeNumber{getMaxInodeNumber().get() + 1};
   }
 
   closeAndWaitForOutstandingIO();
@@ -151,6 +244,14 @@ folly::SemiFuture<Unit> Overlay::initialize(
   // before waiting for GC work to do.
   auto [initPromise, initFuture] = folly::makePromiseContract<Unit>();
 
+#ifndef _WIN32
+  if (FLAGS_overlayGcThreads > 1) {
+    gcExecutor_ = std::make_unique<folly::CPUThreadPoolExecutor>(
+        FLAGS_overlayGcThreads,
+        std::make_shared<folly::NamedThreadFactory>("OverlayGC"));
+  }
+#endif
+
   gcThread_ = std::thread([this,
                            mountPath = std::move(mountPath),
                            progressCallback = std::move(progressCallback),
@@ -169,6 +270,11 @@ folly::SemiFuture<Unit> Overlay::initialize(
     // TODO: On Windows files are cached by the ProjectedFS. We need to
     // clean the cached files while doing GC.
 
+    if (deferredFsck_) {
+      // Errors found here can't be repaired while the mount is live, run
+      // `eden fsck` with EdenFS stopped to repair them.
+      runDeferredFsck();
+    }
     gcThread();
 #endif
   });
@@ -181,6 +287,10 @@ void Overlay::initOverlay(
         progressCallback) {
   IORequest req{this};
   auto optNextInodeNumber = backingOverlay_->initOverlay(true);
+#ifndef _WIN32
+  // Always consume the reservation so that a stale one is never used.
+  auto reservation = backingOverlay_->loadInodeNumberReservation();
+#endif // !_WIN32
   if (!optNextInodeNumber.has_value()) {
 #ifndef _WIN32
     // If the next-inode-number data is missing it means that this overlay was
@@ -190,30 +300,20 @@ void Overlay::initOverlay(
     //
     // Use OverlayChecker to scan the overlay for any issues, and also compute
     // correct next inode number as it does so.
-    XLOG(WARN) << "Overlay " << backingOverlay_->getLocalDir()
-               << " was not shut down cleanly.  Performing fsck scan.";
-
-    // TODO(zeyi): `OverlayCheck` should be associated with the specific
-    // Overlay implementation. `reinterpret_cast` is a temporary workaround.
-    OverlayChecker checker(
-        reinterpret_cast<FsOverlay*>(backingOverlay_.get()), std::nullopt);
-    folly::stop_watch<> fsckRuntime;
-    checker.scanForErrors(progressCallback);
-    auto result = checker.repairErrors();
-    auto fsckRuntimeInSeconds =
-        std::chrono::duration<double>{fsckRuntime.elapsed()}.count();
-    if (result) {
-      // If totalErrors - fixedErrors is nonzero, then we failed to
-      // fix all of the problems.
-      auto success = !(result->totalErrors - result->fixedErrors);
-      structuredLogger_->logEvent(
-          Fsck{fsckRuntimeInSeconds, success, true /*attempted_repair*/});
+    //
+    // If the previous run reserved its inode numbers, the reservation is a
+    // safe next inode number, and the scan can wait until the mount is
+    // serving requests.
+    if (FLAGS_overlayDeferFsck && reservation.has_value()) {
+      XLOG(WARN) << "Overlay " << backingOverlay_->getLocalDir()
+                 << " was not shut down cleanly.  Deferring fsck scan.";
+      optNextInodeNumber = reservation;
+      deferredFsck_ = true;
     } else {
-      structuredLogger_->logEvent(Fsck{
-          fsckRuntimeInSeconds, true /*success*/, false /*attempted_repair*/});
+      XLOG(WARN) << "Overlay " << backingOverlay_->getLocalDir()
+                 << " was not shut down cleanly.  Performing fsck scan.";
+      optNextInodeNumber = runFsck(progressCallback, /*attemptRepair=*/true);
     }
-
-    optNextInodeNumber = checker.getNextInodeNumber();
 #else
     // SqliteOverlay will always return the value of next Inode number, if we
     // end up here - it's a bug.
@@ -228,21 +328,27 @@ void Overlay::initOverlay(
   // running.
   //
   // HACK: ideally we should not have multiple overlay types. However before
-  // the migration is done, this is a reliable way to look for `TreeOverlay`.
-  if (supportsSemanticOperations_) {
-    optNextInodeNumber = dynamic_cast<TreeOverlay*>(backingOverlay_.get())
-                             ->scanLocalChanges(*mountPath);
+  // the migration is done, this is how we look for `TreeOverlay`.
+  if (auto treeOverlay = dynamic_cast<TreeOverlay*>(backingOverlay_.get())) {
+    optNextInodeNumber = treeOverlay->scanLocalChanges(*mountPath);
   }
 
+  maxRetiredInodeNumber_.store(
+      optNextInodeNumber->get() - 1, std::memory_order_relaxed);
   nextInodeNumber_.store(optNextInodeNumber->get(), std::memory_order_relaxed);
 
 #ifndef _WIN32
+  if (FLAGS_overlayDeferFsck && !supportsSemanticOperations_) {
+    extendInodeNumberReservation(optNextInodeNumber->get());
+  }
+
   // Open after infoFile_'s lock is acquired because the InodeTable acquires
   // its own lock, which should be released prior to infoFile_.
   inodeMetadataTable_ =
       InodeMetadataTable::open((backingOverlay_->getLocalDir() +
                                 PathComponentPiece{FsOverlay::kMetadataFile})
-                                   .c_str());
+                                   .c_str(),
+                               FLAGS_inodeMetadataHugePages);
 #endif // !_WIN32
 }
 
@@ -258,16 +364,112 @@ InodeNumber Overlay::allocateInodeNumber() {
   static_assert(
       sizeof(InodeNumber) >= 8, "expected InodeNumber to be at least 64 bits");
 
-  // This could be a relaxed atomic operation.  It doesn't matter on x86 but
-  // might on ARM.
-  auto previous = nextInodeNumber_++;
+  // Only take from the shared counter once per block, so that threads
+  // creating inodes concurrently do not contend on it.
+  auto& block = *inodeNumberBlocks_;
+  auto next = block.next.load(std::memory_order_relaxed);
+  if (next == block.end) {
+    auto blockSize = std::max<uint64_t>(FLAGS_overlayInodeNumberBlockSize, 1);
+    next = nextInodeNumber_.fetch_add(blockSize, std::memory_order_relaxed);
+    block.end = next + blockSize;
+    // Everything below the block's end counts as used, so that an unclean
+    // restart never hands out a number from it again.
 #ifdef _WIN32
-  backingOverlay_->updateUsedInodeNumber(previous);
+    backingOverlay_->updateUsedInodeNumber(block.end - 1);
+#else
+    auto reservation = inodeNumberReservation_.load(std::memory_order_acquire);
+    if (reservation != 0 && block.end > reservation) {
+      extendInodeNumberReservation(block.end - 1);
+    }
 #endif
-  XDCHECK_NE(0u, previous) << "allocateInodeNumber called before initialize";
-  return InodeNumber{previous};
+  }
+  block.next.store(next + 1, std::memory_order_relaxed);
+  XDCHECK_NE(0u, next) << "allocateInodeNumber called before initialize";
+  return InodeNumber{next};
+}
+
+Overlay::InodeNumberBlock::~InodeNumberBlock() {
+  auto used = next.load(std::memory_order_relaxed);
+  if (used == 0) {
+    return;
+  }
+  auto max = maxRetired.load(std::memory_order_relaxed);
+  while (max < used - 1 &&
+         !maxRetired.compare_exchange_weak(
+             max, used - 1, std::memory_order_relaxed)) {
+  }
 }
 
+#ifndef _WIN32
+void Overlay::extendInodeNumberReservation(uint64_t usedInodeNumber) {
+  std::lock_guard<std::mutex> lock{inodeNumberReservationMutex_};
+  if (usedInodeNumber <
+      inodeNumberReservation_.load(std::memory_order_relaxed)) {
+    // Another thread extended the reservation first.
+    return;
+  }
+  // The new reservation must be durable before any inode number past the
+  // previous one is handed out.
+  auto limit = usedInodeNumber + kInodeNumberReservationSize;
+  backingOverlay_->saveInodeNumberReservation(InodeNumber{limit});
+  inodeNumberReservation_.store(limit, std::memory_order_release);
+}
+
+InodeNumber Overlay::runFsck(
+    const OverlayChecker::ProgressCallback& progressCallback,
+    bool attemptRepair) {
+  // TODO(zeyi): `OverlayCheck` should be associated with the specific
+  // Overlay implementation. `reinterpret_cast` is a temporary workaround.
+  OverlayChecker checker(
+      reinterpret_cast<FsOverlay*>(backingOverlay_.get()),
+      std::nullopt,
+      FLAGS_overlayFsckThreads);
+  folly::stop_watch<> fsckRuntime;
+  checker.scanForErrors(progressCallback);
+  std::optional<OverlayChecker::RepairResult> result;
+  if (attemptRepair) {
+    result = checker.repairErrors();
+  } else {
+    checker.logErrors();
+  }
+  auto fsckRuntimeInSeconds =
+      std::chrono::duration<double>{fsckRuntime.elapsed()}.count();
+  if (result) {
+    // If totalErrors - fixedErrors is nonzero, then we failed to
+    // fix all of the problems.
+    auto success = !(result->totalErrors - result->fixedErrors);
+    structuredLogger_->logEvent(
+        Fsck{fsckRuntimeInSeconds, success, true /*attempted_repair*/});
+  } else {
+    structuredLogger_->logEvent(Fsck{
+        fsckRuntimeInSeconds,
+        checker.getErrors().empty(),
+        false /*attempted_repair*/});
+  }
+
+  return checker.getNextInodeNumber();
+}
+
+void Overlay::runDeferredFsck() noexcept {
+  try {
+    IORequest req{this};
+    XLOG(INFO) << "Starting deferred fsck scan of overlay "
+               << backingOverlay_->getLocalDir();
+    auto nextInodeNumber = runFsck([](auto) {}, /*attemptRepair=*/false);
+    // Inodes allocated since startup are visible to the scan, but they are
+    // all below nextInodeNumber_.
+    if (nextInodeNumber.get() >
+        nextInodeNumber_.load(std::memory_order_acquire)) {
+      XLOG(ERR) << "Overlay " << backingOverlay_->getLocalDir()
+                << " contains inode numbers beyond its reservation";
+    }
+  } catch (const std::exception& e) {
+    XLOG(ERR) << "deferred fsck scan of overlay "
+              << backingOverlay_->getLocalDir() << " failed: " << e.what();
+  }
+}
+#endif // !_WIN32
+
 DirContents Overlay::loadOverlayDir(InodeNumber inodeNumber) {
   DirContents result(caseSensitive_);
   IORequest req{this};
@@ -277,6 +479,14 @@ DirContents Overlay::loadOverlayDir(InodeNumber inodeNumber) {
   }
   const auto& dir = dirData.value();
 
+  size_t longNameBytes = 0;
+  for (const auto& iter : *dir.entries_ref()) {
+    longNameBytes += PathComponentArena::getReservation(iter.first);
+  }
+  // The long names of the directory are copied into a single block.
+  PathComponentArena names{longNameBytes};
+  result.reserve(dir.entries_ref()->size());
+
   bool shouldMigrateToNewFormat = false;
 
   for (auto& iter : *dir.entries_ref()) {
@@ -293,10 +503,12 @@ DirContents Overlay::loadOverlayDir(InodeNumber inodeNumber) {
 
     if (value.hash_ref() && !value.hash_ref()->empty()) {
       auto hash = Hash{folly::ByteRange{folly::StringPiece{*value.hash_ref()}}};
-      result.emplace(PathComponentPiece{name}, *value.mode_ref(), ino, hash);
+      result.emplace(
+          names.copy(PathComponentPiece{name}), *value.mode_ref(), ino, hash);
     } else {
       // The inode is materialized
-      result.emplace(PathComponentPiece{name}, *value.mode_ref(), ino);
+      result.emplace(
+          names.copy(PathComponentPiece{name}), *value.mode_ref(), ino);
     }
   }
 
@@ -383,6 +595,7 @@ void Overlay::recursivelyRemoveOverlayData(InodeNumber inodeNumber) {
   removeOverlayData(inodeNumber);
 
   if (dirData) {
+    gcPendingTrees_.fetch_add(1, std::memory_order_relaxed);
     gcQueue_.lock()->queue.emplace_back(std::move(*dirData));
     gcCondVar_.notify_one();
   }
@@ -443,12 +656,61 @@ OverlayFile Overlay::createOverlayFile(
       weak_from_this());
 }
 
+OverlayFile Overlay::createOverlayFileFromBlob(
+    InodeNumber inodeNumber,
+    const Hash& blobHash,
+    const folly::IOBuf& contents) {
+  IORequest req{this};
+  XCHECK_LT(inodeNumber.get(), nextInodeNumber_.load(std::memory_order_relaxed))
+      << "createOverlayFileFromBlob called with unallocated inode number";
+  return OverlayFile(
+      backingOverlay_->createOverlayFileFromBlob(
+          inodeNumber, blobHash, contents),
+      weak_from_this());
+}
+
+void Overlay::dedupeOverlayFile(InodeNumber inodeNumber, const Hash& sha1) {
+  IORequest req{this};
+  backingOverlay_->dedupeOverlayFile(inodeNumber, sha1);
+}
+
+std::optional<size_t> Overlay::getInlineFileLimit() const {
+  return backingOverlay_->getInlineFileLimit();
+}
+
+void Overlay::saveInlineFile(
+    InodeNumber inodeNumber,
+    folly::ByteRange contents) {
+  IORequest req{this};
+  backingOverlay_->saveInlineFile(inodeNumber, contents);
+}
+
+std::optional<std::string> Overlay::loadInlineFile(InodeNumber inodeNumber) {
+  IORequest req{this};
+  return backingOverlay_->loadInlineFile(inodeNumber);
+}
+
+void Overlay::removeInlineFile(InodeNumber inodeNumber) {
+  IORequest req{this};
+  backingOverlay_->removeInlineFile(inodeNumber);
+}
+
 #endif // !_WIN32
 
 InodeNumber Overlay::getMaxInodeNumber() {
-  auto ino = nextInodeNumber_.load(std::memory_order_relaxed);
-  XCHECK_GT(ino, 1u);
-  return InodeNumber{ino - 1};
+  XCHECK_GT(nextInodeNumber_.load(std::memory_order_relaxed), 1u);
+  // A thread hands out the numbers of its block in order and only takes a
+  // new block once its current one is used up, so its last number is the
+  // largest it allocated.
+  auto accessor = inodeNumberBlocks_.accessAllThreads();
+  auto max = maxRetiredInodeNumber_.load(std::memory_order_relaxed);
+  for (const auto& block : accessor) {
+    auto next = block.next.load(std::memory_order_relaxed);
+    if (next != 0) {
+      max = std::max(max, next - 1);
+    }
+  }
+  return InodeNumber{max};
 }
 
 bool Overlay::tryIncOutstandingIORequests() {
@@ -528,80 +790,119 @@ void Overlay::gcThread() noexcept {
   }
 }
 
+template <typename EnqueueTree>
+void Overlay::gcProcessDir(
+    const overlay::OverlayDir& dir,
+    EnqueueTree& enqueueTree) {
+  for (const auto& entry : *dir.entries_ref()) {
+    const auto& value = entry.second;
+    if (!(*value.inodeNumber_ref())) {
+      // Legacy-only.  All new Overlay trees have inode numbers for all
+      // children.
+      continue;
+    }
+    auto ino = InodeNumber::fromThrift(*value.inodeNumber_ref());
+
+    if (S_ISDIR(*value.mode_ref())) {
+      enqueueTree(ino);
+    } else {
+      // No need to recurse, but delete any file at this inode.  Note that,
+      // under normal operation, there should be nothing at this path
+      // because files are only written into the overlay if they're
+      // materialized.
+      gcRemoveOverlayData(ino);
+    }
+  }
+}
+
+template <typename EnqueueTree>
+void Overlay::gcCollectTree(InodeNumber ino, EnqueueTree& enqueueTree) {
+  SCOPE_EXIT {
+    gcPendingTrees_.fetch_sub(1, std::memory_order_relaxed);
+  };
+
+  overlay::OverlayDir dir;
+  try {
+    auto dirData = backingOverlay_->loadOverlayDir(ino);
+    if (!dirData.has_value()) {
+      XLOG(DBG7) << "no dir data for inode " << ino;
+      return;
+    } else {
+      dir = std::move(*dirData);
+    }
+  } catch (const std::exception& e) {
+    XLOG(ERR) << "While collecting, failed to load tree data for inode "
+              << ino << ": " << e.what();
+    return;
+  }
+
+  gcRemoveOverlayData(ino);
+  gcProcessDir(dir, enqueueTree);
+}
+
+void Overlay::gcRemoveOverlayData(InodeNumber inodeNumber) {
+  try {
+    removeOverlayData(inodeNumber);
+  } catch (const std::exception& e) {
+    XLOG(ERR) << "Failed to remove overlay data for inode " << inodeNumber
+              << ": " << e.what();
+  }
+}
+
 void Overlay::handleGCRequest(GCRequest& request) {
   IORequest req{this};
   if (request.flush) {
-    request.flush->setValue();
+    request.flush->setWith([this] { backingOverlay_->flush(); });
     return;
   }
 
-  // Should only include inode numbers for trees.
-  std::queue<InodeNumber> queue;
-
-  // TODO: For better throughput on large tree collections, it might make
-  // sense to split this into two threads: one for traversing the tree and
-  // another that makes the actual unlink calls.
-  auto safeRemoveOverlayData = [&](InodeNumber inodeNumber) {
-    try {
-      removeOverlayData(inodeNumber);
-    } catch (const std::exception& e) {
-      XLOG(ERR) << "Failed to remove overlay data for inode " << inodeNumber
-                << ": " << e.what();
+  if (!gcExecutor_) {
+    // Should only include inode numbers for trees.
+    std::queue<InodeNumber> queue;
+    auto enqueueTree = [&](InodeNumber ino) {
+      gcPendingTrees_.fetch_add(1, std::memory_order_relaxed);
+      queue.push(ino);
+    };
+
+    gcProcessDir(request.dir, enqueueTree);
+    gcPendingTrees_.fetch_sub(1, std::memory_order_relaxed);
+    while (!queue.empty()) {
+      auto ino = queue.front();
+      queue.pop();
+      gcCollectTree(ino, enqueueTree);
     }
-  };
+    return;
+  }
 
-  auto processDir = [&](const overlay::OverlayDir& dir) {
-    for (const auto& entry : *dir.entries_ref()) {
-      const auto& value = entry.second;
-      if (!(*value.inodeNumber_ref())) {
-        // Legacy-only.  All new Overlay trees have inode numbers for all
-        // children.
-        continue;
-      }
-      auto ino = InodeNumber::fromThrift(*value.inodeNumber_ref());
-
-      if (S_ISDIR(*value.mode_ref())) {
-        queue.push(ino);
-      } else {
-        // No need to recurse, but delete any file at this inode.  Note that,
-        // under normal operation, there should be nothing at this path
-        // because files are only written into the overlay if they're
-        // materialized.
-        safeRemoveOverlayData(ino);
-      }
+  // Subtrees are disjoint, so they are collected concurrently on the GC
+  // workers. Wait for the whole tree before handling the next request, so
+  // that flush requests still wait for all the previous collections.
+  std::atomic<size_t> outstanding{1};
+  folly::Baton<> done;
+  auto finishOne = [&] {
+    if (outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      done.post();
     }
   };
+  std::function<void(InodeNumber)> enqueueTree = [&](InodeNumber ino) {
+    gcPendingTrees_.fetch_add(1, std::memory_order_relaxed);
+    outstanding.fetch_add(1, std::memory_order_relaxed);
+    gcExecutor_->add([&, ino] {
+      gcCollectTree(ino, enqueueTree);
+      finishOne();
+    });
+  };
 
-  processDir(request.dir);
-
-  while (!queue.empty()) {
-    auto ino = queue.front();
-    queue.pop();
-
-    overlay::OverlayDir dir;
-    try {
-      auto dirData = backingOverlay_->loadOverlayDir(ino);
-      if (!dirData.has_value()) {
-        XLOG(DBG7) << "no dir data for inode " << ino;
-        continue;
-      } else {
-        dir = std::move(*dirData);
-      }
-    } catch (const std::exception& e) {
-      XLOG(ERR) << "While collecting, failed to load tree data for inode "
-                << ino << ": " << e.what();
-      continue;
-    }
-
-    safeRemoveOverlayData(ino);
-    processDir(dir);
-  }
+  gcProcessDir(request.dir, enqueueTree);
+  gcPendingTrees_.fetch_sub(1, std::memory_order_relaxed);
+  finishOne();
+  done.wait();
 }
 #endif // !1
 
 void Overlay::addChild(
     InodeNumber parent,
-    const std::pair<PathComponent, DirEntry>& childEntry,
+    const std::pair<CompactPathComponent, DirEntry>& childEntry,
     const DirContents& content) {
   if (supportsSemanticOperations_) {
     backingOverlay_->addChild(
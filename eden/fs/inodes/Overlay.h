@@ -8,12 +8,14 @@
 #pragma once
 #include <folly/File.h>
 #include <folly/Range.h>
+#include <folly/ThreadLocal.h>
 #include <folly/futures/Future.h>
 #include <folly/futures/Promise.h>
 #include <folly/synchronization/Baton.h>
 #include <array>
 #include <atomic>
 #include <condition_variable>
+#include <mutex>
 #include <optional>
 #include <thread>
 #include "eden/fs/inodes/InodeNumber.h"
@@ -29,6 +31,10 @@
 #include "eden/fs/inodes/overlay/FsOverlay.h"
 #endif
 
+namespace folly {
+class CPUThreadPoolExecutor;
+} // namespace folly
+
 namespace facebook {
 namespace eden {
 
@@ -75,6 +81,17 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
     Tree = 1,
     TreeInMemory = 2,
     TreeSynchronousOff = 3,
+    Log = 4,
+  };
+
+  /**
+   * The most bytes the legacy overlay keeps in its blob cache and content
+   * index, from the overlay:blob-cache-size and overlay:content-index-size
+   * settings. 0 disables them.
+   */
+  struct CacheSizes {
+    uint64_t blobCache{0};
+    uint64_t contentIndex{0};
   };
 
   /**
@@ -87,7 +104,8 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
       AbsolutePathPiece localDir,
       CaseSensitivity caseSensitive,
       OverlayType overlayType,
-      std::shared_ptr<StructuredLogger> logger);
+      std::shared_ptr<StructuredLogger> logger,
+      CacheSizes cacheSizes = {});
 
   ~Overlay();
 
@@ -160,8 +178,8 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
    *   inodeCreated() should be called immediately afterwards to register the
    *   new child Inode object.
    *
-   * TODO: It would be easy to extend this function to allocate a range of
-   * inode values in one atomic operation.
+   * Each thread takes a block of FLAGS_overlayInodeNumberBlockSize numbers at
+   * a time, so inode numbers are unique but only increase within a thread.
    */
   InodeNumber allocateInodeNumber();
 #ifndef _WIN32
@@ -196,10 +214,19 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
 
   /**
    * Returns a future that completes once all previously-issued async
-   * operations, namely recursivelyRemoveOverlayData, finish.
+   * operations, namely recursivelyRemoveOverlayData, finish, and the writes
+   * buffered by the backing overlay are durable.
    */
   folly::Future<folly::Unit> flushPendingAsync();
 
+  /**
+   * Number of forgotten trees whose overlay data is waiting to be removed by
+   * the background collection.
+   */
+  size_t getGCQueueDepth() const {
+    return gcPendingTrees_.load(std::memory_order_relaxed);
+  }
+
   bool hasOverlayData(InodeNumber inodeNumber);
 
 #ifndef _WIN32
@@ -229,6 +256,32 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
       InodeNumber inodeNumber,
       const folly::IOBuf& contents);
 
+  /**
+   * Helper function to write an overlay file for a FileInode materialized
+   * from the blob with the given hash.
+   */
+  OverlayFile createOverlayFileFromBlob(
+      InodeNumber inodeNumber,
+      const Hash& blobHash,
+      const folly::IOBuf& contents);
+
+  /**
+   * Let the backing overlay share the storage of the overlay file with the
+   * files with the same SHA-1, if it supports it.
+   */
+  void dedupeOverlayFile(InodeNumber inodeNumber, const Hash& sha1);
+
+  /**
+   * See IOverlay::getInlineFileLimit().
+   */
+  std::optional<size_t> getInlineFileLimit() const;
+
+  void saveInlineFile(InodeNumber inodeNumber, folly::ByteRange contents);
+
+  std::optional<std::string> loadInlineFile(InodeNumber inodeNumber);
+
+  void removeInlineFile(InodeNumber inodeNumber);
+
   /**
    * call statfs(2) on the filesystem in which the overlay is located
    */
@@ -237,7 +290,7 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
 
   void addChild(
       InodeNumber parent,
-      const std::pair<PathComponent, DirEntry>& childEntry,
+      const std::pair<CompactPathComponent, DirEntry>& childEntry,
       const DirContents& content);
 
   void removeChild(
@@ -258,7 +311,8 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
       AbsolutePathPiece localDir,
       CaseSensitivity caseSensitive,
       OverlayType overlayType,
-      std::shared_ptr<StructuredLogger> logger);
+      std::shared_ptr<StructuredLogger> logger,
+      CacheSizes cacheSizes);
 
   /**
    * A request for the background GC thread.  There are two types of requests:
@@ -292,6 +346,47 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
   void gcThread() noexcept;
   void handleGCRequest(GCRequest& request);
 
+  /**
+   * Remove the overlay data of the files in dir, and pass the inode number
+   * of each subtree to enqueueTree.
+   */
+  template <typename EnqueueTree>
+  void gcProcessDir(const overlay::OverlayDir& dir, EnqueueTree& enqueueTree);
+
+  /**
+   * Remove the overlay data of the tree ino, and process its entries with
+   * gcProcessDir().
+   */
+  template <typename EnqueueTree>
+  void gcCollectTree(InodeNumber ino, EnqueueTree& enqueueTree);
+
+  /**
+   * removeOverlayData(), logging instead of throwing errors.
+   */
+  void gcRemoveOverlayData(InodeNumber inodeNumber);
+
+#ifndef _WIN32
+  /**
+   * Scan the whole overlay for errors, repairing them if attemptRepair is
+   * true, and return the next inode number to allocate.
+   */
+  InodeNumber runFsck(
+      const OverlayChecker::ProgressCallback& progressCallback,
+      bool attemptRepair);
+
+  /**
+   * Run the scan that initOverlay() skipped because of FLAGS_overlayDeferFsck.
+   * The overlay is live by then, so errors are only logged.
+   */
+  void runDeferredFsck() noexcept;
+
+  /**
+   * Move the inode number reservation past usedInodeNumber, see
+   * IOverlay::saveInodeNumberReservation.
+   */
+  void extendInodeNumberReservation(uint64_t usedInodeNumber);
+#endif // !_WIN32
+
   // Serialize EdenFS overlay data structure into Thrift data structure
   overlay::OverlayEntry serializeOverlayEntry(const DirEntry& entry);
 
@@ -313,6 +408,44 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
    */
   std::atomic<uint64_t> nextInodeNumber_{0};
 
+  /**
+   * The inode numbers a thread takes from nextInodeNumber_ at once. Only its
+   * thread writes next, getMaxInodeNumber() reads it from the others.
+   */
+  struct InodeNumberBlock {
+    explicit InodeNumberBlock(std::atomic<uint64_t>& maxRetired)
+        : maxRetired{maxRetired} {}
+    ~InodeNumberBlock();
+
+    std::atomic<uint64_t>& maxRetired;
+    std::atomic<uint64_t> next{0};
+    uint64_t end{0};
+  };
+  struct InodeNumberBlockTag {};
+
+  /**
+   * The largest inode number allocated before initialize() or by threads
+   * that have since exited.
+   */
+  std::atomic<uint64_t> maxRetiredInodeNumber_{0};
+  folly::ThreadLocal<InodeNumberBlock, InodeNumberBlockTag> inodeNumberBlocks_{
+      [this] { return new InodeNumberBlock{maxRetiredInodeNumber_}; }};
+
+  /**
+   * When FLAGS_overlayDeferFsck is set, no inode number at or above this has
+   * been allocated, and it is persisted in the backing overlay so that an
+   * unclean restart can resume from it. Zero if inode numbers are not
+   * reserved.
+   */
+  std::atomic<uint64_t> inodeNumberReservation_{0};
+  std::mutex inodeNumberReservationMutex_;
+
+  /**
+   * Set if initOverlay() skipped the fsck scan after an unclean shutdown, for
+   * the GC thread to run it once the mount is serving requests.
+   */
+  bool deferredFsck_{false};
+
   std::unique_ptr<IOverlay> backingOverlay_;
 
   /**
@@ -338,6 +471,18 @@ class Overlay : public std::enable_shared_from_this<Overlay> {
   folly::Synchronized<GCQueue, std::mutex> gcQueue_;
   std::condition_variable gcCondVar_;
 
+  /**
+   * Workers collecting the subtrees of a GC request concurrently, if
+   * --overlayGcThreads is greater than 1.
+   */
+  std::unique_ptr<folly::CPUThreadPoolExecutor> gcExecutor_;
+
+  /**
+   * Trees queued for collection, either as GC requests or by the traversal
+   * of one.
+   */
+  std::atomic<size_t> gcPendingTrees_{0};
+
   /**
    * This uint64_t holds two values, a single bit on the MSB that
    * acts a boolean closed: True if the the Overlay has been closed with
@@ -12,6 +12,7 @@
 #include <folly/FileUtil.h>
 
 #include "eden/fs/inodes/Overlay.h"
+#include "eden/fs/utils/XAttr.h"
 
 namespace facebook {
 namespace eden {
@@ -128,6 +129,34 @@ folly::Expected<int, int> OverlayFile::fallocate(off_t offset, off_t length)
 #endif
 }
 
+folly::Expected<ssize_t, int> OverlayFile::copyFileRange(
+    off_t offset,
+    const OverlayFile& dest,
+    off_t destOffset,
+    size_t n) const {
+#ifdef __linux__
+  std::shared_ptr<Overlay> overlay = overlay_.lock();
+  if (!overlay) {
+    return folly::makeUnexpected(EIO);
+  }
+  IORequest req{overlay.get()};
+
+  loff_t in = offset;
+  loff_t out = destOffset;
+  auto ret = ::copy_file_range(file_.fd(), &in, dest.file_.fd(), &out, n, 0);
+  if (ret == -1) {
+    return folly::makeUnexpected(errno);
+  }
+  return ret;
+#else
+  (void)offset;
+  (void)dest;
+  (void)destOffset;
+  (void)n;
+  return folly::makeUnexpected(ENOSYS);
+#endif
+}
+
 folly::Expected<int, int> OverlayFile::fdatasync() const {
 #ifndef __APPLE__
   std::shared_ptr<Overlay> overlay = overlay_.lock();
@@ -160,6 +189,54 @@ folly::Expected<std::string, int> OverlayFile::readFile() const {
   return folly::makeExpected<int>(std::move(out));
 }
 
+folly::Expected<std::string, int> OverlayFile::getxattr(
+    folly::StringPiece name) const {
+  std::shared_ptr<Overlay> overlay = overlay_.lock();
+  if (!overlay) {
+    return folly::makeUnexpected(EIO);
+  }
+  IORequest req{overlay.get()};
+
+  try {
+    return fgetxattr(file_.fd(), name);
+  } catch (const std::system_error& ex) {
+    return folly::makeUnexpected(ex.code().value());
+  }
+}
+
+folly::Expected<folly::Unit, int> OverlayFile::setxattr(
+    folly::StringPiece name,
+    folly::StringPiece value) const {
+  std::shared_ptr<Overlay> overlay = overlay_.lock();
+  if (!overlay) {
+    return folly::makeUnexpected(EIO);
+  }
+  IORequest req{overlay.get()};
+
+  try {
+    fsetxattr(file_.fd(), name, value);
+  } catch (const std::system_error& ex) {
+    return folly::makeUnexpected(ex.code().value());
+  }
+  return folly::unit;
+}
+
+folly::Expected<folly::Unit, int> OverlayFile::removexattr(
+    folly::StringPiece name) const {
+  std::shared_ptr<Overlay> overlay = overlay_.lock();
+  if (!overlay) {
+    return folly::makeUnexpected(EIO);
+  }
+  IORequest req{overlay.get()};
+
+  try {
+    fremovexattr(file_.fd(), name);
+  } catch (const std::system_error& ex) {
+    return folly::makeUnexpected(ex.code().value());
+  }
+  return folly::unit;
+}
+
 } // namespace eden
 } // namespace facebook
 
@@ -9,6 +9,8 @@
 
 #include <folly/Expected.h>
 #include <folly/File.h>
+#include <folly/Range.h>
+#include <folly/Unit.h>
 #include <folly/portability/SysUio.h>
 
 namespace folly {
@@ -37,9 +39,28 @@ class OverlayFile {
   folly::Expected<int, int> ftruncate(off_t length) const;
   folly::Expected<int, int> fsync() const;
   folly::Expected<int, int> fallocate(off_t offset, off_t length) const;
+  /**
+   * Copy up to n bytes from this file into dest with copy_file_range(2).
+   * Returns ENOSYS on platforms without copy_file_range.
+   */
+  folly::Expected<ssize_t, int> copyFileRange(
+      off_t offset,
+      const OverlayFile& dest,
+      off_t destOffset,
+      size_t n) const;
   folly::Expected<int, int> fdatasync() const;
   folly::Expected<std::string, int> readFile() const;
 
+  /**
+   * Extended attributes of the overlay file itself, as opposed to the
+   * attributes EdenFS reports for the inode.
+   */
+  folly::Expected<std::string, int> getxattr(folly::StringPiece name) const;
+  folly::Expected<folly::Unit, int> setxattr(
+      folly::StringPiece name,
+      folly::StringPiece value) const;
+  folly::Expected<folly::Unit, int> removexattr(folly::StringPiece name) const;
+
  private:
   OverlayFile(const OverlayFile&) = delete;
   OverlayFile& operator=(const OverlayFile&) = delete;
@@ -11,9 +11,14 @@
 
 #include <folly/Expected.h>
 #include <folly/Range.h>
+#include <folly/String.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/logging/xlog.h>
 #include <gflags/gflags.h>
 #include <openssl/sha.h>
+#include <algorithm>
+#include <cstring>
 
 #include "eden/fs/inodes/FileInode.h"
 #include "eden/fs/inodes/InodeError.h"
@@ -23,6 +28,8 @@
 #include "eden/fs/inodes/TreeInode.h"
 #include "eden/fs/model/Blob.h"
 #include "eden/fs/utils/Bug.h"
+#include "eden/fs/utils/StatTimes.h"
+#include "eden/fs/utils/XAttr.h"
 #include "folly/FileUtil.h"
 
 namespace facebook {
@@ -35,11 +42,99 @@ namespace eden {
  */
 
 DEFINE_uint64(overlayFileCacheSize, 100, "");
+DEFINE_uint64(
+    overlayIoThreads,
+    0,
+    "Number of threads reading and syncing materialized files, so that the "
+    "FUSE and NFS threads are not blocked on a slow disk. When 0, the thread "
+    "handling the request does the IO itself.");
+
+namespace {
+/**
+ * Name of the overlay file xattr holding the SHA-1 of a file whose entry was
+ * evicted from the cache.
+ */
+constexpr folly::StringPiece kPersistedSha1Xattr{"user.eden.sha1"};
+
+/**
+ * The xattr value is the raw SHA-1, followed by the size and mtime the
+ * overlay file had when the SHA-1 was persisted. A write by anything that
+ * doesn't know about the xattr changes the mtime and thus invalidates it.
+ */
+constexpr size_t kPersistedSha1Size = Hash::RAW_SIZE + 3 * sizeof(int64_t);
+
+/**
+ * How much of the file getSha1 reads at once.
+ */
+constexpr size_t kSha1ReadSize = 64 * 1024;
+
+std::string encodePersistedSha1(const Hash& sha1, const struct stat& st) {
+  auto mtime = stMtime(st);
+  int64_t fields[] = {st.st_size, mtime.tv_sec, mtime.tv_nsec};
+  static_assert(sizeof(fields) + Hash::RAW_SIZE == kPersistedSha1Size);
+
+  std::string value;
+  value.reserve(kPersistedSha1Size);
+  auto bytes = sha1.getBytes();
+  value.append(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  value.append(reinterpret_cast<const char*>(fields), sizeof(fields));
+  return value;
+}
+
+std::optional<Hash> decodePersistedSha1(
+    folly::StringPiece value,
+    const struct stat& st) {
+  if (value.size() != kPersistedSha1Size) {
+    return std::nullopt;
+  }
+  int64_t fields[3];
+  memcpy(fields, value.data() + Hash::RAW_SIZE, sizeof(fields));
+  auto mtime = stMtime(st);
+  if (fields[0] != st.st_size || fields[1] != mtime.tv_sec ||
+      fields[2] != mtime.tv_nsec) {
+    return std::nullopt;
+  }
+  return Hash{folly::ByteRange{value.subpiece(0, Hash::RAW_SIZE)}};
+}
+
+/**
+ * Reads back the SHA-1 persisted by persistSha1(), if it is still valid.
+ *
+ * The xattr is removed before the file can be modified through the returned
+ * entry, so that a crash never leaves a stale SHA-1 behind.
+ */
+std::optional<Hash> loadPersistedSha1(
+    const OverlayFile& file,
+    InodeNumber ino) {
+  auto value = file.getxattr(kPersistedSha1Xattr);
+  if (value.hasError()) {
+    if (value.error() != kENOATTR) {
+      XLOG(DBG3) << "unable to read the persisted SHA-1 of overlay file "
+                 << ino << ": " << folly::errnoStr(value.error());
+    }
+    return std::nullopt;
+  }
+
+  auto removed = file.removexattr(kPersistedSha1Xattr);
+  if (removed.hasError()) {
+    XLOG(WARN) << "unable to remove the persisted SHA-1 of overlay file "
+               << ino << ": " << folly::errnoStr(removed.error());
+    return std::nullopt;
+  }
+
+  auto st = file.fstat();
+  if (st.hasError()) {
+    return std::nullopt;
+  }
+  return decodePersistedSha1(value.value(), st.value());
+}
+} // namespace
 
 void OverlayFileAccess::Entry::Info::invalidateMetadata() {
   ++version;
   size = std::nullopt;
   sha1 = std::nullopt;
+  deduped = false;
 }
 
 OverlayFileAccess::State::State(size_t cacheSize) : entries{cacheSize} {
@@ -49,29 +144,173 @@ OverlayFileAccess::State::State(size_t cacheSize) : entries{cacheSize} {
 }
 
 OverlayFileAccess::OverlayFileAccess(Overlay* overlay)
-    : overlay_{overlay}, state_{folly::in_place, FLAGS_overlayFileCacheSize} {}
+    : overlay_{overlay}, state_{folly::in_place, FLAGS_overlayFileCacheSize} {
+  auto state = state_.wlock();
+  // The hook runs within entries.set(), with the state lock held.
+  State* lockedState = &*state;
+  state->entries.setPruneHook([lockedState](
+                                  InodeNumber ino, EntryPtr&& entry) {
+    // If the entry is still in use, a write may be racing with this
+    // eviction, so the SHA-1 is not trusted. Inline files are cheap to hash
+    // again.
+    if (entry->isInline || entry.use_count() != 1 ||
+        !entry->info.rlock()->sha1.has_value()) {
+      return;
+    }
+    Eviction eviction{std::move(entry), std::make_shared<folly::Baton<>>()};
+    lockedState->evictions[ino] = eviction;
+    lockedState->unpersisted.emplace_back(ino, std::move(eviction));
+  });
+  state.unlock();
+  if (FLAGS_overlayIoThreads > 0) {
+    ioExecutor_ = std::make_unique<folly::CPUThreadPoolExecutor>(
+        FLAGS_overlayIoThreads,
+        std::make_shared<folly::NamedThreadFactory>("OverlayIO"));
+  }
+}
 
 OverlayFileAccess::~OverlayFileAccess() = default;
 
+std::vector<std::pair<InodeNumber, OverlayFileAccess::Eviction>>
+OverlayFileAccess::State::takeUnpersisted() {
+  return std::exchange(unpersisted, {});
+}
+
+void OverlayFileAccess::persistEvictions(
+    std::vector<std::pair<InodeNumber, Eviction>> evictions) {
+  for (auto& [ino, eviction] : evictions) {
+    persistSha1(ino, eviction.entry);
+    {
+      auto state = state_.wlock();
+      auto it = state->evictions.find(ino);
+      if (it != state->evictions.end() &&
+          it->second.persisted == eviction.persisted) {
+        state->evictions.erase(it);
+      }
+    }
+    eviction.persisted->post();
+  }
+}
+
+void OverlayFileAccess::persistSha1(InodeNumber ino, const EntryPtr& entry) {
+  if (entry->isInline) {
+    return;
+  }
+  std::optional<Hash> sha1 = entry->info.rlock()->sha1;
+  if (!sha1.has_value()) {
+    return;
+  }
+
+  try {
+    auto st = entry->file.fstat();
+    if (st.hasError()) {
+      return;
+    }
+    auto result = entry->file.setxattr(
+        kPersistedSha1Xattr, encodePersistedSha1(*sha1, st.value()));
+    if (result.hasError()) {
+      XLOG(DBG3) << "unable to persist the SHA-1 of overlay file " << ino
+                 << ": " << folly::errnoStr(result.error());
+    }
+  } catch (const std::exception& ex) {
+    // The overlay is being closed. Evicting the entry must not fail.
+    XLOG(DBG3) << "unable to persist the SHA-1 of overlay file " << ino
+               << ": " << folly::exceptionStr(ex);
+  }
+}
+
 void OverlayFileAccess::createEmptyFile(InodeNumber ino) {
-  auto file = overlay_->createOverlayFile(ino, folly::ByteRange{});
-  auto state = state_.wlock();
-  XCHECK(!state->entries.exists(ino))
-      << "Cannot create overlay file " << ino << " when it's already open!";
-  state->entries.set(
-      ino, std::make_shared<Entry>(std::move(file), size_t{0}, kEmptySha1));
+  createFile(ino, folly::ByteRange{});
+}
+
+void OverlayFileAccess::createFile(
+    InodeNumber ino,
+    folly::ByteRange contents) {
+  std::optional<Hash> sha1;
+  if (contents.empty()) {
+    sha1 = kEmptySha1;
+  }
+  if (storeInline(contents.size())) {
+    overlay_->saveInlineFile(ino, contents);
+    insertNewEntry(
+        ino,
+        std::make_shared<Entry>(
+            std::string{folly::StringPiece{contents}}, sha1));
+    return;
+  }
+  auto file = overlay_->createOverlayFile(ino, contents);
+  insertNewEntry(
+      ino, std::make_shared<Entry>(std::move(file), contents.size(), sha1));
 }
 
 void OverlayFileAccess::createFile(
     InodeNumber ino,
     const Blob& blob,
     const std::optional<Hash>& sha1) {
-  auto file = overlay_->createOverlayFile(ino, blob.getContents());
+  if (storeInline(blob.getSize())) {
+    auto buf = blob.getContents().cloneCoalescedAsValue();
+    std::string contents{
+        reinterpret_cast<const char*>(buf.data()), buf.length()};
+    overlay_->saveInlineFile(
+        ino, folly::ByteRange{folly::StringPiece{contents}});
+    insertNewEntry(ino, std::make_shared<Entry>(std::move(contents), sha1));
+    return;
+  }
+  auto file = overlay_->createOverlayFileFromBlob(
+      ino, blob.getHash(), blob.getContents());
+  insertNewEntry(
+      ino, std::make_shared<Entry>(std::move(file), blob.getSize(), sha1));
+}
+
+void OverlayFileAccess::insertNewEntry(InodeNumber ino, EntryPtr entry) {
   auto state = state_.wlock();
   XCHECK(!state->entries.exists(ino))
       << "Cannot create overlay file " << ino << " when it's already open!";
-  state->entries.set(
-      ino, std::make_shared<Entry>(std::move(file), blob.getSize(), sha1));
+  // A pending eviction is for the file this one replaced.
+  state->evictions.erase(ino);
+  state->entries.set(ino, std::move(entry));
+  auto evictions = state->takeUnpersisted();
+  state.unlock();
+  persistEvictions(std::move(evictions));
+}
+
+bool OverlayFileAccess::storeInline(size_t size) const {
+  auto limit = overlay_->getInlineFileLimit();
+  return limit.has_value() && size <= *limit;
+}
+
+void OverlayFileAccess::modifyInline(
+    FileInode& inode,
+    const EntryPtr& entry,
+    folly::FunctionRef<void(std::string&)> modify) {
+  auto ino = inode.getNodeId();
+  auto info = entry->info.wlock();
+  auto contents = info->inlineContents;
+  modify(contents);
+
+  if (storeInline(contents.size())) {
+    overlay_->saveInlineFile(
+        ino, folly::ByteRange{folly::StringPiece{contents}});
+    info->inlineContents = std::move(contents);
+    info->invalidateMetadata();
+    info->size = info->inlineContents.size();
+    return;
+  }
+
+  // Creating the overlay file removes the inline contents. The caller holds
+  // the inode's lock, so no other modification can race with the
+  // replacement of the entry.
+  auto file = overlay_->createOverlayFile(
+      ino, folly::ByteRange{folly::StringPiece{contents}});
+  auto promoted =
+      std::make_shared<Entry>(std::move(file), contents.size(), std::nullopt);
+  info.unlock();
+
+  auto state = state_.wlock();
+  state->entries.set(ino, std::move(promoted));
+  auto evictions = state->takeUnpersisted();
+  state.unlock();
+  persistEvictions(std::move(evictions));
 }
 
 off_t OverlayFileAccess::getFileSize(FileInode& inode) {
@@ -80,6 +319,9 @@ off_t OverlayFileAccess::getFileSize(FileInode& inode) {
 
 off_t OverlayFileAccess::getFileSize(InodeNumber ino, InodeBase* inode) {
   auto entry = getEntryForInode(ino);
+  if (entry->isInline) {
+    return entry->info.rlock()->inlineContents.size();
+  }
   uint64_t version;
   {
     auto info = entry->info.rlock();
@@ -122,7 +364,23 @@ off_t OverlayFileAccess::getFileSize(InodeNumber ino, InodeBase* inode) {
 }
 
 Hash OverlayFileAccess::getSha1(FileInode& inode) {
+  return computeSha1(inode, getEntryForInode(inode.getNodeId()));
+}
+
+folly::Function<Hash()> OverlayFileAccess::prepareSha1(FileInode& inode) {
+  // Holding the entry keeps its file open even if the inode is dematerialized
+  // before the function is called.
+  return [this, &inode, entry = getEntryForInode(inode.getNodeId())] {
+    return computeSha1(inode, entry);
+  };
+}
+
+std::optional<Hash> OverlayFileAccess::getCachedSha1(FileInode& inode) {
   auto entry = getEntryForInode(inode.getNodeId());
+  return entry->info.rlock()->sha1;
+}
+
+Hash OverlayFileAccess::computeSha1(FileInode& inode, const EntryPtr& entry) {
   uint64_t version;
   {
     auto info = entry->info.rlock();
@@ -132,12 +390,23 @@ Hash OverlayFileAccess::getSha1(FileInode& inode) {
     version = info->version;
   }
 
+  if (entry->isInline) {
+    auto info = entry->info.wlock();
+    if (!info->sha1.has_value()) {
+      info->sha1 = Hash::sha1(info->inlineContents);
+    }
+    return *info->sha1;
+  }
+
   // SHA-1 is not known, so recompute it. Do so while the lock is not held to
   // improve concurrency.
 
   SHA_CTX ctx;
   SHA1_Init(&ctx);
 
+  // SHA1_Update uses the SHA extensions of the CPU where available, so the
+  // cost of hashing is dominated by the number of reads.
+  auto buf = std::make_unique<uint8_t[]>(kSha1ReadSize);
   off_t off = FsOverlay::kHeaderLength;
   while (true) {
     // Using pread here so that we don't move the file position;
@@ -145,8 +414,7 @@ Hash OverlayFileAccess::getSha1(FileInode& inode) {
     // and while we serialize the requests to FileData, it seems
     // like a good property of this function to avoid changing that
     // state.
-    uint8_t buf[8192];
-    auto ret = entry->file.preadNoInt(&buf, sizeof(buf), off);
+    auto ret = entry->file.preadNoInt(buf.get(), kSha1ReadSize, off);
     if (ret.hasError()) {
       throw InodeError(
           ret.error(),
@@ -157,7 +425,7 @@ Hash OverlayFileAccess::getSha1(FileInode& inode) {
     if (len == 0) {
       break;
     }
-    SHA1_Update(&ctx, buf, len);
+    SHA1_Update(&ctx, buf.get(), len);
     off += len;
   }
 
@@ -173,8 +441,28 @@ Hash OverlayFileAccess::getSha1(FileInode& inode) {
   return sha1;
 }
 
+void OverlayFileAccess::dedupe(FileInode& inode) {
+  auto entry = getEntryForInode(inode.getNodeId());
+  if (entry->isInline) {
+    return;
+  }
+  std::optional<Hash> sha1;
+  {
+    auto info = entry->info.wlock();
+    if (info->deduped || !info->sha1.has_value()) {
+      return;
+    }
+    info->deduped = true;
+    sha1 = info->sha1;
+  }
+  overlay_->dedupeOverlayFile(inode.getNodeId(), *sha1);
+}
+
 std::string OverlayFileAccess::readAllContents(FileInode& inode) {
   auto entry = getEntryForInode(inode.getNodeId());
+  if (entry->isInline) {
+    return entry->info.rlock()->inlineContents;
+  }
 
   // Note that this code requires a write lock on the entry because the lseek()
   // call modifies the file offset of the file descriptor. Otherwise, concurrent
@@ -206,7 +494,25 @@ std::string OverlayFileAccess::readAllContents(FileInode& inode) {
 }
 
 BufVec OverlayFileAccess::read(FileInode& inode, size_t size, off_t off) {
-  auto entry = getEntryForInode(inode.getNodeId());
+  return BufVec{
+      readEntry(inode, getEntryForInode(inode.getNodeId()), size, off)};
+}
+
+std::unique_ptr<folly::IOBuf> OverlayFileAccess::readEntry(
+    FileInode& inode,
+    const EntryPtr& entry,
+    size_t size,
+    off_t off) {
+  if (entry->isInline) {
+    auto info = entry->info.rlock();
+    const auto& contents = info->inlineContents;
+    auto start = static_cast<size_t>(off);
+    if (start >= contents.size()) {
+      return folly::IOBuf::create(0);
+    }
+    return folly::IOBuf::copyBuffer(
+        contents.data() + start, std::min(size, contents.size() - start));
+  }
 
   auto buf = folly::IOBuf::createCombined(size);
   auto res = entry->file.preadNoInt(
@@ -220,7 +526,25 @@ BufVec OverlayFileAccess::read(FileInode& inode, size_t size, off_t off) {
   }
 
   buf->append(res.value());
-  return BufVec{std::move(buf)};
+  return buf;
+}
+
+template <typename Func>
+ImmediateFuture<std::invoke_result_t<Func>> OverlayFileAccess::runIo(
+    Func&& func) {
+  if (!ioExecutor_) {
+    return makeImmediateFutureWith(std::forward<Func>(func));
+  }
+  // The captured inode pointer keeps the mount, and thus this object, alive
+  // until func completes.
+  return folly::via(ioExecutor_.get(), std::forward<Func>(func)).semi();
+}
+
+ImmediateFuture<BufVec>
+OverlayFileAccess::readAsync(FileInode& inode, size_t size, off_t off) {
+  return runIo([this, inode = inode.inodePtrFromThis(), size, off] {
+    return read(*inode, size, off);
+  });
 }
 
 size_t OverlayFileAccess::write(
@@ -229,6 +553,24 @@ size_t OverlayFileAccess::write(
     size_t iovcnt,
     off_t off) {
   auto entry = getEntryForInode(inode.getNodeId());
+  if (entry->isInline) {
+    size_t xfer = 0;
+    for (size_t i = 0; i < iovcnt; ++i) {
+      xfer += iov[i].iov_len;
+    }
+    modifyInline(inode, entry, [&](std::string& contents) {
+      auto end = static_cast<size_t>(off) + xfer;
+      if (contents.size() < end) {
+        contents.resize(end);
+      }
+      auto pos = contents.data() + off;
+      for (size_t i = 0; i < iovcnt; ++i) {
+        memcpy(pos, iov[i].iov_base, iov[i].iov_len);
+        pos += iov[i].iov_len;
+      }
+    });
+    return xfer;
+  }
 
   auto xfer = entry->file.pwritev(iov, iovcnt, off + FsOverlay::kHeaderLength);
   if (xfer.hasError()) {
@@ -245,6 +587,11 @@ size_t OverlayFileAccess::write(
 
 void OverlayFileAccess::truncate(FileInode& inode, off_t size) {
   auto entry = getEntryForInode(inode.getNodeId());
+  if (entry->isInline) {
+    modifyInline(
+        inode, entry, [&](std::string& contents) { contents.resize(size); });
+    return;
+  }
   auto result = entry->file.ftruncate(size + FsOverlay::kHeaderLength);
   if (result.hasError()) {
     throw InodeError(
@@ -262,6 +609,11 @@ void OverlayFileAccess::fsync(FileInode& inode, bool datasync) {
   // That said, close() does not ensure data is synced, so it's safest to
   // reopen.
   auto entry = getEntryForInode(inode.getNodeId());
+  if (entry->isInline) {
+    // Inline files are written to the overlay's database as they are
+    // modified.
+    return;
+  }
   auto result = datasync ? entry->file.fdatasync() : entry->file.fsync();
   if (result.hasError()) {
     throw InodeError(
@@ -271,11 +623,28 @@ void OverlayFileAccess::fsync(FileInode& inode, bool datasync) {
   }
 }
 
+ImmediateFuture<folly::Unit> OverlayFileAccess::fsyncAsync(
+    FileInode& inode,
+    bool datasync) {
+  return runIo([this, inode = inode.inodePtrFromThis(), datasync] {
+    fsync(*inode, datasync);
+    return folly::unit;
+  });
+}
+
 void OverlayFileAccess::fallocate(
     FileInode& inode,
     uint64_t offset,
     uint64_t length) {
   auto entry = getEntryForInode(inode.getNodeId());
+  if (entry->isInline) {
+    modifyInline(inode, entry, [&](std::string& contents) {
+      if (contents.size() < offset + length) {
+        contents.resize(offset + length);
+      }
+    });
+    return;
+  }
   auto result =
       entry->file.fallocate(offset, length + FsOverlay::kHeaderLength);
   if (result.hasError()) {
@@ -286,28 +655,137 @@ void OverlayFileAccess::fallocate(
   }
 }
 
+size_t OverlayFileAccess::copyFileRange(
+    FileInode& source,
+    off_t offIn,
+    FileInode& destination,
+    off_t offOut,
+    size_t length) {
+  auto sourceEntry = getEntryForInode(source.getNodeId());
+  auto destEntry = getEntryForInode(destination.getNodeId());
+  if (sourceEntry->isInline || destEntry->isInline) {
+    // There is no overlay file to copy in-kernel from or to.
+    auto buf = readEntry(source, sourceEntry, length, offIn);
+    if (buf->length() == 0) {
+      return 0;
+    }
+    iovec iov;
+    iov.iov_base = buf->writableData();
+    iov.iov_len = buf->length();
+    return write(destination, &iov, 1, offOut);
+  }
+
+  auto xfer = sourceEntry->file.copyFileRange(
+      offIn + FsOverlay::kHeaderLength,
+      destEntry->file,
+      offOut + FsOverlay::kHeaderLength,
+      length);
+  if (xfer.hasError() &&
+      (xfer.error() == ENOSYS || xfer.error() == EXDEV ||
+       xfer.error() == EOPNOTSUPP)) {
+    // Older kernels and some filesystems can't copy in-kernel; bounce the data
+    // through memory instead.
+    auto buf = folly::IOBuf::createCombined(length);
+    auto readResult = sourceEntry->file.preadNoInt(
+        buf->writableBuffer(), length, offIn + FsOverlay::kHeaderLength);
+    if (readResult.hasError()) {
+      throw InodeError(
+          readResult.error(),
+          source.inodePtrFromThis(),
+          "pread failed during overlay file copy");
+    }
+    if (readResult.value() == 0) {
+      xfer = ssize_t{0};
+    } else {
+      iovec iov;
+      iov.iov_base = buf->writableData();
+      iov.iov_len = readResult.value();
+      xfer = destEntry->file.pwritev(
+          &iov, 1, offOut + FsOverlay::kHeaderLength);
+    }
+  }
+  if (xfer.hasError()) {
+    throw InodeError(
+        xfer.error(),
+        destination.inodePtrFromThis(),
+        "copy_file_range failed during overlay file copy");
+  }
+
+  auto info = destEntry->info.wlock();
+  info->invalidateMetadata();
+
+  return xfer.value();
+}
+
+off_t OverlayFileAccess::seek(FileInode& inode, off_t offset, int whence) {
+  auto entry = getEntryForInode(inode.getNodeId());
+  if (entry->isInline) {
+    // Inline files have no holes.
+    auto size = static_cast<off_t>(entry->info.rlock()->inlineContents.size());
+    if (offset >= size) {
+      throw InodeError(
+          ENXIO, inode.inodePtrFromThis(), "unable to seek overlay file");
+    }
+    return whence == SEEK_HOLE ? size : offset;
+  }
+  auto result = entry->file.lseek(offset + FsOverlay::kHeaderLength, whence);
+  if (result.hasError()) {
+    throw InodeError(
+        result.error(),
+        inode.inodePtrFromThis(),
+        "unable to seek overlay file");
+  }
+  return result.value() - static_cast<off_t>(FsOverlay::kHeaderLength);
+}
+
+void OverlayFileAccess::forgetFile(InodeNumber ino) {
+  state_.wlock()->entries.erase(ino);
+}
+
 OverlayFileAccess::EntryPtr OverlayFileAccess::getEntryForInode(
     InodeNumber ino) {
-  {
-    auto state = state_.wlock();
-    auto iter = state->entries.find(ino);
-    if (iter != state->entries.end()) {
-      return iter->second;
+  while (true) {
+    std::shared_ptr<folly::Baton<>> persisted;
+    {
+      auto state = state_.wlock();
+      auto iter = state->entries.find(ino);
+      if (iter != state->entries.end()) {
+        return iter->second;
+      }
+      auto evicted = state->evictions.find(ino);
+      if (evicted == state->evictions.end()) {
+        break;
+      }
+      persisted = evicted->second.persisted;
     }
+    // The SHA-1 of the entry that was just evicted is being persisted. The
+    // file must not be opened until then, or its xattr could be written
+    // after it was read, and then be trusted despite later writes.
+    persisted->wait();
   }
 
-  // No entry found. Open one while the lock is not held.
-  // TODO: A possible future optimization here is, if a SHA-1 is known when
-  // the blob is evicted, write it into an xattr when the blob is closed. When
-  // reopened, if the xattr exists, read it back out (and clear).
-  auto entry = std::make_shared<Entry>(
-      overlay_->openFileNoVerify(ino), std::nullopt, std::nullopt);
-
-  {
-    auto state = state_.wlock();
-    state->entries.set(ino, entry);
+  // No entry found. Open one while the lock is not held. If the SHA-1 was
+  // known when a previous entry for this inode was evicted, it is read back
+  // from the xattr written by persistSha1().
+  EntryPtr entry;
+  std::optional<std::string> inlineContents;
+  if (overlay_->getInlineFileLimit().has_value()) {
+    inlineContents = overlay_->loadInlineFile(ino);
+  }
+  if (inlineContents.has_value()) {
+    entry = std::make_shared<Entry>(std::move(*inlineContents), std::nullopt);
+  } else {
+    auto file = overlay_->openFileNoVerify(ino);
+    auto sha1 = loadPersistedSha1(file, ino);
+    entry = std::make_shared<Entry>(std::move(file), std::nullopt, sha1);
   }
 
+  auto state = state_.wlock();
+  state->entries.set(ino, entry);
+  auto evictions = state->takeUnpersisted();
+  state.unlock();
+  persistEvictions(std::move(evictions));
+
   return entry;
 }
 
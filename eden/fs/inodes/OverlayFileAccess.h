@@ -8,14 +8,26 @@
 #pragma once
 
 #include <folly/File.h>
+#include <folly/Function.h>
 #include <folly/Synchronized.h>
 #include <folly/container/EvictingCacheMap.h>
+#include <folly/synchronization/Baton.h>
 #include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include "eden/fs/inodes/InodeNumber.h"
 #include "eden/fs/inodes/InodePtr.h"
 #include "eden/fs/inodes/OverlayFile.h"
 #include "eden/fs/model/Hash.h"
 #include "eden/fs/utils/BufVec.h"
+#include "eden/fs/utils/ImmediateFuture.h"
+
+namespace folly {
+class CPUThreadPoolExecutor;
+} // namespace folly
 
 namespace facebook {
 namespace eden {
@@ -43,6 +55,12 @@ class OverlayFileAccess {
    */
   void createEmptyFile(InodeNumber ino);
 
+  /**
+   * Creates a new file in the overlay with the given contents, with the same
+   * requirements as createEmptyFile.
+   */
+  void createFile(InodeNumber ino, folly::ByteRange contents);
+
   /**
    * Creates a new file in the overlay populated with the contents of the given
    * blob. If a sha1 is given, it is cached in memory.
@@ -71,6 +89,27 @@ class OverlayFileAccess {
    */
   Hash getSha1(FileInode& inode);
 
+  /**
+   * Like getSha1, but split so that a caller holding the inode's lock only
+   * needs it to call prepareSha1: the returned function reads and hashes the
+   * file, and may be called after the lock is released.
+   */
+  folly::Function<Hash()> prepareSha1(FileInode& inode);
+
+  /**
+   * Returns the SHA-1 of the file contents if it is cached, without reading
+   * the file. Any write since it was computed clears it.
+   */
+  std::optional<Hash> getCachedSha1(FileInode& inode);
+
+  /**
+   * Lets the overlay share the storage of the inode's overlay file with the
+   * files with the same contents, once its SHA-1 is cached. The caller must
+   * hold the inode's lock exclusively, so that the file is not written
+   * meanwhile.
+   */
+  void dedupe(FileInode& inode);
+
   /**
    * Reads the entire file's contents into memory and returns it.
    */
@@ -82,6 +121,12 @@ class OverlayFileAccess {
    */
   BufVec read(FileInode& inode, size_t size, off_t off);
 
+  /**
+   * Like read(), but when --overlayIoThreads is set, the read is performed by
+   * one of those threads so that the calling thread isn't blocked on disk IO.
+   */
+  ImmediateFuture<BufVec> readAsync(FileInode& inode, size_t size, off_t off);
+
   /**
    * Writes data into the file at the specified offset. Returns the number of
    * bytes written.
@@ -100,11 +145,43 @@ class OverlayFileAccess {
    */
   void fsync(FileInode& inode, bool datasync);
 
+  /**
+   * Like fsync(), but performed by one of the --overlayIoThreads threads
+   * when they are enabled.
+   */
+  ImmediateFuture<folly::Unit> fsyncAsync(FileInode& inode, bool datasync);
+
   /**
    * Call fallocate(mode=0) or posix_fallocate on the backing overlay storage.
    */
   void fallocate(FileInode& inode, uint64_t offset, uint64_t size);
 
+  /**
+   * Copies up to `length` bytes at offset `offIn` of source's overlay file to
+   * offset `offOut` of destination's, using copy_file_range(2) where
+   * available so the data never passes through EdenFS. Returns the number of
+   * bytes copied, which is 0 at the end of the source file.
+   */
+  size_t copyFileRange(
+      FileInode& source,
+      off_t offIn,
+      FileInode& destination,
+      off_t offOut,
+      size_t length);
+
+  /**
+   * Calls lseek(2) with SEEK_DATA or SEEK_HOLE on the overlay file, and
+   * returns the resulting offset within the file contents.
+   */
+  off_t seek(FileInode& inode, off_t offset, int whence);
+
+  /**
+   * Drops the cached file handle for an inode whose overlay file no longer
+   * holds its contents because it has been dematerialized. This allows a
+   * subsequent createFile() or createEmptyFile() for the inode.
+   */
+  void forgetFile(InodeNumber ino);
+
  private:
   /*
    * OverlayFileAccess can be accessed concurrently. There are two types of data
@@ -123,33 +200,78 @@ class OverlayFileAccess {
    * concurrent with write or truncate, a version number is incremented on every
    * modification to an entry's file, and checked before writing the cached
    * value back.
+   *
+   * When an entry with a known SHA-1 is evicted from the LRU cache, the SHA-1
+   * is written to an xattr of the overlay file, and read back (and removed)
+   * when the file is reopened. This saves rehashing files that are queried
+   * again after falling out of the cache. The xattr is written after the
+   * state lock is released, and the file is not reopened until then.
+   *
+   * When the overlay stores small files inline (see
+   * IOverlay::getInlineFileLimit), the entry of such a file has no overlay
+   * file, and keeps the contents in memory instead. Each modification
+   * rewrites the contents in the overlay while the entry's lock is held,
+   * which is cheap since they are small. A file modified past the limit is
+   * moved to an overlay file, and its entry replaced.
    */
 
   struct Entry {
     Entry(OverlayFile f, std::optional<size_t> s, const std::optional<Hash>& h)
         : file{std::move(f)}, info{folly::in_place, s, h} {}
 
+    Entry(std::string contents, const std::optional<Hash>& h)
+        : isInline{true}, info{folly::in_place, std::move(contents), h} {}
+
     struct Info {
       Info(std::optional<size_t> s, const std::optional<Hash>& h)
           : size{s}, sha1{h} {}
 
+      Info(std::string contents, const std::optional<Hash>& h)
+          : size{contents.size()},
+            sha1{h},
+            inlineContents{std::move(contents)} {}
+
       void invalidateMetadata();
 
       std::optional<size_t> size;
       std::optional<Hash> sha1;
       uint64_t version{0};
+      // Whether the file was passed to dedupe() since it was last modified.
+      bool deduped{false};
+      // The contents of an inline file.
+      std::string inlineContents;
     };
 
     const OverlayFile file;
+    const bool isInline{false};
     folly::Synchronized<Info> info;
   };
 
   using EntryPtr = std::shared_ptr<Entry>;
 
+  /**
+   * An entry evicted with a known SHA-1, which is yet to be persisted.
+   */
+  struct Eviction {
+    EntryPtr entry;
+    // Posted once the SHA-1 is persisted.
+    std::shared_ptr<folly::Baton<>> persisted;
+  };
+
   struct State {
     explicit State(size_t cacheSize);
 
+    /**
+     * Returns the evictions added by the last entries.set(), which the
+     * caller must pass to persistEvictions() once the lock is released.
+     */
+    std::vector<std::pair<InodeNumber, Eviction>> takeUnpersisted();
+
     folly::EvictingCacheMap<InodeNumber, EntryPtr> entries;
+    // The evictions being persisted, which the inodes wait for to be
+    // reopened.
+    std::unordered_map<InodeNumber, Eviction> evictions;
+    std::vector<std::pair<InodeNumber, Eviction>> unpersisted;
   };
 
   using LockedStatePtr = folly::Synchronized<State>::LockedPtr;
@@ -160,8 +282,58 @@ class OverlayFileAccess {
    */
   EntryPtr getEntryForInode(InodeNumber);
 
+  /**
+   * Adds the entry of a file that was just created to the cache.
+   */
+  void insertNewEntry(InodeNumber ino, EntryPtr entry);
+
+  /**
+   * Whether a file of the given size is stored inline by the overlay.
+   */
+  bool storeInline(size_t size) const;
+
+  /**
+   * Applies modify to the contents of an inline file, and stores the result
+   * inline, or in a new overlay file if it's too large.
+   */
+  void modifyInline(
+      FileInode& inode,
+      const EntryPtr& entry,
+      folly::FunctionRef<void(std::string&)> modify);
+
+  /**
+   * Reads up to size bytes at offset off of the file of entry.
+   */
+  std::unique_ptr<folly::IOBuf>
+  readEntry(FileInode& inode, const EntryPtr& entry, size_t size, off_t off);
+
+  /**
+   * Saves the SHA-1 of each evicted entry alongside its overlay file, and
+   * lets the inodes be reopened. Called without the state lock.
+   */
+  void persistEvictions(
+      std::vector<std::pair<InodeNumber, Eviction>> evictions);
+
+  static void persistSha1(InodeNumber ino, const EntryPtr& entry);
+
+  /**
+   * Returns the cached SHA-1 of the entry's file, or hashes it and caches
+   * the result if the file was not modified meanwhile.
+   */
+  Hash computeSha1(FileInode& inode, const EntryPtr& entry);
+
+  /**
+   * Run func on ioExecutor_, or immediately if there is none.
+   */
+  template <typename Func>
+  ImmediateFuture<std::invoke_result_t<Func>> runIo(Func&& func);
+
   Overlay* overlay_ = nullptr;
   folly::Synchronized<State> state_;
+
+  // Declared last so that it is joined before anything its tasks use is
+  // destroyed.
+  std::unique_ptr<folly::CPUThreadPoolExecutor> ioExecutor_;
 };
 
 } // namespace eden
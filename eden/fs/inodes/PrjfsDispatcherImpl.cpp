@@ -48,6 +48,31 @@ std::string makeDotEdenConfig(EdenMount& mount) {
   return stream.str();
 }
 
+/**
+ * Fetch context of the background prefetches, these shouldn't delay the
+ * fetches that an application is actively waiting on.
+ */
+class PrefetchFetchContext : public ObjectFetchContext {
+ public:
+  explicit PrefetchFetchContext(std::optional<pid_t> clientPid)
+      : clientPid_(clientPid) {}
+
+  ImportPriority getPriority() const override {
+    return ImportPriority::kLow();
+  }
+
+  std::optional<pid_t> getClientPid() const override {
+    return clientPid_;
+  }
+
+  Cause getCause() const override {
+    return ObjectFetchContext::Cause::Fs;
+  }
+
+ private:
+  std::optional<pid_t> clientPid_;
+};
+
 } // namespace
 
 PrjfsDispatcherImpl::PrjfsDispatcherImpl(EdenMount* mount)
@@ -64,6 +89,47 @@ folly::Future<std::vector<FileMetadata>> PrjfsDispatcherImpl::opendir(
   });
 }
 
+folly::Future<size_t> PrjfsDispatcherImpl::prefetchChildren(
+    RelativePath path,
+    size_t maxBlobs,
+    ObjectFetchContext& context) {
+  return mount_->getInode(path, context)
+      .thenValue([this, maxBlobs, clientPid = context.getClientPid()](
+                     const InodePtr inode) {
+        auto treePtr = inode.asTreePtr();
+
+        auto hashes = std::make_shared<std::vector<Hash>>();
+        {
+          auto contents = treePtr->getContents().rlock();
+          for (const auto& [name, entry] : contents->entries) {
+            if (hashes->size() >= maxBlobs) {
+              break;
+            }
+            // Materialized files have no hash and are already on disk.
+            if (entry.getDtype() != dtype_t::Dir && entry.getOptionalHash()) {
+              hashes->push_back(entry.getHash());
+            }
+          }
+        }
+
+        if (hashes->empty()) {
+          return size_t{0};
+        }
+
+        auto fetchContext = std::make_shared<PrefetchFetchContext>(clientPid);
+        mount_->getObjectStore()
+            ->prefetchBlobs(
+                folly::Range{hashes->data(), hashes->size()}, *fetchContext)
+            .thenError([path = treePtr->getLogPath()](
+                           const folly::exception_wrapper& ew) {
+              XLOG(DBG3) << "Failed to prefetch the children of " << path
+                         << ": " << ew;
+            })
+            .ensure([hashes, fetchContext] {});
+        return hashes->size();
+      });
+}
+
 folly::Future<std::optional<LookupResult>> PrjfsDispatcherImpl::lookup(
     RelativePath path,
     ObjectFetchContext& context) {
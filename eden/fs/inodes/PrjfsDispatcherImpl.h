@@ -32,6 +32,11 @@ class PrjfsDispatcherImpl : public PrjfsDispatcher {
       RelativePath path,
       ObjectFetchContext& context) override;
 
+  folly::Future<size_t> prefetchChildren(
+      RelativePath path,
+      size_t maxBlobs,
+      ObjectFetchContext& context) override;
+
   folly::Future<folly::Unit> fileCreated(
       RelativePath relPath,
       ObjectFetchContext& context) override;
@@ -20,8 +20,7 @@ namespace facebook::eden {
 void RequestContext::startRequest(
     EdenStats* stats,
     ChannelThreadStats::StatPtr stat,
-    std::shared_ptr<RequestMetricsScope::LockedRequestWatchList>&
-        requestWatches) {
+    std::shared_ptr<RequestWatchList>& requestWatches) {
   startTime_ = steady_clock::now();
   XDCHECK(latencyStat_ == nullptr);
   latencyStat_ = stat;
@@ -49,7 +48,7 @@ void RequestContext::finishRequest() {
     channelThreadLocalStats_.reset();
   }
 
-  if (auto pid = getClientPid(); pid.has_value()) {
+  if (auto pid = clientPid_; pid.has_value()) {
     switch (getEdenTopStats().getFetchOrigin()) {
       case Origin::FromMemoryCache:
         pal_.recordAccess(
@@ -19,15 +19,23 @@
 
 namespace facebook::eden {
 
+/**
+ * The ObjectFetchContext of a filesystem request.
+ *
+ * Every FS request creates one, so the overrides the fetch path calls are
+ * final, and the client pid is stored here rather than behind another virtual
+ * call. Code that holds a concrete subclass calls them without virtual
+ * dispatch.
+ */
 class RequestContext : public ObjectFetchContext {
   // Needed to track stats
   std::chrono::time_point<std::chrono::steady_clock> startTime_;
   ChannelThreadStats::StatPtr latencyStat_{nullptr};
   EdenStats* stats_{nullptr};
   RequestMetricsScope requestMetricsScope_;
-  std::shared_ptr<RequestMetricsScope::LockedRequestWatchList>
-      channelThreadLocalStats_;
+  std::shared_ptr<RequestWatchList> channelThreadLocalStats_;
   ProcessAccessLog& pal_;
+  const std::optional<pid_t> clientPid_;
 
   struct EdenTopStats {
    public:
@@ -59,7 +67,10 @@ class RequestContext : public ObjectFetchContext {
   RequestContext(RequestContext&&) = delete;
   RequestContext& operator=(RequestContext&&) = delete;
 
-  explicit RequestContext(ProcessAccessLog& pal) : pal_(pal) {}
+  explicit RequestContext(
+      ProcessAccessLog& pal,
+      std::optional<pid_t> clientPid = std::nullopt)
+      : pal_(pal), clientPid_(clientPid) {}
 
   /**
    * Override of `ObjectFetchContext`
@@ -68,35 +79,39 @@ class RequestContext : public ObjectFetchContext {
    * arbitrary threads.
    */
   void didFetch(ObjectType /*type*/, const Hash& /*hash*/, Origin origin)
-      override {
+      final {
     edenTopStats_.setFetchOrigin(origin);
   }
 
+  // Override of `ObjectFetchContext`
+  std::optional<pid_t> getClientPid() const final {
+    return clientPid_;
+  }
+
   // Override of `getPriority`
-  ImportPriority getPriority() const override {
+  ImportPriority getPriority() const final {
     return priority_;
   }
 
   // Override of `deprioritize`
-  virtual void deprioritize(uint64_t delta) override {
+  void deprioritize(uint64_t delta) final {
     ImportPriority prev = priority_.load();
     priority_.compare_exchange_strong(prev, prev.getDeprioritized(delta));
-    if (getClientPid().has_value()) {
-      XLOG(DBG7) << "priority for " << getClientPid().value()
+    if (clientPid_.has_value()) {
+      XLOG(DBG7) << "priority for " << clientPid_.value()
                  << " has changed to: " << priority_.load().value();
     }
   }
 
   // Override of `ObjectFetchContext`
-  Cause getCause() const override {
+  Cause getCause() const final {
     return ObjectFetchContext::Cause::Fs;
   }
 
   void startRequest(
       EdenStats* stats,
       ChannelThreadStats::StatPtr stat,
-      std::shared_ptr<RequestMetricsScope::LockedRequestWatchList>&
-          requestWatches);
+      std::shared_ptr<RequestWatchList>& requestWatches);
   void finishRequest();
 
   EdenTopStats& getEdenTopStats() {
@@ -63,13 +63,17 @@ ServerState::ServerState(
       config_{edenConfig},
       userIgnoreFileMonitor_{CachedParsedFileMonitor<GitIgnoreFileParser>{
           edenConfig->userIgnoreFile.getValue(),
-          kUserIgnoreMinPollSeconds}},
+          kUserIgnoreMinPollSeconds,
+          FileChangeDetection::Watch}},
       systemIgnoreFileMonitor_{CachedParsedFileMonitor<GitIgnoreFileParser>{
           edenConfig->systemIgnoreFile.getValue(),
-          kSystemIgnoreMinPollSeconds}},
+          kSystemIgnoreMinPollSeconds,
+          FileChangeDetection::Watch}},
       notifications_(config_),
       fsEventLogger_{
-          (kHasHiveLogger && edenConfig->requestSamplesPerMinute.getValue())
+          (kHasHiveLogger &&
+           (edenConfig->requestSamplesPerMinute.getValue() ||
+            edenConfig->requestSlowThreshold.getValue().count()))
               ? std::make_shared<FsEventLogger>(config_, hiveLogger_)
               : nullptr} {
   // It would be nice if we eventually built a more generic mechanism for
@@ -87,7 +91,7 @@ ServerState::ServerState(
 
 ServerState::~ServerState() {}
 
-std::unique_ptr<TopLevelIgnores> ServerState::getTopLevelIgnores() {
+std::shared_ptr<const TopLevelIgnores> ServerState::getTopLevelIgnores() {
   // Update EdenConfig to detect changes to the system or user ignore files
   auto edenConfig = getEdenConfig();
 
@@ -95,23 +99,40 @@ std::unique_ptr<TopLevelIgnores> ServerState::getTopLevelIgnores() {
   auto userIgnoreFile = edenConfig->userIgnoreFile.getValue();
   auto systemIgnoreFile = edenConfig->systemIgnoreFile.getValue();
 
+  auto userIgnoreFileMonitor = userIgnoreFileMonitor_.wlock();
+  auto systemIgnoreFileMonitor = systemIgnoreFileMonitor_.wlock();
+  auto userIgnoreUpdateCount = userIgnoreFileMonitor->refresh(userIgnoreFile);
+  auto systemIgnoreUpdateCount =
+      systemIgnoreFileMonitor->refresh(systemIgnoreFile);
+
+  // Reuse the ignores built from the same versions of the files, rather than
+  // copying their rules for every diff.
+  auto cached = cachedTopLevelIgnores_.wlock();
+  if (cached->ignores &&
+      cached->userIgnoreUpdateCount == userIgnoreUpdateCount &&
+      cached->systemIgnoreUpdateCount == systemIgnoreUpdateCount) {
+    return cached->ignores;
+  }
+
   // Get the userIgnoreFile
   GitIgnore userGitIgnore{};
-  auto fcResult =
-      userIgnoreFileMonitor_.wlock()->getFileContents(userIgnoreFile);
+  auto fcResult = userIgnoreFileMonitor->getFileContents();
   if (fcResult.hasValue()) {
-    userGitIgnore = fcResult.value();
+    userGitIgnore = std::move(fcResult).value();
   }
 
   // Get the systemIgnoreFile
   GitIgnore systemGitIgnore{};
-  fcResult =
-      systemIgnoreFileMonitor_.wlock()->getFileContents(systemIgnoreFile);
+  fcResult = systemIgnoreFileMonitor->getFileContents();
   if (fcResult.hasValue()) {
-    systemGitIgnore = fcResult.value();
+    systemGitIgnore = std::move(fcResult).value();
   }
-  return std::make_unique<TopLevelIgnores>(
+
+  cached->userIgnoreUpdateCount = userIgnoreUpdateCount;
+  cached->systemIgnoreUpdateCount = systemIgnoreUpdateCount;
+  cached->ignores = std::make_shared<const TopLevelIgnores>(
       std::move(userGitIgnore), std::move(systemGitIgnore));
+  return cached->ignores;
 }
 
 } // namespace eden
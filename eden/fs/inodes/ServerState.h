@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <folly/Synchronized.h>
 #include <folly/ThreadLocal.h>
 #include <chrono>
 #include <memory>
@@ -101,9 +102,9 @@ class ServerState {
 
   /**
    * Get the TopLevelIgnores. It is based on the system and user git ignore
-   * files.
+   * files, and is shared by the callers until one of the files changes.
    */
-  std::unique_ptr<TopLevelIgnores> getTopLevelIgnores();
+  std::shared_ptr<const TopLevelIgnores> getTopLevelIgnores();
 
   /**
    * Get the UserInfo object describing the user running this edenfs process.
@@ -203,6 +204,17 @@ class ServerState {
       userIgnoreFileMonitor_;
   folly::Synchronized<CachedParsedFileMonitor<GitIgnoreFileParser>>
       systemIgnoreFileMonitor_;
+
+  /**
+   * The last TopLevelIgnores built by getTopLevelIgnores(), along with the
+   * update counts of the ignore files it was built from.
+   */
+  struct CachedTopLevelIgnores {
+    size_t userIgnoreUpdateCount{0};
+    size_t systemIgnoreUpdateCount{0};
+    std::shared_ptr<const TopLevelIgnores> ignores;
+  };
+  folly::Synchronized<CachedTopLevelIgnores> cachedTopLevelIgnores_;
   Notifications notifications_;
   std::shared_ptr<FsEventLogger> fsEventLogger_;
 };
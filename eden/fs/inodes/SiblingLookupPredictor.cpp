@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/SiblingLookupPredictor.h"
+
+#include <folly/hash/Hash.h>
+#include <algorithm>
+
+namespace facebook {
+namespace eden {
+
+size_t SiblingLookupPredictor::KeyHash::operator()(
+    const Key& key) const noexcept {
+  return folly::hash::hash_combine(
+      key.pid, key.grandparent.get(), key.name.stringPiece());
+}
+
+SiblingLookupPredictor::SiblingLookupPredictor(size_t maxTrackedLookups)
+    : lookups_{folly::in_place, maxTrackedLookups} {}
+
+bool SiblingLookupPredictor::recordLookup(
+    pid_t pid,
+    InodeNumber grandparent,
+    InodeNumber parent,
+    PathComponentPiece name,
+    size_t threshold) {
+  Key key{pid, grandparent, name.copy()};
+
+  auto lookups = lookups_.wlock();
+  auto iter = lookups->find(key);
+  if (iter == lookups->end()) {
+    lookups->set(key, Lookups{});
+    iter = lookups->find(key);
+  }
+
+  auto& entry = iter->second;
+  if (entry.predicted) {
+    return false;
+  }
+  if (std::find(entry.parents.begin(), entry.parents.end(), parent) ==
+      entry.parents.end()) {
+    entry.parents.push_back(parent);
+  }
+  if (entry.parents.size() < threshold) {
+    return false;
+  }
+
+  entry.predicted = true;
+  entry.parents.clear();
+  entry.parents.shrink_to_fit();
+  return true;
+}
+
+} // namespace eden
+} // namespace facebook
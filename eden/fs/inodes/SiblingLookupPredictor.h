@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <sys/types.h>
+#include <vector>
+#include "eden/fs/inodes/InodeNumber.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Predicts which lookups a process is about to make from the lookups it made
+ * in sibling directories.
+ *
+ * Build tools and source control commonly look for the same name in every
+ * directory of a subtree, e.g. BUCK or TARGETS files. Once a process looked a
+ * name up in enough different children of a directory, it is likely to look
+ * it up in the remaining children too, and the caller can prefetch those.
+ *
+ * Only a bounded number of (process, directory, name) triples are tracked,
+ * the least recently used ones are forgotten.
+ */
+class SiblingLookupPredictor {
+ public:
+  explicit SiblingLookupPredictor(size_t maxTrackedLookups = 10000);
+
+  /**
+   * Records that pid looked up name in the directory parent, whose own parent
+   * is grandparent.
+   *
+   * Returns true when pid has now looked up name in threshold different
+   * children of grandparent. This only happens once per triple, so that the
+   * caller prefetches the remaining lookups once.
+   */
+  bool recordLookup(
+      pid_t pid,
+      InodeNumber grandparent,
+      InodeNumber parent,
+      PathComponentPiece name,
+      size_t threshold);
+
+ private:
+  struct Key {
+    pid_t pid;
+    InodeNumber grandparent;
+    PathComponent name;
+
+    bool operator==(const Key& other) const {
+      return pid == other.pid && grandparent == other.grandparent &&
+          name == other.name;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const noexcept;
+  };
+
+  struct Lookups {
+    /**
+     * The distinct children of the grandparent name was looked up in, until
+     * there are threshold of them.
+     */
+    std::vector<InodeNumber> parents;
+    bool predicted{false};
+  };
+
+  folly::Synchronized<folly::EvictingCacheMap<Key, Lookups, KeyHash>>
+      lookups_;
+};
+
+} // namespace eden
+} // namespace facebook
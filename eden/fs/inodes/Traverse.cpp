@@ -7,6 +7,7 @@
 
 #include "eden/fs/inodes/Traverse.h"
 
+#include <folly/futures/Future.h>
 #include <folly/logging/xlog.h>
 #include "eden/fs/inodes/EdenMount.h"
 #include "eden/fs/inodes/FileInode.h"
@@ -21,7 +22,7 @@ std::vector<ChildEntry> parseDirContents(const DirContents& contents) {
   results.reserve(contents.size());
   for (const auto& [name, entry] : contents) {
     results.push_back(ChildEntry{
-        name,
+        name.copy(),
         entry.getDtype(),
         entry.getInodeNumber(),
         entry.getOptionalHash(),
@@ -30,6 +31,100 @@ std::vector<ChildEntry> parseDirContents(const DirContents& contents) {
   return results;
 }
 
+folly::Future<folly::Unit> traverseChildrenConcurrently(
+    Overlay* overlay,
+    std::vector<ChildEntry> children,
+    RelativePathPiece rootPath,
+    InodeNumber ino,
+    const std::optional<Hash>& hash,
+    uint64_t fsRefcount,
+    ConcurrentTraversalCallbacks& callbacks,
+    folly::Executor::KeepAlive<> executor);
+
+folly::Future<folly::Unit> traverseTreeInodeConcurrently(
+    TreeInodePtr tree,
+    RelativePathPiece path,
+    ConcurrentTraversalCallbacks& callbacks,
+    folly::Executor::KeepAlive<> executor) {
+  std::vector<ChildEntry> children;
+  std::optional<Hash> hash;
+  {
+    auto contents = tree->getContents().rlock();
+    children = parseDirContents(contents->entries);
+    hash = contents->treeHash;
+  }
+
+  return traverseChildrenConcurrently(
+      tree->getMount()->getOverlay(),
+      std::move(children),
+      path,
+      tree->getNodeId(),
+      hash,
+      tree->debugGetFsRefcount(),
+      callbacks,
+      std::move(executor));
+}
+
+folly::Future<folly::Unit> traverseChildrenConcurrently(
+    Overlay* overlay,
+    std::vector<ChildEntry> children,
+    RelativePathPiece rootPath,
+    InodeNumber ino,
+    const std::optional<Hash>& hash,
+    uint64_t fsRefcount,
+    ConcurrentTraversalCallbacks& callbacks,
+    folly::Executor::KeepAlive<> executor) {
+  callbacks.visitTreeInode(rootPath, ino, hash, fsRefcount, children);
+
+  // Every child directory is traversed by a separate task, so that large
+  // subtrees are spread across the threads of the executor.
+  std::vector<folly::Future<folly::Unit>> futures;
+  for (auto& entry : children) {
+    auto childPath = rootPath + entry.name;
+    if (auto child = entry.loadedChild) {
+      auto loadedTreeInode = child.asTreePtrOrNull();
+      if (loadedTreeInode && callbacks.shouldRecurse(entry)) {
+        futures.push_back(folly::via(
+            executor,
+            [tree = std::move(loadedTreeInode),
+             childPath = std::move(childPath),
+             &callbacks,
+             executor]() mutable {
+              return traverseTreeInodeConcurrently(
+                  std::move(tree), childPath, callbacks, std::move(executor));
+            }));
+      }
+    } else if (dtype_t::Dir == entry.dtype && callbacks.shouldRecurse(entry)) {
+      futures.push_back(folly::via(
+          executor,
+          [overlay,
+           childIno = entry.ino,
+           childHash = entry.hash,
+           childPath = std::move(childPath),
+           &callbacks,
+           executor]() mutable {
+            // If we are able to load a child directory from the overlay,
+            // then this child entry has been allocated, and can be
+            // traversed.
+            auto contents = overlay->loadOverlayDir(childIno);
+            if (contents.empty()) {
+              return folly::makeFuture();
+            }
+            return traverseChildrenConcurrently(
+                overlay,
+                parseDirContents(contents),
+                childPath,
+                childIno,
+                childHash,
+                0,
+                callbacks,
+                std::move(executor));
+          }));
+    }
+  }
+  return folly::collect(futures).unit();
+}
+
 } // namespace
 
 void traverseTreeInodeChildren(
@@ -54,7 +149,7 @@ void traverseTreeInodeChildren(
         if (callbacks.shouldRecurse(entry)) {
           // If we are able to load a child directory from the overlay, then
           // this child entry has been allocated, and can be traversed.
-          auto contents = overlay->loadOverlayDir(ino);
+          auto contents = overlay->loadOverlayDir(entry.ino);
           if (!contents.empty()) {
             traverseTreeInodeChildren(
                 overlay,
@@ -95,4 +190,13 @@ void traverseObservedInodes(
       callbacks);
 }
 
+folly::Future<folly::Unit> traverseObservedInodesConcurrently(
+    TreeInodePtr root,
+    RelativePathPiece rootPath,
+    ConcurrentTraversalCallbacks& callbacks,
+    folly::Executor::KeepAlive<> executor) {
+  return traverseTreeInodeConcurrently(
+      std::move(root), rootPath, callbacks, std::move(executor));
+}
+
 } // namespace facebook::eden
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <folly/Executor.h>
+#include <folly/futures/Future.h>
 #include <variant>
 #include "eden/fs/inodes/InodeNumber.h"
 #include "eden/fs/inodes/InodePtr.h"
@@ -53,6 +55,15 @@ struct TraversalCallbacks {
   virtual bool shouldRecurse(const ChildEntry& entry) = 0;
 };
 
+/**
+ * TraversalCallbacks for traverseObservedInodesConcurrently().
+ *
+ * visitTreeInode() and shouldRecurse() may be called concurrently from several
+ * threads, for different TreeInodes. A TreeInode is still visited before any of
+ * its children, but there is no ordering between independent subtrees.
+ */
+struct ConcurrentTraversalCallbacks : TraversalCallbacks {};
+
 /**
  * Starting from the given loaded TreeInode root, performs a pre-order traversal
  * of EdenFS's observed inode tree structure.
@@ -70,4 +81,17 @@ void traverseObservedInodes(
     RelativePathPiece rootPath,
     TraversalCallbacks& callbacks);
 
+/**
+ * Same as traverseObservedInodes(), but traverses independent subtrees in
+ * parallel on the given executor. The contents lock of each TreeInode is only
+ * held while copying its entries.
+ *
+ * The callbacks must be kept alive until the returned future completes.
+ */
+folly::Future<folly::Unit> traverseObservedInodesConcurrently(
+    TreeInodePtr root,
+    RelativePathPiece rootPath,
+    ConcurrentTraversalCallbacks& callbacks,
+    folly::Executor::KeepAlive<> executor);
+
 } // namespace facebook::eden
@@ -35,6 +35,7 @@
 #include "eden/fs/store/DiffCallback.h"
 #include "eden/fs/store/DiffContext.h"
 #include "eden/fs/store/ObjectStore.h"
+#include "eden/fs/telemetry/EdenStats.h"
 #include "eden/fs/telemetry/Tracing.h"
 #include "eden/fs/utils/Bug.h"
 #include "eden/fs/utils/CaseSensitivity.h"
@@ -44,6 +45,7 @@
 #include "eden/fs/utils/Synchronized.h"
 #include "eden/fs/utils/TimeUtil.h"
 #include "eden/fs/utils/UnboundedQueueExecutor.h"
+#include "eden/fs/utils/WorkStealingTaskQueue.h"
 
 #ifdef _WIN32
 #include "eden/fs/prjfs/Enumerator.h"
@@ -51,7 +53,10 @@
 #include <folly/FileUtil.h>
 #include "eden/fs/fuse/DirList.h"
 #include "eden/fs/fuse/FuseChannel.h"
+#include "eden/fs/fuse/FuseDispatcher.h"
 #include "eden/fs/inodes/InodeTable.h"
+#include "eden/fs/inodes/OverlayFileAccess.h"
+#include "eden/fs/nfs/DirList.h"
 #include "eden/fs/utils/XAttr.h"
 #endif // _WIN32
 
@@ -77,7 +82,7 @@ static constexpr PathComponentPiece kIgnoreFilename{".gitignore"};
  */
 static inline PathComponent copyCanonicalInodeName(
     const DirContents::const_iterator& iter) {
-  return PathComponent(iter->first);
+  return iter->first.copy();
 }
 } // namespace
 
@@ -183,6 +188,16 @@ TreeInode::TreeInode(
 
 TreeInode::~TreeInode() {}
 
+size_t TreeInode::estimateMemoryUsage() const {
+  auto contents = contents_.rlock();
+  auto bytes = sizeof(TreeInode) +
+      contents->entries.capacity() * sizeof(DirContents::value_type);
+  for (const auto& entry : contents->entries) {
+    bytes += estimateIndirectMemoryUsage(entry.first);
+  }
+  return bytes;
+}
+
 ImmediateFuture<struct stat> TreeInode::stat(ObjectFetchContext& /*context*/) {
   auto st = getMount()->initStatData();
   st.st_ino = folly::to_narrow(getNodeId().get());
@@ -207,6 +222,20 @@ ImmediateFuture<struct stat> TreeInode::stat(ObjectFetchContext& /*context*/) {
 Future<InodePtr> TreeInode::getOrLoadChild(
     PathComponentPiece name,
     ObjectFetchContext& context) {
+  return getOrLoadChildImpl(name, context, /*nullIfMissing=*/false);
+}
+
+Future<InodePtr> TreeInode::getOrLoadChildIfExists(
+    PathComponentPiece name,
+    ObjectFetchContext& context) {
+  predictSiblingLookups(name, context);
+  return getOrLoadChildImpl(name, context, /*nullIfMissing=*/true);
+}
+
+Future<InodePtr> TreeInode::getOrLoadChildImpl(
+    PathComponentPiece name,
+    ObjectFetchContext& context,
+    bool nullIfMissing) {
   TraceBlock block("getOrLoadChild");
 
 #ifndef _WIN32
@@ -221,12 +250,28 @@ Future<InodePtr> TreeInode::getOrLoadChild(
   }
 #endif // !_WIN32
 
+  // Only the lookups of getOrLoadChildIfExists() come from the channels, the
+  // ones EdenFS makes internally are not counted. They are counted once the
+  // contents lock is released.
+  bool found = true;
+  SCOPE_EXIT {
+    if (nullIfMissing) {
+      auto& stats = getMount()->getStats()->getChannelStatsForCurrentThread();
+      (found ? stats.lookupChildFound : stats.lookupChildMissing).addValue(1);
+    }
+  };
+
   return tryRlockCheckBeforeUpdate<Future<InodePtr>>(
              contents_,
              [&](const auto& contents) -> folly::Optional<Future<InodePtr>> {
                // Check if the child is already loaded and return it if so
                auto iter = contents.entries.find(name);
                if (iter == contents.entries.end()) {
+                 found = false;
+                 if (nullIfMissing) {
+                   return folly::make_optional(
+                       makeFuture<InodePtr>(InodePtr{}));
+                 }
                  XLOG(DBG7) << "attempted to load non-existent entry \"" << name
                             << "\" in " << getLogPath();
                  return folly::make_optional(makeFuture<InodePtr>(
@@ -868,11 +913,21 @@ DirContents TreeInode::buildDirFromTree(
   // of atomic operations from N to 1, though if the atomic is issued with the
   // other work this loop is doing it may not matter much.
 
+  const auto& treeEntries = tree->getTreeEntries();
+  size_t longNameBytes = 0;
+  for (const auto& treeEntry : treeEntries) {
+    longNameBytes +=
+        PathComponentArena::getReservation(treeEntry.getName().stringPiece());
+  }
+  // The long names of the directory are copied into a single block.
+  PathComponentArena names{longNameBytes};
+
   DirContents dir(caseSensitive);
+  dir.reserve(treeEntries.size());
   // TODO: O(N^2)
-  for (const auto& treeEntry : tree->getTreeEntries()) {
+  for (const auto& treeEntry : treeEntries) {
     dir.emplace(
-        treeEntry.getName(),
+        names.copy(treeEntry.getName()),
         modeFromTreeEntryType(treeEntry.getType()),
         overlay->allocateInodeNumber(),
         treeEntry.getHash());
@@ -938,7 +993,7 @@ FileInodePtr TreeInode::createImpl(
 
 #ifndef _WIN32
     // Create the overlay file before we insert the file into our entries map.
-    auto file = getOverlay()->createOverlayFile(childNumber, fileContents);
+    getMount()->getOverlayFileAccess()->createFile(childNumber, fileContents);
 #endif
 
     auto now = getNow();
@@ -946,6 +1001,7 @@ FileInodePtr TreeInode::createImpl(
 
     // Record the new entry
     auto insertion = contents->entries.emplace(name, mode, childNumber);
+    ++contents->listingGeneration;
     XCHECK(insertion.second)
         << "we already confirmed that this entry did not exist above";
     auto& entry = insertion.first->second;
@@ -1086,6 +1142,7 @@ TreeInodePtr TreeInode::mkdir(
 
     // Add a new entry to contents_.entries
     auto emplaceResult = contents->entries.emplace(name, mode, childNumber);
+    ++contents->listingGeneration;
     XCHECK(emplaceResult.second)
         << "directory contents should not have changed since the check above";
     auto& entry = emplaceResult.first->second;
@@ -1307,6 +1364,7 @@ int TreeInode::tryRemoveChild(
 
     // Remove it from our entries list
     contents->entries.erase(entIter);
+    ++contents->listingGeneration;
 
     // We want to update mtime and ctime of parent directory after removing the
     // child.
@@ -1348,6 +1406,20 @@ class TreeInode::TreeRenameLocks {
       TreeInode* destTree,
       PathComponentPiece destName);
 
+  /**
+   * Acquire the locks to rename srcName to destName within tree while only
+   * holding the rename lock in shared mode.
+   *
+   * This is only possible if tree is materialized and srcName refers to an
+   * existing non-directory, as the rename then only changes tree.  Returns
+   * false, holding no locks, otherwise.
+   */
+  bool tryAcquireLocksInDirectory(
+      SharedRenameLock&& renameLock,
+      TreeInode* tree,
+      PathComponentPiece srcName,
+      PathComponentPiece destName);
+
   /**
    * Reset the TreeRenameLocks to the empty state, releasing all locks that it
    * holds.
@@ -1361,13 +1433,42 @@ class TreeInode::TreeRenameLocks {
    * mount point RenameLock.
    */
   void releaseAllButRename() {
+    if (sharedRenameLock_.owns_lock()) {
+      // Renames within a directory are only ordered by its contents lock,
+      // which therefore stays held until they are recorded in the journal.
+      return;
+    }
     *this = TreeRenameLocks(std::move(renameLock_));
   }
 
+  /**
+   * The mountpoint-wide rename lock.  This must not be called if the locks
+   * were acquired with tryAcquireLocksInDirectory().
+   */
   const RenameLock& renameLock() const {
+    XDCHECK(renameLock_.owns_lock());
     return renameLock_;
   }
 
+  std::unique_ptr<InodeBase>
+  markUnlinked(InodeBase* child, TreeInode* parent, PathComponentPiece name) {
+    if (sharedRenameLock_.owns_lock()) {
+      return child->markUnlinked(parent, name, sharedRenameLock_);
+    }
+    return child->markUnlinked(parent, name, renameLock_);
+  }
+
+  void updateLocation(
+      InodeBase* child,
+      TreeInodePtr newParent,
+      PathComponentPiece newName) {
+    if (sharedRenameLock_.owns_lock()) {
+      child->updateLocation(std::move(newParent), newName, sharedRenameLock_);
+    } else {
+      child->updateLocation(std::move(newParent), newName, renameLock_);
+    }
+  }
+
   DirContents* srcContents() {
     return srcContents_;
   }
@@ -1384,7 +1485,7 @@ class TreeInode::TreeRenameLocks {
     return *destContentsLock_;
   }
 
-  const PathMap<DirEntry>::iterator& destChildIter() const {
+  const DirContents::iterator& destChildIter() const {
     return destChildIter_;
   }
   InodeBase* destChild() const {
@@ -1411,9 +1512,10 @@ class TreeInode::TreeRenameLocks {
   void lockDestChild(PathComponentPiece destName);
 
   /**
-   * The mountpoint-wide rename lock.
+   * The mountpoint-wide rename lock.  Only one of them is held.
    */
   RenameLock renameLock_;
+  SharedRenameLock sharedRenameLock_;
 
   /**
    * Locks for the contents of the source and destination directories.
@@ -1442,7 +1544,7 @@ class TreeInode::TreeRenameLocks {
    * This may point to destContents_->entries.end() if the destination child
    * does not exist.
    */
-  PathMap<DirEntry>::iterator destChildIter_;
+  DirContents::iterator destChildIter_;
 };
 
 Future<Unit> TreeInode::rename(
@@ -1464,15 +1566,20 @@ Future<Unit> TreeInode::rename(
   bool needSrc = false;
   bool needDest = false;
   {
-    auto renameLock = getMount()->acquireRenameLock();
-    materialize(&renameLock);
-    if (destParent.get() != this) {
-      destParent->materialize(&renameLock);
-    }
-
-    // Acquire the locks required to do the rename
+    // Acquire the locks required to do the rename.  Renaming a file within a
+    // directory doesn't need to exclude renames elsewhere in the mount.
     TreeRenameLocks locks;
-    locks.acquireLocks(std::move(renameLock), this, destParent.get(), destName);
+    if (destParent.get() != this ||
+        !locks.tryAcquireLocksInDirectory(
+            getMount()->acquireSharedRenameLock(), this, name, destName)) {
+      auto renameLock = getMount()->acquireRenameLock();
+      materialize(&renameLock);
+      if (destParent.get() != this) {
+        destParent->materialize(&renameLock);
+      }
+      locks.acquireLocks(
+          std::move(renameLock), this, destParent.get(), destName);
+    }
 
     // Look up the source entry.  The destination entry info was already
     // loaded by TreeRenameLocks::acquireLocks().
@@ -1590,7 +1697,7 @@ bool isAncestor(const RenameLock& renameLock, TreeInode* a, TreeInode* b) {
 Future<Unit> TreeInode::doRename(
     TreeRenameLocks&& locks,
     PathComponentPiece srcName,
-    PathMap<DirEntry>::iterator srcIter,
+    DirContents::iterator srcIter,
     TreeInodePtr destParent,
     PathComponentPiece destName,
     InvalidationRequired invalidate) {
@@ -1647,8 +1754,8 @@ Future<Unit> TreeInode::doRename(
   auto* childInode = srcEntry.getInode();
   bool destChildExists = locks.destChildExists();
   if (destChildExists) {
-    deletedInode = locks.destChild()->markUnlinked(
-        destParent.get(), destName, locks.renameLock());
+    deletedInode =
+        locks.markUnlinked(locks.destChild(), destParent.get(), destName);
 
     // Replace the destination contents entry with the source data
     locks.destChildIter()->second = std::move(srcIter->second);
@@ -1666,10 +1773,14 @@ Future<Unit> TreeInode::doRename(
   }
 
   // Inform the child inode that it has been moved
-  childInode->updateLocation(destParent, destName, locks.renameLock());
+  locks.updateLocation(childInode, destParent, destName);
 
   // Now remove the source information
   locks.srcContents()->erase(srcIter);
+  ++locks.srcInodeState().listingGeneration;
+  if (destParent.get() != this) {
+    ++locks.dstInodeState().listingGeneration;
+  }
 
   auto now = getNow();
   updateMtimeAndCtimeLocked(*locks.srcContents(), now);
@@ -1779,6 +1890,30 @@ void TreeInode::TreeRenameLocks::acquireLocks(
   }
 }
 
+bool TreeInode::TreeRenameLocks::tryAcquireLocksInDirectory(
+    SharedRenameLock&& renameLock,
+    TreeInode* tree,
+    PathComponentPiece srcName,
+    PathComponentPiece destName) {
+  sharedRenameLock_ = std::move(renameLock);
+  srcContentsLock_ = tree->contents_.wlock();
+
+  // Materializing the directory would update its ancestors, and moving a
+  // directory would change the location of all of its descendants.
+  auto srcIter = srcContentsLock_->entries.find(srcName);
+  if (!srcContentsLock_->isMaterialized() ||
+      srcIter == srcContentsLock_->entries.end() ||
+      srcIter->second.isDirectory()) {
+    reset();
+    return false;
+  }
+
+  srcContents_ = &srcContentsLock_->entries;
+  destContents_ = &srcContentsLock_->entries;
+  lockDestChild(destName);
+  return true;
+}
+
 void TreeInode::TreeRenameLocks::lockDestChild(PathComponentPiece destName) {
   // Look up the destination child entry
   destChildIter_ = destContents_->find(destName);
@@ -1866,35 +2001,74 @@ bool TreeInode::readdirImpl(off_t off, ObjectFetchContext& context, Fn add) {
     }
   }
 
-  auto dir = contents_.rlock();
-  auto& entries = dir->entries;
+  // The listing is immutable, so the reply is filled without holding the
+  // contents lock.
+  auto listing = getDirListing();
+  auto& entries = listing->entries;
+  auto it = std::upper_bound(
+      entries.begin(),
+      entries.end(),
+      off,
+      [](off_t offset, const DirListing::Entry& entry) {
+        return offset < static_cast<off_t>(entry.ino.get() + 2);
+      });
 
-  // Compute an index into the PathMap by InodeNumber, only including the
-  // entries that are greater than the given offset.
-  std::vector<std::pair<InodeNumber, size_t>> indices;
-  indices.reserve(entries.size());
-  size_t index = 0;
-  for (auto& entry : entries) {
-    auto inodeNumber = entry.second.getInodeNumber();
-    if (static_cast<off_t>(inodeNumber.get() + 2) > off) {
-      indices.emplace_back(entry.second.getInodeNumber(), index);
+  // The provided FuseDirList has limited space. Add entries until no more fit.
+  for (; it != entries.end(); ++it) {
+    if (!add(
+            it->name.stringPiece(),
+            DirEntry{it->mode, it->ino},
+            it->ino.get() + 2)) {
+      return false;
     }
-    ++index;
   }
-  std::make_heap(indices.begin(), indices.end(), std::greater<>{});
 
-  // The provided FuseDirList has limited space. Add entries until no more fit.
-  while (indices.size()) {
-    std::pop_heap(indices.begin(), indices.end(), std::greater<>{});
-    auto& [name, entry] = entries.begin()[indices.back().second];
-    indices.pop_back();
+  return true;
+}
 
-    if (!add(name.stringPiece(), entry, entry.getInodeNumber().get() + 2)) {
-      break;
+namespace {
+/**
+ * Listings of smaller directories are cheap to build again, and are not
+ * worth keeping in memory.
+ */
+constexpr size_t kMinCachedDirListingSize = 256;
+} // namespace
+
+std::shared_ptr<const TreeInode::DirListing> TreeInode::getDirListing() {
+  auto dir = contents_.rlock();
+  auto& entries = dir->entries;
+  bool hasStaleListing;
+  {
+    auto cached = dirListing_.rlock();
+    if (*cached && (*cached)->generation == dir->listingGeneration) {
+      return *cached;
     }
+    hasStaleListing = *cached != nullptr;
   }
 
-  return indices.size() == 0;
+  auto listing = std::make_shared<DirListing>();
+  listing->generation = dir->listingGeneration;
+  listing->entries.reserve(entries.size());
+  for (auto& [name, entry] : entries) {
+    listing->entries.push_back(DirListing::Entry{
+        name, entry.getInodeNumber(), entry.getInitialMode()});
+  }
+  std::sort(
+      listing->entries.begin(),
+      listing->entries.end(),
+      [](const DirListing::Entry& a, const DirListing::Entry& b) {
+        return a.ino < b.ino;
+      });
+
+  std::shared_ptr<const DirListing> result = std::move(listing);
+  if (entries.size() >= kMinCachedDirListingSize) {
+    // Stored while the contents lock is held, so that it cannot replace a
+    // listing of a later generation.
+    *dirListing_.wlock() = result;
+  } else if (hasStaleListing) {
+    dirListing_.wlock()->reset();
+  }
+  return result;
 }
 
 FuseDirList TreeInode::fuseReaddir(
@@ -1912,6 +2086,103 @@ FuseDirList TreeInode::fuseReaddir(
   return std::move(list);
 }
 
+#ifdef __linux__
+ImmediateFuture<FuseDirList> TreeInode::fuseReaddirPlus(
+    FuseDirList&& list,
+    off_t off,
+    ObjectFetchContext& context) {
+  struct PageEntry {
+    std::string name;
+    InodeNumber ino;
+    dtype_t type;
+    off_t offset;
+  };
+
+  // Pick the entries that fit in this reply first, so that only the inodes
+  // that are actually returned to the kernel get loaded.
+  std::vector<PageEntry> page;
+  size_t remaining = list.remainingSize();
+  readdirImpl(
+      off,
+      context,
+      [&page, &remaining](
+          StringPiece name, const DirEntry& entry, uint64_t offset) {
+        auto size = FuseDirList::direntPlusSize(name.size());
+        if (size > remaining) {
+          return false;
+        }
+        remaining -= size;
+        page.push_back(PageEntry{
+            name.str(),
+            entry.getInodeNumber(),
+            entry.getDtype(),
+            static_cast<off_t>(offset)});
+        return true;
+      });
+
+  using ChildAttr = std::pair<InodePtr, struct stat>;
+  std::vector<Future<ChildAttr>> attrFutures;
+  attrFutures.reserve(page.size());
+  for (const auto& entry : page) {
+    if (entry.name == "." || entry.name == "..") {
+      // The kernel never takes a reference on the dot entries, so there is no
+      // point in computing their attributes.
+      attrFutures.push_back(makeFuture(ChildAttr{}));
+      continue;
+    }
+    attrFutures.push_back(
+        getOrLoadChild(PathComponentPiece{entry.name}, context)
+            .thenValue([&context](InodePtr inode) {
+              auto statFuture = inode->stat(context).semi();
+              return std::move(statFuture)
+                  .deferValue([inode = std::move(inode)](struct stat st) {
+                    return ChildAttr{inode, st};
+                  });
+            }));
+  }
+
+  return ImmediateFuture<std::vector<folly::Try<ChildAttr>>>{
+      folly::collectAll(std::move(attrFutures))}
+      .thenValue([list = std::move(list), page = std::move(page)](
+                     std::vector<folly::Try<ChildAttr>>&& results) mutable {
+        for (size_t i = 0; i < page.size(); ++i) {
+          const auto& entry = page[i];
+          auto& result = results[i];
+
+          // Entries we could not stat (e.g. removed concurrently, or with a
+          // corrupt overlay) are sent without attributes.  The kernel will
+          // issue a regular FUSE_LOOKUP for them if it needs to.
+          fuse_entry_out entryOut = {};
+          if (result.hasException()) {
+            XLOG(DBG3) << "readdirplus: unable to get attributes for "
+                       << entry.name << ": " << result.exception().what();
+          } else if (
+              result->first &&
+              static_cast<uint64_t>(result->second.st_ino) ==
+                  entry.ino.get()) {
+            entryOut = FuseDispatcher::Attr{result->second}.asFuseEntry();
+          }
+
+          if (!list.addPlus(
+                  entry.name,
+                  entryOut,
+                  entry.ino.get(),
+                  entry.type,
+                  entry.offset)) {
+            // The page was sized to fit, so this should not happen.
+            break;
+          }
+          if (entryOut.nodeid != 0) {
+            // The kernel now holds a reference to this inode, just like after
+            // a successful lookup().
+            result->first->incFsRefcount();
+          }
+        }
+        return std::move(list);
+      });
+}
+#endif
+
 std::tuple<NfsDirList, bool> TreeInode::nfsReaddir(
     NfsDirList&& list,
     off_t off,
@@ -1927,6 +2198,62 @@ std::tuple<NfsDirList, bool> TreeInode::nfsReaddir(
   return {std::move(list), isEof};
 }
 
+ImmediateFuture<
+    std::tuple<NfsDirPlusList, std::vector<std::optional<struct stat>>, bool>>
+TreeInode::nfsReaddirPlus(
+    NfsDirPlusList&& list,
+    off_t off,
+    ObjectFetchContext& context) {
+  updateAtime();
+
+  // Pick the entries that fit in this reply first, so that only the inodes
+  // that are actually returned to the client get loaded.
+  std::vector<std::string> names;
+  bool isEof = readdirImpl(
+      off,
+      context,
+      [&list, &names](
+          StringPiece name, const DirEntry& entry, uint64_t offset) {
+        if (!list.add(name, entry.getInodeNumber(), offset)) {
+          return false;
+        }
+        names.push_back(name.str());
+        return true;
+      });
+
+  std::vector<Future<std::optional<struct stat>>> attrFutures;
+  attrFutures.reserve(names.size());
+  for (const auto& name : names) {
+    if (name == "." || name == "..") {
+      attrFutures.push_back(makeFuture(std::optional<struct stat>{}));
+      continue;
+    }
+    attrFutures.push_back(
+        getOrLoadChild(PathComponentPiece{name}, context)
+            .thenValue([&context](InodePtr inode) {
+              return inode->stat(context).semi();
+            })
+            .thenTry([name](folly::Try<struct stat>&& st) {
+              // Entries we could not stat (e.g. removed concurrently, or with
+              // a corrupt overlay) are sent without attributes. The client
+              // will issue a GETATTR for them if it needs to.
+              if (st.hasException()) {
+                XLOG(DBG3) << "readdirplus: unable to get attributes for "
+                           << name << ": " << st.exception().what();
+                return std::optional<struct stat>{};
+              }
+              return std::optional<struct stat>{st.value()};
+            }));
+  }
+
+  return ImmediateFuture<std::vector<std::optional<struct stat>>>{
+      folly::collect(std::move(attrFutures))}
+      .thenValue([list = std::move(list), isEof](
+                     std::vector<std::optional<struct stat>>&& attrs) mutable {
+        return std::make_tuple(std::move(list), std::move(attrs), isEof);
+      });
+}
+
 #else
 
 std::vector<FileMetadata> TreeInode::readdir() {
@@ -1948,15 +2275,19 @@ std::vector<FileMetadata> TreeInode::readdir() {
         static ObjectFetchContext* context =
             ObjectFetchContext::getNullContextWithCauseDetail(
                 "TreeInode::readdir");
+        // The size is only fetched once the entry is about to be returned
+        // to ProjectedFS, see Enumerator::prefetch.
         ret.emplace_back(
             std::move(winName),
             false,
-            getMount()->getObjectStore()->getBlobSize(hash.value(), *context));
+            [store = getMount()->getObjectStore(), hash = hash.value()] {
+              return store->getBlobSize(hash, *context);
+            });
         continue;
       }
     }
 
-    ret.emplace_back(std::move(winName), isDir, folly::Future<size_t>(0));
+    ret.emplace_back(std::move(winName), isDir, size_t{0});
   }
 
   return ret;
@@ -2117,24 +2448,59 @@ Future<Unit> TreeInode::loadGitIgnoreThenDiff(
     shared_ptr<const Tree> tree,
     const GitIgnoreStack* parentIgnore,
     bool isIgnored) {
+  // The parsed rules of a regular ignore file are kept by the mount, keyed by
+  // the hash of its contents when it is not materialized. The target of a
+  // symlink can change without the symlink changing, so they are not cached.
+  auto* ignoreFile = gitignoreInode.asFileOrNull();
+  std::optional<InodeNumber> cacheIno;
+  std::optional<Hash> contentHash;
+  uint64_t cacheGeneration = 0;
+  if (ignoreFile && ignoreFile->getType() != dtype_t::Symlink) {
+    cacheIno = ignoreFile->getNodeId();
+    contentHash = ignoreFile->getBlobHash();
+    auto cached =
+        getMount()->getGitIgnoreCache().get(*cacheIno, contentHash);
+    if (cached.ignore) {
+      return computeDiff(
+          contents_.wlock(),
+          context,
+          currentPath,
+          std::move(tree),
+          make_unique<GitIgnoreStack>(parentIgnore, std::move(cached.ignore)),
+          isIgnored);
+    }
+    cacheGeneration = cached.generation;
+  }
+
   return getMount()
       ->loadFileContents(context->getFetchContext(), gitignoreInode)
-      .thenError([](const folly::exception_wrapper& ex) {
-        XLOG(WARN) << "error reading ignore file: " << folly::exceptionStr(ex);
-        return std::string{};
-      })
-      .thenValue([self = inodePtrFromThis(),
-                  context,
-                  currentPath = RelativePath{currentPath}, // deep copy
-                  tree,
-                  parentIgnore,
-                  isIgnored](std::string&& ignoreFileContents) mutable {
+      .thenTry([self = inodePtrFromThis(),
+                context,
+                currentPath = RelativePath{currentPath}, // deep copy
+                tree,
+                parentIgnore,
+                isIgnored,
+                cacheIno,
+                contentHash,
+                cacheGeneration](
+                   folly::Try<std::string>&& ignoreFileContents) mutable {
+        auto ignore = std::make_shared<GitIgnore>();
+        if (ignoreFileContents.hasException()) {
+          XLOG(WARN) << "error reading ignore file: "
+                     << folly::exceptionStr(ignoreFileContents.exception());
+        } else {
+          ignore->loadFile(*ignoreFileContents);
+          if (cacheIno) {
+            self->getMount()->getGitIgnoreCache().insert(
+                *cacheIno, contentHash, ignore, cacheGeneration);
+          }
+        }
         return self->computeDiff(
             self->contents_.wlock(),
             context,
             currentPath,
             std::move(tree),
-            make_unique<GitIgnoreStack>(parentIgnore, ignoreFileContents),
+            make_unique<GitIgnoreStack>(parentIgnore, std::move(ignore)),
             isIgnored);
       });
 }
@@ -2213,6 +2579,9 @@ Future<Unit> TreeInode::computeDiff(
       auto fileType = inodeEntry->isDirectory() ? GitIgnore::TYPE_DIR
                                                 : GitIgnore::TYPE_FILE;
       auto entryPath = currentPath + name;
+      if (!context->getScope().contains(entryPath)) {
+        return;
+      }
       if (!isIgnored) {
         auto ignoreStatus = ignore->match(entryPath, fileType);
         if (ignoreStatus == GitIgnore::HIDDEN) {
@@ -2278,13 +2647,16 @@ Future<Unit> TreeInode::computeDiff(
     };
 
     auto processRemoved = [&](const TreeEntry& scmEntry) {
+      auto entryPath = currentPath + scmEntry.getName();
+      if (!context->getScope().contains(entryPath)) {
+        return;
+      }
       if (scmEntry.isTree()) {
         deferredEntries.emplace_back(DeferredDiffEntry::createRemovedScmEntry(
-            context, currentPath + scmEntry.getName(), scmEntry.getHash()));
+            context, entryPath, scmEntry.getHash()));
       } else {
-        XLOG(DBG5) << "diff: removed file: "
-                   << currentPath + scmEntry.getName();
-        context->callback->removedFile(currentPath + scmEntry.getName());
+        XLOG(DBG5) << "diff: removed file: " << entryPath;
+        context->callback->removedFile(entryPath);
       }
     };
 
@@ -2295,6 +2667,9 @@ Future<Unit> TreeInode::computeDiff(
       // is always included since it is already tracked in source control.
       bool entryIgnored = isIgnored;
       auto entryPath = currentPath + scmEntry.getName();
+      if (!context->getScope().contains(entryPath)) {
+        return;
+      }
       if (!isIgnored && (inodeEntry->isDirectory() || scmEntry.isTree())) {
         auto fileType = inodeEntry->isDirectory() ? GitIgnore::TYPE_DIR
                                                   : GitIgnore::TYPE_FILE;
@@ -2459,10 +2834,14 @@ Future<Unit> TreeInode::computeDiff(
     load.finish();
   }
 
-  // Now process all of the deferred work.
+  // Now process all of the deferred work, fetching the blob SHA-1s it needs
+  // in bulk.
   vector<Future<Unit>> deferredFutures;
-  for (auto& entry : deferredEntries) {
-    deferredFutures.push_back(entry->run());
+  {
+    DiffContext::BlobSha1Batch batch{context};
+    for (auto& entry : deferredEntries) {
+      deferredFutures.push_back(entry->run());
+    }
   }
 
   // Wait on all of the deferred entries to complete.
@@ -2570,6 +2949,7 @@ Future<Unit> TreeInode::checkout(
 
             // Update our state in the overlay
             self->saveOverlayPostCheckout(ctx, toTree.get());
+            ctx->treeCheckoutCompleted(actions.size());
 
             XLOG(DBG4) << "checkout: finished update of " << self->getLogPath()
                        << ": " << numErrors << " errors";
@@ -2798,6 +3178,7 @@ unique_ptr<CheckoutAction> TreeInode::processCheckoutEntry(
             getOverlay()->allocateInodeNumber(),
             newScmEntry->getHash());
         XDCHECK(inserted);
+        ++state.listingGeneration;
       } else {
         ctx->addError(this, name, success.exception());
       }
@@ -2895,6 +3276,7 @@ unique_ptr<CheckoutAction> TreeInode::processCheckoutEntry(
         getOverlay()->allocateInodeNumber(),
         newScmEntry->getHash());
   }
+  ++state.listingGeneration;
 
   wasDirectoryListModified = true;
 
@@ -2986,6 +3368,7 @@ Future<InvalidationRequired> TreeInode::checkoutUpdateEntry(
             newScmEntry->getHash());
         XDCHECK(inserted);
       }
+      ++contents->listingGeneration;
     }
 
     // We don't save our own overlay data right now:
@@ -3009,7 +3392,14 @@ Future<InvalidationRequired> TreeInode::checkoutUpdateEntry(
       // new name.
     } else {
       // TODO: Also apply permissions changes to the entry.
-      return treeInode->checkout(ctx, std::move(oldTree), std::move(newTree))
+      return ctx
+          ->runSubtreeCheckout([ctx,
+                                treeInode,
+                                oldTree = std::move(oldTree),
+                                newTree = std::move(newTree)]() mutable {
+            return treeInode->checkout(
+                ctx, std::move(oldTree), std::move(newTree));
+          })
           .thenValue([](folly::Unit) { return InvalidationRequired::No; });
     }
   }
@@ -3019,7 +3409,11 @@ Future<InvalidationRequired> TreeInode::checkoutUpdateEntry(
   // Fortunately, calling checkout() with an empty destination tree does
   // exactly what we want.  checkout() will even remove the directory before it
   // returns if the directory is empty.
-  return treeInode->checkout(ctx, std::move(oldTree), nullptr)
+  return ctx
+      ->runSubtreeCheckout(
+          [ctx, treeInode, oldTree = std::move(oldTree)]() mutable {
+            return treeInode->checkout(ctx, std::move(oldTree), nullptr);
+          })
       .thenValue(
           [ctx, parentInode = inodePtrFromThis(), treeInode, newScmEntry](
               auto&&) -> folly::Future<InvalidationRequired> {
@@ -3068,6 +3462,7 @@ Future<InvalidationRequired> TreeInode::checkoutUpdateEntry(
                   parentInode->getOverlay()->allocateInodeNumber(),
                   newScmEntry->getHash());
               inserted = ret.second;
+              ++contents->listingGeneration;
             }
 
             if (!inserted) {
@@ -3569,6 +3964,7 @@ void TreeInode::prefetch(ObjectFetchContext& context) {
   }
   XLOG(DBG4) << "starting prefetch for " << getLogPath();
 
+  BackgroundWorkGuard backgroundWork;
   folly::via(
       getMount()->getServerThreadPool().get(),
       [lease = std::move(*prefetchLease)]() mutable {
@@ -3624,6 +4020,108 @@ void TreeInode::prefetch(ObjectFetchContext& context) {
       });
 }
 
+void TreeInode::predictSiblingLookups(
+    PathComponentPiece name,
+    ObjectFetchContext& context) {
+  auto threshold = getMount()
+                       ->getServerState()
+                       ->getEdenConfig(ConfigReloadBehavior::NoReload)
+                       ->prefetchSiblingLookupThreshold.getValue();
+  if (threshold == 0) {
+    return;
+  }
+  auto pid = context.getClientPid();
+  if (!pid.has_value()) {
+    return;
+  }
+  auto parent = getParentRacy();
+  if (!parent) {
+    return;
+  }
+
+  if (getMount()->getSiblingLookupPredictor().recordLookup(
+          *pid, parent->getNodeId(), getNodeId(), name, threshold)) {
+    parent->prefetchLookupInChildren(name, context);
+  }
+}
+
+void TreeInode::prefetchLookupInChildren(
+    PathComponentPiece name,
+    ObjectFetchContext& context) {
+  auto prefetchLease =
+      getMount()->tryStartTreePrefetch(inodePtrFromThis(), context);
+  if (!prefetchLease) {
+    XLOG(DBG3) << "skipping prefetch of " << name << " in the children of "
+               << getLogPath() << ": too many prefetches already in progress";
+    return;
+  }
+  XLOG(DBG4) << "starting prefetch of " << name << " in the children of "
+             << getLogPath();
+
+  folly::via(
+      getMount()->getServerThreadPool().get(),
+      [lease = std::move(*prefetchLease), name = name.copy()]() mutable {
+        // The same process already looked name up in several of the child
+        // directories, and will likely go on with the remaining ones. Load
+        // them and their entry for name in parallel, so that the tree imports
+        // are not serialized behind the process' lookups.
+        std::vector<IncompleteInodeLoad> pendingLoads;
+        std::vector<Future<Unit>> lookupFutures;
+        // The aliveness of this context is guaranteed by the `.thenTry`
+        // capture at the end of this lambda
+        auto& context = lease.getContext();
+
+        auto lookupInChild = [&context, name](InodePtr inode) {
+          auto tree = inode.asTreePtrOrNull();
+          if (!tree) {
+            return makeFuture();
+          }
+          return tree->getOrLoadChildImpl(name, context, /*nullIfMissing=*/true)
+              .thenValue([&context](InodePtr child) -> folly::SemiFuture<Unit> {
+                if (!child) {
+                  return folly::unit;
+                }
+                return child->stat(context).semi().unit();
+              });
+        };
+
+        {
+          auto contents = lease.getTreeInode()->contents_.wlock();
+
+          for (auto& [childName, entry] : contents->entries) {
+            if (!entry.isDirectory()) {
+              continue;
+            }
+            auto inodeFuture = entry.getInode()
+                ? makeFuture<InodePtr>(entry.getInodePtr())
+                : lease.getTreeInode()->loadChildLocked(
+                      contents->entries,
+                      childName,
+                      entry,
+                      pendingLoads,
+                      context);
+            lookupFutures.emplace_back(
+                std::move(inodeFuture).thenValue(lookupInChild));
+          }
+        }
+
+        // Hook up the pending load futures to properly complete the loading
+        // process then the futures are ready.  We can only do this after
+        // releasing the contents_ lock.
+        for (auto& load : pendingLoads) {
+          load.finish();
+        }
+
+        return folly::collectAllUnsafe(lookupFutures)
+            .thenTry([lease = std::move(lease),
+                      name = std::move(name)](auto&&) {
+              XLOG(DBG4) << "finished prefetch of " << name
+                         << " in the children of "
+                         << lease.getTreeInode()->getLogPath();
+            });
+      });
+}
+
 folly::Future<struct stat> TreeInode::setattr(
     const DesiredMetadata& desired,
     ObjectFetchContext& /*fetchContext*/) {
@@ -23,6 +23,7 @@ class CheckoutContext;
 class DiffContext;
 class FuseDirList;
 class NfsDirList;
+class NfsDirPlusList;
 class EdenMount;
 class GitIgnoreStack;
 class DiffCallback;
@@ -64,6 +65,13 @@ struct TreeInodeState {
    * treeHash will be none.
    */
   std::optional<Hash> treeHash;
+
+  /**
+   * Bumped whenever an entry is added to, removed from or replaced in entries,
+   * whether or not the channel caches are invalidated. Cached readdir
+   * listings of an older generation are stale.
+   */
+  uint64_t listingGeneration{0};
 };
 
 /**
@@ -130,6 +138,19 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
   folly::Future<InodePtr> getOrLoadChild(
       PathComponentPiece name,
       ObjectFetchContext& context);
+
+  /**
+   * Like getOrLoadChild, but a null InodePtr is returned when this directory
+   * has no child with that name.
+   *
+   * Build systems probe a large number of nonexistent paths, this allows the
+   * channels to answer these lookups without constructing and propagating an
+   * InodeError.
+   */
+  folly::Future<InodePtr> getOrLoadChildIfExists(
+      PathComponentPiece name,
+      ObjectFetchContext& context);
+
   folly::Future<TreeInodePtr> getOrLoadChildTree(
       PathComponentPiece name,
       ObjectFetchContext& context);
@@ -157,6 +178,18 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
   FuseDirList
   fuseReaddir(FuseDirList&& list, off_t off, ObjectFetchContext& context);
 
+#ifdef __linux__
+  /**
+   * Like fuseReaddir(), but also returns the attributes of each entry, as
+   * required by FUSE_READDIRPLUS.
+   *
+   * The children returned in the list are loaded, and their FS refcount is
+   * incremented since the kernel takes a reference on each of them.
+   */
+  ImmediateFuture<FuseDirList>
+  fuseReaddirPlus(FuseDirList&& list, off_t off, ObjectFetchContext& context);
+#endif
+
   /**
    * Populate the list with as many directory entries as possible starting from
    * the inode start.
@@ -166,6 +199,21 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
    */
   std::tuple<NfsDirList, bool>
   nfsReaddir(NfsDirList&& list, off_t off, ObjectFetchContext& context);
+
+  /**
+   * Like nfsReaddir(), but also returns the attributes of each entry in the
+   * list, in the same order, as required by READDIRPLUS. The attributes are
+   * std::nullopt for the "." and ".." entries and for the entries that could
+   * not be loaded.
+   *
+   * The children returned in the list are loaded.
+   */
+  ImmediateFuture<
+      std::tuple<NfsDirPlusList, std::vector<std::optional<struct stat>>, bool>>
+  nfsReaddirPlus(
+      NfsDirPlusList&& list,
+      off_t off,
+      ObjectFetchContext& context);
 #else
   /**
    * The following readdir() is for responding to Projected FS's directory
@@ -185,6 +233,12 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
     return contents_;
   }
 
+  /**
+   * Estimate the memory used by this TreeInode and its directory entries.
+   * The inodes of the children are not counted.
+   */
+  size_t estimateMemoryUsage() const;
+
   FileInodePtr symlink(
       PathComponentPiece name,
       folly::StringPiece contents,
@@ -431,6 +485,15 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
    */
   ObjectStore* getStore() const;
 
+  /**
+   * Implementation of getOrLoadChild and getOrLoadChildIfExists, a missing
+   * child fails with an InodeError unless nullIfMissing is true.
+   */
+  folly::Future<InodePtr> getOrLoadChildImpl(
+      PathComponentPiece name,
+      ObjectFetchContext& context,
+      bool nullIfMissing);
+
   void registerInodeLoadComplete(
       folly::Future<std::unique_ptr<InodeBase>>& future,
       PathComponentPiece name,
@@ -460,7 +523,7 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
   FOLLY_NODISCARD folly::Future<folly::Unit> doRename(
       TreeRenameLocks&& locks,
       PathComponentPiece srcName,
-      PathMap<DirEntry>::iterator srcIter,
+      DirContents::iterator srcIter,
       TreeInodePtr destParent,
       PathComponentPiece destName,
       InvalidationRequired invalidate);
@@ -501,6 +564,23 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
 
   void prefetch(ObjectFetchContext& context);
 
+  /**
+   * Reports a lookup of name in this directory to the SiblingLookupPredictor
+   * of the mount. When the predictor expects the process to look name up in
+   * the siblings of this directory next, prefetches those lookups.
+   */
+  void predictSiblingLookups(
+      PathComponentPiece name,
+      ObjectFetchContext& context);
+
+  /**
+   * Loads every child directory of this inode and looks up name in each of
+   * them, in the background and at low priority.
+   */
+  void prefetchLookupInChildren(
+      PathComponentPiece name,
+      ObjectFetchContext& context);
+
   /**
    * Get a TreeInodePtr to ourself.
    *
@@ -523,6 +603,30 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
   template <typename Fn>
   bool readdirImpl(off_t offset, ObjectFetchContext& context, Fn add);
 
+#ifndef _WIN32
+  /**
+   * An immutable copy of the entries of this directory, sorted by inode
+   * number, from which readdir replies are paged without holding the
+   * contents lock.
+   */
+  struct DirListing {
+    struct Entry {
+      PathComponent name;
+      InodeNumber ino;
+      mode_t mode;
+    };
+
+    uint64_t generation;
+    std::vector<Entry> entries;
+  };
+
+  /**
+   * Returns the listing of the current entries, reusing the cached one if
+   * the entries have not changed since.
+   */
+  std::shared_ptr<const DirListing> getDirListing();
+#endif
+
   /**
    * createImpl() is a helper function for creating new children inodes.
    *
@@ -730,6 +834,13 @@ class TreeInode final : public InodeBaseMetadata<DirContents> {
    * Only prefetch blob metadata on the first readdir() of a loaded inode.
    */
   std::atomic<bool> prefetched_{false};
+
+#ifndef _WIN32
+  /**
+   * The listing built by the last readdir of a large enough directory.
+   */
+  folly::Synchronized<std::shared_ptr<const DirListing>> dirListing_;
+#endif
 };
 
 /**
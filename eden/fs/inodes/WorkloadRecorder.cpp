@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#ifndef _WIN32
+
+#include "eden/fs/inodes/WorkloadRecorder.h"
+
+#include <fcntl.h>
+#include <folly/Conv.h>
+#include <folly/File.h>
+#include <folly/FileUtil.h>
+#include <folly/logging/xlog.h>
+#include "eden/fs/inodes/EdenMount.h"
+#include "eden/fs/inodes/InodeMap.h"
+#include "eden/fs/inodes/WorkloadTrace.h"
+#include "eden/fs/utils/IDGen.h"
+
+namespace facebook::eden {
+
+namespace {
+
+/**
+ * Return the value of `key` in arguments rendered by FuseChannel like
+ * "key1=value1, key2=value2", up to the next key if given. Names aren't
+ * escaped, so the next key is searched from the end.
+ */
+std::optional<folly::StringPiece> argument(
+    folly::StringPiece arguments,
+    folly::StringPiece key,
+    folly::StringPiece nextKey = {}) {
+  auto start = arguments.find(folly::to<std::string>(key, "="));
+  if (start == folly::StringPiece::npos) {
+    return std::nullopt;
+  }
+  auto value = arguments.subpiece(start + key.size() + 1);
+  if (!nextKey.empty()) {
+    auto end = value.rfind(folly::to<std::string>(", ", nextKey, "="));
+    if (end == folly::StringPiece::npos) {
+      return std::nullopt;
+    }
+    value = value.subpiece(0, end);
+  } else if (auto end = value.find(", "); end != folly::StringPiece::npos) {
+    value = value.subpiece(0, end);
+  }
+  return value;
+}
+
+uint64_t numericArgument(folly::StringPiece arguments, folly::StringPiece key) {
+  auto value = argument(arguments, key);
+  return value ? folly::to<uint64_t>(*value) : 0;
+}
+
+/**
+ * Convert the START event of a request to a record, or return std::nullopt
+ * if the request isn't replayed or its inode can't be resolved.
+ */
+std::optional<WorkloadTraceRecord> makeRecord(
+    const FuseTraceEvent& event,
+    InodeMap& inodeMap,
+    std::chrono::steady_clock::time_point start) {
+  const auto& request = event.getRequest();
+  folly::StringPiece arguments;
+  if (const auto& renderedArguments = event.getArguments()) {
+    arguments = *renderedArguments;
+  }
+  auto pathForInode = [&](uint64_t nodeid) {
+    return inodeMap.getPathForInode(InodeNumber{nodeid});
+  };
+
+  auto path = pathForInode(request.nodeid);
+  if (!path) {
+    return std::nullopt;
+  }
+  WorkloadTraceRecord record;
+  record.time = std::chrono::duration_cast<std::chrono::microseconds>(
+      event.monotonicTime - start);
+  record.op = fuseOpcodeName(request.opcode).str();
+  record.pid = request.pid;
+
+  switch (request.opcode) {
+    case FUSE_GETATTR:
+      record.path = std::move(*path);
+      break;
+    case FUSE_LOOKUP:
+    case FUSE_UNLINK:
+    case FUSE_RMDIR:
+      record.path = *path + PathComponentPiece{arguments};
+      break;
+    case FUSE_MKDIR: {
+      auto mode = arguments.rfind(", mode=");
+      if (mode == folly::StringPiece::npos) {
+        return std::nullopt;
+      }
+      record.path = *path + PathComponentPiece{arguments.subpiece(0, mode)};
+      break;
+    }
+    case FUSE_CREATE: {
+      auto name = argument(arguments, "name", "mode");
+      if (!name) {
+        return std::nullopt;
+      }
+      record.path = *path + PathComponentPiece{*name};
+      break;
+    }
+    case FUSE_RENAME: {
+      auto oldName = argument(arguments, "old", "newdir");
+      auto newName = argument(arguments, "new");
+      auto newdir = argument(arguments, "newdir");
+      if (!oldName || !newName || !newdir) {
+        return std::nullopt;
+      }
+      auto newParent = pathForInode(folly::to<uint64_t>(*newdir));
+      if (!newParent) {
+        return std::nullopt;
+      }
+      record.path = *path + PathComponentPiece{*oldName};
+      record.newPath = *newParent + PathComponentPiece{*newName};
+      break;
+    }
+    case FUSE_READ:
+    case FUSE_WRITE:
+      record.path = std::move(*path);
+      record.offset = numericArgument(arguments, "off");
+      record.size = numericArgument(arguments, "len");
+      break;
+    case FUSE_READDIR:
+    case FUSE_READDIRPLUS:
+      record.path = std::move(*path);
+      record.offset = numericArgument(arguments, "offset");
+      break;
+    default:
+      return std::nullopt;
+  }
+  return record;
+}
+
+} // namespace
+
+WorkloadRecorder::WorkloadRecorder(std::shared_ptr<EdenMount> edenMount)
+    : IActivityRecorder{std::move(edenMount)} {}
+
+WorkloadRecorder::~WorkloadRecorder() = default;
+
+uint64_t WorkloadRecorder::addSubscriber(AbsolutePathPiece outputDir) {
+  auto* fuseChannel = edenMount_->getFuseChannel();
+  if (!fuseChannel) {
+    XLOG(WARN) << "workload recording is only supported on FUSE mounts";
+    return 0;
+  }
+
+  auto unique = generateUniqueID();
+  auto outputPath = outputDir +
+      PathComponent{folly::to<std::string>("workload-", unique, ".jsonl")};
+  std::shared_ptr<folly::File> output;
+  try {
+    output = std::make_shared<folly::File>(
+        outputPath.stringPiece(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC);
+  } catch (const std::exception& ex) {
+    XLOG(ERR) << "unable to create workload trace " << outputPath << ": "
+              << folly::exceptionStr(ex);
+    return 0;
+  }
+
+  Recording recording{outputPath, fuseChannel->traceDetailedArguments(), {}};
+  recording.subHandle = fuseChannel->getTraceBus().subscribeFunction(
+      folly::to<std::string>("workload-", edenMount_->getPath().basename()),
+      [output = std::move(output),
+       mount = std::weak_ptr<EdenMount>{edenMount_},
+       start = std::chrono::steady_clock::now()](const FuseTraceEvent& event) {
+        if (event.getType() != FuseTraceEvent::START) {
+          return;
+        }
+        auto edenMount = mount.lock();
+        if (!edenMount) {
+          return;
+        }
+        std::optional<WorkloadTraceRecord> record;
+        try {
+          record = makeRecord(event, *edenMount->getInodeMap(), start);
+        } catch (const std::exception& ex) {
+          XLOG(DBG3) << "not recording "
+                     << fuseOpcodeName(event.getRequest().opcode) << ": "
+                     << folly::exceptionStr(ex);
+        }
+        if (record) {
+          auto line = serializeWorkloadTraceRecord(*record);
+          if (folly::writeFull(output->fd(), line.data(), line.size()) < 0) {
+            XLOG_EVERY_MS(ERR, 1000)
+                << "unable to write workload trace: " << folly::errnoStr(errno);
+          }
+        }
+      });
+
+  recordings_.wlock()->emplace(unique, std::move(recording));
+  return unique;
+}
+
+std::optional<std::string> WorkloadRecorder::removeSubscriber(
+    uint64_t unique) {
+  auto recordings = recordings_.wlock();
+  auto it = recordings->find(unique);
+  if (it == recordings->end()) {
+    return std::nullopt;
+  }
+  auto outputPath = it->second.outputPath.value();
+  recordings->erase(it);
+  return outputPath;
+}
+
+std::vector<std::tuple<uint64_t, std::string>>
+WorkloadRecorder::getSubscribers() {
+  std::vector<std::tuple<uint64_t, std::string>> subscribers;
+  for (const auto& [unique, recording] : *recordings_.rlock()) {
+    subscribers.emplace_back(unique, recording.outputPath.value());
+  }
+  return subscribers;
+}
+
+} // namespace facebook::eden
+
+#endif // !_WIN32
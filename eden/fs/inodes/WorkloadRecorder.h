@@ -0,0 +1,49 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#ifndef _WIN32
+
+#include <folly/Synchronized.h>
+#include <map>
+#include "eden/fs/fuse/FuseChannel.h"
+#include "eden/fs/telemetry/IActivityRecorder.h"
+
+namespace facebook::eden {
+
+/**
+ * Records the FUSE requests of a mount as workload traces, in the format of
+ * WorkloadTrace.h, so that they can be replayed against a fresh mount by the
+ * replay_workload benchmark.
+ *
+ * Each subscriber writes a trace to workload-<unique>.jsonl in its output
+ * directory. The paths are resolved when the request is received, so the
+ * requests for inodes that were unlinked in the meantime are dropped.
+ */
+class WorkloadRecorder final : public IActivityRecorder {
+ public:
+  explicit WorkloadRecorder(std::shared_ptr<EdenMount> edenMount);
+  ~WorkloadRecorder() override;
+
+  uint64_t addSubscriber(AbsolutePathPiece outputDir) override;
+  std::optional<std::string> removeSubscriber(uint64_t unique) override;
+  std::vector<std::tuple<uint64_t, std::string>> getSubscribers() override;
+
+ private:
+  struct Recording {
+    AbsolutePath outputPath;
+    TraceDetailedArgumentsHandle argHandle;
+    TraceSubscriptionHandle<FuseTraceEvent> subHandle;
+  };
+
+  folly::Synchronized<std::map<uint64_t, Recording>> recordings_;
+};
+
+} // namespace facebook::eden
+
+#endif // !_WIN32
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/WorkloadTrace.h"
+
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <folly/String.h>
+#include <folly/json.h>
+
+namespace facebook::eden {
+
+folly::dynamic WorkloadTraceRecord::toDynamic() const {
+  auto value = folly::dynamic::object("time_us", time.count())("op", op)(
+      "path", path.stringPiece())("pid", pid);
+  if (newPath) {
+    value["new_path"] = newPath->stringPiece();
+  }
+  if (offset != 0) {
+    value["offset"] = offset;
+  }
+  if (size != 0) {
+    value["size"] = size;
+  }
+  return value;
+}
+
+WorkloadTraceRecord WorkloadTraceRecord::fromDynamic(
+    const folly::dynamic& value) {
+  WorkloadTraceRecord record;
+  record.time = std::chrono::microseconds{value["time_us"].asInt()};
+  record.op = value["op"].asString();
+  record.path = RelativePath{value["path"].asString()};
+  if (auto* newPath = value.get_ptr("new_path")) {
+    record.newPath = RelativePath{newPath->asString()};
+  }
+  record.offset = value.getDefault("offset", 0).asInt();
+  record.size = value.getDefault("size", 0).asInt();
+  record.pid = value["pid"].asInt();
+  return record;
+}
+
+bool WorkloadTraceRecord::operator==(const WorkloadTraceRecord& other) const {
+  return time == other.time && op == other.op && path == other.path &&
+      newPath == other.newPath && offset == other.offset &&
+      size == other.size && pid == other.pid;
+}
+
+std::string serializeWorkloadTraceRecord(const WorkloadTraceRecord& record) {
+  auto line = folly::toJson(record.toDynamic());
+  line.push_back('\n');
+  return line;
+}
+
+std::vector<WorkloadTraceRecord> readWorkloadTrace(AbsolutePathPiece path) {
+  std::string contents;
+  if (!folly::readFile(path.stringPiece().str().c_str(), contents)) {
+    folly::throwSystemError("unable to read workload trace ", path);
+  }
+  std::vector<folly::StringPiece> lines;
+  folly::split('\n', contents, lines);
+
+  std::vector<WorkloadTraceRecord> records;
+  records.reserve(lines.size());
+  for (auto line : lines) {
+    if (!line.empty()) {
+      records.push_back(
+          WorkloadTraceRecord::fromDynamic(folly::parseJson(line)));
+    }
+  }
+  return records;
+}
+
+} // namespace facebook::eden
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/dynamic.h>
+#include <sys/types.h>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <vector>
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook::eden {
+
+/**
+ * One filesystem request of a workload trace, as recorded by
+ * WorkloadRecorder and replayed by the replay_workload benchmark.
+ *
+ * A trace is a file of one JSON object per line, in the order the requests
+ * were received.
+ */
+struct WorkloadTraceRecord {
+  /**
+   * When the request was received, since the start of the recording.
+   */
+  std::chrono::microseconds time{0};
+
+  /**
+   * The name of the request, as returned by fuseOpcodeName().
+   */
+  std::string op;
+
+  /**
+   * The path of the inode the request is for or, for the requests on a
+   * directory entry like lookups, unlinks or renames, of that entry.
+   */
+  RelativePath path;
+
+  /**
+   * The new path of a renamed entry.
+   */
+  std::optional<RelativePath> newPath;
+
+  uint64_t offset{0};
+  uint64_t size{0};
+  pid_t pid{0};
+
+  folly::dynamic toDynamic() const;
+
+  /**
+   * Throws if value isn't a valid record.
+   */
+  static WorkloadTraceRecord fromDynamic(const folly::dynamic& value);
+
+  bool operator==(const WorkloadTraceRecord& other) const;
+};
+
+/**
+ * Serialize the record as one line of a trace, including its newline.
+ */
+std::string serializeWorkloadTraceRecord(const WorkloadTraceRecord& record);
+
+/**
+ * Read all the records of the trace at path, skipping empty lines.
+ */
+std::vector<WorkloadTraceRecord> readWorkloadTrace(AbsolutePathPiece path);
+
+} // namespace facebook::eden
@@ -10,8 +10,16 @@
 #include "eden/fs/inodes/overlay/FsOverlay.h"
 
 #include <boost/filesystem.hpp>
+#include <dirent.h>
+#include <sys/ioctl.h>
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <vector>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
 
 #include <folly/Exception.h>
 #include <folly/File.h>
@@ -19,6 +27,8 @@
 #include <folly/Range.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
+#include <folly/ScopeGuard.h>
+#include <folly/String.h>
 #include <folly/lang/ToAscii.h>
 #include <folly/logging/xlog.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
@@ -47,6 +57,7 @@ using std::string;
  */
 constexpr StringPiece kInfoFile{"info"};
 constexpr const char* kNextInodeNumberFile{"next-inode-number"};
+constexpr const char* kInodeNumberReservationFile{"inode-number-reservation"};
 
 /**
  * 4-byte magic identifier to put at the start of the info file.
@@ -64,9 +75,36 @@ constexpr folly::StringPiece FsOverlay::kMetadataFile;
  * an older version of the code.
  */
 constexpr uint32_t kOverlayVersion = 1;
+
+/**
+ * The directory, relative to the overlay, holding the blob contents that
+ * materialized files are cloned from.
+ */
+constexpr auto kBlobCacheDir = "blobs"_sp;
+/**
+ * The directory, relative to the overlay, holding a copy of the contents of
+ * materialized files, named after their SHA-1, which other files with the
+ * same contents are deduplicated against.
+ */
+constexpr auto kContentIndexDir = "contents"_sp;
 constexpr size_t kInfoHeaderSize =
     kInfoHeaderMagic.size() + sizeof(kOverlayVersion);
 
+/**
+ * Makes the file destFd a copy of srcFd that shares its blocks. The caches
+ * that rely on this are only enabled on Linux.
+ */
+int cloneFile(int destFd, int srcFd) {
+#ifdef __linux__
+  return ioctl(destFd, FICLONE, srcFd);
+#else
+  (void)destFd;
+  (void)srcFd;
+  errno = EOPNOTSUPP;
+  return -1;
+#endif
+}
+
 constexpr folly::StringPiece FsOverlay::kHeaderIdentifierDir;
 constexpr folly::StringPiece FsOverlay::kHeaderIdentifierFile;
 constexpr uint32_t FsOverlay::kHeaderVersion;
@@ -134,12 +172,143 @@ std::optional<InodeNumber> FsOverlay::initOverlay(bool createIfNonExisting) {
       dirFd, "error opening overlay directory handle for ", localDir_.value());
   dirFile_ = File{dirFd, /* ownsFd */ true};
 
+  initBlobCache();
+
   if (overlayCreated) {
     return InodeNumber{kRootNodeId.get() + 1};
   }
   return tryLoadNextInodeNumber();
 }
 
+void FsOverlay::initBlobCache() {
+#ifdef __linux__
+  if (blobCacheSize_ > 0) {
+    blobCacheEnabled_ = initCacheDir(kBlobCacheDir, blobCacheBytes_);
+  }
+  if (contentIndexSize_ > 0) {
+    contentIndexEnabled_ = initCacheDir(kContentIndexDir, contentIndexBytes_);
+  }
+#endif // __linux__
+}
+
+bool FsOverlay::initCacheDir(
+    folly::StringPiece name,
+    std::atomic<uint64_t>& cachedBytes) {
+  auto result = ::mkdirat(dirFile_.fd(), name.str().c_str(), 0700);
+  if (result != 0 && errno != EEXIST) {
+    XLOG(WARN) << "unable to create the overlay " << name << " directory in "
+               << localDir_ << ": " << folly::errnoStr(errno);
+    return false;
+  }
+
+  // Account for the files cached by previous runs, which count against the
+  // size limit.
+  int fd = openat(
+      dirFile_.fd(), name.str().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd == -1) {
+    XLOG(WARN) << "unable to open the overlay " << name << " directory in "
+               << localDir_ << ": " << folly::errnoStr(errno);
+    return false;
+  }
+  DIR* dir = fdopendir(fd);
+  if (!dir) {
+    ::close(fd);
+    return false;
+  }
+  SCOPE_EXIT {
+    closedir(dir);
+  };
+
+  uint64_t bytes = 0;
+  while (auto* entry = readdir(dir)) {
+    struct stat st;
+    if (fstatat(dirfd(dir), entry->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 &&
+        S_ISREG(st.st_mode)) {
+      bytes += st.st_size;
+    }
+  }
+  cachedBytes = bytes;
+  return true;
+}
+
+bool FsOverlay::reserveCacheBytes(
+    folly::StringPiece name,
+    std::atomic<uint64_t>& cachedBytes,
+    uint64_t size,
+    uint64_t limit) {
+  if (cachedBytes.fetch_add(size) + size <= limit) {
+    return true;
+  }
+  cachedBytes.fetch_sub(size);
+  if (size > limit / 2) {
+    // Evicting would not make room for it.
+    return false;
+  }
+  evictCacheDir(name, cachedBytes, limit);
+  if (cachedBytes.fetch_add(size) + size <= limit) {
+    return true;
+  }
+  cachedBytes.fetch_sub(size);
+  return false;
+}
+
+void FsOverlay::evictCacheDir(
+    folly::StringPiece name,
+    std::atomic<uint64_t>& cachedBytes,
+    uint64_t limit) {
+  // Threads that find the cache full while another one evicts just don't
+  // add to it.
+  std::unique_lock<std::mutex> lock{evictionMutex_, std::try_to_lock};
+  if (!lock.owns_lock() || cachedBytes.load() <= limit / 2) {
+    return;
+  }
+
+  int fd = openat(
+      dirFile_.fd(), name.str().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd == -1) {
+    return;
+  }
+  DIR* dir = fdopendir(fd);
+  if (!dir) {
+    ::close(fd);
+    return;
+  }
+  SCOPE_EXIT {
+    closedir(dir);
+  };
+
+  struct CachedFile {
+    time_t mtime;
+    uint64_t size;
+    std::string name;
+  };
+  std::vector<CachedFile> files;
+  while (auto* entry = readdir(dir)) {
+    struct stat st;
+    if (fstatat(dirfd(dir), entry->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 &&
+        S_ISREG(st.st_mode)) {
+      files.push_back(CachedFile{
+          st.st_mtime, static_cast<uint64_t>(st.st_size), entry->d_name});
+    }
+  }
+  std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) {
+    return a.mtime < b.mtime;
+  });
+
+  uint64_t removed = 0;
+  for (const auto& file : files) {
+    if (cachedBytes.load() - removed <= limit / 2) {
+      break;
+    }
+    if (unlinkat(dirfd(dir), file.name.c_str(), 0) == 0) {
+      removed += file.size;
+    }
+  }
+  cachedBytes.fetch_sub(removed);
+  XLOG(DBG3) << "evicted " << removed << " bytes from the overlay " << name
+             << " directory in " << localDir_;
+}
+
 struct statfs FsOverlay::statFs() const {
   struct statfs fs = {};
   fstatfs(infoFile_.fd(), &fs);
@@ -150,6 +319,13 @@ void FsOverlay::close(std::optional<InodeNumber> inodeNumber) {
   if (inodeNumber) {
     saveNextInodeNumber(inodeNumber.value());
   }
+  // A reservation is only needed to recover from an unclean shutdown.
+  if (unlinkat(dirFile_.fd(), kInodeNumberReservationFile, 0) &&
+      errno != ENOENT) {
+    XLOG(WARN) << "Failed to unlink " << kInodeNumberReservationFile
+               << " in overlay " << localDir_ << ": "
+               << folly::errnoStr(errno);
+  }
   dirFile_.close();
   infoFile_.close();
 }
@@ -200,6 +376,52 @@ std::optional<InodeNumber> FsOverlay::tryLoadNextInodeNumber() {
   return InodeNumber{nextInodeNumber};
 }
 
+std::optional<InodeNumber> FsOverlay::loadInodeNumberReservation() {
+  int fd =
+      openat(dirFile_.fd(), kInodeNumberReservationFile, O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    if (errno == ENOENT) {
+      return std::nullopt;
+    }
+    folly::throwSystemError("Failed to open ", kInodeNumberReservationFile);
+  }
+
+  folly::File reservationFile{fd, /* ownsFd */ true};
+
+  // Like kNextInodeNumberFile, the reservation can only be trusted once: a
+  // later run without reservations may allocate inode numbers beyond it.
+  if (unlinkat(dirFile_.fd(), kInodeNumberReservationFile, 0)) {
+    folly::throwSystemError(
+        "Failed to unlink ", kInodeNumberReservationFile, " in overlay");
+  }
+
+  uint64_t reservation;
+  auto readResult = folly::readFull(fd, &reservation, sizeof(reservation));
+  if (readResult < 0) {
+    folly::throwSystemError(
+        "Failed to read ", kInodeNumberReservationFile, " from overlay");
+  }
+  if (readResult != sizeof(reservation) || reservation <= kRootNodeId.get()) {
+    XLOG(WARN) << "Ignoring invalid inode number reservation in overlay "
+               << localDir_;
+    return std::nullopt;
+  }
+  return InodeNumber{reservation};
+}
+
+void FsOverlay::saveInodeNumberReservation(InodeNumber limit) {
+  auto reservationPath =
+      localDir_ + PathComponentPiece{kInodeNumberReservationFile};
+
+  auto limitVal = limit.get();
+  writeFileAtomic(
+      reservationPath,
+      ByteRange(
+          reinterpret_cast<const uint8_t*>(&limitVal),
+          reinterpret_cast<const uint8_t*>(&limitVal + 1)))
+      .value();
+}
+
 void FsOverlay::saveNextInodeNumber(InodeNumber nextInodeNumber) {
   auto nextInodeNumberPath =
       localDir_ + PathComponentPiece{kNextInodeNumberFile};
@@ -437,8 +659,17 @@ folly::File FsOverlay::openFileNoVerify(InodeNumber inodeNumber) {
 namespace {
 
 constexpr auto tmpPrefix = "tmp/"_sp;
-using InodeTmpPath = std::
-    array<char, tmpPrefix.size() + FsOverlay::kMaxDecimalInodeNumberLength + 1>;
+// The inode number, a dot and a sequence number.
+using InodeTmpPath = std::array<
+    char,
+    tmpPrefix.size() + FsOverlay::kMaxDecimalInodeNumberLength + 1 +
+        folly::to_ascii_size_max_decimal<uint64_t> + 1>;
+
+/**
+ * Distinguishes the temporary files of concurrent writes of the same inode,
+ * or of an overlay file and of a cache entry cloned from it.
+ */
+std::atomic<uint64_t> tmpFileSequence{0};
 
 InodeTmpPath getFileTmpPath(InodeNumber inodeNumber) {
   // It's substantially faster on XFS to create this temporary file in
@@ -446,9 +677,15 @@ InodeTmpPath getFileTmpPath(InodeNumber inodeNumber) {
   // than to create it directly in the subtree.
   InodeTmpPath tmpPath;
   memcpy(tmpPath.data(), tmpPrefix.data(), tmpPrefix.size());
-  auto index = folly::to_ascii_decimal(
-      tmpPath.data() + tmpPrefix.size(), tmpPath.end(), inodeNumber.get());
-  tmpPath[tmpPrefix.size() + index] = '\0';
+  auto pos = tmpPrefix.size();
+  pos += folly::to_ascii_decimal(
+      tmpPath.data() + pos, tmpPath.end(), inodeNumber.get());
+  tmpPath[pos++] = '.';
+  pos += folly::to_ascii_decimal(
+      tmpPath.data() + pos,
+      tmpPath.end(),
+      tmpFileSequence.fetch_add(1, std::memory_order_relaxed));
+  tmpPath[pos] = '\0';
   return tmpPath;
 }
 
@@ -458,26 +695,42 @@ folly::File FsOverlay::createOverlayFileImpl(
     InodeNumber inodeNumber,
     iovec* iov,
     size_t iovCount) {
+  auto path = getFilePath(inodeNumber);
+  return createFileAtomically(inodeNumber, path.c_str(), [&](int fd) {
+    auto sizeWritten = folly::writevFull(fd, iov, iovCount);
+    folly::checkUnixError(
+        sizeWritten,
+        "error writing to overlay file for inode ",
+        inodeNumber,
+        " in ",
+        localDir_);
+  });
+}
+
+folly::File FsOverlay::createFileAtomically(
+    InodeNumber inodeNumber,
+    const char* path,
+    folly::FunctionRef<void(int fd)> fill) {
   // We do not use mkstemp() to create the temporary file, since there is no
-  // mkstempat() equivalent that can create files relative to dirFile.  We
-  // simply create the file with a fixed suffix, and do not use O_EXCL.  This
-  // is not a security risk since only the current user should have permission
-  // to create files inside the overlay directory, so no one else can create
-  // symlinks inside the overlay directory.  We also open the temporary file
-  // using O_NOFOLLOW.
+  // mkstempat() equivalent that can create files relative to dirFile.
+  // Instead, the name of the temporary file is made unique within this
+  // process with a sequence number, and the file is created with O_EXCL, so
+  // that concurrent writes never share a temporary file. A name left by a
+  // previous process that crashed is skipped.
   //
   // We could potentially use O_TMPFILE followed by linkat() to commit the
   // file.  However this may not be supported by all filesystems, and seems to
   // provide minimal benefits for our use case.
-  auto path = getFilePath(inodeNumber);
-
-  auto tmpPath = getFileTmpPath(inodeNumber);
-
-  auto tmpFD = openat(
-      dirFile_.fd(),
-      tmpPath.data(),
-      O_CREAT | O_RDWR | O_CLOEXEC | O_NOFOLLOW | O_TRUNC,
-      0600);
+  InodeTmpPath tmpPath;
+  int tmpFD;
+  do {
+    tmpPath = getFileTmpPath(inodeNumber);
+    tmpFD = openat(
+        dirFile_.fd(),
+        tmpPath.data(),
+        O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC | O_NOFOLLOW,
+        0600);
+  } while (tmpFD < 0 && errno == EEXIST);
   folly::checkUnixError(
       tmpFD,
       "failed to create temporary overlay file for inode ",
@@ -492,13 +745,7 @@ folly::File FsOverlay::createOverlayFileImpl(
     }
   };
 
-  auto sizeWritten = folly::writevFull(tmpFD, iov, iovCount);
-  folly::checkUnixError(
-      sizeWritten,
-      "error writing to overlay file for inode ",
-      inodeNumber,
-      " in ",
-      localDir_);
+  fill(tmpFD);
 
   // fdatasync() is required to ensure that we are really reliably and
   // atomically writing out the new file.  Without calling fdatasync() the file
@@ -526,7 +773,7 @@ folly::File FsOverlay::createOverlayFileImpl(
   }
 
   auto returnCode =
-      renameat(dirFile_.fd(), tmpPath.data(), dirFile_.fd(), path.c_str());
+      renameat(dirFile_.fd(), tmpPath.data(), dirFile_.fd(), path);
   folly::checkUnixError(
       returnCode,
       "error committing overlay file for inode ",
@@ -575,6 +822,212 @@ folly::File FsOverlay::createOverlayFile(
   return createOverlayFileImpl(inodeNumber, iov.data(), iov.size());
 }
 
+folly::File FsOverlay::createOverlayFileFromBlob(
+    InodeNumber inodeNumber,
+    const Hash& blobHash,
+    const IOBuf& contents) {
+  auto useBlobCache = [&] {
+    return blobCacheEnabled_ &&
+        !cloneUnsupported_.load(std::memory_order_relaxed);
+  };
+  auto fileSize = kHeaderLength + contents.computeChainDataLength();
+  if (useBlobCache()) {
+    if (auto file = cloneFromBlobCache(inodeNumber, blobHash, fileSize)) {
+      return std::move(*file);
+    }
+  }
+  // The contents are only written once: they are added to the cache by
+  // cloning the new overlay file.
+  auto file = createOverlayFile(inodeNumber, contents);
+  if (useBlobCache()) {
+    addToBlobCache(inodeNumber, blobHash, file, fileSize);
+  }
+  return file;
+}
+
+void FsOverlay::dedupeOverlayFile(InodeNumber inodeNumber, const Hash& sha1) {
+  if (!contentIndexEnabled_ ||
+      dedupeUnsupported_.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  auto indexPath =
+      folly::to<std::string>(kContentIndexDir, "/", sha1.toString());
+  try {
+    auto file = openFileNoVerify(inodeNumber);
+    struct stat st;
+    folly::checkUnixError(fstat(file.fd(), &st), "fstat failed");
+    auto fileSize = static_cast<uint64_t>(st.st_size);
+
+    int indexFd = openat(
+        dirFile_.fd(), indexPath.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (indexFd < 0) {
+      if (errno != ENOENT) {
+        folly::throwSystemError("error opening ", indexPath);
+      }
+      if (!reserveCacheBytes(
+              kContentIndexDir,
+              contentIndexBytes_,
+              fileSize,
+              contentIndexSize_)) {
+        return;
+      }
+      // The first file with these contents is cloned into the index, so they
+      // already share their blocks.
+      try {
+        createFileAtomically(inodeNumber, indexPath.c_str(), [&](int fd) {
+          folly::checkUnixError(
+              cloneFile(fd, file.fd()),
+              "error adding inode ",
+              inodeNumber,
+              " to the index");
+        });
+      } catch (const std::exception&) {
+        contentIndexBytes_.fetch_sub(fileSize);
+        throw;
+      }
+      return;
+    }
+
+    File indexFile{indexFd, /* ownsFd */ true};
+    struct stat indexSt;
+    folly::checkUnixError(fstat(indexFd, &indexSt), "fstat failed");
+    if (static_cast<uint64_t>(indexSt.st_size) != fileSize) {
+      return;
+    }
+    // Keep the entry from being evicted while it is still being used.
+    futimens(indexFd, nullptr);
+
+#ifdef __linux__
+    // The kernel compares the ranges and only shares the blocks of identical
+    // ones, and it may process less than requested per call.
+    constexpr size_t kRangeSize =
+        sizeof(file_dedupe_range) + sizeof(file_dedupe_range_info);
+    alignas(file_dedupe_range) std::array<uint8_t, kRangeSize> storage{};
+    auto* range = reinterpret_cast<file_dedupe_range*>(storage.data());
+    uint64_t offset = 0;
+    while (offset < fileSize) {
+      range->src_offset = offset;
+      range->src_length = fileSize - offset;
+      range->dest_count = 1;
+      range->info[0].dest_fd = file.fd();
+      range->info[0].dest_offset = offset;
+      folly::checkUnixError(
+          ioctl(indexFd, FIDEDUPERANGE, range),
+          "error deduplicating inode ",
+          inodeNumber);
+      if (range->info[0].status < 0) {
+        folly::throwSystemErrorExplicit(
+            -range->info[0].status,
+            "error deduplicating inode ",
+            inodeNumber);
+      }
+      if (range->info[0].status == FILE_DEDUPE_RANGE_DIFFERS ||
+          range->info[0].bytes_deduped == 0) {
+        break;
+      }
+      offset += range->info[0].bytes_deduped;
+    }
+#else
+    folly::throwSystemErrorExplicit(EOPNOTSUPP, "FIDEDUPERANGE unavailable");
+#endif
+  } catch (const std::system_error& ex) {
+    auto error = ex.code().value();
+    if (error == EOPNOTSUPP || error == ENOTTY || error == EXDEV ||
+        error == EINVAL || error == ENOSYS) {
+      if (!dedupeUnsupported_.exchange(true)) {
+        XLOG(INFO) << "the filesystem of the overlay in " << localDir_
+                   << " does not support deduplicating files, not using the "
+                   << "overlay content index: " << folly::exceptionStr(ex);
+      }
+    } else {
+      XLOG(WARN) << "unable to deduplicate the overlay file for inode "
+                 << inodeNumber << ": " << folly::exceptionStr(ex);
+    }
+  }
+}
+
+std::optional<folly::File> FsOverlay::cloneFromBlobCache(
+    InodeNumber inodeNumber,
+    const Hash& blobHash,
+    uint64_t fileSize) {
+  auto blobPath =
+      folly::to<std::string>(kBlobCacheDir, "/", blobHash.toString());
+  try {
+    int blobFd = openat(
+        dirFile_.fd(), blobPath.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (blobFd < 0) {
+      return std::nullopt;
+    }
+    File blobFile{blobFd, /* ownsFd */ true};
+    struct stat st;
+    if (fstat(blobFd, &st) != 0 ||
+        static_cast<uint64_t>(st.st_size) != fileSize) {
+      // Left over from a crash while it was being written.
+      return std::nullopt;
+    }
+    // Keep the blob from being evicted while it is still being used.
+    futimens(blobFd, nullptr);
+
+    auto path = getFilePath(inodeNumber);
+    return createFileAtomically(inodeNumber, path.c_str(), [&](int fd) {
+      folly::checkUnixError(
+          cloneFile(fd, blobFile.fd()),
+          "error cloning overlay file for inode ",
+          inodeNumber);
+    });
+  } catch (const std::system_error& ex) {
+    handleBlobCacheError(inodeNumber, ex);
+    return std::nullopt;
+  }
+}
+
+void FsOverlay::addToBlobCache(
+    InodeNumber inodeNumber,
+    const Hash& blobHash,
+    const folly::File& file,
+    uint64_t fileSize) {
+  if (!reserveCacheBytes(
+          kBlobCacheDir, blobCacheBytes_, fileSize, blobCacheSize_)) {
+    return;
+  }
+  // The overlay file starts with its header, so that other overlay files
+  // can be cloned from the cached copy in their entirety: cloning requires
+  // block aligned ranges, which the contents following the header are not.
+  auto blobPath =
+      folly::to<std::string>(kBlobCacheDir, "/", blobHash.toString());
+  try {
+    createFileAtomically(inodeNumber, blobPath.c_str(), [&](int fd) {
+      folly::checkUnixError(
+          cloneFile(fd, file.fd()),
+          "error adding blob ",
+          blobHash,
+          " to the overlay blob cache in ",
+          localDir_);
+    });
+  } catch (const std::system_error& ex) {
+    blobCacheBytes_.fetch_sub(fileSize);
+    handleBlobCacheError(inodeNumber, ex);
+  }
+}
+
+void FsOverlay::handleBlobCacheError(
+    InodeNumber inodeNumber,
+    const std::system_error& ex) {
+  auto error = ex.code().value();
+  if (error == EOPNOTSUPP || error == ENOTTY || error == EXDEV ||
+      error == EINVAL || error == ENOSYS) {
+    if (!cloneUnsupported_.exchange(true)) {
+      XLOG(INFO) << "the filesystem of the overlay in " << localDir_
+                 << " does not support cloning files, not using the "
+                 << "overlay blob cache: " << folly::exceptionStr(ex);
+    }
+  } else {
+    XLOG(WARN) << "unable to use the overlay blob cache for inode "
+               << inodeNumber << ": " << folly::exceptionStr(ex);
+  }
+}
+
 void FsOverlay::validateHeader(
     InodeNumber inodeNumber,
     folly::StringPiece contents,
@@ -8,14 +8,19 @@
 #pragma once
 
 #include <folly/File.h>
+#include <folly/Function.h>
 #include <folly/Range.h>
 #include <gtest/gtest_prod.h>
 #include <array>
+#include <atomic>
 #include <condition_variable>
+#include <mutex>
 #include <optional>
+#include <system_error>
 #include "eden/fs/inodes/IOverlay.h"
 #include "eden/fs/inodes/InodeNumber.h"
 #include "eden/fs/inodes/overlay/gen-cpp2/overlay_types.h"
+#include "eden/fs/model/Hash.h"
 #include "eden/fs/utils/DirType.h"
 #include "eden/fs/utils/PathFuncs.h"
 #ifdef __APPLE__
@@ -40,7 +45,18 @@ class InodePath;
  */
 class FsOverlay : public IOverlay {
  public:
-  explicit FsOverlay(AbsolutePathPiece localDir) : localDir_{localDir} {}
+  /**
+   * blobCacheSize and contentIndexSize bound the size of the blob cache and
+   * of the content index, which are disabled when 0. See the
+   * overlay:blob-cache-size and overlay:content-index-size settings.
+   */
+  explicit FsOverlay(
+      AbsolutePathPiece localDir,
+      uint64_t blobCacheSize = 0,
+      uint64_t contentIndexSize = 0)
+      : localDir_{localDir},
+        blobCacheSize_{blobCacheSize},
+        contentIndexSize_{contentIndexSize} {}
 
   bool supportsSemanticOperations() const override {
     return false;
@@ -132,6 +148,10 @@ class FsOverlay : public IOverlay {
    */
   std::optional<InodeNumber> tryLoadNextInodeNumber();
 
+  std::optional<InodeNumber> loadInodeNumberReservation() override;
+
+  void saveInodeNumberReservation(InodeNumber limit) override;
+
   /**
    * Validate an existing overlay's info file exists, is valid and contains the
    * correct version.
@@ -153,6 +173,30 @@ class FsOverlay : public IOverlay {
       InodeNumber inodeNumber,
       const folly::IOBuf& contents) override;
 
+  /**
+   * Creates an overlay file for a FileInode materialized from a blob.
+   *
+   * When the blob cache is enabled, the overlay files of blobs are cloned
+   * into the overlay's "blobs" directory, and the next overlay files for the
+   * same blobs are cloned from there, on Linux filesystems that support
+   * reflinks, such as btrfs and XFS. The clones share their extents until
+   * either is written to, so materializing a large file again doesn't copy
+   * its contents. Falls back to createOverlayFile() otherwise.
+   */
+  folly::File createOverlayFileFromBlob(
+      InodeNumber inodeNumber,
+      const Hash& blobHash,
+      const folly::IOBuf& contents) override;
+
+  /**
+   * When the content index is enabled, make
+   * the overlay file for inodeNumber share its blocks with the indexed file
+   * with the same SHA-1, indexing it first if there is none. This relies on
+   * FIDEDUPERANGE, which the kernel only honors for identical ranges, so a
+   * stale sha1 never corrupts the file.
+   */
+  void dedupeOverlayFile(InodeNumber inodeNumber, const Hash& sha1) override;
+
   /**
    * Remove the overlay data associated with the passed InodeNumber.
    */
@@ -235,6 +279,79 @@ class FsOverlay : public IOverlay {
   folly::File
   createOverlayFileImpl(InodeNumber inodeNumber, iovec* iov, size_t iovCount);
 
+  /**
+   * Creates the file at path, relative to localDir, by filling a temporary
+   * file named after inodeNumber and renaming it into place.
+   */
+  folly::File createFileAtomically(
+      InodeNumber inodeNumber,
+      const char* path,
+      folly::FunctionRef<void(int fd)> fill);
+
+  /**
+   * Prepares the blob cache and the content index if their sizes are
+   * non-zero. They are only supported on Linux.
+   */
+  void initBlobCache();
+
+  /**
+   * Creates the named cache directory in the overlay if needed, and sets
+   * cachedBytes to the size of the files it already holds. Returns false if
+   * the directory cannot be used.
+   */
+  bool initCacheDir(
+      folly::StringPiece name,
+      std::atomic<uint64_t>& cachedBytes);
+
+  /**
+   * Adds size bytes to cachedBytes if that keeps it within limit, evicting
+   * the least recently used files of the named cache directory first if
+   * needed. Returns false, leaving cachedBytes unchanged, if they don't fit.
+   */
+  bool reserveCacheBytes(
+      folly::StringPiece name,
+      std::atomic<uint64_t>& cachedBytes,
+      uint64_t size,
+      uint64_t limit);
+
+  /**
+   * Removes the files of the named cache directory with the oldest
+   * modification times until it holds at most half of limit. Files in use
+   * are refreshed by touching them.
+   */
+  void evictCacheDir(
+      folly::StringPiece name,
+      std::atomic<uint64_t>& cachedBytes,
+      uint64_t limit);
+
+  /**
+   * Clones the overlay file for inodeNumber, of fileSize bytes including its
+   * header, from the cached blob. Returns std::nullopt if the blob is not
+   * cached or the file cannot be cloned.
+   */
+  std::optional<folly::File> cloneFromBlobCache(
+      InodeNumber inodeNumber,
+      const Hash& blobHash,
+      uint64_t fileSize);
+
+  /**
+   * Clones file, the new overlay file for inodeNumber, into the blob cache,
+   * evicting older blobs if needed.
+   */
+  void addToBlobCache(
+      InodeNumber inodeNumber,
+      const Hash& blobHash,
+      const folly::File& file,
+      uint64_t fileSize);
+
+  /**
+   * Logs a blob cache error, disabling the cache if the filesystem doesn't
+   * support cloning.
+   */
+  void handleBlobCacheError(
+      InodeNumber inodeNumber,
+      const std::system_error& ex);
+
  private:
   /** Path to ".eden/CLIENT/local" */
   const AbsolutePath localDir_;
@@ -254,6 +371,43 @@ class FsOverlay : public IOverlay {
    * We maintain this so we can use openat(), unlinkat(), etc.
    */
   folly::File dirFile_;
+
+  const uint64_t blobCacheSize_;
+  const uint64_t contentIndexSize_;
+
+  /**
+   * Whether initBlobCache() succeeded, and the number of bytes held in the
+   * blob cache. Its least recently used blobs are evicted when it is full.
+   * That is always safe, since the overlay files cloned from them keep
+   * their shared blocks.
+   */
+  bool blobCacheEnabled_{false};
+  std::atomic<uint64_t> blobCacheBytes_{0};
+
+  /**
+   * Same as above for the content index, whose evicted files leave the
+   * overlay files deduplicated against them unchanged.
+   */
+  bool contentIndexEnabled_{false};
+  std::atomic<uint64_t> contentIndexBytes_{0};
+
+  /**
+   * Held while evicting files from a cache directory, so that a single
+   * thread scans it at a time.
+   */
+  std::mutex evictionMutex_;
+
+  /**
+   * Set once cloning failed because the filesystem of the overlay doesn't
+   * support it.
+   */
+  std::atomic<bool> cloneUnsupported_{false};
+
+  /**
+   * Set once deduplicating failed because the filesystem of the overlay
+   * doesn't support it.
+   */
+  std::atomic<bool> dedupeUnsupported_{false};
 };
 
 class InodePath {
@@ -0,0 +1,751 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/overlay/LogOverlay.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <array>
+#include <cstring>
+
+#include <folly/Conv.h>
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <folly/hash/Checksum.h>
+#include <folly/lang/Bits.h>
+#include <folly/logging/xlog.h>
+#include <thrift/lib/cpp2/protocol/Serializer.h>
+
+#include "eden/fs/inodes/overlay/OverlayChecker.h"
+
+namespace facebook {
+namespace eden {
+
+using apache::thrift::CompactSerializer;
+using overlay::OverlayDir;
+using overlay::OverlayLogOperation;
+using overlay::OverlayLogRecord;
+
+namespace {
+constexpr folly::StringPiece kSnapshotIdentifier{"OVSN"};
+constexpr folly::StringPiece kLogIdentifier{"OVLG"};
+constexpr uint32_t kFormatVersion = 1;
+
+// The identifier, the format version and the generation.
+constexpr size_t kFileHeaderLength = 16;
+// The length and the CRC-32C of the serialized record.
+constexpr size_t kRecordHeaderLength = 8;
+
+constexpr auto kCompactionRetryDelay = std::chrono::seconds{10};
+
+std::array<uint8_t, kFileHeaderLength> makeFileHeader(
+    folly::StringPiece identifier,
+    uint64_t generation) {
+  std::array<uint8_t, kFileHeaderLength> header;
+  memcpy(header.data(), identifier.data(), identifier.size());
+  auto version = folly::Endian::big(kFormatVersion);
+  memcpy(header.data() + 4, &version, sizeof(version));
+  auto generationBE = folly::Endian::big(generation);
+  memcpy(header.data() + 8, &generationBE, sizeof(generationBE));
+  return header;
+}
+
+/**
+ * Validate the header of a snapshot or log, and return its generation.
+ */
+uint64_t parseFileHeader(
+    const AbsolutePath& path,
+    folly::StringPiece identifier,
+    folly::ByteRange contents) {
+  if (contents.size() < kFileHeaderLength ||
+      folly::StringPiece{contents.subpiece(0, identifier.size())} !=
+          identifier) {
+    throw std::runtime_error(
+        folly::to<std::string>("invalid overlay log header in ", path));
+  }
+  uint32_t version;
+  memcpy(&version, contents.data() + 4, sizeof(version));
+  if (folly::Endian::big(version) != kFormatVersion) {
+    throw std::runtime_error(folly::to<std::string>(
+        "unsupported overlay log version ",
+        folly::Endian::big(version),
+        " in ",
+        path));
+  }
+  uint64_t generation;
+  memcpy(&generation, contents.data() + 8, sizeof(generation));
+  return folly::Endian::big(generation);
+}
+
+std::array<uint8_t, kRecordHeaderLength> makeRecordHeader(
+    folly::StringPiece payload) {
+  std::array<uint8_t, kRecordHeaderLength> header;
+  auto length = folly::Endian::big(static_cast<uint32_t>(payload.size()));
+  memcpy(header.data(), &length, sizeof(length));
+  auto checksum = folly::Endian::big(folly::crc32c(
+      reinterpret_cast<const uint8_t*>(payload.data()), payload.size()));
+  memcpy(header.data() + 4, &checksum, sizeof(checksum));
+  return header;
+}
+
+void appendRecord(std::string& out, const OverlayLogRecord& record) {
+  auto payload = CompactSerializer::serialize<std::string>(record);
+  auto header = makeRecordHeader(payload);
+  out.append(reinterpret_cast<const char*>(header.data()), header.size());
+  out.append(payload);
+}
+
+/**
+ * Call fn with each valid record of contents, which doesn't include the file
+ * header, and return the number of bytes they span. Parsing stops at the
+ * first truncated or corrupted record.
+ */
+template <typename Fn>
+size_t parseRecords(folly::ByteRange contents, Fn&& fn) {
+  size_t validBytes = 0;
+  while (contents.size() >= kRecordHeaderLength) {
+    uint32_t length;
+    memcpy(&length, contents.data(), sizeof(length));
+    length = folly::Endian::big(length);
+    uint32_t checksum;
+    memcpy(&checksum, contents.data() + 4, sizeof(checksum));
+    checksum = folly::Endian::big(checksum);
+    if (contents.size() - kRecordHeaderLength < length) {
+      break;
+    }
+
+    auto payload = contents.subpiece(kRecordHeaderLength, length);
+    if (folly::crc32c(payload.data(), payload.size()) != checksum) {
+      break;
+    }
+    OverlayLogRecord record;
+    try {
+      record = CompactSerializer::deserialize<OverlayLogRecord>(payload);
+    } catch (const std::exception&) {
+      break;
+    }
+    fn(std::move(record));
+
+    contents.advance(kRecordHeaderLength + length);
+    validBytes += kRecordHeaderLength + length;
+  }
+  return validBytes;
+}
+
+void updateNextInodeNumber(uint64_t& nextInodeNumber, uint64_t inodeNumber) {
+  nextInodeNumber = std::max(nextInodeNumber, inodeNumber + 1);
+}
+
+void syncFile(const folly::File& file, folly::StringPiece description) {
+  folly::checkUnixError(
+      folly::fdatasyncNoInt(file.fd()), "error syncing ", description);
+}
+} // namespace
+
+constexpr folly::StringPiece LogOverlay::kSnapshotFile;
+constexpr folly::StringPiece LogOverlay::kLogFilePrefix;
+
+LogOverlay::LogOverlay(
+    AbsolutePathPiece localDir,
+    uint64_t compactionThreshold,
+    size_t maxLoggedDirs)
+    : fs_{localDir},
+      compactionThreshold_{compactionThreshold},
+      maxLoggedDirs_{maxLoggedDirs} {}
+
+LogOverlay::~LogOverlay() {
+  stopCompactionThread();
+}
+
+AbsolutePath LogOverlay::logPath(
+    AbsolutePathPiece localDir,
+    uint64_t generation) {
+  return localDir +
+      PathComponent{folly::to<std::string>(kLogFilePrefix, generation)};
+}
+
+std::optional<InodeNumber> LogOverlay::initOverlay(bool createIfNonExisting) {
+  auto fsNextInodeNumber = fs_.initOverlay(createIfNonExisting);
+
+  auto state = state_.lock();
+  auto existed = replay(fs_, *state, /*repair=*/true);
+  openLog(*state, state->generation);
+  if (!existed && !fsNextInodeNumber.has_value()) {
+    // The overlay was used by an FsOverlay until now, and was not shut down
+    // cleanly. All its directories are still in the FsOverlay, so it can
+    // still be checked as usual.
+    XLOG(WARN) << "Overlay " << fs_.getLocalDir()
+               << " was not shut down cleanly.  Performing fsck scan.";
+    OverlayChecker checker(&fs_, std::nullopt);
+    checker.scanForErrors();
+    checker.repairErrors();
+    fsNextInodeNumber = checker.getNextInodeNumber();
+  }
+  if (fsNextInodeNumber.has_value()) {
+    // The directories which are still in the FsOverlay may reference inodes
+    // beyond the ones in the log.
+    OverlayLogRecord record;
+    record.operation_ref() = OverlayLogOperation::NEXT_INODE_NUMBER;
+    record.inodeNumber_ref() = fsNextInodeNumber->get();
+    commit(*state, std::move(record));
+  }
+  auto nextInodeNumber = InodeNumber{state->nextInodeNumber};
+  state.unlock();
+
+  compactionThread_ = std::thread{[this] { compactionThread(); }};
+  return nextInodeNumber;
+}
+
+void LogOverlay::close(std::optional<InodeNumber> nextInodeNumber) {
+  stopCompactionThread();
+  std::shared_ptr<folly::File> previousLog;
+  std::shared_ptr<folly::File> log;
+  {
+    auto state = state_.lock();
+    previousLog = std::move(state->previousLog);
+    log = std::move(state->log);
+  }
+  if (previousLog) {
+    syncFile(*previousLog, "overlay log");
+  }
+  if (log) {
+    syncFile(*log, "overlay log");
+  }
+  fs_.close(nextInodeNumber);
+}
+
+void LogOverlay::flush() {
+  std::shared_ptr<folly::File> previousLog;
+  std::shared_ptr<folly::File> log;
+  {
+    auto state = state_.lock();
+    previousLog = state->previousLog;
+    log = state->log;
+  }
+  // The appends carry on while the logs are synced. replay() discards the
+  // logs following a torn one, so the previous log must be synced too.
+  if (previousLog) {
+    syncFile(*previousLog, "overlay log");
+  }
+  syncFile(*log, "overlay log");
+}
+
+std::vector<std::pair<InodeNumber, OverlayDir>> LogOverlay::readLoggedDirs(
+    FsOverlay& fs) {
+  State state;
+  replay(fs, state, /*repair=*/false);
+
+  std::vector<std::pair<InodeNumber, OverlayDir>> dirs;
+  dirs.reserve(state.dirs.size());
+  for (auto& [inodeNumber, dir] : state.dirs) {
+    dirs.emplace_back(inodeNumber, std::move(*dir));
+  }
+  return dirs;
+}
+
+bool LogOverlay::replay(FsOverlay& fs, State& state, bool repair) {
+  bool existed = false;
+  std::string contents;
+  auto snapshotPath = fs.getLocalDir() + PathComponentPiece{kSnapshotFile};
+  if (folly::readFile(snapshotPath.c_str(), contents)) {
+    existed = true;
+    folly::ByteRange data{folly::StringPiece{contents}};
+    state.generation = parseFileHeader(snapshotPath, kSnapshotIdentifier, data);
+    data.advance(kFileHeaderLength);
+    auto validBytes = parseRecords(data, [&](OverlayLogRecord&& record) {
+      apply(fs, state, std::move(record));
+    });
+    // Unlike the log, the snapshot is synced before it replaces the previous
+    // one, so it is never torn.
+    if (validBytes != data.size()) {
+      throw std::runtime_error(
+          folly::to<std::string>("corrupted overlay snapshot ", snapshotPath));
+    }
+  } else if (errno != ENOENT) {
+    folly::throwSystemError("error reading overlay snapshot ", snapshotPath);
+  }
+
+  // A compaction that was interrupted after the snapshot was written may have
+  // left the logs it replaced behind.
+  if (repair && state.generation > 0) {
+    ::unlink(logPath(fs.getLocalDir(), state.generation - 1).c_str());
+  }
+
+  // A compaction that was interrupted before the snapshot was written leaves
+  // two logs to replay.
+  auto generation = state.generation;
+  bool torn = false;
+  while (!torn && replayLog(fs, state, generation, repair, torn)) {
+    existed = true;
+    state.generation = generation++;
+  }
+
+  // Only a crash of the whole system tears a log followed by another one,
+  // since the compaction switches logs between appends. The mutations of the
+  // following log may depend on the lost ones, so they are discarded too.
+  // They were never flushed, since flush() syncs the previous log first.
+  while (torn) {
+    auto path = logPath(fs.getLocalDir(), generation++);
+    if (::access(path.c_str(), F_OK) != 0) {
+      break;
+    }
+    XLOG(WARN) << "Discarding " << path << ", which follows a torn log";
+    if (repair) {
+      folly::checkUnixError(
+          ::unlink(path.c_str()), "error removing overlay log ", path);
+    }
+  }
+  return existed;
+}
+
+bool LogOverlay::replayLog(
+    FsOverlay& fs,
+    State& state,
+    uint64_t generation,
+    bool repair,
+    bool& torn) {
+  auto path = logPath(fs.getLocalDir(), generation);
+  std::string contents;
+  if (!folly::readFile(path.c_str(), contents)) {
+    if (errno == ENOENT) {
+      return false;
+    }
+    folly::throwSystemError("error reading overlay log ", path);
+  }
+  if (contents.size() < kFileHeaderLength) {
+    // The log was created but its header was never written.
+    if (repair) {
+      ::unlink(path.c_str());
+    }
+    return false;
+  }
+
+  folly::ByteRange data{folly::StringPiece{contents}};
+  parseFileHeader(path, kLogIdentifier, data);
+  data.advance(kFileHeaderLength);
+  auto validBytes = parseRecords(data, [&](OverlayLogRecord&& record) {
+    apply(fs, state, std::move(record));
+  });
+  if (validBytes != data.size()) {
+    torn = true;
+    if (repair) {
+      XLOG(WARN) << "Discarding " << data.size() - validBytes
+                 << " bytes of torn or corrupted records at the end of "
+                 << path;
+      folly::checkUnixError(
+          ::truncate(path.c_str(), kFileHeaderLength + validBytes),
+          "error truncating overlay log ",
+          path);
+    }
+  }
+  return true;
+}
+
+void LogOverlay::openLog(State& state, uint64_t generation) {
+  auto path = logPath(fs_.getLocalDir(), generation);
+  folly::File log{
+      path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600};
+  struct stat st;
+  folly::checkUnixError(
+      fstat(log.fd(), &st), "error getting the size of ", path);
+  if (st.st_size == 0) {
+    auto header = makeFileHeader(kLogIdentifier, generation);
+    folly::checkUnixError(
+        folly::writeFull(log.fd(), header.data(), header.size()),
+        "error writing overlay log header to ",
+        path);
+    st.st_size = header.size();
+  }
+  state.log = std::make_shared<folly::File>(std::move(log));
+  state.generation = generation;
+  state.logBytes = st.st_size - kFileHeaderLength;
+}
+
+void LogOverlay::commit(State& state, OverlayLogRecord&& record) {
+  auto payload = CompactSerializer::serialize<std::string>(record);
+  auto header = makeRecordHeader(payload);
+  std::array<iovec, 2> iov;
+  iov[0].iov_base = header.data();
+  iov[0].iov_len = header.size();
+  iov[1].iov_base = payload.data();
+  iov[1].iov_len = payload.size();
+  auto written = folly::writevFull(state.log->fd(), iov.data(), iov.size());
+  if (written != static_cast<ssize_t>(header.size() + payload.size())) {
+    int errnum = errno;
+    // Don't leave a partial record that would hide the following ones.
+    (void)::ftruncate(state.log->fd(), kFileHeaderLength + state.logBytes);
+    folly::throwSystemErrorExplicit(errnum, "error appending to overlay log");
+  }
+  state.logBytes += header.size() + payload.size();
+
+  apply(fs_, state, std::move(record));
+
+  if (needsCompaction(state)) {
+    compactionCondVar_.notify_one();
+  }
+}
+
+void LogOverlay::apply(
+    FsOverlay& fs,
+    State& state,
+    OverlayLogRecord&& record) {
+  auto inodeNumber = InodeNumber{*record.inodeNumber_ref()};
+  switch (*record.operation_ref()) {
+    case OverlayLogOperation::SAVE_DIR: {
+      auto dir = std::make_shared<OverlayDir>(std::move(*record.dir_ref()));
+      updateNextInodeNumber(state.nextInodeNumber, inodeNumber.get());
+      for (const auto& [name, entry] : *dir->entries_ref()) {
+        updateNextInodeNumber(state.nextInodeNumber, *entry.inodeNumber_ref());
+      }
+      state.dirs[inodeNumber] = std::move(dir);
+      break;
+    }
+    case OverlayLogOperation::REMOVE_DIR:
+      state.dirs.erase(inodeNumber);
+      break;
+    case OverlayLogOperation::ADD_CHILD: {
+      auto& entry = *record.entry_ref();
+      updateNextInodeNumber(state.nextInodeNumber, *entry.inodeNumber_ref());
+      (*getMutableDir(fs, state, inodeNumber)
+            .entries_ref())[*record.name_ref()] = std::move(entry);
+      break;
+    }
+    case OverlayLogOperation::REMOVE_CHILD: {
+      auto& entries = *getMutableDir(fs, state, inodeNumber).entries_ref();
+      entries.erase(*record.name_ref());
+      break;
+    }
+    case OverlayLogOperation::RENAME_CHILD: {
+      auto& srcEntries = *getMutableDir(fs, state, inodeNumber).entries_ref();
+      auto it = srcEntries.find(*record.name_ref());
+      if (it == srcEntries.end()) {
+        break;
+      }
+      auto entry = std::move(it->second);
+      srcEntries.erase(it);
+      auto dst = InodeNumber{*record.dstInodeNumber_ref()};
+      (*getMutableDir(fs, state, dst).entries_ref())[*record.dstName_ref()] =
+          std::move(entry);
+      break;
+    }
+    case OverlayLogOperation::NEXT_INODE_NUMBER:
+      state.nextInodeNumber =
+          std::max(state.nextInodeNumber, inodeNumber.get());
+      break;
+  }
+}
+
+OverlayDir& LogOverlay::getMutableDir(
+    FsOverlay& fs,
+    State& state,
+    InodeNumber inodeNumber) {
+  auto it = state.dirs.find(inodeNumber);
+  if (it == state.dirs.end()) {
+    auto dir = fs.loadOverlayDir(inodeNumber);
+    it = state.dirs
+             .emplace(
+                 inodeNumber,
+                 std::make_shared<OverlayDir>(
+                     dir ? std::move(*dir) : OverlayDir{}))
+             .first;
+  } else if (it->second.use_count() > 1) {
+    // The directory is being written to a snapshot.
+    it->second = std::make_shared<OverlayDir>(*it->second);
+  }
+  return *it->second;
+}
+
+std::optional<OverlayDir> LogOverlay::loadOverlayDir(InodeNumber inodeNumber) {
+  std::shared_ptr<OverlayDir> dir;
+  {
+    auto state = state_.lock();
+    auto it = state->dirs.find(inodeNumber);
+    if (it != state->dirs.end()) {
+      // Holding a reference makes writers copy the directory, so it can be
+      // copied without the lock.
+      dir = it->second;
+    }
+  }
+  if (dir) {
+    return *dir;
+  }
+  return fs_.loadOverlayDir(inodeNumber);
+}
+
+void LogOverlay::saveOverlayDir(
+    InodeNumber inodeNumber,
+    const OverlayDir& odir) {
+  OverlayLogRecord record;
+  record.operation_ref() = OverlayLogOperation::SAVE_DIR;
+  record.inodeNumber_ref() = inodeNumber.get();
+  record.dir_ref() = odir;
+  commit(*state_.lock(), std::move(record));
+}
+
+void LogOverlay::removeOverlayData(InodeNumber inodeNumber) {
+  {
+    auto state = state_.lock();
+    if (state->dirs.count(inodeNumber)) {
+      OverlayLogRecord record;
+      record.operation_ref() = OverlayLogOperation::REMOVE_DIR;
+      record.inodeNumber_ref() = inodeNumber.get();
+      commit(*state, std::move(record));
+    }
+  }
+  // Remove the file, or the directory if it predates the LogOverlay.
+  fs_.removeOverlayData(inodeNumber);
+}
+
+bool LogOverlay::hasOverlayData(InodeNumber inodeNumber) {
+  if (state_.lock()->dirs.count(inodeNumber)) {
+    return true;
+  }
+  return fs_.hasOverlayData(inodeNumber);
+}
+
+folly::File LogOverlay::createOverlayFile(
+    InodeNumber inodeNumber,
+    folly::ByteRange contents) {
+  return fs_.createOverlayFile(inodeNumber, contents);
+}
+
+folly::File LogOverlay::createOverlayFile(
+    InodeNumber inodeNumber,
+    const folly::IOBuf& contents) {
+  return fs_.createOverlayFile(inodeNumber, contents);
+}
+
+folly::File LogOverlay::createOverlayFileFromBlob(
+    InodeNumber inodeNumber,
+    const Hash& blobHash,
+    const folly::IOBuf& contents) {
+  return fs_.createOverlayFileFromBlob(inodeNumber, blobHash, contents);
+}
+
+folly::File LogOverlay::openFile(
+    InodeNumber inodeNumber,
+    folly::StringPiece headerId) {
+  return fs_.openFile(inodeNumber, headerId);
+}
+
+folly::File LogOverlay::openFileNoVerify(InodeNumber inodeNumber) {
+  return fs_.openFileNoVerify(inodeNumber);
+}
+
+struct statfs LogOverlay::statFs() const {
+  return fs_.statFs();
+}
+
+void LogOverlay::addChild(
+    InodeNumber parent,
+    PathComponentPiece name,
+    overlay::OverlayEntry entry) {
+  OverlayLogRecord record;
+  record.operation_ref() = OverlayLogOperation::ADD_CHILD;
+  record.inodeNumber_ref() = parent.get();
+  record.name_ref() = name.stringPiece().str();
+  record.entry_ref() = std::move(entry);
+
+  auto state = state_.lock();
+  // Load the directory first, so that a failure doesn't leave a record in
+  // the log.
+  getMutableDir(fs_, *state, parent);
+  commit(*state, std::move(record));
+}
+
+void LogOverlay::removeChild(InodeNumber parent, PathComponentPiece childName) {
+  OverlayLogRecord record;
+  record.operation_ref() = OverlayLogOperation::REMOVE_CHILD;
+  record.inodeNumber_ref() = parent.get();
+  record.name_ref() = childName.stringPiece().str();
+
+  auto state = state_.lock();
+  getMutableDir(fs_, *state, parent);
+  commit(*state, std::move(record));
+}
+
+void LogOverlay::renameChild(
+    InodeNumber src,
+    InodeNumber dst,
+    PathComponentPiece srcName,
+    PathComponentPiece dstName) {
+  OverlayLogRecord record;
+  record.operation_ref() = OverlayLogOperation::RENAME_CHILD;
+  record.inodeNumber_ref() = src.get();
+  record.dstInodeNumber_ref() = dst.get();
+  record.name_ref() = srcName.stringPiece().str();
+  record.dstName_ref() = dstName.stringPiece().str();
+
+  auto state = state_.lock();
+  getMutableDir(fs_, *state, src);
+  getMutableDir(fs_, *state, dst);
+  commit(*state, std::move(record));
+}
+
+void LogOverlay::compact() {
+  std::lock_guard<std::mutex> compactionLock{compactionMutex_};
+
+  std::vector<std::pair<InodeNumber, std::shared_ptr<OverlayDir>>> dirs;
+  std::shared_ptr<folly::File> previousLog;
+  uint64_t generation;
+  uint64_t nextInodeNumber;
+  {
+    auto state = state_.lock();
+    dirs.assign(state->dirs.begin(), state->dirs.end());
+    nextInodeNumber = state->nextInodeNumber;
+    generation = state->generation + 1;
+
+    // Switch to the next log, so that the mutations carry on while the
+    // previous one is synced and the snapshot is written.
+    previousLog = state->log;
+    state->previousLog = previousLog;
+    openLog(*state, generation);
+  }
+
+  // Until this sync completes, flush() syncs the previous log too, so that
+  // the next log is never durable without it.
+  syncFile(*previousLog, "overlay log");
+  state_.lock()->previousLog.reset();
+
+  // Past the bound, write directories back to the FsOverlay, down to half
+  // the bound so that this doesn't happen again on the next compaction. The
+  // directories are taken in no particular order: one that is modified again
+  // is simply read back from the FsOverlay.
+  std::vector<std::pair<InodeNumber, std::shared_ptr<OverlayDir>>> spilled;
+  if (dirs.size() > maxLoggedDirs_) {
+    auto count = dirs.size() - maxLoggedDirs_ / 2;
+    spilled.assign(
+        std::make_move_iterator(dirs.end() - count),
+        std::make_move_iterator(dirs.end()));
+    dirs.erase(dirs.end() - count, dirs.end());
+    spillDirs(spilled);
+  }
+
+  writeSnapshot(generation, nextInodeNumber, dirs);
+  dirs.clear();
+
+  if (!spilled.empty()) {
+    std::vector<InodeNumber> removed;
+    {
+      auto state = state_.lock();
+      for (const auto& [inodeNumber, dir] : spilled) {
+        auto it = state->dirs.find(inodeNumber);
+        if (it == state->dirs.end()) {
+          removed.push_back(inodeNumber);
+        } else if (it->second == dir) {
+          state->dirs.erase(it);
+        }
+        // Otherwise, the directory was modified in the next log, whose
+        // records apply to the written back copy on replay.
+      }
+    }
+    spilled.clear();
+    // The directories removed while they were written back may have been
+    // recreated in the FsOverlay.
+    for (auto inodeNumber : removed) {
+      fs_.removeOverlayData(inodeNumber);
+    }
+  }
+
+  auto previousLogPath = logPath(fs_.getLocalDir(), generation - 1);
+  if (::unlink(previousLogPath.c_str()) != 0 && errno != ENOENT) {
+    XLOG(WARN) << "error removing overlay log " << previousLogPath << ": "
+               << folly::errnoStr(errno);
+  }
+}
+
+void LogOverlay::spillDirs(
+    const std::vector<std::pair<InodeNumber, std::shared_ptr<OverlayDir>>>&
+        dirs) {
+  for (const auto& [inodeNumber, dir] : dirs) {
+    fs_.saveOverlayDir(inodeNumber, *dir);
+    syncFile(fs_.openFileNoVerify(inodeNumber), "overlay directory");
+  }
+  XLOG(DBG2) << "wrote " << dirs.size() << " overlay directories back to "
+             << fs_.getLocalDir();
+}
+
+void LogOverlay::writeSnapshot(
+    uint64_t generation,
+    uint64_t nextInodeNumber,
+    const std::vector<std::pair<InodeNumber, std::shared_ptr<OverlayDir>>>&
+        dirs) {
+  auto header = makeFileHeader(kSnapshotIdentifier, generation);
+  std::string contents{
+      reinterpret_cast<const char*>(header.data()), header.size()};
+
+  OverlayLogRecord nextInodeRecord;
+  nextInodeRecord.operation_ref() = OverlayLogOperation::NEXT_INODE_NUMBER;
+  nextInodeRecord.inodeNumber_ref() = nextInodeNumber;
+  appendRecord(contents, nextInodeRecord);
+
+  for (const auto& [inodeNumber, dir] : dirs) {
+    OverlayLogRecord record;
+    record.operation_ref() = OverlayLogOperation::SAVE_DIR;
+    record.inodeNumber_ref() = inodeNumber.get();
+    record.dir_ref() = *dir;
+    appendRecord(contents, record);
+  }
+
+  // The snapshot, and its rename over the previous one, must be durable
+  // before the log it replaces is removed.
+  auto snapshotPath = fs_.getLocalDir() + PathComponentPiece{kSnapshotFile};
+  folly::writeFileAtomic(
+      snapshotPath.stringPiece(), contents, 0600, folly::SyncType::WITH_SYNC);
+  folly::File dir{
+      fs_.getLocalDir().c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC};
+  folly::checkUnixError(
+      folly::fsyncNoInt(dir.fd()),
+      "error syncing overlay directory ",
+      fs_.getLocalDir());
+  XLOG(DBG2) << "wrote overlay snapshot " << generation << " with "
+             << dirs.size() << " directories to " << snapshotPath;
+}
+
+void LogOverlay::compactionThread() noexcept {
+  auto state = state_.lock();
+  while (!state->stopping) {
+    if (!needsCompaction(*state)) {
+      compactionCondVar_.wait(state.as_lock());
+      continue;
+    }
+
+    state.unlock();
+    bool failed = false;
+    try {
+      compact();
+    } catch (const std::exception& ex) {
+      XLOG(ERR) << "error compacting overlay log in " << fs_.getLocalDir()
+                << ": " << folly::exceptionStr(ex);
+      failed = true;
+    }
+    state = state_.lock();
+    if (failed || state->dirs.size() > maxLoggedDirs_) {
+      // Every append past the threshold notifies this thread, so don't retry
+      // right away. Directories created faster than they are written back
+      // don't warrant an immediate compaction either.
+      compactionCondVar_.wait_for(
+          state.as_lock(), kCompactionRetryDelay, [&] {
+            return state->stopping;
+          });
+    }
+  }
+}
+
+void LogOverlay::stopCompactionThread() {
+  if (!compactionThread_.joinable()) {
+    return;
+  }
+  state_.lock()->stopping = true;
+  compactionCondVar_.notify_one();
+  compactionThread_.join();
+}
+
+} // namespace eden
+} // namespace facebook
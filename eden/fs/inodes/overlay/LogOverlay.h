@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/File.h>
+#include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "eden/fs/inodes/IOverlay.h"
+#include "eden/fs/inodes/InodeNumber.h"
+#include "eden/fs/inodes/overlay/FsOverlay.h"
+#include "eden/fs/inodes/overlay/gen-cpp2/overlay_types.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * LogOverlay keeps the overlay directories in memory, and appends every
+ * directory mutation to a log of checksummed records before applying it.
+ *
+ * Mutations are therefore about as fast as with the in-memory tree overlay,
+ * but they survive a crash of EdenFS: on startup, the directories are
+ * rebuilt by replaying the log. A torn record at the end of the log, left by
+ * a crash in the middle of an append, is discarded. Appends are not synced,
+ * flush() makes them durable across a crash of the whole system. Syncs happen
+ * outside of the lock of the directories, so they don't block mutations.
+ *
+ * Once the log grows past the compaction threshold, a background thread
+ * writes all the directories to a snapshot and starts a new log, so the log
+ * replayed on startup stays short. The snapshot and the logs are numbered
+ * with a generation: the snapshot of generation N contains all the mutations
+ * of the logs before N.
+ *
+ * The number of directories kept in memory is bounded: past the bound, the
+ * compaction writes directories back to the FsOverlay, syncs them, and leaves
+ * them out of the snapshot and of memory until they are modified again.
+ *
+ * The contents of the files, and any directory written by an FsOverlay
+ * before the overlay was switched to a LogOverlay, are stored by an FsOverlay
+ * in the same directory. Switching back to an FsOverlay loses the
+ * directories that were only written to the log. The OverlayChecker reads
+ * them with readLoggedDirs().
+ */
+class LogOverlay : public IOverlay {
+ public:
+  static constexpr uint64_t kDefaultCompactionThreshold = 64 * 1024 * 1024;
+  static constexpr size_t kDefaultMaxLoggedDirs = 256 * 1024;
+
+  explicit LogOverlay(
+      AbsolutePathPiece localDir,
+      uint64_t compactionThreshold = kDefaultCompactionThreshold,
+      size_t maxLoggedDirs = kDefaultMaxLoggedDirs);
+
+  ~LogOverlay() override;
+
+  bool supportsSemanticOperations() const override {
+    return true;
+  }
+
+  /**
+   * Load the snapshot and replay the logs.
+   *
+   * The next inode number is always known, even after an unclean shutdown,
+   * since every directory referencing an inode is in the log.
+   */
+  std::optional<InodeNumber> initOverlay(bool createIfNonExisting) override;
+
+  void close(std::optional<InodeNumber> nextInodeNumber) override;
+
+  /**
+   * Sync the log to disk, along with the previous one if a compaction has not
+   * synced it yet.
+   */
+  void flush() override;
+
+  bool initialized() const override {
+    return fs_.initialized();
+  }
+
+  const AbsolutePath& getLocalDir() const override {
+    return fs_.getLocalDir();
+  }
+
+  std::optional<overlay::OverlayDir> loadOverlayDir(
+      InodeNumber inodeNumber) override;
+
+  void saveOverlayDir(InodeNumber inodeNumber, const overlay::OverlayDir& odir)
+      override;
+
+  void removeOverlayData(InodeNumber inodeNumber) override;
+
+  bool hasOverlayData(InodeNumber inodeNumber) override;
+
+  folly::File createOverlayFile(
+      InodeNumber inodeNumber,
+      folly::ByteRange contents) override;
+
+  folly::File createOverlayFile(
+      InodeNumber inodeNumber,
+      const folly::IOBuf& contents) override;
+
+  folly::File createOverlayFileFromBlob(
+      InodeNumber inodeNumber,
+      const Hash& blobHash,
+      const folly::IOBuf& contents) override;
+
+  folly::File openFile(InodeNumber inodeNumber, folly::StringPiece headerId)
+      override;
+
+  folly::File openFileNoVerify(InodeNumber inodeNumber) override;
+
+  void dedupeOverlayFile(InodeNumber inodeNumber, const Hash& sha1) override {
+    fs_.dedupeOverlayFile(inodeNumber, sha1);
+  }
+
+  struct statfs statFs() const override;
+
+  void addChild(
+      InodeNumber parent,
+      PathComponentPiece name,
+      overlay::OverlayEntry entry) override;
+
+  void removeChild(InodeNumber parent, PathComponentPiece childName) override;
+
+  void renameChild(
+      InodeNumber src,
+      InodeNumber dst,
+      PathComponentPiece srcName,
+      PathComponentPiece dstName) override;
+
+  /**
+   * Write all the directories to a new snapshot, and remove the logs it
+   * replaces. Past maxLoggedDirs directories, some are written back to the
+   * FsOverlay instead. This is normally done by the background thread once
+   * the log grows past the compaction threshold, or the directories past
+   * maxLoggedDirs.
+   */
+  void compact();
+
+  /**
+   * The size of the current log, in bytes.
+   */
+  uint64_t getLogSize() const {
+    return state_.lock()->logBytes;
+  }
+
+  /**
+   * The number of directories kept in memory.
+   */
+  size_t getLoggedDirCount() const {
+    return state_.lock()->dirs.size();
+  }
+
+  /**
+   * Replay the snapshot and the logs of the overlay of fs without modifying
+   * them, and return the directories they contain, which replace those of
+   * the FsOverlay.
+   */
+  static std::vector<std::pair<InodeNumber, overlay::OverlayDir>>
+  readLoggedDirs(FsOverlay& fs);
+
+  static constexpr folly::StringPiece kSnapshotFile{"dir-snapshot"};
+  static constexpr folly::StringPiece kLogFilePrefix{"dir-log."};
+
+ private:
+  struct State {
+    /**
+     * The directories written since the overlay was switched to a
+     * LogOverlay. The compaction shares the directories with this map
+     * while it writes the snapshot; they are copied before being modified
+     * if they are shared.
+     */
+    std::unordered_map<InodeNumber, std::shared_ptr<overlay::OverlayDir>> dirs;
+
+    /**
+     * One more than the largest inode number seen so far.
+     */
+    uint64_t nextInodeNumber{kRootNodeId.get() + 1};
+
+    std::shared_ptr<folly::File> log;
+    /**
+     * The log before the last compaction, until the compaction has synced
+     * it.
+     */
+    std::shared_ptr<folly::File> previousLog;
+    uint64_t generation{0};
+    uint64_t logBytes{0};
+
+    bool stopping{false};
+  };
+
+  static AbsolutePath logPath(AbsolutePathPiece localDir, uint64_t generation);
+
+  /**
+   * Load the snapshot and replay the logs following it. Returns false if
+   * neither a snapshot nor a log existed. With repair set, the logs are
+   * cleaned up as described in replayLog.
+   */
+  static bool replay(FsOverlay& fs, State& state, bool repair);
+
+  /**
+   * Replay the log of the given generation. Returns false if it doesn't
+   * exist. Sets torn if it ends with a torn record, which is truncated with
+   * repair set.
+   */
+  static bool replayLog(
+      FsOverlay& fs,
+      State& state,
+      uint64_t generation,
+      bool repair,
+      bool& torn);
+
+  /**
+   * Open the log of the given generation for appending, creating it if
+   * needed.
+   */
+  void openLog(State& state, uint64_t generation);
+
+  /**
+   * Append the record to the log and apply it to the directories.
+   */
+  void commit(State& state, overlay::OverlayLogRecord&& record);
+
+  static void
+  apply(FsOverlay& fs, State& state, overlay::OverlayLogRecord&& record);
+
+  /**
+   * Get the directory for modification, loading it from the FsOverlay if it
+   * is not in the log yet.
+   */
+  static overlay::OverlayDir&
+  getMutableDir(FsOverlay& fs, State& state, InodeNumber inodeNumber);
+
+  bool needsCompaction(const State& state) const {
+    return state.logBytes >= compactionThreshold_ ||
+        state.dirs.size() > maxLoggedDirs_;
+  }
+
+  /**
+   * Write the directories back to the FsOverlay and sync them, so that they
+   * can be left out of the snapshot.
+   */
+  void spillDirs(
+      const std::vector<
+          std::pair<InodeNumber, std::shared_ptr<overlay::OverlayDir>>>& dirs);
+
+  void writeSnapshot(
+      uint64_t generation,
+      uint64_t nextInodeNumber,
+      const std::vector<
+          std::pair<InodeNumber, std::shared_ptr<overlay::OverlayDir>>>& dirs);
+
+  void compactionThread() noexcept;
+  void stopCompactionThread();
+
+  FsOverlay fs_;
+  const uint64_t compactionThreshold_;
+  const size_t maxLoggedDirs_;
+
+  folly::Synchronized<State, std::mutex> state_;
+  std::condition_variable compactionCondVar_;
+
+  /**
+   * Serializes compactions, which write the snapshot without holding the
+   * state_ lock.
+   */
+  std::mutex compactionMutex_;
+  std::thread compactionThread_;
+};
+
+} // namespace eden
+} // namespace facebook
@@ -13,16 +13,22 @@
 #include <fcntl.h>
 #include <time.h>
 #include <unistd.h>
+#include <atomic>
+#include <thread>
 
 #include <folly/Conv.h>
 #include <folly/ExceptionWrapper.h>
 #include <folly/File.h>
 #include <folly/FileUtil.h>
+#include <folly/ScopeGuard.h>
 #include <folly/String.h>
+#include <folly/Try.h>
 #include <folly/logging/xlog.h>
+#include <folly/synchronization/Baton.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
 #include "eden/fs/inodes/overlay/FsOverlay.h"
+#include "eden/fs/inodes/overlay/LogOverlay.h"
 #include "eden/fs/utils/EnumValue.h"
 
 using apache::thrift::CompactSerializer;
@@ -654,8 +660,11 @@ class OverlayChecker::BadNextInodeNumber : public OverlayChecker::Error {
 
 OverlayChecker::OverlayChecker(
     FsOverlay* fs,
-    optional<InodeNumber> nextInodeNumber)
-    : fs_(fs), loadedNextInodeNumber_(nextInodeNumber) {}
+    optional<InodeNumber> nextInodeNumber,
+    size_t numThreads)
+    : fs_(fs),
+      loadedNextInodeNumber_(nextInodeNumber),
+      numThreads_(std::max<size_t>(numThreads, 1)) {}
 
 OverlayChecker::~OverlayChecker() {}
 
@@ -665,6 +674,7 @@ void OverlayChecker::scanForErrors(const ProgressCallback& progressCallback) {
     callback(0);
   }
   readInodes(progressCallback);
+  readLoggedDirs();
   linkInodeChildren();
   scanForParentErrors();
   checkNextInodeNumber();
@@ -857,11 +867,40 @@ PathComponent OverlayChecker::findChildName(
 }
 
 void OverlayChecker::readInodes(const ProgressCallback& progressCallback) {
-  // Walk through all of the sharded subdirectories
+  // Walk through all of the sharded subdirectories. With several threads, the
+  // shards are handed out to the threads in order, and merged in order on
+  // this thread as soon as each of them is scanned, so that the results do
+  // not depend on the scheduling of the threads. An error scanning a shard is
+  // rethrown by this thread when it reaches the shard.
+  std::vector<folly::Try<ShardScan>> scans(FsOverlay::kNumShards);
+  std::vector<folly::Baton<>> scanned(FsOverlay::kNumShards);
+  std::atomic<ShardID> nextShard{0};
+  std::vector<std::thread> threads;
+  SCOPE_EXIT {
+    // Once an error is rethrown, the remaining shards are not scanned.
+    nextShard.store(FsOverlay::kNumShards, std::memory_order_relaxed);
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  };
+  if (numThreads_ > 1) {
+    for (size_t i = 0; i < numThreads_; ++i) {
+      threads.emplace_back([&] {
+        while (true) {
+          auto shardID = nextShard.fetch_add(1, std::memory_order_relaxed);
+          if (shardID >= FsOverlay::kNumShards) {
+            return;
+          }
+          scans[shardID] =
+              folly::makeTryWith([&] { return readInodeSubdir(shardID); });
+          scanned[shardID].post();
+        }
+      });
+    }
+  }
+
   uint32_t progress10pct = 0;
-  std::array<char, 2> subdirBuffer;
-  MutableStringPiece subdir{subdirBuffer.data(), subdirBuffer.size()};
-  for (uint32_t shardID = 0; shardID < FsOverlay::kNumShards; ++shardID) {
+  for (ShardID shardID = 0; shardID < FsOverlay::kNumShards; ++shardID) {
     // Log a INFO message every 10% done
     uint32_t progress = (10 * shardID) / FsOverlay::kNumShards;
     if (progress > progress10pct) {
@@ -872,10 +911,13 @@ void OverlayChecker::readInodes(const ProgressCallback& progressCallback) {
       }
       progress10pct = progress;
     }
-    FsOverlay::formatSubdirShardPath(shardID, subdir);
-    auto subdirPath = fs_->getLocalDir() + PathComponentPiece{subdir};
 
-    readInodeSubdir(subdirPath, shardID);
+    if (threads.empty()) {
+      mergeShardScan(readInodeSubdir(shardID));
+    } else {
+      scanned[shardID].wait();
+      mergeShardScan(std::move(scans[shardID]).value());
+    }
   }
   if (auto callback = progressCallback) {
     callback(10);
@@ -884,17 +926,20 @@ void OverlayChecker::readInodes(const ProgressCallback& progressCallback) {
              << " inodes";
 }
 
-void OverlayChecker::readInodeSubdir(
-    const AbsolutePath& path,
-    ShardID shardID) {
+OverlayChecker::ShardScan OverlayChecker::readInodeSubdir(ShardID shardID) {
+  std::array<char, 2> subdirBuffer;
+  MutableStringPiece subdir{subdirBuffer.data(), subdirBuffer.size()};
+  FsOverlay::formatSubdirShardPath(shardID, subdir);
+  auto path = fs_->getLocalDir() + PathComponentPiece{subdir};
   XLOG(DBG5) << "fsck:" << fs_->getLocalDir() << ": scanning " << path;
 
+  ShardScan scan;
   boost::system::error_code error;
   auto boostPath = boost::filesystem::path{path.value().c_str()};
   auto iterator = boost::filesystem::directory_iterator(boostPath, error);
   if (error.value() != 0) {
-    addError<ShardDirectoryEnumerationError>(path, error);
-    return;
+    scan.addError<ShardDirectoryEnumerationError>(path, error);
+    return scan;
   }
 
   auto endIterator = boost::filesystem::directory_iterator();
@@ -904,37 +949,55 @@ void OverlayChecker::readInodeSubdir(
     auto entryInodeNumber =
         folly::tryTo<uint64_t>(inodePath.basename().value());
     if (entryInodeNumber.hasValue()) {
-      loadInode(InodeNumber(*entryInodeNumber), shardID);
+      loadInode(InodeNumber(*entryInodeNumber), shardID, scan);
     } else {
-      addError<UnexpectedOverlayFile>(inodePath);
+      scan.addError<UnexpectedOverlayFile>(inodePath);
     }
 
     iterator.increment(error);
     if (error.value() != 0) {
-      addError<ShardDirectoryEnumerationError>(path, error);
+      scan.addError<ShardDirectoryEnumerationError>(path, error);
       break;
     }
   }
+  return scan;
 }
 
-void OverlayChecker::loadInode(InodeNumber number, ShardID shardID) {
+void OverlayChecker::loadInode(
+    InodeNumber number,
+    ShardID shardID,
+    ShardScan& scan) {
   XLOG(DBG9) << "fsck: loading inode " << number;
-  updateMaxInodeNumber(number);
+  scan.updateMaxInodeNumber(number);
 
   // Verify that we found this inode in the correct shard subdirectory.
   // Ignore the data if it is in the wrong directory.
   ShardID expectedShard = static_cast<ShardID>(number.get() & 0xff);
   if (expectedShard != shardID) {
-    addError<UnexpectedInodeShard>(number, shardID);
+    scan.addError<UnexpectedInodeShard>(number, shardID);
     return;
   }
 
-  inodes_.emplace(number, loadInodeInfo(number));
+  scan.inodes.emplace_back(number, loadInodeInfo(number, scan));
+}
+
+void OverlayChecker::mergeShardScan(ShardScan&& scan) {
+  if (scan.maxInodeNumber > maxInodeNumber_) {
+    maxInodeNumber_ = scan.maxInodeNumber;
+  }
+  for (auto& [number, info] : scan.inodes) {
+    inodes_.emplace(number, std::move(info));
+  }
+  for (auto& error : scan.errors) {
+    addError(std::move(error));
+  }
 }
 
-OverlayChecker::InodeInfo OverlayChecker::loadInodeInfo(InodeNumber number) {
-  auto inodeError = [this, number](auto&&... args) {
-    addError<InodeDataError>(number, args...);
+OverlayChecker::InodeInfo OverlayChecker::loadInodeInfo(
+    InodeNumber number,
+    ShardScan& scan) {
+  auto inodeError = [&scan, number](auto&&... args) {
+    scan.addError<InodeDataError>(number, args...);
     return InodeInfo(number, InodeType::Error);
   };
 
@@ -1012,6 +1075,21 @@ overlay::OverlayDir OverlayChecker::loadDirectoryChildren(folly::File& file) {
   return CompactSerializer::deserialize<overlay::OverlayDir>(serializedData);
 }
 
+void OverlayChecker::readLoggedDirs() {
+  // The directories written by a LogOverlay are in its snapshot and logs. They
+  // replace the inode files, which hold the directories from before the
+  // overlay was switched to a LogOverlay, if any.
+  auto dirs = LogOverlay::readLoggedDirs(*fs_);
+  for (auto& [number, dir] : dirs) {
+    updateMaxInodeNumber(number);
+    inodes_.insert_or_assign(number, InodeInfo(number, std::move(dir)));
+  }
+  if (!dirs.empty()) {
+    XLOG(INFO) << "fsck:" << fs_->getLocalDir() << ": read " << dirs.size()
+               << " directories from the overlay log";
+  }
+}
+
 void OverlayChecker::linkInodeChildren() {
   for (const auto& [parentInodeNumber, parent] : inodes_) {
     for (const auto& [childName, child] : *parent.children.entries_ref()) {
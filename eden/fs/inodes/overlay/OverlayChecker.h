@@ -7,8 +7,11 @@
 
 #pragma once
 
+#include <algorithm>
 #include <memory>
 #include <optional>
+#include <utility>
+#include <vector>
 
 #include <folly/CppAttributes.h>
 #include <folly/small_vector.h>
@@ -56,8 +59,15 @@ class OverlayChecker {
    * The OverlayChecker stores a raw pointer to the FsOverlay for the duration
    * of the check operation.  The caller is responsible for ensuring that the
    * FsOverlay object exists for at least as long as the OverlayChecker object.
+   *
+   * The inode shard directories are read by numThreads threads concurrently.
+   * The errors are reported in the same order regardless of the number of
+   * threads.
    */
-  OverlayChecker(FsOverlay* fs, std::optional<InodeNumber> nextInodeNumber);
+  OverlayChecker(
+      FsOverlay* fs,
+      std::optional<InodeNumber> nextInodeNumber,
+      size_t numThreads = 1);
 
   ~OverlayChecker();
 
@@ -187,11 +197,35 @@ class OverlayChecker {
   PathInfo cachedPathComputation(InodeNumber number, Fn&& fn);
 
   using ShardID = uint32_t;
+
+  /**
+   * The inodes and errors found in one shard subdirectory.
+   *
+   * Shards are scanned independently of each other, possibly on different
+   * threads, and then merged into the OverlayChecker in shard order.
+   */
+  struct ShardScan {
+    template <typename ErrorType, typename... Args>
+    void addError(Args&&... args) {
+      errors.push_back(
+          std::make_unique<ErrorType>(std::forward<Args>(args)...));
+    }
+    void updateMaxInodeNumber(InodeNumber number) {
+      maxInodeNumber = std::max(maxInodeNumber, number.get());
+    }
+
+    std::vector<std::pair<InodeNumber, InodeInfo>> inodes;
+    std::vector<std::unique_ptr<Error>> errors;
+    uint64_t maxInodeNumber{0};
+  };
+
   void readInodes(const ProgressCallback& progressCallback = [](auto) {});
-  void readInodeSubdir(const AbsolutePath& path, ShardID shardID);
-  void loadInode(InodeNumber number, ShardID shardID);
-  InodeInfo loadInodeInfo(InodeNumber number);
+  ShardScan readInodeSubdir(ShardID shardID);
+  void loadInode(InodeNumber number, ShardID shardID, ShardScan& scan);
+  InodeInfo loadInodeInfo(InodeNumber number, ShardScan& scan);
+  void mergeShardScan(ShardScan&& scan);
   overlay::OverlayDir loadDirectoryChildren(folly::File& file);
+  void readLoggedDirs();
 
   void linkInodeChildren();
   void scanForParentErrors();
@@ -211,6 +245,7 @@ class OverlayChecker {
 
   FsOverlay* const fs_;
   std::optional<InodeNumber> loadedNextInodeNumber_;
+  const size_t numThreads_;
   std::unordered_map<InodeNumber, InodeInfo> inodes_;
   std::vector<std::unique_ptr<Error>> errors_;
   uint64_t maxInodeNumber_{kRootNodeId.get()};
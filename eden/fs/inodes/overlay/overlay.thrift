@@ -40,3 +40,30 @@ struct OverlayDir {
   // The contents of this dir.
   1: map<PathComponent, OverlayEntry> entries;
 }
+
+// The mutations recorded in the log of a LogOverlay.
+enum OverlayLogOperation {
+  // Replace the directory inodeNumber with dir.
+  SAVE_DIR = 0,
+  // Remove the directory inodeNumber.
+  REMOVE_DIR = 1,
+  // Add or replace the child name of the directory inodeNumber with entry.
+  ADD_CHILD = 2,
+  // Remove the child name of the directory inodeNumber.
+  REMOVE_CHILD = 3,
+  // Move the child name of the directory inodeNumber to the child dstName of
+  // the directory dstInodeNumber, replacing it if it exists.
+  RENAME_CHILD = 4,
+  // No inode number below inodeNumber may be allocated.
+  NEXT_INODE_NUMBER = 5,
+}
+
+struct OverlayLogRecord {
+  1: OverlayLogOperation operation;
+  2: i64 inodeNumber;
+  3: i64 dstInodeNumber;
+  4: PathComponent name;
+  5: PathComponent dstName;
+  6: optional OverlayDir dir;
+  7: optional OverlayEntry entry;
+}
@@ -435,6 +435,31 @@ TEST(Fsck, testBadFileData) {
   overlay->fs().close(checker.getNextInodeNumber());
 }
 
+TEST(Fsck, testMultithreadedScanReportsSameErrors) {
+  auto overlay = make_shared<TestOverlay>();
+  auto root = overlay->init();
+  SimpleOverlayLayout layout(root);
+
+  std::string badHeader(FsOverlay::kHeaderLength, 0x55);
+  overlay->corruptInodeHeader(layout.src_foo_testTxt.number(), badHeader);
+  auto srcDataFile = overlay->fs().openFileNoVerify(layout.src.number());
+  folly::checkUnixError(ftruncate(srcDataFile.fd(), 0), "truncate failed");
+
+  OverlayChecker serialChecker(&overlay->fs(), std::nullopt);
+  serialChecker.scanForErrors();
+  OverlayChecker parallelChecker(&overlay->fs(), std::nullopt, 8);
+  parallelChecker.scanForErrors();
+
+  // The errors are reported in the same order, so that repairs are also
+  // performed in the same order.
+  EXPECT_EQ(4, serialChecker.getErrors().size());
+  EXPECT_EQ(errorMessages(serialChecker), errorMessages(parallelChecker));
+  EXPECT_EQ(
+      serialChecker.getNextInodeNumber(), parallelChecker.getNextInodeNumber());
+
+  overlay->fs().close(parallelChecker.getNextInodeNumber());
+}
+
 TEST(Fsck, testTruncatedDirData) {
   auto overlay = make_shared<TestOverlay>();
   auto root = overlay->init();
@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/overlay/LogOverlay.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
+
+#include <folly/Exception.h>
+#include <folly/File.h>
+#include <folly/FileUtil.h>
+#include <folly/experimental/TestUtil.h>
+#include <folly/portability/GTest.h>
+
+#include "eden/fs/inodes/overlay/FsOverlay.h"
+#include "eden/fs/inodes/overlay/OverlayChecker.h"
+#include "eden/fs/testharness/TempFile.h"
+
+using namespace facebook::eden;
+using namespace folly::string_piece_literals;
+
+namespace {
+
+overlay::OverlayEntry makeEntry(mode_t mode, uint64_t inodeNumber) {
+  overlay::OverlayEntry entry;
+  entry.mode_ref() = mode;
+  entry.inodeNumber_ref() = inodeNumber;
+  return entry;
+}
+
+overlay::OverlayDir makeDir(
+    std::initializer_list<std::pair<const char*, uint64_t>> children) {
+  overlay::OverlayDir dir;
+  for (const auto& [name, inodeNumber] : children) {
+    (*dir.entries_ref())[name] = makeEntry(S_IFREG | 0644, inodeNumber);
+  }
+  return dir;
+}
+
+std::vector<std::string> childNames(
+    const std::optional<overlay::OverlayDir>& dir) {
+  std::vector<std::string> names;
+  if (dir) {
+    for (const auto& entry : *dir->entries_ref()) {
+      names.push_back(entry.first);
+    }
+  }
+  return names;
+}
+
+using Names = std::vector<std::string>;
+
+class LogOverlayTest : public ::testing::Test {
+ protected:
+  AbsolutePath path() const {
+    return AbsolutePath{testDir_.path().string()};
+  }
+
+  std::unique_ptr<LogOverlay> open(
+      uint64_t compactionThreshold = LogOverlay::kDefaultCompactionThreshold) {
+    auto overlay = std::make_unique<LogOverlay>(path(), compactionThreshold);
+    nextInodeNumber_ = overlay->initOverlay(/*createIfNonExisting=*/true);
+    return overlay;
+  }
+
+  folly::test::TemporaryDirectory testDir_{makeTempDir()};
+  std::optional<InodeNumber> nextInodeNumber_;
+};
+
+} // namespace
+
+TEST_F(LogOverlayTest, directoriesAreReplayedAfterUncleanShutdown) {
+  {
+    auto overlay = open();
+    overlay->saveOverlayDir(kRootNodeId, makeDir({{"a", 2}, {"b", 3}}));
+    overlay->saveOverlayDir(InodeNumber{4}, makeDir({{"c", 10}}));
+    overlay->addChild(kRootNodeId, "d"_pc, makeEntry(S_IFDIR | 0755, 4));
+    overlay->removeChild(kRootNodeId, "a"_pc);
+    overlay->renameChild(kRootNodeId, InodeNumber{4}, "b"_pc, "e"_pc);
+    overlay->saveOverlayDir(InodeNumber{5}, makeDir({}));
+    overlay->removeOverlayData(InodeNumber{5});
+    // Don't close the overlay, as if EdenFS crashed.
+  }
+
+  auto overlay = open();
+  EXPECT_EQ(Names{"d"}, childNames(overlay->loadOverlayDir(kRootNodeId)));
+  EXPECT_EQ(
+      (Names{"c", "e"}), childNames(overlay->loadOverlayDir(InodeNumber{4})));
+  EXPECT_FALSE(overlay->hasOverlayData(InodeNumber{5}));
+  EXPECT_FALSE(overlay->loadOverlayDir(InodeNumber{5}).has_value());
+  EXPECT_EQ(InodeNumber{11}, nextInodeNumber_);
+  overlay->close(nextInodeNumber_);
+}
+
+TEST_F(LogOverlayTest, tornRecordAtTheEndOfTheLogIsDiscarded) {
+  {
+    auto overlay = open();
+    overlay->saveOverlayDir(kRootNodeId, makeDir({{"a", 2}}));
+    overlay->addChild(kRootNodeId, "b"_pc, makeEntry(S_IFREG | 0644, 3));
+  }
+
+  // Cut the last record in the middle.
+  auto logPath = path() + PathComponentPiece{"dir-log.0"};
+  struct stat st;
+  folly::checkUnixError(::stat(logPath.c_str(), &st));
+  folly::checkUnixError(::truncate(logPath.c_str(), st.st_size - 3));
+
+  {
+    auto overlay = open();
+    EXPECT_EQ(Names{"a"}, childNames(overlay->loadOverlayDir(kRootNodeId)));
+    // The records appended after the truncation are replayed.
+    overlay->addChild(kRootNodeId, "c"_pc, makeEntry(S_IFREG | 0644, 4));
+  }
+
+  auto overlay = open();
+  EXPECT_EQ(
+      (Names{"a", "c"}), childNames(overlay->loadOverlayDir(kRootNodeId)));
+  overlay->close(nextInodeNumber_);
+}
+
+TEST_F(LogOverlayTest, logsFollowingATornLogAreDiscarded) {
+  {
+    auto overlay = open();
+    overlay->saveOverlayDir(kRootNodeId, makeDir({{"a", 2}}));
+    overlay->addChild(kRootNodeId, "b"_pc, makeEntry(S_IFREG | 0644, 3));
+  }
+
+  // As if the system crashed during a compaction, keeping the next log but
+  // losing the end of the previous one.
+  auto logPath = path() + "dir-log.0"_pc;
+  std::string contents;
+  ASSERT_TRUE(folly::readFile(logPath.c_str(), contents));
+  ASSERT_TRUE(folly::writeFile(contents, (path() + "dir-log.1"_pc).c_str()));
+  folly::checkUnixError(::truncate(logPath.c_str(), contents.size() - 3));
+
+  auto overlay = open();
+  EXPECT_EQ(Names{"a"}, childNames(overlay->loadOverlayDir(kRootNodeId)));
+  EXPECT_EQ(-1, ::access((path() + "dir-log.1"_pc).c_str(), F_OK));
+  overlay->close(nextInodeNumber_);
+}
+
+TEST_F(LogOverlayTest, compactionReplacesTheLogWithASnapshot) {
+  {
+    auto overlay = open();
+    overlay->saveOverlayDir(kRootNodeId, makeDir({{"a", 2}}));
+    overlay->compact();
+    EXPECT_EQ(0, overlay->getLogSize());
+    overlay->addChild(kRootNodeId, "b"_pc, makeEntry(S_IFREG | 0644, 3));
+    EXPECT_LT(0, overlay->getLogSize());
+  }
+
+  EXPECT_EQ(-1, ::access((path() + "dir-log.0"_pc).c_str(), F_OK));
+  EXPECT_EQ(0, ::access((path() + "dir-log.1"_pc).c_str(), F_OK));
+  EXPECT_EQ(0, ::access((path() + "dir-snapshot"_pc).c_str(), F_OK));
+
+  auto overlay = open();
+  EXPECT_EQ(
+      (Names{"a", "b"}), childNames(overlay->loadOverlayDir(kRootNodeId)));
+  overlay->close(nextInodeNumber_);
+}
+
+TEST_F(LogOverlayTest, compactsInTheBackgroundPastTheThreshold) {
+  auto overlay = open(/*compactionThreshold=*/1);
+  overlay->saveOverlayDir(kRootNodeId, makeDir({{"a", 2}}));
+
+  auto snapshotPath = path() + "dir-snapshot"_pc;
+  for (int i = 0; i < 1000 && ::access(snapshotPath.c_str(), F_OK) != 0;
+       ++i) {
+    /* sleep override */
+    std::this_thread::sleep_for(std::chrono::milliseconds{10});
+  }
+  EXPECT_EQ(0, ::access(snapshotPath.c_str(), F_OK));
+  overlay->close(nextInodeNumber_);
+}
+
+TEST_F(LogOverlayTest, compactionWritesDirectoriesBackPastTheBound) {
+  {
+    LogOverlay overlay{
+        path(), LogOverlay::kDefaultCompactionThreshold, /*maxLoggedDirs=*/4};
+    overlay.initOverlay(/*createIfNonExisting=*/true);
+    for (uint64_t i = 10; i < 20; ++i) {
+      overlay.saveOverlayDir(InodeNumber{i}, makeDir({{"a", i + 100}}));
+    }
+    overlay.compact();
+    EXPECT_GE(2u, overlay.getLoggedDirCount());
+    for (uint64_t i = 10; i < 20; ++i) {
+      EXPECT_EQ(Names{"a"}, childNames(overlay.loadOverlayDir(InodeNumber{i})));
+    }
+    overlay.addChild(InodeNumber{10}, "b"_pc, makeEntry(S_IFREG | 0644, 200));
+  }
+
+  auto overlay = open();
+  EXPECT_EQ(
+      (Names{"a", "b"}), childNames(overlay->loadOverlayDir(InodeNumber{10})));
+  for (uint64_t i = 11; i < 20; ++i) {
+    EXPECT_EQ(Names{"a"}, childNames(overlay->loadOverlayDir(InodeNumber{i})));
+  }
+  overlay->close(nextInodeNumber_);
+}
+
+TEST_F(LogOverlayTest, checkerReadsTheLoggedDirectories) {
+  {
+    auto overlay = open();
+    overlay->saveOverlayDir(kRootNodeId, makeDir({{"a", 2}}));
+    overlay->createOverlayFile(InodeNumber{2}, folly::ByteRange{});
+    overlay->close(InodeNumber{3});
+  }
+
+  // The file is only referenced by the logged root directory, and must not
+  // be reported as an orphan.
+  FsOverlay fs{path()};
+  auto nextInodeNumber = fs.initOverlay(/*createIfNonExisting=*/false);
+  OverlayChecker checker{&fs, nextInodeNumber};
+  checker.scanForErrors();
+  EXPECT_TRUE(checker.getErrors().empty());
+  EXPECT_EQ(InodeNumber{3}, checker.getNextInodeNumber());
+  fs.close(nextInodeNumber);
+}
+
+TEST_F(LogOverlayTest, directoriesOfAnFsOverlayAreStillReadable) {
+  {
+    FsOverlay fs{path()};
+    fs.initOverlay(/*createIfNonExisting=*/true);
+    fs.saveOverlayDir(kRootNodeId, makeDir({{"a", 2}}));
+    fs.saveOverlayDir(InodeNumber{3}, makeDir({{"b", 9}}));
+    fs.close(InodeNumber{20});
+  }
+
+  {
+    auto overlay = open();
+    EXPECT_EQ(InodeNumber{20}, nextInodeNumber_);
+    EXPECT_EQ(Names{"b"}, childNames(overlay->loadOverlayDir(InodeNumber{3})));
+    overlay->addChild(kRootNodeId, "c"_pc, makeEntry(S_IFREG | 0644, 4));
+    overlay->removeOverlayData(InodeNumber{3});
+  }
+
+  auto overlay = open();
+  EXPECT_EQ(
+      (Names{"a", "c"}), childNames(overlay->loadOverlayDir(kRootNodeId)));
+  EXPECT_FALSE(overlay->hasOverlayData(InodeNumber{3}));
+  // The inode numbers referenced by the FsOverlay directories are not reused
+  // after an unclean shutdown.
+  EXPECT_EQ(InodeNumber{20}, nextInodeNumber_);
+  overlay->close(nextInodeNumber_);
+}
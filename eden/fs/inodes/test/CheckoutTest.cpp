@@ -14,6 +14,7 @@
 #include <folly/test/TestUtils.h>
 
 #include "eden/fs/config/CheckoutConfig.h"
+#include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/inodes/EdenMount.h"
 #include "eden/fs/inodes/FileInode.h"
 #include "eden/fs/inodes/InodeMap.h"
@@ -767,6 +768,42 @@ TEST(Checkout, createUntrackedFileAndCheckoutAsTrackedFile) {
           makeConflict(ConflictType::UNTRACKED_ADDED, "src/test.c")));
 }
 
+TEST(Checkout, modifyToMatchDestinationKeepsFile) {
+  auto builder1 = FakeTreeBuilder();
+  builder1.setFile("src/main.c", "// Some code.\n");
+  builder1.setFile("src/test.c", "// Old test.\n");
+  TestMount testMount{RootId{"1"}, builder1};
+
+  auto builder2 = builder1.clone();
+  builder2.replaceFile("src/test.c", "// New test.\n");
+  builder2.setFile("src/new.c", "// New code.\n");
+  builder2.finalize(testMount.getBackingStore(), true);
+  auto commit2 = testMount.getBackingStore()->putCommit("2", builder2);
+  commit2->setReady();
+
+  // As after rebasing a local change onto a commit that includes it.
+  testMount.overwriteFile("src/test.c", "// New test.\n");
+  testMount.addFile("src/new.c", "// New code.\n");
+  auto preInode = testMount.getFileInode("src/test.c");
+
+  auto executor = testMount.getServerExecutor().get();
+  auto checkoutTo2 = testMount.getEdenMount()
+                         ->checkout(RootId("2"), std::nullopt, __func__)
+                         .waitVia(executor);
+  ASSERT_TRUE(checkoutTo2.isReady());
+  EXPECT_THAT(std::move(checkoutTo2).get().conflicts, UnorderedElementsAre());
+
+  auto postInode = testMount.getFileInode("src/test.c");
+  EXPECT_FILE_INODE(postInode, "// New test.\n", 0644);
+  EXPECT_FILE_INODE(
+      testMount.getFileInode("src/new.c"), "// New code.\n", 0644);
+#ifndef _WIN32
+  // The file was kept, and is served from the object store again.
+  EXPECT_EQ(preInode->getNodeId(), postInode->getNodeId());
+  EXPECT_TRUE(postInode->getBlobHash().has_value());
+#endif
+}
+
 /*
  * This is similar to createUntrackedFileAndCheckoutAsTrackedFile, except it
  * exercises the case where the code must traverse into an untracked directory
@@ -1649,6 +1686,85 @@ TEST(Checkout, checkoutFailsOnInProgressCheckout) {
   EXPECT_NO_THROW(std::move(checkout2).get());
 }
 
+TEST(Checkout, checkoutPrefetchesChangedTreesWhileUpdatingInodes) {
+  auto builder1 = FakeTreeBuilder();
+  builder1.setFile("a/b/c/file.txt", "contents\n");
+  builder1.setFile("x/y/other.txt", "other\n");
+  TestMount testMount{RootId("1"), builder1};
+  testMount.getEdenConfig()->checkoutPrefetchTreeBatchSize.setValue(
+      2, ConfigSource::CommandLine);
+  testMount.getServerState()->getFaultInjector().injectBlock(
+      "inodeCheckout", ".*");
+
+  auto builder2 = builder1.clone();
+  builder2.replaceFile("a/b/c/file.txt", "new contents\n");
+  builder2.finalize(testMount.getBackingStore(), true);
+  testMount.getBackingStore()->putCommit("2", builder2)->setReady();
+
+  auto executor = testMount.getServerExecutor().get();
+  auto checkout =
+      testMount.getEdenMount()->checkout(RootId{"2"}, std::nullopt, __func__);
+  executor->drain();
+  EXPECT_FALSE(checkout.isReady());
+
+  // The changed trees were all fetched while the inode walk was blocked.
+  auto backingStore = testMount.getBackingStore();
+  for (auto path : {"a", "a/b", "a/b/c"}) {
+    auto hash =
+        builder2.getStoredTree(RelativePathPiece{path})->get().getHash();
+    EXPECT_EQ(1, backingStore->getAccessCount(hash)) << path;
+  }
+  auto unchangedHash =
+      builder2.getStoredTree(RelativePathPiece{"x/y"})->get().getHash();
+  EXPECT_EQ(0, backingStore->getAccessCount(unchangedHash));
+
+  testMount.getServerState()->getFaultInjector().unblock("inodeCheckout", ".*");
+  auto result = std::move(checkout).getVia(executor);
+  EXPECT_THAT(result.conflicts, UnorderedElementsAre());
+  EXPECT_FILE_INODE(
+      testMount.getFileInode("a/b/c/file.txt"), "new contents\n", 0644);
+}
+
+TEST(Checkout, checkoutPrefetchStopsAtMaxDepth) {
+  auto builder1 = FakeTreeBuilder();
+  builder1.setFile("a/b/c/file.txt", "contents\n");
+  TestMount testMount{RootId("1"), builder1};
+  testMount.getEdenConfig()->checkoutPrefetchTreeBatchSize.setValue(
+      2, ConfigSource::CommandLine);
+  testMount.getEdenConfig()->checkoutPrefetchTreeMaxDepth.setValue(
+      2, ConfigSource::CommandLine);
+  testMount.getServerState()->getFaultInjector().injectBlock(
+      "inodeCheckout", ".*");
+
+  auto builder2 = builder1.clone();
+  builder2.replaceFile("a/b/c/file.txt", "new contents\n");
+  builder2.finalize(testMount.getBackingStore(), true);
+  testMount.getBackingStore()->putCommit("2", builder2)->setReady();
+
+  auto executor = testMount.getServerExecutor().get();
+  auto checkout =
+      testMount.getEdenMount()->checkout(RootId{"2"}, std::nullopt, __func__);
+  executor->drain();
+  EXPECT_FALSE(checkout.isReady());
+
+  // Only the two top levels were prefetched, a/b/c is left to the walk.
+  auto backingStore = testMount.getBackingStore();
+  for (auto path : {"a", "a/b"}) {
+    auto hash =
+        builder2.getStoredTree(RelativePathPiece{path})->get().getHash();
+    EXPECT_EQ(1, backingStore->getAccessCount(hash)) << path;
+  }
+  auto deepHash =
+      builder2.getStoredTree(RelativePathPiece{"a/b/c"})->get().getHash();
+  EXPECT_EQ(0, backingStore->getAccessCount(deepHash));
+
+  testMount.getServerState()->getFaultInjector().unblock("inodeCheckout", ".*");
+  auto result = std::move(checkout).getVia(executor);
+  EXPECT_THAT(result.conflicts, UnorderedElementsAre());
+  EXPECT_FILE_INODE(
+      testMount.getFileInode("a/b/c/file.txt"), "new contents\n", 0644);
+}
+
 // TODO:
 // - remove subdirectory
 //   - with no untracked/ignored files, it should get removed entirely
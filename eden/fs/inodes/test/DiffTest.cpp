@@ -10,8 +10,10 @@
 #include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
 #include <folly/test/TestUtils.h>
+#include <gflags/gflags.h>
 
 #include "eden/fs/config/CheckoutConfig.h"
+#include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/inodes/FileInode.h"
 #include "eden/fs/inodes/TreeInode.h"
 #include "eden/fs/model/git/TopLevelIgnores.h"
@@ -30,6 +32,8 @@ using std::string;
 using ::testing::UnorderedElementsAre;
 using ::testing::UnorderedElementsAreArray;
 
+DECLARE_bool(dematerializeRevertedFiles);
+
 template <typename T>
 T getFutureResult(folly::Future<T>& future, const char* filename, int line) {
   if (!future.isReady()) {
@@ -171,6 +175,120 @@ TEST(DiffTest, noChanges) {
   test.checkNoChanges();
 }
 
+#ifndef _WIN32
+TEST(DiffTest, revertedFileIsDematerialized) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_dematerializeRevertedFiles = true;
+
+  DiffTest test;
+  test.getMount().overwriteFile("src/1.txt", "This file has been updated.\n");
+  test.getMount().overwriteFile("src/1.txt", "This is src/1.txt.\n");
+  auto file = test.getMount().getFileInode("src/1.txt");
+  EXPECT_FALSE(file->getBlobHash().has_value());
+
+  test.checkNoChanges();
+  EXPECT_TRUE(file->getBlobHash().has_value());
+  EXPECT_EQ("This is src/1.txt.\n", test.getMount().readFile("src/1.txt"));
+
+  // Writing to the file materializes it again.
+  test.getMount().overwriteFile("src/1.txt", "This file has been updated.\n");
+  auto result = test.diff();
+  EXPECT_THAT(
+      *result.entries_ref(),
+      UnorderedElementsAre(
+          std::make_pair("src/1.txt", ScmFileStatus::MODIFIED)));
+}
+#endif // !_WIN32
+
+TEST(DiffTest, cachedStatusFollowsJournal) {
+  DiffTest test;
+  test.getMount().getEdenConfig()->scmStatusCacheMaxAge.setValue(
+      std::chrono::hours(1), ConfigSource::CommandLine);
+
+  auto noChanges = test.diffFuture();
+  EXPECT_THAT(
+      *EXPECT_FUTURE_RESULT(noChanges).entries_ref(), UnorderedElementsAre());
+  auto stillNoChanges = test.diffFuture();
+  EXPECT_THAT(
+      *EXPECT_FUTURE_RESULT(stillNoChanges).entries_ref(),
+      UnorderedElementsAre());
+
+  // Modifying a file is recorded in the journal, so the cached status must
+  // not be returned anymore.
+  test.getMount().overwriteFile("src/1.txt", "This file has been updated.\n");
+  auto modified = test.diffFuture();
+  EXPECT_THAT(
+      *EXPECT_FUTURE_RESULT(modified).entries_ref(),
+      UnorderedElementsAre(
+          std::make_pair("src/1.txt", ScmFileStatus::MODIFIED)));
+}
+
+TEST(DiffTest, cachedStatusAppliesJournalChanges) {
+  DiffTest test;
+  test.getMount().getEdenConfig()->scmStatusCacheMaxAge.setValue(
+      std::chrono::hours(1), ConfigSource::CommandLine);
+
+  test.getMount().overwriteFile("src/1.txt", "This file has been updated.\n");
+  auto modified = test.diffFuture();
+  EXPECT_THAT(
+      *EXPECT_FUTURE_RESULT(modified).entries_ref(),
+      UnorderedElementsAre(
+          std::make_pair("src/1.txt", ScmFileStatus::MODIFIED)));
+
+  // Each of these moves the journal by one file: only that file is diffed
+  // again, and the entries of the other paths come from the cached status.
+  test.getMount().addFile("src/a/new.txt", "new\n");
+  auto added = test.diffFuture();
+  EXPECT_THAT(
+      *EXPECT_FUTURE_RESULT(added).entries_ref(),
+      UnorderedElementsAre(
+          std::make_pair("src/1.txt", ScmFileStatus::MODIFIED),
+          std::make_pair("src/a/new.txt", ScmFileStatus::ADDED)));
+
+  test.getMount().deleteFile("src/a/b/3.txt");
+  auto removed = test.diffFuture();
+  EXPECT_THAT(
+      *EXPECT_FUTURE_RESULT(removed).entries_ref(),
+      UnorderedElementsAre(
+          std::make_pair("src/1.txt", ScmFileStatus::MODIFIED),
+          std::make_pair("src/a/new.txt", ScmFileStatus::ADDED),
+          std::make_pair("src/a/b/3.txt", ScmFileStatus::REMOVED)));
+
+  test.getMount().overwriteFile("src/1.txt", "This is src/1.txt.\n");
+  auto reverted = test.diffFuture();
+  EXPECT_THAT(
+      *EXPECT_FUTURE_RESULT(reverted).entries_ref(),
+      UnorderedElementsAre(
+          std::make_pair("src/a/new.txt", ScmFileStatus::ADDED),
+          std::make_pair("src/a/b/3.txt", ScmFileStatus::REMOVED)));
+}
+
+TEST(DiffTest, cachedStatusIsRecomputedAfterJournalTruncation) {
+  DiffTest test;
+  test.getMount().getEdenConfig()->scmStatusCacheMaxAge.setValue(
+      std::chrono::hours(1), ConfigSource::CommandLine);
+
+  test.getMount().overwriteFile("src/1.txt", "This file has been updated.\n");
+  auto modified = test.diffFuture();
+  EXPECT_THAT(
+      *EXPECT_FUTURE_RESULT(modified).entries_ref(),
+      UnorderedElementsAre(
+          std::make_pair("src/1.txt", ScmFileStatus::MODIFIED)));
+
+  // Only the latest change is kept, so the journal no longer covers the
+  // changes since the cached status and a full diff is needed.
+  test.getMount().getEdenMount()->getJournal().setMemoryLimit(0);
+  test.getMount().overwriteFile("src/2.txt", "This file has been updated.\n");
+  test.getMount().addFile("src/new.txt", "new\n");
+  auto truncated = test.diffFuture();
+  EXPECT_THAT(
+      *EXPECT_FUTURE_RESULT(truncated).entries_ref(),
+      UnorderedElementsAre(
+          std::make_pair("src/1.txt", ScmFileStatus::MODIFIED),
+          std::make_pair("src/2.txt", ScmFileStatus::MODIFIED),
+          std::make_pair("src/new.txt", ScmFileStatus::ADDED)));
+}
+
 TEST(DiffTest, fileModified) {
   DiffTest test;
   test.getMount().overwriteFile("src/1.txt", "This file has been updated.\n");
@@ -13,6 +13,7 @@
 #include <folly/Range.h>
 #include <folly/portability/GTest.h>
 #include <folly/test/TestUtils.h>
+#include <gflags/gflags.h>
 #include <chrono>
 
 #include "eden/fs/inodes/TreeInode.h"
@@ -28,6 +29,11 @@ using folly::StringPiece;
 using folly::literals::string_piece_literals::operator""_sp;
 using namespace std::chrono_literals;
 
+namespace facebook::eden {
+DECLARE_uint64(overlayFileCacheSize);
+DECLARE_uint64(overlayIoThreads);
+} // namespace facebook::eden
+
 std::ostream& operator<<(std::ostream& os, const timespec& ts) {
   os << folly::sformat("{}.{:09d}", ts.tv_sec, ts.tv_nsec);
   return os;
@@ -406,8 +412,124 @@ TEST_F(FileInodeTest, fallocate) {
   BASIC_ATTR_XCHECKS(inode, attr);
   EXPECT_EQ(42, attr.st_size);
 }
+
+TEST_F(FileInodeTest, copyFileRangeFromBlobSharesBlob) {
+  mount_.addFile("dir/copy", "");
+  auto source = mount_.getFileInode("dir/a.txt");
+  auto dest = mount_.getFileInode("dir/copy");
+  auto& context = ObjectFetchContext::getNullContext();
+
+  auto copied = source->copyFileRange(0, dest, 0, 1 << 20, context).get(0ms);
+  EXPECT_EQ(15, copied);
+  EXPECT_EQ(source->getBlobHash(), dest->getBlobHash());
+  EXPECT_EQ("This is a.txt.\n", dest->readAll(context).get(0ms));
+  EXPECT_EQ(15, getFileAttr(dest).st_size);
+
+  // Copying past the end of the source copies nothing.
+  EXPECT_EQ(0, source->copyFileRange(15, dest, 15, 100, context).get(0ms));
+  EXPECT_TRUE(dest->getBlobHash().has_value());
+}
+
+TEST_F(FileInodeTest, copyFileRangeSharesBlobsLargerThanAChunk) {
+  // Larger than the chunk a data-moving copy is capped at.
+  std::string contents(3 << 20, 'x');
+  FakeTreeBuilder builder;
+  builder.setFiles({{"large", contents}, {"copy", ""}});
+  TestMount mount{builder};
+  auto source = mount.getFileInode("large");
+  auto dest = mount.getFileInode("copy");
+  auto& context = ObjectFetchContext::getNullContext();
+
+  auto copied = source->copyFileRange(0, dest, 0, 4 << 20, context).get(0ms);
+  EXPECT_EQ(contents.size(), copied);
+  EXPECT_EQ(source->getBlobHash(), dest->getBlobHash());
+  EXPECT_EQ(contents.size(), getFileAttr(dest).st_size);
+}
+
+TEST_F(FileInodeTest, copyFileRangeIntoLargerFileCopiesData) {
+  mount_.addFile("dir/copy", "0123456789abcdefghij");
+  auto source = mount_.getFileInode("dir/a.txt");
+  auto dest = mount_.getFileInode("dir/copy");
+  auto& context = ObjectFetchContext::getNullContext();
+
+  auto copied = source->copyFileRange(8, dest, 2, 6, context).get(0ms);
+  EXPECT_EQ(6, copied);
+  EXPECT_FALSE(dest->getBlobHash().has_value());
+  EXPECT_EQ("01a.txt.89abcdefghij", dest->readAll(context).get(0ms));
+}
+
+TEST_F(FileInodeTest, copyFileRangeBetweenMaterializedFiles) {
+  mount_.addFile("dir/source", "materialized data");
+  mount_.addFile("dir/copy", "");
+  auto source = mount_.getFileInode("dir/source");
+  auto dest = mount_.getFileInode("dir/copy");
+  auto& context = ObjectFetchContext::getNullContext();
+
+  auto copied = source->copyFileRange(0, dest, 0, 1 << 20, context).get(0ms);
+  EXPECT_EQ(17, copied);
+  EXPECT_EQ("materialized data", dest->readAll(context).get(0ms));
+  EXPECT_EQ(17, getFileAttr(dest).st_size);
+}
+
+TEST_F(FileInodeTest, seekDataOrHole) {
+  auto& context = ObjectFetchContext::getNullContext();
+  for (auto path : {"dir/a.txt"_sp, "dir/materialized"_sp}) {
+    SCOPED_TRACE(path);
+    if (path == "dir/materialized") {
+      mount_.addFile(path, "This is a.txt.\n");
+    }
+    auto inode = mount_.getFileInode(path);
+    EXPECT_EQ(4, inode->seekDataOrHole(4, SEEK_DATA, context).get());
+    EXPECT_EQ(15, inode->seekDataOrHole(4, SEEK_HOLE, context).get());
+    EXPECT_THROW_ERRNO(
+        inode->seekDataOrHole(15, SEEK_DATA, context).get(), ENXIO);
+  }
+}
+
+TEST(FileInode, sha1IsCorrectAfterOverlayFileIsEvicted) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_overlayFileCacheSize = 1;
+
+  FakeTreeBuilder builder;
+  builder.setFiles({{"a.txt", "a\n"}, {"b.txt", "b\n"}});
+  TestMount mount{builder};
+  auto& context = ObjectFetchContext::getNullContext();
+  mount.overwriteFile("a.txt", "new a\n");
+  mount.overwriteFile("b.txt", "new b\n");
+  auto a = mount.getFileInode("a.txt");
+  auto b = mount.getFileInode("b.txt");
+
+  EXPECT_EQ(Hash::sha1("new a\n"), a->getSha1(context).get(0ms));
+  // Only one overlay file stays open, so this evicts the one of a.txt.
+  EXPECT_EQ(Hash::sha1("new b\n"), b->getSha1(context).get(0ms));
+  EXPECT_EQ(Hash::sha1("new a\n"), a->getSha1(context).get(0ms));
+
+  // A write after the overlay file was reopened invalidates the SHA-1 that
+  // was saved at eviction.
+  a->write("b", 4, context).get(0ms);
+  EXPECT_EQ(Hash::sha1("new b\n"), b->getSha1(context).get(0ms));
+  EXPECT_EQ(Hash::sha1("new b\n"), a->getSha1(context).get(0ms));
+}
 #endif
 
+TEST(FileInode, readAndFsyncOnOverlayIoThreads) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_overlayIoThreads = 2;
+
+  FakeTreeBuilder builder;
+  builder.setFiles({{"a.txt", "a\n"}});
+  TestMount mount{builder};
+  auto& context = ObjectFetchContext::getNullContext();
+  mount.overwriteFile("a.txt", "new a\n");
+  auto inode = mount.getFileInode("a.txt");
+
+  auto buf = inode->read(4096, 0, context).get(1s);
+  EXPECT_EQ("new a\n", buf->moveToFbString());
+  buf = inode->read(4096, 4, context).get(1s);
+  EXPECT_EQ("a\n", buf->moveToFbString());
+  inode->fsync(/*datasync=*/true).get(1s);
+}
+
 TEST(FileInode, truncatingDuringLoad) {
   FakeTreeBuilder builder;
   builder.setFiles({{"notready.txt", "Contents not ready.\n"}});
@@ -623,6 +745,15 @@ TEST(FileInode, reloadsBlobIfCacheIsEvicted) {
       << "reading should insert hash " << hash << " into cache";
 }
 
+TEST(FileInode, loadedInodesStayWithinTheirSizeBudget) {
+  // Build hosts keep tens of millions of inodes loaded, so growing these
+  // should be a deliberate decision.  The budgets are for 64-bit Linux.
+#if defined(__linux__) && defined(__x86_64__) && defined(__GLIBCXX__)
+  EXPECT_LE(sizeof(FileInode), 232);
+  EXPECT_LE(sizeof(TreeInode), 168);
+#endif
+}
+
 // TODO: test multiple flags together
 // TODO: ensure ctime is updated after every call to setattr()
 // TODO: ensure mtime is updated after opening a file, writing to it, then
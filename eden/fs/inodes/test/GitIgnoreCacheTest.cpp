@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/GitIgnoreCache.h"
+
+#include <folly/portability/GTest.h>
+#include "eden/fs/model/git/GitIgnore.h"
+#include "eden/fs/telemetry/EdenStats.h"
+
+using namespace facebook::eden;
+
+namespace {
+
+const Hash kHash1{"0000000000000000000000000000000000000001"};
+const Hash kHash2{"0000000000000000000000000000000000000002"};
+
+std::shared_ptr<const GitIgnore> makeIgnore(folly::StringPiece contents) {
+  auto ignore = std::make_shared<GitIgnore>();
+  ignore->loadFile(contents);
+  return ignore;
+}
+
+class GitIgnoreCacheTest : public ::testing::Test {
+ protected:
+  Journal journal{std::make_shared<EdenStats>()};
+  GitIgnoreCache cache{100};
+};
+
+} // namespace
+
+TEST_F(GitIgnoreCacheTest, sourceControlFilesAreKeyedByContentHash) {
+  cache.processJournal(journal);
+  auto ignore = makeIgnore("*.o\n");
+  auto lookup = cache.get(2_ino, kHash1);
+  EXPECT_FALSE(lookup.ignore);
+  cache.insert(2_ino, kHash1, ignore, lookup.generation);
+
+  EXPECT_EQ(ignore, cache.get(2_ino, kHash1).ignore);
+  EXPECT_FALSE(cache.get(2_ino, kHash2).ignore);
+  EXPECT_FALSE(cache.get(2_ino, std::nullopt).ignore);
+  EXPECT_FALSE(cache.get(3_ino, kHash1).ignore);
+
+  // Source control files don't depend on the journal.
+  journal.recordChanged("a/.gitignore"_relpath);
+  cache.processJournal(journal);
+  EXPECT_EQ(ignore, cache.get(2_ino, kHash1).ignore);
+}
+
+TEST_F(GitIgnoreCacheTest, materializedFilesAreDroppedOnIgnoreFileChanges) {
+  cache.processJournal(journal);
+  auto ignore = makeIgnore("*.o\n");
+  auto lookup = cache.get(2_ino, std::nullopt);
+  cache.insert(2_ino, std::nullopt, ignore, lookup.generation);
+  EXPECT_EQ(ignore, cache.get(2_ino, std::nullopt).ignore);
+
+  journal.recordChanged("a/main.c"_relpath);
+  cache.processJournal(journal);
+  EXPECT_EQ(ignore, cache.get(2_ino, std::nullopt).ignore);
+
+  journal.recordChanged("a/.gitignore"_relpath);
+  cache.processJournal(journal);
+  EXPECT_FALSE(cache.get(2_ino, std::nullopt).ignore);
+}
+
+TEST_F(GitIgnoreCacheTest, materializedFileReadBeforeAChangeIsNotCached) {
+  cache.processJournal(journal);
+  auto lookup = cache.get(2_ino, std::nullopt);
+
+  // Another diff sees the file change before the first one inserts the
+  // rules it parsed.
+  journal.recordChanged(".gitignore"_relpath);
+  cache.processJournal(journal);
+  cache.insert(2_ino, std::nullopt, makeIgnore("*.o\n"), lookup.generation);
+  EXPECT_FALSE(cache.get(2_ino, std::nullopt).ignore);
+}
+
+TEST(GitIgnoreCache, emptyCacheIsDisabled) {
+  GitIgnoreCache cache{0};
+  cache.insert(2_ino, kHash1, makeIgnore("*.o\n"), 0);
+  EXPECT_FALSE(cache.get(2_ino, kHash1).ignore);
+}
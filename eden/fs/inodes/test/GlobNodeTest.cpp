@@ -7,11 +7,13 @@
 
 #include "eden/fs/inodes/GlobNode.h"
 
+#include <algorithm>
 #include <utility>
 
 #include <folly/Conv.h>
 #include <folly/Exception.h>
 #include <folly/Range.h>
+#include <folly/Synchronized.h>
 #include <folly/experimental/TestUtil.h>
 #include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
@@ -291,6 +293,23 @@ TEST_P(GlobNodeTest, matchLiteralDirectoryAndDirectoryRecursiveChildren) {
   EXPECT_EQ(expect, matches);
 }
 
+TEST_P(GlobNodeTest, matchManyPatternsInSameDirectory) {
+  GlobNode globRoot(/*includeDotfiles=*/false);
+  globRoot.parse("dir/*.cpp");
+  globRoot.parse("dir/s*");
+  globRoot.parse("dir/*.txt");
+  globRoot.parse("dir/b*.txt");
+  globRoot.parse("dir/[a].txt");
+
+  auto matches = doGlob(globRoot, kZeroRootId);
+  std::vector<GlobResult> expect{
+      GlobResult("dir/a.txt"_relpath, dtype_t::Regular, kZeroRootId),
+      GlobResult("dir/a.txt"_relpath, dtype_t::Regular, kZeroRootId),
+      GlobResult("dir/sub"_relpath, dtype_t::Dir, kZeroRootId),
+  };
+  EXPECT_EQ(expect, matches);
+}
+
 const std::pair<enum StartReady, enum Prefetch> combinations[] = {
     {StartReady::Start, Prefetch::NoPrefetch},
     {StartReady::Start, Prefetch::PrefetchBlobs},
@@ -416,3 +435,41 @@ TEST_P(GlobNodeTest, testCommitHashSet) {
     EXPECT_EQ(expectHashes, getPrefetchHashes());
   }
 }
+
+TEST_P(GlobNodeTest, resultSinkReceivesMatchesOfEachDirectory) {
+  GlobNode globRoot(/*includeDotfiles=*/true);
+  globRoot.parse("**/*.txt");
+
+  folly::Synchronized<std::vector<std::vector<GlobResult>>> batches;
+  GlobNode::ResultSink resultSink =
+      [&batches](std::vector<GlobResult>&& results) {
+        batches.wlock()->push_back(std::move(results));
+      };
+
+  auto future = globRoot.evaluate(
+      mount_.getEdenMount()->getObjectStore(),
+      ObjectFetchContext::getNullContext(),
+      RelativePathPiece(),
+      mount_.getTreeInode(RelativePathPiece()),
+      nullptr,
+      kZeroRootId,
+      &resultSink);
+  if (!GetParam().first) {
+    builder_.setAllReady();
+  }
+  EXPECT_TRUE(std::move(future).get(kSmallTimeout).empty());
+
+  auto received = batches.rlock();
+  ASSERT_EQ(2, received->size());
+  std::vector<GlobResult> matches;
+  for (auto& batch : *received) {
+    ASSERT_EQ(1, batch.size());
+    matches.push_back(batch[0]);
+  }
+  std::sort(matches.begin(), matches.end());
+  std::vector<GlobResult> expect{
+      GlobResult("dir/a.txt"_relpath, dtype_t::Regular, kZeroRootId),
+      GlobResult("dir/sub/b.txt"_relpath, dtype_t::Regular, kZeroRootId),
+  };
+  EXPECT_EQ(expect, matches);
+}
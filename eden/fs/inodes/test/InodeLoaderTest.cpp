@@ -107,3 +107,37 @@ TEST(InodeLoader, notReady) {
     EXPECT_EQ("dir/sub/b.txt"_relpath, results[3].value());
   }
 }
+
+TEST(InodeLoader, lookupDoesNotLoadLeaves) {
+  FakeTreeBuilder builder;
+  builder.setFiles({{"dir/a.txt", ""}, {"dir/sub/b.txt", ""}});
+  TestMount mount(builder);
+
+  auto rootInode = mount.getTreeInode(RelativePathPiece());
+  // Loading a.txt makes it resolve to its inode rather than its entry.
+  mount.getFileInode("dir/a.txt");
+
+  auto results =
+      collectAll(
+          applyToInodesOrEntries(
+              rootInode,
+              std::vector<std::string>{
+                  "dir/a.txt", "dir/sub/b.txt", "dir/sub", "not/exist"},
+              [](InodeOrEntry& inodeOrEntry) {
+                return std::holds_alternative<InodePtr>(inodeOrEntry);
+              },
+              ObjectFetchContext::getNullContext(),
+              /*maxConcurrentLoads=*/1))
+          .get();
+
+  EXPECT_TRUE(results[0].value());
+  // dir/sub had to be loaded to look b.txt up, so it is resolved to its
+  // inode too.
+  EXPECT_FALSE(results[1].value());
+  EXPECT_TRUE(results[2].value());
+  EXPECT_THROW_ERRNO(results[3].value(), ENOENT);
+
+  auto sub = mount.getTreeInode("dir/sub");
+  auto contents = sub->getContents().rlock();
+  EXPECT_EQ(nullptr, contents->entries.find("b.txt"_pc)->second.getInode());
+}
@@ -91,6 +91,38 @@ TEST(InodeMap, simpleLookups) {
       inodeMap->lookupTreeInode(noop->getNodeId()).get(), ENOTDIR);
 }
 
+TEST(InodeMap, lookupsAcrossShards) {
+  FakeTreeBuilder builder;
+  for (int i = 0; i < 100; ++i) {
+    builder.setFile(folly::sformat("dir/file{}", i), "contents\n");
+  }
+  TestMount testMount{builder};
+  auto* inodeMap = testMount.getEdenMount()->getInodeMap();
+  auto before = inodeMap->getInodeCounts();
+
+  std::vector<FileInodePtr> files;
+  std::vector<InodeNumber> numbers;
+  for (int i = 0; i < 100; ++i) {
+    files.push_back(testMount.getFileInode(folly::sformat("dir/file{}", i)));
+    numbers.push_back(files.back()->getNodeId());
+  }
+
+  auto counts = inodeMap->getInodeCounts();
+  EXPECT_EQ(before.fileCount + 100, counts.fileCount);
+  EXPECT_EQ(before.treeCount + 1, counts.treeCount);
+  for (const auto& file : files) {
+    EXPECT_EQ(file, inodeMap->lookupLoadedFile(file->getNodeId()));
+    EXPECT_EQ(file, inodeMap->lookupFileInode(file->getNodeId()).get());
+  }
+
+  files.clear();
+  testMount.getEdenMount()->getRootInode()->unloadChildrenNow();
+  for (auto number : numbers) {
+    EXPECT_FALSE(inodeMap->lookupLoadedInode(number));
+  }
+  EXPECT_GE(before.fileCount, inodeMap->getInodeCounts().fileCount);
+}
+
 TEST(InodeMap, asyncLookup) {
   auto builder = FakeTreeBuilder();
   builder.setFile("README", "docs go here\n");
@@ -593,6 +625,51 @@ TEST_F(
 }
 #endif
 
+#ifdef __linux__
+TEST_F(InodePersistenceTreeTest, readsTakeoverSnapshotEntriesOnDemand) {
+  TestMount testMount{builder};
+  auto edenMount = testMount.getEdenMount();
+
+  auto tree =
+      edenMount->getInode("dir"_relpath, ObjectFetchContext::getNullContext())
+          .get();
+  auto file1 =
+      edenMount
+          ->getInode(
+              "dir/file1.txt"_relpath, ObjectFetchContext::getNullContext())
+          .get();
+  // Pretend FUSE is keeping a reference to the file, its parent is then
+  // remembered too.
+  file1->incFsRefcount();
+  auto treeId = tree->getNodeId();
+  auto file1Id = file1->getNodeId();
+
+  edenMount.reset();
+  tree.reset();
+  file1.reset();
+  testMount.remountGracefully(/*throughSnapshot=*/true);
+  edenMount = testMount.getEdenMount();
+  auto* inodeMap = edenMount->getInodeMap();
+
+  EXPECT_TRUE(inodeMap->isInodeRemembered(treeId));
+  EXPECT_TRUE(inodeMap->isInodeRemembered(file1Id));
+  auto path = inodeMap->getPathForInode(file1Id);
+  ASSERT_TRUE(path.has_value());
+  EXPECT_EQ("dir/file1.txt", path->stringPiece());
+
+  // Loading the file copies it and its parent out of the snapshot.
+  auto inode = inodeMap->lookupInode(file1Id).get();
+  EXPECT_EQ("dir/file1.txt", inode->getLogPath());
+  EXPECT_EQ(1, inode->debugGetFsRefcount());
+  EXPECT_FALSE(inodeMap->isInodeRemembered(file1Id));
+  EXPECT_EQ(
+      treeId,
+      edenMount->getInode("dir"_relpath, ObjectFetchContext::getNullContext())
+          .get()
+          ->getNodeId());
+}
+#endif
+
 /**
  * clang and gcc use the inode number of a header to determine whether it's the
  * same file as one previously included and marked #pragma once.
@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/InodeNameTable.h"
+
+#include <folly/portability/GTest.h>
+
+using namespace facebook::eden;
+
+TEST(InodeNameTableTest, equalNamesShareOneCopy) {
+  InodeNameTable table;
+  auto a = table.intern(PathComponentPiece{"src"});
+  auto b = table.intern(PathComponentPiece{"src"});
+  auto c = table.intern(PathComponentPiece{"BUCK"});
+  EXPECT_EQ(2, table.size());
+  EXPECT_EQ("src", a.piece().stringPiece());
+  EXPECT_EQ("BUCK", c.piece().stringPiece());
+  EXPECT_EQ(a.piece().stringPiece().data(), b.piece().stringPiece().data());
+}
+
+TEST(InodeNameTableTest, namesAreRemovedWithTheirLastReference) {
+  InodeNameTable table;
+  auto a = table.intern(PathComponentPiece{"src"});
+  {
+    auto b = table.intern(PathComponentPiece{"src"});
+    auto c = table.intern(PathComponentPiece{"BUCK"});
+  }
+  EXPECT_EQ(1, table.size());
+  EXPECT_EQ("src", a.piece().stringPiece());
+
+  auto moved = std::move(a);
+  EXPECT_EQ(1, table.size());
+  moved = table.intern(PathComponentPiece{"test"});
+  EXPECT_EQ(1, table.size());
+  EXPECT_EQ("test", moved.piece().stringPiece());
+}
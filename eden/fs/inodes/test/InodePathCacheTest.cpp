@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/InodePathCache.h"
+
+#include <folly/portability/GTest.h>
+
+using namespace facebook::eden;
+
+TEST(InodePathCacheTest, remembersInsertedPaths) {
+  InodePathCache cache{10};
+  EXPECT_FALSE(cache.get(RelativePathPiece{"a/b"}).has_value());
+  cache.insert(RelativePathPiece{"a/b"}, 5_ino, cache.getGeneration());
+  EXPECT_EQ(5_ino, cache.get(RelativePathPiece{"a/b"}));
+  EXPECT_FALSE(cache.get(RelativePathPiece{"a"}).has_value());
+}
+
+TEST(InodePathCacheTest, invalidateForgetsAllPaths) {
+  InodePathCache cache{10};
+  cache.insert(RelativePathPiece{"a/b"}, 5_ino, cache.getGeneration());
+  cache.invalidate();
+  EXPECT_FALSE(cache.get(RelativePathPiece{"a/b"}).has_value());
+
+  cache.insert(RelativePathPiece{"a/b"}, 6_ino, cache.getGeneration());
+  EXPECT_EQ(6_ino, cache.get(RelativePathPiece{"a/b"}));
+}
+
+TEST(InodePathCacheTest, lookupsThatRacedWithAnInvalidationAreNotInserted) {
+  InodePathCache cache{10};
+  auto generation = cache.getGeneration();
+  cache.invalidate();
+  cache.insert(RelativePathPiece{"a/b"}, 5_ino, generation);
+  EXPECT_FALSE(cache.get(RelativePathPiece{"a/b"}).has_value());
+}
+
+TEST(InodePathCacheTest, isBounded) {
+  InodePathCache cache{2};
+  cache.insert(RelativePathPiece{"a"}, 2_ino, cache.getGeneration());
+  cache.insert(RelativePathPiece{"b"}, 3_ino, cache.getGeneration());
+  cache.insert(RelativePathPiece{"c"}, 4_ino, cache.getGeneration());
+  EXPECT_FALSE(cache.get(RelativePathPiece{"a"}).has_value());
+  EXPECT_EQ(4_ino, cache.get(RelativePathPiece{"c"}));
+}
+
+TEST(InodePathCacheTest, sizeZeroDisablesTheCache) {
+  InodePathCache cache{0};
+  cache.insert(RelativePathPiece{"a"}, 2_ino, cache.getGeneration());
+  EXPECT_FALSE(cache.get(RelativePathPiece{"a"}).has_value());
+}
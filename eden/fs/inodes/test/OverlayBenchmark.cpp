@@ -5,79 +5,265 @@
  * GNU General Public License version 2.
  */
 
+#include <folly/Conv.h>
+#include <folly/Exception.h>
+#include <folly/String.h>
 #include <folly/init/Init.h>
+#include <folly/json.h>
 #include <folly/stop_watch.h>
+#include <folly/testing/TestUtil.h>
 #include <gflags/gflags.h>
+#include <signal.h>
 #include <stdlib.h>
+#include <random>
 #include "eden/fs/inodes/DirEntry.h"
 #include "eden/fs/inodes/Overlay.h"
+#include "eden/fs/inodes/OverlayFile.h"
+#include "eden/fs/inodes/overlay/FsOverlay.h"
 #include "eden/fs/telemetry/NullStructuredLogger.h"
+#include "eden/fs/utils/SpawnedProcess.h"
 
 using namespace facebook::eden;
 using namespace folly::string_piece_literals;
 
-DEFINE_string(overlayPath, "", "Directory where the test overlay is created");
+DEFINE_string(overlayPath, "", "Directory where the test overlays are created");
+DEFINE_string(
+    overlayTypes,
+    "legacy,tree,tree-synchronous-off,tree-in-memory,log",
+    "Comma-separated overlay types to compare");
+DEFINE_uint64(numFiles, 100000, "Number of files created by the untar step");
+DEFINE_uint64(filesPerDir, 1000, "Number of files in each directory");
+DEFINE_uint64(numRewrites, 100000, "Number of file rewrites");
+DEFINE_uint64(renameDepth, 32, "Depth of the directories renamed across");
+DEFINE_uint64(numRenames, 10000, "Number of renames between deep directories");
+DEFINE_string(
+    crashAfterUntar,
+    "",
+    "Internal: untar into the overlay of the given type in --overlayPath, "
+    "then kill -9 the process");
 
 namespace {
 
-void benchmarkOverlayTreeWrites(AbsolutePathPiece overlayPath) {
-  // A large mount will contain 500,000 trees. If they're all loaded, they
-  // will all be written into the overlay. This benchmark simulates that
-  // workload and measures how long it takes.
-  //
-  // overlayPath is parameterized to measure on different filesystem types.
+constexpr std::pair<folly::StringPiece, Overlay::OverlayType> kOverlayTypes[] =
+    {
+        {"legacy"_sp, Overlay::OverlayType::Legacy},
+        {"tree"_sp, Overlay::OverlayType::Tree},
+        {"tree-synchronous-off"_sp, Overlay::OverlayType::TreeSynchronousOff},
+        {"tree-in-memory"_sp, Overlay::OverlayType::TreeInMemory},
+        {"log"_sp, Overlay::OverlayType::Log},
+};
 
+Overlay::OverlayType parseOverlayType(folly::StringPiece name) {
+  for (const auto& [typeName, type] : kOverlayTypes) {
+    if (typeName == name) {
+      return type;
+    }
+  }
+  throw std::invalid_argument(
+      folly::to<std::string>("unknown overlay type: ", name));
+}
+
+std::shared_ptr<Overlay> openOverlay(
+    AbsolutePathPiece path,
+    Overlay::OverlayType type) {
   auto overlay = Overlay::create(
-      overlayPath,
+      path,
       kPathMapDefaultCaseSensitive,
-      Overlay::OverlayType::Legacy,
+      type,
       std::make_shared<NullStructuredLogger>());
   overlay->initialize().get();
+  return overlay;
+}
+
+/**
+ * Print one result as a line of JSON, to be collected by scripts.
+ */
+void report(
+    folly::StringPiece overlayType,
+    folly::StringPiece workload,
+    uint64_t count,
+    std::chrono::nanoseconds elapsed) {
+  auto seconds =
+      std::chrono::duration_cast<std::chrono::duration<double>>(elapsed)
+          .count();
+  folly::dynamic result = folly::dynamic::object("overlay", overlayType)(
+      "workload", workload)("count", count)("seconds", seconds)(
+      "us_per_op", count ? seconds * 1e6 / count : 0.0);
+  printf("%s\n", folly::toJson(result).c_str());
+  fflush(stdout);
+}
 
-  Hash hash1{folly::ByteRange{"abcdabcdabcdabcdabcd"_sp}};
-  Hash hash2{folly::ByteRange{"01234012340123401234"_sp}};
+struct UntarResult {
+  std::vector<InodeNumber> dirs;
+  std::vector<InodeNumber> files;
+};
 
+/**
+ * Create FLAGS_numFiles files of FLAGS_filesPerDir per directory, the way
+ * TreeInode adds the entries of a new directory one at a time.
+ */
+UntarResult untar(Overlay& overlay) {
+  UntarResult result;
+  auto root = overlay.allocateInodeNumber();
+  DirContents rootContents(kPathMapDefaultCaseSensitive);
   DirContents contents(kPathMapDefaultCaseSensitive);
-  contents.emplace(
-      PathComponent{"one"},
-      S_IFREG | 0644,
-      overlay->allocateInodeNumber(),
-      hash1);
-  contents.emplace(
-      PathComponent{"two"},
-      S_IFDIR | 0755,
-      overlay->allocateInodeNumber(),
-      hash2);
-
-  uint64_t N = 500000;
+  InodeNumber dir;
+  for (uint64_t i = 0; i < FLAGS_numFiles; ++i) {
+    if (i % FLAGS_filesPerDir == 0) {
+      dir = overlay.allocateInodeNumber();
+      result.dirs.push_back(dir);
+      contents = DirContents(kPathMapDefaultCaseSensitive);
+      auto insertion = rootContents.emplace(
+          PathComponent{folly::to<std::string>("dir", result.dirs.size())},
+          S_IFDIR | 0755,
+          dir);
+      overlay.addChild(root, *insertion.first, rootContents);
+    }
+    auto file = overlay.allocateInodeNumber();
+    result.files.push_back(file);
+    overlay.createOverlayFile(
+        file, folly::ByteRange{folly::StringPiece{"file contents\n"}});
+    auto insertion = contents.emplace(
+        PathComponent{folly::to<std::string>("file", i)}, S_IFREG | 0644, file);
+    overlay.addChild(dir, *insertion.first, contents);
+  }
+  return result;
+}
+
+/**
+ * Rewrite random files, as an editor or a build writing its outputs would.
+ */
+void rewriteFiles(Overlay& overlay, const std::vector<InodeNumber>& files) {
+  std::mt19937_64 rng{0};
+  std::string contents(4096, 'x');
+  for (uint64_t i = 0; i < FLAGS_numRewrites; ++i) {
+    auto file = overlay.openFile(
+        files[rng() % files.size()], FsOverlay::kHeaderIdentifierFile);
+    iovec iov{contents.data(), contents.size()};
+    auto written = file.pwritev(&iov, 1, FsOverlay::kHeaderLength);
+    if (written.hasError()) {
+      folly::throwSystemErrorExplicit(written.error(), "rewrite failed");
+    }
+    file.ftruncate(FsOverlay::kHeaderLength + contents.size());
+  }
+}
 
+/**
+ * Move files back and forth between the leaves of two chains of
+ * FLAGS_renameDepth directories.
+ */
+void renameDeep(Overlay& overlay) {
+  auto makeChain = [&] {
+    auto parent = overlay.allocateInodeNumber();
+    InodeNumber leaf;
+    for (uint64_t depth = 0; depth < FLAGS_renameDepth; ++depth) {
+      leaf = overlay.allocateInodeNumber();
+      DirContents contents(kPathMapDefaultCaseSensitive);
+      auto insertion =
+          contents.emplace(PathComponent{"sub"}, S_IFDIR | 0755, leaf);
+      overlay.addChild(parent, *insertion.first, contents);
+      parent = leaf;
+    }
+    return leaf;
+  };
+  auto leaves = std::array<InodeNumber, 2>{makeChain(), makeChain()};
+  std::array<DirContents, 2> contents{
+      DirContents(kPathMapDefaultCaseSensitive),
+      DirContents(kPathMapDefaultCaseSensitive)};
+  for (uint64_t i = 0; i < 64; ++i) {
+    auto insertion = contents[0].emplace(
+        PathComponent{folly::to<std::string>("file", i)},
+        S_IFREG | 0644,
+        overlay.allocateInodeNumber());
+    overlay.addChild(leaves[0], *insertion.first, contents[0]);
+  }
+
+  for (uint64_t i = 0; i < FLAGS_numRenames; ++i) {
+    auto from = (i / 64) % 2;
+    auto to = 1 - from;
+    PathComponent name{folly::to<std::string>("file", i % 64)};
+    auto it = contents[from].find(name);
+    contents[to].emplace(
+        name, it->second.getInitialMode(), it->second.getInodeNumber());
+    contents[from].erase(it);
+    overlay.renameChild(
+        leaves[from], leaves[to], name, name, contents[from], contents[to]);
+  }
+}
+
+/**
+ * Load the contents of every directory, as a cold `ls -R` would.
+ */
+void listDirs(Overlay& overlay, const std::vector<InodeNumber>& dirs) {
+  size_t numEntries = 0;
+  for (auto dir : dirs) {
+    numEntries += overlay.loadOverlayDir(dir).size();
+  }
+  if (numEntries != FLAGS_numFiles) {
+    throw std::runtime_error(folly::to<std::string>(
+        "listed ", numEntries, " files instead of ", FLAGS_numFiles));
+  }
+}
+
+template <typename Fn>
+void timed(
+    folly::StringPiece overlayType,
+    folly::StringPiece workload,
+    uint64_t count,
+    Fn&& fn) {
   folly::stop_watch<> timer;
+  fn();
+  report(overlayType, workload, count, timer.elapsed());
+}
 
-  for (uint64_t i = 1; i <= N; i++) {
-    auto ino = overlay->allocateInodeNumber();
-    overlay->saveOverlayDir(ino, contents);
+/**
+ * Untar into a new overlay in a child process that is killed before closing
+ * it, then time reopening the overlay, which has to recover from the unclean
+ * shutdown.
+ */
+void measureRecovery(folly::StringPiece typeName, AbsolutePathPiece dir) {
+  SpawnedProcess child{
+      {executablePath().value(),
+       folly::to<std::string>("--overlayPath=", dir),
+       folly::to<std::string>("--crashAfterUntar=", typeName),
+       folly::to<std::string>("--numFiles=", FLAGS_numFiles),
+       folly::to<std::string>("--filesPerDir=", FLAGS_filesPerDir)}};
+  auto status = child.wait();
+  if (status.killSignal() != SIGKILL) {
+    throw std::runtime_error(folly::to<std::string>(
+        "the crashing child exited with ", status.str()));
   }
 
-  auto elapsed = timer.elapsed();
+  timed(typeName, "recovery", FLAGS_numFiles, [&] {
+    openOverlay(dir, parseOverlayType(typeName))->close();
+  });
+}
 
-  printf(
-      "Total elapsed time for %" SCNu64 " entries: %.2f s\n",
-      N,
-      std::chrono::duration_cast<std::chrono::duration<double>>(elapsed)
-          .count());
-
-  // Normally, I prefer to use minimum, but the cost of writing into the
-  // overlay increases as the overlay grows, as xfs especially updates its
-  // btrees.
-  //
-  // That reason, plus the reason that we want a fixed N for comparable results
-  // is why this benchmark doesn't use folly Benchmark.
-  printf(
-      "Average time per call: %.2f us\n",
-      static_cast<double>(
-          std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(
-              elapsed / N)
-              .count()));
+void benchmarkOverlay(folly::StringPiece typeName, AbsolutePathPiece root) {
+  auto type = parseOverlayType(typeName);
+  auto dir = root + PathComponentPiece{typeName};
+  ensureDirectoryExists(dir);
+
+  auto overlay = openOverlay(dir, type);
+  UntarResult tree;
+  timed(typeName, "untar", FLAGS_numFiles, [&] { tree = untar(*overlay); });
+  timed(typeName, "rewrite", FLAGS_numRewrites, [&] {
+    rewriteFiles(*overlay, tree.files);
+  });
+  timed(
+      typeName, "deep_rename", FLAGS_numRenames, [&] { renameDeep(*overlay); });
+  timed(typeName, "list", tree.dirs.size(), [&] {
+    listDirs(*overlay, tree.dirs);
+  });
+  overlay->close();
+
+  // There is nothing to recover from an in-memory overlay.
+  if (type != Overlay::OverlayType::TreeInMemory) {
+    auto crashDir =
+        root + PathComponent{folly::to<std::string>(typeName, "-crash")};
+    ensureDirectoryExists(crashDir);
+    measureRecovery(typeName, crashDir);
+  }
 }
 
 } // namespace
@@ -89,9 +275,29 @@ int main(int argc, char* argv[]) {
     fprintf(stderr, "error: overlayPath is required\n");
     return 1;
   }
-
   auto overlayPath = normalizeBestEffort(FLAGS_overlayPath.c_str());
-  benchmarkOverlayTreeWrites(overlayPath);
+
+  if (!FLAGS_crashAfterUntar.empty()) {
+    auto overlay =
+        openOverlay(overlayPath, parseOverlayType(FLAGS_crashAfterUntar));
+    untar(*overlay);
+    kill(getpid(), SIGKILL);
+  }
+
+  // Each overlay is created in a new directory so that runs don't interfere,
+  // and the files written by the crashing children are removed with it.
+  folly::test::TemporaryDirectory tempDir{
+      "eden_overlay_benchmark", FLAGS_overlayPath};
+  auto root = normalizeBestEffort(tempDir.path().string());
+  std::vector<folly::StringPiece> types;
+  folly::split(',', FLAGS_overlayTypes, types);
+
+  // Overlay writes get slower as the overlay grows, as xfs especially updates
+  // its btrees, and the results should be comparable across runs, so this
+  // uses fixed counts rather than folly Benchmark.
+  for (auto type : types) {
+    benchmarkOverlay(type, root);
+  }
 
   return 0;
 }
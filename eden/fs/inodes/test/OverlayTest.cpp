@@ -20,9 +20,12 @@
 #include <folly/portability/GTest.h>
 #include <folly/synchronization/test/Barrier.h>
 #include <folly/test/TestUtils.h>
+#include <gflags/gflags.h>
 #include <algorithm>
+#include <functional>
 #include <iomanip>
 #include <sstream>
+#include <thread>
 
 #include "eden/fs/inodes/EdenMount.h"
 #include "eden/fs/inodes/FileInode.h"
@@ -41,6 +44,11 @@
 
 using namespace folly::string_piece_literals;
 
+DECLARE_bool(overlayDeferFsck);
+DECLARE_uint32(overlayGcThreads);
+DECLARE_uint32(overlayInodeNumberBlockSize);
+DECLARE_uint64(treeOverlayInlineFileBytes);
+
 namespace facebook {
 namespace eden {
 
@@ -320,11 +328,224 @@ TEST(PlainOverlayTest, unclean_overlay_is_dirty) {
   EXPECT_FALSE(overlay->hadCleanStartup());
 }
 
+TEST(PlainOverlayTest, unclean_overlay_resumes_from_inode_number_reservation) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_overlayDeferFsck = true;
+
+  folly::test::TemporaryDirectory testDir;
+  auto localDir = AbsolutePath{testDir.path().string()};
+  auto reservationPath = localDir + "inode-number-reservation"_pc;
+
+  std::string reservation;
+  {
+    auto overlay = Overlay::create(
+        localDir,
+        kPathMapDefaultCaseSensitive,
+        kOverlayType,
+        std::make_shared<NullStructuredLogger>());
+    overlay->initialize().get();
+    auto ino = overlay->allocateInodeNumber();
+
+    // The reservation covers every inode number handed out so far.
+    ASSERT_TRUE(folly::readFile(reservationPath.c_str(), reservation));
+    ASSERT_EQ(sizeof(uint64_t), reservation.size());
+    uint64_t limit;
+    memcpy(&limit, reservation.data(), sizeof(limit));
+    EXPECT_GT(limit, ino.get());
+  }
+  EXPECT_EQ(-1, access(reservationPath.c_str(), F_OK))
+      << "a clean shutdown drops the reservation";
+
+  // Simulate a crash, which leaves the reservation behind.
+  if (unlink((localDir + "next-inode-number"_pc).c_str())) {
+    folly::throwSystemError("removing saved inode numebr");
+  }
+  ASSERT_TRUE(folly::writeFile(reservation, reservationPath.c_str()));
+
+  auto overlay = Overlay::create(
+      localDir,
+      kPathMapDefaultCaseSensitive,
+      kOverlayType,
+      std::make_shared<NullStructuredLogger>());
+  overlay->initialize().get();
+  EXPECT_FALSE(overlay->hadCleanStartup());
+  uint64_t limit;
+  memcpy(&limit, reservation.data(), sizeof(limit));
+  EXPECT_EQ(InodeNumber{limit}, overlay->allocateInodeNumber());
+}
+
+TEST(PlainOverlayTest, materializes_files_from_blob_cache) {
+  folly::test::TemporaryDirectory testDir;
+  auto localDir = AbsolutePath{testDir.path().string()};
+  auto overlay = Overlay::create(
+      localDir,
+      kPathMapDefaultCaseSensitive,
+      kOverlayType,
+      std::make_shared<NullStructuredLogger>(),
+      Overlay::CacheSizes{/*blobCache=*/1024 * 1024});
+  overlay->initialize().get();
+
+  auto contents = folly::IOBuf::copyBuffer(std::string{"blob contents"});
+  auto blobHash = Hash::sha1(*contents);
+  // Both files are cloned from the same cached blob where the filesystem
+  // allows it, and copied otherwise.
+  for (auto i = 0; i < 2; ++i) {
+    auto ino = overlay->allocateInodeNumber();
+    auto file = overlay->createOverlayFileFromBlob(ino, blobHash, *contents);
+    ASSERT_FALSE(file.lseek(FsOverlay::kHeaderLength, SEEK_SET).hasError());
+    EXPECT_EQ("blob contents", file.readFile().value());
+  }
+
+  // The blob is only cached where the filesystem can clone files.
+  struct stat st;
+  auto blobPath = localDir + "blobs"_pc + PathComponent{blobHash.toString()};
+  if (::stat(blobPath.c_str(), &st) == 0) {
+    EXPECT_EQ(FsOverlay::kHeaderLength + contents->length(), st.st_size);
+  }
+}
+
+TEST(PlainOverlayTest, blob_cache_evicts_blobs_when_full) {
+  auto blobSize = FsOverlay::kHeaderLength + 8;
+  folly::test::TemporaryDirectory testDir;
+  auto localDir = AbsolutePath{testDir.path().string()};
+  auto overlay = Overlay::create(
+      localDir,
+      kPathMapDefaultCaseSensitive,
+      kOverlayType,
+      std::make_shared<NullStructuredLogger>(),
+      Overlay::CacheSizes{/*blobCache=*/2 * blobSize});
+  overlay->initialize().get();
+
+  std::vector<AbsolutePath> blobPaths;
+  for (auto name : {"blob 001", "blob 002", "blob 003"}) {
+    auto contents = folly::IOBuf::copyBuffer(std::string{name});
+    auto blobHash = Hash::sha1(*contents);
+    overlay->createOverlayFileFromBlob(
+        overlay->allocateInodeNumber(), blobHash, *contents);
+    blobPaths.push_back(
+        localDir + "blobs"_pc + PathComponent{blobHash.toString()});
+  }
+
+  struct stat st;
+  if (::stat(blobPaths[2].c_str(), &st) != 0) {
+    // The filesystem can't clone files.
+    return;
+  }
+  // Making room for the third blob evicted one of the others.
+  EXPECT_EQ(
+      1,
+      (::stat(blobPaths[0].c_str(), &st) == 0) +
+          (::stat(blobPaths[1].c_str(), &st) == 0));
+}
+
+TEST(PlainOverlayTest, blob_cache_is_bounded) {
+  folly::test::TemporaryDirectory testDir;
+  auto localDir = AbsolutePath{testDir.path().string()};
+  auto overlay = Overlay::create(
+      localDir,
+      kPathMapDefaultCaseSensitive,
+      kOverlayType,
+      std::make_shared<NullStructuredLogger>(),
+      Overlay::CacheSizes{/*blobCache=*/1});
+  overlay->initialize().get();
+
+  auto contents = folly::IOBuf::copyBuffer(std::string{"blob contents"});
+  auto blobHash = Hash::sha1(*contents);
+  auto ino = overlay->allocateInodeNumber();
+  auto file = overlay->createOverlayFileFromBlob(ino, blobHash, *contents);
+  ASSERT_FALSE(file.lseek(FsOverlay::kHeaderLength, SEEK_SET).hasError());
+  EXPECT_EQ("blob contents", file.readFile().value());
+
+  struct stat st;
+  auto blobPath = localDir + "blobs"_pc + PathComponent{blobHash.toString()};
+  EXPECT_EQ(-1, ::stat(blobPath.c_str(), &st));
+}
+
+TEST(PlainOverlayTest, removed_trees_are_collected_in_parallel) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_overlayGcThreads = 4;
+
+  folly::test::TemporaryDirectory testDir;
+  auto overlay = Overlay::create(
+      AbsolutePath{testDir.path().string()},
+      kPathMapDefaultCaseSensitive,
+      kOverlayType,
+      std::make_shared<NullStructuredLogger>());
+  overlay->initialize().get();
+
+  // Build a tree with a few levels of directories, each containing a file,
+  // so that the collection fans out to several GC workers.
+  std::vector<InodeNumber> descendants;
+  std::function<InodeNumber(int)> makeTree = [&](int depth) {
+    auto ino = overlay->allocateInodeNumber();
+    DirContents dir(kPathMapDefaultCaseSensitive);
+    auto fileIno = overlay->allocateInodeNumber();
+    overlay->createOverlayFile(fileIno, folly::ByteRange{"contents"_sp});
+    dir.emplace("file"_pc, S_IFREG | 0644, fileIno);
+    descendants.push_back(fileIno);
+    if (depth > 0) {
+      for (auto name : {"a"_pc, "b"_pc, "c"_pc}) {
+        auto childIno = makeTree(depth - 1);
+        dir.emplace(name, S_IFDIR | 0755, childIno);
+        descendants.push_back(childIno);
+      }
+    }
+    overlay->saveOverlayDir(ino, dir);
+    return ino;
+  };
+  auto rootIno = makeTree(3);
+
+  overlay->recursivelyRemoveOverlayData(rootIno);
+  overlay->flushPendingAsync().get();
+
+  EXPECT_FALSE(overlay->hasOverlayData(rootIno));
+  for (auto ino : descendants) {
+    EXPECT_FALSE(overlay->hasOverlayData(ino)) << ino.get();
+  }
+  EXPECT_EQ(0, overlay->getGCQueueDepth());
+}
+
 enum class OverlayRestartMode {
   CLEAN,
   UNCLEAN,
 };
 
+TEST(TreeOverlayInlineFilesTest, small_files_are_stored_in_the_database) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_treeOverlayInlineFileBytes = 8;
+
+  FakeTreeBuilder builder;
+  builder.setFile("dir/a.txt", "contents");
+  TestMount mount;
+  mount.getConfig()->setEnableTreeOverlay(true);
+  mount.initialize(builder);
+  auto overlay = mount.getEdenMount()->getOverlay();
+
+  mount.addFile("new.txt", "tiny");
+  auto ino = mount.getFileInode("new.txt")->getNodeId();
+  EXPECT_EQ("tiny", overlay->loadInlineFile(ino));
+  EXPECT_EQ("tiny", mount.readFile("new.txt"));
+
+  // Writes within the limit replace the inline contents.
+  mount.overwriteFile("new.txt", "tinier");
+  EXPECT_EQ("tinier", overlay->loadInlineFile(ino));
+  EXPECT_EQ("tinier", mount.readFile("new.txt"));
+
+  // A write past the limit moves the file to an overlay file.
+  mount.overwriteFile("new.txt", "no longer tiny");
+  EXPECT_EQ(std::nullopt, overlay->loadInlineFile(ino));
+  EXPECT_EQ("no longer tiny", mount.readFile("new.txt"));
+  auto file = overlay->openFileNoVerify(ino);
+  ASSERT_FALSE(file.lseek(FsOverlay::kHeaderLength, SEEK_SET).hasError());
+  EXPECT_EQ("no longer tiny", file.readFile().value());
+
+  // Files of the source control tree are stored inline once materialized.
+  mount.overwriteFile("dir/a.txt", "modified");
+  auto materialized = mount.getFileInode("dir/a.txt")->getNodeId();
+  EXPECT_EQ("modified", overlay->loadInlineFile(materialized));
+  EXPECT_EQ("modified", mount.readFile("dir/a.txt"));
+}
+
 class RawOverlayTest : public ::testing::TestWithParam<OverlayRestartMode> {
  public:
   RawOverlayTest() : testDir_{makeTempDir("eden_raw_overlay_test_")} {
@@ -514,6 +735,43 @@ TEST_P(RawOverlayTest, cannot_remove_overlay_file_when_closed) {
       "cannot access overlay after it is closed");
 }
 
+TEST_P(RawOverlayTest, concurrently_allocated_inode_numbers_are_unique) {
+  gflags::FlagSaver flagSaver;
+  FLAGS_overlayInodeNumberBlockSize = 4;
+
+  constexpr size_t kThreads = 4;
+  constexpr size_t kPerThread = 10;
+  std::vector<std::vector<InodeNumber>> allocated(kThreads);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < kThreads; ++i) {
+    threads.emplace_back([&, i] {
+      for (size_t j = 0; j < kPerThread; ++j) {
+        allocated[i].push_back(overlay->allocateInodeNumber());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  std::vector<InodeNumber> all;
+  for (auto& numbers : allocated) {
+    all.insert(all.end(), numbers.begin(), numbers.end());
+  }
+  std::sort(all.begin(), all.end());
+  EXPECT_EQ(all.end(), std::adjacent_find(all.begin(), all.end()));
+  EXPECT_LT(kRootNodeId, all.front());
+
+  // The threads have exited, but their numbers are still accounted for.
+  EXPECT_EQ(all.back(), overlay->getMaxInodeNumber());
+  auto ino = overlay->allocateInodeNumber();
+  EXPECT_GT(ino, all.back());
+
+  recreate(OverlayRestartMode::CLEAN);
+  EXPECT_EQ(ino, overlay->getMaxInodeNumber());
+  EXPECT_EQ(InodeNumber{ino.get() + 1}, overlay->allocateInodeNumber());
+}
+
 TEST_P(RawOverlayTest, max_inode_number_is_1_if_overlay_is_empty) {
   EXPECT_EQ(kRootNodeId, overlay->getMaxInodeNumber());
   EXPECT_EQ(2_ino, overlay->allocateInodeNumber());
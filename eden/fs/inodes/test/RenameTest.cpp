@@ -196,6 +196,29 @@ TEST_F(RenameTest, renameFileToSamePath) {
   EXPECT_EQ(path, origFile->getPath().value());
 }
 
+TEST_F(RenameTest, renameFileWithinDirectoryDoesNotExcludeOtherRenames) {
+  // Renames elsewhere in the mount only hold the rename lock in shared mode,
+  // which must not block renaming a file within a materialized directory.
+  auto renameLock = mount_->getEdenMount()->acquireSharedRenameLock();
+
+  auto dir = mount_->getTreeInode("a/b/c");
+  auto origFile = mount_->getFileInode("a/b/c/doc.txt");
+  auto renameFuture = dir->rename(
+      "doc.txt"_pc,
+      dir,
+      "readme.txt"_pc,
+      InvalidationRequired::No,
+      ObjectFetchContext::getNullContext());
+  ASSERT_TRUE(renameFuture.isReady());
+  std::move(renameFuture).get();
+
+  EXPECT_EQ("a/b/c/readme.txt"_relpath, origFile->getPath().value());
+  EXPECT_EQ(
+      origFile->getNodeId(),
+      mount_->getFileInode("a/b/c/readme.txt")->getNodeId());
+  EXPECT_THROW_ERRNO(mount_->getFileInode("a/b/c/doc.txt"), ENOENT);
+}
+
 /*
  * Basic tests for renaming directories
  */
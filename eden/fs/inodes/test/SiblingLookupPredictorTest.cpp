@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/SiblingLookupPredictor.h"
+
+#include <folly/portability/GTest.h>
+
+using namespace facebook::eden;
+
+TEST(SiblingLookupPredictorTest, predictsOnceThresholdIsReached) {
+  SiblingLookupPredictor predictor;
+  EXPECT_FALSE(predictor.recordLookup(1, 2_ino, 3_ino, "BUCK"_pc, 3));
+  EXPECT_FALSE(predictor.recordLookup(1, 2_ino, 4_ino, "BUCK"_pc, 3));
+  EXPECT_TRUE(predictor.recordLookup(1, 2_ino, 5_ino, "BUCK"_pc, 3));
+  // The lookups are only predicted once.
+  EXPECT_FALSE(predictor.recordLookup(1, 2_ino, 6_ino, "BUCK"_pc, 3));
+}
+
+TEST(SiblingLookupPredictorTest, repeatedLookupsInSameDirectoryDoNotCount) {
+  SiblingLookupPredictor predictor;
+  EXPECT_FALSE(predictor.recordLookup(1, 2_ino, 3_ino, "BUCK"_pc, 2));
+  EXPECT_FALSE(predictor.recordLookup(1, 2_ino, 3_ino, "BUCK"_pc, 2));
+  EXPECT_TRUE(predictor.recordLookup(1, 2_ino, 4_ino, "BUCK"_pc, 2));
+}
+
+TEST(SiblingLookupPredictorTest, lookupsAreTrackedPerProcessAndName) {
+  SiblingLookupPredictor predictor;
+  EXPECT_FALSE(predictor.recordLookup(1, 2_ino, 3_ino, "BUCK"_pc, 2));
+  EXPECT_FALSE(predictor.recordLookup(7, 2_ino, 4_ino, "BUCK"_pc, 2));
+  EXPECT_FALSE(predictor.recordLookup(1, 2_ino, 4_ino, "TARGETS"_pc, 2));
+  EXPECT_FALSE(predictor.recordLookup(1, 8_ino, 9_ino, "BUCK"_pc, 2));
+  EXPECT_TRUE(predictor.recordLookup(1, 2_ino, 4_ino, "BUCK"_pc, 2));
+}
+
+TEST(SiblingLookupPredictorTest, forgetsLeastRecentlyUsedLookups) {
+  SiblingLookupPredictor predictor{1};
+  EXPECT_FALSE(predictor.recordLookup(1, 2_ino, 3_ino, "BUCK"_pc, 2));
+  EXPECT_FALSE(predictor.recordLookup(1, 2_ino, 3_ino, "TARGETS"_pc, 2));
+  EXPECT_FALSE(predictor.recordLookup(1, 2_ino, 4_ino, "BUCK"_pc, 2));
+}
@@ -7,7 +7,11 @@
 
 #include "eden/fs/inodes/Traverse.h"
 
+#include <folly/Conv.h>
+#include <folly/Synchronized.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/portability/GTest.h>
+#include <algorithm>
 #include "eden/fs/inodes/FileInode.h"
 #include "eden/fs/inodes/InodeBase.h"
 #include "eden/fs/inodes/TreeInode.h"
@@ -75,3 +79,57 @@ TEST(TraverseTest, does_traverse_loaded_trees) {
   EXPECT_EQ("dir1", callbacks.paths.at(2));
   EXPECT_EQ("dir1/dir2", callbacks.paths.at(3));
 }
+
+struct ConcurrentTestCallbacks : ConcurrentTraversalCallbacks {
+  folly::Synchronized<std::vector<RelativePath>> paths;
+
+  void visitTreeInode(
+      RelativePathPiece path,
+      InodeNumber ino,
+      const std::optional<Hash>& hash,
+      uint64_t fuseRefcount,
+      const std::vector<ChildEntry>& entries) override {
+    paths.wlock()->emplace_back(path);
+    (void)ino;
+    (void)hash;
+    (void)fuseRefcount;
+    (void)entries;
+  }
+
+  bool shouldRecurse(const ChildEntry& entry) override {
+    (void)entry;
+    return true;
+  }
+};
+
+TEST(TraverseTest, concurrent_traversal_visits_the_same_trees) {
+  FakeTreeBuilder builder;
+  for (auto i = 0; i < 8; ++i) {
+    for (auto j = 0; j < 8; ++j) {
+      builder.setFile(folly::to<std::string>("dir", i, "/sub", j, "/file"), "");
+    }
+  }
+  TestMount mount{builder};
+
+  auto rootPath = RelativePath{""};
+  auto root = mount.getTreeInode(rootPath);
+  for (auto i = 0; i < 8; i += 2) {
+    mount.getFileInode(folly::to<std::string>("dir", i, "/sub", i, "/file"));
+  }
+
+  TestCallbacks callbacks;
+  traverseObservedInodes(*root, rootPath, callbacks);
+
+  folly::CPUThreadPoolExecutor executor{4};
+  ConcurrentTestCallbacks concurrentCallbacks;
+  traverseObservedInodesConcurrently(
+      root, rootPath, concurrentCallbacks, folly::getKeepAliveToken(executor))
+      .get();
+
+  auto concurrentPaths = concurrentCallbacks.paths.copy();
+  // The root is always visited first.
+  EXPECT_EQ("", concurrentPaths.at(0));
+  std::sort(callbacks.paths.begin(), callbacks.paths.end());
+  std::sort(concurrentPaths.begin(), concurrentPaths.end());
+  EXPECT_EQ(callbacks.paths, concurrentPaths);
+}
@@ -243,6 +243,45 @@ TEST(TreeInode, fuseReaddirRespectsOffset) {
   EXPECT_EQ(0, resultE.size());
 }
 
+#ifdef __linux__
+TEST(TreeInode, fuseReaddirPlusReturnsAttributesOfChildren) {
+  FakeTreeBuilder builder;
+  builder.setFiles({{"file", "hello"}, {"dir/sub", "contents"}});
+  TestMount mount{builder};
+
+  auto root = mount.getEdenMount()->getRootInode();
+  auto result = root->fuseReaddirPlus(
+                        FuseDirList{4096},
+                        0,
+                        ObjectFetchContext::getNullContext())
+                    .get(0ms)
+                    .extractPlus();
+
+  ASSERT_EQ(5, result.size());
+  EXPECT_EQ(".", result[0].name);
+  EXPECT_EQ(0, result[0].nodeid);
+  EXPECT_EQ("..", result[1].name);
+  EXPECT_EQ(0, result[1].nodeid);
+
+  auto fileInode = mount.getFileInode("file");
+  auto dirInode = mount.getTreeInode("dir");
+  for (size_t i = 2; i < result.size(); ++i) {
+    const auto& entry = result[i];
+    if (entry.name == "file") {
+      EXPECT_EQ(fileInode->getNodeId().get(), entry.nodeid);
+      EXPECT_EQ(5, entry.size);
+      EXPECT_EQ(1, fileInode->debugGetFsRefcount());
+    } else if (entry.name == "dir") {
+      EXPECT_EQ(dirInode->getNodeId().get(), entry.nodeid);
+      EXPECT_EQ(1, dirInode->debugGetFsRefcount());
+    } else {
+      EXPECT_EQ(".eden", entry.name);
+      EXPECT_EQ(entry.inode, entry.nodeid);
+    }
+  }
+}
+#endif
+
 TEST(TreeInode, fuseReaddirIgnoresWildOffsets) {
   TestMount mount{FakeTreeBuilder{}};
 
@@ -256,6 +295,51 @@ TEST(TreeInode, fuseReaddirIgnoresWildOffsets) {
   EXPECT_EQ(0, result.size());
 }
 
+TEST(TreeInode, fuseReaddirOfLargeDirectorySeesLaterChanges) {
+  // Listings of large directories are cached between readdir calls. Make
+  // sure creating and removing entries still shows up in the next listing.
+  FakeTreeBuilder builder;
+  for (int i = 0; i < 300; ++i) {
+    builder.setFile(folly::to<std::string>("dir/file", i), "");
+  }
+  TestMount mount{builder};
+  auto dir = mount.getTreeInode("dir");
+
+  auto listNames = [&] {
+    std::unordered_set<std::string> names;
+    for (auto& entry :
+         dir->fuseReaddir(
+                FuseDirList{64 * 1024}, 0, ObjectFetchContext::getNullContext())
+             .extract()) {
+      names.insert(entry.name);
+    }
+    return names;
+  };
+
+  auto names = listNames();
+  EXPECT_EQ(302, names.size());
+  EXPECT_EQ(1, names.count("file0"));
+
+  mount.addFile("dir/new", "");
+  mount.deleteFile("dir/file0");
+
+  names = listNames();
+  EXPECT_EQ(302, names.size());
+  EXPECT_EQ(1, names.count("new"));
+  EXPECT_EQ(0, names.count("file0"));
+
+  // Renames change the listing of both directories.
+  mount.addFile("other", "");
+  mount.move("other", "dir/moved");
+  mount.move("dir/file1", "dir/renamed");
+
+  names = listNames();
+  EXPECT_EQ(303, names.size());
+  EXPECT_EQ(1, names.count("moved"));
+  EXPECT_EQ(1, names.count("renamed"));
+  EXPECT_EQ(0, names.count("file1"));
+}
+
 namespace {
 
 // 500 is big enough for ~9 entries
@@ -417,6 +501,29 @@ TEST(TreeInode, createExists) {
 #endif
 }
 
+TEST(TreeInode, getOrLoadChildIfExists) {
+  FakeTreeBuilder builder;
+  builder.setFile("somedir/foo.txt", "test\n");
+  TestMount mount{builder};
+
+  auto somedir = mount.getTreeInode("somedir"_relpath);
+  auto& context = ObjectFetchContext::getNullContext();
+
+  auto child = somedir->getOrLoadChildIfExists("foo.txt"_pc, context).get(0ms);
+  ASSERT_TRUE(child);
+  EXPECT_EQ(
+      mount.getFileInode("somedir/foo.txt"_relpath)->getNodeId(),
+      child->getNodeId());
+
+  auto missing =
+      somedir->getOrLoadChildIfExists("bar.txt"_pc, context).get(0ms);
+  EXPECT_FALSE(missing);
+
+  // The missing child is still an error for getOrLoadChild.
+  EXPECT_THROW_ERRNO(
+      somedir->getOrLoadChild("bar.txt"_pc, context).get(0ms), ENOENT);
+}
+
 #ifndef _WIN32
 
 TEST(TreeInode, createOverlayWriteError) {
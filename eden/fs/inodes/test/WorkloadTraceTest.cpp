@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/inodes/WorkloadTrace.h"
+
+#include <folly/FileUtil.h>
+#include <folly/json.h>
+#include <folly/portability/GTest.h>
+#include <folly/testing/TestUtil.h>
+
+using namespace facebook::eden;
+using namespace std::chrono_literals;
+
+namespace {
+
+WorkloadTraceRecord makeRename() {
+  WorkloadTraceRecord record;
+  record.time = 1500us;
+  record.op = "FUSE_RENAME";
+  record.path = RelativePath{"dir/old"};
+  record.newPath = RelativePath{"other/new"};
+  record.pid = 42;
+  return record;
+}
+
+WorkloadTraceRecord makeRead() {
+  WorkloadTraceRecord record;
+  record.time = 2000us;
+  record.op = "FUSE_READ";
+  record.path = RelativePath{"dir/file"};
+  record.offset = 4096;
+  record.size = 131072;
+  record.pid = 43;
+  return record;
+}
+
+} // namespace
+
+TEST(WorkloadTrace, records_round_trip_through_dynamic) {
+  for (const auto& record : {makeRename(), makeRead()}) {
+    EXPECT_EQ(record, WorkloadTraceRecord::fromDynamic(record.toDynamic()));
+  }
+}
+
+TEST(WorkloadTrace, default_fields_are_omitted) {
+  auto value = makeRename().toDynamic();
+  EXPECT_EQ(nullptr, value.get_ptr("offset"));
+  EXPECT_EQ(nullptr, value.get_ptr("size"));
+  EXPECT_EQ("other/new", value["new_path"].asString());
+}
+
+TEST(WorkloadTrace, fromDynamic_rejects_records_without_path) {
+  auto value = makeRead().toDynamic();
+  value.erase("path");
+  EXPECT_ANY_THROW(WorkloadTraceRecord::fromDynamic(value));
+}
+
+TEST(WorkloadTrace, reads_one_record_per_line) {
+  folly::test::TemporaryDirectory dir{"eden_workload_trace_test"};
+  auto path = normalizeBestEffort((dir.path() / "trace.jsonl").string());
+  auto contents = serializeWorkloadTraceRecord(makeRename()) + "\n" +
+      serializeWorkloadTraceRecord(makeRead());
+  ASSERT_TRUE(folly::writeFile(contents, path.stringPiece().str().c_str()));
+
+  auto records = readWorkloadTrace(path);
+  ASSERT_EQ(2, records.size());
+  EXPECT_EQ(makeRename(), records[0]);
+  EXPECT_EQ(makeRead(), records[1]);
+}
@@ -7,29 +7,68 @@
 
 #include "eden/fs/inodes/treeoverlay/TreeOverlay.h"
 
+#include <folly/Exception.h>
 #include <folly/File.h>
+#include <folly/logging/xlog.h>
+#include <limits>
 #include "eden/fs/inodes/InodeNumber.h"
 #include "eden/fs/inodes/overlay/gen-cpp2/overlay_types.h"
 #include "eden/fs/inodes/treeoverlay/TreeOverlayWindowsFsck.h"
 #include "eden/fs/utils/Bug.h"
 
+#ifndef _WIN32
+#include "eden/fs/inodes/overlay/FsOverlay.h"
+#endif
+
 namespace facebook::eden {
 
 TreeOverlay::TreeOverlay(
     AbsolutePathPiece path,
     TreeOverlayStore::SynchronousMode mode)
-    : path_{path.copy()}, store_{path_, mode} {}
+    : path_{path.copy()}, store_{path_, mode} {
+#ifndef _WIN32
+  fs_ = std::make_unique<FsOverlay>(path_);
+#endif
+}
+
+TreeOverlay::TreeOverlay(std::unique_ptr<SqliteDatabase> store)
+    : store_(std::move(store)),
+      inlineFileLimit_{std::numeric_limits<size_t>::max()} {}
+
+TreeOverlay::~TreeOverlay() = default;
 
 std::optional<InodeNumber> TreeOverlay::initOverlay(bool createIfNonExisting) {
   if (createIfNonExisting) {
     store_.createTableIfNonExisting();
   }
+#ifndef _WIN32
+  if (fs_) {
+    // The directory of a TreeOverlay that never stored an overlay file has
+    // no FsOverlay yet. The next inode number is tracked by the database.
+    fs_->initOverlay(/*createIfNonExisting=*/true);
+  }
+#endif
   initialized_ = true;
   return store_.loadCounters();
 }
 
 void TreeOverlay::close(std::optional<InodeNumber> /*nextInodeNumber*/) {
   store_.close();
+#ifndef _WIN32
+  if (fs_) {
+    fs_->close(std::nullopt);
+  }
+#endif
+}
+
+void TreeOverlay::flush() {
+  store_.flush();
+}
+
+void TreeOverlay::enableWriteBatching(
+    size_t maxWrites,
+    std::chrono::milliseconds maxDelay) {
+  store_.enableWriteBatching(maxWrites, maxDelay);
 }
 
 const AbsolutePath& TreeOverlay::getLocalDir() const {
@@ -48,35 +87,88 @@ void TreeOverlay::saveOverlayDir(
 }
 
 #ifndef _WIN32
+namespace {
+[[noreturn]] void throwNoOverlayFile(InodeNumber inodeNumber) {
+  folly::throwSystemErrorExplicit(
+      ENOENT,
+      "the in-memory tree overlay has no overlay file for inode ",
+      inodeNumber);
+}
+} // namespace
+
 folly::File TreeOverlay::createOverlayFile(
-    InodeNumber /*inodeNumber*/,
-    folly::ByteRange /*contents*/) {
-  EDEN_BUG() << "UNIMPLEMENTED";
+    InodeNumber inodeNumber,
+    folly::ByteRange contents) {
+  if (!fs_) {
+    throwNoOverlayFile(inodeNumber);
+  }
+  auto file = fs_->createOverlayFile(inodeNumber, contents);
+  // Inline contents left from before the file was promoted or dematerialized
+  // would take precedence over the new overlay file.
+  store_.removeFile(inodeNumber);
+  return file;
 }
 
 folly::File TreeOverlay::createOverlayFile(
-    InodeNumber /*inodeNumber*/,
-    const folly::IOBuf& /*contents*/) {
-  EDEN_BUG() << "UNIMPLEMENTED";
+    InodeNumber inodeNumber,
+    const folly::IOBuf& contents) {
+  if (!fs_) {
+    throwNoOverlayFile(inodeNumber);
+  }
+  auto file = fs_->createOverlayFile(inodeNumber, contents);
+  store_.removeFile(inodeNumber);
+  return file;
 }
 
 folly::File TreeOverlay::openFile(
-    InodeNumber /*inodeNumber*/,
-    folly::StringPiece /*headerId*/) {
-  EDEN_BUG() << "UNIMPLEMENTED";
+    InodeNumber inodeNumber,
+    folly::StringPiece headerId) {
+  if (!fs_) {
+    throwNoOverlayFile(inodeNumber);
+  }
+  return fs_->openFile(inodeNumber, headerId);
 }
 
-folly::File TreeOverlay::openFileNoVerify(InodeNumber /*inodeNumber*/) {
-  EDEN_BUG() << "UNIMPLEMENTED";
+folly::File TreeOverlay::openFileNoVerify(InodeNumber inodeNumber) {
+  if (!fs_) {
+    throwNoOverlayFile(inodeNumber);
+  }
+  return fs_->openFileNoVerify(inodeNumber);
+}
+
+void TreeOverlay::saveInlineFile(
+    InodeNumber inodeNumber,
+    folly::ByteRange contents) {
+  XCHECK(inlineFileLimit_.has_value() && contents.size() <= *inlineFileLimit_)
+      << "a file of " << contents.size() << " bytes can't be stored inline";
+  store_.saveFile(inodeNumber, contents);
+}
+
+std::optional<std::string> TreeOverlay::loadInlineFile(
+    InodeNumber inodeNumber) {
+  return store_.loadFile(inodeNumber);
+}
+
+void TreeOverlay::removeInlineFile(InodeNumber inodeNumber) {
+  store_.removeFile(inodeNumber);
 }
 
 struct statfs TreeOverlay::statFs() const {
-  EDEN_BUG() << "UNIMPLEMENTED";
+  if (!fs_) {
+    return {};
+  }
+  return fs_->statFs();
 }
 #endif
 
 void TreeOverlay::removeOverlayData(InodeNumber inodeNumber) {
   store_.removeTree(inodeNumber);
+#ifndef _WIN32
+  store_.removeFile(inodeNumber);
+  if (fs_) {
+    fs_->removeOverlayData(inodeNumber);
+  }
+#endif
 }
 
 bool TreeOverlay::hasOverlayData(InodeNumber inodeNumber) {
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <folly/Range.h>
+#include <memory>
 #include <optional>
 
 #include "eden/fs/inodes/IOverlay.h"
@@ -24,6 +25,17 @@ class OverlayDir;
 }
 struct InodeNumber;
 
+class FsOverlay;
+
+/**
+ * TreeOverlay stores the overlay directories in a SQLite database.
+ *
+ * Outside of Windows, the contents of the files are stored by an FsOverlay in
+ * the same directory. Once enableInlineFiles() is called, the files up to the
+ * given size are stored in the database instead, which saves creating an
+ * overlay file for each of them. An in-memory TreeOverlay has no directory,
+ * so it stores all the files in its database.
+ */
 class TreeOverlay : public IOverlay {
  public:
   explicit TreeOverlay(
@@ -31,10 +43,9 @@ class TreeOverlay : public IOverlay {
       TreeOverlayStore::SynchronousMode mode =
           TreeOverlayStore::SynchronousMode::Normal);
 
-  explicit TreeOverlay(std::unique_ptr<SqliteDatabase> store)
-      : store_(std::move(store)) {}
+  explicit TreeOverlay(std::unique_ptr<SqliteDatabase> store);
 
-  ~TreeOverlay() override {}
+  ~TreeOverlay() override;
 
   TreeOverlay(const TreeOverlay&) = delete;
   TreeOverlay& operator=(const TreeOverlay&) = delete;
@@ -50,6 +61,22 @@ class TreeOverlay : public IOverlay {
 
   void close(std::optional<InodeNumber> nextInodeNumber) override;
 
+  void flush() override;
+
+  /**
+   * See TreeOverlayStore::enableWriteBatching().
+   */
+  void enableWriteBatching(
+      size_t maxWrites,
+      std::chrono::milliseconds maxDelay);
+
+  /**
+   * Store the contents of the files up to maxSize bytes in the database.
+   */
+  void enableInlineFiles(size_t maxSize) {
+    inlineFileLimit_ = maxSize;
+  }
+
   bool initialized() const override {
     return initialized_;
   }
@@ -76,6 +103,17 @@ class TreeOverlay : public IOverlay {
 
   folly::File openFileNoVerify(InodeNumber inodeNumber) override;
 
+  std::optional<size_t> getInlineFileLimit() const override {
+    return inlineFileLimit_;
+  }
+
+  void saveInlineFile(InodeNumber inodeNumber, folly::ByteRange contents)
+      override;
+
+  std::optional<std::string> loadInlineFile(InodeNumber inodeNumber) override;
+
+  void removeInlineFile(InodeNumber inodeNumber) override;
+
   struct statfs statFs() const override;
 #endif
 
@@ -110,6 +148,16 @@ class TreeOverlay : public IOverlay {
 
   TreeOverlayStore store_;
 
+#ifndef _WIN32
+  /**
+   * Stores the files that are not stored inline. Null for an in-memory
+   * TreeOverlay.
+   */
+  std::unique_ptr<FsOverlay> fs_;
+#endif
+
+  std::optional<size_t> inlineFileLimit_;
+
   bool initialized_ = false;
 };
 } // namespace facebook::eden
@@ -8,7 +8,11 @@
 #include "eden/fs/inodes/treeoverlay/TreeOverlayStore.h"
 
 #include <folly/Range.h>
+#include <folly/ScopeGuard.h>
+#include <folly/futures/SharedPromise.h>
+#include <folly/logging/xlog.h>
 #include <array>
+#include <optional>
 #include "eden/fs/inodes/InodeNumber.h"
 #include "eden/fs/inodes/overlay/gen-cpp2/overlay_types.h"
 #include "eden/fs/sqlite/PersistentSqliteStatement.h"
@@ -22,6 +26,7 @@ namespace {
 // SQLite table names
 constexpr folly::StringPiece kEntryTable = "entries";
 constexpr folly::StringPiece kMetadataTable = "metadata";
+constexpr folly::StringPiece kFileTable = "files";
 
 // Filename of the tree overlay database
 constexpr PathComponentPiece kTreeStorePath =
@@ -37,23 +42,41 @@ constexpr uint32_t kSchemaVersion = 1;
 // Maximum number of values when we do batch insertion
 constexpr size_t kBatchInsertSize = 8;
 
+// Number of connections loading trees concurrently, in addition to the one
+// used for writes.
+constexpr size_t kNumReadConnections = 8;
+
 } // namespace
 
-struct TreeOverlayStore::StatementCache {
-  explicit StatementCache(SqliteDatabase::Connection& db)
-      : deleteParent{db, "DELETE FROM ", kEntryTable, " WHERE parent = ?"},
-        selectTree{
+struct TreeOverlayStore::ReadStatementCache {
+  explicit ReadStatementCache(SqliteDatabase::Connection& db)
+      : selectTree{
             db,
             "SELECT name, dtype, inode, hash FROM ",
             kEntryTable,
             " WHERE parent = ? ORDER BY name"},
+        hasTree{db, "SELECT 1 FROM ", kEntryTable, " WHERE parent = ?"},
+        selectFile{
+            db,
+            "SELECT contents FROM ",
+            kFileTable,
+            " WHERE inode = ?"} {}
+
+  PersistentSqliteStatement selectTree;
+  PersistentSqliteStatement hasTree;
+  PersistentSqliteStatement selectFile;
+};
+
+struct TreeOverlayStore::StatementCache {
+  explicit StatementCache(SqliteDatabase::Connection& db)
+      : deleteParent{db, "DELETE FROM ", kEntryTable, " WHERE parent = ?"},
+        reads{db},
         countChildren{
             db,
             "SELECT COUNT(*) FROM ",
             kEntryTable,
             " WHERE parent = ?"},
         deleteTree{db, "DELETE FROM ", kEntryTable, " WHERE parent = ?"},
-        hasTree{db, "SELECT 1 FROM ", kEntryTable, " WHERE parent = ?"},
         insertChild{
             db,
             "INSERT INTO ",
@@ -77,6 +100,12 @@ struct TreeOverlayStore::StatementCache {
             "UPDATE ",
             kEntryTable,
             " SET parent = ?, name = ? WHERE parent = ? AND name = ?"},
+        insertFile{
+            db,
+            "INSERT OR REPLACE INTO ",
+            kFileTable,
+            " (inode, contents) VALUES (?, ?)"},
+        deleteFile{db, "DELETE FROM ", kFileTable, " WHERE inode = ?"},
         batchInsert{
             makeBatchInsert(db, 1),
             makeBatchInsert(db, 2),
@@ -86,7 +115,13 @@ struct TreeOverlayStore::StatementCache {
             makeBatchInsert(db, 6),
             makeBatchInsert(db, 7),
             makeBatchInsert(db, 8),
-        } {}
+        },
+        beginBatch{db, "BEGIN"},
+        commitBatch{db, "COMMIT"},
+        rollbackBatch{db, "ROLLBACK"},
+        beginWrite{db, "SAVEPOINT batched_write"},
+        releaseWrite{db, "RELEASE batched_write"},
+        rollbackWrite{db, "ROLLBACK TO batched_write"} {}
 
   PersistentSqliteStatement makeBatchInsert(
       SqliteDatabase::Connection& db,
@@ -108,15 +143,48 @@ struct TreeOverlayStore::StatementCache {
   }
 
   PersistentSqliteStatement deleteParent;
-  PersistentSqliteStatement selectTree;
+  ReadStatementCache reads;
   PersistentSqliteStatement countChildren;
   PersistentSqliteStatement deleteTree;
-  PersistentSqliteStatement hasTree;
   PersistentSqliteStatement insertChild;
   PersistentSqliteStatement deleteChild;
   PersistentSqliteStatement hasChild;
   PersistentSqliteStatement renameChild;
+  PersistentSqliteStatement insertFile;
+  PersistentSqliteStatement deleteFile;
   std::array<PersistentSqliteStatement, kBatchInsertSize> batchInsert;
+  PersistentSqliteStatement beginBatch;
+  PersistentSqliteStatement commitBatch;
+  PersistentSqliteStatement rollbackBatch;
+  PersistentSqliteStatement beginWrite;
+  PersistentSqliteStatement releaseWrite;
+  PersistentSqliteStatement rollbackWrite;
+};
+
+struct TreeOverlayStore::WriteBatch {
+  WriteBatch(size_t maxWrites, std::chrono::milliseconds maxDelay)
+      : maxWrites{maxWrites}, maxDelay{maxDelay} {}
+
+  const size_t maxWrites;
+  const std::chrono::milliseconds maxDelay;
+
+  // Number of mutations in the open transaction, protected by the database
+  // lock. A transaction is open if and only if this is non-zero.
+  size_t pendingWrites{0};
+
+  // Fulfilled once the open transaction has committed, or with the error that
+  // prevented it from committing. Protected by the database lock.
+  folly::SharedPromise<folly::Unit> committed;
+
+  // Protects the fields below, and is taken after the database lock.
+  std::mutex mutex;
+  // Signaled when a transaction is opened, and when stopping.
+  std::condition_variable condition;
+  // When the open transaction must be committed by the flush thread, unset
+  // when no transaction is open.
+  std::optional<std::chrono::steady_clock::time_point> deadline;
+  bool stop{false};
+  std::thread flushThread;
 };
 
 TreeOverlayStore::TreeOverlayStore(
@@ -136,6 +204,10 @@ TreeOverlayStore::TreeOverlayStore(
         << "Synchronous mode is off. Data loss may happen when system crashes.";
     SqliteStatement(dbLock, "PRAGMA synchronous=OFF").step();
   }
+  dbLock.unlock();
+
+  db_->openReadConnections(kNumReadConnections);
+  readCaches_.resize(kNumReadConnections);
 }
 
 TreeOverlayStore::TreeOverlayStore(std::unique_ptr<SqliteDatabase> db)
@@ -143,9 +215,17 @@ TreeOverlayStore::TreeOverlayStore(std::unique_ptr<SqliteDatabase> db)
 
 // We must define the destructor here because of incomplete definition of
 // `StatementCache`
-TreeOverlayStore::~TreeOverlayStore() = default;
+TreeOverlayStore::~TreeOverlayStore() {
+  try {
+    stopWriteBatching();
+  } catch (const std::exception& ex) {
+    XLOG(ERR) << "Failed to commit batched tree overlay writes: " << ex.what();
+  }
+}
 
 void TreeOverlayStore::close() {
+  stopWriteBatching();
+  readCaches_.clear();
   cache_.reset();
   if (db_) {
     db_->close();
@@ -153,10 +233,151 @@ void TreeOverlayStore::close() {
 }
 
 std::unique_ptr<SqliteDatabase> TreeOverlayStore::takeDatabase() {
+  stopWriteBatching();
+  readCaches_.clear();
   cache_.reset();
   return std::move(db_);
 }
 
+void TreeOverlayStore::enableWriteBatching(
+    size_t maxWrites,
+    std::chrono::milliseconds maxDelay) {
+  XCHECK(!writeBatch_) << "write batching is already enabled";
+  XCHECK_GT(maxWrites, 0u);
+  writeBatch_ = std::make_unique<WriteBatch>(maxWrites, maxDelay);
+  writeBatch_->flushThread = std::thread{[this] { flushThread(); }};
+}
+
+void TreeOverlayStore::flush() {
+  if (!writeBatch_) {
+    return;
+  }
+  auto conn = db_->lock();
+  commitBatch(conn);
+}
+
+void TreeOverlayStore::flushThread() {
+  auto lock = std::unique_lock{writeBatch_->mutex};
+  for (;;) {
+    if (writeBatch_->stop) {
+      return;
+    }
+    if (!writeBatch_->deadline) {
+      writeBatch_->condition.wait(lock);
+      continue;
+    }
+    if (std::chrono::steady_clock::now() < *writeBatch_->deadline) {
+      writeBatch_->condition.wait_until(lock, *writeBatch_->deadline);
+      continue;
+    }
+
+    // commitBatch() clears the deadline.
+    lock.unlock();
+    try {
+      flush();
+    } catch (const std::exception& ex) {
+      XLOG(ERR) << "Failed to commit batched tree overlay writes: "
+                << ex.what();
+    }
+    lock.lock();
+  }
+}
+
+void TreeOverlayStore::stopWriteBatching() {
+  if (!writeBatch_) {
+    return;
+  }
+
+  {
+    auto lock = std::unique_lock{writeBatch_->mutex};
+    writeBatch_->stop = true;
+  }
+  writeBatch_->condition.notify_one();
+  writeBatch_->flushThread.join();
+
+  // Commit what is left, after which the mutations go back to using their
+  // own transactions.
+  SCOPE_EXIT {
+    writeBatch_.reset();
+  };
+  if (db_) {
+    flush();
+  }
+}
+
+void TreeOverlayStore::writeTransaction(
+    const std::function<void(SqliteDatabase::Connection&)>& func) {
+  if (!writeBatch_) {
+    db_->transaction(func);
+    return;
+  }
+
+  folly::SemiFuture<folly::Unit> committed;
+  {
+    auto conn = db_->lock();
+    if (writeBatch_->pendingWrites == 0) {
+      cache_->beginBatch.get(conn).step();
+      writeBatch_->committed = folly::SharedPromise<folly::Unit>{};
+      {
+        auto lock = std::unique_lock{writeBatch_->mutex};
+        writeBatch_->deadline =
+            std::chrono::steady_clock::now() + writeBatch_->maxDelay;
+      }
+      writeBatch_->condition.notify_one();
+    }
+    ++writeBatch_->pendingWrites;
+
+    // A savepoint makes each mutation atomic on its own, so that a failing
+    // one is rolled back without losing the others in the batch.
+    cache_->beginWrite.get(conn).step();
+    try {
+      func(conn);
+    } catch (const std::exception& ex) {
+      cache_->rollbackWrite.get(conn).step();
+      cache_->releaseWrite.get(conn).step();
+      XLOG(WARN) << "SQLite transaction failed: " << ex.what();
+      throw;
+    }
+    cache_->releaseWrite.get(conn).step();
+
+    committed = writeBatch_->committed.getSemiFuture();
+    if (writeBatch_->pendingWrites >= writeBatch_->maxWrites) {
+      commitBatch(conn);
+      return;
+    }
+  }
+
+  // The mutation is only acknowledged once it is durable: a failed commit
+  // rolls back the whole batch, which throws here for each of its mutations.
+  std::move(committed).get();
+}
+
+void TreeOverlayStore::commitBatch(SqliteDatabase::Connection& conn) {
+  {
+    auto lock = std::unique_lock{writeBatch_->mutex};
+    writeBatch_->deadline.reset();
+  }
+  if (writeBatch_->pendingWrites == 0) {
+    return;
+  }
+
+  auto pendingWrites = std::exchange(writeBatch_->pendingWrites, 0);
+  try {
+    cache_->commitBatch.get(conn).step();
+  } catch (const std::exception& ex) {
+    XLOG(ERR) << "Failed to commit " << pendingWrites
+              << " tree overlay writes: " << ex.what();
+    writeBatch_->committed.setException(
+        folly::exception_wrapper{std::current_exception(), ex});
+    // SQLite may or may not have rolled back the transaction already.
+    if (!sqlite3_get_autocommit(*conn)) {
+      cache_->rollbackBatch.get(conn).step();
+    }
+    throw;
+  }
+  writeBatch_->committed.setValue();
+}
+
 void TreeOverlayStore::createTableIfNonExisting() {
   // TODO: check `user_version` and migrate schema if necessary
   db_->transaction([&](auto& txn) {
@@ -209,6 +430,17 @@ void TreeOverlayStore::createTableIfNonExisting() {
     mtime INTEGER NOT NULL,
     ctime INTEGER NOT NULL
 ) WITHOUT ROWID;
+  )")
+        .step();
+
+    // Contents of the small files stored inline rather than in overlay files.
+    // This table was added without changing the schema version, since older
+    // versions simply ignore it.
+    SqliteStatement(txn, "CREATE TABLE IF NOT EXISTS ", kFileTable, R"(
+  (
+    inode INTEGER PRIMARY KEY NOT NULL,
+    contents BLOB NOT NULL
+  )
   )")
         .step();
 
@@ -263,7 +495,7 @@ InodeNumber TreeOverlayStore::nextInodeNumber() {
 void TreeOverlayStore::saveTree(
     InodeNumber inodeNumber,
     const overlay::OverlayDir& odir) {
-  db_->transaction([&](auto& txn) {
+  writeTransaction([&](auto& txn) {
     // When `saveTree` gets called, caller is expected to rewrite the tree
     // content. So we need to remove the previously stored version.
     auto& stmt = cache_->deleteParent.get(txn);
@@ -311,11 +543,33 @@ void TreeOverlayStore::saveTree(
   });
 }
 
+void TreeOverlayStore::read(
+    const std::function<void(SqliteDatabase::Connection&, ReadStatementCache&)>&
+        func) {
+  // Batched writes are only visible to the connection that made them, so the
+  // read connections cannot be used while batching.
+  if (readCaches_.empty() || writeBatch_) {
+    auto conn = db_->lock();
+    func(conn, cache_->reads);
+    return;
+  }
+
+  auto reader = db_->lockForRead();
+  // Each slot is only accessed while holding the lock of its connection.
+  auto& readCache = readCaches_[reader.index];
+  if (!readCache) {
+    readCache = std::make_unique<ReadStatementCache>(reader.connection);
+  }
+  func(reader.connection, *readCache);
+}
+
 overlay::OverlayDir TreeOverlayStore::loadTree(InodeNumber inode) {
   overlay::OverlayDir dir;
 
-  db_->transaction([&](auto& txn) {
-    auto& query = cache_->selectTree.get(txn);
+  // A single query reads a consistent snapshot without an explicit
+  // transaction, which could not be started while a write batch is open.
+  read([&](auto& conn, auto& reads) {
+    auto& query = reads.selectTree.get(conn);
     query.bind(1, inode.get());
 
     while (query.step()) {
@@ -333,7 +587,7 @@ overlay::OverlayDir TreeOverlayStore::loadTree(InodeNumber inode) {
 }
 
 void TreeOverlayStore::removeTree(InodeNumber inode) {
-  db_->transaction([&](auto& txn) {
+  writeTransaction([&](auto& txn) {
     auto& children = cache_->countChildren.get(txn);
     children.bind(1, inode.get());
 
@@ -349,33 +603,38 @@ void TreeOverlayStore::removeTree(InodeNumber inode) {
 }
 
 bool TreeOverlayStore::hasTree(InodeNumber inode) {
-  auto db = db_->lock();
-  auto& query = cache_->hasTree.get(db);
-  query.bind(1, inode.get());
-  if (query.step()) {
-    return query.columnUint64(0) == 1;
-  }
-  return false;
+  bool found = false;
+  read([&](auto& conn, auto& reads) {
+    auto& query = reads.hasTree.get(conn);
+    query.bind(1, inode.get());
+    found = query.step() && query.columnUint64(0) == 1;
+    // An unfinished statement would keep its connection reading the current
+    // snapshot of the database, hiding later writes.
+    query.reset();
+  });
+  return found;
 }
 
 void TreeOverlayStore::addChild(
     InodeNumber parent,
     PathComponentPiece name,
     overlay::OverlayEntry entry) {
-  auto db = db_->lock();
-  auto& stmt = cache_->insertChild.get(db);
-  insertInodeEntry(stmt, 0, parent, name, entry);
-  stmt.step();
+  writeTransaction([&](auto& txn) {
+    auto& stmt = cache_->insertChild.get(txn);
+    insertInodeEntry(stmt, 0, parent, name, entry);
+    stmt.step();
+  });
 }
 
 void TreeOverlayStore::removeChild(
     InodeNumber parent,
     PathComponentPiece childName) {
-  auto db = db_->lock();
-  auto& stmt = cache_->deleteChild.get(db);
-  stmt.bind(1, parent.get());
-  stmt.bind(2, childName.stringPiece());
-  stmt.step();
+  writeTransaction([&](auto& txn) {
+    auto& stmt = cache_->deleteChild.get(txn);
+    stmt.bind(1, parent.get());
+    stmt.bind(2, childName.stringPiece());
+    stmt.step();
+  });
 }
 
 void TreeOverlayStore::renameChild(
@@ -385,7 +644,7 @@ void TreeOverlayStore::renameChild(
     PathComponentPiece dstName) {
   // When rename also overwrites some file in the destination, we need to make
   // sure this is transactional.
-  db_->transaction([&](auto& txn) {
+  writeTransaction([&](auto& txn) {
     auto& overwriteEmpty = cache_->hasChild.get(txn);
     overwriteEmpty.bind(1, dst.get());
     overwriteEmpty.bind(2, dstName.stringPiece());
@@ -409,6 +668,43 @@ void TreeOverlayStore::renameChild(
   });
 }
 
+void TreeOverlayStore::saveFile(
+    InodeNumber inode,
+    folly::ByteRange contents) {
+  writeTransaction([&](auto& txn) {
+    auto& stmt = cache_->insertFile.get(txn);
+    stmt.bind(1, inode.get());
+    // SQLite binds a null pointer as NULL rather than as an empty blob.
+    if (contents.empty()) {
+      stmt.bind(2, folly::StringPiece{""});
+    } else {
+      stmt.bind(2, contents);
+    }
+    stmt.step();
+  });
+}
+
+std::optional<std::string> TreeOverlayStore::loadFile(InodeNumber inode) {
+  std::optional<std::string> contents;
+  read([&](auto& conn, auto& reads) {
+    auto& query = reads.selectFile.get(conn);
+    query.bind(1, inode.get());
+    if (query.step()) {
+      contents = query.columnBlob(0).str();
+    }
+    query.reset();
+  });
+  return contents;
+}
+
+void TreeOverlayStore::removeFile(InodeNumber inode) {
+  writeTransaction([&](auto& txn) {
+    auto& stmt = cache_->deleteFile.get(txn);
+    stmt.bind(1, inode.get());
+    stmt.step();
+  });
+}
+
 void TreeOverlayStore::insertInodeEntry(
     SqliteStatement& inserts,
     size_t index,
@@ -9,7 +9,15 @@
 
 #include <gtest/gtest_prod.h>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <fmt/format.h>
 #include "eden/fs/sqlite/SqliteDatabase.h"
@@ -66,6 +74,27 @@ class TreeOverlayStore {
 
   void close();
 
+  /**
+   * Group concurrent mutations into shared transactions instead of committing
+   * each one separately. A transaction is committed once it holds `maxWrites`
+   * mutations, or by a background thread `maxDelay` after it was opened.
+   *
+   * A mutation only returns once the transaction holding it has committed,
+   * and throws if that commit failed, so it may wait for up to `maxDelay`.
+   * Loads of this store see the mutations before they are committed.
+   *
+   * This must be called before the store is used from multiple threads.
+   */
+  void enableWriteBatching(
+      size_t maxWrites,
+      std::chrono::milliseconds maxDelay);
+
+  /**
+   * Commit the mutations batched since the last commit. This is a no-op when
+   * write batching is not enabled.
+   */
+  void flush();
+
   /**
    * Create table and indexes if they are not already created. This function
    * will throw if it fails.
@@ -129,12 +158,56 @@ class TreeOverlayStore {
       PathComponentPiece srcName,
       PathComponentPiece dstName);
 
+  /**
+   * Store the contents of a file inline in the database, replacing any
+   * previously stored contents. This is meant for files small enough that
+   * a separate overlay file would cost more than the contents themselves.
+   */
+  void saveFile(InodeNumber inode, folly::ByteRange contents);
+
+  /**
+   * Load the contents stored by saveFile(), or std::nullopt if the file is
+   * not stored inline.
+   */
+  std::optional<std::string> loadFile(InodeNumber inode);
+
+  /**
+   * Delete the inline contents of a file, if there are any.
+   */
+  void removeFile(InodeNumber inode);
+
   std::unique_ptr<SqliteDatabase> takeDatabase();
 
  private:
   FRIEND_TEST(TreeOverlayStoreTest, testRecoverInodeEntryNumber);
 
   struct StatementCache;
+  struct ReadStatementCache;
+  struct WriteBatch;
+
+  /**
+   * Run the read-only `func` on one of the read connections, or on the
+   * connection used for writes if there are none or while batching writes.
+   */
+  void read(const std::function<
+            void(SqliteDatabase::Connection&, ReadStatementCache&)>& func);
+
+  /**
+   * Run `func` as one atomic mutation: in its own transaction, or as part of
+   * the current batch when write batching is enabled.
+   */
+  void writeTransaction(
+      const std::function<void(SqliteDatabase::Connection&)>& func);
+
+  /**
+   * Commit the current batch, if there is one, and wake up the mutations
+   * waiting for it. The caller must be holding the database lock.
+   */
+  void commitBatch(SqliteDatabase::Connection& conn);
+
+  void flushThread();
+
+  void stopWriteBatching();
 
   /**
    * Private helper function to add a SQLite statement that inserts a row to the
@@ -151,6 +224,11 @@ class TreeOverlayStore {
 
   std::unique_ptr<StatementCache> cache_;
 
+  // Statements of each read connection of `db_`, prepared on first use.
+  std::vector<std::unique_ptr<ReadStatementCache>> readCaches_;
+
+  std::unique_ptr<WriteBatch> writeBatch_;
+
   std::atomic_uint64_t nextEntryId_{0};
 
   std::atomic_uint64_t nextInode_{0};
@@ -9,8 +9,12 @@
 
 #include <folly/logging/xlog.h>
 #include <folly/portability/GTest.h>
+#include <folly/testing/TestUtil.h>
+#include <atomic>
 #include <memory>
 #include <optional>
+#include <thread>
+#include <vector>
 #include "eden/fs/inodes/InodeNumber.h"
 #include "eden/fs/inodes/overlay/gen-cpp2/overlay_types.h"
 #include "eden/fs/model/Hash.h"
@@ -272,4 +276,125 @@ TEST_F(TreeOverlayStoreTest, testRenameChild) {
     expect_entry(it->second, entry);
   }
 }
+
+TEST_F(TreeOverlayStoreTest, testSaveLoadRemoveFile) {
+  auto inode = InodeNumber{overlay_->nextInodeNumber()};
+  EXPECT_EQ(overlay_->loadFile(inode), std::nullopt);
+
+  overlay_->saveFile(inode, folly::ByteRange{folly::StringPiece{"hello"}});
+  EXPECT_EQ(overlay_->loadFile(inode), "hello");
+
+  overlay_->saveFile(inode, folly::ByteRange{});
+  EXPECT_EQ(overlay_->loadFile(inode), "");
+
+  overlay_->removeFile(inode);
+  EXPECT_EQ(overlay_->loadFile(inode), std::nullopt);
+}
+
+TEST_F(TreeOverlayStoreTest, testBatchedWritesAreVisibleAndCommitted) {
+  // Each mutation waits for the flush thread to commit its batch.
+  overlay_->enableWriteBatching(1000, std::chrono::milliseconds{1});
+
+  auto inode = InodeNumber{overlay_->nextInodeNumber()};
+  overlay::OverlayDir dir;
+  dir.entries_ref()->emplace(std::make_pair("hello", makeEntry()));
+  overlay_->saveTree(inode, dir);
+  overlay_->addChild(inode, "world"_pc, makeEntry());
+  EXPECT_TRUE(overlay_->hasTree(inode));
+  EXPECT_EQ(overlay_->loadTree(inode).entries_ref()->size(), 2);
+
+  // A failing mutation must not roll back the rest of the batch.
+  EXPECT_THROW(overlay_->removeTree(inode), TreeOverlayNonEmptyError);
+  overlay_->removeChild(inode, "hello"_pc);
+
+  auto db = overlay_->takeDatabase();
+  overlay_.reset();
+
+  TreeOverlayStore newOverlay{std::move(db)};
+  newOverlay.createTableIfNonExisting();
+  auto loaded = newOverlay.loadTree(inode);
+  auto entries = loaded.entries_ref();
+  EXPECT_EQ(entries->size(), 1);
+  EXPECT_EQ(entries->begin()->first, "world");
+}
+
+TEST(TreeOverlayStoreBatchTest, mutationsReturnOnceTheirBatchIsCommitted) {
+  folly::test::TemporaryDirectory tempDir;
+  auto path = AbsolutePath{tempDir.path().string()};
+  TreeOverlayStore writer{path};
+  writer.createTableIfNonExisting();
+  writer.loadCounters();
+  // A second connection only sees the committed transactions.
+  TreeOverlayStore reader{path};
+  reader.createTableIfNonExisting();
+
+  // Only a full batch is committed, the flush thread never gets to it.
+  writer.enableWriteBatching(2, std::chrono::hours{1});
+  auto inode = writer.nextInodeNumber();
+  overlay::OverlayEntry entry;
+  entry.mode_ref() = dtype_to_mode(dtype_t::Regular);
+  entry.inodeNumber_ref() = writer.nextInodeNumber().get();
+
+  // Whichever of these comes second commits the batch, and both wait for it.
+  std::thread saver{[&] { writer.saveTree(inode, overlay::OverlayDir{}); }};
+  writer.addChild(inode, "hello"_pc, entry);
+  saver.join();
+  EXPECT_EQ(reader.loadTree(inode).entries_ref()->size(), 1);
+}
+
+TEST(TreeOverlayStoreBatchTest, flushThreadCommitsAfterTheDelay) {
+  folly::test::TemporaryDirectory tempDir;
+  auto path = AbsolutePath{tempDir.path().string()};
+  TreeOverlayStore writer{path};
+  writer.createTableIfNonExisting();
+  writer.loadCounters();
+  TreeOverlayStore reader{path};
+  reader.createTableIfNonExisting();
+
+  writer.enableWriteBatching(1000, std::chrono::milliseconds{1});
+  auto inode = writer.nextInodeNumber();
+  writer.saveTree(inode, overlay::OverlayDir{});
+  overlay::OverlayEntry entry;
+  entry.mode_ref() = dtype_to_mode(dtype_t::Regular);
+  entry.inodeNumber_ref() = writer.nextInodeNumber().get();
+  writer.addChild(inode, "hello"_pc, entry);
+  EXPECT_EQ(reader.loadTree(inode).entries_ref()->size(), 1);
+}
+
+TEST(TreeOverlayStoreReadTest, concurrentLoadsSeeCommittedWrites) {
+  folly::test::TemporaryDirectory tempDir;
+  TreeOverlayStore overlay{AbsolutePath{tempDir.path().string()}};
+  overlay.createTableIfNonExisting();
+  overlay.loadCounters();
+
+  auto inode = overlay.nextInodeNumber();
+  overlay.saveTree(inode, overlay::OverlayDir{});
+
+  std::vector<std::thread> threads;
+  std::atomic<bool> sawEntry{false};
+  for (size_t i = 0; i < 16; ++i) {
+    threads.emplace_back([&] {
+      for (size_t n = 0; n < 100; ++n) {
+        auto hadEntry = sawEntry.load();
+        auto size = overlay.loadTree(inode).entries_ref()->size();
+        // Once a load observed the write, later loads must observe it too.
+        EXPECT_TRUE(size == 1 || !hadEntry);
+        if (size == 1) {
+          sawEntry = true;
+        }
+      }
+    });
+  }
+  overlay::OverlayEntry entry;
+  entry.mode_ref() = dtype_to_mode(dtype_t::Regular);
+  entry.inodeNumber_ref() = overlay.nextInodeNumber().get();
+  overlay.addChild(inode, "hello"_pc, entry);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // Every read issued after a write has returned must observe it.
+  EXPECT_TRUE(overlay.hasTree(inode));
+  EXPECT_EQ(overlay.loadTree(inode).entries_ref()->size(), 1);
+}
 } // namespace facebook::eden
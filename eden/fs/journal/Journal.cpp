@@ -6,6 +6,9 @@
  */
 
 #include "Journal.h"
+#include <folly/ExceptionString.h>
+#include <folly/container/F14Map.h>
+#include <folly/futures/Future.h>
 #include <folly/logging/xlog.h>
 #include "eden/fs/journal/JournalDelta.h"
 
@@ -88,7 +91,7 @@ bool Journal::DeltaState::isFileChangeInBack() const {
   return !isFileChangeEmpty && isHashUpdateEmpty;
 }
 
-void Journal::DeltaState::appendDelta(FileChangeJournalDelta&& delta) {
+void Journal::DeltaState::appendDelta(InternedFileChangeJournalDelta&& delta) {
   fileChangeDeltas.emplace_back(std::move(delta));
 }
 
@@ -166,7 +169,9 @@ void Journal::truncateIfNecessary(DeltaState& deltaState) {
   }
 }
 
-bool Journal::compact(FileChangeJournalDelta& delta, DeltaState& deltaState) {
+bool Journal::compact(
+    InternedFileChangeJournalDelta& delta,
+    DeltaState& deltaState) {
   auto back = deltaState.backPtr().getAsFileChangeJournalDelta();
   if (back && delta.isModification() && delta.isSameAction(*back)) {
     deltaState.stats->latestTimestamp = delta.time;
@@ -185,10 +190,61 @@ bool Journal::compact(
 }
 
 template <typename T>
-bool Journal::addDeltaBeforeNotifying(T&& delta, DeltaState& deltaState) {
+void Journal::linkDelta(T&& delta, DeltaState& deltaState) {
   delta.sequenceID = deltaState.nextSequence++;
-  delta.time = std::chrono::steady_clock::now();
 
+  logDelta(delta, deltaState);
+  if constexpr (std::is_same_v<std::decay_t<T>, FileChangeJournalDelta>) {
+    insertDelta(
+        InternedFileChangeJournalDelta{delta, deltaState.pathTable},
+        deltaState);
+  } else {
+    insertDelta(std::forward<T>(delta), deltaState);
+  }
+  if (deltaState.log && deltaState.log->needsRewrite()) {
+    rewriteLog(deltaState);
+  }
+}
+
+bool Journal::markModified() {
+  auto staged = stagedDeltas_.lock();
+  return std::exchange(staged->lastModificationHasBeenObserved, false);
+}
+
+Journal::DeltaStateLock Journal::lockDeltaState(bool observe) {
+  auto deltaState = deltaState_.lock();
+  std::vector<FileChangeJournalDelta> deltas;
+  {
+    auto staged = stagedDeltas_.lock();
+    deltas.swap(staged->deltas);
+    if (observe) {
+      staged->lastModificationHasBeenObserved = true;
+    }
+  }
+  for (auto& delta : deltas) {
+    linkDelta(std::move(delta), *deltaState);
+  }
+  return DeltaStateLock{std::move(deltaState)};
+}
+
+Journal::DeltaStateLock::~DeltaStateLock() {
+  if (!lock_) {
+    return;
+  }
+  // The log does its own locking, so that writing it doesn't block the
+  // other users of the journal.
+  auto rewrite = std::exchange(lock_->logRewrite, std::nullopt);
+  auto log = lock_->log;
+  lock_.unlock();
+  if (rewrite) {
+    rewrite->log->finishRewrite(rewrite->id, std::move(rewrite->writer));
+  } else if (log && log->needsFlush()) {
+    log->flush();
+  }
+}
+
+template <typename T>
+void Journal::insertDelta(T&& delta, DeltaState& deltaState) {
   truncateIfNecessary(deltaState);
 
   // We will compact the delta if possible. We can compact the delta if it is
@@ -216,10 +272,69 @@ bool Journal::addDeltaBeforeNotifying(T&& delta, DeltaState& deltaState) {
   }
 
   deltaState.stats->earliestTimestamp = deltaState.frontPtr()->time;
+}
 
-  bool shouldNotify = deltaState.lastModificationHasBeenObserved;
-  deltaState.lastModificationHasBeenObserved = false;
-  return shouldNotify;
+void Journal::logDelta(
+    const FileChangeJournalDelta& delta,
+    DeltaState& deltaState) {
+  if (!deltaState.log) {
+    return;
+  }
+  try {
+    deltaState.log->append(delta);
+  } catch (const std::exception& ex) {
+    discardLog(deltaState, ex);
+  }
+}
+
+void Journal::logDelta(
+    const RootUpdateJournalDelta& delta,
+    DeltaState& deltaState) {
+  if (!deltaState.log) {
+    return;
+  }
+  try {
+    deltaState.log->append(delta, deltaState.currentHash);
+  } catch (const std::exception& ex) {
+    discardLog(deltaState, ex);
+  }
+}
+
+void Journal::rewriteLog(DeltaState& deltaState) {
+  JournalLog::Writer writer{deltaState.mountGeneration};
+  // Only the latest root is remembered: each root update delta updated to
+  // the root the next one updated from.
+  auto fileChangeIt = deltaState.fileChangeDeltas.begin();
+  auto hashUpdateIt = deltaState.hashUpdateDeltas.begin();
+  auto fileChangeEnd = deltaState.fileChangeDeltas.end();
+  auto hashUpdateEnd = deltaState.hashUpdateDeltas.end();
+  while (fileChangeIt != fileChangeEnd || hashUpdateIt != hashUpdateEnd) {
+    bool isFileChange = hashUpdateIt == hashUpdateEnd ||
+        (fileChangeIt != fileChangeEnd &&
+         fileChangeIt->sequenceID < hashUpdateIt->sequenceID);
+    if (isFileChange) {
+      writer.add(fileChangeIt->toFileChangeJournalDelta());
+      ++fileChangeIt;
+    } else {
+      auto next = std::next(hashUpdateIt);
+      writer.add(
+          *hashUpdateIt,
+          next == hashUpdateEnd ? deltaState.currentHash : next->fromHash);
+      hashUpdateIt = next;
+    }
+  }
+
+  auto id = deltaState.log->beginRewrite();
+  deltaState.logRewrite = DeltaState::LogRewrite{
+      deltaState.log, id, std::move(writer)};
+}
+
+void Journal::discardLog(DeltaState& deltaState, const std::exception& ex) {
+  XLOG(ERR) << "no longer persisting the journal to "
+            << deltaState.log->getPath() << ": " << folly::exceptionStr(ex);
+  deltaState.log->discard();
+  deltaState.log.reset();
+  deltaState.logRewrite.reset();
 }
 
 void Journal::notifySubscribers() const {
@@ -231,9 +346,19 @@ void Journal::notifySubscribers() const {
 
 void Journal::addDelta(FileChangeJournalDelta&& delta) {
   bool shouldNotify;
+  bool shouldMerge;
   {
-    auto deltaState = deltaState_.lock();
-    shouldNotify = addDeltaBeforeNotifying(std::move(delta), *deltaState);
+    auto staged = stagedDeltas_.lock();
+    delta.time = std::chrono::steady_clock::now();
+    staged->deltas.push_back(std::move(delta));
+    shouldMerge = staged->deltas.size() >= kMaxStagedDeltas;
+    shouldNotify =
+        std::exchange(staged->lastModificationHasBeenObserved, false);
+  }
+  if (shouldMerge) {
+    // Bound the memory held by deltas that aren't subject to the journal
+    // memory limit yet.
+    lockDeltaState();
   }
   if (shouldNotify) {
     notifySubscribers();
@@ -243,15 +368,18 @@ void Journal::addDelta(FileChangeJournalDelta&& delta) {
 void Journal::addDelta(RootUpdateJournalDelta&& delta, RootId newRootId) {
   bool shouldNotify;
   {
-    auto deltaState = deltaState_.lock();
+    auto deltaState = lockDeltaState();
 
     // If the hashes were not set to anything, default to copying
     // the value from the prior journal entry
     if (delta.fromHash == RootId{}) {
       delta.fromHash = deltaState->currentHash;
     }
-    shouldNotify = addDeltaBeforeNotifying(std::move(delta), *deltaState);
+    // Set before adding the delta, for it to be logged with its new root.
     deltaState->currentHash = std::move(newRootId);
+    delta.time = std::chrono::steady_clock::now();
+    linkDelta(std::move(delta), *deltaState);
+    shouldNotify = markModified();
   }
   if (shouldNotify) {
     notifySubscribers();
@@ -259,13 +387,12 @@ void Journal::addDelta(RootUpdateJournalDelta&& delta, RootId newRootId) {
 }
 
 std::optional<JournalDeltaInfo> Journal::getLatest() {
-  auto deltaState = deltaState_.lock();
-  deltaState->lastModificationHasBeenObserved = true;
+  auto deltaState = lockDeltaState(/*observe=*/true);
   if (deltaState->empty()) {
     return std::nullopt;
   } else {
     if (deltaState->isFileChangeInBack()) {
-      const FileChangeJournalDelta& back = deltaState->fileChangeDeltas.back();
+      const auto& back = deltaState->fileChangeDeltas.back();
       return JournalDeltaInfo{
           deltaState->currentHash,
           deltaState->currentHash,
@@ -286,6 +413,103 @@ uint64_t Journal::registerSubscriber(SubscriberCallback&& callback) {
   return id;
 }
 
+namespace {
+/**
+ * The subscriber registered by registerThrottledSubscriber(). The journal
+ * holds the only strong reference to it, so that the pending notifications
+ * are dropped once it is cancelled.
+ */
+struct ThrottledSubscriber {
+  ThrottledSubscriber(
+      Journal::SubscriberCallback callback,
+      folly::Executor::KeepAlive<> executor,
+      std::chrono::steady_clock::duration minInterval)
+      : callback{std::move(callback)},
+        executor{std::move(executor)},
+        minInterval{minInterval} {}
+
+  Journal::SubscriberCallback callback;
+  folly::Executor::KeepAlive<> executor;
+  std::chrono::steady_clock::duration minInterval;
+
+  struct State {
+    // Whether a notification is scheduled or running.
+    bool scheduled = false;
+    // Whether the journal changed since the scheduled notification started.
+    bool dirty = false;
+    std::chrono::steady_clock::time_point lastNotified;
+  };
+  folly::Synchronized<State, std::mutex> state;
+};
+
+void scheduleNotification(
+    std::weak_ptr<ThrottledSubscriber> weakSubscriber,
+    ThrottledSubscriber& subscriber,
+    std::chrono::steady_clock::duration delay);
+
+void runNotification(const std::weak_ptr<ThrottledSubscriber>& weak) {
+  auto subscriber = weak.lock();
+  if (!subscriber) {
+    return;
+  }
+  {
+    auto state = subscriber->state.lock();
+    state->dirty = false;
+    state->lastNotified = std::chrono::steady_clock::now();
+  }
+
+  subscriber->callback();
+
+  auto state = subscriber->state.lock();
+  if (state->dirty) {
+    state.unlock();
+    scheduleNotification(weak, *subscriber, subscriber->minInterval);
+  } else {
+    state->scheduled = false;
+  }
+}
+
+void scheduleNotification(
+    std::weak_ptr<ThrottledSubscriber> weakSubscriber,
+    ThrottledSubscriber& subscriber,
+    std::chrono::steady_clock::duration delay) {
+  if (delay <= std::chrono::steady_clock::duration::zero()) {
+    subscriber.executor->add(
+        [weakSubscriber = std::move(weakSubscriber)] {
+          runNotification(weakSubscriber);
+        });
+    return;
+  }
+  folly::futures::sleep(
+      std::chrono::duration_cast<folly::HighResDuration>(delay))
+      .via(subscriber.executor)
+      .thenValue([weakSubscriber = std::move(weakSubscriber)](auto&&) {
+        runNotification(weakSubscriber);
+      });
+}
+} // namespace
+
+uint64_t Journal::registerThrottledSubscriber(
+    SubscriberCallback&& callback,
+    folly::Executor::KeepAlive<> executor,
+    std::chrono::steady_clock::duration minInterval) {
+  auto subscriber = std::make_shared<ThrottledSubscriber>(
+      std::move(callback), std::move(executor), minInterval);
+  return registerSubscriber([subscriber] {
+    auto state = subscriber->state.lock();
+    if (state->scheduled) {
+      state->dirty = true;
+      return;
+    }
+    state->scheduled = true;
+    auto delay =
+        state->lastNotified + subscriber->minInterval -
+        std::chrono::steady_clock::now();
+    state.unlock();
+    scheduleNotification(subscriber, *subscriber, delay);
+  });
+}
+
 void Journal::cancelSubscriber(uint64_t id) {
   auto subscriberState = subscriberState_.wlock();
   auto it = subscriberState->subscribers.find(id);
@@ -316,7 +540,7 @@ bool Journal::isSubscriberValid(uint64_t id) const {
 }
 
 std::optional<JournalStats> Journal::getStats() {
-  return deltaState_.lock()->stats;
+  return lockDeltaState()->stats;
 }
 
 namespace {
@@ -343,8 +567,8 @@ size_t Journal::getMemoryLimit() const {
   return deltaState->memoryLimit;
 }
 
-size_t Journal::estimateMemoryUsage() const {
-  return estimateMemoryUsage(*deltaState_.lock());
+size_t Journal::estimateMemoryUsage() {
+  return estimateMemoryUsage(*lockDeltaState());
 }
 
 template <typename T>
@@ -366,13 +590,14 @@ size_t Journal::estimateMemoryUsage(const DeltaState& deltaState) const {
   if (deltaState.stats) {
     memoryUsage += deltaState.deltaMemoryUsage;
   }
+  memoryUsage += deltaState.pathTable.estimateMemoryUsage();
   return memoryUsage;
 }
 
 void Journal::flush() {
   bool shouldNotify;
   {
-    auto deltaState = deltaState_.lock();
+    auto deltaState = lockDeltaState();
     ++deltaState->nextSequence;
     auto lastHash = deltaState->currentHash;
     deltaState->fileChangeDeltas.clear();
@@ -387,31 +612,121 @@ void Journal::flush() {
      * flush operation.
      */
     delta.fromHash = lastHash;
-    shouldNotify = addDeltaBeforeNotifying(std::move(delta), *deltaState);
+    delta.time = std::chrono::steady_clock::now();
+    linkDelta(std::move(delta), *deltaState);
+    shouldNotify = markModified();
+    if (deltaState->log) {
+      rewriteLog(*deltaState);
+    }
   }
   if (shouldNotify) {
     notifySubscribers();
   }
 }
 
+void Journal::attachLog(std::unique_ptr<JournalLog> log) {
+  auto contents = log->load();
+
+  auto deltaState = lockDeltaState();
+  XCHECK(deltaState->empty() && !deltaState->log && !deltaState->pendingLog)
+      << "the log must be attached to an empty journal";
+  if (contents) {
+    for (auto& record : contents->records) {
+      if (auto* fileChange = std::get_if<FileChangeJournalDelta>(&record)) {
+        deltaState->nextSequence = fileChange->sequenceID + 1;
+        insertDelta(
+            InternedFileChangeJournalDelta{*fileChange, deltaState->pathTable},
+            *deltaState);
+      } else {
+        auto& rootUpdate = std::get<JournalLog::RootUpdate>(record);
+        deltaState->nextSequence = rootUpdate.delta.sequenceID + 1;
+        deltaState->currentHash = std::move(rootUpdate.toHash);
+        insertDelta(std::move(rootUpdate.delta), *deltaState);
+      }
+    }
+    deltaState->restoredMountGeneration = contents->mountGeneration;
+    XLOG(DBG1) << "restored " << contents->records.size()
+               << " journal deltas from " << log->getPath();
+  }
+  deltaState->pendingLog = std::move(log);
+}
+
+std::optional<uint64_t> Journal::getRestoredMountGeneration() const {
+  return deltaState_.lock()->restoredMountGeneration;
+}
+
+void Journal::setMountGeneration(uint64_t mountGeneration) {
+  auto deltaState = lockDeltaState();
+  deltaState->mountGeneration = mountGeneration;
+  if (deltaState->pendingLog) {
+    deltaState->log = std::move(deltaState->pendingLog);
+    // Also marks the log as not closed cleanly until closeLog().
+    rewriteLog(*deltaState);
+  }
+}
+
+void Journal::closeLog() {
+  auto deltaState = lockDeltaState();
+  if (auto rewrite = std::exchange(deltaState->logRewrite, std::nullopt)) {
+    // close() waits for the rewrites in progress, so this one can't wait for
+    // the lock to be released.
+    rewrite->log->finishRewrite(rewrite->id, std::move(rewrite->writer));
+  }
+  if (deltaState->log) {
+    deltaState->log->close();
+    deltaState->log.reset();
+  }
+  deltaState->pendingLog.reset();
+}
+
+namespace {
+/**
+ * Whether path is root or under it. Cheaper than RelativePathPiece's
+ * isParentDirOf(), as it runs for every path in the accumulated range.
+ */
+bool isInScope(RelativePathPiece path, RelativePathPiece root) {
+  if (root.empty()) {
+    return true;
+  }
+  auto pathStr = path.stringPiece();
+  auto rootStr = root.stringPiece();
+  return pathStr.startsWith(rootStr) &&
+      (pathStr.size() == rootStr.size() ||
+       pathStr[rootStr.size()] == kDirSeparator);
+}
+} // namespace
+
 std::unique_ptr<JournalDeltaRange> Journal::accumulateRange(
-    SequenceNumber from) {
+    SequenceNumber from,
+    RelativePathPiece root) {
   XDCHECK(from > 0);
   std::unique_ptr<JournalDeltaRange> result = nullptr;
 
   size_t filesAccumulated = 0;
-  auto deltaState = deltaState_.lock();
+  auto deltaState = lockDeltaState(/*observe=*/true);
   // If this is going to be truncated, handle it before iterating.
   if (!deltaState->empty() && deltaState->getFrontSequenceID() > from) {
     result = std::make_unique<JournalDeltaRange>();
     result->isTruncated = true;
   } else {
+    // The changes are merged by interned path, and only turned into paths
+    // once all the deltas are accumulated. When a root is given, only its
+    // node and the nodes under it are in scope; a root that was never
+    // interned has no change under it.
+    const JournalPathTable::Node* rootNode = nullptr;
+    bool rootIsInterned = true;
+    if (!root.empty()) {
+      rootNode = deltaState->pathTable.find(root);
+      rootIsInterned = rootNode != nullptr;
+    }
+    folly::F14FastMap<const JournalPathTable::Node*, PathChangeInfo>
+        changedNodes;
+
     forEachDelta(
         *deltaState,
         from,
         std::nullopt,
-        [&](const FileChangeJournalDelta& current) -> void {
-          ++filesAccumulated;
+        [&](const InternedFileChangeJournalDelta& current) -> void {
           if (!result) {
             result = std::make_unique<JournalDeltaRange>();
             result->toSequence = current.sequenceID;
@@ -422,23 +737,37 @@ std::unique_ptr<JournalDeltaRange> Journal::accumulateRange(
           result->fromSequence = current.sequenceID;
           result->fromTime = current.time;
 
-          for (auto& entry : current.getChangedFilesInOverlay()) {
-            auto& name = entry.first;
-            auto& currentInfo = entry.second;
-            auto* resultInfo =
-                folly::get_ptr(result->changedFilesInOverlay, name);
-            if (!resultInfo) {
-              result->changedFilesInOverlay.emplace(name, currentInfo);
-            } else {
-              if (resultInfo->existedBefore != currentInfo.existedAfter) {
+          bool accumulated = false;
+          auto mergeChange = [&](const JournalPathTable::Ref& name,
+                                 const PathChangeInfo& currentInfo) {
+            if (!rootIsInterned ||
+                !JournalPathTable::isSameOrUnder(name.get(), rootNode)) {
+              return;
+            }
+            accumulated = true;
+            auto [resultInfo, inserted] =
+                changedNodes.try_emplace(name.get(), currentInfo);
+            if (!inserted) {
+              if (resultInfo->second.existedBefore !=
+                  currentInfo.existedAfter) {
                 auto event1 = eventCharacterizationFor(currentInfo);
-                auto event2 = eventCharacterizationFor(*resultInfo);
-                XLOG(ERR) << "Journal for " << name << " holds invalid "
-                          << event1 << ", " << event2 << " sequence";
+                auto event2 = eventCharacterizationFor(resultInfo->second);
+                XLOG(ERR) << "Journal for " << name.toPath()
+                          << " holds invalid " << event1 << ", " << event2
+                          << " sequence";
               }
 
-              resultInfo->existedBefore = currentInfo.existedBefore;
+              resultInfo->second.existedBefore = currentInfo.existedBefore;
             }
+          };
+          if (current.isPath1Valid) {
+            mergeChange(current.path1, current.info1);
+          }
+          if (current.isPath2Valid) {
+            mergeChange(current.path2, current.info2);
+          }
+          if (accumulated) {
+            ++filesAccumulated;
           }
         },
         [&](const RootUpdateJournalDelta& current) -> void {
@@ -454,9 +783,25 @@ std::unique_ptr<JournalDeltaRange> Journal::accumulateRange(
           result->snapshotTransitions.push_back(current.fromHash);
 
           // Merge the unclean status list
-          result->uncleanPaths.insert(
-              current.uncleanPaths.begin(), current.uncleanPaths.end());
+          if (root.empty()) {
+            result->uncleanPaths.insert(
+                current.uncleanPaths.begin(), current.uncleanPaths.end());
+          } else {
+            for (const auto& path : current.uncleanPaths) {
+              if (isInScope(path, root)) {
+                result->uncleanPaths.insert(path);
+              }
+            }
+          }
         });
+
+    if (result) {
+      result->changedFilesInOverlay.reserve(changedNodes.size());
+      for (const auto& [node, info] : changedNodes) {
+        result->changedFilesInOverlay.emplace(
+            JournalPathTable::toPath(node), info);
+      }
+    }
   }
 
   if (result) {
@@ -477,7 +822,6 @@ std::unique_ptr<JournalDeltaRange> Journal::accumulateRange(
         result->snapshotTransitions.begin(), result->snapshotTransitions.end());
   }
 
-  deltaState->lastModificationHasBeenObserved = true;
   return result;
 }
 
@@ -485,15 +829,15 @@ std::vector<DebugJournalDelta> Journal::getDebugRawJournalInfo(
     SequenceNumber from,
     std::optional<size_t> limit,
     long mountGeneration,
-    RootIdCodec& rootIdCodec) const {
+    RootIdCodec& rootIdCodec) {
   auto result = std::vector<DebugJournalDelta>();
-  auto deltaState = deltaState_.lock();
+  auto deltaState = lockDeltaState();
   RootId currentHash = deltaState->currentHash;
   forEachDelta(
       *deltaState,
       from,
       limit,
-      [&](const FileChangeJournalDelta& current) -> void {
+      [&](const InternedFileChangeJournalDelta& current) -> void {
         DebugJournalDelta delta;
         JournalPosition fromPosition;
         fromPosition.mountGeneration_ref() = mountGeneration;
@@ -507,7 +851,9 @@ std::vector<DebugJournalDelta> Journal::getDebugRawJournalInfo(
         toPosition.snapshotHash_ref() = rootIdCodec.renderRootId(currentHash);
         delta.toPosition_ref() = toPosition;
 
-        for (const auto& entry : current.getChangedFilesInOverlay()) {
+        auto changedFiles =
+            current.toFileChangeJournalDelta().getChangedFilesInOverlay();
+        for (const auto& entry : changedFiles) {
           auto& path = entry.first;
           auto& changeInfo = entry.second;
 
@@ -546,7 +892,7 @@ std::vector<DebugJournalDelta> Journal::getDebugRawJournalInfo(
 }
 
 /**
- * FileChangeFunc: void(const FileChangeJournalDelta&)
+ * FileChangeFunc: void(const InternedFileChangeJournalDelta&)
  * HashUpdateFunc: void(const RootUpdateJournalDelta&)
  */
 template <class FileChangeFunc, class HashUpdateFunc>
@@ -7,14 +7,18 @@
 
 #pragma once
 
+#include <folly/Executor.h>
 #include <folly/Function.h>
 #include <folly/Synchronized.h>
 #include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <memory>
 #include <optional>
 #include <unordered_map>
+#include <vector>
 #include "eden/fs/journal/JournalDelta.h"
+#include "eden/fs/journal/JournalLog.h"
 #include "eden/fs/model/RootId.h"
 #include "eden/fs/service/ThriftUtil.h"
 #include "eden/fs/service/gen-cpp2/StreamingEdenService.h"
@@ -57,6 +61,10 @@ struct JournalDeltaInfo {
  *
  * The Journal class is thread-safe.  Subscribers are called on the thread
  * that called addDelta.
+ *
+ * File changes are staged in a small buffer and only linked into the journal,
+ * with their sequence numbers, by the next reader or once enough of them are
+ * staged, so that recording them doesn't wait for the readers of the journal.
  */
 class Journal {
  public:
@@ -121,9 +129,14 @@ class Journal {
    * The default limit value indicates that all deltas should be summed.
    *
    * If the limitSequence means that no deltas will match, returns nullptr.
+   *
+   * When root is not empty, only the changed and unclean paths that are root
+   * or under it are accumulated, while the sequence range and the snapshot
+   * transitions still cover all the deltas.
    */
   std::unique_ptr<JournalDeltaRange> accumulateRange(
-      SequenceNumber limitSequence = 1);
+      SequenceNumber limitSequence = 1,
+      RelativePathPiece root = RelativePathPiece{});
 
   // Subscription functionality:
 
@@ -144,6 +157,23 @@ class Journal {
    * to cancelSubscriber to later remove the registration.
    */
   SubscriberId registerSubscriber(SubscriberCallback&& callback);
+
+  /**
+   * Like registerSubscriber(), but the callback runs on the executor instead
+   * of the thread that modified the journal, and at most once per
+   * minInterval. The changes made while a notification is pending or running
+   * are coalesced into a single notification, sent once minInterval elapsed
+   * since the previous one, so the subscriber is always notified after the
+   * last change of a burst.
+   *
+   * A notification may still run after cancelSubscriber() returned if it had
+   * already started.
+   */
+  SubscriberId registerThrottledSubscriber(
+      SubscriberCallback&& callback,
+      folly::Executor::KeepAlive<> executor,
+      std::chrono::steady_clock::duration minInterval);
+
   void cancelSubscriber(SubscriberId id);
 
   void cancelAllSubscribers();
@@ -166,7 +196,7 @@ class Journal {
       SequenceNumber from,
       std::optional<size_t> limit,
       long mountGeneration,
-      RootIdCodec& rootIdCodec) const;
+      RootIdCodec& rootIdCodec);
 
   /** Removes all prior contents from the journal and sets up the journal in a
    * way such that when subscribers are notified they all get truncated results
@@ -177,7 +207,36 @@ class Journal {
 
   size_t getMemoryLimit() const;
 
-  size_t estimateMemoryUsage() const;
+  size_t estimateMemoryUsage();
+
+  // Persistence:
+
+  /**
+   * Persist the deltas of this journal to the log, after restoring the
+   * deltas it holds if it was closed cleanly. The restored deltas keep their
+   * sequence numbers, so that the journal positions handed out before remain
+   * valid. Must be called before any delta is recorded.
+   *
+   * Nothing is written to the log until setMountGeneration() is called.
+   */
+  void attachLog(std::unique_ptr<JournalLog> log);
+
+  /**
+   * The mount generation of the deltas restored by attachLog(), if any.
+   */
+  std::optional<uint64_t> getRestoredMountGeneration() const;
+
+  /**
+   * Set the mount generation the positions in this journal are handed out
+   * with, and start writing to the attached log.
+   */
+  void setMountGeneration(uint64_t mountGeneration);
+
+  /**
+   * Mark the log as closed cleanly, so that the next attachLog() restores
+   * it, and stop writing to it.
+   */
+  void closeLog();
 
  private:
   /** Add a delta to the journal and notify subscribers.
@@ -189,17 +248,28 @@ class Journal {
 
   static constexpr size_t kDefaultJournalMemoryLimit = 1000000000;
 
+  /**
+   * The number of staged file changes past which the writer links them into
+   * the journal itself.
+   */
+  static constexpr size_t kMaxStagedDeltas = 1024;
+
   struct DeltaState {
     /**
      * The sequence number that we'll use for the next entry that we link into
      * the chain.
      */
     SequenceNumber nextSequence{1};
+    /**
+     * The paths of fileChangeDeltas. Declared before them so that it outlives
+     * their references.
+     */
+    JournalPathTable pathTable;
     /**
      * All recorded entries. Newer (more recent) deltas are added to the back of
      * the appropriate deque.
      */
-    std::deque<FileChangeJournalDelta> fileChangeDeltas;
+    std::deque<InternedFileChangeJournalDelta> fileChangeDeltas;
     std::deque<RootUpdateJournalDelta> hashUpdateDeltas;
     RootId currentHash;
     /// The stats about this Journal up to the latest delta.
@@ -207,10 +277,25 @@ class Journal {
     size_t memoryLimit = kDefaultJournalMemoryLimit;
     size_t deltaMemoryUsage = 0;
 
-    // Set to false when a delta is added.
-    // Set to true when getLatest() or accumulateRange() are called.
-    // If true before calling addDelta, subscribers are notified.
-    bool lastModificationHasBeenObserved = true;
+    /**
+     * The log the deltas are written to, once setMountGeneration() was
+     * called. Until then, the attached log is held by pendingLog.
+     */
+    std::shared_ptr<JournalLog> log;
+    std::unique_ptr<JournalLog> pendingLog;
+    std::optional<uint64_t> restoredMountGeneration;
+    uint64_t mountGeneration{0};
+
+    /**
+     * A rewrite of the log begun while holding the lock, to be finished by
+     * the DeltaStateLock once it is released.
+     */
+    struct LogRewrite {
+      std::shared_ptr<JournalLog> log;
+      uint64_t id;
+      JournalLog::Writer writer;
+    };
+    std::optional<LogRewrite> logRewrite;
 
     JournalDeltaPtr frontPtr() noexcept;
     void popFront();
@@ -223,7 +308,7 @@ class Journal {
     bool isFileChangeInFront() const;
     bool isFileChangeInBack() const;
 
-    void appendDelta(FileChangeJournalDelta&& delta);
+    void appendDelta(InternedFileChangeJournalDelta&& delta);
     void appendDelta(RootUpdateJournalDelta&& delta);
 
     JournalDelta::SequenceNumber getFrontSequenceID() const {
@@ -236,6 +321,53 @@ class Journal {
   };
   folly::Synchronized<DeltaState, std::mutex> deltaState_;
 
+  /**
+   * The lock of the deltaState. Once released, it writes the log: either
+   * the rewrite begun while it was held, or the batch of records appended.
+   */
+  class DeltaStateLock {
+   public:
+    explicit DeltaStateLock(
+        folly::Synchronized<DeltaState, std::mutex>::LockedPtr lock)
+        : lock_{std::move(lock)} {}
+    DeltaStateLock(DeltaStateLock&&) = default;
+    DeltaStateLock& operator=(DeltaStateLock&&) = delete;
+    ~DeltaStateLock();
+
+    DeltaState* operator->() {
+      return lock_.operator->();
+    }
+    DeltaState& operator*() {
+      return *lock_;
+    }
+
+   private:
+    folly::Synchronized<DeltaState, std::mutex>::LockedPtr lock_;
+  };
+
+  /**
+   * The file changes recorded since the journal was last locked, in order.
+   * They have a timestamp but no sequence number yet.
+   */
+  struct StagedDeltas {
+    std::vector<FileChangeJournalDelta> deltas;
+
+    // Set to false when a delta is added.
+    // Set to true when getLatest() or accumulateRange() are called.
+    // If true before calling addDelta, subscribers are notified.
+    bool lastModificationHasBeenObserved = true;
+  };
+  folly::Synchronized<StagedDeltas, std::mutex> stagedDeltas_;
+
+  /**
+   * Lock the deltaState and link the staged deltas into it. When observe is
+   * set, the next recorded change notifies the subscribers.
+   *
+   * stagedDeltas_ is only ever locked while holding deltaState_, never the
+   * other way around.
+   */
+  DeltaStateLock lockDeltaState(bool observe = false);
+
   /**
    * Removes the oldest deltas until the memory usage of the journal is below
    * the journal's memory limit.
@@ -246,24 +378,54 @@ class Journal {
    * Tries to compact a new Journal Delta with an old one if possible,
    * returning true if it did compact it and false if not
    */
-  bool compact(FileChangeJournalDelta& delta, DeltaState& deltaState);
+  bool compact(InternedFileChangeJournalDelta& delta, DeltaState& deltaState);
   bool compact(RootUpdateJournalDelta& delta, DeltaState& deltaState);
 
+  /**
+   * Link a delta that already has its sequence number and timestamp into the
+   * journal, truncating and compacting it as needed. File changes must have
+   * been interned in the deltaState.pathTable.
+   */
+  template <typename T>
+  void insertDelta(T&& delta, DeltaState& deltaState);
+
+  /**
+   * Append a stamped delta to the log, if any. The root update deltas are
+   * stored with deltaState.currentHash as the root they updated to.
+   */
+  void logDelta(const FileChangeJournalDelta& delta, DeltaState& deltaState);
+  void logDelta(const RootUpdateJournalDelta& delta, DeltaState& deltaState);
+
+  /**
+   * Replace the log by the deltas currently held in the journal. The file is
+   * written once the DeltaStateLock is released.
+   */
+  void rewriteLog(DeltaState& deltaState);
+
+  /**
+   * Stop persisting the journal after the log failed to be written to.
+   */
+  void discardLog(DeltaState& deltaState, const std::exception& ex);
+
   struct SubscriberState {
     SubscriberId nextSubscriberId{1};
     std::unordered_map<SubscriberId, SubscriberCallback> subscribers;
   };
 
   /**
-   * Add a delta to the journal without notifying subscribers.
-   * The delta will have a new sequence number and timestamp
-   * applied. A lock to the deltaState must be held and passed to this
-   * function.
+   * Add a timestamped delta to the journal without notifying subscribers.
+   * The delta will have a new sequence number applied. A lock to the
+   * deltaState must be held and passed to this function.
+   */
+  template <typename T>
+  void linkDelta(T&& delta, DeltaState& deltaState);
+
+  /**
+   * Record that the journal was modified since it was last observed.
    *
    * Returns true if subscribers should be notified.
    */
-  template <typename T>
-  [[nodiscard]] bool addDeltaBeforeNotifying(T&& delta, DeltaState& deltaState);
+  [[nodiscard]] bool markModified();
 
   /**
    * Notify subscribers that a change has happened. Must not be called while
@@ -122,9 +122,57 @@ bool FileChangeJournalDelta::isSameAction(
       info2 == other.info2 && path2 == other.path2;
 }
 
+InternedFileChangeJournalDelta::InternedFileChangeJournalDelta(
+    const FileChangeJournalDelta& delta,
+    JournalPathTable& pathTable)
+    : info1{delta.info1},
+      info2{delta.info2},
+      isPath1Valid{delta.isPath1Valid},
+      isPath2Valid{delta.isPath2Valid} {
+  sequenceID = delta.sequenceID;
+  time = delta.time;
+  if (isPath1Valid) {
+    path1 = pathTable.intern(delta.path1);
+  }
+  if (isPath2Valid) {
+    path2 = pathTable.intern(delta.path2);
+  }
+}
+
+bool InternedFileChangeJournalDelta::isModification() const {
+  return isPath1Valid && !isPath2Valid && info1.existedBefore &&
+      info1.existedAfter;
+}
+
+bool InternedFileChangeJournalDelta::isSameAction(
+    const InternedFileChangeJournalDelta& other) const {
+  return isPath1Valid == other.isPath1Valid && info1 == other.info1 &&
+      path1 == other.path1 && isPath2Valid == other.isPath2Valid &&
+      info2 == other.info2 && path2 == other.path2;
+}
+
+FileChangeJournalDelta
+InternedFileChangeJournalDelta::toFileChangeJournalDelta() const {
+  FileChangeJournalDelta delta;
+  delta.sequenceID = sequenceID;
+  delta.time = time;
+  if (isPath1Valid) {
+    delta.path1 = path1.toPath();
+  }
+  if (isPath2Valid) {
+    delta.path2 = path2.toPath();
+  }
+  delta.info1 = info1;
+  delta.info2 = info2;
+  delta.isPath1Valid = isPath1Valid;
+  delta.isPath2Valid = isPath2Valid;
+  return delta;
+}
+
 JournalDeltaPtr::JournalDeltaPtr(std::nullptr_t) {}
 
-JournalDeltaPtr::JournalDeltaPtr(FileChangeJournalDelta* p) : data_{p} {
+JournalDeltaPtr::JournalDeltaPtr(InternedFileChangeJournalDelta* p)
+    : data_{p} {
   XCHECK(p);
 }
 
@@ -156,11 +204,12 @@ const JournalDelta* JournalDeltaPtr::operator->() const noexcept {
       data_);
 }
 
-FileChangeJournalDelta* JournalDeltaPtr::getAsFileChangeJournalDelta() {
+InternedFileChangeJournalDelta* JournalDeltaPtr::getAsFileChangeJournalDelta() {
   return std::visit(
-      [](auto delta) -> FileChangeJournalDelta* {
-        if constexpr (std::
-                          is_same_v<decltype(delta), FileChangeJournalDelta*>) {
+      [](auto delta) -> InternedFileChangeJournalDelta* {
+        if constexpr (std::is_same_v<
+                          decltype(delta),
+                          InternedFileChangeJournalDelta*>) {
           return delta;
         } else {
           return nullptr;
@@ -11,6 +11,7 @@
 #include <type_traits>
 #include <unordered_set>
 #include <variant>
+#include "eden/fs/journal/JournalPathTable.h"
 #include "eden/fs/model/RootId.h"
 #include "eden/fs/utils/PathFuncs.h"
 
@@ -118,6 +119,44 @@ class FileChangeJournalDelta : public JournalDelta {
   size_t estimateMemoryUsage() const;
 };
 
+/**
+ * A FileChangeJournalDelta as the Journal stores it, with its paths interned
+ * in the JournalPathTable of the journal rather than each holding a copy of
+ * their parent directories.
+ */
+class InternedFileChangeJournalDelta : public JournalDelta {
+ public:
+  InternedFileChangeJournalDelta(
+      const FileChangeJournalDelta& delta,
+      JournalPathTable& pathTable);
+  InternedFileChangeJournalDelta(InternedFileChangeJournalDelta&&) = default;
+  InternedFileChangeJournalDelta& operator=(InternedFileChangeJournalDelta&&) =
+      default;
+
+  JournalPathTable::Ref path1;
+  JournalPathTable::Ref path2;
+  PathChangeInfo info1;
+  PathChangeInfo info2;
+  bool isPath1Valid = false;
+  bool isPath2Valid = false;
+
+  /** Checks whether this delta is a modification */
+  bool isModification() const;
+
+  /** Checks whether this delta and other are the same disregarding time and
+   * sequenceID [whether they do the same action] */
+  bool isSameAction(const InternedFileChangeJournalDelta& other) const;
+
+  /** Copy the delta back out of the journal, with its own paths. */
+  FileChangeJournalDelta toFileChangeJournalDelta() const;
+
+  /** Get memory used (in bytes) by this Delta. The interned paths are
+   * accounted for by the JournalPathTable. */
+  size_t estimateMemoryUsage() const {
+    return sizeof(InternedFileChangeJournalDelta);
+  }
+};
+
 /** A delta that stores information about changing commits */
 class RootUpdateJournalDelta : public JournalDelta {
  public:
@@ -146,7 +185,7 @@ class JournalDeltaPtr {
  public:
   /* implicit */ JournalDeltaPtr(std::nullptr_t);
 
-  /* implicit */ JournalDeltaPtr(FileChangeJournalDelta* p);
+  /* implicit */ JournalDeltaPtr(InternedFileChangeJournalDelta* p);
 
   /* implicit */ JournalDeltaPtr(RootUpdateJournalDelta* p);
 
@@ -156,15 +195,18 @@ class JournalDeltaPtr {
     return !std::holds_alternative<std::monostate>(data_);
   }
 
-  /** If this JournalDeltaPtr points to a FileChangeJournalDelta then returns
-   * the raw pointer, if it does not point to a FileChangeJournalDelta then
+  /** If this JournalDeltaPtr points to a file change delta then returns
+   * the raw pointer, if it does not point to a file change delta then
    * return nullptr. */
-  FileChangeJournalDelta* getAsFileChangeJournalDelta();
+  InternedFileChangeJournalDelta* getAsFileChangeJournalDelta();
 
   const JournalDelta* operator->() const noexcept;
 
  private:
-  std::variant<std::monostate, FileChangeJournalDelta*, RootUpdateJournalDelta*>
+  std::variant<
+      std::monostate,
+      InternedFileChangeJournalDelta*,
+      RootUpdateJournalDelta*>
       data_;
 };
 
@@ -0,0 +1,399 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/journal/JournalLog.h"
+
+#include <folly/Bits.h>
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/String.h>
+#include <folly/io/Cursor.h>
+#include <folly/io/IOBuf.h>
+#include <folly/logging/xlog.h>
+#include <folly/portability/Fcntl.h>
+#include <folly/portability/Unistd.h>
+#include "eden/fs/utils/FileUtils.h"
+
+namespace facebook::eden {
+
+namespace {
+
+constexpr folly::StringPiece kMagic{"EDJL"};
+constexpr uint32_t kVersion = 1;
+// The clean flag follows the magic and the version.
+constexpr off_t kCleanFlagOffset = 4 + sizeof(uint32_t);
+
+// The appended records are written once this many bytes of them are
+// buffered.
+constexpr size_t kAppendBatchSize = 64 * 1024;
+
+// The log is rewritten without its truncated and compacted deltas once it
+// grows past twice its size after the last rewrite plus this many bytes.
+constexpr size_t kRewriteSlack = 1024 * 1024;
+
+enum RecordType : uint8_t {
+  kFileChange = 1,
+  kRootUpdate = 2,
+};
+
+enum FileChangeFlags : uint8_t {
+  kPath1Valid = 1 << 0,
+  kPath2Valid = 1 << 1,
+  kInfo1ExistedBefore = 1 << 2,
+  kInfo1ExistedAfter = 1 << 3,
+  kInfo2ExistedBefore = 1 << 4,
+  kInfo2ExistedAfter = 1 << 5,
+};
+
+template <typename T>
+void appendBE(std::string& out, T value) {
+  value = folly::Endian::big(value);
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void appendString(std::string& out, folly::StringPiece str) {
+  appendBE<uint32_t>(out, static_cast<uint32_t>(str.size()));
+  out.append(str.data(), str.size());
+}
+
+std::string readString(folly::io::Cursor& cursor) {
+  auto length = cursor.readBE<uint32_t>();
+  return cursor.readFixedString(length);
+}
+
+/**
+ * The Journal timestamps deltas with the steady clock, which doesn't carry
+ * over restarts, so they are stored as system clock times.
+ */
+int64_t toSystemTime(std::chrono::steady_clock::time_point time) {
+  auto systemTime = std::chrono::system_clock::now() +
+      std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                        time - std::chrono::steady_clock::now());
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             systemTime.time_since_epoch())
+      .count();
+}
+
+std::chrono::steady_clock::time_point fromSystemTime(int64_t nanoseconds) {
+  auto systemTime = std::chrono::system_clock::time_point{
+      std::chrono::duration_cast<std::chrono::system_clock::duration>(
+          std::chrono::nanoseconds{nanoseconds})};
+  return std::chrono::steady_clock::now() +
+      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+             systemTime - std::chrono::system_clock::now());
+}
+
+void appendHeader(std::string& out, bool clean, uint64_t mountGeneration) {
+  out.append(kMagic.data(), kMagic.size());
+  appendBE<uint32_t>(out, kVersion);
+  out.push_back(clean ? 1 : 0);
+  appendBE<uint64_t>(out, mountGeneration);
+}
+
+void appendRecordHeader(
+    std::string& out,
+    RecordType type,
+    const JournalDelta& delta) {
+  // The length of the record is filled in by finishRecord().
+  appendBE<uint32_t>(out, 0);
+  out.push_back(type);
+  appendBE<uint64_t>(out, delta.sequenceID);
+  appendBE<int64_t>(out, toSystemTime(delta.time));
+}
+
+void finishRecord(std::string& out, size_t recordStart) {
+  uint32_t length = folly::Endian::big(
+      static_cast<uint32_t>(out.size() - recordStart - sizeof(uint32_t)));
+  memcpy(&out[recordStart], &length, sizeof(length));
+}
+
+void serialize(std::string& out, const FileChangeJournalDelta& delta) {
+  auto recordStart = out.size();
+  appendRecordHeader(out, kFileChange, delta);
+  uint8_t flags = (delta.isPath1Valid ? kPath1Valid : 0) |
+      (delta.isPath2Valid ? kPath2Valid : 0) |
+      (delta.info1.existedBefore ? kInfo1ExistedBefore : 0) |
+      (delta.info1.existedAfter ? kInfo1ExistedAfter : 0) |
+      (delta.info2.existedBefore ? kInfo2ExistedBefore : 0) |
+      (delta.info2.existedAfter ? kInfo2ExistedAfter : 0);
+  out.push_back(flags);
+  appendString(out, delta.path1.stringPiece());
+  appendString(out, delta.path2.stringPiece());
+  finishRecord(out, recordStart);
+}
+
+void serialize(
+    std::string& out,
+    const RootUpdateJournalDelta& delta,
+    const RootId& toHash) {
+  auto recordStart = out.size();
+  appendRecordHeader(out, kRootUpdate, delta);
+  appendString(out, delta.fromHash.value());
+  appendString(out, toHash.value());
+  appendBE<uint32_t>(out, static_cast<uint32_t>(delta.uncleanPaths.size()));
+  for (const auto& path : delta.uncleanPaths) {
+    appendString(out, path.stringPiece());
+  }
+  finishRecord(out, recordStart);
+}
+
+JournalLog::Record parseRecord(folly::io::Cursor& cursor) {
+  auto type = cursor.read<uint8_t>();
+  auto sequenceID = cursor.readBE<uint64_t>();
+  auto time = fromSystemTime(cursor.readBE<int64_t>());
+  switch (type) {
+    case kFileChange: {
+      FileChangeJournalDelta delta;
+      delta.sequenceID = sequenceID;
+      delta.time = time;
+      auto flags = cursor.read<uint8_t>();
+      delta.isPath1Valid = flags & kPath1Valid;
+      delta.isPath2Valid = flags & kPath2Valid;
+      delta.info1 = PathChangeInfo{
+          bool(flags & kInfo1ExistedBefore), bool(flags & kInfo1ExistedAfter)};
+      delta.info2 = PathChangeInfo{
+          bool(flags & kInfo2ExistedBefore), bool(flags & kInfo2ExistedAfter)};
+      delta.path1 = RelativePath{readString(cursor)};
+      delta.path2 = RelativePath{readString(cursor)};
+      return delta;
+    }
+    case kRootUpdate: {
+      JournalLog::RootUpdate update;
+      update.delta.sequenceID = sequenceID;
+      update.delta.time = time;
+      update.delta.fromHash = RootId{readString(cursor)};
+      update.toHash = RootId{readString(cursor)};
+      auto pathCount = cursor.readBE<uint32_t>();
+      for (uint32_t i = 0; i < pathCount; ++i) {
+        update.delta.uncleanPaths.emplace(readString(cursor));
+      }
+      return update;
+    }
+  }
+  throw std::domain_error(
+      folly::to<std::string>("unknown journal record type ", type));
+}
+
+} // namespace
+
+JournalLog::Writer::Writer(uint64_t mountGeneration) {
+  appendHeader(buffer_, /*clean=*/false, mountGeneration);
+}
+
+void JournalLog::Writer::add(const FileChangeJournalDelta& delta) {
+  serialize(buffer_, delta);
+}
+
+void JournalLog::Writer::add(
+    const RootUpdateJournalDelta& delta,
+    const RootId& toHash) {
+  serialize(buffer_, delta, toHash);
+}
+
+JournalLog::JournalLog(AbsolutePath path) : path_{std::move(path)} {}
+
+std::optional<JournalLog::Contents> JournalLog::load() const {
+  auto data = readFile(path_);
+  if (data.hasException()) {
+    XLOG(DBG2) << "no journal to restore at " << path_ << ": "
+               << data.exception().what();
+    return std::nullopt;
+  }
+
+  auto buf = folly::IOBuf::wrapBufferAsValue(folly::StringPiece{*data});
+  folly::io::Cursor cursor{&buf};
+  try {
+    if (cursor.readFixedString(kMagic.size()) != kMagic) {
+      XLOG(WARN) << "ignoring journal " << path_ << " with a bad magic";
+      return std::nullopt;
+    }
+    auto version = cursor.readBE<uint32_t>();
+    if (version != kVersion) {
+      XLOG(WARN) << "ignoring journal " << path_ << " with unsupported version "
+                 << version;
+      return std::nullopt;
+    }
+    if (cursor.read<uint8_t>() != 1) {
+      XLOG(WARN) << "ignoring journal " << path_
+                 << " that was not closed cleanly";
+      return std::nullopt;
+    }
+
+    Contents contents;
+    contents.mountGeneration = cursor.readBE<uint64_t>();
+    while (!cursor.isAtEnd()) {
+      auto length = cursor.readBE<uint32_t>();
+      std::unique_ptr<folly::IOBuf> record;
+      if (cursor.cloneAtMost(record, length) != length) {
+        throw std::out_of_range("truncated journal record");
+      }
+      folly::io::Cursor recordCursor{record.get()};
+      contents.records.push_back(parseRecord(recordCursor));
+    }
+    return contents;
+  } catch (const std::exception& ex) {
+    XLOG(WARN) << "ignoring corrupt journal " << path_ << ": " << ex.what();
+    return std::nullopt;
+  }
+}
+
+uint64_t JournalLog::beginRewrite() {
+  std::lock_guard<std::mutex> lock{mutex_};
+  // The writer holds the buffered records, and the current file is not
+  // appended to anymore.
+  buffer_.clear();
+  rewriting_ = true;
+  return ++rewrite_;
+}
+
+void JournalLog::finishRewrite(uint64_t rewrite, Writer&& writer) {
+  auto tmpPath = path_.dirname() +
+      PathComponent{folly::to<std::string>(
+          path_.basename().stringPiece(), ".", rewrite, ".tmp")};
+  auto written = writeFile(tmpPath, folly::StringPiece{writer.buffer_});
+
+  std::lock_guard<std::mutex> lock{mutex_};
+  if (rewrite != rewrite_ || failed_) {
+    // A later rewrite replaces this one, or the log was discarded.
+    unlink(tmpPath.c_str());
+    return;
+  }
+  try {
+    written.value();
+    renameWithAbsolutePath(tmpPath, path_);
+    file_ = folly::File{path_.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC};
+    size_ = sizeAfterRewrite_ = writer.buffer_.size();
+    size_ += buffer_.size();
+    writeBufferLocked();
+  } catch (const std::exception& ex) {
+    unlink(tmpPath.c_str());
+    failLocked(ex);
+  }
+  rewriting_ = false;
+  rewriteFinished_.notify_all();
+}
+
+bool JournalLog::needsRewrite() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return !rewriting_ && !failed_ &&
+      size_ > 2 * sizeAfterRewrite_ + kRewriteSlack;
+}
+
+void JournalLog::append(const FileChangeJournalDelta& delta) {
+  std::string record;
+  serialize(record, delta);
+  appendRecord(record);
+}
+
+void JournalLog::append(
+    const RootUpdateJournalDelta& delta,
+    const RootId& toHash) {
+  std::string record;
+  serialize(record, delta, toHash);
+  appendRecord(record);
+}
+
+void JournalLog::appendRecord(folly::StringPiece record) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  if (failed_) {
+    throw std::runtime_error(
+        folly::to<std::string>("journal ", path_, " was discarded"));
+  }
+  XCHECK(file_ || rewriting_) << "journal " << path_ << " is not open";
+  buffer_.append(record.data(), record.size());
+  size_ += record.size();
+}
+
+bool JournalLog::needsFlush() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return !rewriting_ && !failed_ && buffer_.size() >= kAppendBatchSize;
+}
+
+void JournalLog::flush() {
+  std::lock_guard<std::mutex> lock{mutex_};
+  if (rewriting_ || failed_) {
+    return;
+  }
+  try {
+    writeBufferLocked();
+  } catch (const std::exception& ex) {
+    failLocked(ex);
+  }
+}
+
+void JournalLog::writeBufferLocked() {
+  if (buffer_.empty()) {
+    return;
+  }
+  folly::checkUnixError(
+      folly::writeFull(file_.fd(), buffer_.data(), buffer_.size()),
+      "failed to append to journal ",
+      path_);
+  buffer_.clear();
+}
+
+void JournalLog::failLocked(const std::exception& ex) {
+  XLOG(ERR) << "no longer persisting the journal to " << path_ << ": "
+            << folly::exceptionStr(ex);
+  file_.close();
+  buffer_.clear();
+  failed_ = true;
+  if (unlink(path_.c_str()) != 0 && errno != ENOENT) {
+    XLOG(WARN) << "failed to remove journal " << path_ << ": "
+               << folly::errnoStr(errno);
+  }
+}
+
+void JournalLog::close() {
+  std::unique_lock<std::mutex> lock{mutex_};
+  rewriteFinished_.wait(lock, [this] { return !rewriting_; });
+  if (!file_) {
+    return;
+  }
+  try {
+    // The records must be on disk before the flag that says they all are.
+    writeBufferLocked();
+    folly::checkUnixError(
+        folly::fsyncNoInt(file_.fd()), "failed to sync journal ", path_);
+    // The file is opened for appending, where pwrite ignores the offset.
+    file_.close();
+    folly::File file{path_.c_str(), O_WRONLY | O_CLOEXEC};
+    char clean = 1;
+    folly::checkUnixError(
+        folly::pwriteFull(file.fd(), &clean, sizeof(clean), kCleanFlagOffset),
+        "failed to mark journal ",
+        path_,
+        " as clean");
+    folly::checkUnixError(
+        folly::fsyncNoInt(file.fd()), "failed to sync journal ", path_);
+  } catch (const std::exception& ex) {
+    XLOG(ERR) << "the journal won't be restored: " << ex.what();
+  }
+  file_.close();
+}
+
+void JournalLog::discard() {
+  std::lock_guard<std::mutex> lock{mutex_};
+  file_.close();
+  buffer_.clear();
+  size_ = 0;
+  // Nothing is appended to a discarded log, nor is it rewritten.
+  failed_ = true;
+  rewriting_ = false;
+  rewriteFinished_.notify_all();
+  if (unlink(path_.c_str()) != 0 && errno != ENOENT) {
+    XLOG(WARN) << "failed to remove journal " << path_ << ": "
+               << folly::errnoStr(errno);
+  }
+}
+
+size_t JournalLog::size() const {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return size_;
+}
+
+} // namespace facebook::eden
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/File.h>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <variant>
+#include <vector>
+#include "eden/fs/journal/JournalDelta.h"
+#include "eden/fs/model/RootId.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook::eden {
+
+/**
+ * An append-only file holding the deltas of the Journal of a mount, so that
+ * EdenFS can restore the journal after a restart and keep answering
+ * getFilesChangedSince() for the journal positions it handed out before.
+ *
+ * The file starts with a header holding the mount generation of these
+ * positions and whether the log was closed cleanly, followed by one length
+ * prefixed record per delta, in sequence order. A log that was not closed
+ * cleanly may miss the latest changes, and is never restored. Appended
+ * records are therefore buffered and written in batches: only close() needs
+ * them on disk.
+ *
+ * The methods are thread safe, so that the I/O of a rewrite and of a batch
+ * of appends can run without holding the lock of the Journal.
+ */
+class JournalLog {
+ public:
+  /**
+   * A RootUpdateJournalDelta, along with the root it updated to.
+   */
+  struct RootUpdate {
+    RootUpdateJournalDelta delta;
+    RootId toHash;
+  };
+
+  using Record = std::variant<FileChangeJournalDelta, RootUpdate>;
+
+  struct Contents {
+    uint64_t mountGeneration{0};
+    std::vector<Record> records;
+  };
+
+  /**
+   * Serializes the records of a whole log, to be written by rewrite().
+   */
+  class Writer {
+   public:
+    explicit Writer(uint64_t mountGeneration);
+
+    void add(const FileChangeJournalDelta& delta);
+    void add(const RootUpdateJournalDelta& delta, const RootId& toHash);
+
+   private:
+    friend class JournalLog;
+
+    std::string buffer_;
+  };
+
+  explicit JournalLog(AbsolutePath path);
+
+  JournalLog(const JournalLog&) = delete;
+  JournalLog& operator=(const JournalLog&) = delete;
+
+  /**
+   * Read the records of the log if it was closed cleanly.
+   *
+   * Returns std::nullopt if there is no log to restore: it doesn't exist, it
+   * wasn't closed cleanly, or it is corrupt. A record truncated by a crash
+   * in the middle of an append makes the log unclean.
+   */
+  std::optional<Contents> load() const;
+
+  /**
+   * Start replacing the log by the records of a writer, which must hold
+   * every record appended so far. The records appended from now on are kept
+   * for the new log. Returns the ID to pass to finishRewrite().
+   */
+  uint64_t beginRewrite();
+
+  /**
+   * Atomically replace the log by the records of the writer followed by the
+   * ones appended since beginRewrite(), and open it for append(). The log is
+   * marked as not closed cleanly until close(). Does nothing if another
+   * rewrite began since.
+   *
+   * This does the I/O of the rewrite, so it is meant to be called without
+   * holding the Journal's lock. A failure discards the log, and the next
+   * append() throws.
+   */
+  void finishRewrite(uint64_t rewrite, Writer&& writer);
+
+  /**
+   * Whether the log grew past twice its size after the last rewrite, plus
+   * some slack, and no rewrite is in progress.
+   */
+  bool needsRewrite() const;
+
+  /**
+   * Append one record to the log. Must be called after beginRewrite().
+   *
+   * Throws if the log was discarded after a failure.
+   */
+  void append(const FileChangeJournalDelta& delta);
+  void append(const RootUpdateJournalDelta& delta, const RootId& toHash);
+
+  /**
+   * Whether enough records are buffered to be written as one batch.
+   */
+  bool needsFlush() const;
+
+  /**
+   * Write the buffered records, unless a rewrite will. Like finishRewrite(),
+   * meant to be called without holding the Journal's lock. A failure
+   * discards the log, and the next append() throws.
+   */
+  void flush();
+
+  /**
+   * Write the buffered records, sync them and then mark the log as closed
+   * cleanly, so that it is restored by the next load(). Waits for a rewrite
+   * in progress. Nothing can be appended afterwards.
+   */
+  void close();
+
+  /**
+   * Remove the log, after an error left it incomplete.
+   */
+  void discard();
+
+  /**
+   * The size of the log, in bytes, including the buffered records.
+   */
+  size_t size() const;
+
+  const AbsolutePath& getPath() const {
+    return path_;
+  }
+
+ private:
+  void appendRecord(folly::StringPiece record);
+  void writeBufferLocked();
+  void failLocked(const std::exception& ex);
+
+  const AbsolutePath path_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable rewriteFinished_;
+  folly::File file_;
+  // The records appended but not written yet.
+  std::string buffer_;
+  size_t size_{0};
+  size_t sizeAfterRewrite_{0};
+  // The ID of the latest rewrite; only its finishRewrite() replaces the log.
+  uint64_t rewrite_{0};
+  bool rewriting_{false};
+  bool failed_{false};
+};
+
+} // namespace facebook::eden
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/journal/JournalPathTable.h"
+
+#include <folly/hash/Hash.h>
+#include <folly/logging/xlog.h>
+#include <folly/memory/Malloc.h>
+#include <vector>
+
+namespace facebook::eden {
+
+size_t JournalPathTable::KeyHasher::operator()(const Key& key) const {
+  return folly::hash::hash_combine(
+      reinterpret_cast<uintptr_t>(key.parent),
+      folly::hasher<folly::StringPiece>{}(key.name.stringPiece()));
+}
+
+JournalPathTable::~JournalPathTable() {
+  // All the references must have been released first, which frees the nodes.
+  XDCHECK(nodes_.empty()) << nodes_.size() << " journal paths are leaked";
+}
+
+JournalPathTable::Ref JournalPathTable::intern(RelativePathPiece path) {
+  Node* node = nullptr;
+  for (auto name : path.components()) {
+    auto it = nodes_.find(Key{node, name});
+    if (it != nodes_.end()) {
+      node = it->second;
+      continue;
+    }
+    auto* child = new Node{this, node, name};
+    // The key references the name owned by the node.
+    nodes_.emplace(Key{node, child->name_}, child);
+    memoryUsage_ += estimateNodeMemoryUsage(*child);
+    if (node) {
+      // The child holds a reference on its parent.
+      ++node->refCount_;
+    }
+    node = child;
+  }
+  return Ref{node};
+}
+
+const JournalPathTable::Node* JournalPathTable::find(
+    RelativePathPiece path) const {
+  const Node* node = nullptr;
+  for (auto name : path.components()) {
+    auto it = nodes_.find(Key{node, name});
+    if (it == nodes_.end()) {
+      return nullptr;
+    }
+    node = it->second;
+  }
+  return node;
+}
+
+bool JournalPathTable::isSameOrUnder(const Node* node, const Node* ancestor) {
+  if (!ancestor) {
+    return true;
+  }
+  for (; node; node = node->parent_) {
+    if (node == ancestor) {
+      return true;
+    }
+  }
+  return false;
+}
+
+RelativePath JournalPathTable::toPath(const Node* node) {
+  std::vector<PathComponentPiece> names;
+  size_t length = 0;
+  for (; node; node = node->parent_) {
+    names.push_back(node->name_);
+    length += node->name_.value().size() + 1;
+  }
+  if (names.empty()) {
+    return RelativePath{};
+  }
+
+  std::string path;
+  path.reserve(length - 1);
+  for (auto it = names.rbegin(); it != names.rend(); ++it) {
+    if (!path.empty()) {
+      path.push_back(kDirSeparator);
+    }
+    auto name = it->stringPiece();
+    path.append(name.data(), name.size());
+  }
+  return RelativePath{std::move(path)};
+}
+
+void JournalPathTable::release(Node* node) {
+  // Release the chain of parents the freed nodes referenced.
+  while (node && --node->refCount_ == 0) {
+    auto* table = node->table_;
+    auto* parent = node->parent_;
+    table->memoryUsage_ -= table->estimateNodeMemoryUsage(*node);
+    table->nodes_.erase(Key{parent, node->name_});
+    delete node;
+    node = parent;
+  }
+}
+
+size_t JournalPathTable::estimateNodeMemoryUsage(const Node& node) const {
+  return folly::goodMallocSize(sizeof(Node)) +
+      estimateIndirectMemoryUsage(node.name_.value()) + sizeof(Key) +
+      sizeof(Node*);
+}
+
+} // namespace facebook::eden
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/container/F14Map.h>
+#include <cstddef>
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook::eden {
+
+/**
+ * Interns the paths recorded in the Journal as a trie of their components,
+ * so that a directory is stored once however many deltas reference paths
+ * under it. A node is freed as soon as no delta nor child references it.
+ *
+ * Nothing here is thread-safe: the Journal only creates, copies and releases
+ * references while holding its deltaState lock.
+ */
+class JournalPathTable {
+ public:
+  class Node {
+   public:
+    Node(const Node&) = delete;
+    Node& operator=(const Node&) = delete;
+
+    /** The parent directory, or nullptr for a top-level path. */
+    const Node* getParent() const {
+      return parent_;
+    }
+
+    PathComponentPiece getName() const {
+      return name_;
+    }
+
+   private:
+    friend class JournalPathTable;
+
+    Node(JournalPathTable* table, Node* parent, PathComponentPiece name)
+        : table_{table}, parent_{parent}, name_{name.copy()} {}
+
+    JournalPathTable* table_;
+    Node* parent_;
+    PathComponent name_;
+    // The references and children holding this node.
+    size_t refCount_{0};
+  };
+
+  /**
+   * A reference to an interned path. The empty reference is the root of the
+   * mount.
+   */
+  class Ref {
+   public:
+    Ref() = default;
+    Ref(Ref&& other) noexcept : node_{std::exchange(other.node_, nullptr)} {}
+    Ref& operator=(Ref&& other) noexcept {
+      if (this != &other) {
+        reset();
+        node_ = std::exchange(other.node_, nullptr);
+      }
+      return *this;
+    }
+    Ref(const Ref&) = delete;
+    Ref& operator=(const Ref&) = delete;
+    ~Ref() {
+      reset();
+    }
+
+    const Node* get() const {
+      return node_;
+    }
+
+    RelativePath toPath() const {
+      return JournalPathTable::toPath(node_);
+    }
+
+    bool operator==(const Ref& other) const {
+      return node_ == other.node_;
+    }
+    bool operator!=(const Ref& other) const {
+      return node_ != other.node_;
+    }
+
+   private:
+    friend class JournalPathTable;
+
+    explicit Ref(Node* node) : node_{node} {
+      if (node_) {
+        ++node_->refCount_;
+      }
+    }
+
+    void reset() {
+      if (node_) {
+        JournalPathTable::release(std::exchange(node_, nullptr));
+      }
+    }
+
+    Node* node_{nullptr};
+  };
+
+  JournalPathTable() = default;
+  ~JournalPathTable();
+
+  JournalPathTable(const JournalPathTable&) = delete;
+  JournalPathTable& operator=(const JournalPathTable&) = delete;
+
+  /**
+   * Intern the path, adding the nodes it is missing.
+   */
+  Ref intern(RelativePathPiece path);
+
+  /**
+   * The node of an interned path, or nullptr if the path isn't interned. The
+   * node of the root is nullptr too.
+   */
+  const Node* find(RelativePathPiece path) const;
+
+  /**
+   * Whether the node is ancestor or a path under it. Every path is under the
+   * root, whose node is nullptr.
+   */
+  static bool isSameOrUnder(const Node* node, const Node* ancestor);
+
+  static RelativePath toPath(const Node* node);
+
+  /** The number of interned nodes. */
+  size_t size() const {
+    return nodes_.size();
+  }
+
+  size_t estimateMemoryUsage() const {
+    return memoryUsage_;
+  }
+
+ private:
+  struct Key {
+    const Node* parent;
+    PathComponentPiece name;
+
+    bool operator==(const Key& other) const {
+      return parent == other.parent && name == other.name;
+    }
+  };
+
+  struct KeyHasher {
+    size_t operator()(const Key& key) const;
+  };
+
+  static void release(Node* node);
+
+  size_t estimateNodeMemoryUsage(const Node& node) const;
+
+  folly::F14FastMap<Key, Node*, KeyHasher> nodes_;
+  size_t memoryUsage_{0};
+};
+
+} // namespace facebook::eden
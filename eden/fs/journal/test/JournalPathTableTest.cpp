@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/journal/JournalPathTable.h"
+
+#include <folly/portability/GTest.h>
+
+using namespace facebook::eden;
+
+TEST(JournalPathTable, shares_parent_directories) {
+  JournalPathTable table;
+  auto foo = table.intern("a/b/foo"_relpath);
+  auto bar = table.intern("a/b/bar"_relpath);
+  auto fooAgain = table.intern("a/b/foo"_relpath);
+
+  // a, a/b, a/b/foo and a/b/bar.
+  EXPECT_EQ(4, table.size());
+  EXPECT_EQ(foo, fooAgain);
+  EXPECT_NE(foo, bar);
+  EXPECT_EQ(foo.get()->getParent(), bar.get()->getParent());
+  EXPECT_EQ("a/b/foo"_relpath, foo.toPath());
+  EXPECT_EQ("a/b/bar"_relpath, bar.toPath());
+}
+
+TEST(JournalPathTable, frees_unreferenced_nodes) {
+  JournalPathTable table;
+  auto memoryUsage = table.estimateMemoryUsage();
+  {
+    auto foo = table.intern("a/b/foo"_relpath);
+    {
+      auto bar = table.intern("a/c/bar"_relpath);
+      EXPECT_EQ(5, table.size());
+    }
+    EXPECT_EQ(3, table.size());
+    EXPECT_EQ(nullptr, table.find("a/c"_relpath));
+    EXPECT_EQ(foo.get(), table.find("a/b/foo"_relpath));
+  }
+  EXPECT_EQ(0, table.size());
+  EXPECT_EQ(memoryUsage, table.estimateMemoryUsage());
+}
+
+TEST(JournalPathTable, root_is_empty_reference) {
+  JournalPathTable table;
+  auto root = table.intern(RelativePathPiece{});
+  EXPECT_EQ(nullptr, root.get());
+  EXPECT_EQ(RelativePath{}, root.toPath());
+  EXPECT_EQ(0, table.size());
+}
+
+TEST(JournalPathTable, is_same_or_under) {
+  JournalPathTable table;
+  auto foo = table.intern("a/b/foo"_relpath);
+  auto other = table.intern("ab/foo"_relpath);
+  auto* a = table.find("a"_relpath);
+  ASSERT_NE(nullptr, a);
+
+  EXPECT_TRUE(JournalPathTable::isSameOrUnder(foo.get(), a));
+  EXPECT_TRUE(JournalPathTable::isSameOrUnder(a, a));
+  EXPECT_FALSE(JournalPathTable::isSameOrUnder(other.get(), a));
+  EXPECT_FALSE(JournalPathTable::isSameOrUnder(a, foo.get()));
+  // Everything is under the root.
+  EXPECT_TRUE(JournalPathTable::isSameOrUnder(other.get(), nullptr));
+}
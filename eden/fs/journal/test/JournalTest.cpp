@@ -7,8 +7,11 @@
 
 #include "eden/fs/journal/Journal.h"
 
+#include <folly/executors/ManualExecutor.h>
+#include <folly/experimental/TestUtil.h>
 #include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
+#include <thread>
 
 #include "eden/fs/model/RootId.h"
 
@@ -657,3 +660,194 @@ TEST_F(JournalTest, all_subscribers_are_notified_after_any_observation) {
   EXPECT_EQ(2u, calls1);
   EXPECT_EQ(2u, calls2);
 }
+
+TEST_F(JournalTest, throttled_subscribers_are_coalesced) {
+  folly::ManualExecutor executor;
+  unsigned calls = 0;
+  auto id = journal.registerThrottledSubscriber(
+      [&] { ++calls; },
+      folly::getKeepAliveToken(executor),
+      std::chrono::steady_clock::duration::zero());
+
+  journal.recordChanged("foo"_relpath);
+  journal.getLatest();
+  journal.recordChanged("bar"_relpath);
+  // Subscribers run on the executor.
+  EXPECT_EQ(0u, calls);
+  executor.drain();
+  EXPECT_EQ(1u, calls);
+
+  journal.getLatest();
+  journal.recordChanged("baz"_relpath);
+  executor.drain();
+  EXPECT_EQ(2u, calls);
+
+  // Release the executor before it is destroyed.
+  journal.cancelSubscriber(id);
+}
+
+TEST_F(JournalTest, throttled_subscribers_see_changes_made_while_notified) {
+  folly::ManualExecutor executor;
+  unsigned calls = 0;
+  auto id = journal.registerThrottledSubscriber(
+      [&] {
+        ++calls;
+        // A change made while the subscriber runs is notified afterwards.
+        journal.getLatest();
+        if (calls == 1) {
+          journal.recordChanged("bar"_relpath);
+        }
+      },
+      folly::getKeepAliveToken(executor),
+      std::chrono::steady_clock::duration::zero());
+
+  journal.recordChanged("foo"_relpath);
+  executor.drain();
+  EXPECT_EQ(2u, calls);
+
+  journal.cancelSubscriber(id);
+}
+
+TEST_F(JournalTest, accumulate_range_under_root) {
+  journal.recordHashUpdate(RootId{"first"});
+  journal.recordCreated("foo/a"_relpath);
+  journal.recordCreated("foobar/b"_relpath);
+  journal.recordRenamed("foo/a"_relpath, "baz/a"_relpath);
+  journal.recordChanged("foo"_relpath);
+  journal.recordUncleanPaths(
+      RootId{"first"},
+      RootId{"second"},
+      {RelativePath{"foo/c"}, RelativePath{"foobar/c"}});
+  journal.recordCreated("baz/d"_relpath);
+
+  auto summed = journal.accumulateRange(2, "foo"_relpath);
+  ASSERT_NE(nullptr, summed);
+  EXPECT_EQ(2u, summed->fromSequence);
+  EXPECT_EQ(7u, summed->toSequence);
+  EXPECT_EQ(
+      (std::vector<RootId>{RootId{"first"}, RootId{"second"}}),
+      summed->snapshotTransitions);
+  EXPECT_EQ(2u, summed->changedFilesInOverlay.size());
+  EXPECT_FALSE(summed->changedFilesInOverlay["foo/a"_relpath].existedBefore);
+  EXPECT_FALSE(summed->changedFilesInOverlay["foo/a"_relpath].existedAfter);
+  EXPECT_TRUE(summed->changedFilesInOverlay["foo"_relpath].existedAfter);
+  EXPECT_EQ(
+      (std::unordered_set<RelativePath>{RelativePath{"foo/c"}}),
+      summed->uncleanPaths);
+
+  // No change under the root still reports the range that was covered.
+  summed = journal.accumulateRange(7, "foo"_relpath);
+  ASSERT_NE(nullptr, summed);
+  EXPECT_EQ(7u, summed->fromSequence);
+  EXPECT_EQ(7u, summed->toSequence);
+  EXPECT_TRUE(summed->changedFilesInOverlay.empty());
+}
+
+TEST_F(JournalTest, concurrent_writers_are_all_sequenced) {
+  constexpr size_t kThreads = 4;
+  constexpr size_t kChangesPerThread = 3000;
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < kThreads; ++i) {
+    threads.emplace_back([this, i] {
+      for (size_t j = 0; j < kChangesPerThread; ++j) {
+        journal.recordCreated(
+            RelativePath{folly::to<std::string>("dir", i, "/file", j)});
+        if (j % 100 == 0) {
+          journal.getLatest();
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(kThreads * kChangesPerThread, journal.getLatest()->sequenceID);
+  auto summed = journal.accumulateRange();
+  ASSERT_NE(nullptr, summed);
+  EXPECT_EQ(1u, summed->fromSequence);
+  EXPECT_EQ(kThreads * kChangesPerThread, summed->changedFilesInOverlay.size());
+}
+
+TEST_F(JournalTest, restores_cleanly_closed_log) {
+  folly::test::TemporaryDirectory tmpDir{"eden_journal_test_"};
+  auto logPath = AbsolutePath{tmpDir.path().string()} + "journal"_pc;
+
+  journal.attachLog(std::make_unique<JournalLog>(logPath));
+  EXPECT_EQ(std::nullopt, journal.getRestoredMountGeneration());
+  journal.setMountGeneration(42);
+  journal.recordHashUpdate(RootId{"first"});
+  journal.recordCreated("foo"_relpath);
+  journal.recordRenamed("foo"_relpath, "bar"_relpath);
+  journal.recordUncleanPaths(
+      RootId{"first"}, RootId{"second"}, {RelativePath{"baz"}});
+  journal.recordChanged("bar"_relpath);
+  journal.closeLog();
+
+  Journal restored{edenStats};
+  restored.attachLog(std::make_unique<JournalLog>(logPath));
+  EXPECT_EQ(42u, restored.getRestoredMountGeneration());
+  restored.setMountGeneration(42);
+
+  auto latest = restored.getLatest();
+  ASSERT_TRUE(latest);
+  EXPECT_EQ(5u, latest->sequenceID);
+  EXPECT_EQ(RootId{"second"}, latest->toHash);
+
+  auto summed = restored.accumulateRange(2);
+  ASSERT_NE(nullptr, summed);
+  EXPECT_FALSE(summed->isTruncated);
+  EXPECT_EQ(2u, summed->fromSequence);
+  EXPECT_EQ(5u, summed->toSequence);
+  EXPECT_EQ(
+      (std::vector<RootId>{RootId{"first"}, RootId{"second"}}),
+      summed->snapshotTransitions);
+  EXPECT_EQ(
+      (std::unordered_set<RelativePath>{RelativePath{"baz"}}),
+      summed->uncleanPaths);
+  EXPECT_EQ(2u, summed->changedFilesInOverlay.size());
+  EXPECT_FALSE(summed->changedFilesInOverlay["foo"_relpath].existedAfter);
+  EXPECT_TRUE(summed->changedFilesInOverlay["bar"_relpath].existedAfter);
+
+  restored.recordChanged("qux"_relpath);
+  EXPECT_EQ(6u, restored.getLatest()->sequenceID);
+}
+
+TEST_F(JournalTest, restores_log_written_in_batches_and_rewritten) {
+  folly::test::TemporaryDirectory tmpDir{"eden_journal_test_"};
+  auto logPath = AbsolutePath{tmpDir.path().string()} + "journal"_pc;
+
+  journal.attachLog(std::make_unique<JournalLog>(logPath));
+  journal.setMountGeneration(42);
+  // Enough records to be written in many batches and to make the log grow
+  // past the size that triggers a rewrite.
+  constexpr size_t kChanges = 50000;
+  for (size_t i = 0; i < kChanges; ++i) {
+    journal.recordCreated(RelativePath{folly::to<std::string>("file", i)});
+  }
+  journal.closeLog();
+
+  Journal restored{edenStats};
+  restored.attachLog(std::make_unique<JournalLog>(logPath));
+  EXPECT_EQ(42u, restored.getRestoredMountGeneration());
+  restored.setMountGeneration(42);
+  EXPECT_EQ(kChanges, restored.getLatest()->sequenceID);
+  auto summed = restored.accumulateRange(1);
+  ASSERT_NE(nullptr, summed);
+  EXPECT_FALSE(summed->isTruncated);
+  EXPECT_EQ(kChanges, summed->changedFilesInOverlay.size());
+}
+
+TEST_F(JournalTest, does_not_restore_log_that_was_not_closed) {
+  folly::test::TemporaryDirectory tmpDir{"eden_journal_test_"};
+  auto logPath = AbsolutePath{tmpDir.path().string()} + "journal"_pc;
+
+  journal.attachLog(std::make_unique<JournalLog>(logPath));
+  journal.setMountGeneration(42);
+  journal.recordCreated("foo"_relpath);
+
+  Journal restored{edenStats};
+  restored.attachLog(std::make_unique<JournalLog>(logPath));
+  EXPECT_EQ(std::nullopt, restored.getRestoredMountGeneration());
+  EXPECT_FALSE(restored.getLatest());
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/model/FlatTree.h"
+
+#include <folly/Bits.h>
+#include <folly/Conv.h>
+#include <folly/String.h>
+#include <folly/io/Cursor.h>
+
+#include "eden/fs/model/Tree.h"
+
+namespace facebook::eden {
+
+namespace {
+constexpr folly::StringPiece kMagic{"EdTF"};
+constexpr size_t kHeaderSize = 16;
+
+// The layout of an entry record.
+constexpr size_t kNameOffset = 0;
+constexpr size_t kNameLength = 4;
+constexpr size_t kHash = 8;
+constexpr size_t kType = kHash + Hash::RAW_SIZE;
+constexpr size_t kFlags = kType + 1;
+constexpr size_t kSize = kFlags + 1;
+constexpr size_t kSha1 = kSize + 8;
+constexpr size_t kRecordSize = kSha1 + Hash::RAW_SIZE;
+
+constexpr uint8_t kHasSize = 1 << 0;
+constexpr uint8_t kHasSha1 = 1 << 1;
+
+template <typename T>
+T load(const uint8_t* p) {
+  return folly::Endian::little(folly::loadUnaligned<T>(p));
+}
+
+[[noreturn]] void throwInvalid(folly::StringPiece reason) {
+  throw std::invalid_argument(
+      folly::to<std::string>("invalid flat tree: ", reason));
+}
+} // namespace
+
+folly::IOBuf FlatTreeView::serialize(const Tree& tree) {
+  const auto& entries = tree.getTreeEntries();
+  size_t namesSize = 0;
+  for (const auto& entry : entries) {
+    namesSize += entry.getName().stringPiece().size();
+  }
+  auto namesOffset = kHeaderSize + entries.size() * kRecordSize;
+
+  folly::IOBuf buf{folly::IOBuf::CREATE, namesOffset + namesSize};
+  folly::io::Appender appender{&buf, 0};
+  appender.push(kMagic);
+  appender.writeLE<uint32_t>(kVersion);
+  appender.writeLE(folly::to<uint32_t>(entries.size()));
+  appender.writeLE(folly::to<uint32_t>(namesOffset));
+
+  uint32_t nameOffset = 0;
+  for (const auto& entry : entries) {
+    auto name = entry.getName().stringPiece();
+    appender.writeLE<uint32_t>(nameOffset);
+    appender.writeLE(folly::to<uint32_t>(name.size()));
+    nameOffset += name.size();
+    appender.push(entry.getHash().getBytes());
+    appender.write<uint8_t>(static_cast<uint8_t>(entry.getType()));
+    const auto& size = entry.getSize();
+    const auto& sha1 = entry.getContentSha1();
+    appender.write<uint8_t>(
+        (size.has_value() ? kHasSize : 0) | (sha1.has_value() ? kHasSha1 : 0));
+    appender.writeLE<uint64_t>(size.value_or(0));
+    appender.push(sha1.value_or(Hash{}).getBytes());
+  }
+  for (const auto& entry : entries) {
+    appender.push(entry.getName().stringPiece());
+  }
+  return buf;
+}
+
+bool FlatTreeView::isFlatTree(folly::ByteRange data) {
+  return data.size() >= kMagic.size() &&
+      folly::StringPiece{data.subpiece(0, kMagic.size())} == kMagic;
+}
+
+FlatTreeView::FlatTreeView(folly::ByteRange data) : data_{data} {
+  if (data.size() < kHeaderSize || !isFlatTree(data)) {
+    throwInvalid("missing header");
+  }
+  auto version = load<uint32_t>(data.data() + 4);
+  if (version != kVersion) {
+    throwInvalid(folly::to<std::string>("unsupported version ", version));
+  }
+  entryCount_ = load<uint32_t>(data.data() + 8);
+  auto namesOffset = load<uint32_t>(data.data() + 12);
+  if (namesOffset != kHeaderSize + entryCount_ * kRecordSize ||
+      namesOffset > data.size()) {
+    throwInvalid("truncated entries");
+  }
+  names_ = data.subpiece(namesOffset);
+
+  for (size_t i = 0; i < entryCount_; ++i) {
+    auto* p = record(i);
+    uint64_t end = uint64_t{load<uint32_t>(p + kNameOffset)} +
+        load<uint32_t>(p + kNameLength);
+    if (end > names_.size()) {
+      throwInvalid("truncated names");
+    }
+    if (p[kType] > static_cast<uint8_t>(TreeEntryType::SYMLINK)) {
+      throwInvalid(folly::to<std::string>("unknown entry type ", p[kType]));
+    }
+  }
+}
+
+const uint8_t* FlatTreeView::record(size_t index) const {
+  return data_.data() + kHeaderSize + index * kRecordSize;
+}
+
+folly::StringPiece FlatTreeView::getNameBytes(size_t index) const {
+  auto* p = record(index);
+  return folly::StringPiece{names_.subpiece(
+      load<uint32_t>(p + kNameOffset), load<uint32_t>(p + kNameLength))};
+}
+
+PathComponentPiece FlatTreeView::getName(size_t index) const {
+  // The names were valid path components when serialized.
+  return PathComponentPiece{getNameBytes(index), detail::SkipPathSanityCheck{}};
+}
+
+Hash FlatTreeView::getHash(size_t index) const {
+  return Hash{folly::ByteRange{record(index) + kHash, Hash::RAW_SIZE}};
+}
+
+TreeEntryType FlatTreeView::getType(size_t index) const {
+  return static_cast<TreeEntryType>(record(index)[kType]);
+}
+
+std::optional<uint64_t> FlatTreeView::getSize(size_t index) const {
+  auto* p = record(index);
+  if (!(p[kFlags] & kHasSize)) {
+    return std::nullopt;
+  }
+  return load<uint64_t>(p + kSize);
+}
+
+std::optional<Hash> FlatTreeView::getContentSha1(size_t index) const {
+  auto* p = record(index);
+  if (!(p[kFlags] & kHasSha1)) {
+    return std::nullopt;
+  }
+  return Hash{folly::ByteRange{p + kSha1, Hash::RAW_SIZE}};
+}
+
+std::optional<size_t> FlatTreeView::find(PathComponentPiece name) const {
+  auto target = name.stringPiece();
+  size_t low = 0;
+  size_t high = entryCount_;
+  while (low < high) {
+    auto mid = low + (high - low) / 2;
+    if (getNameBytes(mid) < target) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  if (low < entryCount_ && getNameBytes(low) == target) {
+    return low;
+  }
+#ifdef _WIN32
+  // Like Tree::getEntryPtr(), fall back to a case insensitive lookup.
+  for (size_t i = 0; i < entryCount_; ++i) {
+    if (getNameBytes(i).equals(target, folly::AsciiCaseInsensitive())) {
+      return i;
+    }
+  }
+#endif
+  return std::nullopt;
+}
+
+TreeEntry FlatTreeView::getEntry(size_t index) const {
+  return TreeEntry{
+      getHash(index),
+      getName(index).copy(),
+      getType(index),
+      getSize(index),
+      getContentSha1(index)};
+}
+
+std::unique_ptr<Tree> FlatTreeView::toTree(const Hash& hash) const {
+  std::vector<TreeEntry> entries;
+  entries.reserve(entryCount_);
+  for (size_t i = 0; i < entryCount_; ++i) {
+    entries.push_back(getEntry(i));
+  }
+  return std::make_unique<Tree>(std::move(entries), hash);
+}
+
+} // namespace facebook::eden
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <folly/io/IOBuf.h>
+#include <memory>
+#include <optional>
+
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/model/TreeEntry.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook::eden {
+
+class Tree;
+
+/**
+ * A read-only view of a tree serialized in the flat format, which can be
+ * used in place, without deserializing or allocating, from a buffer read
+ * from the LocalStore.
+ *
+ * The format is versioned and little-endian:
+ *
+ * - A header: the "EdTF" magic, the version, the number of entries and the
+ *   offset of the name pool, each a u32.
+ * - One fixed-size record per entry, sorted by name: the offset of the name
+ *   in the pool and its length (u32 each), the hash, the entry type (u8), a
+ *   u8 of flags telling which of the following are set, the size (u64) and
+ *   the SHA-1 of the contents.
+ * - The name pool.
+ *
+ * Since the records have a fixed size, looking up a name is a binary search
+ * over the buffer.
+ */
+class FlatTreeView {
+ public:
+  static constexpr uint32_t kVersion = 1;
+
+  /**
+   * Serialize the tree, including the size and SHA-1 of its entries when
+   * they are known.
+   */
+  static folly::IOBuf serialize(const Tree& tree);
+
+  /**
+   * Whether the data starts with the header of the flat format. Trees
+   * serialized in the Git format don't.
+   */
+  static bool isFlatTree(folly::ByteRange data);
+
+  /**
+   * Validate the header and the entry records, throwing
+   * std::invalid_argument if the data is truncated or of an unknown
+   * version. The data must outlive the view.
+   */
+  explicit FlatTreeView(folly::ByteRange data);
+
+  size_t size() const {
+    return entryCount_;
+  }
+
+  PathComponentPiece getName(size_t index) const;
+  Hash getHash(size_t index) const;
+  TreeEntryType getType(size_t index) const;
+  std::optional<uint64_t> getSize(size_t index) const;
+  std::optional<Hash> getContentSha1(size_t index) const;
+
+  /**
+   * Find the entry with the given name, returning its index.
+   */
+  std::optional<size_t> find(PathComponentPiece name) const;
+
+  TreeEntry getEntry(size_t index) const;
+
+  /**
+   * Deserialize all the entries into a Tree.
+   */
+  std::unique_ptr<Tree> toTree(const Hash& hash) const;
+
+ private:
+  const uint8_t* record(size_t index) const;
+  folly::StringPiece getNameBytes(size_t index) const;
+
+  folly::ByteRange data_;
+  size_t entryCount_;
+  folly::ByteRange names_;
+};
+
+} // namespace facebook::eden
@@ -48,14 +48,6 @@ size_t Hash::getHashCode() const noexcept {
   return result;
 }
 
-bool Hash::operator==(const Hash& otherHash) const {
-  return bytes_ == otherHash.bytes_;
-}
-
-bool Hash::operator<(const Hash& otherHash) const {
-  return bytes_ < otherHash.bytes_;
-}
-
 Hash Hash::sha1(const folly::IOBuf& buf) {
   Storage hashBytes;
   OpenSSLHash::sha1(range(hashBytes), buf);
@@ -9,8 +9,10 @@
 
 #include <boost/operators.hpp>
 #include <folly/Range.h>
+#include <folly/lang/Bits.h>
 #include <stdint.h>
 #include <array>
+#include <cstring>
 #include <iosfwd>
 
 namespace folly {
@@ -73,10 +75,42 @@ class Hash20 : boost::totally_ordered<Hash20> {
 
   size_t getHashCode() const noexcept;
 
-  bool operator==(const Hash20&) const;
-  bool operator<(const Hash20&) const;
+  /**
+   * Hashes are compared a word at a time rather than byte by byte, since
+   * diffing trees and looking up sorted containers compare a lot of them.
+   */
+  bool operator==(const Hash20& other) const noexcept {
+    return ((loadWord<uint64_t>(0) ^ other.loadWord<uint64_t>(0)) |
+            (loadWord<uint64_t>(8) ^ other.loadWord<uint64_t>(8)) |
+            (loadWord<uint32_t>(16) ^ other.loadWord<uint32_t>(16))) == 0;
+  }
+
+  /**
+   * Orders hashes like their bytes, by comparing big-endian words.
+   */
+  bool operator<(const Hash20& other) const noexcept {
+    auto word = folly::Endian::big(loadWord<uint64_t>(0));
+    auto otherWord = folly::Endian::big(other.loadWord<uint64_t>(0));
+    if (word != otherWord) {
+      return word < otherWord;
+    }
+    word = folly::Endian::big(loadWord<uint64_t>(8));
+    otherWord = folly::Endian::big(other.loadWord<uint64_t>(8));
+    if (word != otherWord) {
+      return word < otherWord;
+    }
+    return folly::Endian::big(loadWord<uint32_t>(16)) <
+        folly::Endian::big(other.loadWord<uint32_t>(16));
+  }
 
  private:
+  template <typename Word>
+  Word loadWord(size_t offset) const noexcept {
+    Word word;
+    std::memcpy(&word, bytes_.data() + offset, sizeof(Word));
+    return word;
+  }
+
   static constexpr Storage constructFromByteRange(folly::ByteRange bytes) {
     if (bytes.size() != RAW_SIZE) {
       throwInvalidArgument(
@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <memory>
 #include <string>
 #include "eden/fs/model/git/GitIgnore.h"
 #include "eden/fs/utils/PathFuncs.h"
@@ -56,10 +57,22 @@ class GitIgnoreStack {
       const GitIgnoreStack* parent,
       folly::StringPiece ignoreFileContents)
       : parent_{parent} {
-    ignore_.loadFile(ignoreFileContents);
+    auto ignore = std::make_shared<GitIgnore>();
+    ignore->loadFile(ignoreFileContents);
+    ignore_ = std::move(ignore);
   }
 
   GitIgnoreStack(const GitIgnoreStack* parent, GitIgnore ignore)
+      : ignore_{std::make_shared<const GitIgnore>(std::move(ignore))},
+        parent_{parent} {}
+
+  /**
+   * Create a new GitIgnoreStack for a directory whose .gitignore file has
+   * already been parsed, sharing its rules rather than copying them.
+   */
+  GitIgnoreStack(
+      const GitIgnoreStack* parent,
+      std::shared_ptr<const GitIgnore> ignore)
       : ignore_{std::move(ignore)}, parent_{parent} {}
 
   /**
@@ -70,14 +83,16 @@ class GitIgnoreStack {
       GitIgnore::FileType fileType) const;
 
   bool empty() const {
-    return ignore_.empty();
+    return !ignore_ || ignore_->empty();
   }
 
  private:
   /**
-   * The GitIgnore info for this node on the stack
+   * The GitIgnore info for this node on the stack, or nullptr when the
+   * directory has no .gitignore file. It may be shared with the
+   * GitIgnoreCache of the mount.
    */
-  GitIgnore ignore_;
+  std::shared_ptr<const GitIgnore> ignore_;
 
   /**
    * A pointer to the next node in the stack.
@@ -8,9 +8,11 @@
 #include "GitTree.h"
 #include <folly/Format.h>
 #include <folly/String.h>
+#include <algorithm>
 #include <array>
 #include <cstdio>
 #include <cstring>
+#include <limits>
 #include <string>
 #include "eden/fs/model/Hash.h"
 #include "eden/fs/model/Tree.h"
@@ -32,44 +34,119 @@ enum GitModeMask {
   SYMLINK = 0120000,
 };
 
+namespace {
+
+// The number of bytes of an average tree entry, used to size the entries
+// vector up front: a mode, a short name and a 20 byte hash.
+constexpr size_t kEstimatedEntrySize = 40;
+
+/**
+ * Find `delimiter` within the next `maxLength` bytes of [pos, end), or return
+ * nullptr. memchr is vectorized by the C library, which is what makes the
+ * scan of the names of large trees cheap.
+ */
+const char* findDelimiter(
+    const char* pos,
+    const char* end,
+    char delimiter,
+    size_t maxLength) {
+  size_t length = std::min(static_cast<size_t>(end - pos), maxLength);
+  return static_cast<const char*>(memchr(pos, delimiter, length));
+}
+
+// Parse the octal mode of an entry, without using an intermediate string.
+int parseMode(folly::StringPiece modeStr) {
+  if (modeStr.empty()) {
+    throw invalid_argument("Did not parse expected number of octal chars.");
+  }
+  int mode = 0;
+  for (char c : modeStr) {
+    if (c < '0' || c > '7') {
+      throw invalid_argument("Did not parse expected number of octal chars.");
+    }
+    mode = (mode << 3) | (c - '0');
+  }
+  return mode;
+}
+
+} // namespace
+
 std::unique_ptr<Tree> deserializeGitTree(
     const Hash& hash,
     const IOBuf* treeData) {
-  folly::io::Cursor cursor(treeData);
+  if (!treeData->isChained()) {
+    return deserializeGitTree(
+        hash, folly::ByteRange{treeData->data(), treeData->length()});
+  }
+  // The parser works on contiguous memory. Trees read from git are never
+  // chained, so this copy is only made for callers that built the buffer
+  // piecewise.
+  auto coalesced = treeData->cloneCoalescedAsValue();
+  return deserializeGitTree(
+      hash, folly::ByteRange{coalesced.data(), coalesced.length()});
+}
+
+std::unique_ptr<Tree> deserializeGitTree(
+    const Hash& hash,
+    folly::ByteRange treeData) {
+  auto* pos = reinterpret_cast<const char*>(treeData.data());
+  auto* end = pos + treeData.size();
 
   // Find the end of the header and extract the size.
-  if (cursor.readFixedString(5) != "tree ") {
+  constexpr folly::StringPiece kHeader{"tree "};
+  if (!folly::StringPiece{pos, end}.startsWith(kHeader)) {
     throw invalid_argument("Contents did not start with expected header.");
   }
+  pos += kHeader.size();
 
   // 25 characters is long enough to represent any legitimate length
   size_t maxSizeLength = 25;
-  auto sizeStr = cursor.readTerminatedString('\0', maxSizeLength);
-  auto contentSize = folly::to<unsigned int>(sizeStr);
-  if (contentSize != cursor.length()) {
+  auto* sizeEnd = findDelimiter(pos, end, '\0', maxSizeLength);
+  if (!sizeEnd) {
+    throw invalid_argument("Tree header is not terminated.");
+  }
+  auto contentSize = folly::to<unsigned int>(folly::StringPiece{pos, sizeEnd});
+  pos = sizeEnd + 1;
+  if (contentSize != static_cast<size_t>(end - pos)) {
     throw invalid_argument("Size in header should match contents");
   }
 
-  // Scan the data and populate entries, as appropriate.
+  // Scan the data and populate entries, as appropriate. The entries point
+  // straight into the buffer: only the names are copied, once, into their
+  // PathComponent.
   vector<TreeEntry> entries;
-  while (!cursor.isAtEnd()) {
+  entries.reserve(contentSize / kEstimatedEntrySize);
+  while (pos != end) {
     // Extract the mode.
     // This should only be 6 or 7 characters.
     // Stop scanning if we haven't seen a space in 10 characters
     size_t maxModeLength = 10;
-    auto modeStr = cursor.readTerminatedString(' ', maxModeLength);
-    size_t modeEndIndex;
-    auto mode = std::stoi(modeStr, &modeEndIndex, /* base */ 8);
-    if (modeEndIndex != modeStr.size()) {
-      throw invalid_argument("Did not parse expected number of octal chars.");
+    auto* modeEnd = findDelimiter(pos, end, ' ', maxModeLength);
+    if (!modeEnd) {
+      throw invalid_argument(folly::sformat(
+          "Truncated entry mode in object {}", hash.toString()));
     }
+    auto mode = parseMode(folly::StringPiece{pos, modeEnd});
+    pos = modeEnd + 1;
 
     // Extract the name.
-    auto name = cursor.readTerminatedString();
+    auto* nameEnd =
+        findDelimiter(pos, end, '\0', std::numeric_limits<size_t>::max());
+    if (!nameEnd) {
+      throw invalid_argument(folly::sformat(
+          "Truncated entry name in object {}", hash.toString()));
+    }
+    folly::StringPiece name{pos, nameEnd};
+    pos = nameEnd + 1;
 
     // Extract the hash.
-    Hash::Storage hashBytes;
-    cursor.pull(hashBytes.data(), hashBytes.size());
+    if (static_cast<size_t>(end - pos) < Hash::RAW_SIZE) {
+      throw invalid_argument(folly::sformat(
+          "Truncated entry hash in object {}", hash.toString()));
+    }
+    auto* hashBytes = reinterpret_cast<const uint8_t*>(pos);
+    Hash entryHash{folly::ByteRange{hashBytes, Hash::RAW_SIZE}};
+    pos += Hash::RAW_SIZE;
 
     // Determine the individual fields from the mode.
 
@@ -92,21 +169,12 @@ std::unique_ptr<Tree> deserializeGitTree(
           "Unrecognized mode: {:o} in object {}", mode, hash.toString()));
     }
 
-    entries.emplace_back(
-        Hash(hashBytes), PathComponent{std::move(name)}, fileType);
+    entries.emplace_back(entryHash, PathComponent{name}, fileType);
   }
 
   return std::make_unique<Tree>(std::move(entries), hash);
 }
 
-// Convenience wrapper which accepts a ByteRange
-std::unique_ptr<Tree> deserializeGitTree(
-    const Hash& hash,
-    folly::ByteRange treeData) {
-  IOBuf buf(IOBuf::WRAP_BUFFER, treeData);
-  return deserializeGitTree(hash, &buf);
-}
-
 enum size_t {
   // Initially allocate 4kb of data for the tree buffer.
   INITIAL_TREE_BUF_SIZE = 4096,
@@ -21,6 +21,9 @@ class TreeEntry;
 /**
  * Creates an Eden Tree from the serialized version of a Git tree object.
  * As such, the SHA-1 of the gitTreeObject should match the hash.
+ *
+ * Trees the LocalStore saved in the flat format are read with FlatTreeView
+ * instead, and never go through this parser.
  */
 std::unique_ptr<Tree> deserializeGitTree(
     const Hash& hash,
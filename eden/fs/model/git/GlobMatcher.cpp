@@ -90,7 +90,48 @@ bool operator&(GlobOptions a, GlobOptions b) {
 }
 
 GlobMatcher::GlobMatcher(vector<uint8_t> pattern)
-    : pattern_(std::move(pattern)) {}
+    : pattern_(std::move(pattern)) {
+  classify();
+}
+
+void GlobMatcher::classify() {
+  shape_ = Shape::GENERIC;
+  if (pattern_.empty()) {
+    // Only matches the empty string.
+    shape_ = Shape::LITERAL;
+    literalIdx_ = 0;
+    literalLength_ = 0;
+    return;
+  }
+
+  if (pattern_[0] == GLOB_LITERAL) {
+    // GLOB_LITERAL length data [GLOB_STAR bool]
+    uint8_t length = pattern_[1];
+    size_t literalEnd = 2 + length;
+    if (literalEnd == pattern_.size()) {
+      shape_ = Shape::LITERAL;
+    } else if (
+        literalEnd + 2 == pattern_.size() &&
+        pattern_[literalEnd] == GLOB_STAR) {
+      shape_ = Shape::STARTS_WITH;
+      starMatchCanStartWithDot_ = pattern_[literalEnd + 1] == GLOB_TRUE;
+    } else {
+      return;
+    }
+    literalIdx_ = 2;
+    literalLength_ = length;
+  } else if (pattern_[0] == GLOB_ENDS_WITH) {
+    // GLOB_ENDS_WITH bool length data
+    uint8_t length = pattern_[2];
+    if (3 + size_t{length} != pattern_.size()) {
+      return;
+    }
+    shape_ = Shape::ENDS_WITH;
+    starMatchCanStartWithDot_ = pattern_[1] == GLOB_TRUE;
+    literalIdx_ = 3;
+    literalLength_ = length;
+  }
+}
 
 GlobMatcher::GlobMatcher() {}
 
@@ -467,6 +508,43 @@ bool GlobMatcher::addCharClass(
 }
 
 bool GlobMatcher::match(StringPiece text) const {
+  // The fast paths only compare the literal and scan for '/' with memcmp()
+  // and memchr(), which the C library vectorizes.
+  const uint8_t* literal = pattern_.data() + literalIdx_;
+  switch (shape_) {
+    case Shape::LITERAL:
+      return text.size() == literalLength_ &&
+          (literalLength_ == 0 ||
+           0 == memcmp(text.data(), literal, literalLength_));
+    case Shape::ENDS_WITH: {
+      if (text.size() < literalLength_) {
+        return false;
+      }
+      // Like the GLOB_ENDS_WITH opcode, reject a text starting with a dot
+      // matched by the '*', even if the '*' matches nothing.
+      if (!starMatchCanStartWithDot_ && !text.empty() && text[0] == '.') {
+        return false;
+      }
+      auto starLength = text.size() - literalLength_;
+      return 0 ==
+          memcmp(text.data() + starLength, literal, literalLength_) &&
+          memchr(text.data(), '/', starLength) == nullptr;
+    }
+    case Shape::STARTS_WITH: {
+      if (text.size() < literalLength_ ||
+          0 != memcmp(text.data(), literal, literalLength_)) {
+        return false;
+      }
+      auto starLength = text.size() - literalLength_;
+      if (!starMatchCanStartWithDot_ && starLength > 0 &&
+          text[literalLength_] == '.') {
+        return false;
+      }
+      return memchr(text.data() + literalLength_, '/', starLength) == nullptr;
+    }
+    case Shape::GENERIC:
+      break;
+  }
   return tryMatchAt(text, 0, 0);
 }
 
@@ -37,6 +37,10 @@ bool operator&(GlobOptions a, GlobOptions b);
  * allowing it to perform matches more efficiently.  (In basic benchmarks I
  * have run it ranges from 50% to 100% faster than the wildmatch()
  * implementation used by git, depending on the pattern.)
+ *
+ * The most common shapes of patterns, fixed strings, "*.ext" and "prefix*",
+ * are recognized when the pattern is created and matched directly, without
+ * interpreting the pattern buffer.
  */
 class GlobMatcher {
  public:
@@ -78,6 +82,28 @@ class GlobMatcher {
  private:
   explicit GlobMatcher(std::vector<uint8_t> pattern);
 
+  /**
+   * The shapes of patterns that match() handles without running the opcodes
+   * of the pattern buffer.
+   */
+  enum class Shape : uint8_t {
+    // Any other pattern: interpret the pattern buffer.
+    GENERIC,
+    // A single literal: the text must be equal to it.
+    LITERAL,
+    // "*" followed by a literal: the text must end with it, and the text
+    // before it must not contain '/'.
+    ENDS_WITH,
+    // A literal followed by "*": the text must start with it, and the text
+    // after it must not contain '/'.
+    STARTS_WITH,
+  };
+
+  /**
+   * Recognize the shape of pattern_, and record where its literal is.
+   */
+  void classify();
+
   static folly::Expected<size_t, std::string> parseBracketExpr(
       folly::StringPiece glob,
       size_t idx,
@@ -116,6 +142,15 @@ class GlobMatcher {
    * rather than heap-allocating them in a vector.
    */
   std::vector<uint8_t> pattern_;
+
+  Shape shape_{Shape::LITERAL};
+  // For ENDS_WITH and STARTS_WITH, whether the text matched by the "*" may
+  // start with a '.'.
+  bool starMatchCanStartWithDot_{true};
+  // The position of the literal of a LITERAL, ENDS_WITH or STARTS_WITH
+  // pattern in pattern_.
+  uint16_t literalIdx_{0};
+  uint8_t literalLength_{0};
 };
 
 } // namespace facebook::eden
@@ -162,6 +162,27 @@ TEST(GitTree, deserializeEmpty) {
   EXPECT_EQ(0, tree->getTreeEntries().size());
 }
 
+TEST(GitTree, deserializeChainedBuffer) {
+  // An entry split across the buffers of the chain, in the middle of its
+  // name and of its hash.
+  auto data = folly::to<string>(
+      string("tree 43\x00", 8),
+      string("100644 apm-rest-api.md\x00", 23),
+      toBinaryHash("a3c8e5c25e5523322f0ea490173dbdc1d844aefb"));
+  auto head = IOBuf::copyBuffer(data.data(), 20);
+  head->prependChain(IOBuf::copyBuffer(data.data() + 20, 20));
+  head->prependChain(IOBuf::copyBuffer(data.data() + 40, data.size() - 40));
+  ASSERT_TRUE(head->isChained());
+
+  auto tree = deserializeGitTree(Hash::sha1(*head), head.get());
+  ASSERT_EQ(1, tree->getTreeEntries().size());
+  auto entry = tree->getEntryAt(0);
+  EXPECT_EQ("apm-rest-api.md", entry.getName());
+  EXPECT_EQ(
+      Hash("a3c8e5c25e5523322f0ea490173dbdc1d844aefb"), entry.getHash());
+  EXPECT_EQ(TreeEntryType::REGULAR_FILE, entry.getType());
+}
+
 TEST(GitTree, testBadDeserialize) {
   Hash zero("0000000000000000000000000000000000000000");
   // Partial header
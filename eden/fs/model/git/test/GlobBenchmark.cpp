@@ -211,6 +211,26 @@ GBENCHMARK(endswith_fixed)(benchmark::State& state) {
   runBenchmark<EndsWithImpl>(state, ".txt", basenameCorpus);
 }
 
+GBENCHMARK(startswith_globmatch)(benchmark::State& state) {
+  runBenchmark<GlobMatcherImpl>(state, "foo*", basenameCorpus);
+}
+
+GBENCHMARK(startswith_wildmatch)(benchmark::State& state) {
+  runBenchmark<WildmatchImpl>(state, "foo*", basenameCorpus);
+}
+
+GBENCHMARK(startswith_re2)(benchmark::State& state) {
+  runBenchmark<RE2Impl>(state, "foo[^/]*", basenameCorpus);
+}
+
+GBENCHMARK(fullEndswith_globmatch)(benchmark::State& state) {
+  runBenchmark<GlobMatcherImpl>(state, "*.c", fullnameCorpus);
+}
+
+GBENCHMARK(fullEndswith_wildmatch)(benchmark::State& state) {
+  runBenchmark<WildmatchImpl>(state, "*.c", fullnameCorpus);
+}
+
 GBENCHMARK(basenameGlob_globmatch)(benchmark::State& state) {
   runBenchmark<GlobMatcherImpl>(state, ".*.swp", basenameCorpus);
 }
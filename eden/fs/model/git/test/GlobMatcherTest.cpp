@@ -328,6 +328,37 @@ TEST(Glob, testOther) {
   EXPECT_NOMATCH("foo\x9atest", "foo[\xa0-\xaf]test");
 }
 
+TEST(Glob, testSimpleShapes) {
+  // These patterns are matched without interpreting the pattern buffer, but
+  // must behave exactly like the general matcher.
+  EXPECT_TRUE(GlobMatcher().match(""));
+  EXPECT_FALSE(GlobMatcher().match("a"));
+
+  EXPECT_MATCH("node_modules", "node_modules");
+  EXPECT_NOMATCH("node_module", "node_modules");
+  EXPECT_NOMATCH("node_modules/", "node_modules");
+
+  EXPECT_MATCH("buck-out", "buck-out*");
+  EXPECT_MATCH("buck-out-2", "buck-out*");
+  EXPECT_MATCH("buck-out.tmp", "buck-out*");
+  EXPECT_NOMATCH("buck-ou", "buck-out*");
+  EXPECT_NOMATCH("buck-out/gen", "buck-out*");
+  EXPECT_MATCH("foo/bar", "foo/*");
+  EXPECT_NOMATCH("foo/bar/baz", "foo/*");
+  EXPECT_IGNORE_DOTFILES_NOMATCH("foo/.bar", "foo/*");
+  EXPECT_IGNORE_DOTFILES_MATCH("foo/bar", "foo/*");
+  EXPECT_IGNORE_DOTFILES_MATCH("foo.bar", "foo*");
+
+  EXPECT_MATCH("main.o", "*.o");
+  EXPECT_MATCH(".o", "*.o");
+  EXPECT_NOMATCH("main.c", "*.o");
+  EXPECT_NOMATCH("o", "*.o");
+  EXPECT_NOMATCH("dir/main.o", "*.o");
+  EXPECT_IGNORE_DOTFILES_NOMATCH(".o", "*.o");
+  EXPECT_IGNORE_DOTFILES_NOMATCH(".main.o", "*.o");
+  EXPECT_IGNORE_DOTFILES_MATCH("main.o", "*.o");
+}
+
 void testCharClass(StringPiece name, int (*libcFn)(int)) {
   auto matcher =
       GlobMatcher::create("[[:" + name.str() + ":]]", GlobOptions::DEFAULT)
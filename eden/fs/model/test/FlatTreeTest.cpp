@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/model/FlatTree.h"
+
+#include <folly/portability/GTest.h>
+
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/model/Tree.h"
+#include "eden/fs/model/TreeEntry.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+using facebook::eden::FlatTreeView;
+using facebook::eden::Hash;
+using facebook::eden::PathComponent;
+using facebook::eden::PathComponentPiece;
+using facebook::eden::Tree;
+using facebook::eden::TreeEntry;
+using facebook::eden::TreeEntryType;
+using std::vector;
+
+namespace {
+Hash fileHash("faceb00cdeadbeefc00010ff1badb0028badf00d");
+Hash dirHash("0123456789abcdef0123456789abcdef01234567");
+Hash sha1("da39a3ee5e6b4b0d3255bfef95601890afd80709");
+
+Tree makeTree() {
+  vector<TreeEntry> entries;
+  entries.emplace_back(
+      fileHash,
+      PathComponent{"a_file"},
+      TreeEntryType::REGULAR_FILE,
+      42,
+      sha1);
+  entries.emplace_back(dirHash, PathComponent{"b_dir"}, TreeEntryType::TREE);
+  entries.emplace_back(
+      fileHash, PathComponent{"c_exe"}, TreeEntryType::EXECUTABLE_FILE);
+  return Tree{std::move(entries)};
+}
+
+folly::ByteRange bytes(const folly::IOBuf& buf) {
+  return folly::ByteRange{buf.data(), buf.length()};
+}
+} // namespace
+
+TEST(FlatTree, testRoundTrip) {
+  auto tree = makeTree();
+  auto buf = FlatTreeView::serialize(tree);
+  ASSERT_TRUE(FlatTreeView::isFlatTree(bytes(buf)));
+
+  FlatTreeView view{bytes(buf)};
+  ASSERT_EQ(3, view.size());
+  EXPECT_EQ(PathComponentPiece{"a_file"}, view.getName(0));
+  EXPECT_EQ(fileHash, view.getHash(0));
+  EXPECT_EQ(TreeEntryType::REGULAR_FILE, view.getType(0));
+  EXPECT_EQ(42, view.getSize(0));
+  EXPECT_EQ(sha1, view.getContentSha1(0));
+  EXPECT_EQ(TreeEntryType::TREE, view.getType(1));
+  EXPECT_FALSE(view.getSize(1).has_value());
+  EXPECT_FALSE(view.getContentSha1(1).has_value());
+
+  auto copy = view.toTree(dirHash);
+  EXPECT_EQ(dirHash, copy->getHash());
+  EXPECT_EQ(tree.getTreeEntries(), copy->getTreeEntries());
+  EXPECT_EQ(42, copy->getTreeEntries()[0].getSize());
+}
+
+TEST(FlatTree, testFind) {
+  auto buf = FlatTreeView::serialize(makeTree());
+  FlatTreeView view{bytes(buf)};
+
+  EXPECT_EQ(0, view.find(PathComponentPiece{"a_file"}));
+  EXPECT_EQ(1, view.find(PathComponentPiece{"b_dir"}));
+  EXPECT_EQ(2, view.find(PathComponentPiece{"c_exe"}));
+  EXPECT_FALSE(view.find(PathComponentPiece{"b"}).has_value());
+  EXPECT_FALSE(view.find(PathComponentPiece{"d"}).has_value());
+}
+
+TEST(FlatTree, testEmptyTree) {
+  auto buf = FlatTreeView::serialize(Tree{vector<TreeEntry>{}});
+  FlatTreeView view{bytes(buf)};
+  EXPECT_EQ(0, view.size());
+  EXPECT_FALSE(view.find(PathComponentPiece{"a"}).has_value());
+}
+
+TEST(FlatTree, testRejectsTruncatedData) {
+  auto buf = FlatTreeView::serialize(makeTree());
+  auto data = bytes(buf);
+  EXPECT_THROW(FlatTreeView{data.subpiece(0, 8)}, std::invalid_argument);
+  EXPECT_THROW(
+      FlatTreeView{data.subpiece(0, data.size() - 1)}, std::invalid_argument);
+}
+
+TEST(FlatTree, testRejectsUnknownVersion) {
+  auto buf = FlatTreeView::serialize(makeTree());
+  buf.writableData()[4] = FlatTreeView::kVersion + 1;
+  EXPECT_THROW(FlatTreeView{bytes(buf)}, std::invalid_argument);
+}
+
+TEST(FlatTree, testGitTreesAreNotFlat) {
+  folly::StringPiece git{"tree 0\0", 7};
+  EXPECT_FALSE(FlatTreeView::isFlatTree(folly::ByteRange{git}));
+}
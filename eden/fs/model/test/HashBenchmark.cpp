@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/model/Hash.h"
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace facebook::eden;
+
+namespace {
+
+std::vector<Hash> randomHashes(size_t count) {
+  std::mt19937 generator{0};
+  std::vector<Hash> hashes;
+  hashes.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    Hash::Storage bytes;
+    std::generate(bytes.begin(), bytes.end(), [&] { return generator(); });
+    hashes.emplace_back(bytes);
+  }
+  return hashes;
+}
+
+} // namespace
+
+// Diffing compares the hashes of entries that are usually identical, which
+// is the worst case for an early-exit comparison.
+static void BM_equalHashes(benchmark::State& state) {
+  auto hashes = randomHashes(1024);
+  auto copies = hashes;
+  for (auto _ : state) {
+    size_t equal = 0;
+    for (size_t i = 0; i < hashes.size(); ++i) {
+      equal += hashes[i] == copies[i];
+    }
+    benchmark::DoNotOptimize(equal);
+  }
+  state.SetItemsProcessed(state.iterations() * hashes.size());
+}
+BENCHMARK(BM_equalHashes);
+
+static void BM_equalHashesWithMemcmp(benchmark::State& state) {
+  auto hashes = randomHashes(1024);
+  auto copies = hashes;
+  for (auto _ : state) {
+    size_t equal = 0;
+    for (size_t i = 0; i < hashes.size(); ++i) {
+      equal += memcmp(
+                   hashes[i].getBytes().data(),
+                   copies[i].getBytes().data(),
+                   Hash::RAW_SIZE) == 0;
+    }
+    benchmark::DoNotOptimize(equal);
+  }
+  state.SetItemsProcessed(state.iterations() * hashes.size());
+}
+BENCHMARK(BM_equalHashesWithMemcmp);
+
+static void BM_sortHashes(benchmark::State& state) {
+  auto hashes = randomHashes(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto sorted = hashes;
+    state.ResumeTiming();
+    std::sort(sorted.begin(), sorted.end());
+    benchmark::DoNotOptimize(sorted.data());
+  }
+  state.SetItemsProcessed(state.iterations() * hashes.size());
+}
+BENCHMARK(BM_sortHashes)->Arg(1024)->Arg(65536);
@@ -217,3 +217,22 @@ TEST(Hash, getHashCode) {
   // using 64 bits of data to contribute to the hash code.
   EXPECT_EQ(folly::Endian::big(0xfaceb00cdeadbeef), testHash.getHashCode());
 }
+
+TEST(Hash, comparisonsMatchTheBytes) {
+  // Flip each byte in turn, so that every word of the hash decides the
+  // comparison at least once.
+  for (size_t i = 0; i < Hash::RAW_SIZE; ++i) {
+    Hash::Storage lowBytes{};
+    Hash::Storage highBytes{};
+    highBytes[i] = 0x80;
+    lowBytes[Hash::RAW_SIZE - 1 - i] = 0x01;
+    Hash low{lowBytes};
+    Hash high{highBytes};
+
+    EXPECT_EQ(lowBytes < highBytes, low < high) << i;
+    EXPECT_EQ(highBytes < lowBytes, high < low) << i;
+    EXPECT_NE(low, high) << i;
+    EXPECT_FALSE(high < high) << i;
+    EXPECT_EQ(Hash{highBytes}, high) << i;
+  }
+}
@@ -96,7 +96,12 @@ EdenMonitor::EdenMonitor(
 
   auto maxLogSize = config->maxLogFileSize.getValue();
   unique_ptr<LogRotationStrategy> rotationStrategy;
-  if (maxLogSize > 0) {
+  if (maxLogSize > 0 && config->compressRotatedLogs.getValue()) {
+    rotationStrategy = make_unique<CompressedTimestampLogRotation>(
+        config->maxRotatedLogFiles.getValue(),
+        config->maxRotatedLogBytes.getValue(),
+        config->logCompressionBytesPerSecond.getValue());
+  } else if (maxLogSize > 0) {
     rotationStrategy = make_unique<TimestampLogRotation>(
         config->maxRotatedLogFiles.getValue());
   }
@@ -8,14 +8,26 @@
 #include "eden/fs/monitor/LogRotation.h"
 
 #include <boost/filesystem.hpp>
+#include <fcntl.h>
 #include <fmt/format.h>
 #include <time.h>
+#include <algorithm>
 #include <chrono>
-#include <queue>
+#include <thread>
+#include <vector>
 
+#include <folly/Exception.h>
+#include <folly/File.h>
+#include <folly/FileUtil.h>
 #include <folly/Range.h>
+#include <folly/ScopeGuard.h>
+#include <folly/compression/Compression.h>
 #include <folly/logging/xlog.h>
+#include <folly/portability/SysResource.h>
 #include <folly/portability/SysStat.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 #include "eden/fs/utils/Clock.h"
 
@@ -25,6 +37,11 @@ namespace fs = boost::filesystem;
 namespace facebook {
 namespace eden {
 
+namespace {
+constexpr folly::StringPiece kTemporaryExtension{".tmp"};
+constexpr size_t kCompressionChunkSize = 1024 * 1024;
+} // namespace
+
 LogRotationStrategy::~LogRotationStrategy() {}
 
 TimestampLogRotation::TimestampLogRotation(
@@ -152,19 +169,18 @@ std::string TimestampLogRotation::appendLogSuffix(
 }
 
 void TimestampLogRotation::performRotation(const AbsolutePath&) {
-  // For now we simply prune old log files.
-  // In the future perhaps we could also compress the new log file.
+  // Simply prune old log files.  CompressedTimestampLogRotation also
+  // compresses the new one.
   removeOldLogFiles();
 }
 
 void TimestampLogRotation::removeOldLogFiles() {
-  // Clean up old log files so that we have at most numFilesToKeep_ old files.
-  // Keep a priority queue of the newest numFilesToKeep_ rotated file names
-  std::priority_queue<
-      FileSuffix,
-      std::vector<FileSuffix>,
-      std::greater<FileSuffix>>
-      filesToKeep;
+  struct RotatedFile {
+    FileSuffix suffix;
+    std::string path;
+    uint64_t size;
+  };
+  std::vector<RotatedFile> files;
 
   auto prefix = path_.value() + "-";
   fs::path dirname(path_.dirname().value());
@@ -176,28 +192,171 @@ void TimestampLogRotation::removeOldLogFiles() {
       continue;
     }
 
-    // Only match files that look like they have a valid timestamp suffix
-    auto suffix =
-        parseLogSuffix(StringPiece(entryPath).subpiece(prefix.size()));
+    // Only match files that look like they have a valid timestamp suffix,
+    // whether they were compressed or not.
+    auto suffixStr = StringPiece(entryPath).subpiece(prefix.size());
+    suffixStr.removeSuffix(kCompressedExtension);
+    auto suffix = parseLogSuffix(suffixStr);
     if (!suffix.has_value()) {
       continue;
     }
 
     XLOG(DBG9) << "log cleanup match: " << entry;
-    filesToKeep.emplace(suffix.value());
-    if (filesToKeep.size() > numFilesToKeep_) {
-      // delete the last file.
-      auto pathToRemove = appendLogSuffix(prefix, filesToKeep.top());
-      filesToKeep.pop();
-      XLOG(DBG5) << "remove oldest: " << pathToRemove;
-      int rc = unlink(pathToRemove.c_str());
-      if (rc != 0) {
-        int errnum = errno;
-        XLOG(WARN) << "error removing rotated log file " << pathToRemove << ": "
-                   << folly::errnoStr(errnum);
-        // Continue anyway.
+    uint64_t size = 0;
+    if (maxTotalBytes_ != 0) {
+      boost::system::error_code ec;
+      size = fs::file_size(entry.path(), ec);
+      if (ec) {
+        size = 0;
       }
     }
+    files.push_back(RotatedFile{suffix.value(), std::move(entryPath), size});
+  }
+
+  // Keep the newest files.
+  std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) {
+    return a.suffix > b.suffix;
+  });
+  size_t numKept = 0;
+  uint64_t totalBytes = 0;
+  for (const auto& file : files) {
+    totalBytes += file.size;
+    if (numKept == 0 ||
+        (numKept < numFilesToKeep_ &&
+         (maxTotalBytes_ == 0 || totalBytes <= maxTotalBytes_))) {
+      ++numKept;
+      continue;
+    }
+    XLOG(DBG5) << "remove oldest: " << file.path;
+    int rc = unlink(file.path.c_str());
+    if (rc != 0) {
+      int errnum = errno;
+      XLOG(WARN) << "error removing rotated log file " << file.path << ": "
+                 << folly::errnoStr(errnum);
+      // Continue anyway.
+    }
+  }
+}
+
+CompressedTimestampLogRotation::CompressedTimestampLogRotation(
+    size_t numFilesToKeep,
+    uint64_t maxTotalBytes,
+    uint64_t bytesPerSecond,
+    std::shared_ptr<Clock> clock)
+    : TimestampLogRotation(numFilesToKeep, std::move(clock)),
+      bytesPerSecond_{bytesPerSecond} {
+  maxTotalBytes_ = maxTotalBytes;
+}
+
+void CompressedTimestampLogRotation::init(AbsolutePathPiece path) {
+  TimestampLogRotation::init(path);
+  try {
+    removeTemporaryFiles();
+  } catch (const std::exception& ex) {
+    XLOG(ERR) << "error cleaning up partially compressed log files for "
+              << path << ": " << folly::exceptionStr(ex);
+  }
+}
+
+void CompressedTimestampLogRotation::removeTemporaryFiles() {
+  // A previous process may have stopped in the middle of compressing a file,
+  // whose uncompressed version is then still there.
+  auto prefix = getPath().value() + "-";
+  fs::path dirname(getPath().dirname().value());
+  for (const auto& entry : fs::directory_iterator(dirname)) {
+    auto entryPath = entry.path().string();
+    if (StringPiece(entryPath).startsWith(prefix) &&
+        StringPiece(entryPath).endsWith(kTemporaryExtension)) {
+      XLOG(DBG5) << "remove partially compressed log: " << entryPath;
+      unlink(entryPath.c_str());
+    }
+  }
+}
+
+void CompressedTimestampLogRotation::performRotation(const AbsolutePath& path) {
+  if (!loweredPriority_) {
+    // This only runs on the rotation thread, so lower its priority for good.
+    loweredPriority_ = true;
+#ifdef __linux__
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+    // IOPRIO_WHO_PROCESS of the calling thread, IOPRIO_CLASS_IDLE.
+    syscall(SYS_ioprio_set, 1, 0, 3 << 13);
+#endif
+  }
+
+  if (folly::io::hasStreamCodec(folly::io::CodecType::ZSTD)) {
+    try {
+      compress(path);
+    } catch (const std::exception& ex) {
+      XLOG(ERR) << "error compressing rotated log file " << path << ": "
+                << folly::exceptionStr(ex);
+      // Keep the file uncompressed.
+    }
+  }
+  removeOldLogFiles();
+}
+
+void CompressedTimestampLogRotation::compress(const AbsolutePath& path) {
+  auto compressedPath =
+      folly::to<std::string>(path.value(), kCompressedExtension);
+  auto temporaryPath =
+      folly::to<std::string>(compressedPath, kTemporaryExtension);
+
+  folly::File input{path.c_str(), O_RDONLY | O_CLOEXEC};
+  folly::File output{
+      temporaryPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644};
+  SCOPE_FAIL {
+    unlink(temporaryPath.c_str());
+  };
+
+  auto codec = folly::io::getStreamCodec(folly::io::CodecType::ZSTD);
+  std::vector<uint8_t> inputBuffer(kCompressionChunkSize);
+  std::vector<uint8_t> outputBuffer(kCompressionChunkSize);
+  auto start = std::chrono::steady_clock::now();
+  uint64_t totalRead = 0;
+  while (true) {
+    auto bytesRead =
+        folly::readFull(input.fd(), inputBuffer.data(), inputBuffer.size());
+    folly::checkUnixError(bytesRead, "failed to read ", path);
+    totalRead += bytesRead;
+
+    auto end = static_cast<size_t>(bytesRead) < inputBuffer.size();
+    auto flushOp = end ? folly::io::StreamCodec::FlushOp::END
+                       : folly::io::StreamCodec::FlushOp::NONE;
+    folly::ByteRange in{inputBuffer.data(), static_cast<size_t>(bytesRead)};
+    bool done = false;
+    while (!in.empty() || (end && !done)) {
+      folly::MutableByteRange out{outputBuffer.data(), outputBuffer.size()};
+      done = codec->compressStream(in, out, flushOp);
+      auto length = outputBuffer.size() - out.size();
+      folly::checkUnixError(
+          folly::writeFull(output.fd(), outputBuffer.data(), length),
+          "failed to write ",
+          temporaryPath);
+    }
+    if (end) {
+      break;
+    }
+
+    if (bytesPerSecond_ != 0) {
+      // Sleep until reading this much has taken long enough.
+      auto due = start +
+          std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                     std::chrono::duration<double>(
+                         static_cast<double>(totalRead) / bytesPerSecond_));
+      std::this_thread::sleep_until(due);
+    }
+  }
+  output.close();
+
+  folly::checkUnixError(
+      rename(temporaryPath.c_str(), compressedPath.c_str()),
+      "failed to rename ",
+      temporaryPath);
+  if (unlink(path.c_str()) != 0) {
+    int errnum = errno;
+    XLOG(WARN) << "error removing rotated log file " << path
+               << " after compressing it: " << folly::errnoStr(errnum);
   }
 }
 
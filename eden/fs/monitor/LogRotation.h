@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <folly/Range.h>
 #include <gtest/gtest_prod.h>
 #include <optional>
 #include <tuple>
@@ -83,6 +84,24 @@ class TimestampLogRotation : public LogRotationStrategy {
   AbsolutePath renameMainLogFile() override;
   void performRotation(const AbsolutePath& path) override;
 
+ protected:
+  // Appended to the name of a rotated log file once it is compressed.
+  static constexpr folly::StringPiece kCompressedExtension{".zst"};
+
+  /**
+   * Remove the oldest rotated files, compressed or not, beyond the
+   * numFilesToKeep most recent ones, or once they take more than
+   * maxTotalBytes_ together.  The most recent file is always kept.
+   */
+  void removeOldLogFiles();
+
+  const AbsolutePath& getPath() const {
+    return path_;
+  }
+
+  // If non-zero, the total size of the rotated files to keep.
+  uint64_t maxTotalBytes_{0};
+
  private:
   FRIEND_TEST(TimestampLogRotation, parseLogSuffix);
   FRIEND_TEST(TimestampLogRotation, appendLogSuffix);
@@ -98,7 +117,6 @@ class TimestampLogRotation : public LogRotationStrategy {
       folly::StringPiece prefix,
       const FileSuffix& suffix);
   AbsolutePath computeNewPath();
-  void removeOldLogFiles();
 
   AbsolutePath path_;
   std::shared_ptr<Clock> clock_;
@@ -113,5 +131,35 @@ class TimestampLogRotation : public LogRotationStrategy {
   size_t nextSuffix_{0};
 };
 
+/**
+ * A TimestampLogRotation that also compresses each rotated log file with
+ * zstd, and can bound the total size of the rotated files.
+ *
+ * The compression runs on the rotation thread, at a low CPU and I/O priority,
+ * and reads at most bytesPerSecond so that it does not compete with EdenFS for
+ * the disk.  If zstd is not available the files are kept uncompressed.
+ */
+class CompressedTimestampLogRotation : public TimestampLogRotation {
+ public:
+  /**
+   * maxTotalBytes and bytesPerSecond may be 0 for no limit.
+   */
+  CompressedTimestampLogRotation(
+      size_t numFilesToKeep,
+      uint64_t maxTotalBytes,
+      uint64_t bytesPerSecond,
+      std::shared_ptr<Clock> clock = nullptr);
+
+  void init(AbsolutePathPiece path) override;
+  void performRotation(const AbsolutePath& path) override;
+
+ private:
+  void compress(const AbsolutePath& path);
+  void removeTemporaryFiles();
+
+  uint64_t const bytesPerSecond_;
+  bool loweredPriority_{false};
+};
+
 } // namespace eden
 } // namespace facebook
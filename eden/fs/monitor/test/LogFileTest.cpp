@@ -7,7 +7,9 @@
 
 #include <chrono>
 
+#include <folly/FileUtil.h>
 #include <folly/Range.h>
+#include <folly/compression/Compression.h>
 #include <folly/logging/xlog.h>
 #include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
@@ -88,6 +90,88 @@ TEST(TimestampLogRotation, rotation) {
           "test.log-20200307.123525.2"));
 }
 
+TEST(CompressedTimestampLogRotation, rotation) {
+  if (!folly::io::hasStreamCodec(folly::io::CodecType::ZSTD)) {
+    GTEST_SKIP() << "zstd is not available";
+  }
+  auto tempdir = makeTempDir();
+  auto dir = AbsolutePath(tempdir.path().native());
+  auto logPath = dir + "test.log"_pc;
+
+  auto clock = make_shared<FakeClock>();
+  struct tm testTime = {};
+  testTime.tm_year = 2020 - 1900;
+  testTime.tm_mon = 3 - 1;
+  testTime.tm_mday = 7;
+  testTime.tm_hour = 12;
+  testTime.tm_min = 34;
+  testTime.tm_sec = 56;
+  clock->set(FakeClock::time_point(std::chrono::seconds(mktime(&testTime))));
+
+  {
+    LogFile log(
+        logPath,
+        /*maxSize=*/100,
+        make_unique<CompressedTimestampLogRotation>(
+            /*numFilesToKeep=*/3,
+            /*maxTotalBytes=*/0,
+            /*bytesPerSecond=*/0,
+            clock));
+    for (size_t n = 0; n < 10; ++n) {
+      auto msg = folly::to<string>("msg ", n, ": ", string(200, 'a'), "\n");
+      log.write(msg.data(), msg.size());
+      clock->advance(1s);
+    }
+  }
+
+  // The last three rotations kept, each compressed.
+  EXPECT_THAT(
+      listDir(tempdir.path()),
+      UnorderedElementsAre(
+          "test.log",
+          "test.log-20200307.123503.zst",
+          "test.log-20200307.123504.zst",
+          "test.log-20200307.123505.zst"));
+
+  string compressed;
+  ASSERT_TRUE(folly::readFile(
+      (dir + "test.log-20200307.123505.zst"_pc).c_str(), compressed));
+  auto contents = folly::io::getCodec(folly::io::CodecType::ZSTD)
+                      ->uncompress(StringPiece{compressed});
+  EXPECT_EQ(
+      folly::to<string>("msg 9: ", string(200, 'a'), "\n"), contents);
+}
+
+TEST(CompressedTimestampLogRotation, removeByTotalSize) {
+  auto tempdir = makeTempDir();
+  auto dir = AbsolutePath(tempdir.path().native());
+  auto logPath = dir + "test.log"_pc;
+
+  auto createFile = [&](StringPiece name, size_t size) {
+    auto full_path = dir + PathComponent(name);
+    folly::writeFile(string(size, 'a'), full_path.c_str());
+  };
+
+  createFile("test.log", 10);
+  createFile("test.log-20200303.001122", 400);
+  createFile("test.log-20200303.001122.1.zst", 400);
+  createFile("test.log-20200305.235959.zst", 400);
+  createFile("test.log-20200306.010203.zst", 400);
+  createFile("test.log-20200306.010203.zst.tmp", 100);
+
+  // Only the two newest files fit in 1000 bytes, and init() also removes the
+  // leftover of an interrupted compression.
+  auto rotater = make_unique<CompressedTimestampLogRotation>(
+      /*numFilesToKeep=*/5, /*maxTotalBytes=*/1000, /*bytesPerSecond=*/0);
+  rotater->init(logPath);
+  EXPECT_THAT(
+      listDir(tempdir.path()),
+      UnorderedElementsAre(
+          "test.log",
+          "test.log-20200305.235959.zst",
+          "test.log-20200306.010203.zst"));
+}
+
 TEST(TimestampLogRotation, removeOldLogFiles) {
   auto tempdir = makeTempDir();
   auto dir = AbsolutePath(tempdir.path().native());
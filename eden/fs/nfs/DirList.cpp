@@ -33,6 +33,17 @@ uint32_t computeInitialRemaining(uint32_t count) {
   }
   return count - kInitialOverhead;
 }
+
+/**
+ * How much larger an entryplus3 becomes once its attributes and file handle
+ * are filled in.
+ */
+size_t entryPlusAttributesSize() {
+  return XdrTrait<post_op_attr>::serializedSize(post_op_attr{fattr3{}}) +
+      XdrTrait<post_op_fh3>::serializedSize(post_op_fh3{nfs_fh3{}}) -
+      XdrTrait<post_op_attr>::serializedSize(post_op_attr{}) -
+      XdrTrait<post_op_fh3>::serializedSize(post_op_fh3{});
+}
 } // namespace
 
 NfsDirList::NfsDirList(uint32_t count)
@@ -57,6 +68,33 @@ bool NfsDirList::add(
   return true;
 }
 
+NfsDirPlusList::NfsDirPlusList(uint32_t dircount, uint32_t maxcount)
+    : dirRemaining_(dircount),
+      maxRemaining_(computeInitialRemaining(maxcount)) {}
+
+bool NfsDirPlusList::add(
+    folly::StringPiece name,
+    InodeNumber ino,
+    uint64_t offset) {
+  auto entry = entryplus3{ino.get(), name.str(), offset, {}, {}};
+  // dircount only covers the fields shared with READDIR's entry3, while
+  // maxcount also covers the attributes and file handle.
+  auto dirSize = XdrTrait<uint64_t>::serializedSize(entry.fileid) +
+      XdrTrait<std::string>::serializedSize(entry.name) +
+      XdrTrait<uint64_t>::serializedSize(entry.cookie);
+  auto neededSize = XdrTrait<entryplus3>::serializedSize(entry) +
+      entryPlusAttributesSize() + XdrTrait<bool>::serializedSize(true);
+
+  if (dirSize > dirRemaining_ || neededSize > maxRemaining_) {
+    return false;
+  }
+
+  dirRemaining_ -= dirSize;
+  maxRemaining_ -= neededSize;
+  list_.list.push_back(std::move(entry));
+  return true;
+}
+
 } // namespace facebook::eden
 
 #endif
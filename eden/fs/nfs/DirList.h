@@ -47,6 +47,54 @@ class NfsDirList {
   XdrList<entry3> list_{};
 };
 
+/**
+ * Same as NfsDirList, but for READDIRPLUS, whose entries also carry the
+ * attributes and file handle of each entry.
+ *
+ * READDIRPLUS has two limits: dircount bounds the size of the entries without
+ * their attributes and handles, while maxcount bounds the size of the entire
+ * READDIRPLUS3resok.
+ */
+class NfsDirPlusList {
+ public:
+  NfsDirPlusList(uint32_t dircount, uint32_t maxcount);
+
+  NfsDirPlusList(NfsDirPlusList&&) = default;
+  NfsDirPlusList& operator=(NfsDirPlusList&&) = default;
+
+  NfsDirPlusList() = delete;
+  NfsDirPlusList(const NfsDirPlusList&) = delete;
+  NfsDirPlusList& operator=(const NfsDirPlusList&) = delete;
+
+  /**
+   * Add an entry, reserving room for its attributes and file handle. Return
+   * true if the entry was successfully added, false otherwise.
+   *
+   * The attributes and handle are left empty and are filled in by the caller
+   * once they are known.
+   */
+  bool add(folly::StringPiece name, InodeNumber ino, uint64_t offset);
+
+  /**
+   * The entries added so far.
+   */
+  const XdrList<entryplus3>& getList() const {
+    return list_;
+  }
+
+  /**
+   * Move the built list out of the NfsDirPlusList.
+   */
+  XdrList<entryplus3> extractList() {
+    return std::move(list_);
+  }
+
+ private:
+  uint32_t dirRemaining_;
+  uint32_t maxRemaining_;
+  XdrList<entryplus3> list_{};
+};
+
 } // namespace facebook::eden
 
 #endif
@@ -216,9 +216,10 @@ void MountdServerProcessor::unregisterMount(AbsolutePathPiece path) {
 
 Mountd::Mountd(
     folly::EventBase* evb,
-    std::shared_ptr<folly::Executor> threadPool)
+    std::shared_ptr<folly::Executor> threadPool,
+    std::shared_ptr<folly::IOExecutor> ioPool)
     : proc_(std::make_shared<MountdServerProcessor>()),
-      server_(proc_, evb, std::move(threadPool)) {}
+      server_(proc_, evb, std::move(threadPool), std::move(ioPool)) {}
 
 void Mountd::initialize(folly::SocketAddress addr, bool registerWithRpcbind) {
   server_.initialize(addr);
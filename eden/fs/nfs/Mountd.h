@@ -18,6 +18,7 @@
 
 namespace folly {
 class Executor;
+class IOExecutor;
 }
 
 namespace facebook::eden {
@@ -35,8 +36,13 @@ class Mountd {
    * Note: at mount time, EdenFS will manually call mount.nfs with -o mountport
    * to manually specify the port on which this server is bound, so registering
    * is not necessary for a properly behaving EdenFS.
+   *
+   * See RpcServer for the meaning of ioPool.
    */
-  Mountd(folly::EventBase* evb, std::shared_ptr<folly::Executor> threadPool);
+  Mountd(
+      folly::EventBase* evb,
+      std::shared_ptr<folly::Executor> threadPool,
+      std::shared_ptr<folly::IOExecutor> ioPool);
 
   /**
    * Bind the RPC mountd program to the passed in address.
@@ -86,11 +86,20 @@ class NfsDispatcher {
       InodeNumber ino,
       ObjectFetchContext& context) = 0;
 
+  /**
+   * Return value of the lookup method, std::nullopt when the directory has no
+   * such file.
+   */
+  using LookupRes = std::optional<std::tuple<InodeNumber, struct stat>>;
+
   /**
    * Find the given file in the passed in directory. It's InodeNumber and
    * attributes are returned.
+   *
+   * A missing file is reported by returning std::nullopt, which is much
+   * cheaper than failing with ENOENT.
    */
-  virtual ImmediateFuture<std::tuple<InodeNumber, struct stat>>
+  virtual ImmediateFuture<LookupRes>
   lookup(InodeNumber dir, PathComponent name, ObjectFetchContext& context) = 0;
 
   /**
@@ -144,6 +153,14 @@ class NfsDispatcher {
       off_t offset,
       ObjectFetchContext& context) = 0;
 
+  /**
+   * Flush the data previously written to the file referenced by the
+   * InodeNumber ino to stable storage.
+   */
+  virtual ImmediateFuture<folly::Unit> commit(
+      InodeNumber ino,
+      ObjectFetchContext& context) = 0;
+
   /**
    * Return value of the create method.
    */
@@ -348,6 +365,34 @@ class NfsDispatcher {
       uint32_t count,
       ObjectFetchContext& context) = 0;
 
+  /**
+   * Return value of the readdirplus method.
+   */
+  struct ReaddirplusRes {
+    /** List of directory entries, without attributes nor file handles */
+    NfsDirPlusList entries;
+    /**
+     * The attributes of each entry, in the same order as the entries. Entries
+     * without attributes should be returned to the client without them.
+     */
+    std::vector<std::optional<struct stat>> attributes;
+    /** Has the readdirplus reached the end of the directory */
+    bool isEof;
+  };
+
+  /**
+   * Same as readdir, but also return the attributes of every entry.
+   *
+   * At most dircount bytes of entries and maxcount bytes of entries with their
+   * attributes and file handles are added to the returned NfsDirPlusList.
+   */
+  virtual ImmediateFuture<ReaddirplusRes> readdirplus(
+      InodeNumber dir,
+      off_t offset,
+      uint32_t dircount,
+      uint32_t maxcount,
+      ObjectFetchContext& context) = 0;
+
   virtual ImmediateFuture<struct statfs> statfs(
       InodeNumber dir,
       ObjectFetchContext& context) = 0;
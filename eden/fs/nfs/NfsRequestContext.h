@@ -11,7 +11,7 @@
 
 namespace facebook::eden {
 
-class NfsRequestContext : public RequestContext {
+class NfsRequestContext final : public RequestContext {
  public:
   /**
    * Constructs a new NfsRequestContext. The context should live for the
@@ -9,6 +9,7 @@
 
 #include "eden/fs/nfs/NfsServer.h"
 
+#include <folly/executors/IOThreadPoolExecutor.h>
 #include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include "eden/fs/nfs/Nfsd3.h"
 #include "eden/fs/utils/EdenTaskQueue.h"
@@ -18,13 +19,27 @@ namespace facebook::eden {
 NfsServer::NfsServer(
     folly::EventBase* evb,
     uint64_t numServicingThreads,
-    uint64_t maxInflightRequests)
+    uint64_t maxInflightRequests,
+    uint64_t numIoThreads,
+    uint64_t maxInflightMetadataRequests,
+    uint64_t maxInflightDataRequests,
+    ThreadPlacement servicingPlacement)
     : evb_(evb),
       threadPool_(std::make_shared<folly::CPUThreadPoolExecutor>(
           numServicingThreads,
           std::make_unique<EdenTaskQueue>(maxInflightRequests),
-          std::make_unique<folly::NamedThreadFactory>("NfsThreadPool"))),
-      mountd_(evb_, threadPool_) {}
+          std::make_shared<PlacedThreadFactory>(
+              std::make_shared<folly::NamedThreadFactory>("NfsThreadPool"),
+              servicingPlacement))),
+      ioPool_(
+          numIoThreads == 0 ? nullptr
+                            : std::make_shared<folly::IOThreadPoolExecutor>(
+                                  numIoThreads,
+                                  std::make_shared<folly::NamedThreadFactory>(
+                                      "NfsIoThread"))),
+      maxInflightMetadataRequests_(maxInflightMetadataRequests),
+      maxInflightDataRequests_(maxInflightDataRequests),
+      mountd_(evb_, threadPool_, ioPool_) {}
 
 void NfsServer::initialize(
     folly::SocketAddress addr,
@@ -46,6 +61,7 @@ NfsServer::NfsMountInfo NfsServer::registerMount(
   auto nfsd = std::make_unique<Nfsd3>(
       evb_,
       threadPool_,
+      ioPool_,
       std::move(dispatcher),
       straceLogger,
       std::move(processNameCache),
@@ -53,7 +69,9 @@ NfsServer::NfsMountInfo NfsServer::registerMount(
       requestTimeout,
       notifications,
       caseSensitive,
-      iosize);
+      iosize,
+      maxInflightMetadataRequests_,
+      maxInflightDataRequests_);
   mountd_.registerMount(path, rootIno);
 
   return {std::move(nfsd), mountd_.getAddr()};
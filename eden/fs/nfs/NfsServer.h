@@ -13,9 +13,11 @@
 #include "eden/fs/nfs/Mountd.h"
 #include "eden/fs/nfs/Nfsd3.h"
 #include "eden/fs/utils/CaseSensitivity.h"
+#include "eden/fs/utils/ThreadPlacement.h"
 
 namespace folly {
 class Executor;
+class IOThreadPoolExecutor;
 }
 
 namespace facebook::eden {
@@ -31,7 +33,15 @@ class NfsServer {
    * This will handle the lifetime of the various programs involved in the NFS
    * protocol including mountd and nfsd. The requests will be serviced by a
    * blocking thread pool initialized with numServicingThreads and
-   * maxInflightRequests.
+   * maxInflightRequests, whose threads are placed with servicingPlacement.
+   *
+   * When numIoThreads is non-zero, the socket reads and writes of the
+   * accepted connections are spread over a pool of that many IO threads
+   * instead of all running on evb. This matters for clients that open several
+   * connections to the same server.
+   *
+   * maxInflightMetadataRequests and maxInflightDataRequests are the per-mount
+   * budgets of requests processed at once, see Nfsd3.
    *
    * One mountd program will be created per NfsServer, while one nfsd program
    * will be created per-mount point, this allows nfsd program to be only aware
@@ -40,7 +50,11 @@ class NfsServer {
   NfsServer(
       folly::EventBase* evb,
       uint64_t numServicingThreads,
-      uint64_t maxInflightRequests);
+      uint64_t maxInflightRequests,
+      uint64_t numIoThreads,
+      uint64_t maxInflightMetadataRequests,
+      uint64_t maxInflightDataRequests,
+      ThreadPlacement servicingPlacement);
 
   /**
    * Bind the NfsServer to the passed in socket.
@@ -87,7 +101,7 @@ class NfsServer {
   void unregisterMount(AbsolutePathPiece path);
 
   /**
-   * Return the EventBase that the various NFS programs are running on.
+   * Return the EventBase that the various NFS programs accept connections on.
    */
   folly::EventBase* getEventBase() const {
     return evb_;
@@ -101,6 +115,9 @@ class NfsServer {
  private:
   folly::EventBase* evb_;
   std::shared_ptr<folly::Executor> threadPool_;
+  std::shared_ptr<folly::IOThreadPoolExecutor> ioPool_;
+  uint64_t maxInflightMetadataRequests_;
+  uint64_t maxInflightDataRequests_;
   Mountd mountd_;
 };
 
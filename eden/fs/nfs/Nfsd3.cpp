@@ -14,11 +14,16 @@
 #include <sys/sysmacros.h>
 #endif
 
+#include <folly/Random.h>
+#include <folly/Synchronized.h>
 #include <folly/Utility.h>
+#include <folly/executors/QueuedImmediateExecutor.h>
 #include <folly/executors/SerialExecutor.h>
 #include <folly/futures/Future.h>
+#include <deque>
 #include <memory>
 #include "eden/fs/nfs/NfsRequestContext.h"
+#include "eden/fs/nfs/Nfsd4.h"
 #include "eden/fs/nfs/NfsdRpc.h"
 #include "eden/fs/telemetry/FsEventLogger.h"
 #include "eden/fs/telemetry/RequestMetricsScope.h"
@@ -33,9 +38,233 @@ class Executor;
 namespace facebook::eden {
 
 namespace {
-constexpr size_t kTraceBusCapacity = 25000;
+// TraceBus capacity is per publishing thread.
+constexpr size_t kTraceBusCapacity = 5000;
 static_assert(sizeof(NfsTraceEvent) == 40);
-static_assert(kTraceBusCapacity * sizeof(NfsTraceEvent) == 1000000);
+static_assert(kTraceBusCapacity * sizeof(NfsTraceEvent) == 200000);
+
+/**
+ * Maximum amount of UNSTABLE write data that can be waiting to be written to
+ * the overlay. Past this, UNSTABLE writes are performed synchronously.
+ */
+constexpr size_t kMaxWriteBehindBytes = 64 * 1024 * 1024;
+
+/**
+ * Keep track of the UNSTABLE writes that were acknowledged to the client but
+ * that haven't reached the overlay yet.
+ *
+ * An UNSTABLE write only needs to be durable once a COMMIT covering it
+ * succeeds, this allows replying to the client before the data is written,
+ * letting it pipeline its writes. The procedures that observe the content or
+ * size of a file need to wait for these writes to complete first.
+ */
+class WriteBehind {
+ public:
+  /**
+   * Start tracking a write of size bytes at offset to ino.
+   *
+   * Returns the end of the writes to ino that were already pending, 0 if
+   * there are none. Returns std::nullopt when too much data is already
+   * waiting to be written, in which case the write isn't tracked and should
+   * be done synchronously.
+   */
+  std::optional<uint64_t>
+  start(InodeNumber ino, uint64_t offset, size_t size) {
+    auto state = state_.wlock();
+    if (state->pendingBytes != 0 &&
+        state->pendingBytes + size > kMaxWriteBehindBytes) {
+      return std::nullopt;
+    }
+    state->pendingBytes += size;
+    auto& writes = state->inodes[ino];
+    auto previousEnd = writes.end;
+    writes.inflight++;
+    writes.end = std::max(writes.end, offset + size);
+    return previousEnd;
+  }
+
+  /**
+   * Called when a write previously started completes. A failed write is
+   * recorded and will be reported by the next takeError.
+   */
+  void complete(InodeNumber ino, size_t size, folly::exception_wrapper error) {
+    std::vector<folly::Promise<folly::Unit>> waiters;
+    {
+      auto state = state_.wlock();
+      state->pendingBytes -= size;
+      auto it = state->inodes.find(ino);
+      XCHECK(it != state->inodes.end());
+      auto& writes = it->second;
+      if (error && !writes.error) {
+        writes.error = std::move(error);
+      }
+      if (--writes.inflight == 0) {
+        waiters = std::move(writes.waiters);
+        writes.end = 0;
+        if (!writes.error) {
+          state->inodes.erase(it);
+        }
+      }
+    }
+
+    for (auto& waiter : waiters) {
+      waiter.setValue();
+    }
+  }
+
+  /**
+   * Whether some of the writes to ino haven't completed yet.
+   */
+  bool pending(InodeNumber ino) {
+    auto state = state_.rlock();
+    auto it = state->inodes.find(ino);
+    return it != state->inodes.end() && it->second.inflight != 0;
+  }
+
+  /**
+   * Wait for all the writes to ino started so far to complete.
+   */
+  ImmediateFuture<folly::Unit> wait(InodeNumber ino) {
+    auto state = state_.wlock();
+    auto it = state->inodes.find(ino);
+    if (it == state->inodes.end() || it->second.inflight == 0) {
+      return folly::unit;
+    }
+    auto& promise = it->second.waiters.emplace_back();
+    return promise.getSemiFuture();
+  }
+
+  /**
+   * Wait for all the writes started so far to complete.
+   */
+  ImmediateFuture<folly::Unit> waitAll() {
+    std::vector<folly::SemiFuture<folly::Unit>> futures;
+    {
+      auto state = state_.wlock();
+      for (auto& [ino, writes] : state->inodes) {
+        if (writes.inflight != 0) {
+          futures.push_back(writes.waiters.emplace_back().getSemiFuture());
+        }
+      }
+    }
+    return folly::collectAll(std::move(futures)).deferValue([](auto&&) {});
+  }
+
+  /**
+   * Return and forget the error of the first failed write to ino since the
+   * last call.
+   */
+  folly::exception_wrapper takeError(InodeNumber ino) {
+    auto state = state_.wlock();
+    auto it = state->inodes.find(ino);
+    if (it == state->inodes.end()) {
+      return {};
+    }
+    auto error = std::move(it->second.error);
+    it->second.error = {};
+    if (it->second.inflight == 0) {
+      state->inodes.erase(it);
+    }
+    return error;
+  }
+
+ private:
+  struct InodeWrites {
+    size_t inflight{0};
+    // End of the furthest write in flight, the file is at least this large
+    // once they complete.
+    uint64_t end{0};
+    std::vector<folly::Promise<folly::Unit>> waiters;
+    folly::exception_wrapper error;
+  };
+
+  struct State {
+    size_t pendingBytes{0};
+    std::unordered_map<InodeNumber, InodeWrites> inodes;
+  };
+
+  folly::Synchronized<State> state_;
+};
+
+/**
+ * Bound the number of requests of a class of procedures that are being
+ * processed at once.
+ *
+ * The requests above the budget are queued and started in FIFO order as the
+ * previous ones complete. Having one budget per class of procedures keeps
+ * the cheap metadata requests flowing while the data requests are waiting on
+ * the backing store.
+ */
+class RequestAdmission {
+ public:
+  /**
+   * A maxInflight of 0 means there is no limit.
+   */
+  explicit RequestAdmission(size_t maxInflight) : maxInflight_{maxInflight} {}
+
+  /**
+   * The returned future completes when the request may start, release must
+   * then be called once it completes.
+   *
+   * A queued request is started on the thread that released its slot.
+   */
+  ImmediateFuture<folly::Unit> admit() {
+    if (maxInflight_ == 0) {
+      return folly::unit;
+    }
+
+    auto state = state_.wlock();
+    if (state->inflight < maxInflight_) {
+      state->inflight++;
+      return folly::unit;
+    }
+    auto& promise = state->waiters.emplace_back();
+    return promise.getSemiFuture();
+  }
+
+  void release() {
+    if (maxInflight_ == 0) {
+      return;
+    }
+
+    folly::Promise<folly::Unit> next;
+    {
+      auto state = state_.wlock();
+      if (state->waiters.empty()) {
+        state->inflight--;
+        return;
+      }
+      // Hand the slot over to the oldest queued request.
+      next = std::move(state->waiters.front());
+      state->waiters.pop_front();
+    }
+    next.setValue();
+  }
+
+ private:
+  struct State {
+    size_t inflight{0};
+    std::deque<folly::Promise<folly::Unit>> waiters;
+  };
+
+  const size_t maxInflight_;
+  folly::Synchronized<State> state_;
+};
+
+/**
+ * The procedures that read or write file content, and can thus wait on the
+ * backing store or the overlay for a long time.
+ */
+bool isDataProcedure(uint32_t procNumber) {
+  switch (static_cast<nfsv3Procs>(procNumber)) {
+    case nfsv3Procs::read:
+    case nfsv3Procs::write:
+    case nfsv3Procs::commit:
+      return true;
+    default:
+      return false;
+  }
+}
 
 class Nfsd3ServerProcessor final : public RpcServerProcessor {
  public:
@@ -44,6 +273,8 @@ class Nfsd3ServerProcessor final : public RpcServerProcessor {
       const folly::Logger* straceLogger,
       CaseSensitivity caseSensitive,
       uint32_t iosize,
+      size_t maxInflightMetadataRequests,
+      size_t maxInflightDataRequests,
       folly::Promise<Nfsd3::StopData>& stopPromise,
       ProcessAccessLog& processAccessLog,
       std::atomic<size_t>& traceDetailedArguments,
@@ -55,7 +286,10 @@ class Nfsd3ServerProcessor final : public RpcServerProcessor {
         stopPromise_{stopPromise},
         processAccessLog_{processAccessLog},
         traceDetailedArguments_(traceDetailedArguments),
-        traceBus_(traceBus) {}
+        traceBus_(traceBus),
+        metadataAdmission_{maxInflightMetadataRequests},
+        dataAdmission_{maxInflightDataRequests},
+        nfsd4_{*dispatcher_, straceLogger, iosize, processAccessLog} {}
 
   Nfsd3ServerProcessor(const Nfsd3ServerProcessor&) = delete;
   Nfsd3ServerProcessor(Nfsd3ServerProcessor&&) = delete;
@@ -72,6 +306,8 @@ class Nfsd3ServerProcessor final : public RpcServerProcessor {
 
   void onSocketClosed() override;
 
+  void onRepliesFlushed(size_t numReplies) override;
+
   ImmediateFuture<folly::Unit> null(
       folly::io::Cursor deser,
       folly::io::QueueAppender ser,
@@ -162,6 +398,22 @@ class Nfsd3ServerProcessor final : public RpcServerProcessor {
       NfsRequestContext& context);
 
  private:
+  /**
+   * Return the attributes of ino once the writes to it that are still in
+   * flight complete.
+   */
+  ImmediateFuture<struct stat> getattrAfterWrites(
+      InodeNumber ino,
+      NfsRequestContext& context);
+
+  /**
+   * The attributes of the entries with writes in flight may not account for
+   * them, collect these attributes again once the writes complete.
+   */
+  ImmediateFuture<NfsDispatcher::ReaddirplusRes> refreshPendingAttributes(
+      NfsDispatcher::ReaddirplusRes res,
+      NfsRequestContext& context);
+
   std::unique_ptr<NfsDispatcher> dispatcher_;
   const folly::Logger* straceLogger_;
   CaseSensitivity caseSensitive_;
@@ -174,6 +426,11 @@ class Nfsd3ServerProcessor final : public RpcServerProcessor {
   ProcessAccessLog& processAccessLog_;
   std::atomic<size_t>& traceDetailedArguments_;
   std::shared_ptr<TraceBus<NfsTraceEvent>>& traceBus_;
+  WriteBehind writeBehind_;
+  RequestAdmission metadataAdmission_;
+  RequestAdmission dataAdmission_;
+  // Serves the NFSv4 calls received on the same socket.
+  Nfsd4ServerProcessor nfsd4_;
 };
 
 /**
@@ -380,6 +637,22 @@ pre_op_attr statToPreOpAttr(const struct stat& stat) {
   }};
 }
 
+/**
+ * The attributes of a file once a write ending at end, done at time now,
+ * completes.
+ */
+struct stat statAfterWrite(struct stat stat, uint64_t end, timespec now) {
+  stat.st_size = std::max<off_t>(stat.st_size, folly::to_signed(end));
+#ifdef __linux__
+  stat.st_mtim = now;
+  stat.st_ctim = now;
+#else
+  stat.st_mtimespec = now;
+  stat.st_ctimespec = now;
+#endif
+  return stat;
+}
+
 /**
  * Convert the struct stat returned from the NfsDispatcher into a wcc_data
  * useable by NFS.
@@ -412,6 +685,46 @@ ImmediateFuture<PathComponent> extractPathComponent(std::string str) {
   });
 }
 
+ImmediateFuture<struct stat> Nfsd3ServerProcessor::getattrAfterWrites(
+    InodeNumber ino,
+    NfsRequestContext& context) {
+  return writeBehind_.wait(ino).thenValue([this, ino, &context](auto&&) {
+    return dispatcher_->getattr(ino, context);
+  });
+}
+
+ImmediateFuture<NfsDispatcher::ReaddirplusRes>
+Nfsd3ServerProcessor::refreshPendingAttributes(
+    NfsDispatcher::ReaddirplusRes res,
+    NfsRequestContext& context) {
+  std::vector<size_t> indices;
+  std::vector<folly::SemiFuture<struct stat>> stats;
+  const auto& entries = res.entries.getList().list;
+  for (size_t i = 0; i < entries.size() && i < res.attributes.size(); ++i) {
+    auto ino = InodeNumber{entries[i].fileid};
+    if (res.attributes[i].has_value() && writeBehind_.pending(ino)) {
+      indices.push_back(i);
+      stats.push_back(getattrAfterWrites(ino, context).semi());
+    }
+  }
+  if (indices.empty()) {
+    return std::move(res);
+  }
+
+  return folly::collectAll(std::move(stats))
+      .deferValue([res = std::move(res), indices = std::move(indices)](
+                      std::vector<folly::Try<struct stat>> stats) mutable {
+        for (size_t i = 0; i < indices.size(); ++i) {
+          // Rather than returning stale attributes, let the client ask for
+          // them again.
+          res.attributes[indices[i]] = stats[i].hasValue()
+              ? std::make_optional(stats[i].value())
+              : std::nullopt;
+        }
+        return std::move(res);
+      });
+}
+
 ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::getattr(
     folly::io::Cursor deser,
     folly::io::QueueAppender ser,
@@ -420,19 +733,19 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::getattr(
 
   auto args = XdrTrait<GETATTR3args>::deserialize(deser);
 
-  return dispatcher_->getattr(args.object.ino, context)
+  return getattrAfterWrites(args.object.ino, context)
       .thenTry(
           [ser = std::move(ser)](const folly::Try<struct stat>& try_) mutable {
             if (try_.hasException()) {
               GETATTR3res res{
                   {{exceptionToNfsError(try_.exception()), std::monostate{}}}};
-              XdrTrait<GETATTR3res>::serialize(ser, res);
+              serializePresized(ser, res);
             } else {
               const auto& stat = try_.value();
 
               GETATTR3res res{
                   {{nfsstat3::NFS3_OK, GETATTR3resok{statToFattr3(stat)}}}};
-              XdrTrait<GETATTR3res>::serialize(ser, res);
+              serializePresized(ser, res);
             }
 
             return folly::unit;
@@ -451,7 +764,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::setattr(
     // TODO(xavierd): we probably need to support this.
     XLOG(WARN) << "Guarded setattr aren't supported.";
     SETATTR3res res{{{nfsstat3::NFS3ERR_INVAL, SETATTR3resfail{}}}};
-    XdrTrait<SETATTR3res>::serialize(ser, res);
+    serializePresized(ser, res);
     return folly::unit;
   }
 
@@ -488,13 +801,16 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::setattr(
       /*mtime*/ makeTimespec(args.new_attributes.mtime),
   };
 
-  return dispatcher_->setattr(args.object.ino, desired, context)
+  return writeBehind_.wait(args.object.ino)
+      .thenValue([this, ino = args.object.ino, desired, &context](auto&&) {
+        return dispatcher_->setattr(ino, desired, context);
+      })
       .thenTry([ser = std::move(ser)](
                    folly::Try<NfsDispatcher::SetattrRes>&& try_) mutable {
         if (try_.hasException()) {
           SETATTR3res res{
               {{exceptionToNfsError(try_.exception()), SETATTR3resfail{}}}};
-          XdrTrait<SETATTR3res>::serialize(ser, res);
+          serializePresized(ser, res);
         } else {
           const auto& setattrRes = try_.value();
 
@@ -502,7 +818,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::setattr(
               {{nfsstat3::NFS3_OK,
                 SETATTR3resok{
                     statToWccData(setattrRes.preStat, setattrRes.postStat)}}}};
-          XdrTrait<SETATTR3res>::serialize(ser, res);
+          serializePresized(ser, res);
         }
 
         return folly::unit;
@@ -532,12 +848,12 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::lookup(
             LOOKUP3res res{
                 {{nfsstat3::NFS3ERR_NAMETOOLONG,
                   LOOKUP3resfail{post_op_attr{}}}}};
-            XdrTrait<LOOKUP3res>::serialize(ser, res);
+            serializePresized(ser, res);
           } else {
             LOOKUP3res res{
                 {{nfsstat3::NFS3ERR_NAMETOOLONG,
                   LOOKUP3resfail{post_op_attr{statToFattr3(try_.value())}}}}};
-            XdrTrait<LOOKUP3res>::serialize(ser, res);
+            serializePresized(ser, res);
           }
 
           return folly::unit;
@@ -548,9 +864,9 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::lookup(
            if (args.what.name == ".") {
              return dispatcher_->getattr(args.what.dir.ino, context)
                  .thenValue(
-                     [ino = args.what.dir.ino](struct stat && stat)
-                         -> std::tuple<InodeNumber, struct stat> {
-                       return {ino, std::move(stat)};
+                     [ino = args.what.dir.ino](
+                         struct stat && stat) -> NfsDispatcher::LookupRes {
+                       return std::make_tuple(ino, std::move(stat));
                      });
            } else if (args.what.name == "..") {
              return dispatcher_->getParent(args.what.dir.ino, context)
@@ -558,8 +874,8 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::lookup(
                    return dispatcher_->getattr(ino, context)
                        .thenValue(
                            [ino](struct stat && stat)
-                               -> std::tuple<InodeNumber, struct stat> {
-                             return {ino, std::move(stat)};
+                               -> NfsDispatcher::LookupRes {
+                             return std::make_tuple(ino, std::move(stat));
                            });
                  });
            } else {
@@ -570,9 +886,21 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::lookup(
                  });
            }
          })
+      .thenValue([this, &context](NfsDispatcher::LookupRes lookupRes)
+                     -> ImmediateFuture<NfsDispatcher::LookupRes> {
+        if (!lookupRes.has_value() ||
+            !writeBehind_.pending(std::get<0>(*lookupRes))) {
+          return std::move(lookupRes);
+        }
+        // The attributes don't account for the writes still in flight.
+        auto ino = std::get<0>(*lookupRes);
+        return getattrAfterWrites(ino, context)
+            .thenValue([ino](struct stat&& stat) -> NfsDispatcher::LookupRes {
+              return std::make_tuple(ino, std::move(stat));
+            });
+      })
       .thenTry([ser = std::move(ser), dirAttrFut = std::move(dirAttrFut)](
-                   folly::Try<std::tuple<InodeNumber, struct stat>>&&
-                       lookupTry) mutable {
+                   folly::Try<NfsDispatcher::LookupRes>&& lookupTry) mutable {
         return std::move(dirAttrFut)
             .thenTry([ser = std::move(ser), lookupTry = std::move(lookupTry)](
                          const folly::Try<struct stat>& dirStat) mutable {
@@ -580,9 +908,14 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::lookup(
                 LOOKUP3res res{
                     {{exceptionToNfsError(lookupTry.exception()),
                       LOOKUP3resfail{statToPostOpAttr(dirStat)}}}};
-                XdrTrait<LOOKUP3res>::serialize(ser, res);
+                serializePresized(ser, res);
+              } else if (!lookupTry.value().has_value()) {
+                LOOKUP3res res{
+                    {{nfsstat3::NFS3ERR_NOENT,
+                      LOOKUP3resfail{statToPostOpAttr(dirStat)}}}};
+                serializePresized(ser, res);
               } else {
-                const auto& [ino, stat] = lookupTry.value();
+                const auto& [ino, stat] = *lookupTry.value();
                 LOOKUP3res res{
                     {{nfsstat3::NFS3_OK,
                       LOOKUP3resok{
@@ -592,7 +925,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::lookup(
                           /*dir_attributes*/
                           statToPostOpAttr(dirStat),
                       }}}};
-                XdrTrait<LOOKUP3res>::serialize(ser, res);
+                serializePresized(ser, res);
               }
               return folly::unit;
             });
@@ -615,14 +948,14 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::access(
 
   auto args = XdrTrait<ACCESS3args>::deserialize(deser);
 
-  return dispatcher_->getattr(args.object.ino, context)
+  return getattrAfterWrites(args.object.ino, context)
       .thenTry([ser = std::move(ser), desiredAccess = args.access](
                    folly::Try<struct stat>&& try_) mutable {
         if (try_.hasException()) {
           ACCESS3res res{
               {{exceptionToNfsError(try_.exception()),
                 ACCESS3resfail{post_op_attr{}}}}};
-          XdrTrait<ACCESS3res>::serialize(ser, res);
+          serializePresized(ser, res);
         } else {
           const auto& stat = try_.value();
 
@@ -632,7 +965,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::access(
                     post_op_attr{statToFattr3(stat)},
                     /*access*/ getEffectiveAccessRights(stat, desiredAccess),
                 }}}};
-          XdrTrait<ACCESS3res>::serialize(ser, res);
+          serializePresized(ser, res);
         }
 
         return folly::unit;
@@ -657,7 +990,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::readlink(
                 READLINK3res res{
                     {{exceptionToNfsError(tryReadlink.exception()),
                       READLINK3resfail{statToPostOpAttr(tryAttr)}}}};
-                XdrTrait<READLINK3res>::serialize(ser, res);
+                serializePresized(ser, res);
               } else {
                 auto&& link = std::move(tryReadlink).value();
 
@@ -667,7 +1000,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::readlink(
                           /*symlink_attributes*/ statToPostOpAttr(tryAttr),
                           /*data*/ std::move(link),
                       }}}};
-                XdrTrait<READLINK3res>::serialize(ser, res);
+                serializePresized(ser, res);
               }
 
               return folly::unit;
@@ -682,7 +1015,11 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::read(
   serializeReply(ser, accept_stat::SUCCESS, context.getXid());
   auto args = XdrTrait<READ3args>::deserialize(deser);
 
-  return dispatcher_->read(args.file.ino, args.count, args.offset, context)
+  return writeBehind_.wait(args.file.ino)
+      .thenValue([this, args, &context](auto&&) {
+        return dispatcher_->read(
+            args.file.ino, args.count, args.offset, context);
+      })
       .thenTry([this, ser = std::move(ser), ino = args.file.ino, &context](
                    folly::Try<NfsDispatcher::ReadRes> tryRead) mutable {
         return dispatcher_->getattr(ino, context)
@@ -692,7 +1029,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::read(
                 READ3res res{
                     {{exceptionToNfsError(tryRead.exception()),
                       READ3resfail{statToPostOpAttr(tryStat)}}}};
-                XdrTrait<READ3res>::serialize(ser, res);
+                serializePresized(ser, res);
               } else {
                 auto& read = tryRead.value();
                 auto length = read.data->computeChainDataLength();
@@ -701,15 +1038,18 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::read(
                 XDCHECK_LE(
                     length, size_t{std::numeric_limits<uint32_t>::max()});
 
-                READ3res res{
-                    {{nfsstat3::NFS3_OK,
-                      READ3resok{
-                          /*file_attributes*/ statToPostOpAttr(tryStat),
-                          /*count*/ folly::to_narrow(length),
-                          /*eof*/ read.isEof,
-                          /*data*/ std::move(read.data),
-                      }}}};
-                XdrTrait<READ3res>::serialize(ser, res);
+                // This is the serialization of a successful READ3res, done by
+                // hand so the data is moved into the reply: the blob or
+                // overlay buffers are then referenced by the reply chain
+                // instead of being cloned, and the padding doesn't force a
+                // new allocation after them.
+                XdrTrait<nfsstat3>::serialize(ser, nfsstat3::NFS3_OK);
+                XdrTrait<post_op_attr>::serialize(
+                    ser, statToPostOpAttr(tryStat));
+                XdrTrait<uint32_t>::serialize(ser, folly::to_narrow(length));
+                XdrTrait<bool>::serialize(ser, read.isEof);
+                XdrTrait<std::unique_ptr<folly::IOBuf>>::serialize(
+                    ser, std::move(read.data));
               }
               return folly::unit;
             });
@@ -719,11 +1059,13 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::read(
 /**
  * Generate a unique per-EdenFS instance write cookie.
  *
- * TODO(xavierd): Note that for now this will always be 0 as this is to handle
- * the case where the server restart while the client isn't aware.
+ * The client compares the cookies returned by WRITE and COMMIT: when they
+ * differ, the server may have lost UNSTABLE writes, for instance due to a
+ * restart, and the client will send them again.
  */
 writeverf3 makeWriteVerf() {
-  return 0;
+  static const writeverf3 verf = folly::Random::rand64();
+  return verf;
 }
 
 ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::write(
@@ -733,20 +1075,94 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::write(
   serializeReply(ser, accept_stat::SUCCESS, context.getXid());
   auto args = XdrTrait<WRITE3args>::deserialize(deser);
 
-  // I have no idea why NFS sent us data that we shouldn't write to the file,
-  // but here it is, let's only take up to count bytes from the data.
-  auto queue = folly::IOBufQueue();
-  queue.append(std::move(args.data));
-  auto data = queue.split(args.count);
+  // The data shares the memory of the request, which is written to the
+  // overlay as is.
+  auto data = std::move(args.data);
+  auto length = data->computeChainDataLength();
+  if (length > args.count) {
+    // I have no idea why NFS sent us data that we shouldn't write to the
+    // file, but here it is, let's only take up to count bytes from the data.
+    auto queue = folly::IOBufQueue();
+    queue.append(std::move(data));
+    data = queue.split(args.count);
+    length = args.count;
+  }
 
-  return dispatcher_
-      ->write(args.file.ino, std::move(data), args.offset, context)
-      .thenTry([ser = std::move(ser)](
+  auto ino = args.file.ino;
+  auto pendingEnd = args.stable == stable_how::UNSTABLE
+      ? writeBehind_.start(ino, args.offset, length)
+      : std::nullopt;
+  if (pendingEnd.has_value()) {
+    // Request the attributes before dispatching the write, the wcc data of
+    // the reply extends them by the writes in flight and this one.
+    auto preStatFut = dispatcher_->getattr(ino, context);
+
+    // Reply right away and write the data to the overlay in the background.
+    // The request context is gone by the time the write runs.
+    dispatcher_
+        ->write(
+            ino,
+            std::move(data),
+            args.offset,
+            ObjectFetchContext::getNullContext())
+        .semi()
+        .via(&folly::QueuedImmediateExecutor::instance())
+        .thenTry([this, ino, length](
+                     folly::Try<NfsDispatcher::WriteRes> writeTry) {
+          writeBehind_.complete(
+              ino,
+              length,
+              writeTry.hasException() ? std::move(writeTry.exception())
+                                      : folly::exception_wrapper{});
+        });
+
+    return std::move(preStatFut)
+        .thenTry([this,
+                  ser = std::move(ser),
+                  length,
+                  previousEnd = *pendingEnd,
+                  end = args.offset + length](
+                     folly::Try<struct stat> tryStat) mutable {
+          std::optional<struct stat> preStat;
+          std::optional<struct stat> postStat;
+          if (tryStat.hasValue()) {
+            auto now = dispatcher_->getClock().getRealtime();
+            preStat = tryStat.value();
+            preStat->st_size = std::max<off_t>(
+                preStat->st_size, folly::to_signed(previousEnd));
+            postStat = statAfterWrite(*preStat, end, now);
+          }
+
+          WRITE3res res{
+              {{nfsstat3::NFS3_OK,
+                WRITE3resok{
+                    /*file_wcc*/ statToWccData(preStat, postStat),
+                    /*count*/ folly::to_narrow(length),
+                    /*committed*/ stable_how::UNSTABLE,
+                    /*verf*/ makeWriteVerf(),
+                }}}};
+          serializePresized(ser, res);
+          return folly::unit;
+        });
+  }
+
+  auto stable = args.stable;
+  return dispatcher_->write(ino, std::move(data), args.offset, context)
+      .thenValue([this, ino, stable, &context](NfsDispatcher::WriteRes res) {
+        if (stable == stable_how::UNSTABLE) {
+          return ImmediateFuture<NfsDispatcher::WriteRes>{std::move(res)};
+        }
+        return dispatcher_->commit(ino, context)
+            .thenValue([res = std::move(res)](auto&&) mutable {
+              return std::move(res);
+            });
+      })
+      .thenTry([ser = std::move(ser), stable](
                    folly::Try<NfsDispatcher::WriteRes> writeTry) mutable {
         if (writeTry.hasException()) {
           WRITE3res res{
               {{exceptionToNfsError(writeTry.exception()), WRITE3resfail{}}}};
-          XdrTrait<WRITE3res>::serialize(ser, res);
+          serializePresized(ser, res);
         } else {
           const auto& writeRes = writeTry.value();
 
@@ -762,15 +1178,12 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::write(
                     /*file_wcc*/ statToWccData(
                         writeRes.preStat, writeRes.postStat),
                     /*count*/ folly::to_narrow(writeRes.written),
-                    // TODO(xavierd): the following is a total lie and we
-                    // should call inode->fdatasync() in the case where
-                    // args.stable is anything other than
-                    // stable_how::UNSTABLE. For testing purpose, this is
-                    // OK.
-                    /*committed*/ stable_how::FILE_SYNC,
+                    /*committed*/ stable == stable_how::UNSTABLE
+                        ? stable_how::UNSTABLE
+                        : stable_how::FILE_SYNC,
                     /*verf*/ makeWriteVerf(),
                 }}}};
-          XdrTrait<WRITE3res>::serialize(ser, res);
+          serializePresized(ser, res);
         }
 
         return folly::unit;
@@ -810,7 +1223,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::create(
   if (args.how.tag == createmode3::EXCLUSIVE) {
     // Exclusive file creation is complicated, for now let's not support it.
     CREATE3res res{{{nfsstat3::NFS3ERR_NOTSUPP, CREATE3resfail{wcc_data{}}}}};
-    XdrTrait<CREATE3res>::serialize(ser, res);
+    serializePresized(ser, res);
     return folly::unit;
   }
 
@@ -845,11 +1258,11 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::create(
                           /*before*/ pre_op_attr{},
                           /*after*/ post_op_attr{},
                       }}}}};
-            XdrTrait<CREATE3res>::serialize(ser, res);
+            serializePresized(ser, res);
           } else {
             CREATE3res res{
                 {{exceptionToNfsError(try_.exception()), CREATE3resfail{}}}};
-            XdrTrait<CREATE3res>::serialize(ser, res);
+            serializePresized(ser, res);
           }
         } else {
           const auto& createRes = try_.value();
@@ -863,7 +1276,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::create(
                     /*dir_wcc*/
                     statToWccData(createRes.preDirStat, createRes.postDirStat),
                 }}}};
-          XdrTrait<CREATE3res>::serialize(ser, res);
+          serializePresized(ser, res);
         }
         return folly::unit;
       });
@@ -879,7 +1292,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::mkdir(
   // Don't allow creating this directory and its parent.
   if (args.where.name == "." || args.where.name == "..") {
     MKDIR3res res{{{nfsstat3::NFS3ERR_EXIST, MKDIR3resfail{}}}};
-    XdrTrait<MKDIR3res>::serialize(ser, res);
+    serializePresized(ser, res);
     return folly::unit;
   }
 
@@ -902,7 +1315,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::mkdir(
         if (try_.hasException()) {
           MKDIR3res res{
               {{exceptionToNfsError(try_.exception()), MKDIR3resfail{}}}};
-          XdrTrait<MKDIR3res>::serialize(ser, res);
+          serializePresized(ser, res);
         } else {
           const auto& mkdirRes = try_.value();
 
@@ -915,7 +1328,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::mkdir(
                     /*dir_wcc*/
                     statToWccData(mkdirRes.preDirStat, mkdirRes.postDirStat),
                 }}}};
-          XdrTrait<MKDIR3res>::serialize(ser, res);
+          serializePresized(ser, res);
         }
         return folly::unit;
       });
@@ -931,7 +1344,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::symlink(
   // Don't allow creating a symlink named . or ..
   if (args.where.name == "." || args.where.name == "..") {
     SYMLINK3res res{{{nfsstat3::NFS3ERR_INVAL, SYMLINK3resfail{}}}};
-    XdrTrait<SYMLINK3res>::serialize(ser, res);
+    serializePresized(ser, res);
     return folly::unit;
   }
 
@@ -950,7 +1363,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::symlink(
         if (try_.hasException()) {
           SYMLINK3res res{
               {{exceptionToNfsError(try_.exception()), SYMLINK3resfail{}}}};
-          XdrTrait<SYMLINK3res>::serialize(ser, res);
+          serializePresized(ser, res);
         } else {
           const auto& symlinkRes = try_.value();
 
@@ -964,7 +1377,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::symlink(
                     statToWccData(
                         symlinkRes.preDirStat, symlinkRes.postDirStat),
                 }}}};
-          XdrTrait<SYMLINK3res>::serialize(ser, res);
+          serializePresized(ser, res);
         }
         return folly::unit;
       });
@@ -982,7 +1395,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::mknod(
     case ftype3::NF3DIR:
     case ftype3::NF3LNK: {
       MKNOD3res res{{{nfsstat3::NFS3ERR_BADTYPE, MKNOD3resfail{}}}};
-      XdrTrait<MKNOD3res>::serialize(ser, res);
+      serializePresized(ser, res);
       return folly::unit;
     }
     default:
@@ -992,7 +1405,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::mknod(
   // Don't allow creating a node name . or ..
   if (args.where.name == "." || args.where.name == "..") {
     MKNOD3res res{{{nfsstat3::NFS3ERR_INVAL, MKNOD3resfail{}}}};
-    XdrTrait<MKNOD3res>::serialize(ser, res);
+    serializePresized(ser, res);
     return folly::unit;
   }
 
@@ -1008,7 +1421,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::mknod(
     // This can only happen if the deserialization code is wrong, but let's be
     // safe.
     MKNOD3res res{{{nfsstat3::NFS3ERR_SERVERFAULT, MKNOD3resfail{}}}};
-    XdrTrait<MKNOD3res>::serialize(ser, res);
+    serializePresized(ser, res);
     return folly::unit;
   }
 
@@ -1025,7 +1438,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::mknod(
         if (try_.hasException()) {
           MKNOD3res res{
               {{exceptionToNfsError(try_.exception()), MKNOD3resfail{}}}};
-          XdrTrait<MKNOD3res>::serialize(ser, res);
+          serializePresized(ser, res);
         } else {
           const auto& mknodRes = try_.value();
 
@@ -1038,7 +1451,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::mknod(
                     /*dir_wcc*/
                     statToWccData(mknodRes.preDirStat, mknodRes.postDirStat),
                 }}}};
-          XdrTrait<MKNOD3res>::serialize(ser, res);
+          serializePresized(ser, res);
         }
         return folly::unit;
       });
@@ -1054,7 +1467,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::remove(
   // Don't allow removing the special directories.
   if (args.object.name == "." || args.object.name == "..") {
     REMOVE3res res{{{nfsstat3::NFS3ERR_ACCES, REMOVE3resfail{}}}};
-    XdrTrait<REMOVE3res>::serialize(ser, res);
+    serializePresized(ser, res);
     return folly::unit;
   }
 
@@ -1073,7 +1486,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::remove(
         if (try_.hasException()) {
           REMOVE3res res{
               {{exceptionToNfsError(try_.exception()), REMOVE3resfail{}}}};
-          XdrTrait<REMOVE3res>::serialize(ser, res);
+          serializePresized(ser, res);
         } else {
           const auto& unlinkRes = try_.value();
 
@@ -1081,7 +1494,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::remove(
               {{nfsstat3::NFS3_OK,
                 REMOVE3resok{/*dir_wcc*/ statToWccData(
                     unlinkRes.preDirStat, unlinkRes.postDirStat)}}}};
-          XdrTrait<REMOVE3res>::serialize(ser, res);
+          serializePresized(ser, res);
         }
         return folly::unit;
       });
@@ -1100,7 +1513,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::rmdir(
     auto status = args.object.name == "." ? nfsstat3::NFS3ERR_INVAL
                                           : nfsstat3::NFS3ERR_EXIST;
     RMDIR3res res{{{status, RMDIR3resfail{}}}};
-    XdrTrait<RMDIR3res>::serialize(ser, res);
+    serializePresized(ser, res);
     return folly::unit;
   }
 
@@ -1114,7 +1527,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::rmdir(
         if (try_.hasException()) {
           RMDIR3res res{
               {{exceptionToNfsError(try_.exception()), RMDIR3resfail{}}}};
-          XdrTrait<RMDIR3res>::serialize(ser, res);
+          serializePresized(ser, res);
         } else {
           const auto& rmdirRes = try_.value();
 
@@ -1122,7 +1535,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::rmdir(
               {{nfsstat3::NFS3_OK,
                 RMDIR3resok{/*dir_wcc*/ statToWccData(
                     rmdirRes.preDirStat, rmdirRes.postDirStat)}}}};
-          XdrTrait<RMDIR3res>::serialize(ser, res);
+          serializePresized(ser, res);
         }
         return folly::unit;
       });
@@ -1138,14 +1551,14 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::rename(
   if (args.from.name == "." || args.from.name == ".." || args.to.name == "." ||
       args.to.name == "..") {
     RENAME3res res{{{nfsstat3::NFS3ERR_INVAL, RENAME3resfail{}}}};
-    XdrTrait<RENAME3res>::serialize(ser, res);
+    serializePresized(ser, res);
     return folly::unit;
   }
 
   // Do nothing if the source and destination are the exact same file.
   if (args.from == args.to) {
     RENAME3res res{{{nfsstat3::NFS3_OK, RENAME3resok{}}}};
-    XdrTrait<RENAME3res>::serialize(ser, res);
+    serializePresized(ser, res);
     return folly::unit;
   }
 
@@ -1171,7 +1584,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::rename(
         if (try_.hasException()) {
           RENAME3res res{
               {{exceptionToNfsError(try_.exception()), RENAME3resfail{}}}};
-          XdrTrait<RENAME3res>::serialize(ser, res);
+          serializePresized(ser, res);
         } else {
           const auto& renameRes = try_.value();
 
@@ -1184,7 +1597,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::rename(
                     statToWccData(
                         renameRes.toPreDirStat, renameRes.toPostDirStat),
                 }}}};
-          XdrTrait<RENAME3res>::serialize(ser, res);
+          serializePresized(ser, res);
         }
 
         return folly::unit;
@@ -1206,7 +1619,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::link(
             LINK3res res{
                 {{nfsstat3::NFS3ERR_NOTSUPP,
                   LINK3resfail{statToPostOpAttr(try_), wcc_data{}}}}};
-            XdrTrait<LINK3res>::serialize(ser, res);
+            serializePresized(ser, res);
             return folly::unit;
           });
 }
@@ -1247,7 +1660,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::readdir(
 
   if (!isReaddirCookieverfValid(args.cookieverf)) {
     READDIR3res res{{{nfsstat3::NFS3ERR_BAD_COOKIE, READDIR3resfail{}}}};
-    XdrTrait<READDIR3res>::serialize(ser, res);
+    serializePresized(ser, res);
     return folly::unit;
   }
 
@@ -1261,7 +1674,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::readdir(
                 READDIR3res res{
                     {{exceptionToNfsError(try_.exception()),
                       READDIR3resfail{statToPostOpAttr(tryStat)}}}};
-                XdrTrait<READDIR3res>::serialize(ser, res);
+                serializePresized(ser, res);
               } else {
                 auto& readdirRes = try_.value();
 
@@ -1275,7 +1688,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::readdir(
                               /*entries*/ readdirRes.entries.extractList(),
                               /*eof*/ readdirRes.isEof,
                           }}}}};
-                XdrTrait<READDIR3res>::serialize(ser, res);
+                serializePresized(ser, res);
               }
               return folly::unit;
             });
@@ -1283,11 +1696,67 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::readdir(
 }
 
 ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::readdirplus(
-    folly::io::Cursor /*deser*/,
+    folly::io::Cursor deser,
     folly::io::QueueAppender ser,
     NfsRequestContext& context) {
-  serializeReply(ser, accept_stat::PROC_UNAVAIL, context.getXid());
-  return folly::unit;
+  serializeReply(ser, accept_stat::SUCCESS, context.getXid());
+  auto args = XdrTrait<READDIRPLUS3args>::deserialize(deser);
+
+  if (!isReaddirCookieverfValid(args.cookieverf)) {
+    READDIRPLUS3res res{
+        {{nfsstat3::NFS3ERR_BAD_COOKIE, READDIRPLUS3resfail{}}}};
+    serializePresized(ser, res);
+    return folly::unit;
+  }
+
+  return dispatcher_
+      ->readdirplus(
+          args.dir.ino, args.cookie, args.dircount, args.maxcount, context)
+      .thenValue([this, &context](NfsDispatcher::ReaddirplusRes res) {
+        return refreshPendingAttributes(std::move(res), context);
+      })
+      .thenTry([this, ino = args.dir.ino, ser = std::move(ser), &context](
+                   folly::Try<NfsDispatcher::ReaddirplusRes> try_) mutable {
+        return dispatcher_->getattr(ino, context)
+            .thenTry([ser = std::move(ser), try_ = std::move(try_)](
+                         const folly::Try<struct stat>& tryStat) mutable {
+              if (try_.hasException()) {
+                READDIRPLUS3res res{
+                    {{exceptionToNfsError(try_.exception()),
+                      READDIRPLUS3resfail{statToPostOpAttr(tryStat)}}}};
+                serializePresized(ser, res);
+              } else {
+                auto& readdirRes = try_.value();
+
+                // The file handle of an entry is just its inode number, so
+                // every entry gets one. Its attributes may be missing.
+                auto entries = readdirRes.entries.extractList();
+                auto& attributes = readdirRes.attributes;
+                for (size_t i = 0; i < entries.list.size(); ++i) {
+                  auto& entry = entries.list[i];
+                  entry.name_handle =
+                      post_op_fh3{nfs_fh3{InodeNumber{entry.fileid}}};
+                  if (i < attributes.size() && attributes[i].has_value()) {
+                    entry.name_attributes =
+                        post_op_attr{statToFattr3(*attributes[i])};
+                  }
+                }
+
+                READDIRPLUS3res res{
+                    {{nfsstat3::NFS3_OK,
+                      READDIRPLUS3resok{
+                          /*dir_attributes*/ statToPostOpAttr(tryStat),
+                          /*cookieverf*/ getReaddirCookieverf(),
+                          /*reply*/
+                          dirlistplus3{
+                              /*entries*/ std::move(entries),
+                              /*eof*/ readdirRes.isEof,
+                          }}}}};
+                serializePresized(ser, res);
+              }
+              return folly::unit;
+            });
+      });
 }
 
 ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::fsstat(
@@ -1307,7 +1776,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::fsstat(
                 FSSTAT3res res{
                     {{exceptionToNfsError(statFsTry.exception()),
                       FSSTAT3resfail{statToPostOpAttr(statTry)}}}};
-                XdrTrait<FSSTAT3res>::serialize(ser, res);
+                serializePresized(ser, res);
               } else {
                 auto& statfs = statFsTry.value();
 
@@ -1323,7 +1792,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::fsstat(
                           /*afiles*/ statfs.f_ffree,
                           /*invarsec*/ 0,
                       }}}};
-                XdrTrait<FSSTAT3res>::serialize(ser, res);
+                serializePresized(ser, res);
               }
 
               return folly::unit;
@@ -1356,7 +1825,7 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::fsinfo(
             /*properties*/ FSF3_SYMLINK | FSF3_HOMOGENEOUS | FSF3_CANSETTIME,
         }}}};
 
-  XdrTrait<FSINFO3res>::serialize(ser, res);
+  serializePresized(ser, res);
 
   return folly::unit;
 }
@@ -1382,17 +1851,44 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::pathconf(
             /*case_preserving=*/true,
         }}}};
 
-  XdrTrait<PATHCONF3res>::serialize(ser, res);
+  serializePresized(ser, res);
 
   return folly::unit;
 }
 
 ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::commit(
-    folly::io::Cursor /*deser*/,
+    folly::io::Cursor deser,
     folly::io::QueueAppender ser,
     NfsRequestContext& context) {
-  serializeReply(ser, accept_stat::PROC_UNAVAIL, context.getXid());
-  return folly::unit;
+  serializeReply(ser, accept_stat::SUCCESS, context.getXid());
+  auto args = XdrTrait<COMMIT3args>::deserialize(deser);
+
+  // The offset and count are ignored and the entire file is committed.
+  auto ino = args.file.ino;
+  return writeBehind_.wait(ino)
+      .thenValue(
+          [this, ino, &context](auto&&) -> ImmediateFuture<folly::Unit> {
+            if (auto error = writeBehind_.takeError(ino)) {
+              return folly::Try<folly::Unit>{std::move(error)};
+            }
+            return dispatcher_->commit(ino, context);
+          })
+      .thenTry([ser = std::move(ser)](folly::Try<folly::Unit> try_) mutable {
+        if (try_.hasException()) {
+          COMMIT3res res{
+              {{exceptionToNfsError(try_.exception()), COMMIT3resfail{}}}};
+          serializePresized(ser, res);
+        } else {
+          COMMIT3res res{
+              {{nfsstat3::NFS3_OK,
+                COMMIT3resok{
+                    /*file_wcc*/ statToWccData(std::nullopt, std::nullopt),
+                    /*verf*/ makeWriteVerf(),
+                }}}};
+          serializePresized(ser, res);
+        }
+        return folly::unit;
+      });
 }
 
 NfsArgsDetails formatNull(folly::io::Cursor /*deser*/) {
@@ -1665,9 +2161,15 @@ NfsArgsDetails formatPathconf(folly::io::Cursor deser) {
   return {fmt::format(FMT_STRING("ino={}"), args.object.ino), args.object.ino};
 }
 
-NfsArgsDetails formatCommit(folly::io::Cursor /*deser*/) {
-  // TODO(xavierd): Fill this in.
-  return {""};
+NfsArgsDetails formatCommit(folly::io::Cursor deser) {
+  auto args = XdrTrait<COMMIT3args>::deserialize(deser);
+  return {
+      fmt::format(
+          FMT_STRING("ino={}, offset={}, count={}"),
+          args.file.ino,
+          args.offset,
+          args.count),
+      args.file.ino};
 }
 
 using Handler = ImmediateFuture<folly::Unit> (Nfsd3ServerProcessor::*)(
@@ -1896,10 +2398,34 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::dispatchRpc(
     return folly::unit;
   }
 
+  if (progVersion == kNfsd4ProgVersion) {
+    // A COMPOUND can't be classified before it is decoded, it shares the
+    // metadata budget.
+    return metadataAdmission_.admit().thenValue(
+        [this,
+         deser = std::move(deser),
+         ser = std::move(ser),
+         xid,
+         progNumber,
+         progVersion,
+         procNumber](auto&&) mutable {
+          return makeImmediateFutureWith([&]() {
+                   return nfsd4_.dispatchRpc(
+                       std::move(deser),
+                       std::move(ser),
+                       xid,
+                       progNumber,
+                       progVersion,
+                       procNumber);
+                 })
+              .ensure([this]() { metadataAdmission_.release(); });
+        });
+  }
+
   if (progVersion != kNfsd3ProgVersion) {
     serializeReply(ser, accept_stat::PROG_MISMATCH, xid);
     XdrTrait<mismatch_info>::serialize(
-        ser, mismatch_info{kNfsd3ProgVersion, kNfsd3ProgVersion});
+        ser, mismatch_info{kNfsd3ProgVersion, kNfsd4ProgVersion});
     return folly::unit;
   }
 
@@ -1921,33 +2447,66 @@ ImmediateFuture<folly::Unit> Nfsd3ServerProcessor::dispatchRpc(
       traceBus_, traceDetailedArguments_, handlerEntry, deser, xid, procNumber};
 
   // TODO: Add requestMetrics for NFS.
-  std::shared_ptr<RequestMetricsScope::LockedRequestWatchList> nullRequestWatch;
+  std::shared_ptr<RequestWatchList> nullRequestWatch;
   auto context = std::make_unique<NfsRequestContext>(
       xid, handlerEntry.name, processAccessLog_);
   context->startRequest(
       dispatcher_->getStats(), handlerEntry.stat, nullRequestWatch);
 
+  auto& admission =
+      isDataProcedure(procNumber) ? dataAdmission_ : metadataAdmission_;
+
   // The data that contextRef reference to is alive for the duration of the
   // handler function and is deleted when context unique_ptr goes out of the
   // scope at the `ensure` lambda.
   auto& contextRef = *context;
-  return (this->*handlerEntry.handler)(
-             std::move(deser), std::move(ser), contextRef)
+  return admission.admit()
+      .thenValue([this,
+                  handler = handlerEntry.handler,
+                  deser = std::move(deser),
+                  ser = std::move(ser),
+                  &contextRef,
+                  &admission](auto&&) mutable {
+        auto allocations = getImmediateFutureAllocationCount();
+        auto result = makeImmediateFutureWith([&]() {
+                        return (this->*handler)(
+                            std::move(deser), std::move(ser), contextRef);
+                      }).ensure([&admission]() { admission.release(); });
+        dispatcher_->getStats()
+            ->getChannelStatsForCurrentThread()
+            .nfsFutureAllocations.addValue(
+                getImmediateFutureAllocationCount() - allocations);
+        return result;
+      })
       .ensure([liveRequest = std::move(liveRequest),
                context = std::move(context)]() { context->finishRequest(); });
 }
 
+void Nfsd3ServerProcessor::onRepliesFlushed(size_t numReplies) {
+  dispatcher_->getStats()
+      ->getChannelStatsForCurrentThread()
+      .nfsRepliesPerWrite.addValue(numReplies);
+}
+
 void Nfsd3ServerProcessor::onSocketClosed() {
-  // Note this triggers the Nfsd3 destruction which will also destroy
-  // Nfsd3ServerProcessor. Don't do anything will the Nfsd3ServerProcessor
-  // member variables after this!
-  stopPromise_.setValue(Nfsd3::StopData{});
+  // The background writes reference this Nfsd3ServerProcessor, wait for them
+  // before letting the Nfsd3 be destroyed.
+  writeBehind_.waitAll()
+      .semi()
+      .via(&folly::QueuedImmediateExecutor::instance())
+      .thenValue([this](auto&&) {
+        // Note this triggers the Nfsd3 destruction which will also destroy
+        // Nfsd3ServerProcessor. Don't do anything will the
+        // Nfsd3ServerProcessor member variables after this!
+        stopPromise_.setValue(Nfsd3::StopData{});
+      });
 }
 } // namespace
 
 Nfsd3::Nfsd3(
     folly::EventBase* evb,
     std::shared_ptr<folly::Executor> threadPool,
+    std::shared_ptr<folly::IOExecutor> ioPool,
     std::unique_ptr<NfsDispatcher> dispatcher,
     const folly::Logger* straceLogger,
     std::shared_ptr<ProcessNameCache> processNameCache,
@@ -1955,19 +2514,24 @@ Nfsd3::Nfsd3(
     folly::Duration /*requestTimeout*/,
     Notifications* /*notifications*/,
     CaseSensitivity caseSensitive,
-    uint32_t iosize)
+    uint32_t iosize,
+    size_t maxInflightMetadataRequests,
+    size_t maxInflightDataRequests)
     : server_(
           std::make_shared<Nfsd3ServerProcessor>(
               std::move(dispatcher),
               straceLogger,
               caseSensitive,
               iosize,
+              maxInflightMetadataRequests,
+              maxInflightDataRequests,
               stopPromise_,
               processAccessLog_,
               traceDetailedArguments_,
               traceBus_),
           evb,
-          std::move(threadPool)),
+          std::move(threadPool),
+          std::move(ioPool)),
       processAccessLog_(std::move(processNameCache)),
       invalidationExecutor_{
           folly::SerialExecutor::create(folly::getGlobalCPUExecutor())},
@@ -2020,6 +2584,7 @@ void Nfsd3::initialize(folly::SocketAddress addr, bool registerWithRpcbind) {
   server_.initialize(addr);
   if (registerWithRpcbind) {
     server_.registerService(kNfsdProgNumber, kNfsd3ProgVersion);
+    server_.registerService(kNfsdProgNumber, kNfsd4ProgVersion);
   }
 }
 
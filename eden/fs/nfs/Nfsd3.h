@@ -118,8 +118,19 @@ class Nfsd3 {
    * registered with rpcbind, and thus if a real NFS server is running on this
    * host, EdenFS won't be able to register itself.
    *
-   * All the socket processing will be run on the EventBase passed in. This
-   * also must be called on that EventBase thread.
+   * Connections are accepted on the EventBase passed in, and serviced on it
+   * unless an ioPool is given, see RpcServer. This also must be called on that
+   * EventBase thread.
+   *
+   * The READ, WRITE and COMMIT procedures can wait on the backing store or
+   * the overlay for a long time. At most maxInflightDataRequests of them are
+   * processed at once, and at most maxInflightMetadataRequests of the other
+   * procedures, the requests above these budgets are queued. This keeps the
+   * metadata requests flowing while the data requests are waiting. A budget
+   * of 0 means no limit.
+   *
+   * The NFSv4.1 calls received on the same socket are served by an
+   * Nfsd4ServerProcessor, against the same dispatcher.
    *
    * Note: at mount time, EdenFS will manually call mount.nfs with -o port
    * to manually specify the port on which this server is bound, so registering
@@ -128,6 +139,7 @@ class Nfsd3 {
   Nfsd3(
       folly::EventBase* evb,
       std::shared_ptr<folly::Executor> threadPool,
+      std::shared_ptr<folly::IOExecutor> ioPool,
       std::unique_ptr<NfsDispatcher> dispatcher,
       const folly::Logger* straceLogger,
       std::shared_ptr<ProcessNameCache> processNameCache,
@@ -135,7 +147,9 @@ class Nfsd3 {
       folly::Duration requestTimeout,
       Notifications* FOLLY_NULLABLE notifications,
       CaseSensitivity caseSensitive,
-      uint32_t iosize);
+      uint32_t iosize,
+      size_t maxInflightMetadataRequests,
+      size_t maxInflightDataRequests);
 
   /**
    * This is triggered when the kernel closes the socket. The socket is closed
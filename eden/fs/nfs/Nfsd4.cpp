@@ -0,0 +1,1048 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#ifndef _WIN32
+
+#include "eden/fs/nfs/Nfsd4.h"
+
+#ifndef __APPLE__
+#include <sys/sysmacros.h>
+#endif
+
+#include <folly/Conv.h>
+#include <folly/Utility.h>
+#include <folly/futures/Future.h>
+#include <folly/logging/xlog.h>
+#include <algorithm>
+#include <chrono>
+#include "eden/fs/nfs/NfsRequestContext.h"
+#include "eden/fs/telemetry/RequestMetricsScope.h"
+#include "eden/fs/utils/SystemError.h"
+
+namespace facebook::eden {
+
+/**
+ * The state of a COMPOUND while its operations are being executed.
+ *
+ * The operations are decoded one at a time from deser, and their results
+ * accumulated in results as the number of results and the overall status are
+ * only known once the COMPOUND completes.
+ */
+struct CompoundState {
+  explicit CompoundState(folly::io::Cursor deser, uint32_t numOps)
+      : deser{std::move(deser)}, numOps{numOps}, remainingOps{numOps} {}
+
+  folly::io::Cursor deser;
+  const uint32_t numOps;
+  uint32_t remainingOps;
+
+  /**
+   * Set once the SEQUENCE starting the COMPOUND succeeded.
+   */
+  bool inSession{false};
+
+  folly::IOBufQueue results{folly::IOBufQueue::cacheChainLength()};
+  folly::io::QueueAppender ser{&results, 1024};
+  uint32_t numResults{0};
+  nfsstat4 status{nfsstat4::NFS4_OK};
+
+  std::optional<InodeNumber> currentFh;
+  std::optional<InodeNumber> savedFh;
+
+  /**
+   * Append the result of an operation, the operation specific result
+   * needs to be serialized right after when status is NFS4_OK.
+   */
+  void addResult(nfs_opnum4 op, nfsstat4 opStatus) {
+    XdrTrait<nfs_opnum4>::serialize(ser, op);
+    XdrTrait<nfsstat4>::serialize(ser, opStatus);
+    numResults++;
+    status = opStatus;
+  }
+};
+
+namespace {
+
+/**
+ * The client can always split its work in several COMPOUND, limit how much
+ * can be sent in a single one.
+ */
+constexpr uint32_t kMaxCompoundOps = 128;
+
+/**
+ * How long, in seconds, a client lease lasts. The clients and sessions are
+ * only forgotten when destroyed, this is only reported via the lease_time
+ * attribute.
+ */
+constexpr uint32_t kLeaseTime = 90;
+
+/**
+ * Maximum number of slots of a session, that is of requests a client can
+ * have in flight on it.
+ */
+constexpr uint32_t kMaxSlots = 64;
+
+/**
+ * Room left for the RPC and COMPOUND headers around the data of a READ in
+ * the negotiated request and reply sizes.
+ */
+constexpr uint32_t kCompoundOverhead = 4096;
+
+constexpr folly::StringPiece kServerOwner{"edenfs"};
+
+// Values of the fh_expire_type attribute.
+constexpr uint32_t FH4_PERSISTENT = 0;
+
+/**
+ * Convert a exception to the appropriate NFSv4 error value.
+ */
+nfsstat4 exceptionToNfs4Error(const folly::exception_wrapper& ex) {
+  if (auto* err = ex.get_exception<std::system_error>()) {
+    if (!isErrnoError(*err)) {
+      return nfsstat4::NFS4ERR_SERVERFAULT;
+    }
+
+    switch (err->code().value()) {
+      case EPERM:
+        return nfsstat4::NFS4ERR_PERM;
+      case ENOENT:
+        return nfsstat4::NFS4ERR_NOENT;
+      case EIO:
+      case ETXTBSY:
+        return nfsstat4::NFS4ERR_IO;
+      case ENXIO:
+        return nfsstat4::NFS4ERR_NXIO;
+      case EACCES:
+        return nfsstat4::NFS4ERR_ACCESS;
+      case EEXIST:
+        return nfsstat4::NFS4ERR_EXIST;
+      case EXDEV:
+        return nfsstat4::NFS4ERR_XDEV;
+      case ENOTDIR:
+        return nfsstat4::NFS4ERR_NOTDIR;
+      case EISDIR:
+        return nfsstat4::NFS4ERR_ISDIR;
+      case EINVAL:
+        return nfsstat4::NFS4ERR_INVAL;
+      case EFBIG:
+        return nfsstat4::NFS4ERR_FBIG;
+      case EROFS:
+        return nfsstat4::NFS4ERR_ROFS;
+      case EMLINK:
+        return nfsstat4::NFS4ERR_MLINK;
+      case ENAMETOOLONG:
+        return nfsstat4::NFS4ERR_NAMETOOLONG;
+      case ENOTEMPTY:
+        return nfsstat4::NFS4ERR_NOTEMPTY;
+      case EDQUOT:
+        return nfsstat4::NFS4ERR_DQUOT;
+      case ESTALE:
+        return nfsstat4::NFS4ERR_STALE;
+      case ETIMEDOUT:
+      case EAGAIN:
+      case ENOMEM:
+        return nfsstat4::NFS4ERR_DELAY;
+      case ENOTSUP:
+        return nfsstat4::NFS4ERR_NOTSUPP;
+    }
+    return nfsstat4::NFS4ERR_SERVERFAULT;
+  } else if (ex.get_exception<folly::FutureTimeout>()) {
+    return nfsstat4::NFS4ERR_DELAY;
+  } else {
+    return nfsstat4::NFS4ERR_SERVERFAULT;
+  }
+}
+
+/**
+ * Convert the POSIX mode to a NFSv4 file type, these have the same values as
+ * the NFSv3 ones.
+ */
+ftype3 modeToFtype4(mode_t mode) {
+  if (S_ISREG(mode)) {
+    return ftype3::NF3REG;
+  } else if (S_ISDIR(mode)) {
+    return ftype3::NF3DIR;
+  } else if (S_ISBLK(mode)) {
+    return ftype3::NF3BLK;
+  } else if (S_ISCHR(mode)) {
+    return ftype3::NF3CHR;
+  } else if (S_ISLNK(mode)) {
+    return ftype3::NF3LNK;
+  } else if (S_ISSOCK(mode)) {
+    return ftype3::NF3SOCK;
+  } else {
+    XDCHECK(S_ISFIFO(mode));
+    return ftype3::NF3FIFO;
+  }
+}
+
+nfstime4 timespecToNfsTime4(const struct timespec& time) {
+  return nfstime4{
+      time.tv_sec, folly::to_narrow(folly::to_unsigned(time.tv_nsec))};
+}
+
+/**
+ * The attributes that statToFattr4 knows how to encode, in increasing bit
+ * order as this is the order in which they must be encoded.
+ */
+constexpr fattr4_attr kSupportedAttrs[] = {
+    fattr4_attr::supported_attrs, fattr4_attr::type,
+    fattr4_attr::fh_expire_type,  fattr4_attr::change,
+    fattr4_attr::size,            fattr4_attr::link_support,
+    fattr4_attr::symlink_support, fattr4_attr::named_attr,
+    fattr4_attr::fsid,            fattr4_attr::unique_handles,
+    fattr4_attr::lease_time,      fattr4_attr::rdattr_error,
+    fattr4_attr::filehandle,      fattr4_attr::fileid,
+    fattr4_attr::mode,            fattr4_attr::numlinks,
+    fattr4_attr::owner,           fattr4_attr::owner_group,
+    fattr4_attr::rawdev,          fattr4_attr::space_used,
+    fattr4_attr::time_access,     fattr4_attr::time_metadata,
+    fattr4_attr::time_modify,
+};
+
+const bitmap4& supportedAttrsBitmap() {
+  static const bitmap4 bitmap = [] {
+    bitmap4 ret;
+    for (auto attr : kSupportedAttrs) {
+      bitmap4Set(ret, attr);
+    }
+    return ret;
+  }();
+  return bitmap;
+}
+
+/**
+ * Encode the requested attributes, the unsupported ones are silently
+ * ignored and not set in the returned attrmask, as required by the RFC.
+ */
+fattr4 statToFattr4(
+    const bitmap4& request,
+    const struct stat& stat,
+    InodeNumber ino) {
+#ifdef __linux__
+  const auto& atime = stat.st_atim;
+  const auto& mtime = stat.st_mtim;
+  const auto& ctime = stat.st_ctim;
+#else
+  const auto& atime = stat.st_atimespec;
+  const auto& mtime = stat.st_mtimespec;
+  const auto& ctime = stat.st_ctimespec;
+#endif
+
+  fattr4 ret;
+  folly::IOBufQueue queue;
+  folly::io::QueueAppender ser{&queue, 256};
+  for (auto attr : kSupportedAttrs) {
+    if (!bitmap4Contains(request, attr)) {
+      continue;
+    }
+    bitmap4Set(ret.attrmask, attr);
+
+    switch (attr) {
+      case fattr4_attr::supported_attrs:
+        XdrTrait<bitmap4>::serialize(ser, supportedAttrsBitmap());
+        break;
+      case fattr4_attr::type:
+        XdrTrait<ftype3>::serialize(ser, modeToFtype4(stat.st_mode));
+        break;
+      case fattr4_attr::fh_expire_type:
+        XdrTrait<uint32_t>::serialize(ser, FH4_PERSISTENT);
+        break;
+      case fattr4_attr::change:
+        // The change attribute needs to be updated on every data or metadata
+        // modification, which is also what the ctime tracks.
+        XdrTrait<uint64_t>::serialize(
+            ser,
+            folly::to_unsigned(ctime.tv_sec) * 1000000000 +
+                folly::to_unsigned(ctime.tv_nsec));
+        break;
+      case fattr4_attr::size:
+        XdrTrait<uint64_t>::serialize(ser, folly::to_unsigned(stat.st_size));
+        break;
+      case fattr4_attr::link_support:
+      case fattr4_attr::symlink_support:
+      case fattr4_attr::unique_handles:
+        XdrTrait<bool>::serialize(ser, true);
+        break;
+      case fattr4_attr::named_attr:
+        XdrTrait<bool>::serialize(ser, false);
+        break;
+      case fattr4_attr::fsid:
+        XdrTrait<fsid4>::serialize(
+            ser, fsid4{folly::to_unsigned(stat.st_dev), 0});
+        break;
+      case fattr4_attr::lease_time:
+        XdrTrait<uint32_t>::serialize(ser, kLeaseTime);
+        break;
+      case fattr4_attr::rdattr_error:
+        XdrTrait<nfsstat4>::serialize(ser, nfsstat4::NFS4_OK);
+        break;
+      case fattr4_attr::filehandle:
+        XdrTrait<nfs_fh4>::serialize(ser, nfs_fh4{ino});
+        break;
+      case fattr4_attr::fileid:
+        XdrTrait<uint64_t>::serialize(ser, stat.st_ino);
+        break;
+      case fattr4_attr::mode:
+        XdrTrait<uint32_t>::serialize(ser, stat.st_mode & 07777);
+        break;
+      case fattr4_attr::numlinks:
+        XdrTrait<uint32_t>::serialize(ser, folly::to_narrow(stat.st_nlink));
+        break;
+      case fattr4_attr::owner:
+        // Without an idmapper, clients accept the numeric ids.
+        XdrTrait<std::string>::serialize(
+            ser, folly::to<std::string>(stat.st_uid));
+        break;
+      case fattr4_attr::owner_group:
+        XdrTrait<std::string>::serialize(
+            ser, folly::to<std::string>(stat.st_gid));
+        break;
+      case fattr4_attr::rawdev:
+        XdrTrait<specdata4>::serialize(
+            ser,
+            specdata4{
+                static_cast<uint32_t>(major(stat.st_rdev)),
+                static_cast<uint32_t>(minor(stat.st_rdev))});
+        break;
+      case fattr4_attr::space_used:
+        XdrTrait<uint64_t>::serialize(
+            ser, folly::to_unsigned(stat.st_blocks) * 512u);
+        break;
+      case fattr4_attr::time_access:
+        XdrTrait<nfstime4>::serialize(ser, timespecToNfsTime4(atime));
+        break;
+      case fattr4_attr::time_metadata:
+        XdrTrait<nfstime4>::serialize(ser, timespecToNfsTime4(ctime));
+        break;
+      case fattr4_attr::time_modify:
+        XdrTrait<nfstime4>::serialize(ser, timespecToNfsTime4(mtime));
+        break;
+    }
+  }
+
+  auto buf = queue.move();
+  if (buf) {
+    ret.attr_vals.reserve(buf->computeChainDataLength());
+    for (auto range : *buf) {
+      ret.attr_vals.insert(ret.attr_vals.end(), range.begin(), range.end());
+    }
+  }
+  return ret;
+}
+
+/**
+ * Negotiate the attributes of the fore channel of a session, this is the
+ * channel that the COMPOUNDs are sent over. Replies are never cached.
+ */
+channel_attrs4 negotiateForeChannel(
+    const channel_attrs4& requested,
+    uint32_t iosize) {
+  auto maxSize = iosize + kCompoundOverhead;
+  return channel_attrs4{
+      /*ca_headerpadsize*/ 0,
+      /*ca_maxrequestsize*/ std::min(requested.ca_maxrequestsize, maxSize),
+      /*ca_maxresponsesize*/ std::min(requested.ca_maxresponsesize, maxSize),
+      /*ca_maxresponsesize_cached*/ 0,
+      /*ca_maxoperations*/
+      std::clamp(requested.ca_maxoperations, 1u, kMaxCompoundOps),
+      /*ca_maxrequests*/ std::clamp(requested.ca_maxrequests, 1u, kMaxSlots),
+      /*ca_rdma_ird*/ {},
+  };
+}
+
+/**
+ * Decode the csa_sec_parms of a CREATE_SESSION. No callbacks are ever sent,
+ * their content is thus ignored. Returns false for an unknown flavor.
+ */
+bool skipCallbackSecParms(folly::io::Cursor& deser) {
+  auto count = XdrTrait<uint32_t>::deserialize(deser);
+  for (uint32_t i = 0; i < count; i++) {
+    switch (XdrTrait<auth_flavor>::deserialize(deser)) {
+      case auth_flavor::AUTH_NONE:
+        break;
+      case auth_flavor::AUTH_SYS:
+        XdrTrait<authsys_parms>::deserialize(deser);
+        break;
+      case auth_flavor::RPCSEC_GSS:
+        // gcbp_service, gcbp_handle_from_server and gcbp_handle_from_client.
+        XdrTrait<uint32_t>::deserialize(deser);
+        XdrTrait<std::vector<uint8_t>>::deserialize(deser);
+        XdrTrait<std::vector<uint8_t>>::deserialize(deser);
+        break;
+      default:
+        return false;
+    }
+  }
+  return true;
+}
+
+sessionid4 makeSessionId(uint64_t clientId, uint64_t sessionNumber) {
+  sessionid4 ret;
+  for (size_t i = 0; i < 8; i++) {
+    ret[i] = static_cast<uint8_t>(clientId >> (56 - 8 * i));
+    ret[8 + i] = static_cast<uint8_t>(sessionNumber >> (56 - 8 * i));
+  }
+  return ret;
+}
+
+/**
+ * Test if the operation number is defined by NFSv4.1.
+ */
+bool isLegalOp(nfs_opnum4 op) {
+  return folly::to_underlying(op) >=
+      folly::to_underlying(nfs_opnum4::OP_ACCESS) &&
+      folly::to_underlying(op) <=
+      folly::to_underlying(nfs_opnum4::OP_RECLAIM_COMPLETE);
+}
+
+ImmediateFuture<PathComponent> extractPathComponent4(std::string str) {
+  return makeImmediateFutureWith([&]() {
+    try {
+      return PathComponent{str};
+    } catch (const PathComponentNotUtf8& ex) {
+      throw std::system_error(EINVAL, std::system_category(), ex.what());
+    }
+  });
+}
+
+} // namespace
+
+uint32_t getEffectiveAccess4(mode_t mode, uint32_t requested) {
+  uint32_t granted = 0;
+  if (mode & S_IRUSR) {
+    granted |= ACCESS4_READ;
+  }
+  if (mode & S_IWUSR) {
+    granted |= ACCESS4_MODIFY | ACCESS4_EXTEND;
+    if (S_ISDIR(mode)) {
+      // For a directory, DELETE is about removing its entries.
+      granted |= ACCESS4_DELETE;
+    }
+  }
+  if (mode & S_IXUSR) {
+    granted |= S_ISDIR(mode) ? ACCESS4_LOOKUP : ACCESS4_EXECUTE;
+  }
+  return requested & granted;
+}
+
+Nfsd4ServerProcessor::Nfsd4ServerProcessor(
+    NfsDispatcher& dispatcher,
+    const folly::Logger* straceLogger,
+    uint32_t iosize,
+    ProcessAccessLog& processAccessLog)
+    : dispatcher_{dispatcher},
+      straceLogger_{straceLogger},
+      iosize_{iosize},
+      processAccessLog_{processAccessLog} {
+  // The client IDs embed the start time, a restarted EdenFS thus rejects the
+  // ones handed out before with NFS4ERR_STALE_CLIENTID instead of mistaking a
+  // client for another.
+  auto now = std::chrono::system_clock::now().time_since_epoch();
+  sessionState_.wlock()->nextClientId =
+      static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::seconds>(now).count())
+      << 32;
+}
+
+void Nfsd4ServerProcessor::SessionState::removeClient(uint64_t clientId) {
+  auto it = clients.find(clientId);
+  if (it == clients.end()) {
+    return;
+  }
+  clientsByOwner.erase(it->second.ownerId);
+  clients.erase(it);
+  for (auto session = sessions.begin(); session != sessions.end();) {
+    if (session->second.clientId == clientId) {
+      session = sessions.erase(session);
+    } else {
+      ++session;
+    }
+  }
+}
+
+ImmediateFuture<folly::Unit> Nfsd4ServerProcessor::dispatchRpc(
+    folly::io::Cursor deser,
+    folly::io::QueueAppender ser,
+    uint32_t xid,
+    uint32_t progNumber,
+    uint32_t progVersion,
+    uint32_t procNumber) {
+  if (progNumber != kNfsdProgNumber) {
+    serializeReply(ser, accept_stat::PROG_UNAVAIL, xid);
+    return folly::unit;
+  }
+
+  if (progVersion != kNfsd4ProgVersion) {
+    serializeReply(ser, accept_stat::PROG_MISMATCH, xid);
+    XdrTrait<mismatch_info>::serialize(
+        ser, mismatch_info{kNfsd4ProgVersion, kNfsd4ProgVersion});
+    return folly::unit;
+  }
+
+  switch (static_cast<nfsv4Procs>(procNumber)) {
+    case nfsv4Procs::null:
+      FB_LOG(*straceLogger_, DBG7, "NULL()");
+      serializeReply(ser, accept_stat::SUCCESS, xid);
+      return folly::unit;
+    case nfsv4Procs::compound: {
+      std::shared_ptr<RequestWatchList> nullRequestWatch;
+      auto context = std::make_unique<NfsRequestContext>(
+          xid, "COMPOUND", processAccessLog_);
+      context->startRequest(
+          dispatcher_.getStats(),
+          &ChannelThreadStats::nfs4Compound,
+          nullRequestWatch);
+
+      auto& contextRef = *context;
+      return compound(std::move(deser), std::move(ser), contextRef)
+          .ensure([context = std::move(context)]() {
+            context->finishRequest();
+          });
+    }
+  }
+
+  XLOG(ERR) << "Invalid NFSv4 procedure: " << procNumber;
+  serializeReply(ser, accept_stat::PROC_UNAVAIL, xid);
+  return folly::unit;
+}
+
+ImmediateFuture<folly::Unit> Nfsd4ServerProcessor::compound(
+    folly::io::Cursor deser,
+    folly::io::QueueAppender ser,
+    NfsRequestContext& context) {
+  serializeReply(ser, accept_stat::SUCCESS, context.getXid());
+  auto args = XdrTrait<COMPOUND4argsHeader>::deserialize(deser);
+  FB_LOGF(
+      *straceLogger_,
+      DBG7,
+      "COMPOUND(tag={}, minorversion={}, numops={})",
+      args.tag,
+      args.minorversion,
+      args.numops);
+
+  if (args.minorversion != kNfsd4MinorVersion) {
+    XdrTrait<nfsstat4>::serialize(
+        ser, nfsstat4::NFS4ERR_MINOR_VERS_MISMATCH);
+    XdrTrait<std::string>::serialize(ser, args.tag);
+    XdrTrait<uint32_t>::serialize(ser, 0);
+    return folly::unit;
+  }
+
+  if (args.numops > kMaxCompoundOps) {
+    XdrTrait<nfsstat4>::serialize(ser, nfsstat4::NFS4ERR_TOO_MANY_OPS);
+    XdrTrait<std::string>::serialize(ser, args.tag);
+    XdrTrait<uint32_t>::serialize(ser, 0);
+    return folly::unit;
+  }
+
+  auto state = std::make_unique<CompoundState>(std::move(deser), args.numops);
+  auto& stateRef = *state;
+  return processOps(stateRef, context)
+      .thenValue([ser = std::move(ser),
+                  state = std::move(state),
+                  tag = std::move(args.tag)](auto&&) mutable {
+        XdrTrait<nfsstat4>::serialize(ser, state->status);
+        XdrTrait<std::string>::serialize(ser, tag);
+        XdrTrait<uint32_t>::serialize(ser, state->numResults);
+        if (auto results = state->results.move()) {
+          ser.insert(std::move(results));
+        }
+        return folly::unit;
+      });
+}
+
+ImmediateFuture<folly::Unit> Nfsd4ServerProcessor::processOps(
+    CompoundState& state,
+    NfsRequestContext& context) {
+  if (state.remainingOps == 0 || state.status != nfsstat4::NFS4_OK) {
+    return folly::unit;
+  }
+  state.remainingOps--;
+
+  return processOp(state, context).thenValue([this, &state, &context](auto&&) {
+    return processOps(state, context);
+  });
+}
+
+ImmediateFuture<folly::Unit> Nfsd4ServerProcessor::processOp(
+    CompoundState& state,
+    NfsRequestContext& context) {
+  auto op = XdrTrait<nfs_opnum4>::deserialize(state.deser);
+  FB_LOGF(*straceLogger_, DBG7, "COMPOUND op {}", folly::to_underlying(op));
+
+  // The arguments of a failing operation aren't decoded, this is fine as the
+  // COMPOUND stops at it.
+  if (!isLegalOp(op)) {
+    state.addResult(nfs_opnum4::OP_ILLEGAL, nfsstat4::NFS4ERR_OP_ILLEGAL);
+    return folly::unit;
+  }
+
+  if (op == nfs_opnum4::OP_SEQUENCE) {
+    if (state.numResults != 0) {
+      state.addResult(op, nfsstat4::NFS4ERR_SEQUENCE_POS);
+    } else {
+      sequence(state);
+    }
+    return folly::unit;
+  }
+
+  if (!state.inSession) {
+    // Only the operations managing the clients and sessions can be sent
+    // outside of a session, and then on their own.
+    switch (op) {
+      case nfs_opnum4::OP_EXCHANGE_ID:
+      case nfs_opnum4::OP_CREATE_SESSION:
+      case nfs_opnum4::OP_DESTROY_SESSION:
+      case nfs_opnum4::OP_DESTROY_CLIENTID:
+        if (state.numOps != 1) {
+          state.addResult(op, nfsstat4::NFS4ERR_NOT_ONLY_OP);
+          return folly::unit;
+        }
+        break;
+      default:
+        state.addResult(op, nfsstat4::NFS4ERR_OP_NOT_IN_SESSION);
+        return folly::unit;
+    }
+  }
+
+  switch (op) {
+    case nfs_opnum4::OP_EXCHANGE_ID:
+      exchangeId(state);
+      return folly::unit;
+    case nfs_opnum4::OP_CREATE_SESSION:
+      createSession(state);
+      return folly::unit;
+    case nfs_opnum4::OP_DESTROY_SESSION:
+      destroySession(state);
+      return folly::unit;
+    case nfs_opnum4::OP_DESTROY_CLIENTID:
+      destroyClientId(state);
+      return folly::unit;
+    case nfs_opnum4::OP_RECLAIM_COMPLETE:
+      // Nothing is ever reclaimed as no state survives a restart.
+      XdrTrait<RECLAIM_COMPLETE4args>::deserialize(state.deser);
+      state.addResult(op, nfsstat4::NFS4_OK);
+      return folly::unit;
+    case nfs_opnum4::OP_PUTROOTFH:
+      state.currentFh = kRootNodeId;
+      state.addResult(op, nfsstat4::NFS4_OK);
+      return folly::unit;
+    case nfs_opnum4::OP_PUTFH: {
+      auto args = XdrTrait<PUTFH4args>::deserialize(state.deser);
+      state.currentFh = args.object.ino;
+      state.addResult(op, nfsstat4::NFS4_OK);
+      return folly::unit;
+    }
+    case nfs_opnum4::OP_GETFH:
+      if (!state.currentFh) {
+        state.addResult(op, nfsstat4::NFS4ERR_NOFILEHANDLE);
+      } else {
+        state.addResult(op, nfsstat4::NFS4_OK);
+        XdrTrait<GETFH4resok>::serialize(
+            state.ser, GETFH4resok{nfs_fh4{*state.currentFh}});
+      }
+      return folly::unit;
+    case nfs_opnum4::OP_SAVEFH:
+      if (!state.currentFh) {
+        state.addResult(op, nfsstat4::NFS4ERR_NOFILEHANDLE);
+      } else {
+        state.savedFh = state.currentFh;
+        state.addResult(op, nfsstat4::NFS4_OK);
+      }
+      return folly::unit;
+    case nfs_opnum4::OP_RESTOREFH:
+      if (!state.savedFh) {
+        state.addResult(op, nfsstat4::NFS4ERR_RESTOREFH);
+      } else {
+        state.currentFh = state.savedFh;
+        state.addResult(op, nfsstat4::NFS4_OK);
+      }
+      return folly::unit;
+    case nfs_opnum4::OP_LOOKUP:
+      return lookup(state, context);
+    case nfs_opnum4::OP_LOOKUPP:
+      return lookupp(state, context);
+    case nfs_opnum4::OP_ACCESS:
+      return access(state, context);
+    case nfs_opnum4::OP_GETATTR:
+      return getattr(state, context);
+    case nfs_opnum4::OP_READ:
+      return read(state, context);
+    case nfs_opnum4::OP_READLINK:
+      return readlink(state, context);
+    default:
+      break;
+  }
+
+  state.addResult(op, nfsstat4::NFS4ERR_NOTSUPP);
+  return folly::unit;
+}
+
+void Nfsd4ServerProcessor::exchangeId(CompoundState& state) {
+  auto args = XdrTrait<EXCHANGE_ID4argsHeader>::deserialize(state.deser);
+  if (args.spa_how != state_protect_how4::SP4_NONE) {
+    // Clients retry with SP4_NONE when the state protection isn't supported.
+    state.addResult(nfs_opnum4::OP_EXCHANGE_ID, nfsstat4::NFS4ERR_NOTSUPP);
+    return;
+  }
+  // The eia_client_impl_id is only informative.
+  XdrTrait<std::vector<nfs_impl_id4>>::deserialize(state.deser);
+
+  const auto& owner = args.eia_clientowner;
+  std::string ownerId(owner.co_ownerid.begin(), owner.co_ownerid.end());
+
+  auto sessionState = sessionState_.wlock();
+  Client* client = nullptr;
+  uint64_t clientId = 0;
+  auto ownerIt = sessionState->clientsByOwner.find(ownerId);
+  if (ownerIt != sessionState->clientsByOwner.end()) {
+    auto& existing = sessionState->clients.at(ownerIt->second);
+    if (existing.verifier == owner.co_verifier) {
+      clientId = ownerIt->second;
+      client = &existing;
+    }
+  }
+
+  if (!client) {
+    if (args.eia_flags & EXCHGID4_FLAG_UPD_CONFIRMED_REC_A) {
+      state.addResult(nfs_opnum4::OP_EXCHANGE_ID, nfsstat4::NFS4ERR_NOENT);
+      return;
+    }
+    if (ownerIt != sessionState->clientsByOwner.end()) {
+      // A new verifier means the client rebooted, its previous state is gone.
+      sessionState->removeClient(ownerIt->second);
+    }
+    clientId = sessionState->nextClientId++;
+    client = &sessionState->clients
+                  .emplace(clientId, Client{owner.co_verifier, ownerId})
+                  .first->second;
+    sessionState->clientsByOwner.emplace(std::move(ownerId), clientId);
+  }
+
+  auto flags = EXCHGID4_FLAG_USE_NON_PNFS;
+  if (client->confirmed) {
+    flags |= EXCHGID4_FLAG_CONFIRMED_R;
+  }
+  std::vector<uint8_t> serverOwner(kServerOwner.begin(), kServerOwner.end());
+
+  state.addResult(nfs_opnum4::OP_EXCHANGE_ID, nfsstat4::NFS4_OK);
+  XdrTrait<EXCHANGE_ID4resok>::serialize(
+      state.ser,
+      EXCHANGE_ID4resok{
+          clientId,
+          client->createSessionSequence,
+          flags,
+          state_protect_how4::SP4_NONE,
+          server_owner4{0, serverOwner},
+          /*eir_server_scope*/ serverOwner,
+          /*eir_server_impl_id*/ {},
+      });
+}
+
+void Nfsd4ServerProcessor::createSession(CompoundState& state) {
+  auto args = XdrTrait<CREATE_SESSION4argsHeader>::deserialize(state.deser);
+  if (!skipCallbackSecParms(state.deser)) {
+    state.addResult(nfs_opnum4::OP_CREATE_SESSION, nfsstat4::NFS4ERR_BADXDR);
+    return;
+  }
+
+  auto sessionState = sessionState_.wlock();
+  auto clientIt = sessionState->clients.find(args.csa_clientid);
+  if (clientIt == sessionState->clients.end()) {
+    state.addResult(
+        nfs_opnum4::OP_CREATE_SESSION, nfsstat4::NFS4ERR_STALE_CLIENTID);
+    return;
+  }
+  auto& client = clientIt->second;
+
+  if (client.lastCreateSession &&
+      args.csa_sequence + 1 == client.createSessionSequence) {
+    // A retransmission of the previous CREATE_SESSION.
+    state.addResult(nfs_opnum4::OP_CREATE_SESSION, nfsstat4::NFS4_OK);
+    XdrTrait<CREATE_SESSION4resok>::serialize(
+        state.ser, *client.lastCreateSession);
+    return;
+  }
+  if (args.csa_sequence != client.createSessionSequence) {
+    state.addResult(
+        nfs_opnum4::OP_CREATE_SESSION, nfsstat4::NFS4ERR_SEQ_MISORDERED);
+    return;
+  }
+
+  auto fore = negotiateForeChannel(args.csa_fore_chan_attrs, iosize_);
+  // No callbacks are sent, the back channel attributes are only echoed.
+  auto back = std::move(args.csa_back_chan_attrs);
+  back.ca_rdma_ird.clear();
+
+  auto sessionId =
+      makeSessionId(args.csa_clientid, sessionState->nextSessionId++);
+  sessionState->sessions.emplace(
+      sessionId,
+      Session{
+          args.csa_clientid,
+          fore.ca_maxoperations,
+          std::vector<uint32_t>(fore.ca_maxrequests, 0)});
+
+  client.confirmed = true;
+  client.createSessionSequence++;
+  // The flags are cleared: the session isn't persistent, and the connection
+  // isn't used as a back channel.
+  client.lastCreateSession = CREATE_SESSION4resok{
+      sessionId, args.csa_sequence, 0, std::move(fore), std::move(back)};
+
+  state.addResult(nfs_opnum4::OP_CREATE_SESSION, nfsstat4::NFS4_OK);
+  XdrTrait<CREATE_SESSION4resok>::serialize(
+      state.ser, *client.lastCreateSession);
+}
+
+void Nfsd4ServerProcessor::destroySession(CompoundState& state) {
+  auto args = XdrTrait<DESTROY_SESSION4args>::deserialize(state.deser);
+  auto erased = sessionState_.wlock()->sessions.erase(args.dsa_sessionid);
+  state.addResult(
+      nfs_opnum4::OP_DESTROY_SESSION,
+      erased ? nfsstat4::NFS4_OK : nfsstat4::NFS4ERR_BADSESSION);
+}
+
+void Nfsd4ServerProcessor::destroyClientId(CompoundState& state) {
+  auto args = XdrTrait<DESTROY_CLIENTID4args>::deserialize(state.deser);
+  auto sessionState = sessionState_.wlock();
+  if (!sessionState->clients.count(args.dca_clientid)) {
+    state.addResult(
+        nfs_opnum4::OP_DESTROY_CLIENTID, nfsstat4::NFS4ERR_STALE_CLIENTID);
+    return;
+  }
+  for (const auto& [sessionId, session] : sessionState->sessions) {
+    if (session.clientId == args.dca_clientid) {
+      state.addResult(
+          nfs_opnum4::OP_DESTROY_CLIENTID, nfsstat4::NFS4ERR_CLIENTID_BUSY);
+      return;
+    }
+  }
+  sessionState->removeClient(args.dca_clientid);
+  state.addResult(nfs_opnum4::OP_DESTROY_CLIENTID, nfsstat4::NFS4_OK);
+}
+
+void Nfsd4ServerProcessor::sequence(CompoundState& state) {
+  auto args = XdrTrait<SEQUENCE4args>::deserialize(state.deser);
+
+  uint32_t highestSlot = 0;
+  auto status = [&]() {
+    auto sessionState = sessionState_.wlock();
+    auto it = sessionState->sessions.find(args.sa_sessionid);
+    if (it == sessionState->sessions.end()) {
+      return nfsstat4::NFS4ERR_BADSESSION;
+    }
+    auto& session = it->second;
+    if (args.sa_slotid >= session.slots.size()) {
+      return nfsstat4::NFS4ERR_BADSLOT;
+    }
+    auto& slot = session.slots[args.sa_slotid];
+    if (args.sa_sequenceid == slot) {
+      // The replies aren't cached, a retransmission can't be answered.
+      return nfsstat4::NFS4ERR_RETRY_UNCACHED_REP;
+    }
+    if (args.sa_sequenceid != slot + 1) {
+      return nfsstat4::NFS4ERR_SEQ_MISORDERED;
+    }
+    if (state.numOps > session.maxOperations) {
+      return nfsstat4::NFS4ERR_TOO_MANY_OPS;
+    }
+    slot = args.sa_sequenceid;
+    highestSlot = folly::to_narrow(session.slots.size() - 1);
+    return nfsstat4::NFS4_OK;
+  }();
+
+  state.addResult(nfs_opnum4::OP_SEQUENCE, status);
+  if (status != nfsstat4::NFS4_OK) {
+    return;
+  }
+  state.inSession = true;
+  XdrTrait<SEQUENCE4resok>::serialize(
+      state.ser,
+      SEQUENCE4resok{
+          args.sa_sessionid,
+          args.sa_sequenceid,
+          args.sa_slotid,
+          highestSlot,
+          highestSlot,
+          /*sr_status_flags*/ 0,
+      });
+}
+
+ImmediateFuture<folly::Unit> Nfsd4ServerProcessor::lookup(
+    CompoundState& state,
+    NfsRequestContext& context) {
+  auto args = XdrTrait<LOOKUP4args>::deserialize(state.deser);
+  if (!state.currentFh) {
+    state.addResult(nfs_opnum4::OP_LOOKUP, nfsstat4::NFS4ERR_NOFILEHANDLE);
+    return folly::unit;
+  }
+  if (args.objname.length() > NAME_MAX) {
+    state.addResult(nfs_opnum4::OP_LOOKUP, nfsstat4::NFS4ERR_NAMETOOLONG);
+    return folly::unit;
+  }
+  if (args.objname.empty() || args.objname == "." || args.objname == "..") {
+    // NFSv4 has a dedicated LOOKUPP operation for the parent directory.
+    state.addResult(nfs_opnum4::OP_LOOKUP, nfsstat4::NFS4ERR_INVAL);
+    return folly::unit;
+  }
+
+  return extractPathComponent4(std::move(args.objname))
+      .thenValue(
+          [this, ino = *state.currentFh, &context](PathComponent&& name) {
+            return dispatcher_.lookup(ino, std::move(name), context);
+          })
+      .thenTry([&state](folly::Try<NfsDispatcher::LookupRes> try_) {
+        if (try_.hasException()) {
+          state.addResult(
+              nfs_opnum4::OP_LOOKUP, exceptionToNfs4Error(try_.exception()));
+        } else if (!try_.value()) {
+          state.addResult(nfs_opnum4::OP_LOOKUP, nfsstat4::NFS4ERR_NOENT);
+        } else {
+          state.currentFh = std::get<InodeNumber>(*try_.value());
+          state.addResult(nfs_opnum4::OP_LOOKUP, nfsstat4::NFS4_OK);
+        }
+        return folly::unit;
+      });
+}
+
+ImmediateFuture<folly::Unit> Nfsd4ServerProcessor::lookupp(
+    CompoundState& state,
+    NfsRequestContext& context) {
+  if (!state.currentFh) {
+    state.addResult(nfs_opnum4::OP_LOOKUPP, nfsstat4::NFS4ERR_NOFILEHANDLE);
+    return folly::unit;
+  }
+
+  return dispatcher_.getParent(*state.currentFh, context)
+      .thenTry([&state](folly::Try<InodeNumber> try_) {
+        if (try_.hasException()) {
+          state.addResult(
+              nfs_opnum4::OP_LOOKUPP, exceptionToNfs4Error(try_.exception()));
+        } else {
+          state.currentFh = try_.value();
+          state.addResult(nfs_opnum4::OP_LOOKUPP, nfsstat4::NFS4_OK);
+        }
+        return folly::unit;
+      });
+}
+
+ImmediateFuture<folly::Unit> Nfsd4ServerProcessor::access(
+    CompoundState& state,
+    NfsRequestContext& context) {
+  auto args = XdrTrait<ACCESS4args>::deserialize(state.deser);
+  if (!state.currentFh) {
+    state.addResult(nfs_opnum4::OP_ACCESS, nfsstat4::NFS4ERR_NOFILEHANDLE);
+    return folly::unit;
+  }
+
+  constexpr uint32_t kAllAccess = ACCESS4_READ | ACCESS4_LOOKUP |
+      ACCESS4_MODIFY | ACCESS4_EXTEND | ACCESS4_DELETE | ACCESS4_EXECUTE;
+  return dispatcher_.getattr(*state.currentFh, context)
+      .thenTry([&state, supported = args.access & kAllAccess](
+                   const folly::Try<struct stat>& try_) {
+        if (try_.hasException()) {
+          state.addResult(
+              nfs_opnum4::OP_ACCESS, exceptionToNfs4Error(try_.exception()));
+        } else {
+          state.addResult(nfs_opnum4::OP_ACCESS, nfsstat4::NFS4_OK);
+          XdrTrait<ACCESS4resok>::serialize(
+              state.ser,
+              ACCESS4resok{
+                  supported,
+                  getEffectiveAccess4(try_.value().st_mode, supported)});
+        }
+        return folly::unit;
+      });
+}
+
+ImmediateFuture<folly::Unit> Nfsd4ServerProcessor::getattr(
+    CompoundState& state,
+    NfsRequestContext& context) {
+  auto args = XdrTrait<GETATTR4args>::deserialize(state.deser);
+  if (!state.currentFh) {
+    state.addResult(nfs_opnum4::OP_GETATTR, nfsstat4::NFS4ERR_NOFILEHANDLE);
+    return folly::unit;
+  }
+
+  auto ino = *state.currentFh;
+  return dispatcher_.getattr(ino, context)
+      .thenTry([&state, ino, request = std::move(args.attr_request)](
+                   const folly::Try<struct stat>& try_) {
+        if (try_.hasException()) {
+          state.addResult(
+              nfs_opnum4::OP_GETATTR, exceptionToNfs4Error(try_.exception()));
+        } else {
+          state.addResult(nfs_opnum4::OP_GETATTR, nfsstat4::NFS4_OK);
+          XdrTrait<GETATTR4resok>::serialize(
+              state.ser,
+              GETATTR4resok{statToFattr4(request, try_.value(), ino)});
+        }
+        return folly::unit;
+      });
+}
+
+ImmediateFuture<folly::Unit> Nfsd4ServerProcessor::read(
+    CompoundState& state,
+    NfsRequestContext& context) {
+  auto args = XdrTrait<READ4args>::deserialize(state.deser);
+  if (!state.currentFh) {
+    state.addResult(nfs_opnum4::OP_READ, nfsstat4::NFS4ERR_NOFILEHANDLE);
+    return folly::unit;
+  }
+
+  // The stateid is ignored: without OPEN support, the client can only use
+  // the anonymous stateid. The count is bounded by the maximum reply size
+  // negotiated when the session was created.
+  return dispatcher_
+      .read(
+          *state.currentFh,
+          std::min(args.count, iosize_),
+          folly::to_signed(args.offset),
+          context)
+      .thenTry([&state](folly::Try<NfsDispatcher::ReadRes> try_) {
+        if (try_.hasException()) {
+          state.addResult(
+              nfs_opnum4::OP_READ, exceptionToNfs4Error(try_.exception()));
+        } else {
+          auto& res = try_.value();
+          state.addResult(nfs_opnum4::OP_READ, nfsstat4::NFS4_OK);
+          XdrTrait<bool>::serialize(state.ser, res.isEof);
+          // Move the data in the reply instead of copying it.
+          XdrTrait<std::unique_ptr<folly::IOBuf>>::serialize(
+              state.ser, std::move(res.data));
+        }
+        return folly::unit;
+      });
+}
+
+ImmediateFuture<folly::Unit> Nfsd4ServerProcessor::readlink(
+    CompoundState& state,
+    NfsRequestContext& context) {
+  if (!state.currentFh) {
+    state.addResult(nfs_opnum4::OP_READLINK, nfsstat4::NFS4ERR_NOFILEHANDLE);
+    return folly::unit;
+  }
+
+  return dispatcher_.readlink(*state.currentFh, context)
+      .thenTry([&state](folly::Try<std::string> try_) {
+        if (try_.hasException()) {
+          state.addResult(
+              nfs_opnum4::OP_READLINK, exceptionToNfs4Error(try_.exception()));
+        } else {
+          state.addResult(nfs_opnum4::OP_READLINK, nfsstat4::NFS4_OK);
+          XdrTrait<READLINK4resok>::serialize(
+              state.ser, READLINK4resok{std::move(try_.value())});
+        }
+        return folly::unit;
+      });
+}
+
+} // namespace facebook::eden
+
+#endif
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#ifndef _WIN32
+
+// Implementation of the NFSv4.1 COMPOUND procedure as described in:
+// https://tools.ietf.org/html/rfc5661
+
+#include <folly/Synchronized.h>
+#include <map>
+#include <unordered_map>
+#include "eden/fs/nfs/NfsDispatcher.h"
+#include "eden/fs/nfs/Nfsd4Rpc.h"
+#include "eden/fs/nfs/rpc/Server.h"
+#include "eden/fs/utils/ProcessAccessLog.h"
+
+namespace folly {
+class Logger;
+}
+
+namespace facebook::eden {
+
+class NfsRequestContext;
+struct CompoundState;
+
+/**
+ * Serve the NULL and COMPOUND procedures of NFSv4.1.
+ *
+ * A COMPOUND bundles several operations in a single RPC, a client can thus
+ * resolve a path, fetch its attributes and read its content in a single round
+ * trip where NFSv3 would need one RPC per step. The operations are executed
+ * in order against the same NfsDispatcher as Nfsd3 and processing stops at
+ * the first failing operation.
+ *
+ * Every COMPOUND must start with a SEQUENCE that names a session created by
+ * EXCHANGE_ID and CREATE_SESSION, which are tracked in memory. The replies
+ * aren't cached: a retransmitted request fails with
+ * NFS4ERR_RETRY_UNCACHED_REP, as the RFC allows.
+ *
+ * Past the session operations, only the stateless, read-only operations are
+ * supported for now: PUTROOTFH, PUTFH, GETFH, SAVEFH, RESTOREFH, LOOKUP,
+ * LOOKUPP, ACCESS, GETATTR, READ with the anonymous stateid and READLINK.
+ * Every other operation fails with NFS4ERR_NOTSUPP, which notably includes
+ * OPEN and READDIR.
+ *
+ * Nfsd3 serves this processor on its socket for the version 4 calls.
+ */
+class Nfsd4ServerProcessor final : public RpcServerProcessor {
+ public:
+  /**
+   * The dispatcher and processAccessLog must outlive this processor. READs
+   * are bounded to iosize bytes.
+   */
+  Nfsd4ServerProcessor(
+      NfsDispatcher& dispatcher,
+      const folly::Logger* straceLogger,
+      uint32_t iosize,
+      ProcessAccessLog& processAccessLog);
+
+  Nfsd4ServerProcessor(const Nfsd4ServerProcessor&) = delete;
+  Nfsd4ServerProcessor(Nfsd4ServerProcessor&&) = delete;
+  Nfsd4ServerProcessor& operator=(const Nfsd4ServerProcessor&) = delete;
+  Nfsd4ServerProcessor& operator=(Nfsd4ServerProcessor&&) = delete;
+
+  ImmediateFuture<folly::Unit> dispatchRpc(
+      folly::io::Cursor deser,
+      folly::io::QueueAppender ser,
+      uint32_t xid,
+      uint32_t progNumber,
+      uint32_t progVersion,
+      uint32_t procNumber) override;
+
+ private:
+  /**
+   * A client, as identified by the co_ownerid it passed to EXCHANGE_ID.
+   */
+  struct Client {
+    verifier4 verifier;
+    std::string ownerId;
+    bool confirmed{false};
+    // The csa_sequence expected by the next CREATE_SESSION.
+    uint32_t createSessionSequence{1};
+    // The reply to the last CREATE_SESSION, for when it is retransmitted.
+    std::optional<CREATE_SESSION4resok> lastCreateSession;
+  };
+
+  struct Session {
+    uint64_t clientId;
+    uint32_t maxOperations;
+    // The sequenceid of the last request received on each slot.
+    std::vector<uint32_t> slots;
+  };
+
+  struct SessionState {
+    uint64_t nextClientId{0};
+    uint64_t nextSessionId{1};
+    std::unordered_map<uint64_t, Client> clients;
+    std::unordered_map<std::string, uint64_t> clientsByOwner;
+    std::map<sessionid4, Session> sessions;
+
+    /**
+     * Forget the client and all of its sessions.
+     */
+    void removeClient(uint64_t clientId);
+  };
+
+  ImmediateFuture<folly::Unit> compound(
+      folly::io::Cursor deser,
+      folly::io::QueueAppender ser,
+      NfsRequestContext& context);
+
+  /**
+   * Execute the remaining operations of the COMPOUND, in order.
+   */
+  ImmediateFuture<folly::Unit> processOps(
+      CompoundState& state,
+      NfsRequestContext& context);
+
+  /**
+   * Decode and execute the next operation of the COMPOUND, its result is
+   * appended to the state.
+   */
+  ImmediateFuture<folly::Unit> processOp(
+      CompoundState& state,
+      NfsRequestContext& context);
+
+  void exchangeId(CompoundState& state);
+  void createSession(CompoundState& state);
+  void destroySession(CompoundState& state);
+  void destroyClientId(CompoundState& state);
+  void sequence(CompoundState& state);
+
+  ImmediateFuture<folly::Unit> lookup(
+      CompoundState& state,
+      NfsRequestContext& context);
+  ImmediateFuture<folly::Unit> lookupp(
+      CompoundState& state,
+      NfsRequestContext& context);
+  ImmediateFuture<folly::Unit> access(
+      CompoundState& state,
+      NfsRequestContext& context);
+  ImmediateFuture<folly::Unit> getattr(
+      CompoundState& state,
+      NfsRequestContext& context);
+  ImmediateFuture<folly::Unit> read(
+      CompoundState& state,
+      NfsRequestContext& context);
+  ImmediateFuture<folly::Unit> readlink(
+      CompoundState& state,
+      NfsRequestContext& context);
+
+  NfsDispatcher& dispatcher_;
+  const folly::Logger* straceLogger_;
+  uint32_t iosize_;
+  ProcessAccessLog& processAccessLog_;
+  folly::Synchronized<SessionState> sessionState_;
+};
+
+/**
+ * Return which of the requested ACCESS4 bits the mode of a file grants.
+ *
+ * All the files of a mount are owned by the user running EdenFS, and the RPC
+ * credentials aren't passed down to the processors, so the owner permission
+ * bits are the ones checked.
+ */
+uint32_t getEffectiveAccess4(mode_t mode, uint32_t requested);
+
+} // namespace facebook::eden
+
+#endif
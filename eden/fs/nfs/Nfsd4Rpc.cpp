@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#ifndef _WIN32
+
+#include "eden/fs/nfs/Nfsd4Rpc.h"
+
+namespace facebook::eden {
+EDEN_XDR_SERDE_IMPL(nfstime4, seconds, nseconds);
+EDEN_XDR_SERDE_IMPL(fsid4, major, minor);
+EDEN_XDR_SERDE_IMPL(specdata4, specdata1, specdata2);
+EDEN_XDR_SERDE_IMPL(stateid4, seqid, other);
+EDEN_XDR_SERDE_IMPL(client_owner4, co_verifier, co_ownerid);
+EDEN_XDR_SERDE_IMPL(server_owner4, so_minor_id, so_major_id);
+EDEN_XDR_SERDE_IMPL(nfs_impl_id4, nii_domain, nii_name, nii_date);
+EDEN_XDR_SERDE_IMPL(
+    channel_attrs4,
+    ca_headerpadsize,
+    ca_maxrequestsize,
+    ca_maxresponsesize,
+    ca_maxresponsesize_cached,
+    ca_maxoperations,
+    ca_maxrequests,
+    ca_rdma_ird);
+EDEN_XDR_SERDE_IMPL(fattr4, attrmask, attr_vals);
+EDEN_XDR_SERDE_IMPL(COMPOUND4argsHeader, tag, minorversion, numops);
+EDEN_XDR_SERDE_IMPL(ACCESS4args, access);
+EDEN_XDR_SERDE_IMPL(ACCESS4resok, supported, access);
+EDEN_XDR_SERDE_IMPL(GETATTR4args, attr_request);
+EDEN_XDR_SERDE_IMPL(GETATTR4resok, obj_attributes);
+EDEN_XDR_SERDE_IMPL(GETFH4resok, object);
+EDEN_XDR_SERDE_IMPL(LOOKUP4args, objname);
+EDEN_XDR_SERDE_IMPL(PUTFH4args, object);
+EDEN_XDR_SERDE_IMPL(READ4args, stateid, offset, count);
+EDEN_XDR_SERDE_IMPL(READLINK4resok, link);
+EDEN_XDR_SERDE_IMPL(
+    EXCHANGE_ID4argsHeader,
+    eia_clientowner,
+    eia_flags,
+    spa_how);
+EDEN_XDR_SERDE_IMPL(
+    EXCHANGE_ID4resok,
+    eir_clientid,
+    eir_sequenceid,
+    eir_flags,
+    spr_how,
+    eir_server_owner,
+    eir_server_scope,
+    eir_server_impl_id);
+EDEN_XDR_SERDE_IMPL(
+    CREATE_SESSION4argsHeader,
+    csa_clientid,
+    csa_sequence,
+    csa_flags,
+    csa_fore_chan_attrs,
+    csa_back_chan_attrs,
+    csa_cb_program);
+EDEN_XDR_SERDE_IMPL(
+    CREATE_SESSION4resok,
+    csr_sessionid,
+    csr_sequence,
+    csr_flags,
+    csr_fore_chan_attrs,
+    csr_back_chan_attrs);
+EDEN_XDR_SERDE_IMPL(DESTROY_SESSION4args, dsa_sessionid);
+EDEN_XDR_SERDE_IMPL(DESTROY_CLIENTID4args, dca_clientid);
+EDEN_XDR_SERDE_IMPL(
+    SEQUENCE4args,
+    sa_sessionid,
+    sa_sequenceid,
+    sa_slotid,
+    sa_highest_slotid,
+    sa_cachethis);
+EDEN_XDR_SERDE_IMPL(
+    SEQUENCE4resok,
+    sr_sessionid,
+    sr_sequenceid,
+    sr_slotid,
+    sr_highest_slotid,
+    sr_target_highest_slotid,
+    sr_status_flags);
+EDEN_XDR_SERDE_IMPL(RECLAIM_COMPLETE4args, rca_one_fs);
+} // namespace facebook::eden
+
+#endif
@@ -0,0 +1,461 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#ifndef _WIN32
+
+#include <folly/Utility.h>
+#include "eden/fs/nfs/NfsdRpc.h"
+
+/*
+ * Nfsd protocol, version 4, described in RFC5661:
+ * https://tools.ietf.org/html/rfc5661
+ *
+ * Only the subset of the protocol served by Nfsd4 is described here.
+ */
+
+namespace facebook::eden {
+
+constexpr uint32_t kNfsd4ProgVersion = 4;
+
+/**
+ * Only NFSv4.1 is served: 4.0 needs the SETCLIENTID and OPEN_CONFIRM state
+ * machine, which 4.1 replaced with sessions.
+ */
+constexpr uint32_t kNfsd4MinorVersion = 1;
+
+/**
+ * Procedure values. NFSv4 only has 2 procedures, all the operations are sent
+ * in a COMPOUND.
+ */
+enum class nfsv4Procs : uint32_t {
+  null = 0,
+  compound = 1,
+};
+
+enum class nfs_opnum4 : uint32_t {
+  OP_ACCESS = 3,
+  OP_CLOSE = 4,
+  OP_COMMIT = 5,
+  OP_CREATE = 6,
+  OP_DELEGPURGE = 7,
+  OP_DELEGRETURN = 8,
+  OP_GETATTR = 9,
+  OP_GETFH = 10,
+  OP_LINK = 11,
+  OP_LOCK = 12,
+  OP_LOCKT = 13,
+  OP_LOCKU = 14,
+  OP_LOOKUP = 15,
+  OP_LOOKUPP = 16,
+  OP_NVERIFY = 17,
+  OP_OPEN = 18,
+  OP_OPENATTR = 19,
+  OP_OPEN_CONFIRM = 20,
+  OP_OPEN_DOWNGRADE = 21,
+  OP_PUTFH = 22,
+  OP_PUTPUBFH = 23,
+  OP_PUTROOTFH = 24,
+  OP_READ = 25,
+  OP_READDIR = 26,
+  OP_READLINK = 27,
+  OP_REMOVE = 28,
+  OP_RENAME = 29,
+  OP_RENEW = 30,
+  OP_RESTOREFH = 31,
+  OP_SAVEFH = 32,
+  OP_SECINFO = 33,
+  OP_SETATTR = 34,
+  OP_SETCLIENTID = 35,
+  OP_SETCLIENTID_CONFIRM = 36,
+  OP_VERIFY = 37,
+  OP_WRITE = 38,
+  OP_RELEASE_LOCKOWNER = 39,
+  OP_EXCHANGE_ID = 42,
+  OP_CREATE_SESSION = 43,
+  OP_DESTROY_SESSION = 44,
+  OP_SEQUENCE = 53,
+  OP_DESTROY_CLIENTID = 57,
+  OP_RECLAIM_COMPLETE = 58,
+  OP_ILLEGAL = 10044,
+};
+
+enum class nfsstat4 : uint32_t {
+  NFS4_OK = 0,
+  NFS4ERR_PERM = 1,
+  NFS4ERR_NOENT = 2,
+  NFS4ERR_IO = 5,
+  NFS4ERR_NXIO = 6,
+  NFS4ERR_ACCESS = 13,
+  NFS4ERR_EXIST = 17,
+  NFS4ERR_XDEV = 18,
+  NFS4ERR_NOTDIR = 20,
+  NFS4ERR_ISDIR = 21,
+  NFS4ERR_INVAL = 22,
+  NFS4ERR_FBIG = 27,
+  NFS4ERR_NOSPC = 28,
+  NFS4ERR_ROFS = 30,
+  NFS4ERR_MLINK = 31,
+  NFS4ERR_NAMETOOLONG = 63,
+  NFS4ERR_NOTEMPTY = 66,
+  NFS4ERR_DQUOT = 69,
+  NFS4ERR_STALE = 70,
+  NFS4ERR_BADHANDLE = 10001,
+  NFS4ERR_NOTSUPP = 10004,
+  NFS4ERR_SERVERFAULT = 10006,
+  NFS4ERR_DELAY = 10008,
+  NFS4ERR_RESOURCE = 10018,
+  NFS4ERR_NOFILEHANDLE = 10020,
+  NFS4ERR_MINOR_VERS_MISMATCH = 10021,
+  NFS4ERR_STALE_CLIENTID = 10022,
+  NFS4ERR_RESTOREFH = 10030,
+  NFS4ERR_SYMLINK = 10029,
+  NFS4ERR_BADXDR = 10036,
+  NFS4ERR_OP_ILLEGAL = 10044,
+  NFS4ERR_BADSESSION = 10052,
+  NFS4ERR_BADSLOT = 10053,
+  NFS4ERR_SEQ_MISORDERED = 10063,
+  NFS4ERR_SEQUENCE_POS = 10064,
+  NFS4ERR_RETRY_UNCACHED_REP = 10068,
+  NFS4ERR_TOO_MANY_OPS = 10070,
+  NFS4ERR_OP_NOT_IN_SESSION = 10071,
+  NFS4ERR_CLIENTID_BUSY = 10074,
+  NFS4ERR_NOT_ONLY_OP = 10081,
+};
+
+// Bits of the ACCESS4args and ACCESS4resok masks.
+constexpr uint32_t ACCESS4_READ = 0x00000001;
+constexpr uint32_t ACCESS4_LOOKUP = 0x00000002;
+constexpr uint32_t ACCESS4_MODIFY = 0x00000004;
+constexpr uint32_t ACCESS4_EXTEND = 0x00000008;
+constexpr uint32_t ACCESS4_DELETE = 0x00000010;
+constexpr uint32_t ACCESS4_EXECUTE = 0x00000020;
+
+// Flags of EXCHANGE_ID4args and EXCHANGE_ID4resok.
+constexpr uint32_t EXCHGID4_FLAG_USE_NON_PNFS = 0x00010000;
+constexpr uint32_t EXCHGID4_FLAG_UPD_CONFIRMED_REC_A = 0x40000000;
+constexpr uint32_t EXCHGID4_FLAG_CONFIRMED_R = 0x80000000;
+
+/**
+ * Bit numbers of the file attributes, a client requests attributes by setting
+ * the corresponding bits in a bitmap4.
+ */
+enum class fattr4_attr : uint32_t {
+  supported_attrs = 0,
+  type = 1,
+  fh_expire_type = 2,
+  change = 3,
+  size = 4,
+  link_support = 5,
+  symlink_support = 6,
+  named_attr = 7,
+  fsid = 8,
+  unique_handles = 9,
+  lease_time = 10,
+  rdattr_error = 11,
+  filehandle = 19,
+  fileid = 20,
+  mode = 33,
+  numlinks = 35,
+  owner = 36,
+  owner_group = 37,
+  rawdev = 41,
+  space_used = 45,
+  time_access = 47,
+  time_metadata = 52,
+  time_modify = 53,
+};
+
+/**
+ * The NFSv4 file handles are opaque to the client, re-use the NFSv3 ones so
+ * both protocols can refer to the same inodes.
+ */
+using nfs_fh4 = nfs_fh3;
+
+using bitmap4 = std::vector<uint32_t>;
+
+/**
+ * Test if the attribute is set in the bitmap.
+ */
+inline bool bitmap4Contains(const bitmap4& bitmap, fattr4_attr attr) {
+  auto bit = folly::to_underlying(attr);
+  auto word = bit / 32;
+  return word < bitmap.size() && (bitmap[word] & (1u << (bit % 32))) != 0;
+}
+
+/**
+ * Set the attribute in the bitmap, growing it as needed.
+ */
+inline void bitmap4Set(bitmap4& bitmap, fattr4_attr attr) {
+  auto bit = folly::to_underlying(attr);
+  auto word = bit / 32;
+  if (word >= bitmap.size()) {
+    bitmap.resize(word + 1);
+  }
+  bitmap[word] |= 1u << (bit % 32);
+}
+
+struct nfstime4 {
+  int64_t seconds;
+  uint32_t nseconds;
+};
+EDEN_XDR_SERDE_DECL(nfstime4, seconds, nseconds);
+
+struct fsid4 {
+  uint64_t major;
+  uint64_t minor;
+};
+EDEN_XDR_SERDE_DECL(fsid4, major, minor);
+
+struct specdata4 {
+  uint32_t specdata1;
+  uint32_t specdata2;
+};
+EDEN_XDR_SERDE_DECL(specdata4, specdata1, specdata2);
+
+struct stateid4 {
+  uint32_t seqid;
+  std::array<uint8_t, 12> other;
+};
+EDEN_XDR_SERDE_DECL(stateid4, seqid, other);
+
+using verifier4 = std::array<uint8_t, 8>;
+using sessionid4 = std::array<uint8_t, 16>;
+
+struct client_owner4 {
+  verifier4 co_verifier;
+  std::vector<uint8_t> co_ownerid;
+};
+EDEN_XDR_SERDE_DECL(client_owner4, co_verifier, co_ownerid);
+
+struct server_owner4 {
+  uint64_t so_minor_id;
+  std::vector<uint8_t> so_major_id;
+};
+EDEN_XDR_SERDE_DECL(server_owner4, so_minor_id, so_major_id);
+
+struct nfs_impl_id4 {
+  std::string nii_domain;
+  std::string nii_name;
+  nfstime4 nii_date;
+};
+EDEN_XDR_SERDE_DECL(nfs_impl_id4, nii_domain, nii_name, nii_date);
+
+enum class state_protect_how4 : uint32_t {
+  SP4_NONE = 0,
+  SP4_MACH_CRED = 1,
+  SP4_SSV = 2,
+};
+
+struct channel_attrs4 {
+  uint32_t ca_headerpadsize;
+  uint32_t ca_maxrequestsize;
+  uint32_t ca_maxresponsesize;
+  uint32_t ca_maxresponsesize_cached;
+  uint32_t ca_maxoperations;
+  uint32_t ca_maxrequests;
+  std::vector<uint32_t> ca_rdma_ird;
+};
+EDEN_XDR_SERDE_DECL(
+    channel_attrs4,
+    ca_headerpadsize,
+    ca_maxrequestsize,
+    ca_maxresponsesize,
+    ca_maxresponsesize_cached,
+    ca_maxoperations,
+    ca_maxrequests,
+    ca_rdma_ird);
+
+/**
+ * The attribute values are encoded in increasing bit order of the attrmask
+ * into attr_vals.
+ */
+struct fattr4 {
+  bitmap4 attrmask;
+  std::vector<uint8_t> attr_vals;
+};
+EDEN_XDR_SERDE_DECL(fattr4, attrmask, attr_vals);
+
+struct COMPOUND4argsHeader {
+  std::string tag;
+  uint32_t minorversion;
+  uint32_t numops;
+};
+EDEN_XDR_SERDE_DECL(COMPOUND4argsHeader, tag, minorversion, numops);
+
+struct ACCESS4args {
+  uint32_t access;
+};
+EDEN_XDR_SERDE_DECL(ACCESS4args, access);
+
+struct ACCESS4resok {
+  uint32_t supported;
+  uint32_t access;
+};
+EDEN_XDR_SERDE_DECL(ACCESS4resok, supported, access);
+
+struct GETATTR4args {
+  bitmap4 attr_request;
+};
+EDEN_XDR_SERDE_DECL(GETATTR4args, attr_request);
+
+struct GETATTR4resok {
+  fattr4 obj_attributes;
+};
+EDEN_XDR_SERDE_DECL(GETATTR4resok, obj_attributes);
+
+struct GETFH4resok {
+  nfs_fh4 object;
+};
+EDEN_XDR_SERDE_DECL(GETFH4resok, object);
+
+struct LOOKUP4args {
+  std::string objname;
+};
+EDEN_XDR_SERDE_DECL(LOOKUP4args, objname);
+
+struct PUTFH4args {
+  nfs_fh4 object;
+};
+EDEN_XDR_SERDE_DECL(PUTFH4args, object);
+
+struct READ4args {
+  stateid4 stateid;
+  uint64_t offset;
+  uint32_t count;
+};
+EDEN_XDR_SERDE_DECL(READ4args, stateid, offset, count);
+
+struct READLINK4resok {
+  std::string link;
+};
+EDEN_XDR_SERDE_DECL(READLINK4resok, link);
+
+/**
+ * The EXCHANGE_ID4args up to its state_protect4_a union. Only SP4_NONE is
+ * supported, whose arm is empty, the eia_client_impl_id follows.
+ */
+struct EXCHANGE_ID4argsHeader {
+  client_owner4 eia_clientowner;
+  uint32_t eia_flags;
+  state_protect_how4 spa_how;
+};
+EDEN_XDR_SERDE_DECL(
+    EXCHANGE_ID4argsHeader,
+    eia_clientowner,
+    eia_flags,
+    spa_how);
+
+/**
+ * The state_protect4_r union is always SP4_NONE, which has no arm.
+ */
+struct EXCHANGE_ID4resok {
+  uint64_t eir_clientid;
+  uint32_t eir_sequenceid;
+  uint32_t eir_flags;
+  state_protect_how4 spr_how;
+  server_owner4 eir_server_owner;
+  std::vector<uint8_t> eir_server_scope;
+  std::vector<nfs_impl_id4> eir_server_impl_id;
+};
+EDEN_XDR_SERDE_DECL(
+    EXCHANGE_ID4resok,
+    eir_clientid,
+    eir_sequenceid,
+    eir_flags,
+    spr_how,
+    eir_server_owner,
+    eir_server_scope,
+    eir_server_impl_id);
+
+/**
+ * The CREATE_SESSION4args up to its csa_sec_parms, an array of unions that
+ * is decoded separately.
+ */
+struct CREATE_SESSION4argsHeader {
+  uint64_t csa_clientid;
+  uint32_t csa_sequence;
+  uint32_t csa_flags;
+  channel_attrs4 csa_fore_chan_attrs;
+  channel_attrs4 csa_back_chan_attrs;
+  uint32_t csa_cb_program;
+};
+EDEN_XDR_SERDE_DECL(
+    CREATE_SESSION4argsHeader,
+    csa_clientid,
+    csa_sequence,
+    csa_flags,
+    csa_fore_chan_attrs,
+    csa_back_chan_attrs,
+    csa_cb_program);
+
+struct CREATE_SESSION4resok {
+  sessionid4 csr_sessionid;
+  uint32_t csr_sequence;
+  uint32_t csr_flags;
+  channel_attrs4 csr_fore_chan_attrs;
+  channel_attrs4 csr_back_chan_attrs;
+};
+EDEN_XDR_SERDE_DECL(
+    CREATE_SESSION4resok,
+    csr_sessionid,
+    csr_sequence,
+    csr_flags,
+    csr_fore_chan_attrs,
+    csr_back_chan_attrs);
+
+struct DESTROY_SESSION4args {
+  sessionid4 dsa_sessionid;
+};
+EDEN_XDR_SERDE_DECL(DESTROY_SESSION4args, dsa_sessionid);
+
+struct DESTROY_CLIENTID4args {
+  uint64_t dca_clientid;
+};
+EDEN_XDR_SERDE_DECL(DESTROY_CLIENTID4args, dca_clientid);
+
+struct SEQUENCE4args {
+  sessionid4 sa_sessionid;
+  uint32_t sa_sequenceid;
+  uint32_t sa_slotid;
+  uint32_t sa_highest_slotid;
+  bool sa_cachethis;
+};
+EDEN_XDR_SERDE_DECL(
+    SEQUENCE4args,
+    sa_sessionid,
+    sa_sequenceid,
+    sa_slotid,
+    sa_highest_slotid,
+    sa_cachethis);
+
+struct SEQUENCE4resok {
+  sessionid4 sr_sessionid;
+  uint32_t sr_sequenceid;
+  uint32_t sr_slotid;
+  uint32_t sr_highest_slotid;
+  uint32_t sr_target_highest_slotid;
+  uint32_t sr_status_flags;
+};
+EDEN_XDR_SERDE_DECL(
+    SEQUENCE4resok,
+    sr_sessionid,
+    sr_sequenceid,
+    sr_slotid,
+    sr_highest_slotid,
+    sr_target_highest_slotid,
+    sr_status_flags);
+
+struct RECLAIM_COMPLETE4args {
+  bool rca_one_fs;
+};
+EDEN_XDR_SERDE_DECL(RECLAIM_COMPLETE4args, rca_one_fs);
+
+} // namespace facebook::eden
+
+#endif
@@ -168,6 +168,9 @@ struct nfs_fh3 {
 
 template <>
 struct XdrTrait<nfs_fh3> {
+  static constexpr size_t kFixedSize =
+      XdrTrait<uint32_t>::kFixedSize + XdrTrait<uint64_t>::kFixedSize;
+
   static void serialize(folly::io::QueueAppender& appender, const nfs_fh3& fh) {
     XdrTrait<uint32_t>::serialize(appender, sizeof(nfs_fh3));
     XdrTrait<uint64_t>::serialize(appender, fh.ino.get());
@@ -180,8 +183,7 @@ struct XdrTrait<nfs_fh3> {
   }
 
   static constexpr size_t serializedSize(const nfs_fh3&) {
-    return XdrTrait<uint32_t>::serializedSize(0) +
-        XdrTrait<uint64_t>::serializedSize(0);
+    return kFixedSize;
   }
 };
 
@@ -906,6 +908,29 @@ EDEN_XDR_SERDE_DECL(PATHCONF3resfail, obj_attributes);
 struct PATHCONF3res
     : public detail::Nfsstat3Variant<PATHCONF3resok, PATHCONF3resfail> {};
 
+// COMMIT Procedure:
+
+struct COMMIT3args {
+  nfs_fh3 file;
+  uint64_t offset;
+  uint32_t count;
+};
+EDEN_XDR_SERDE_DECL(COMMIT3args, file, offset, count);
+
+struct COMMIT3resok {
+  wcc_data file_wcc;
+  writeverf3 verf;
+};
+EDEN_XDR_SERDE_DECL(COMMIT3resok, file_wcc, verf);
+
+struct COMMIT3resfail {
+  wcc_data file_wcc;
+};
+EDEN_XDR_SERDE_DECL(COMMIT3resfail, file_wcc);
+
+struct COMMIT3res
+    : public detail::Nfsstat3Variant<COMMIT3resok, COMMIT3resfail> {};
+
 } // namespace facebook::eden
 
 #endif
@@ -11,6 +11,7 @@
 
 // https://datatracker.ietf.org/doc/rfc5531/?include_text=1
 
+#include <folly/small_vector.h>
 #include <vector>
 
 #include "eden/fs/nfs/xdr/Xdr.h"
@@ -78,7 +79,12 @@ enum class auth_stat {
   RPCSEC_GSS_CTXPROBLEM = 14 /* problem with context */
 };
 
-using OpaqueBytes = std::vector<uint8_t>;
+/**
+ * Credentials and verifiers are decoded for every call. AUTH_SYS credentials
+ * fit inline, so decoding them does not allocate.
+ */
+constexpr size_t kInlineOpaqueAuthSize = 128;
+using OpaqueBytes = folly::small_vector<uint8_t, kInlineOpaqueAuthSize>;
 
 struct opaque_auth {
   auth_flavor flavor;
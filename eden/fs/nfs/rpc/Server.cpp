@@ -11,6 +11,7 @@
 
 #include <folly/Exception.h>
 #include <folly/String.h>
+#include <folly/executors/IOExecutor.h>
 #include <folly/executors/QueuedImmediateExecutor.h>
 #include <folly/io/IOBufQueue.h>
 #include <folly/io/async/AsyncSocket.h>
@@ -163,14 +164,36 @@ class RpcTcpHandler : public folly::DelayedDestruction {
       std::unique_ptr<folly::IOBuf> input,
       DestructorGuard guard);
 
+  /**
+   * Queue a reply to be written to the socket.
+   *
+   * All the replies that complete during an EventBase loop iteration are
+   * written together at the end of it, with a single writev instead of one
+   * write per reply. This bounds the added latency to one loop iteration.
+   */
+  void queueReply(std::unique_ptr<folly::IOBuf> reply);
+
+  /**
+   * Write all the queued replies to the socket.
+   */
+  void flushReplies();
+
   std::shared_ptr<RpcServerProcessor> proc_;
   AsyncSocket::UniquePtr sock_;
   std::shared_ptr<folly::Executor> threadPool_;
   std::unique_ptr<Reader> reader_;
   Writer writer_{};
   folly::IOBufQueue readBuf_{folly::IOBufQueue::cacheChainLength()};
+  folly::IOBufQueue pendingReplies_{folly::IOBufQueue::cacheChainLength()};
+  size_t numPendingReplies_{0};
 };
 
+/**
+ * Past this many bytes of queued replies, flush them right away instead of
+ * waiting for the end of the EventBase loop iteration.
+ */
+constexpr size_t kMaxPendingReplyBytes = 1024 * 1024;
+
 void RpcTcpHandler::tryConsumeReadBuffer() noexcept {
   // Iterate over all the complete fragments and dispatch these to the
   // threadPool_.
@@ -354,20 +377,51 @@ void RpcTcpHandler::dispatchAndReply(
         if (result.hasException()) {
           // XXX: This should never happen.
         } else {
-          auto resultBuffer = std::move(result).value();
-          sock_->writeChain(&writer_, std::move(resultBuffer));
+          queueReply(std::move(result).value());
         }
       });
 }
 
+void RpcTcpHandler::queueReply(std::unique_ptr<folly::IOBuf> reply) {
+  pendingReplies_.append(std::move(reply));
+  if (++numPendingReplies_ == 1) {
+    sock_->getEventBase()->runInLoop(
+        [this, guard = DestructorGuard(this)]() { flushReplies(); });
+  } else if (pendingReplies_.chainLength() >= kMaxPendingReplyBytes) {
+    flushReplies();
+  }
+}
+
+void RpcTcpHandler::flushReplies() {
+  if (numPendingReplies_ == 0) {
+    return;
+  }
+
+  proc_->onRepliesFlushed(numPendingReplies_);
+  numPendingReplies_ = 0;
+  sock_->writeChain(&writer_, pendingReplies_.move());
+}
+
 } // namespace
 
 void RpcServer::RpcAcceptCallback::connectionAccepted(
     folly::NetworkSocket fd,
     const folly::SocketAddress& clientAddr) noexcept {
   XLOG(DBG7) << "Accepted connection from: " << clientAddr;
-  auto socket = AsyncSocket::newSocket(evb_, fd);
-  auto handler = RpcTcpHandler::create(proc_, std::move(socket), threadPool_);
+  if (!ioPool_) {
+    auto socket = AsyncSocket::newSocket(evb_, fd);
+    auto handler = RpcTcpHandler::create(proc_, std::move(socket), threadPool_);
+    return;
+  }
+
+  // The socket must be created and used on the EventBase it is attached to,
+  // hop to the IO thread that will service this connection.
+  auto evb = ioPool_->getEventBase();
+  evb->runInEventBaseThread([evb, fd, proc = proc_, threadPool = threadPool_] {
+    auto socket = AsyncSocket::newSocket(evb, fd);
+    auto handler = RpcTcpHandler::create(
+        std::move(proc), std::move(socket), std::move(threadPool));
+  });
 }
 
 void RpcServer::RpcAcceptCallback::acceptError(
@@ -400,13 +454,19 @@ ImmediateFuture<folly::Unit> RpcServerProcessor::dispatchRpc(
 
 void RpcServerProcessor::onSocketClosed() {}
 
+void RpcServerProcessor::onRepliesFlushed(size_t /*numReplies*/) {}
+
 RpcServer::RpcServer(
     std::shared_ptr<RpcServerProcessor> proc,
     folly::EventBase* evb,
-    std::shared_ptr<folly::Executor> threadPool)
+    std::shared_ptr<folly::Executor> threadPool,
+    std::shared_ptr<folly::IOExecutor> ioPool)
     : evb_(evb),
-      acceptCb_(
-          new RpcServer::RpcAcceptCallback(proc, evb_, std::move(threadPool))),
+      acceptCb_(new RpcServer::RpcAcceptCallback(
+          proc,
+          evb_,
+          std::move(threadPool),
+          std::move(ioPool))),
       serverSocket_(new AsyncServerSocket(evb_)) {}
 
 void RpcServer::initialize(folly::SocketAddress addr) {
@@ -18,6 +18,7 @@
 
 namespace folly {
 class Executor;
+class IOExecutor;
 }
 
 namespace facebook::eden {
@@ -34,6 +35,12 @@ class RpcServerProcessor {
       uint32_t progVersion,
       uint32_t procNumber);
   virtual void onSocketClosed();
+
+  /**
+   * Called on the EventBase thread every time numReplies replies are written
+   * to the socket at once.
+   */
+  virtual void onRepliesFlushed(size_t numReplies);
 };
 
 class RpcServer {
@@ -41,13 +48,19 @@ class RpcServer {
   /**
    * Create an RPC server.
    *
-   * Request will be received on the passed EventBase and dispatched to the
-   * RpcServerProcessor on the passed in threadPool.
+   * Connections will be accepted on the passed EventBase and requests
+   * dispatched to the RpcServerProcessor on the passed in threadPool.
+   *
+   * When ioPool is non-null, each accepted connection is assigned to one of
+   * its EventBase, spreading the socket reads and writes of the various
+   * connections over several threads. Otherwise, all the connections are
+   * serviced by evb.
    */
   RpcServer(
       std::shared_ptr<RpcServerProcessor> proc,
       folly::EventBase* evb,
-      std::shared_ptr<folly::Executor> threadPool);
+      std::shared_ptr<folly::Executor> threadPool,
+      std::shared_ptr<folly::IOExecutor> ioPool);
   ~RpcServer();
 
   /**
@@ -58,7 +71,7 @@ class RpcServer {
   void registerService(uint32_t progNumber, uint32_t progVersion);
 
   /**
-   * Return the EventBase that this RpcServer is running on.
+   * Return the EventBase that this RpcServer accepts connections on.
    */
   folly::EventBase* getEventBase() const {
     return evb_;
@@ -79,10 +92,12 @@ class RpcServer {
     explicit RpcAcceptCallback(
         std::shared_ptr<RpcServerProcessor> proc,
         folly::EventBase* evb,
-        std::shared_ptr<folly::Executor> threadPool)
+        std::shared_ptr<folly::Executor> threadPool,
+        std::shared_ptr<folly::IOExecutor> ioPool)
         : evb_(evb),
           proc_(proc),
           threadPool_(std::move(threadPool)),
+          ioPool_(std::move(ioPool)),
           guard_(this) {}
 
    private:
@@ -99,6 +114,7 @@ class RpcServer {
     folly::EventBase* evb_;
     std::shared_ptr<RpcServerProcessor> proc_;
     std::shared_ptr<folly::Executor> threadPool_;
+    std::shared_ptr<folly::IOExecutor> ioPool_;
 
     /**
      * Hold a guard to ourself to avoid being deleted until the callback is
@@ -8,6 +8,7 @@
 #ifndef _WIN32
 
 #include <folly/portability/GTest.h>
+#include "eden/fs/nfs/DirList.h"
 #include "eden/fs/nfs/NfsdRpc.h"
 #include "eden/fs/nfs/testharness/XdrTestUtils.h"
 
@@ -28,6 +29,34 @@ TEST(DirListTest, size) {
   EXPECT_EQ(computeInitialOverhead(), 104);
 }
 
+TEST(DirListTest, plusListHonorsDircount) {
+  // An entry with a 4 bytes name takes 24 bytes of dircount.
+  NfsDirPlusList list{/*dircount*/ 60, /*maxcount*/ 64 * 1024};
+  EXPECT_TRUE(list.add("aaaa", InodeNumber{2}, 1));
+  EXPECT_TRUE(list.add("bbbb", InodeNumber{3}, 2));
+  EXPECT_FALSE(list.add("cccc", InodeNumber{4}, 3));
+  EXPECT_EQ(list.extractList().list.size(), 2);
+}
+
+TEST(DirListTest, plusListHonorsMaxcount) {
+  // Room for a single entry once its attributes and file handle are counted.
+  NfsDirPlusList list{/*dircount*/ 64 * 1024, /*maxcount*/ 104 + 200};
+  EXPECT_TRUE(list.add("aaaa", InodeNumber{2}, 1));
+  EXPECT_FALSE(list.add("bbbb", InodeNumber{3}, 2));
+
+  auto entries = list.extractList();
+  ASSERT_EQ(entries.list.size(), 1);
+  // Filling in the attributes and handle must not make the entry exceed what
+  // was reserved for it.
+  auto& entry = entries.list[0];
+  entry.name_attributes = post_op_attr{fattr3{}};
+  entry.name_handle = post_op_fh3{nfs_fh3{InodeNumber{2}}};
+  EXPECT_LE(
+      XdrTrait<entryplus3>::serializedSize(entry) +
+          XdrTrait<bool>::serializedSize(true),
+      200);
+}
+
 } // namespace facebook::eden
 
 #endif
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#ifndef _WIN32
+
+#include "eden/fs/nfs/Nfsd4Rpc.h"
+#include <folly/portability/GTest.h>
+#include "eden/fs/nfs/testharness/XdrTestUtils.h"
+
+namespace facebook::eden {
+
+TEST(Nfsd4RpcTest, bitmap) {
+  bitmap4 bitmap;
+  bitmap4Set(bitmap, fattr4_attr::size);
+  bitmap4Set(bitmap, fattr4_attr::time_modify);
+  EXPECT_EQ(bitmap.size(), 2);
+  EXPECT_EQ(bitmap[0], 1u << 4);
+  EXPECT_EQ(bitmap[1], 1u << (53 - 32));
+
+  EXPECT_TRUE(bitmap4Contains(bitmap, fattr4_attr::size));
+  EXPECT_TRUE(bitmap4Contains(bitmap, fattr4_attr::time_modify));
+  EXPECT_FALSE(bitmap4Contains(bitmap, fattr4_attr::type));
+  EXPECT_FALSE(bitmap4Contains(bitmap4{}, fattr4_attr::size));
+}
+
+TEST(Nfsd4RpcTest, roundtrip) {
+  roundtrip(COMPOUND4argsHeader{"tag", 1, 3});
+  roundtrip(fattr4{{1, 2}, {1, 2, 3, 4}});
+  roundtrip(READ4args{stateid4{1, {}}, 4096, 8192});
+  roundtrip(nfstime4{-1, 42});
+  roundtrip(SEQUENCE4args{sessionid4{1, 2, 3}, 1, 0, 7, true});
+  roundtrip(CREATE_SESSION4argsHeader{
+      42,
+      1,
+      0,
+      channel_attrs4{0, 1024, 1024, 0, 8, 16, {}},
+      channel_attrs4{0, 512, 512, 0, 2, 1, {4}},
+      0x40000000});
+  roundtrip(EXCHANGE_ID4resok{
+      1,
+      2,
+      EXCHGID4_FLAG_USE_NON_PNFS,
+      state_protect_how4::SP4_NONE,
+      server_owner4{0, {'e', 'd', 'e', 'n'}},
+      {'e', 'd', 'e', 'n'},
+      {nfs_impl_id4{"domain", "name", nfstime4{1, 2}}}});
+}
+
+TEST(Nfsd4RpcTest, fixedSize) {
+  static_assert(kXdrFixedSize<nfstime4> == 12);
+  static_assert(kXdrFixedSize<stateid4> == 16);
+  static_assert(kXdrFixedSize<READ4args> == 28);
+  static_assert(kXdrFixedSize<SEQUENCE4args> == 32);
+  static_assert(!kXdrFixedSize<fattr4>.has_value());
+}
+
+} // namespace facebook::eden
+
+#endif
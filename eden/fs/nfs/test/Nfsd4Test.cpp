@@ -0,0 +1,441 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#ifndef _WIN32
+
+#include "eden/fs/nfs/Nfsd4.h"
+
+#include <folly/logging/Logger.h>
+#include <folly/portability/GTest.h>
+#include "eden/fs/telemetry/EdenStats.h"
+#include "eden/fs/utils/Clock.h"
+#include "eden/fs/utils/ProcessNameCache.h"
+
+namespace facebook::eden {
+namespace {
+
+constexpr InodeNumber kFileIno{2};
+constexpr folly::StringPiece kFileContent{"0123456789"};
+constexpr uint32_t kIosize = 4;
+
+template <typename T>
+ImmediateFuture<T> notSupported() {
+  return makeImmediateFutureWith(
+      []() -> T { throw std::system_error(ENOTSUP, std::generic_category()); });
+}
+
+/**
+ * Serve a root directory containing a single regular file named "file".
+ */
+class FakeDispatcher final : public NfsDispatcher {
+ public:
+  FakeDispatcher(EdenStats* stats, const Clock& clock)
+      : NfsDispatcher{stats, clock} {}
+
+  ImmediateFuture<struct stat> getattr(InodeNumber ino, ObjectFetchContext&)
+      override {
+    return makeImmediateFutureWith([ino]() {
+      struct stat st {};
+      if (ino == kRootNodeId) {
+        st.st_mode = S_IFDIR | 0755;
+      } else if (ino == kFileIno) {
+        st.st_mode = S_IFREG | 0644;
+        st.st_size = kFileContent.size();
+      } else {
+        throw std::system_error(ENOENT, std::generic_category());
+      }
+      st.st_ino = ino.get();
+      return st;
+    });
+  }
+
+  ImmediateFuture<SetattrRes>
+  setattr(InodeNumber, DesiredMetadata, ObjectFetchContext&) override {
+    return notSupported<SetattrRes>();
+  }
+
+  ImmediateFuture<InodeNumber> getParent(InodeNumber, ObjectFetchContext&)
+      override {
+    return kRootNodeId;
+  }
+
+  ImmediateFuture<LookupRes>
+  lookup(InodeNumber dir, PathComponent name, ObjectFetchContext& context)
+      override {
+    if (dir != kRootNodeId || name.stringPiece() != "file") {
+      return LookupRes{std::nullopt};
+    }
+    return getattr(kFileIno, context).thenValue([](struct stat&& st) {
+      return LookupRes{std::make_tuple(kFileIno, st)};
+    });
+  }
+
+  ImmediateFuture<std::string> readlink(InodeNumber, ObjectFetchContext&)
+      override {
+    return notSupported<std::string>();
+  }
+
+  ImmediateFuture<ReadRes>
+  read(InodeNumber, size_t size, off_t offset, ObjectFetchContext&) override {
+    readSizes.push_back(size);
+    auto data = kFileContent.subpiece(offset, size);
+    return ReadRes{
+        folly::IOBuf::copyBuffer(data.data(), data.size()),
+        offset + data.size() >= kFileContent.size()};
+  }
+
+  ImmediateFuture<WriteRes> write(
+      InodeNumber,
+      std::unique_ptr<folly::IOBuf>,
+      off_t,
+      ObjectFetchContext&) override {
+    return notSupported<WriteRes>();
+  }
+
+  ImmediateFuture<folly::Unit> commit(InodeNumber, ObjectFetchContext&)
+      override {
+    return notSupported<folly::Unit>();
+  }
+
+  ImmediateFuture<CreateRes>
+  create(InodeNumber, PathComponent, mode_t, ObjectFetchContext&) override {
+    return notSupported<CreateRes>();
+  }
+
+  ImmediateFuture<MkdirRes>
+  mkdir(InodeNumber, PathComponent, mode_t, ObjectFetchContext&) override {
+    return notSupported<MkdirRes>();
+  }
+
+  ImmediateFuture<SymlinkRes> symlink(
+      InodeNumber,
+      PathComponent,
+      std::string,
+      ObjectFetchContext&) override {
+    return notSupported<SymlinkRes>();
+  }
+
+  ImmediateFuture<MknodRes> mknod(
+      InodeNumber,
+      PathComponent,
+      mode_t,
+      dev_t,
+      ObjectFetchContext&) override {
+    return notSupported<MknodRes>();
+  }
+
+  ImmediateFuture<UnlinkRes>
+  unlink(InodeNumber, PathComponent, ObjectFetchContext&) override {
+    return notSupported<UnlinkRes>();
+  }
+
+  ImmediateFuture<RmdirRes>
+  rmdir(InodeNumber, PathComponent, ObjectFetchContext&) override {
+    return notSupported<RmdirRes>();
+  }
+
+  ImmediateFuture<RenameRes> rename(
+      InodeNumber,
+      PathComponent,
+      InodeNumber,
+      PathComponent,
+      ObjectFetchContext&) override {
+    return notSupported<RenameRes>();
+  }
+
+  ImmediateFuture<ReaddirRes>
+  readdir(InodeNumber, off_t, uint32_t, ObjectFetchContext&) override {
+    return notSupported<ReaddirRes>();
+  }
+
+  ImmediateFuture<ReaddirplusRes> readdirplus(
+      InodeNumber,
+      off_t,
+      uint32_t,
+      uint32_t,
+      ObjectFetchContext&) override {
+    return notSupported<ReaddirplusRes>();
+  }
+
+  ImmediateFuture<struct statfs> statfs(InodeNumber, ObjectFetchContext&)
+      override {
+    return notSupported<struct statfs>();
+  }
+
+  std::vector<size_t> readSizes;
+};
+
+/**
+ * The operations of a COMPOUND being built.
+ */
+struct Compound {
+  template <typename... Args>
+  Compound& add(nfs_opnum4 op, const Args&... args) {
+    XdrTrait<nfs_opnum4>::serialize(ser, op);
+    (XdrTrait<Args>::serialize(ser, args), ...);
+    numOps++;
+    return *this;
+  }
+
+  folly::IOBufQueue ops{folly::IOBufQueue::cacheChainLength()};
+  folly::io::QueueAppender ser{&ops, 1024};
+  uint32_t numOps{0};
+};
+
+struct Reply {
+  explicit Reply(std::unique_ptr<folly::IOBuf> buf)
+      : buf{std::move(buf)}, cursor{this->buf.get()} {
+    XdrTrait<rpc_msg_reply>::deserialize(cursor);
+    status = XdrTrait<nfsstat4>::deserialize(cursor);
+    XdrTrait<std::string>::deserialize(cursor);
+    numResults = XdrTrait<uint32_t>::deserialize(cursor);
+  }
+
+  /**
+   * Decode the operation number and status of the next result.
+   */
+  nfsstat4 next(nfs_opnum4 expectedOp) {
+    EXPECT_EQ(XdrTrait<nfs_opnum4>::deserialize(cursor), expectedOp);
+    return XdrTrait<nfsstat4>::deserialize(cursor);
+  }
+
+  std::unique_ptr<folly::IOBuf> buf;
+  folly::io::Cursor cursor;
+  nfsstat4 status;
+  uint32_t numResults;
+};
+
+channel_attrs4 makeChannelAttrs() {
+  return channel_attrs4{0, 1024 * 1024, 1024 * 1024, 4096, 16, 8, {}};
+}
+
+class Nfsd4Test : public ::testing::Test {
+ protected:
+  Reply send(Compound& compound, uint32_t minorVersion = 1) {
+    folly::IOBufQueue call{folly::IOBufQueue::cacheChainLength()};
+    folly::io::QueueAppender ser{&call, 1024};
+    XdrTrait<COMPOUND4argsHeader>::serialize(
+        ser, COMPOUND4argsHeader{"", minorVersion, compound.numOps});
+    if (auto ops = compound.ops.move()) {
+      ser.insert(std::move(ops));
+    }
+    auto buf = call.move();
+
+    folly::IOBufQueue result{folly::IOBufQueue::cacheChainLength()};
+    processor
+        .dispatchRpc(
+            folly::io::Cursor{buf.get()},
+            folly::io::QueueAppender{&result, 1024},
+            ++xid,
+            kNfsdProgNumber,
+            kNfsd4ProgVersion,
+            folly::to_underlying(nfsv4Procs::compound))
+        .get();
+    return Reply{result.move()};
+  }
+
+  /**
+   * Register a client and create a session for it.
+   */
+  sessionid4 createSession() {
+    Compound exchangeId;
+    exchangeId.add(
+        nfs_opnum4::OP_EXCHANGE_ID,
+        EXCHANGE_ID4argsHeader{
+            client_owner4{verifier4{1}, {'c'}},
+            0,
+            state_protect_how4::SP4_NONE},
+        std::vector<nfs_impl_id4>{});
+    auto exchangeIdReply = send(exchangeId);
+    EXPECT_EQ(
+        exchangeIdReply.next(nfs_opnum4::OP_EXCHANGE_ID), nfsstat4::NFS4_OK);
+    auto client =
+        XdrTrait<EXCHANGE_ID4resok>::deserialize(exchangeIdReply.cursor);
+    EXPECT_FALSE(client.eir_flags & EXCHGID4_FLAG_CONFIRMED_R);
+
+    Compound createSession;
+    createSession.add(
+        nfs_opnum4::OP_CREATE_SESSION,
+        CREATE_SESSION4argsHeader{
+            client.eir_clientid,
+            client.eir_sequenceid,
+            0,
+            makeChannelAttrs(),
+            makeChannelAttrs(),
+            0},
+        /*csa_sec_parms*/ uint32_t{0});
+    auto createSessionReply = send(createSession);
+    EXPECT_EQ(
+        createSessionReply.next(nfs_opnum4::OP_CREATE_SESSION),
+        nfsstat4::NFS4_OK);
+    auto session =
+        XdrTrait<CREATE_SESSION4resok>::deserialize(createSessionReply.cursor);
+    EXPECT_EQ(session.csr_fore_chan_attrs.ca_maxrequests, 8);
+    EXPECT_EQ(session.csr_fore_chan_attrs.ca_maxoperations, 16);
+    EXPECT_EQ(
+        session.csr_fore_chan_attrs.ca_maxresponsesize, kIosize + 4096);
+    return session.csr_sessionid;
+  }
+
+  SEQUENCE4args sequence(
+      const sessionid4& session,
+      uint32_t sequenceId,
+      uint32_t slot = 0) {
+    return SEQUENCE4args{session, sequenceId, slot, slot, false};
+  }
+
+  EdenStats stats;
+  UnixClock clock;
+  FakeDispatcher dispatcher{&stats, clock};
+  ProcessAccessLog processAccessLog{std::make_shared<ProcessNameCache>()};
+  folly::Logger straceLogger{"eden.strace"};
+  Nfsd4ServerProcessor processor{
+      dispatcher,
+      &straceLogger,
+      kIosize,
+      processAccessLog};
+  uint32_t xid{0};
+};
+
+TEST_F(Nfsd4Test, onlyMinorVersion1IsServed) {
+  Compound compound;
+  compound.add(nfs_opnum4::OP_PUTROOTFH);
+  auto reply = send(compound, 0);
+  EXPECT_EQ(reply.status, nfsstat4::NFS4ERR_MINOR_VERS_MISMATCH);
+  EXPECT_EQ(reply.numResults, 0);
+}
+
+TEST_F(Nfsd4Test, operationsOutsideOfSessionFail) {
+  Compound compound;
+  compound.add(nfs_opnum4::OP_PUTROOTFH).add(nfs_opnum4::OP_GETFH);
+  auto reply = send(compound);
+  EXPECT_EQ(reply.status, nfsstat4::NFS4ERR_OP_NOT_IN_SESSION);
+  EXPECT_EQ(reply.numResults, 1);
+  EXPECT_EQ(
+      reply.next(nfs_opnum4::OP_PUTROOTFH),
+      nfsstat4::NFS4ERR_OP_NOT_IN_SESSION);
+
+  Compound notOnly;
+  notOnly.add(nfs_opnum4::OP_DESTROY_CLIENTID, uint64_t{1})
+      .add(nfs_opnum4::OP_PUTROOTFH);
+  EXPECT_EQ(send(notOnly).status, nfsstat4::NFS4ERR_NOT_ONLY_OP);
+}
+
+TEST_F(Nfsd4Test, sequenceTracksSlots) {
+  auto session = createSession();
+
+  Compound first;
+  first.add(nfs_opnum4::OP_SEQUENCE, sequence(session, 1))
+      .add(nfs_opnum4::OP_PUTROOTFH);
+  auto reply = send(first);
+  EXPECT_EQ(reply.status, nfsstat4::NFS4_OK);
+  EXPECT_EQ(reply.numResults, 2);
+  EXPECT_EQ(reply.next(nfs_opnum4::OP_SEQUENCE), nfsstat4::NFS4_OK);
+  auto res = XdrTrait<SEQUENCE4resok>::deserialize(reply.cursor);
+  EXPECT_EQ(res.sr_sequenceid, 1);
+  EXPECT_EQ(res.sr_highest_slotid, 7);
+
+  Compound replay;
+  replay.add(nfs_opnum4::OP_SEQUENCE, sequence(session, 1));
+  EXPECT_EQ(send(replay).status, nfsstat4::NFS4ERR_RETRY_UNCACHED_REP);
+
+  Compound skipped;
+  skipped.add(nfs_opnum4::OP_SEQUENCE, sequence(session, 3));
+  EXPECT_EQ(send(skipped).status, nfsstat4::NFS4ERR_SEQ_MISORDERED);
+
+  Compound otherSlot;
+  otherSlot.add(nfs_opnum4::OP_SEQUENCE, sequence(session, 1, 7));
+  EXPECT_EQ(send(otherSlot).status, nfsstat4::NFS4_OK);
+
+  Compound badSlot;
+  badSlot.add(nfs_opnum4::OP_SEQUENCE, sequence(session, 1, 8));
+  EXPECT_EQ(send(badSlot).status, nfsstat4::NFS4ERR_BADSLOT);
+
+  Compound misplaced;
+  misplaced.add(nfs_opnum4::OP_SEQUENCE, sequence(session, 2))
+      .add(nfs_opnum4::OP_SEQUENCE, sequence(session, 3));
+  auto misplacedReply = send(misplaced);
+  EXPECT_EQ(misplacedReply.status, nfsstat4::NFS4ERR_SEQUENCE_POS);
+  EXPECT_EQ(misplacedReply.numResults, 2);
+
+  Compound destroy;
+  destroy.add(nfs_opnum4::OP_DESTROY_SESSION, DESTROY_SESSION4args{session});
+  EXPECT_EQ(send(destroy).status, nfsstat4::NFS4_OK);
+
+  Compound destroyed;
+  destroyed.add(nfs_opnum4::OP_SEQUENCE, sequence(session, 4));
+  EXPECT_EQ(send(destroyed).status, nfsstat4::NFS4ERR_BADSESSION);
+}
+
+TEST_F(Nfsd4Test, accessIsComputedFromTheMode) {
+  auto session = createSession();
+  constexpr uint32_t kAll = ACCESS4_READ | ACCESS4_LOOKUP | ACCESS4_MODIFY |
+      ACCESS4_EXTEND | ACCESS4_DELETE | ACCESS4_EXECUTE;
+
+  Compound compound;
+  compound.add(nfs_opnum4::OP_SEQUENCE, sequence(session, 1))
+      .add(nfs_opnum4::OP_PUTROOTFH)
+      .add(nfs_opnum4::OP_ACCESS, ACCESS4args{kAll})
+      .add(nfs_opnum4::OP_LOOKUP, LOOKUP4args{"file"})
+      .add(nfs_opnum4::OP_ACCESS, ACCESS4args{kAll | 0x1000});
+  auto reply = send(compound);
+  EXPECT_EQ(reply.status, nfsstat4::NFS4_OK);
+  EXPECT_EQ(reply.numResults, 5);
+  reply.next(nfs_opnum4::OP_SEQUENCE);
+  XdrTrait<SEQUENCE4resok>::deserialize(reply.cursor);
+  reply.next(nfs_opnum4::OP_PUTROOTFH);
+
+  EXPECT_EQ(reply.next(nfs_opnum4::OP_ACCESS), nfsstat4::NFS4_OK);
+  auto dirAccess = XdrTrait<ACCESS4resok>::deserialize(reply.cursor);
+  EXPECT_EQ(dirAccess.supported, kAll);
+  EXPECT_EQ(
+      dirAccess.access,
+      ACCESS4_READ | ACCESS4_LOOKUP | ACCESS4_MODIFY | ACCESS4_EXTEND |
+          ACCESS4_DELETE);
+
+  EXPECT_EQ(reply.next(nfs_opnum4::OP_LOOKUP), nfsstat4::NFS4_OK);
+  EXPECT_EQ(reply.next(nfs_opnum4::OP_ACCESS), nfsstat4::NFS4_OK);
+  auto fileAccess = XdrTrait<ACCESS4resok>::deserialize(reply.cursor);
+  EXPECT_EQ(fileAccess.supported, kAll);
+  EXPECT_EQ(
+      fileAccess.access, ACCESS4_READ | ACCESS4_MODIFY | ACCESS4_EXTEND);
+}
+
+TEST_F(Nfsd4Test, effectiveAccess) {
+  EXPECT_EQ(
+      getEffectiveAccess4(S_IFREG | 0755, ACCESS4_EXECUTE), ACCESS4_EXECUTE);
+  EXPECT_EQ(getEffectiveAccess4(S_IFREG | 0444, ACCESS4_MODIFY), 0);
+  EXPECT_EQ(getEffectiveAccess4(S_IFDIR | 0500, ACCESS4_DELETE), 0);
+  EXPECT_EQ(getEffectiveAccess4(S_IFDIR | 0700, ACCESS4_EXECUTE), 0);
+}
+
+TEST_F(Nfsd4Test, readIsBoundedByIosize) {
+  auto session = createSession();
+
+  Compound compound;
+  compound.add(nfs_opnum4::OP_SEQUENCE, sequence(session, 1))
+      .add(nfs_opnum4::OP_PUTROOTFH)
+      .add(nfs_opnum4::OP_LOOKUP, LOOKUP4args{"file"})
+      .add(nfs_opnum4::OP_READ, READ4args{stateid4{}, 2, 1024 * 1024});
+  auto reply = send(compound);
+  EXPECT_EQ(reply.status, nfsstat4::NFS4_OK);
+  reply.next(nfs_opnum4::OP_SEQUENCE);
+  XdrTrait<SEQUENCE4resok>::deserialize(reply.cursor);
+  reply.next(nfs_opnum4::OP_PUTROOTFH);
+  reply.next(nfs_opnum4::OP_LOOKUP);
+  EXPECT_EQ(reply.next(nfs_opnum4::OP_READ), nfsstat4::NFS4_OK);
+  EXPECT_FALSE(XdrTrait<bool>::deserialize(reply.cursor));
+  auto data =
+      XdrTrait<std::unique_ptr<folly::IOBuf>>::deserialize(reply.cursor);
+  EXPECT_EQ(data->moveToFbString(), "2345");
+  EXPECT_EQ(dispatcher.readSizes, std::vector<size_t>{kIosize});
+}
+
+} // namespace
+} // namespace facebook::eden
+
+#endif
@@ -43,6 +43,13 @@ TEST(NfsdRpcTest, variant) {
   roundtrip(var4);
 }
 
+TEST(NfsdRpcTest, fixedSize) {
+  static_assert(kXdrFixedSize<nfs_fh3> == 12);
+  static_assert(kXdrFixedSize<fattr3> == 84);
+  static_assert(kXdrFixedSize<wcc_attr> == 24);
+  static_assert(!kXdrFixedSize<post_op_attr>.has_value());
+}
+
 } // namespace facebook::eden
 
 #endif
@@ -12,6 +12,17 @@
 namespace facebook::eden {
 
 namespace {
+constexpr uint8_t kPadding[3] = {0, 0, 0};
+
+size_t checkedIOBufLength(const folly::IOBuf& buf) {
+  auto len = buf.computeChainDataLength();
+  if (len > std::numeric_limits<uint32_t>::max()) {
+    throw std::length_error(
+        "XDR cannot encode variable sized array bigger than 4GB");
+  }
+  return len;
+}
+
 void addPadding(folly::io::QueueAppender& appender, size_t len) {
   auto paddingBytes = detail::roundUp(len) - len;
   for (size_t i = 0; i < paddingBytes; i++) {
@@ -38,16 +49,26 @@ void serialize_variable(
 void serialize_iobuf(
     folly::io::QueueAppender& appender,
     const folly::IOBuf& buf) {
-  auto len = buf.computeChainDataLength();
-  if (len > std::numeric_limits<uint32_t>::max()) {
-    throw std::length_error(
-        "XDR cannot encode variable sized array bigger than 4GB");
-  }
+  auto len = checkedIOBufLength(buf);
   XdrTrait<uint32_t>::serialize(appender, folly::to_narrow(len));
   appender.insert(buf);
   addPadding(appender, len);
 }
 
+void serialize_iobuf(
+    folly::io::QueueAppender& appender,
+    std::unique_ptr<folly::IOBuf> buf) {
+  auto len = checkedIOBufLength(*buf);
+  XdrTrait<uint32_t>::serialize(appender, folly::to_narrow(len));
+  appender.insert(std::move(buf));
+  if (auto paddingBytes = roundUp(len) - len; paddingBytes != 0) {
+    // Writing the padding through the appender would need tailroom after the
+    // data, which a shared blob buffer doesn't have. Link a static buffer
+    // instead of allocating a new one.
+    appender.insert(folly::IOBuf::wrapBuffer(kPadding, paddingBytes));
+  }
+}
+
 } // namespace detail
 
 } // namespace facebook::eden
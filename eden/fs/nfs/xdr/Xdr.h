@@ -11,6 +11,8 @@
 
 #include <folly/Preprocessor.h>
 #include <folly/io/Cursor.h>
+#include <folly/small_vector.h>
+#include <initializer_list>
 #include <optional>
 #include <variant>
 
@@ -39,23 +41,35 @@
 // This macro declares the XDR serializer and deserializer functions
 // for a given type.
 // See EDEN_XDR_SERDE_IMPL above for an example.
-#define EDEN_XDR_SERDE_DECL(STRUCT, ...)                      \
-  bool operator==(const STRUCT& a, const STRUCT& b);          \
-  template <>                                                 \
-  struct XdrTrait<STRUCT> {                                   \
-    static void serialize(                                    \
-        folly::io::QueueAppender& appender,                   \
-        const STRUCT& a) {                                    \
-      FOLLY_PP_FOR_EACH(EDEN_XDR_SER, __VA_ARGS__)            \
-    }                                                         \
-    static STRUCT deserialize(folly::io::Cursor& cursor) {    \
-      STRUCT ret;                                             \
-      FOLLY_PP_FOR_EACH(EDEN_XDR_DE, __VA_ARGS__)             \
-      return ret;                                             \
-    }                                                         \
-    static size_t serializedSize(const STRUCT& a) {           \
-      return FOLLY_PP_FOR_EACH(EDEN_XDR_SIZE, __VA_ARGS__) 0; \
-    }                                                         \
+//
+// When all the fields have a size known at compile time, kFixedSize holds the
+// serialized size of the struct, see kXdrFixedSize below.
+#define EDEN_XDR_SERDE_DECL(STRUCT, ...)                               \
+  bool operator==(const STRUCT& a, const STRUCT& b);                   \
+  template <>                                                          \
+  struct XdrTrait<STRUCT> {                                            \
+    using Struct = STRUCT;                                             \
+    static constexpr std::optional<size_t> kFixedSize =                \
+        detail::sumFixedSizes(                                         \
+            {FOLLY_PP_FOR_EACH(EDEN_XDR_FIXED_SIZE, __VA_ARGS__)});    \
+    static void serialize(                                             \
+        folly::io::QueueAppender& appender,                            \
+        const STRUCT& a) {                                             \
+      FOLLY_PP_FOR_EACH(EDEN_XDR_SER, __VA_ARGS__)                     \
+    }                                                                  \
+    static STRUCT deserialize(folly::io::Cursor& cursor) {             \
+      STRUCT ret;                                                      \
+      FOLLY_PP_FOR_EACH(EDEN_XDR_DE, __VA_ARGS__)                      \
+      return ret;                                                      \
+    }                                                                  \
+    static size_t serializedSize(const STRUCT& a) {                    \
+      if constexpr (kFixedSize.has_value()) {                          \
+        (void)a;                                                       \
+        return *kFixedSize;                                            \
+      } else {                                                         \
+        return FOLLY_PP_FOR_EACH(EDEN_XDR_SIZE, __VA_ARGS__) 0;        \
+      }                                                                \
+    }                                                                  \
   }
 
 #define EDEN_XDR_SERDE_IMPL(STRUCT, ...)                  \
@@ -79,6 +93,11 @@
 // size of the given field.
 #define EDEN_XDR_SIZE(name) XdrTrait<decltype(a.name)>::serializedSize(a.name) +
 
+// This is a helper called by FOLLY_PP_FOR_EACH. It emits the compile time
+// size of the given field, followed by a comma.
+#define EDEN_XDR_FIXED_SIZE(name) \
+  detail::xdrFixedSize<decltype(Struct::name)>(),
+
 // This is a helper called by FOLLY_PP_FOR_EACH. It emits a comparison
 // between a.name and b.name, followed by &&.  It is intended
 // to be used in a sequence and have a literal 1 following that sequence.
@@ -109,6 +128,43 @@ struct XdrTrait;
 
 namespace detail {
 
+template <typename T, class Enable = void>
+struct HasXdrFixedSize : std::false_type {};
+
+template <typename T>
+struct HasXdrFixedSize<T, std::void_t<decltype(XdrTrait<T>::kFixedSize)>>
+    : std::true_type {};
+
+/**
+ * Return the serialized size of T when it is the same for all values of T.
+ *
+ * A XdrTrait advertises this by having a constexpr kFixedSize member.
+ */
+template <typename T>
+constexpr std::optional<size_t> xdrFixedSize() {
+  if constexpr (HasXdrFixedSize<T>::value) {
+    return std::optional<size_t>{XdrTrait<T>::kFixedSize};
+  } else {
+    return std::nullopt;
+  }
+}
+
+/**
+ * Sum the fixed sizes of the fields of a struct. As soon as one field doesn't
+ * have a fixed size, neither does the struct.
+ */
+constexpr std::optional<size_t> sumFixedSizes(
+    std::initializer_list<std::optional<size_t>> sizes) {
+  size_t total = 0;
+  for (auto size : sizes) {
+    if (!size.has_value()) {
+      return std::nullopt;
+    }
+    total += *size;
+  }
+  return total;
+}
+
 template <typename T>
 struct IsXdrIntegral
     : std::integral_constant<
@@ -124,6 +180,8 @@ struct IsXdrIntegral
  */
 template <typename T>
 struct XdrTrait<T, typename std::enable_if_t<detail::IsXdrIntegral<T>::value>> {
+  static constexpr size_t kFixedSize = sizeof(T);
+
   static void serialize(folly::io::QueueAppender& appender, T value) {
     appender.writeBE<T>(value);
   }
@@ -142,6 +200,8 @@ struct XdrTrait<T, typename std::enable_if_t<detail::IsXdrIntegral<T>::value>> {
  */
 template <>
 struct XdrTrait<bool> {
+  static constexpr size_t kFixedSize = sizeof(int32_t);
+
   static void serialize(folly::io::QueueAppender& appender, bool value) {
     XdrTrait<int32_t>::serialize(appender, value ? 1 : 0);
   }
@@ -160,6 +220,8 @@ struct XdrTrait<bool> {
  */
 template <typename T>
 struct XdrTrait<T, typename std::enable_if_t<std::is_enum_v<T>>> {
+  static constexpr size_t kFixedSize = sizeof(int32_t);
+
   static void serialize(folly::io::QueueAppender& appender, const T& value) {
     static_assert(sizeof(T) <= 4, "enum must fit in int32");
     XdrTrait<int32_t>::serialize(appender, static_cast<int32_t>(value));
@@ -209,6 +271,16 @@ void serialize_iobuf(
     folly::io::QueueAppender& appender,
     const folly::IOBuf& buf);
 
+/**
+ * Same as above, but take ownership of the IOBuf chain. The chain is linked
+ * into the output as is, referencing the same memory instead of copying it,
+ * and the padding is appended as a separate small buffer. Use this when
+ * serializing large buffers, like file content.
+ */
+void serialize_iobuf(
+    folly::io::QueueAppender& appender,
+    std::unique_ptr<folly::IOBuf> buf);
+
 /**
  * Skip the padding bytes that were written during serialization.
  */
@@ -218,11 +290,34 @@ inline void skipPadding(folly::io::Cursor& cursor, size_t len) {
 
 } // namespace detail
 
+/**
+ * Serialized size of T, when known at compile time, std::nullopt otherwise.
+ */
+template <typename T>
+inline constexpr std::optional<size_t> kXdrFixedSize =
+    detail::xdrFixedSize<T>();
+
+/**
+ * Serialize value after making sure that the appender has enough contiguous
+ * room for all of it. The value is then encoded into a single buffer instead
+ * of growing the output in many small steps.
+ *
+ * This must not be used for values holding IOBufs, as the IOBuf content would
+ * be accounted in the preallocation even though it is linked and not copied.
+ */
+template <typename T>
+void serializePresized(folly::io::QueueAppender& appender, const T& value) {
+  appender.ensure(XdrTrait<T>::serializedSize(value));
+  XdrTrait<T>::serialize(appender, value);
+}
+
 /**
  * Array are encoded as a fixed size array with no preceding length indicator.
  */
 template <size_t N>
 struct XdrTrait<std::array<uint8_t, N>> {
+  static constexpr size_t kFixedSize = detail::roundUp(N);
+
   static void serialize(
       folly::io::QueueAppender& appender,
       const std::array<uint8_t, N>& value) {
@@ -237,7 +332,7 @@ struct XdrTrait<std::array<uint8_t, N>> {
   }
 
   static constexpr size_t serializedSize(const std::array<uint8_t, N>&) {
-    return N;
+    return kFixedSize;
   }
 };
 
@@ -296,11 +391,40 @@ struct XdrTrait<std::vector<uint8_t>> {
   }
 };
 
+/**
+ * Same encoding as a vector of bytes, for small opaque fields. Up to N bytes
+ * are decoded into inline storage instead of a heap allocation.
+ */
+template <size_t N>
+struct XdrTrait<folly::small_vector<uint8_t, N>> {
+  static void serialize(
+      folly::io::QueueAppender& appender,
+      const folly::small_vector<uint8_t, N>& value) {
+    detail::serialize_variable(
+        appender, folly::ByteRange(value.data(), value.size()));
+  }
+
+  static folly::small_vector<uint8_t, N> deserialize(
+      folly::io::Cursor& cursor) {
+    auto len = XdrTrait<uint32_t>::deserialize(cursor);
+    folly::small_vector<uint8_t, N> ret(len);
+    cursor.pull(ret.data(), len);
+    detail::skipPadding(cursor, len);
+    return ret;
+  }
+
+  static size_t serializedSize(const folly::small_vector<uint8_t, N>& value) {
+    return XdrTrait<uint32_t>::serializedSize(0) +
+        detail::roundUp(value.size());
+  }
+};
+
 /**
  * IOBuf are encoded as a variable sized array, similarly to a vector. IOBuf
  * should be preferred to a vector when the data to serialize/deserialize is
  * potentially large, a vector would copy all the data, while an IOBuf would
- * clone the existing cursor.
+ * clone the existing cursor: the decoded chain shares the memory of the
+ * buffers being read.
  */
 template <>
 struct XdrTrait<std::unique_ptr<folly::IOBuf>> {
@@ -310,6 +434,12 @@ struct XdrTrait<std::unique_ptr<folly::IOBuf>> {
     detail::serialize_iobuf(appender, *buf);
   }
 
+  static void serialize(
+      folly::io::QueueAppender& appender,
+      std::unique_ptr<folly::IOBuf>&& buf) {
+    detail::serialize_iobuf(appender, std::move(buf));
+  }
+
   static std::unique_ptr<folly::IOBuf> deserialize(folly::io::Cursor& cursor) {
     auto len = XdrTrait<uint32_t>::deserialize(cursor);
     auto ret = std::make_unique<folly::IOBuf>();
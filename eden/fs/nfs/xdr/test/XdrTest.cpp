@@ -29,6 +29,11 @@ TEST(XdrSerialize, integers) {
   std::vector<uint8_t> u8Numbers{1, 2, 3};
   roundtrip(u8Numbers);
 
+  folly::small_vector<uint8_t, 4> inlineBytes{1, 2, 3};
+  roundtrip(inlineBytes);
+  folly::small_vector<uint8_t, 4> heapBytes{1, 2, 3, 4, 5, 6};
+  roundtrip(heapBytes);
+
   auto fixedNumbers = folly::make_array<uint32_t>(3, 2, 1);
   roundtrip(fixedNumbers);
 }
@@ -45,6 +50,51 @@ TEST(XdrSerialize, structs) {
   roundtrip(s);
 }
 
+struct MyFixedStruct {
+  uint32_t number;
+  bool flag;
+  uint64_t bigNumber;
+  std::array<uint8_t, 6> bytes;
+};
+EDEN_XDR_SERDE_DECL(MyFixedStruct, number, flag, bigNumber, bytes);
+EDEN_XDR_SERDE_IMPL(MyFixedStruct, number, flag, bigNumber, bytes);
+
+struct MyNestedFixedStruct {
+  MyFixedStruct fixed;
+  uint32_t other;
+};
+EDEN_XDR_SERDE_DECL(MyNestedFixedStruct, fixed, other);
+EDEN_XDR_SERDE_IMPL(MyNestedFixedStruct, fixed, other);
+
+TEST(XdrSerialize, fixedSize) {
+  static_assert(kXdrFixedSize<uint32_t> == 4);
+  static_assert(kXdrFixedSize<bool> == 4);
+  static_assert(kXdrFixedSize<std::array<uint8_t, 6>> == 8);
+  static_assert(kXdrFixedSize<MyFixedStruct> == 24);
+  static_assert(kXdrFixedSize<MyNestedFixedStruct> == 28);
+  static_assert(!kXdrFixedSize<std::string>.has_value());
+  static_assert(!kXdrFixedSize<MySerializableStruct>.has_value());
+
+  MyFixedStruct s{123, true, 456, {1, 2, 3, 4, 5, 6}};
+  roundtrip(s);
+  roundtrip(MyNestedFixedStruct{s, 42});
+}
+
+TEST(XdrSerialize, presized) {
+  folly::IOBufQueue queue;
+  {
+    // A growth smaller than the struct would otherwise need several buffers.
+    folly::io::QueueAppender appender{&queue, 4};
+    serializePresized(appender, MySerializableStruct{123, "hello world"});
+  }
+  auto buf = queue.move();
+  EXPECT_FALSE(buf->isChained());
+  EXPECT_EQ(
+      buf->length(),
+      XdrTrait<MySerializableStruct>::serializedSize(
+          MySerializableStruct{123, "hello world"}));
+}
+
 struct MyVariant : XdrVariant<bool, uint32_t> {};
 
 template <>
@@ -139,6 +189,43 @@ TEST(XdrSerialize, iobuf) {
   roundtrip(std::move(buf));
 }
 
+TEST(XdrSerialize, iobufMoved) {
+  // Small buffers may be packed into the preceding one by the IOBufQueue, use
+  // a buffer large enough to be linked as is. Its size also requires padding.
+  constexpr size_t kSize = 8191;
+  auto data = folly::IOBuf::copyBuffer(std::string(kSize, 'a'));
+  auto dataPtr = data->data();
+
+  folly::IOBufQueue queue{folly::IOBufQueue::cacheChainLength()};
+  {
+    folly::io::QueueAppender appender{&queue, 1024};
+    XdrTrait<std::unique_ptr<folly::IOBuf>>::serialize(
+        appender, std::move(data));
+  }
+  auto serialized = queue.move();
+  EXPECT_EQ(serialized->computeChainDataLength(), 4 + kSize + 1);
+
+  // The data must be referenced by the output, not copied.
+  bool found = false;
+  for (auto range : *serialized) {
+    found |= range.data() == dataPtr;
+  }
+  EXPECT_TRUE(found);
+
+  folly::io::Cursor cursor{serialized.get()};
+  auto deserialized =
+      XdrTrait<std::unique_ptr<folly::IOBuf>>::deserialize(cursor);
+  EXPECT_EQ(deserialized->computeChainDataLength(), kSize);
+  EXPECT_TRUE(cursor.isAtEnd());
+
+  // Decoding shares the serialized buffers as well.
+  found = false;
+  for (auto range : *deserialized) {
+    found |= range.data() == dataPtr;
+  }
+  EXPECT_TRUE(found);
+}
+
 struct ListElement {
   uint32_t value;
 };
@@ -42,6 +42,17 @@ FileMetadata* Enumerator::current() {
   return nullptr;
 }
 
+void Enumerator::prefetch(size_t count) {
+  prefetchIndex_ = std::max(prefetchIndex_, listIndex_);
+  for (; count > 0 && prefetchIndex_ < metadataList_.size(); prefetchIndex_++) {
+    auto& entry = metadataList_[prefetchIndex_];
+    if (PrjFileNameMatch(entry.name.c_str(), searchExpression_.c_str())) {
+      entry.prefetchSize();
+      count--;
+    }
+  }
+}
+
 } // namespace eden
 } // namespace facebook
 
@@ -10,6 +10,7 @@
 #include <optional>
 #include <string>
 #include <vector>
+#include "folly/Function.h"
 #include "eden/fs/model/Hash.h"
 #include "folly/futures/Future.h"
 
@@ -28,29 +29,52 @@ struct FileMetadata {
   //
   bool isDirectory{false};
 
+  /**
+   * Start fetching the size of this entry, if it isn't already known or being
+   * fetched.
+   */
+  void prefetchSize() {
+    if (!cachedSize_ && !sizeFuture_.valid()) {
+      sizeFuture_ = fetchSize_();
+    }
+  }
+
   folly::Future<size_t> getSize() {
     if (cachedSize_) {
       return *cachedSize_;
     }
 
+    prefetchSize();
     return std::move(sizeFuture_).thenValue([this](size_t size) {
       cachedSize_ = size;
       return size;
     });
   }
 
+  /**
+   * Build an entry whose size is already known.
+   */
+  FileMetadata(std::wstring&& name, bool isDir, size_t size)
+      : name(std::move(name)), isDirectory(isDir), cachedSize_(size) {}
+
+  /**
+   * Build an entry whose size will be fetched by calling fetchSize, this is
+   * only done once the Enumerator is about to return the entry to
+   * ProjectedFS.
+   */
   FileMetadata(
       std::wstring&& name,
       bool isDir,
-      folly::Future<size_t> sizeFuture)
+      folly::Function<folly::Future<size_t>()> fetchSize)
       : name(std::move(name)),
         isDirectory(isDir),
-        sizeFuture_(std::move(sizeFuture)) {}
+        fetchSize_(std::move(fetchSize)) {}
 
   FileMetadata() = delete;
 
  private:
-  folly::Future<size_t> sizeFuture_;
+  folly::Function<folly::Future<size_t>()> fetchSize_;
+  folly::Future<size_t> sizeFuture_{folly::Future<size_t>::makeEmpty()};
   std::optional<size_t> cachedSize_;
 };
 
@@ -64,18 +88,37 @@ class Enumerator {
   Enumerator(Enumerator&& other) noexcept
       : searchExpression_(std::move(other.searchExpression_)),
         metadataList_(std::move(other.metadataList_)),
-        listIndex_(std::move(other.listIndex_)) {}
+        listIndex_(std::move(other.listIndex_)),
+        prefetchIndex_(std::move(other.prefetchIndex_)) {}
 
   explicit Enumerator() = delete;
 
   FileMetadata* current();
 
+  /**
+   * Start fetching the sizes of the next count entries matching the search
+   * expression. The sizes of the entries are fetched lazily so that
+   * enumerating the first few entries of a large directory doesn't fetch the
+   * size of every file in it; prefetching a batch ahead of the entries being
+   * consumed allows these fetches to proceed concurrently.
+   */
+  void prefetch(size_t count);
+
   void advance() {
     ++listIndex_;
   }
 
   void restart() {
     listIndex_ = 0;
+    prefetchIndex_ = 0;
+  }
+
+  /**
+   * Whether the size of the current entry hasn't been prefetched, the caller
+   * should then call prefetch to start fetching the next batch.
+   */
+  bool needsPrefetch() const {
+    return listIndex_ >= prefetchIndex_;
   }
 
   bool isSearchExpressionEmpty() const {
@@ -95,6 +138,11 @@ class Enumerator {
   // multiple calls
   //
   size_t listIndex_ = 0;
+
+  //
+  // Entries before prefetchIndex_ have had their size fetch started.
+  //
+  size_t prefetchIndex_ = 0;
 };
 } // namespace eden
 } // namespace facebook
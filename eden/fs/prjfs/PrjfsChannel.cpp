@@ -9,6 +9,7 @@
 
 #include "eden/fs/prjfs/PrjfsChannel.h"
 #include <fmt/format.h>
+#include <folly/container/F14Map.h>
 #include <folly/logging/xlog.h>
 #include "eden/fs/prjfs/PrjfsDispatcher.h"
 #include "eden/fs/prjfs/PrjfsRequestContext.h"
@@ -23,6 +24,14 @@ namespace facebook::eden {
 
 namespace {
 
+/**
+ * Number of entries whose size is fetched ahead of the one being added to
+ * the enumeration buffer. ProjectedFS buffers only hold a few hundred entries,
+ * so this keeps the fetches concurrent without fetching the size of entries
+ * that may never be listed.
+ */
+constexpr size_t kEnumerationPrefetchCount = 64;
+
 #define BAIL_ON_RECURSIVE_CALL(callbackData)                               \
   do {                                                                     \
     if (callbackData->TriggeringProcessId == GetCurrentProcessId()) {      \
@@ -177,18 +186,18 @@ HRESULT PrjfsChannelInner::startEnumeration(
                              context,
                              guid = std::move(guid),
                              path = std::move(path)]() mutable {
-        auto requestWatch =
-            std::shared_ptr<RequestMetricsScope::LockedRequestWatchList>(
-                nullptr);
+        auto requestWatch = std::shared_ptr<RequestWatchList>(nullptr);
         auto stat = &ChannelThreadStats::openDir;
         context->startRequest(dispatcher_->getStats(), stat, requestWatch);
 
         FB_LOGF(getStraceLogger(), DBG7, "opendir({}, guid={})", path, guid);
-        return dispatcher_->opendir(std::move(path), *context)
+        return dispatcher_->opendir(path, *context)
             .thenValue([this,
                         context = std::move(context),
-                        guid = std::move(guid)](auto&& dirents) {
+                        guid = std::move(guid),
+                        path = std::move(path)](auto&& dirents) mutable {
               addDirectoryEnumeration(std::move(guid), std::move(dirents));
+              prefetchChildren(std::move(path), context);
               context->sendSuccess();
             });
       }).within(requestTimeout_);
@@ -199,6 +208,85 @@ HRESULT PrjfsChannelInner::startEnumeration(
   return HRESULT_FROM_WIN32(ERROR_IO_PENDING);
 }
 
+namespace {
+/**
+ * Maximum number of files prefetched when a directory is listed.
+ */
+constexpr size_t kMaxPrefetchPerDirectory = 1024;
+
+/**
+ * Duration over which the prefetch budget of a process applies. A process
+ * listing directories for longer gets a new budget every window.
+ */
+constexpr auto kPrefetchBudgetWindow = std::chrono::minutes{1};
+} // namespace
+
+void PrjfsChannelInner::prefetchChildren(
+    RelativePath path,
+    std::shared_ptr<PrjfsRequestContext> context) {
+  if (prefetchBudgetPerProcess_ == 0) {
+    return;
+  }
+
+  auto pid = context->getClientPid().value_or(0);
+  auto reservation = reservePrefetchBudget(pid, kMaxPrefetchPerDirectory);
+  if (reservation.count == 0) {
+    return;
+  }
+
+  dispatcher_->prefetchChildren(std::move(path), reservation.count, *context)
+      .thenTry([this, pid, reservation, context = std::move(context)](
+                   folly::Try<size_t> prefetched) {
+        auto used = prefetched.hasValue() ? *prefetched : 0;
+        releasePrefetchBudget(
+            pid,
+            reservation,
+            reservation.count - std::min(used, reservation.count));
+      });
+}
+
+PrjfsChannelInner::PrefetchReservation PrjfsChannelInner::reservePrefetchBudget(
+    pid_t pid,
+    size_t count) {
+  auto now = std::chrono::steady_clock::now();
+  auto budgets = prefetchBudgets_.wlock();
+  if (now - budgets->windowStart >= kPrefetchBudgetWindow) {
+    budgets->window++;
+    budgets->windowStart = now;
+    budgets->prefetched.clear();
+  }
+
+  auto& used = budgets->prefetched[pid];
+  if (used >= prefetchBudgetPerProcess_) {
+    return PrefetchReservation{budgets->window, 0};
+  }
+  auto reserved = std::min<uint64_t>(count, prefetchBudgetPerProcess_ - used);
+  used += reserved;
+  return PrefetchReservation{budgets->window, reserved};
+}
+
+void PrjfsChannelInner::releasePrefetchBudget(
+    pid_t pid,
+    const PrefetchReservation& reservation,
+    size_t count) {
+  if (count == 0) {
+    return;
+  }
+  auto budgets = prefetchBudgets_.wlock();
+  if (budgets->window != reservation.window) {
+    // The process already got a new budget.
+    return;
+  }
+  auto it = budgets->prefetched.find(pid);
+  if (it == budgets->prefetched.end()) {
+    return;
+  }
+  it->second -= std::min<uint64_t>(count, it->second);
+  if (it->second == 0) {
+    budgets->prefetched.erase(it);
+  }
+}
+
 HRESULT PrjfsChannelInner::endEnumeration(
     std::shared_ptr<PrjfsRequestContext> /* context */,
     const PRJ_CALLBACK_DATA* /*callbackData*/,
@@ -253,14 +341,17 @@ HRESULT PrjfsChannelInner::getEnumerationData(
                                     context,
                                     enumerator = std::move(enumerator),
                                     buffer = dirEntryBufferHandle] {
-    auto requestWatch =
-        std::shared_ptr<RequestMetricsScope::LockedRequestWatchList>(nullptr);
+    auto requestWatch = std::shared_ptr<RequestWatchList>(nullptr);
     auto stat = &ChannelThreadStats::readDir;
     context->startRequest(dispatcher_->getStats(), stat, requestWatch);
 
     bool added = false;
     for (FileMetadata* entry; (entry = enumerator->current());
          enumerator->advance()) {
+      if (enumerator->needsPrefetch()) {
+        enumerator->prefetch(kEnumerationPrefetchCount);
+      }
+
       auto fileInfo = PRJ_FILE_BASIC_INFO();
 
       fileInfo.IsDirectory = entry->isDirectory;
@@ -313,9 +404,7 @@ HRESULT PrjfsChannelInner::getPlaceholderInfo(
                              context,
                              path = std::move(path),
                              virtualizationContext]() mutable {
-        auto requestWatch =
-            std::shared_ptr<RequestMetricsScope::LockedRequestWatchList>(
-                nullptr);
+        auto requestWatch = std::shared_ptr<RequestWatchList>(nullptr);
         auto stat = &ChannelThreadStats::lookup;
         context->startRequest(dispatcher_->getStats(), stat, requestWatch);
 
@@ -371,9 +460,7 @@ HRESULT PrjfsChannelInner::queryFileName(
 
   auto fut =
       folly::makeFutureWith([this, context, path = std::move(path)]() mutable {
-        auto requestWatch =
-            std::shared_ptr<RequestMetricsScope::LockedRequestWatchList>(
-                nullptr);
+        auto requestWatch = std::shared_ptr<RequestWatchList>(nullptr);
         auto stat = &ChannelThreadStats::access;
         context->startRequest(dispatcher_->getStats(), stat, requestWatch);
         FB_LOGF(getStraceLogger(), DBG7, "access({})", path);
@@ -488,9 +575,7 @@ HRESULT PrjfsChannelInner::getFileData(
                              dataStreamId = Guid(callbackData->DataStreamId),
                              byteOffset,
                              length]() mutable {
-        auto requestWatch =
-            std::shared_ptr<RequestMetricsScope::LockedRequestWatchList>(
-                nullptr);
+        auto requestWatch = std::shared_ptr<RequestWatchList>(nullptr);
         auto stat = &ChannelThreadStats::read;
         context->startRequest(dispatcher_->getStats(), stat, requestWatch);
 
@@ -796,33 +881,193 @@ HRESULT PrjfsChannelInner::notification(
     auto relPath = RelativePath(callbackData->FilePathName);
     auto destPath = RelativePath(destinationFileName);
 
-    auto fut = folly::makeFutureWith([this,
-                                      context,
-                                      stat = stat,
-                                      handler = handler,
-                                      renderer = renderer,
-                                      relPath = std::move(relPath),
-                                      destPath = std::move(destPath),
-                                      isDirectory]() mutable {
-      auto requestWatch =
-          std::shared_ptr<RequestMetricsScope::LockedRequestWatchList>(nullptr);
-      context->startRequest(dispatcher_->getStats(), stat, requestWatch);
-
-      FB_LOG(getStraceLogger(), DBG7, renderer(relPath, destPath, isDirectory));
-      return (this->*handler)(
-                 std::move(relPath), std::move(destPath), isDirectory, *context)
-          .thenValue([context = std::move(context)](auto&&) {
-            context->sendNotificationSuccess();
-          });
-    });
+    auto parent = relPath.dirname().copy();
+    auto isBarrier =
+        isDirectory || notificationType == PRJ_NOTIFICATION_FILE_RENAMED;
+
+    auto apply = [this,
+                  context,
+                  stat = stat,
+                  handler = handler,
+                  renderer = renderer,
+                  relPath = std::move(relPath),
+                  destPath = std::move(destPath),
+                  isDirectory]() mutable {
+      auto fut = folly::makeFutureWith([this,
+                                        context,
+                                        stat = stat,
+                                        handler = handler,
+                                        renderer = renderer,
+                                        relPath = std::move(relPath),
+                                        destPath = std::move(destPath),
+                                        isDirectory]() mutable {
+        auto requestWatch = std::shared_ptr<RequestWatchList>(nullptr);
+        context->startRequest(dispatcher_->getStats(), stat, requestWatch);
 
-    context->catchErrors(std::move(fut), notifications_)
-        .ensure([context = std::move(context)] {});
+        FB_LOG(
+            getStraceLogger(), DBG7, renderer(relPath, destPath, isDirectory));
+        return (this->*handler)(
+                   std::move(relPath),
+                   std::move(destPath),
+                   isDirectory,
+                   *context)
+            .thenValue([context = std::move(context)](auto&&) {
+              context->sendNotificationSuccess();
+            });
+      });
+
+      return context->catchErrors(std::move(fut), notifications_)
+          .ensure([context = std::move(context)] {});
+    };
+
+    enqueueNotification(QueuedNotification{
+        std::move(parent),
+        isBarrier,
+        std::move(context),
+        std::move(apply)});
 
     return HRESULT_FROM_WIN32(ERROR_IO_PENDING);
   }
 }
 
+namespace {
+/**
+ * Apply the notifications one after the other.
+ */
+folly::Future<folly::Unit> applyInOrder(
+    std::vector<folly::Function<folly::Future<folly::Unit>()>> applies) {
+  auto fut = folly::makeFuture();
+  for (auto& apply : applies) {
+    fut = std::move(fut).thenValue(
+        [apply = std::move(apply)](auto&&) mutable { return apply(); });
+  }
+  return fut;
+}
+} // namespace
+
+void PrjfsChannelInner::enqueueNotification(QueuedNotification notification) {
+  {
+    auto queue = notificationQueue_.wlock();
+    queue->pending.push_back(std::move(notification));
+    queue->numEnqueued++;
+    if (queue->isDraining) {
+      // The thread draining the queue will pick this notification up once
+      // the notifications it is applying have completed.
+      return;
+    }
+    queue->isDraining = true;
+  }
+
+  drainNotifications();
+}
+
+void PrjfsChannelInner::drainNotifications() {
+  while (true) {
+    std::vector<QueuedNotification> batch;
+    {
+      auto queue = notificationQueue_.wlock();
+      if (queue->pending.empty()) {
+        queue->isDraining = false;
+        return;
+      }
+
+      // Take everything that is queued so that the notifications for a
+      // directory are grouped across the whole queue instead of being split
+      // at an arbitrary batch size.
+      batch.reserve(queue->pending.size());
+      for (auto& notification : queue->pending) {
+        batch.push_back(std::move(notification));
+      }
+      queue->pending.clear();
+    }
+
+    auto batchSize = batch.size();
+    // The contexts of the batch are released as the notifications complete,
+    // hold onto one of them to keep the channel alive until the next batch
+    // is started.
+    auto keepAlive = batch.back().context;
+    auto fut = applyNotifications(std::move(batch));
+    if (fut.isReady()) {
+      // Loop instead of recursing to not grow the stack when the
+      // notifications complete immediately.
+      notificationsApplied(batchSize);
+      continue;
+    }
+
+    std::move(fut).thenTry(
+        [this, batchSize, keepAlive = std::move(keepAlive)](auto&&) {
+          notificationsApplied(batchSize);
+          drainNotifications();
+        });
+    return;
+  }
+}
+
+void PrjfsChannelInner::notificationsApplied(size_t numApplied) {
+  std::vector<folly::Promise<folly::Unit>> flushed;
+  {
+    auto queue = notificationQueue_.wlock();
+    queue->numApplied += numApplied;
+    while (!queue->flushWaiters.empty() &&
+           queue->flushWaiters.front().first <= queue->numApplied) {
+      flushed.push_back(std::move(queue->flushWaiters.front().second));
+      queue->flushWaiters.pop_front();
+    }
+  }
+
+  for (auto& promise : flushed) {
+    promise.setValue();
+  }
+}
+
+folly::Future<folly::Unit> PrjfsChannelInner::applyNotifications(
+    std::vector<QueuedNotification> batch) {
+  auto fut = folly::makeFuture();
+
+  auto it = batch.begin();
+  while (it != batch.end()) {
+    if (it->isBarrier) {
+      fut = std::move(fut).thenValue(
+          [apply = std::move(it->apply)](auto&&) mutable { return apply(); });
+      ++it;
+      continue;
+    }
+
+    // Group all the notifications up to the next barrier by directory.
+    folly::F14FastMap<
+        RelativePath,
+        std::vector<folly::Function<folly::Future<folly::Unit>()>>>
+        groups;
+    for (; it != batch.end() && !it->isBarrier; ++it) {
+      groups[std::move(it->parent)].push_back(std::move(it->apply));
+    }
+
+    fut = std::move(fut).thenValue([groups = std::move(groups)](
+                                       auto&&) mutable {
+      std::vector<folly::Future<folly::Unit>> futures;
+      futures.reserve(groups.size());
+      for (auto& [parent, applies] : groups) {
+        futures.push_back(applyInOrder(std::move(applies)));
+      }
+      return folly::collectAllUnsafe(std::move(futures)).unit();
+    });
+  }
+
+  return fut;
+}
+
+folly::Future<folly::Unit> PrjfsChannelInner::waitForPendingNotifications() {
+  auto queue = notificationQueue_.wlock();
+  if (queue->numApplied >= queue->numEnqueued) {
+    return folly::unit;
+  }
+
+  folly::Promise<folly::Unit> promise;
+  auto fut = promise.getFuture();
+  queue->flushWaiters.emplace_back(queue->numEnqueued, std::move(promise));
+  return fut;
+}
+
 namespace {
 void sendReply(
     PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT context,
@@ -875,7 +1120,10 @@ PrjfsChannel::~PrjfsChannel() {
       << "stop() must be called before destroying the channel";
 }
 
-void PrjfsChannel::start(bool readOnly, bool useNegativePathCaching) {
+void PrjfsChannel::start(
+    bool readOnly,
+    bool useNegativePathCaching,
+    uint64_t prefetchBudgetPerProcess) {
   if (readOnly) {
     NOT_IMPLEMENTED();
   }
@@ -915,6 +1163,8 @@ void PrjfsChannel::start(bool readOnly, bool useNegativePathCaching) {
       mountPath_,
       mountId_);
 
+  inner_.rlock()->setPrefetchBudgetPerProcess(prefetchBudgetPerProcess);
+
   auto winPath = mountPath_.wide();
 
   auto result = PrjMarkDirectoryAsPlaceholder(
@@ -1045,6 +1295,16 @@ folly::Try<void> PrjfsChannel::addDirectoryPlaceholder(RelativePathPiece path) {
   return folly::Try<void>{};
 }
 
+folly::Future<folly::Unit> PrjfsChannel::waitForPendingNotifications() {
+  auto inner = getInner();
+  if (!inner) {
+    // The channel is being stopped, which waits for all the pending
+    // notifications.
+    return folly::unit;
+  }
+  return inner->waitForPendingNotifications();
+}
+
 void PrjfsChannel::flushNegativePathCache() {
   if (useNegativePathCaching_) {
     XLOG(DBG6) << "Flushing negative path cache";
@@ -9,7 +9,11 @@
 
 #include <folly/portability/Windows.h>
 
+#include <folly/Function.h>
+#include <folly/Synchronized.h>
 #include <folly/futures/Future.h>
+#include <chrono>
+#include <deque>
 
 #include <ProjectedFSLib.h> // @manual
 #include "eden/fs/prjfs/Enumerator.h"
@@ -120,6 +124,16 @@ class PrjfsChannelInner {
       PCWSTR destinationFileName,
       PRJ_NOTIFICATION_PARAMETERS* notificationParameters);
 
+  /**
+   * Returns a future that completes once all the notifications received
+   * before this call have been applied to the inode tree.
+   *
+   * Notifications are applied asynchronously, operations that need to observe
+   * every change made to the working copy (status, checkout) must wait on this
+   * first.
+   */
+  folly::Future<folly::Unit> waitForPendingNotifications();
+
   /**
    * Notification sent when a file or directory has been created.
    */
@@ -195,6 +209,15 @@ class PrjfsChannelInner {
     mountChannel_ = channel;
   }
 
+  /**
+   * Maximum number of files whose content may be prefetched on behalf of a
+   * process per minute after it listed a directory, 0 disables the
+   * prefetching.
+   */
+  void setPrefetchBudgetPerProcess(uint64_t budget) {
+    prefetchBudgetPerProcess_ = budget;
+  }
+
   void sendSuccess(
       int32_t commandId,
       PRJ_COMPLETE_COMMAND_EXTENDED_PARAMETERS* FOLLY_NULLABLE extra);
@@ -229,6 +252,97 @@ class PrjfsChannelInner {
     XDCHECK(erasedCount == 1);
   }
 
+  /**
+   * Prefetch the content of the files of a directory that was just listed,
+   * within the prefetch budget of the process that listed it.
+   */
+  void prefetchChildren(
+      RelativePath path,
+      std::shared_ptr<PrjfsRequestContext> context);
+
+  struct PrefetchReservation {
+    // Window the files were reserved in.
+    uint64_t window;
+    size_t count;
+  };
+
+  /**
+   * Reserve up to count files of the prefetch budget of the process in the
+   * current window.
+   */
+  PrefetchReservation reservePrefetchBudget(pid_t pid, size_t count);
+
+  /**
+   * Give back count files of the reservation to the prefetch budget of the
+   * process. Does nothing once the window of the reservation has ended.
+   */
+  void releasePrefetchBudget(
+      pid_t pid,
+      const PrefetchReservation& reservation,
+      size_t count);
+
+  struct QueuedNotification {
+    // Directory whose entries are changed by the notification. Notifications
+    // for the same directory are applied in the order they were received.
+    RelativePath parent;
+
+    // Directory and rename notifications may affect more than one directory,
+    // they are applied once all the notifications received before them have
+    // completed, and before any of the subsequent ones are started.
+    bool isBarrier;
+
+    // Keeps the channel alive until the notification has been applied.
+    std::shared_ptr<PrjfsRequestContext> context;
+
+    folly::Function<folly::Future<folly::Unit>()> apply;
+  };
+
+  struct NotificationQueue {
+    std::deque<QueuedNotification> pending;
+
+    // Whether a thread is applying the pending notifications. Only one batch
+    // of notifications is applied at a time to preserve their ordering, the
+    // notifications received meanwhile form the next batch.
+    bool isDraining{false};
+
+    uint64_t numEnqueued{0};
+    uint64_t numApplied{0};
+
+    // Callers of waitForPendingNotifications, along with the value of
+    // numApplied that they are waiting for.
+    std::deque<std::pair<uint64_t, folly::Promise<folly::Unit>>> flushWaiters;
+  };
+
+  /**
+   * Queue a notification. It is applied after the notifications received
+   * before it for the same directory, and concurrently with the ones for
+   * other directories.
+   */
+  void enqueueNotification(QueuedNotification notification);
+
+  /**
+   * Apply the queued notifications until the queue is empty, taking every
+   * pending notification at once.
+   */
+  void drainNotifications();
+
+  /**
+   * Called once a batch of numApplied notifications has been applied.
+   */
+  void notificationsApplied(size_t numApplied);
+
+  /**
+   * Apply a batch of notifications. Between barriers, the notifications are
+   * grouped by parent directory: the groups are applied concurrently while the
+   * notifications of a group are applied in order.
+   *
+   * This only orders the notifications: each of them is still applied by
+   * the dispatcher on its own, no lookup is shared between the notifications
+   * of a group.
+   */
+  folly::Future<folly::Unit> applyNotifications(
+      std::vector<QueuedNotification> batch);
+
   // Internal ProjectedFS channel used to communicate with ProjectedFS.
   PRJ_NAMESPACE_VIRTUALIZATION_CONTEXT mountChannel_{nullptr};
 
@@ -245,6 +359,22 @@ class PrjfsChannelInner {
   // Set of currently active directory enumerations.
   folly::Synchronized<folly::F14FastMap<Guid, std::shared_ptr<Enumerator>>>
       enumSessions_;
+
+  folly::Synchronized<NotificationQueue> notificationQueue_;
+
+  uint64_t prefetchBudgetPerProcess_{0};
+
+  struct PrefetchBudgets {
+    uint64_t window{0};
+    std::chrono::steady_clock::time_point windowStart;
+
+    // Number of files prefetched on behalf of each process during the
+    // current window. Cleared when the window ends, which also drops the
+    // processes that have exited since.
+    folly::F14FastMap<pid_t, uint64_t> prefetched;
+  };
+
+  folly::Synchronized<PrefetchBudgets> prefetchBudgets_;
 };
 
 class PrjfsChannel {
@@ -265,7 +395,10 @@ class PrjfsChannel {
 
   ~PrjfsChannel();
 
-  void start(bool readOnly, bool useNegativePathCaching);
+  void start(
+      bool readOnly,
+      bool useNegativePathCaching,
+      uint64_t prefetchBudgetPerProcess);
 
   /**
    * Stop the PrjfsChannel.
@@ -302,6 +435,12 @@ class PrjfsChannel {
 
   void flushNegativePathCache();
 
+  /**
+   * Wait for all the notifications received so far to be applied to the inode
+   * tree, see PrjfsChannelInner::waitForPendingNotifications.
+   */
+  folly::Future<folly::Unit> waitForPendingNotifications();
+
   ProcessAccessLog& getProcessAccessLog() {
     return processAccessLog_;
   }
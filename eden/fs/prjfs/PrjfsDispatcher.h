@@ -78,6 +78,19 @@ class PrjfsDispatcher {
       RelativePath path,
       ObjectFetchContext& context) = 0;
 
+  /**
+   * Start fetching the content of up to maxBlobs files of the directory that
+   * aren't materialized: once a directory has been listed, its files are
+   * likely to be read soon after. The fetches are done in the background at
+   * a low priority.
+   *
+   * Returns the number of files whose content is being prefetched.
+   */
+  virtual folly::Future<size_t> prefetchChildren(
+      RelativePath path,
+      size_t maxBlobs,
+      ObjectFetchContext& context) = 0;
+
   /**
    * Notification sent when a file was created
    */
@@ -15,7 +15,7 @@
 
 namespace facebook::eden {
 
-class PrjfsRequestContext : public RequestContext {
+class PrjfsRequestContext final : public RequestContext {
  public:
   PrjfsRequestContext(const PrjfsRequestContext&) = delete;
   PrjfsRequestContext& operator=(const PrjfsRequestContext&) = delete;
@@ -25,14 +25,11 @@ class PrjfsRequestContext : public RequestContext {
   explicit PrjfsRequestContext(
       detail::RcuLockedPtr channel,
       const PRJ_CALLBACK_DATA& prjfsData)
-      : RequestContext(channel->getProcessAccessLog()),
+      : RequestContext(
+            channel->getProcessAccessLog(),
+            static_cast<pid_t>(prjfsData.TriggeringProcessId)),
         channel_(std::move(channel)),
-        commandId_(prjfsData.CommandId),
-        clientPid_(prjfsData.TriggeringProcessId) {}
-
-  std::optional<pid_t> getClientPid() const override {
-    return clientPid_;
-  }
+        commandId_(prjfsData.CommandId) {}
 
   folly::Future<folly::Unit> catchErrors(
       folly::Future<folly::Unit>&& fut,
@@ -77,7 +74,6 @@ class PrjfsRequestContext : public RequestContext {
 
   detail::RcuLockedPtr channel_;
   int32_t commandId_;
-  pid_t clientPid_;
 };
 
 } // namespace facebook::eden
@@ -7,15 +7,60 @@
 
 #include "eden/fs/service/EdenCPUThreadPool.h"
 
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
+#include <folly/logging/xlog.h>
 #include <gflags/gflags.h>
+#include "eden/fs/telemetry/EdenStats.h"
+#include "eden/fs/utils/ThreadPlacement.h"
+#include "eden/fs/utils/WorkStealingTaskQueue.h"
 
 DEFINE_int32(num_eden_threads, 12, "the number of eden CPU worker threads");
+DEFINE_string(
+    eden_thread_placement,
+    "none",
+    "where the eden CPU worker threads run: none, spread, pack or per-node");
 
 namespace facebook {
 namespace eden {
 
+namespace {
+ThreadPlacement getThreadPlacement() {
+  auto placement = parseThreadPlacement(FLAGS_eden_thread_placement);
+  if (placement.hasError()) {
+    XLOG(ERR) << "ignoring --eden_thread_placement: " << placement.error();
+    return ThreadPlacement::None;
+  }
+  return placement.value();
+}
+
+std::unique_ptr<folly::CPUThreadPoolExecutor> makeExecutor() {
+  // The stats are exported by name, so they don't need to be the ones of the
+  // ServerState, which is created after the thread pool.
+  auto stats = std::make_shared<EdenStats>();
+  auto observer = [stats](
+                      WorkPriority priority,
+                      std::chrono::steady_clock::duration latency) {
+    auto& executorStats = stats->getExecutorStatsForCurrentThread();
+    auto& stat = priority == WorkPriority::Interactive
+        ? executorStats.interactiveQueueLatency
+        : executorStats.backgroundQueueLatency;
+    stat.addValue(
+        std::chrono::duration_cast<std::chrono::microseconds>(latency)
+            .count());
+  };
+  return std::make_unique<folly::CPUThreadPoolExecutor>(
+      FLAGS_num_eden_threads,
+      std::make_unique<WorkStealingTaskQueue>(
+          FLAGS_num_eden_threads, std::move(observer)),
+      std::make_shared<PlacedThreadFactory>(
+          std::make_shared<folly::NamedThreadFactory>("EdenCPUThread"),
+          getThreadPlacement()));
+}
+} // namespace
+
 EdenCPUThreadPool::EdenCPUThreadPool()
-    : UnboundedQueueExecutor(FLAGS_num_eden_threads, "EdenCPUThread") {}
+    : UnboundedQueueExecutor(makeExecutor()) {}
 
 } // namespace eden
 } // namespace facebook
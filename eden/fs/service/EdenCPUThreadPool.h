@@ -13,6 +13,9 @@ namespace facebook {
 namespace eden {
 
 // The Eden CPU thread pool is intended for miscellaneous background tasks.
+//
+// Its threads steal work from each other, and run the work queued under a
+// BackgroundWorkGuard, such as checkouts, after the interactive work.
 class EdenCPUThreadPool : public UnboundedQueueExecutor {
  public:
   explicit EdenCPUThreadPool();
@@ -27,6 +27,7 @@
 #include "eden/fs/eden-config.h"
 #include "eden/fs/fuse/privhelper/PrivHelper.h"
 #include "eden/fs/fuse/privhelper/PrivHelperImpl.h"
+#include "eden/fs/inodes/WorkloadRecorder.h"
 #include "eden/fs/service/EdenInit.h"
 #include "eden/fs/service/EdenServer.h"
 #include "eden/fs/service/EdenServiceHandler.h" // for kServiceName
@@ -147,8 +148,14 @@ MetadataImporterFactory DefaultEdenMain::getMetadataImporterFactory() {
 }
 
 ActivityRecorderFactory DefaultEdenMain::getActivityRecorderFactory() {
-  return [](std::shared_ptr<const EdenMount>) {
+  return [](std::shared_ptr<EdenMount> edenMount)
+             -> std::unique_ptr<IActivityRecorder> {
+#ifndef _WIN32
+    return std::make_unique<WorkloadRecorder>(std::move(edenMount));
+#else
+    (void)edenMount;
     return std::make_unique<NullActivityRecorder>();
+#endif
   };
 }
 
@@ -10,10 +10,15 @@
 #include <cpptoml.h>
 
 #include <sys/stat.h>
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <deque>
 #include <fstream>
 #include <functional>
+#include <limits>
 #include <memory>
+#include <numeric>
 #include <sstream>
 
 #include <fb303/ServiceData.h>
@@ -23,6 +28,8 @@
 #include <folly/SocketAddress.h>
 #include <folly/String.h>
 #include <folly/chrono/Conv.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/io/async/AsyncSignalHandler.h>
 #include <folly/logging/xlog.h>
 #include <folly/stop_watch.h>
@@ -43,6 +50,7 @@
 #include "eden/fs/service/EdenCPUThreadPool.h"
 #include "eden/fs/service/EdenServiceHandler.h"
 #include "eden/fs/service/StartupLogger.h"
+#include "eden/fs/service/ThriftPermissionChecker.h"
 #include "eden/fs/service/gen-cpp2/eden_types.h"
 #include "eden/fs/store/BackingStoreLogger.h"
 #include "eden/fs/store/BlobCache.h"
@@ -50,9 +58,12 @@
 #include "eden/fs/store/LocalStore.h"
 #include "eden/fs/store/MemoryLocalStore.h"
 #include "eden/fs/store/ObjectStore.h"
+#include "eden/fs/store/PackLocalStore.h"
 #include "eden/fs/store/RocksDbLocalStore.h"
 #include "eden/fs/store/SqliteLocalStore.h"
+#include "eden/fs/store/TieredLocalStore.h"
 #include "eden/fs/store/TreeCache.h"
+#include "eden/fs/store/WriteBackLocalStore.h"
 #include "eden/fs/store/hg/HgBackingStore.h"
 #include "eden/fs/store/hg/HgQueuedBackingStore.h"
 #include "eden/fs/store/hg/MetadataImporter.h"
@@ -104,7 +115,7 @@ DEFINE_bool(
     "Enable the fault injection framework.");
 
 #define DEFAULT_STORAGE_ENGINE "rocksdb"
-#define SUPPORTED_STORAGE_ENGINES "rocksdb|sqlite|memory"
+#define SUPPORTED_STORAGE_ENGINES "rocksdb|sqlite|memory|pack"
 
 DEFINE_string(
     local_storage_engine_unsafe,
@@ -147,6 +158,21 @@ DEFINE_uint64(
     minimumBlobCacheEntryCount,
     16,
     "The minimum number of recent blobs to keep cached. Trumps maximumBlobCacheSize");
+DEFINE_uint64(
+    blobCacheShards,
+    1,
+    "Number of independently locked shards the blob cache is split into, "
+    "dividing maximumBlobCacheSize and minimumBlobCacheEntryCount evenly");
+DEFINE_bool(
+    blobCacheTinyLFU,
+    false,
+    "Only admit blobs into the blob cache if they are used more often than "
+    "the blobs they would evict, so that scans don't flush the cache");
+DEFINE_uint64(
+    compressedBlobCacheSize,
+    0,
+    "How many bytes worth of compressed blobs evicted from the blob cache to "
+    "keep in memory, or 0 to not keep them");
 
 using apache::thrift::ThriftServer;
 using apache::thrift::ThriftServerAsyncProcessorFactory;
@@ -167,6 +193,7 @@ using namespace facebook::eden;
 
 constexpr StringPiece kRocksDBPath{"storage/rocks-db"};
 constexpr StringPiece kSqlitePath{"storage/sqlite.db"};
+constexpr StringPiece kPackPath{"storage/packs"};
 constexpr StringPiece kHgStorePrefix{"store.hg"};
 #ifndef _WIN32
 constexpr StringPiece kFuseRequestPrefix{"fuse"};
@@ -179,6 +206,82 @@ std::optional<std::string> getUnixDomainSocketPath(
                                         : std::nullopt;
 }
 
+/**
+ * Runs the queued functions in order, with at most `limit` of the futures
+ * they return pending at once.
+ */
+class BoundedFutureQueue
+    : public std::enable_shared_from_this<BoundedFutureQueue> {
+ public:
+  explicit BoundedFutureQueue(size_t limit)
+      : limit_{limit == 0 ? std::numeric_limits<size_t>::max() : limit} {}
+
+  /**
+   * Returns a future completed with the one of the function once it ran.
+   */
+  Future<Unit> add(folly::Function<Future<Unit>()> func) {
+    auto state = state_.lock();
+    state->queue.push_back(Entry{std::move(func), folly::Promise<Unit>{}});
+    return state->queue.back().promise.getFuture();
+  }
+
+  /**
+   * Start running the queued functions.
+   */
+  void run() {
+    while (startNext()) {
+    }
+  }
+
+ private:
+  struct Entry {
+    folly::Function<Future<Unit>()> func;
+    folly::Promise<Unit> promise;
+  };
+
+  struct State {
+    std::deque<Entry> queue;
+    size_t running{0};
+  };
+
+  bool startNext() {
+    Entry entry;
+    {
+      auto state = state_.lock();
+      if (state->queue.empty() || state->running >= limit_) {
+        return false;
+      }
+      entry = std::move(state->queue.front());
+      state->queue.pop_front();
+      ++state->running;
+    }
+    folly::makeFutureWith(std::move(entry.func))
+        .thenTry([self = shared_from_this(),
+                  promise = std::move(entry.promise)](
+                     folly::Try<Unit>&& result) mutable {
+          promise.setTry(std::move(result));
+          --self->state_.lock()->running;
+          self->startNext();
+        });
+    return true;
+  }
+
+  const size_t limit_;
+  folly::Synchronized<State, std::mutex> state_;
+};
+
+/**
+ * When the checkout was last used, approximated by the last change to its
+ * state directory, which is rewritten by checkouts and journal compactions.
+ */
+time_t getCheckoutLastUseTime(AbsolutePathPiece clientDirectory) {
+  struct stat st;
+  if (::stat(clientDirectory.stringPiece().str().c_str(), &st) != 0) {
+    return 0;
+  }
+  return st.st_mtime;
+}
+
 std::string getCounterNameForImportMetric(
     RequestMetricsScope::RequestStage stage,
     RequestMetricsScope::RequestMetric metric,
@@ -203,6 +306,27 @@ std::string getCounterNameForImportMetric(
       RequestMetricsScope::stringOfRequestMetric(metric));
 }
 
+constexpr std::array<
+    std::pair<HgQueuedBackingStore::FetcherMetric, StringPiece>,
+    3>
+    kFetcherMetrics{{
+        {HgQueuedBackingStore::FetcherMetric::ACTIVE, "active"},
+        {HgQueuedBackingStore::FetcherMetric::THREADS, "threads"},
+        {HgQueuedBackingStore::FetcherMetric::MAX_THREADS, "max_threads"},
+    }};
+
+std::string getCounterNameForFetcherMetric(
+    HgBackingStore::HgImportObject object,
+    StringPiece metric) {
+  // base prefix . fetchers . object . metric
+  return folly::to<std::string>(
+      kHgStorePrefix,
+      ".fetchers.",
+      HgBackingStore::stringOfHgImportObject(object),
+      ".",
+      metric);
+}
+
 #ifndef _WIN32
 std::string getCounterNameForFuseRequests(
     RequestMetricsScope::RequestStage stage,
@@ -286,6 +410,11 @@ class EdenServer::ThriftServerEventHandler
     runningPromise_.setValue();
   }
 
+  void connectionDestroyed(
+      apache::thrift::server::TConnectionContext* ctx) override {
+    edenServer_->getHandler()->getPermissionChecker()->connectionDestroyed(ctx);
+  }
+
   void signalReceived(int sig) noexcept override {
     // Stop the server.
     // Unregister for this signal first, so that we will be terminated
@@ -312,6 +441,8 @@ class EdenServer::ThriftServerEventHandler
 };
 
 static constexpr folly::StringPiece kBlobCacheMemory{"blob_cache.memory"};
+static constexpr folly::StringPiece kCompressedBlobCacheMemory{
+    "blob_cache.compressed_memory"};
 
 EdenServer::EdenServer(
     std::vector<std::string> originalCommandLine,
@@ -329,7 +460,11 @@ EdenServer::EdenServer(
       activityRecorderFactory_(std::move(activityRecorderFactory)),
       blobCache_{BlobCache::create(
           FLAGS_maximumBlobCacheSize,
-          FLAGS_minimumBlobCacheEntryCount)},
+          FLAGS_minimumBlobCacheEntryCount,
+          FLAGS_blobCacheShards,
+          FLAGS_blobCacheTinyLFU ? ObjectCachePolicy::TinyLFU
+                                 : ObjectCachePolicy::LRU,
+          FLAGS_compressedBlobCacheSize)},
       // Store a pointer to the EventBase that will be used to drive
       // the main thread.  The runServer() code will end up driving this
       // EventBase.
@@ -339,7 +474,10 @@ EdenServer::EdenServer(
           std::move(privHelper),
           std::make_shared<EdenCPUThreadPool>(),
           std::make_shared<UnixClock>(),
-          std::make_shared<ProcessNameCache>(),
+          std::make_shared<ProcessNameCache>(
+              std::chrono::minutes{5},
+              edenConfig->processNameCacheSize.getValue(),
+              edenConfig->processNameResolutionsPerSecond.getValue()),
           makeDefaultStructuredLogger(*edenConfig, std::move(sessionInfo)),
           std::move(hiveLogger),
           edenConfig,
@@ -348,14 +486,21 @@ EdenServer::EdenServer(
               ? std::make_shared<NfsServer>(
                     mainEventBase_,
                     edenConfig->numNfsThreads.getValue(),
-                    edenConfig->maxNfsInflightRequests.getValue())
+                    edenConfig->maxNfsInflightRequests.getValue(),
+                    edenConfig->numNfsIoThreads.getValue(),
+                    edenConfig->maxNfsInflightMetadataRequests.getValue(),
+                    edenConfig->maxNfsInflightDataRequests.getValue(),
+                    edenConfig->nfsThreadPlacement.getValue())
               :
 #endif
               nullptr,
           FLAGS_enable_fault_injection)},
       version_{std::move(version)},
       progressManager_{std::make_unique<
-          folly::Synchronized<EdenServer::ProgressManager>>()} {
+          folly::Synchronized<EdenServer::ProgressManager>>()},
+      maintenanceExecutor_{std::make_unique<folly::CPUThreadPoolExecutor>(
+          1,
+          std::make_shared<folly::NamedThreadFactory>("EdenMaintenance"))} {
 
   treeCache_ = TreeCache::create(shared_ptr<ReloadableConfig>(
       serverState_, &serverState_->getReloadableConfig()));
@@ -363,6 +508,9 @@ EdenServer::EdenServer(
   counters->registerCallback(kBlobCacheMemory, [this] {
     return this->getBlobCache()->getStats().totalSizeInBytes;
   });
+  counters->registerCallback(kCompressedBlobCacheMemory, [this] {
+    return this->getBlobCache()->getCompressedStats().totalSizeInBytes;
+  });
 
   for (auto stage : RequestMetricsScope::requestStages) {
     for (auto metric : RequestMetricsScope::requestMetrics) {
@@ -395,11 +543,29 @@ EdenServer::EdenServer(
       });
     }
   }
+
+  for (auto object : HgBackingStore::hgImportObjects) {
+    for (auto [metric, metricName] : kFetcherMetrics) {
+      counters->registerCallback(
+          getCounterNameForFetcherMetric(object, metricName),
+          [this, object, metric = metric] {
+            auto individualCounters = this->collectHgQueuedBackingStoreCounters(
+                [object, metric](const HgQueuedBackingStore& store) {
+                  return store.getFetcherMetric(object, metric);
+                });
+            return std::accumulate(
+                individualCounters.begin(),
+                individualCounters.end(),
+                size_t{0});
+          });
+    }
+  }
 }
 
 EdenServer::~EdenServer() {
   auto counters = fb303::ServiceData::get()->getDynamicCounters();
   counters->unregisterCallback(kBlobCacheMemory);
+  counters->unregisterCallback(kCompressedBlobCacheMemory);
 
   for (auto stage : RequestMetricsScope::requestStages) {
     for (auto metric : RequestMetricsScope::requestMetrics) {
@@ -411,6 +577,13 @@ EdenServer::~EdenServer() {
       counters->unregisterCallback(summaryCounterName);
     }
   }
+
+  for (auto object : HgBackingStore::hgImportObjects) {
+    for (const auto& fetcherMetric : kFetcherMetrics) {
+      counters->unregisterCallback(
+          getCounterNameForFetcherMetric(object, fetcherMetric.second));
+    }
+  }
 }
 
 namespace cursor_helper {
@@ -634,11 +807,39 @@ void EdenServer::startPeriodicTasks() {
   if (FLAGS_unload_interval_minutes > 0) {
     scheduleInodeUnload(std::chrono::minutes(FLAGS_start_delay_minutes));
   }
+
+  memoryPressureUnloadAge_ = std::chrono::minutes(FLAGS_unload_age_minutes);
 #endif
 
   backingStoreTask_.updateInterval(1min);
 }
 
+folly::Executor* EdenServer::getMaintenanceExecutor() const {
+  return maintenanceExecutor_.get();
+}
+
+bool EdenServer::isFilesystemBusy() const {
+#ifndef _WIN32
+  auto threshold =
+      serverState_->getEdenConfig(ConfigReloadBehavior::NoReload)
+          ->maintenanceBusyRequests.getValue();
+  if (threshold == 0) {
+    return false;
+  }
+  // NFS does not track its live requests yet, so only FUSE mounts count.
+  size_t liveRequests = 0;
+  for (const auto& mount : getMountPoints()) {
+    if (auto* channel = mount->getFuseChannel()) {
+      liveRequests +=
+          channel->getRequestMetric(RequestMetricsScope::RequestMetric::COUNT);
+    }
+  }
+  return liveRequests >= threshold;
+#else
+  return false;
+#endif
+}
+
 void EdenServer::updatePeriodicTaskIntervals(const EdenConfig& config) {
   // Update all periodic tasks whose interval is
   // controlled by EdenConfig settings.
@@ -658,10 +859,21 @@ void EdenServer::updatePeriodicTaskIntervals(const EdenConfig& config) {
   localStoreTask_.updateInterval(
       std::chrono::duration_cast<std::chrono::milliseconds>(
           config.localStoreManagementInterval.getValue()));
+
+#ifndef _WIN32
+  memoryPressureUnloadTask_.updateInterval(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          config.inodeUnloadInterval.getValue()));
+
+  inodeMetadataFlushTask_.updateInterval(
+      std::chrono::duration_cast<std::chrono::milliseconds>(
+          config.inodeMetadataFlushInterval.getValue()));
+#endif
 }
 
 #ifndef _WIN32
-void EdenServer::unloadInodes() {
+size_t EdenServer::unloadInodesLastAccessedBefore(
+    std::chrono::system_clock::time_point cutoff) {
   struct Root {
     AbsolutePath mountName;
     TreeInodePtr rootInode;
@@ -675,12 +887,11 @@ void EdenServer::unloadInodes() {
     }
   }
 
+  size_t totalUnloaded = 0;
   if (!roots.empty()) {
     auto serviceData = fb303::ServiceData::get();
 
-    uint64_t totalUnloaded = serviceData->getCounter(kPeriodicUnloadCounterKey);
-    auto cutoff = std::chrono::system_clock::now() -
-        std::chrono::minutes(FLAGS_unload_age_minutes);
+    uint64_t counter = serviceData->getCounter(kPeriodicUnloadCounterKey);
     auto cutoff_ts = folly::to<timespec>(cutoff);
     for (auto& [name, rootInode] : roots) {
       auto unloaded = rootInode->unloadChildrenLastAccessedBefore(cutoff_ts);
@@ -690,12 +901,66 @@ void EdenServer::unloadInodes() {
       }
       totalUnloaded += unloaded;
     }
-    serviceData->setCounter(kPeriodicUnloadCounterKey, totalUnloaded);
+    serviceData->setCounter(kPeriodicUnloadCounterKey, counter + totalUnloaded);
   }
+  return totalUnloaded;
+}
+
+void EdenServer::unloadInodes() {
+  unloadInodesLastAccessedBefore(
+      std::chrono::system_clock::now() -
+      std::chrono::minutes(FLAGS_unload_age_minutes));
 
   scheduleInodeUnload(std::chrono::minutes(FLAGS_unload_interval_minutes));
 }
 
+void EdenServer::unloadInodesUnderMemoryPressure() {
+  auto config = serverState_->getReloadableConfig().getEdenConfig(
+      ConfigReloadBehavior::NoReload);
+  auto target = config->inodeUnloadMemoryTarget.getValue();
+  auto minAge = std::chrono::duration_cast<std::chrono::system_clock::duration>(
+      config->inodeUnloadMinAge.getValue());
+  auto maxAge = std::chrono::duration_cast<std::chrono::system_clock::duration>(
+      std::chrono::minutes(FLAGS_unload_age_minutes));
+  maxAge = std::max(maxAge, minAge);
+  if (target == 0) {
+    memoryPressureUnloadAge_ = maxAge;
+    return;
+  }
+
+  auto memoryStats = proc_util::readMemoryStats();
+  if (!memoryStats) {
+    return;
+  }
+
+  if (memoryStats->resident <= target) {
+    memoryPressureUnloadAge_ = std::min(maxAge, memoryPressureUnloadAge_ * 2);
+    return;
+  }
+
+  auto age = std::clamp(memoryPressureUnloadAge_, minAge, maxAge);
+  auto unloaded =
+      unloadInodesLastAccessedBefore(std::chrono::system_clock::now() - age);
+  XLOG(DBG2) << "resident memory of " << memoryStats->resident
+             << " bytes is above the target of " << target
+             << " bytes, unloaded " << unloaded
+             << " inodes last accessed more than "
+             << std::chrono::duration_cast<std::chrono::seconds>(age).count()
+             << " seconds ago";
+  memoryPressureUnloadAge_ = std::max(minAge, age / 2);
+}
+
+void EdenServer::flushInodeMetadata() {
+  for (const auto& mount : getMountPoints()) {
+    try {
+      mount->getInodeMetadataTable()->flush();
+    } catch (const std::exception& ex) {
+      XLOG(ERR) << "failed to flush the inode metadata of "
+                << mount->getPath() << ": " << folly::exceptionStr(ex);
+    }
+  }
+}
+
 void EdenServer::scheduleInodeUnload(std::chrono::milliseconds timeout) {
   mainEventBase_->timer().scheduleTimeoutFn(
       [this] {
@@ -812,11 +1077,14 @@ Future<Unit> EdenServer::prepareImpl(
     logger->log(
         "Requesting existing edenfs process to gracefully "
         "transfer its mount points...");
+    folly::stop_watch<> receiveWatch;
     takeoverData = takeoverMounts(takeoverPath);
     logger->log(
         "Received takeover information for ",
         takeoverData.mountPoints.size(),
-        " mount points");
+        " mount points in ",
+        std::chrono::duration<double>{receiveWatch.elapsed()}.count(),
+        "s");
 
     // Take over the eden lock file and the thrift server socket.
     edenDir_.takeoverLock(std::move(takeoverData.lockFile));
@@ -916,7 +1184,8 @@ bool EdenServer::openStorageEngine(
 
   if (storageEngine == "memory") {
     logger.log("Creating new memory store.");
-    localStore_ = make_shared<MemoryLocalStore>();
+    localStore_ =
+        make_shared<MemoryLocalStore>(*serverState_->getEdenConfig());
   } else if (storageEngine == "sqlite") {
     const auto path = edenDir_.getPath() + RelativePathPiece{kSqlitePath};
     const auto parentDir = path.dirname();
@@ -936,7 +1205,14 @@ bool EdenServer::openStorageEngine(
     localStore_ = make_shared<RocksDbLocalStore>(
         rocksPath,
         serverState_->getStructuredLogger(),
-        &serverState_->getFaultInjector());
+        &serverState_->getFaultInjector(),
+        *serverState_->getEdenConfig());
+    if (auto writeBackLimit =
+            serverState_->getEdenConfig()->localStoreWriteBackLimit.getValue();
+        writeBackLimit > 0) {
+      localStore_ = make_shared<WriteBackLocalStore>(
+          std::move(localStore_), writeBackLimit);
+    }
     localStore_->enableBlobCaching.store(
         serverState_->getEdenConfig()->enableBlobCaching.getValue(),
         std::memory_order_relaxed);
@@ -944,11 +1220,31 @@ bool EdenServer::openStorageEngine(
         "Opened RocksDB store in ",
         watch.elapsed().count() / 1000.0,
         " seconds.");
+  } else if (storageEngine == "pack") {
+    logger.log("Opening local pack store...");
+    folly::stop_watch<std::chrono::milliseconds> watch;
+    const auto packPath = edenDir_.getPath() + RelativePathPiece{kPackPath};
+    ensureDirectoryExists(packPath);
+    localStore_ = make_shared<PackLocalStore>(
+        packPath, *serverState_->getEdenConfig());
+    localStore_->enableBlobCaching.store(
+        serverState_->getEdenConfig()->enableBlobCaching.getValue(),
+        std::memory_order_relaxed);
+    logger.log(
+        "Opened pack store in ",
+        watch.elapsed().count() / 1000.0,
+        " seconds.");
   } else {
     throw std::runtime_error(
         folly::to<string>("invalid storage engine: ", storageEngine));
   }
 
+  if (storageEngine != "memory" &&
+      serverState_->getEdenConfig()->localStoreL1CacheSize.getValue() > 0) {
+    localStore_ = make_shared<TieredLocalStore>(
+        std::move(localStore_), *serverState_->getEdenConfig());
+  }
+
   return configUpdated;
 }
 
@@ -1016,52 +1312,91 @@ std::vector<Future<Unit>> EdenServer::prepareMounts(
     logger->log("No mount points currently configured.");
     return mountFutures;
   }
-  logger->log("Remounting ", dirs.size(), " mount points...");
-
+  auto maxConcurrentMounts =
+      serverState_->getEdenConfig()->maxConcurrentStartupMounts.getValue();
+  logger->log(
+      "Remounting ",
+      dirs.size(),
+      " mount points, most recently used first...");
+
+  // Initializing a mount reads its overlay and maybe checks it, so starting
+  // them all at once makes every mount wait for all the others. They are
+  // started a few at a time instead, so that the mounts used last, which are
+  // the likeliest to be used first, are ready as soon as possible.
+  struct PendingMount {
+    std::string mountPath;
+    AbsolutePath clientDirectory;
+    time_t lastUseTime;
+  };
+  std::vector<PendingMount> pendingMounts;
   for (const auto& client : dirs.items()) {
-    auto mountFuture = makeFutureWith([&] {
-      MountInfo mountInfo;
-      *mountInfo.mountPoint_ref() = client.first.c_str();
-      auto edenClientPath =
-          edenDir_.getCheckoutStateDir(client.second.asString());
-      *mountInfo.edenClientPath_ref() = edenClientPath.stringPiece().str();
-      auto initialConfig = CheckoutConfig::loadFromClientDirectory(
-          AbsolutePathPiece{*mountInfo.mountPoint_ref()},
-          AbsolutePathPiece{*mountInfo.edenClientPath_ref()});
-      auto progressIndex = progressManager_->wlock()->registerEntry(
-          client.first.asString(), initialConfig->getOverlayPath().c_str());
-
-      return mount(
-                 std::move(initialConfig),
-                 false,
-                 [this, logger, progressIndex](auto percent) {
-                   progressManager_->wlock()->manageProgress(
-                       logger, progressIndex, percent);
-                 })
-          .thenTry(
-              [this,
-               logger,
-               mountPath = client.first.asString(),
-               progressIndex](folly::Try<std::shared_ptr<EdenMount>>&& result) {
-                if (result.hasValue()) {
-                  auto wl = progressManager_->wlock();
-                  wl->finishProgress(progressIndex);
-                  wl->printProgresses(logger);
-                  return makeFuture();
-                } else {
-                  incrementStartupMountFailures();
-                  logger->warn(
-                      "Failed to remount ",
-                      mountPath,
-                      ": ",
-                      result.exception().what());
-                  return makeFuture<Unit>(std::move(result).exception());
-                }
-              });
-    });
+    auto clientDirectory =
+        edenDir_.getCheckoutStateDir(client.second.asString());
+    auto lastUseTime = getCheckoutLastUseTime(clientDirectory);
+    pendingMounts.push_back(PendingMount{
+        client.first.asString(), std::move(clientDirectory), lastUseTime});
+  }
+  std::stable_sort(
+      pendingMounts.begin(),
+      pendingMounts.end(),
+      [](const PendingMount& a, const PendingMount& b) {
+        return a.lastUseTime > b.lastUseTime;
+      });
+  {
+    auto pending = pendingStartupMounts_.wlock();
+    for (const auto& pendingMount : pendingMounts) {
+      pending->push_back(pendingMount.mountPath);
+    }
+  }
+
+  auto queue = std::make_shared<BoundedFutureQueue>(maxConcurrentMounts);
+  for (auto& pendingMount : pendingMounts) {
+    auto mountFuture = queue->add(
+        [this,
+         logger,
+         mountPath = std::move(pendingMount.mountPath),
+         clientDirectory = std::move(pendingMount.clientDirectory)]() {
+          {
+            auto pending = pendingStartupMounts_.wlock();
+            pending->erase(
+                std::remove(pending->begin(), pending->end(), mountPath),
+                pending->end());
+          }
+          auto initialConfig = CheckoutConfig::loadFromClientDirectory(
+              AbsolutePathPiece{mountPath}, clientDirectory);
+          auto progressIndex = progressManager_->wlock()->registerEntry(
+              mountPath, initialConfig->getOverlayPath().c_str());
+
+          return mount(
+                     std::move(initialConfig),
+                     false,
+                     [this, logger, progressIndex](auto percent) {
+                       progressManager_->wlock()->manageProgress(
+                           logger, progressIndex, percent);
+                     })
+              .thenTry(
+                  [this, logger, mountPath, progressIndex](
+                      folly::Try<std::shared_ptr<EdenMount>>&& result) {
+                    if (result.hasValue()) {
+                      auto wl = progressManager_->wlock();
+                      wl->finishProgress(progressIndex);
+                      wl->printProgresses(logger);
+                      return makeFuture();
+                    } else {
+                      incrementStartupMountFailures();
+                      logger->warn(
+                          "Failed to remount ",
+                          mountPath,
+                          ": ",
+                          result.exception().what());
+                      return makeFuture<Unit>(std::move(result).exception());
+                    }
+                  });
+        });
 
     mountFutures.push_back(std::move(mountFuture));
   }
+  queue->run();
   return mountFutures;
 }
 
@@ -1225,6 +1560,9 @@ void EdenServer::registerStats(std::shared_ptr<EdenMount> edenMount) {
         return stats ? stats->maxFilesAccumulated : 0;
       });
 #ifndef _WIN32
+  counters->registerCallback(
+      edenMount->getCounterName(CounterName::OVERLAY_GC_QUEUE_DEPTH),
+      [edenMount] { return edenMount->getOverlay()->getGCQueueDepth(); });
   if (auto* channel = edenMount->getFuseChannel()) {
     for (auto metric : RequestMetricsScope::requestMetrics) {
       counters->registerCallback(
@@ -1234,6 +1572,14 @@ void EdenServer::registerStats(std::shared_ptr<EdenMount> edenMount) {
             return channel->getRequestMetric(metric);
           });
     }
+    counters->registerCallback(
+        edenMount->getCounterName(CounterName::FUSE_INVALIDATIONS_SENT),
+        [edenMount, channel] { return channel->getInvalidationCounts().sent; });
+    counters->registerCallback(
+        edenMount->getCounterName(CounterName::FUSE_INVALIDATIONS_COALESCED),
+        [edenMount, channel] {
+          return channel->getInvalidationCounts().coalesced;
+        });
   } else if (edenMount->getNfsdChannel()) {
     // TODO(xavierd): Add requestMetrics for NFS.
   }
@@ -1271,11 +1617,17 @@ void EdenServer::unregisterStats(EdenMount* edenMount) {
   counters->unregisterCallback(
       edenMount->getCounterName(CounterName::JOURNAL_MAX_FILES_ACCUMULATED));
 #ifndef _WIN32
+  counters->unregisterCallback(
+      edenMount->getCounterName(CounterName::OVERLAY_GC_QUEUE_DEPTH));
   if (edenMount->getFuseChannel()) {
     for (auto metric : RequestMetricsScope::requestMetrics) {
       counters->unregisterCallback(getCounterNameForFuseRequests(
           RequestMetricsScope::RequestStage::LIVE, metric, edenMount));
     }
+    counters->unregisterCallback(
+        edenMount->getCounterName(CounterName::FUSE_INVALIDATIONS_SENT));
+    counters->unregisterCallback(
+        edenMount->getCounterName(CounterName::FUSE_INVALIDATIONS_COALESCED));
   } else if (edenMount->getNfsdChannel()) {
     // TODO(xavierd): Unregister NFS metrics
   }
@@ -1353,6 +1705,10 @@ folly::Future<std::shared_ptr<EdenMount>> EdenServer::mount(
       serverState_->getStructuredLogger(),
       serverState_->getReloadableConfig().getEdenConfig());
   auto journal = std::make_unique<Journal>(getSharedStats());
+  if (serverState_->getEdenConfig()->persistJournal.getValue()) {
+    journal->attachLog(std::make_unique<JournalLog>(
+        initialConfig->getClientDirectory() + "journal"_pc));
+  }
 
   // Create the EdenMount object and insert the mount into the mountPoints_ map.
   auto edenMount = EdenMount::create(
@@ -1367,10 +1723,22 @@ folly::Future<std::shared_ptr<EdenMount>> EdenServer::mount(
 
   const bool doTakeover = optionalTakeover.has_value();
 
+  auto takeoverInodeMap = doTakeover
+      ? std::make_optional(std::move(optionalTakeover->inodeMap))
+      : std::nullopt;
+  std::shared_ptr<const InodeMapSnapshot> takeoverSnapshot;
+#ifndef _WIN32
+  if (doTakeover && optionalTakeover->inodeMapSnapshot) {
+    // The InodeMap reads the entries of the snapshot as it needs them, the
+    // serialized inode map is left empty by this version of the protocol.
+    takeoverSnapshot = std::move(optionalTakeover->inodeMapSnapshot);
+    takeoverInodeMap = std::nullopt;
+  }
+#endif
   auto initFuture = edenMount->initialize(
       std::move(progressCallback),
-      doTakeover ? std::make_optional(optionalTakeover->inodeMap)
-                 : std::nullopt);
+      takeoverInodeMap,
+      std::move(takeoverSnapshot));
 
   // Now actually begin starting the mount point
   return std::move(initFuture)
@@ -1503,8 +1871,12 @@ void EdenServer::mountFinished(
   const bool doTakeover = takeoverPromise.has_value();
 
   // Shutdown the EdenMount, and fulfill the unmount promise
-  // when the shutdown completes
-  edenMount->shutdown(doTakeover)
+  // when the shutdown completes. Unloading and serializing the inodes runs on
+  // the thread pool rather than on the thread stopping the channel, so that
+  // the mounts stopped together shut down concurrently.
+  folly::via(
+      serverState_->getThreadPool().get(),
+      [edenMount, doTakeover] { return edenMount->shutdown(doTakeover); })
       .via(getMainEventBase())
       .thenTry([unmountPromise = std::move(unmountPromise),
                 takeoverPromise = std::move(takeoverPromise),
@@ -1653,6 +2025,10 @@ shared_ptr<BackingStore> EdenServer::createBackingStore(
         reloadableConfig,
         getSharedStats(),
         metadataImporterFactory_);
+    auto numQueueWorkers = std::clamp<uint32_t>(
+        reloadableConfig->getEdenConfig()->numQueueWorkers.getValue(),
+        1,
+        std::numeric_limits<uint8_t>::max());
     return make_shared<HgQueuedBackingStore>(
         localStore_,
         getSharedStats(),
@@ -1661,11 +2037,15 @@ shared_ptr<BackingStore> EdenServer::createBackingStore(
         serverState_->getStructuredLogger(),
         std::make_unique<BackingStoreLogger>(
             serverState_->getStructuredLogger(),
-            serverState_->getProcessNameCache()));
+            serverState_->getProcessNameCache()),
+        static_cast<uint8_t>(numQueueWorkers));
   } else if (type == "git") {
 #ifdef EDEN_HAVE_GIT
     const auto repoPath = realpath(name);
-    return make_shared<GitBackingStore>(repoPath, localStore_.get());
+    return make_shared<GitBackingStore>(
+        repoPath,
+        localStore_.get(),
+        serverState_->getEdenConfig()->gitImportThreads.getValue());
 #else // EDEN_HAVE_GIT
     throw std::domain_error(
         "support for Git was not enabled in this EdenFS build");
@@ -1787,6 +2167,8 @@ folly::Future<TakeoverData> EdenServer::startTakeoverShutdown() {
   // once runServer() returns.
   folly::Promise<std::optional<TakeoverData>> takeoverPromise;
   folly::File thriftSocket;
+  folly::stop_watch<> shutdownWatch;
+  auto event = std::make_shared<TakeoverShutdown>();
   {
     auto state = runningState_.wlock();
     if (state->state != RunState::RUNNING) {
@@ -1813,14 +2195,34 @@ folly::Future<TakeoverData> EdenServer::startTakeoverShutdown() {
     // upon successfully sending the TakeoverData, or with the TakeoverData
     // if the takeover was unsuccessful.
     XCHECK(!state->shutdownFuture.valid());
-    state->shutdownFuture = takeoverPromise.getFuture();
+    state->shutdownFuture =
+        takeoverPromise.getFuture().thenTry(
+            [this, shutdownWatch, event](
+                folly::Try<std::optional<TakeoverData>>&& result) {
+              event->send_duration =
+                  std::chrono::duration<double>{shutdownWatch.elapsed()}
+                      .count() -
+                  event->prepare_duration - event->stop_mounts_duration;
+              // The TakeoverData is only given back if the takeover failed.
+              event->success = result.hasValue() && !result.value().has_value();
+              XLOG(INFO) << "takeover shutdown took " << event->prepare_duration
+                         << "s to prepare, " << event->stop_mounts_duration
+                         << "s to stop " << event->mount_count << " mounts and "
+                         << event->send_duration << "s to send them";
+              serverState_->getStructuredLogger()->logEvent(*event);
+              return std::move(result).value();
+            });
     state->state = RunState::SHUTTING_DOWN;
   }
 
   return serverState_->getFaultInjector()
       .checkAsync("takeover", "server_shutdown")
       .via(serverState_->getThreadPool().get())
-      .thenValue([this](auto&&) {
+      .thenValue([this, shutdownWatch, event](auto&&) {
+        SCOPE_EXIT {
+          event->prepare_duration =
+              std::chrono::duration<double>{shutdownWatch.elapsed()}.count();
+        };
         // Compact storage for all key spaces in order to speed up the
         // takeover start of the new process. We could potentially test this
         // more and change it in the future to simply flush instead of
@@ -1852,8 +2254,13 @@ folly::Future<TakeoverData> EdenServer::startTakeoverShutdown() {
         }
         return stopMountsForTakeover(std::move(takeoverPromise));
       })
-      .thenValue([this, socket = std::move(thriftSocket)](
+      .thenValue([this, socket = std::move(thriftSocket), shutdownWatch, event](
                      TakeoverData&& takeover) mutable {
+        event->stop_mounts_duration =
+            std::chrono::duration<double>{shutdownWatch.elapsed()}.count() -
+            event->prepare_duration;
+        event->mount_count = takeover.mountPoints.size();
+
         takeover.lockFile = edenDir_.extractLock();
 
         takeover.thriftSocket = std::move(socket);
@@ -56,6 +56,7 @@ class ThriftServer;
 } // namespace apache
 
 namespace folly {
+class CPUThreadPoolExecutor;
 class EventBase;
 }
 
@@ -275,6 +276,14 @@ class EdenServer : private TakeoverHandler {
    */
   MountList getAllMountPoints() const;
 
+  /**
+   * The paths of the configured mount points that are waiting for their turn
+   * to start at startup, see prepareMounts().
+   */
+  std::vector<std::string> getPendingStartupMounts() const {
+    return *pendingStartupMounts_.rlock();
+  }
+
   /**
    * Look up an EdenMount by the path where it is mounted.
    *
@@ -381,6 +390,21 @@ class EdenServer : private TakeoverHandler {
     return mainEventBase_;
   }
 
+  /**
+   * Get the executor of the single thread that runs the periodic maintenance
+   * tasks, out of the way of the main thread.
+   */
+  folly::Executor* getMaintenanceExecutor() const;
+
+  /**
+   * Whether the mounts are busy enough serving filesystem requests that
+   * maintenance work should be put off, as controlled by the
+   * "core:maintenance-busy-requests" setting.
+   *
+   * This should only be called from the main EventBase thread.
+   */
+  bool isFilesystemBusy() const;
+
   /**
    * Look up all BackingStores
    *
@@ -451,6 +475,31 @@ class EdenServer : private TakeoverHandler {
   // all mounts.
   void unloadInodes();
 
+  /**
+   * Unload the unreferenced inodes of all the mounts that were last accessed
+   * before the cutoff, and return the number of inodes unloaded.
+   */
+  size_t unloadInodesLastAccessedBefore(
+      std::chrono::system_clock::time_point cutoff);
+
+  /**
+   * When the resident memory is above inode-unload-memory-target, unload the
+   * inodes last accessed before memoryPressureUnloadAge_, and halve that age
+   * for the next run. Once under the target, the age is doubled back at every
+   * run so that recently accessed inodes are only unloaded under sustained
+   * pressure.
+   *
+   * The age limits how many inodes are unloaded, not the work of a run: like
+   * unloadInodes(), every run above the target walks all the loaded inodes
+   * of every mount, which is why it runs on the maintenance thread.
+   */
+  void unloadInodesUnderMemoryPressure();
+
+  /**
+   * Write the modified inode metadata of every mount back to disk.
+   */
+  void flushInodeMetadata();
+
   std::shared_ptr<BackingStore> createBackingStore(
       folly::StringPiece type,
       folly::StringPiece name);
@@ -585,6 +634,7 @@ class EdenServer : private TakeoverHandler {
   std::shared_ptr<TreeCache> treeCache_;
 
   folly::Synchronized<MountMap> mountPoints_{kPathMapDefaultCaseSensitive};
+  folly::Synchronized<std::vector<std::string>> pendingStartupMounts_;
 
 #ifndef _WIN32
   /**
@@ -706,11 +756,38 @@ class EdenServer : private TakeoverHandler {
       "mem_stats"};
   PeriodicFnTask<&EdenServer::manageLocalStore> localStoreTask_{
       this,
-      "local_store"};
+      "local_store",
+      PeriodicTask::Options::maintenance()};
 
   PeriodicFnTask<&EdenServer::refreshBackingStore> backingStoreTask_{
       this,
-      "backing_store"};
+      "backing_store",
+      PeriodicTask::Options::maintenance()};
+
+#ifndef _WIN32
+  PeriodicFnTask<&EdenServer::unloadInodesUnderMemoryPressure>
+      memoryPressureUnloadTask_{
+          this,
+          "memory_pressure_unload",
+          PeriodicTask::Options::maintenance()};
+  PeriodicFnTask<&EdenServer::flushInodeMetadata> inodeMetadataFlushTask_{
+      this,
+      "inode_metadata_flush",
+      PeriodicTask::Options::maintenance()};
+
+  /**
+   * The age of the inodes to unload on the next run of
+   * memoryPressureUnloadTask_. Only accessed from the maintenance thread,
+   * once the task started.
+   */
+  std::chrono::system_clock::duration memoryPressureUnloadAge_{};
+#endif
+
+  /**
+   * Runs the background periodic tasks.  Declared last so that it is
+   * destroyed, and its thread joined, before any of them.
+   */
+  std::unique_ptr<folly::CPUThreadPoolExecutor> maintenanceExecutor_;
 };
 } // namespace eden
 } // namespace facebook
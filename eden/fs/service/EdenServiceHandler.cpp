@@ -9,6 +9,7 @@
 
 #include <algorithm>
 #include <optional>
+#include <unordered_set>
 #include "eden/fs/utils/ProcessNameCache.h"
 
 #include <fb303/ServiceData.h>
@@ -16,6 +17,7 @@
 #include <folly/FileUtil.h>
 #include <folly/Portability.h>
 #include <folly/String.h>
+#include <folly/Synchronized.h>
 #include <folly/chrono/Conv.h>
 #include <folly/container/Access.h>
 #include <folly/futures/Future.h>
@@ -65,6 +67,7 @@
 #include "eden/fs/store/ObjectStore.h"
 #include "eden/fs/store/PathLoader.h"
 #include "eden/fs/store/hg/HgQueuedBackingStore.h"
+#include "eden/fs/telemetry/SamplingProfiler.h"
 #include "eden/fs/telemetry/Tracing.h"
 #include "eden/fs/utils/Bug.h"
 #include "eden/fs/utils/Clock.h"
@@ -75,6 +78,7 @@
 #include "eden/fs/utils/ProcessNameCache.h"
 #include "eden/fs/utils/StatTimes.h"
 #include "eden/fs/utils/UnboundedQueueExecutor.h"
+#include "eden/fs/utils/WorkStealingTaskQueue.h"
 
 using folly::Future;
 using folly::makeFuture;
@@ -181,10 +185,32 @@ class ThriftFetchContext : public ObjectFetchContext {
     prefetchMetadata_ = prefetchMetadata;
   }
 
+  ImportPriority getPriority() const override {
+    return priority_;
+  }
+
+  void setPriority(ImportPriority priority) {
+    priority_ = priority;
+  }
+
+  void didFetch(ObjectType type, const Hash&, Origin origin) override {
+    counts_[type][origin].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * The number of objects of the type fetched from the origin so far.
+   */
+  uint64_t countFetches(ObjectType type, Origin origin) const {
+    return counts_[type][origin].load(std::memory_order_relaxed);
+  }
+
  private:
   std::optional<pid_t> pid_;
   folly::StringPiece endpoint_;
   bool prefetchMetadata_ = false;
+  ImportPriority priority_{ImportPriority::kNormal()};
+  std::atomic<uint64_t> counts_[ObjectFetchContext::kObjectTypeEnumMax]
+                               [ObjectFetchContext::kOriginEnumMax] = {};
 };
 
 // Helper class to log where the request completes in Future
@@ -217,7 +243,9 @@ class ThriftLogHelper {
         itcLineNumber_(itcLineNumber),
         level_(level),
         itcLogger_(logger),
-        fetchContext_{pid, itcFunctionName} {}
+        fetchContext_{pid, itcFunctionName},
+        // The function names are always __func__, which is null-terminated.
+        profilerTag_{itcFunctionName.data()} {}
 
   ~ThriftLogHelper() {
     // Logging completion time for the request
@@ -236,6 +264,13 @@ class ThriftLogHelper {
     return itcFunctionName_;
   }
 
+  /**
+   * Keep the request admitted until it completes.
+   */
+  void setPermit(ThriftClientLimiter::Permit permit) {
+    permit_ = std::move(permit);
+  }
+
  private:
   folly::StringPiece itcFunctionName_;
   folly::StringPiece itcFileName_;
@@ -244,6 +279,8 @@ class ThriftLogHelper {
   folly::Logger itcLogger_;
   folly::stop_watch<std::chrono::microseconds> itcTimer_ = {};
   ThriftFetchContext fetchContext_;
+  ThriftClientLimiter::Permit permit_;
+  ProfilerTag profilerTag_;
 };
 
 template <typename ReturnType>
@@ -339,7 +376,9 @@ EdenServiceHandler::EdenServiceHandler(
     EdenServer* server)
     : BaseService{kServiceName},
       originalCommandLine_{std::move(originalCommandLine)},
-      server_{server} {
+      server_{server},
+      permissionChecker_{
+          std::make_shared<ThriftPermissionChecker>(server->getServerState())} {
   struct HistConfig {
     int64_t bucketSize{250};
     int64_t min{0};
@@ -391,8 +430,7 @@ EdenServiceHandler::getProcessor() {
   if (server_->getServerState()
           ->getEdenConfig()
           ->thriftUseCustomPermissionChecking.getValue()) {
-    processor->addEventHandler(
-        std::make_shared<ThriftPermissionChecker>(server_->getServerState()));
+    processor->addEventHandler(permissionChecker_);
   }
   return processor;
 }
@@ -525,62 +563,129 @@ void EdenServiceHandler::resetParentCommits(
   edenMount->resetParent(parent1);
 }
 
+namespace {
+/**
+ * What the SHA-1 of a path is computed from: its loaded inode, or the blob of
+ * its entry when its inode is neither loaded nor materialized.
+ */
+struct Sha1Source {
+  FileInodePtr inode;
+  std::optional<Hash> blobId;
+};
+
+Sha1Source getSha1Source(InodeOrEntry& inodeOrEntry) {
+  if (auto* inode = std::get_if<InodePtr>(&inodeOrEntry)) {
+    auto fileInode = inode->asFilePtr();
+    if (fileInode->getType() != dtype_t::Regular) {
+      // We intentionally want to refuse to compute the SHA1 of symlinks
+      throw InodeError(EINVAL, fileInode, "file is a symlink");
+    }
+    return Sha1Source{std::move(fileInode), std::nullopt};
+  }
+
+  auto& entry = std::get<UnloadedEntry>(inodeOrEntry);
+  switch (entry.getDtype()) {
+    case dtype_t::Regular:
+      return Sha1Source{nullptr, entry.hash};
+    case dtype_t::Dir:
+      throw std::system_error(EISDIR, std::generic_category());
+    default:
+      throw std::system_error(
+          EINVAL, std::generic_category(), "file is a symlink");
+  }
+}
+} // namespace
+
 void EdenServiceHandler::getSHA1(
     vector<SHA1Result>& out,
     unique_ptr<string> mountPoint,
     unique_ptr<vector<string>> paths) {
   TraceBlock block("getSHA1");
   auto helper = INSTRUMENT_THRIFT_CALL(DBG3, *mountPoint, toLogArg(*paths));
-  vector<Future<Hash>> futures;
+  auto& fetchContext = helper->getFetchContext();
   auto mountPath = AbsolutePathPiece{*mountPoint};
-  for (const auto& path : *paths) {
-    futures.emplace_back(
-        getSHA1ForPathDefensively(mountPath, path, helper->getFetchContext()));
+  auto edenMount = server_->getMount(mountPath);
+
+  // The paths are resolved together, so that the directories they share are
+  // only walked once, and without loading the inodes of the files.
+  auto sources = collectAll(applyToInodesOrEntries(
+                                edenMount->getRootInode(),
+                                *paths,
+                                &getSha1Source,
+                                fetchContext))
+                     .get();
+
+  // The SHA-1s of the files whose inode isn't loaded are looked up in their
+  // blob metadata as one batch, and computed by their inode otherwise.
+  std::vector<Hash> blobIds;
+  std::vector<size_t> blobIndices;
+  std::vector<Future<Hash>> inodeSha1s;
+  std::vector<size_t> inodeIndices;
+  for (size_t i = 0; i < sources.size(); ++i) {
+    if (sources[i].hasException() || (*paths)[i].empty()) {
+      continue;
+    }
+    if (sources[i]->inode) {
+      inodeSha1s.push_back(folly::makeFutureWith(
+          [&] { return sources[i]->inode->getSha1(fetchContext); }));
+      inodeIndices.push_back(i);
+    } else {
+      blobIds.push_back(*sources[i]->blobId);
+      blobIndices.push_back(i);
+    }
   }
+  auto blobSha1sFuture =
+      edenMount->getObjectStore()->getBlobSha1s(blobIds, fetchContext);
 
-  auto results = folly::collectAll(std::move(futures)).get();
+  std::vector<Try<Hash>> results(paths->size());
+  for (size_t i = 0; i < sources.size(); ++i) {
+    if ((*paths)[i].empty()) {
+      results[i] = Try<Hash>{newEdenError(
+          EINVAL,
+          EdenErrorType::ARGUMENT_ERROR,
+          "path cannot be the empty string")};
+    } else if (sources[i].hasException()) {
+      results[i] = Try<Hash>{std::move(sources[i]).exception()};
+    }
+  }
+  auto inodeResults = folly::collectAll(std::move(inodeSha1s)).get();
+  for (size_t n = 0; n < inodeIndices.size(); ++n) {
+    results[inodeIndices[n]] = std::move(inodeResults[n]);
+  }
+  auto blobResults = std::move(blobSha1sFuture).getTry();
+  for (size_t n = 0; n < blobIndices.size(); ++n) {
+    results[blobIndices[n]] = blobResults.hasException()
+        ? Try<Hash>{blobResults.exception()}
+        : std::move(blobResults.value()[n]);
+  }
+
+  size_t succeeded = 0;
   for (auto& result : results) {
     out.emplace_back();
     SHA1Result& sha1Result = out.back();
     if (result.hasValue()) {
       sha1Result.set_sha1(thriftHash(result.value()));
+      ++succeeded;
     } else {
       sha1Result.set_error(newEdenError(result.exception()));
     }
   }
-}
 
-Future<Hash> EdenServiceHandler::getSHA1ForPathDefensively(
-    AbsolutePathPiece mountPoint,
-    StringPiece path,
-    ObjectFetchContext& fetchContext) noexcept {
-  return folly::makeFutureWith(
-      [&] { return getSHA1ForPath(mountPoint, path, fetchContext); });
-}
-
-Future<Hash> EdenServiceHandler::getSHA1ForPath(
-    AbsolutePathPiece mountPoint,
-    StringPiece path,
-    ObjectFetchContext& fetchContext) {
-  if (path.empty()) {
-    return makeFuture<Hash>(newEdenError(
-        EINVAL,
-        EdenErrorType::ARGUMENT_ERROR,
-        "path cannot be the empty string"));
-  }
-
-  auto edenMount = server_->getMount(mountPoint);
-  auto relativePath = RelativePathPiece{path};
-  return edenMount->getInode(relativePath, fetchContext)
-      .thenValue([&fetchContext](const InodePtr& inode) {
-        auto fileInode = inode.asFilePtr();
-        if (fileInode->getType() != dtype_t::Regular) {
-          // We intentionally want to refuse to compute the SHA1 of symlinks
-          return makeFuture<Hash>(
-              InodeError(EINVAL, fileInode, "file is a symlink"));
-        }
-        return fileInode->getSha1(fetchContext);
-      });
+  // Every SHA-1 that wasn't hashed from a materialized file came from the
+  // blob metadata.
+  auto fromMemory = fetchContext.countFetches(
+      ObjectFetchContext::BlobMetadata, ObjectFetchContext::FromMemoryCache);
+  auto fromLocalStore = fetchContext.countFetches(
+      ObjectFetchContext::BlobMetadata, ObjectFetchContext::FromDiskCache);
+  auto fromBackingStore = fetchContext.countFetches(
+      ObjectFetchContext::BlobMetadata, ObjectFetchContext::FromBackingStore);
+  auto fromMetadata = fromMemory + fromLocalStore + fromBackingStore;
+  auto& stats = server_->getStats()->getThriftStatsForCurrentThread();
+  stats.getSha1FromOverlay.addValue(
+      succeeded > fromMetadata ? succeeded - fromMetadata : 0);
+  stats.getSha1FromMemory.addValue(fromMemory);
+  stats.getSha1FromLocalStore.addValue(fromLocalStore);
+  stats.getSha1FromBackingStore.addValue(fromBackingStore);
 }
 
 void EdenServiceHandler::getBindMounts(
@@ -646,9 +751,11 @@ void EdenServiceHandler::getCurrentJournalPosition(
 
 apache::thrift::ServerStream<JournalPosition>
 EdenServiceHandler::subscribeStreamTemporary(
-    std::unique_ptr<std::string> mountPoint) {
-  auto helper = INSTRUMENT_THRIFT_CALL(DBG3, *mountPoint);
+    std::unique_ptr<std::string> mountPoint,
+    std::unique_ptr<std::string> root) {
+  auto helper = INSTRUMENT_THRIFT_CALL(DBG3, *mountPoint, *root);
   auto mountPath = AbsolutePathPiece{*mountPoint};
+  auto rootPath = RelativePath{*root};
   auto edenMount = server_->getMount(mountPath);
 
   // We need a weak ref on the mount because the thrift stream plumbing
@@ -707,14 +814,51 @@ EdenServiceHandler::subscribeStreamTemporary(
 
   // Register onJournalChange with the journal subsystem, and assign
   // the subscriber id into the handle so that the callbacks can consume it.
-  handle->emplace(edenMount->getJournal().registerSubscriber(
-      [stream = std::move(stream)]() mutable {
+  // Bursts of changes are coalesced, so that neither the writers nor the
+  // client pay for a notification per change.
+  auto latest = edenMount->getJournal().getLatest();
+  auto nextSequence = latest ? latest->sequenceID + 1 : 1;
+  handle->emplace(edenMount->getJournal().registerThrottledSubscriber(
+      [stream = std::move(stream),
+       weakMount,
+       rootPath = std::move(rootPath),
+       nextSequence]() mutable {
+        if (!rootPath.empty()) {
+          // Only notify of the bursts that changed something under root. The
+          // notifications of a subscriber run one at a time, so nextSequence
+          // needs no lock.
+          auto mount = weakMount.lock();
+          if (!mount) {
+            return;
+          }
+          auto range =
+              mount->getJournal().accumulateRange(nextSequence, rootPath);
+          if (!range) {
+            return;
+          }
+          if (range->isTruncated) {
+            // Let the client recompute its baseline, and resume from the
+            // latest change.
+            if (auto latest = mount->getJournal().getLatest()) {
+              nextSequence = latest->sequenceID + 1;
+            }
+          } else {
+            nextSequence = range->toSequence + 1;
+            if (range->changedFilesInOverlay.empty() &&
+                range->uncleanPaths.empty() &&
+                range->snapshotTransitions.size() <= 1) {
+              return;
+            }
+          }
+        }
         JournalPosition pos;
         // The value is intentionally undefined and should not be used. Instead,
         // the subscriber should call getCurrentJournalPosition or
         // getFilesChangedSince.
         stream->publisher.next(pos);
-      }));
+      },
+      folly::getKeepAliveToken(edenMount->getServerThreadPool().get()),
+      edenMount->getEdenConfig()->journalSubscriberMinInterval.getValue()));
 
   return std::move(streamAndPublisher.first);
 }
@@ -1045,9 +1189,11 @@ apache::thrift::ServerStream<HgEvent> EdenServiceHandler::traceHgEvents(
 void EdenServiceHandler::getFilesChangedSince(
     FileDelta& out,
     std::unique_ptr<std::string> mountPoint,
-    std::unique_ptr<JournalPosition> fromPosition) {
-  auto helper = INSTRUMENT_THRIFT_CALL(DBG3, *mountPoint);
+    std::unique_ptr<JournalPosition> fromPosition,
+    std::unique_ptr<std::string> root) {
+  auto helper = INSTRUMENT_THRIFT_CALL(DBG3, *mountPoint, *root);
   auto mountPath = AbsolutePathPiece{*mountPoint};
+  auto rootPath = RelativePathPiece{*root};
   auto edenMount = server_->getMount(mountPath);
 
   if (*fromPosition->mountGeneration_ref() !=
@@ -1064,7 +1210,7 @@ void EdenServiceHandler::getFilesChangedSince(
   // its limitSequence parameter and we want the changes *since*
   // the provided sequence number.
   auto summed = edenMount->getJournal().accumulateRange(
-      *fromPosition->sequenceNumber_ref() + 1);
+      *fromPosition->sequenceNumber_ref() + 1, rootPath);
 
   // We set the default toPosition to be where we where if summed is null
   out.toPosition_ref()->sequenceNumber_ref() =
@@ -1167,6 +1313,40 @@ void EdenServiceHandler::debugGetRawJournal(
       *edenMount->getObjectStore());
 }
 
+namespace {
+/**
+ * Compute what the stat() of the inode of an entry would return if it was
+ * loaded, from the mount's record of its metadata and from the size of its
+ * source control object.
+ */
+folly::Future<struct stat> statUnloadedEntry(
+    const EdenMount& edenMount,
+    const UnloadedEntry& entry,
+    ObjectFetchContext& fetchContext) {
+  auto st = edenMount.initStatData();
+  st.st_nlink = 1;
+  st.st_ino = entry.inodeNumber.get();
+#ifndef _WIN32
+  // The metadata of an inode that was loaded before is kept in the table,
+  // otherwise it gets its initial metadata when it is loaded.
+  edenMount.getInodeMetadataTable()
+      ->getOptional(entry.inodeNumber)
+      .value_or(edenMount.getInitialInodeMetadata(entry.initialMode))
+      .applyToStat(st);
+#endif
+
+  if (entry.getDtype() == dtype_t::Dir) {
+    return folly::makeFuture(st);
+  }
+  return edenMount.getObjectStore()
+      ->getBlobSize(entry.hash, fetchContext)
+      .thenValue([st](uint64_t size) mutable {
+        st.st_size = size;
+        return st;
+      });
+}
+} // namespace
+
 folly::SemiFuture<std::unique_ptr<std::vector<EntryInformationOrError>>>
 EdenServiceHandler::semifuture_getEntryInformation(
     std::unique_ptr<std::string> mountPoint,
@@ -1177,17 +1357,19 @@ EdenServiceHandler::semifuture_getEntryInformation(
   auto rootInode = edenMount->getRootInode();
   auto& fetchContext = helper->getFetchContext();
 
-  // TODO: applyToInodes currently forces allocation of inodes for all specified
-  // paths. It's possible to resolve this request directly from source control
-  // data. In the future, this should be changed to avoid allocating inodes when
-  // possible.
-
+  // Only the directories leading to the paths are loaded: the type of the
+  // paths themselves is known from the entries of their parent.
   return wrapSemiFuture(
       std::move(helper),
-      collectAll(applyToInodes(
+      collectAll(applyToInodesOrEntries(
                      rootInode,
                      *paths,
-                     [](InodePtr inode) { return inode->getType(); },
+                     [](InodeOrEntry& inodeOrEntry) {
+                       if (auto* inode = std::get_if<InodePtr>(&inodeOrEntry)) {
+                         return (*inode)->getType();
+                       }
+                       return std::get<UnloadedEntry>(inodeOrEntry).getDtype();
+                     },
                      fetchContext))
           .deferValue([](vector<Try<dtype_t>> done) {
             auto out = std::make_unique<vector<EntryInformationOrError>>();
@@ -1216,18 +1398,24 @@ EdenServiceHandler::semifuture_getFileInformation(
   auto edenMount = server_->getMount(mountPath);
   auto rootInode = edenMount->getRootInode();
   auto& fetchContext = helper->getFetchContext();
-  // TODO: applyToInodes currently forces allocation of inodes for all specified
-  // paths. It's possible to resolve this request directly from source control
-  // data. In the future, this should be changed to avoid allocating inodes when
-  // possible.
+  // The paths whose inode isn't loaded are served from their source control
+  // metadata, without loading their inode.
   return wrapSemiFuture(
       std::move(helper),
-      collectAll(applyToInodes(
+      collectAll(applyToInodesOrEntries(
                      rootInode,
                      *paths,
-                     [&fetchContext](InodePtr inode) {
-                       return inode->stat(fetchContext)
-                           .thenValue([](struct stat st) {
+                     [edenMount, &fetchContext](InodeOrEntry& inodeOrEntry) {
+                       auto* inode = std::get_if<InodePtr>(&inodeOrEntry);
+                       auto statFuture = inode
+                           ? (*inode)->stat(fetchContext).semi()
+                           : statUnloadedEntry(
+                                 *edenMount,
+                                 std::get<UnloadedEntry>(inodeOrEntry),
+                                 fetchContext)
+                                 .semi();
+                       return std::move(statFuture)
+                           .deferValue([](struct stat st) {
                              FileInformation info;
                              info.size_ref() = st.st_size;
                              auto ts = stMtime(st);
@@ -1239,8 +1427,7 @@ EdenServiceHandler::semifuture_getFileInformation(
                              result.set_info(info);
 
                              return result;
-                           })
-                           .semi();
+                           });
                      },
                      fetchContext))
           .deferValue([](vector<Try<FileInformationOrError>>&& done) {
@@ -1259,6 +1446,154 @@ EdenServiceHandler::semifuture_getFileInformation(
           }));
 }
 
+namespace {
+/**
+ * Evaluate globRoot against the directory at searchRoot below inode.
+ *
+ * Inodes are only loaded along searchRoot while the directories are
+ * materialized.  An unmaterialized directory has the same content as its
+ * source control Tree, so the rest of searchRoot and the glob itself are
+ * evaluated against Trees from the ObjectStore without loading any inode.
+ */
+folly::Future<std::vector<GlobNode::GlobResult>> evaluateGlobAt(
+    std::shared_ptr<GlobNode> globRoot,
+    ObjectStore& objectStore,
+    ObjectFetchContext& fetchContext,
+    TreeInodePtr inode,
+    RelativePathPiece searchRoot,
+    GlobNode::PrefetchList fileBlobsToPrefetch,
+    const RootId& originRootId,
+    const GlobNode::ResultSink* resultSink = nullptr) {
+  if (searchRoot.empty()) {
+    return globRoot->evaluate(
+        &objectStore,
+        fetchContext,
+        RelativePathPiece(),
+        std::move(inode),
+        std::move(fileBlobsToPrefetch),
+        originRootId,
+        resultSink);
+  }
+
+  auto path = searchRoot.stringPiece();
+  auto slash = path.find('/');
+  auto name = PathComponentPiece{path.subpiece(0, slash)};
+  auto rest = slash == folly::StringPiece::npos
+      ? RelativePath()
+      : RelativePath{path.subpiece(slash + 1)};
+
+  std::optional<Hash> treeHash;
+  {
+    auto contents = inode->getContents().rlock();
+    auto it = contents->entries.find(name);
+    if (it != contents->entries.end() && it->second.isDirectory() &&
+        !it->second.isMaterialized()) {
+      treeHash = it->second.getHash();
+    }
+  }
+
+  if (treeHash) {
+    return objectStore.getTree(*treeHash, fetchContext)
+        .thenValue([&objectStore, &fetchContext, rest = std::move(rest)](
+                       std::shared_ptr<const Tree>&& tree) {
+          return resolveTree(objectStore, fetchContext, std::move(tree), rest);
+        })
+        .thenValue([globRoot = std::move(globRoot),
+                    &objectStore,
+                    &fetchContext,
+                    fileBlobsToPrefetch = std::move(fileBlobsToPrefetch),
+                    &originRootId,
+                    resultSink](std::shared_ptr<const Tree>&& tree) {
+          return globRoot->evaluate(
+              &objectStore,
+              fetchContext,
+              RelativePathPiece(),
+              std::move(tree),
+              fileBlobsToPrefetch,
+              originRootId,
+              resultSink);
+        });
+  }
+
+  // Either the directory is materialized, or getOrLoadChildTree() will report
+  // the appropriate error.
+  return inode->getOrLoadChildTree(name, fetchContext)
+      .thenValue([globRoot = std::move(globRoot),
+                  &objectStore,
+                  &fetchContext,
+                  rest = std::move(rest),
+                  fileBlobsToPrefetch = std::move(fileBlobsToPrefetch),
+                  &originRootId,
+                  resultSink](TreeInodePtr child) mutable {
+        return evaluateGlobAt(
+            std::move(globRoot),
+            objectStore,
+            fetchContext,
+            std::move(child),
+            rest,
+            std::move(fileBlobsToPrefetch),
+            originRootId,
+            resultSink);
+      });
+}
+
+/**
+ * Compile the list of globs into a tree.
+ */
+std::shared_ptr<GlobNode> compileGlobs(
+    const std::vector<std::string>& globs,
+    bool includeDotfiles) {
+  auto globRoot = std::make_shared<GlobNode>(includeDotfiles);
+  try {
+    for (auto& globString : globs) {
+      try {
+        globRoot->parse(globString);
+      } catch (const std::domain_error& exc) {
+        throw newEdenError(
+            EdenErrorType::ARGUMENT_ERROR,
+            "Invalid glob (",
+            exc.what(),
+            "): ",
+            globString);
+      }
+    }
+  } catch (const std::system_error& exc) {
+    throw newEdenError(exc);
+  }
+  return globRoot;
+}
+
+/**
+ * Prefetch the blobs of the files matched by a glob.
+ */
+folly::Future<folly::Unit> prefetchGlobMatches(
+    ObjectStore& store,
+    ObjectFetchContext& fetchContext,
+    GlobNode::PrefetchList fileBlobsToPrefetch) {
+  auto blobs = fileBlobsToPrefetch->wlock();
+  // fileBlobsToPrefetch is deduplicated as an optimization.
+  // The BackingStore layer does not deduplicate fetches, so lets
+  // avoid causing too many duplicates here.
+  std::sort(blobs->begin(), blobs->end());
+  blobs->erase(std::unique(blobs->begin(), blobs->end()), blobs->end());
+
+  std::vector<folly::Future<folly::Unit>> futures;
+  auto range = HashRange{blobs->data(), blobs->size()};
+  while (range.size() > 20480) {
+    auto curRange = range.subpiece(0, 20480);
+    range.advance(20480);
+    futures.emplace_back(store.prefetchBlobs(curRange, fetchContext));
+  }
+  if (!range.empty()) {
+    futures.emplace_back(store.prefetchBlobs(range, fetchContext));
+  }
+  blobs.unlock();
+
+  return folly::collectUnsafe(futures).thenValue(
+      [fileBlobsToPrefetch = std::move(fileBlobsToPrefetch)](auto&&) {});
+}
+} // namespace
+
 folly::Future<std::unique_ptr<Glob>> EdenServiceHandler::_globFiles(
     folly::StringPiece mountPoint,
     std::vector<std::string> globs,
@@ -1275,27 +1610,13 @@ folly::Future<std::unique_ptr<Glob>> EdenServiceHandler::_globFiles(
     bool listOnlyFiles) {
   auto helper = INSTRUMENT_THRIFT_CALL_WITH_FUNCTION_NAME_AND_PID(
       DBG3, caller, pid, mountPoint, toLogArg(globs), includeDotfiles);
+  helper->setPermit(admitClient(pid, caller));
   auto mountPath = AbsolutePathPiece{mountPoint};
   auto edenMount = server_->getMount(mountPath);
+  // Glob fan-out must not delay the filesystem requests.
+  BackgroundWorkGuard backgroundWork;
 
-  // Compile the list of globs into a tree
-  auto globRoot = std::make_shared<GlobNode>(includeDotfiles);
-  try {
-    for (auto& globString : globs) {
-      try {
-        globRoot->parse(globString);
-      } catch (const std::domain_error& exc) {
-        throw newEdenError(
-            EdenErrorType::ARGUMENT_ERROR,
-            "Invalid glob (",
-            exc.what(),
-            "): ",
-            globString);
-      }
-    }
-  } catch (const std::system_error& exc) {
-    throw newEdenError(exc);
-  }
+  auto globRoot = compileGlobs(globs, includeDotfiles);
 
   auto fileBlobsToPrefetch = prefetchFiles
       ? std::make_shared<folly::Synchronized<std::vector<Hash>>>()
@@ -1354,27 +1675,21 @@ folly::Future<std::unique_ptr<Glob>> EdenServiceHandler::_globFiles(
   } else {
     const RootId& originRootId =
         originRootIds->emplace_back(edenMount->getParentCommit());
-    globResults.emplace_back(edenMount->getInode(searchRoot, fetchContext)
-                                 .thenValue([&fetchContext,
-                                             globRoot,
-                                             edenMount,
-                                             fileBlobsToPrefetch,
-                                             &originRootId](InodePtr inode) {
-                                   return globRoot->evaluate(
-                                       edenMount->getObjectStore(),
-                                       fetchContext,
-                                       RelativePathPiece(),
-                                       inode.asTreePtr(),
-                                       fileBlobsToPrefetch,
-                                       originRootId);
-                                 }));
+    globResults.emplace_back(evaluateGlobAt(
+        globRoot,
+        *edenMount->getObjectStore(),
+        fetchContext,
+        edenMount->getRootInode(),
+        searchRoot,
+        fileBlobsToPrefetch,
+        originRootId));
   }
 
   auto prefetchFuture = wrapFuture(
       std::move(helper),
       folly::collectAll(std::move(globResults))
           .via(server_->getServerState()->getThreadPool().get())
-          .thenValue([fileBlobsToPrefetch, suppressFileList](
+          .thenValue([suppressFileList](
                          std::vector<folly::Try<
                              std::vector<GlobNode::GlobResult>>>&& rawResults) {
             // deduplicate and combine all the globResults.
@@ -1406,21 +1721,6 @@ folly::Future<std::unique_ptr<Glob>> EdenServiceHandler::_globFiles(
               }
             }
 
-            // fileBlobsToPrefetch is deduplicated as an optimization.
-            // The BackingStore layer does not deduplicate fetches, so lets
-            // avoid causing too many duplicates here.
-            if (fileBlobsToPrefetch) {
-              auto fileBlobsToPrefetchLocked = fileBlobsToPrefetch->wlock();
-              std::sort(
-                  fileBlobsToPrefetchLocked->begin(),
-                  fileBlobsToPrefetchLocked->end());
-              auto fileBlobsToPrefetchNewEnd = std::unique(
-                  fileBlobsToPrefetchLocked->begin(),
-                  fileBlobsToPrefetchLocked->end());
-              fileBlobsToPrefetchLocked->erase(
-                  fileBlobsToPrefetchNewEnd, fileBlobsToPrefetchLocked->end());
-            }
-
             return folly::makeFuture<std::vector<GlobNode::GlobResult>>(
                 std::move(combinedResults));
           })
@@ -1453,24 +1753,11 @@ folly::Future<std::unique_ptr<Glob>> EdenServiceHandler::_globFiles(
               }
             }
             if (fileBlobsToPrefetch) {
-              std::vector<folly::Future<folly::Unit>> futures;
-
-              auto store = edenMount->getObjectStore();
-              auto blobs = fileBlobsToPrefetch->rlock();
-              auto range = folly::Range{blobs->data(), blobs->size()};
-
-              while (range.size() > 20480) {
-                auto curRange = range.subpiece(0, 20480);
-                range.advance(20480);
-                futures.emplace_back(
-                    store->prefetchBlobs(curRange, fetchContext));
-              }
-              if (!range.empty()) {
-                futures.emplace_back(store->prefetchBlobs(range, fetchContext));
-              }
-
-              return folly::collectUnsafe(futures).thenValue(
-                  [glob = std::move(out), fileBlobsToPrefetch](auto&&) mutable {
+              return prefetchGlobMatches(
+                         *edenMount->getObjectStore(),
+                         fetchContext,
+                         std::move(fileBlobsToPrefetch))
+                  .thenValue([glob = std::move(out)](auto&&) mutable {
                     return makeFuture(std::move(glob));
                   });
             }
@@ -1635,6 +1922,286 @@ folly::Future<std::unique_ptr<Glob>> EdenServiceHandler::future_globFiles(
       *params->listOnlyFiles_ref());
 }
 
+namespace {
+// The maximum number of matches sent in one Glob of streamGlobFiles().
+constexpr size_t kGlobStreamBatchSize = 1024;
+
+// The most batches streamGlobFiles() and streamScmStatus() publish. The
+// stream publisher doesn't expose how many batches the client has yet to
+// read, and holds all of them, so a stream that would publish more fails
+// instead. This bounds the memory a slow client can make a stream use.
+constexpr size_t kMaxStreamBatches = 1024;
+
+/**
+ * Fails the stream of publisher because it reached kMaxStreamBatches.
+ */
+template <typename T>
+void failOverflowedStream(
+    apache::thrift::ServerStreamPublisher<T>&& publisher,
+    EdenStats& stats) {
+  stats.getThriftStatsForCurrentThread().streamOverflow.addValue(1);
+  std::move(publisher).complete(
+      folly::make_exception_wrapper<EdenError>(newEdenError(
+          EdenErrorType::GENERIC_ERROR,
+          "the stream has more than ",
+          kMaxStreamBatches,
+          " batches of results, use the non-streaming call instead")));
+}
+
+/**
+ * Publishes the matches of streamGlobFiles() in batches, as the directories
+ * are evaluated, leaving out the matches that were already sent.
+ *
+ * Each batch is sent as soon as it fills up, so the matches are never all
+ * serialized at once. The batches the client has yet to read are held by the
+ * stream, up to kMaxStreamBatches, as are the names already sent.
+ */
+class GlobStreamPublisher {
+ public:
+  GlobStreamPublisher(
+      apache::thrift::ServerStreamPublisher<Glob> publisher,
+      std::shared_ptr<std::atomic<bool>> disconnected,
+      std::shared_ptr<EdenMount> edenMount,
+      std::shared_ptr<EdenStats> stats,
+      bool wantDtype,
+      bool listOnlyFiles)
+      : state_{folly::in_place, std::move(publisher)},
+        disconnected_{std::move(disconnected)},
+        edenMount_{std::move(edenMount)},
+        stats_{std::move(stats)},
+        wantDtype_{wantDtype},
+        listOnlyFiles_{listOnlyFiles} {}
+
+  ~GlobStreamPublisher() {
+    // Destroying a publisher without calling complete() aborts the process.
+    complete(folly::make_exception_wrapper<std::runtime_error>(
+        "glob terminated"));
+  }
+
+  void add(std::vector<GlobNode::GlobResult>&& results) {
+    if (disconnected_->load()) {
+      return;
+    }
+
+    auto state = state_.lock();
+    if (state->completed) {
+      return;
+    }
+    for (auto& entry : results) {
+      if (listOnlyFiles_ && entry.dtype == dtype_t::Dir) {
+        continue;
+      }
+      auto originHash =
+          edenMount_->getObjectStore()->renderRootId(*entry.originHash);
+      // Several globs, or the same glob at several revisions, may match the
+      // same name.
+      if (!state->sent
+               .insert(folly::to<std::string>(
+                   entry.name.stringPiece(), '\0', originHash))
+               .second) {
+        continue;
+      }
+      state->batch.matchingFiles_ref()->emplace_back(
+          entry.name.stringPiece().toString());
+      if (wantDtype_) {
+        state->batch.dtypes_ref()->emplace_back(
+            static_cast<OsDtype>(entry.dtype));
+      }
+      state->batch.originHashes_ref()->emplace_back(std::move(originHash));
+
+      if (state->batch.matchingFiles_ref()->size() >= kGlobStreamBatchSize) {
+        if (++state->publishedBatches > kMaxStreamBatches) {
+          state->completed = true;
+          failOverflowedStream(std::move(state->publisher), *stats_);
+          return;
+        }
+        state->publisher.next(std::exchange(state->batch, Glob{}));
+      }
+    }
+  }
+
+  /**
+   * Send the last batch and complete the stream, or fail it if error is set.
+   */
+  void complete(folly::exception_wrapper error) {
+    auto state = state_.lock();
+    if (state->completed) {
+      return;
+    }
+    state->completed = true;
+    if (error) {
+      std::move(state->publisher)
+          .complete(folly::make_exception_wrapper<EdenError>(
+              newEdenError(error)));
+      return;
+    }
+    if (!state->batch.matchingFiles_ref()->empty()) {
+      state->publisher.next(std::move(state->batch));
+    }
+    std::move(state->publisher).complete();
+  }
+
+ private:
+  struct State {
+    explicit State(apache::thrift::ServerStreamPublisher<Glob> publisher)
+        : publisher{std::move(publisher)} {}
+
+    apache::thrift::ServerStreamPublisher<Glob> publisher;
+    Glob batch;
+    size_t publishedBatches{0};
+    // The name and origin of every match sent so far.
+    std::unordered_set<std::string> sent;
+    bool completed{false};
+  };
+
+  folly::Synchronized<State, std::mutex> state_;
+  std::shared_ptr<std::atomic<bool>> disconnected_;
+  std::shared_ptr<EdenMount> edenMount_;
+  std::shared_ptr<EdenStats> stats_;
+  bool wantDtype_;
+  bool listOnlyFiles_;
+};
+} // namespace
+
+apache::thrift::ServerStream<Glob> EdenServiceHandler::streamGlobFiles(
+    std::unique_ptr<GlobParams> params) {
+  auto& mountPoint = *params->mountPoint_ref();
+  auto helper = INSTRUMENT_THRIFT_CALL(
+      DBG3,
+      mountPoint,
+      toLogArg(*params->globs_ref()),
+      *params->includeDotfiles_ref());
+  if (*params->background_ref() || params->predictiveGlob_ref()) {
+    throw newEdenError(
+        EdenErrorType::ARGUMENT_ERROR,
+        "streamGlobFiles does not support background nor predictive globs");
+  }
+  helper->setPermit(admitClient(getAndRegisterClientPid(), __func__));
+  auto edenMount = server_->getMount(AbsolutePathPiece{mountPoint});
+  auto globRoot =
+      compileGlobs(*params->globs_ref(), *params->includeDotfiles_ref());
+
+  auto fileBlobsToPrefetch = *params->prefetchFiles_ref()
+      ? std::make_shared<folly::Synchronized<std::vector<Hash>>>()
+      : nullptr;
+
+  auto& fetchContext = helper->getFetchContext();
+  fetchContext.setPrefetchMetadata(*params->prefetchMetadata_ref());
+
+  auto disconnected = std::make_shared<std::atomic<bool>>(false);
+  auto [serverStream, streamPublisher] =
+      apache::thrift::ServerStream<Glob>::createPublisher([disconnected] {
+        // Stop publishing the matches, the walk itself runs to completion.
+        disconnected->store(true);
+      });
+  auto publisher = std::make_shared<GlobStreamPublisher>(
+      std::move(streamPublisher),
+      std::move(disconnected),
+      edenMount,
+      server_->getSharedStats(),
+      *params->wantDtype_ref(),
+      *params->listOnlyFiles_ref());
+
+  auto resultSink = std::make_shared<GlobNode::ResultSink>(
+      [publisher, suppressFileList = *params->suppressFileList_ref()](
+          std::vector<GlobNode::GlobResult>&& results) {
+        if (!suppressFileList) {
+          publisher->add(std::move(results));
+        }
+      });
+
+  // These hashes must outlive the GlobResults created by evaluate as the
+  // GlobResults will hold on to references to these hashes
+  auto originRootIds = std::make_unique<std::vector<RootId>>();
+  std::vector<folly::Future<std::vector<GlobNode::GlobResult>>> globResults;
+  auto searchRoot = relpathFromUserPath(*params->searchRoot_ref());
+
+  auto& revisions = *params->revisions_ref();
+  if (!revisions.empty()) {
+    // Note that we MUST reserve here, otherwise while emplacing we might
+    // invalidate the earlier commitHash refrences
+    globResults.reserve(revisions.size());
+    originRootIds->reserve(revisions.size());
+    for (auto& revision : revisions) {
+      const RootId& originRootId = originRootIds->emplace_back(
+          edenMount->getObjectStore()->parseRootId(revision));
+
+      globResults.emplace_back(
+          edenMount->getObjectStore()
+              ->getRootTree(originRootId, fetchContext)
+              .thenValue([edenMount, &fetchContext, searchRoot](
+                             std::shared_ptr<const Tree>&& rootTree) {
+                return resolveTree(
+                    *edenMount->getObjectStore(),
+                    fetchContext,
+                    std::move(rootTree),
+                    searchRoot);
+              })
+              .thenValue([edenMount,
+                          globRoot,
+                          &fetchContext,
+                          fileBlobsToPrefetch,
+                          &originRootId,
+                          resultSink = resultSink.get()](
+                             std::shared_ptr<const Tree>&& tree) {
+                return globRoot->evaluate(
+                    edenMount->getObjectStore(),
+                    fetchContext,
+                    RelativePathPiece(),
+                    std::move(tree),
+                    fileBlobsToPrefetch,
+                    originRootId,
+                    resultSink);
+              }));
+    }
+  } else {
+    const RootId& originRootId =
+        originRootIds->emplace_back(edenMount->getParentCommit());
+    globResults.emplace_back(evaluateGlobAt(
+        globRoot,
+        *edenMount->getObjectStore(),
+        fetchContext,
+        edenMount->getRootInode(),
+        searchRoot,
+        fileBlobsToPrefetch,
+        originRootId,
+        resultSink.get()));
+  }
+
+  auto* threadPool = server_->getServerState()->getThreadPool().get();
+  auto globFuture =
+      folly::collectAll(std::move(globResults))
+          .via(threadPool)
+          .thenValue([edenMount, fileBlobsToPrefetch, &fetchContext](
+                         std::vector<folly::Try<
+                             std::vector<GlobNode::GlobResult>>>&& results) {
+            for (auto& result : results) {
+              result.throwUnlessValue();
+            }
+            if (!fileBlobsToPrefetch) {
+              return folly::makeFuture();
+            }
+            return prefetchGlobMatches(
+                *edenMount->getObjectStore(),
+                fetchContext,
+                fileBlobsToPrefetch);
+          })
+          .thenTry([publisher](folly::Try<folly::Unit>&& result) {
+            publisher->complete(
+                result.hasException() ? std::move(result.exception())
+                                      : folly::exception_wrapper{});
+          })
+          .ensure([helper = std::move(helper),
+                   globRoot,
+                   originRootIds = std::move(originRootIds),
+                   resultSink]() {
+            // keep the glob state alive until the end
+          });
+  folly::futures::detachOn(threadPool, std::move(globFuture).semi());
+
+  return std::move(serverStream);
+}
+
 folly::Future<Unit> EdenServiceHandler::future_chown(
     FOLLY_MAYBE_UNUSED std::unique_ptr<std::string> mountPoint,
     FOLLY_MAYBE_UNUSED int32_t uid,
@@ -1661,6 +2228,7 @@ void EdenServiceHandler::async_tm_getScmStatusV2(
         *params->mountPoint_ref(),
         folly::to<string>("commitHash=", logHash(*params->commit_ref())),
         folly::to<string>("listIgnored=", *params->listIgnored_ref()));
+    helper->setPermit(admitClient(pid, func));
 
     auto mountPath = AbsolutePathPiece{*params->mountPoint_ref()};
     auto mount = server_->getMount(mountPath);
@@ -1685,6 +2253,372 @@ void EdenServiceHandler::async_tm_getScmStatusV2(
       });
 }
 
+namespace {
+// The number of differences at which streamScmStatus() sends a batch.
+constexpr size_t kScmStatusStreamBatchSize = 1024;
+
+/**
+ * Lets several threads publish to a stream, and completes the stream when
+ * destroyed if it wasn't already: destroying a publisher without calling
+ * complete() aborts the process.
+ *
+ * When given stats, the stream fails once it would publish more than
+ * kMaxStreamBatches values.
+ */
+template <typename T>
+class SynchronizedStreamPublisher {
+ public:
+  explicit SynchronizedStreamPublisher(
+      apache::thrift::ServerStreamPublisher<T> publisher,
+      std::shared_ptr<EdenStats> stats = nullptr)
+      : state_{folly::in_place, std::move(publisher)},
+        stats_{std::move(stats)} {}
+
+  ~SynchronizedStreamPublisher() {
+    complete(folly::make_exception_wrapper<std::runtime_error>(
+        "stream terminated"));
+  }
+
+  void next(T&& value) {
+    auto state = state_.lock();
+    if (state->completed) {
+      return;
+    }
+    if (stats_ && ++state->published > kMaxStreamBatches) {
+      state->completed = true;
+      failOverflowedStream(std::move(state->publisher), *stats_);
+      return;
+    }
+    state->publisher.next(std::move(value));
+  }
+
+  /**
+   * Complete the stream, or fail it if error is set.
+   */
+  void complete(folly::exception_wrapper error = {}) {
+    auto state = state_.lock();
+    if (std::exchange(state->completed, true)) {
+      return;
+    }
+    if (error) {
+      std::move(state->publisher)
+          .complete(folly::make_exception_wrapper<EdenError>(
+              newEdenError(error)));
+    } else {
+      std::move(state->publisher).complete();
+    }
+  }
+
+ private:
+  struct State {
+    explicit State(apache::thrift::ServerStreamPublisher<T> publisher)
+        : publisher{std::move(publisher)} {}
+
+    apache::thrift::ServerStreamPublisher<T> publisher;
+    size_t published{0};
+    bool completed{false};
+  };
+
+  folly::Synchronized<State, std::mutex> state_;
+  std::shared_ptr<EdenStats> stats_;
+};
+} // namespace
+
+apache::thrift::ServerStream<ScmStatus> EdenServiceHandler::streamScmStatus(
+    std::unique_ptr<GetScmStatusParams> params) {
+  auto helper = INSTRUMENT_THRIFT_CALL(
+      DBG2,
+      *params->mountPoint_ref(),
+      folly::to<string>("commitHash=", logHash(*params->commit_ref())),
+      folly::to<string>("listIgnored=", *params->listIgnored_ref()));
+  helper->setPermit(admitClient(getAndRegisterClientPid(), __func__));
+
+  auto mountPath = AbsolutePathPiece{*params->mountPoint_ref()};
+  auto mount = server_->getMount(mountPath);
+  auto rootId = mount->getObjectStore()->parseRootId(*params->commit_ref());
+  auto enforceParents = server_->getServerState()
+                            ->getReloadableConfig()
+                            .getEdenConfig()
+                            ->enforceParents.getValue();
+
+  auto [serverStream, streamPublisher] =
+      apache::thrift::ServerStream<ScmStatus>::createPublisher([] {});
+  auto publisher = std::make_shared<SynchronizedStreamPublisher<ScmStatus>>(
+      std::move(streamPublisher), server_->getSharedStats());
+
+  // The differences are sent as the diff finds them rather than being
+  // accumulated and serialized at once. The stream holds the batches the
+  // client has yet to read, up to kMaxStreamBatches.
+  auto callback = std::make_shared<ScmStatusDiffCallback>(
+      kScmStatusStreamBatchSize,
+      [publisher](ScmStatus&& batch) { publisher->next(std::move(batch)); });
+
+  auto diffFuture =
+      mount
+          ->diff(
+              callback.get(),
+              rootId,
+              *params->listIgnored_ref(),
+              enforceParents,
+              /*request=*/nullptr)
+          .thenTry([callback, publisher](folly::Try<folly::Unit>&& result) {
+            if (result.hasException()) {
+              publisher->complete(std::move(result.exception()));
+              return;
+            }
+            callback->flush();
+            publisher->complete();
+          })
+          .ensure([helper = std::move(helper), mount]() {
+            // keep the mount alive until the diff completes
+          });
+  folly::futures::detachOn(
+      server_->getServerState()->getThreadPool().get(),
+      std::move(diffFuture).semi());
+
+  return std::move(serverStream);
+}
+
+namespace {
+// The largest number of files whose sizes are looked up and which are fetched
+// at once by streamPrefetch(), and after which its progress is sent.
+constexpr size_t kPrefetchBatchSize = 1024;
+
+/**
+ * Fetches the files matched by streamPrefetch() one batch at a time, within
+ * its budget, and publishes the progress after each batch.
+ */
+class PrefetchJob : public std::enable_shared_from_this<PrefetchJob> {
+ public:
+  PrefetchJob(
+      std::shared_ptr<EdenMount> edenMount,
+      ObjectFetchContext& fetchContext,
+      std::vector<Hash> blobs,
+      uint64_t maxBytes,
+      uint64_t maxFiles,
+      std::shared_ptr<SynchronizedStreamPublisher<PrefetchProgress>> publisher,
+      std::shared_ptr<std::atomic<bool>> cancelled)
+      : edenMount_{std::move(edenMount)},
+        fetchContext_{fetchContext},
+        blobs_{std::move(blobs)},
+        maxBytes_{maxBytes},
+        maxFiles_{maxFiles},
+        publisher_{std::move(publisher)},
+        cancelled_{std::move(cancelled)} {}
+
+  /**
+   * Fetch the remaining batches, completing once the last one is fetched,
+   * the budget is exhausted or the stream is cancelled.
+   */
+  folly::Future<folly::Unit> run() {
+    if (cancelled_->load() || budgetExhausted_ || next_ == blobs_.size()) {
+      return folly::unit;
+    }
+
+    auto batchSize = nextBatchSize();
+    if (batchSize == 0) {
+      budgetExhausted_ = true;
+      publisher_->next(getProgress());
+      return folly::unit;
+    }
+    auto end = std::min(next_ + batchSize, blobs_.size());
+    std::vector<Hash> batch{blobs_.begin() + next_, blobs_.begin() + end};
+    next_ = end;
+    auto* store = edenMount_->getObjectStore();
+    return store->getBlobSizes(batch, fetchContext_)
+        .thenValue([self = shared_from_this(), batch = std::move(batch)](
+                       std::vector<folly::Try<uint64_t>>&& sizes) mutable {
+          // The sizes come from the blob metadata, so the budget is checked
+          // for each blob and the batch is cut at the first one that doesn't
+          // fit before any of them is fetched.
+          uint64_t batchBytes = 0;
+          size_t count = 0;
+          for (; count < batch.size(); ++count) {
+            auto size = sizes[count].hasValue() ? *sizes[count] : 0;
+            if (self->maxBytes_ != 0 &&
+                self->bytesFetched_ + batchBytes + size > self->maxBytes_) {
+              self->budgetExhausted_ = true;
+              break;
+            }
+            batchBytes += size;
+          }
+          batch.resize(count);
+          auto* store = self->edenMount_->getObjectStore();
+          return store
+              ->prefetchBlobs(
+                  HashRange{batch.data(), batch.size()}, self->fetchContext_)
+              .thenValue([self, count, batchBytes, batch = std::move(batch)](
+                             auto&&) {
+                self->filesFetched_ += count;
+                self->bytesFetched_ += batchBytes;
+                self->publisher_->next(self->getProgress());
+                return self->run();
+              });
+        });
+  }
+
+  /**
+   * How many files to look up next: no more than the file budget has left,
+   * and, once the average size of the files fetched is known, about as many
+   * as the byte budget has left room for, so that the sizes of files that
+   * will not be fetched are not looked up.
+   */
+  size_t nextBatchSize() const {
+    uint64_t size = kPrefetchBatchSize;
+    if (maxFiles_ != 0) {
+      size = std::min(size, maxFiles_ - filesFetched_);
+    }
+    if (maxBytes_ != 0 && filesFetched_ != 0) {
+      auto averageBytes = std::max<uint64_t>(1, bytesFetched_ / filesFetched_);
+      size = std::min(size, (maxBytes_ - bytesFetched_) / averageBytes + 1);
+    }
+    return size;
+  }
+
+  PrefetchProgress getProgress() const {
+    PrefetchProgress progress;
+    progress.filesMatched_ref() = blobs_.size();
+    progress.filesFetched_ref() = filesFetched_;
+    progress.bytesFetched_ref() = bytesFetched_;
+    progress.filesPending_ref() = blobs_.size() - filesFetched_;
+    progress.budgetExhausted_ref() = budgetExhausted_;
+    return progress;
+  }
+
+ private:
+  std::shared_ptr<EdenMount> edenMount_;
+  ObjectFetchContext& fetchContext_;
+  const std::vector<Hash> blobs_;
+  const uint64_t maxBytes_;
+  const uint64_t maxFiles_;
+  std::shared_ptr<SynchronizedStreamPublisher<PrefetchProgress>> publisher_;
+  std::shared_ptr<std::atomic<bool>> cancelled_;
+
+  // Only accessed by one batch at a time.
+  size_t next_{0};
+  uint64_t filesFetched_{0};
+  uint64_t bytesFetched_{0};
+  bool budgetExhausted_{false};
+};
+} // namespace
+
+apache::thrift::ServerStream<PrefetchProgress>
+EdenServiceHandler::streamPrefetch(std::unique_ptr<PrefetchParams> params) {
+  auto& mountPoint = *params->mountPoint_ref();
+  auto helper =
+      INSTRUMENT_THRIFT_CALL(DBG2, mountPoint, toLogArg(*params->globs_ref()));
+  helper->setPermit(admitClient(getAndRegisterClientPid(), __func__));
+  if (*params->maxBytes_ref() < 0 || *params->maxFiles_ref() < 0) {
+    throw newEdenError(
+        EdenErrorType::ARGUMENT_ERROR,
+        "the prefetch budget cannot be negative");
+  }
+  auto edenMount = server_->getMount(AbsolutePathPiece{mountPoint});
+  auto globRoot =
+      compileGlobs(*params->globs_ref(), *params->includeDotfiles_ref());
+
+  // Warming the caches must not delay the interactive fetches nor the
+  // filesystem requests.
+  auto& fetchContext = helper->getFetchContext();
+  fetchContext.setPriority(ImportPriority::kLow());
+  fetchContext.setPrefetchMetadata(true);
+  BackgroundWorkGuard backgroundWork;
+
+  auto cancelled = std::make_shared<std::atomic<bool>>(false);
+  auto [serverStream, streamPublisher] =
+      apache::thrift::ServerStream<PrefetchProgress>::createPublisher(
+          [cancelled] { cancelled->store(true); });
+  auto publisher =
+      std::make_shared<SynchronizedStreamPublisher<PrefetchProgress>>(
+          std::move(streamPublisher));
+
+  auto fileBlobsToPrefetch =
+      std::make_shared<folly::Synchronized<std::vector<Hash>>>();
+  auto originRootIds = std::make_unique<std::vector<RootId>>();
+  std::vector<folly::Future<std::vector<GlobNode::GlobResult>>> globResults;
+  auto& revisions = *params->revisions_ref();
+  if (!revisions.empty()) {
+    // Reserve so that emplacing doesn't invalidate the references to the
+    // earlier root IDs held by the evaluations.
+    originRootIds->reserve(revisions.size());
+    for (auto& revision : revisions) {
+      const RootId& originRootId = originRootIds->emplace_back(
+          edenMount->getObjectStore()->parseRootId(revision));
+      globResults.emplace_back(
+          edenMount->getObjectStore()
+              ->getRootTree(originRootId, fetchContext)
+              .thenValue([edenMount,
+                          globRoot,
+                          &fetchContext,
+                          fileBlobsToPrefetch,
+                          &originRootId](std::shared_ptr<const Tree>&& tree) {
+                return globRoot->evaluate(
+                    edenMount->getObjectStore(),
+                    fetchContext,
+                    RelativePathPiece(),
+                    std::move(tree),
+                    fileBlobsToPrefetch,
+                    originRootId);
+              }));
+    }
+  } else {
+    const RootId& originRootId =
+        originRootIds->emplace_back(edenMount->getParentCommit());
+    globResults.emplace_back(evaluateGlobAt(
+        globRoot,
+        *edenMount->getObjectStore(),
+        fetchContext,
+        edenMount->getRootInode(),
+        RelativePathPiece{},
+        fileBlobsToPrefetch,
+        originRootId));
+  }
+
+  auto* threadPool = server_->getServerState()->getThreadPool().get();
+  auto prefetchFuture =
+      folly::collectAll(std::move(globResults))
+          .via(threadPool)
+          .thenValue([edenMount,
+                      fileBlobsToPrefetch,
+                      &fetchContext,
+                      maxBytes = *params->maxBytes_ref(),
+                      maxFiles = *params->maxFiles_ref(),
+                      publisher,
+                      cancelled](std::vector<folly::Try<
+                                     std::vector<GlobNode::GlobResult>>>&&
+                                     results) {
+            for (auto& result : results) {
+              result.throwUnlessValue();
+            }
+            auto blobs = std::move(*fileBlobsToPrefetch->wlock());
+            std::sort(blobs.begin(), blobs.end());
+            blobs.erase(std::unique(blobs.begin(), blobs.end()), blobs.end());
+            auto job = std::make_shared<PrefetchJob>(
+                edenMount,
+                fetchContext,
+                std::move(blobs),
+                static_cast<uint64_t>(maxBytes),
+                static_cast<uint64_t>(maxFiles),
+                publisher,
+                cancelled);
+            publisher->next(job->getProgress());
+            return job->run().ensure([job] {});
+          })
+          .thenTry([publisher](folly::Try<folly::Unit>&& result) {
+            publisher->complete(
+                result.hasException() ? std::move(result.exception())
+                                      : folly::exception_wrapper{});
+          })
+          .ensure([helper = std::move(helper),
+                   globRoot,
+                   originRootIds = std::move(originRootIds)]() {
+            // keep the glob state alive until the end
+          });
+  folly::futures::detachOn(threadPool, std::move(prefetchFuture).semi());
+
+  return std::move(serverStream);
+}
+
 void EdenServiceHandler::async_tm_getScmStatus(
     unique_ptr<apache::thrift::HandlerCallback<unique_ptr<ScmStatus>>> callback,
     unique_ptr<string> mountPoint,
@@ -1699,6 +2633,7 @@ void EdenServiceHandler::async_tm_getScmStatus(
         *mountPoint,
         folly::to<string>("listIgnored=", listIgnored ? "true" : "false"),
         folly::to<string>("commitHash=", logHash(*commitHash)));
+    helper->setPermit(admitClient(pid, func));
 
     // Unlike getScmStatusV2(), this older getScmStatus() call does not enforce
     // that the caller specified the current commit.  In the future we might
@@ -1734,7 +2669,11 @@ EdenServiceHandler::future_getScmStatusBetweenRevisions(
   auto id2 = mount->getObjectStore()->parseRootId(*newHash);
   return wrapFuture(
       std::move(helper),
-      diffCommitsForStatus(mount->getObjectStore(), id1, id2));
+      diffCommitsForStatus(
+          mount->getObjectStore(),
+          id1,
+          id2,
+          mount->getEdenConfig()->diffMaxConcurrentTreeFetches.getValue()));
 }
 
 void EdenServiceHandler::debugGetScmTree(
@@ -1843,7 +2782,7 @@ void EdenServiceHandler::debugGetScmBlobMetadata(
 
 namespace {
 
-class InodeStatusCallbacks : public TraversalCallbacks {
+class InodeStatusCallbacks : public ConcurrentTraversalCallbacks {
  public:
   explicit InodeStatusCallbacks(
       EdenMount* mount,
@@ -1871,6 +2810,7 @@ class InodeStatusCallbacks : public TraversalCallbacks {
     info.refcount_ref() = fsRefcount;
 
     info.entries_ref()->reserve(entries.size());
+    std::vector<RequestedSize> requestedSizes;
 
     for (auto& entry : entries) {
       TreeInodeEntryDebugInfo entryInfo;
@@ -1900,8 +2840,8 @@ class InodeStatusCallbacks : public TraversalCallbacks {
           dtype_t::Dir != entry.dtype) {
         if (entry.hash.has_value()) {
           // schedule fetching size from ObjectStore::getBlobSize
-          requestedSizes_.push_back(RequestedSize{
-              results_.size(), info.entries_ref()->size(), entry.hash.value()});
+          requestedSizes.push_back(RequestedSize{
+              0, info.entries_ref()->size(), entry.hash.value()});
         } else {
 #ifndef _WIN32
           entryInfo.fileSize_ref() =
@@ -1932,7 +2872,8 @@ class InodeStatusCallbacks : public TraversalCallbacks {
       info.entries_ref()->push_back(entryInfo);
     }
 
-    results_.push_back(std::move(info));
+    visitedTrees_.wlock()->push_back(
+        VisitedTree{path.copy(), std::move(info), std::move(requestedSizes)});
   }
 
   bool shouldRecurse(const ChildEntry& entry) override {
@@ -1946,20 +2887,53 @@ class InodeStatusCallbacks : public TraversalCallbacks {
     return true;
   }
 
+  /**
+   * Called once the traversal completes to store the visited trees in the
+   * results, in the same pre-order as a sequential traversal.
+   */
+  void finish() {
+    auto visitedTrees = visitedTrees_.wlock();
+    std::sort(
+        visitedTrees->begin(),
+        visitedTrees->end(),
+        [](const VisitedTree& a, const VisitedTree& b) {
+          auto aComponents = a.path.components();
+          auto bComponents = b.path.components();
+          return std::lexicographical_compare(
+              aComponents.begin(),
+              aComponents.end(),
+              bComponents.begin(),
+              bComponents.end());
+        });
+
+    results_.reserve(results_.size() + visitedTrees->size());
+    for (auto& tree : *visitedTrees) {
+      for (auto& request : tree.requestedSizes) {
+        request.resultIndex = results_.size();
+        requestedSizes_.push_back(std::move(request));
+      }
+      results_.push_back(std::move(tree.info));
+    }
+    visitedTrees->clear();
+  }
+
   void fillBlobSizes(ObjectFetchContext& fetchContext) {
-    std::vector<folly::Future<folly::Unit>> futures;
-    futures.reserve(requestedSizes_.size());
-    for (auto& request : requestedSizes_) {
-      futures.push_back(mount_->getObjectStore()
-                            ->getBlobSize(request.hash, fetchContext)
-                            .thenValue([this, request](uint64_t blobSize) {
-                              results_.at(request.resultIndex)
-                                  .entries_ref()
-                                  ->at(request.entryIndex)
-                                  .fileSize_ref() = blobSize;
-                            }));
+    std::vector<Hash> hashes;
+    hashes.reserve(requestedSizes_.size());
+    for (const auto& request : requestedSizes_) {
+      hashes.push_back(request.hash);
+    }
+    auto sizes =
+        mount_->getObjectStore()->getBlobSizes(hashes, fetchContext).get();
+    for (size_t i = 0; i < requestedSizes_.size(); ++i) {
+      if (sizes[i].hasValue()) {
+        const auto& request = requestedSizes_[i];
+        results_.at(request.resultIndex)
+            .entries_ref()
+            ->at(request.entryIndex)
+            .fileSize_ref() = sizes[i].value();
+      }
     }
-    folly::collectAll(futures).get();
   }
 
  private:
@@ -1969,10 +2943,17 @@ class InodeStatusCallbacks : public TraversalCallbacks {
     Hash hash;
   };
 
+  struct VisitedTree {
+    RelativePath path;
+    TreeInodeDebugInfo info;
+    std::vector<RequestedSize> requestedSizes;
+  };
+
   EdenMount* mount_;
   int64_t flags_;
   std::vector<TreeInodeDebugInfo>& results_;
   std::vector<RequestedSize> requestedSizes_;
+  folly::Synchronized<std::vector<VisitedTree>> visitedTrees_;
 };
 
 } // namespace
@@ -1996,7 +2977,13 @@ void EdenServiceHandler::debugInodeStatus(
   auto inodePath = inode->getPath().value();
 
   InodeStatusCallbacks callbacks{edenMount.get(), flags, inodeInfo};
-  traverseObservedInodes(*inode, inodePath, callbacks);
+  traverseObservedInodesConcurrently(
+      inode,
+      inodePath,
+      callbacks,
+      folly::getKeepAliveToken(edenMount->getServerThreadPool().get()))
+      .get();
+  callbacks.finish();
   callbacks.fillBlobSizes(helper->getFetchContext());
 }
 
@@ -2116,6 +3103,53 @@ void EdenServiceHandler::debugListActivityRecordings(
   result.recordings_ref() = recordings;
 }
 
+folly::SemiFuture<std::unique_ptr<CpuProfileResult>>
+EdenServiceHandler::semifuture_debugProfileCpu(
+    FOLLY_MAYBE_UNUSED int64_t durationSeconds,
+    FOLLY_MAYBE_UNUSED std::unique_ptr<std::string> outputPath) {
+#ifdef __linux__
+  auto helper = INSTRUMENT_THRIFT_CALL(
+      DBG1, folly::to<std::string>(durationSeconds), *outputPath);
+  // Long enough for the profiles wanted in reports, short enough that a
+  // forgotten request doesn't keep the signals coming.
+  constexpr int64_t kMaxDurationSeconds = 600;
+  if (durationSeconds <= 0 || durationSeconds > kMaxDurationSeconds) {
+    throw newEdenError(
+        EINVAL,
+        EdenErrorType::ARGUMENT_ERROR,
+        "the profile duration must be between 1 and ",
+        kMaxDurationSeconds,
+        " seconds");
+  }
+  AbsolutePath path;
+  try {
+    path = AbsolutePath{*outputPath};
+  } catch (const std::exception&) {
+    throw newEdenError(
+        EINVAL, EdenErrorType::ARGUMENT_ERROR, "the output path is invalid");
+  }
+  try {
+    SamplingProfiler::start();
+  } catch (const std::logic_error& ex) {
+    throw newEdenError(EBUSY, EdenErrorType::POSIX_ERROR, ex.what());
+  }
+
+  return wrapSemiFuture(
+      std::move(helper),
+      folly::futures::sleep(std::chrono::seconds{durationSeconds})
+          .defer([path = std::move(path)](folly::Try<folly::Unit>&&) {
+            // The profile is stopped even if the sleep was interrupted.
+            auto profile = SamplingProfiler::stop(path);
+            auto result = std::make_unique<CpuProfileResult>();
+            result->sampleCount_ref() = profile.samples;
+            result->droppedSampleCount_ref() = profile.droppedSamples;
+            return result;
+          }));
+#else
+  NOT_IMPLEMENTED();
+#endif
+}
+
 void EdenServiceHandler::debugGetInodePath(
     InodePathDebugInfo& info,
     std::unique_ptr<std::string> mountPoint,
@@ -2193,6 +3227,48 @@ void EdenServiceHandler::getAccessCounts(
   }
 }
 
+void EdenServiceHandler::getFetchCosts(
+    GetFetchCostsResult& result,
+    bool clear) {
+  auto helper = INSTRUMENT_THRIFT_CALL(DBG3);
+
+  result.cmdsByPid_ref() =
+      server_->getServerState()->getProcessNameCache()->getAllProcessNames();
+
+  for (auto& mount : server_->getMountPoints()) {
+    auto& attribution = mount->getObjectStore()->getFetchAttribution();
+    auto entries = attribution.getEntries();
+    if (clear) {
+      attribution.clear();
+    }
+
+    auto& costs = result.costsByMount_ref()[mount->getPath().value()];
+    for (const auto& entry : entries) {
+      FetchCost& cost = costs.emplace_back();
+      cost.pid_ref() = entry.cause.pid;
+      switch (entry.cause.cause) {
+        case ObjectFetchContext::Fs:
+          cost.cause_ref() = FetchCause::FS;
+          break;
+        case ObjectFetchContext::Thrift:
+          cost.cause_ref() = FetchCause::THRIFT;
+          break;
+        case ObjectFetchContext::Unknown:
+          cost.cause_ref() = FetchCause::UNKNOWN;
+          break;
+      }
+      cost.localStoreReads_ref() = entry.localStoreReads;
+      cost.treeImports_ref() =
+          entry.backingStoreImports[ObjectFetchContext::Tree];
+      cost.blobImports_ref() =
+          entry.backingStoreImports[ObjectFetchContext::Blob];
+      cost.blobMetadataImports_ref() =
+          entry.backingStoreImports[ObjectFetchContext::BlobMetadata];
+      cost.overestimate_ref() = entry.overestimate;
+    }
+  }
+}
+
 void EdenServiceHandler::clearAndCompactLocalStore() {
   auto helper = INSTRUMENT_THRIFT_CALL(DBG1);
   server_->getLocalStore()->clearCachesAndCompactAll();
@@ -2275,6 +3351,49 @@ void EdenServiceHandler::getStatInfo(
     result.mountPointJournalInfo_ref() = mountPointJournalInfo;
   }
 
+  if (statsMask & eden_constants::STATS_INODE_MEMORY_) {
+    std::map<PathString, MountInodeMemoryUsage> memoryUsage;
+    for (auto& mount : server_->getMountPoints()) {
+      auto inodeUsage = mount->getInodeMap()->estimateMemoryUsage();
+      MountInodeMemoryUsage usage;
+      usage.inodeMapBytes_ref() = inodeUsage.inodeMapBytes;
+      usage.unloadedInodeBytes_ref() = inodeUsage.unloadedInodeBytes;
+      usage.treeInodeBytes_ref() = inodeUsage.treeInodeBytes;
+      usage.fileInodeBytes_ref() = inodeUsage.fileInodeBytes;
+#ifndef _WIN32
+      usage.inodeMetadataBytes_ref() =
+          mount->getInodeMetadataTable()->estimateMemoryUsage();
+#else
+      usage.inodeMetadataBytes_ref() = 0;
+#endif
+      memoryUsage[mount->getPath().stringPiece().str()] = usage;
+    }
+    result.mountPointInodeMemoryUsage_ref() = std::move(memoryUsage);
+  }
+
+#ifndef _WIN32
+  if (statsMask & eden_constants::STATS_FUSE_LATENCIES_) {
+    std::map<PathString, std::map<std::string, FuseOpcodeLatency>> latencies;
+    for (auto& mount : server_->getMountPoints()) {
+      auto* fuseChannel = mount->getFuseChannel();
+      if (!fuseChannel) {
+        continue;
+      }
+      auto& mountLatencies = latencies[mount->getPath().stringPiece().str()];
+      for (auto& [opcode, percentiles] : fuseChannel->getOpcodeLatencies()) {
+        FuseOpcodeLatency latency;
+        latency.count_ref() = percentiles.count;
+        latency.p50_ref() = percentiles.p50.count();
+        latency.p90_ref() = percentiles.p90.count();
+        latency.p99_ref() = percentiles.p99.count();
+        latency.p999_ref() = percentiles.p999.count();
+        mountLatencies[opcode] = latency;
+      }
+    }
+    result.mountPointFuseLatencies_ref() = std::move(latencies);
+  }
+#endif
+
   if (statsMask & eden_constants::STATS_COUNTERS_) {
     // Get the counters and set number of inodes unloaded by periodic unload
     // job.
@@ -2318,6 +3437,21 @@ void EdenServiceHandler::getStatInfo(
     result.blobCacheStats_ref()->evictionCount_ref() =
         blobCacheStats.evictionCount;
     result.blobCacheStats_ref()->dropCount_ref() = blobCacheStats.dropCount;
+    result.blobCacheStats_ref()->rejectionCount_ref() =
+        blobCacheStats.rejectionCount;
+
+    const auto compressedStats = server_->getBlobCache()->getCompressedStats();
+    result.compressedBlobCacheStats_ref() = CacheStats{};
+    result.compressedBlobCacheStats_ref()->entryCount_ref() =
+        compressedStats.objectCount;
+    result.compressedBlobCacheStats_ref()->totalSizeInBytes_ref() =
+        compressedStats.totalSizeInBytes;
+    result.compressedBlobCacheStats_ref()->hitCount_ref() =
+        compressedStats.hitCount;
+    result.compressedBlobCacheStats_ref()->missCount_ref() =
+        compressedStats.missCount;
+    result.compressedBlobCacheStats_ref()->evictionCount_ref() =
+        compressedStats.evictionCount;
 
     const auto treeCacheStats = server_->getTreeCache()->getStats();
     result.treeCacheStats_ref() = CacheStats{};
@@ -2328,6 +3462,8 @@ void EdenServiceHandler::getStatInfo(
     result.treeCacheStats_ref()->missCount_ref() = treeCacheStats.missCount;
     result.treeCacheStats_ref()->evictionCount_ref() =
         treeCacheStats.evictionCount;
+    result.treeCacheStats_ref()->rejectionCount_ref() =
+        treeCacheStats.rejectionCount;
   }
 }
 
@@ -2336,6 +3472,33 @@ void EdenServiceHandler::flushStatsNow() {
   server_->flushStatsNow();
 }
 
+void EdenServiceHandler::getCounterDelta(
+    CounterDelta& result,
+    int64_t token) {
+  auto helper = INSTRUMENT_THRIFT_CALL(DBG4, token);
+  // The thread-local stats are flushed once a second anyway, so aggregating
+  // them more often wouldn't change the counters.
+  constexpr auto kMinUpdateInterval = std::chrono::seconds{1};
+
+  auto state = counterDeltas_.lock();
+  auto now = std::chrono::steady_clock::now();
+  if (state->lastUpdate == std::chrono::steady_clock::time_point{} ||
+      now - state->lastUpdate >= kMinUpdateInterval) {
+    state->table.update(fb303::ServiceData::get()->getCounters());
+    state->lastUpdate = now;
+  }
+  auto delta = state->table.getChangesSince(static_cast<uint64_t>(token));
+  state.unlock();
+
+  result.token_ref() = static_cast<int64_t>(delta.token);
+  result.full_ref() = delta.full;
+  auto& counters = *result.counters_ref();
+  for (auto& [name, value] : delta.changed) {
+    counters.emplace(std::move(name), value);
+  }
+  *result.removed_ref() = std::move(delta.removed);
+}
+
 Future<Unit> EdenServiceHandler::future_invalidateKernelInodeCache(
     FOLLY_MAYBE_UNUSED std::unique_ptr<std::string> mountPoint,
     FOLLY_MAYBE_UNUSED std::unique_ptr<std::string> path) {
@@ -2399,6 +3562,28 @@ void EdenServiceHandler::getTracePoints(std::vector<TracePoint>& result) {
   }
 }
 
+void EdenServiceHandler::startTraceExport(std::unique_ptr<std::string> path) {
+  auto helper = INSTRUMENT_THRIFT_CALL(INFO, *path);
+  std::unique_ptr<ChromeTraceExporter> exporter;
+  try {
+    exporter = std::make_unique<ChromeTraceExporter>(
+        AbsolutePathPiece{*path}.stringPiece());
+  } catch (const std::exception& ex) {
+    throw newEdenError(ex);
+  }
+  eden::enableTracing();
+  // The previous exporter, if any, finishes writing its file when destroyed.
+  auto previous = std::exchange(*traceExporter_.wlock(), std::move(exporter));
+}
+
+void EdenServiceHandler::stopTraceExport() {
+  auto helper = INSTRUMENT_THRIFT_CALL(INFO);
+  auto exporter = std::move(*traceExporter_.wlock());
+  if (exporter) {
+    XLOG(INFO) << "Stopping the trace export to " << exporter->getPath();
+  }
+}
+
 namespace {
 std::optional<folly::exception_wrapper> getFaultError(
     apache::thrift::optional_field_ref<std::string&> errorType,
@@ -2516,6 +3701,18 @@ void EdenServiceHandler::getDaemonInfo(DaemonInfo& result) {
   auto now = std::chrono::steady_clock::now();
   std::chrono::duration<float> uptime = now - server_->getStartTime();
   result.uptime_ref() = uptime.count();
+
+  // Clients may start using each mount as soon as it is RUNNING, rather than
+  // waiting for the daemon to remount all of them.
+  std::map<PathString, MountState> mountStates;
+  for (const auto& edenMount : server_->getAllMountPoints()) {
+    mountStates[edenMount->getPath().stringPiece().str()] =
+        edenMount->getState();
+  }
+  for (auto& mountPath : server_->getPendingStartupMounts()) {
+    mountStates.emplace(std::move(mountPath), MountState::UNINITIALIZED);
+  }
+  result.mountStates_ref() = std::move(mountStates);
 }
 
 void EdenServiceHandler::checkPrivHelper(PrivHelperInfo& result) {
@@ -2546,6 +3743,26 @@ void EdenServiceHandler::getConfig(
   result = config->toThriftConfigData();
 }
 
+ThriftClientLimiter::Permit EdenServiceHandler::admitClient(
+    std::optional<pid_t> pid,
+    folly::StringPiece method) {
+  auto config = server_->getServerState()->getReloadableConfig().getEdenConfig(
+      ConfigReloadBehavior::NoReload);
+  ThriftClientLimiter::Limits limits;
+  limits.maxConcurrentRequests =
+      config->thriftMaxConcurrentRequestsPerClient.getValue();
+  limits.maxRequestsPerSecond =
+      config->thriftMaxRequestsPerClientPerSecond.getValue();
+  try {
+    return clientLimiter_.admit(pid, method, limits);
+  } catch (const EdenError&) {
+    server_->getStats()
+        ->getThriftStatsForCurrentThread()
+        .rejectedOverloaded.addValue(1);
+    throw;
+  }
+}
+
 std::optional<pid_t> EdenServiceHandler::getAndRegisterClientPid() {
 #ifndef _WIN32
   // The Cpp2RequestContext for a thrift request is kept in a thread local
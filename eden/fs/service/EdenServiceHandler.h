@@ -7,9 +7,15 @@
 
 #pragma once
 
+#include <folly/Synchronized.h>
+#include <chrono>
+#include <mutex>
 #include <optional>
 #include "eden/fs/eden-config.h"
+#include "eden/fs/service/ThriftClientLimiter.h"
 #include "eden/fs/service/gen-cpp2/StreamingEdenService.h"
+#include "eden/fs/telemetry/ChromeTraceWriter.h"
+#include "eden/fs/telemetry/CounterDeltaTable.h"
 #include "eden/fs/utils/PathFuncs.h"
 #include "fb303/BaseService.h"
 
@@ -25,6 +31,7 @@ class Hash20;
 using Hash = Hash20;
 class EdenMount;
 class EdenServer;
+class ThriftPermissionChecker;
 class TreeInode;
 class ObjectFetchContext;
 #ifdef EDEN_HAVE_USAGE_SERVICE
@@ -49,6 +56,10 @@ class EdenServiceHandler : virtual public StreamingEdenServiceSvIf,
 
   std::unique_ptr<apache::thrift::AsyncProcessor> getProcessor() override;
 
+  const std::shared_ptr<ThriftPermissionChecker>& getPermissionChecker() const {
+    return permissionChecker_;
+  }
+
   fb303::cpp2::fb303_status getStatus() override;
 
   void mount(std::unique_ptr<MountArgument> mount) override;
@@ -92,7 +103,8 @@ class EdenServiceHandler : virtual public StreamingEdenServiceSvIf,
   void getFilesChangedSince(
       FileDelta& out,
       std::unique_ptr<std::string> mountPoint,
-      std::unique_ptr<JournalPosition> fromPosition) override;
+      std::unique_ptr<JournalPosition> fromPosition,
+      std::unique_ptr<std::string> root) override;
 
   void setJournalMemoryLimit(
       std::unique_ptr<PathString> mountPoint,
@@ -129,7 +141,8 @@ class EdenServiceHandler : virtual public StreamingEdenServiceSvIf,
       int32_t gid) override;
 
   apache::thrift::ServerStream<JournalPosition> subscribeStreamTemporary(
-      std::unique_ptr<std::string> mountPoint) override;
+      std::unique_ptr<std::string> mountPoint,
+      std::unique_ptr<std::string> root) override;
 
 #ifndef _WIN32
   apache::thrift::ServerStream<FsEvent> traceFsEvents(
@@ -140,11 +153,20 @@ class EdenServiceHandler : virtual public StreamingEdenServiceSvIf,
   apache::thrift::ServerStream<HgEvent> traceHgEvents(
       std::unique_ptr<std::string> mountPoint) override;
 
+  apache::thrift::ServerStream<Glob> streamGlobFiles(
+      std::unique_ptr<GlobParams> params) override;
+
   void async_tm_getScmStatusV2(
       std::unique_ptr<apache::thrift::HandlerCallback<
           std::unique_ptr<GetScmStatusResult>>> callback,
       std::unique_ptr<GetScmStatusParams> params) override;
 
+  apache::thrift::ServerStream<ScmStatus> streamScmStatus(
+      std::unique_ptr<GetScmStatusParams> params) override;
+
+  apache::thrift::ServerStream<PrefetchProgress> streamPrefetch(
+      std::unique_ptr<PrefetchParams> params) override;
+
   void async_tm_getScmStatus(
       std::unique_ptr<
           apache::thrift::HandlerCallback<std::unique_ptr<ScmStatus>>> callback,
@@ -203,6 +225,11 @@ class EdenServiceHandler : virtual public StreamingEdenServiceSvIf,
       ListActivityRecordingsResult& result,
       std::unique_ptr<std::string> mountPoint) override;
 
+  folly::SemiFuture<std::unique_ptr<CpuProfileResult>>
+  semifuture_debugProfileCpu(
+      int64_t durationSeconds,
+      std::unique_ptr<std::string> outputPath) override;
+
   void debugGetInodePath(
       InodePathDebugInfo& inodePath,
       std::unique_ptr<std::string> mountPoint,
@@ -228,6 +255,8 @@ class EdenServiceHandler : virtual public StreamingEdenServiceSvIf,
 
   void flushStatsNow() override;
 
+  void getCounterDelta(CounterDelta& result, int64_t token) override;
+
   folly::Future<folly::Unit> future_invalidateKernelInodeCache(
       std::unique_ptr<std::string> mountPoint,
       std::unique_ptr<std::string> path) override;
@@ -240,6 +269,10 @@ class EdenServiceHandler : virtual public StreamingEdenServiceSvIf,
   void disableTracing() override;
   void getTracePoints(std::vector<TracePoint>& result) override;
 
+  void getFetchCosts(GetFetchCostsResult& result, bool clear) override;
+  void startTraceExport(std::unique_ptr<std::string> path) override;
+  void stopTraceExport() override;
+
   void injectFault(std::unique_ptr<FaultDefinition> fault) override;
   bool removeFault(std::unique_ptr<RemoveFaultArg> fault) override;
   int64_t unblockFault(std::unique_ptr<UnblockFaultArg> info) override;
@@ -290,15 +323,14 @@ class EdenServiceHandler : virtual public StreamingEdenServiceSvIf,
   std::optional<pid_t> getAndRegisterClientPid();
 
  private:
-  folly::Future<Hash> getSHA1ForPath(
-      AbsolutePathPiece mountPoint,
-      folly::StringPiece path,
-      ObjectFetchContext& fetchContext);
-
-  folly::Future<Hash> getSHA1ForPathDefensively(
-      AbsolutePathPiece mountPoint,
-      folly::StringPiece path,
-      ObjectFetchContext& fetchContext) noexcept;
+  /**
+   * Admit an expensive request of the calling client, see
+   * ThriftClientLimiter. The request counts as in flight until the returned
+   * permit is destroyed.
+   */
+  ThriftClientLimiter::Permit admitClient(
+      std::optional<pid_t> pid,
+      folly::StringPiece method);
 
   folly::Future<std::unique_ptr<Glob>> _globFiles(
       folly::StringPiece mountPoint,
@@ -322,6 +354,18 @@ class EdenServiceHandler : virtual public StreamingEdenServiceSvIf,
 #endif
   const std::vector<std::string> originalCommandLine_;
   EdenServer* const server_;
+  // Shared by the processors of all the threads, which all see every
+  // connection.
+  const std::shared_ptr<ThriftPermissionChecker> permissionChecker_;
+  ThriftClientLimiter clientLimiter_;
+
+  struct CounterDeltaState {
+    CounterDeltaTable table;
+    std::chrono::steady_clock::time_point lastUpdate;
+  };
+  folly::Synchronized<CounterDeltaState, std::mutex> counterDeltas_;
+
+  folly::Synchronized<std::unique_ptr<ChromeTraceExporter>> traceExporter_;
 };
 } // namespace eden
 } // namespace facebook
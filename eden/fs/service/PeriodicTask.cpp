@@ -18,50 +18,131 @@ using namespace std::chrono_literals;
 
 namespace {
 constexpr auto kSlowTaskLimit = 50ms;
+
+/**
+ * How long a task that is put off because the filesystem is busy waits before
+ * checking again.
+ */
+constexpr auto kBusyRetryDelay = 1s;
+
+double toMilliseconds(std::chrono::microseconds duration) {
+  return duration.count() / 1000.0;
 }
+} // namespace
 
 namespace facebook {
 namespace eden {
 
 PeriodicTask::PeriodicTask(EdenServer* server, folly::StringPiece name)
-    : server_{server}, name_{name.str()}, interval_{0} {}
+    : PeriodicTask{server, name, Options{}} {}
+
+PeriodicTask::PeriodicTask(
+    EdenServer* server,
+    folly::StringPiece name,
+    Options options)
+    : server_{server}, name_{name.str()}, options_{options}, interval_{0} {}
+
+PeriodicTask::~PeriodicTask() {
+  waitForBackgroundRun();
+}
+
+void PeriodicTask::waitForBackgroundRun() {
+  std::unique_lock<std::mutex> lock{background_->mutex};
+  background_->stopped = true;
+  background_->idle.wait(lock, [&] { return !background_->running; });
+}
 
 void PeriodicTask::timeoutExpired() noexcept {
-  folly::stop_watch<> timer;
+  if (options_.deferWhenBusy && shouldDefer()) {
+    XLOG(DBG4) << "putting off periodic task " << name_
+               << " while the filesystem is busy";
+    server_->getMainEventBase()->timer().scheduleTimeout(
+        this, std::chrono::duration_cast<Duration>(kBusyRetryDelay));
+    return;
+  }
+  deferredSince_.reset();
+
+  running_ = true;
+  if (!options_.background) {
+    finishRun(run());
+    return;
+  }
+  server_->getMaintenanceExecutor()->add([this, state = background_] {
+    {
+      std::lock_guard<std::mutex> lock{state->mutex};
+      if (state->stopped) {
+        return;
+      }
+      state->running = true;
+    }
+    auto duration = run();
+    // Grab the EventBase before the destructor may go ahead.
+    auto* mainEventBase = server_->getMainEventBase();
+    {
+      std::lock_guard<std::mutex> lock{state->mutex};
+      state->running = false;
+    }
+    state->idle.notify_all();
+    // The task is only destroyed on the main EventBase thread, so checking
+    // stopped there is safe.
+    mainEventBase->runInEventBaseThread([this, state, duration] {
+      if (!state->stopped) {
+        finishRun(duration);
+      }
+    });
+  });
+}
+
+std::chrono::microseconds PeriodicTask::run() noexcept {
+  folly::stop_watch<std::chrono::microseconds> timer;
   try {
-    running_ = true;
     runTask();
   } catch (const std::exception& ex) {
     XLOG(ERR) << "error running periodic task " << name_ << ": "
               << folly::exceptionStr(ex);
   }
+  return timer.elapsed();
+}
+
+void PeriodicTask::finishRun(std::chrono::microseconds duration) {
   running_ = false;
 
+  XLOG(DBG6) << "ran periodic task " << name_ << " in "
+             << toMilliseconds(duration) << "ms";
+
   // Log a warning if any of the periodic tasks take longer than 50ms to run.
   // Since these run on the main EventBase thread we want to ensure that they
   // don't block this thread for long periods of time.
-  auto duration = timer.elapsed();
-  XLOG(DBG6) << "ran periodic task " << name_ << " in "
-             << (std::chrono::duration_cast<std::chrono::microseconds>(duration)
-                     .count() /
-                 1000.0)
-             << "ms";
-  if (duration > kSlowTaskLimit) {
+  if (!options_.background && duration > kSlowTaskLimit) {
     // Just in case some task starts frequently running slowly for some reason,
     // put some rate limiting on this log message.
     // Using popcount() give us exponential backoff.
     ++slowCount_;
     if (folly::popcount(slowCount_) == 1) {
       XLOG(WARN) << "slow periodic task: " << name_ << " took "
-                 << (std::chrono::duration_cast<std::chrono::microseconds>(
-                         duration)
-                         .count() /
-                     1000.0)
-                 << "ms; has run slowly " << slowCount_ << " times";
+                 << toMilliseconds(duration) << "ms; has run slowly "
+                 << slowCount_ << " times";
     }
   }
 
-  reschedule();
+  reschedule(duration);
+}
+
+bool PeriodicTask::isFilesystemBusy() const {
+  return server_->isFilesystemBusy();
+}
+
+bool PeriodicTask::shouldDefer() {
+  if (!isFilesystemBusy()) {
+    return false;
+  }
+  // Never put a task off by more than one interval, so that it still runs
+  // on a mount that stays busy for hours.
+  auto now = std::chrono::steady_clock::now();
+  if (!deferredSince_) {
+    deferredSince_ = now;
+  }
+  return now - *deferredSince_ < interval_;
 }
 
 void PeriodicTask::updateInterval(Duration interval, bool splay) {
@@ -92,11 +173,21 @@ void PeriodicTask::updateInterval(Duration interval, bool splay) {
       this, initialScheduleTime);
 }
 
-void PeriodicTask::reschedule() {
+void PeriodicTask::reschedule(std::chrono::microseconds lastRunDuration) {
   if (interval_ <= Duration(0)) {
     return;
   }
-  server_->getMainEventBase()->timer().scheduleTimeout(this, interval_);
+  auto delay = interval_;
+  if (options_.maxDutyCycle > 0) {
+    delay = std::max(
+        delay,
+        std::chrono::duration_cast<Duration>(
+            lastRunDuration / options_.maxDutyCycle));
+  }
+  if (options_.jitter) {
+    delay += Duration(folly::Random::rand64(delay.count() / 10 + 1));
+  }
+  server_->getMainEventBase()->timer().scheduleTimeout(this, delay);
 }
 
 } // namespace eden
@@ -8,6 +8,10 @@
 #pragma once
 
 #include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
 
 #include <folly/Range.h>
@@ -22,9 +26,10 @@ class EdenServer;
  * A helper class for implementing periodic tasks that should be run by
  * EdenServer.
  *
- * Tasks will run on the main EventBase thread.  As a result tasks should
- * complete relatively quickly.  If a task needs to perform an expensive
- * operation it should schedule it in a separate executor.
+ * Tasks will run on the main EventBase thread by default.  As a result tasks
+ * should complete relatively quickly.  Maintenance work that can take longer
+ * should set Options::background to run on the EdenServer's maintenance
+ * thread instead, where it also does not delay the other tasks' timers.
  */
 class PeriodicTask : private folly::HHWheelTimer::Callback {
  public:
@@ -32,7 +37,44 @@ class PeriodicTask : private folly::HHWheelTimer::Callback {
   // Unfortunately HHWheelTimer does not expose this as a class member.
   using Duration = std::chrono::milliseconds;
 
+  struct Options {
+    /**
+     * Run the task on the EdenServer's maintenance thread rather than on the
+     * main EventBase.  The background tasks run one at a time, so they never
+     * compete with each other for CPU or disk.
+     */
+    bool background;
+
+    /**
+     * Put the task off while EdenServer reports the filesystem as busy, by at
+     * most one interval.
+     */
+    bool deferWhenBusy;
+
+    /**
+     * Add up to 10% of the interval to each run, so tasks with the same
+     * interval drift apart rather than keep firing together.
+     */
+    bool jitter;
+
+    /**
+     * If non-zero, the largest share of the time the task may spend running.
+     * A run that takes longer pushes the next one back accordingly.
+     */
+    double maxDutyCycle;
+
+    /**
+     * For heavy maintenance work, which should stay out of the way of
+     * filesystem requests.
+     */
+    static Options maintenance() {
+      return Options{true, true, true, 0.05};
+    }
+  };
+
   PeriodicTask(EdenServer* server, folly::StringPiece name);
+  PeriodicTask(EdenServer* server, folly::StringPiece name, Options options);
+  virtual ~PeriodicTask();
 
   EdenServer* getServer() const {
     return server_;
@@ -75,16 +117,51 @@ class PeriodicTask : private folly::HHWheelTimer::Callback {
    */
   virtual void runTask() = 0;
 
+  /**
+   * Whether a task with Options::deferWhenBusy should be put off.  Defaults to
+   * EdenServer::isFilesystemBusy().
+   */
+  virtual bool isFilesystemBusy() const;
+
+  /**
+   * Keep queued background runs from starting, and wait for the one in
+   * progress to finish.  The destructor calls this, but a subclass' members
+   * are gone by then, so a subclass whose runTask() uses them should call it
+   * from its own destructor.  The task must not be rescheduled afterwards.
+   */
+  void waitForBackgroundRun();
+
  private:
+  /**
+   * Shared with the background runs queued on the maintenance thread, which
+   * may outlive the task.
+   */
+  struct BackgroundState {
+    std::mutex mutex;
+    std::condition_variable idle;
+    bool stopped{false};
+    bool running{false};
+  };
+
   /**
    * Implementation of the HHWheelTimer::Callback interface.
    */
   void timeoutExpired() noexcept override final;
 
-  void reschedule();
+  /**
+   * Calls runTask(), and returns how long it took.
+   */
+  std::chrono::microseconds run() noexcept;
+  void finishRun(std::chrono::microseconds duration);
+  bool shouldDefer();
+  void reschedule(std::chrono::microseconds lastRunDuration);
 
   EdenServer* const server_;
   std::string const name_;
+  Options const options_;
+
+  std::shared_ptr<BackgroundState> background_{
+      std::make_shared<BackgroundState>()};
 
   /*
    * PeriodicTask objects are only ever used from the EdenServer's main
@@ -107,6 +184,12 @@ class PeriodicTask : private folly::HHWheelTimer::Callback {
    * running_ is set to true while runTask() is running.
    */
   bool running_{false};
+
+  /**
+   * When the task was first put off because the filesystem was busy, while it
+   * still is.
+   */
+  std::optional<std::chrono::steady_clock::time_point> deferredSince_;
 };
 
 } // namespace eden
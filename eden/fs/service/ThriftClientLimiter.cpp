@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/service/ThriftClientLimiter.h"
+
+#include <folly/logging/xlog.h>
+#include "eden/fs/utils/EdenError.h"
+
+namespace facebook {
+namespace eden {
+
+namespace {
+// The number of tracked clients past which the idle ones are forgotten.
+constexpr size_t kMaxIdleClients = 1024;
+
+double refill(
+    double tokens,
+    double rate,
+    std::chrono::steady_clock::duration elapsed) {
+  auto seconds = std::chrono::duration<double>{elapsed}.count();
+  return std::min(std::max(rate, 1.0), tokens + seconds * rate);
+}
+} // namespace
+
+void ThriftClientLimiter::Permit::release() {
+  if (!limiter_) {
+    return;
+  }
+  auto state = std::exchange(limiter_, nullptr)->state_.lock();
+  auto it = state->clients.find(pid_);
+  XDCHECK(it != state->clients.end());
+  if (it != state->clients.end() && it->second.inFlight > 0) {
+    --it->second.inFlight;
+  }
+}
+
+ThriftClientLimiter::Permit ThriftClientLimiter::admit(
+    std::optional<pid_t> pid,
+    folly::StringPiece method,
+    const Limits& limits,
+    std::chrono::steady_clock::time_point now) {
+  if (!pid ||
+      (limits.maxConcurrentRequests == 0 && limits.maxRequestsPerSecond <= 0)) {
+    return Permit{};
+  }
+
+  auto state = state_.lock();
+  if (state->clients.size() > kMaxIdleClients) {
+    evictIdleClients(*state, limits, now);
+  }
+  auto [it, inserted] = state->clients.try_emplace(*pid);
+  auto& client = it->second;
+  if (inserted) {
+    client.tokens = std::max(limits.maxRequestsPerSecond, 1.0);
+    client.lastRefill = now;
+    client.lruPosition = state->lru.insert(state->lru.end(), *pid);
+  } else {
+    state->lru.splice(state->lru.end(), state->lru, client.lruPosition);
+  }
+  client.lastAdmit = now;
+
+  if (limits.maxConcurrentRequests != 0 &&
+      client.inFlight >= limits.maxConcurrentRequests) {
+    XLOG(DBG2) << "rejecting " << method << "() from pid " << *pid
+               << ": already " << client.inFlight << " requests in flight";
+    throw newEdenError(
+        EAGAIN,
+        EdenErrorType::OVERLOADED,
+        "too many concurrent requests from this process: ",
+        client.inFlight,
+        " in flight, the limit is ",
+        limits.maxConcurrentRequests);
+  }
+  if (limits.maxRequestsPerSecond > 0) {
+    client.tokens = refill(
+        client.tokens, limits.maxRequestsPerSecond, now - client.lastRefill);
+    client.lastRefill = now;
+    if (client.tokens < 1) {
+      XLOG(DBG2) << "rejecting " << method << "() from pid " << *pid
+                 << ": over its request rate";
+      throw newEdenError(
+          EAGAIN,
+          EdenErrorType::OVERLOADED,
+          "too many requests from this process: the limit is ",
+          limits.maxRequestsPerSecond,
+          " per second");
+    }
+    client.tokens -= 1;
+  }
+
+  ++client.inFlight;
+  return Permit{this, *pid};
+}
+
+void ThriftClientLimiter::evictIdleClients(
+    State& state,
+    const Limits& limits,
+    std::chrono::steady_clock::time_point now) {
+  // An empty bucket refills in this long, so the bucket of a client admitted
+  // earlier than that is full.
+  auto refillTime = std::chrono::duration<double>{
+      limits.maxRequestsPerSecond > 0
+          ? std::max(limits.maxRequestsPerSecond, 1.0) /
+              limits.maxRequestsPerSecond
+          : 0.0};
+  for (auto lruIt = state.lru.begin(); lruIt != state.lru.end();) {
+    auto it = state.clients.find(*lruIt);
+    XDCHECK(it != state.clients.end());
+    if (now - it->second.lastAdmit < refillTime) {
+      // The clients after this one were admitted even more recently.
+      break;
+    }
+    if (it->second.inFlight == 0) {
+      state.clients.erase(it);
+      lruIt = state.lru.erase(lruIt);
+    } else {
+      ++lruIt;
+    }
+  }
+}
+
+} // namespace eden
+} // namespace facebook
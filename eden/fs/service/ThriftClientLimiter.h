@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <folly/container/F14Map.h>
+#include <folly/portability/SysTypes.h>
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Bounds the expensive Thrift requests, such as globs and status, that each
+ * client process may have in flight and may start per second, so that a
+ * client calling them in a loop can't starve the filesystem.
+ *
+ * Requests over budget are rejected with an OVERLOADED EdenError before any
+ * work starts, and may be retried later.
+ */
+class ThriftClientLimiter {
+ public:
+  struct Limits {
+    /** 0 lets a client have any number of requests in flight. */
+    size_t maxConcurrentRequests{0};
+    /** 0 lets a client start any number of requests per second. */
+    double maxRequestsPerSecond{0};
+  };
+
+  /**
+   * Counts a request as in flight until destroyed.
+   */
+  class Permit {
+   public:
+    Permit() = default;
+    Permit(Permit&& other) noexcept
+        : limiter_{std::exchange(other.limiter_, nullptr)},
+          pid_{other.pid_} {}
+    Permit& operator=(Permit&& other) noexcept {
+      release();
+      limiter_ = std::exchange(other.limiter_, nullptr);
+      pid_ = other.pid_;
+      return *this;
+    }
+    ~Permit() {
+      release();
+    }
+
+   private:
+    friend class ThriftClientLimiter;
+
+    Permit(ThriftClientLimiter* limiter, pid_t pid)
+        : limiter_{limiter}, pid_{pid} {}
+
+    void release();
+
+    ThriftClientLimiter* limiter_{nullptr};
+    pid_t pid_{0};
+  };
+
+  ThriftClientLimiter() = default;
+  ThriftClientLimiter(const ThriftClientLimiter&) = delete;
+  ThriftClientLimiter& operator=(const ThriftClientLimiter&) = delete;
+
+  /**
+   * Admit a request of the client, or throw an OVERLOADED EdenError if the
+   * client is over one of its limits. The requests whose client is unknown
+   * are always admitted.
+   */
+  Permit admit(
+      std::optional<pid_t> pid,
+      folly::StringPiece method,
+      const Limits& limits,
+      std::chrono::steady_clock::time_point now =
+          std::chrono::steady_clock::now());
+
+  /** The number of client processes currently tracked. */
+  size_t getClientCount() const {
+    return state_.lock()->clients.size();
+  }
+
+ private:
+  struct Client {
+    size_t inFlight{0};
+    // A token bucket holding up to one second worth of requests.
+    double tokens{0};
+    std::chrono::steady_clock::time_point lastRefill;
+    std::chrono::steady_clock::time_point lastAdmit;
+    // The position of the client in State::lru.
+    std::list<pid_t>::iterator lruPosition;
+  };
+
+  struct State {
+    folly::F14NodeMap<pid_t, Client> clients;
+    // The clients, from the least to the most recently admitted.
+    std::list<pid_t> lru;
+  };
+
+  /**
+   * Forget the clients that don't have requests in flight and were last
+   * admitted long enough ago for their bucket to have refilled, once there
+   * are too many of them. Only the least recently admitted clients are
+   * visited, up to the first one admitted too recently.
+   */
+  static void evictIdleClients(
+      State& state,
+      const Limits& limits,
+      std::chrono::steady_clock::time_point now);
+
+  folly::Synchronized<State, std::mutex> state_;
+};
+
+} // namespace eden
+} // namespace facebook
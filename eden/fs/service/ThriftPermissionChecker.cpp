@@ -7,8 +7,11 @@
 
 #include "eden/fs/service/ThriftPermissionChecker.h"
 
+#include <folly/ScopeGuard.h>
+#include <folly/stop_watch.h>
 #include <thrift/lib/cpp2/server/Cpp2ConnContext.h>
 #include "eden/fs/inodes/ServerState.h"
+#include "eden/fs/telemetry/EdenStats.h"
 
 namespace {
 /**
@@ -71,6 +74,37 @@ void ThriftPermissionChecker::preRead(void* ctx, const char* fn_name) {
   }
   auto* connectionContext = requestContext->getConnectionContext();
 
+  folly::stop_watch<std::chrono::microseconds> watch;
+  SCOPE_EXIT {
+    serverState_->getStats()
+        .getThriftStatsForCurrentThread()
+        .permissionCheck.addValue(watch.elapsed().count());
+  };
+
+  // A reloaded config may have changed who is allowed, so the decisions made
+  // under a previous config are stale.
+  auto config = serverState_->getEdenConfig();
+  const apache::thrift::TConnectionContext* key = connectionContext;
+  {
+    auto allowed = allowedConnections_.rlock();
+    auto it = allowed->find(key);
+    if (it != allowed->end() && it->second == config) {
+      return;
+    }
+  }
+
+  checkConnection(connectionContext, fn_name);
+  allowedConnections_.wlock()->insert_or_assign(key, std::move(config));
+}
+
+void ThriftPermissionChecker::connectionDestroyed(
+    const apache::thrift::TConnectionContext* connectionContext) {
+  allowedConnections_.wlock()->erase(connectionContext);
+}
+
+void ThriftPermissionChecker::checkConnection(
+    apache::thrift::Cpp2ConnContext* connectionContext,
+    const char* fn_name) {
   auto* peerAddress = connectionContext->getPeerAddress();
   if (!peerAddress) {
     throw NotAuthorized{"unknown peer address"};
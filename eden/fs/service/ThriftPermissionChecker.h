@@ -7,12 +7,20 @@
 
 #pragma once
 
+#include <folly/Synchronized.h>
+#include <folly/container/F14Map.h>
 #include <thrift/lib/cpp/TProcessorEventHandler.h>
+#include <memory>
 #include <stdexcept>
 
+namespace apache::thrift {
+class Cpp2ConnContext;
+} // namespace apache::thrift
+
 namespace facebook {
 namespace eden {
 
+class EdenConfig;
 class ServerState;
 
 class NotAuthorized : public std::runtime_error {
@@ -23,6 +31,11 @@ class NotAuthorized : public std::runtime_error {
 /**
  * Throws NotAuthorized in preRead if process connected to Eden's unix domain
  * socket has an effective uid not allowed to access a given Thrift method.
+ *
+ * The peer of a connection doesn't change, so a connection allowed once is
+ * allowed until it is destroyed or the config is reloaded, without checking
+ * its credentials again. Denials are not cached: they are rare, and their
+ * error names the method.
  */
 class ThriftPermissionChecker : public apache::thrift::TProcessorEventHandler {
  public:
@@ -35,8 +48,27 @@ class ThriftPermissionChecker : public apache::thrift::TProcessorEventHandler {
 
   void preRead(void* ctx, const char* fn_name) override;
 
+  /**
+   * Forget the decision cached for a connection. Must be called when the
+   * connection is destroyed, before its context can be reused by another.
+   */
+  void connectionDestroyed(
+      const apache::thrift::TConnectionContext* connectionContext);
+
  private:
+  void checkConnection(
+      apache::thrift::Cpp2ConnContext* connectionContext,
+      const char* fn_name);
+
   std::shared_ptr<ServerState> serverState_;
+
+  /**
+   * The connections allowed so far, with the config they were allowed under.
+   */
+  folly::Synchronized<folly::F14FastMap<
+      const apache::thrift::TConnectionContext*,
+      std::shared_ptr<const EdenConfig>>>
+      allowedConnections_;
 };
 
 } // namespace eden
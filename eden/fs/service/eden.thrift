@@ -91,6 +91,12 @@ enum EdenErrorType {
   * parent that is not the current parent. errorCode will not be set.
   */
   OUT_OF_DATE_PARENT = 8,
+  /**
+  * The calling process has too many expensive requests in flight, or started
+  * too many of them recently. The request can be retried later. errorCode will
+  * be set to EAGAIN.
+  */
+  OVERLOADED = 9,
 }
 
 exception EdenError {
@@ -123,6 +129,11 @@ struct DaemonInfo {
    * Same data from /proc/pid/stat
    */
   4: optional float uptime;
+  /**
+   * The state of every mount point, including the ones still waiting for
+   * their turn to start after a restart, which are UNINITIALIZED.
+   */
+  5: optional map<PathString, MountState> mountStates;
 }
 
 /**
@@ -570,6 +581,13 @@ struct ListActivityRecordingsResult {
   1: list<ActivityRecorderResult> recordings;
 }
 
+struct CpuProfileResult {
+  // The number of samples written to the profile.
+  1: i64 sampleCount;
+  // The number of samples dropped because the profile was full.
+  2: i64 droppedSampleCount;
+}
+
 struct SetLogLevelResult {
   1: bool categoryCreated;
 }
@@ -591,6 +609,25 @@ struct MountInodeInfo {
   5: i64 loadedTreeCount;
 }
 
+/**
+ * Estimates of the memory used by the inodes of a mount point, in bytes. The
+ * Tree and Blob objects are accounted for by treeCacheStats and
+ * blobCacheStats.
+ */
+struct MountInodeMemoryUsage {
+  // The InodeMap entries of the loaded and unloaded inodes.
+  1: i64 inodeMapBytes;
+  // The loaded TreeInodes and their directory entries.
+  2: i64 treeInodeBytes;
+  // The loaded FileInodes and their state.
+  3: i64 fileInodeBytes;
+  // The records and the index of the InodeMetadataTable. Zero on Windows.
+  4: i64 inodeMetadataBytes;
+  // The part of inodeMapBytes used by the unloaded inodes the kernel still
+  // references, including their interned names.
+  5: i64 unloadedInodeBytes;
+}
+
 struct CacheStats {
   1: i64 entryCount;
   2: i64 totalSizeInBytes;
@@ -598,6 +635,21 @@ struct CacheStats {
   4: i64 missCount;
   5: i64 evictionCount;
   6: i64 dropCount;
+  // Objects that the scan-resistant policy declined to keep cached.
+  7: i64 rejectionCount;
+}
+
+/**
+ * The latency distribution of one FUSE opcode, in microseconds. Each
+ * percentile is rounded up to the end of its histogram bucket, which is
+ * within 1/8 of the true value.
+ */
+struct FuseOpcodeLatency {
+  1: i64 count;
+  2: i64 p50;
+  3: i64 p90;
+  4: i64 p99;
+  5: i64 p999;
 }
 
 /*
@@ -609,8 +661,28 @@ const i64 STATS_SMAPS = 0x4;
 const i64 STATS_PRIVATE_BYTES = 0x8;
 const i64 STATS_RSS_BYTES = 0x10;
 const i64 STATS_CACHE_STATS = 0x20;
+const i64 STATS_FUSE_LATENCIES = 0x40;
+const i64 STATS_INODE_MEMORY = 0x80;
 const i64 STATS_ALL = 0xFFFF;
 
+/**
+ * The fb303 counters that changed since a previous getCounterDelta() call.
+ */
+struct CounterDelta {
+  /** The token to pass to the next getCounterDelta() call. */
+  1: i64 token;
+  /**
+   * The token passed was unknown, for example because EdenFS restarted, or
+   * too old: counters holds every counter, and the counters missing from it
+   * no longer exist.
+   */
+  2: bool full;
+  /** The counters added or changed since the token. */
+  3: map<string, i64> counters;
+  /** The counters removed since the token. */
+  4: list<string> removed;
+}
+
 /**
  * Struct to store fb303 counters from ServiceData.getCounters() and inode
  * information of all the mount points.
@@ -667,6 +739,25 @@ struct InternalStats {
    * Populated if STATS_CACHE_STATS is set.
    */
   9: optional CacheStats treeCacheStats;
+  /**
+   * The latency of each FUSE opcode handled since each mount started, keyed
+   * by mount path and then by opcode name.
+   * Populated if STATS_FUSE_LATENCIES is set. Linux and macOS only.
+   */
+  10: optional map<PathString, map<string, FuseOpcodeLatency>> mountPointFuseLatencies;
+  /**
+   * Statistics about the compressed tier of the blob cache, whose sizes are
+   * compressed sizes and whose hits are the blobs decompressed back into the
+   * blob cache.
+   * Populated if STATS_CACHE_STATS is set.
+   */
+  11: optional CacheStats compressedBlobCacheStats;
+  /**
+   * Estimates of the memory used by the inodes of each mount point, keyed by
+   * mount path. This visits every loaded inode.
+   * Populated if STATS_INODE_MEMORY is set.
+   */
+  12: optional map<PathString, MountInodeMemoryUsage> mountPointInodeMemoryUsage;
 }
 
 struct FuseCall {
@@ -823,6 +914,34 @@ struct GetAccessCountsResult {
 // 3: map<pid_t, AccessCount> thriftAccesses
 }
 
+enum FetchCause {
+  UNKNOWN = 0,
+  FS = 1,
+  THRIFT = 2,
+}
+
+/**
+ * The local store reads and backing store imports charged to one process and
+ * interface. Only the heaviest causes of each mount are tracked, so the counts
+ * of a cause may include up to `overestimate` fetches of the causes it
+ * replaced.
+ */
+struct FetchCost {
+  1: pid_t pid;
+  2: FetchCause cause;
+  3: i64 localStoreReads;
+  4: i64 treeImports;
+  5: i64 blobImports;
+  6: i64 blobMetadataImports;
+  7: i64 overestimate;
+}
+
+struct GetFetchCostsResult {
+  1: map<pid_t, binary> cmdsByPid;
+  // The heaviest causes first.
+  2: map<PathString, list<FetchCost>> costsByMount;
+}
+
 enum TracePointEvent {
   // Start of a new block
   START = 0,
@@ -1071,10 +1190,16 @@ service EdenService extends fb303_core.BaseService {
    * This indicates that eden cannot compute the delta for the requested
    * range.  The client will need to recompute a new baseline using
    * other available functions in EdenService.
+   *
+   * When root is set, only the changed, created and unclean paths that are
+   * root or under it are returned, which is much cheaper for clients only
+   * interested in a subtree of the mount. The positions still cover the
+   * changes to the whole mount.
    */
   FileDelta getFilesChangedSince(
     1: PathString mountPoint,
     2: JournalPosition fromPosition,
+    3: PathString root,
   ) throws (1: EdenError ex);
 
   /** Sets the memory limit on the journal such that the journal will forget
@@ -1343,6 +1468,19 @@ service EdenService extends fb303_core.BaseService {
     1: PathString mountPoint,
   );
 
+  /**
+   * Sample the CPU usage of EdenFS for durationSeconds, then write the
+   * samples to outputPath as a pprof profile.
+   *
+   * The samples are labeled with the FUSE request, thrift method or import
+   * being run by the sampled thread. Only one profile can be taken at a time,
+   * and only on Linux.
+   */
+  CpuProfileResult debugProfileCpu(
+    1: i64 durationSeconds,
+    2: PathString outputPath,
+  ) throws (1: EdenError ex);
+
   /**
    * Get the InodePathDebugInfo for the inode that corresponds to the given
    * inode number. This provides the path for the inode and also indicates
@@ -1373,6 +1511,13 @@ service EdenService extends fb303_core.BaseService {
     1: EdenError ex,
   );
 
+  /**
+   * Return the processes charged with the most local store reads and backing
+   * store imports since the mounts started or since the last clear, along
+   * with their command lines.
+   */
+  GetFetchCostsResult getFetchCosts(1: bool clear) throws (1: EdenError ex);
+
   /**
    * Start recording paths of the files fetched from the backing store.
    *
@@ -1440,6 +1585,18 @@ service EdenService extends fb303_core.BaseService {
    */
   void flushStatsNow() throws (1: EdenError ex);
 
+  /**
+   * Get the fb303 counters that changed since a previous call, identified by
+   * the token it returned.
+   *
+   * The counters are aggregated at most once a second, whatever the number
+   * of pollers, and only the ones whose value changed are returned: this is
+   * meant for monitoring polling frequently, for which getStatInfo would
+   * collect and serialize every counter each time. Pass 0 as the token of
+   * the first call.
+   */
+  CounterDelta getCounterDelta(1: i64 token) throws (1: EdenError ex);
+
   /**
   * Invalidate kernel cache for inode.
   */
@@ -1459,6 +1616,22 @@ service EdenService extends fb303_core.BaseService {
   void disableTracing();
   list<TracePoint> getTracePoints();
 
+  /**
+   * Enable tracing and stream the tracepoints into the file at the given
+   * absolute path, as Chrome trace event JSON which chrome://tracing and
+   * Perfetto can load, until stopTraceExport() is called.
+   *
+   * The tracepoints exported are not returned by getTracePoints(). Starting a
+   * new export stops the previous one.
+   */
+  void startTraceExport(1: string path) throws (1: EdenError ex);
+
+  /**
+   * Stop the export started by startTraceExport(), after writing the
+   * tracepoints recorded so far. Tracing is left enabled.
+   */
+  void stopTraceExport();
+
   /**
    * Configure a new fault in Eden's fault injection framework.
    *
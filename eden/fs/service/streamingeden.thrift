@@ -110,6 +110,48 @@ struct HgEvent {
   7: optional RequestInfo requestInfo;
 }
 
+struct PrefetchParams {
+  1: eden.PathString mountPoint;
+  /**
+   * The globs matching the files to prefetch, such as the globs of a prefetch
+   * profile.
+   */
+  2: list<string> globs;
+  3: bool includeDotfiles;
+  /**
+   * The commits whose files are prefetched. The working copy is used when
+   * empty.
+   */
+  4: list<eden.ThriftRootId> revisions;
+  /**
+   * Stop once the contents of the files fetched add up to this many bytes.
+   * 0 means no limit.
+   */
+  5: i64 maxBytes;
+  /**
+   * Stop once this many files were fetched. 0 means no limit.
+   */
+  6: i64 maxFiles;
+}
+
+struct PrefetchProgress {
+  /** The distinct files matched by the globs. */
+  1: i64 filesMatched;
+  /**
+   * The files fetched so far, including the ones that were already cached,
+   * and the total size of their contents.
+   */
+  2: i64 filesFetched;
+  3: i64 bytesFetched;
+  /** The files matched that are not fetched yet. */
+  4: i64 filesPending;
+  /**
+   * Whether the prefetch stopped at its budget before fetching every file
+   * matched. Only set in the last progress of the stream.
+   */
+  5: bool budgetExhausted;
+}
+
 /**
  * This Thrift service defines streaming functions. It is separate from
  * EdenService because older Thrift runtimes do not support Thrift streaming,
@@ -135,9 +177,16 @@ service StreamingEdenService extends eden.EdenService {
    * but want to start pushing out an implementation now because
    * we've seen inflated memory usage for the older `subscribe`
    * method above.
+   *
+   * When root is set, only the changes to root or under it are notified,
+   * along with the commit transitions, which may change any path. Pass the
+   * same root to getFilesChangedSince. Since EdenFS checks each burst of
+   * changes itself, these notifications keep arriving even if the
+   * subscriber doesn't call getFilesChangedSince.
    */
   stream<eden.JournalPosition> subscribeStreamTemporary(
     1: eden.PathString mountPoint,
+    2: eden.PathString root,
   );
 
   /**
@@ -159,4 +208,40 @@ service StreamingEdenService extends eden.EdenService {
    * started, and finished.
    */
   stream<HgEvent> traceHgEvents(1: eden.PathString mountPoint);
+
+  /**
+   * Evaluate the globs like globFiles, but stream the matches back as they
+   * are found instead of returning them all at once.
+   *
+   * Each Glob in the stream holds a batch of the matches of one or more
+   * directories, and the stream completes once every directory has been
+   * evaluated and, if requested, the matching files have been prefetched.
+   * A match is only sent once, even if several globs match it. The stream
+   * fails past 1024 batches, which bounds the memory it holds for a client
+   * that doesn't read it.
+   *
+   * The background and predictiveGlob parameters are not supported.
+   */
+  stream<eden.Glob> streamGlobFiles(1: eden.GlobParams params);
+
+  /**
+   * Compute the status like getScmStatusV2, but stream the differences back
+   * as they are found instead of returning them all at once.
+   *
+   * Each ScmStatus in the stream holds a batch of the differences, in no
+   * particular order, and the stream completes once the diff has. Like
+   * streamGlobFiles, the stream fails past 1024 batches.
+   */
+  stream<eden.ScmStatus> streamScmStatus(1: eden.GetScmStatusParams params);
+
+  /**
+   * Prefetch the contents of the files matched by the globs in the
+   * background, streaming its progress back after every batch of files.
+   *
+   * The files are fetched with a low import priority, so that interactive
+   * fetches go first, and at most within the budget of the params. The
+   * stream completes once the files are fetched or the budget is exhausted;
+   * cancelling the stream stops the prefetch after the current batch.
+   */
+  stream<PrefetchProgress> streamPrefetch(1: PrefetchParams params);
 }
@@ -7,7 +7,11 @@
 
 #include "eden/fs/service/PeriodicTask.h"
 
+#include <atomic>
+#include <chrono>
 #include <functional>
+#include <optional>
+#include <thread>
 
 #include <folly/io/async/test/Util.h>
 #include <folly/logging/test/TestLogHandler.h>
@@ -36,13 +40,26 @@ class TestTask : public PeriodicTask {
   explicit TestTask(
       EdenServer* server,
       StringPiece name,
-      std::function<void()>&& fn)
-      : PeriodicTask(server, name), fn_(std::move(fn)) {}
+      std::function<void()>&& fn,
+      Options options = {})
+      : PeriodicTask(server, name, options), fn_(std::move(fn)) {}
+
+  ~TestTask() override {
+    waitForBackgroundRun();
+  }
 
   void runTask() override {
     fn_();
   }
 
+  bool isFilesystemBusy() const override {
+    ++busyChecks;
+    return busy;
+  }
+
+  bool busy{false};
+  mutable size_t busyChecks{0};
+
  private:
   std::function<void()> fn_;
 };
@@ -267,3 +284,86 @@ TEST_F(PeriodicTaskTest, slowTask) {
           MatchesRegex("slow periodic task: test_task took .*ms; "
                        "has run slowly 8 times")));
 }
+
+TEST_F(PeriodicTaskTest, backgroundTask) {
+  // Background tasks run on the maintenance thread, and keep being
+  // rescheduled once each run completes there.
+  constexpr auto kInterval = 10ms;
+  constexpr size_t kNumInvocations = 5;
+  auto mainThread = std::this_thread::get_id();
+  std::atomic<size_t> count{0};
+  std::atomic<size_t> onMainThread{0};
+  TestTask task(
+      &getServer(),
+      "test_task",
+      [&] {
+        if (std::this_thread::get_id() == mainThread) {
+          ++onMainThread;
+        }
+        if (++count == kNumInvocations) {
+          getServer().getMainEventBase()->runInEventBaseThread(
+              [&] { getServer().stop(); });
+        }
+      },
+      PeriodicTask::Options{true, false, true, 0});
+  task.updateInterval(kInterval);
+
+  runServer();
+  EXPECT_GE(count.load(), kNumInvocations);
+  EXPECT_EQ(0, onMainThread.load());
+}
+
+TEST_F(PeriodicTaskTest, deferWhenBusy) {
+  // A task is put off while the filesystem is busy, but by no more than one
+  // interval, after which it runs on the next retry anyway.
+  constexpr auto kInterval = 10ms;
+  std::optional<std::chrono::steady_clock::time_point> scheduled;
+  std::optional<std::chrono::steady_clock::time_point> ran;
+  TestTask task(
+      &getServer(),
+      "test_task",
+      [&] {
+        ran = std::chrono::steady_clock::now();
+        getServer().stop();
+      },
+      PeriodicTask::Options{false, true, false, 0});
+  task.busy = true;
+  runOnServerStart([&] {
+    scheduled = std::chrono::steady_clock::now();
+    task.updateInterval(kInterval, /*splay=*/false);
+  });
+
+  runServer();
+  ASSERT_TRUE(ran.has_value());
+  // Checked once when the timer fired, and again on the retry a second later.
+  EXPECT_EQ(2, task.busyChecks);
+  EXPECT_GE(*ran - scheduled.value(), 1s);
+}
+
+TEST_F(PeriodicTaskTest, maxDutyCycle) {
+  // A run longer than the duty cycle allows pushes the next one back.
+  constexpr auto kInterval = 1ms;
+  constexpr auto kRunTime = 20ms;
+  constexpr size_t kNumInvocations = 3;
+  std::vector<std::chrono::steady_clock::time_point> starts;
+  TestTask task(
+      &getServer(),
+      "test_task",
+      [&] {
+        starts.push_back(std::chrono::steady_clock::now());
+        if (starts.size() == kNumInvocations) {
+          getServer().stop();
+          return;
+        }
+        /* sleep override */ std::this_thread::sleep_for(kRunTime);
+      },
+      PeriodicTask::Options{false, false, false, 0.5});
+  task.updateInterval(kInterval);
+
+  runServer();
+  ASSERT_EQ(kNumInvocations, starts.size());
+  for (size_t n = 1; n < starts.size(); ++n) {
+    // Each run takes kRunTime, after which the task waits twice as long.
+    EXPECT_GE(starts[n] - starts[n - 1], 3 * kRunTime);
+  }
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/service/ThriftClientLimiter.h"
+
+#include <folly/portability/GTest.h>
+#include "eden/fs/service/gen-cpp2/eden_types.h"
+
+using namespace facebook::eden;
+using namespace std::chrono_literals;
+
+namespace {
+void expectOverloaded(
+    ThriftClientLimiter& limiter,
+    pid_t pid,
+    const ThriftClientLimiter::Limits& limits,
+    std::chrono::steady_clock::time_point now) {
+  try {
+    limiter.admit(pid, "glob", limits, now);
+    ADD_FAILURE() << "the request was admitted";
+  } catch (const EdenError& error) {
+    EXPECT_EQ(EdenErrorType::OVERLOADED, *error.errorType_ref());
+    EXPECT_EQ(EAGAIN, *error.errorCode_ref());
+  }
+}
+} // namespace
+
+TEST(ThriftClientLimiterTest, limitsConcurrentRequestsPerClient) {
+  ThriftClientLimiter limiter;
+  ThriftClientLimiter::Limits limits;
+  limits.maxConcurrentRequests = 2;
+  auto now = std::chrono::steady_clock::now();
+
+  auto first = limiter.admit(10, "glob", limits, now);
+  std::optional<ThriftClientLimiter::Permit> second{
+      limiter.admit(10, "glob", limits, now)};
+  expectOverloaded(limiter, 10, limits, now);
+
+  // Other clients have their own budget.
+  auto other = limiter.admit(11, "glob", limits, now);
+
+  second.reset();
+  auto third = limiter.admit(10, "glob", limits, now);
+}
+
+TEST(ThriftClientLimiterTest, limitsRequestRatePerClient) {
+  ThriftClientLimiter limiter;
+  ThriftClientLimiter::Limits limits;
+  limits.maxRequestsPerSecond = 2;
+  auto now = std::chrono::steady_clock::now();
+
+  limiter.admit(10, "glob", limits, now);
+  limiter.admit(10, "glob", limits, now);
+  expectOverloaded(limiter, 10, limits, now);
+
+  // Half a second refills one request.
+  limiter.admit(10, "glob", limits, now + 500ms);
+  expectOverloaded(limiter, 10, limits, now + 500ms);
+}
+
+TEST(ThriftClientLimiterTest, admitsUnknownClientsAndUnlimitedRequests) {
+  ThriftClientLimiter limiter;
+  ThriftClientLimiter::Limits limits;
+  limits.maxConcurrentRequests = 1;
+  auto now = std::chrono::steady_clock::now();
+
+  auto first = limiter.admit(std::nullopt, "glob", limits, now);
+  auto second = limiter.admit(std::nullopt, "glob", limits, now);
+
+  auto unlimited1 = limiter.admit(10, "glob", {}, now);
+  auto unlimited2 = limiter.admit(10, "glob", {}, now);
+  EXPECT_EQ(0, limiter.getClientCount());
+}
+
+TEST(ThriftClientLimiterTest, evictsClientsIdleForLongEnough) {
+  ThriftClientLimiter limiter;
+  ThriftClientLimiter::Limits limits;
+  limits.maxConcurrentRequests = 1;
+  limits.maxRequestsPerSecond = 1;
+  auto now = std::chrono::steady_clock::now();
+
+  // Past 1024 clients, the ones admitted more than a second ago and without
+  // requests in flight are forgotten.
+  auto inFlight = limiter.admit(1, "glob", limits, now);
+  for (pid_t pid = 2; pid < 514; ++pid) {
+    limiter.admit(pid, "glob", limits, now);
+  }
+  for (pid_t pid = 514; pid < 1026; ++pid) {
+    limiter.admit(pid, "glob", limits, now + 1500ms);
+  }
+  EXPECT_EQ(1025, limiter.getClientCount());
+
+  limiter.admit(2000, "glob", limits, now + 2s);
+  EXPECT_EQ(514, limiter.getClientCount());
+  expectOverloaded(limiter, 1, limits, now + 2s);
+}
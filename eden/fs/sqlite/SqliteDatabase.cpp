@@ -7,8 +7,10 @@
 
 #include "eden/fs/sqlite/SqliteDatabase.h"
 
+#include <folly/concurrency/CacheLocality.h>
 #include <folly/logging/xlog.h>
 #include "eden/fs/sqlite/PersistentSqliteStatement.h"
+#include "eden/fs/sqlite/SqliteStatement.h"
 
 namespace facebook::eden {
 struct SqliteDatabase::StatementCache {
@@ -44,16 +46,23 @@ void checkSqliteResult(sqlite3* db, int result) {
   }
 }
 
-SqliteDatabase::SqliteDatabase(const char* addr) {
+namespace {
+sqlite3* openDatabase(const char* addr, int flags) {
   sqlite3* db = nullptr;
-  auto result = sqlite3_open(addr, &db);
+  auto result = sqlite3_open_v2(addr, &db, flags, nullptr);
   if (result != SQLITE_OK) {
     // sqlite3_close handles nullptr fine
     // @lint-ignore CLANGTIDY
     sqlite3_close(db);
     checkSqliteResult(nullptr, result);
   }
-  db_ = db;
+  return db;
+}
+} // namespace
+
+SqliteDatabase::SqliteDatabase(const char* addr)
+    : address_{addr},
+      db_{openDatabase(addr, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE)} {
   auto conn = lock();
   cache_ = std::make_unique<StatementCache>(conn);
 }
@@ -64,6 +73,13 @@ void SqliteDatabase::close() {
   // `sqlite3_close` will fail with `SQLITE_BUSY`. This rule applies to any
   // statement cache elsewhere too.
   cache_.reset();
+  for (auto& reader : readers_) {
+    auto readerDb = reader->wlock();
+    if (*readerDb) {
+      sqlite3_close(*readerDb);
+      *readerDb = nullptr;
+    }
+  }
   if (*db) {
     sqlite3_close(*db);
     *db = nullptr;
@@ -78,6 +94,40 @@ SqliteDatabase::Connection SqliteDatabase::lock() {
   return db_.wlock();
 }
 
+void SqliteDatabase::openReadConnections(size_t count) {
+  if (address_ == ":memory:") {
+    throw std::logic_error(
+        "an in-memory SQLite database cannot be shared between connections");
+  }
+  {
+    auto conn = lock();
+    SqliteStatement journalMode(conn, "PRAGMA journal_mode");
+    if (!journalMode.step() || journalMode.columnBlob(0) != "wal") {
+      throw std::logic_error(
+          "read connections require the SQLite database to use WAL");
+    }
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    readers_.push_back(std::make_unique<folly::Synchronized<sqlite3*>>(
+        openDatabase(address_.c_str(), SQLITE_OPEN_READONLY)));
+  }
+}
+
+SqliteDatabase::ReadConnection SqliteDatabase::lockForRead() {
+  XDCHECK(!readers_.empty());
+  // Start from the connection associated with the current CPU, so that
+  // threads on different CPUs usually don't contend.
+  auto start = folly::AccessSpreader<>::current(readers_.size());
+  for (size_t n = 0; n < readers_.size(); ++n) {
+    auto index = (start + n) % readers_.size();
+    if (auto conn = readers_[index]->tryWLock()) {
+      return ReadConnection{std::move(conn), index};
+    }
+  }
+  return ReadConnection{readers_[start]->wlock(), start};
+}
+
 void SqliteDatabase::transaction(const std::function<void(Connection&)>& func) {
   auto conn = lock();
   try {
@@ -9,6 +9,9 @@
 
 #include <folly/Synchronized.h>
 #include <sqlite3.h>
+#include <memory>
+#include <string>
+#include <vector>
 #include "eden/fs/utils/PathFuncs.h"
 
 namespace facebook::eden {
@@ -56,6 +59,39 @@ class SqliteDatabase {
    * to the SqliteStatement class. */
   Connection lock();
 
+  /**
+   * Open `count` additional read-only connections to the database, which
+   * allow reads to proceed concurrently with each other and with the writes
+   * made through `lock()`. The database must be stored in a file and use
+   * the WAL journal mode, see https://www.sqlite.org/wal.html
+   *
+   * This must be called before the database is used from multiple threads.
+   */
+  void openReadConnections(size_t count);
+
+  size_t getReadConnectionCount() const {
+    return readers_.size();
+  }
+
+  struct ReadConnection {
+    Connection connection;
+    /**
+     * Index of the locked connection, in [0, getReadConnectionCount()). This
+     * allows the caller to keep a cache of statements per read connection.
+     */
+    size_t index;
+  };
+
+  /**
+   * Lock one of the read connections, preferring one that is not in use.
+   * Since the read connections don't see uncommitted changes, read-only
+   * statements that must observe a transaction in progress still need to use
+   * `lock()`.
+   *
+   * This must only be called after openReadConnections().
+   */
+  ReadConnection lockForRead();
+
   /**
    * Executes a SQLite transaction. If the lambda body throws any error, the
    * transaction will be rolled back. This function returns a boolean to
@@ -77,8 +113,12 @@ class SqliteDatabase {
 
   explicit SqliteDatabase(const char* address);
 
+  std::string address_;
+
   folly::Synchronized<sqlite3*> db_{nullptr};
 
   std::unique_ptr<StatementCache> cache_;
+
+  std::vector<std::unique_ptr<folly::Synchronized<sqlite3*>>> readers_;
 };
 } // namespace facebook::eden
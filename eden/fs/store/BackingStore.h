@@ -9,7 +9,9 @@
 
 #include <folly/Range.h>
 #include <folly/futures/Future.h>
+#include <folly/io/IOBuf.h>
 #include <memory>
+#include <stdexcept>
 
 #include "eden/fs/model/RootId.h"
 #include "eden/fs/store/ImportPriority.h"
@@ -55,13 +57,42 @@ class BackingStore : public RootIdCodec {
       TreeEntryType treeEntryType,
       facebook::eden::PathComponentPiece pathComponentPiece,
       ObjectFetchContext& context) = 0;
-  virtual folly::SemiFuture<std::unique_ptr<Tree>> getTree(
+
+  /**
+   * Trees and blobs are returned as shared, immutable objects, so that an
+   * import requested by several callers at once is handed to all of them
+   * without being copied.
+   */
+  virtual folly::SemiFuture<std::shared_ptr<const Tree>> getTree(
       const Hash& id,
       ObjectFetchContext& context) = 0;
-  virtual folly::SemiFuture<std::unique_ptr<Blob>> getBlob(
+  virtual folly::SemiFuture<std::shared_ptr<const Blob>> getBlob(
       const Hash& id,
       ObjectFetchContext& context) = 0;
 
+  /**
+   * Whether getBlobRange() can fetch part of a blob without fetching all of
+   * it. Only then is it worth reading a large blob one range at a time.
+   */
+  virtual bool supportsBlobRanges() const {
+    return false;
+  }
+
+  /**
+   * Fetch the `length` bytes of a blob starting at `offset`, or fewer if the
+   * blob ends first.
+   *
+   * Only called when supportsBlobRanges() returns true.
+   */
+  virtual folly::SemiFuture<std::unique_ptr<folly::IOBuf>> getBlobRange(
+      const Hash& /*id*/,
+      uint64_t /*offset*/,
+      uint64_t /*length*/,
+      ObjectFetchContext& /*context*/) {
+    return folly::makeSemiFuture<std::unique_ptr<folly::IOBuf>>(
+        std::logic_error("this backing store cannot fetch blob ranges"));
+  }
+
   /**
    * Prefetch all the blobs represented by the HashRange.
    *
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/BlobCache.h"
+
+#include <folly/ExceptionString.h>
+#include <folly/compression/Compression.h>
+#include <folly/logging/xlog.h>
+
+namespace facebook::eden {
+
+namespace {
+constexpr auto kCodecType = folly::io::CodecType::LZ4;
+
+/**
+ * Blobs that compress to more than this share of their size, such as
+ * binaries and images, are not worth keeping compressed.
+ */
+constexpr size_t kMaxCompressedPercent = 80;
+
+folly::io::Codec& getCodec() {
+  // Codecs are not safe to share between threads.
+  thread_local auto codec = folly::io::getCodec(kCodecType);
+  return *codec;
+}
+} // namespace
+
+BlobCache::BlobCache(
+    size_t maximumCacheSizeBytes,
+    size_t minimumEntryCount,
+    size_t shardCount,
+    ObjectCachePolicy policy,
+    size_t compressedCacheSizeBytes)
+    : ObjectCache<Blob, ObjectCacheFlavor::InterestHandle>{
+          maximumCacheSizeBytes,
+          minimumEntryCount,
+          shardCount,
+          policy} {
+  if (compressedCacheSizeBytes == 0) {
+    return;
+  }
+  if (!folly::io::hasCodec(kCodecType)) {
+    XLOG(WARN) << "LZ4 is not available, not keeping compressed blobs";
+    return;
+  }
+  compressed_ = CompressedCache::create(
+      compressedCacheSizeBytes, /*minimumEntryCount=*/0, shardCount);
+  setEvictionCallback([this](std::vector<ObjectPtr>&& blobs) {
+    compressEvicted(std::move(blobs));
+  });
+}
+
+BlobCache::GetResult BlobCache::get(const Hash& hash, Interest interest) {
+  auto result = getInterestHandle(hash, interest);
+  if (result.object || !compressed_) {
+    return result;
+  }
+
+  auto compressedBlob = compressed_->getSimple(hash);
+  if (!compressedBlob) {
+    return result;
+  }
+  std::shared_ptr<const Blob> blob;
+  try {
+    auto contents = getCodec().uncompress(
+        &compressedBlob->getContents(), compressedBlob->getUncompressedSize());
+    blob = std::make_shared<Blob>(hash, std::move(*contents));
+  } catch (const std::exception& ex) {
+    XLOG(ERR) << "unable to decompress cached blob " << hash << ": "
+              << folly::exceptionStr(ex);
+    return result;
+  }
+  auto interestHandle = insertInterestHandle(blob, interest);
+  return GetResult{std::move(blob), std::move(interestHandle)};
+}
+
+void BlobCache::compressEvicted(std::vector<ObjectPtr>&& blobs) {
+  for (auto& blob : blobs) {
+    auto size = blob->getSize();
+    if (size == 0 || compressed_->contains(blob->getHash())) {
+      continue;
+    }
+    try {
+      auto contents = getCodec().compress(&blob->getContents());
+      if (contents->computeChainDataLength() * 100 >
+          size * kMaxCompressedPercent) {
+        continue;
+      }
+      compressed_->insertSimple(std::make_shared<CompressedBlob>(
+          blob->getHash(), std::move(contents), size));
+    } catch (const std::exception& ex) {
+      XLOG(WARN) << "unable to compress evicted blob " << blob->getHash()
+                 << ": " << folly::exceptionStr(ex);
+    }
+  }
+}
+
+BlobCache::CompressedCache::Stats BlobCache::getCompressedStats() const {
+  if (!compressed_) {
+    return CompressedCache::Stats{};
+  }
+  return compressed_->getStats();
+}
+
+} // namespace facebook::eden
@@ -6,6 +6,11 @@
  */
 
 #pragma once
+
+#include <folly/io/IOBuf.h>
+#include <memory>
+#include <vector>
+
 #include "eden/fs/model/Blob.h"
 #include "eden/fs/store/ObjectCache.h"
 
@@ -13,6 +18,43 @@ namespace facebook::eden {
 
 using BlobInterestHandle = ObjectInterestHandle<Blob>;
 
+/**
+ * The compressed contents of a blob evicted from the BlobCache.
+ */
+class CompressedBlob {
+ public:
+  CompressedBlob(
+      const Hash& hash,
+      std::unique_ptr<folly::IOBuf> contents,
+      size_t uncompressedSize)
+      : hash_{hash},
+        contents_{std::move(contents)},
+        size_{contents_->computeChainDataLength()},
+        uncompressedSize_{uncompressedSize} {}
+
+  const Hash& getHash() const {
+    return hash_;
+  }
+
+  const folly::IOBuf& getContents() const {
+    return *contents_;
+  }
+
+  size_t getSizeBytes() const {
+    return size_;
+  }
+
+  size_t getUncompressedSize() const {
+    return uncompressedSize_;
+  }
+
+ private:
+  const Hash hash_;
+  const std::unique_ptr<folly::IOBuf> contents_;
+  const size_t size_;
+  const size_t uncompressedSize_;
+};
+
 /**
  * An in-memory LRU cache for loaded blobs. It is parameterized by both a
  * maximum cache size and a minimum entry count. The cache tries to evict
@@ -23,17 +65,36 @@ using BlobInterestHandle = ObjectInterestHandle<Blob>;
  * frequently-accessed large blobs when they are larger than the maximum cache
  * size.
  *
+ * If compressedCacheSizeBytes is non-zero, the blobs evicted to make room
+ * for new ones are compressed with LZ4 into a second, larger LRU tier of
+ * that size, which is looked up on a miss. A blob found there is
+ * decompressed and inserted again, so that its next reads are served from
+ * memory without going to the LocalStore. The blobs that don't compress well
+ * are not kept.
+ *
  * It is safe to use this object from arbitrary threads.
  */
 class BlobCache : public ObjectCache<Blob, ObjectCacheFlavor::InterestHandle> {
  public:
+  using CompressedCache =
+      ObjectCache<CompressedBlob, ObjectCacheFlavor::Simple>;
+
   static std::shared_ptr<BlobCache> create(
       size_t maximumCacheSizeBytes,
-      size_t minimumEntryCount) {
+      size_t minimumEntryCount,
+      size_t shardCount = 1,
+      ObjectCachePolicy policy = ObjectCachePolicy::LRU,
+      size_t compressedCacheSizeBytes = 0) {
     struct BC : BlobCache {
-      BC(size_t x, size_t y) : BlobCache{x, y} {}
+      BC(size_t x, size_t y, size_t z, ObjectCachePolicy p, size_t c)
+          : BlobCache{x, y, z, p, c} {}
     };
-    return std::make_shared<BC>(maximumCacheSizeBytes, minimumEntryCount);
+    return std::make_shared<BC>(
+        maximumCacheSizeBytes,
+        minimumEntryCount,
+        shardCount,
+        policy,
+        compressedCacheSizeBytes);
   }
   ~BlobCache() = default;
 
@@ -51,9 +112,7 @@ class BlobCache : public ObjectCache<Blob, ObjectCacheFlavor::InterestHandle> {
    */
   GetResult get(
       const Hash& hash,
-      Interest interest = Interest::LikelyNeededAgain) {
-    return getInterestHandle(hash, interest);
-  }
+      Interest interest = Interest::LikelyNeededAgain);
 
   /**
    * Inserts a blob into the cache for future lookup. If the new total size
@@ -69,11 +128,29 @@ class BlobCache : public ObjectCache<Blob, ObjectCacheFlavor::InterestHandle> {
     return insertInterestHandle(blob, interest);
   }
 
+  /**
+   * Statistics of the compressed tier. Its hits are the blobs decompressed
+   * and inserted again, and its size is the compressed size. All zero if
+   * the tier is disabled.
+   */
+  CompressedCache::Stats getCompressedStats() const;
+
  private:
-  explicit BlobCache(size_t maximumCacheSizeBytes, size_t minimumEntryCount)
-      : ObjectCache<Blob, ObjectCacheFlavor::InterestHandle>{
-            maximumCacheSizeBytes,
-            minimumEntryCount} {}
+  explicit BlobCache(
+      size_t maximumCacheSizeBytes,
+      size_t minimumEntryCount,
+      size_t shardCount,
+      ObjectCachePolicy policy,
+      size_t compressedCacheSizeBytes);
+
+  /**
+   * Called by the ObjectCache, without its locks held, with the blobs it
+   * evicted.
+   */
+  void compressEvicted(std::vector<ObjectPtr>&& blobs);
+
+  /// Null if the compressed tier is disabled.
+  std::shared_ptr<CompressedCache> compressed_;
 };
 
 } // namespace facebook::eden
@@ -51,8 +51,8 @@ struct ChildFutures {
 };
 
 struct DiffState {
-  explicit DiffState(const ObjectStore* store)
-      : callback{}, context{&callback, store} {}
+  DiffState(const ObjectStore* store, size_t maxConcurrentTreeFetches)
+      : callback{}, context{&callback, store, maxConcurrentTreeFetches} {}
 
   ScmStatusDiffCallback callback;
   DiffContext context;
@@ -634,9 +634,10 @@ diffRoots(DiffContext* context, const RootId& root1, const RootId& root2) {
 Future<std::unique_ptr<ScmStatus>> diffCommitsForStatus(
     const ObjectStore* store,
     const RootId& root1,
-    const RootId& root2) {
+    const RootId& root2,
+    size_t maxConcurrentTreeFetches) {
   return folly::makeFutureWith([&] {
-    auto state = std::make_unique<DiffState>(store);
+    auto state = std::make_unique<DiffState>(store, maxConcurrentTreeFetches);
     auto statePtr = state.get();
     auto contextPtr = &(statePtr->context);
     return diffRoots(contextPtr, root1, root2)
@@ -653,10 +654,8 @@ FOLLY_NODISCARD Future<Unit> diffTrees(
     Hash wdHash,
     const GitIgnoreStack* ignore,
     bool isIgnored) {
-  auto scmTreeFuture =
-      context->store->getTree(scmHash, context->getFetchContext());
-  auto wdTreeFuture =
-      context->store->getTree(wdHash, context->getFetchContext());
+  auto scmTreeFuture = context->getTree(scmHash);
+  auto wdTreeFuture = context->getTree(wdHash);
   // Optimization for the case when both tree objects are immediately ready.
   // We can avoid copying the input path in this case.
   if (scmTreeFuture.isReady() && wdTreeFuture.isReady()) {
@@ -686,7 +685,7 @@ FOLLY_NODISCARD Future<Unit> diffAddedTree(
     Hash wdHash,
     const GitIgnoreStack* ignore,
     bool isIgnored) {
-  auto wdFuture = context->store->getTree(wdHash, context->getFetchContext());
+  auto wdFuture = context->getTree(wdHash);
   // Optimization for the case when the tree object is immediately ready.
   // We can avoid copying the input path in this case.
   if (wdFuture.isReady()) {
@@ -705,7 +704,7 @@ FOLLY_NODISCARD Future<Unit> diffRemovedTree(
     DiffContext* context,
     RelativePathPiece currentPath,
     Hash scmHash) {
-  auto scmFuture = context->store->getTree(scmHash, context->getFetchContext());
+  auto scmFuture = context->getTree(scmHash);
   // Optimization for the case when the tree object is immediately ready.
   // We can avoid copying the input path in this case.
   if (scmFuture.isReady()) {
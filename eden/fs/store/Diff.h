@@ -31,12 +31,16 @@ class RootId;
  * The caller is responsible for ensuring that the ObjectStore remains valid
  * until the returned Future completes.
  *
+ * At most maxConcurrentTreeFetches trees are fetched at once, or any number
+ * of them if it is 0.
+ *
  * The differences will be returned to the caller.
  */
 folly::Future<std::unique_ptr<ScmStatus>> diffCommitsForStatus(
     const ObjectStore* store,
     const RootId& root1,
-    const RootId& root2);
+    const RootId& root2,
+    size_t maxConcurrentTreeFetches = 0);
 
 /**
  * Compute the diff between a source control Tree and the current directory
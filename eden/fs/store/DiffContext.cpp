@@ -9,38 +9,67 @@
 
 #include <thrift/lib/cpp2/async/ResponseChannel.h>
 
+#include "eden/fs/model/Tree.h"
 #include "eden/fs/model/git/GitIgnoreStack.h"
 #include "eden/fs/model/git/TopLevelIgnores.h"
 #include "eden/fs/store/IObjectStore.h"
+#include "eden/fs/store/ObjectStore.h"
 
 using apache::thrift::ResponseChannelRequest;
 
 namespace facebook::eden {
 
+DiffScope::DiffScope(const std::vector<RelativePath>& paths) {
+  for (const auto& path : paths) {
+    paths_.insert(path.stringPiece().str());
+    for (auto parent : path.dirname().allPaths()) {
+      parents_.insert(parent.stringPiece().str());
+    }
+  }
+}
+
+bool DiffScope::contains(RelativePathPiece path) const {
+  if (empty() || parents_.count(path.stringPiece())) {
+    return true;
+  }
+  for (auto prefix : path.rpaths()) {
+    if (paths_.count(prefix.stringPiece())) {
+      return true;
+    }
+  }
+  return false;
+}
+
 DiffContext::DiffContext(
     DiffCallback* cb,
     bool listIgnored,
     CaseSensitivity caseSensitive,
     const ObjectStore* os,
-    std::unique_ptr<TopLevelIgnores> topLevelIgnores,
+    std::shared_ptr<const TopLevelIgnores> topLevelIgnores,
     LoadFileFunction loadFileContentsFromPath,
-    ResponseChannelRequest* request)
+    ResponseChannelRequest* request,
+    size_t maxConcurrentTreeFetches)
     : callback{cb},
       store{os},
       listIgnored{listIgnored},
       caseSensitive{caseSensitive},
       topLevelIgnores_(std::move(topLevelIgnores)),
       loadFileContentsFromPath_{loadFileContentsFromPath},
-      request_{request} {}
+      request_{request},
+      maxConcurrentTreeFetches_{maxConcurrentTreeFetches} {}
 
-DiffContext::DiffContext(DiffCallback* cb, const ObjectStore* os)
+DiffContext::DiffContext(
+    DiffCallback* cb,
+    const ObjectStore* os,
+    size_t maxConcurrentTreeFetches)
     : callback{cb},
       store{os},
       listIgnored{true},
       caseSensitive{kPathMapDefaultCaseSensitive},
-      topLevelIgnores_{std::unique_ptr<TopLevelIgnores>()},
+      topLevelIgnores_{nullptr},
       loadFileContentsFromPath_{nullptr},
-      request_{nullptr} {};
+      request_{nullptr},
+      maxConcurrentTreeFetches_{maxConcurrentTreeFetches} {};
 
 DiffContext::~DiffContext() = default;
 
@@ -52,6 +81,111 @@ DiffContext::LoadFileFunction DiffContext::getLoadFileContentsFromPath() const {
   return loadFileContentsFromPath_;
 }
 
+folly::Future<std::shared_ptr<const Tree>> DiffContext::getTree(
+    const Hash& hash) {
+  if (maxConcurrentTreeFetches_ == 0) {
+    return store->getTree(hash, fetchContext_);
+  }
+
+  {
+    auto state = treeFetches_.wlock();
+    if (state->inFlight >= maxConcurrentTreeFetches_) {
+      auto& pending = state->pending.emplace_back(PendingTreeFetch{hash, {}});
+      return pending.promise.getFuture();
+    }
+    ++state->inFlight;
+  }
+
+  auto future = folly::makeFutureWith(
+      [&] { return store->getTree(hash, fetchContext_); });
+  if (future.isReady()) {
+    treeFetchCompleted();
+    return future;
+  }
+  return std::move(future).ensure([this] { treeFetchCompleted(); });
+}
+
+void DiffContext::treeFetchCompleted() {
+  // Trees that are already cached complete immediately, loop over them here
+  // rather than recursing once per pending fetch.
+  while (true) {
+    PendingTreeFetch next;
+    {
+      auto state = treeFetches_.wlock();
+      if (state->pending.empty()) {
+        --state->inFlight;
+        return;
+      }
+      next = std::move(state->pending.front());
+      state->pending.pop_front();
+    }
+
+    auto future = folly::makeFutureWith(
+        [&] { return store->getTree(next.hash, fetchContext_); });
+    if (future.isReady()) {
+      next.promise.setTry(std::move(future).result());
+      continue;
+    }
+    std::move(future).thenTry(
+        [this, promise = std::move(next.promise)](
+            folly::Try<std::shared_ptr<const Tree>>&& tree) mutable {
+          treeFetchCompleted();
+          promise.setTry(std::move(tree));
+        });
+    return;
+  }
+}
+
+folly::Future<Hash> DiffContext::getBlobSha1(const Hash& hash) {
+  {
+    auto state = blobSha1Batches_.wlock();
+    if (state->openBatches > 0) {
+      auto& pending = state->pending.emplace_back(PendingBlobSha1{hash, {}});
+      return pending.promise.getFuture();
+    }
+  }
+  return store->getBlobSha1(hash, fetchContext_);
+}
+
+DiffContext::BlobSha1Batch::BlobSha1Batch(DiffContext* context)
+    : context_{context} {
+  ++context_->blobSha1Batches_.wlock()->openBatches;
+}
+
+DiffContext::BlobSha1Batch::~BlobSha1Batch() {
+  std::vector<PendingBlobSha1> pending;
+  {
+    auto state = context_->blobSha1Batches_.wlock();
+    if (--state->openBatches == 0) {
+      pending.swap(state->pending);
+    }
+  }
+  if (!pending.empty()) {
+    context_->fetchBlobSha1s(std::move(pending));
+  }
+}
+
+void DiffContext::fetchBlobSha1s(std::vector<PendingBlobSha1> pending) {
+  std::vector<Hash> hashes;
+  hashes.reserve(pending.size());
+  for (const auto& request : pending) {
+    hashes.push_back(request.hash);
+  }
+
+  folly::makeFutureWith(
+      [&] { return store->getBlobSha1s(hashes, fetchContext_); })
+      .thenTry([pending = std::move(pending)](
+                   folly::Try<std::vector<folly::Try<Hash>>>&& sha1s) mutable {
+        for (size_t i = 0; i < pending.size(); ++i) {
+          if (sha1s.hasException()) {
+            pending[i].promise.setException(sha1s.exception());
+          } else {
+            pending[i].promise.setTry(std::move((*sha1s)[i]));
+          }
+        }
+      });
+}
+
 bool DiffContext::isCancelled() const {
   // If request_ is null we do not have an associated thrift
   // request that can be cancelled, so we are always still active
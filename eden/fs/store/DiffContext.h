@@ -8,8 +8,14 @@
 #pragma once
 
 #include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <folly/container/F14Set.h>
 #include <folly/futures/Future.h>
+#include <folly/futures/Promise.h>
+#include <deque>
+#include <vector>
 
+#include "eden/fs/model/Hash.h"
 #include "eden/fs/store/StatsFetchContext.h"
 #include "eden/fs/utils/PathFuncs.h"
 
@@ -33,6 +39,29 @@ class ObjectStore;
 class UserInfo;
 class TopLevelIgnores;
 class EdenMount;
+class Tree;
+
+/**
+ * The paths a diff is restricted to. A path is in scope if it is one of these
+ * paths, is under one of them, or is the parent directory of one of them,
+ * since those have to be walked to reach them. An empty scope contains every
+ * path.
+ */
+class DiffScope {
+ public:
+  DiffScope() = default;
+  explicit DiffScope(const std::vector<RelativePath>& paths);
+
+  bool empty() const {
+    return paths_.empty();
+  }
+
+  bool contains(RelativePathPiece path) const;
+
+ private:
+  folly::F14FastSet<std::string> paths_;
+  folly::F14FastSet<std::string> parents_;
+};
 
 /**
  * A helper class to store parameters for a TreeInode::diff() operation.
@@ -53,14 +82,18 @@ class DiffContext {
       bool listIgnored,
       CaseSensitivity caseSensitive,
       const ObjectStore* os,
-      std::unique_ptr<TopLevelIgnores> topLevelIgnores,
+      std::shared_ptr<const TopLevelIgnores> topLevelIgnores,
       LoadFileFunction loadFileContentsFromPath,
-      apache::thrift::ResponseChannelRequest* FOLLY_NULLABLE request = nullptr);
+      apache::thrift::ResponseChannelRequest* FOLLY_NULLABLE request = nullptr,
+      size_t maxConcurrentTreeFetches = 0);
 
   /**
    * Test only constructor.
    */
-  DiffContext(DiffCallback* cb, const ObjectStore* os);
+  DiffContext(
+      DiffCallback* cb,
+      const ObjectStore* os,
+      size_t maxConcurrentTreeFetches = 0);
 
   DiffContext(const DiffContext&) = delete;
   DiffContext& operator=(const DiffContext&) = delete;
@@ -86,6 +119,54 @@ class DiffContext {
   const GitIgnoreStack* getToplevelIgnore() const;
   bool isCancelled() const;
   LoadFileFunction getLoadFileContentsFromPath() const;
+
+  /**
+   * Restrict the diff to the given scope. The entries of the walked
+   * directories that are out of scope are skipped, but the subtrees that are
+   * only compared in source control may still be reported in full.
+   */
+  void setScope(DiffScope scope) {
+    scope_ = std::move(scope);
+  }
+
+  const DiffScope& getScope() const {
+    return scope_;
+  }
+
+  /**
+   * Fetch a Tree from the ObjectStore.
+   *
+   * When maxConcurrentTreeFetches is not 0, at most that many trees are
+   * fetched at once for this diff.  Trees requested over that limit are
+   * fetched in request order as the earlier fetches complete, so that a diff
+   * of two distant commits does not flood the BackingStore.
+   */
+  folly::Future<std::shared_ptr<const Tree>> getTree(const Hash& hash);
+
+  /**
+   * Fetch the SHA-1 of the contents of a blob from the ObjectStore.
+   *
+   * While a BlobSha1Batch is alive, requests are queued and then fetched
+   * together with ObjectStore::getBlobSha1s() once the last batch ends.
+   */
+  folly::Future<Hash> getBlobSha1(const Hash& hash);
+
+  /**
+   * Batches the getBlobSha1() calls made on a DiffContext during its
+   * lifetime, for instance by all the deferred entries of a directory.
+   */
+  class BlobSha1Batch {
+   public:
+    explicit BlobSha1Batch(DiffContext* context);
+    ~BlobSha1Batch();
+
+    BlobSha1Batch(const BlobSha1Batch&) = delete;
+    BlobSha1Batch& operator=(const BlobSha1Batch&) = delete;
+
+   private:
+    DiffContext* const context_;
+  };
+
   StatsFetchContext& getFetchContext() {
     return fetchContext_;
   }
@@ -96,11 +177,46 @@ class DiffContext {
   }
 
  private:
-  std::unique_ptr<TopLevelIgnores> topLevelIgnores_;
+  std::shared_ptr<const TopLevelIgnores> topLevelIgnores_;
   const LoadFileFunction loadFileContentsFromPath_;
   apache::thrift::ResponseChannelRequest* const FOLLY_NULLABLE request_;
   StatsFetchContext fetchContext_;
   CaseSensitivity caseSensitive_;
+  DiffScope scope_;
+
+  struct PendingTreeFetch {
+    Hash hash;
+    folly::Promise<std::shared_ptr<const Tree>> promise;
+  };
+  struct TreeFetchState {
+    size_t inFlight{0};
+    std::deque<PendingTreeFetch> pending;
+  };
+
+  /**
+   * Called when a tree fetch started by getTree() completes, to start the
+   * next pending fetch if any.
+   */
+  void treeFetchCompleted();
+
+  const size_t maxConcurrentTreeFetches_;
+  folly::Synchronized<TreeFetchState> treeFetches_;
+
+  struct PendingBlobSha1 {
+    Hash hash;
+    folly::Promise<Hash> promise;
+  };
+  struct BlobSha1BatchState {
+    size_t openBatches{0};
+    std::vector<PendingBlobSha1> pending;
+  };
+
+  /**
+   * Fetch the SHA-1s queued while BlobSha1Batches were alive.
+   */
+  void fetchBlobSha1s(std::vector<PendingBlobSha1> pending);
+
+  folly::Synchronized<BlobSha1BatchState> blobSha1Batches_;
 };
 
 } // namespace facebook::eden
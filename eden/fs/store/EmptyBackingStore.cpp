@@ -15,6 +15,7 @@
 
 using folly::makeSemiFuture;
 using folly::SemiFuture;
+using std::shared_ptr;
 using std::unique_ptr;
 
 namespace facebook::eden {
@@ -38,17 +39,17 @@ SemiFuture<unique_ptr<Tree>> EmptyBackingStore::getRootTree(
       std::domain_error("empty backing store"));
 }
 
-SemiFuture<unique_ptr<Tree>> EmptyBackingStore::getTree(
+SemiFuture<shared_ptr<const Tree>> EmptyBackingStore::getTree(
     const Hash& /* id */,
     ObjectFetchContext& /* context */) {
-  return makeSemiFuture<unique_ptr<Tree>>(
+  return makeSemiFuture<shared_ptr<const Tree>>(
       std::domain_error("empty backing store"));
 }
 
-SemiFuture<unique_ptr<Blob>> EmptyBackingStore::getBlob(
+SemiFuture<shared_ptr<const Blob>> EmptyBackingStore::getBlob(
     const Hash& /* id */,
     ObjectFetchContext& /* context */) {
-  return makeSemiFuture<unique_ptr<Blob>>(
+  return makeSemiFuture<shared_ptr<const Blob>>(
       std::domain_error("empty backing store"));
 }
 
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/FetchAttribution.h"
+
+#include <folly/hash/Hash.h>
+#include <folly/logging/xlog.h>
+#include <algorithm>
+
+namespace facebook::eden {
+
+size_t FetchAttribution::CauseHasher::operator()(const Cause& cause) const {
+  return folly::hash::hash_combine(cause.pid, static_cast<int>(cause.cause));
+}
+
+FetchAttribution::FetchAttribution(size_t capacity) : capacity_{capacity} {
+  XCHECK_GT(capacity_, 0u);
+}
+
+void FetchAttribution::record(
+    const ObjectFetchContext& context,
+    ObjectFetchContext::ObjectType type,
+    ObjectFetchContext::Origin origin) {
+  if (origin != ObjectFetchContext::FromDiskCache &&
+      origin != ObjectFetchContext::FromBackingStore) {
+    return;
+  }
+  Cause cause{context.getClientPid().value_or(0), context.getCause()};
+
+  auto state = state_.lock();
+  Entry* entry;
+  auto it = state->indices.find(cause);
+  if (it != state->indices.end()) {
+    entry = &state->entries[it->second];
+  } else if (state->entries.size() < capacity_) {
+    state->indices.emplace(cause, state->entries.size());
+    entry = &state->entries.emplace_back();
+    entry->cause = cause;
+  } else {
+    // Replace the lightest cause. The scan only happens for the causes which
+    // aren't heavy enough to be tracked.
+    auto lightest = std::min_element(
+        state->entries.begin(),
+        state->entries.end(),
+        [](const Entry& a, const Entry& b) { return a.weight < b.weight; });
+    state->indices.erase(lightest->cause);
+    state->indices.emplace(cause, lightest - state->entries.begin());
+    auto weight = lightest->weight;
+    *lightest = Entry{};
+    lightest->cause = cause;
+    lightest->weight = weight;
+    lightest->overestimate = weight;
+    entry = &*lightest;
+  }
+
+  ++entry->weight;
+  if (origin == ObjectFetchContext::FromDiskCache) {
+    ++entry->localStoreReads;
+  } else {
+    ++entry->backingStoreImports[type];
+  }
+}
+
+std::vector<FetchAttribution::Entry> FetchAttribution::getEntries() const {
+  auto entries = state_.lock()->entries;
+  std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+    return a.weight > b.weight;
+  });
+  return entries;
+}
+
+void FetchAttribution::clear() {
+  auto state = state_.lock();
+  state->entries.clear();
+  state->indices.clear();
+}
+
+} // namespace facebook::eden
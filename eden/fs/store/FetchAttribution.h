@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Synchronized.h>
+#include <folly/container/F14Map.h>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "eden/fs/store/ObjectFetchContext.h"
+
+namespace facebook::eden {
+
+/**
+ * Charges the local store reads and backing store imports of an ObjectStore
+ * to the process and interface which caused them, keeping only the heaviest
+ * of them.
+ *
+ * This is a Space-Saving heavy hitters summary: at most `capacity` causes are
+ * tracked, and a new cause replaces the lightest one, inheriting its weight as
+ * an overestimate. Any cause charged with more than a 1/capacity share of the
+ * fetches is therefore guaranteed to be tracked, with its weight overestimated
+ * by at most `overestimate`.
+ */
+class FetchAttribution {
+ public:
+  static constexpr size_t kDefaultCapacity = 256;
+
+  struct Cause {
+    // 0 when the fetch context has no client pid.
+    pid_t pid;
+    ObjectFetchContext::Cause cause;
+
+    bool operator==(const Cause& other) const {
+      return pid == other.pid && cause == other.cause;
+    }
+  };
+
+  struct Entry {
+    Cause cause;
+    uint64_t localStoreReads = 0;
+    uint64_t backingStoreImports[ObjectFetchContext::kObjectTypeEnumMax] = {};
+    // Sum of the charged fetches, including those inherited on replacement.
+    uint64_t weight = 0;
+    // The part of the weight inherited from the replaced cause.
+    uint64_t overestimate = 0;
+  };
+
+  explicit FetchAttribution(size_t capacity = kDefaultCapacity);
+
+  /**
+   * Charge the fetch to its cause, unless it was satisfied from memory.
+   */
+  void record(
+      const ObjectFetchContext& context,
+      ObjectFetchContext::ObjectType type,
+      ObjectFetchContext::Origin origin);
+
+  /**
+   * The tracked causes, the heaviest first.
+   */
+  std::vector<Entry> getEntries() const;
+
+  void clear();
+
+ private:
+  struct CauseHasher {
+    size_t operator()(const Cause& cause) const;
+  };
+
+  struct State {
+    std::vector<Entry> entries;
+    folly::F14FastMap<Cause, size_t, CauseHasher> indices;
+  };
+
+  const size_t capacity_;
+  folly::Synchronized<State, std::mutex> state_;
+};
+
+} // namespace facebook::eden
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/FrequencySketch.h"
+
+#include <algorithm>
+#include <array>
+
+#include <folly/Bits.h>
+#include <folly/hash/Hash.h>
+
+namespace facebook::eden {
+
+namespace {
+constexpr size_t kMinimumWidth = 64;
+
+// Arbitrary odd constants, so that a key lands on unrelated counters in
+// each row.
+constexpr std::array<uint64_t, FrequencySketch::kDepth> kRowSeeds = {
+    0x97cb3127c4d1e2f5,
+    0xc2b2ae3d27d4eb4f,
+    0x165667b19e3779f9,
+    0x9e3779b97f4a7c15,
+};
+} // namespace
+
+void FrequencySketch::ensureCapacity(size_t entries) {
+  auto width = folly::nextPowTwo(std::max(entries, kMinimumWidth));
+  if (!table_.empty() && width <= getWidth()) {
+    return;
+  }
+  table_.assign(width * kDepth, 0);
+  widthMask_ = width - 1;
+  additions_ = 0;
+  sampleSize_ = width * 10;
+}
+
+size_t FrequencySketch::index(uint64_t key, size_t row) const {
+  return row * getWidth() +
+      (folly::hash::twang_mix64(key ^ kRowSeeds[row]) & widthMask_);
+}
+
+void FrequencySketch::increment(uint64_t key) {
+  if (table_.empty()) {
+    return;
+  }
+  bool incremented = false;
+  for (size_t row = 0; row < kDepth; ++row) {
+    auto& counter = table_[index(key, row)];
+    if (counter < kMaxCount) {
+      ++counter;
+      incremented = true;
+    }
+  }
+  if (incremented && ++additions_ >= sampleSize_) {
+    age();
+  }
+}
+
+uint8_t FrequencySketch::estimate(uint64_t key) const {
+  if (table_.empty()) {
+    return 0;
+  }
+  uint8_t count = kMaxCount;
+  for (size_t row = 0; row < kDepth; ++row) {
+    count = std::min(count, table_[index(key, row)]);
+  }
+  return count;
+}
+
+void FrequencySketch::clear() {
+  std::fill(table_.begin(), table_.end(), 0);
+  additions_ = 0;
+}
+
+void FrequencySketch::age() {
+  for (auto& counter : table_) {
+    counter >>= 1;
+  }
+  additions_ /= 2;
+}
+
+} // namespace facebook::eden
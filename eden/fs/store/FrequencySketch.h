@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace facebook::eden {
+
+/**
+ * A count-min sketch estimating how often keys were seen recently, in a
+ * fixed amount of memory regardless of the number of distinct keys.
+ *
+ * Each key increments one counter in each of kDepth rows, and its estimate
+ * is the smallest of them, so collisions can only make a key look more
+ * frequent than it is. The counters saturate at kMaxCount, and are all
+ * halved once the number of increments reaches ten times the width, so
+ * keys that stop being accessed fade out.
+ *
+ * This is not thread safe.
+ */
+class FrequencySketch {
+ public:
+  static constexpr uint8_t kMaxCount = 15;
+  static constexpr size_t kDepth = 4;
+
+  /**
+   * Resize the sketch so that it can tell apart about `entries` keys. The
+   * counts are reset if the width changes. Shrinking is never done.
+   */
+  void ensureCapacity(size_t entries);
+
+  void increment(uint64_t key);
+
+  uint8_t estimate(uint64_t key) const;
+
+  void clear();
+
+  size_t getWidth() const {
+    return widthMask_ + 1;
+  }
+
+ private:
+  size_t index(uint64_t key, size_t row) const;
+
+  /**
+   * Halve all the counters.
+   */
+  void age();
+
+  /// kDepth rows of getWidth() counters, empty until ensureCapacity().
+  std::vector<uint8_t> table_;
+  size_t widthMask_{0};
+  size_t additions_{0};
+  size_t sampleSize_{0};
+};
+
+} // namespace facebook::eden
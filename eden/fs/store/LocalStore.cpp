@@ -14,9 +14,11 @@
 #include <folly/io/IOBuf.h>
 #include <folly/lang/Bits.h>
 #include <folly/logging/xlog.h>
+#include <gflags/gflags.h>
 #include <array>
 
 #include "eden/fs/model/Blob.h"
+#include "eden/fs/model/FlatTree.h"
 #include "eden/fs/model/Tree.h"
 #include "eden/fs/model/git/GitBlob.h"
 #include "eden/fs/model/git/GitTree.h"
@@ -31,6 +33,14 @@ using folly::io::Cursor;
 using std::optional;
 using std::string;
 
+DEFINE_bool(
+    localStoreFlatTrees,
+    false,
+    "Store trees in the LocalStore in the flat format, which keeps the size "
+    "and SHA-1 of their entries and is faster to read, rather than in the "
+    "Git format. Versions of EdenFS that predate the flat format cannot read "
+    "these trees.");
+
 namespace facebook::eden {
 
 void LocalStore::clearDeprecatedKeySpaces() {
@@ -103,6 +113,10 @@ folly::Future<std::unique_ptr<Tree>> LocalStore::getTree(const Hash& id) const {
         if (!data.isValid()) {
           return std::unique_ptr<Tree>(nullptr);
         }
+        // Both formats are read, regardless of --localStoreFlatTrees.
+        if (FlatTreeView::isFlatTree(data.bytes())) {
+          return FlatTreeView{data.bytes()}.toTree(id);
+        }
         return deserializeGitTree(id, data.bytes());
       });
 }
@@ -134,7 +148,33 @@ folly::Future<optional<BlobMetadata>> LocalStore::getBlobMetadata(
       });
 }
 
+folly::Future<std::vector<optional<BlobMetadata>>>
+LocalStore::getBlobMetadataBatch(const std::vector<Hash>& ids) const {
+  std::vector<folly::ByteRange> keys;
+  keys.reserve(ids.size());
+  for (const auto& id : ids) {
+    keys.push_back(id.getBytes());
+  }
+  return getBatch(KeySpace::BlobMetaDataFamily, keys)
+      .thenValue([ids](std::vector<StoreResult>&& data) {
+        std::vector<optional<BlobMetadata>> results;
+        results.reserve(ids.size());
+        for (size_t i = 0; i < ids.size(); ++i) {
+          if (data[i].isValid()) {
+            results.emplace_back(
+                SerializedBlobMetadata::parse(ids[i], data[i]));
+          } else {
+            results.emplace_back(std::nullopt);
+          }
+        }
+        return results;
+      });
+}
+
 folly::IOBuf LocalStore::serializeTree(const Tree& tree) {
+  if (FLAGS_localStoreFlatTrees) {
+    return FlatTreeView::serialize(tree);
+  }
   GitTreeSerializer serializer;
   for (auto& entry : tree.getTreeEntries()) {
     serializer.addEntry(std::move(entry));
@@ -193,6 +233,14 @@ BlobMetadata LocalStore::getMetadataFromBlob(const Blob* blob) {
 }
 
 void LocalStore::putTreeMetadata(
+    const TreeMetadata& treeMetadata,
+    const Tree& tree) {
+  auto writeBatch = beginWrite();
+  writeBatch->putTreeMetadata(treeMetadata, tree);
+  writeBatch->flush();
+}
+
+void LocalStore::WriteBatch::putTreeMetadata(
     const TreeMetadata& rawTreeMetadata,
     const Tree& tree) {
   // make sure that the tree entries are indexed by hash
@@ -217,17 +265,15 @@ void LocalStore::putTreeMetadata(
   }
 }
 
-void LocalStore::putNormalizedTreeMetadata(
+void LocalStore::WriteBatch::putNormalizedTreeMetadata(
     const Hash& hash,
     const TreeMetadata& treeMetadata) {
-  auto writeBatch = beginWrite();
   // store metadata for each blob in the local store under their blob ids
   for (const auto& [entryId, metadata] :
        std::get<TreeMetadata::HashIndexedEntryMetadata>(
            treeMetadata.entries())) {
     SerializedBlobMetadata metadataBytes(metadata);
-    writeBatch->put(
-        KeySpace::BlobMetaDataFamily,
+    put(KeySpace::BlobMetaDataFamily,
         entryId.getBytes(),
         metadataBytes.slice());
   }
@@ -235,11 +281,9 @@ void LocalStore::putNormalizedTreeMetadata(
   // store all metadata for tree in the local store under the tree id
   auto buf = treeMetadata.serialize();
   buf.coalesce();
-  writeBatch->put(
-      KeySpace::TreeMetaDataFamily,
+  put(KeySpace::TreeMetaDataFamily,
       hash.getBytes(),
       folly::ByteRange(buf.data(), buf.length()));
-  writeBatch->flush();
 }
 
 void LocalStore::put(
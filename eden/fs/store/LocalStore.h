@@ -135,12 +135,22 @@ class LocalStore : public std::enable_shared_from_this<LocalStore> {
   folly::Future<std::optional<BlobMetadata>> getBlobMetadata(
       const Hash& id) const;
 
+  /**
+   * Get the metadata of several blobs with a single batch read, in the same
+   * order as ids.
+   */
+  folly::Future<std::vector<std::optional<BlobMetadata>>> getBlobMetadataBatch(
+      const std::vector<Hash>& ids) const;
+
   /**
    * Compute the serialized version of the tree in a (not coalesced) IOBuf.
    * This does not modify the contents of the store; it is the method
    * used by the putTree method to compute the data that it stores.
    * This is useful when computing the overall set of data during a
    * two phase import.
+   *
+   * The tree is serialized in the Git format, or, with --localStoreFlatTrees,
+   * in the format of FlatTreeView.
    */
   static folly::IOBuf serializeTree(const Tree& tree);
 
@@ -205,6 +215,12 @@ class LocalStore : public std::enable_shared_from_this<LocalStore> {
      */
     void putBlob(const Hash& id, const Blob* blob);
 
+    /**
+     * Store metadata for each of the entries in the Tree, like
+     * LocalStore::putTreeMetadata.
+     */
+    void putTreeMetadata(const TreeMetadata& treeMetadata, const Tree& tree);
+
     /**
      * Put arbitrary data in the store.
      */
@@ -236,6 +252,18 @@ class LocalStore : public std::enable_shared_from_this<LocalStore> {
 
    private:
     friend class LocalStore;
+
+    /**
+     * Store metadata for each of the entries in the Tree. This stores the
+     * blob metadata for each entry under the identifing hash of that entry
+     * and stores a copy of metadata for each entry under the identifying
+     * hash of the tree.
+     *
+     * note: this assumes `treeMetadata` contains HashIndexedEntryMetadata
+     */
+    void putNormalizedTreeMetadata(
+        const Hash& hash,
+        const TreeMetadata& treeMetadata);
   };
 
   BlobMetadata getMetadataFromBlob(const Blob* blob);
@@ -261,19 +289,6 @@ class LocalStore : public std::enable_shared_from_this<LocalStore> {
    * the configured local store management interval is).
    */
   std::atomic<bool> enableBlobCaching = true;
-
- private:
-  /**
-   * Store metadata for each of the entries in the Tree. This stores the
-   * blob metadata for each entry under the identifing hash of that entry and
-   * stores a copy of metadata for each entry under the identifying hash
-   * of the tree.
-   *
-   * note: this assumes `treeMetadata` contains HashIndexedEntryMetadata
-   */
-  void putNormalizedTreeMetadata(
-      const Hash& hash,
-      const TreeMetadata& treeMetadata);
 };
 
 } // namespace facebook::eden
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/LocalStoreAccessLog.h"
+
+#include <fcntl.h>
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <folly/Random.h>
+#include <folly/String.h>
+#include <folly/logging/xlog.h>
+#include <sys/stat.h>
+#include <cstdio>
+#include <optional>
+#include <vector>
+
+namespace facebook::eden {
+
+namespace {
+constexpr folly::StringPiece kOldSuffix{".old"};
+
+folly::File openLog(AbsolutePathPiece path) {
+  return folly::File{
+      path.stringPiece(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644};
+}
+
+std::optional<LocalStoreAccessLog::Access> parseLine(folly::StringPiece line) {
+  std::vector<folly::StringPiece> fields;
+  folly::split(' ', line, fields);
+  if (fields.size() != 3) {
+    return std::nullopt;
+  }
+  std::string key;
+  if (!folly::unhexlify(fields[1], key)) {
+    return std::nullopt;
+  }
+  bool hit;
+  if (fields[2] == "hit") {
+    hit = true;
+  } else if (fields[2] == "miss") {
+    hit = false;
+  } else {
+    return std::nullopt;
+  }
+  for (auto& ks : KeySpace::kAll) {
+    if (fields[0] == ks->name) {
+      return LocalStoreAccessLog::Access{ks, std::move(key), hit};
+    }
+  }
+  return std::nullopt;
+}
+
+void readFile(
+    const std::string& path,
+    folly::FunctionRef<void(const LocalStoreAccessLog::Access&)> fn) {
+  std::string contents;
+  if (!folly::readFile(path.c_str(), contents)) {
+    return;
+  }
+  folly::StringPiece rest{contents};
+  while (!rest.empty()) {
+    auto end = rest.find('\n');
+    if (end == folly::StringPiece::npos) {
+      // A line cut short while it was written.
+      break;
+    }
+    if (auto access = parseLine(rest.subpiece(0, end))) {
+      fn(*access);
+    }
+    rest.advance(end + 1);
+  }
+}
+} // namespace
+
+LocalStoreAccessLog::LocalStoreAccessLog(
+    AbsolutePathPiece path,
+    uint32_t sampleDenominator,
+    uint64_t maxBytes)
+    : path_{path}, sampleDenominator_{sampleDenominator}, maxBytes_{maxBytes} {
+  auto state = state_.wlock();
+  state->file = openLog(path_);
+  struct stat st;
+  folly::checkUnixError(
+      fstat(state->file.fd(), &st), "failed to stat the access log");
+  state->bytes = st.st_size;
+}
+
+void LocalStoreAccessLog::record(
+    KeySpace keySpace,
+    folly::ByteRange key,
+    bool hit) {
+  if (sampleDenominator_ > 1 &&
+      0 != folly::Random::rand32(sampleDenominator_)) {
+    return;
+  }
+  auto line = folly::to<std::string>(
+      keySpace->name,
+      " ",
+      folly::hexlify(key),
+      hit ? " hit\n" : " miss\n");
+
+  auto state = state_.wlock();
+  if (state->bytes + line.size() > maxBytes_) {
+    rotate(*state);
+  }
+  if (folly::writeFull(state->file.fd(), line.data(), line.size()) < 0) {
+    XLOG_EVERY_MS(WARN, 60000)
+        << "failed to write to the local store access log " << path_ << ": "
+        << folly::errnoStr(errno);
+    return;
+  }
+  state->bytes += line.size();
+}
+
+void LocalStoreAccessLog::rotate(State& state) {
+  auto oldPath = folly::to<std::string>(path_.stringPiece(), kOldSuffix);
+  if (rename(path_.c_str(), oldPath.c_str()) != 0) {
+    XLOG_EVERY_MS(WARN, 60000)
+        << "failed to rotate the local store access log " << path_ << ": "
+        << folly::errnoStr(errno);
+  }
+  try {
+    state.file = openLog(path_);
+  } catch (const std::exception& ex) {
+    XLOG_EVERY_MS(WARN, 60000)
+        << "failed to reopen the local store access log: " << ex.what();
+  }
+  state.bytes = 0;
+}
+
+void LocalStoreAccessLog::read(
+    AbsolutePathPiece path,
+    folly::FunctionRef<void(const Access&)> fn) {
+  readFile(folly::to<std::string>(path.stringPiece(), kOldSuffix), fn);
+  readFile(path.stringPiece().str(), fn);
+}
+
+} // namespace facebook::eden
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/File.h>
+#include <folly/Function.h>
+#include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <string>
+
+#include "eden/fs/store/KeySpace.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook::eden {
+
+/**
+ * A log of a sample of the reads of a LocalStore, from which
+ * eden_store_util estimates hit rates and finds the popular objects.
+ *
+ * Each line is "<key space> <hex key> <hit|miss>". Once the log exceeds
+ * maxBytes it is renamed with a ".old" suffix and a new one started, so it
+ * takes up at most twice that.
+ */
+class LocalStoreAccessLog {
+ public:
+  static constexpr uint64_t kDefaultMaxBytes = 64 * 1024 * 1024;
+
+  /**
+   * Log one read out of sampleDenominator to the file at path, appending to
+   * it if it exists.
+   */
+  LocalStoreAccessLog(
+      AbsolutePathPiece path,
+      uint32_t sampleDenominator,
+      uint64_t maxBytes = kDefaultMaxBytes);
+
+  /**
+   * Log the read if it is sampled. Cheap when it isn't.
+   */
+  void record(KeySpace keySpace, folly::ByteRange key, bool hit);
+
+  struct Access {
+    KeySpace keySpace;
+    std::string key;
+    bool hit;
+  };
+
+  /**
+   * Call fn with the reads logged at path, oldest first, including the
+   * rotated log. Malformed lines, such as one cut short by a crash, are
+   * skipped.
+   */
+  static void read(
+      AbsolutePathPiece path,
+      folly::FunctionRef<void(const Access&)> fn);
+
+ private:
+  struct State {
+    folly::File file;
+    uint64_t bytes{0};
+  };
+
+  void rotate(State& state);
+
+  const AbsolutePath path_;
+  const uint32_t sampleDenominator_;
+  const uint64_t maxBytes_;
+  folly::Synchronized<State> state_;
+};
+
+} // namespace facebook::eden
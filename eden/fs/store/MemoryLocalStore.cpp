@@ -7,6 +7,12 @@
 
 #include "eden/fs/store/MemoryLocalStore.h"
 #include <folly/String.h>
+#include <folly/futures/Future.h>
+#include <folly/hash/Hash.h>
+#include <folly/io/IOBuf.h>
+#include <algorithm>
+#include <optional>
+#include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/store/StoreResult.h"
 
 namespace facebook::eden {
@@ -14,15 +20,24 @@ namespace facebook::eden {
 using folly::StringPiece;
 
 namespace {
-class MemoryWriteBatch : public LocalStore::WriteBatch {
+// Smaller values are copied out of the store, as that is cheaper than
+// sharing them through a reference-counted IOBuf.
+constexpr size_t kMinSharedValueSize = 4096;
+
+void freeSharedValue(void* /* buffer */, void* userData) {
+  delete static_cast<std::shared_ptr<const std::string>*>(userData);
+}
+} // namespace
+
+class MemoryLocalStore::Batch : public LocalStore::WriteBatch {
  public:
-  explicit MemoryWriteBatch(MemoryLocalStore* store) : store_(store) {
-    storage_.resize(KeySpace::kTotalCount);
-  }
+  explicit Batch(MemoryLocalStore* store) : store_(store) {}
 
   void put(KeySpace keySpace, folly::ByteRange key, folly::ByteRange value)
       override {
-    storage_[keySpace->index][StringPiece(key)] = StringPiece(value).str();
+    entries_[keySpace->index].push_back(Entry{
+        StringPiece(key).str(),
+        std::make_shared<const std::string>(StringPiece(value).str())});
   }
 
   void put(
@@ -33,62 +48,249 @@ class MemoryWriteBatch : public LocalStore::WriteBatch {
     for (const auto& slice : valueSlices) {
       value.append(reinterpret_cast<const char*>(slice.data()), slice.size());
     }
-    put(keySpace, key, StringPiece(value));
+    entries_[keySpace->index].push_back(Entry{
+        StringPiece(key).str(),
+        std::make_shared<const std::string>(std::move(value))});
   }
 
   void flush() override {
     for (auto& ks : KeySpace::kAll) {
-      for (const auto& it : storage_[ks->index]) {
-        store_->put(ks, folly::StringPiece(it.first), StringPiece(it.second));
+      if (!entries_[ks->index].empty()) {
+        store_->insertBatch(ks, std::move(entries_[ks->index]));
+        entries_[ks->index].clear();
       }
-      storage_[ks->index].clear();
     }
   }
 
  private:
   MemoryLocalStore* store_;
-  std::vector<folly::StringKeyedUnorderedMap<std::string>> storage_;
+  std::array<std::vector<Entry>, KeySpace::kTotalCount> entries_;
 };
-} // namespace
 
-MemoryLocalStore::MemoryLocalStore() {
-  storage_.wlock()->resize(KeySpace::kTotalCount);
+MemoryLocalStore::MemoryLocalStore(size_t shardCount)
+    : shards_(std::max(shardCount, size_t{1})) {}
+
+MemoryLocalStore::MemoryLocalStore(const EdenConfig& config, size_t shardCount)
+    : MemoryLocalStore(shardCount) {
+  periodicManagementTask(config);
 }
 
 void MemoryLocalStore::close() {}
 
 void MemoryLocalStore::clearKeySpace(KeySpace keySpace) {
-  (*storage_.wlock())[keySpace->index].clear();
+  for (auto& lockedShard : shards_) {
+    auto shard = lockedShard.lock();
+    auto& ks = (*shard)[keySpace->index];
+    ks.index.clear();
+    ks.lru.clear();
+    ks.bytes = 0;
+  }
 }
 
 void MemoryLocalStore::compactKeySpace(KeySpace) {}
 
+size_t MemoryLocalStore::shardIndex(folly::ByteRange key) const {
+  // Mix the hash again so that the keys of a shard don't all share the low
+  // bits of the hash its F14 index uses.
+  return folly::hash::twang_mix64(folly::hasher<StringPiece>{}(
+             StringPiece(key))) %
+      shards_.size();
+}
+
+StoreResult MemoryLocalStore::lookup(
+    KeySpace keySpace,
+    KeySpaceShard& shard,
+    folly::ByteRange key) const {
+  auto it = shard.index.find(StringPiece(key));
+  if (it == shard.index.end()) {
+    return StoreResult::missing(keySpace, key);
+  }
+  shard.lru.splice(shard.lru.end(), shard.lru, it->second);
+
+  const auto& value = it->second->value;
+  if (value->size() < kMinSharedValueSize) {
+    return StoreResult(std::string(*value));
+  }
+  // Extract the data and size before we pass the reference to the IOBuf
+  // constructor, since arguments are evaluated in an arbitrary order.
+  auto data = const_cast<char*>(value->data());
+  auto size = value->size();
+  return StoreResult(folly::IOBuf(
+      folly::IOBuf::TAKE_OWNERSHIP,
+      data,
+      size,
+      freeSharedValue,
+      new std::shared_ptr<const std::string>(value)));
+}
+
 StoreResult MemoryLocalStore::get(KeySpace keySpace, folly::ByteRange key)
     const {
-  auto store = storage_.rlock();
-  auto it = (*store)[keySpace->index].find(StringPiece(key));
-  if (it == (*store)[keySpace->index].end()) {
-    return StoreResult::missing(keySpace, key);
+  auto shard = shards_[shardIndex(key)].lock();
+  return lookup(keySpace, (*shard)[keySpace->index], key);
+}
+
+folly::Future<StoreResult> MemoryLocalStore::getFuture(
+    KeySpace keySpace,
+    folly::ByteRange key) const {
+  // Lookups never block on I/O, so skip the executor hop.
+  return folly::makeFuture(get(keySpace, key));
+}
+
+folly::Future<std::vector<StoreResult>> MemoryLocalStore::getBatch(
+    KeySpace keySpace,
+    const std::vector<folly::ByteRange>& keys) const {
+  std::vector<std::vector<size_t>> keysByShard(shards_.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    keysByShard[shardIndex(keys[i])].push_back(i);
   }
-  return StoreResult(std::string(it->second));
+
+  std::vector<std::optional<StoreResult>> found(keys.size());
+  for (size_t s = 0; s < shards_.size(); ++s) {
+    if (keysByShard[s].empty()) {
+      continue;
+    }
+    auto shard = shards_[s].lock();
+    auto& ks = (*shard)[keySpace->index];
+    for (auto i : keysByShard[s]) {
+      found[i] = lookup(keySpace, ks, keys[i]);
+    }
+  }
+
+  std::vector<StoreResult> results;
+  results.reserve(keys.size());
+  for (auto& result : found) {
+    results.push_back(std::move(*result));
+  }
+  return folly::makeFuture(std::move(results));
 }
 
 bool MemoryLocalStore::hasKey(KeySpace keySpace, folly::ByteRange key) const {
-  auto store = storage_.rlock();
-  auto it = (*store)[keySpace->index].find(StringPiece(key));
-  return it != (*store)[keySpace->index].end();
+  auto shard = shards_[shardIndex(key)].lock();
+  return (*shard)[keySpace->index].index.count(StringPiece(key)) != 0;
+}
+
+void MemoryLocalStore::insert(
+    KeySpace keySpace,
+    KeySpaceShard& shard,
+    std::string key,
+    std::shared_ptr<const std::string> value) {
+  auto it = shard.index.find(StringPiece(key));
+  if (it != shard.index.end()) {
+    auto& entry = *it->second;
+    shard.bytes -= entry.value->size();
+    shard.bytes += value->size();
+    entry.value = std::move(value);
+    shard.lru.splice(shard.lru.end(), shard.lru, it->second);
+  } else {
+    shard.bytes += key.size() + value->size();
+    shard.lru.push_back(Entry{std::move(key), std::move(value)});
+    auto last = std::prev(shard.lru.end());
+    shard.index.emplace(StringPiece(last->key), last);
+  }
+  evict(keySpace, shard);
+}
+
+void MemoryLocalStore::evict(KeySpace keySpace, KeySpaceShard& shard) {
+  auto limit = shardLimits_[keySpace->index].load(std::memory_order_relaxed);
+  if (limit == 0) {
+    return;
+  }
+  while (shard.bytes > limit && !shard.lru.empty()) {
+    auto& oldest = shard.lru.front();
+    shard.bytes -= oldest.key.size() + oldest.value->size();
+    shard.index.erase(StringPiece(oldest.key));
+    shard.lru.pop_front();
+  }
 }
 
 void MemoryLocalStore::put(
     KeySpace keySpace,
     folly::ByteRange key,
     folly::ByteRange value) {
-  (*storage_.wlock())[keySpace->index][StringPiece(key)] =
-      StringPiece(value).str();
+  auto entryValue =
+      std::make_shared<const std::string>(StringPiece(value).str());
+  auto shard = shards_[shardIndex(key)].lock();
+  insert(
+      keySpace,
+      (*shard)[keySpace->index],
+      StringPiece(key).str(),
+      std::move(entryValue));
+}
+
+void MemoryLocalStore::insertBatch(
+    KeySpace keySpace,
+    std::vector<Entry>&& entries) {
+  std::vector<std::vector<Entry*>> entriesByShard(shards_.size());
+  for (auto& entry : entries) {
+    entriesByShard[shardIndex(StringPiece(entry.key))].push_back(&entry);
+  }
+  for (size_t s = 0; s < shards_.size(); ++s) {
+    if (entriesByShard[s].empty()) {
+      continue;
+    }
+    auto shard = shards_[s].lock();
+    auto& ks = (*shard)[keySpace->index];
+    for (auto* entry : entriesByShard[s]) {
+      insert(keySpace, ks, std::move(entry->key), std::move(entry->value));
+    }
+  }
 }
 
 std::unique_ptr<LocalStore::WriteBatch> MemoryLocalStore::beginWrite(size_t) {
-  return std::make_unique<MemoryWriteBatch>(this);
+  return std::make_unique<Batch>(this);
+}
+
+void MemoryLocalStore::periodicManagementTask(const EdenConfig& config) {
+  enableBlobCaching.store(
+      config.enableBlobCaching.getValue(), std::memory_order_relaxed);
+
+  // Split the memory limit between the ephemeral key spaces in proportion
+  // to their cache limits.
+  auto memoryLimit = config.localStoreMemoryLimit.getValue();
+  double totalCacheLimit = 0;
+  for (auto& ks : KeySpace::kAll) {
+    if (const auto* ephemeral = std::get_if<Ephemeral>(&ks->persistence)) {
+      totalCacheLimit += (config.*(ephemeral->cacheLimit)).getValue();
+    }
+  }
+  for (auto& ks : KeySpace::kAll) {
+    uint64_t shardLimit = 0;
+    const auto* ephemeral = std::get_if<Ephemeral>(&ks->persistence);
+    if (memoryLimit > 0 && ephemeral && totalCacheLimit > 0) {
+      auto share = (config.*(ephemeral->cacheLimit)).getValue() /
+          totalCacheLimit;
+      // Never round down to 0, which would mean unbounded.
+      shardLimit = std::max<uint64_t>(
+          1, static_cast<uint64_t>(memoryLimit * share / shards_.size()));
+    }
+    shardLimits_[ks->index].store(shardLimit, std::memory_order_relaxed);
+  }
+
+  for (auto& lockedShard : shards_) {
+    auto shard = lockedShard.lock();
+    for (auto& ks : KeySpace::kAll) {
+      evict(ks, (*shard)[ks->index]);
+    }
+  }
+}
+
+void MemoryLocalStore::setSizeLimit(KeySpace keySpace, uint64_t limit) {
+  uint64_t shardLimit = 0;
+  if (limit > 0) {
+    shardLimit = std::max<uint64_t>(1, limit / shards_.size());
+  }
+  shardLimits_[keySpace->index].store(shardLimit, std::memory_order_relaxed);
+  for (auto& lockedShard : shards_) {
+    evict(keySpace, (*lockedShard.lock())[keySpace->index]);
+  }
+}
+
+uint64_t MemoryLocalStore::getApproximateSize(KeySpace keySpace) const {
+  uint64_t size = 0;
+  for (auto& lockedShard : shards_) {
+    size += (*lockedShard.lock())[keySpace->index].bytes;
+  }
+  return size;
 }
 
 } // namespace facebook::eden
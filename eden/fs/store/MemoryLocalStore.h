@@ -7,33 +7,129 @@
 
 #pragma once
 #include <folly/Synchronized.h>
-#include <folly/experimental/StringKeyedUnorderedMap.h>
+#include <folly/container/F14Map.h>
+#include <array>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
 #include "eden/fs/store/LocalStore.h"
 
 namespace facebook::eden {
 
 /** An implementation of LocalStore that stores values in memory.
- * Stored values remain in memory for the lifetime of the
- * MemoryLocalStore instance.
  * MemoryLocalStore is thread safe, allowing concurrent reads and
  * writes from any thread.
+ *
+ * Keys are spread over shards, each with its own lock, so that concurrent
+ * accesses to different keys rarely contend.
+ *
+ * By default stored values remain in memory for the lifetime of the
+ * MemoryLocalStore instance. When constructed with an EdenConfig, the
+ * ephemeral key spaces share the memory limit set by store:memory-limit in
+ * proportion to their store:*-size-limit settings, and evict their least
+ * recently used values past it. Persistent key spaces are never evicted,
+ * unless the MemoryLocalStore caches another store and is given explicit
+ * limits with setSizeLimit().
  * */
 class MemoryLocalStore : public LocalStore {
  public:
-  explicit MemoryLocalStore();
+  static constexpr size_t kDefaultShardCount = 16;
+
+  explicit MemoryLocalStore(size_t shardCount = kDefaultShardCount);
+  explicit MemoryLocalStore(
+      const EdenConfig& config,
+      size_t shardCount = kDefaultShardCount);
+
   void close() override;
   void clearKeySpace(KeySpace keySpace) override;
   void compactKeySpace(KeySpace keySpace) override;
   StoreResult get(KeySpace keySpace, folly::ByteRange key) const override;
+  FOLLY_NODISCARD folly::Future<StoreResult> getFuture(
+      KeySpace keySpace,
+      folly::ByteRange key) const override;
+  FOLLY_NODISCARD folly::Future<std::vector<StoreResult>> getBatch(
+      KeySpace keySpace,
+      const std::vector<folly::ByteRange>& keys) const override;
   bool hasKey(KeySpace keySpace, folly::ByteRange key) const override;
   void put(KeySpace keySpace, folly::ByteRange key, folly::ByteRange value)
       override;
   std::unique_ptr<LocalStore::WriteBatch> beginWrite(
       size_t bufSize = 0) override;
 
+  /**
+   * Update the memory limits of the ephemeral key spaces, and evict the
+   * values past them.
+   */
+  void periodicManagementTask(const EdenConfig& config) override;
+
+  /**
+   * Limit the memory used by a key space, whether or not it is ephemeral,
+   * evicting its least recently used values past the limit. 0 means
+   * unbounded. Only for a MemoryLocalStore caching another store, since
+   * the limit is reset by periodicManagementTask().
+   */
+  void setSizeLimit(KeySpace keySpace, uint64_t limit);
+
+  /**
+   * The total size of the keys and values of the key space.
+   */
+  uint64_t getApproximateSize(KeySpace keySpace) const;
+
  private:
-  folly::Synchronized<std::vector<folly::StringKeyedUnorderedMap<std::string>>>
-      storage_;
+  class Batch;
+
+  struct Entry {
+    std::string key;
+    std::shared_ptr<const std::string> value;
+  };
+
+  /**
+   * The values of a key space in a shard, in least recently used order.
+   * The index keys point into the entries of the list.
+   */
+  struct KeySpaceShard {
+    std::list<Entry> lru;
+    folly::F14FastMap<folly::StringPiece, std::list<Entry>::iterator> index;
+    uint64_t bytes{0};
+  };
+
+  using Shard = std::array<KeySpaceShard, KeySpace::kTotalCount>;
+
+  size_t shardIndex(folly::ByteRange key) const;
+
+  /**
+   * Look up a key, marking it as the most recently used one of its shard.
+   */
+  StoreResult lookup(
+      KeySpace keySpace,
+      KeySpaceShard& shard,
+      folly::ByteRange key) const;
+
+  void insert(
+      KeySpace keySpace,
+      KeySpaceShard& shard,
+      std::string key,
+      std::shared_ptr<const std::string> value);
+
+  /**
+   * Evict the least recently used values of the shard until it fits in its
+   * part of the key space limit.
+   */
+  void evict(KeySpace keySpace, KeySpaceShard& shard);
+
+  /**
+   * Insert entries grouped by shard, taking each shard lock once.
+   */
+  void insertBatch(KeySpace keySpace, std::vector<Entry>&& entries);
+
+  // The memory limit of each key space, divided by the number of shards.
+  // 0 means unbounded.
+  std::array<std::atomic<uint64_t>, KeySpace::kTotalCount> shardLimits_{};
+
+  // Shards are touched on reads too, to update the LRU order, so they are
+  // guarded by plain mutexes rather than reader-writer locks.
+  mutable std::vector<folly::Synchronized<Shard, std::mutex>> shards_;
 };
 
 } // namespace facebook::eden
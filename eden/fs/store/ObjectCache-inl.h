@@ -6,7 +6,9 @@
  */
 
 #include <folly/MapUtil.h>
+#include <folly/hash/Hash.h>
 #include <folly/logging/xlog.h>
+#include <algorithm>
 #include <utility>
 
 #include "eden/fs/store/ObjectCache.h"
@@ -61,20 +63,43 @@ template <typename ObjectType, ObjectCacheFlavor Flavor>
 std::shared_ptr<ObjectCache<ObjectType, Flavor>>
 ObjectCache<ObjectType, Flavor>::create(
     size_t maximumCacheSizeBytes,
-    size_t minimumEntryCount) {
+    size_t minimumEntryCount,
+    size_t shardCount,
+    ObjectCachePolicy policy) {
   // Allow make_shared with private constructor.
   struct OC : ObjectCache<ObjectType, Flavor> {
-    OC(size_t x, size_t y) : ObjectCache<ObjectType, Flavor>{x, y} {}
+    OC(size_t x, size_t y, size_t z, ObjectCachePolicy p)
+        : ObjectCache<ObjectType, Flavor>{x, y, z, p} {}
   };
-  return std::make_shared<OC>(maximumCacheSizeBytes, minimumEntryCount);
+  return std::make_shared<OC>(
+      maximumCacheSizeBytes, minimumEntryCount, shardCount, policy);
 }
 
 template <typename ObjectType, ObjectCacheFlavor Flavor>
 ObjectCache<ObjectType, Flavor>::ObjectCache(
     size_t maximumCacheSizeBytes,
-    size_t minimumEntryCount)
-    : maximumCacheSizeBytes_{maximumCacheSizeBytes},
-      minimumEntryCount_{minimumEntryCount} {}
+    size_t minimumEntryCount,
+    size_t shardCount,
+    ObjectCachePolicy policy)
+    : shardCount_{std::max<size_t>(shardCount, 1)},
+      policy_{policy},
+      maximumCacheSizeBytes_{maximumCacheSizeBytes / shardCount_},
+      // Round up so that the cache as a whole keeps at least
+      // minimumEntryCount entries.
+      minimumEntryCount_{(minimumEntryCount + shardCount_ - 1) / shardCount_},
+      windowSizeBytes_{maximumCacheSizeBytes_ * kTinyLFUWindowPercent / 100},
+      shards_{std::make_unique<Shard[]>(shardCount_)} {}
+
+template <typename ObjectType, ObjectCacheFlavor Flavor>
+typename ObjectCache<ObjectType, Flavor>::Shard&
+ObjectCache<ObjectType, Flavor>::getShard(const Hash& hash) const {
+  if (shardCount_ == 1) {
+    return shards_[0];
+  }
+  // The items maps of the shards index the same hash code, mix it so that
+  // the shard doesn't correlate with the bucket.
+  return shards_[folly::hash::twang_mix64(hash.getHashCode()) % shardCount_];
+}
 
 template <typename ObjectType, ObjectCacheFlavor Flavor>
 template <ObjectCacheFlavor F>
@@ -90,9 +115,12 @@ ObjectCache<ObjectType, Flavor>::getInterestHandle(
   // runs after the lock is released.
   ObjectInterestHandle<ObjectType> interestHandle;
 
-  auto state = lockState();
+  auto state = lockState(hash);
 
-  auto item = getImpl(hash, state);
+  // Repeated reads through an interest handle are a single use of the
+  // object as far as the frequency is concerned.
+  auto item =
+      getImpl(hash, state, interest != Interest::UnlikelyNeededAgain);
   if (!item) {
     return GetResult{};
   }
@@ -129,7 +157,7 @@ typename std::enable_if_t<
     typename ObjectCache<ObjectType, Flavor>::ObjectPtr>
 ObjectCache<ObjectType, Flavor>::getSimple(const Hash& hash) {
   XLOG(DBG6) << "BlobCache::getSimple " << hash;
-  auto state = lockState();
+  auto state = lockState(hash);
 
   if (auto item = getImpl(hash, state)) {
     return item->object;
@@ -139,8 +167,16 @@ ObjectCache<ObjectType, Flavor>::getSimple(const Hash& hash) {
 
 template <typename ObjectType, ObjectCacheFlavor Flavor>
 typename ObjectCache<ObjectType, Flavor>::CacheItem*
-ObjectCache<ObjectType, Flavor>::getImpl(const Hash& hash, LockedState& state) {
+ObjectCache<ObjectType, Flavor>::getImpl(
+    const Hash& hash,
+    LockedState& state,
+    bool recordAccess) {
   XLOG(DBG6) << "ObjectCache::getImpl " << hash;
+  if (policy_ == ObjectCachePolicy::TinyLFU && recordAccess) {
+    // Misses count too: an object that keeps being reloaded after being
+    // evicted is worth admitting.
+    state->sketch.increment(hash.getHashCode());
+  }
   auto* item = folly::get_ptr(state->items, hash);
   if (!item) {
     XLOG(DBG6) << "ObjectCache::getImpl missed";
@@ -151,8 +187,8 @@ ObjectCache<ObjectType, Flavor>::getImpl(const Hash& hash, LockedState& state) {
 
     // TODO: Should we avoid promoting if interest is UnlikelyNeededAgain?
     // For now, we'll try not to be too clever.
-    state->evictionQueue.splice(
-        state->evictionQueue.end(), state->evictionQueue, item->index);
+    auto& queue = queueOf(state, item);
+    queue.splice(queue.end(), queue, item->index);
     ++state->hitCount;
   }
 
@@ -188,26 +224,30 @@ ObjectCache<ObjectType, Flavor>::insertInterestHandle(
 
   XLOG(DBG6) << "  creating entry with generation=" << cacheItemGeneration;
 
-  auto state = lockState();
-  auto [item, inserted] = insertImpl(object, state);
-  switch (interest) {
-    case Interest::UnlikelyNeededAgain:
-      break;
-    case Interest::WantHandle:
-    case Interest::LikelyNeededAgain:
-      ++item->referenceCount;
-      break;
-  }
-  if (inserted) { // new entry we need to set the generation number
-    item->generation = cacheItemGeneration;
-  } else {
-    XLOG(DBG6) << "duplicate entry, using generation " << item->generation;
-    // Inserting duplicate entry - use its generation.
-    interestHandle.cacheItemGeneration_ = item->generation;
-    // note we can skip eviction here because we didn't insert anything new,
-    // so the cache size has not changed as a result of this operation.
-    return interestHandle;
+  std::vector<ObjectPtr> evicted;
+  {
+    auto state = lockState(object->getHash());
+    auto [item, inserted] = insertImpl(object, state);
+    switch (interest) {
+      case Interest::UnlikelyNeededAgain:
+        break;
+      case Interest::WantHandle:
+      case Interest::LikelyNeededAgain:
+        ++item->referenceCount;
+        break;
+    }
+    if (inserted) { // new entry we need to set the generation number
+      item->generation = cacheItemGeneration;
+      evicted.swap(state->evicted);
+    } else {
+      XLOG(DBG6) << "duplicate entry, using generation " << item->generation;
+      // Inserting duplicate entry - use its generation.
+      interestHandle.cacheItemGeneration_ = item->generation;
+      // note we can skip eviction here because we didn't insert anything new,
+      // so the cache size has not changed as a result of this operation.
+    }
   }
+  notifyEvicted(std::move(evicted));
   return interestHandle;
 }
 
@@ -217,8 +257,21 @@ typename std::enable_if_t<F == ObjectCacheFlavor::Simple, void>
 ObjectCache<ObjectType, Flavor>::insertSimple(
     ObjectCache<ObjectType, Flavor>::ObjectPtr object) {
   XLOG(DBG6) << "ObjectCache::insertSimple " << object->getHash();
-  auto state = lockState();
-  insertImpl(object, state);
+  std::vector<ObjectPtr> evicted;
+  {
+    auto state = lockState(object->getHash());
+    insertImpl(object, state);
+    evicted.swap(state->evicted);
+  }
+  notifyEvicted(std::move(evicted));
+}
+
+template <typename ObjectType, ObjectCacheFlavor Flavor>
+void ObjectCache<ObjectType, Flavor>::notifyEvicted(
+    std::vector<ObjectPtr>&& evicted) {
+  if (!evicted.empty()) {
+    evictionCallback_(std::move(evicted));
+  }
 }
 
 template <typename ObjectType, ObjectCacheFlavor Flavor>
@@ -238,48 +291,65 @@ ObjectCache<ObjectType, Flavor>::insertImpl(
 
   auto* itemPtr = &iter->second;
   if (inserted) {
+    itemPtr->inWindow = policy_ == ObjectCachePolicy::TinyLFU;
+    auto& queue = queueOf(state, itemPtr);
     try {
-      state->evictionQueue.push_back(itemPtr);
+      if (itemPtr->inWindow) {
+        // Keep the sketch wide enough to tell the cached objects apart.
+        state->sketch.ensureCapacity(state->items.size());
+      }
+      queue.push_back(itemPtr);
     } catch (const std::exception&) {
       state->items.erase(iter);
       throw;
     }
-    iter->second.index = std::prev(state->evictionQueue.end());
+    iter->second.index = std::prev(queue.end());
     state->totalSize += size;
+    if (itemPtr->inWindow) {
+      state->windowSize += size;
+    }
     evictUntilFits(state);
   } else {
-    state->evictionQueue.splice(
-        state->evictionQueue.end(), state->evictionQueue, itemPtr->index);
+    auto& queue = queueOf(state, itemPtr);
+    queue.splice(queue.end(), queue, itemPtr->index);
   }
   return std::make_pair(itemPtr, inserted);
 }
 
 template <typename ObjectType, ObjectCacheFlavor Flavor>
 bool ObjectCache<ObjectType, Flavor>::contains(const Hash& hash) const {
-  auto state = lockState();
+  auto state = lockState(hash);
   return 1 == state->items.count(hash);
 }
 
 template <typename ObjectType, ObjectCacheFlavor Flavor>
 void ObjectCache<ObjectType, Flavor>::clear() {
   XLOG(DBG6) << "ObjectCache::clear";
-  auto state = lockState();
-  state->totalSize = 0;
-  state->items.clear();
-  state->evictionQueue.clear();
+  for (size_t i = 0; i < shardCount_; ++i) {
+    auto state = lockShard(i);
+    state->totalSize = 0;
+    state->items.clear();
+    state->evictionQueue.clear();
+    state->windowQueue.clear();
+    state->windowSize = 0;
+    state->sketch.clear();
+  }
 }
 
 template <typename ObjectType, ObjectCacheFlavor Flavor>
 typename ObjectCache<ObjectType, Flavor>::Stats
 ObjectCache<ObjectType, Flavor>::getStats() const {
-  auto state = lockState();
   Stats stats;
-  stats.objectCount = state->items.size();
-  stats.totalSizeInBytes = state->totalSize;
-  stats.hitCount = state->hitCount;
-  stats.missCount = state->missCount;
-  stats.evictionCount = state->evictionCount;
-  stats.dropCount = state->dropCount;
+  for (size_t i = 0; i < shardCount_; ++i) {
+    auto state = lockShard(i);
+    stats.objectCount += state->items.size();
+    stats.totalSizeInBytes += state->totalSize;
+    stats.hitCount += state->hitCount;
+    stats.missCount += state->missCount;
+    stats.evictionCount += state->evictionCount;
+    stats.dropCount += state->dropCount;
+    stats.rejectionCount += state->rejectionCount;
+  }
   return stats;
 }
 
@@ -288,7 +358,7 @@ void ObjectCache<ObjectType, Flavor>::dropInterestHandle(
     const Hash& hash,
     uint64_t generation) noexcept {
   XLOG(DBG6) << "dropInterestHandle " << hash << " generation=" << generation;
-  auto state = lockState();
+  auto state = lockState(hash);
 
   auto* item = folly::get_ptr(state->items, hash);
   if (!item) {
@@ -310,7 +380,7 @@ void ObjectCache<ObjectType, Flavor>::dropInterestHandle(
   }
 
   if (--item->referenceCount == 0) {
-    state->evictionQueue.erase(item->index);
+    queueOf(state, item).erase(item->index);
     ++state->dropCount;
     evictItem(state, item);
   }
@@ -324,17 +394,66 @@ void ObjectCache<ObjectType, Flavor>::evictUntilFits(
              << ", maximumCacheSizeBytes_=" << maximumCacheSizeBytes_
              << ", evictionQueue.size()=" << state->evictionQueue.size()
              << ", minimumEntryCount_=" << minimumEntryCount_;
-  while (state->totalSize > maximumCacheSizeBytes_ &&
-         state->evictionQueue.size() > minimumEntryCount_) {
+  if (policy_ == ObjectCachePolicy::TinyLFU) {
+    drainWindow(state);
+  }
+  while (isOverLimits(state)) {
     evictOne(state);
   }
 }
 
+template <typename ObjectType, ObjectCacheFlavor Flavor>
+void ObjectCache<ObjectType, Flavor>::drainWindow(LockedState& state) noexcept {
+  // The most recently inserted entry always stays in the window, so that it
+  // gets a chance to be accessed again before competing for admission.
+  while (state->windowSize > windowSizeBytes_ &&
+         state->windowQueue.size() > 1) {
+    CacheItem* candidate = state->windowQueue.front();
+    state->windowSize -= candidate->object->getSizeBytes();
+    candidate->inWindow = false;
+
+    auto candidateFrequency =
+        state->sketch.estimate(candidate->object->getHash().getHashCode());
+    bool admitted = true;
+    while (isOverLimits(state) && !state->evictionQueue.empty()) {
+      CacheItem* victim = state->evictionQueue.front();
+      auto victimFrequency =
+          state->sketch.estimate(victim->object->getHash().getHashCode());
+      if (candidateFrequency <= victimFrequency) {
+        admitted = false;
+        break;
+      }
+      evictOne(state);
+    }
+
+    if (admitted) {
+      // Cannot throw, the node is moved rather than allocated.
+      state->evictionQueue.splice(
+          state->evictionQueue.end(), state->windowQueue, candidate->index);
+    } else {
+      state->windowQueue.erase(candidate->index);
+      ++state->rejectionCount;
+      evictItem(state, candidate);
+    }
+  }
+}
+
 template <typename ObjectType, ObjectCacheFlavor Flavor>
 void ObjectCache<ObjectType, Flavor>::evictOne(LockedState& state) noexcept {
-  CacheItem* front = state->evictionQueue.front();
-  state->evictionQueue.pop_front();
+  // With the TinyLFU policy, the window is only evicted from once the rest of
+  // the cache is empty but still over the limits.
+  auto& queue = state->evictionQueue.empty() ? state->windowQueue
+                                             : state->evictionQueue;
+  CacheItem* front = queue.front();
+  queue.pop_front();
   ++state->evictionCount;
+  if (evictionCallback_) {
+    try {
+      state->evicted.push_back(front->object);
+    } catch (const std::bad_alloc&) {
+      // The callback just won't see this object.
+    }
+  }
   evictItem(state, front);
 }
 
@@ -346,6 +465,9 @@ void ObjectCache<ObjectType, Flavor>::evictItem(
              << "evicting " << item->object->getHash()
              << " generation=" << item->generation;
   auto size = item->object->getSizeBytes();
+  if (item->inWindow) {
+    state->windowSize -= size;
+  }
   // TODO: Releasing this ObjectPtr here can run arbitrary deleters which
   // could, in theory, try to reacquire the ObjectCache's lock. The object
   // could be scheduled for deletion in a deletion queue but then it's hard to
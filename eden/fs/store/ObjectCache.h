@@ -7,18 +7,43 @@
 
 #pragma once
 
+#include <functional>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
+#include <folly/lang/Align.h>
 #include <folly/synchronization/DistributedMutex.h>
 
 #include "eden/fs/model/Hash.h"
+#include "eden/fs/store/FrequencySketch.h"
 
 namespace facebook::eden {
 
 enum class ObjectCacheFlavor { Simple, InterestHandle };
 
+/**
+ * How an ObjectCache picks the entries to evict.
+ */
+enum class ObjectCachePolicy {
+  /**
+   * Evict the least recently used entry.
+   */
+  LRU,
+
+  /**
+   * W-TinyLFU: new entries go through a small LRU window, sized to
+   * kTinyLFUWindowPercent of the cache. An entry leaving the window is only
+   * admitted into the rest of the cache if it was accessed more often than
+   * the entry it would evict, as estimated by a FrequencySketch. A scan of
+   * many objects that are read once therefore only churns the window, and
+   * leaves the frequently used objects cached.
+   */
+  TinyLFU,
+};
+
 template <typename ObjectType, ObjectCacheFlavor Flavor>
 class ObjectCache;
 
@@ -100,6 +125,13 @@ class ObjectInterestHandle {
  * be used that only allow clients to use one flavor of get and insert. See
  * BlobCache and TreeCache for examples of each flavor.
  *
+ * The cache can be split into several shards, keyed by hash, each with its
+ * own lock, eviction queue and an equal part of the maximum cache size and
+ * minimum entry count. This lets lookups of different objects proceed in
+ * parallel, at the cost of evicting per shard rather than globally: an
+ * object may be evicted while a less recently used one in another shard is
+ * kept.
+ *
  * It is safe to use this object from arbitrary threads.
  */
 template <typename ObjectType, ObjectCacheFlavor Flavor>
@@ -147,11 +179,26 @@ class ObjectCache
     uint64_t missCount{0};
     uint64_t evictionCount{0};
     uint64_t dropCount{0};
+    /// Entries leaving the TinyLFU window that were not admitted into the
+    /// main part of the cache. They are not counted in evictionCount.
+    uint64_t rejectionCount{0};
+
+    double getHitRate() const {
+      auto lookups = hitCount + missCount;
+      return lookups == 0 ? 0.0 : static_cast<double>(hitCount) / lookups;
+    }
   };
 
+  /**
+   * The share of the cache taken by the window of the TinyLFU policy.
+   */
+  static constexpr size_t kTinyLFUWindowPercent = 1;
+
   static std::shared_ptr<ObjectCache<ObjectType, Flavor>> create(
       size_t maximumCacheSizeBytes,
-      size_t minimumEntryCount);
+      size_t minimumEntryCount,
+      size_t shardCount = 1,
+      ObjectCachePolicy policy = ObjectCachePolicy::LRU);
   ~ObjectCache() {}
 
   /**
@@ -221,12 +268,38 @@ class ObjectCache
 
   /**
    * Return information about the current size of the cache and the total number
-   * of hits and misses.
+   * of hits and misses, summed over all the shards.
    */
   Stats getStats() const;
 
+  size_t getShardCount() const {
+    return shardCount_;
+  }
+
+  ObjectCachePolicy getPolicy() const {
+    return policy_;
+  }
+
  protected:
-  explicit ObjectCache(size_t maximumCacheSizeBytes, size_t minimumEntryCount);
+  explicit ObjectCache(
+      size_t maximumCacheSizeBytes,
+      size_t minimumEntryCount,
+      size_t shardCount = 1,
+      ObjectCachePolicy policy = ObjectCachePolicy::LRU);
+
+  using EvictionCallback = std::function<void(std::vector<ObjectPtr>&&)>;
+
+  /**
+   * Call the callback with the objects evicted to make room for an inserted
+   * one, once the insertion released the lock. Objects evicted because their
+   * last interest handle was dropped, or not admitted by the TinyLFU policy,
+   * are not passed to the callback.
+   *
+   * Must be called before the cache is used by several threads.
+   */
+  void setEvictionCallback(EvictionCallback callback) {
+    evictionCallback_ = std::move(callback);
+  }
 
  private:
   /*
@@ -257,6 +330,10 @@ class ObjectCache
     /// Given a unique value upon allocation. Used to verify InterestHandle
     /// matches this specific item.
     uint64_t generation{std::numeric_limits<uint64_t>::max()};
+
+    /// Whether index points into State::windowQueue rather than
+    /// State::evictionQueue.
+    bool inWindow{false};
   };
 
   struct State {
@@ -266,10 +343,22 @@ class ObjectCache
     /// Entries are evicted from the front of the queue.
     std::list<CacheItem*> evictionQueue;
 
+    /// With the TinyLFU policy, the entries that were inserted recently,
+    /// least recently used first, and their total size.
+    std::list<CacheItem*> windowQueue;
+    size_t windowSize{0};
+
+    /// With the TinyLFU policy, recent accesses by hash code.
+    FrequencySketch sketch;
+
     uint64_t hitCount{0};
     uint64_t missCount{0};
     uint64_t evictionCount{0};
     uint64_t dropCount{0};
+    uint64_t rejectionCount{0};
+
+    /// Objects evicted for the eviction callback, while the lock is held.
+    std::vector<ObjectPtr> evicted;
   };
 
   /**
@@ -303,17 +392,38 @@ class ObjectCache
     std::unique_lock<folly::DistributedMutex> stateLock_;
   };
 
-  LockedState lockState() const {
-    return LockedState{state_, stateLock_};
+  /**
+   * Padded to a cache line so that the locks of adjacent shards don't
+   * contend through false sharing.
+   */
+  struct alignas(folly::hardware_destructive_interference_size) Shard {
+    State state;
+    folly::DistributedMutex lock;
+  };
+
+  Shard& getShard(const Hash& hash) const;
+
+  LockedState lockState(const Hash& hash) const {
+    auto& shard = getShard(hash);
+    return LockedState{shard.state, shard.lock};
+  }
+
+  LockedState lockShard(size_t index) const {
+    auto& shard = shards_[index];
+    return LockedState{shard.state, shard.lock};
   }
 
   /**
    * If an object for the given hash is in cache, return it. If the object is
    * not in cache, return nullptr (and an empty interest handle).
    *
-   * Does not do anything related to interest handles.
+   * Does not do anything related to interest handles. recordAccess is false
+   * for lookups that shouldn't count towards the frequency of the object.
    */
-  CacheItem* getImpl(const Hash& hash, LockedState& state);
+  CacheItem* getImpl(
+      const Hash& hash,
+      LockedState& state,
+      bool recordAccess = true);
 
   /**
    * Inserts an object into the cache for future lookup. If the new total size
@@ -328,14 +438,44 @@ class ObjectCache
 
   void dropInterestHandle(const Hash& hash, uint64_t generation) noexcept;
 
+  void notifyEvicted(std::vector<ObjectPtr>&& evicted);
+
+  std::list<CacheItem*>& queueOf(LockedState& state, CacheItem* item) {
+    return item->inWindow ? state->windowQueue : state->evictionQueue;
+  }
+
   void evictUntilFits(LockedState& state) noexcept;
+
+  /**
+   * Move the least recently used entries out of the TinyLFU window while it
+   * is over its size, admitting them into the eviction queue or rejecting
+   * them.
+   */
+  void drainWindow(LockedState& state) noexcept;
+
+  bool isOverLimits(LockedState& state) const noexcept {
+    return state->totalSize > maximumCacheSizeBytes_ &&
+        state->items.size() > minimumEntryCount_;
+  }
+
   void evictOne(LockedState& state) noexcept;
+
+  /**
+   * Remove the item, which must already have been removed from its queue.
+   */
   void evictItem(LockedState&, CacheItem* item) noexcept;
 
+  const size_t shardCount_;
+  const ObjectCachePolicy policy_;
+
+  /// The limits of each shard.
   const size_t maximumCacheSizeBytes_;
   const size_t minimumEntryCount_;
-  mutable State state_;
-  mutable folly::DistributedMutex stateLock_;
+  const size_t windowSizeBytes_;
+
+  std::unique_ptr<Shard[]> shards_;
+
+  EvictionCallback evictionCallback_;
 
   friend class ObjectInterestHandle<ObjectType>;
 };
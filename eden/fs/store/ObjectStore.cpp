@@ -11,6 +11,7 @@
 #include <folly/Executor.h>
 #include <folly/Format.h>
 #include <folly/futures/Future.h>
+#include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 
 #include <stdexcept>
@@ -26,7 +27,6 @@ using folly::Future;
 using folly::makeFuture;
 using std::shared_ptr;
 using std::string;
-using std::unique_ptr;
 
 namespace facebook::eden {
 
@@ -70,6 +70,7 @@ ObjectStore::ObjectStore(
       stats_{std::move(stats)},
       executor_{executor},
       pidFetchCounts_{std::make_unique<PidFetchCounts>()},
+      fetchAttribution_{std::make_unique<FetchAttribution>()},
       processNameCache_(processNameCache),
       structuredLogger_(structuredLogger),
       edenConfig_(edenConfig) {}
@@ -153,22 +154,54 @@ folly::Future<std::shared_ptr<TreeEntry>> ObjectStore::getTreeEntryForRootId(
       .via(executor_);
 }
 
+template <typename T, typename Fetch>
+Future<ObjectStore::Fetched<T>> ObjectStore::coalesce(
+    InFlightFetches<T>& inFlight,
+    const Hash& id,
+    ImportPriority priority,
+    ObjectStoreThreadStats::StatPtr coalescedStat,
+    Fetch&& fetch) const {
+  {
+    auto fetches = inFlight.wlock();
+    auto [it, inserted] =
+        fetches->try_emplace(id, InFlightFetch<T>{priority, {}});
+    if (!inserted) {
+      auto& existing = it->second;
+      if (existing.priority < priority) {
+        // The backing store raises the import of the fetch in progress to
+        // this priority, so later requests at this priority can wait for it.
+        existing.priority = priority;
+        fetches.unlock();
+        return folly::makeFutureWith(std::forward<Fetch>(fetch));
+      }
+      (stats_->getObjectStoreStatsForCurrentThread().*coalescedStat)
+          .addValue(1);
+      auto [promise, future] = folly::makePromiseContract<Fetched<T>>();
+      existing.waiters.push_back(std::move(promise));
+      return std::move(future).via(executor_);
+    }
+  }
+
+  return folly::makeFutureWith(std::forward<Fetch>(fetch))
+      .thenTry([self = shared_from_this(), &inFlight, id](
+                   folly::Try<Fetched<T>>&& result) {
+        std::vector<folly::Promise<Fetched<T>>> waiters;
+        {
+          auto fetches = inFlight.wlock();
+          auto it = fetches->find(id);
+          waiters = std::move(it->second.waiters);
+          fetches->erase(it);
+        }
+        for (auto& waiter : waiters) {
+          waiter.setTry(folly::Try<Fetched<T>>{result});
+        }
+        return std::move(result).value();
+      });
+}
+
 Future<shared_ptr<const Tree>> ObjectStore::getTree(
     const Hash& id,
     ObjectFetchContext& fetchContext) const {
-  // Check in the LocalStore first
-
-  // TODO: We should consider checking if we have in flight BackingStore
-  // requests on this layer instead of only in the BackingStore. Consider the
-  // case in which thread A and thread B both request a Tree at the same time.
-  // Let's say thread A checks the LocalStore, then thread B checks the
-  // LocalStore, gets the file from the BackingStore (making a request to the
-  // server), then writes the Tree to the LocalStore. Now when thread A checks
-  // for in flight requests in the BackingStore, it will not see any since
-  // thread B has completely finished, so thread A will make a duplicate
-  // request. If we we're to mark here that we got a request on this layer, then
-  // we could avoid that case.
-
   if (auto maybeTree = treeCache_->get(id)) {
     fetchContext.didFetch(
         ObjectFetchContext::Tree, id, ObjectFetchContext::FromMemoryCache);
@@ -178,18 +211,39 @@ Future<shared_ptr<const Tree>> ObjectStore::getTree(
     return maybeTree;
   }
 
+  // Concurrent requests for the tree share a single lookup in the LocalStore
+  // and, if it misses, a single request to the BackingStore. Marking the
+  // request in flight on this layer also avoids importing the tree twice
+  // when a second request checks the LocalStore just before the first one
+  // writes the tree to it.
+  return coalesce(
+             inFlightTrees_,
+             id,
+             fetchContext.getPriority(),
+             &ObjectStoreThreadStats::getTreeCoalesced,
+             [&] { return fetchTree(id, fetchContext); })
+      .thenValue([self = shared_from_this(), id, &fetchContext](
+                     Fetched<shared_ptr<const Tree>>&& fetched) {
+        fetchContext.didFetch(ObjectFetchContext::Tree, id, fetched.origin);
+        self->updateProcessFetch(fetchContext);
+        self->fetchAttribution_->record(
+            fetchContext, ObjectFetchContext::Tree, fetched.origin);
+        return std::move(fetched.object);
+      });
+}
+
+Future<ObjectStore::Fetched<shared_ptr<const Tree>>> ObjectStore::fetchTree(
+    const Hash& id,
+    ObjectFetchContext& fetchContext) const {
   return localStore_->getTree(id).thenValue([self = shared_from_this(),
                                              id,
                                              &fetchContext](
                                                 shared_ptr<const Tree> tree) {
     if (tree) {
       XLOG(DBG4) << "tree " << id << " found in local store";
-      fetchContext.didFetch(
-          ObjectFetchContext::Tree, id, ObjectFetchContext::FromDiskCache);
-
-      self->updateProcessFetch(fetchContext);
       self->treeCache_->insert(tree);
-      return makeFuture(std::move(tree));
+      return makeFuture(Fetched<shared_ptr<const Tree>>{
+          std::move(tree), ObjectFetchContext::FromDiskCache});
     }
 
     self->deprioritizeWhenFetchHeavy(fetchContext);
@@ -197,9 +251,9 @@ Future<shared_ptr<const Tree>> ObjectStore::getTree(
     // Load the tree from the BackingStore.
     return self->backingStore_->getTree(id, fetchContext)
         .via(self->executor_)
-        .thenValue([self, id, &fetchContext, localStore = self->localStore_](
-                       unique_ptr<const Tree> tree) {
-          if (!tree) {
+        .thenValue([self, id, localStore = self->localStore_](
+                       shared_ptr<const Tree> loadedTree) {
+          if (!loadedTree) {
             // TODO: Perhaps we should do some short-term negative
             // caching?
             XLOG(DBG2) << "unable to find tree " << id;
@@ -207,18 +261,11 @@ Future<shared_ptr<const Tree>> ObjectStore::getTree(
                 folly::to<string>("tree ", id.toString(), " not found"));
           }
 
-          // promote to shared_ptr so we can store in the cache and return
-          std::shared_ptr<const Tree> loadedTree{std::move(tree)};
           localStore->putTree(*loadedTree);
           self->treeCache_->insert(loadedTree);
           XLOG(DBG3) << "tree " << id << " retrieved from backing store";
-          fetchContext.didFetch(
-              ObjectFetchContext::Tree,
-              id,
-              ObjectFetchContext::FromBackingStore);
-
-          self->updateProcessFetch(fetchContext);
-          return shared_ptr<const Tree>(std::move(loadedTree));
+          return Fetched<shared_ptr<const Tree>>{
+              std::move(loadedTree), ObjectFetchContext::FromBackingStore};
         });
   });
 }
@@ -243,6 +290,25 @@ folly::Future<folly::Unit> ObjectStore::prefetchBlobs(
 Future<shared_ptr<const Blob>> ObjectStore::getBlob(
     const Hash& id,
     ObjectFetchContext& fetchContext) const {
+  return coalesce(
+             inFlightBlobs_,
+             id,
+             fetchContext.getPriority(),
+             &ObjectStoreThreadStats::getBlobCoalesced,
+             [&] { return fetchBlob(id, fetchContext); })
+      .thenValue([self = shared_from_this(), id, &fetchContext](
+                     Fetched<shared_ptr<const Blob>>&& fetched) {
+        fetchContext.didFetch(ObjectFetchContext::Blob, id, fetched.origin);
+        self->updateProcessFetch(fetchContext);
+        self->fetchAttribution_->record(
+            fetchContext, ObjectFetchContext::Blob, fetched.origin);
+        return std::move(fetched.object);
+      });
+}
+
+Future<ObjectStore::Fetched<shared_ptr<const Blob>>> ObjectStore::fetchBlob(
+    const Hash& id,
+    ObjectFetchContext& fetchContext) const {
   auto self = shared_from_this();
 
   return localStore_->getBlob(id).thenValue([id, &fetchContext, self](
@@ -255,11 +321,8 @@ Future<shared_ptr<const Blob>> ObjectStore::getBlob(
       // instead.)
       XLOG(DBG4) << "blob " << id << " found in local store";
       self->updateBlobStats(true, false);
-      fetchContext.didFetch(
-          ObjectFetchContext::Blob, id, ObjectFetchContext::FromDiskCache);
-
-      self->updateProcessFetch(fetchContext);
-      return makeFuture(shared_ptr<const Blob>(std::move(blob)));
+      return makeFuture(Fetched<shared_ptr<const Blob>>{
+          std::move(blob), ObjectFetchContext::FromDiskCache});
     }
 
     self->deprioritizeWhenFetchHeavy(fetchContext);
@@ -267,17 +330,10 @@ Future<shared_ptr<const Blob>> ObjectStore::getBlob(
     // Look in the BackingStore
     return self->backingStore_->getBlob(id, fetchContext)
         .via(self->executor_)
-        .thenValue([self, &fetchContext, id](
-                       unique_ptr<const Blob> loadedBlob) {
+        .thenValue([self, id](shared_ptr<const Blob> loadedBlob) {
           if (loadedBlob) {
             XLOG(DBG3) << "blob " << id << "  retrieved from backing store";
             self->updateBlobStats(false, true);
-            fetchContext.didFetch(
-                ObjectFetchContext::Blob,
-                id,
-                ObjectFetchContext::FromBackingStore);
-
-            self->updateProcessFetch(fetchContext);
 
             // Quick check in-memory cache first, before doing expensive
             // calculations. If metadata is present in cache, it most certainly
@@ -286,7 +342,8 @@ Future<shared_ptr<const Blob>> ObjectStore::getBlob(
               auto metadata = self->localStore_->putBlob(id, loadedBlob.get());
               self->metadataCache_.wlock()->set(id, metadata);
             }
-            return shared_ptr<const Blob>(std::move(loadedBlob));
+            return Fetched<shared_ptr<const Blob>>{
+                std::move(loadedBlob), ObjectFetchContext::FromBackingStore};
           }
 
           XLOG(DBG2) << "unable to find blob " << id;
@@ -298,6 +355,59 @@ Future<shared_ptr<const Blob>> ObjectStore::getBlob(
   });
 }
 
+namespace {
+std::unique_ptr<folly::IOBuf>
+sliceBlob(const Blob& blob, uint64_t offset, uint64_t length) {
+  const auto& contents = blob.getContents();
+  folly::io::Cursor cursor(&contents);
+  if (!cursor.canAdvance(offset)) {
+    return folly::IOBuf::create(0);
+  }
+  cursor.skip(offset);
+  std::unique_ptr<folly::IOBuf> result;
+  cursor.cloneAtMost(result, length);
+  return result;
+}
+} // namespace
+
+bool ObjectStore::supportsBlobRanges() const {
+  return backingStore_->supportsBlobRanges();
+}
+
+Future<std::unique_ptr<folly::IOBuf>> ObjectStore::getBlobRange(
+    const Hash& id,
+    uint64_t offset,
+    uint64_t length,
+    ObjectFetchContext& fetchContext) const {
+  if (!backingStore_->supportsBlobRanges()) {
+    return getBlob(id, fetchContext)
+        .thenValue([offset, length](shared_ptr<const Blob> blob) {
+          return sliceBlob(*blob, offset, length);
+        });
+  }
+
+  auto self = shared_from_this();
+  return localStore_->getBlob(id).thenValue(
+      [self, id, offset, length, &fetchContext](shared_ptr<const Blob> blob)
+          -> Future<std::unique_ptr<folly::IOBuf>> {
+        if (blob) {
+          self->updateBlobStats(true, false);
+          fetchContext.didFetch(
+              ObjectFetchContext::Blob, id, ObjectFetchContext::FromDiskCache);
+          return sliceBlob(*blob, offset, length);
+        }
+
+        self->deprioritizeWhenFetchHeavy(fetchContext);
+        self->updateBlobStats(false, true);
+        fetchContext.didFetch(
+            ObjectFetchContext::Blob, id, ObjectFetchContext::FromBackingStore);
+        self->updateProcessFetch(fetchContext);
+        return self->backingStore_
+            ->getBlobRange(id, offset, length, fetchContext)
+            .via(self->executor_);
+      });
+}
+
 void ObjectStore::updateBlobStats(bool local, bool backing) const {
   ObjectStoreThreadStats& stats = stats_->getObjectStoreStatsForCurrentThread();
   stats.getBlobFromLocalStore.addValue(local);
@@ -323,58 +433,93 @@ Future<BlobMetadata> ObjectStore::getBlobMetadata(
     }
   }
 
-  auto self = shared_from_this();
+  return coalesce(
+             inFlightBlobMetadata_,
+             id,
+             context.getPriority(),
+             &ObjectStoreThreadStats::getBlobMetadataCoalesced,
+             [&] { return fetchBlobMetadata(id, context); })
+      .thenValue([self = shared_from_this(), id, &context](
+                     Fetched<BlobMetadata>&& fetched) {
+        context.didFetch(ObjectFetchContext::BlobMetadata, id, fetched.origin);
+        self->updateProcessFetch(context);
+        self->fetchAttribution_->record(
+            context, ObjectFetchContext::BlobMetadata, fetched.origin);
+        return std::move(fetched.object);
+      });
+}
 
+Future<ObjectStore::Fetched<BlobMetadata>> ObjectStore::fetchBlobMetadata(
+    const Hash& id,
+    ObjectFetchContext& context) const {
   // Check local store
   return localStore_->getBlobMetadata(id).thenValue(
-      [self, id, &context](std::optional<BlobMetadata>&& metadata) {
+      [self = shared_from_this(), id, &context](
+          std::optional<BlobMetadata>&& metadata) {
         if (metadata) {
           self->updateBlobMetadataStats(false, true, false);
           self->metadataCache_.wlock()->set(id, *metadata);
-          context.didFetch(
-              ObjectFetchContext::BlobMetadata,
-              id,
-              ObjectFetchContext::FromDiskCache);
+          return makeFuture(Fetched<BlobMetadata>{
+              *metadata, ObjectFetchContext::FromDiskCache});
+        }
 
-          self->updateProcessFetch(context);
-          return makeFuture(*metadata);
+        return self->fetchBlobMetadataFromBackingStore(id, context);
+      });
+}
+
+Future<ObjectStore::Fetched<BlobMetadata>>
+ObjectStore::fetchBlobMetadataFromBackingStore(
+    const Hash& id,
+    ObjectFetchContext& context) const {
+  deprioritizeWhenFetchHeavy(context);
+
+  // Check backing store
+  //
+  // TODO: It would be nice to add a smarter API to the BackingStore so
+  // that we can query it just for the blob metadata if it supports
+  // getting that without retrieving the full blob data.
+  //
+  // TODO: This should probably check the LocalStore for the blob first,
+  // especially when we begin to expire entries in RocksDB.
+  auto self = shared_from_this();
+  return backingStore_->getBlob(id, context)
+      .via(executor_)
+      .thenValue([self, id](std::shared_ptr<const Blob> blob) {
+        if (blob) {
+          self->updateBlobMetadataStats(false, false, true);
+          auto metadata = self->localStore_->putBlob(id, blob.get());
+          self->metadataCache_.wlock()->set(id, metadata);
+          // I could see an argument for recording this fetch with
+          // type Blob instead of BlobMetadata, but it's probably more
+          // useful in context to know how many metadata fetches
+          // occurred. Also, since backing stores don't directly
+          // support fetching metadata, it should be clear.
+          return Fetched<BlobMetadata>{
+              metadata, ObjectFetchContext::FromBackingStore};
         }
 
-        self->deprioritizeWhenFetchHeavy(context);
-
-        // Check backing store
-        //
-        // TODO: It would be nice to add a smarter API to the BackingStore so
-        // that we can query it just for the blob metadata if it supports
-        // getting that without retrieving the full blob data.
-        //
-        // TODO: This should probably check the LocalStore for the blob first,
-        // especially when we begin to expire entries in RocksDB.
-        return self->backingStore_->getBlob(id, context)
-            .via(self->executor_)
-            .thenValue([self, id, &context](std::unique_ptr<Blob> blob) {
-              if (blob) {
-                self->updateBlobMetadataStats(false, false, true);
-                auto metadata = self->localStore_->putBlob(id, blob.get());
-                self->metadataCache_.wlock()->set(id, metadata);
-                // I could see an argument for recording this fetch with
-                // type Blob instead of BlobMetadata, but it's probably more
-                // useful in context to know how many metadata fetches
-                // occurred. Also, since backing stores don't directly
-                // support fetching metadata, it should be clear.
-                context.didFetch(
-                    ObjectFetchContext::BlobMetadata,
-                    id,
-                    ObjectFetchContext::FromBackingStore);
-
-                self->updateProcessFetch(context);
-                return makeFuture(metadata);
-              }
+        self->updateBlobMetadataStats(false, false, false);
+        throw std::domain_error(
+            folly::to<string>("blob ", id.toString(), " not found"));
+      });
+}
 
-              self->updateBlobMetadataStats(false, false, false);
-              throw std::domain_error(
-                  folly::to<string>("blob ", id.toString(), " not found"));
-            });
+Future<BlobMetadata> ObjectStore::getBlobMetadataFromBackingStore(
+    const Hash& id,
+    ObjectFetchContext& context) const {
+  return coalesce(
+             inFlightBlobMetadata_,
+             id,
+             context.getPriority(),
+             &ObjectStoreThreadStats::getBlobMetadataCoalesced,
+             [&] { return fetchBlobMetadataFromBackingStore(id, context); })
+      .thenValue([self = shared_from_this(), id, &context](
+                     Fetched<BlobMetadata>&& fetched) {
+        context.didFetch(ObjectFetchContext::BlobMetadata, id, fetched.origin);
+        self->updateProcessFetch(context);
+        self->fetchAttribution_->record(
+            context, ObjectFetchContext::BlobMetadata, fetched.origin);
+        return std::move(fetched.object);
       });
 }
 
@@ -393,6 +538,155 @@ Future<Hash> ObjectStore::getBlobSha1(
       .thenValue([](const BlobMetadata& metadata) { return metadata.sha1; });
 }
 
+Future<std::vector<folly::Try<BlobMetadata>>>
+ObjectStore::getBlobMetadataBatch(
+    const std::vector<Hash>& ids,
+    ObjectFetchContext& context) const {
+  auto results =
+      std::make_shared<std::vector<folly::Try<BlobMetadata>>>(ids.size());
+
+  // Check in-memory cache
+  std::vector<size_t> misses;
+  {
+    auto metadataCache = metadataCache_.wlock();
+    for (size_t i = 0; i < ids.size(); ++i) {
+      auto cacheIter = metadataCache->find(ids[i]);
+      if (cacheIter == metadataCache->end()) {
+        misses.push_back(i);
+        continue;
+      }
+      updateBlobMetadataStats(true, false, false);
+      context.didFetch(
+          ObjectFetchContext::BlobMetadata,
+          ids[i],
+          ObjectFetchContext::FromMemoryCache);
+      updateProcessFetch(context);
+      (*results)[i].emplace(cacheIter->second);
+    }
+  }
+  if (misses.empty()) {
+    return std::move(*results);
+  }
+
+  auto missingIds = std::make_shared<std::vector<Hash>>();
+  missingIds->reserve(misses.size());
+  for (auto i : misses) {
+    missingIds->push_back(ids[i]);
+  }
+
+  // Ask the BackingStore for all the blobs in one batch while the LocalStore
+  // is being checked, so that the individual fetches below find them ready
+  // instead of each making its own request. As in prefetchBlobs(), the blobs
+  // the LocalStore has are not filtered out first. A prefetch failure is not
+  // fatal: the fetches report their own errors.
+  deprioritizeWhenFetchHeavy(context);
+  auto prefetched =
+      backingStore_
+          ->prefetchBlobs(
+              HashRange{missingIds->data(), missingIds->size()}, context)
+          .via(executor_)
+          .thenTry([missingIds](folly::Try<folly::Unit>&& result) {
+            if (result.hasException()) {
+              XLOG(DBG2) << "failed to prefetch " << missingIds->size()
+                         << " blobs: " << result.exception().what();
+            }
+          });
+
+  // Check local store
+  auto self = shared_from_this();
+  return localStore_->getBlobMetadataBatch(*missingIds)
+      .thenValue([self,
+                  results,
+                  misses = std::move(misses),
+                  missingIds,
+                  prefetched = std::move(prefetched),
+                  &context](std::vector<std::optional<BlobMetadata>>&&
+                                metadata) mutable {
+        std::vector<size_t> backingMisses;
+        auto backingIds = std::make_shared<std::vector<Hash>>();
+        for (size_t n = 0; n < misses.size(); ++n) {
+          auto i = misses[n];
+          const auto& id = (*missingIds)[n];
+          if (metadata[n]) {
+            self->updateBlobMetadataStats(false, true, false);
+            self->metadataCache_.wlock()->set(id, *metadata[n]);
+            context.didFetch(
+                ObjectFetchContext::BlobMetadata,
+                id,
+                ObjectFetchContext::FromDiskCache);
+            self->updateProcessFetch(context);
+            self->fetchAttribution_->record(
+                context,
+                ObjectFetchContext::BlobMetadata,
+                ObjectFetchContext::FromDiskCache);
+            (*results)[i].emplace(std::move(*metadata[n]));
+            continue;
+          }
+          backingMisses.push_back(i);
+          backingIds->push_back(id);
+        }
+        // The prefetch is still waited for when the LocalStore had every
+        // blob, since it uses the caller's fetch context.
+        return std::move(prefetched)
+            .thenValue([self,
+                        results,
+                        backingMisses = std::move(backingMisses),
+                        backingIds,
+                        &context](folly::Unit) {
+              std::vector<Future<folly::Unit>> backingStoreFetches;
+              backingStoreFetches.reserve(backingMisses.size());
+              for (size_t n = 0; n < backingMisses.size(); ++n) {
+                auto i = backingMisses[n];
+                backingStoreFetches.push_back(
+                    folly::makeFutureWith([&] {
+                      return self->getBlobMetadataFromBackingStore(
+                          (*backingIds)[n], context);
+                    }).thenTry([results,
+                                i](folly::Try<BlobMetadata>&& result) {
+                      (*results)[i] = std::move(result);
+                    }));
+              }
+              return folly::collectAll(backingStoreFetches)
+                  .toUnsafeFuture()
+                  .thenValue(
+                      [results](auto&&) { return std::move(*results); });
+            });
+      });
+}
+
+Future<std::vector<folly::Try<Hash>>> ObjectStore::getBlobSha1s(
+    const std::vector<Hash>& ids,
+    ObjectFetchContext& context) const {
+  return getBlobMetadataBatch(ids, context)
+      .thenValue([](std::vector<folly::Try<BlobMetadata>>&& metadata) {
+        std::vector<folly::Try<Hash>> sha1s;
+        sha1s.reserve(metadata.size());
+        for (auto& result : metadata) {
+          sha1s.push_back(result.hasException()
+                              ? folly::Try<Hash>{std::move(result).exception()}
+                              : folly::Try<Hash>{result->sha1});
+        }
+        return sha1s;
+      });
+}
+
+Future<std::vector<folly::Try<uint64_t>>> ObjectStore::getBlobSizes(
+    const std::vector<Hash>& ids,
+    ObjectFetchContext& context) const {
+  return getBlobMetadataBatch(ids, context)
+      .thenValue([](std::vector<folly::Try<BlobMetadata>>&& metadata) {
+        std::vector<folly::Try<uint64_t>> sizes;
+        sizes.reserve(metadata.size());
+        for (auto& result : metadata) {
+          sizes.push_back(
+              result.hasException()
+                  ? folly::Try<uint64_t>{std::move(result).exception()}
+                  : folly::Try<uint64_t>{result->size});
+        }
+        return sizes;
+      });
+}
+
 Future<uint64_t> ObjectStore::getBlobSize(
     const Hash& id,
     ObjectFetchContext& context) const {
@@ -10,14 +10,18 @@
 #include <folly/Executor.h>
 #include <folly/Synchronized.h>
 #include <folly/container/EvictingCacheMap.h>
+#include <folly/container/F14Map.h>
+#include <folly/futures/Promise.h>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include <folly/logging/xlog.h>
 #include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/model/Hash.h"
 #include "eden/fs/model/RootId.h"
 #include "eden/fs/store/BlobMetadata.h"
+#include "eden/fs/store/FetchAttribution.h"
 #include "eden/fs/store/IObjectStore.h"
 #include "eden/fs/store/ImportPriority.h"
 #include "eden/fs/store/ObjectFetchContext.h"
@@ -176,6 +180,25 @@ class ObjectStore : public IObjectStore,
       const Hash& id,
       ObjectFetchContext& context) const override;
 
+  /**
+   * Get the `length` bytes of a blob starting at `offset`, or fewer if the
+   * blob ends first.
+   *
+   * When the BackingStore supports blob ranges and the blob isn't in the
+   * LocalStore, only the range is fetched, and it isn't cached. Otherwise,
+   * this is a slice of getBlob().
+   */
+  folly::Future<std::unique_ptr<folly::IOBuf>> getBlobRange(
+      const Hash& id,
+      uint64_t offset,
+      uint64_t length,
+      ObjectFetchContext& context) const;
+
+  /**
+   * Whether getBlobRange() avoids fetching whole blobs.
+   */
+  bool supportsBlobRanges() const;
+
   /**
    * Returns the size of the contents of the blob with the given ID.
    */
@@ -189,6 +212,28 @@ class ObjectStore : public IObjectStore,
   folly::Future<Hash> getBlobSha1(const Hash& id, ObjectFetchContext& context)
       const;
 
+  /**
+   * Returns the SHA-1 hashes of the contents of the blobs with the given IDs,
+   * in the same order.
+   *
+   * The blobs missing from the in-memory cache are looked up in the
+   * LocalStore with a single batch read, while they are prefetched from the
+   * BackingStore in a single batch. The ones the LocalStore doesn't have are
+   * then fetched individually. A failure to fetch one blob is only reported
+   * in its own result.
+   */
+  folly::Future<std::vector<folly::Try<Hash>>> getBlobSha1s(
+      const std::vector<Hash>& ids,
+      ObjectFetchContext& context) const;
+
+  /**
+   * Returns the sizes of the contents of the blobs with the given IDs, in
+   * the same order, looking them up like getBlobSha1s().
+   */
+  folly::Future<std::vector<folly::Try<uint64_t>>> getBlobSizes(
+      const std::vector<Hash>& ids,
+      ObjectFetchContext& context) const;
+
   /**
    * Get the LocalStore used by this ObjectStore
    */
@@ -211,6 +256,14 @@ class ObjectStore : public IObjectStore,
     pidFetchCounts_->clear();
   }
 
+  /**
+   * The local store reads and backing store imports charged to the processes
+   * causing them.
+   */
+  FetchAttribution& getFetchAttribution() {
+    return *fetchAttribution_;
+  }
+
  private:
   // Forbidden constructor. Use create().
   ObjectStore(
@@ -226,6 +279,71 @@ class ObjectStore : public IObjectStore,
   ObjectStore(ObjectStore const&) = delete;
   ObjectStore& operator=(ObjectStore const&) = delete;
 
+  /**
+   * An object loaded from the LocalStore or the BackingStore, along with
+   * where it was found, so that each request waiting for it can record its
+   * own fetch.
+   */
+  template <typename T>
+  struct Fetched {
+    T object;
+    ObjectFetchContext::Origin origin;
+  };
+
+  /**
+   * A fetch in progress and the requests waiting for it.
+   */
+  template <typename T>
+  struct InFlightFetch {
+    /**
+     * The highest priority any request has fetched the object at.
+     */
+    ImportPriority priority;
+    std::vector<folly::Promise<Fetched<T>>> waiters;
+  };
+
+  template <typename T>
+  using InFlightFetches =
+      folly::Synchronized<folly::F14NodeMap<Hash, InFlightFetch<T>>>;
+
+  /**
+   * Run fetch() unless a fetch of the object is already in progress at the
+   * same or a higher priority, in which case wait for its result instead.
+   *
+   * Only the first request's fetch context is used to load the object from
+   * the BackingStore; the callers record the fetch in their own context. A
+   * request with a higher priority than the fetch in progress runs its own
+   * fetch, so that it does not wait behind a low priority import. The
+   * HgImportRequestQueue raises the priority of the pending import it
+   * duplicates.
+   */
+  template <typename T, typename Fetch>
+  folly::Future<Fetched<T>> coalesce(
+      InFlightFetches<T>& inFlight,
+      const Hash& id,
+      ImportPriority priority,
+      ObjectStoreThreadStats::StatPtr coalescedStat,
+      Fetch&& fetch) const;
+
+  /**
+   * The parts of getTree() and getBlob() that run after missing the
+   * in-memory cache, shared by concurrent requests for the same object.
+   */
+  folly::Future<Fetched<std::shared_ptr<const Tree>>> fetchTree(
+      const Hash& id,
+      ObjectFetchContext& context) const;
+  folly::Future<Fetched<std::shared_ptr<const Blob>>> fetchBlob(
+      const Hash& id,
+      ObjectFetchContext& context) const;
+
+  /**
+   * The metadata of the blobs with the given IDs, in the same order. See
+   * getBlobSha1s().
+   */
+  folly::Future<std::vector<folly::Try<BlobMetadata>>> getBlobMetadataBatch(
+      const std::vector<Hash>& ids,
+      ObjectFetchContext& context) const;
+
   /**
    * Get metadata about a Blob.
    *
@@ -237,6 +355,30 @@ class ObjectStore : public IObjectStore,
       const Hash& id,
       ObjectFetchContext& context) const;
 
+  /**
+   * The part of getBlobMetadata() that runs after missing the in-memory
+   * cache.
+   */
+  folly::Future<Fetched<BlobMetadata>> fetchBlobMetadata(
+      const Hash& id,
+      ObjectFetchContext& context) const;
+
+  /**
+   * The part of getBlobMetadata() that runs after missing both the in-memory
+   * cache and the LocalStore.
+   */
+  folly::Future<Fetched<BlobMetadata>> fetchBlobMetadataFromBackingStore(
+      const Hash& id,
+      ObjectFetchContext& context) const;
+
+  /**
+   * Wait for a fetch of the blob's metadata already in progress, or start
+   * one from the BackingStore, and record it in the context.
+   */
+  folly::Future<BlobMetadata> getBlobMetadataFromBackingStore(
+      const Hash& id,
+      ObjectFetchContext& context) const;
+
   static constexpr size_t kCacheSize = 1000000;
 
   /**
@@ -269,6 +411,15 @@ class ObjectStore : public IObjectStore,
    */
   const std::shared_ptr<TreeCache> treeCache_;
 
+  /**
+   * The fetches in progress, so that many processes reading the same object
+   * at once, as a build does with a popular header, only load and decode it
+   * once. (HgImportRequestQueue only deduplicates the imports themselves.)
+   */
+  mutable InFlightFetches<std::shared_ptr<const Tree>> inFlightTrees_;
+  mutable InFlightFetches<std::shared_ptr<const Blob>> inFlightBlobs_;
+  mutable InFlightFetches<BlobMetadata> inFlightBlobMetadata_;
+
   /*
    * The LocalStore.
    *
@@ -291,6 +442,8 @@ class ObjectStore : public IObjectStore,
    * from the beginning of the eden daemon progress */
   std::unique_ptr<PidFetchCounts> pidFetchCounts_;
 
+  std::unique_ptr<FetchAttribution> fetchAttribution_;
+
   /* process name cache and structured logger used for
    * sending fetch heavy events, set to nullptr if not
    * initialized by create()
@@ -0,0 +1,577 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/PackLocalStore.h"
+
+#include <boost/filesystem.hpp>
+#include <fb303/ServiceData.h>
+#include <fmt/format.h>
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <folly/hash/Checksum.h>
+#include <folly/hash/SpookyHashV2.h>
+#include <folly/lang/Bits.h>
+#include <folly/logging/xlog.h>
+#include <folly/portability/SysStat.h>
+#include <folly/portability/Unistd.h>
+#include <algorithm>
+#include <cstring>
+
+#include "eden/fs/config/EdenConfig.h"
+#include "eden/fs/store/StoreResult.h"
+
+namespace facebook::eden {
+
+namespace {
+constexpr folly::StringPiece kPackSuffix{".pack"};
+constexpr folly::StringPiece kIndexSuffix{".idx"};
+
+// A record is the length of the key and of the value, a CRC32C of both, then
+// the key and the value.
+constexpr size_t kRecordHeaderSize = 12;
+
+// An index is a header (a magic, the version and the number of slots), then
+// an open-addressing hash table of (key hash, record offset) slots.
+constexpr folly::StringPiece kIndexMagic{"EdPI"};
+constexpr uint32_t kIndexVersion = 1;
+constexpr size_t kIndexHeaderSize = 16;
+constexpr size_t kSlotSize = 16;
+constexpr uint64_t kEmptySlot = std::numeric_limits<uint64_t>::max();
+
+constexpr uint64_t kMinPackSize = 1024 * 1024;
+
+template <typename T>
+T load(const uint8_t* p) {
+  T value;
+  memcpy(&value, p, sizeof(value));
+  return folly::Endian::little(value);
+}
+
+template <typename T>
+void appendLE(std::string& out, T value) {
+  value = folly::Endian::little(value);
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+uint64_t hashKey(folly::ByteRange key) {
+  return folly::hash::SpookyHashV2::Hash64(key.data(), key.size(), 0);
+}
+
+uint32_t checksum(folly::ByteRange key, folly::ByteRange value) {
+  return folly::crc32c(
+      value.data(), value.size(), folly::crc32c(key.data(), key.size()));
+}
+
+void appendRecord(
+    std::string& out,
+    folly::ByteRange key,
+    folly::ByteRange value) {
+  appendLE(out, folly::to<uint32_t>(key.size()));
+  appendLE(out, folly::to<uint32_t>(value.size()));
+  appendLE(out, checksum(key, value));
+  out.append(reinterpret_cast<const char*>(key.data()), key.size());
+  out.append(reinterpret_cast<const char*>(value.data()), value.size());
+}
+
+struct Record {
+  folly::ByteRange key;
+  folly::ByteRange value;
+};
+
+/**
+ * Parse the record at the given offset of the pack, returning std::nullopt
+ * if it is truncated or corrupt.
+ */
+std::optional<Record> parseRecord(folly::ByteRange pack, uint64_t offset) {
+  if (offset > pack.size() || pack.size() - offset < kRecordHeaderSize) {
+    return std::nullopt;
+  }
+  auto* header = pack.data() + offset;
+  uint64_t keyLength = load<uint32_t>(header);
+  uint64_t valueLength = load<uint32_t>(header + 4);
+  if (pack.size() - offset - kRecordHeaderSize < keyLength + valueLength) {
+    return std::nullopt;
+  }
+  Record record{
+      pack.subpiece(offset + kRecordHeaderSize, keyLength),
+      pack.subpiece(offset + kRecordHeaderSize + keyLength, valueLength)};
+  if (checksum(record.key, record.value) != load<uint32_t>(header + 8)) {
+    return std::nullopt;
+  }
+  return record;
+}
+
+/**
+ * Call fn(key, offset) for each record of the pack, and return the size of
+ * the prefix made of complete records.
+ */
+template <typename Fn>
+uint64_t scanRecords(folly::ByteRange pack, Fn&& fn) {
+  uint64_t offset = 0;
+  while (auto record = parseRecord(pack, offset)) {
+    fn(record->key, offset);
+    offset += kRecordHeaderSize + record->key.size() + record->value.size();
+  }
+  return offset;
+}
+
+std::string buildIndex(
+    const std::vector<std::pair<uint64_t, uint64_t>>& entries) {
+  // Keep the load factor at most 1/2 so that probes stay short and always
+  // reach an empty slot.
+  uint64_t slotCount =
+      folly::nextPowTwo(std::max<uint64_t>(16, entries.size() * 2));
+  std::string index;
+  index.reserve(kIndexHeaderSize + slotCount * kSlotSize);
+  index.append(kIndexMagic.data(), kIndexMagic.size());
+  appendLE(index, kIndexVersion);
+  appendLE(index, slotCount);
+
+  std::vector<std::pair<uint64_t, uint64_t>> slots(
+      slotCount, {0, kEmptySlot});
+  for (auto [hash, offset] : entries) {
+    auto i = hash & (slotCount - 1);
+    while (slots[i].second != kEmptySlot) {
+      i = (i + 1) & (slotCount - 1);
+    }
+    slots[i] = {hash, offset};
+  }
+  for (auto [hash, offset] : slots) {
+    appendLE(index, hash);
+    appendLE(index, offset);
+  }
+  return index;
+}
+
+bool isValidIndex(folly::ByteRange index) {
+  if (index.size() < kIndexHeaderSize ||
+      folly::StringPiece{index.subpiece(0, kIndexMagic.size())} !=
+          kIndexMagic ||
+      load<uint32_t>(index.data() + 4) != kIndexVersion) {
+    return false;
+  }
+  auto slotCount = load<uint64_t>(index.data() + 8);
+  return slotCount > 0 && folly::isPowTwo(slotCount) &&
+      (index.size() - kIndexHeaderSize) / kSlotSize == slotCount &&
+      (index.size() - kIndexHeaderSize) % kSlotSize == 0;
+}
+
+PathComponent fileName(uint64_t number, folly::StringPiece suffix) {
+  auto name = fmt::format(FMT_STRING("{:016}"), number);
+  name.append(suffix.data(), suffix.size());
+  return PathComponent{std::move(name)};
+}
+
+folly::MemoryMapping mapFile(AbsolutePathPiece path) {
+  return folly::MemoryMapping{
+      folly::File{path.stringPiece(), O_RDONLY | O_CLOEXEC}};
+}
+
+void removeFile(AbsolutePathPiece path) {
+  if (::unlink(path.c_str()) != 0 && errno != ENOENT) {
+    folly::throwSystemError("failed to remove ", path);
+  }
+}
+} // namespace
+
+/**
+ * Accumulates its puts and appends them to the packs of each key space in
+ * one write when flushed.
+ */
+class PackLocalStore::Batch : public LocalStore::WriteBatch {
+ public:
+  Batch(PackLocalStore& store, size_t bufSize)
+      : store_{store}, bufSize_{bufSize} {}
+
+  ~Batch() override {
+    if (bytes_ > 0) {
+      XLOG(ERR) << "WriteBatch being destroyed with " << bytes_
+                << " bytes pending flush";
+    }
+  }
+
+  void put(KeySpace keySpace, folly::ByteRange key, folly::ByteRange value)
+      override {
+    add(keySpace,
+        key,
+        std::string{reinterpret_cast<const char*>(value.data()), value.size()});
+  }
+
+  void put(
+      KeySpace keySpace,
+      folly::ByteRange key,
+      std::vector<folly::ByteRange> valueSlices) override {
+    std::string value;
+    for (auto slice : valueSlices) {
+      value.append(reinterpret_cast<const char*>(slice.data()), slice.size());
+    }
+    add(keySpace, key, std::move(value));
+  }
+
+  void flush() override {
+    for (auto& ks : KeySpace::kAll) {
+      auto& entries = entries_[ks->index];
+      if (!entries.empty()) {
+        store_.append(ks, entries);
+        entries.clear();
+      }
+    }
+    bytes_ = 0;
+  }
+
+ private:
+  void add(KeySpace keySpace, folly::ByteRange key, std::string value) {
+    bytes_ += key.size() + value.size();
+    entries_[keySpace->index].emplace_back(
+        std::string{reinterpret_cast<const char*>(key.data()), key.size()},
+        std::move(value));
+    if (bufSize_ > 0 && bytes_ >= bufSize_) {
+      flush();
+    }
+  }
+
+  PackLocalStore& store_;
+  const size_t bufSize_;
+  std::array<
+      std::vector<std::pair<std::string, std::string>>,
+      KeySpace::kTotalCount>
+      entries_;
+  size_t bytes_{0};
+};
+
+PackLocalStore::PackLocalStore(
+    AbsolutePathPiece path,
+    const EdenConfig& config)
+    : root_{path} {
+  for (auto& ks : KeySpace::kAll) {
+    open(ks, config);
+  }
+  clearDeprecatedKeySpaces();
+}
+
+PackLocalStore::~PackLocalStore() {
+  close();
+}
+
+void PackLocalStore::close() {
+  for (auto& keySpace : keySpaces_) {
+    auto state = keySpace.wlock();
+    state->sealed.clear();
+    state->sealedBytes = 0;
+    state->active.close();
+    state->activeIndex.clear();
+  }
+}
+
+AbsolutePath PackLocalStore::getPackPath(KeySpace keySpace, uint64_t number)
+    const {
+  return root_ + PathComponentPiece{keySpace->name} +
+      fileName(number, kPackSuffix);
+}
+
+AbsolutePath PackLocalStore::getIndexPath(KeySpace keySpace, uint64_t number)
+    const {
+  return root_ + PathComponentPiece{keySpace->name} +
+      fileName(number, kIndexSuffix);
+}
+
+void PackLocalStore::open(KeySpace keySpace, const EdenConfig& config) {
+  auto dir = root_ + PathComponentPiece{keySpace->name};
+  ensureDirectoryExists(dir);
+
+  std::vector<uint64_t> numbers;
+  for (const auto& entry :
+       boost::filesystem::directory_iterator{dir.stringPiece().str()}) {
+    auto name = entry.path().filename().string();
+    auto stem = folly::StringPiece{name};
+    if (stem.removeSuffix(kPackSuffix)) {
+      auto number = folly::tryTo<uint64_t>(stem);
+      if (number.hasValue()) {
+        numbers.push_back(number.value());
+      }
+    }
+  }
+  std::sort(numbers.begin(), numbers.end());
+
+  auto state = keySpaces_[keySpace->index].wlock();
+  if (const auto* ephemeral = std::get_if<Ephemeral>(&keySpace->persistence)) {
+    state->packSizeLimit = std::clamp(
+        (config.*(ephemeral->cacheLimit)).getValue() / 8,
+        kMinPackSize,
+        kMaxPackSize);
+  }
+
+  // The last pack is still active unless it was sealed just before
+  // shutting down.
+  uint64_t activeNumber = 0;
+  for (auto number : numbers) {
+    if (number == numbers.back() &&
+        ::access(getIndexPath(keySpace, number).c_str(), F_OK) != 0) {
+      activeNumber = number;
+      break;
+    }
+    auto pack = openSealed(keySpace, number);
+    state->sealedBytes += pack.data.range().size();
+    state->sealed.push_back(std::move(pack));
+    activeNumber = number + 1;
+  }
+  openActive(keySpace, *state, activeNumber);
+}
+
+PackLocalStore::SealedPack PackLocalStore::openSealed(
+    KeySpace keySpace,
+    uint64_t number) const {
+  auto packPath = getPackPath(keySpace, number);
+  auto indexPath = getIndexPath(keySpace, number);
+  auto data = mapFile(packPath);
+
+  std::optional<folly::MemoryMapping> index;
+  if (::access(indexPath.c_str(), F_OK) == 0) {
+    index.emplace(mapFile(indexPath));
+  }
+  if (!index || !isValidIndex(index->range())) {
+    XLOG(WARN) << "rebuilding the index of " << packPath;
+    std::vector<std::pair<uint64_t, uint64_t>> entries;
+    scanRecords(data.range(), [&](folly::ByteRange key, uint64_t offset) {
+      entries.emplace_back(hashKey(key), offset);
+    });
+    folly::writeFileAtomic(
+        indexPath.stringPiece(), folly::StringPiece{buildIndex(entries)});
+    index.emplace(mapFile(indexPath));
+  }
+  return SealedPack{number, std::move(data), std::move(*index)};
+}
+
+void PackLocalStore::openActive(
+    KeySpace keySpace,
+    KeySpaceState& state,
+    uint64_t number) const {
+  auto path = getPackPath(keySpace, number);
+  folly::File file{
+      path.stringPiece(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644};
+  struct stat st;
+  folly::checkUnixError(fstat(file.fd(), &st), "failed to stat ", path);
+
+  state.activeIndex.clear();
+  uint64_t validBytes = 0;
+  if (st.st_size > 0) {
+    folly::MemoryMapping data{file.dup()};
+    validBytes =
+        scanRecords(data.range(), [&](folly::ByteRange key, uint64_t offset) {
+          state.activeIndex.insert_or_assign(
+              std::string{folly::StringPiece{key}}, offset);
+        });
+  }
+  if (validBytes < static_cast<uint64_t>(st.st_size)) {
+    XLOG(WARN) << "truncating " << path << " from " << st.st_size << " to "
+               << validBytes << " bytes after an incomplete record";
+    folly::checkUnixError(
+        folly::ftruncateNoInt(file.fd(), validBytes),
+        "failed to truncate ",
+        path);
+  }
+
+  state.active = std::move(file);
+  state.activeNumber = number;
+  state.activeBytes = validBytes;
+}
+
+void PackLocalStore::append(
+    KeySpace keySpace,
+    const std::vector<std::pair<std::string, std::string>>& entries) {
+  std::string buffer;
+  std::vector<uint64_t> offsets;
+  offsets.reserve(entries.size());
+  for (const auto& [key, value] : entries) {
+    offsets.push_back(buffer.size());
+    appendRecord(buffer, folly::StringPiece{key}, folly::StringPiece{value});
+  }
+
+  auto state = keySpaces_[keySpace->index].wlock();
+  checkOpen(*state);
+  auto written =
+      folly::writeFull(state->active.fd(), buffer.data(), buffer.size());
+  if (written != static_cast<ssize_t>(buffer.size())) {
+    auto error = errno;
+    // Don't leave a partial record behind the next ones.
+    folly::ftruncateNoInt(state->active.fd(), state->activeBytes);
+    folly::throwSystemErrorExplicit(
+        error, "failed to append to the ", keySpace->name, " pack");
+  }
+  for (size_t i = 0; i < entries.size(); ++i) {
+    state->activeIndex.insert_or_assign(
+        entries[i].first, state->activeBytes + offsets[i]);
+  }
+  state->activeBytes += buffer.size();
+
+  if (state->activeBytes >= state->packSizeLimit) {
+    sealActive(keySpace, *state);
+  }
+}
+
+void PackLocalStore::sealActive(KeySpace keySpace, KeySpaceState& state)
+    const {
+  std::vector<std::pair<uint64_t, uint64_t>> entries;
+  entries.reserve(state.activeIndex.size());
+  for (const auto& [key, offset] : state.activeIndex) {
+    entries.emplace_back(hashKey(folly::StringPiece{key}), offset);
+  }
+  folly::writeFileAtomic(
+      getIndexPath(keySpace, state.activeNumber).stringPiece(),
+      folly::StringPiece{buildIndex(entries)});
+
+  auto pack = openSealed(keySpace, state.activeNumber);
+  state.sealedBytes += pack.data.range().size();
+  state.sealed.push_back(std::move(pack));
+  openActive(keySpace, state, state.activeNumber + 1);
+}
+
+void PackLocalStore::dropOldest(KeySpace keySpace, KeySpaceState& state)
+    const {
+  auto& oldest = state.sealed.front();
+  XLOG(DBG2) << "dropping pack " << oldest.number << " of " << keySpace->name;
+  state.sealedBytes -= oldest.data.range().size();
+  removeFile(getIndexPath(keySpace, oldest.number));
+  removeFile(getPackPath(keySpace, oldest.number));
+  state.sealed.erase(state.sealed.begin());
+}
+
+void PackLocalStore::checkOpen(const KeySpaceState& state) const {
+  if (state.active.fd() == -1) {
+    throw std::runtime_error("the PackLocalStore is closed");
+  }
+}
+
+std::optional<folly::ByteRange> PackLocalStore::findSealed(
+    const KeySpaceState& state,
+    folly::ByteRange key) const {
+  auto hash = hashKey(key);
+  for (auto pack = state.sealed.rbegin(); pack != state.sealed.rend();
+       ++pack) {
+    auto index = pack->index.range();
+    auto mask = load<uint64_t>(index.data() + 8) - 1;
+    for (auto i = hash & mask;; i = (i + 1) & mask) {
+      auto* slot = index.data() + kIndexHeaderSize + i * kSlotSize;
+      auto offset = load<uint64_t>(slot + 8);
+      if (offset == kEmptySlot) {
+        break;
+      }
+      if (load<uint64_t>(slot) != hash) {
+        continue;
+      }
+      auto record = parseRecord(pack->data.range(), offset);
+      if (record && record->key == key) {
+        return record->value;
+      }
+    }
+  }
+  return std::nullopt;
+}
+
+std::string PackLocalStore::readActive(
+    const KeySpaceState& state,
+    uint64_t offset) const {
+  uint8_t header[kRecordHeaderSize];
+  if (folly::preadFull(state.active.fd(), header, sizeof(header), offset) !=
+      static_cast<ssize_t>(sizeof(header))) {
+    folly::throwSystemError("failed to read a record header");
+  }
+  auto keyLength = load<uint32_t>(header);
+  std::string value(load<uint32_t>(header + 4), '\0');
+  if (folly::preadFull(
+          state.active.fd(),
+          value.data(),
+          value.size(),
+          offset + kRecordHeaderSize + keyLength) !=
+      static_cast<ssize_t>(value.size())) {
+    folly::throwSystemError("failed to read a record");
+  }
+  return value;
+}
+
+void PackLocalStore::clearKeySpace(KeySpace keySpace) {
+  auto state = keySpaces_[keySpace->index].wlock();
+  checkOpen(*state);
+  while (!state->sealed.empty()) {
+    dropOldest(keySpace, *state);
+  }
+  state->active.close();
+  removeFile(getPackPath(keySpace, state->activeNumber));
+  openActive(keySpace, *state, state->activeNumber + 1);
+}
+
+void PackLocalStore::compactKeySpace(KeySpace) {
+  // Packs are never rewritten: the space of old values is reclaimed by
+  // dropping whole packs in periodicManagementTask().
+}
+
+StoreResult PackLocalStore::get(KeySpace keySpace, folly::ByteRange key)
+    const {
+  auto state = keySpaces_[keySpace->index].rlock();
+  checkOpen(*state);
+  auto active = state->activeIndex.find(folly::StringPiece{key});
+  if (active != state->activeIndex.end()) {
+    return StoreResult{readActive(*state, active->second)};
+  }
+  if (auto value = findSealed(*state, key)) {
+    return StoreResult{std::string{folly::StringPiece{*value}}};
+  }
+  return StoreResult::missing(keySpace, key);
+}
+
+bool PackLocalStore::hasKey(KeySpace keySpace, folly::ByteRange key) const {
+  auto state = keySpaces_[keySpace->index].rlock();
+  checkOpen(*state);
+  return state->activeIndex.count(folly::StringPiece{key}) ||
+      findSealed(*state, key).has_value();
+}
+
+void PackLocalStore::put(
+    KeySpace keySpace,
+    folly::ByteRange key,
+    folly::ByteRange value) {
+  std::vector<std::pair<std::string, std::string>> entries;
+  entries.emplace_back(
+      std::string{reinterpret_cast<const char*>(key.data()), key.size()},
+      std::string{reinterpret_cast<const char*>(value.data()), value.size()});
+  append(keySpace, entries);
+}
+
+std::unique_ptr<LocalStore::WriteBatch> PackLocalStore::beginWrite(
+    size_t bufSize) {
+  return std::make_unique<Batch>(*this, bufSize);
+}
+
+void PackLocalStore::periodicManagementTask(const EdenConfig& config) {
+  enableBlobCaching.store(
+      config.enableBlobCaching.getValue(), std::memory_order_relaxed);
+
+  for (auto& ks : KeySpace::kAll) {
+    auto state = keySpaces_[ks->index].wlock();
+    if (const auto* ephemeral = std::get_if<Ephemeral>(&ks->persistence)) {
+      auto limit = (config.*(ephemeral->cacheLimit)).getValue();
+      while (!state->sealed.empty() &&
+             state->sealedBytes + state->activeBytes > limit) {
+        dropOldest(ks, *state);
+      }
+    }
+    fb303::fbData->setCounter(
+        folly::to<std::string>("local_store.", ks->name, ".size"),
+        state->sealedBytes + state->activeBytes);
+  }
+}
+
+uint64_t PackLocalStore::getApproximateSize(KeySpace keySpace) const {
+  auto state = keySpaces_[keySpace->index].rlock();
+  return state->sealedBytes + state->activeBytes;
+}
+
+size_t PackLocalStore::getPackCount(KeySpace keySpace) const {
+  return keySpaces_[keySpace->index].rlock()->sealed.size() + 1;
+}
+
+} // namespace facebook::eden
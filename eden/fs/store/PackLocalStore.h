@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/File.h>
+#include <folly/Synchronized.h>
+#include <folly/container/F14Map.h>
+#include <folly/system/MemoryMapping.h>
+#include <array>
+#include <vector>
+
+#include "eden/fs/store/LocalStore.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook::eden {
+
+/**
+ * An implementation of LocalStore for immutable, content-addressed values,
+ * which appends them to pack files instead of maintaining an LSM tree.
+ *
+ * Each key space has its own directory of numbered packs. New values are
+ * appended to the newest, active pack, and an in-memory index maps their
+ * keys to their offset. Once the active pack reaches its size limit it is
+ * sealed: a hash index of its keys is written next to it, and both files
+ * are then memory mapped and never modified again.
+ *
+ * Since values are never rewritten there is no compaction. Instead, the
+ * oldest packs of an ephemeral key space are deleted when it exceeds its
+ * size limit, dropping the values that were written the earliest.
+ *
+ * When opening the store, the active pack is scanned to rebuild its index,
+ * and truncated after the last complete record if EdenFS did not shut down
+ * cleanly.
+ */
+class PackLocalStore : public LocalStore {
+ public:
+  /**
+   * The largest size of a pack. The packs of an ephemeral key space are
+   * made smaller so that dropping one only evicts a fraction of its limit.
+   */
+  static constexpr uint64_t kMaxPackSize = 256 * 1024 * 1024;
+
+  PackLocalStore(AbsolutePathPiece path, const EdenConfig& config);
+  ~PackLocalStore() override;
+
+  void close() override;
+  void clearKeySpace(KeySpace keySpace) override;
+  void compactKeySpace(KeySpace keySpace) override;
+  StoreResult get(KeySpace keySpace, folly::ByteRange key) const override;
+  bool hasKey(KeySpace keySpace, folly::ByteRange key) const override;
+  void put(KeySpace keySpace, folly::ByteRange key, folly::ByteRange value)
+      override;
+  std::unique_ptr<WriteBatch> beginWrite(size_t bufSize = 0) override;
+
+  /**
+   * Delete the oldest packs of the ephemeral key spaces exceeding their
+   * size limit.
+   */
+  void periodicManagementTask(const EdenConfig& config) override;
+
+  /**
+   * The total size of the packs of the key space.
+   */
+  uint64_t getApproximateSize(KeySpace keySpace) const;
+
+  /**
+   * The number of packs of the key space, including the active one.
+   */
+  size_t getPackCount(KeySpace keySpace) const;
+
+ private:
+  class Batch;
+
+  struct SealedPack {
+    uint64_t number;
+    folly::MemoryMapping data;
+    folly::MemoryMapping index;
+  };
+
+  struct KeySpaceState {
+    std::vector<SealedPack> sealed;
+    uint64_t sealedBytes{0};
+    uint64_t activeNumber{0};
+    folly::File active;
+    uint64_t activeBytes{0};
+    folly::F14FastMap<std::string, uint64_t> activeIndex;
+    uint64_t packSizeLimit{kMaxPackSize};
+  };
+
+  AbsolutePath getPackPath(KeySpace keySpace, uint64_t number) const;
+  AbsolutePath getIndexPath(KeySpace keySpace, uint64_t number) const;
+
+  void open(KeySpace keySpace, const EdenConfig& config);
+  SealedPack openSealed(KeySpace keySpace, uint64_t number) const;
+  void openActive(KeySpace keySpace, KeySpaceState& state, uint64_t number)
+      const;
+
+  /**
+   * Append the entries to the active pack in a single write, sealing it
+   * once it reaches its size limit.
+   */
+  void append(
+      KeySpace keySpace,
+      const std::vector<std::pair<std::string, std::string>>& entries);
+  void sealActive(KeySpace keySpace, KeySpaceState& state) const;
+  void dropOldest(KeySpace keySpace, KeySpaceState& state) const;
+
+  /**
+   * Find the value of the key in the sealed packs, newest first, returning
+   * a range pointing into the mapping of the pack.
+   */
+  std::optional<folly::ByteRange> findSealed(
+      const KeySpaceState& state,
+      folly::ByteRange key) const;
+
+  /**
+   * Read the value of the record at the given offset of the active pack.
+   */
+  std::string readActive(const KeySpaceState& state, uint64_t offset) const;
+
+  void checkOpen(const KeySpaceState& state) const;
+
+  const AbsolutePath root_;
+  std::array<folly::Synchronized<KeySpaceState>, KeySpace::kTotalCount>
+      keySpaces_;
+};
+
+} // namespace facebook::eden
@@ -6,6 +6,8 @@
  */
 
 #include "eden/fs/store/PathLoader.h"
+#include <folly/container/F14Map.h>
+#include <folly/futures/Future.h>
 #include <vector>
 #include "eden/fs/model/Tree.h"
 #include "eden/fs/service/gen-cpp2/eden_constants.h"
@@ -55,6 +57,119 @@ folly::Future<std::shared_ptr<const Tree>> resolveTree(
       });
 }
 
+/**
+ * A node of the prefix trie of the paths given to resolveTrees(), standing
+ * for one directory.
+ */
+struct PathTrieNode {
+  // The indexes of the paths naming this directory.
+  std::vector<size_t> paths;
+  folly::F14FastMap<PathComponent, std::unique_ptr<PathTrieNode>> children;
+};
+
+struct ResolveTreesContext {
+  PathTrieNode root;
+  std::vector<folly::Try<std::shared_ptr<const Tree>>> results;
+};
+
+/**
+ * Fail the paths naming the directory of the node and its descendants.
+ */
+void failSubtree(
+    ResolveTreesContext& ctx,
+    const PathTrieNode& node,
+    const folly::exception_wrapper& error) {
+  for (auto index : node.paths) {
+    ctx.results[index] = folly::Try<std::shared_ptr<const Tree>>{error};
+  }
+  for (const auto& [name, child] : node.children) {
+    failSubtree(ctx, *child, error);
+  }
+}
+
+/**
+ * Resolve the paths of the nodes whose trees are known, then fetch the trees
+ * of all their children at once and continue with those.
+ */
+folly::Future<folly::Unit> resolveLevel(
+    std::shared_ptr<ResolveTreesContext> ctx,
+    ObjectStore& objectStore,
+    ObjectFetchContext& fetchContext,
+    std::vector<std::pair<const PathTrieNode*, std::shared_ptr<const Tree>>>
+        level) {
+  // The children of the level to fetch, grouped by tree, since identical
+  // directories share it.
+  folly::F14FastMap<Hash, std::vector<const PathTrieNode*>> childrenByHash;
+  std::vector<Hash> hashes;
+  for (auto& [node, tree] : level) {
+    for (auto index : node->paths) {
+      ctx->results[index] = folly::Try<std::shared_ptr<const Tree>>{tree};
+    }
+    for (const auto& [name, child] : node->children) {
+      auto* entry = tree->getEntryPtr(name);
+      if (!entry) {
+        failSubtree(
+            *ctx,
+            *child,
+            folly::exception_wrapper{newEdenError(
+                ENOENT,
+                EdenErrorType::POSIX_ERROR,
+                "no child with name ",
+                name)});
+        continue;
+      }
+      if (!entry->isTree()) {
+        failSubtree(
+            *ctx,
+            *child,
+            folly::exception_wrapper{newEdenError(
+                ENOTDIR,
+                EdenErrorType::POSIX_ERROR,
+                "child is not tree ",
+                name)});
+        continue;
+      }
+      auto& nodes = childrenByHash[entry->getHash()];
+      if (nodes.empty()) {
+        hashes.push_back(entry->getHash());
+      }
+      nodes.push_back(child.get());
+    }
+  }
+  if (hashes.empty()) {
+    return folly::makeFuture();
+  }
+
+  std::vector<folly::Future<std::shared_ptr<const Tree>>> futures;
+  futures.reserve(hashes.size());
+  for (const auto& hash : hashes) {
+    futures.push_back(objectStore.getTree(hash, fetchContext));
+  }
+  return folly::collectAll(std::move(futures))
+      .toUnsafeFuture()
+      .thenValue([ctx = std::move(ctx),
+                  &objectStore,
+                  &fetchContext,
+                  hashes = std::move(hashes),
+                  childrenByHash = std::move(childrenByHash)](
+                     std::vector<folly::Try<std::shared_ptr<const Tree>>>&&
+                         trees) mutable {
+        std::vector<std::pair<const PathTrieNode*, std::shared_ptr<const Tree>>>
+            next;
+        for (size_t i = 0; i < hashes.size(); ++i) {
+          for (auto* node : childrenByHash[hashes[i]]) {
+            if (trees[i].hasException()) {
+              failSubtree(*ctx, *node, trees[i].exception());
+            } else {
+              next.emplace_back(node, trees[i].value());
+            }
+          }
+        }
+        return resolveLevel(
+            std::move(ctx), objectStore, fetchContext, std::move(next));
+      });
+}
+
 } // namespace
 
 folly::Future<std::shared_ptr<const Tree>> resolveTree(
@@ -73,4 +188,31 @@ folly::Future<std::shared_ptr<const Tree>> resolveTree(
       std::move(ctx), objectStore, fetchContext, std::move(root), 0);
 }
 
+folly::Future<std::vector<folly::Try<std::shared_ptr<const Tree>>>>
+resolveTrees(
+    ObjectStore& objectStore,
+    ObjectFetchContext& fetchContext,
+    std::shared_ptr<const Tree> root,
+    const std::vector<RelativePath>& paths) {
+  auto ctx = std::make_shared<ResolveTreesContext>();
+  ctx->results.resize(paths.size());
+  for (size_t i = 0; i < paths.size(); ++i) {
+    auto* node = &ctx->root;
+    for (auto c : paths[i].components()) {
+      auto& child = node->children[PathComponent{c}];
+      if (!child) {
+        child = std::make_unique<PathTrieNode>();
+      }
+      node = child.get();
+    }
+    node->paths.push_back(i);
+  }
+
+  std::vector<std::pair<const PathTrieNode*, std::shared_ptr<const Tree>>>
+      level;
+  level.emplace_back(&ctx->root, std::move(root));
+  return resolveLevel(ctx, objectStore, fetchContext, std::move(level))
+      .thenValue([ctx](folly::Unit) { return std::move(ctx->results); });
+}
+
 } // namespace facebook::eden
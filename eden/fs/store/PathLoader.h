@@ -7,7 +7,9 @@
 
 #pragma once
 
+#include <folly/Try.h>
 #include <folly/futures/Future.h>
+#include <vector>
 #include "eden/fs/store/ObjectFetchContext.h"
 #include "eden/fs/utils/PathFuncs.h"
 
@@ -23,4 +25,19 @@ folly::Future<std::shared_ptr<const Tree>> resolveTree(
     std::shared_ptr<const Tree> root,
     RelativePathPiece path);
 
+/**
+ * Resolve many paths relative to the same root, in the same order.
+ *
+ * The paths are walked together, one level at a time: the trees of a level
+ * are fetched concurrently, and a tree shared by several paths, as a common
+ * parent or an identical subtree, is only fetched once. A path that doesn't
+ * resolve only fails its own result.
+ */
+folly::Future<std::vector<folly::Try<std::shared_ptr<const Tree>>>>
+resolveTrees(
+    ObjectStore& objectStore,
+    ObjectFetchContext& fetchContext,
+    std::shared_ptr<const Tree> root,
+    const std::vector<RelativePath>& paths);
+
 } // namespace facebook::eden
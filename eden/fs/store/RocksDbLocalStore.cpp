@@ -14,19 +14,23 @@
 #include <folly/Format.h>
 #include <folly/String.h>
 #include <folly/futures/Future.h>
+#include <folly/hash/SpookyHashV2.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/IOBuf.h>
 #include <folly/lang/Bits.h>
 #include <folly/logging/xlog.h>
+#include <rocksdb/cache.h>
 #include <rocksdb/convenience.h>
 #include <rocksdb/db.h>
 #include <rocksdb/filter_policy.h>
 #include <rocksdb/table.h>
+#include <rocksdb/version.h>
 
 #include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/rocksdb/RocksException.h"
 #include "eden/fs/rocksdb/RocksHandles.h"
 #include "eden/fs/store/KeySpace.h"
+#include "eden/fs/store/LocalStoreAccessLog.h"
 #include "eden/fs/store/StoreResult.h"
 #include "eden/fs/telemetry/StructuredLogger.h"
 #include "eden/fs/utils/FaultInjector.h"
@@ -40,18 +44,117 @@ using rocksdb::WriteOptions;
 using std::string;
 using std::chrono::duration_cast;
 
+namespace facebook::eden {
+
+/**
+ * The block caches the column families are opened with.
+ */
+struct RocksDbBlockCaches {
+  std::shared_ptr<rocksdb::Cache> shared;
+  std::shared_ptr<rocksdb::Cache> blob;
+};
+
+} // namespace facebook::eden
+
 namespace {
 using namespace facebook::eden;
 
-rocksdb::ColumnFamilyOptions makeColumnOptions(uint64_t LRUblockCacheSizeMB) {
-  rocksdb::ColumnFamilyOptions options;
+using Profiles = std::array<RocksDbProfile, KeySpace::kTotalCount>;
+
+Profiles getProfiles(const EdenConfig& config) {
+  Profiles profiles;
+  for (auto& ks : KeySpace::kAll) {
+    if (ks->index == KeySpace::BlobFamily.index) {
+      profiles[ks->index] = RocksDbProfile::Blob;
+    } else if (ks->index == KeySpace::TreeFamily.index) {
+      profiles[ks->index] = RocksDbProfile::Tree;
+    } else {
+      profiles[ks->index] = RocksDbProfile::PointLookup;
+    }
+  }
+
+  for (const auto& entry : config.localStoreRocksDbProfiles.getValue()) {
+    folly::StringPiece keySpaceName;
+    folly::StringPiece profileName;
+    std::optional<RocksDbProfile> profile;
+    if (folly::split(':', entry, keySpaceName, profileName)) {
+      profile = parseRocksDbProfile(profileName);
+    }
+    auto ks = std::find_if(
+        std::begin(KeySpace::kAll),
+        std::end(KeySpace::kAll),
+        [&](const KeySpaceRecord* record) {
+          return record->name == keySpaceName;
+        });
+    if (!profile || ks == std::end(KeySpace::kAll)) {
+      XLOG(WARN) << "ignoring invalid RocksDB profile override: " << entry;
+      continue;
+    }
+    profiles[(*ks)->index] = *profile;
+  }
+  return profiles;
+}
 
-  // We'll never perform range scans on any of the keys that we store.
-  // This enables bloom filters and a hash policy that improves our
-  // get/put performance.
-  options.OptimizeForPointLookup(LRUblockCacheSizeMB);
+// Most of the column families share the same cache. We want the blob data
+// to live in its own smaller cache; the assumption is that the vfs cache
+// will compensate for that, together with the idea that we shouldn't need
+// to materialize a great many files.
+RocksDbBlockCaches makeBlockCaches(const EdenConfig& config) {
+  return RocksDbBlockCaches{
+      rocksdb::NewLRUCache(config.localStoreRocksDbBlockCacheSize.getValue()),
+      rocksdb::NewLRUCache(
+          config.localStoreRocksDbBlobBlockCacheSize.getValue())};
+}
 
+rocksdb::ColumnFamilyOptions makeColumnOptions(
+    RocksDbProfile profile,
+    const RocksDbBlockCaches& caches,
+    const EdenConfig& config) {
+  rocksdb::ColumnFamilyOptions options;
   options.OptimizeLevelStyleCompaction();
+
+  // We'll never perform range scans on any of the keys that we store, so
+  // bloom filters on the whole keys avoid most reads of absent keys.
+  rocksdb::BlockBasedTableOptions table;
+  table.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10));
+  table.whole_key_filtering = true;
+
+  switch (profile) {
+    case RocksDbProfile::PointLookup:
+      // The values are a few dozen bytes: small blocks limit the read
+      // amplification of a lookup, the hash index avoids the binary search
+      // within a block, and compression would hardly save anything.
+      table.block_size = 4 * 1024;
+      table.data_block_index_type =
+          rocksdb::BlockBasedTableOptions::kDataBlockBinaryAndHash;
+      table.block_cache = caches.shared;
+      options.compression = rocksdb::kNoCompression;
+      options.memtable_prefix_bloom_size_ratio = 0.02;
+      options.memtable_whole_key_filtering = true;
+      break;
+    case RocksDbProfile::Tree:
+      table.block_size = 16 * 1024;
+      table.index_type = rocksdb::BlockBasedTableOptions::kTwoLevelIndexSearch;
+      table.partition_filters = true;
+      table.cache_index_and_filter_blocks = true;
+      table.pin_top_level_index_and_filter = true;
+      table.block_cache = caches.shared;
+      break;
+    case RocksDbProfile::Blob:
+      table.block_size = 64 * 1024;
+      table.block_cache = caches.blob;
+#if ROCKSDB_MAJOR > 6 || (ROCKSDB_MAJOR == 6 && ROCKSDB_MINOR >= 18)
+      if (auto minBlobSize = config.localStoreRocksDbBlobFileMinSize.getValue();
+          minBlobSize > 0) {
+        options.enable_blob_files = true;
+        options.min_blob_size = minBlobSize;
+        options.blob_compression_type = options.compression;
+      }
+#endif
+      break;
+  }
+
+  options.table_factory.reset(rocksdb::NewBlockBasedTableFactory(table));
   return options;
 }
 
@@ -61,13 +164,11 @@ rocksdb::ColumnFamilyOptions makeColumnOptions(uint64_t LRUblockCacheSizeMB) {
  */
 const std::vector<rocksdb::ColumnFamilyDescriptor> columnFamilies(
     const rocksdb::DBOptions& db_options,
-    const std::string& name) {
-  // Most of the column families will share the same cache.  We
-  // want the blob data to live in its own smaller cache; the assumption
-  // is that the vfs cache will compensate for that, together with the
-  // idea that we shouldn't need to materialize a great many files.
-  auto options = makeColumnOptions(64);
-  auto blobOptions = makeColumnOptions(8);
+    const std::string& name,
+    const Profiles& profiles,
+    const RocksDbBlockCaches& caches,
+    const EdenConfig& config) {
+  auto options = makeColumnOptions(RocksDbProfile::PointLookup, caches, config);
 
   // We have to open all column families that currenly exists in our RocksDb.
   // Else we will get "Invalid argument: You have to open all column
@@ -81,8 +182,7 @@ const std::vector<rocksdb::ColumnFamilyDescriptor> columnFamilies(
   std::vector<rocksdb::ColumnFamilyDescriptor> families;
   for (auto& ks : KeySpace::kAll) {
     families.emplace_back(
-        ks->name.str(),
-        (ks->index == KeySpace::BlobFamily.index) ? blobOptions : options);
+        ks->name.str(), makeColumnOptions(profiles[ks->index], caches, config));
     auto oldFamily = find(
         oldUnopenedColumnFamilies.begin(),
         oldUnopenedColumnFamilies.end(),
@@ -244,10 +344,19 @@ rocksdb::Options getRocksdbOptions() {
   return options;
 }
 
-RocksHandles openDB(AbsolutePathPiece path, RocksDBOpenMode mode) {
+RocksHandles openDB(
+    AbsolutePathPiece path,
+    RocksDBOpenMode mode,
+    const Profiles& profiles,
+    const RocksDbBlockCaches& caches,
+    const EdenConfig& config) {
   auto options = getRocksdbOptions();
-  const auto columnDescriptors =
-      columnFamilies(rocksdb::DBOptions{options}, path.stringPiece().str());
+  const auto columnDescriptors = columnFamilies(
+      rocksdb::DBOptions{options},
+      path.stringPiece().str(),
+      profiles,
+      caches,
+      config);
   try {
     return RocksHandles(path.stringPiece(), mode, options, columnDescriptors);
   } catch (const RocksException& ex) {
@@ -260,25 +369,169 @@ RocksHandles openDB(AbsolutePathPiece path, RocksDBOpenMode mode) {
     // Fall through and attempt to repair the DB
   }
 
-  RocksDbLocalStore::repairDB(path);
+  RocksDbLocalStore::repairDB(path, config);
 
   // Now try opening the DB again.
   return RocksHandles(path.stringPiece(), mode, options, columnDescriptors);
 }
 
+// Flush the deletions of the automatic garbage collection every few
+// megabytes of keys.
+constexpr size_t kEvictionBatchBytes = 1024 * 1024;
+
+// Values at least this large are returned pinned in the block cache rather
+// than copied out of it. A value this large takes up at least half of a
+// block of the Blob profile, so that keeping it in memory, say in the
+// BlobCache, holds at most about twice its size in the block cache.
+constexpr size_t kMinPinnedValueSize = 32 * 1024;
+
+/**
+ * A value read from RocksDB, owned by the IOBuf of a StoreResult.
+ */
+struct PinnedValue {
+  rocksdb::PinnableSlice slice;
+  // Releasing a pin only needs the cache it is in. Holding the caches lets
+  // values outlive the DB, as a Blob may when the store is closed.
+  std::shared_ptr<const RocksDbBlockCaches> caches;
+};
+
+void freePinnedValue(void* /* buffer */, void* userData) {
+  delete static_cast<PinnedValue*>(userData);
+}
+
+StoreResult makePinnedResult(std::unique_ptr<PinnedValue> value) {
+  auto& slice = value->slice;
+  if (!slice.IsPinned()) {
+    // Values from the memtable were copied into the slice itself.
+    return StoreResult(std::move(*slice.GetSelf()));
+  }
+  if (slice.size() < kMinPinnedValueSize) {
+    return StoreResult(slice.ToString());
+  }
+  // Extract the data and size before we pass value.release() to the IOBuf
+  // constructor, since arguments are evaluated in an arbitrary order.
+  auto data = const_cast<char*>(slice.data());
+  auto size = slice.size();
+  return StoreResult(folly::IOBuf(
+      folly::IOBuf::TAKE_OWNERSHIP,
+      data,
+      size,
+      freePinnedValue,
+      value.release()));
+}
+
 } // namespace
 
 namespace facebook::eden {
 
+/**
+ * Remembers which keys of a key space were read recently, as two
+ * generations of bits indexed by a hash of the keys. The current generation
+ * records the reads since the eviction hand last swept over the whole key
+ * space, and the previous one those of the sweep before.
+ *
+ * Hash collisions only make the garbage collection keep a few more objects.
+ */
+class RocksDbLocalStore::AccessFilter {
+ public:
+  AccessFilter() {
+    for (auto& generation : generations_) {
+      generation = std::make_unique<std::atomic<uint64_t>[]>(kWords);
+      for (size_t i = 0; i < kWords; ++i) {
+        generation[i].store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  void record(ByteRange key) {
+    auto bit = hash(key);
+    generations_[current_.load(std::memory_order_relaxed)][bit / 64]
+        .fetch_or(uint64_t{1} << (bit % 64), std::memory_order_relaxed);
+  }
+
+  bool recentlyAccessed(ByteRange key) const {
+    auto bit = hash(key);
+    auto mask = uint64_t{1} << (bit % 64);
+    return (generations_[0][bit / 64].load(std::memory_order_relaxed) |
+            generations_[1][bit / 64].load(std::memory_order_relaxed)) &
+        mask;
+  }
+
+  /**
+   * Forget the reads of the previous generation and start a new one.
+   */
+  void age() {
+    auto previous = current_.load(std::memory_order_relaxed) ^ 1;
+    for (size_t i = 0; i < kWords; ++i) {
+      generations_[previous][i].store(0, std::memory_order_relaxed);
+    }
+    current_.store(previous, std::memory_order_relaxed);
+  }
+
+ private:
+  // 4M bits per generation, 1MB per key space.
+  static constexpr size_t kBits = size_t{1} << 22;
+  static constexpr size_t kWords = kBits / 64;
+
+  static size_t hash(ByteRange key) {
+    return folly::hash::SpookyHashV2::Hash64(key.data(), key.size(), 0) %
+        kBits;
+  }
+
+  std::array<std::unique_ptr<std::atomic<uint64_t>[]>, 2> generations_;
+  std::atomic<size_t> current_{0};
+};
+
+folly::StringPiece rocksDbProfileName(RocksDbProfile profile) {
+  switch (profile) {
+    case RocksDbProfile::PointLookup:
+      return "point-lookup";
+    case RocksDbProfile::Tree:
+      return "tree";
+    case RocksDbProfile::Blob:
+      return "blob";
+  }
+  return "unknown";
+}
+
+std::optional<RocksDbProfile> parseRocksDbProfile(folly::StringPiece name) {
+  for (auto profile :
+       {RocksDbProfile::PointLookup,
+        RocksDbProfile::Tree,
+        RocksDbProfile::Blob}) {
+    if (name == rocksDbProfileName(profile)) {
+      return profile;
+    }
+  }
+  return std::nullopt;
+}
+
 RocksDbLocalStore::RocksDbLocalStore(
     AbsolutePathPiece pathToRocksDb,
     std::shared_ptr<StructuredLogger> structuredLogger,
     FaultInjector* faultInjector,
+    const EdenConfig& config,
     RocksDBOpenMode mode)
     : structuredLogger_{std::move(structuredLogger)},
       faultInjector_(*faultInjector),
       ioPool_(12, "RocksLocalStore"),
-      dbHandles_(folly::in_place, openDB(pathToRocksDb, mode)) {
+      profiles_(getProfiles(config)),
+      blockCaches_(
+          std::make_shared<RocksDbBlockCaches>(makeBlockCaches(config))),
+      dbHandles_(
+          folly::in_place,
+          openDB(pathToRocksDb, mode, profiles_, *blockCaches_, config)) {
+  for (auto& ks : KeySpace::kAll) {
+    if (ks->isEphemeral()) {
+      accessFilters_[ks->index] = std::make_unique<AccessFilter>();
+    }
+  }
+  if (auto sampleDenominator =
+          config.localStoreAccessLogSampleDenominator.getValue();
+      sampleDenominator > 0 && mode == RocksDBOpenMode::ReadWrite) {
+    accessLog_ = std::make_unique<LocalStoreAccessLog>(
+        getAccessLogPath(pathToRocksDb), sampleDenominator);
+  }
   // Publish fb303 stats once when we first open the DB.
   // These will be kept up-to-date later by the periodicManagementTask() call.
   computeStats(/*publish=*/true, /*config=*/nullptr);
@@ -297,7 +550,9 @@ void RocksDbLocalStore::close() {
   handles->close();
 }
 
-void RocksDbLocalStore::repairDB(AbsolutePathPiece path) {
+void RocksDbLocalStore::repairDB(
+    AbsolutePathPiece path,
+    const EdenConfig& config) {
   XLOG(ERR) << "Attempting to repair RocksDB " << path;
   rocksdb::ColumnFamilyOptions unknownColumFamilyOptions;
   unknownColumFamilyOptions.OptimizeForPointLookup(8);
@@ -306,8 +561,12 @@ void RocksDbLocalStore::repairDB(AbsolutePathPiece path) {
   auto dbPathStr = path.stringPiece().str();
   rocksdb::DBOptions dbOptions(getRocksdbOptions());
 
-  const auto columnDescriptors =
-      columnFamilies(dbOptions, path.stringPiece().str());
+  const auto columnDescriptors = columnFamilies(
+      dbOptions,
+      path.stringPiece().str(),
+      getProfiles(config),
+      makeBlockCaches(config),
+      config);
 
   auto status = RepairDB(
       dbPathStr, dbOptions, columnDescriptors, unknownColumFamilyOptions);
@@ -373,14 +632,16 @@ void RocksDbLocalStore::compactKeySpace(KeySpace keySpace) {
 
 StoreResult RocksDbLocalStore::get(KeySpace keySpace, ByteRange key) const {
   auto handles = getHandles();
-  string value;
+  auto value = std::make_unique<PinnedValue>();
+  value->caches = blockCaches_;
   auto status = handles->db->Get(
       ReadOptions(),
       handles->columns[keySpace->index].get(),
       _createSlice(key),
-      &value);
+      &value->slice);
   if (!status.ok()) {
     if (status.IsNotFound()) {
+      logAccess(keySpace, key, /*hit=*/false);
       // Return an empty StoreResult
       return StoreResult::missing(keySpace, key);
     }
@@ -393,7 +654,48 @@ StoreResult RocksDbLocalStore::get(KeySpace keySpace, ByteRange key) const {
     throw RocksException::build(
         status, "failed to get ", folly::hexlify(key), " from local store");
   }
-  return StoreResult(std::move(value));
+  recordAccess(keySpace, key);
+  logAccess(keySpace, key, /*hit=*/true);
+  return makePinnedResult(std::move(value));
+}
+
+void RocksDbLocalStore::recordAccess(KeySpace keySpace, ByteRange key) const {
+  if (auto& filter = accessFilters_[keySpace->index]) {
+    filter->record(key);
+  }
+}
+
+void RocksDbLocalStore::logAccess(KeySpace keySpace, ByteRange key, bool hit)
+    const {
+  if (accessLog_) {
+    accessLog_->record(keySpace, key, hit);
+  }
+}
+
+AbsolutePath RocksDbLocalStore::getAccessLogPath(
+    AbsolutePathPiece pathToRocksDb) {
+  // RocksDB ignores the files of its directory it doesn't know about.
+  return pathToRocksDb + "eden-access-log"_pc;
+}
+
+void RocksDbLocalStore::forEach(
+    KeySpace keySpace,
+    folly::FunctionRef<void(folly::ByteRange key, folly::ByteRange value)> fn)
+    const {
+  auto handles = getHandles();
+  ReadOptions options;
+  // A full scan would otherwise evict the working set from the block cache.
+  options.fill_cache = false;
+  std::unique_ptr<rocksdb::Iterator> it{handles->db->NewIterator(
+      options, handles->columns[keySpace->index].get())};
+  for (it->SeekToFirst(); it->Valid(); it->Next()) {
+    auto key = it->key();
+    auto value = it->value();
+    fn(folly::StringPiece{key.data(), key.size()},
+       folly::StringPiece{value.data(), value.size()});
+  }
+  RocksException::check(
+      it->status(), "failed to iterate over ", keySpace->name);
 }
 
 FOLLY_NODISCARD folly::Future<StoreResult> RocksDbLocalStore::getFuture(
@@ -418,6 +720,67 @@ FOLLY_NODISCARD folly::Future<StoreResult> RocksDbLocalStore::getFuture(
       });
 }
 
+std::vector<StoreResult> RocksDbLocalStore::multiGet(
+    KeySpace keySpace,
+    const std::vector<std::string>& keys) const {
+  auto handles = getHandles();
+  std::vector<Slice> keySlices;
+  keySlices.reserve(keys.size());
+  for (auto& key : keys) {
+    keySlices.emplace_back(key);
+  }
+  std::vector<rocksdb::PinnableSlice> values(keys.size());
+  std::vector<rocksdb::Status> statuses(keys.size());
+
+  // The batched form of MultiGet, unlike the one taking a column family per
+  // key, looks up all the keys of a column family together, coalescing the
+  // block reads and, where supported, issuing them asynchronously.
+  ReadOptions options;
+#if ROCKSDB_MAJOR >= 7
+  options.async_io = true;
+#endif
+  handles->db->MultiGet(
+      options,
+      handles->columns[keySpace->index].get(),
+      keySlices.size(),
+      keySlices.data(),
+      values.data(),
+      statuses.data());
+
+  std::vector<StoreResult> results;
+  results.reserve(keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    auto& status = statuses[i];
+    if (!status.ok()) {
+      if (status.IsNotFound()) {
+        logAccess(keySpace, folly::StringPiece{keys[i]}, /*hit=*/false);
+        // Return an empty StoreResult
+        results.push_back(StoreResult::missing(
+            keySpace, folly::ByteRange{folly::StringPiece{keys[i]}}));
+        continue;
+      }
+
+      // TODO: RocksDB can return a "TryAgain" error.
+      // Should we try again for the user, rather than
+      // re-throwing the error?
+
+      // We don't use RocksException::check(), since we don't
+      // want to waste our time computing the hex string of the
+      // key if we succeeded.
+      throw RocksException::build(
+          status,
+          "failed to get ",
+          folly::hexlify(keys[i]),
+          " from local store");
+    }
+    recordAccess(keySpace, folly::StringPiece{keys[i]});
+    logAccess(keySpace, folly::StringPiece{keys[i]}, /*hit=*/true);
+    results.push_back(makePinnedResult(std::make_unique<PinnedValue>(
+        PinnedValue{std::move(values[i]), blockCaches_})));
+  }
+  return results;
+}
+
 FOLLY_NODISCARD folly::Future<std::vector<StoreResult>>
 RocksDbLocalStore::getBatch(
     KeySpace keySpace,
@@ -443,45 +806,7 @@ RocksDbLocalStore::getBatch(
                         keySpace,
                         keys = std::move(batch)](folly::Unit&&) {
               XLOG(DBG3) << __func__ << " starting to actually do work";
-              auto handles = store->getHandles();
-              std::vector<Slice> keySlices;
-              std::vector<std::string> values;
-              std::vector<rocksdb::ColumnFamilyHandle*> columns;
-              for (auto& key : *keys) {
-                keySlices.emplace_back(key);
-                columns.emplace_back(handles->columns[keySpace->index].get());
-              }
-              auto statuses = handles->db->MultiGet(
-                  ReadOptions(), columns, keySlices, &values);
-
-              std::vector<StoreResult> results;
-              for (size_t i = 0; i < keys->size(); ++i) {
-                auto& status = statuses[i];
-                if (!status.ok()) {
-                  if (status.IsNotFound()) {
-                    // Return an empty StoreResult
-                    results.push_back(StoreResult::missing(
-                        keySpace,
-                        folly::ByteRange{folly::StringPiece{keys->at(i)}}));
-                    continue;
-                  }
-
-                  // TODO: RocksDB can return a "TryAgain" error.
-                  // Should we try again for the user, rather than
-                  // re-throwing the error?
-
-                  // We don't use RocksException::check(), since we don't
-                  // want to waste our time computing the hex string of the
-                  // key if we succeeded.
-                  throw RocksException::build(
-                      status,
-                      "failed to get ",
-                      folly::hexlify(keys->at(i)),
-                      " from local store");
-                }
-                results.emplace_back(std::move(values[i]));
-              }
-              return results;
+              return store->multiGet(keySpace, *keys);
             }));
   }
 
@@ -539,6 +864,18 @@ void RocksDbLocalStore::put(
       _createSlice(value));
 }
 
+std::string RocksDbLocalStore::describeOptions(KeySpace keySpace) const {
+  auto handles = getHandles();
+  auto options =
+      handles->db->GetOptions(handles->columns[keySpace->index].get());
+  std::string description;
+  auto status = rocksdb::GetStringFromColumnFamilyOptions(
+      &description, rocksdb::ColumnFamilyOptions{options}, "\n  ");
+  RocksException::check(
+      status, "unable to describe the options of ", keySpace->name);
+  return description;
+}
+
 uint64_t RocksDbLocalStore::getApproximateSize(KeySpace keySpace) const {
   auto handles = getHandles();
   uint64_t size = 0;
@@ -624,8 +961,14 @@ RocksDbLocalStore::SizeSummary RocksDbLocalStore::computeStats(
     if (auto* ephemeral = std::get_if<Ephemeral>(&ks->persistence)) {
       result.ephemeral += size;
       if (config) {
-        if (size > (config->*(ephemeral->cacheLimit)).getValue()) {
+        auto limit = (config->*(ephemeral->cacheLimit)).getValue();
+        if (size > limit) {
           result.excessiveKeySpaces.set(ks->index);
+          auto target = static_cast<uint64_t>(
+              limit * config->localStoreAutoGCTargetRatio.getValue());
+          result.excessBytes[ks->index] = std::min(
+              size - std::min(size, target),
+              config->localStoreAutoGCMaxBytesPerRun.getValue());
         }
       }
     } else if (!ks->isDeprecated()) {
@@ -671,27 +1014,126 @@ void RocksDbLocalStore::triggerAutoGC(SizeSummary before) {
     state->inProgress_ = true;
   }
 
+  // Rather than clearing the excessive key spaces, which would turn every
+  // access into a backing store import, evict the objects that weren't read
+  // recently, a bounded amount per management interval.
   ioPool_.add([store = getSharedFromThis(), before] {
+    uint64_t reclaimed = 0;
     try {
       for (auto& ks : KeySpace::kAll) {
         if (before.excessiveKeySpaces.test(ks->index)) {
-          store->clearKeySpace(ks);
-          store->compactKeySpace(ks);
+          auto evicted =
+              store->evictColdKeys(ks, before.excessBytes[ks->index]);
+          XLOG(INFO) << "automatic local store garbage collection evicted "
+                     << evicted << " bytes from " << ks->name;
+          reclaimed += evicted;
         }
       }
     } catch (const std::exception& ex) {
       XLOG(ERR) << "error during automatic local store garbage collection: "
                 << folly::exceptionStr(ex);
-      store->autoGCFinished(/*successful=*/false, before.ephemeral);
+      store->autoGCFinished(
+          /*successful=*/false, before.ephemeral, reclaimed);
       return;
     }
-    store->autoGCFinished(/*successful=*/true, before.ephemeral);
+    store->autoGCFinished(/*successful=*/true, before.ephemeral, reclaimed);
   });
 }
 
+uint64_t RocksDbLocalStore::evictColdKeys(
+    KeySpace keySpace,
+    uint64_t bytesToReclaim) {
+  auto& filter = accessFilters_[keySpace->index];
+  if (!filter) {
+    throw std::invalid_argument(folly::to<string>(
+        "cannot evict from the persistent key space ", keySpace->name));
+  }
+
+  if (bytesToReclaim == 0) {
+    return 0;
+  }
+
+  auto handles = getHandles();
+  auto* column = handles->columns[keySpace->index].get();
+  auto cursors = evictionCursors_.wlock();
+  auto& cursor = (*cursors)[keySpace->index];
+
+  rocksdb::WriteBatch batch;
+  auto flush = [&] {
+    if (batch.Count() > 0) {
+      RocksException::check(
+          handles->db->Write(WriteOptions(), &batch),
+          "failed to evict from ",
+          keySpace->name);
+      batch.Clear();
+    }
+  };
+  // Compact the range the hand swept over, so that the deleted objects
+  // actually free their space and aren't counted by the next run.
+  auto compact = [&](const std::string& begin, const std::string* end) {
+    flush();
+    Slice beginSlice{begin};
+    Slice endSlice = end ? Slice{*end} : Slice{};
+    RocksException::check(
+        handles->db->CompactRange(
+            rocksdb::CompactRangeOptions{},
+            column,
+            &beginSlice,
+            end ? &endSlice : nullptr),
+        "failed to compact ",
+        keySpace->name);
+  };
+
+  std::unique_ptr<rocksdb::Iterator> it{
+      handles->db->NewIterator(ReadOptions(), column)};
+  auto rangeBegin = cursor;
+  it->Seek(rangeBegin);
+  uint64_t reclaimed = 0;
+  bool wrapped = false;
+  while (reclaimed < bytesToReclaim) {
+    if (!it->Valid()) {
+      RocksException::check(
+          it->status(), "failed to iterate over ", keySpace->name);
+      compact(rangeBegin, nullptr);
+      if (wrapped) {
+        // Every object was read since the hand last passed it.
+        break;
+      }
+      // The hand completed a sweep: objects only read before the previous
+      // one are now eligible for eviction.
+      wrapped = true;
+      filter->age();
+      rangeBegin.clear();
+      it->SeekToFirst();
+      continue;
+    }
+
+    auto key = it->key();
+    if (!filter->recentlyAccessed(
+            ByteRange{folly::StringPiece{key.data(), key.size()}})) {
+      batch.Delete(column, key);
+      reclaimed += key.size() + it->value().size();
+      if (batch.GetDataSize() >= kEvictionBatchBytes) {
+        flush();
+      }
+    }
+    it->Next();
+  }
+
+  cursor = it->Valid() ? it->key().ToString() : std::string{};
+  if (it->Valid()) {
+    compact(rangeBegin, &cursor);
+  } else if (reclaimed >= bytesToReclaim) {
+    // The hand stopped right at the end of the key space.
+    compact(rangeBegin, nullptr);
+  }
+  return reclaimed;
+}
+
 void RocksDbLocalStore::autoGCFinished(
     bool successful,
-    uint64_t ephemeralSizeBefore) {
+    uint64_t ephemeralSizeBefore,
+    uint64_t reclaimed) {
   auto ephemeralSizeAfter =
       computeStats(/*publish=*/false, /*config=*/nullptr).ephemeral;
 
@@ -708,7 +1150,8 @@ void RocksDbLocalStore::autoGCFinished(
       duration_cast<std::chrono::duration<double>>(duration).count(),
       successful,
       static_cast<int64_t>(ephemeralSizeBefore),
-      static_cast<int64_t>(ephemeralSizeAfter)});
+      static_cast<int64_t>(ephemeralSizeAfter),
+      static_cast<int64_t>(reclaimed)});
 
   fb303::fbData->setCounter(
       folly::to<string>(statsPrefix_, "auto_gc.running"), 0);
@@ -719,6 +1162,11 @@ void RocksDbLocalStore::autoGCFinished(
       successful ? 1 : 0);
   fb303::fbData->setCounter(
       folly::to<string>(statsPrefix_, "auto_gc.last_duration_ms"), durationMS);
+  fb303::fbData->setCounter(
+      folly::to<string>(statsPrefix_, "auto_gc.last_reclaimed_bytes"),
+      reclaimed);
+  fb303::fbData->incrementCounter(
+      folly::to<string>(statsPrefix_, "auto_gc.reclaimed_bytes"), reclaimed);
 
   if (successful) {
     fb303::fbData->incrementCounter(
@@ -8,8 +8,11 @@
 #pragma once
 
 #include <folly/CppAttributes.h>
+#include <folly/Function.h>
 #include <folly/Synchronized.h>
+#include <array>
 #include <bitset>
+#include <optional>
 
 #include "eden/fs/rocksdb/RocksHandles.h"
 #include "eden/fs/store/LocalStore.h"
@@ -18,7 +21,34 @@
 namespace facebook::eden {
 
 class FaultInjector;
+class LocalStoreAccessLog;
 class StructuredLogger;
+struct RocksDbBlockCaches;
+
+/**
+ * How the column family of a key space is tuned, according to the size of
+ * its values and how they are accessed.
+ */
+enum class RocksDbProfile {
+  /**
+   * Small values read with point lookups, such as proxy hashes and metadata:
+   * small uncompressed blocks with a hash index, and bloom filters.
+   */
+  PointLookup,
+  /**
+   * Medium-sized values: compressed blocks with partitioned index and
+   * filters, so that only the partitions in use take up the block cache.
+   */
+  Tree,
+  /**
+   * Large, read-mostly values: large compressed blocks in their own block
+   * cache, optionally stored in blob files.
+   */
+  Blob,
+};
+
+folly::StringPiece rocksDbProfileName(RocksDbProfile profile);
+std::optional<RocksDbProfile> parseRocksDbProfile(folly::StringPiece name);
 
 /** An implementation of LocalStore that uses RocksDB for the underlying
  * storage.
@@ -33,6 +63,7 @@ class RocksDbLocalStore : public LocalStore {
       AbsolutePathPiece pathToRocksDb,
       std::shared_ptr<StructuredLogger> structuredLogger,
       FaultInjector* FOLLY_NONNULL faultInjector,
+      const EdenConfig& config,
       RocksDBOpenMode mode = RocksDBOpenMode::ReadWrite);
   ~RocksDbLocalStore();
   void close() override;
@@ -51,15 +82,52 @@ class RocksDbLocalStore : public LocalStore {
   std::unique_ptr<WriteBatch> beginWrite(size_t bufSize = 0) override;
 
   // Call RocksDB's RepairDB() function on the DB at the specified location
-  static void repairDB(AbsolutePathPiece path);
+  static void repairDB(AbsolutePathPiece path, const EdenConfig& config);
 
   // Get the approximate number of bytes stored on disk for the
   // specified key space.
   uint64_t getApproximateSize(KeySpace keySpace) const;
 
+  RocksDbProfile getProfile(KeySpace keySpace) const {
+    return profiles_[keySpace->index];
+  }
+
+  // Describe the options RocksDB uses for the column family of the specified
+  // key space.
+  std::string describeOptions(KeySpace keySpace) const;
+
   void periodicManagementTask(const EdenConfig& config) override;
 
+  /**
+   * Delete objects of an ephemeral key space that weren't read recently,
+   * until about bytesToReclaim bytes are deleted or the whole key space was
+   * visited twice, and compact the range that was visited.
+   *
+   * Successive calls resume where the previous one stopped, sweeping over
+   * the key space like the hand of a CLOCK: an object is only deleted if it
+   * wasn't read since the hand last passed it. Returns the number of bytes
+   * deleted.
+   */
+  uint64_t evictColdKeys(KeySpace keySpace, uint64_t bytesToReclaim);
+
+  /**
+   * Call fn with every key and value of the key space, in key order.
+   * The ranges are only valid during the call.
+   */
+  void forEach(
+      KeySpace keySpace,
+      folly::FunctionRef<void(folly::ByteRange key, folly::ByteRange value)>
+          fn) const;
+
+  /**
+   * The access log of a RocksDB local store, written when
+   * store:access-log-sample-denominator is set.
+   */
+  static AbsolutePath getAccessLogPath(AbsolutePathPiece pathToRocksDb);
+
  private:
+  class AccessFilter;
+
   /**
    * Get a pointer to the RocksHandles object in order to perform an I/O
    * operation.
@@ -76,6 +144,25 @@ class RocksDbLocalStore : public LocalStore {
     return handles;
   }
   [[noreturn]] void throwStoreClosedError() const;
+
+  /**
+   * Remember that the key was read, so that the automatic garbage
+   * collection keeps it.
+   */
+  void recordAccess(KeySpace keySpace, folly::ByteRange key) const;
+
+  /**
+   * Log a sample of the reads, hits and misses, to the access log.
+   */
+  void logAccess(KeySpace keySpace, folly::ByteRange key, bool hit) const;
+
+  /**
+   * Look up all the keys of a batch with a single MultiGet call on the
+   * column family of the key space.
+   */
+  std::vector<StoreResult> multiGet(
+      KeySpace keySpace,
+      const std::vector<std::string>& keys) const;
   std::shared_ptr<RocksDbLocalStore> getSharedFromThis() {
     return std::static_pointer_cast<RocksDbLocalStore>(shared_from_this());
   }
@@ -100,9 +187,14 @@ class RocksDbLocalStore : public LocalStore {
     uint64_t persistent = 0;
     /**
      * Which keyspace indices exceed their configured size limit and should be
-     * cleared.
+     * garbage collected.
      */
     std::bitset<KeySpace::kTotalCount> excessiveKeySpaces;
+    /**
+     * How many bytes to evict from each excessive keyspace to bring it back
+     * to the target ratio of its limit.
+     */
+    std::array<uint64_t, KeySpace::kTotalCount> excessBytes{};
   };
 
   /**
@@ -112,13 +204,27 @@ class RocksDbLocalStore : public LocalStore {
   SizeSummary computeStats(bool publish, const EdenConfig* config);
 
   void triggerAutoGC(SizeSummary before);
-  void autoGCFinished(bool successful, uint64_t ephemeralSizeBefore);
+  void autoGCFinished(
+      bool successful,
+      uint64_t ephemeralSizeBefore,
+      uint64_t reclaimed);
 
   std::shared_ptr<StructuredLogger> structuredLogger_;
   const std::string statsPrefix_{"local_store."};
   FaultInjector& faultInjector_;
   mutable UnboundedQueueExecutor ioPool_;
   folly::Synchronized<AutoGCState> autoGCState_;
+  const std::array<RocksDbProfile, KeySpace::kTotalCount> profiles_;
+  // Shared with the values returned pinned in the caches.
+  const std::shared_ptr<const RocksDbBlockCaches> blockCaches_;
+  // Only allocated for the ephemeral key spaces.
+  std::array<std::unique_ptr<AccessFilter>, KeySpace::kTotalCount>
+      accessFilters_;
+  // Only allocated when store:access-log-sample-denominator is set.
+  std::unique_ptr<LocalStoreAccessLog> accessLog_;
+  // Where evictColdKeys() resumes, for each key space.
+  folly::Synchronized<std::array<std::string, KeySpace::kTotalCount>>
+      evictionCursors_;
   folly::Synchronized<RocksHandles> dbHandles_;
 };
 
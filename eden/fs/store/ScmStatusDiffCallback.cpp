@@ -16,24 +16,25 @@
 
 namespace facebook::eden {
 
+ScmStatusDiffCallback::ScmStatusDiffCallback(
+    size_t batchSize,
+    BatchCallback onBatch)
+    : batchSize_{batchSize}, onBatch_{std::move(onBatch)} {}
+
 void ScmStatusDiffCallback::ignoredFile(RelativePathPiece path) {
-  data_.wlock()->entries_ref()->emplace(
-      path.stringPiece().str(), ScmFileStatus::IGNORED);
+  addEntry(path, ScmFileStatus::IGNORED);
 }
 
 void ScmStatusDiffCallback::addedFile(RelativePathPiece path) {
-  data_.wlock()->entries_ref()->emplace(
-      path.stringPiece().str(), ScmFileStatus::ADDED);
+  addEntry(path, ScmFileStatus::ADDED);
 }
 
 void ScmStatusDiffCallback::removedFile(RelativePathPiece path) {
-  data_.wlock()->entries_ref()->emplace(
-      path.stringPiece().str(), ScmFileStatus::REMOVED);
+  addEntry(path, ScmFileStatus::REMOVED);
 }
 
 void ScmStatusDiffCallback::modifiedFile(RelativePathPiece path) {
-  data_.wlock()->entries_ref()->emplace(
-      path.stringPiece().str(), ScmFileStatus::MODIFIED);
+  addEntry(path, ScmFileStatus::MODIFIED);
 }
 
 void ScmStatusDiffCallback::diffError(
@@ -41,8 +42,30 @@ void ScmStatusDiffCallback::diffError(
     const folly::exception_wrapper& ew) {
   XLOG(WARNING) << "error computing status data for " << path << ": "
                 << folly::exceptionStr(ew);
-  data_.wlock()->errors_ref()->emplace(
+  auto data = getShard().data.lock();
+  data->errors_ref()->emplace(
       path.stringPiece().str(), folly::exceptionStr(ew).toStdString());
+  maybeSendBatch(data);
+}
+
+void ScmStatusDiffCallback::addEntry(
+    RelativePathPiece path,
+    ScmFileStatus status) {
+  auto data = getShard().data.lock();
+  data->entries_ref()->emplace(path.stringPiece().str(), status);
+  maybeSendBatch(data);
+}
+
+void ScmStatusDiffCallback::maybeSendBatch(
+    SynchronizedStatus::LockedPtr& data) {
+  if (!onBatch_ ||
+      data->entries_ref()->size() + data->errors_ref()->size() < batchSize_) {
+    return;
+  }
+  auto batch = std::move(*data);
+  *data = ScmStatus{};
+  data.unlock();
+  onBatch_(std::move(batch));
 }
 
 /**
@@ -53,8 +76,28 @@ void ScmStatusDiffCallback::diffError(
  * the diff operation has completed.
  */
 ScmStatus ScmStatusDiffCallback::extractStatus() {
-  auto data = data_.wlock();
-  return std::move(*data);
+  ScmStatus status;
+  for (auto& shard : shards_) {
+    auto data = shard.data.lock();
+    status.entries_ref()->merge(*data->entries_ref());
+    status.errors_ref()->merge(*data->errors_ref());
+    *data = ScmStatus{};
+  }
+  return status;
+}
+
+void ScmStatusDiffCallback::flush() {
+  XCHECK(onBatch_) << "flush() requires a batch callback";
+  for (auto& shard : shards_) {
+    auto data = shard.data.lock();
+    if (data->entries_ref()->empty() && data->errors_ref()->empty()) {
+      continue;
+    }
+    auto batch = std::move(*data);
+    *data = ScmStatus{};
+    data.unlock();
+    onBatch_(std::move(batch));
+  }
 }
 
 char scmStatusCodeChar(ScmFileStatus code) {
@@ -6,9 +6,13 @@
  */
 
 #pragma once
+#include <array>
+#include <functional>
 #include <iosfwd>
+#include <mutex>
 
 #include <folly/Synchronized.h>
+#include <folly/concurrency/CacheLocality.h>
 
 #include "eden/fs/model/Hash.h"
 #include "eden/fs/service/gen-cpp2/eden_types.h"
@@ -22,8 +26,30 @@ class Future;
 
 namespace facebook::eden {
 
+/**
+ * Accumulates the differences reported by a diff into an ScmStatus.
+ *
+ * The diff reports differences from many threads at once, so they are
+ * accumulated in per-CPU shards, whose locks are normally only taken by the
+ * thread running on that CPU, and merged once the diff has completed.
+ */
 class ScmStatusDiffCallback : public DiffCallback {
  public:
+  using BatchCallback = std::function<void(ScmStatus&&)>;
+
+  ScmStatusDiffCallback() = default;
+
+  /**
+   * Rather than accumulating the whole status, hand the differences over to
+   * onBatch as soon as batchSize of them accumulated in a shard, so that
+   * they can be streamed out while the diff is still running.
+   *
+   * onBatch may be called concurrently from several threads. The
+   * differences left in the shards when the diff completes are handed over
+   * by flush().
+   */
+  ScmStatusDiffCallback(size_t batchSize, BatchCallback onBatch);
+
   void ignoredFile(RelativePathPiece path) override;
   void addedFile(RelativePathPiece path) override;
   void removedFile(RelativePathPiece path) override;
@@ -41,8 +67,35 @@ class ScmStatusDiffCallback : public DiffCallback {
    */
   ScmStatus extractStatus();
 
+  /**
+   * Hand the differences that are not part of a batch yet to onBatch. It
+   * should only be invoked after the diff operation has completed.
+   */
+  void flush();
+
  private:
-  folly::Synchronized<ScmStatus> data_;
+  static constexpr size_t kNumShards = 16;
+
+  using SynchronizedStatus = folly::Synchronized<ScmStatus, std::mutex>;
+
+  struct alignas(folly::hardware_destructive_interference_size) Shard {
+    SynchronizedStatus data;
+  };
+
+  void addEntry(RelativePathPiece path, ScmFileStatus status);
+
+  /**
+   * Hand over the differences of the shard if they make up a whole batch.
+   */
+  void maybeSendBatch(SynchronizedStatus::LockedPtr& data);
+
+  Shard& getShard() {
+    return shards_[folly::AccessSpreader<>::current(kNumShards)];
+  }
+
+  const size_t batchSize_{0};
+  const BatchCallback onBatch_;
+  std::array<Shard, kNumShards> shards_;
 };
 
 /**
@@ -11,6 +11,7 @@
 #include <folly/container/Array.h>
 #include <folly/logging/xlog.h>
 
+#include "eden/fs/sqlite/PersistentSqliteStatement.h"
 #include "eden/fs/sqlite/SqliteStatement.h"
 #include "eden/fs/store/StoreResult.h"
 
@@ -22,6 +23,10 @@ using std::string;
 
 namespace {
 
+// Number of connections reading concurrently, in addition to the one used for
+// writes.
+constexpr size_t kNumReadConnections = 8;
+
 /**
  * Implements the write batching helper.
  * In an ideal world, we'd just start a transaction and have the WriteBatch
@@ -100,6 +105,20 @@ class SqliteWriteBatch : public LocalStore::WriteBatch {
 
 } // namespace
 
+struct SqliteLocalStore::ReadStatementCache {
+  explicit ReadStatementCache(SqliteDatabase::Connection& db) {
+    get.reserve(KeySpace::kTotalCount);
+    hasKey.reserve(KeySpace::kTotalCount);
+    for (const auto& ks : KeySpace::kAll) {
+      get.emplace_back(db, "select value from ", ks->name, " where key = ?");
+      hasKey.emplace_back(db, "select 1 from ", ks->name, " where key = ?");
+    }
+  }
+
+  std::vector<PersistentSqliteStatement> get;
+  std::vector<PersistentSqliteStatement> hasKey;
+};
+
 SqliteLocalStore::SqliteLocalStore(AbsolutePathPiece pathToDb)
     : db_(SqliteDatabase(pathToDb)) {
   {
@@ -124,9 +143,20 @@ SqliteLocalStore::SqliteLocalStore(AbsolutePathPiece pathToDb)
   }
 
   clearDeprecatedKeySpaces();
+
+  db_.openReadConnections(kNumReadConnections);
+  readCaches_.resize(kNumReadConnections);
+}
+
+// We must define the destructor here because of incomplete definition of
+// `ReadStatementCache`
+SqliteLocalStore::~SqliteLocalStore() {
+  close();
 }
 
 void SqliteLocalStore::close() {
+  // The cached statements must be destroyed before their connections.
+  readCaches_.clear();
   db_.close();
 }
 
@@ -140,17 +170,20 @@ void SqliteLocalStore::clearKeySpace(KeySpace keySpace) {
 void SqliteLocalStore::compactKeySpace(KeySpace) {}
 
 StoreResult SqliteLocalStore::get(KeySpace keySpace, ByteRange key) const {
-  auto db = db_.lock();
-
-  SqliteStatement stmt(
-      db, "select value from ", keySpace->name, " where key = ?");
+  auto reader = db_.lockForRead();
+  auto& stmt = getReadStatements(reader).get[keySpace->index].get(
+      reader.connection);
 
   // Bind the key; parameters are 1-based
   stmt.bind(1, key);
 
   if (stmt.step()) {
     // Return the result; columns are 0-based!
-    return StoreResult(stmt.columnBlob(0).str());
+    auto result = StoreResult(stmt.columnBlob(0).str());
+    // Finish the statement, otherwise the connection would keep reading its
+    // current snapshot of the database.
+    stmt.reset();
+    return result;
   }
 
   // the key does not exist
@@ -158,12 +191,24 @@ StoreResult SqliteLocalStore::get(KeySpace keySpace, ByteRange key) const {
 }
 
 bool SqliteLocalStore::hasKey(KeySpace keySpace, ByteRange key) const {
-  auto db = db_.lock();
-
-  SqliteStatement stmt(db, "select 1 from ", keySpace->name, " where key = ?");
+  auto reader = db_.lockForRead();
+  auto& stmt = getReadStatements(reader).hasKey[keySpace->index].get(
+      reader.connection);
 
   stmt.bind(1, key);
-  return stmt.step();
+  auto found = stmt.step();
+  stmt.reset();
+  return found;
+}
+
+SqliteLocalStore::ReadStatementCache& SqliteLocalStore::getReadStatements(
+    SqliteDatabase::ReadConnection& reader) const {
+  // Each slot is only accessed while holding the lock of its connection.
+  auto& readCache = readCaches_[reader.index];
+  if (!readCache) {
+    readCache = std::make_unique<ReadStatementCache>(reader.connection);
+  }
+  return *readCache;
 }
 
 void SqliteLocalStore::put(KeySpace keySpace, ByteRange key, ByteRange value) {
@@ -7,6 +7,8 @@
 
 #pragma once
 #include <folly/Synchronized.h>
+#include <memory>
+#include <vector>
 #include "eden/fs/sqlite/SqliteDatabase.h"
 #include "eden/fs/store/LocalStore.h"
 
@@ -19,6 +21,7 @@ namespace facebook::eden {
 class SqliteLocalStore : public LocalStore {
  public:
   explicit SqliteLocalStore(AbsolutePathPiece pathToDb);
+  ~SqliteLocalStore() override;
   void close() override;
   void clearKeySpace(KeySpace keySpace) override;
   void compactKeySpace(KeySpace keySpace) override;
@@ -30,7 +33,20 @@ class SqliteLocalStore : public LocalStore {
       size_t bufSize = 0) override;
 
  private:
+  struct ReadStatementCache;
+
+  /**
+   * Return the cached statements of the given read connection, preparing
+   * them on first use.
+   */
+  ReadStatementCache& getReadStatements(
+      SqliteDatabase::ReadConnection& reader) const;
+
   mutable SqliteDatabase db_;
+
+  // Statements of each read connection of `db_`. Reads go through these
+  // connections, so that they don't contend with each other or with writes.
+  mutable std::vector<std::unique_ptr<ReadStatementCache>> readCaches_;
 };
 
 } // namespace facebook::eden
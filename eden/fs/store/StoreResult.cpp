@@ -31,16 +31,38 @@ StoreResult StoreResult::missing(KeySpace keySpace, folly::ByteRange key) {
           keySpace->name)};
 }
 
+StoreResult::StoreResult(IOBuf data) : valid_{true} {
+  data.makeManaged();
+  data.coalesce();
+  buf_ = std::move(data);
+}
+
 IOBuf StoreResult::iobufWrapper() const {
   ensureValid();
   return IOBuf{IOBuf::WRAP_BUFFER, bytes()};
 }
 
+std::string StoreResult::extractValue() {
+  ensureValid();
+  valid_ = false;
+  if (buf_) {
+    auto value = folly::StringPiece{buf_->data(), buf_->length()}.str();
+    buf_.reset();
+    return value;
+  }
+  return std::move(data_);
+}
+
 folly::IOBuf StoreResult::extractIOBuf() {
   ensureValid();
 
-  // Unfortunately RocksDB returns data to us in a std::string.  This makes it
-  // difficult for us to control the lifetime.  We end up having to allocate a
+  if (buf_) {
+    valid_ = false;
+    return *std::exchange(buf_, std::nullopt);
+  }
+
+  // A std::string makes it difficult for us to control the lifetime of its
+  // data.  We end up having to allocate a
   // new std::string on the heap, just to control when it will free the
   // underlying data it points to.
   auto stringPtr = std::make_unique<std::string>(std::move(data_));
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/TieredLocalStore.h"
+
+#include <folly/futures/Future.h>
+#include <algorithm>
+
+#include "eden/fs/config/EdenConfig.h"
+#include "eden/fs/store/StoreResult.h"
+
+namespace facebook::eden {
+
+namespace {
+std::string toString(folly::ByteRange bytes) {
+  return std::string{folly::StringPiece{bytes}};
+}
+} // namespace
+
+/**
+ * Forwards its puts to a write batch of the underlying store, and adds the
+ * values of the cached key spaces to the cache once that batch is flushed.
+ */
+class TieredLocalStore::Batch : public LocalStore::WriteBatch {
+ public:
+  Batch(TieredLocalStore& store, size_t bufSize)
+      : store_{store}, batch_{store.store_->beginWrite(bufSize)} {}
+
+  void put(KeySpace keySpace, folly::ByteRange key, folly::ByteRange value)
+      override {
+    batch_->put(keySpace, key, value);
+    if (store_.isCached(keySpace)) {
+      cached_.push_back(Entry{keySpace, toString(key), toString(value)});
+    }
+  }
+
+  void put(
+      KeySpace keySpace,
+      folly::ByteRange key,
+      std::vector<folly::ByteRange> valueSlices) override {
+    if (store_.isCached(keySpace)) {
+      std::string value;
+      for (auto slice : valueSlices) {
+        value.append(
+            reinterpret_cast<const char*>(slice.data()), slice.size());
+      }
+      cached_.push_back(Entry{keySpace, toString(key), std::move(value)});
+    }
+    batch_->put(keySpace, key, std::move(valueSlices));
+  }
+
+  void flush() override {
+    batch_->flush();
+    if (cached_.empty()) {
+      return;
+    }
+    auto cacheBatch = store_.cache_->beginWrite();
+    for (auto& entry : cached_) {
+      cacheBatch->put(
+          entry.keySpace,
+          folly::StringPiece{entry.key},
+          folly::StringPiece{entry.value});
+    }
+    cacheBatch->flush();
+    cached_.clear();
+  }
+
+ private:
+  struct Entry {
+    KeySpace keySpace;
+    std::string key;
+    std::string value;
+  };
+
+  TieredLocalStore& store_;
+  std::unique_ptr<LocalStore::WriteBatch> batch_;
+  std::vector<Entry> cached_;
+};
+
+TieredLocalStore::TieredLocalStore(
+    std::shared_ptr<LocalStore> store,
+    const EdenConfig& config)
+    : store_{std::move(store)}, cache_{std::make_shared<MemoryLocalStore>()} {
+  enableBlobCaching.store(
+      config.enableBlobCaching.getValue(), std::memory_order_relaxed);
+  updateCacheLimits(config);
+}
+
+void TieredLocalStore::close() {
+  store_->close();
+}
+
+void TieredLocalStore::clearKeySpace(KeySpace keySpace) {
+  store_->clearKeySpace(keySpace);
+  cache_->clearKeySpace(keySpace);
+}
+
+void TieredLocalStore::compactKeySpace(KeySpace keySpace) {
+  store_->compactKeySpace(keySpace);
+}
+
+StoreResult TieredLocalStore::get(KeySpace keySpace, folly::ByteRange key)
+    const {
+  if (!isCached(keySpace)) {
+    return store_->get(keySpace, key);
+  }
+  auto result = cache_->get(keySpace, key);
+  if (result.isValid()) {
+    return result;
+  }
+  result = store_->get(keySpace, key);
+  if (result.isValid()) {
+    cache_->put(keySpace, key, result.bytes());
+  }
+  return result;
+}
+
+folly::Future<StoreResult> TieredLocalStore::getFuture(
+    KeySpace keySpace,
+    folly::ByteRange key) const {
+  if (!isCached(keySpace)) {
+    return store_->getFuture(keySpace, key);
+  }
+  auto result = cache_->get(keySpace, key);
+  if (result.isValid()) {
+    return folly::makeFuture(std::move(result));
+  }
+  return store_->getFuture(keySpace, key)
+      .thenValue([cache = cache_, keySpace, key = toString(key)](
+                     StoreResult&& stored) {
+        if (stored.isValid()) {
+          cache->put(keySpace, folly::StringPiece{key}, stored.bytes());
+        }
+        return std::move(stored);
+      });
+}
+
+folly::Future<std::vector<StoreResult>> TieredLocalStore::getBatch(
+    KeySpace keySpace,
+    const std::vector<folly::ByteRange>& keys) const {
+  if (!isCached(keySpace)) {
+    return store_->getBatch(keySpace, keys);
+  }
+
+  // The cache is in memory, so its batch is ready right away.
+  auto cached = cache_->getBatch(keySpace, keys).get();
+  std::vector<std::optional<StoreResult>> results;
+  results.reserve(keys.size());
+  std::vector<folly::ByteRange> missingKeys;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (cached[i].isValid()) {
+      results.emplace_back(std::move(cached[i]));
+    } else {
+      results.emplace_back(std::nullopt);
+      missingKeys.push_back(keys[i]);
+    }
+  }
+  if (missingKeys.empty()) {
+    std::vector<StoreResult> found;
+    found.reserve(results.size());
+    for (auto& result : results) {
+      found.push_back(std::move(*result));
+    }
+    return folly::makeFuture(std::move(found));
+  }
+
+  std::vector<std::string> missing;
+  missing.reserve(missingKeys.size());
+  for (auto key : missingKeys) {
+    missing.push_back(toString(key));
+  }
+  return store_->getBatch(keySpace, missingKeys)
+      .thenValue([cache = cache_,
+                  keySpace,
+                  missing = std::move(missing),
+                  results = std::move(results)](
+                     std::vector<StoreResult>&& stored) mutable {
+        auto cacheBatch = cache->beginWrite();
+        for (size_t i = 0; i < stored.size(); ++i) {
+          if (stored[i].isValid()) {
+            cacheBatch->put(
+                keySpace, folly::StringPiece{missing[i]}, stored[i].bytes());
+          }
+        }
+        cacheBatch->flush();
+
+        std::vector<StoreResult> merged;
+        merged.reserve(results.size());
+        auto next = stored.begin();
+        for (auto& result : results) {
+          merged.push_back(result ? std::move(*result) : std::move(*next++));
+        }
+        return merged;
+      });
+}
+
+bool TieredLocalStore::hasKey(KeySpace keySpace, folly::ByteRange key) const {
+  if (isCached(keySpace) && cache_->hasKey(keySpace, key)) {
+    return true;
+  }
+  return store_->hasKey(keySpace, key);
+}
+
+void TieredLocalStore::put(
+    KeySpace keySpace,
+    folly::ByteRange key,
+    folly::ByteRange value) {
+  store_->put(keySpace, key, value);
+  if (isCached(keySpace)) {
+    cache_->put(keySpace, key, value);
+  }
+}
+
+std::unique_ptr<LocalStore::WriteBatch> TieredLocalStore::beginWrite(
+    size_t bufSize) {
+  return std::make_unique<Batch>(*this, bufSize);
+}
+
+void TieredLocalStore::periodicManagementTask(const EdenConfig& config) {
+  enableBlobCaching.store(
+      config.enableBlobCaching.getValue(), std::memory_order_relaxed);
+  updateCacheLimits(config);
+  store_->periodicManagementTask(config);
+}
+
+void TieredLocalStore::updateCacheLimits(const EdenConfig& config) {
+  auto cacheSize = config.localStoreL1CacheSize.getValue();
+  const auto& names = config.localStoreL1CacheKeySpaces.getValue();
+  for (auto& ks : KeySpace::kAll) {
+    bool cached = cacheSize > 0 && !ks->isDeprecated() &&
+        std::find(names.begin(), names.end(), ks->name) != names.end();
+    cache_->setSizeLimit(ks, cached ? cacheSize : 0);
+    if (!cached_[ks->index].exchange(cached, std::memory_order_relaxed) ||
+        cached) {
+      continue;
+    }
+    // Free the values of a key space no longer cached. They would be
+    // missing the puts made in the meantime if it were cached again.
+    cache_->clearKeySpace(ks);
+  }
+}
+
+} // namespace facebook::eden
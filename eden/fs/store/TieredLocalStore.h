@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+
+#include "eden/fs/store/LocalStore.h"
+#include "eden/fs/store/MemoryLocalStore.h"
+
+namespace facebook::eden {
+
+/**
+ * A LocalStore that caches the values of some key spaces of another
+ * LocalStore in memory, so that frequent point reads, such as those of
+ * blob metadata and proxy hashes, don't go to disk.
+ *
+ * Writes go to both the cache and the underlying store. Values read from the
+ * underlying store are added to the cache, which evicts the least recently
+ * used values of a key space past store:l1-cache-size. This assumes a key is
+ * never put with a different value, as the keys are hashes of the values or
+ * of the objects they describe.
+ */
+class TieredLocalStore : public LocalStore {
+ public:
+  TieredLocalStore(std::shared_ptr<LocalStore> store, const EdenConfig& config);
+
+  void close() override;
+  void clearKeySpace(KeySpace keySpace) override;
+  void compactKeySpace(KeySpace keySpace) override;
+  StoreResult get(KeySpace keySpace, folly::ByteRange key) const override;
+  FOLLY_NODISCARD folly::Future<StoreResult> getFuture(
+      KeySpace keySpace,
+      folly::ByteRange key) const override;
+  FOLLY_NODISCARD folly::Future<std::vector<StoreResult>> getBatch(
+      KeySpace keySpace,
+      const std::vector<folly::ByteRange>& keys) const override;
+  bool hasKey(KeySpace keySpace, folly::ByteRange key) const override;
+  void put(KeySpace keySpace, folly::ByteRange key, folly::ByteRange value)
+      override;
+  std::unique_ptr<WriteBatch> beginWrite(size_t bufSize = 0) override;
+  void periodicManagementTask(const EdenConfig& config) override;
+
+  /**
+   * The total size of the keys and values of the key space held in memory.
+   */
+  uint64_t getCachedSize(KeySpace keySpace) const {
+    return cache_->getApproximateSize(keySpace);
+  }
+
+ private:
+  class Batch;
+
+  bool isCached(KeySpace keySpace) const {
+    return cached_[keySpace->index].load(std::memory_order_relaxed);
+  }
+
+  /**
+   * Apply the cache size and the cached key spaces of the config, dropping
+   * the cached values of the key spaces no longer cached.
+   */
+  void updateCacheLimits(const EdenConfig& config);
+
+  const std::shared_ptr<LocalStore> store_;
+  // Shared with the continuations of the reads from the underlying store,
+  // which fill it.
+  const std::shared_ptr<MemoryLocalStore> cache_;
+  std::array<std::atomic<bool>, KeySpace::kTotalCount> cached_{};
+};
+
+} // namespace facebook::eden
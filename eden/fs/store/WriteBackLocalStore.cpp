@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/WriteBackLocalStore.h"
+
+#include <folly/futures/Future.h>
+#include <folly/logging/xlog.h>
+#include <utility>
+
+#include "eden/fs/config/EdenConfig.h"
+#include "eden/fs/store/StoreResult.h"
+
+namespace facebook::eden {
+
+namespace {
+// Let the underlying store flush its write batch every few megabytes, so
+// that applying a large backlog doesn't build a single huge batch.
+constexpr size_t kWriteBatchBytes = 4 * 1024 * 1024;
+
+std::string toString(folly::ByteRange bytes) {
+  return std::string{folly::StringPiece{bytes}};
+}
+} // namespace
+
+/**
+ * Accumulates its puts and hands them to the WriteBackLocalStore in one go
+ * when flushed.
+ */
+class WriteBackLocalStore::Batch : public LocalStore::WriteBatch {
+ public:
+  Batch(WriteBackLocalStore& store, size_t bufSize)
+      : store_{store}, bufSize_{bufSize} {}
+
+  ~Batch() override {
+    if (!entries_.empty()) {
+      XLOG(ERR) << "WriteBatch being destroyed with " << entries_.size()
+                << " items pending flush";
+    }
+  }
+
+  void put(KeySpace keySpace, folly::ByteRange key, folly::ByteRange value)
+      override {
+    add(keySpace, key, toString(value));
+  }
+
+  void put(
+      KeySpace keySpace,
+      folly::ByteRange key,
+      std::vector<folly::ByteRange> valueSlices) override {
+    std::string value;
+    for (auto slice : valueSlices) {
+      value.append(reinterpret_cast<const char*>(slice.data()), slice.size());
+    }
+    add(keySpace, key, std::move(value));
+  }
+
+  void flush() override {
+    if (entries_.empty()) {
+      return;
+    }
+    store_.enqueue(std::move(entries_));
+    entries_.clear();
+    bytes_ = 0;
+  }
+
+ private:
+  void add(KeySpace keySpace, folly::ByteRange key, std::string value) {
+    bytes_ += key.size() + value.size();
+    entries_.push_back(Entry{keySpace, toString(key), std::move(value)});
+    if (bufSize_ > 0 && bytes_ >= bufSize_) {
+      flush();
+    }
+  }
+
+  WriteBackLocalStore& store_;
+  const size_t bufSize_;
+  std::vector<Entry> entries_;
+  size_t bytes_{0};
+};
+
+WriteBackLocalStore::WriteBackLocalStore(
+    std::shared_ptr<LocalStore> store,
+    size_t maxPendingBytes)
+    : store_{std::move(store)}, maxPendingBytes_{maxPendingBytes} {
+  writerThread_ = std::thread{[this] { writerThread(); }};
+}
+
+WriteBackLocalStore::~WriteBackLocalStore() {
+  stopWriterThread();
+}
+
+void WriteBackLocalStore::close() {
+  stopWriterThread();
+  store_->close();
+}
+
+void WriteBackLocalStore::flush() {
+  auto state = state_.lock();
+  writtenCondVar_.wait(
+      state.as_lock(), [&] { return state->pendingCount == 0; });
+  if (auto error = std::exchange(state->writeError, {})) {
+    error.throw_exception();
+  }
+}
+
+void WriteBackLocalStore::clearKeySpace(KeySpace keySpace) {
+  flush();
+  store_->clearKeySpace(keySpace);
+}
+
+void WriteBackLocalStore::compactKeySpace(KeySpace keySpace) {
+  store_->compactKeySpace(keySpace);
+}
+
+std::optional<StoreResult> WriteBackLocalStore::getPending(
+    KeySpace keySpace,
+    folly::ByteRange key) const {
+  auto state = state_.lock();
+  const auto& pending = state->pending[keySpace->index];
+  auto it = pending.find(folly::StringPiece{key});
+  if (it == pending.end()) {
+    return std::nullopt;
+  }
+  return StoreResult{*it->second.value};
+}
+
+StoreResult WriteBackLocalStore::get(KeySpace keySpace, folly::ByteRange key)
+    const {
+  if (auto result = getPending(keySpace, key)) {
+    return std::move(*result);
+  }
+  return store_->get(keySpace, key);
+}
+
+folly::Future<StoreResult> WriteBackLocalStore::getFuture(
+    KeySpace keySpace,
+    folly::ByteRange key) const {
+  if (auto result = getPending(keySpace, key)) {
+    return folly::makeFuture(std::move(*result));
+  }
+  return store_->getFuture(keySpace, key);
+}
+
+folly::Future<std::vector<StoreResult>> WriteBackLocalStore::getBatch(
+    KeySpace keySpace,
+    const std::vector<folly::ByteRange>& keys) const {
+  std::vector<std::optional<StoreResult>> results;
+  results.reserve(keys.size());
+  std::vector<folly::ByteRange> missingKeys;
+  for (auto key : keys) {
+    results.push_back(getPending(keySpace, key));
+    if (!results.back()) {
+      missingKeys.push_back(key);
+    }
+  }
+  if (missingKeys.empty()) {
+    std::vector<StoreResult> found;
+    found.reserve(results.size());
+    for (auto& result : results) {
+      found.push_back(std::move(*result));
+    }
+    return folly::makeFuture(std::move(found));
+  }
+
+  return store_->getBatch(keySpace, missingKeys)
+      .thenValue([results = std::move(results)](
+                     std::vector<StoreResult>&& stored) mutable {
+        std::vector<StoreResult> merged;
+        merged.reserve(results.size());
+        auto next = stored.begin();
+        for (auto& result : results) {
+          merged.push_back(result ? std::move(*result) : std::move(*next++));
+        }
+        return merged;
+      });
+}
+
+bool WriteBackLocalStore::hasKey(KeySpace keySpace, folly::ByteRange key)
+    const {
+  {
+    auto state = state_.lock();
+    if (state->pending[keySpace->index].count(folly::StringPiece{key})) {
+      return true;
+    }
+  }
+  return store_->hasKey(keySpace, key);
+}
+
+void WriteBackLocalStore::put(
+    KeySpace keySpace,
+    folly::ByteRange key,
+    folly::ByteRange value) {
+  std::vector<Entry> entries;
+  entries.push_back(Entry{keySpace, toString(key), toString(value)});
+  enqueue(std::move(entries));
+}
+
+std::unique_ptr<LocalStore::WriteBatch> WriteBackLocalStore::beginWrite(
+    size_t bufSize) {
+  return std::make_unique<Batch>(*this, bufSize);
+}
+
+void WriteBackLocalStore::periodicManagementTask(const EdenConfig& config) {
+  enableBlobCaching.store(
+      config.enableBlobCaching.getValue(), std::memory_order_relaxed);
+  store_->periodicManagementTask(config);
+}
+
+void WriteBackLocalStore::enqueue(std::vector<Entry>&& entries) {
+  auto state = state_.lock();
+  // Apply backpressure: let the background thread catch up rather than
+  // buffer without bounds while the underlying store is stalled.
+  writtenCondVar_.wait(state.as_lock(), [&] {
+    return state->pendingBytes < maxPendingBytes_ || state->stopping;
+  });
+  if (state->stopping) {
+    state.unlock();
+    auto batch = store_->beginWrite();
+    for (auto& entry : entries) {
+      batch->put(
+          entry.keySpace,
+          folly::StringPiece{entry.key},
+          folly::StringPiece{entry.value});
+    }
+    batch->flush();
+    return;
+  }
+
+  auto wasIdle = state->queue.empty();
+  for (auto& entry : entries) {
+    auto value = std::make_shared<const std::string>(std::move(entry.value));
+    auto sequence = state->nextSequence++;
+    auto [it, inserted] = state->pending[entry.keySpace->index].try_emplace(
+        entry.key, PendingValue{value, sequence});
+    if (inserted) {
+      ++state->pendingCount;
+    } else {
+      state->pendingBytes -= it->first.size() + it->second.value->size();
+      it->second = PendingValue{value, sequence};
+    }
+    state->pendingBytes += it->first.size() + value->size();
+    state->queue.push_back(
+        Write{entry.keySpace, std::move(entry.key), value, sequence});
+  }
+  if (wasIdle) {
+    queuedCondVar_.notify_one();
+  }
+}
+
+void WriteBackLocalStore::writerThread() {
+  auto state = state_.lock();
+  while (true) {
+    if (state->queue.empty()) {
+      if (state->stopping) {
+        break;
+      }
+      queuedCondVar_.wait(state.as_lock());
+      continue;
+    }
+
+    auto writes = std::move(state->queue);
+    state->queue.clear();
+    state.unlock();
+
+    folly::exception_wrapper error;
+    try {
+      auto batch = store_->beginWrite(kWriteBatchBytes);
+      for (const auto& write : writes) {
+        batch->put(
+            write.keySpace,
+            folly::StringPiece{write.key},
+            folly::StringPiece{*write.value});
+      }
+      batch->flush();
+    } catch (const std::exception& ex) {
+      XLOG(ERR) << "failed to write " << writes.size()
+                << " entries to the local store: " << ex.what();
+      error = folly::exception_wrapper{std::current_exception(), ex};
+    }
+
+    state = state_.lock();
+    if (error && !state->writeError) {
+      state->writeError = std::move(error);
+    }
+    for (const auto& write : writes) {
+      auto& pending = state->pending[write.keySpace->index];
+      auto it = pending.find(write.key);
+      if (it != pending.end() && it->second.sequence == write.sequence) {
+        state->pendingBytes -= it->first.size() + it->second.value->size();
+        --state->pendingCount;
+        pending.erase(it);
+      }
+    }
+    writtenCondVar_.notify_all();
+  }
+}
+
+void WriteBackLocalStore::stopWriterThread() {
+  if (!writerThread_.joinable()) {
+    return;
+  }
+  state_.lock()->stopping = true;
+  queuedCondVar_.notify_one();
+  writtenCondVar_.notify_all();
+  writerThread_.join();
+}
+
+} // namespace facebook::eden
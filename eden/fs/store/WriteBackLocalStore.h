@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/ExceptionWrapper.h>
+#include <folly/Synchronized.h>
+#include <folly/container/F14Map.h>
+#include <array>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "eden/fs/store/LocalStore.h"
+#include "eden/fs/store/StoreResult.h"
+
+namespace facebook::eden {
+
+/**
+ * A LocalStore that writes to another LocalStore in the background, so that
+ * the latency of the underlying store, including the write stalls of
+ * RocksDB during compactions, stays off the import path.
+ *
+ * Puts are recorded in an in-memory map, from which reads are served until
+ * a background thread has written them to the underlying store in a single
+ * WriteBatch. Once the pending values exceed maxPendingBytes, puts block
+ * until the background thread catches up.
+ *
+ * Since the writes are asynchronous, an error writing to the underlying
+ * store is not reported to the caller of put(). It is logged, and thrown by
+ * the next flush().
+ */
+class WriteBackLocalStore : public LocalStore {
+ public:
+  WriteBackLocalStore(
+      std::shared_ptr<LocalStore> store,
+      size_t maxPendingBytes);
+  ~WriteBackLocalStore() override;
+
+  /**
+   * Write the pending values and close the underlying store.
+   */
+  void close() override;
+
+  /**
+   * Wait until all the values put so far are written to the underlying
+   * store.
+   *
+   * Throws the first error the background thread hit writing to the
+   * underlying store since the previous flush(), if any.
+   */
+  void flush();
+
+  void clearKeySpace(KeySpace keySpace) override;
+  void compactKeySpace(KeySpace keySpace) override;
+  StoreResult get(KeySpace keySpace, folly::ByteRange key) const override;
+  FOLLY_NODISCARD folly::Future<StoreResult> getFuture(
+      KeySpace keySpace,
+      folly::ByteRange key) const override;
+  FOLLY_NODISCARD folly::Future<std::vector<StoreResult>> getBatch(
+      KeySpace keySpace,
+      const std::vector<folly::ByteRange>& keys) const override;
+  bool hasKey(KeySpace keySpace, folly::ByteRange key) const override;
+  void put(KeySpace keySpace, folly::ByteRange key, folly::ByteRange value)
+      override;
+  std::unique_ptr<WriteBatch> beginWrite(size_t bufSize = 0) override;
+  void periodicManagementTask(const EdenConfig& config) override;
+
+  /**
+   * The total size of the keys and values not yet written to the underlying
+   * store.
+   */
+  size_t getPendingBytes() const {
+    return state_.lock()->pendingBytes;
+  }
+
+ private:
+  class Batch;
+
+  struct Entry {
+    KeySpace keySpace;
+    std::string key;
+    std::string value;
+  };
+
+  struct Write {
+    KeySpace keySpace;
+    std::string key;
+    std::shared_ptr<const std::string> value;
+    uint64_t sequence;
+  };
+
+  struct PendingValue {
+    std::shared_ptr<const std::string> value;
+    // Identifies the latest put of the key, so that the background thread
+    // doesn't forget a value put again while the previous one was written.
+    uint64_t sequence;
+  };
+
+  struct State {
+    std::array<
+        folly::F14NodeMap<std::string, PendingValue>,
+        KeySpace::kTotalCount>
+        pending;
+    // The writes not yet picked up by the background thread.
+    std::vector<Write> queue;
+    size_t pendingBytes{0};
+    size_t pendingCount{0};
+    uint64_t nextSequence{0};
+    bool stopping{false};
+    // The first write error not yet reported by flush().
+    folly::exception_wrapper writeError;
+  };
+
+  /**
+   * Record the values and queue them for the background thread, blocking
+   * while too many bytes are pending.
+   */
+  void enqueue(std::vector<Entry>&& entries);
+
+  /**
+   * Look up a value not yet written to the underlying store. A key missing
+   * from the pending values is either absent or already in the underlying
+   * store, since the background thread only forgets a value once the
+   * underlying store has it.
+   */
+  std::optional<StoreResult> getPending(
+      KeySpace keySpace,
+      folly::ByteRange key) const;
+
+  void writerThread();
+  void stopWriterThread();
+
+  const std::shared_ptr<LocalStore> store_;
+  const size_t maxPendingBytes_;
+
+  mutable folly::Synchronized<State, std::mutex> state_;
+  // Signaled when writes are queued or the store is closing.
+  std::condition_variable queuedCondVar_;
+  // Signaled when the background thread has written a batch.
+  std::condition_variable writtenCondVar_;
+  std::thread writerThread_;
+};
+
+} // namespace facebook::eden
@@ -5,14 +5,23 @@
  * GNU General Public License version 2.
  */
 
+#include <fcntl.h>
 #include <sysexits.h>
+#include <algorithm>
+#include <array>
+#include <bitset>
 #include <memory>
 #include <optional>
+#include <vector>
 
+#include <folly/File.h>
+#include <folly/FileUtil.h>
 #include <folly/Range.h>
 #include <folly/String.h>
 #include <folly/container/Array.h>
 #include <folly/container/Enumerate.h>
+#include <folly/container/F14Map.h>
+#include <folly/lang/Bits.h>
 #include <folly/init/Init.h>
 #include <folly/logging/Init.h>
 #include <folly/logging/xlog.h>
@@ -23,7 +32,9 @@
 #include "eden/fs/service/EdenInit.h"
 #include "eden/fs/service/EdenStateDir.h"
 #include "eden/fs/store/KeySpace.h"
+#include "eden/fs/store/LocalStoreAccessLog.h"
 #include "eden/fs/store/RocksDbLocalStore.h"
+#include "eden/fs/store/StoreResult.h"
 #include "eden/fs/telemetry/NullStructuredLogger.h"
 #include "eden/fs/utils/FaultInjector.h"
 #include "eden/fs/utils/UserInfo.h"
@@ -37,6 +48,14 @@ using std::optional;
 FOLLY_INIT_LOGGING_CONFIG("eden=DBG2; default:async=true");
 
 DEFINE_string(keySpace, "", "operate on just a single key space");
+DEFINE_string(
+    hotSetPath,
+    "",
+    "the file export_hot_set writes and import_hot_set reads");
+DEFINE_uint64(
+    hotSetSize,
+    100000,
+    "how many of the most read objects export_hot_set exports");
 
 namespace {
 
@@ -57,6 +76,116 @@ optional<KeySpace> getKeySpace() {
   return stringToKeySpace(FLAGS_keySpace);
 }
 
+/**
+ * The key spaces selected by --keySpace, or all those in use.
+ */
+std::vector<KeySpace> getKeySpaces() {
+  if (auto keySpace = getKeySpace()) {
+    return {*keySpace};
+  }
+  std::vector<KeySpace> keySpaces;
+  for (auto& ks : KeySpace::kAll) {
+    if (!ks->isDeprecated()) {
+      keySpaces.push_back(ks);
+    }
+  }
+  return keySpaces;
+}
+
+AbsolutePath getHotSetPath() {
+  if (FLAGS_hotSetPath.empty()) {
+    throw ArgumentError("error: --hotSetPath is required");
+  }
+  return canonicalPath(FLAGS_hotSetPath);
+}
+
+// How many keys export_hot_set reads at once, and how many bytes
+// import_hot_set writes at once.
+constexpr size_t kHotSetReadBatchSize = 1024;
+constexpr size_t kHotSetWriteBatchBytes = 16 * 1024 * 1024;
+
+/**
+ * A hot set file is a sequence of records, each made of the key space name,
+ * the key and the value. The name is prefixed by its length as one byte,
+ * the key and value by theirs as 4 little-endian bytes.
+ */
+class HotSetWriter {
+ public:
+  explicit HotSetWriter(AbsolutePathPiece path)
+      : file_{path.stringPiece(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC} {}
+
+  void write(KeySpace keySpace, folly::ByteRange key, folly::ByteRange value) {
+    buffer_.push_back(static_cast<char>(keySpace->name.size()));
+    buffer_.append(keySpace->name.data(), keySpace->name.size());
+    appendWithSize(key);
+    appendWithSize(value);
+    if (buffer_.size() >= kHotSetWriteBatchBytes) {
+      flush();
+    }
+  }
+
+  void flush() {
+    folly::checkUnixError(
+        folly::writeFull(file_.fd(), buffer_.data(), buffer_.size()),
+        "failed to write the hot set");
+    buffer_.clear();
+  }
+
+ private:
+  void appendWithSize(folly::ByteRange bytes) {
+    auto size = folly::Endian::little(static_cast<uint32_t>(bytes.size()));
+    buffer_.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    buffer_.append(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+  }
+
+  folly::File file_;
+  std::string buffer_;
+};
+
+class HotSetReader {
+ public:
+  explicit HotSetReader(AbsolutePathPiece path)
+      : file_{path.stringPiece(), O_RDONLY | O_CLOEXEC} {}
+
+  /**
+   * Read the next record, returning false at the end of the file.
+   */
+  bool next(KeySpace& keySpace, std::string& key, std::string& value) {
+    uint8_t nameSize;
+    if (!readExact(&nameSize, sizeof(nameSize), /*eofOk=*/true)) {
+      return false;
+    }
+    std::string name(nameSize, '\0');
+    readExact(name.data(), name.size());
+    keySpace = stringToKeySpace(name);
+    readWithSize(key);
+    readWithSize(value);
+    return true;
+  }
+
+ private:
+  void readWithSize(std::string& bytes) {
+    uint32_t size;
+    readExact(&size, sizeof(size));
+    bytes.resize(folly::Endian::little(size));
+    readExact(bytes.data(), bytes.size());
+  }
+
+  bool readExact(void* data, size_t size, bool eofOk = false) {
+    auto bytesRead = folly::readFull(file_.fd(), data, size);
+    folly::checkUnixError(bytesRead, "failed to read the hot set");
+    if (bytesRead == 0 && eofOk) {
+      return false;
+    }
+    if (static_cast<size_t>(bytesRead) != size) {
+      throw std::runtime_error("truncated hot set file");
+    }
+    return true;
+  }
+
+  folly::File file_;
+};
+
 class Command {
  public:
   Command()
@@ -89,6 +218,7 @@ class Command {
         rocksPath,
         std::make_shared<NullStructuredLogger>(),
         &faultInjector_,
+        *config_,
         mode);
     XLOG(INFO) << "Opened RocksDB store in "
                << (mode == RocksDBOpenMode::ReadOnly ? "read-only"
@@ -183,7 +313,7 @@ class RepairCommand : public Command {
       "Force a repair of the RocksDB storage, even if it does not look corrupt");
 
   void run() override {
-    RocksDbLocalStore::repairDB(getLocalStorePath());
+    RocksDbLocalStore::repairDB(getLocalStorePath(), *config_);
   }
 };
 
@@ -205,13 +335,203 @@ class ShowSizesCommand : public Command {
   }
 };
 
+class ShowOptionsCommand : public Command {
+ public:
+  static constexpr auto name = StringPiece("show_options");
+  static constexpr auto help = StringPiece(
+      "Report the tuning profile and RocksDB options of each key space.");
+
+  void run() override {
+    auto localStore = openLocalStore(RocksDBOpenMode::ReadOnly);
+
+    for (const auto& ks : KeySpace::kAll) {
+      LOG(INFO) << "Column family \"" << ks->name << "\": profile "
+                << rocksDbProfileName(localStore->getProfile(ks)) << "\n  "
+                << localStore->describeOptions(ks);
+    }
+  }
+};
+
+class ShowStatsCommand : public Command {
+ public:
+  static constexpr auto name = StringPiece("show_stats");
+  static constexpr auto help = StringPiece(
+      "Report the key counts and value sizes of each key space, and the hit "
+      "rates in the access log.");
+
+  void run() override {
+    auto localStore = openLocalStore(RocksDBOpenMode::ReadOnly);
+    auto keySpaces = getKeySpaces();
+
+    for (const auto& ks : keySpaces) {
+      uint64_t count = 0;
+      uint64_t bytes = 0;
+      // Values by the number of bits of their size: bucket n holds the
+      // values of less than 2^n bytes, and at least 2^(n-1).
+      std::array<uint64_t, 65> histogram{};
+      localStore->forEach(ks, [&](folly::ByteRange, folly::ByteRange value) {
+        ++count;
+        bytes += value.size();
+        ++histogram[folly::findLastSet(value.size())];
+      });
+      LOG(INFO) << "Column family \"" << ks->name << "\": " << count
+                << " keys, "
+                << folly::prettyPrint(bytes, folly::PRETTY_BYTES_METRIC);
+      for (auto bucket : folly::enumerate(histogram)) {
+        if (*bucket > 0) {
+          LOG(INFO) << "  values under "
+                    << folly::prettyPrint(
+                           uint64_t{1} << bucket.index,
+                           folly::PRETTY_BYTES_METRIC)
+                    << ": " << *bucket;
+        }
+      }
+    }
+
+    std::array<uint64_t, KeySpace::kTotalCount> reads{};
+    std::array<uint64_t, KeySpace::kTotalCount> hits{};
+    LocalStoreAccessLog::read(
+        RocksDbLocalStore::getAccessLogPath(getLocalStorePath()),
+        [&](const LocalStoreAccessLog::Access& access) {
+          ++reads[access.keySpace->index];
+          hits[access.keySpace->index] += access.hit;
+        });
+    for (const auto& ks : keySpaces) {
+      auto sampled = reads[ks->index];
+      if (sampled == 0) {
+        continue;
+      }
+      LOG(INFO) << "Column family \"" << ks->name << "\": " << sampled
+                << " sampled reads, estimated hit rate "
+                << fmt::format(
+                       FMT_STRING("{:.1f}%"),
+                       100.0 * hits[ks->index] / sampled);
+    }
+  }
+};
+
+class ExportHotSetCommand : public Command {
+ public:
+  static constexpr auto name = StringPiece("export_hot_set");
+  static constexpr auto help = StringPiece(
+      "Write the most read objects of the access log to --hotSetPath, to "
+      "pre-seed the local store of another machine.");
+
+  void run() override {
+    auto hotSetPath = getHotSetPath();
+    auto localStore = openLocalStore(RocksDBOpenMode::ReadOnly);
+
+    // Count the sampled reads of each key; misses too, since a key missing
+    // here may still be popular.
+    std::array<folly::F14FastMap<std::string, uint64_t>, KeySpace::kTotalCount>
+        readCounts;
+    std::bitset<KeySpace::kTotalCount> selected;
+    for (const auto& ks : getKeySpaces()) {
+      selected.set(ks->index);
+    }
+    LocalStoreAccessLog::read(
+        RocksDbLocalStore::getAccessLogPath(getLocalStorePath()),
+        [&](const LocalStoreAccessLog::Access& access) {
+          if (selected.test(access.keySpace->index)) {
+            ++readCounts[access.keySpace->index][access.key];
+          }
+        });
+
+    struct Candidate {
+      uint64_t reads;
+      KeySpace keySpace;
+      const std::string* key;
+    };
+    std::vector<Candidate> candidates;
+    for (const auto& ks : KeySpace::kAll) {
+      for (const auto& [key, reads] : readCounts[ks->index]) {
+        candidates.push_back(Candidate{reads, ks, &key});
+      }
+    }
+    auto hotSetSize =
+        std::min<size_t>(candidates.size(), FLAGS_hotSetSize);
+    std::partial_sort(
+        candidates.begin(),
+        candidates.begin() + hotSetSize,
+        candidates.end(),
+        [](const Candidate& a, const Candidate& b) {
+          return a.reads > b.reads;
+        });
+    candidates.resize(hotSetSize);
+
+    HotSetWriter writer{hotSetPath};
+    size_t exported = 0;
+    for (const auto& ks : KeySpace::kAll) {
+      std::vector<folly::ByteRange> keys;
+      auto exportBatch = [&] {
+        auto results = localStore->getBatch(ks, keys).get();
+        for (size_t i = 0; i < keys.size(); ++i) {
+          if (results[i].isValid()) {
+            writer.write(ks, keys[i], results[i].bytes());
+            ++exported;
+          }
+        }
+        keys.clear();
+      };
+      for (const auto& candidate : candidates) {
+        if (candidate.keySpace->index != ks->index) {
+          continue;
+        }
+        keys.push_back(folly::StringPiece{*candidate.key});
+        if (keys.size() >= kHotSetReadBatchSize) {
+          exportBatch();
+        }
+      }
+      if (!keys.empty()) {
+        exportBatch();
+      }
+    }
+    writer.flush();
+    LOG(INFO) << "Exported " << exported << " objects of the "
+              << candidates.size() << " most read to " << hotSetPath;
+  }
+};
+
+class ImportHotSetCommand : public Command {
+ public:
+  static constexpr auto name = StringPiece("import_hot_set");
+  static constexpr auto help = StringPiece(
+      "Add the objects of the hot set at --hotSetPath to the local store.");
+
+  void run() override {
+    auto hotSetPath = getHotSetPath();
+    auto localStore = openLocalStore(RocksDBOpenMode::ReadWrite);
+
+    HotSetReader reader{hotSetPath};
+    auto batch = localStore->beginWrite(kHotSetWriteBatchBytes);
+    KeySpace keySpace = KeySpace::BlobFamily;
+    std::string key;
+    std::string value;
+    size_t imported = 0;
+    while (reader.next(keySpace, key, value)) {
+      if (keySpace->isDeprecated()) {
+        continue;
+      }
+      batch->put(
+          keySpace, folly::StringPiece{key}, folly::StringPiece{value});
+      ++imported;
+    }
+    batch->flush();
+    LOG(INFO) << "Imported " << imported << " objects from " << hotSetPath;
+  }
+};
+
 std::unique_ptr<Command> createCommand(StringPiece name) {
   auto commands = make_array<std::unique_ptr<CommandFactory>>(
       make_unique<CommandFactoryT<GcCommand>>(),
       make_unique<CommandFactoryT<ClearCommand>>(),
       make_unique<CommandFactoryT<CompactCommand>>(),
       make_unique<CommandFactoryT<RepairCommand>>(),
-      make_unique<CommandFactoryT<ShowSizesCommand>>());
+      make_unique<CommandFactoryT<ShowSizesCommand>>(),
+      make_unique<CommandFactoryT<ShowOptionsCommand>>(),
+      make_unique<CommandFactoryT<ShowStatsCommand>>(),
+      make_unique<CommandFactoryT<ExportHotSetCommand>>(),
+      make_unique<CommandFactoryT<ImportHotSetCommand>>());
 
   std::unique_ptr<Command> command;
   for (const auto& factory : commands) {
@@ -8,9 +8,12 @@
 #include "GitBackingStore.h"
 
 #include <folly/Conv.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/futures/Future.h>
 #include <folly/logging/xlog.h>
 #include <git2.h>
+#include <algorithm>
 
 #include "eden/fs/model/Blob.h"
 #include "eden/fs/model/Hash.h"
@@ -29,6 +32,7 @@ using folly::makeSemiFuture;
 using folly::SemiFuture;
 using folly::StringPiece;
 using std::make_unique;
+using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
 
@@ -54,25 +58,59 @@ namespace facebook::eden {
 
 GitBackingStore::GitBackingStore(
     AbsolutePathPiece repository,
-    LocalStore* localStore)
-    : localStore_{localStore} {
+    LocalStore* localStore,
+    size_t numImportThreads)
+    : localStore_{localStore}, repoPath_{repository.value().str()} {
   // Make sure libgit2 is initialized.
   // (git_libgit2_init() is safe to call multiple times if multiple
   // GitBackingStore objects are created.  git_libgit2_shutdown() should be
   // called once for each call to git_libgit2_init().)
   git_libgit2_init();
 
-  auto error = git_repository_open(&repo_, repository.value().str().c_str());
+  git_repository* repo = nullptr;
+  auto error = git_repository_open(&repo, repoPath_.c_str());
   gitCheckError(error, "error opening git repository", repository);
+  gitDirPath_ = git_repository_path(repo);
+  idleRepos_.wlock()->push_back(repo);
+
+  importThreadPool_ = std::make_unique<folly::CPUThreadPoolExecutor>(
+      std::max<size_t>(numImportThreads, 1),
+      std::make_shared<folly::NamedThreadFactory>("GitImport"));
 }
 
 GitBackingStore::~GitBackingStore() {
-  git_repository_free(repo_);
+  // Finish the pending imports before freeing the handles they use.
+  importThreadPool_->join();
+  for (auto* repo : *idleRepos_.wlock()) {
+    git_repository_free(repo);
+  }
   git_libgit2_shutdown();
 }
 
+GitBackingStore::RepositoryHandle::~RepositoryHandle() {
+  if (repo_) {
+    store_->idleRepos_.wlock()->push_back(repo_);
+  }
+}
+
+GitBackingStore::RepositoryHandle GitBackingStore::getRepository() {
+  {
+    auto idleRepos = idleRepos_.wlock();
+    if (!idleRepos->empty()) {
+      auto* repo = idleRepos->back();
+      idleRepos->pop_back();
+      return RepositoryHandle{this, repo};
+    }
+  }
+
+  git_repository* repo = nullptr;
+  auto error = git_repository_open(&repo, repoPath_.c_str());
+  gitCheckError(error, "error opening git repository", repoPath_);
+  return RepositoryHandle{this, repo};
+}
+
 const char* GitBackingStore::getPath() const {
-  return git_repository_path(repo_);
+  return gitDirPath_.c_str();
 }
 
 RootId GitBackingStore::parseRootId(folly::StringPiece rootId) {
@@ -94,7 +132,8 @@ SemiFuture<unique_ptr<Tree>> GitBackingStore::getRootTree(
   // Look up the commit info
   git_oid commitOID = root2Oid(rootId);
   git_commit* commit = nullptr;
-  auto error = git_commit_lookup(&commit, repo_, &commitOID);
+  auto repo = getRepository();
+  auto error = git_commit_lookup(&commit, repo.get(), &commitOID);
   gitCheckError(
       error,
       "unable to find git commit ",
@@ -119,11 +158,13 @@ SemiFuture<unique_ptr<Tree>> GitBackingStore::getRootTree(
       });
 }
 
-SemiFuture<unique_ptr<Tree>> GitBackingStore::getTree(
+SemiFuture<shared_ptr<const Tree>> GitBackingStore::getTree(
     const Hash& id,
     ObjectFetchContext& /*context*/) {
-  // TODO: Use a separate thread pool to do the git I/O
-  return makeSemiFuture(getTreeImpl(id));
+  return folly::via(importThreadPool_.get(), [this, id] {
+           return shared_ptr<const Tree>{getTreeImpl(id)};
+         })
+      .semi();
 }
 
 unique_ptr<Tree> GitBackingStore::getTreeImpl(const Hash& id) {
@@ -131,7 +172,8 @@ unique_ptr<Tree> GitBackingStore::getTreeImpl(const Hash& id) {
 
   git_oid treeOID = hash2Oid(id);
   git_tree* gitTree = nullptr;
-  auto error = git_tree_lookup(&gitTree, repo_, &treeOID);
+  auto repo = getRepository();
+  auto error = git_tree_lookup(&gitTree, repo.get(), &treeOID);
   gitCheckError(
       error, "unable to find git tree ", id, " in repository ", getPath());
   SCOPE_EXIT {
@@ -140,6 +182,7 @@ unique_ptr<Tree> GitBackingStore::getTreeImpl(const Hash& id) {
 
   std::vector<TreeEntry> entries;
   size_t numEntries = git_tree_entrycount(gitTree);
+  entries.reserve(numEntries);
   for (size_t i = 0; i < numEntries; ++i) {
     auto gitEntry = git_tree_entry_byindex(gitTree, i);
     auto entryMode = git_tree_entry_filemode(gitEntry);
@@ -171,11 +214,13 @@ unique_ptr<Tree> GitBackingStore::getTreeImpl(const Hash& id) {
   return tree;
 }
 
-SemiFuture<unique_ptr<Blob>> GitBackingStore::getBlob(
+SemiFuture<shared_ptr<const Blob>> GitBackingStore::getBlob(
     const Hash& id,
     ObjectFetchContext& /*context*/) {
-  // TODO: Use a separate thread pool to do the git I/O
-  return makeSemiFuture(getBlobImpl(id));
+  return folly::via(importThreadPool_.get(), [this, id] {
+           return shared_ptr<const Blob>{getBlobImpl(id)};
+         })
+      .semi();
 }
 
 unique_ptr<Blob> GitBackingStore::getBlobImpl(const Hash& id) {
@@ -183,7 +228,8 @@ unique_ptr<Blob> GitBackingStore::getBlobImpl(const Hash& id) {
 
   auto blobOID = hash2Oid(id);
   git_blob* blob = nullptr;
-  int error = git_blob_lookup(&blob, repo_, &blobOID);
+  auto repo = getRepository();
+  int error = git_blob_lookup(&blob, repo.get(), &blobOID);
   gitCheckError(
       error, "unable to find git blob ", id, " in repository ", getPath());
 
@@ -201,6 +247,47 @@ unique_ptr<Blob> GitBackingStore::getBlobImpl(const Hash& id) {
   return make_unique<Blob>(id, std::move(buf));
 }
 
+SemiFuture<folly::Unit> GitBackingStore::prefetchBlobs(
+    HashRange ids,
+    ObjectFetchContext& /*context*/) {
+  // Split the blobs evenly over the import threads.
+  auto numThreads = importThreadPool_->numThreads();
+  auto chunkSize =
+      std::max<size_t>((ids.size() + numThreads - 1) / numThreads, 1);
+
+  std::vector<folly::Future<folly::Unit>> prefetches;
+  for (size_t begin = 0; begin < ids.size(); begin += chunkSize) {
+    auto end = std::min(begin + chunkSize, ids.size());
+    std::vector<Hash> chunk{ids.begin() + begin, ids.begin() + end};
+    prefetches.push_back(folly::via(
+        importThreadPool_.get(), [this, chunk = std::move(chunk)] {
+          prefetchBlobsImpl(chunk);
+        }));
+  }
+  return folly::collectAll(std::move(prefetches)).deferValue([](auto&&) {});
+}
+
+void GitBackingStore::prefetchBlobsImpl(const std::vector<Hash>& ids) {
+  auto repo = getRepository();
+  git_odb* odb = nullptr;
+  gitCheckError(
+      git_repository_odb(&odb, repo.get()),
+      "unable to open the object database of ",
+      getPath());
+  SCOPE_EXIT {
+    git_odb_free(odb);
+  };
+
+  for (const auto& id : ids) {
+    auto oid = hash2Oid(id);
+    git_odb_object* object = nullptr;
+    // Missing blobs are reported when they are actually fetched.
+    if (git_odb_read(&object, odb, &oid) == 0) {
+      git_odb_object_free(object);
+    }
+  }
+}
+
 git_oid GitBackingStore::root2Oid(const RootId& rootId) {
   auto& value = rootId.value();
   CHECK_EQ(40, value.size());
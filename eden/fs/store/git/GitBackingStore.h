@@ -8,6 +8,11 @@
 #pragma once
 
 #include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "eden/fs/store/BackingStore.h"
 #include "eden/fs/store/ObjectFetchContext.h"
@@ -16,12 +21,24 @@
 struct git_oid;
 struct git_repository;
 
+namespace folly {
+class CPUThreadPoolExecutor;
+} // namespace folly
+
 namespace facebook::eden {
 
 class LocalStore;
 
+constexpr size_t kDefaultGitImportThreads = 8;
+
 /**
  * A BackingStore implementation that loads data out of a git repository.
+ *
+ * Trees and blobs are imported on a pool of threads. A git_repository handle
+ * can't be used by several threads at once, so each import borrows one from
+ * a pool of handles, opening another when they are all in use. All the
+ * handles share the memory mapped windows of the packfiles, which libgit2
+ * caches per process.
  */
 class GitBackingStore final : public BackingStore {
  public:
@@ -32,7 +49,10 @@ class GitBackingStore final : public BackingStore {
    * GitBackingStore object).  It is guaranteed to be valid for the lifetime of
    * the GitBackingStore object.
    */
-  GitBackingStore(AbsolutePathPiece repository, LocalStore* localStore);
+  GitBackingStore(
+      AbsolutePathPiece repository,
+      LocalStore* localStore,
+      size_t numImportThreads = kDefaultGitImportThreads);
   ~GitBackingStore() override;
 
   /**
@@ -55,19 +75,53 @@ class GitBackingStore final : public BackingStore {
       ObjectFetchContext& /* context */) override {
     throw std::domain_error("unimplemented");
   }
-  folly::SemiFuture<std::unique_ptr<Tree>> getTree(
+  folly::SemiFuture<std::shared_ptr<const Tree>> getTree(
       const Hash& id,
       ObjectFetchContext& context) override;
-  folly::SemiFuture<std::unique_ptr<Blob>> getBlob(
+  folly::SemiFuture<std::shared_ptr<const Blob>> getBlob(
       const Hash& id,
       ObjectFetchContext& context) override;
 
+  /**
+   * Read the blobs once, spread over the import threads, so that their
+   * packfile windows are mapped and their delta bases cached when they are
+   * fetched.
+   */
+  FOLLY_NODISCARD folly::SemiFuture<folly::Unit> prefetchBlobs(
+      HashRange ids,
+      ObjectFetchContext& context) override;
+
  private:
   GitBackingStore(GitBackingStore const&) = delete;
   GitBackingStore& operator=(GitBackingStore const&) = delete;
 
+  /**
+   * A git_repository borrowed from the pool, and given back to it when the
+   * handle is destroyed.
+   */
+  class RepositoryHandle {
+   public:
+    RepositoryHandle(GitBackingStore* store, git_repository* repo)
+        : store_{store}, repo_{repo} {}
+    RepositoryHandle(RepositoryHandle&& other) noexcept
+        : store_{other.store_}, repo_{std::exchange(other.repo_, nullptr)} {}
+    RepositoryHandle& operator=(RepositoryHandle&&) = delete;
+    ~RepositoryHandle();
+
+    git_repository* get() const {
+      return repo_;
+    }
+
+   private:
+    GitBackingStore* store_;
+    git_repository* repo_;
+  };
+
+  RepositoryHandle getRepository();
+
   std::unique_ptr<Tree> getTreeImpl(const Hash& id);
   std::unique_ptr<Blob> getBlobImpl(const Hash& id);
+  void prefetchBlobsImpl(const std::vector<Hash>& ids);
 
   static git_oid root2Oid(const RootId& rootId);
 
@@ -75,7 +129,12 @@ class GitBackingStore final : public BackingStore {
   static Hash oid2Hash(const git_oid* oid);
 
   LocalStore* localStore_{nullptr};
-  git_repository* repo_{nullptr};
+  std::string repoPath_;
+  // The path of the .git directory, as resolved by libgit2.
+  std::string gitDirPath_;
+  // The handles that no import is using.
+  folly::Synchronized<std::vector<git_repository*>> idleRepos_;
+  std::unique_ptr<folly::CPUThreadPoolExecutor> importThreadPool_;
 };
 
 } // namespace facebook::eden
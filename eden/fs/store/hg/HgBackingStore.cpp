@@ -7,6 +7,7 @@
 
 #include "HgBackingStore.h"
 
+#include <algorithm>
 #include <memory>
 
 #include <folly/Range.h>
@@ -15,6 +16,7 @@
 #include <folly/Try.h>
 #include <folly/executors/CPUThreadPoolExecutor.h>
 #include <folly/executors/GlobalExecutor.h>
+#include <folly/executors/InlineExecutor.h>
 #include <folly/executors/task_queue/UnboundedBlockingQueue.h>
 #include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/futures/Future.h>
@@ -37,6 +39,7 @@
 #include "eden/fs/store/hg/HgImporter.h"
 #include "eden/fs/store/hg/HgProxyHash.h"
 #include "eden/fs/store/hg/MetadataImporter.h"
+#include "eden/fs/store/hg/TreeMetadataBatcher.h"
 #include "eden/fs/store/hg/ScsProxyHash.h"
 #include "eden/fs/telemetry/EdenStats.h"
 #include "eden/fs/telemetry/RequestMetricsScope.h"
@@ -44,13 +47,6 @@
 #include "eden/fs/utils/EnumValue.h"
 #include "eden/fs/utils/UnboundedQueueExecutor.h"
 
-#ifdef EDEN_HAVE_SERVICEROUTER
-#include "servicerouter/common/TServiceRouterException.h" // @manual
-#include "servicerouter/common/gen-cpp2/error_types.h" // @manual
-
-using facebook::servicerouter::ErrorReason;
-using facebook::servicerouter::TServiceRouterException;
-#endif
 
 using folly::Future;
 using folly::IOBuf;
@@ -93,6 +89,10 @@ Importer& getThreadLocalImporter() {
   return *threadLocalImporter;
 }
 
+// The default of hg:proxy-hash-index-size, for the stores created by tests
+// without a config.
+constexpr size_t kDefaultProxyHashIndexSize = 256 * 1024;
+
 Hash hashFromRootId(const RootId& root) {
   return hashFromThrift(root.value());
 }
@@ -174,13 +174,17 @@ HgBackingStore::HgBackingStore(
           std::make_shared<HgImporterThreadFactory>(repository, stats))),
       config_(config),
       serverThreadPool_(serverThreadPool),
-      datapackStore_(
+      proxyHashIndex_(config->getEdenConfig()->hgProxyHashIndexSize.getValue()),
+      datapackStore_(std::make_unique<HgDatapackStore>(
           repository,
-          config->getEdenConfig()->useEdenApi.getValue()) {
+          config->getEdenConfig()->useEdenApi.getValue(),
+          &proxyHashIndex_)) {
   HgImporter importer(repository, stats);
   const auto& options = importer.getOptions();
   repoName_ = options.repoName;
   metadataImporter_ = metadataImporterFactory(config_, repoName_, localStore_);
+  metadataBatcher_ = std::make_shared<TreeMetadataBatcher>(
+      metadataImporter_, localStore_, serverThreadPool_, config_);
 }
 
 /**
@@ -211,10 +215,35 @@ HgBackingStore::HgBackingStore(
       stats_{std::move(stats)},
       importThreadPool_{std::make_unique<HgImporterTestExecutor>(importer)},
       serverThreadPool_{importThreadPool_.get()},
-      datapackStore_(repository, false) {
+      proxyHashIndex_(kDefaultProxyHashIndexSize),
+      datapackStore_(std::make_unique<HgDatapackStore>(
+          repository,
+          false,
+          &proxyHashIndex_)) {
   const auto& options = importer->getOptions();
   repoName_ = options.repoName;
   metadataImporter_ = metadataImporterFactory(config_, repoName_, localStore_);
+  metadataBatcher_ = std::make_shared<TreeMetadataBatcher>(
+      metadataImporter_, localStore_, serverThreadPool_, config_);
+}
+
+HgBackingStore::HgBackingStore(
+    std::unique_ptr<HgDatapackStore> datapackStore,
+    std::shared_ptr<LocalStore> localStore,
+    std::shared_ptr<ReloadableConfig> config,
+    std::shared_ptr<EdenStats> stats)
+    : localStore_{std::move(localStore)},
+      stats_{std::move(stats)},
+      importThreadPool_{std::make_unique<folly::InlineExecutor>()},
+      config_{std::move(config)},
+      serverThreadPool_{importThreadPool_.get()},
+      proxyHashIndex_(
+          config_->getEdenConfig()->hgProxyHashIndexSize.getValue()),
+      datapackStore_{std::move(datapackStore)} {
+  metadataImporter_ = MetadataImporter::getMetadataImporterFactory<
+      DefaultMetadataImporter>()(config_, repoName_, localStore_);
+  metadataBatcher_ = std::make_shared<TreeMetadataBatcher>(
+      metadataImporter_, localStore_, serverThreadPool_, config_);
 }
 
 HgBackingStore::~HgBackingStore() = default;
@@ -264,41 +293,23 @@ SemiFuture<unique_ptr<Tree>> HgBackingStore::getTree(
 void HgBackingStore::getTreeBatch(
     const std::vector<Hash>& ids,
     const std::vector<HgProxyHash>& hashes,
-    std::vector<folly::Promise<std::unique_ptr<Tree>>*> promises,
+    std::vector<folly::Promise<std::shared_ptr<const Tree>>*> promises,
     bool prefetchMetadata) {
   auto writeBatch = localStore_->beginWrite();
 
   std::vector<folly::Promise<std::unique_ptr<Tree>>> innerPromises;
   innerPromises.reserve(promises.size());
-  std::vector<folly::SemiFuture<std::unique_ptr<TreeMetadata>>> metadataFutures;
-  metadataFutures.reserve(promises.size());
-
-  bool metadataEnabled =
-      metadataImporter_->metadataFetchingAvailable() && prefetchMetadata;
-
-  // Kick off all the fetching
-  auto proxyHash = hashes.begin();
-  auto id = ids.begin();
-  auto promise = promises.begin();
-  for (; promise != promises.end(); ++id, ++proxyHash, ++promise) {
+  for (size_t i = 0; i < promises.size(); ++i) {
     innerPromises.emplace_back(folly::Promise<std::unique_ptr<Tree>>());
-
-    auto treeMetadataFuture =
-        folly::SemiFuture<std::unique_ptr<TreeMetadata>>::makeEmpty();
-    if (metadataEnabled) {
-      treeMetadataFuture =
-          metadataImporter_->getTreeMetadata(*id, proxyHash->revHash());
-    }
-    metadataFutures.push_back(std::move(treeMetadataFuture));
   }
-  datapackStore_.getTreeBatch(ids, hashes, writeBatch.get(), &innerPromises);
+  datapackStore_->getTreeBatch(ids, hashes, writeBatch.get(), &innerPromises);
 
-  // Receive the fetches and tie the content and metadata together if needed.
+  // Receive the fetches and request the metadata of the fetched trees.
   auto innerPromise = innerPromises.begin();
-  promise = promises.begin();
-  auto treeMetadataFuture = std::make_move_iterator(metadataFutures.begin());
+  auto promise = promises.begin();
+  auto proxyHash = hashes.begin();
   for (; innerPromise != innerPromises.end();
-       ++innerPromise, ++promise, ++treeMetadataFuture) {
+       ++innerPromise, ++promise, ++proxyHash) {
     // This innerPromise pattern is so we can retrieve the tree from the
     // innerPromise and use it for tree metadata prefetching, without
     // invalidating the passed in Promise.
@@ -308,8 +319,10 @@ void HgBackingStore::getTreeBatch(
 
     (*promise)->setWith([&]() mutable {
       std::unique_ptr<Tree> tree = (*innerPromise).getFuture().get();
-      this->processTreeMetadata(std::move(*treeMetadataFuture), *tree);
-      return tree;
+      if (prefetchMetadata) {
+        fetchTreeMetadata(*tree, proxyHash->revHash());
+      }
+      return std::shared_ptr<const Tree>{std::move(tree)};
     });
   }
 }
@@ -333,65 +346,27 @@ Future<unique_ptr<Tree>> HgBackingStore::importTreeImpl(
 
   folly::stop_watch<std::chrono::milliseconds> watch;
 
-  auto treeMetadataFuture =
-      folly::SemiFuture<std::unique_ptr<TreeMetadata>>::makeEmpty();
-  if (metadataImporter_->metadataFetchingAvailable() && prefetchMetadata) {
-    treeMetadataFuture =
-        metadataImporter_->getTreeMetadata(edenTreeID, manifestNode);
-  }
   return fetchTreeFromHgCacheOrImporter(
              manifestNode, edenTreeID, path.copy(), commitHash)
-      .thenValue([this,
-                  watch,
-                  treeMetadataFuture = std::move(treeMetadataFuture),
-                  config = config_](std::unique_ptr<Tree>&& result) mutable {
+      .thenValue([this, watch, manifestNode, prefetchMetadata](
+                     std::unique_ptr<Tree>&& result) mutable {
         auto& currentThreadStats =
             stats_->getHgBackingStoreStatsForCurrentThread();
         currentThreadStats.hgBackingStoreGetTree.addValue(
             watch.elapsed().count());
-        this->processTreeMetadata(std::move(treeMetadataFuture), *result);
+        if (prefetchMetadata) {
+          this->fetchTreeMetadata(*result, manifestNode);
+        }
         return std::move(result);
       });
 }
 
-void HgBackingStore::processTreeMetadata(
-    folly::SemiFuture<std::unique_ptr<TreeMetadata>>&& treeMetadataFuture,
-    const Tree& tree) {
-  if (!treeMetadataFuture.valid()) {
-    return;
+void HgBackingStore::fetchTreeMetadata(
+    const Tree& tree,
+    const Hash& manifestId) {
+  if (metadataImporter_->metadataFetchingAvailable()) {
+    metadataBatcher_->fetch(tree, manifestId);
   }
-
-  // metadata fetching will need the eden ids of each of the
-  // children of the the tree, to store the metadata for each of the
-  // children in the local store. Thus we make a copy of this and
-  // pass it along to metadata storage.
-  std::move(treeMetadataFuture)
-      .via(serverThreadPool_)
-      .thenValue([localStore = localStore_, tree = tree](
-                     std::unique_ptr<TreeMetadata>&& treeMetadata) mutable {
-        // note this may throw if the localStore has already been
-        // closed
-        localStore->putTreeMetadata(*treeMetadata, tree);
-      })
-      .thenError([config = config_](folly::exception_wrapper&& error) {
-#ifdef EDEN_HAVE_SERVICEROUTER
-        if (TServiceRouterException* serviceRouterError =
-                error.get_exception<TServiceRouterException>()) {
-          if (config &&
-              serviceRouterError->getErrorReason() ==
-                  ErrorReason::THROTTLING_REQUEST) {
-            XLOG_EVERY_N_THREAD(
-                WARN,
-                config->getEdenConfig()->scsThrottleErrorSampleRatio.getValue())
-                << "Error during metadata pre-fetching or storage: "
-                << error.what();
-            return;
-          }
-        }
-#endif
-        XLOG(WARN) << "Error during metadata pre-fetching or storage: "
-                   << error.what();
-      });
 }
 
 folly::Future<std::unique_ptr<Tree>>
@@ -401,7 +376,7 @@ HgBackingStore::fetchTreeFromHgCacheOrImporter(
     RelativePath path,
     const std::optional<Hash>& commitId) {
   auto writeBatch = localStore_->beginWrite();
-  if (auto tree = datapackStore_.getTree(
+  if (auto tree = datapackStore_->getTree(
           path, manifestNode, edenTreeID, writeBatch.get(), commitId)) {
     XLOG(DBG4) << "imported tree node=" << manifestNode << " path=" << path
                << " from Rust hgcache";
@@ -585,7 +560,7 @@ std::unique_ptr<Tree> HgBackingStore::processTree(
                << " node: " << entry.node << " flag: " << entry.type;
 
     auto relPath = path + entry.name;
-    auto proxyHash = HgProxyHash::store(relPath, entry.node, writeBatch);
+    auto proxyHash = proxyHashIndex_.store(relPath, entry.node, writeBatch);
     if (commitHash) {
       ScsProxyHash::store(proxyHash, relPath, *commitHash, writeBatch);
     }
@@ -661,11 +636,12 @@ folly::Future<std::unique_ptr<Tree>> HgBackingStore::importTreeManifestImpl(
   batch->flush();
   auto futTree = importTreeImpl(
       manifestNode, proxyInfo.first, path, commitId, prefetchMetadata);
-  return std::move(futTree).thenValue([batch = localStore_->beginWrite(),
+  return std::move(futTree).thenValue([this,
+                                       batch = localStore_->beginWrite(),
                                        info = std::move(proxyInfo)](auto tree) {
     // Only write the proxy hash value for this once we've imported
     // the root.
-    HgProxyHash::store(info, batch.get());
+    proxyHashIndex_.store(info, batch.get());
     batch->flush();
     return tree;
   });
@@ -676,17 +652,13 @@ unique_ptr<Tree> HgBackingStore::getTreeFromHgCache(
     const HgProxyHash& proxyHash,
     bool prefetchMetadata) {
   if (auto tree =
-          datapackStore_.getTreeLocal(edenTreeId, proxyHash, *localStore_)) {
+          datapackStore_->getTreeLocal(edenTreeId, proxyHash, *localStore_)) {
     XLOG(DBG5) << "imported tree of '" << proxyHash.path() << "', "
                << proxyHash.revHash().toString() << " from hgcache";
 
-    auto treeMetadataFuture =
-        folly::SemiFuture<std::unique_ptr<TreeMetadata>>::makeEmpty();
-    if (metadataImporter_->metadataFetchingAvailable() && prefetchMetadata) {
-      treeMetadataFuture =
-          metadataImporter_->getTreeMetadata(edenTreeId, proxyHash.revHash());
+    if (prefetchMetadata) {
+      this->fetchTreeMetadata(*tree, proxyHash.revHash());
     }
-    this->processTreeMetadata(std::move(treeMetadataFuture), *tree);
     return tree;
   }
 
@@ -711,6 +683,57 @@ SemiFuture<std::unique_ptr<Blob>> HgBackingStore::fetchBlobFromHgImporter(
       });
 }
 
+SemiFuture<std::vector<folly::Try<std::unique_ptr<Blob>>>>
+HgBackingStore::fetchBlobsFromHgImporter(std::vector<HgProxyHash> hgInfos) {
+  std::vector<SemiFuture<std::vector<folly::Try<std::unique_ptr<Blob>>>>>
+      futures;
+  std::vector<size_t> groupSizes;
+  for (size_t begin = 0; begin < hgInfos.size();
+       begin += HgImporter::kMaxPipelinedRequests) {
+    auto end =
+        std::min(begin + HgImporter::kMaxPipelinedRequests, hgInfos.size());
+    std::vector<HgProxyHash> group{
+        std::make_move_iterator(hgInfos.begin() + begin),
+        std::make_move_iterator(hgInfos.begin() + end)};
+    groupSizes.push_back(group.size());
+    futures.push_back(folly::via(
+        importThreadPool_.get(),
+        [stats = stats_,
+         group = std::move(group),
+         &liveImportBlobWatches = liveImportBlobWatches_] {
+          Importer& importer = getThreadLocalImporter();
+          folly::stop_watch<std::chrono::milliseconds> watch;
+          RequestMetricsScope queueTracker{&liveImportBlobWatches};
+          auto blobs = importer.importFileContentsBatch(group);
+          stats->getHgBackingStoreStatsForCurrentThread()
+              .hgBackingStoreImportBlob.addValue(watch.elapsed().count());
+          return blobs;
+        }));
+  }
+  // A group fails as a whole when its importer does, which must only fail
+  // the blobs of that group.
+  return folly::collectAll(futures).deferValue(
+      [groupSizes = std::move(groupSizes)](
+          std::vector<
+              folly::Try<std::vector<folly::Try<std::unique_ptr<Blob>>>>>&&
+              groups) {
+        std::vector<folly::Try<std::unique_ptr<Blob>>> blobs;
+        for (size_t i = 0; i < groups.size(); ++i) {
+          auto& group = groups[i];
+          if (group.hasException()) {
+            for (size_t j = 0; j < groupSizes[i]; ++j) {
+              blobs.emplace_back(group.exception());
+            }
+            continue;
+          }
+          for (auto& blob : group.value()) {
+            blobs.push_back(std::move(blob));
+          }
+        }
+        return blobs;
+      });
+}
+
 SemiFuture<folly::Unit> HgBackingStore::prefetchBlobs(
     std::vector<HgProxyHash> proxyHashes,
     ObjectFetchContext& /*context*/) {
@@ -786,8 +809,8 @@ folly::StringPiece HgBackingStore::stringOfHgImportObject(
   EDEN_BUG() << "unknown hg import object " << enumValue(object);
 }
 
-RequestMetricsScope::LockedRequestWatchList&
-HgBackingStore::getLiveImportWatches(HgImportObject object) const {
+RequestWatchList& HgBackingStore::getLiveImportWatches(
+    HgImportObject object) const {
   switch (object) {
     case HgImportObject::BLOB:
       return liveImportBlobWatches_;
@@ -800,7 +823,7 @@ HgBackingStore::getLiveImportWatches(HgImportObject object) const {
 }
 
 void HgBackingStore::periodicManagementTask() {
-  datapackStore_.refresh();
+  datapackStore_->refresh();
 }
 
 } // namespace facebook::eden
@@ -9,17 +9,20 @@
 
 #include <memory>
 #include <optional>
+#include <vector>
 
 #include <folly/Executor.h>
 #include <folly/Range.h>
 #include <folly/String.h>
 #include <folly/Synchronized.h>
+#include <folly/Try.h>
 
 #include "eden/fs/eden-config.h"
 #include "eden/fs/store/BackingStore.h"
 #include "eden/fs/store/LocalStore.h"
 #include "eden/fs/store/ObjectFetchContext.h"
 #include "eden/fs/store/hg/HgDatapackStore.h"
+#include "eden/fs/store/hg/HgProxyHashIndex.h"
 #include "eden/fs/store/hg/MetadataImporter.h"
 #include "eden/fs/telemetry/RequestMetricsScope.h"
 #include "eden/fs/utils/PathFuncs.h"
@@ -33,6 +36,7 @@ class LocalStore;
 class UnboundedQueueExecutor;
 class ReloadableConfig;
 class HgProxyHash;
+class TreeMetadataBatcher;
 
 /**
  * An implementation class for HgQueuedBackingStore that loads data out of a
@@ -68,6 +72,17 @@ class HgBackingStore {
       std::shared_ptr<EdenStats>,
       MetadataImporterFactory metadataImporter);
 
+  /**
+   * Create an HgBackingStore reading from the given datapack store rather
+   * than from a repository, for benchmarks. There is no hg importer to fall
+   * back on, so the datapack store has to find every object.
+   */
+  HgBackingStore(
+      std::unique_ptr<HgDatapackStore> datapackStore,
+      std::shared_ptr<LocalStore> localStore,
+      std::shared_ptr<ReloadableConfig> config,
+      std::shared_ptr<EdenStats> stats);
+
   ~HgBackingStore();
 
   folly::SemiFuture<std::unique_ptr<Tree>> getRootTree(
@@ -81,11 +96,15 @@ class HgBackingStore {
   void getTreeBatch(
       const std::vector<Hash>& ids,
       const std::vector<HgProxyHash>& hashes,
-      std::vector<folly::Promise<std::unique_ptr<Tree>>*> promises,
+      std::vector<folly::Promise<std::shared_ptr<const Tree>>*> promises,
       bool prefetchMetadata);
-  void processTreeMetadata(
-      folly::SemiFuture<std::unique_ptr<TreeMetadata>>&& treeMetadataFuture,
-      const Tree& tree);
+
+  /**
+   * Fetch and store the metadata of the entries of the tree, when the
+   * MetadataImporter supports it. The fetches are batched by the
+   * TreeMetadataBatcher.
+   */
+  void fetchTreeMetadata(const Tree& tree, const Hash& manifestId);
 
   /**
    * Retrieve a tree from hgcache. This function may return `nullptr` when it
@@ -139,16 +158,32 @@ class HgBackingStore {
    *        )
    *    gets the watches timing live blob imports
    */
-  RequestMetricsScope::LockedRequestWatchList& getLiveImportWatches(
-      HgImportObject object) const;
+  RequestWatchList& getLiveImportWatches(HgImportObject object) const;
 
   // Get blob step functions
 
   folly::SemiFuture<std::unique_ptr<Blob>> fetchBlobFromHgImporter(
       HgProxyHash hgInfo);
 
+  /**
+   * Fetch the blobs through the debugedenimporthelper processes. The blobs
+   * are split in groups of HgImporter::kMaxPipelinedRequests, spread over
+   * the import threads, each one pipelining its group over its own helper.
+   * The result has one entry per hgInfo, in order: a helper that fails only
+   * fails the blobs of its own group.
+   */
+  folly::SemiFuture<std::vector<folly::Try<std::unique_ptr<Blob>>>>
+  fetchBlobsFromHgImporter(std::vector<HgProxyHash> hgInfos);
+
   HgDatapackStore& getDatapackStore() {
-    return datapackStore_;
+    return *datapackStore_;
+  }
+
+  /**
+   * The proxy hashes of the recently imported trees and their entries.
+   */
+  HgProxyHashIndex& getProxyHashIndex() {
+    return proxyHashIndex_;
   }
 
   MetadataImporter& getMetadataImporter() {
@@ -222,15 +257,18 @@ class HgBackingStore {
   folly::Executor* serverThreadPool_;
 
   std::string repoName_;
-  HgDatapackStore datapackStore_;
+  // Declared before, and thus outlives, the datapack store populating it.
+  HgProxyHashIndex proxyHashIndex_;
+  std::unique_ptr<HgDatapackStore> datapackStore_;
 
-  std::unique_ptr<MetadataImporter> metadataImporter_;
+  // Shared with the in-flight batches of the metadataBatcher_.
+  std::shared_ptr<MetadataImporter> metadataImporter_;
+  std::shared_ptr<TreeMetadataBatcher> metadataBatcher_;
 
   // Track metrics for imports currently fetching data from hg
-  mutable RequestMetricsScope::LockedRequestWatchList liveImportBlobWatches_;
-  mutable RequestMetricsScope::LockedRequestWatchList liveImportTreeWatches_;
-  mutable RequestMetricsScope::LockedRequestWatchList
-      liveImportPrefetchWatches_;
+  mutable RequestWatchList liveImportBlobWatches_;
+  mutable RequestWatchList liveImportTreeWatches_;
+  mutable RequestWatchList liveImportPrefetchWatches_;
 };
 
 } // namespace facebook::eden
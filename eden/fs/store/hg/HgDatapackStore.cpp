@@ -18,6 +18,7 @@
 #include "eden/fs/model/Tree.h"
 #include "eden/fs/model/TreeEntry.h"
 #include "eden/fs/store/hg/HgProxyHash.h"
+#include "eden/fs/store/hg/HgProxyHashIndex.h"
 #include "eden/fs/store/hg/ScsProxyHash.h"
 #include "eden/fs/utils/Bug.h"
 
@@ -40,9 +41,10 @@ TreeEntryType fromRawTreeEntryType(RustTreeEntryType type) {
 }
 
 TreeEntry fromRawTreeEntry(
-    RustTreeEntry entry,
+    const RustTreeEntry& entry,
     RelativePathPiece path,
     LocalStore::WriteBatch* writeBatch,
+    HgProxyHashIndex& proxyHashIndex,
     const std::optional<Hash>& commitHash) {
   std::optional<uint64_t> size;
   std::optional<Hash> contentSha1;
@@ -59,7 +61,7 @@ TreeEntry fromRawTreeEntry(
   auto hash = Hash{entry.hash};
 
   auto fullPath = path + name;
-  auto proxyHash = HgProxyHash::store(fullPath, hash, writeBatch);
+  auto proxyHash = proxyHashIndex.store(fullPath, hash, writeBatch);
   if (commitHash) {
     ScsProxyHash::store(proxyHash, fullPath, commitHash.value(), writeBatch);
   }
@@ -77,14 +79,15 @@ FOLLY_MAYBE_UNUSED std::unique_ptr<Tree> fromRawTree(
     const Hash& edenTreeId,
     RelativePathPiece path,
     LocalStore::WriteBatch* writeBatch,
+    HgProxyHashIndex& proxyHashIndex,
     const std::optional<Hash>& commitHash) {
   std::vector<TreeEntry> entries;
+  entries.reserve(tree->length);
 
   for (uintptr_t i = 0; i < tree->length; i++) {
     try {
-      auto entry =
-          fromRawTreeEntry(tree->entries[i], path, writeBatch, commitHash);
-      entries.push_back(entry);
+      entries.push_back(fromRawTreeEntry(
+          tree->entries[i], path, writeBatch, proxyHashIndex, commitHash));
     } catch (const PathComponentContainsDirectorySeparator& ex) {
       XLOG(WARN) << "Ignoring directory entry: " << ex.what();
     }
@@ -102,10 +105,10 @@ FOLLY_MAYBE_UNUSED std::unique_ptr<Tree> fromRawTree(
 std::unique_ptr<Blob> HgDatapackStore::getBlobLocal(
     const Hash& id,
     const HgProxyHash& hgInfo) {
-  auto content = store_.getBlob(
+  auto content = store_->getBlob(
       hgInfo.path().stringPiece(), hgInfo.revHash().getBytes(), true);
   if (content) {
-    return std::make_unique<Blob>(id, *content);
+    return std::make_unique<Blob>(id, std::move(*content));
   }
 
   return nullptr;
@@ -115,13 +118,14 @@ std::unique_ptr<Tree> HgDatapackStore::getTreeLocal(
     const Hash& edenTreeId,
     const HgProxyHash& proxyHash,
     LocalStore& localStore) {
-  auto tree = store_.getTree(proxyHash.byteHash(), /*local=*/true);
+  auto tree = store_->getTree(proxyHash.byteHash(), /*local=*/true);
   if (tree) {
     return fromRawTree(
         tree.get(),
         edenTreeId,
         proxyHash.path(),
         localStore.beginWrite().get(),
+        *proxyHashIndex_,
         std::nullopt);
   }
 
@@ -131,7 +135,7 @@ std::unique_ptr<Tree> HgDatapackStore::getTreeLocal(
 void HgDatapackStore::getBlobBatch(
     const std::vector<Hash>& ids,
     const std::vector<HgProxyHash>& hashes,
-    std::vector<folly::Promise<std::unique_ptr<Blob>>*> promises) {
+    std::vector<folly::Promise<std::shared_ptr<const Blob>>*> promises) {
   std::vector<Hash> blobhashes;
   std::vector<std::pair<folly::ByteRange, folly::ByteRange>> requests;
 
@@ -156,7 +160,7 @@ void HgDatapackStore::getBlobBatch(
         folly::ByteRange{hash->path().stringPiece()}, blobhash->getBytes()));
   }
 
-  store_.getBlobBatch(
+  store_->getBlobBatch(
       requests,
       false,
       [promises = std::move(promises), ids, requests](
@@ -166,8 +170,8 @@ void HgDatapackStore::getBlobBatch(
             "Imported name={} node={}",
             folly::StringPiece{requests[index].first},
             folly::hexlify(requests[index].second));
-        auto blob = std::make_unique<Blob>(ids[index], *content);
-        promises[index]->setValue(std::move(blob));
+        promises[index]->setValue(
+            std::make_shared<Blob>(ids[index], std::move(*content)));
       });
 }
 
@@ -200,10 +204,15 @@ void HgDatapackStore::getTreeBatch(
         folly::ByteRange{hash->path().stringPiece()}, treehash->getBytes()));
   }
 
-  store_.getTreeBatch(
+  store_->getTreeBatch(
       requests,
       false,
-      [promises = promises, ids = ids, hashes = hashes, writeBatch, requests](
+      [promises = promises,
+       ids = ids,
+       hashes = hashes,
+       writeBatch,
+       requests,
+       proxyHashIndex = proxyHashIndex_](
           size_t index, std::shared_ptr<RustTree> content) mutable {
         (*promises)[index].setWith([&] {
           XLOGF(
@@ -216,6 +225,7 @@ void HgDatapackStore::getTreeBatch(
               ids[index],
               hashes[index].path(),
               writeBatch,
+              *proxyHashIndex,
               std::optional<Hash>());
         });
       });
@@ -234,21 +244,22 @@ std::unique_ptr<Tree> HgDatapackStore::getTree(
   // cache miss, and just doing it for root trees is sufficient to detect the
   // scenario where Mercurial just wrote a brand new tree.
   bool local_only = path.empty();
-  auto tree = store_.getTree(manifestId.getBytes(), local_only);
+  auto tree = store_->getTree(manifestId.getBytes(), local_only);
   if (!tree && local_only) {
     // Mercurial might have just written the tree to the store. Refresh the
     // store and try again, this time allowing remote fetches.
-    store_.refresh();
-    tree = store_.getTree(manifestId.getBytes(), false);
+    store_->refresh();
+    tree = store_->getTree(manifestId.getBytes(), false);
   }
   if (tree) {
-    return fromRawTree(tree.get(), edenTreeId, path, writeBatch, commitHash);
+    return fromRawTree(
+        tree.get(), edenTreeId, path, writeBatch, *proxyHashIndex_, commitHash);
   }
   return nullptr;
 }
 
 void HgDatapackStore::refresh() {
-  store_.refresh();
+  store_->refresh();
 }
 
 } // namespace facebook::eden
@@ -9,6 +9,7 @@
 
 #include <folly/Range.h>
 #include <folly/futures/Promise.h>
+#include <optional>
 
 #include "eden/fs/model/Blob.h"
 #include "eden/fs/store/LocalStore.h"
@@ -18,23 +19,36 @@
 namespace facebook::eden {
 
 class HgProxyHash;
+class HgProxyHashIndex;
 
 class HgDatapackStore {
  public:
-  HgDatapackStore(AbsolutePathPiece repository, bool useEdenApi)
-      : store_{repository.stringPiece(), useEdenApi} {}
+  /**
+   * The proxy hashes of the entries of the imported trees are added to
+   * proxyHashIndex, which must outlive this store.
+   */
+  HgDatapackStore(
+      AbsolutePathPiece repository,
+      bool useEdenApi,
+      HgProxyHashIndex* proxyHashIndex)
+      : store_{std::in_place, repository.stringPiece(), useEdenApi},
+        proxyHashIndex_{proxyHashIndex} {}
+
+  virtual ~HgDatapackStore() = default;
 
   /**
    * Imports the blob identified by the given hash from the local store.
    * Returns nullptr if not found.
    */
-  std::unique_ptr<Blob> getBlobLocal(const Hash& id, const HgProxyHash& hgInfo);
+  virtual std::unique_ptr<Blob> getBlobLocal(
+      const Hash& id,
+      const HgProxyHash& hgInfo);
 
   /**
    * Imports the tree identified by the given hash from the local store.
    * Returns nullptr if not found.
    */
-  std::unique_ptr<Tree> getTreeLocal(
+  virtual std::unique_ptr<Tree> getTreeLocal(
       const Hash& edenTreeId,
       const HgProxyHash& proxyHash,
       LocalStore& localStore);
@@ -44,28 +58,36 @@ class HgDatapackStore {
    * length. Promises passed in will be resolved if a blob is successfully
    * imported. Otherwise the promise will be left untouched.
    */
-  void getBlobBatch(
+  virtual void getBlobBatch(
       const std::vector<Hash>& ids,
       const std::vector<HgProxyHash>& hashes,
-      std::vector<folly::Promise<std::unique_ptr<Blob>>*> promises);
+      std::vector<folly::Promise<std::shared_ptr<const Blob>>*> promises);
 
-  void getTreeBatch(
+  virtual void getTreeBatch(
       const std::vector<Hash>& ids,
       const std::vector<HgProxyHash>& hashes,
       LocalStore::WriteBatch* writeBatch,
       std::vector<folly::Promise<std::unique_ptr<Tree>>>* promises);
 
-  std::unique_ptr<Tree> getTree(
+  virtual std::unique_ptr<Tree> getTree(
       const RelativePath& path,
       const Hash& manifestId,
       const Hash& edenTreeId,
       LocalStore::WriteBatch* writeBatch,
       const std::optional<Hash>& commitHash);
 
-  void refresh();
+  virtual void refresh();
+
+ protected:
+  /**
+   * For subclasses serving the objects without a repository, like the mock
+   * stores of the benchmarks, which override every method.
+   */
+  HgDatapackStore() = default;
 
  private:
-  HgNativeBackingStore store_;
+  std::optional<HgNativeBackingStore> store_;
+  HgProxyHashIndex* proxyHashIndex_{nullptr};
 };
 
 } // namespace facebook::eden
@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/hg/HgImportBatchSizer.h"
+
+#include <algorithm>
+
+namespace facebook::eden {
+
+size_t HgImportBatchSizer::getBatchSize(
+    size_t maxSize,
+    std::chrono::nanoseconds targetLatency) {
+  maxSize = std::max<size_t>(maxSize, 1);
+  if (targetLatency.count() <= 0 || size_ == 0) {
+    size_ = maxSize;
+  }
+  // The configured size may have been lowered since the last batch.
+  size_ = std::min(size_, maxSize);
+  return size_;
+}
+
+void HgImportBatchSizer::recordBatch(
+    size_t batchSize,
+    std::chrono::nanoseconds latency,
+    size_t maxSize,
+    std::chrono::nanoseconds targetLatency) {
+  if (targetLatency.count() <= 0 || size_ == 0) {
+    return;
+  }
+  if (latency > targetLatency) {
+    size_ = std::max<size_t>(size_ / 2, 1);
+  } else if (batchSize >= size_) {
+    size_ = std::min(size_ + 1, std::max<size_t>(maxSize, 1));
+  }
+}
+
+} // namespace facebook::eden
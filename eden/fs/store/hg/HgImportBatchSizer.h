@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+namespace facebook::eden {
+
+/**
+ * Sizes the import batches of one request type from the latency of the
+ * previous ones, with an additive increase, multiplicative decrease scheme.
+ *
+ * A batch that took longer than the target latency halves the size of the
+ * next ones. A batch that was full and met the target grows the next ones
+ * by one request. Since a batch can only be full when enough requests were
+ * queued, the size only grows while the queue is deep enough to need it.
+ *
+ * The configured batch size is both the starting point and the upper
+ * bound, and a zero target latency keeps the size fixed to it.
+ *
+ * This class isn't thread safe, the HgImportRequestQueue protects it with
+ * its lock.
+ */
+class HgImportBatchSizer {
+ public:
+  /**
+   * The size of the next batch, no larger than maxSize.
+   */
+  size_t getBatchSize(size_t maxSize, std::chrono::nanoseconds targetLatency);
+
+  /**
+   * Adjust the size of the next batches after a batch of batchSize requests
+   * took the given latency to import.
+   */
+  void recordBatch(
+      size_t batchSize,
+      std::chrono::nanoseconds latency,
+      size_t maxSize,
+      std::chrono::nanoseconds targetLatency);
+
+ private:
+  /**
+   * Zero until the first batch is sized, to start from the configured size.
+   */
+  size_t size_{0};
+};
+
+} // namespace facebook::eden
@@ -8,6 +8,9 @@
 #pragma once
 
 #include <folly/futures/Promise.h>
+#include <folly/portability/SysTypes.h>
+#include <folly/small_vector.h>
+#include <optional>
 #include <utility>
 #include <variant>
 
@@ -30,8 +33,15 @@ namespace facebook::eden {
  */
 class HgImportRequest {
  public:
+  /**
+   * The promises of the duplicate requests. Most requests have at most one
+   * duplicate, which is stored inline.
+   */
+  template <typename Response>
+  using PromiseList = folly::small_vector<folly::Promise<Response>, 1>;
+
   struct BlobImport {
-    using Response = std::unique_ptr<Blob>;
+    using Response = std::shared_ptr<const Blob>;
     BlobImport(Hash hash, HgProxyHash proxyHash)
         : hash(hash), proxyHash(proxyHash) {}
 
@@ -40,11 +50,11 @@ class HgImportRequest {
 
     // In the case where requests de-duplicate to this one, the requests
     // promise will be enqueued to the following vector.
-    std::vector<folly::Promise<Response>> promises;
+    PromiseList<Response> promises;
   };
 
   struct TreeImport {
-    using Response = std::unique_ptr<Tree>;
+    using Response = std::shared_ptr<const Tree>;
     TreeImport(Hash hash, HgProxyHash proxyHash, bool prefetchMetadata = true)
         : hash(hash),
           proxyHash(proxyHash),
@@ -57,7 +67,7 @@ class HgImportRequest {
     bool prefetchMetadata;
 
     // See the comment above for BlobImport::promises
-    std::vector<folly::Promise<Response>> promises;
+    PromiseList<Response> promises;
   };
 
   struct Prefetch {
@@ -127,6 +137,18 @@ class HgImportRequest {
     priority_ = priority;
   }
 
+  /**
+   * The process that caused the request, which HgImportRequestQueue uses to
+   * share the imports fairly between processes.
+   */
+  std::optional<pid_t> getClientPid() const noexcept {
+    return clientPid_;
+  }
+
+  void setClientPid(std::optional<pid_t> clientPid) noexcept {
+    clientPid_ = clientPid;
+  }
+
   template <typename T>
   folly::Promise<T>* getPromise() {
     auto promise = std::get_if<folly::Promise<T>>(&promise_); // Promise<T>
@@ -159,13 +181,14 @@ class HgImportRequest {
 
   using Request = std::variant<BlobImport, TreeImport, Prefetch>;
   using Response = std::variant<
-      folly::Promise<std::unique_ptr<Blob>>,
-      folly::Promise<std::unique_ptr<Tree>>,
+      folly::Promise<std::shared_ptr<const Blob>>,
+      folly::Promise<std::shared_ptr<const Tree>>,
       folly::Promise<folly::Unit>>;
 
   Request request_;
   ImportPriority priority_;
   Response promise_;
+  std::optional<pid_t> clientPid_;
   uint64_t unique_ = generateUniqueID();
   std::chrono::steady_clock::time_point requestTime_ =
       std::chrono::steady_clock::now();
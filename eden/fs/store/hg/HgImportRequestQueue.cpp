@@ -12,6 +12,127 @@
 
 namespace facebook::eden {
 
+namespace {
+bool comparePriority(
+    const std::shared_ptr<HgImportRequest>& lhs,
+    const std::shared_ptr<HgImportRequest>& rhs) {
+  return (*lhs) < (*rhs);
+}
+
+size_t kindIndex(const HgImportRequest& request) {
+  return static_cast<size_t>(request.getPriority().kind);
+}
+
+pid_t clientKey(const HgImportRequest& request) {
+  // Requests without a client share a single turn.
+  return request.getClientPid().value_or(0);
+}
+} // namespace
+
+bool HgImportRequestQueue::TypeQueue::empty() const {
+  return std::all_of(kinds.begin(), kinds.end(), [](const KindQueue& kind) {
+    return kind.size == 0;
+  });
+}
+
+void HgImportRequestQueue::TypeQueue::clear() {
+  for (auto& kind : kinds) {
+    kind = KindQueue{};
+  }
+}
+
+void HgImportRequestQueue::TypeQueue::push(
+    std::shared_ptr<HgImportRequest> request) {
+  auto& kind = kinds[kindIndex(*request)];
+  if (kind.size == 0) {
+    // Measure the wait of an idle kind from its first request.
+    kind.lastServed = std::chrono::steady_clock::now();
+  }
+  auto client = clientKey(*request);
+  auto& heap = kind.clients[client];
+  if (heap.empty()) {
+    kind.rotation.push_back(client);
+  }
+  heap.push_back(std::move(request));
+  std::push_heap(heap.begin(), heap.end(), comparePriority);
+  ++kind.size;
+}
+
+bool HgImportRequestQueue::TypeQueue::remove(
+    const std::shared_ptr<HgImportRequest>& request) {
+  auto& kind = kinds[kindIndex(*request)];
+  auto client = clientKey(*request);
+  auto heapIt = kind.clients.find(client);
+  if (heapIt == kind.clients.end()) {
+    return false;
+  }
+  auto& heap = heapIt->second;
+  auto it = std::find(heap.begin(), heap.end(), request);
+  if (it == heap.end()) {
+    return false;
+  }
+  heap.erase(it);
+  std::make_heap(heap.begin(), heap.end(), comparePriority);
+  --kind.size;
+  if (heap.empty()) {
+    kind.clients.erase(heapIt);
+    kind.rotation.erase(
+        std::find(kind.rotation.begin(), kind.rotation.end(), client));
+  }
+  return true;
+}
+
+std::shared_ptr<HgImportRequest> HgImportRequestQueue::TypeQueue::pop(
+    size_t index) {
+  auto& kind = kinds[index];
+  auto client = kind.rotation.front();
+  kind.rotation.pop_front();
+  auto heapIt = kind.clients.find(client);
+  auto& heap = heapIt->second;
+
+  std::pop_heap(heap.begin(), heap.end(), comparePriority);
+  auto request = std::move(heap.back());
+  heap.pop_back();
+  if (heap.empty()) {
+    kind.clients.erase(heapIt);
+  } else {
+    kind.rotation.push_back(client);
+  }
+  --kind.size;
+  kind.lastServed = std::chrono::steady_clock::now();
+  return request;
+}
+
+std::pair<size_t, ImportPriority> HgImportRequestQueue::TypeQueue::next(
+    std::chrono::steady_clock::time_point now,
+    std::chrono::steady_clock::duration agingInterval) const {
+  constexpr auto kMaxAgedKind =
+      static_cast<size_t>(ImportPriorityKind::Normal);
+
+  std::optional<std::pair<size_t, ImportPriority>> best;
+  for (size_t index = 0; index < kinds.size(); ++index) {
+    const auto& kind = kinds[index];
+    if (kind.size == 0) {
+      continue;
+    }
+    auto effectiveKind = index;
+    if (canAge && agingInterval.count() > 0 && index < kMaxAgedKind) {
+      auto promotions =
+          static_cast<size_t>((now - kind.lastServed) / agingInterval);
+      effectiveKind = std::min(index + promotions, kMaxAgedKind);
+    }
+    const auto& head = kind.clients.at(kind.rotation.front()).front();
+    ImportPriority priority{
+        static_cast<ImportPriorityKind>(effectiveKind),
+        head->getPriority().offset};
+    // On a tie, the kind that wasn't promoted goes first.
+    if (!best || !(priority < best->second)) {
+      best = std::make_pair(index, priority);
+    }
+  }
+  return *best;
+}
+
 void HgImportRequestQueue::stop() {
   auto state = state_.lock();
   if (state->running) {
@@ -20,15 +141,15 @@ void HgImportRequestQueue::stop() {
   }
 }
 
-folly::Future<std::unique_ptr<Blob>> HgImportRequestQueue::enqueueBlob(
+folly::Future<std::shared_ptr<const Blob>> HgImportRequestQueue::enqueueBlob(
     std::shared_ptr<HgImportRequest> request) {
-  return enqueue<std::unique_ptr<Blob>, HgImportRequest::BlobImport>(
+  return enqueue<std::shared_ptr<const Blob>, HgImportRequest::BlobImport>(
       std::move(request));
 }
 
-folly::Future<std::unique_ptr<Tree>> HgImportRequestQueue::enqueueTree(
+folly::Future<std::shared_ptr<const Tree>> HgImportRequestQueue::enqueueTree(
     std::shared_ptr<HgImportRequest> request) {
-  return enqueue<std::unique_ptr<Tree>, HgImportRequest::TreeImport>(
+  return enqueue<std::shared_ptr<const Tree>, HgImportRequest::TreeImport>(
       std::move(request));
 }
 
@@ -42,7 +163,7 @@ folly::Future<Ret> HgImportRequestQueue::enqueue(
     std::shared_ptr<HgImportRequest> request) {
   auto state = state_.lock();
 
-  std::vector<std::shared_ptr<HgImportRequest>>* queue;
+  TypeQueue* queue;
   if constexpr (std::is_same_v<ImportType, HgImportRequest::BlobImport>) {
     queue = &state->blobQueue;
   } else if constexpr (std::
@@ -65,27 +186,25 @@ folly::Future<Ret> HgImportRequestQueue::enqueue(
       trackedImport->promises.emplace_back(std::move(promise));
 
       if (existingRequest->getPriority() < request->getPriority()) {
-        existingRequest->setPriority(request->getPriority());
-
         // Since the new request has a higher priority than the already present
-        // one, we need to re-order the heap.
+        // one, we need to move it to its new place in the queue, unless it is
+        // already being imported.
         //
         // TODO(xavierd): this has a O(n) complexity, and enqueing tons of
         // duplicated requests will thus lead to a quadratic complexity.
-        std::make_heap(
-            queue->begin(),
-            queue->end(),
-            [](const std::shared_ptr<HgImportRequest>& lhs,
-               const std::shared_ptr<HgImportRequest>& rhs) {
-              return (*lhs) < (*rhs);
-            });
+        if (queue->remove(existingRequest)) {
+          existingRequest->setPriority(request->getPriority());
+          queue->push(existingRequest);
+        } else {
+          existingRequest->setPriority(request->getPriority());
+        }
       }
 
       return std::move(future).toUnsafeFuture();
     }
   }
 
-  queue->emplace_back(request);
+  queue->push(request);
   auto promise = request->getPromise<Ret>();
 
   if constexpr (!std::is_same_v<ImportType, HgImportRequest::Prefetch>) {
@@ -93,14 +212,6 @@ folly::Future<Ret> HgImportRequestQueue::enqueue(
     state->requestTracker.emplace(hash, std::move(request));
   }
 
-  std::push_heap(
-      queue->begin(),
-      queue->end(),
-      [](const std::shared_ptr<HgImportRequest>& lhs,
-         const std::shared_ptr<HgImportRequest>& rhs) {
-        return (*lhs) < (*rhs);
-      });
-
   queueCV_.notify_one();
 
   return promise->getFuture();
@@ -108,7 +219,7 @@ folly::Future<Ret> HgImportRequestQueue::enqueue(
 
 std::vector<std::shared_ptr<HgImportRequest>> HgImportRequestQueue::dequeue() {
   size_t count;
-  std::vector<std::shared_ptr<HgImportRequest>>* queue = nullptr;
+  TypeQueue* queue = nullptr;
 
   auto state = state_.lock();
   while (true) {
@@ -119,6 +230,11 @@ std::vector<std::shared_ptr<HgImportRequest>> HgImportRequestQueue::dequeue() {
       return std::vector<std::shared_ptr<HgImportRequest>>();
     }
 
+    auto now = std::chrono::steady_clock::now();
+    auto agingInterval =
+        config_->getEdenConfig()->importAgingInterval.getValue();
+    auto targetLatency =
+        config_->getEdenConfig()->importBatchTargetLatency.getValue();
     ImportPriority highestPriority{ImportPriorityKind::Low, 0};
 
     // Trees have a higher priority than blobs who themself have a higher
@@ -127,23 +243,29 @@ std::vector<std::shared_ptr<HgImportRequest>> HgImportRequestQueue::dequeue() {
     // higher fan-out and thus increasing concurrency of fetches which
     // translate onto a higher overall throughput.
     if (!state->treeQueue.empty()) {
-      count = config_->getEdenConfig()->importBatchSizeTree.getValue();
-      highestPriority = state->treeQueue.front()->getPriority();
+      count = state->treeBatchSizer.getBatchSize(
+          config_->getEdenConfig()->importBatchSizeTree.getValue(),
+          targetLatency);
+      highestPriority = state->treeQueue.next(now, agingInterval).second;
       queue = &state->treeQueue;
     }
 
     if (!state->blobQueue.empty()) {
-      auto priority = state->blobQueue.front()->getPriority();
+      auto priority = state->blobQueue.next(now, agingInterval).second;
       if (!queue || priority > highestPriority) {
         queue = &state->blobQueue;
-        count = config_->getEdenConfig()->importBatchSize.getValue();
+        count = state->blobBatchSizer.getBatchSize(
+            config_->getEdenConfig()->importBatchSize.getValue(),
+            targetLatency);
         highestPriority = priority;
       }
     }
 
+    // Prefetches only run ahead of tree and blob imports of a lower kind, so
+    // that interactive reads never wait for a background prefetch.
     if (!state->prefetchQueue.empty()) {
-      auto priority = state->prefetchQueue.front()->getPriority();
-      if (!queue || priority > highestPriority) {
+      auto priority = state->prefetchQueue.next(now, agingInterval).second;
+      if (!queue || priority.kind > highestPriority.kind) {
         queue = &state->prefetchQueue;
         count = 1;
       }
@@ -156,23 +278,37 @@ std::vector<std::shared_ptr<HgImportRequest>> HgImportRequestQueue::dequeue() {
     }
   }
 
-  count = std::min(count, queue->size());
+  auto now = std::chrono::steady_clock::now();
+  auto agingInterval = config_->getEdenConfig()->importAgingInterval.getValue();
   std::vector<std::shared_ptr<HgImportRequest>> result;
   result.reserve(count);
-  for (size_t i = 0; i < count; i++) {
-    std::pop_heap(
-        queue->begin(),
-        queue->end(),
-        [](const std::shared_ptr<HgImportRequest>& lhs,
-           const std::shared_ptr<HgImportRequest>& rhs) {
-          return (*lhs) < (*rhs);
-        });
-
-    result.emplace_back(std::move(queue->back()));
-    queue->pop_back();
+  for (size_t i = 0; i < count && !queue->empty(); i++) {
+    result.emplace_back(queue->pop(queue->next(now, agingInterval).first));
   }
 
   return result;
 }
 
+void HgImportRequestQueue::recordTreeBatch(
+    size_t batchSize,
+    std::chrono::nanoseconds latency) {
+  auto config = config_->getEdenConfig();
+  state_.lock()->treeBatchSizer.recordBatch(
+      batchSize,
+      latency,
+      config->importBatchSizeTree.getValue(),
+      config->importBatchTargetLatency.getValue());
+}
+
+void HgImportRequestQueue::recordBlobBatch(
+    size_t batchSize,
+    std::chrono::nanoseconds latency) {
+  auto config = config_->getEdenConfig();
+  state_.lock()->blobBatchSizer.recordBatch(
+      batchSize,
+      latency,
+      config->importBatchSize.getValue(),
+      config->importBatchTargetLatency.getValue());
+}
+
 } // namespace facebook::eden
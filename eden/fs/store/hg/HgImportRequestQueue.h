@@ -10,10 +10,14 @@
 #include <folly/Synchronized.h>
 #include <folly/Try.h>
 #include <folly/container/F14Map.h>
+#include <array>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <mutex>
 #include <vector>
 #include "eden/fs/model/Hash.h"
+#include "eden/fs/store/hg/HgImportBatchSizer.h"
 #include "eden/fs/store/hg/HgImportRequest.h"
 #include "folly/futures/Future.h"
 
@@ -21,6 +25,17 @@ namespace facebook::eden {
 
 class ReloadableConfig;
 
+/**
+ * Schedules the import requests of the HgQueuedBackingStore.
+ *
+ * Requests are ordered by the kind of their priority first. Within a kind,
+ * the clients that issued requests are served in turn, so that one busy
+ * process can't monopolize the imports, and the requests of each client
+ * are ordered by their priority. A kind that hasn't been served for
+ * hg:import-aging-interval is promoted by one kind, up to Normal, so that
+ * low priority work eventually runs. Prefetch requests are never promoted,
+ * and only run ahead of tree and blob requests of a lower kind.
+ */
 class HgImportRequestQueue {
  public:
   explicit HgImportRequestQueue(std::shared_ptr<ReloadableConfig> config)
@@ -31,7 +46,7 @@ class HgImportRequestQueue {
    *
    * Return a future that will complete when the blob request completes.
    */
-  folly::Future<std::unique_ptr<Blob>> enqueueBlob(
+  folly::Future<std::shared_ptr<const Blob>> enqueueBlob(
       std::shared_ptr<HgImportRequest> request);
 
   /**
@@ -39,7 +54,7 @@ class HgImportRequestQueue {
    *
    * Return a future that will complete when the blob request completes.
    */
-  folly::Future<std::unique_ptr<Tree>> enqueueTree(
+  folly::Future<std::shared_ptr<const Tree>> enqueueTree(
       std::shared_ptr<HgImportRequest> request);
 
   /**
@@ -57,11 +72,25 @@ class HgImportRequestQueue {
    * item available in the queue.
    *
    * All requests in the vector are guaranteed to be the same type.
-   * The number of the returned requests is controlled by `import-batch-size*`
-   * options in the config. It may have fewer requests than configured.
+   * The number of the returned requests is bounded by the
+   * `import-batch-size*` options in the config, and adapted to the latency
+   * reported by recordTreeBatch and recordBlobBatch. It may have fewer
+   * requests than configured.
    */
   std::vector<std::shared_ptr<HgImportRequest>> dequeue();
 
+  /**
+   * Report how long importing a batch of tree requests took, to size the
+   * next tree batches.
+   */
+  void recordTreeBatch(size_t batchSize, std::chrono::nanoseconds latency);
+
+  /**
+   * Report how long importing a batch of blob requests took, to size the
+   * next blob batches.
+   */
+  void recordBlobBatch(size_t batchSize, std::chrono::nanoseconds latency);
+
   /**
    * Destroy the queue.
    *
@@ -75,7 +104,7 @@ class HgImportRequestQueue {
   template <typename T>
   void markImportAsFinished(
       const Hash& id,
-      folly::Try<std::unique_ptr<T>>& importTry) {
+      folly::Try<std::shared_ptr<const T>>& importTry) {
     std::shared_ptr<HgImportRequest> import;
     {
       auto state = state_.lock();
@@ -91,7 +120,7 @@ class HgImportRequestQueue {
       return;
     }
 
-    std::vector<folly::Promise<std::unique_ptr<T>>>* promises;
+    HgImportRequest::PromiseList<std::shared_ptr<const T>>* promises;
 
     if constexpr (std::is_same_v<T, Tree>) {
       auto* treeImport = import->getRequest<HgImportRequest::TreeImport>();
@@ -106,10 +135,10 @@ class HgImportRequestQueue {
 
     if (importTry.hasValue()) {
       // If we find the id in the map, loop through all of the associated
-      // Promises and fulfill them with the obj. We need to construct a
-      // deep copy of the unique_ptr to fulfill the Promises
+      // Promises and fulfill them with the obj. It is immutable, so they all
+      // share it rather than each getting a copy.
       for (auto& promise : (*promises)) {
-        promise.setValue(std::make_unique<T>(*(importTry.value())));
+        promise.setValue(importTry.value());
       }
     } else {
       // If we find the id in the map, loop through all of the associated
@@ -130,11 +159,48 @@ class HgImportRequestQueue {
   HgImportRequestQueue(HgImportRequestQueue&&) = delete;
   HgImportRequestQueue& operator=(HgImportRequestQueue&&) = delete;
 
+  /**
+   * The requests of one type and priority kind, kept in a heap per client.
+   * The clients with queued requests take turns in `rotation`.
+   */
+  struct KindQueue {
+    folly::F14FastMap<pid_t, std::vector<std::shared_ptr<HgImportRequest>>>
+        clients;
+    std::deque<pid_t> rotation;
+    size_t size = 0;
+    std::chrono::steady_clock::time_point lastServed;
+  };
+
+  struct TypeQueue {
+    explicit TypeQueue(bool canAge) : canAge{canAge} {}
+
+    bool empty() const;
+    void clear();
+
+    void push(std::shared_ptr<HgImportRequest> request);
+    bool remove(const std::shared_ptr<HgImportRequest>& request);
+    std::shared_ptr<HgImportRequest> pop(size_t kind);
+
+    /**
+     * The kind to serve next and the priority it competes with, after
+     * promoting the kinds that have waited too long.
+     */
+    std::pair<size_t, ImportPriority> next(
+        std::chrono::steady_clock::time_point now,
+        std::chrono::steady_clock::duration agingInterval) const;
+
+    const bool canAge;
+    std::array<KindQueue, 3> kinds;
+  };
+
   struct State {
     bool running = true;
-    std::vector<std::shared_ptr<HgImportRequest>> treeQueue;
-    std::vector<std::shared_ptr<HgImportRequest>> blobQueue;
-    std::vector<std::shared_ptr<HgImportRequest>> prefetchQueue;
+    TypeQueue treeQueue{true};
+    TypeQueue blobQueue{true};
+    TypeQueue prefetchQueue{false};
+
+    HgImportBatchSizer treeBatchSizer;
+    HgImportBatchSizer blobBatchSizer;
 
     /**
      * Map of a Hash to an element in the queue. Any changes to this type can
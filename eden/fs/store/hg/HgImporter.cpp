@@ -26,6 +26,7 @@
 #include <unistd.h>
 #endif
 
+#include <algorithm>
 #include <mutex>
 
 #include "eden/fs/model/Blob.h"
@@ -68,6 +69,17 @@ DEFINE_string(
 
 namespace facebook::eden {
 
+std::vector<folly::Try<unique_ptr<Blob>>> Importer::importFileContentsBatch(
+    const std::vector<HgProxyHash>& files) {
+  std::vector<folly::Try<unique_ptr<Blob>>> results;
+  results.reserve(files.size());
+  for (const auto& file : files) {
+    results.push_back(folly::makeTryWith(
+        [&] { return importFileContents(file.path(), file.revHash()); }));
+  }
+  return results;
+}
+
 class HgImporterEofError : public HgImporterError {
  public:
   using HgImporterError::HgImporterError;
@@ -247,6 +259,10 @@ ProcessStatus HgImporter::debugStopHelperProcess() {
   return helper_.wait();
 }
 
+bool HgImporter::isHelperRunning() {
+  return !helper_.terminated();
+}
+
 void HgImporter::stopHelperProcess() {
   if (!helper_.terminated()) {
     helperIn_.close();
@@ -262,7 +278,52 @@ unique_ptr<Blob> HgImporter::importFileContents(
 
   // Ask the import helper process for the file contents
   auto requestID = sendFileRequest(path, blobHash);
+  return readFileResponse(requestID, path, blobHash);
+}
+
+std::vector<folly::Try<unique_ptr<Blob>>> HgImporter::importFileContentsBatch(
+    const std::vector<HgProxyHash>& files) {
+  std::vector<folly::Try<unique_ptr<Blob>>> results;
+  results.reserve(files.size());
+
+  std::vector<TransactionID> requestIDs;
+  for (size_t begin = 0; begin < files.size();
+       begin += kMaxPipelinedRequests) {
+    auto end = std::min(begin + kMaxPipelinedRequests, files.size());
+    requestIDs.clear();
+    for (auto i = begin; i < end; ++i) {
+      requestIDs.push_back(
+          sendFileRequest(files[i].path(), files[i].revHash()));
+    }
+    for (auto i = begin; i < end; ++i) {
+      // An error response is fully read before being thrown, so the next
+      // response can still be read. Failures to communicate with the helper
+      // process, and requests to restart it, are thrown instead so that the
+      // HgImporterManager replaces it.
+      try {
+        results.emplace_back(readFileResponse(
+            requestIDs[i - begin], files[i].path(), files[i].revHash()));
+      } catch (const HgImporterError&) {
+        throw;
+      } catch (const HgImportPyError& ex) {
+        if (ex.errorType() == "ResetRepoError") {
+          throw;
+        }
+        results.emplace_back(
+            folly::exception_wrapper{std::current_exception(), ex});
+      } catch (const std::exception& ex) {
+        results.emplace_back(
+            folly::exception_wrapper{std::current_exception(), ex});
+      }
+    }
+  }
+  return results;
+}
 
+unique_ptr<Blob> HgImporter::readFileResponse(
+    TransactionID requestID,
+    RelativePathPiece path,
+    Hash blobHash) {
   // Read the response.  The response body contains the file contents,
   // which is exactly what we want to return.
   //
@@ -706,6 +767,14 @@ Hash HgImporterManager::resolveManifestNode(StringPiece revName) {
   });
 }
 
+std::vector<folly::Try<unique_ptr<Blob>>>
+HgImporterManager::importFileContentsBatch(
+    const std::vector<HgProxyHash>& files) {
+  return retryOnError([&](HgImporter* importer) {
+    return importer->importFileContentsBatch(files);
+  });
+}
+
 unique_ptr<Blob> HgImporterManager::importFileContents(
     RelativePathPiece path,
     Hash blobHash) {
@@ -728,6 +797,10 @@ std::unique_ptr<IOBuf> HgImporterManager::fetchTree(
 }
 
 HgImporter* HgImporterManager::getImporter() {
+  if (importer_ && !importer_->isHelperRunning()) {
+    resetHgImporter(
+        HgImporterError{"debugedenimporthelper exited between requests"});
+  }
   if (!importer_) {
     importer_ = make_unique<HgImporter>(repoPath_, stats_, importHelperScript_);
   }
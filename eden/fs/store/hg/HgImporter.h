@@ -8,9 +8,11 @@
 #pragma once
 
 #include <folly/Range.h>
+#include <folly/Try.h>
 #include <folly/portability/GFlags.h>
 #include <folly/portability/IOVec.h>
 #include <optional>
+#include <vector>
 
 #include "eden/fs/eden-config.h"
 #include "eden/fs/telemetry/EdenStats.h"
@@ -80,6 +82,15 @@ class Importer {
       RelativePathPiece path,
       Hash blobHash) = 0;
 
+  /**
+   * Import the contents of several files, returning the result of each in
+   * the order of the files.
+   *
+   * By default, the files are imported one after the other.
+   */
+  virtual std::vector<folly::Try<std::unique_ptr<Blob>>>
+  importFileContentsBatch(const std::vector<HgProxyHash>& files);
+
   virtual void prefetchFiles(const std::vector<HgProxyHash>& files) = 0;
 
   /**
@@ -123,12 +134,34 @@ class HgImporter : public Importer {
 
   virtual ~HgImporter();
 
+  /**
+   * The largest number of requests sent to the helper process before their
+   * responses are read. The requests of a window must fit in the pipe to
+   * the helper, or writing them could block while the helper itself blocks
+   * writing a response that isn't read yet.
+   */
+  static constexpr size_t kMaxPipelinedRequests = 8;
+
   ProcessStatus debugStopHelperProcess();
 
+  /**
+   * Whether the helper process is still running. An importer whose helper
+   * exited can't serve any request.
+   */
+  bool isHelperRunning();
+
   Hash resolveManifestNode(folly::StringPiece revName) override;
   std::unique_ptr<Blob> importFileContents(
       RelativePathPiece path,
       Hash blobHash) override;
+
+  /**
+   * Send the requests for up to kMaxPipelinedRequests files before reading
+   * their responses, so that the helper process doesn't wait for a round
+   * trip between each file.
+   */
+  std::vector<folly::Try<std::unique_ptr<Blob>>> importFileContentsBatch(
+      const std::vector<HgProxyHash>& files) override;
   void prefetchFiles(const std::vector<HgProxyHash>& files) override;
   std::unique_ptr<folly::IOBuf> fetchTree(
       RelativePathPiece path,
@@ -243,6 +276,13 @@ class HgImporter : public Importer {
    * of the given file at the specified file revision.
    */
   TransactionID sendFileRequest(RelativePathPiece path, Hash fileRevHash);
+  /**
+   * Read the response to a request sent by sendFileRequest.
+   */
+  std::unique_ptr<Blob> readFileResponse(
+      TransactionID requestID,
+      RelativePathPiece path,
+      Hash blobHash);
   /**
    * Send a request to the helper process, asking it to send us the
    * manifest node (NOT the full manifest!) for the specified revision.
@@ -310,6 +350,8 @@ class HgImporterManager : public Importer {
   std::unique_ptr<Blob> importFileContents(
       RelativePathPiece path,
       Hash blobHash) override;
+  std::vector<folly::Try<std::unique_ptr<Blob>>> importFileContentsBatch(
+      const std::vector<HgProxyHash>& files) override;
   void prefetchFiles(const std::vector<HgProxyHash>& files) override;
   std::unique_ptr<folly::IOBuf> fetchTree(
       RelativePathPiece path,
@@ -319,6 +361,11 @@ class HgImporterManager : public Importer {
   template <typename Fn>
   auto retryOnError(Fn&& fn);
 
+  /**
+   * Return the importer, first replacing it if its helper process exited
+   * since the last request, so that the request isn't sent to a dead
+   * process.
+   */
   HgImporter* getImporter();
   void resetHgImporter(const std::exception& ex);
 
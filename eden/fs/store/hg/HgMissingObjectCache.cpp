@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/hg/HgMissingObjectCache.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace facebook::eden {
+
+HgMissingObjectCache::HgMissingObjectCache(size_t maxEntries)
+    : entries_{folly::in_place, std::max<size_t>(maxEntries, 1)} {}
+
+bool HgMissingObjectCache::isDefinitive(const folly::exception_wrapper& error) {
+  // The LocalStore throws std::domain_error for missing keys, as does the
+  // tree import for malformed manifests.
+  return error.is_compatible_with<std::domain_error>();
+}
+
+std::optional<HgMissingObjectCache::MissingObject> HgMissingObjectCache::get(
+    const Hash& id,
+    clock::time_point now,
+    clock::duration ttl) {
+  if (size_.load(std::memory_order_relaxed) == 0) {
+    return std::nullopt;
+  }
+
+  auto entries = entries_.lock();
+  auto it = entries->find(id);
+  if (it == entries->end()) {
+    return std::nullopt;
+  }
+  if (now - it->second.insertTime >= ttl) {
+    entries->erase(it);
+    size_.store(entries->size(), std::memory_order_relaxed);
+    return std::nullopt;
+  }
+  return it->second.object;
+}
+
+void HgMissingObjectCache::insert(
+    const Hash& id,
+    MissingObject object,
+    clock::time_point now) {
+  auto entries = entries_.lock();
+  entries->set(id, Entry{std::move(object), now});
+  size_.store(entries->size(), std::memory_order_relaxed);
+}
+
+void HgMissingObjectCache::remove(const Hash& id) {
+  if (size_.load(std::memory_order_relaxed) == 0) {
+    return;
+  }
+  auto entries = entries_.lock();
+  entries->erase(id);
+  size_.store(entries->size(), std::memory_order_relaxed);
+}
+
+} // namespace facebook::eden
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/ExceptionWrapper.h>
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <atomic>
+#include <chrono>
+#include <optional>
+
+#include "eden/fs/model/Hash.h"
+
+namespace facebook::eden {
+
+/**
+ * Remembers, for a short while, the objects that the HgQueuedBackingStore
+ * definitively failed to find, so that clients retrying them get the same
+ * error back without going through the import queue again.
+ *
+ * Only the errors that retrying can't fix are kept, see isDefinitive.
+ * Network and importer errors are left to the next fetch to retry.
+ */
+class HgMissingObjectCache {
+ public:
+  using clock = std::chrono::steady_clock;
+
+  explicit HgMissingObjectCache(size_t maxEntries);
+
+  /**
+   * Whether the error of an import would be returned again by retrying it:
+   * the object's proxy hash, or the object itself, isn't present in the
+   * store.
+   */
+  static bool isDefinitive(const folly::exception_wrapper& error);
+
+  struct MissingObject {
+    folly::exception_wrapper error;
+    /**
+     * Whether the fetch failed because the object's proxy hash wasn't
+     * stored yet, rather than in the import itself. Importing a tree that
+     * lists the object stores it.
+     */
+    bool proxyHashMissing;
+  };
+
+  /**
+   * Return the last failed fetch of the object if it was recorded less than
+   * ttl ago, or std::nullopt otherwise.
+   */
+  std::optional<MissingObject>
+  get(const Hash& id, clock::time_point now, clock::duration ttl);
+
+  void insert(const Hash& id, MissingObject object, clock::time_point now);
+
+  void remove(const Hash& id);
+
+ private:
+  struct Entry {
+    MissingObject object;
+    clock::time_point insertTime;
+  };
+
+  folly::Synchronized<folly::EvictingCacheMap<Hash, Entry>> entries_;
+  // Lets lookups skip the lock in the common case of an empty cache.
+  std::atomic<size_t> size_{0};
+};
+
+} // namespace facebook::eden
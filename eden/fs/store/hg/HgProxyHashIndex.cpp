@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/hg/HgProxyHashIndex.h"
+
+#include <folly/futures/Future.h>
+#include <algorithm>
+
+namespace facebook::eden {
+
+HgProxyHashIndex::HgProxyHashIndex(size_t maxEntries) {
+  auto shardEntries = std::max<size_t>(maxEntries / kShardCount, 1);
+  shards_.reserve(kShardCount);
+  for (size_t i = 0; i < kShardCount; ++i) {
+    shards_.push_back(std::make_unique<Shard>(folly::in_place, shardEntries));
+  }
+}
+
+HgProxyHashIndex::Shard& HgProxyHashIndex::getShard(
+    const Hash& edenObjectId) const {
+  // Object IDs are SHA-1 hashes, so any of their bytes is evenly spread.
+  return *shards_[edenObjectId.getBytes()[0] % kShardCount];
+}
+
+std::optional<HgProxyHash> HgProxyHashIndex::get(
+    const Hash& edenObjectId) const {
+  auto shard = getShard(edenObjectId).lock();
+  auto it = shard->find(edenObjectId);
+  if (it == shard->end()) {
+    return std::nullopt;
+  }
+  return it->second;
+}
+
+void HgProxyHashIndex::insert(const Hash& edenObjectId, HgProxyHash proxyHash) {
+  getShard(edenObjectId).lock()->set(edenObjectId, std::move(proxyHash));
+}
+
+HgProxyHash HgProxyHashIndex::load(
+    LocalStore* store,
+    const Hash& edenObjectId,
+    folly::StringPiece context) {
+  if (auto proxyHash = get(edenObjectId)) {
+    return std::move(*proxyHash);
+  }
+  auto proxyHash = HgProxyHash::load(store, edenObjectId, context);
+  insert(edenObjectId, proxyHash);
+  return proxyHash;
+}
+
+folly::Future<std::vector<HgProxyHash>> HgProxyHashIndex::getBatch(
+    LocalStore* store,
+    HashRange blobHashes) {
+  std::vector<std::optional<HgProxyHash>> found;
+  found.reserve(blobHashes.size());
+  std::vector<Hash> missing;
+  for (const auto& hash : blobHashes) {
+    found.push_back(get(hash));
+    if (!found.back()) {
+      missing.push_back(hash);
+    }
+  }
+
+  auto mergeMissing = [this, found = std::move(found)](
+                          std::vector<Hash>&& missingIds,
+                          std::vector<HgProxyHash>&& loaded) mutable {
+    std::vector<HgProxyHash> results;
+    results.reserve(found.size());
+    auto next = loaded.begin();
+    auto nextId = missingIds.begin();
+    for (auto& proxyHash : found) {
+      if (proxyHash) {
+        results.push_back(std::move(*proxyHash));
+      } else {
+        insert(*nextId++, *next);
+        results.push_back(std::move(*next++));
+      }
+    }
+    return results;
+  };
+
+  if (missing.empty()) {
+    return folly::makeFuture(mergeMissing({}, {}));
+  }
+  auto missingIds = std::make_unique<std::vector<Hash>>(std::move(missing));
+  auto missingRange = HashRange{missingIds->data(), missingIds->size()};
+  return HgProxyHash::getBatch(store, missingRange)
+      .thenValue([missingIds = std::move(missingIds),
+                  mergeMissing = std::move(mergeMissing)](
+                     std::vector<HgProxyHash>&& loaded) mutable {
+        return mergeMissing(std::move(*missingIds), std::move(loaded));
+      });
+}
+
+Hash HgProxyHashIndex::store(
+    RelativePathPiece path,
+    Hash hgRevHash,
+    LocalStore::WriteBatch* writeBatch) {
+  auto computedPair = HgProxyHash::prepareToStore(path, hgRevHash);
+  store(computedPair, writeBatch);
+  return computedPair.first;
+}
+
+void HgProxyHashIndex::store(
+    const std::pair<Hash, std::string>& computedPair,
+    LocalStore::WriteBatch* writeBatch) {
+  HgProxyHash::store(computedPair, writeBatch);
+  insert(
+      computedPair.first,
+      HgProxyHash{computedPair.first, computedPair.second});
+}
+
+} // namespace facebook::eden
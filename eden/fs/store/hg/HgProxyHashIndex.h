@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Synchronized.h>
+#include <folly/container/EvictingCacheMap.h>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/store/LocalStore.h"
+#include "eden/fs/store/hg/HgProxyHash.h"
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace folly {
+template <typename T>
+class Future;
+} // namespace folly
+
+namespace facebook::eden {
+
+/**
+ * An in-memory cache of the HgProxyHash of recently imported objects, in
+ * front of the HgProxyHashFamily of the LocalStore.
+ *
+ * Importing a tree stores the proxy hashes of its entries, which are then
+ * needed to fetch them. Remembering them here saves a LocalStore read
+ * before each of these fetches.
+ *
+ * The index holds at most a fixed number of entries, evicting the least
+ * recently used ones. It is sharded to keep the import threads from
+ * contending on a single lock.
+ */
+class HgProxyHashIndex {
+ public:
+  explicit HgProxyHashIndex(size_t maxEntries);
+
+  /**
+   * Return the proxy hash of the object, if it is in the index.
+   */
+  std::optional<HgProxyHash> get(const Hash& edenObjectId) const;
+
+  void insert(const Hash& edenObjectId, HgProxyHash proxyHash);
+
+  /**
+   * Like HgProxyHash::load, but first looking in the index, and adding the
+   * proxy hash loaded from the LocalStore to it.
+   */
+  HgProxyHash
+  load(LocalStore* store, const Hash& edenObjectId, folly::StringPiece context);
+
+  /**
+   * Like HgProxyHash::getBatch, but only reading the proxy hashes missing
+   * from the index from the LocalStore.
+   *
+   * The caller is responsible for keeping the HashRange alive for the duration
+   * of the future.
+   */
+  folly::Future<std::vector<HgProxyHash>> getBatch(
+      LocalStore* store,
+      HashRange blobHashes);
+
+  /**
+   * Like HgProxyHash::store, also adding the proxy hash to the index.
+   */
+  Hash store(
+      RelativePathPiece path,
+      Hash hgRevHash,
+      LocalStore::WriteBatch* writeBatch);
+
+  /**
+   * Like HgProxyHash::store of the data computed by
+   * HgProxyHash::prepareToStore(), also adding the proxy hash to the index.
+   */
+  void store(
+      const std::pair<Hash, std::string>& computedPair,
+      LocalStore::WriteBatch* writeBatch);
+
+ private:
+  using Shard = folly::Synchronized<folly::EvictingCacheMap<Hash, HgProxyHash>>;
+
+  static constexpr size_t kShardCount = 16;
+
+  Shard& getShard(const Hash& edenObjectId) const;
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+} // namespace facebook::eden
@@ -15,6 +15,9 @@
 #include <re2/re2.h>
 
 #include <folly/Range.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/task_queue/LifoSemMPMCQueue.h>
+#include <folly/executors/thread_factory/NamedThreadFactory.h>
 #include <folly/futures/Future.h>
 #include <folly/logging/xlog.h>
 #include <folly/system/ThreadName.h>
@@ -31,23 +34,52 @@
 #include "eden/fs/store/hg/HgProxyHash.h"
 #include "eden/fs/telemetry/EdenStats.h"
 #include "eden/fs/telemetry/RequestMetricsScope.h"
+#include "eden/fs/telemetry/SamplingProfiler.h"
 #include "eden/fs/telemetry/StructuredLogger.h"
 #include "eden/fs/utils/Bug.h"
 #include "eden/fs/utils/EnumValue.h"
 #include "eden/fs/utils/IDGen.h"
 #include "eden/fs/utils/PathFuncs.h"
+#include "eden/fs/utils/ThreadPlacement.h"
 #include "folly/ScopeGuard.h"
 #include "folly/String.h"
 
 namespace facebook::eden {
 
 namespace {
-// 100,000 hg object fetches in a short term is plausible.
-constexpr size_t kTraceBusCapacity = 100000;
+// 100,000 hg object fetches in a short term is plausible, but they are spread
+// over the import threads, and the capacity is per publishing thread.
+constexpr size_t kTraceBusCapacity = 10000;
 static_assert(sizeof(HgImportTraceEvent) == 56);
-// TraceBus is double-buffered, so the following capacity should be doubled.
-// 10 MB overhead per backing repo is tolerable.
-static_assert(kTraceBusCapacity * sizeof(HgImportTraceEvent) == 5600000);
+// A few MB overhead per backing repo is tolerable.
+static_assert(kTraceBusCapacity * sizeof(HgImportTraceEvent) == 560000);
+
+/**
+ * Convert the result of an import to the shared, immutable object handed to
+ * the requests waiting for it.
+ */
+template <typename T>
+folly::Try<std::shared_ptr<const T>> toShared(
+    folly::Try<std::unique_ptr<T>>&& result) {
+  if (result.hasException()) {
+    return folly::Try<std::shared_ptr<const T>>{
+        std::move(result).exception()};
+  }
+  return folly::Try<std::shared_ptr<const T>>{
+      std::shared_ptr<const T>{std::move(result).value()}};
+}
+
+const char* profilerTagOfHgImportObject(HgBackingStore::HgImportObject object) {
+  switch (object) {
+    case HgBackingStore::HgImportObject::BLOB:
+      return "hg_import_blob";
+    case HgBackingStore::HgImportObject::TREE:
+      return "hg_import_tree";
+    case HgBackingStore::HgImportObject::PREFETCH:
+      return "hg_prefetch";
+  }
+  return "hg_import";
+}
 } // namespace
 
 HgImportTraceEvent::HgImportTraceEvent(
@@ -76,14 +108,38 @@ HgQueuedBackingStore::HgQueuedBackingStore(
     : localStore_(std::move(localStore)),
       stats_(std::move(stats)),
       config_(config),
+      missingObjects_{
+          config_
+              ? config_->getEdenConfig()->hgMissingObjectCacheSize.getValue()
+              : 1},
       backingStore_(std::move(backingStore)),
       queue_(std::move(config)),
       structuredLogger_{std::move(structuredLogger)},
       logger_(std::move(logger)),
-      traceBus_{TraceBus<HgImportTraceEvent>::create("hg", kTraceBusCapacity)} {
+      // Nothing tracks state across the import events, so it's better to lose
+      // some than to slow the imports down when `eden trace hg` can't keep up.
+      traceBus_{TraceBus<HgImportTraceEvent>::create(
+          "hg",
+          kTraceBusCapacity,
+          TraceBusOverflowPolicy::Drop)} {
+  auto placement = ThreadPlacement::None;
+  if (config_) {
+    auto edenConfig = config_->getEdenConfig();
+    placement = edenConfig->hgThreadPlacement.getValue();
+    fetchers_[HgBackingStore::HgImportObject::BLOB] = makeFetchers(
+        edenConfig->maxBlobFetchThreads.getValue(), "hgfetchblob", placement);
+    fetchers_[HgBackingStore::HgImportObject::TREE] = makeFetchers(
+        edenConfig->maxTreeFetchThreads.getValue(), "hgfetchtree", placement);
+    fetchers_[HgBackingStore::HgImportObject::PREFETCH] = makeFetchers(
+        edenConfig->maxPrefetchThreads.getValue(), "hgprefetch", placement);
+  }
+
   threads_.reserve(numberThreads);
   for (int i = 0; i < numberThreads; i++) {
-    threads_.emplace_back(&HgQueuedBackingStore::processRequest, this);
+    threads_.emplace_back([this, placement] {
+      placeCurrentThread(placement);
+      processRequest();
+    });
   }
 }
 
@@ -92,20 +148,80 @@ HgQueuedBackingStore::~HgQueuedBackingStore() {
   for (auto& thread : threads_) {
     thread.join();
   }
+  // Complete the batches that were handed to the fetchers.
+  for (auto& fetchers : fetchers_) {
+    if (fetchers) {
+      fetchers->join();
+    }
+  }
+}
+
+std::unique_ptr<folly::CPUThreadPoolExecutor>
+HgQueuedBackingStore::makeFetchers(
+    size_t maxThreads,
+    folly::StringPiece name,
+    ThreadPlacement placement) {
+  if (maxThreads == 0) {
+    return nullptr;
+  }
+  // The pool starts with a single thread and grows up to maxThreads while
+  // every thread is busy, which is when fetches from the server are the
+  // bottleneck. Idle threads exit after a while.
+  return std::make_unique<folly::CPUThreadPoolExecutor>(
+      std::make_pair(maxThreads, size_t{1}),
+      std::make_unique<folly::LifoSemMPMCQueue<
+          folly::CPUThreadPoolExecutor::CPUTask,
+          folly::QueueBehaviorIfFull::BLOCK>>(maxThreads),
+      std::make_shared<PlacedThreadFactory>(
+          std::make_shared<folly::NamedThreadFactory>(name), placement));
 }
 
 void HgQueuedBackingStore::processBlobImportRequests(
     std::vector<std::shared_ptr<HgImportRequest>>&& requests) {
+  folly::stop_watch<std::chrono::milliseconds> watch;
+  std::vector<std::shared_ptr<HgImportRequest>> misses;
+  misses.reserve(requests.size());
+
+  XLOG(DBG4) << "Processing blob import batch size=" << requests.size();
+
+  for (auto& request : requests) {
+    auto* blobImport = request->getRequest<HgImportRequest::BlobImport>();
+    traceBus_->publish(HgImportTraceEvent::start(
+        request->getUnique(), HgImportTraceEvent::BLOB, blobImport->proxyHash));
+
+    if (auto blob = backingStore_->getDatapackStore().getBlobLocal(
+            blobImport->hash, blobImport->proxyHash)) {
+      stats_->getHgBackingStoreStatsForCurrentThread()
+          .hgBackingStoreGetBlob.addValue(watch.elapsed().count());
+      request->getPromise<HgImportRequest::BlobImport::Response>()->setValue(
+          std::shared_ptr<const Blob>{std::move(blob)});
+      continue;
+    }
+    misses.push_back(std::move(request));
+  }
+
+  if (misses.empty()) {
+    return;
+  }
+  fetchRemote(
+      HgBackingStore::HgImportObject::BLOB,
+      [this, misses = std::move(misses), watch]() mutable {
+        fetchRemoteBlobs(std::move(misses), watch);
+      });
+}
+
+void HgQueuedBackingStore::fetchRemoteBlobs(
+    std::vector<std::shared_ptr<HgImportRequest>>&& requests,
+    folly::stop_watch<std::chrono::milliseconds> watch) {
   std::vector<Hash> hashes;
   std::vector<HgProxyHash> proxyHashes;
   std::vector<folly::Promise<HgImportRequest::BlobImport::Response>*> promises;
 
-  folly::stop_watch<std::chrono::milliseconds> watch;
   hashes.reserve(requests.size());
   proxyHashes.reserve(requests.size());
   promises.reserve(requests.size());
 
-  XLOG(DBG4) << "Processing blob import batch size=" << requests.size();
+  XLOG(DBG4) << "Fetching blob import batch size=" << requests.size();
 
   for (auto& request : requests) {
     auto* blobImport = request->getRequest<HgImportRequest::BlobImport>();
@@ -113,12 +229,9 @@ void HgQueuedBackingStore::processBlobImportRequests(
     auto* promise =
         request->getPromise<HgImportRequest::BlobImport::Response>();
 
-    traceBus_->publish(HgImportTraceEvent::start(
-        request->getUnique(), HgImportTraceEvent::BLOB, blobImport->proxyHash));
-
     XLOGF(
         DBG4,
-        "Processing blob request for {} ({:p})",
+        "Fetching blob request for {} ({:p})",
         hash.toString(),
         static_cast<void*>(promise));
     hashes.emplace_back(hash);
@@ -126,51 +239,90 @@ void HgQueuedBackingStore::processBlobImportRequests(
     promises.emplace_back(promise);
   }
 
+  stats_->getHgBackingStoreStatsForCurrentThread()
+      .importBatchSizeBlob.addValue(requests.size());
+  folly::stop_watch<std::chrono::nanoseconds> batchWatch;
   backingStore_->getDatapackStore().getBlobBatch(hashes, proxyHashes, promises);
+  queue_.recordBlobBatch(requests.size(), batchWatch.elapsed());
 
   {
-    auto request = requests.begin();
-    auto proxyHash = proxyHashes.begin();
-    auto promise = promises.begin();
-    std::vector<folly::SemiFuture<folly::Unit>> futures;
-    futures.reserve(requests.size());
+    std::vector<HgProxyHash> missingProxyHashes;
+    std::vector<folly::Promise<HgImportRequest::BlobImport::Response>*>
+        missingPromises;
 
     XCHECK_EQ(requests.size(), proxyHashes.size());
-    for (; request != requests.end(); ++request, ++proxyHash, ++promise) {
-      if ((*promise)->isFulfilled()) {
+    for (size_t i = 0; i < requests.size(); ++i) {
+      if (promises[i]->isFulfilled()) {
         stats_->getHgBackingStoreStatsForCurrentThread()
             .hgBackingStoreGetBlob.addValue(watch.elapsed().count());
         continue;
       }
+      missingProxyHashes.push_back(proxyHashes[i]);
+      missingPromises.push_back(promises[i]);
+    }
 
+    if (!missingPromises.empty()) {
       // The blobs were either not found locally, or, when EdenAPI is enabled,
-      // not found on the server. Let's import the blob through the hg importer.
+      // not found on the server. Let's import them through the hg importer,
+      // which pipelines them over its helper processes.
       // TODO(xavierd): remove when EdenAPI has been rolled out everywhere.
-      futures.emplace_back(
-          backingStore_->fetchBlobFromHgImporter(*proxyHash)
-              .defer([request = std::move(*request), watch, stats = stats_](
-                         auto&& result) mutable {
-                auto hash =
-                    request->getRequest<HgImportRequest::BlobImport>()->hash;
-                XLOG(DBG4) << "Imported blob from HgImporter for " << hash;
-                stats->getHgBackingStoreStatsForCurrentThread()
-                    .hgBackingStoreGetBlob.addValue(watch.elapsed().count());
-                request->getPromise<HgImportRequest::BlobImport::Response>()
-                    ->setTry(std::forward<decltype(result)>(result));
-              }));
+      auto results =
+          backingStore_->fetchBlobsFromHgImporter(std::move(missingProxyHashes))
+              .getTry();
+      for (size_t i = 0; i < missingPromises.size(); ++i) {
+        if (results.hasException()) {
+          missingPromises[i]->setException(results.exception());
+          continue;
+        }
+        stats_->getHgBackingStoreStatsForCurrentThread()
+            .hgBackingStoreGetBlob.addValue(watch.elapsed().count());
+        missingPromises[i]->setTry(toShared(std::move(results.value()[i])));
+      }
     }
-
-    folly::collectAll(futures).wait();
   }
 }
 
 void HgQueuedBackingStore::processTreeImportRequests(
     std::vector<std::shared_ptr<HgImportRequest>>&& requests) {
+  folly::stop_watch<std::chrono::milliseconds> watch;
+  std::vector<std::shared_ptr<HgImportRequest>> misses;
+  misses.reserve(requests.size());
+
+  for (auto& request : requests) {
+    auto* treeImport = request->getRequest<HgImportRequest::TreeImport>();
+    traceBus_->publish(HgImportTraceEvent::start(
+        request->getUnique(), HgImportTraceEvent::TREE, treeImport->proxyHash));
+
+    if (auto tree = backingStore_->getTreeFromHgCache(
+            treeImport->hash,
+            treeImport->proxyHash,
+            treeImport->prefetchMetadata)) {
+      stats_->getHgBackingStoreStatsForCurrentThread()
+          .hgBackingStoreGetTree.addValue(watch.elapsed().count());
+      request->getPromise<HgImportRequest::TreeImport::Response>()->setValue(
+          std::shared_ptr<const Tree>{std::move(tree)});
+      continue;
+    }
+    misses.push_back(std::move(request));
+  }
+
+  if (misses.empty()) {
+    return;
+  }
+  fetchRemote(
+      HgBackingStore::HgImportObject::TREE,
+      [this, misses = std::move(misses), watch]() mutable {
+        fetchRemoteTrees(std::move(misses), watch);
+      });
+}
+
+void HgQueuedBackingStore::fetchRemoteTrees(
+    std::vector<std::shared_ptr<HgImportRequest>>&& requests,
+    folly::stop_watch<std::chrono::milliseconds> watch) {
   std::vector<Hash> hashes;
   std::vector<HgProxyHash> proxyHashes;
   std::vector<folly::Promise<HgImportRequest::TreeImport::Response>*> promises;
 
-  folly::stop_watch<std::chrono::milliseconds> watch;
   hashes.reserve(requests.size());
   proxyHashes.reserve(requests.size());
   promises.reserve(requests.size());
@@ -183,12 +335,9 @@ void HgQueuedBackingStore::processTreeImportRequests(
         request->getPromise<HgImportRequest::TreeImport::Response>();
     prefetchMetadata |= treeImport->prefetchMetadata;
 
-    traceBus_->publish(HgImportTraceEvent::start(
-        request->getUnique(), HgImportTraceEvent::TREE, treeImport->proxyHash));
-
     XLOGF(
         DBG4,
-        "Processing tree request for {} ({:p})",
+        "Fetching tree request for {} ({:p})",
         hash.toString(),
         static_cast<void*>(promise));
     hashes.emplace_back(hash);
@@ -196,7 +345,11 @@ void HgQueuedBackingStore::processTreeImportRequests(
     promises.emplace_back(promise);
   }
 
+  stats_->getHgBackingStoreStatsForCurrentThread()
+      .importBatchSizeTree.addValue(requests.size());
+  folly::stop_watch<std::chrono::nanoseconds> batchWatch;
   backingStore_->getTreeBatch(hashes, proxyHashes, promises, prefetchMetadata);
+  queue_.recordTreeBatch(requests.size(), batchWatch.elapsed());
 
   {
     auto request = requests.begin();
@@ -224,8 +377,9 @@ void HgQueuedBackingStore::processTreeImportRequests(
                   treeImport->proxyHash,
                   treeImport->prefetchMetadata,
                   ObjectFetchContext::getNullContext())
-              .defer([request = *request, promise = *promise](auto&& result) {
-                promise->setTry(std::move(result));
+              .defer([request = *request, promise = *promise](
+                         folly::Try<std::unique_ptr<Tree>>&& result) {
+                promise->setTry(toShared(std::move(result)));
               }));
     }
 
@@ -233,17 +387,55 @@ void HgQueuedBackingStore::processTreeImportRequests(
   }
 }
 
+void HgQueuedBackingStore::fetchRemote(
+    HgBackingStore::HgImportObject object,
+    folly::Func fetch) {
+  auto tagged = [object, fetch = std::move(fetch)]() mutable {
+    ProfilerTag profilerTag{profilerTagOfHgImportObject(object)};
+    fetch();
+  };
+  if (auto& fetchers = fetchers_[object]) {
+    // This blocks while all the fetchers are busy, leaving the remaining
+    // requests in the queue ordered by priority.
+    fetchers->add(std::move(tagged));
+  } else {
+    tagged();
+  }
+}
+
+size_t HgQueuedBackingStore::getFetcherMetric(
+    HgBackingStore::HgImportObject object,
+    FetcherMetric metric) const {
+  const auto& fetchers = fetchers_[object];
+  if (!fetchers) {
+    return 0;
+  }
+  switch (metric) {
+    case FetcherMetric::ACTIVE:
+      return fetchers->getPoolStats().activeThreadCount;
+    case FetcherMetric::THREADS:
+      return fetchers->getPoolStats().threadCount;
+    case FetcherMetric::MAX_THREADS:
+      return fetchers->getNumThreads();
+  }
+  EDEN_BUG() << "unknown fetcher metric " << enumValue(metric);
+}
+
 void HgQueuedBackingStore::processPrefetchRequests(
     std::vector<std::shared_ptr<HgImportRequest>>&& requests) {
   for (auto& request : requests) {
-    auto parameter = request->getRequest<HgImportRequest::Prefetch>();
-    request->getPromise<HgImportRequest::Prefetch::Response>()->setWith(
-        [store = backingStore_.get(),
-         proxyHashes = parameter->proxyHashes]() mutable {
-          return store
-              ->prefetchBlobs(
-                  std::move(proxyHashes), ObjectFetchContext::getNullContext())
-              .getTry();
+    fetchRemote(
+        HgBackingStore::HgImportObject::PREFETCH,
+        [store = backingStore_.get(), request = std::move(request)] {
+          auto parameter = request->getRequest<HgImportRequest::Prefetch>();
+          request->getPromise<HgImportRequest::Prefetch::Response>()->setWith(
+              [store, proxyHashes = parameter->proxyHashes]() mutable {
+                return store
+                    ->prefetchBlobs(
+                        std::move(proxyHashes),
+                        ObjectFetchContext::getNullContext())
+                    .getTry();
+              });
         });
   }
 }
@@ -257,6 +449,9 @@ void HgQueuedBackingStore::processRequest() {
       break;
     }
 
+    recordQueueWait(requests);
+
+    ProfilerTag profilerTag{"hg_queue"};
     const auto& first = requests.at(0);
 
     if (first->isType<HgImportRequest::BlobImport>()) {
@@ -269,6 +464,27 @@ void HgQueuedBackingStore::processRequest() {
   }
 }
 
+void HgQueuedBackingStore::recordQueueWait(
+    const std::vector<std::shared_ptr<HgImportRequest>>& requests) {
+  auto now = std::chrono::steady_clock::now();
+  auto& stats = stats_->getHgBackingStoreStatsForCurrentThread();
+  for (const auto& request : requests) {
+    auto wait = std::chrono::duration_cast<std::chrono::microseconds>(
+        now - request->getRequestTime());
+    switch (request->getPriority().kind) {
+      case ImportPriorityKind::Low:
+        stats.importQueueWaitLow.addValue(wait.count());
+        break;
+      case ImportPriorityKind::Normal:
+        stats.importQueueWaitNormal.addValue(wait.count());
+        break;
+      case ImportPriorityKind::High:
+        stats.importQueueWaitHigh.addValue(wait.count());
+        break;
+    }
+  }
+}
+
 RootId HgQueuedBackingStore::parseRootId(folly::StringPiece rootId) {
   // rootId can be 20-byte binary or 40-byte hex. Canonicalize, unconditionally
   // returning 40-byte hex.
@@ -288,14 +504,23 @@ std::string HgQueuedBackingStore::renderRootId(const RootId& rootId) {
   }
 }
 
-folly::SemiFuture<std::unique_ptr<Tree>> HgQueuedBackingStore::getTree(
+folly::SemiFuture<std::shared_ptr<const Tree>> HgQueuedBackingStore::getTree(
     const Hash& id,
     ObjectFetchContext& context) {
+  if (auto error = getMissingObjectError(id)) {
+    return folly::makeSemiFuture<std::shared_ptr<const Tree>>(std::move(error));
+  }
+
   HgProxyHash proxyHash;
   try {
-    proxyHash = HgProxyHash::load(localStore_.get(), id, "getTree");
-  } catch (const std::exception&) {
+    proxyHash = backingStore_->getProxyHashIndex().load(
+        localStore_.get(), id, "getTree");
+  } catch (const std::exception& ex) {
     logMissingProxyHash();
+    recordMissingObject(
+        id,
+        folly::exception_wrapper{std::current_exception(), ex},
+        /*proxyHashMissing=*/true);
     throw;
   }
 
@@ -306,19 +531,21 @@ folly::SemiFuture<std::unique_ptr<Tree>> HgQueuedBackingStore::getTree(
 
   if (auto tree = backingStore_->getTreeFromHgCache(
           id, proxyHash, context.prefetchMetadata())) {
-    return folly::makeSemiFuture(std::move(tree));
+    return folly::makeSemiFuture(std::shared_ptr<const Tree>{std::move(tree)});
   }
 
   return getTreeImpl(id, proxyHash, context);
 }
 
-folly::SemiFuture<std::unique_ptr<Tree>> HgQueuedBackingStore::getTreeImpl(
+folly::SemiFuture<std::shared_ptr<const Tree>>
+HgQueuedBackingStore::getTreeImpl(
     const Hash& id,
     const HgProxyHash& proxyHash,
     ObjectFetchContext& context) {
   auto getTreeFuture = folly::makeFutureWith([&] {
     auto request = HgImportRequest::makeTreeImportRequest(
         id, proxyHash, context.getPriority(), context.prefetchMetadata());
+    request->setClientPid(context.getClientPid());
     uint64_t unique = request->getUnique();
 
     auto importTracker =
@@ -337,20 +564,37 @@ folly::SemiFuture<std::unique_ptr<Tree>> HgQueuedBackingStore::getTreeImpl(
   });
 
   return std::move(getTreeFuture)
-      .thenTry([this, id](folly::Try<std::unique_ptr<Tree>>&& result) {
+      .thenTry([this, id](folly::Try<std::shared_ptr<const Tree>>&& result) {
         this->queue_.markImportAsFinished<Tree>(id, result);
+        if (result.hasException()) {
+          recordMissingObject(
+              id, result.exception(), /*proxyHashMissing=*/false);
+        } else {
+          // Imports started before the object was recorded as missing may
+          // still find it.
+          missingObjects_.remove(id);
+        }
         return folly::makeSemiFuture(std::move(result));
       });
 }
 
-folly::SemiFuture<std::unique_ptr<Blob>> HgQueuedBackingStore::getBlob(
+folly::SemiFuture<std::shared_ptr<const Blob>> HgQueuedBackingStore::getBlob(
     const Hash& id,
     ObjectFetchContext& context) {
+  if (auto error = getMissingObjectError(id)) {
+    return folly::makeSemiFuture<std::shared_ptr<const Blob>>(std::move(error));
+  }
+
   HgProxyHash proxyHash;
   try {
-    proxyHash = HgProxyHash::load(localStore_.get(), id, "getBlob");
-  } catch (const std::exception&) {
+    proxyHash = backingStore_->getProxyHashIndex().load(
+        localStore_.get(), id, "getBlob");
+  } catch (const std::exception& ex) {
     logMissingProxyHash();
+    recordMissingObject(
+        id,
+        folly::exception_wrapper{std::current_exception(), ex},
+        /*proxyHashMissing=*/true);
     throw;
   }
 
@@ -361,13 +605,14 @@ folly::SemiFuture<std::unique_ptr<Blob>> HgQueuedBackingStore::getBlob(
 
   if (auto blob =
           backingStore_->getDatapackStore().getBlobLocal(id, proxyHash)) {
-    return folly::makeSemiFuture(std::move(blob));
+    return folly::makeSemiFuture(std::shared_ptr<const Blob>{std::move(blob)});
   }
 
   return getBlobImpl(id, proxyHash, context);
 }
 
-folly::SemiFuture<std::unique_ptr<Blob>> HgQueuedBackingStore::getBlobImpl(
+folly::SemiFuture<std::shared_ptr<const Blob>>
+HgQueuedBackingStore::getBlobImpl(
     const Hash& id,
     const HgProxyHash& proxyHash,
     ObjectFetchContext& context) {
@@ -377,6 +622,7 @@ folly::SemiFuture<std::unique_ptr<Blob>> HgQueuedBackingStore::getBlobImpl(
 
     auto request = HgImportRequest::makeBlobImportRequest(
         id, proxyHash, context.getPriority());
+    request->setClientPid(context.getClientPid());
     auto unique = request->getUnique();
 
     auto importTracker =
@@ -395,8 +641,16 @@ folly::SemiFuture<std::unique_ptr<Blob>> HgQueuedBackingStore::getBlobImpl(
   });
 
   return std::move(getBlobFuture)
-      .thenTry([this, id](folly::Try<std::unique_ptr<Blob>>&& result) {
+      .thenTry([this, id](folly::Try<std::shared_ptr<const Blob>>&& result) {
         this->queue_.markImportAsFinished<Blob>(id, result);
+        if (result.hasException()) {
+          recordMissingObject(
+              id, result.exception(), /*proxyHashMissing=*/false);
+        } else {
+          // Imports started before the object was recorded as missing may
+          // still find it.
+          missingObjects_.remove(id);
+        }
         return folly::makeSemiFuture(std::move(result));
       });
 }
@@ -410,7 +664,8 @@ folly::SemiFuture<std::unique_ptr<Tree>> HgQueuedBackingStore::getRootTree(
 folly::SemiFuture<folly::Unit> HgQueuedBackingStore::prefetchBlobs(
     HashRange ids,
     ObjectFetchContext& context) {
-  return HgProxyHash::getBatch(localStore_.get(), ids)
+  return backingStore_->getProxyHashIndex()
+      .getBatch(localStore_.get(), ids)
       // The caller guarantees that ids will live at least longer than this
       // future, thus we don't need to deep-copy it.
       .thenTry([&context, this, ids](
@@ -434,7 +689,7 @@ folly::SemiFuture<folly::Unit> HgQueuedBackingStore::prefetchBlobs(
         // when useEdenNativePrefetch is true, fetch blobs one by one instead
         // of grouping them and fetching in batches.
         if (config_->getEdenConfig()->useEdenNativePrefetch.getValue()) {
-          std::vector<folly::SemiFuture<std::unique_ptr<Blob>>> futures;
+          std::vector<folly::SemiFuture<std::shared_ptr<const Blob>>> futures;
           futures.reserve(ids.size());
 
           for (size_t i = 0; i < ids.size(); i++) {
@@ -452,7 +707,8 @@ folly::SemiFuture<folly::Unit> HgQueuedBackingStore::prefetchBlobs(
         } else {
           // TODO: deduplicate prefetches
           auto request = HgImportRequest::makePrefetchRequest(
-              std::move(proxyHashes), ImportPriority::kNormal());
+              std::move(proxyHashes), context.getPriority());
+          request->setClientPid(context.getClientPid());
 
           auto importTracker = std::make_unique<RequestMetricsScope>(
               &pendingImportPrefetchWatches_);
@@ -482,6 +738,53 @@ void HgQueuedBackingStore::logMissingProxyHash() {
   }
 }
 
+std::chrono::nanoseconds HgQueuedBackingStore::getMissingObjectCacheTtl()
+    const {
+  if (!config_) {
+    return std::chrono::nanoseconds::zero();
+  }
+  return config_->getEdenConfig()->hgMissingObjectCacheTtl.getValue();
+}
+
+folly::exception_wrapper HgQueuedBackingStore::getMissingObjectError(
+    const Hash& id) {
+  auto ttl = getMissingObjectCacheTtl();
+  if (ttl.count() == 0) {
+    return {};
+  }
+
+  auto missing =
+      missingObjects_.get(id, std::chrono::steady_clock::now(), ttl);
+  if (!missing) {
+    return {};
+  }
+  // A tree imported since may have stored the proxy hash that was missing.
+  // Only a successful tree import stores it, whereas the proxy hash of an
+  // object whose own import failed was stored before that import started.
+  if (missing->proxyHashMissing &&
+      backingStore_->getProxyHashIndex().get(id)) {
+    missingObjects_.remove(id);
+    return {};
+  }
+  stats_->getHgBackingStoreStatsForCurrentThread()
+      .missingObjectCacheHit.addValue(1);
+  return std::move(missing->error);
+}
+
+void HgQueuedBackingStore::recordMissingObject(
+    const Hash& id,
+    const folly::exception_wrapper& error,
+    bool proxyHashMissing) {
+  if (getMissingObjectCacheTtl().count() == 0 ||
+      !HgMissingObjectCache::isDefinitive(error)) {
+    return;
+  }
+  missingObjects_.insert(
+      id, {error, proxyHashMissing}, std::chrono::steady_clock::now());
+  stats_->getHgBackingStoreStatsForCurrentThread()
+      .missingObjectCacheInsert.addValue(1);
+}
+
 void HgQueuedBackingStore::logBackingStoreFetch(
     ObjectFetchContext& context,
     folly::Range<HgProxyHash*> hashes,
@@ -519,8 +822,7 @@ size_t HgQueuedBackingStore::getImportMetric(
       metric, getImportWatches(stage, object));
 }
 
-RequestMetricsScope::LockedRequestWatchList&
-HgQueuedBackingStore::getImportWatches(
+RequestWatchList& HgQueuedBackingStore::getImportWatches(
     RequestMetricsScope::RequestStage stage,
     HgBackingStore::HgImportObject object) const {
   switch (stage) {
@@ -532,8 +834,7 @@ HgQueuedBackingStore::getImportWatches(
   EDEN_BUG() << "unknown hg import stage " << enumValue(stage);
 }
 
-RequestMetricsScope::LockedRequestWatchList&
-HgQueuedBackingStore::getPendingImportWatches(
+RequestWatchList& HgQueuedBackingStore::getPendingImportWatches(
     HgBackingStore::HgImportObject object) const {
   switch (object) {
     case HgBackingStore::HgImportObject::BLOB:
@@ -7,9 +7,12 @@
 
 #pragma once
 
+#include <folly/Function.h>
 #include <folly/Range.h>
 #include <folly/Synchronized.h>
+#include <folly/stop_watch.h>
 #include <sys/types.h>
+#include <array>
 #include <atomic>
 #include <memory>
 #include <vector>
@@ -19,9 +22,14 @@
 #include "eden/fs/store/ObjectFetchContext.h"
 #include "eden/fs/store/hg/HgBackingStore.h"
 #include "eden/fs/store/hg/HgImportRequestQueue.h"
+#include "eden/fs/store/hg/HgMissingObjectCache.h"
 #include "eden/fs/telemetry/RequestMetricsScope.h"
 #include "eden/fs/telemetry/TraceBus.h"
 
+namespace folly {
+class CPUThreadPoolExecutor;
+}
+
 namespace facebook::eden {
 
 class BackingStoreLogger;
@@ -31,6 +39,7 @@ class LocalStore;
 class EdenStats;
 class HgImportRequest;
 class StructuredLogger;
+enum class ThreadPlacement;
 
 constexpr uint8_t kNumberHgQueueWorker = 32;
 
@@ -125,10 +134,10 @@ class HgQueuedBackingStore final : public BackingStore {
       ObjectFetchContext& /* context */) override {
     throw std::domain_error("unimplemented");
   }
-  folly::SemiFuture<std::unique_ptr<Tree>> getTree(
+  folly::SemiFuture<std::shared_ptr<const Tree>> getTree(
       const Hash& id,
       ObjectFetchContext& context) override;
-  folly::SemiFuture<std::unique_ptr<Blob>> getBlob(
+  folly::SemiFuture<std::shared_ptr<const Blob>> getBlob(
       const Hash& id,
       ObjectFetchContext& context) override;
 
@@ -150,6 +159,23 @@ class HgQueuedBackingStore final : public BackingStore {
       HgBackingStore::HgImportObject object,
       RequestMetricsScope::RequestMetric metric) const;
 
+  enum class FetcherMetric {
+    // The number of fetcher threads running a fetch.
+    ACTIVE,
+    // The number of fetcher threads currently started.
+    THREADS,
+    // The number of threads the fetchers may grow to.
+    MAX_THREADS,
+  };
+
+  /**
+   * The utilization of the fetchers of the object type. Zero when its
+   * fetches run on the workers.
+   */
+  size_t getFetcherMetric(
+      HgBackingStore::HgImportObject object,
+      FetcherMetric metric) const;
+
   void startRecordingFetch() override;
   std::unordered_set<std::string> stopRecordingFetch() override;
 
@@ -179,13 +205,63 @@ class HgQueuedBackingStore final : public BackingStore {
   void processPrefetchRequests(
       std::vector<std::shared_ptr<HgImportRequest>>&& requests);
 
+  /**
+   * Import the blobs or trees that aren't available locally. These run on
+   * the remote fetchers, so that the workers keep resolving local hits
+   * while these wait on the network.
+   */
+  void fetchRemoteBlobs(
+      std::vector<std::shared_ptr<HgImportRequest>>&& requests,
+      folly::stop_watch<std::chrono::milliseconds> watch);
+  void fetchRemoteTrees(
+      std::vector<std::shared_ptr<HgImportRequest>>&& requests,
+      folly::stop_watch<std::chrono::milliseconds> watch);
+
+  /**
+   * Run the fetch on the fetchers of the object type, or inline when there
+   * are none.
+   */
+  void fetchRemote(HgBackingStore::HgImportObject object, folly::Func fetch);
+
+  static std::unique_ptr<folly::CPUThreadPoolExecutor> makeFetchers(
+      size_t maxThreads,
+      folly::StringPiece name,
+      ThreadPlacement placement);
+
   /**
    * The worker runloop function.
    */
   void processRequest();
 
+  /**
+   * Record how long each of the dequeued requests waited in the queue.
+   */
+  void recordQueueWait(
+      const std::vector<std::shared_ptr<HgImportRequest>>& requests);
+
   void logMissingProxyHash();
 
+  /**
+   * The error of the last fetch of the object, if it definitively failed
+   * less than hg:missing-object-cache-ttl ago. Fetches of such objects fail
+   * with that error instead of going through the queue again.
+   */
+  folly::exception_wrapper getMissingObjectError(const Hash& id);
+
+  /**
+   * The hg:missing-object-cache-ttl, or 0 when there is no config.
+   */
+  std::chrono::nanoseconds getMissingObjectCacheTtl() const;
+
+  /**
+   * Remember the error of a failed fetch when retrying it wouldn't help,
+   * and whether it failed on loading the object's proxy hash.
+   */
+  void recordMissingObject(
+      const Hash& id,
+      const folly::exception_wrapper& error,
+      bool proxyHashMissing);
+
   /**
    * Fetch a blob from Mercurial.
    *
@@ -193,7 +269,7 @@ class HgQueuedBackingStore final : public BackingStore {
    * the blob is present locally, as this function will always push the request
    * at the end of the queue.
    */
-  folly::SemiFuture<std::unique_ptr<Blob>> getBlobImpl(
+  folly::SemiFuture<std::shared_ptr<const Blob>> getBlobImpl(
       const Hash& id,
       const HgProxyHash& proxyHash,
       ObjectFetchContext& context);
@@ -205,7 +281,7 @@ class HgQueuedBackingStore final : public BackingStore {
    * the tree is present locally, as this function will always push the request
    * at the end of the queue.
    */
-  folly::SemiFuture<std::unique_ptr<Tree>> getTreeImpl(
+  folly::SemiFuture<std::shared_ptr<const Tree>> getTreeImpl(
       const Hash& id,
       const HgProxyHash& proxyHash,
       ObjectFetchContext& context);
@@ -227,7 +303,7 @@ class HgQueuedBackingStore final : public BackingStore {
    *        )
    *    gets the watches timing blob imports that are pending
    */
-  RequestMetricsScope::LockedRequestWatchList& getImportWatches(
+  RequestWatchList& getImportWatches(
       RequestMetricsScope::RequestStage stage,
       HgBackingStore::HgImportObject object) const;
 
@@ -238,7 +314,7 @@ class HgQueuedBackingStore final : public BackingStore {
    *        )
    *    gets the watches timing pending blob imports
    */
-  RequestMetricsScope::LockedRequestWatchList& getPendingImportWatches(
+  RequestWatchList& getPendingImportWatches(
       HgBackingStore::HgImportObject object) const;
 
   /**
@@ -260,6 +336,11 @@ class HgQueuedBackingStore final : public BackingStore {
    */
   std::shared_ptr<ReloadableConfig> config_;
 
+  /**
+   * The objects that recently failed to be found, see getMissingObjectError.
+   */
+  HgMissingObjectCache missingObjects_;
+
   std::unique_ptr<HgBackingStore> backingStore_;
 
   /**
@@ -274,6 +355,17 @@ class HgQueuedBackingStore final : public BackingStore {
    */
   std::vector<std::thread> threads_;
 
+  /**
+   * The fetchers of each HgImportObject, importing the blob and tree batches
+   * that missed the local caches, and running the prefetches. Each pool
+   * grows up to its hg:max-*-threads limit. A null pool, when the limit is
+   * zero, makes the workers import them themselves.
+   */
+  std::array<
+      std::unique_ptr<folly::CPUThreadPoolExecutor>,
+      HgBackingStore::hgImportObjects.size()>
+      fetchers_;
+
   std::shared_ptr<StructuredLogger> structuredLogger_;
 
   /**
@@ -287,10 +379,9 @@ class HgQueuedBackingStore final : public BackingStore {
       lastMissingProxyHashLog_;
 
   // Track metrics for queued imports
-  mutable RequestMetricsScope::LockedRequestWatchList pendingImportBlobWatches_;
-  mutable RequestMetricsScope::LockedRequestWatchList pendingImportTreeWatches_;
-  mutable RequestMetricsScope::LockedRequestWatchList
-      pendingImportPrefetchWatches_;
+  mutable RequestWatchList pendingImportBlobWatches_;
+  mutable RequestWatchList pendingImportTreeWatches_;
+  mutable RequestWatchList pendingImportPrefetchWatches_;
 
   // This field should be last so any internal subscribers can capture [this].
   std::shared_ptr<TraceBus<HgImportTraceEvent>> traceBus_;
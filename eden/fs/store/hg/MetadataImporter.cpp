@@ -12,6 +12,22 @@
 
 namespace facebook::eden {
 
+folly::SemiFuture<std::vector<folly::Try<std::unique_ptr<TreeMetadata>>>>
+MetadataImporter::getTreeMetadataBatch(
+    const std::vector<std::pair<Hash, Hash>>& trees) {
+  std::vector<folly::SemiFuture<std::unique_ptr<TreeMetadata>>> futures;
+  futures.reserve(trees.size());
+  for (const auto& [edenId, manifestId] : trees) {
+    auto future = getTreeMetadata(edenId, manifestId);
+    // An importer without metadata for the tree returns an empty future.
+    if (!future.valid()) {
+      future = folly::makeSemiFuture(std::unique_ptr<TreeMetadata>{});
+    }
+    futures.push_back(std::move(future));
+  }
+  return folly::collectAll(std::move(futures));
+}
+
 folly::SemiFuture<std::unique_ptr<TreeMetadata>>
 DefaultMetadataImporter::getTreeMetadata(
     const Hash& /*edenId*/,
@@ -8,8 +8,11 @@
 #pragma once
 
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include <folly/Executor.h>
+#include <folly/Try.h>
 #include <folly/futures/Future.h>
 
 #include "eden/fs/utils/PathFuncs.h"
@@ -41,6 +44,18 @@ class MetadataImporter {
       const Hash& edenId,
       const Hash& manifestId) = 0;
 
+  /**
+   * Get the metadata for the entries of each of the trees, specified by their
+   * edenId and manifestId, in as few requests as the importer allows. The
+   * results are in the order of the trees.
+   *
+   * The default implementation issues one getTreeMetadata per tree. A tree
+   * without metadata has a null result.
+   */
+  virtual folly::SemiFuture<
+      std::vector<folly::Try<std::unique_ptr<TreeMetadata>>>>
+  getTreeMetadataBatch(const std::vector<std::pair<Hash, Hash>>& trees);
+
   /**
    * Returns if metadata fetching is supported on the current platform and
    * is configured, if not the DefaultMetadataImporter should be used.
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/hg/TreeMetadataBatcher.h"
+
+#include <folly/futures/Future.h>
+#include <folly/logging/xlog.h>
+#include <algorithm>
+#include <iterator>
+
+#include "eden/fs/config/EdenConfig.h"
+#include "eden/fs/config/ReloadableConfig.h"
+#include "eden/fs/store/LocalStore.h"
+#include "eden/fs/store/TreeMetadata.h"
+#include "eden/fs/store/hg/MetadataImporter.h"
+
+#ifdef EDEN_HAVE_SERVICEROUTER
+#include "servicerouter/common/TServiceRouterException.h" // @manual
+#include "servicerouter/common/gen-cpp2/error_types.h" // @manual
+
+using facebook::servicerouter::ErrorReason;
+using facebook::servicerouter::TServiceRouterException;
+#endif
+
+namespace facebook::eden {
+
+namespace {
+// Used when there is no config, as in unit tests.
+constexpr size_t kDefaultBatchSize = 100;
+constexpr size_t kDefaultMaxConcurrentBatches = 4;
+} // namespace
+
+TreeMetadataBatcher::TreeMetadataBatcher(
+    std::shared_ptr<MetadataImporter> importer,
+    std::shared_ptr<LocalStore> localStore,
+    folly::Executor* executor,
+    std::shared_ptr<ReloadableConfig> config)
+    : importer_{std::move(importer)},
+      localStore_{std::move(localStore)},
+      executor_{executor},
+      config_{std::move(config)} {}
+
+size_t TreeMetadataBatcher::getBatchSize() const {
+  if (!config_) {
+    return kDefaultBatchSize;
+  }
+  return std::max<size_t>(
+      config_->getEdenConfig()->scsMetadataBatchSize.getValue(), 1);
+}
+
+size_t TreeMetadataBatcher::getMaxConcurrentBatches() const {
+  if (!config_) {
+    return kDefaultMaxConcurrentBatches;
+  }
+  return std::max<size_t>(
+      config_->getEdenConfig()->scsMaxConcurrentMetadataBatches.getValue(), 1);
+}
+
+void TreeMetadataBatcher::fetch(const Tree& tree, const Hash& manifestId) {
+  std::vector<std::vector<Request>> batches;
+  {
+    auto state = state_.wlock();
+    if (state->pending.size() >= getBatchSize() * getMaxConcurrentBatches()) {
+      XLOG(DBG4) << "dropping the metadata fetch of tree " << tree.getHash()
+                 << ": too many pending metadata fetches";
+      return;
+    }
+    state->pending.push_back(Request{tree, manifestId});
+    batches = takeBatches(*state);
+  }
+
+  for (auto& batch : batches) {
+    send(std::move(batch));
+  }
+}
+
+std::vector<std::vector<TreeMetadataBatcher::Request>>
+TreeMetadataBatcher::takeBatches(State& state) const {
+  std::vector<std::vector<Request>> batches;
+  auto batchSize = getBatchSize();
+  auto maxConcurrentBatches = getMaxConcurrentBatches();
+  while (state.inFlight < maxConcurrentBatches && !state.pending.empty()) {
+    auto end = state.pending.begin() +
+        std::min<ptrdiff_t>(batchSize, state.pending.size());
+    batches.emplace_back(
+        std::make_move_iterator(state.pending.begin()),
+        std::make_move_iterator(end));
+    state.pending.erase(state.pending.begin(), end);
+    ++state.inFlight;
+  }
+  return batches;
+}
+
+void TreeMetadataBatcher::send(std::vector<Request> batch) {
+  std::vector<std::pair<Hash, Hash>> trees;
+  trees.reserve(batch.size());
+  for (const auto& request : batch) {
+    trees.emplace_back(request.tree.getHash(), request.manifestId);
+  }
+
+  folly::makeSemiFutureWith(
+      [&] { return importer_->getTreeMetadataBatch(trees); })
+      .via(executor_)
+      .thenTry([self = shared_from_this(), batch = std::move(batch)](
+                   folly::Try<Results>&& results) {
+        if (results.hasException()) {
+          self->logError(results.exception());
+        } else {
+          self->store(batch, results.value());
+        }
+        self->batchCompleted();
+      });
+}
+
+void TreeMetadataBatcher::store(
+    const std::vector<Request>& batch,
+    Results& results) {
+  try {
+    auto writeBatch = localStore_->beginWrite();
+    for (size_t i = 0; i < batch.size() && i < results.size(); ++i) {
+      auto& result = results[i];
+      if (result.hasException()) {
+        logError(result.exception());
+        continue;
+      }
+      if (!result.hasValue() || !result.value()) {
+        continue;
+      }
+      writeBatch->putTreeMetadata(*result.value(), batch[i].tree);
+    }
+    // note this may throw if the localStore has already been closed
+    writeBatch->flush();
+  } catch (const std::exception& ex) {
+    logError(folly::exception_wrapper{std::current_exception(), ex});
+  }
+}
+
+void TreeMetadataBatcher::batchCompleted() {
+  std::vector<std::vector<Request>> batches;
+  {
+    auto state = state_.wlock();
+    --state->inFlight;
+    batches = takeBatches(*state);
+  }
+
+  for (auto& batch : batches) {
+    send(std::move(batch));
+  }
+}
+
+void TreeMetadataBatcher::logError(
+    const folly::exception_wrapper& error) const {
+#ifdef EDEN_HAVE_SERVICEROUTER
+  if (auto* serviceRouterError =
+          error.get_exception<TServiceRouterException>()) {
+    if (config_ &&
+        serviceRouterError->getErrorReason() ==
+            ErrorReason::THROTTLING_REQUEST) {
+      XLOG_EVERY_N_THREAD(
+          WARN,
+          config_->getEdenConfig()->scsThrottleErrorSampleRatio.getValue())
+          << "Error during metadata pre-fetching or storage: " << error.what();
+      return;
+    }
+  }
+#endif
+  XLOG(WARN) << "Error during metadata pre-fetching or storage: "
+             << error.what();
+}
+
+} // namespace facebook::eden
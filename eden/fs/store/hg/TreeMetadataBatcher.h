@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Executor.h>
+#include <folly/Synchronized.h>
+#include <folly/Try.h>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "eden/fs/model/Hash.h"
+#include "eden/fs/model/Tree.h"
+
+namespace folly {
+class exception_wrapper;
+} // namespace folly
+
+namespace facebook::eden {
+
+class LocalStore;
+class MetadataImporter;
+class ReloadableConfig;
+class TreeMetadata;
+
+/**
+ * Fetches the metadata of the entries of imported trees through a
+ * MetadataImporter, and stores it in the LocalStore.
+ *
+ * At most scs:max-concurrent-metadata-batches requests are sent at a time.
+ * The trees whose metadata is requested while they are in flight are
+ * coalesced, up to scs:metadata-batch-size per request, and sent when a
+ * request completes. The metadata of a whole batch is written through one
+ * WriteBatch.
+ *
+ * As the metadata is only useful if it arrives before it is needed, trees
+ * are dropped rather than queued once every request slot has a full batch
+ * waiting.
+ */
+class TreeMetadataBatcher
+    : public std::enable_shared_from_this<TreeMetadataBatcher> {
+ public:
+  TreeMetadataBatcher(
+      std::shared_ptr<MetadataImporter> importer,
+      std::shared_ptr<LocalStore> localStore,
+      folly::Executor* executor,
+      std::shared_ptr<ReloadableConfig> config);
+
+  /**
+   * Fetch the metadata of the entries of the tree, whose hg manifest node is
+   * manifestId, and store it.
+   */
+  void fetch(const Tree& tree, const Hash& manifestId);
+
+ private:
+  struct Request {
+    Tree tree;
+    Hash manifestId;
+  };
+
+  using Results = std::vector<folly::Try<std::unique_ptr<TreeMetadata>>>;
+
+  struct State {
+    std::deque<Request> pending;
+    size_t inFlight = 0;
+  };
+
+  /**
+   * Take the batches that can be sent now, marking them in flight.
+   */
+  std::vector<std::vector<Request>> takeBatches(State& state) const;
+
+  void send(std::vector<Request> batch);
+  void store(const std::vector<Request>& batch, Results& results);
+  void batchCompleted();
+
+  void logError(const folly::exception_wrapper& error) const;
+
+  size_t getBatchSize() const;
+  size_t getMaxConcurrentBatches() const;
+
+  std::shared_ptr<MetadataImporter> importer_;
+  std::shared_ptr<LocalStore> localStore_;
+  folly::Executor* executor_;
+  // May be null in unit tests.
+  std::shared_ptr<ReloadableConfig> config_;
+
+  folly::Synchronized<State> state_;
+};
+
+} // namespace facebook::eden
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/hg/HgImportBatchSizer.h"
+
+#include <folly/portability/GTest.h>
+
+using namespace facebook::eden;
+using namespace std::chrono_literals;
+
+TEST(HgImportBatchSizer, startsFromTheConfiguredSize) {
+  HgImportBatchSizer sizer;
+  EXPECT_EQ(32, sizer.getBatchSize(32, 100ms));
+  EXPECT_EQ(1, sizer.getBatchSize(0, 100ms));
+}
+
+TEST(HgImportBatchSizer, slowBatchesHalveTheSize) {
+  HgImportBatchSizer sizer;
+  EXPECT_EQ(32, sizer.getBatchSize(32, 100ms));
+  sizer.recordBatch(32, 300ms, 32, 100ms);
+  EXPECT_EQ(16, sizer.getBatchSize(32, 100ms));
+  for (int i = 0; i < 10; ++i) {
+    sizer.recordBatch(16, 300ms, 32, 100ms);
+  }
+  EXPECT_EQ(1, sizer.getBatchSize(32, 100ms));
+}
+
+TEST(HgImportBatchSizer, onlyFullBatchesGrowTheSize) {
+  HgImportBatchSizer sizer;
+  sizer.getBatchSize(32, 100ms);
+  sizer.recordBatch(32, 300ms, 32, 100ms);
+  EXPECT_EQ(16, sizer.getBatchSize(32, 100ms));
+
+  // A shallow queue doesn't tell whether larger batches would help.
+  sizer.recordBatch(4, 10ms, 32, 100ms);
+  EXPECT_EQ(16, sizer.getBatchSize(32, 100ms));
+
+  sizer.recordBatch(16, 10ms, 32, 100ms);
+  EXPECT_EQ(17, sizer.getBatchSize(32, 100ms));
+  for (int i = 0; i < 100; ++i) {
+    sizer.recordBatch(32, 10ms, 32, 100ms);
+  }
+  EXPECT_EQ(32, sizer.getBatchSize(32, 100ms));
+}
+
+TEST(HgImportBatchSizer, zeroTargetKeepsTheConfiguredSize) {
+  HgImportBatchSizer sizer;
+  sizer.getBatchSize(32, 0ms);
+  sizer.recordBatch(32, 10s, 32, 0ms);
+  EXPECT_EQ(32, sizer.getBatchSize(32, 0ms));
+  EXPECT_EQ(8, sizer.getBatchSize(8, 0ms));
+}
@@ -10,6 +10,7 @@
 #include <folly/portability/GTest.h>
 #include <array>
 #include <memory>
+#include <thread>
 
 #include "eden/fs/config/ReloadableConfig.h"
 #include "eden/fs/model/Hash.h"
@@ -78,6 +79,16 @@ std::pair<Hash, std::shared_ptr<HgImportRequest>> makeTreeImportRequest(
           hash, std::move(proxyHash), priority, true));
 }
 
+folly::Try<std::shared_ptr<const Blob>> makeBlobTry(const Hash& hash) {
+  return folly::Try<std::shared_ptr<const Blob>>{
+      std::make_shared<Blob>(hash, folly::IOBuf{})};
+}
+
+folly::Try<std::shared_ptr<const Tree>> makeTreeTry(const Hash& hash) {
+  return folly::Try<std::shared_ptr<const Tree>>{
+      std::make_shared<Tree>(std::vector<TreeEntry>{}, hash)};
+}
+
 Hash insertBlobImportRequest(
     HgImportRequestQueue& queue,
     ImportPriority priority) {
@@ -121,9 +132,7 @@ TEST_F(HgImportRequestQueueTest, getRequestByPriority) {
     EXPECT_EQ(
         expected, request->getRequest<HgImportRequest::BlobImport>()->hash);
 
-    folly::Try<std::unique_ptr<Blob>> blob = folly::makeTryWith([expected]() {
-      return std::make_unique<Blob>(expected, folly::IOBuf{});
-    });
+    auto blob = makeBlobTry(expected);
 
     queue.markImportAsFinished<Blob>(
         request->getRequest<HgImportRequest::BlobImport>()->hash, blob);
@@ -134,10 +143,7 @@ TEST_F(HgImportRequestQueueTest, getRequestByPriority) {
       smallHash,
       smallRequestDequeue->getRequest<HgImportRequest::BlobImport>()->hash);
 
-  folly::Try<std::unique_ptr<Blob>> smallBlob =
-      folly::makeTryWith([smallHash = smallHash]() {
-        return std::make_unique<Blob>(smallHash, folly::IOBuf{});
-      });
+  auto smallBlob = makeBlobTry(smallHash);
 
   queue.markImportAsFinished<Blob>(
       smallRequestDequeue->getRequest<HgImportRequest::BlobImport>()->hash,
@@ -166,10 +172,7 @@ TEST_F(HgImportRequestQueueTest, getRequestByPriorityReverse) {
       largeHash,
       largeHashDequeue->getRequest<HgImportRequest::BlobImport>()->hash);
 
-  folly::Try<std::unique_ptr<Blob>> largeBlob =
-      folly::makeTryWith([largeHash = largeHash]() {
-        return std::make_unique<Blob>(largeHash, folly::IOBuf{});
-      });
+  auto largeBlob = makeBlobTry(largeHash);
   queue.markImportAsFinished<Blob>(
       largeHashDequeue->getRequest<HgImportRequest::BlobImport>()->hash,
       largeBlob);
@@ -183,9 +186,7 @@ TEST_F(HgImportRequestQueueTest, getRequestByPriorityReverse) {
     EXPECT_EQ(
         expected, request->getRequest<HgImportRequest::BlobImport>()->hash);
 
-    folly::Try<std::unique_ptr<Blob>> blob = folly::makeTryWith([expected]() {
-      return std::make_unique<Blob>(expected, folly::IOBuf{});
-    });
+    auto blob = makeBlobTry(expected);
     queue.markImportAsFinished<Blob>(
         request->getRequest<HgImportRequest::BlobImport>()->hash, blob);
   }
@@ -226,11 +227,8 @@ TEST_F(HgImportRequestQueueTest, mixedPriority) {
         ImportPriority(ImportPriorityKind::Normal, 10 - i)
             .value()); // assert tree requests of priority 10 and 9
 
-    folly::Try<std::unique_ptr<Tree>> tree = folly::makeTryWith(
-        [hash = dequeuedRequest->getRequest<HgImportRequest::TreeImport>()
-                    ->hash]() {
-          return std::make_unique<Tree>(std::vector<TreeEntry>{}, hash);
-        });
+    auto tree = makeTreeTry(
+        dequeuedRequest->getRequest<HgImportRequest::TreeImport>()->hash);
     queue.markImportAsFinished<Tree>(
         dequeuedRequest->getRequest<HgImportRequest::TreeImport>()->hash, tree);
   }
@@ -250,11 +248,8 @@ TEST_F(HgImportRequestQueueTest, mixedPriority) {
         ImportPriority(ImportPriorityKind::Normal, 9 - i)
             .value()); // assert blob requests of priority 9, 8, and 7
 
-    folly::Try<std::unique_ptr<Blob>> blob = folly::makeTryWith(
-        [hash = dequeuedRequest->getRequest<HgImportRequest::BlobImport>()
-                    ->hash]() {
-          return std::make_unique<Blob>(hash, folly::IOBuf{});
-        });
+    auto blob = makeBlobTry(
+        dequeuedRequest->getRequest<HgImportRequest::BlobImport>()->hash);
     queue.markImportAsFinished<Blob>(
         dequeuedRequest->getRequest<HgImportRequest::BlobImport>()->hash, blob);
   }
@@ -288,11 +283,8 @@ TEST_F(HgImportRequestQueueTest, getMultipleRequests) {
             dequeuedRequest->getRequest<HgImportRequest::TreeImport>()->hash) !=
         enqueued_tree.end());
 
-    folly::Try<std::unique_ptr<Tree>> tree = folly::makeTryWith(
-        [hash = dequeuedRequest->getRequest<HgImportRequest::TreeImport>()
-                    ->hash]() {
-          return std::make_unique<Tree>(std::vector<TreeEntry>{}, hash);
-        });
+    auto tree = makeTreeTry(
+        dequeuedRequest->getRequest<HgImportRequest::TreeImport>()->hash);
     queue.markImportAsFinished<Tree>(
         dequeuedRequest->getRequest<HgImportRequest::TreeImport>()->hash, tree);
   }
@@ -308,11 +300,8 @@ TEST_F(HgImportRequestQueueTest, getMultipleRequests) {
             dequeuedRequest->getRequest<HgImportRequest::BlobImport>()->hash) !=
         enqueued_blob.end());
 
-    folly::Try<std::unique_ptr<Blob>> blob = folly::makeTryWith(
-        [hash = dequeuedRequest->getRequest<HgImportRequest::BlobImport>()
-                    ->hash]() {
-          return std::make_unique<Blob>(hash, folly::IOBuf{});
-        });
+    auto blob = makeBlobTry(
+        dequeuedRequest->getRequest<HgImportRequest::BlobImport>()->hash);
     queue.markImportAsFinished<Blob>(
         dequeuedRequest->getRequest<HgImportRequest::BlobImport>()->hash, blob);
   }
@@ -346,10 +335,7 @@ TEST_F(HgImportRequestQueueTest, duplicateRequestAfterEnqueue) {
       expected,
       dequeuedRequest->getRequest<HgImportRequest::BlobImport>()->hash);
 
-  folly::Try<std::unique_ptr<Blob>> blob =
-      folly::makeTryWith([hash = proxyHash.sha1()]() {
-        return std::make_unique<Blob>(hash, folly::IOBuf{});
-      });
+  auto blob = makeBlobTry(proxyHash.sha1());
   queue.markImportAsFinished<Blob>(
       dequeuedRequest->getRequest<HgImportRequest::BlobImport>()->hash, blob);
 }
@@ -384,10 +370,7 @@ TEST_F(HgImportRequestQueueTest, duplicateRequestAfterDequeue) {
       dequeuedRequest->getRequest<HgImportRequest::BlobImport>()
           ->promises.size());
 
-  folly::Try<std::unique_ptr<Blob>> blob =
-      folly::makeTryWith([hash = proxyHash.sha1()]() {
-        return std::make_unique<Blob>(hash, folly::IOBuf{});
-      });
+  auto blob = makeBlobTry(proxyHash.sha1());
   queue.markImportAsFinished<Blob>(
       dequeuedRequest->getRequest<HgImportRequest::BlobImport>()->hash, blob);
 }
@@ -419,10 +402,7 @@ TEST_F(HgImportRequestQueueTest, duplicateRequestAfterMarkedDone) {
       expected,
       dequeuedRequest->getRequest<HgImportRequest::BlobImport>()->hash);
 
-  folly::Try<std::unique_ptr<Blob>> blob =
-      folly::makeTryWith([hash = proxyHash.sha1()]() {
-        return std::make_unique<Blob>(hash, folly::IOBuf{});
-      });
+  auto blob = makeBlobTry(proxyHash.sha1());
   queue.markImportAsFinished<Blob>(
       dequeuedRequest->getRequest<HgImportRequest::BlobImport>()->hash, blob);
 }
@@ -465,10 +445,7 @@ TEST_F(HgImportRequestQueueTest, multipleDuplicateRequests) {
       dequeuedRequest->getRequest<HgImportRequest::BlobImport>()
           ->promises.size());
 
-  folly::Try<std::unique_ptr<Blob>> blob =
-      folly::makeTryWith([hash = proxyHash.sha1()]() {
-        return std::make_unique<Blob>(hash, folly::IOBuf{});
-      });
+  auto blob = makeBlobTry(proxyHash.sha1());
   queue.markImportAsFinished<Blob>(
       dequeuedRequest->getRequest<HgImportRequest::BlobImport>()->hash, blob);
 }
@@ -521,9 +498,7 @@ TEST_F(HgImportRequestQueueTest, twoDuplicateRequestsDifferentPriority) {
     EXPECT_EQ(
         expected, request->getRequest<HgImportRequest::BlobImport>()->hash);
 
-    folly::Try<std::unique_ptr<Blob>> blob = folly::makeTryWith([expected]() {
-      return std::make_unique<Blob>(expected, folly::IOBuf{});
-    });
+    auto blob = makeBlobTry(expected);
     queue.markImportAsFinished<Blob>(
         request->getRequest<HgImportRequest::BlobImport>()->hash, blob);
   }
@@ -533,10 +508,7 @@ TEST_F(HgImportRequestQueueTest, twoDuplicateRequestsDifferentPriority) {
   EXPECT_EQ(
       lowPriHash, expLowPri->getRequest<HgImportRequest::BlobImport>()->hash);
 
-  folly::Try<std::unique_ptr<Blob>> blob =
-      folly::makeTryWith([lowPriHash = lowPriHash]() {
-        return std::make_unique<Blob>(lowPriHash, folly::IOBuf{});
-      });
+  auto blob = makeBlobTry(lowPriHash);
   queue.markImportAsFinished<Blob>(
       expLowPri->getRequest<HgImportRequest::BlobImport>()->hash, blob);
 
@@ -549,11 +521,78 @@ TEST_F(HgImportRequestQueueTest, twoDuplicateRequestsDifferentPriority) {
     EXPECT_EQ(
         expected, request->getRequest<HgImportRequest::BlobImport>()->hash);
 
-    folly::Try<std::unique_ptr<Blob>> expBlob =
-        folly::makeTryWith([expected]() {
-          return std::make_unique<Blob>(expected, folly::IOBuf{});
-        });
+    auto expBlob = makeBlobTry(expected);
     queue.markImportAsFinished<Blob>(
         request->getRequest<HgImportRequest::BlobImport>()->hash, expBlob);
   }
 }
+
+TEST_F(HgImportRequestQueueTest, duplicateRequestsShareTheImportedBlob) {
+  auto queue = HgImportRequestQueue{edenConfig};
+  auto [hash, request] =
+      makeBlobImportRequest(ImportPriority(ImportPriorityKind::Normal, 0));
+  auto [duplicateHash, duplicateRequest] = makeBlobImportRequestWithHash(
+      ImportPriority(ImportPriorityKind::Normal, 0),
+      request->getRequest<HgImportRequest::BlobImport>()->proxyHash);
+
+  auto future = queue.enqueueBlob(std::move(request));
+  auto duplicateFuture = queue.enqueueBlob(std::move(duplicateRequest));
+
+  auto dequeuedRequest = queue.dequeue().at(0);
+  auto blob = makeBlobTry(hash);
+  dequeuedRequest->getPromise<HgImportRequest::BlobImport::Response>()
+      ->setValue(blob.value());
+  queue.markImportAsFinished<Blob>(hash, blob);
+
+  EXPECT_EQ(blob.value(), std::move(future).get());
+  EXPECT_EQ(blob.value(), std::move(duplicateFuture).get());
+}
+
+TEST_F(HgImportRequestQueueTest, clientsOfTheSamePriorityTakeTurns) {
+  auto queue = HgImportRequestQueue{edenConfig};
+  std::vector<Hash> busyClient;
+  for (int i = 0; i < 3; i++) {
+    auto [hash, request] =
+        makeBlobImportRequest(ImportPriority(ImportPriorityKind::Normal, 10));
+    request->setClientPid(1);
+    queue.enqueueBlob(std::move(request));
+    busyClient.push_back(hash);
+  }
+  auto [otherHash, otherRequest] =
+      makeBlobImportRequest(ImportPriority(ImportPriorityKind::Normal, 0));
+  otherRequest->setClientPid(2);
+  queue.enqueueBlob(std::move(otherRequest));
+
+  // The lower offset of the second client doesn't make it wait for all of
+  // the requests of the first one.
+  std::vector<Hash> dequeued;
+  for (int i = 0; i < 4; i++) {
+    auto request = queue.dequeue().at(0);
+    auto hash = request->getRequest<HgImportRequest::BlobImport>()->hash;
+    dequeued.push_back(hash);
+    auto blob = makeBlobTry(hash);
+    queue.markImportAsFinished<Blob>(hash, blob);
+  }
+  EXPECT_EQ(busyClient[0], dequeued[0]);
+  EXPECT_EQ(otherHash, dequeued[1]);
+}
+
+TEST_F(HgImportRequestQueueTest, waitingLowPriorityRequestsAreAged) {
+  rawEdenConfig->importAgingInterval.setValue(
+      std::chrono::milliseconds(1), ConfigSource::CommandLine);
+  auto queue = HgImportRequestQueue{edenConfig};
+
+  auto lowHash = insertBlobImportRequest(
+      queue, ImportPriority(ImportPriorityKind::Low, 1));
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  auto normalHash = insertBlobImportRequest(
+      queue, ImportPriority(ImportPriorityKind::Normal, 0));
+
+  for (auto expected : {lowHash, normalHash}) {
+    auto request = queue.dequeue().at(0);
+    auto hash = request->getRequest<HgImportRequest::BlobImport>()->hash;
+    EXPECT_EQ(expected, hash);
+    auto blob = makeBlobTry(hash);
+    queue.markImportAsFinished<Blob>(hash, blob);
+  }
+}
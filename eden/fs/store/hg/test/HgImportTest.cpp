@@ -5,17 +5,20 @@
  * GNU General Public License version 2.
  */
 
+#include <folly/String.h>
 #include <folly/experimental/TestUtil.h>
 #include <folly/futures/Future.h>
 #include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
 #include <folly/test/TestUtils.h>
+#include <map>
 
 #include "eden/fs/model/Blob.h"
 #include "eden/fs/model/Hash.h"
 #include "eden/fs/model/Tree.h"
 #include "eden/fs/store/hg/HgImportPyError.h"
 #include "eden/fs/store/hg/HgImporter.h"
+#include "eden/fs/store/hg/HgProxyHash.h"
 #include "eden/fs/telemetry/EdenStats.h"
 #include "eden/fs/testharness/HgRepo.h"
 #include "eden/fs/testharness/TestUtil.h"
@@ -90,6 +93,47 @@ TEST_F(HgImportTest, importTest) {
       "no match found");
 }
 
+TEST_F(HgImportTest, importFileContentsBatchPipelinesRequests) {
+  std::vector<std::pair<RelativePath, std::string>> files;
+  for (size_t i = 0; i < 2 * HgImporter::kMaxPipelinedRequests + 1; ++i) {
+    files.emplace_back(
+        RelativePath{folly::to<std::string>("file", i)},
+        folly::to<std::string>("contents of file ", i, "\n"));
+    repo_.writeFile(files.back().first, files.back().second);
+  }
+  repo_.hg("add");
+  repo_.commit("Initial commit");
+
+  auto manifest = repo_.hg("manifest", "--debug");
+  std::vector<folly::StringPiece> lines;
+  folly::split('\n', folly::StringPiece{manifest}, lines, true);
+  std::map<std::string, Hash> hashes;
+  for (auto line : lines) {
+    // Each line is the file hash, its mode and its path.
+    auto pathStart = line.rfind(' ') + 1;
+    hashes.emplace(line.subpiece(pathStart).str(), Hash{line.subpiece(0, 40)});
+  }
+
+  std::vector<HgProxyHash> request;
+  for (const auto& [path, contents] : files) {
+    request.emplace_back(path, hashes.at(path.value()));
+  }
+  // A missing file in the middle of a window doesn't fail the others.
+  request.insert(
+      request.begin() + 3, HgProxyHash{files[3].first, makeTestHash("123")});
+
+  HgImporter importer(repo_.path(), stats_);
+  auto blobs = importer.importFileContentsBatch(request);
+  ASSERT_EQ(request.size(), blobs.size());
+  EXPECT_TRUE(blobs[3].hasException());
+  for (size_t i = 0; i < files.size(); ++i) {
+    auto& blob = blobs[i < 3 ? i : i + 1];
+    ASSERT_TRUE(blob.hasValue()) << i;
+    EXPECT_BLOB_EQ(blob.value(), files[i].second);
+  }
+  EXPECT_TRUE(importer.isHelperRunning());
+}
+
 // TODO(T33797958): Check hg_importer_helper's exit code on Windows (in
 // HgImportTest).
 #ifndef _WIN32
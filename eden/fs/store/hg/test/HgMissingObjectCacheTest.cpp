@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/hg/HgMissingObjectCache.h"
+
+#include <folly/portability/GTest.h>
+#include <stdexcept>
+
+#include "eden/fs/store/hg/HgImporter.h"
+
+using namespace facebook::eden;
+using namespace std::chrono_literals;
+
+namespace {
+const Hash kId{folly::StringPiece{"1111111111111111111111111111111111111111"}};
+const Hash kOtherId{
+    folly::StringPiece{"2222222222222222222222222222222222222222"}};
+} // namespace
+
+TEST(HgMissingObjectCacheTest, missingObjectsFailUntilTheTtlExpires) {
+  HgMissingObjectCache cache{16};
+  auto now = HgMissingObjectCache::clock::now();
+
+  EXPECT_FALSE(cache.get(kId, now, 10s));
+
+  cache.insert(
+      kId,
+      {folly::make_exception_wrapper<std::domain_error>("not found"), false},
+      now);
+  auto missing = cache.get(kId, now + 5s, 10s);
+  ASSERT_TRUE(missing);
+  EXPECT_TRUE(missing->error.is_compatible_with<std::domain_error>());
+  EXPECT_FALSE(missing->proxyHashMissing);
+  EXPECT_FALSE(cache.get(kOtherId, now + 5s, 10s));
+
+  EXPECT_FALSE(cache.get(kId, now + 10s, 10s));
+  // The expired entry was dropped.
+  EXPECT_FALSE(cache.get(kId, now, 10s));
+}
+
+TEST(HgMissingObjectCacheTest, removedObjectsAreFetchedAgain) {
+  HgMissingObjectCache cache{16};
+  auto now = HgMissingObjectCache::clock::now();
+
+  cache.insert(
+      kId,
+      {folly::make_exception_wrapper<std::domain_error>("not found"), false},
+      now);
+  cache.remove(kId);
+  EXPECT_FALSE(cache.get(kId, now, 10s));
+}
+
+TEST(HgMissingObjectCacheTest, onlyMissingObjectErrorsAreDefinitive) {
+  EXPECT_TRUE(HgMissingObjectCache::isDefinitive(
+      folly::make_exception_wrapper<std::domain_error>("not found")));
+  EXPECT_FALSE(HgMissingObjectCache::isDefinitive(
+      folly::make_exception_wrapper<std::runtime_error>("network error")));
+  EXPECT_FALSE(HgMissingObjectCache::isDefinitive(
+      folly::make_exception_wrapper<HgImporterError>("helper died")));
+}
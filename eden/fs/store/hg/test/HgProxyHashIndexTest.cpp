@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/hg/HgProxyHashIndex.h"
+
+#include <folly/futures/Future.h>
+#include <folly/portability/GTest.h>
+#include <memory>
+
+#include "eden/fs/store/MemoryLocalStore.h"
+
+using namespace facebook::eden;
+
+namespace {
+const Hash kRevHash{
+    folly::StringPiece{"1111111111111111111111111111111111111111"}};
+} // namespace
+
+TEST(HgProxyHashIndexTest, storedProxyHashesAreFoundWithoutTheLocalStore) {
+  auto store = std::make_shared<MemoryLocalStore>();
+  HgProxyHashIndex index{1024};
+
+  auto write = store->beginWrite();
+  auto id = index.store(RelativePathPiece{"foo/bar"}, kRevHash, write.get());
+  write->flush();
+
+  auto proxyHash = index.get(id);
+  ASSERT_TRUE(proxyHash);
+  EXPECT_EQ(RelativePathPiece{"foo/bar"}, proxyHash->path());
+  EXPECT_EQ(kRevHash, proxyHash->revHash());
+
+  // The proxy hash is also written to the LocalStore.
+  EXPECT_EQ(
+      RelativePathPiece{"foo/bar"},
+      HgProxyHash::load(store.get(), id, "test").path());
+}
+
+TEST(HgProxyHashIndexTest, loadedProxyHashesAreAddedToTheIndex) {
+  auto store = std::make_shared<MemoryLocalStore>();
+  auto write = store->beginWrite();
+  auto id =
+      HgProxyHash::store(RelativePathPiece{"foo/bar"}, kRevHash, write.get());
+  write->flush();
+
+  HgProxyHashIndex index{1024};
+  EXPECT_FALSE(index.get(id));
+  EXPECT_EQ(kRevHash, index.load(store.get(), id, "test").revHash());
+  EXPECT_TRUE(index.get(id));
+}
+
+TEST(HgProxyHashIndexTest, getBatchMergesTheIndexAndTheLocalStore) {
+  auto store = std::make_shared<MemoryLocalStore>();
+  HgProxyHashIndex index{1024};
+
+  auto write = store->beginWrite();
+  std::vector<Hash> ids;
+  ids.push_back(index.store(RelativePathPiece{"a"}, kRevHash, write.get()));
+  ids.push_back(
+      HgProxyHash::store(RelativePathPiece{"b"}, kRevHash, write.get()));
+  ids.push_back(index.store(RelativePathPiece{"c"}, kRevHash, write.get()));
+  write->flush();
+
+  auto proxyHashes =
+      index.getBatch(store.get(), HashRange{ids.data(), ids.size()}).get();
+  ASSERT_EQ(3, proxyHashes.size());
+  EXPECT_EQ(RelativePathPiece{"a"}, proxyHashes[0].path());
+  EXPECT_EQ(RelativePathPiece{"b"}, proxyHashes[1].path());
+  EXPECT_EQ(RelativePathPiece{"c"}, proxyHashes[2].path());
+  EXPECT_TRUE(index.get(ids[1]));
+}
+
+TEST(HgProxyHashIndexTest, leastRecentlyUsedEntriesAreEvicted) {
+  auto store = std::make_shared<MemoryLocalStore>();
+  // A single entry per shard.
+  HgProxyHashIndex index{1};
+
+  auto write = store->beginWrite();
+  std::vector<Hash> ids;
+  for (int i = 0; i < 100; ++i) {
+    ids.push_back(index.store(
+        RelativePath{folly::to<std::string>("file", i)},
+        kRevHash,
+        write.get()));
+  }
+  write->flush();
+
+  size_t indexed = 0;
+  for (const auto& id : ids) {
+    indexed += index.get(id).has_value();
+  }
+  EXPECT_GE(16, indexed);
+  // Evicted entries are still loaded from the LocalStore.
+  EXPECT_EQ(
+      RelativePathPiece{"file0"},
+      index.load(store.get(), ids[0], "test").path());
+}
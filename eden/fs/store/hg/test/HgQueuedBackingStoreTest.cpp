@@ -120,3 +120,19 @@ TEST_F(HgQueuedBackingStoreTest, getBlob) {
     }
   }
 }
+
+TEST_F(HgQueuedBackingStoreTest, missingObjectIsServedFromTheCache) {
+  auto queuedStore = makeQueuedStore();
+  Hash unknown{folly::StringPiece{"1111111111111111111111111111111111111111"}};
+
+  // The first lookup fails on loading the object's proxy hash.
+  EXPECT_THROW(
+      queuedStore->getBlob(unknown, ObjectFetchContext::getNullContext()),
+      std::domain_error);
+
+  // The second one fails with the cached error, without loading it again.
+  auto blob =
+      queuedStore->getBlob(unknown, ObjectFetchContext::getNullContext());
+  ASSERT_TRUE(blob.isReady());
+  EXPECT_THROW(std::move(blob).get(kTestTimeout), std::domain_error);
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/hg/TreeMetadataBatcher.h"
+
+#include <folly/executors/QueuedImmediateExecutor.h>
+#include <folly/futures/Future.h>
+#include <folly/portability/GTest.h>
+
+#include "eden/fs/config/EdenConfig.h"
+#include "eden/fs/config/ReloadableConfig.h"
+#include "eden/fs/store/BlobMetadata.h"
+#include "eden/fs/store/MemoryLocalStore.h"
+#include "eden/fs/store/TreeMetadata.h"
+#include "eden/fs/store/hg/MetadataImporter.h"
+
+using namespace facebook::eden;
+
+namespace {
+/**
+ * A MetadataImporter whose batches complete when the test fulfills them.
+ */
+class DeferredMetadataImporter : public MetadataImporter {
+ public:
+  using Results = std::vector<folly::Try<std::unique_ptr<TreeMetadata>>>;
+
+  folly::SemiFuture<std::unique_ptr<TreeMetadata>> getTreeMetadata(
+      const Hash& /*edenId*/,
+      const Hash& /*manifestId*/) override {
+    return folly::SemiFuture<std::unique_ptr<TreeMetadata>>::makeEmpty();
+  }
+
+  folly::SemiFuture<Results> getTreeMetadataBatch(
+      const std::vector<std::pair<Hash, Hash>>& trees) override {
+    batches.push_back(trees);
+    promises.emplace_back();
+    return promises.back().getSemiFuture();
+  }
+
+  bool metadataFetchingAvailable() override {
+    return true;
+  }
+
+  std::vector<std::vector<std::pair<Hash, Hash>>> batches;
+  std::vector<folly::Promise<Results>> promises;
+};
+
+Tree makeTree(folly::StringPiece hash, const Hash& childHash) {
+  std::vector<TreeEntry> entries;
+  entries.emplace_back(
+      childHash, PathComponent{"child"}, TreeEntryType::REGULAR_FILE);
+  return Tree{std::move(entries), Hash{hash}};
+}
+
+const Hash kManifest{"0000000000000000000000000000000000000000"};
+const Hash kChild{"8e073e366ed82de6465d1209d3f07da7eebabb93"};
+} // namespace
+
+struct TreeMetadataBatcherTest : ::testing::Test {
+  TreeMetadataBatcherTest() {
+    rawEdenConfig->scsMaxConcurrentMetadataBatches.setValue(
+        1, ConfigSource::CommandLine);
+    rawEdenConfig->scsMetadataBatchSize.setValue(2, ConfigSource::CommandLine);
+  }
+
+  std::shared_ptr<EdenConfig> rawEdenConfig{EdenConfig::createTestEdenConfig()};
+  std::shared_ptr<MemoryLocalStore> localStore{
+      std::make_shared<MemoryLocalStore>()};
+  std::shared_ptr<DeferredMetadataImporter> importer{
+      std::make_shared<DeferredMetadataImporter>()};
+  std::shared_ptr<TreeMetadataBatcher> batcher{
+      std::make_shared<TreeMetadataBatcher>(
+          importer,
+          localStore,
+          &folly::QueuedImmediateExecutor::instance(),
+          std::make_shared<ReloadableConfig>(
+              rawEdenConfig,
+              ConfigReloadBehavior::NoReload))};
+};
+
+TEST_F(TreeMetadataBatcherTest, treesRequestedMeanwhileAreBatched) {
+  batcher->fetch(
+      makeTree("1111111111111111111111111111111111111111", kChild), kManifest);
+  ASSERT_EQ(1, importer->batches.size());
+
+  batcher->fetch(
+      makeTree("2222222222222222222222222222222222222222", kChild), kManifest);
+  batcher->fetch(
+      makeTree("3333333333333333333333333333333333333333", kChild), kManifest);
+  batcher->fetch(
+      makeTree("4444444444444444444444444444444444444444", kChild), kManifest);
+  // Only one batch is in flight at a time.
+  EXPECT_EQ(1, importer->batches.size());
+
+  importer->promises[0].setValue(DeferredMetadataImporter::Results(1));
+  ASSERT_EQ(2, importer->batches.size());
+  EXPECT_EQ(2, importer->batches[1].size());
+
+  importer->promises[1].setValue(DeferredMetadataImporter::Results(2));
+  ASSERT_EQ(3, importer->batches.size());
+  EXPECT_EQ(1, importer->batches[2].size());
+}
+
+TEST_F(TreeMetadataBatcherTest, fetchedMetadataIsStored) {
+  batcher->fetch(
+      makeTree("1111111111111111111111111111111111111111", kChild), kManifest);
+  ASSERT_EQ(1, importer->batches.size());
+
+  auto childMetadata =
+      BlobMetadata{Hash::sha1(folly::ByteRange{folly::StringPiece{"x"}}), 1};
+  DeferredMetadataImporter::Results results;
+  results.emplace_back(std::make_unique<TreeMetadata>(
+      TreeMetadata::NameIndexedEntryMetadata{{"child", childMetadata}}));
+  importer->promises[0].setValue(std::move(results));
+
+  auto stored = localStore->getBlobMetadata(kChild).get();
+  ASSERT_TRUE(stored);
+  EXPECT_EQ(1, stored->size);
+  EXPECT_EQ(childMetadata.sha1, stored->sha1);
+}
@@ -113,3 +113,47 @@ TEST(BlobCache, does_not_forget_blob_until_last_handle_is_forgotten) {
   result2.interestHandle.reset();
   EXPECT_FALSE(weak.lock());
 }
+
+namespace {
+std::shared_ptr<Blob> makeCompressibleBlob(const Hash& hash, char c) {
+  return std::make_shared<Blob>(hash, std::string(1000, c));
+}
+} // namespace
+
+TEST(BlobCache, evicted_blobs_are_kept_compressed) {
+  auto cache = BlobCache::create(1500, 0, 1, ObjectCachePolicy::LRU, 10000);
+  auto blobA = makeCompressibleBlob(hash3, 'a');
+  auto blobB = makeCompressibleBlob(hash4, 'b');
+  cache->insert(blobA);
+  cache->insert(blobB); // evicts blobA into the compressed tier
+  EXPECT_FALSE(cache->contains(hash3));
+
+  auto compressedStats = cache->getCompressedStats();
+  EXPECT_EQ(1, compressedStats.objectCount);
+  EXPECT_LT(compressedStats.totalSizeInBytes, 1000);
+
+  auto result = cache->get(hash3);
+  ASSERT_TRUE(result.object);
+  EXPECT_EQ(std::string(1000, 'a'), result.object->getContents().toString());
+  // blobA is decompressed back in, evicting blobB.
+  EXPECT_TRUE(cache->contains(hash3));
+  EXPECT_FALSE(cache->contains(hash4));
+  EXPECT_EQ(1, cache->getCompressedStats().hitCount);
+  EXPECT_EQ(2, cache->getCompressedStats().objectCount);
+}
+
+TEST(BlobCache, incompressible_blobs_are_not_kept_compressed) {
+  auto cache = BlobCache::create(10, 0, 1, ObjectCachePolicy::LRU, 10000);
+  cache->insert(blob3);
+  cache->insert(blob9);
+  EXPECT_EQ(0, cache->getCompressedStats().objectCount);
+  EXPECT_FALSE(cache->get(hash3).object);
+}
+
+TEST(BlobCache, compressed_tier_is_disabled_by_default) {
+  auto cache = BlobCache::create(1500, 0);
+  cache->insert(makeCompressibleBlob(hash3, 'a'));
+  cache->insert(makeCompressibleBlob(hash4, 'b'));
+  EXPECT_FALSE(cache->get(hash3).object);
+  EXPECT_EQ(0, cache->getCompressedStats().objectCount);
+}
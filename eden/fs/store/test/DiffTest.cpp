@@ -430,6 +430,54 @@ TEST_F(DiffTest, blockedFutures) {
 #endif
 }
 
+TEST_F(DiffTest, limitedConcurrentTreeFetches) {
+  FakeTreeBuilder builder;
+  builder.setFile("a/b/c/d/e/f.txt", "contents");
+  builder.setFile("a/b/1.txt", "1");
+  builder.setFile("src/main.c", "hello world");
+  builder.setFile("src/test/test.c", "testing");
+  builder.setFile("doc/readme.txt", "docs");
+  builder.finalize(backingStore_, /* setReady */ false);
+  auto root1 = backingStore_->putCommit("1", builder);
+
+  auto builder2 = builder.clone();
+  builder2.replaceFile("src/main.c", "hello world v2");
+  builder2.setFile("src/test/test2.c", "another test");
+  builder2.removeFile("a/b/c/d/e/f.txt");
+  builder2.replaceFile("doc/readme.txt", "more docs");
+  builder2.finalize(backingStore_, /* setReady */ false);
+  auto root2 = backingStore_->putCommit("2", builder2);
+
+  // Only allow one tree to be fetched at a time, so that the fetches of the
+  // sibling directories have to wait for each other.
+  auto resultFuture = diffCommitsForStatus(
+      store_.get(),
+      RootId{"1"},
+      RootId{"2"},
+      /*maxConcurrentTreeFetches=*/1);
+  EXPECT_FALSE(resultFuture.isReady());
+
+  root1->setReady();
+  root2->setReady();
+  builder.setReady("");
+  builder2.setReady("");
+  EXPECT_FALSE(resultFuture.isReady());
+
+  builder.setAllReady();
+  builder2.setAllReady();
+  ASSERT_TRUE(resultFuture.isReady());
+
+  auto result = std::move(resultFuture).get();
+  EXPECT_THAT(*result->errors_ref(), UnorderedElementsAre());
+  EXPECT_THAT(
+      *result->entries_ref(),
+      UnorderedElementsAre(
+          Pair("src/main.c", ScmFileStatus::MODIFIED),
+          Pair("src/test/test2.c", ScmFileStatus::ADDED),
+          Pair("a/b/c/d/e/f.txt", ScmFileStatus::REMOVED),
+          Pair("doc/readme.txt", ScmFileStatus::MODIFIED)));
+}
+
 TEST_F(DiffTest, loadTreeError) {
   FakeTreeBuilder builder;
 
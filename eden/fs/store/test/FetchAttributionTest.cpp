@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/FetchAttribution.h"
+#include <gtest/gtest.h>
+#include "eden/fs/store/StatsFetchContext.h"
+
+using namespace facebook::eden;
+
+namespace {
+StatsFetchContext makeContext(pid_t pid) {
+  return StatsFetchContext{pid, ObjectFetchContext::Fs, "test"};
+}
+} // namespace
+
+TEST(FetchAttribution, chargesLocalReadsAndImports) {
+  FetchAttribution attribution;
+  auto context = makeContext(10);
+  attribution.record(
+      context, ObjectFetchContext::Tree, ObjectFetchContext::FromDiskCache);
+  attribution.record(
+      context, ObjectFetchContext::Blob, ObjectFetchContext::FromBackingStore);
+  attribution.record(
+      context, ObjectFetchContext::Blob, ObjectFetchContext::FromBackingStore);
+  // Memory cache hits cost nothing.
+  attribution.record(
+      context, ObjectFetchContext::Blob, ObjectFetchContext::FromMemoryCache);
+
+  auto entries = attribution.getEntries();
+  ASSERT_EQ(1, entries.size());
+  EXPECT_EQ(10, entries[0].cause.pid);
+  EXPECT_EQ(ObjectFetchContext::Fs, entries[0].cause.cause);
+  EXPECT_EQ(1, entries[0].localStoreReads);
+  EXPECT_EQ(2, entries[0].backingStoreImports[ObjectFetchContext::Blob]);
+  EXPECT_EQ(0, entries[0].backingStoreImports[ObjectFetchContext::Tree]);
+  EXPECT_EQ(3, entries[0].weight);
+  EXPECT_EQ(0, entries[0].overestimate);
+}
+
+TEST(FetchAttribution, keepsHeavyHittersWithinCapacity) {
+  FetchAttribution attribution{4};
+  auto heavy = makeContext(1);
+  for (pid_t pid = 100; pid < 200; ++pid) {
+    attribution.record(
+        heavy, ObjectFetchContext::Blob, ObjectFetchContext::FromBackingStore);
+    attribution.record(
+        makeContext(pid),
+        ObjectFetchContext::Blob,
+        ObjectFetchContext::FromBackingStore);
+  }
+
+  auto entries = attribution.getEntries();
+  ASSERT_EQ(4, entries.size());
+  // Half of the imports are the heavy process', which is never replaced.
+  EXPECT_EQ(1, entries[0].cause.pid);
+  EXPECT_EQ(100, entries[0].weight);
+  EXPECT_EQ(0, entries[0].overestimate);
+  for (size_t i = 1; i < entries.size(); ++i) {
+    EXPECT_LE(entries[i].weight - entries[i].overestimate, 1);
+  }
+}
+
+TEST(FetchAttribution, clearForgetsEverything) {
+  FetchAttribution attribution;
+  attribution.record(
+      makeContext(1),
+      ObjectFetchContext::Tree,
+      ObjectFetchContext::FromBackingStore);
+  attribution.clear();
+  EXPECT_TRUE(attribution.getEntries().empty());
+}
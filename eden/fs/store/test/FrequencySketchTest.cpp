@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/FrequencySketch.h"
+#include <gtest/gtest.h>
+
+using namespace facebook::eden;
+
+TEST(FrequencySketch, estimatesAreZeroBeforeSizing) {
+  FrequencySketch sketch;
+  sketch.increment(1);
+  EXPECT_EQ(0, sketch.estimate(1));
+}
+
+TEST(FrequencySketch, countsSaturate) {
+  FrequencySketch sketch;
+  sketch.ensureCapacity(100);
+  EXPECT_EQ(128, sketch.getWidth());
+  for (int i = 0; i < 3; ++i) {
+    sketch.increment(42);
+  }
+  EXPECT_EQ(3, sketch.estimate(42));
+  EXPECT_EQ(0, sketch.estimate(43));
+  for (int i = 0; i < 100; ++i) {
+    sketch.increment(42);
+  }
+  EXPECT_EQ(FrequencySketch::kMaxCount, sketch.estimate(42));
+}
+
+TEST(FrequencySketch, countsAreHalvedPeriodically) {
+  FrequencySketch sketch;
+  sketch.ensureCapacity(64);
+  for (int i = 0; i < 8; ++i) {
+    sketch.increment(1);
+  }
+  // Only the aging can lower an estimate. It happens after ten increments
+  // per counter of a row.
+  bool lowered = false;
+  auto previous = sketch.estimate(1);
+  for (uint64_t key = 1000; key < 1000 + 64 * 10 && !lowered; ++key) {
+    sketch.increment(key);
+    auto current = sketch.estimate(1);
+    lowered = current < previous;
+    previous = current;
+  }
+  EXPECT_TRUE(lowered);
+  EXPECT_GE(FrequencySketch::kMaxCount / 2, sketch.estimate(1));
+}
+
+TEST(FrequencySketch, growingResetsTheCounts) {
+  FrequencySketch sketch;
+  sketch.ensureCapacity(64);
+  sketch.increment(7);
+  sketch.ensureCapacity(10);
+  EXPECT_EQ(1, sketch.estimate(7));
+  sketch.ensureCapacity(65);
+  EXPECT_EQ(128, sketch.getWidth());
+  EXPECT_EQ(0, sketch.estimate(7));
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/LocalStoreAccessLog.h"
+
+#include <folly/FileUtil.h>
+#include <folly/portability/GTest.h>
+
+#include "eden/fs/testharness/TempFile.h"
+
+using namespace facebook::eden;
+using namespace folly::string_piece_literals;
+
+namespace {
+
+std::vector<std::string> readKeys(AbsolutePathPiece path) {
+  std::vector<std::string> keys;
+  LocalStoreAccessLog::read(path, [&](const LocalStoreAccessLog::Access& a) {
+    keys.push_back(a.key);
+  });
+  return keys;
+}
+
+} // namespace
+
+TEST(LocalStoreAccessLog, rotatedLogIsReadFirst) {
+  auto tempDir = makeTempDir();
+  auto path = AbsolutePath{tempDir.path().string()} + "log"_pc;
+  // Room for about two lines.
+  LocalStoreAccessLog log{path, /*sampleDenominator=*/1, /*maxBytes=*/40};
+  for (auto key : {"k1"_sp, "k2"_sp, "k3"_sp}) {
+    log.record(KeySpace::TreeFamily, key, /*hit=*/true);
+  }
+  EXPECT_EQ((std::vector<std::string>{"k1", "k2", "k3"}), readKeys(path));
+
+  // Only the previous log is kept.
+  for (auto key : {"k4"_sp, "k5"_sp}) {
+    log.record(KeySpace::TreeFamily, key, /*hit=*/true);
+  }
+  EXPECT_EQ((std::vector<std::string>{"k3", "k4", "k5"}), readKeys(path));
+}
+
+TEST(LocalStoreAccessLog, malformedLinesAreSkipped) {
+  auto tempDir = makeTempDir();
+  auto path = AbsolutePath{tempDir.path().string()} + "log"_pc;
+  ASSERT_TRUE(folly::writeFile(
+      "tree 6b31 hit\n"
+      "nosuchkeyspace 6b32 hit\n"
+      "tree zz miss\n"
+      "blob 6b33 miss\n"
+      "blob 6b3"_sp,
+      path.c_str()));
+
+  std::vector<std::pair<std::string, bool>> accesses;
+  LocalStoreAccessLog::read(path, [&](const LocalStoreAccessLog::Access& a) {
+    accesses.emplace_back(a.key, a.hit);
+  });
+  EXPECT_EQ(
+      (std::vector<std::pair<std::string, bool>>{{"k1", true}, {"k3", false}}),
+      accesses);
+}
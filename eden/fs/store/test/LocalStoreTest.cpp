@@ -8,8 +8,12 @@
 #ifndef _WIN32
 
 #include "eden/fs/store/test/LocalStoreTest.h"
+#include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/store/MemoryLocalStore.h"
+#include "eden/fs/store/PackLocalStore.h"
 #include "eden/fs/store/SqliteLocalStore.h"
+#include "eden/fs/store/TieredLocalStore.h"
+#include "eden/fs/store/WriteBackLocalStore.h"
 
 namespace {
 
@@ -28,6 +32,35 @@ LocalStoreImplResult makeSqliteLocalStore(FaultInjector*) {
   return {std::move(tempDir), std::move(store)};
 }
 
+LocalStoreImplResult makePackLocalStore(FaultInjector*) {
+  auto tempDir = makeTempDir();
+  auto store = std::make_unique<PackLocalStore>(
+      AbsolutePathPiece{tempDir.path().string()},
+      *EdenConfig::createTestEdenConfig());
+  return {std::move(tempDir), std::move(store)};
+}
+
+LocalStoreImplResult makeWriteBackLocalStore(FaultInjector*) {
+  // A small limit, so that the tests also exercise the backpressure.
+  return {
+      std::nullopt,
+      std::make_unique<WriteBackLocalStore>(
+          std::make_shared<MemoryLocalStore>(), /*maxPendingBytes=*/1024)};
+}
+
+LocalStoreImplResult makeTieredLocalStore(FaultInjector*) {
+  auto config = EdenConfig::createTestEdenConfig();
+  config->localStoreL1CacheSize.setValue(
+      1024 * 1024, ConfigSource::CommandLine);
+  config->localStoreL1CacheKeySpaces.setValue(
+      std::vector<std::string>{"blob", "blobmeta", "tree"},
+      ConfigSource::CommandLine);
+  return {
+      std::nullopt,
+      std::make_unique<TieredLocalStore>(
+          std::make_shared<MemoryLocalStore>(), *config)};
+}
+
 TEST_P(LocalStoreTest, testReadAndWriteBlob) {
   Hash hash{"3a8f8eb91101860fd8484154885838bf322964d0"};
 
@@ -194,6 +227,31 @@ TEST_P(LocalStoreTest, testMultipleBlobWriters) {
   EXPECT_EQ("hello world1_4", result1_4.piece());
 }
 
+TEST_P(LocalStoreTest, testGetBatch) {
+  std::vector<std::string> keys;
+  for (int i = 0; i < 3000; ++i) {
+    keys.push_back(folly::to<std::string>("key", i));
+    if (i % 3 != 0) {
+      auto key = StringPiece{keys.back()};
+      store_->put(KeySpace::BlobFamily, key, key);
+    }
+  }
+  std::vector<folly::ByteRange> keyRanges;
+  for (const auto& key : keys) {
+    keyRanges.emplace_back(folly::StringPiece{key});
+  }
+
+  auto results = store_->getBatch(KeySpace::BlobFamily, keyRanges).get(10s);
+  ASSERT_EQ(keys.size(), results.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (i % 3 == 0) {
+      EXPECT_FALSE(results[i].isValid()) << keys[i];
+    } else {
+      EXPECT_EQ(keys[i], results[i].piece()) << keys[i];
+    }
+  }
+}
+
 TEST_P(LocalStoreTest, testClearKeySpace) {
   store_->put(KeySpace::BlobFamily, "key1"_sp, "blob1"_sp);
   store_->put(KeySpace::BlobFamily, "key2"_sp, "blob2"_sp);
@@ -215,6 +273,21 @@ INSTANTIATE_TEST_CASE_P(
     Sqlite,
     LocalStoreTest,
     ::testing::Values(makeSqliteLocalStore));
+
+INSTANTIATE_TEST_CASE_P(
+    Pack,
+    LocalStoreTest,
+    ::testing::Values(makePackLocalStore));
+
+INSTANTIATE_TEST_CASE_P(
+    WriteBack,
+    LocalStoreTest,
+    ::testing::Values(makeWriteBackLocalStore));
+
+INSTANTIATE_TEST_CASE_P(
+    Tiered,
+    LocalStoreTest,
+    ::testing::Values(makeTieredLocalStore));
 #pragma clang diagnostic pop
 
 } // namespace
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/MemoryLocalStore.h"
+
+#include <folly/portability/GTest.h>
+#include <thread>
+#include <variant>
+
+#include "eden/fs/config/EdenConfig.h"
+#include "eden/fs/store/StoreResult.h"
+
+using namespace facebook::eden;
+using namespace folly::string_piece_literals;
+
+namespace {
+
+std::string key(int i) {
+  return folly::to<std::string>("key", i);
+}
+
+bool hasValue(const MemoryLocalStore& store, KeySpace keySpace, int i) {
+  return store.hasKey(keySpace, folly::StringPiece{key(i)});
+}
+
+void putValues(
+    MemoryLocalStore& store,
+    KeySpace keySpace,
+    int begin,
+    int end,
+    size_t valueSize) {
+  for (int i = begin; i < end; ++i) {
+    store.put(
+        keySpace,
+        folly::StringPiece{key(i)},
+        folly::StringPiece{std::string(valueSize, 'x')});
+  }
+}
+
+std::shared_ptr<EdenConfig> makeConfig(uint64_t memoryLimit) {
+  std::shared_ptr<EdenConfig> config = EdenConfig::createTestEdenConfig();
+  config->localStoreMemoryLimit.setValue(
+      memoryLimit, ConfigSource::CommandLine);
+  return config;
+}
+
+} // namespace
+
+TEST(MemoryLocalStore, unboundedByDefault) {
+  MemoryLocalStore store;
+  putValues(store, KeySpace::BlobFamily, 0, 1000, 1024);
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_TRUE(hasValue(store, KeySpace::BlobFamily, i)) << i;
+  }
+}
+
+TEST(MemoryLocalStore, ephemeralKeySpacesStayUnderTheirLimit) {
+  auto config = makeConfig(16 * 1024 * 1024);
+  MemoryLocalStore store{*config, /*shardCount=*/4};
+  putValues(store, KeySpace::BlobFamily, 0, 20000, 1024);
+  EXPECT_GE(16 * 1024 * 1024, store.getApproximateSize(KeySpace::BlobFamily));
+  EXPECT_FALSE(hasValue(store, KeySpace::BlobFamily, 0));
+  EXPECT_TRUE(hasValue(store, KeySpace::BlobFamily, 19999));
+}
+
+TEST(MemoryLocalStore, recentlyReadValuesAreKept) {
+  MemoryLocalStore store{/*shardCount=*/1};
+  putValues(store, KeySpace::BlobFamily, 0, 100, 1024);
+  auto size = store.getApproximateSize(KeySpace::BlobFamily);
+
+  // Limit the blobs to just what they use now.
+  auto config = makeConfig(0);
+  double totalSizeLimit = 0;
+  for (auto& ks : KeySpace::kAll) {
+    if (const auto* ephemeral = std::get_if<Ephemeral>(&ks->persistence)) {
+      totalSizeLimit += ((*config).*(ephemeral->cacheLimit)).getValue();
+    }
+  }
+  auto blobShare =
+      config->localStoreBlobSizeLimit.getValue() / totalSizeLimit;
+  config->localStoreMemoryLimit.setValue(
+      static_cast<uint64_t>((size + 10) / blobShare) + 1,
+      ConfigSource::CommandLine);
+  store.periodicManagementTask(*config);
+  EXPECT_EQ(size, store.getApproximateSize(KeySpace::BlobFamily));
+
+  // Reading the oldest value makes the next put evict the second oldest.
+  EXPECT_TRUE(store.get(KeySpace::BlobFamily, "key0"_sp).isValid());
+  putValues(store, KeySpace::BlobFamily, 100, 101, 1024);
+  EXPECT_TRUE(hasValue(store, KeySpace::BlobFamily, 0));
+  EXPECT_FALSE(hasValue(store, KeySpace::BlobFamily, 1));
+  EXPECT_TRUE(hasValue(store, KeySpace::BlobFamily, 100));
+}
+
+TEST(MemoryLocalStore, persistentKeySpacesAreNeverEvicted) {
+  auto config = makeConfig(1024);
+  MemoryLocalStore store{*config};
+  putValues(store, KeySpace::HgProxyHashFamily, 0, 1000, 100);
+  store.periodicManagementTask(*config);
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_TRUE(hasValue(store, KeySpace::HgProxyHashFamily, i)) << i;
+  }
+}
+
+TEST(MemoryLocalStore, largeValuesOutliveTheirEviction) {
+  MemoryLocalStore store;
+  std::string value(64 * 1024, 'v');
+  store.put(KeySpace::BlobFamily, "key"_sp, folly::StringPiece{value});
+  auto result = store.get(KeySpace::BlobFamily, "key"_sp);
+  store.clearKeySpace(KeySpace::BlobFamily);
+  ASSERT_TRUE(result.isValid());
+  EXPECT_EQ(value, result.piece());
+}
+
+TEST(MemoryLocalStore, concurrentPutsAndBatchReads) {
+  MemoryLocalStore store;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&store, t] {
+      auto batch = store.beginWrite();
+      for (int i = t * 1000; i < (t + 1) * 1000; ++i) {
+        batch->put(
+            KeySpace::TreeFamily,
+            folly::StringPiece{key(i)},
+            folly::StringPiece{key(i)});
+      }
+      batch->flush();
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  std::vector<std::string> keys;
+  for (int i = 0; i < 8000; i += 7) {
+    keys.push_back(key(i));
+  }
+  keys.push_back("missing");
+  std::vector<folly::ByteRange> keyRanges;
+  for (auto& k : keys) {
+    keyRanges.push_back(folly::StringPiece{k});
+  }
+  auto results = store.getBatch(KeySpace::TreeFamily, keyRanges).get();
+  ASSERT_EQ(keys.size(), results.size());
+  for (size_t i = 0; i + 1 < keys.size(); ++i) {
+    EXPECT_EQ(keys[i], results[i].piece());
+  }
+  EXPECT_FALSE(results.back().isValid());
+}
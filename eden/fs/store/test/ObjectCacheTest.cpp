@@ -7,6 +7,9 @@
 
 #include "eden/fs/store/ObjectCache.h"
 #include <gtest/gtest.h>
+#include <array>
+#include <cstring>
+#include <vector>
 
 using namespace folly::literals;
 using namespace facebook::eden;
@@ -525,3 +528,165 @@ TEST(
   handle3.reset();
   EXPECT_TRUE(cache->contains(hash3));
 }
+
+/**
+ * sharded test cases
+ */
+
+namespace {
+std::vector<std::shared_ptr<CacheObject>>
+makeObjects(size_t count, size_t size, size_t first = 0) {
+  std::vector<std::shared_ptr<CacheObject>> objects;
+  for (size_t i = first; i < first + count; ++i) {
+    std::array<uint8_t, Hash::RAW_SIZE> bytes{};
+    std::memcpy(bytes.data(), &i, sizeof(i));
+    objects.push_back(std::make_shared<CacheObject>(Hash{bytes}, size));
+  }
+  return objects;
+}
+} // namespace
+
+TEST(ObjectCache, testShardedStatsAreSummedOverShards) {
+  auto cache =
+      ObjectCache<CacheObject, ObjectCacheFlavor::Simple>::create(1000, 1, 4);
+  EXPECT_EQ(4, cache->getShardCount());
+
+  auto objects = makeObjects(20, 3);
+  for (const auto& object : objects) {
+    cache->insertSimple(object);
+  }
+  for (const auto& object : objects) {
+    EXPECT_EQ(object, cache->getSimple(object->getHash()));
+  }
+  EXPECT_EQ(nullptr, cache->getSimple(hash11));
+
+  auto stats = cache->getStats();
+  EXPECT_EQ(20, stats.objectCount);
+  EXPECT_EQ(60, stats.totalSizeInBytes);
+  EXPECT_EQ(20, stats.hitCount);
+  EXPECT_EQ(1, stats.missCount);
+  EXPECT_EQ(0, stats.evictionCount);
+
+  cache->clear();
+  EXPECT_EQ(0, cache->getStats().objectCount);
+  EXPECT_EQ(0, cache->getStats().totalSizeInBytes);
+}
+
+TEST(ObjectCache, testShardsSplitTheLimits) {
+  // Each shard holds at most 25 bytes, but keeps at least 2 entries.
+  auto cache =
+      ObjectCache<CacheObject, ObjectCacheFlavor::Simple>::create(100, 5, 4);
+  for (const auto& object : makeObjects(100, 10)) {
+    cache->insertSimple(object);
+  }
+  auto stats = cache->getStats();
+  EXPECT_LE(stats.totalSizeInBytes, 100);
+  EXPECT_EQ(8, stats.objectCount);
+  EXPECT_EQ(92, stats.evictionCount);
+}
+
+TEST(ObjectCache, testShardedInterestHandleEvictsFromItsShard) {
+  auto cache =
+      ObjectCache<CacheObject, ObjectCacheFlavor::InterestHandle>::create(
+          1000, 0, 4);
+  auto objects = makeObjects(8, 3);
+  std::vector<ObjectInterestHandle<CacheObject>> handles;
+  for (const auto& object : objects) {
+    handles.push_back(cache->insertInterestHandle(
+        object,
+        ObjectCache<CacheObject, ObjectCacheFlavor::InterestHandle>::Interest::
+            WantHandle));
+  }
+  handles[3].reset();
+  for (size_t i = 0; i < objects.size(); ++i) {
+    EXPECT_EQ(i != 3, cache->contains(objects[i]->getHash()));
+  }
+  EXPECT_EQ(1, cache->getStats().dropCount);
+}
+
+/**
+ * TinyLFU test cases
+ */
+
+namespace {
+template <ObjectCacheFlavor Flavor>
+void readOnce(
+    ObjectCache<CacheObject, Flavor>& cache,
+    const std::shared_ptr<CacheObject>& object) {
+  if (!cache.getSimple(object->getHash())) {
+    cache.insertSimple(object);
+  }
+}
+
+/**
+ * Read a few objects repeatedly, then scan many objects once, and return how
+ * many of the former are still cached.
+ */
+size_t hotObjectsCachedAfterScan(
+    ObjectCache<CacheObject, ObjectCacheFlavor::Simple>& cache) {
+  auto hot = makeObjects(5, 10);
+  for (int round = 0; round < 5; ++round) {
+    for (const auto& object : hot) {
+      readOnce(cache, object);
+    }
+  }
+  for (const auto& object : makeObjects(100, 10, 1000)) {
+    readOnce(cache, object);
+  }
+
+  size_t cached = 0;
+  for (const auto& object : hot) {
+    cached += cache.contains(object->getHash());
+  }
+  return cached;
+}
+} // namespace
+
+TEST(ObjectCache, testLRUIsFlushedByScans) {
+  auto cache =
+      ObjectCache<CacheObject, ObjectCacheFlavor::Simple>::create(100, 0);
+  EXPECT_EQ(0, hotObjectsCachedAfterScan(*cache));
+}
+
+TEST(ObjectCache, testTinyLFUKeepsFrequentObjectsDuringScans) {
+  auto cache = ObjectCache<CacheObject, ObjectCacheFlavor::Simple>::create(
+      100, 0, 1, ObjectCachePolicy::TinyLFU);
+  EXPECT_EQ(5, hotObjectsCachedAfterScan(*cache));
+
+  auto stats = cache->getStats();
+  EXPECT_LE(stats.totalSizeInBytes, 100);
+  EXPECT_LT(0, stats.rejectionCount);
+  // The hot objects were only missed on their first read.
+  EXPECT_EQ(20, stats.hitCount);
+  EXPECT_EQ(105, stats.missCount);
+  EXPECT_DOUBLE_EQ(20.0 / 125, stats.getHitRate());
+}
+
+TEST(ObjectCache, testTinyLFUAdmitsFreelyUntilFull) {
+  auto cache = ObjectCache<CacheObject, ObjectCacheFlavor::Simple>::create(
+      100, 0, 1, ObjectCachePolicy::TinyLFU);
+  auto objects = makeObjects(10, 10);
+  for (const auto& object : objects) {
+    cache->insertSimple(object);
+  }
+  for (const auto& object : objects) {
+    EXPECT_TRUE(cache->contains(object->getHash()));
+  }
+  EXPECT_EQ(0, cache->getStats().rejectionCount);
+}
+
+TEST(ObjectCache, testTinyLFUDroppingInterestHandleEvicts) {
+  using Cache = ObjectCache<CacheObject, ObjectCacheFlavor::InterestHandle>;
+  auto cache = Cache::create(100, 0, 1, ObjectCachePolicy::TinyLFU);
+  auto handle3 =
+      cache->insertInterestHandle(object3, Cache::Interest::WantHandle);
+  auto handle4 =
+      cache->insertInterestHandle(object4, Cache::Interest::WantHandle);
+  // object4 is still in the window, object3 was admitted out of it.
+  handle3.reset();
+  handle4.reset();
+  EXPECT_FALSE(cache->contains(hash3));
+  EXPECT_FALSE(cache->contains(hash4));
+  EXPECT_EQ(0, cache->getStats().totalSizeInBytes);
+  EXPECT_EQ(2, cache->getStats().dropCount);
+}
@@ -210,6 +210,60 @@ TEST_F(ObjectStoreTest, getBlobSha1NotFound) {
       "blob .* not found");
 }
 
+TEST_F(ObjectStoreTest, getBlobSha1sPreservesOrder) {
+  auto cachedId = putReadyBlob("cached");
+  auto importedId = putReadyBlob("imported");
+  Hash missingId;
+  objectStore->getBlobSha1(cachedId, context).get(0ms);
+
+  auto sha1s =
+      objectStore->getBlobSha1s({importedId, missingId, cachedId}, context)
+          .get(0ms);
+  ASSERT_EQ(3, sha1s.size());
+  EXPECT_EQ(Hash::sha1("imported"_sp), sha1s[0].value());
+  EXPECT_THROW_RE(sha1s[1].value(), std::domain_error, "blob .* not found");
+  EXPECT_EQ(Hash::sha1("cached"_sp), sha1s[2].value());
+  EXPECT_EQ(1, backingStore->getAccessCount(cachedId));
+}
+
+TEST_F(ObjectStoreTest, getBlobSha1sFromLocalStore) {
+  auto id1 = putReadyBlob("1");
+  auto id2 = putReadyBlob("2");
+  // Import both blobs into the local store, then start from an empty
+  // in-memory cache and a backing store that has neither blob.
+  objectStore->getBlobSha1s({id1, id2}, context).get(0ms);
+  objectStore = ObjectStore::create(
+      localStore,
+      std::make_shared<FakeBackingStore>(),
+      treeCache,
+      stats,
+      executor,
+      std::make_shared<ProcessNameCache>(),
+      std::make_shared<NullStructuredLogger>(),
+      EdenConfig::createTestEdenConfig());
+
+  auto sha1s = objectStore->getBlobSha1s({id2, id1}, context).get(0ms);
+  ASSERT_EQ(2, sha1s.size());
+  EXPECT_EQ(Hash::sha1("2"_sp), sha1s[0].value());
+  EXPECT_EQ(Hash::sha1("1"_sp), sha1s[1].value());
+}
+
+TEST_F(ObjectStoreTest, getBlobSizesPreservesOrder) {
+  auto cachedId = putReadyBlob("cached");
+  auto importedId = putReadyBlob("imported blob");
+  Hash missingId;
+  objectStore->getBlobSize(cachedId, context).get(0ms);
+
+  auto sizes =
+      objectStore->getBlobSizes({importedId, missingId, cachedId}, context)
+          .get(0ms);
+  ASSERT_EQ(3, sizes.size());
+  EXPECT_EQ(13, sizes[0].value());
+  EXPECT_THROW_RE(sizes[1].value(), std::domain_error, "blob .* not found");
+  EXPECT_EQ(6, sizes[2].value());
+  EXPECT_EQ(1, backingStore->getAccessCount(importedId));
+}
+
 TEST_F(ObjectStoreTest, get_size_and_sha1_only_imports_blob_once) {
   objectStore->getBlobSize(readyBlobId, context).get(0ms);
   objectStore->getBlobSha1(readyBlobId, context).get(0ms);
@@ -217,6 +271,114 @@ TEST_F(ObjectStoreTest, get_size_and_sha1_only_imports_blob_once) {
   EXPECT_EQ(1, backingStore->getAccessCount(readyBlobId));
 }
 
+TEST_F(ObjectStoreTest, concurrent_getBlob_requests_share_one_fetch) {
+  StoredBlob* storedBlob = backingStore->putBlob("pending"_sp);
+  auto id = storedBlob->get().getHash();
+  LoggingFetchContext context2;
+
+  auto future1 = objectStore->getBlob(id, context);
+  auto future2 = objectStore->getBlob(id, context2);
+  EXPECT_FALSE(future1.isReady());
+  EXPECT_FALSE(future2.isReady());
+
+  storedBlob->trigger();
+  EXPECT_EQ(id, std::move(future1).get(0ms)->getHash());
+  EXPECT_EQ(id, std::move(future2).get(0ms)->getHash());
+  EXPECT_EQ(1, backingStore->getAccessCount(id));
+
+  // Each request records the fetch in its own context.
+  ASSERT_EQ(1, context2.requests.size());
+  EXPECT_EQ(ObjectFetchContext::FromBackingStore, context2.requests[0].origin);
+}
+
+TEST_F(ObjectStoreTest, concurrent_getBlobSha1_requests_share_one_fetch) {
+  StoredBlob* storedBlob = backingStore->putBlob("pending"_sp);
+  auto id = storedBlob->get().getHash();
+
+  auto future1 = objectStore->getBlobSha1(id, context);
+  auto future2 = objectStore->getBlobSize(id, context);
+  storedBlob->trigger();
+  EXPECT_EQ(Hash::sha1("pending"_sp), std::move(future1).get(0ms));
+  EXPECT_EQ(7, std::move(future2).get(0ms));
+  EXPECT_EQ(1, backingStore->getAccessCount(id));
+}
+
+namespace {
+class PriorityFetchContext : public ObjectFetchContext {
+ public:
+  explicit PriorityFetchContext(ImportPriority priority)
+      : priority_{priority} {}
+
+  ImportPriority getPriority() const override {
+    return priority_;
+  }
+
+ private:
+  ImportPriority priority_;
+};
+} // namespace
+
+TEST_F(ObjectStoreTest, higher_priority_request_does_not_wait_for_lower) {
+  StoredBlob* storedBlob = backingStore->putBlob("pending"_sp);
+  auto id = storedBlob->get().getHash();
+  PriorityFetchContext low{ImportPriority::kLow()};
+  PriorityFetchContext high{ImportPriority::kHigh()};
+
+  auto lowFuture = objectStore->getBlob(id, low);
+  auto highFuture = objectStore->getBlob(id, high);
+  // A second high priority request waits for the first one's fetch.
+  auto coalescedFuture = objectStore->getBlob(id, high);
+  EXPECT_EQ(2, backingStore->getAccessCount(id));
+
+  storedBlob->trigger();
+  EXPECT_EQ(id, std::move(lowFuture).get(0ms)->getHash());
+  EXPECT_EQ(id, std::move(highFuture).get(0ms)->getHash());
+  EXPECT_EQ(id, std::move(coalescedFuture).get(0ms)->getHash());
+}
+
+TEST_F(ObjectStoreTest, failed_fetch_is_reported_to_every_request) {
+  StoredTree* storedTree = backingStore->putTree({});
+  auto id = storedTree->get().getHash();
+
+  auto future1 = objectStore->getTree(id, context);
+  auto future2 = objectStore->getTree(id, context);
+  storedTree->triggerError(std::domain_error("tree not found"));
+  EXPECT_THROW(std::move(future1).get(0ms), std::domain_error);
+  EXPECT_THROW(std::move(future2).get(0ms), std::domain_error);
+
+  // The failed fetch is no longer in progress, so it can be retried.
+  storedTree->setReady();
+  EXPECT_EQ(id, objectStore->getTree(id, context).get(0ms)->getHash());
+}
+
+TEST_F(ObjectStoreTest, getBlobRange_slices_whole_blob_by_default) {
+  auto id = putReadyBlob("0123456789");
+
+  auto range = objectStore->getBlobRange(id, 3, 4, context).get(0ms);
+  EXPECT_EQ("3456", range->moveToFbString());
+  auto pastEnd = objectStore->getBlobRange(id, 20, 4, context).get(0ms);
+  EXPECT_EQ(0, pastEnd->computeChainDataLength());
+  // The whole blob was fetched once, then read from the local store.
+  EXPECT_EQ(1, backingStore->getAccessCount(id));
+}
+
+TEST_F(ObjectStoreTest, getBlobRange_fetches_only_the_range_when_supported) {
+  backingStore->setSupportsBlobRanges(true);
+  auto id = putReadyBlob("0123456789");
+
+  auto range = objectStore->getBlobRange(id, 8, 4, context).get(0ms);
+  EXPECT_EQ("89", range->moveToFbString());
+  objectStore->getBlobRange(id, 0, 2, context).get(0ms);
+  // Ranges aren't cached, so each one is fetched.
+  EXPECT_EQ(2, backingStore->getAccessCount(id));
+
+  // Once the whole blob is in the local store, ranges are read from it.
+  objectStore->getBlob(id, context).get(0ms);
+  range = objectStore->getBlobRange(id, 1, 2, context).get(0ms);
+  EXPECT_EQ("12", range->moveToFbString());
+  EXPECT_EQ(3, backingStore->getAccessCount(id));
+}
+
 class PidFetchContext : public ObjectFetchContext {
  public:
   PidFetchContext(pid_t pid) : ObjectFetchContext{}, pid_{pid} {}
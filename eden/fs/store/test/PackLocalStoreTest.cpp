@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/PackLocalStore.h"
+
+#include <folly/FileUtil.h>
+#include <folly/experimental/TestUtil.h>
+#include <folly/portability/GTest.h>
+
+#include "eden/fs/config/EdenConfig.h"
+#include "eden/fs/store/StoreResult.h"
+#include "eden/fs/testharness/TempFile.h"
+
+using namespace facebook::eden;
+using namespace folly::string_piece_literals;
+
+namespace {
+
+constexpr size_t kValueSize = 100 * 1024;
+
+class PackLocalStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // Blob packs are sealed at 1MB, an eighth of this limit.
+    config_->localStoreBlobSizeLimit.setValue(
+        8 * 1024 * 1024, ConfigSource::CommandLine);
+  }
+
+  AbsolutePath path() const {
+    return AbsolutePath{testDir_.path().string()};
+  }
+
+  std::unique_ptr<PackLocalStore> open() const {
+    return std::make_unique<PackLocalStore>(path(), *config_);
+  }
+
+  static std::string key(int i) {
+    return folly::to<std::string>("key", i);
+  }
+
+  static std::string value(int i) {
+    return std::string(kValueSize, static_cast<char>('a' + i % 26));
+  }
+
+  static void putValues(PackLocalStore& store, int begin, int end) {
+    auto batch = store.beginWrite();
+    for (int i = begin; i < end; ++i) {
+      batch->put(
+          KeySpace::BlobFamily,
+          folly::StringPiece{key(i)},
+          folly::StringPiece{value(i)});
+    }
+    batch->flush();
+  }
+
+  static bool hasValue(const PackLocalStore& store, int i) {
+    auto result = store.get(KeySpace::BlobFamily, folly::StringPiece{key(i)});
+    return result.isValid() && result.asString() == value(i);
+  }
+
+  folly::test::TemporaryDirectory testDir_{makeTempDir()};
+  std::shared_ptr<EdenConfig> config_{EdenConfig::createTestEdenConfig()};
+};
+
+} // namespace
+
+TEST_F(PackLocalStoreTest, valuesAreFoundInSealedPacksAfterReopening) {
+  {
+    auto store = open();
+    putValues(*store, 0, 40);
+    EXPECT_LT(2, store->getPackCount(KeySpace::BlobFamily));
+    for (int i = 0; i < 40; ++i) {
+      EXPECT_TRUE(hasValue(*store, i)) << i;
+    }
+  }
+
+  auto store = open();
+  for (int i = 0; i < 40; ++i) {
+    EXPECT_TRUE(hasValue(*store, i)) << i;
+  }
+  EXPECT_FALSE(store->hasKey(KeySpace::BlobFamily, "missing"_sp));
+}
+
+TEST_F(PackLocalStoreTest, laterPutsOfAKeyWin) {
+  auto store = open();
+  putValues(*store, 0, 20);
+  store->put(KeySpace::BlobFamily, folly::StringPiece{key(3)}, "new"_sp);
+  EXPECT_EQ("new", store->get(KeySpace::BlobFamily, "key3"_sp).asString());
+  putValues(*store, 20, 40);
+  EXPECT_EQ("new", store->get(KeySpace::BlobFamily, "key3"_sp).asString());
+}
+
+TEST_F(PackLocalStoreTest, incompleteRecordIsTruncatedOnOpen) {
+  {
+    auto store = open();
+    putValues(*store, 0, 3);
+  }
+
+  // Cut the last record of the active pack in the middle, as if EdenFS
+  // crashed while appending it.
+  auto packPath = path() + "blob/0000000000000000.pack"_relpath;
+  std::string contents;
+  ASSERT_TRUE(folly::readFile(packPath.c_str(), contents));
+  contents.resize(contents.size() - kValueSize / 2);
+  ASSERT_TRUE(folly::writeFile(contents, packPath.c_str()));
+
+  auto store = open();
+  EXPECT_TRUE(hasValue(*store, 0));
+  EXPECT_TRUE(hasValue(*store, 1));
+  EXPECT_FALSE(store->hasKey(KeySpace::BlobFamily, folly::StringPiece{key(2)}));
+
+  // Appending after the truncation keeps the pack readable.
+  putValues(*store, 2, 4);
+  store = open();
+  EXPECT_TRUE(hasValue(*store, 2));
+  EXPECT_TRUE(hasValue(*store, 3));
+}
+
+TEST_F(PackLocalStoreTest, missingIndexIsRebuilt) {
+  {
+    auto store = open();
+    putValues(*store, 0, 20);
+  }
+  auto indexPath = path() + "blob/0000000000000000.idx"_relpath;
+  ASSERT_TRUE(folly::writeFile("garbage"_sp, indexPath.c_str()));
+
+  auto store = open();
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_TRUE(hasValue(*store, i)) << i;
+  }
+}
+
+TEST_F(PackLocalStoreTest, oldestPacksAreDroppedPastTheLimit) {
+  auto store = open();
+  putValues(*store, 0, 60);
+  EXPECT_LT(4 * 1024 * 1024, store->getApproximateSize(KeySpace::BlobFamily));
+
+  config_->localStoreBlobSizeLimit.setValue(
+      3 * 1024 * 1024, ConfigSource::CommandLine);
+  store->periodicManagementTask(*config_);
+  EXPECT_GE(3 * 1024 * 1024, store->getApproximateSize(KeySpace::BlobFamily));
+  EXPECT_FALSE(hasValue(*store, 0));
+  EXPECT_TRUE(hasValue(*store, 59));
+}
+
+TEST_F(PackLocalStoreTest, persistentKeySpacesAreNeverDropped) {
+  auto store = open();
+  store->put(KeySpace::HgProxyHashFamily, "proxy"_sp, "hash"_sp);
+  config_->localStoreBlobSizeLimit.setValue(0, ConfigSource::CommandLine);
+  store->periodicManagementTask(*config_);
+  EXPECT_TRUE(store->hasKey(KeySpace::HgProxyHashFamily, "proxy"_sp));
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/PathLoader.h"
+
+#include <folly/executors/QueuedImmediateExecutor.h>
+#include <folly/portability/GTest.h>
+
+#include "eden/fs/model/Tree.h"
+#include "eden/fs/store/MemoryLocalStore.h"
+#include "eden/fs/store/ObjectStore.h"
+#include "eden/fs/telemetry/NullStructuredLogger.h"
+#include "eden/fs/testharness/FakeBackingStore.h"
+#include "eden/fs/testharness/LoggingFetchContext.h"
+#include "eden/fs/testharness/StoredObject.h"
+#include "eden/fs/utils/EdenError.h"
+
+using namespace facebook::eden;
+using namespace folly::string_piece_literals;
+using namespace std::chrono_literals;
+
+namespace {
+
+struct PathLoaderTest : ::testing::Test {
+  void SetUp() override {
+    auto edenConfig = std::make_shared<ReloadableConfig>(
+        EdenConfig::createTestEdenConfig(), ConfigReloadBehavior::NoReload);
+    backingStore = std::make_shared<FakeBackingStore>();
+    objectStore = ObjectStore::create(
+        std::make_shared<MemoryLocalStore>(),
+        backingStore,
+        TreeCache::create(edenConfig),
+        std::make_shared<EdenStats>(),
+        &folly::QueuedImmediateExecutor::instance(),
+        std::make_shared<ProcessNameCache>(),
+        std::make_shared<NullStructuredLogger>(),
+        EdenConfig::createTestEdenConfig());
+
+    // root/
+    //   file
+    //   a/
+    //     b/
+    //       file
+    //     c/
+    //       d/
+    //     file
+    auto* file = backingStore->putBlob("contents");
+    file->setReady();
+    d = backingStore->putTree({});
+    b = backingStore->putTree({{"file", file}});
+    c = backingStore->putTree({{"d", d}});
+    a = backingStore->putTree({{"b", b}, {"c", c}, {"file", file}});
+    auto* rootTree = backingStore->putTree({{"a", a}, {"file", file}});
+    for (auto* tree : {d, b, c, a, rootTree}) {
+      tree->setReady();
+    }
+    root = objectStore->getTree(rootTree->get().getHash(), context).get(0ms);
+    context.requests.clear();
+  }
+
+  std::vector<folly::Try<std::shared_ptr<const Tree>>> resolve(
+      std::vector<RelativePath> paths) {
+    return resolveTrees(*objectStore, context, root, paths).get(0ms);
+  }
+
+  static int errorCode(const folly::Try<std::shared_ptr<const Tree>>& result) {
+    auto* error = result.tryGetExceptionObject<EdenError>();
+    return error ? *error->errorCode_ref() : 0;
+  }
+
+  LoggingFetchContext context;
+  std::shared_ptr<FakeBackingStore> backingStore;
+  std::shared_ptr<ObjectStore> objectStore;
+  std::shared_ptr<const Tree> root;
+  StoredTree* a;
+  StoredTree* b;
+  StoredTree* c;
+  StoredTree* d;
+};
+
+} // namespace
+
+TEST_F(PathLoaderTest, resolvesEachPathInOrder) {
+  auto results = resolve({
+      RelativePath{"a/c/d"},
+      RelativePath{""},
+      RelativePath{"a"},
+      RelativePath{"a/b"},
+  });
+  ASSERT_EQ(4, results.size());
+  EXPECT_EQ(d->get().getHash(), results[0].value()->getHash());
+  EXPECT_EQ(root->getHash(), results[1].value()->getHash());
+  EXPECT_EQ(a->get().getHash(), results[2].value()->getHash());
+  EXPECT_EQ(b->get().getHash(), results[3].value()->getHash());
+}
+
+TEST_F(PathLoaderTest, fetchesEachTreeOnce) {
+  resolve({
+      RelativePath{"a/b"},
+      RelativePath{"a/c"},
+      RelativePath{"a/c/d"},
+      RelativePath{"a/c/d"},
+  });
+  EXPECT_EQ(4, context.requests.size());
+  for (auto* tree : {a, b, c, d}) {
+    EXPECT_EQ(1, backingStore->getAccessCount(tree->get().getHash()));
+  }
+}
+
+TEST_F(PathLoaderTest, failuresOnlyAffectTheirPaths) {
+  auto results = resolve({
+      RelativePath{"a/missing/x"},
+      RelativePath{"file"},
+      RelativePath{"a/b/file/x"},
+      RelativePath{"a/c"},
+  });
+  ASSERT_EQ(4, results.size());
+  EXPECT_EQ(ENOENT, errorCode(results[0]));
+  EXPECT_EQ(ENOTDIR, errorCode(results[1]));
+  EXPECT_EQ(ENOTDIR, errorCode(results[2]));
+  EXPECT_EQ(c->get().getHash(), results[3].value()->getHash());
+}
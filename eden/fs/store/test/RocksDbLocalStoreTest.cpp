@@ -6,6 +6,8 @@
  */
 
 #include "eden/fs/store/RocksDbLocalStore.h"
+#include "eden/fs/config/EdenConfig.h"
+#include "eden/fs/store/LocalStoreAccessLog.h"
 #include "eden/fs/store/test/LocalStoreTest.h"
 #include "eden/fs/telemetry/NullStructuredLogger.h"
 
@@ -18,7 +20,8 @@ LocalStoreImplResult makeRocksDbLocalStore(FaultInjector* faultInjector) {
   auto store = std::make_unique<RocksDbLocalStore>(
       AbsolutePathPiece{tempDir.path().string()},
       std::make_shared<NullStructuredLogger>(),
-      faultInjector);
+      faultInjector,
+      *EdenConfig::createTestEdenConfig());
   return {std::move(tempDir), std::move(store)};
 }
 
@@ -30,4 +33,174 @@ INSTANTIATE_TEST_CASE_P(
     ::testing::Values(makeRocksDbLocalStore));
 #pragma clang diagnostic pop
 
+class RocksDbLocalStoreGcTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    for (int i = 0; i < 100; ++i) {
+      store_.put(
+          KeySpace::BlobFamily,
+          folly::StringPiece{key(i)},
+          folly::StringPiece{std::string(1000, 'x')});
+    }
+  }
+
+  static std::string key(int i) {
+    return folly::to<std::string>("key", 1000 + i);
+  }
+
+  size_t countKeys() const {
+    size_t count = 0;
+    for (int i = 0; i < 100; ++i) {
+      count += store_.hasKey(KeySpace::BlobFamily, folly::StringPiece{key(i)});
+    }
+    return count;
+  }
+
+  folly::test::TemporaryDirectory tempDir_{makeTempDir()};
+  FaultInjector faultInjector_{/*enabled=*/false};
+  RocksDbLocalStore store_{
+      AbsolutePathPiece{tempDir_.path().string()},
+      std::make_shared<NullStructuredLogger>(),
+      &faultInjector_,
+      *EdenConfig::createTestEdenConfig()};
+};
+
+TEST_F(RocksDbLocalStoreGcTest, recentlyReadKeysAreNotEvicted) {
+  for (int i = 0; i < 10; ++i) {
+    store_.get(KeySpace::BlobFamily, folly::StringPiece{key(i)});
+  }
+
+  auto reclaimed = store_.evictColdKeys(KeySpace::BlobFamily, 1'000'000'000);
+  EXPECT_EQ(90 * (key(0).size() + 1000), reclaimed);
+  EXPECT_EQ(10, countKeys());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_TRUE(
+        store_.hasKey(KeySpace::BlobFamily, folly::StringPiece{key(i)}));
+  }
+}
+
+TEST_F(RocksDbLocalStoreGcTest, evictionResumesWhereItStopped) {
+  auto recordSize = key(0).size() + 1000;
+  EXPECT_EQ(recordSize, store_.evictColdKeys(KeySpace::BlobFamily, 1));
+  EXPECT_FALSE(store_.hasKey(KeySpace::BlobFamily, folly::StringPiece{key(0)}));
+
+  EXPECT_EQ(
+      5 * recordSize,
+      store_.evictColdKeys(KeySpace::BlobFamily, 5 * recordSize));
+  EXPECT_EQ(94, countKeys());
+  EXPECT_FALSE(store_.hasKey(KeySpace::BlobFamily, folly::StringPiece{key(5)}));
+  EXPECT_TRUE(store_.hasKey(KeySpace::BlobFamily, folly::StringPiece{key(6)}));
+}
+
+TEST_F(RocksDbLocalStoreGcTest, persistentKeySpacesAreNotEvicted) {
+  EXPECT_THROW(
+      store_.evictColdKeys(KeySpace::HgProxyHashFamily, 1000),
+      std::invalid_argument);
+}
+
+TEST(RocksDbLocalStore, profilesCanBeOverridden) {
+  auto config = EdenConfig::createTestEdenConfig();
+  config->localStoreRocksDbProfiles.setValue(
+      {"treemeta:blob", "nosuchkeyspace:tree", "blobmeta:nosuchprofile"},
+      ConfigSource::CommandLine);
+  auto tempDir = makeTempDir();
+  FaultInjector faultInjector{/*enabled=*/false};
+  RocksDbLocalStore store{
+      AbsolutePathPiece{tempDir.path().string()},
+      std::make_shared<NullStructuredLogger>(),
+      &faultInjector,
+      *config};
+
+  EXPECT_EQ(RocksDbProfile::Blob, store.getProfile(KeySpace::BlobFamily));
+  EXPECT_EQ(RocksDbProfile::Tree, store.getProfile(KeySpace::TreeFamily));
+  EXPECT_EQ(
+      RocksDbProfile::PointLookup,
+      store.getProfile(KeySpace::HgProxyHashFamily));
+  EXPECT_EQ(
+      RocksDbProfile::PointLookup,
+      store.getProfile(KeySpace::BlobMetaDataFamily));
+  EXPECT_EQ(
+      RocksDbProfile::Blob, store.getProfile(KeySpace::TreeMetaDataFamily));
+
+  // A point lookup column family doesn't compress its small values.
+  EXPECT_NE(
+      std::string::npos,
+      store.describeOptions(KeySpace::HgProxyHashFamily)
+          .find("compression=kNoCompression"));
+}
+
+TEST(RocksDbLocalStore, largeValuesOutliveTheStore) {
+  using namespace std::chrono_literals;
+
+  auto tempDir = makeTempDir();
+  FaultInjector faultInjector{/*enabled=*/false};
+  auto store = std::make_shared<RocksDbLocalStore>(
+      AbsolutePathPiece{tempDir.path().string()},
+      std::make_shared<NullStructuredLogger>(),
+      &faultInjector,
+      *EdenConfig::createTestEdenConfig());
+
+  Hash hash{"3a8f8eb91101860fd8484154885838bf322964d0"};
+  std::string contents(100 * 1024, 'x');
+  auto inBlob = Blob{hash, folly::IOBuf{folly::IOBuf::COPY_BUFFER, contents}};
+  store->putBlob(hash, &inBlob);
+  // Flush the value to a table file, which is read through the block cache
+  // where the value stays pinned.
+  store->compactKeySpace(KeySpace::BlobFamily);
+
+  auto result = store->get(KeySpace::BlobFamily, hash.getBytes());
+  auto batch =
+      store->getBatch(KeySpace::BlobFamily, {hash.getBytes()}).get(10s);
+  auto outBlob = store->getBlob(hash).get(10s);
+  store->close();
+
+  EXPECT_TRUE(result.piece().endsWith(contents));
+  ASSERT_EQ(1, batch.size());
+  EXPECT_EQ(result.piece(), batch[0].piece());
+  EXPECT_EQ(
+      contents, outBlob->getContents().clone()->moveToFbString().toStdString());
+}
+
+TEST(RocksDbLocalStore, sampledReadsAreLoggedAndKeysCanBeScanned) {
+  using namespace folly::string_piece_literals;
+
+  auto config = EdenConfig::createTestEdenConfig();
+  config->localStoreAccessLogSampleDenominator.setValue(
+      1, ConfigSource::CommandLine);
+  auto tempDir = makeTempDir();
+  AbsolutePathPiece path{tempDir.path().string()};
+  FaultInjector faultInjector{/*enabled=*/false};
+  RocksDbLocalStore store{
+      path, std::make_shared<NullStructuredLogger>(), &faultInjector, *config};
+
+  store.put(KeySpace::BlobMetaDataFamily, "b"_sp, "2"_sp);
+  store.put(KeySpace::BlobMetaDataFamily, "a"_sp, "1"_sp);
+  store.get(KeySpace::BlobMetaDataFamily, "a"_sp);
+  store.get(KeySpace::BlobMetaDataFamily, "missing"_sp);
+
+  std::vector<std::pair<std::string, std::string>> entries;
+  store.forEach(
+      KeySpace::BlobMetaDataFamily,
+      [&](folly::ByteRange key, folly::ByteRange value) {
+        entries.emplace_back(
+            folly::StringPiece{key}.str(), folly::StringPiece{value}.str());
+      });
+  EXPECT_EQ(
+      (std::vector<std::pair<std::string, std::string>>{
+          {"a", "1"}, {"b", "2"}}),
+      entries);
+
+  std::vector<std::pair<std::string, bool>> accesses;
+  LocalStoreAccessLog::read(
+      RocksDbLocalStore::getAccessLogPath(path),
+      [&](const LocalStoreAccessLog::Access& access) {
+        EXPECT_EQ(KeySpace::BlobMetaDataFamily.index, access.keySpace->index);
+        accesses.emplace_back(access.key, access.hit);
+      });
+  EXPECT_EQ(
+      (std::vector<std::pair<std::string, bool>>{
+          {"a", true}, {"missing", false}}),
+      accesses);
+}
+
 } // namespace
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/ScmStatusDiffCallback.h"
+
+#include <folly/Conv.h>
+#include <folly/portability/GTest.h>
+#include <thread>
+#include <vector>
+
+using namespace facebook::eden;
+
+TEST(ScmStatusDiffCallback, extract_status_merges_threads) {
+  ScmStatusDiffCallback callback;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; ++i) {
+    threads.emplace_back([&callback, i] {
+      for (int j = 0; j < 100; ++j) {
+        callback.addedFile(RelativePath{folly::to<std::string>(i, "/", j)});
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  callback.removedFile(RelativePathPiece{"removed"});
+  callback.diffError(
+      RelativePathPiece{"broken"},
+      folly::make_exception_wrapper<std::runtime_error>("oops"));
+
+  auto status = callback.extractStatus();
+  EXPECT_EQ(801, status.entries_ref()->size());
+  EXPECT_EQ(ScmFileStatus::ADDED, status.entries_ref()->at("3/14"));
+  EXPECT_EQ(ScmFileStatus::REMOVED, status.entries_ref()->at("removed"));
+  EXPECT_EQ(1, status.errors_ref()->size());
+  EXPECT_TRUE(callback.extractStatus().entries_ref()->empty());
+}
+
+TEST(ScmStatusDiffCallback, full_batches_are_handed_over) {
+  std::vector<ScmStatus> batches;
+  ScmStatusDiffCallback callback{
+      1, [&batches](ScmStatus&& batch) { batches.push_back(std::move(batch)); }};
+
+  callback.addedFile(RelativePathPiece{"a"});
+  callback.modifiedFile(RelativePathPiece{"b"});
+  ASSERT_EQ(2, batches.size());
+  EXPECT_EQ(ScmFileStatus::ADDED, batches[0].entries_ref()->at("a"));
+  EXPECT_EQ(ScmFileStatus::MODIFIED, batches[1].entries_ref()->at("b"));
+
+  // There is nothing left to hand over.
+  callback.flush();
+  EXPECT_EQ(2, batches.size());
+}
+
+TEST(ScmStatusDiffCallback, flush_hands_over_partial_batches) {
+  std::vector<ScmStatus> batches;
+  ScmStatusDiffCallback callback{
+      100,
+      [&batches](ScmStatus&& batch) { batches.push_back(std::move(batch)); }};
+
+  callback.addedFile(RelativePathPiece{"a"});
+  callback.ignoredFile(RelativePathPiece{"b"});
+  callback.removedFile(RelativePathPiece{"c"});
+  EXPECT_TRUE(batches.empty());
+
+  callback.flush();
+  size_t entries = 0;
+  for (auto& batch : batches) {
+    entries += batch.entries_ref()->size();
+  }
+  EXPECT_EQ(3, entries);
+}
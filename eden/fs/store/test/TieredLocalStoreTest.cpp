@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/TieredLocalStore.h"
+
+#include <folly/portability/GTest.h>
+
+#include "eden/fs/config/EdenConfig.h"
+#include "eden/fs/store/MemoryLocalStore.h"
+#include "eden/fs/store/StoreResult.h"
+
+using namespace facebook::eden;
+using namespace folly::string_piece_literals;
+
+namespace {
+
+std::string key(int i) {
+  return folly::to<std::string>("key", i);
+}
+
+class TieredLocalStoreTest : public ::testing::Test {
+ protected:
+  TieredLocalStoreTest() {
+    config_->localStoreL1CacheSize.setValue(
+        1024 * 1024, ConfigSource::CommandLine);
+  }
+
+  std::shared_ptr<EdenConfig> config_{EdenConfig::createTestEdenConfig()};
+  std::shared_ptr<MemoryLocalStore> disk_{
+      std::make_shared<MemoryLocalStore>()};
+};
+
+} // namespace
+
+TEST_F(TieredLocalStoreTest, putsAreWrittenThrough) {
+  TieredLocalStore store{disk_, *config_};
+  store.put(KeySpace::BlobMetaDataFamily, "key"_sp, "meta"_sp);
+  auto batch = store.beginWrite();
+  batch->put(KeySpace::BlobMetaDataFamily, "key2"_sp, "meta2"_sp);
+  batch->flush();
+
+  EXPECT_TRUE(disk_->hasKey(KeySpace::BlobMetaDataFamily, "key"_sp));
+  EXPECT_TRUE(disk_->hasKey(KeySpace::BlobMetaDataFamily, "key2"_sp));
+  EXPECT_LT(0, store.getCachedSize(KeySpace::BlobMetaDataFamily));
+
+  // Served from memory once the underlying store lost them.
+  disk_->clearKeySpace(KeySpace::BlobMetaDataFamily);
+  EXPECT_EQ(
+      "meta", store.get(KeySpace::BlobMetaDataFamily, "key"_sp).piece());
+  EXPECT_TRUE(store.hasKey(KeySpace::BlobMetaDataFamily, "key2"_sp));
+}
+
+TEST_F(TieredLocalStoreTest, uncachedKeySpacesAreNotKeptInMemory) {
+  TieredLocalStore store{disk_, *config_};
+  store.put(KeySpace::BlobFamily, "key"_sp, "blob"_sp);
+  EXPECT_EQ(0, store.getCachedSize(KeySpace::BlobFamily));
+  EXPECT_EQ("blob", store.get(KeySpace::BlobFamily, "key"_sp).piece());
+  EXPECT_EQ(0, store.getCachedSize(KeySpace::BlobFamily));
+}
+
+TEST_F(TieredLocalStoreTest, batchesAreServedPartlyFromMemory) {
+  for (int i = 0; i < 10; ++i) {
+    disk_->put(
+        KeySpace::HgProxyHashFamily,
+        folly::StringPiece{key(i)},
+        folly::StringPiece{key(i)});
+  }
+  TieredLocalStore store{disk_, *config_};
+  for (int i = 0; i < 10; i += 2) {
+    EXPECT_TRUE(
+        store.get(KeySpace::HgProxyHashFamily, folly::StringPiece{key(i)})
+            .isValid());
+  }
+  disk_->clearKeySpace(KeySpace::HgProxyHashFamily);
+
+  std::vector<std::string> keys;
+  std::vector<folly::ByteRange> keyRanges;
+  for (int i = 0; i < 10; ++i) {
+    keys.push_back(key(i));
+  }
+  for (auto& k : keys) {
+    keyRanges.push_back(folly::StringPiece{k});
+  }
+  auto results = store.getBatch(KeySpace::HgProxyHashFamily, keyRanges).get();
+  ASSERT_EQ(10, results.size());
+  for (int i = 0; i < 10; ++i) {
+    if (i % 2 == 0) {
+      EXPECT_EQ(keys[i], results[i].piece()) << i;
+    } else {
+      EXPECT_FALSE(results[i].isValid()) << i;
+    }
+  }
+}
+
+TEST_F(TieredLocalStoreTest, cacheIsBoundedPerKeySpace) {
+  config_->localStoreL1CacheSize.setValue(
+      64 * 1024, ConfigSource::CommandLine);
+  TieredLocalStore store{disk_, *config_};
+  for (int i = 0; i < 1000; ++i) {
+    store.put(
+        KeySpace::TreeMetaDataFamily,
+        folly::StringPiece{key(i)},
+        folly::StringPiece{std::string(1024, 'x')});
+  }
+  EXPECT_GE(64 * 1024, store.getCachedSize(KeySpace::TreeMetaDataFamily));
+  // Evicted values are still in the underlying store.
+  EXPECT_TRUE(store.hasKey(KeySpace::TreeMetaDataFamily, "key0"_sp));
+}
+
+TEST_F(TieredLocalStoreTest, disablingAKeySpaceDropsItsValues) {
+  TieredLocalStore store{disk_, *config_};
+  store.put(KeySpace::TreeMetaDataFamily, "key"_sp, "meta"_sp);
+  EXPECT_LT(0, store.getCachedSize(KeySpace::TreeMetaDataFamily));
+
+  config_->localStoreL1CacheKeySpaces.setValue(
+      std::vector<std::string>{"blobmeta"}, ConfigSource::CommandLine);
+  store.periodicManagementTask(*config_);
+  EXPECT_EQ(0, store.getCachedSize(KeySpace::TreeMetaDataFamily));
+  EXPECT_TRUE(store.hasKey(KeySpace::TreeMetaDataFamily, "key"_sp));
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/store/WriteBackLocalStore.h"
+
+#include <folly/portability/GTest.h>
+#include <folly/test/TestUtils.h>
+#include <thread>
+
+#include "eden/fs/store/MemoryLocalStore.h"
+#include "eden/fs/store/StoreResult.h"
+
+using namespace facebook::eden;
+using namespace folly::string_piece_literals;
+
+namespace {
+
+std::string getString(const LocalStore& store, folly::StringPiece key) {
+  auto result = store.get(KeySpace::BlobFamily, key);
+  return result.isValid() ? result.piece().str() : "";
+}
+
+class FailingLocalStore : public MemoryLocalStore {
+ public:
+  std::unique_ptr<LocalStore::WriteBatch> beginWrite(size_t) override {
+    throw std::runtime_error("disk full");
+  }
+};
+
+} // namespace
+
+TEST(WriteBackLocalStore, flushWritesToTheUnderlyingStore) {
+  auto memory = std::make_shared<MemoryLocalStore>();
+  WriteBackLocalStore store{memory, /*maxPendingBytes=*/1024 * 1024};
+
+  store.put(KeySpace::BlobFamily, "key1"_sp, "value1"_sp);
+  auto batch = store.beginWrite();
+  batch->put(KeySpace::BlobFamily, "key2"_sp, "value2"_sp);
+  batch->put(
+      KeySpace::BlobFamily,
+      "key3"_sp,
+      std::vector<folly::ByteRange>{"val"_sp, "ue3"_sp});
+  batch->flush();
+
+  // Reads see the puts whether or not they are written yet.
+  EXPECT_EQ("value1", getString(store, "key1"_sp));
+  EXPECT_TRUE(store.hasKey(KeySpace::BlobFamily, "key2"_sp));
+
+  store.flush();
+  EXPECT_EQ(0, store.getPendingBytes());
+  EXPECT_EQ("value1", getString(*memory, "key1"_sp));
+  EXPECT_EQ("value2", getString(*memory, "key2"_sp));
+  EXPECT_EQ("value3", getString(*memory, "key3"_sp));
+}
+
+TEST(WriteBackLocalStore, lastPutOfAKeyWins) {
+  auto memory = std::make_shared<MemoryLocalStore>();
+  WriteBackLocalStore store{memory, /*maxPendingBytes=*/1024 * 1024};
+
+  for (int i = 0; i < 100; ++i) {
+    store.put(
+        KeySpace::BlobFamily,
+        "key"_sp,
+        folly::StringPiece{folly::to<std::string>("value", i)});
+  }
+  EXPECT_EQ("value99", getString(store, "key"_sp));
+  store.flush();
+  EXPECT_EQ("value99", getString(*memory, "key"_sp));
+}
+
+TEST(WriteBackLocalStore, putsBlockPastTheLimit) {
+  auto memory = std::make_shared<MemoryLocalStore>();
+  WriteBackLocalStore store{memory, /*maxPendingBytes=*/64};
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&store, t] {
+      for (int i = 0; i < 500; ++i) {
+        auto key = folly::to<std::string>("key", t, "-", i);
+        store.put(
+            KeySpace::BlobFamily,
+            folly::StringPiece{key},
+            folly::StringPiece{key});
+        // A put is only added below the limit, so the pending bytes exceed
+        // it by at most one entry of the longest key and value.
+        EXPECT_LE(store.getPendingBytes(), 64 + 2 * "key3-499"_sp.size());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  store.close();
+  EXPECT_EQ("key3-499", getString(*memory, "key3-499"_sp));
+}
+
+TEST(WriteBackLocalStore, closeWritesThePendingValues) {
+  auto memory = std::make_shared<MemoryLocalStore>();
+  {
+    WriteBackLocalStore store{memory, /*maxPendingBytes=*/1024 * 1024};
+    for (int i = 0; i < 1000; ++i) {
+      auto key = folly::to<std::string>("key", i);
+      auto piece = folly::StringPiece{key};
+      store.put(KeySpace::BlobFamily, piece, piece);
+    }
+    store.close();
+  }
+  EXPECT_EQ("key999", getString(*memory, "key999"_sp));
+}
+
+TEST(WriteBackLocalStore, flushReportsWriteErrors) {
+  auto failing = std::make_shared<FailingLocalStore>();
+  WriteBackLocalStore store{failing, /*maxPendingBytes=*/1024 * 1024};
+
+  store.put(KeySpace::BlobFamily, "key"_sp, "value"_sp);
+  EXPECT_THROW_RE(store.flush(), std::runtime_error, "disk full");
+  EXPECT_EQ(0, store.getPendingBytes());
+
+  // The error is only reported once.
+  store.flush();
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#ifndef _WIN32
+
+#include "eden/fs/takeover/InodeMapSnapshot.h"
+
+#include <fcntl.h>
+#include <folly/Conv.h>
+#include <folly/Exception.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include <stdexcept>
+
+namespace facebook {
+namespace eden {
+
+namespace {
+
+constexpr char kMagic[4] = {'E', 'D', 'I', 'M'};
+constexpr uint32_t kVersion = 1;
+
+struct Header {
+  char magic[4];
+  uint32_t version;
+  uint64_t entryCount;
+  // Where the names and hashes start, right after the entries.
+  uint64_t stringsOffset;
+  uint64_t stringsLength;
+};
+
+struct FlatEntry {
+  uint64_t inodeNumber;
+  uint64_t parentInode;
+  int64_t numFsReferences;
+  // Relative to the start of the strings.
+  uint64_t nameOffset;
+  uint64_t hashOffset;
+  uint32_t nameLength;
+  uint32_t hashLength;
+  int32_t mode;
+  uint8_t isUnlinked;
+  uint8_t padding[3];
+};
+
+static_assert(sizeof(Header) == 32, "the snapshot layout must not change");
+static_assert(sizeof(FlatEntry) == 56, "the snapshot layout must not change");
+
+} // namespace
+
+bool InodeMapSnapshot::isSupported() {
+#ifdef __linux__
+  return true;
+#else
+  return false;
+#endif
+}
+
+folly::File InodeMapSnapshot::write(const SerializedInodeMap& inodeMap) {
+#ifdef __linux__
+  const auto& entries = *inodeMap.unloadedInodes_ref();
+
+  Header header{};
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.entryCount = entries.size();
+  header.stringsOffset = sizeof(Header) + entries.size() * sizeof(FlatEntry);
+  for (const auto& entry : entries) {
+    header.stringsLength += entry.name_ref()->size() + entry.hash_ref()->size();
+  }
+  size_t length = header.stringsOffset + header.stringsLength;
+
+  folly::File file{
+      memfd_create("edenfs_inode_map", MFD_CLOEXEC | MFD_ALLOW_SEALING),
+      /*ownsFd=*/true};
+  folly::checkUnixError(file.fd(), "failed to create an inode map snapshot");
+  folly::checkUnixError(
+      ftruncate(file.fd(), length),
+      "failed to size the inode map snapshot to ",
+      length,
+      " bytes");
+
+  auto* data = static_cast<char*>(
+      mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, file.fd(), 0));
+  if (data == MAP_FAILED) {
+    folly::throwSystemError("failed to map the inode map snapshot");
+  }
+  memcpy(data, &header, sizeof(header));
+  auto* strings = data + header.stringsOffset;
+  uint64_t stringOffset = 0;
+  auto appendString = [&](const std::string& str) {
+    memcpy(strings + stringOffset, str.data(), str.size());
+    auto offset = stringOffset;
+    stringOffset += str.size();
+    return offset;
+  };
+  for (size_t n = 0; n < entries.size(); ++n) {
+    const auto& entry = entries[n];
+    FlatEntry flat{};
+    flat.inodeNumber = *entry.inodeNumber_ref();
+    flat.parentInode = *entry.parentInode_ref();
+    flat.numFsReferences = *entry.numFsReferences_ref();
+    flat.nameLength = entry.name_ref()->size();
+    flat.nameOffset = appendString(*entry.name_ref());
+    flat.hashLength = entry.hash_ref()->size();
+    flat.hashOffset = appendString(*entry.hash_ref());
+    flat.mode = *entry.mode_ref();
+    flat.isUnlinked = *entry.isUnlinked_ref();
+    memcpy(
+        data + sizeof(Header) + n * sizeof(FlatEntry), &flat, sizeof(flat));
+  }
+  munmap(data, length);
+
+  // Sealing guarantees the new process that the file won't shrink under its
+  // mapping, nor change once it has validated it.
+  folly::checkUnixError(
+      fcntl(
+          file.fd(),
+          F_ADD_SEALS,
+          F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL),
+      "failed to seal the inode map snapshot");
+  return file;
+#else
+  (void)inodeMap;
+  throw std::runtime_error(
+      "inode map snapshots are not supported on this platform");
+#endif
+}
+
+InodeMapSnapshot::InodeMapSnapshot(folly::File file) : file_{std::move(file)} {
+#ifdef __linux__
+  auto seals = fcntl(file_.fd(), F_GET_SEALS);
+  folly::checkUnixError(seals, "failed to get the inode map snapshot seals");
+  if (!(seals & F_SEAL_SHRINK) || !(seals & F_SEAL_WRITE)) {
+    throw std::runtime_error("the inode map snapshot is not sealed");
+  }
+#endif
+
+  struct stat st;
+  folly::checkUnixError(
+      fstat(file_.fd(), &st), "failed to stat the inode map snapshot");
+  length_ = st.st_size;
+  if (length_ < sizeof(Header)) {
+    throw std::runtime_error(folly::to<std::string>(
+        "inode map snapshot of ", length_, " bytes is truncated"));
+  }
+
+  auto* data = mmap(nullptr, length_, PROT_READ, MAP_SHARED, file_.fd(), 0);
+  if (data == MAP_FAILED) {
+    folly::throwSystemError("failed to map the inode map snapshot");
+  }
+  data_ = static_cast<const char*>(data);
+
+  Header header;
+  memcpy(&header, data_, sizeof(header));
+  if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kVersion) {
+    munmap(data, length_);
+    throw std::runtime_error(folly::to<std::string>(
+        "unsupported inode map snapshot version ", header.version));
+  }
+  auto maxEntries = (length_ - sizeof(Header)) / sizeof(FlatEntry);
+  if (header.entryCount > maxEntries ||
+      header.stringsOffset !=
+          sizeof(Header) + header.entryCount * sizeof(FlatEntry) ||
+      header.stringsLength > length_ - header.stringsOffset) {
+    munmap(data, length_);
+    throw std::runtime_error("corrupt inode map snapshot header");
+  }
+  entryCount_ = header.entryCount;
+}
+
+InodeMapSnapshot::~InodeMapSnapshot() {
+  munmap(const_cast<char*>(data_), length_);
+}
+
+folly::StringPiece InodeMapSnapshot::getString(
+    uint64_t offset,
+    uint32_t length) const {
+  Header header;
+  memcpy(&header, data_, sizeof(header));
+  if (offset > header.stringsLength || length > header.stringsLength - offset) {
+    throw std::out_of_range("inode map snapshot string out of bounds");
+  }
+  return folly::StringPiece{data_ + header.stringsOffset + offset, length};
+}
+
+InodeMapSnapshot::Entry InodeMapSnapshot::operator[](size_t index) const {
+  if (index >= entryCount_) {
+    throw std::out_of_range(folly::to<std::string>(
+        "inode map snapshot entry ", index, " of ", entryCount_));
+  }
+  FlatEntry flat;
+  memcpy(
+      &flat, data_ + sizeof(Header) + index * sizeof(FlatEntry), sizeof(flat));
+  return Entry{
+      flat.inodeNumber,
+      flat.parentInode,
+      getString(flat.nameOffset, flat.nameLength),
+      flat.isUnlinked != 0,
+      flat.numFsReferences,
+      getString(flat.hashOffset, flat.hashLength),
+      flat.mode};
+}
+
+} // namespace eden
+} // namespace facebook
+
+#endif
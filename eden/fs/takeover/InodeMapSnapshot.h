@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/File.h>
+#include <folly/Range.h>
+#include <cstddef>
+#include <cstdint>
+#include "eden/fs/takeover/gen-cpp2/takeover_types.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * The inode map of a mount, written by the old process into an anonymous
+ * memory file handed over with the FUSE device, and mapped by the new one.
+ *
+ * The layout is flat: a header, an array of fixed-size entries, then the
+ * names and hashes they reference. Both processes run on the same machine,
+ * so it uses the native byte order, but the header carries a magic and a
+ * version so that a process never reads a layout it doesn't know.
+ *
+ * Nothing is decoded up front: the entries are read from the mapping, whose
+ * pages are faulted in as they are accessed.
+ */
+class InodeMapSnapshot {
+ public:
+  struct Entry {
+    uint64_t inodeNumber;
+    uint64_t parentInode;
+    folly::StringPiece name;
+    bool isUnlinked;
+    int64_t numFsReferences;
+    folly::StringPiece hash;
+    int32_t mode;
+  };
+
+  /**
+   * Whether snapshots can be written on this platform: they need memfds.
+   */
+  static bool isSupported();
+
+  /**
+   * Write the inode map into a new sealed memory file.
+   */
+  static folly::File write(const SerializedInodeMap& inodeMap);
+
+  /**
+   * Map a file written by write(). Throws if its header is invalid.
+   */
+  explicit InodeMapSnapshot(folly::File file);
+  ~InodeMapSnapshot();
+
+  InodeMapSnapshot(const InodeMapSnapshot&) = delete;
+  InodeMapSnapshot& operator=(const InodeMapSnapshot&) = delete;
+
+  size_t size() const {
+    return entryCount_;
+  }
+
+  /**
+   * Read an entry. Throws if it references data outside of the file.
+   */
+  Entry operator[](size_t index) const;
+
+ private:
+  folly::StringPiece getString(uint64_t offset, uint32_t length) const;
+
+  folly::File file_;
+  const char* data_{nullptr};
+  size_t length_{0};
+  size_t entryCount_{0};
+};
+
+} // namespace eden
+} // namespace facebook
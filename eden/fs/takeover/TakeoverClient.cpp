@@ -9,6 +9,8 @@
 
 #include "eden/fs/takeover/TakeoverClient.h"
 
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/futures/Future.h>
 #include <folly/io/Cursor.h>
 #include <folly/io/async/EventBase.h>
 #include <folly/logging/xlog.h>
@@ -17,6 +19,9 @@
 #include "eden/fs/takeover/gen-cpp2/takeover_types.h"
 #include "eden/fs/utils/FutureUnixSocket.h"
 
+#include <algorithm>
+#include <vector>
+
 using apache::thrift::CompactSerializer;
 using std::string;
 
@@ -29,9 +34,49 @@ DEFINE_int32(
     300,
     "Timeout for receiving takeover data from old process in seconds");
 
+DEFINE_int32(
+    takeoverDeserializeThreads,
+    8,
+    "Number of threads deserializing the inode map chunks received during "
+    "takeover");
+
 namespace facebook {
 namespace eden {
 
+namespace {
+
+/**
+ * Receive the inode map chunks following the mounts, deserializing them in
+ * parallel while the next ones are being received.
+ */
+void receiveInodeMapChunks(
+    folly::EventBase& evb,
+    FutureUnixSocket& socket,
+    TakeoverData& data) {
+  folly::CPUThreadPoolExecutor deserializer(
+      std::max(FLAGS_takeoverDeserializeThreads, 1));
+  std::vector<folly::Future<SerializedInodeMapChunk>> chunks;
+  chunks.reserve(data.pendingInodeMapChunks);
+
+  auto timeout = std::chrono::seconds(FLAGS_takeoverReceiveTimeout);
+  for (uint64_t n = 0; n < data.pendingInodeMapChunks; ++n) {
+    auto msg = socket.receive(timeout).getVia(&evb);
+    chunks.push_back(
+        folly::via(&deserializer, [buf = std::move(msg.data)]() mutable {
+          return TakeoverData::deserializeInodeMapChunk(&buf);
+        }));
+  }
+
+  // The chunks are added in the order they were sent, so that every inode map
+  // ends up in its original order.
+  for (auto& chunk : folly::collectAll(std::move(chunks)).get()) {
+    data.addInodeMapChunk(std::move(chunk).value());
+  }
+  data.pendingInodeMapChunks = 0;
+}
+
+} // namespace
+
 TakeoverData takeoverMounts(
     AbsolutePathPiece socketPath,
     bool shouldPing,
@@ -99,11 +144,14 @@ TakeoverData takeoverMounts(
   auto& message = expectedMessage.value();
 
   auto data = TakeoverData::deserialize(&message.data);
-  // Add 2 here for the lock file and the thrift socket
-  if (data.mountPoints.size() + 2 != message.files.size()) {
+  // Add 2 here for the lock file and the thrift socket, and each mount may
+  // come with its inode map file after the FUSE devices.
+  auto numMounts = data.mountPoints.size();
+  auto fdsPerMount = data.inodeMapsInFiles ? 2 : 1;
+  if (numMounts * fdsPerMount + 2 != message.files.size()) {
     throw std::runtime_error(folly::to<string>(
         "received ",
-        data.mountPoints.size(),
+        numMounts,
         " mount paths, but ",
         message.files.size(),
         " FDs (including the lock file FD)"));
@@ -113,6 +161,16 @@ TakeoverData takeoverMounts(
   for (size_t n = 0; n < data.mountPoints.size(); ++n) {
     auto& mountInfo = data.mountPoints[n];
     mountInfo.fuseFD = std::move(message.files[n + 2]);
+    if (data.inodeMapsInFiles) {
+      mountInfo.inodeMapSnapshot = std::make_unique<InodeMapSnapshot>(
+          std::move(message.files[numMounts + n + 2]));
+    }
+  }
+
+  if (data.pendingInodeMapChunks > 0) {
+    XLOG(INFO) << "receiving " << data.pendingInodeMapChunks
+               << " inode map chunks";
+    receiveInodeMapChunks(evb, socket, data);
   }
 
   return data;
@@ -26,7 +26,12 @@ namespace eden {
 const std::set<int32_t> kSupportedTakeoverVersions{
     TakeoverData::kTakeoverProtocolVersionOne,
     TakeoverData::kTakeoverProtocolVersionThree,
-    TakeoverData::kTakeoverProtocolVersionFour};
+    TakeoverData::kTakeoverProtocolVersionFour,
+    TakeoverData::kTakeoverProtocolVersionFive,
+#ifdef __linux__
+    TakeoverData::kTakeoverProtocolVersionSix,
+#endif
+};
 
 std::optional<int32_t> TakeoverData::computeCompatibleVersion(
     const std::set<int32_t>& versions,
@@ -47,14 +52,22 @@ std::optional<int32_t> TakeoverData::computeCompatibleVersion(
   return best;
 }
 
+size_t TakeoverData::getInodeMapChunkCount(const SerializedInodeMap& inodeMap) {
+  auto entries = inodeMap.unloadedInodes_ref()->size();
+  return (entries + kInodeMapChunkSize - 1) / kInodeMapChunkSize;
+}
+
 IOBuf TakeoverData::serialize(int32_t protocolVersion) {
   switch (protocolVersion) {
     case kTakeoverProtocolVersionOne:
       return serializeVersion1();
     case kTakeoverProtocolVersionThree:
     case kTakeoverProtocolVersionFour:
-      // versions 3 and 4 use the same data serialization
-      return serializeVersion3();
+    case kTakeoverProtocolVersionFive:
+    case kTakeoverProtocolVersionSix:
+      // versions 3 and 4 use the same data serialization, and versions 5 and
+      // 6 only move the inode maps out of it
+      return serializeVersion3(protocolVersion);
     default: {
       EDEN_BUG() << "asked to serialize takeover data in unsupported format "
                  << protocolVersion;
@@ -74,7 +87,9 @@ folly::IOBuf TakeoverData::serializeError(
       return serializeErrorVersion1(ew);
     case kTakeoverProtocolVersionThree:
     case kTakeoverProtocolVersionFour:
-      // versions 3 and 4 use the same data serialization
+    case kTakeoverProtocolVersionFive:
+    case kTakeoverProtocolVersionSix:
+      // versions 3 to 6 use the same error serialization
       return serializeErrorVersion3(ew);
     default: {
       EDEN_BUG() << "asked to serialize takeover error in unsupported format "
@@ -111,11 +126,20 @@ TakeoverData TakeoverData::deserialize(IOBuf* buf) {
       // because it the messageType is needed to decode the response.
       return deserializeVersion1(buf);
     case kTakeoverProtocolVersionThree:
+    case kTakeoverProtocolVersionFive:
       // Version 3 (there was no 2 because of how Version 1 used word values
       // 1 and 2) doesn't care about this version byte, so we skip past it
-      // and let the underlying code decode the data
+      // and let the underlying code decode the data. The mounts of version 5
+      // only differ by counting the inode map chunks that follow them.
       buf->trimStart(sizeof(uint32_t));
       return deserializeVersion3(buf);
+    case kTakeoverProtocolVersionSix: {
+      // Version 6 only differs by sending the inode maps as files.
+      buf->trimStart(sizeof(uint32_t));
+      auto data = deserializeVersion3(buf);
+      data.inodeMapsInFiles = true;
+      return data;
+    }
     default:
       throw std::runtime_error(folly::sformat(
           "Unrecognized TakeoverData response starting with {:x}",
@@ -123,6 +147,53 @@ TakeoverData TakeoverData::deserialize(IOBuf* buf) {
   }
 }
 
+IOBuf TakeoverData::serializeInodeMapChunk(
+    int32_t mountIndex,
+    folly::Range<const SerializedInodeMapEntry*> entries) {
+  SerializedInodeMapChunk chunk;
+  *chunk.mountIndex_ref() = mountIndex;
+  chunk.unloadedInodes_ref()->assign(entries.begin(), entries.end());
+
+  folly::IOBufQueue bufQ;
+  folly::io::QueueAppender app(&bufQ, 0);
+  app.writeBE<uint32_t>(MessageType::INODE_MAP_CHUNK);
+  CompactSerializer::serialize(chunk, &bufQ);
+  return std::move(*bufQ.move());
+}
+
+SerializedInodeMapChunk TakeoverData::deserializeInodeMapChunk(IOBuf* buf) {
+  folly::io::Cursor cursor(buf);
+  auto messageType = cursor.readBE<uint32_t>();
+  if (messageType != MessageType::INODE_MAP_CHUNK) {
+    throw std::runtime_error(folly::sformat(
+        "expected an inode map chunk but got a message starting with {:x}",
+        messageType));
+  }
+  buf->trimStart(sizeof(uint32_t));
+  return CompactSerializer::deserialize<SerializedInodeMapChunk>(buf);
+}
+
+void TakeoverData::addInodeMapChunk(SerializedInodeMapChunk&& chunk) {
+  auto mountIndex = *chunk.mountIndex_ref();
+  if (mountIndex < 0 || static_cast<size_t>(mountIndex) >= mountPoints.size()) {
+    throw std::runtime_error(folly::to<string>(
+        "received an inode map chunk for mount ",
+        mountIndex,
+        " of ",
+        mountPoints.size()));
+  }
+  auto& entries = *mountPoints[mountIndex].inodeMap.unloadedInodes_ref();
+  auto& chunkEntries = *chunk.unloadedInodes_ref();
+  if (entries.empty()) {
+    entries = std::move(chunkEntries);
+  } else {
+    entries.insert(
+        entries.end(),
+        std::make_move_iterator(chunkEntries.begin()),
+        std::make_move_iterator(chunkEntries.end()));
+  }
+}
+
 IOBuf TakeoverData::serializeVersion1() {
   // Compute the body data length
   uint64_t bodyLength = sizeof(uint32_t);
@@ -284,14 +355,22 @@ TakeoverData TakeoverData::deserializeVersion1(IOBuf* buf) {
   return data;
 }
 
-IOBuf TakeoverData::serializeVersion3() {
+IOBuf TakeoverData::serializeVersion3(int32_t protocolVersion) {
   SerializedTakeoverData serialized;
+  bool chunkInodeMaps = hasInodeMapChunks(protocolVersion);
+  bool inodeMapFiles = hasInodeMapFiles(protocolVersion);
 
   folly::IOBufQueue bufQ;
   folly::io::QueueAppender app(&bufQ, 0);
 
   // First word is the protocol version
-  app.writeBE<uint32_t>(kTakeoverProtocolVersionThree);
+  if (chunkInodeMaps) {
+    app.writeBE<uint32_t>(kTakeoverProtocolVersionFive);
+  } else if (inodeMapFiles) {
+    app.writeBE<uint32_t>(kTakeoverProtocolVersionSix);
+  } else {
+    app.writeBE<uint32_t>(kTakeoverProtocolVersionThree);
+  }
 
   std::vector<SerializedMountInfo> serializedMounts;
   for (const auto& mount : mountPoints) {
@@ -314,7 +393,12 @@ IOBuf TakeoverData::serializeVersion3() {
     *serializedMount.connInfo_ref() = std::string{
         reinterpret_cast<const char*>(&mount.connInfo), sizeof(mount.connInfo)};
 
-    *serializedMount.inodeMap_ref() = mount.inodeMap;
+    if (chunkInodeMaps) {
+      *serializedMount.inodeMapChunkCount_ref() =
+          getInodeMapChunkCount(mount.inodeMap);
+    } else if (!inodeMapFiles) {
+      *serializedMount.inodeMap_ref() = mount.inodeMap;
+    }
 
     serializedMounts.emplace_back(std::move(serializedMount));
   }
@@ -361,6 +445,8 @@ TakeoverData TakeoverData::deserializeVersion3(IOBuf* buf) {
           bindMounts.emplace_back(AbsolutePathPiece{path});
         }
 
+        data.pendingInodeMapChunks +=
+            *serializedMount.inodeMapChunkCount_ref();
         data.mountPoints.emplace_back(
             AbsolutePath{*serializedMount.mountPath_ref()},
             AbsolutePath{*serializedMount.stateDirectory_ref()},
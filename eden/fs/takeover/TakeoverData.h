@@ -8,6 +8,7 @@
 #pragma once
 
 #include <folly/File.h>
+#include <folly/Range.h>
 #include <folly/futures/Promise.h>
 #include <memory>
 #include <optional>
@@ -18,6 +19,7 @@
 
 #ifndef _WIN32
 #include "eden/fs/fuse/FuseTypes.h"
+#include "eden/fs/takeover/InodeMapSnapshot.h"
 #endif
 
 namespace folly {
@@ -73,8 +75,28 @@ class TakeoverData {
     // break a server with this extra handshake talking to a client
     // without it
     kTakeoverProtocolVersionFour = 4,
+
+    // This version sends the inode maps of the mounts separately from the
+    // mount list, as a stream of SerializedInodeMapChunk messages following
+    // it, so that neither process holds a second copy of all the inode maps
+    // in one buffer and the new process can deserialize the chunks in
+    // parallel while it receives the rest. It includes the handshake of
+    // version 4.
+    kTakeoverProtocolVersionFive = 5,
+
+    // This version hands the inode map of each mount over as an
+    // InodeMapSnapshot, a memory file sent along with the FUSE devices,
+    // instead of serializing it. The new process reads the entries straight
+    // out of the mapped file. Only supported on Linux, which has memfds.
+    kTakeoverProtocolVersionSix = 6,
   };
 
+  /**
+   * The number of inode map entries in each chunk sent by version 5 of the
+   * protocol.
+   */
+  static constexpr size_t kInodeMapChunkSize = 16 * 1024;
+
   // Given a set of versions provided by a client, find the largest
   // version that is also present in the provided set of supported
   // versions.
@@ -82,6 +104,27 @@ class TakeoverData {
       const std::set<int32_t>& versions,
       const std::set<int32_t>& supported = kSupportedTakeoverVersions);
 
+  /**
+   * Whether the inode maps are sent as chunks following the serialized
+   * TakeoverData with this version of the protocol.
+   */
+  static bool hasInodeMapChunks(int32_t protocolVersion) {
+    return protocolVersion == kTakeoverProtocolVersionFive;
+  }
+
+  /**
+   * Whether the inode maps are sent as files following the FUSE devices with
+   * this version of the protocol.
+   */
+  static bool hasInodeMapFiles(int32_t protocolVersion) {
+    return protocolVersion == kTakeoverProtocolVersionSix;
+  }
+
+  /**
+   * The number of chunks the inode map is sent in.
+   */
+  static size_t getInodeMapChunkCount(const SerializedInodeMap& inodeMap);
+
   struct MountInfo {
     MountInfo(
         AbsolutePathPiece mountPath,
@@ -110,6 +153,13 @@ class TakeoverData {
     fuse_init_out connInfo;
 #endif
     SerializedInodeMap inodeMap;
+#ifndef _WIN32
+    /**
+     * The inode map received by version 6 of the protocol, which leaves
+     * inodeMap empty.
+     */
+    std::unique_ptr<InodeMapSnapshot> inodeMapSnapshot;
+#endif
   };
 
   /**
@@ -117,10 +167,19 @@ class TakeoverData {
    * process.
    *
    * This includes all data except for file descriptors.  The file descriptors
-   * must be sent separately.
+   * must be sent separately, and so must the inode maps when
+   * hasInodeMapChunks(protocolVersion).
    */
   folly::IOBuf serialize(int32_t protocolVersion);
 
+  /**
+   * Serialize some of the entries of the inode map of a mount, at mountIndex
+   * in mountPoints.
+   */
+  static folly::IOBuf serializeInodeMapChunk(
+      int32_t mountIndex,
+      folly::Range<const SerializedInodeMapEntry*> entries);
+
   /**
    * Serialize an exception.
    */
@@ -138,6 +197,18 @@ class TakeoverData {
    */
   static TakeoverData deserialize(folly::IOBuf* buf);
 
+  /**
+   * Deserialize a chunk of an inode map from a buffer.
+   *
+   * This may be called from any thread: it doesn't touch the TakeoverData.
+   */
+  static SerializedInodeMapChunk deserializeInodeMapChunk(folly::IOBuf* buf);
+
+  /**
+   * Add the entries of a chunk to the inode map of its mount.
+   */
+  void addInodeMapChunk(SerializedInodeMapChunk&& chunk);
+
   /**
    * Checks to see if a message is of type PING
    */
@@ -165,6 +236,18 @@ class TakeoverData {
    */
   folly::Promise<std::optional<TakeoverData>> takeoverComplete;
 
+  /**
+   * The number of inode map chunks that follow the deserialized TakeoverData,
+   * which are still to be received and added to the mounts.
+   */
+  uint64_t pendingInodeMapChunks{0};
+
+  /**
+   * Whether the deserialized TakeoverData came with an inode map file for
+   * each mount, following the FUSE devices.
+   */
+  bool inodeMapsInFiles{false};
+
  private:
   /**
    * Serialize data using version 1 of the takeover protocol.
@@ -184,9 +267,10 @@ class TakeoverData {
   static TakeoverData deserializeVersion1(folly::IOBuf* buf);
 
   /**
-   * Serialize data using version 2 of the takeover protocol.
+   * Serialize data using version 2 of the takeover protocol, or its version 5
+   * and 6 variants which leave the inode maps out.
    */
-  folly::IOBuf serializeVersion3();
+  folly::IOBuf serializeVersion3(int32_t protocolVersion);
 
   /**
    * Serialize an exception using version 2 of the takeover protocol.
@@ -210,6 +294,9 @@ class TakeoverData {
     ERROR = 1,
     MOUNTS = 2,
     PING = 3,
+    // Only sent after the mounts of version 5, so it can't be confused with
+    // the protocol versions starting the other messages.
+    INODE_MAP_CHUNK = 4,
   };
 
   /**
@@ -9,7 +9,10 @@
 
 #include "eden/fs/takeover/TakeoverServer.h"
 
+#include <algorithm>
 #include <chrono>
+#include <memory>
+#include <vector>
 
 #include <folly/FileUtil.h>
 #include <folly/Range.h>
@@ -22,6 +25,7 @@
 #include <folly/logging/xlog.h>
 #include <thrift/lib/cpp2/protocol/Serializer.h>
 
+#include "eden/fs/takeover/InodeMapSnapshot.h"
 #include "eden/fs/takeover/TakeoverData.h"
 #include "eden/fs/takeover/TakeoverHandler.h"
 #include "eden/fs/utils/FutureUnixSocket.h"
@@ -69,6 +73,17 @@ class TakeoverServer::ConnHandler {
   FOLLY_NODISCARD folly::Future<folly::Unit> sendTakeoverData(
       TakeoverData&& data);
 
+  /**
+   * Send the inode maps as chunks, one at a time so that only one chunk is
+   * serialized at any time, starting with the entry at offset in the inode
+   * map of the mount at mountIndex. The entries of each inode map are freed
+   * once it is sent.
+   */
+  FOLLY_NODISCARD folly::Future<folly::Unit> sendInodeMapChunks(
+      std::shared_ptr<std::vector<SerializedInodeMap>> inodeMaps,
+      size_t mountIndex,
+      size_t offset);
+
   template <typename... Args>
   [[noreturn]] void fail(Args&&... args) {
     auto msg = folly::to<std::string>(std::forward<Args>(args)...);
@@ -149,7 +164,9 @@ Future<Unit> TakeoverServer::ConnHandler::start() noexcept {
           // Initiate the takeover shutdown.
           protocolVersion_ = supported.value();
           shouldPing_ =
-              (protocolVersion_ == TakeoverData::kTakeoverProtocolVersionFour);
+              (protocolVersion_ == TakeoverData::kTakeoverProtocolVersionFour ||
+               protocolVersion_ == TakeoverData::kTakeoverProtocolVersionFive ||
+               protocolVersion_ == TakeoverData::kTakeoverProtocolVersionSix);
           return server_->getTakeoverHandler()->startTakeoverShutdown();
         })
         .thenTryInline(folly::makeAsyncTask(
@@ -240,6 +257,12 @@ Future<Unit> TakeoverServer::ConnHandler::sendTakeoverData(
     for (auto& mount : data.mountPoints) {
       msg.files.push_back(std::move(mount.fuseFD));
     }
+    if (TakeoverData::hasInodeMapFiles(protocolVersion_)) {
+      for (auto& mount : data.mountPoints) {
+        msg.files.push_back(InodeMapSnapshot::write(mount.inodeMap));
+        mount.inodeMap = SerializedInodeMap{};
+      }
+    }
   } catch (const std::exception& ex) {
     auto ew = folly::exception_wrapper{std::current_exception(), ex};
     data.takeoverComplete.setException(ew);
@@ -249,7 +272,20 @@ Future<Unit> TakeoverServer::ConnHandler::sendTakeoverData(
   XLOG(INFO) << "Sending takeover data to new process: "
              << msg.data.computeChainDataLength() << " bytes";
 
-  return socket_.send(std::move(msg))
+  auto sendFuture = socket_.send(std::move(msg));
+  if (TakeoverData::hasInodeMapChunks(protocolVersion_)) {
+    auto inodeMaps = std::make_shared<std::vector<SerializedInodeMap>>();
+    inodeMaps->reserve(data.mountPoints.size());
+    for (auto& mount : data.mountPoints) {
+      inodeMaps->push_back(std::move(mount.inodeMap));
+    }
+    sendFuture = std::move(sendFuture).thenValue(
+        [this, inodeMaps = std::move(inodeMaps)](auto&&) mutable {
+          return sendInodeMapChunks(std::move(inodeMaps), 0, 0);
+        });
+  }
+
+  return std::move(sendFuture)
       .thenTry([promise = std::move(data.takeoverComplete)](
                    folly::Try<Unit>&& sendResult) mutable {
         if (sendResult.hasException()) {
@@ -261,6 +297,36 @@ Future<Unit> TakeoverServer::ConnHandler::sendTakeoverData(
       });
 }
 
+Future<Unit> TakeoverServer::ConnHandler::sendInodeMapChunks(
+    std::shared_ptr<std::vector<SerializedInodeMap>> inodeMaps,
+    size_t mountIndex,
+    size_t offset) {
+  while (mountIndex < inodeMaps->size() &&
+         offset >= (*inodeMaps)[mountIndex].unloadedInodes_ref()->size()) {
+    (*inodeMaps)[mountIndex] = SerializedInodeMap{};
+    ++mountIndex;
+    offset = 0;
+  }
+  if (mountIndex == inodeMaps->size()) {
+    return makeFuture();
+  }
+
+  const auto& entries = *(*inodeMaps)[mountIndex].unloadedInodes_ref();
+  auto count =
+      std::min(TakeoverData::kInodeMapChunkSize, entries.size() - offset);
+  UnixSocket::Message msg;
+  msg.data = TakeoverData::serializeInodeMapChunk(
+      static_cast<int32_t>(mountIndex),
+      folly::range(&entries[offset], &entries[offset] + count));
+  return socket_.send(std::move(msg))
+      .thenValue([this,
+                  inodeMaps = std::move(inodeMaps),
+                  mountIndex,
+                  next = offset + count](auto&&) mutable {
+        return sendInodeMapChunks(std::move(inodeMaps), mountIndex, next);
+      });
+}
+
 TakeoverServer::TakeoverServer(
     folly::EventBase* eventBase,
     AbsolutePathPiece socketPath,
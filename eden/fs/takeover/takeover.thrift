@@ -48,6 +48,17 @@ struct SerializedMountInfo {
   // 5: SerializedFileHandleMap fileHandleMap,
 
   6: SerializedInodeMap inodeMap;
+
+  // With version 5 of the protocol, the inode map is left empty and its
+  // entries follow the SerializedTakeoverData in this many
+  // SerializedInodeMapChunk messages.
+  7: i64 inodeMapChunkCount;
+}
+
+// A part of the inode map of the mount at mountIndex in the list of mounts.
+struct SerializedInodeMapChunk {
+  1: i32 mountIndex;
+  2: list<SerializedInodeMapEntry> unloadedInodes;
 }
 
 union SerializedTakeoverData {
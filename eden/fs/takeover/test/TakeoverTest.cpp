@@ -12,7 +12,9 @@
 #include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
 #include <folly/test/TestUtils.h>
+#include <sys/mman.h>
 
+#include "eden/fs/takeover/InodeMapSnapshot.h"
 #include "eden/fs/takeover/TakeoverClient.h"
 #include "eden/fs/takeover/TakeoverData.h"
 #include "eden/fs/takeover/TakeoverHandler.h"
@@ -335,6 +337,113 @@ TEST(Takeover, manyMounts) {
   }
 }
 
+namespace {
+SerializedInodeMap makeInodeMap(size_t numEntries, size_t mountIndex) {
+  SerializedInodeMap inodeMap;
+  for (size_t n = 0; n < numEntries; ++n) {
+    SerializedInodeMapEntry entry;
+    *entry.inodeNumber_ref() = n + 2;
+    *entry.parentInode_ref() = mountIndex;
+    *entry.name_ref() = folly::to<string>("file", n);
+    *entry.hash_ref() = n % 2 ? string(20, static_cast<char>(n)) : string{};
+    *entry.mode_ref() = 0100644;
+    *entry.numFsReferences_ref() = n % 3;
+    inodeMap.unloadedInodes_ref()->push_back(std::move(entry));
+  }
+  return inodeMap;
+}
+
+SerializedInodeMap readInodeMap(const InodeMapSnapshot& snapshot) {
+  SerializedInodeMap inodeMap;
+  for (size_t n = 0; n < snapshot.size(); ++n) {
+    auto snapshotEntry = snapshot[n];
+    SerializedInodeMapEntry entry;
+    *entry.inodeNumber_ref() = snapshotEntry.inodeNumber;
+    *entry.parentInode_ref() = snapshotEntry.parentInode;
+    *entry.name_ref() = snapshotEntry.name.str();
+    *entry.isUnlinked_ref() = snapshotEntry.isUnlinked;
+    *entry.numFsReferences_ref() = snapshotEntry.numFsReferences;
+    *entry.hash_ref() = snapshotEntry.hash.str();
+    *entry.mode_ref() = snapshotEntry.mode;
+    inodeMap.unloadedInodes_ref()->push_back(std::move(entry));
+  }
+  return inodeMap;
+}
+
+void testLargeInodeMaps(const std::set<int32_t>& supportedVersions) {
+  TemporaryDirectory tmpDir("eden_takeover_test");
+  AbsolutePathPiece tmpDirPath{tmpDir.path().string()};
+
+  TakeoverData serverData;
+  auto lockFilePath = tmpDirPath + "lock"_pc;
+  serverData.lockFile =
+      folly::File{lockFilePath.stringPiece(), O_RDWR | O_CREAT};
+  auto thriftSocketPath = tmpDirPath + "thrift"_pc;
+  serverData.thriftSocket =
+      folly::File{thriftSocketPath.stringPiece(), O_RDWR | O_CREAT};
+
+  // An empty inode map, one that fits in a chunk, and one that needs several
+  // chunks with a partial last one.
+  const std::vector<size_t> numEntries = {
+      0, 10, 3 * TakeoverData::kInodeMapChunkSize + 7};
+  for (size_t n = 0; n < numEntries.size(); ++n) {
+    auto fusePath =
+        tmpDirPath + PathComponentPiece{folly::to<string>("fuse", n)};
+    serverData.mountPoints.emplace_back(
+        tmpDirPath + PathComponentPiece{folly::to<string>("mount", n)},
+        tmpDirPath + PathComponentPiece{folly::to<string>("client", n)},
+        std::vector<AbsolutePath>{},
+        folly::File{fusePath.stringPiece(), O_RDWR | O_CREAT},
+        fuse_init_out{},
+        makeInodeMap(numEntries[n], n));
+  }
+
+  auto serverSendFuture = serverData.takeoverComplete.getFuture();
+  TestHandler handler{std::move(serverData)};
+  auto result = runTakeover(tmpDir, &handler, supportedVersions);
+  ASSERT_TRUE(serverSendFuture.hasValue());
+  ASSERT_TRUE(result.hasValue());
+  const auto& clientData = result.value();
+  EXPECT_EQ(0, clientData.pendingInodeMapChunks);
+
+  ASSERT_EQ(numEntries.size(), clientData.mountPoints.size());
+  for (size_t n = 0; n < numEntries.size(); ++n) {
+    const auto& mountInfo = clientData.mountPoints[n];
+    checkExpectedFile(
+        mountInfo.fuseFD.fd(),
+        tmpDirPath + PathComponentPiece{folly::to<string>("fuse", n)});
+    auto inodeMap = mountInfo.inodeMapSnapshot
+        ? readInodeMap(*mountInfo.inodeMapSnapshot)
+        : mountInfo.inodeMap;
+    EXPECT_EQ(numEntries[n], inodeMap.unloadedInodes_ref()->size());
+    EXPECT_TRUE(makeInodeMap(numEntries[n], n) == inodeMap);
+  }
+}
+} // namespace
+
+TEST(Takeover, largeInodeMapsInChunks) {
+  testLargeInodeMaps(
+      std::set<int32_t>{TakeoverData::kTakeoverProtocolVersionFive});
+}
+
+#ifdef __linux__
+TEST(Takeover, largeInodeMapsInFiles) {
+  testLargeInodeMaps(
+      std::set<int32_t>{TakeoverData::kTakeoverProtocolVersionSix});
+}
+
+TEST(Takeover, inodeMapSnapshotRejectsUnsealedFiles) {
+  folly::File file{memfd_create("test", MFD_CLOEXEC), /*ownsFd=*/true};
+  EXPECT_THROW_RE(
+      InodeMapSnapshot{std::move(file)}, std::runtime_error, "not sealed");
+}
+#endif
+
+TEST(Takeover, largeInodeMapsInOneMessage) {
+  testLargeInodeMaps(
+      std::set<int32_t>{TakeoverData::kTakeoverProtocolVersionFour});
+}
+
 TEST(Takeover, error) {
   TemporaryDirectory tmpDir("eden_takeover_test");
   ErrorHandler handler;
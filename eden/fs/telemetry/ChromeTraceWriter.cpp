@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/telemetry/ChromeTraceWriter.h"
+
+#include <folly/Exception.h>
+#include <folly/ExceptionString.h>
+#include <folly/FileUtil.h>
+#include <folly/Format.h>
+#include <folly/dynamic.h>
+#include <folly/json.h>
+#include <folly/logging/xlog.h>
+#include <folly/portability/Fcntl.h>
+#include <folly/portability/Unistd.h>
+#include <folly/system/ThreadName.h>
+
+namespace facebook {
+namespace eden {
+
+namespace {
+constexpr folly::StringPiece kCategory{"eden"};
+
+std::string formatId(uint64_t id) {
+  return folly::sformat("{:#x}", id);
+}
+
+double toMicroseconds(std::chrono::nanoseconds timestamp) {
+  return timestamp.count() / 1000.0;
+}
+
+void appendEvent(std::string& out, const folly::dynamic& event) {
+  out += folly::toJson(event);
+  // The viewers accept the trailing comma of the unterminated array.
+  out += ",\n";
+}
+} // namespace
+
+ChromeTraceWriter::ChromeTraceWriter(folly::File file)
+    : file_{std::move(file)} {
+  writeAll("[\n");
+}
+
+void ChromeTraceWriter::write(
+    const std::vector<CompactTracePoint>& points,
+    const folly::F14FastMap<uint32_t, std::string>& threadNames) {
+  const int64_t pid = getpid();
+
+  std::string out;
+  for (const auto& point : points) {
+    if (namedThreads_.insert(point.threadId).second) {
+      auto it = threadNames.find(point.threadId);
+      if (it != threadNames.end()) {
+        appendEvent(
+            out,
+            folly::dynamic::object("name", "thread_name")("ph", "M")(
+                "pid", pid)("tid", int64_t{point.threadId})(
+                "args", folly::dynamic::object("name", it->second)));
+      }
+    }
+
+    const char* name = point.name;
+    if (point.start) {
+      openBlocks_.insert_or_assign(point.blockId, point.name);
+    } else if (point.stop) {
+      auto it = openBlocks_.find(point.blockId);
+      if (it == openBlocks_.end()) {
+        continue;
+      }
+      name = it->second;
+      openBlocks_.erase(it);
+    } else {
+      continue;
+    }
+
+    folly::dynamic event = folly::dynamic::object("name", name)(
+        "cat", kCategory)("ph", point.start ? "b" : "e")(
+        "id", formatId(point.traceId))("ts", toMicroseconds(point.timestamp))(
+        "pid", pid)("tid", int64_t{point.threadId});
+    if (point.start) {
+      event["args"] = folly::dynamic::object(
+          "blockId", formatId(point.blockId))(
+          "parentBlockId", formatId(point.parentBlockId));
+    }
+    appendEvent(out, event);
+  }
+  if (!out.empty()) {
+    writeAll(out);
+  }
+}
+
+void ChromeTraceWriter::writeAll(folly::StringPiece data) {
+  if (folly::writeFull(file_.fd(), data.data(), data.size()) < 0) {
+    folly::throwSystemError("failed to write the trace");
+  }
+}
+
+ChromeTraceExporter::ChromeTraceExporter(
+    folly::StringPiece path,
+    std::chrono::milliseconds interval)
+    : path_{path.str()},
+      interval_{interval},
+      writer_{folly::File{path_, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC}} {
+  thread_ = std::thread{[this] {
+    folly::setThreadName("TraceExporter");
+    std::unique_lock<std::mutex> lock{mutex_};
+    while (!done_) {
+      cv_.wait_for(lock, interval_, [this] { return done_; });
+      lock.unlock();
+      exportPending();
+      lock.lock();
+    }
+  }};
+}
+
+ChromeTraceExporter::~ChromeTraceExporter() {
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    done_ = true;
+  }
+  cv_.notify_one();
+  thread_.join();
+}
+
+void ChromeTraceExporter::exportPending() {
+  auto points = getAllTracepoints();
+  if (points.empty()) {
+    return;
+  }
+  try {
+    writer_.write(points, getTraceThreadNames());
+  } catch (const std::exception& ex) {
+    XLOG_EVERY_MS(ERR, 10000)
+        << "failed to export " << points.size() << " tracepoints to " << path_
+        << ": " << folly::exceptionStr(ex);
+  }
+}
+
+} // namespace eden
+} // namespace facebook
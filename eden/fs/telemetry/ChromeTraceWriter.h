@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/File.h>
+#include <folly/Range.h>
+#include <folly/container/F14Map.h>
+#include <folly/container/F14Set.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eden/fs/telemetry/Tracing.h"
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Writes tracepoints as Chrome trace event JSON, which both chrome://tracing
+ * and Perfetto load.
+ *
+ * Each TraceBlock becomes a nestable async span whose id is its traceId, so
+ * the blocks of a request are nested on one track even when their futures
+ * hop across threads. The thread which started a block and the block ids are
+ * recorded in the arguments of its span.
+ *
+ * The output uses the JSON array format, which the viewers accept without its
+ * closing bracket, so the file can be loaded while it is still being written.
+ */
+class ChromeTraceWriter {
+ public:
+  explicit ChromeTraceWriter(folly::File file);
+
+  ChromeTraceWriter(const ChromeTraceWriter&) = delete;
+  ChromeTraceWriter& operator=(const ChromeTraceWriter&) = delete;
+
+  /**
+   * Append the tracepoints, which must be in timestamp order, along with the
+   * names of the threads seen for the first time.
+   *
+   * Stop tracepoints whose block started before the writer was created are
+   * skipped.
+   */
+  void write(
+      const std::vector<CompactTracePoint>& points,
+      const folly::F14FastMap<uint32_t, std::string>& threadNames);
+
+  /**
+   * The number of blocks started but not stopped yet.
+   */
+  size_t getOpenBlockCount() const {
+    return openBlocks_.size();
+  }
+
+ private:
+  void writeAll(folly::StringPiece data);
+
+  folly::File file_;
+  // The name of each open block, by blockId, as the stop tracepoints don't
+  // carry one.
+  folly::F14FastMap<uint64_t, const char*> openBlocks_;
+  folly::F14FastSet<uint32_t> namedThreads_;
+};
+
+/**
+ * Streams the tracepoints recorded by TraceBlocks into a ChromeTraceWriter
+ * from a background thread, until it is destroyed.
+ *
+ * The tracepoints are consumed with getAllTracepoints(), so getTracePoints
+ * returns nothing while an exporter runs.
+ */
+class ChromeTraceExporter {
+ public:
+  static constexpr std::chrono::milliseconds kDefaultInterval{500};
+
+  /**
+   * Open the output file, truncating it, and start exporting. Throws if the
+   * file can't be opened.
+   */
+  explicit ChromeTraceExporter(
+      folly::StringPiece path,
+      std::chrono::milliseconds interval = kDefaultInterval);
+  ~ChromeTraceExporter();
+
+  ChromeTraceExporter(const ChromeTraceExporter&) = delete;
+  ChromeTraceExporter& operator=(const ChromeTraceExporter&) = delete;
+
+  const std::string& getPath() const {
+    return path_;
+  }
+
+ private:
+  void exportPending();
+
+  const std::string path_;
+  const std::chrono::milliseconds interval_;
+  ChromeTraceWriter writer_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool done_{false};
+  std::thread thread_;
+};
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/telemetry/CounterDeltaTable.h"
+
+#include <folly/Random.h>
+
+namespace facebook {
+namespace eden {
+
+CounterDeltaTable::CounterDeltaTable(size_t maxRemovals)
+    : epoch_{folly::Random::rand32() | 1u}, maxRemovals_{maxRemovals} {}
+
+uint64_t CounterDeltaTable::update(
+    const std::map<std::string, int64_t>& counters) {
+  // The version is the low half of the tokens.
+  if (++version_ == (uint64_t{1} << 32)) {
+    version_ = 1;
+    oldestIncrementalVersion_ = version_;
+    removals_.clear();
+  }
+
+  for (const auto& [name, value] : counters) {
+    auto [it, inserted] = counters_.try_emplace(name, Entry{value, version_});
+    if (!inserted && it->second.value != value) {
+      it->second = Entry{value, version_};
+    }
+  }
+  for (auto it = counters_.begin(); it != counters_.end();) {
+    if (counters.count(it->first) == 0) {
+      removals_.emplace_back(version_, it->first);
+      it = counters_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  while (removals_.size() > maxRemovals_) {
+    oldestIncrementalVersion_ = removals_.front().first;
+    removals_.pop_front();
+  }
+  return getToken();
+}
+
+CounterDeltaTable::Delta CounterDeltaTable::getChangesSince(
+    uint64_t token) const {
+  Delta delta;
+  delta.token = getToken();
+  auto version = token & 0xffffffff;
+  delta.full = (token >> 32) != epoch_ || version > version_ ||
+      version < oldestIncrementalVersion_;
+  if (delta.full) {
+    version = 0;
+  }
+
+  for (const auto& [name, entry] : counters_) {
+    if (entry.version > version) {
+      delta.changed.emplace_back(name, entry.value);
+    }
+  }
+  if (!delta.full) {
+    for (auto it = removals_.rbegin();
+         it != removals_.rend() && it->first > version;
+         ++it) {
+      // Skip the counters that were added back since.
+      if (counters_.count(it->second) == 0) {
+        delta.removed.push_back(it->second);
+      }
+    }
+  }
+  return delta;
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/container/F14Map.h>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace facebook {
+namespace eden {
+
+/**
+ * Remembers in which update each counter last changed, so that a poller can
+ * be sent only the counters that changed since its previous poll.
+ *
+ * A token identifies an update of a table: passing the token of an update to
+ * getChangesSince() returns the changes made by the later updates. A token
+ * of another table, such as one handed out before a restart, or one older
+ * than the removals the table still remembers, gets every counter instead.
+ *
+ * Not thread-safe.
+ */
+class CounterDeltaTable {
+ public:
+  struct Delta {
+    uint64_t token{0};
+    /**
+     * The token could not be answered incrementally: `changed` holds every
+     * counter, and the counters missing from it were removed.
+     */
+    bool full{false};
+    std::vector<std::pair<std::string, int64_t>> changed;
+    std::vector<std::string> removed;
+  };
+
+  /**
+   * maxRemovals is how many removed counters are remembered, past which the
+   * older tokens get full deltas.
+   */
+  explicit CounterDeltaTable(size_t maxRemovals = 4096);
+
+  /**
+   * Record the current values of every counter, and return the token of this
+   * update.
+   */
+  uint64_t update(const std::map<std::string, int64_t>& counters);
+
+  Delta getChangesSince(uint64_t token) const;
+
+  /** The token of the latest update. */
+  uint64_t getToken() const {
+    return makeToken(version_);
+  }
+
+ private:
+  struct Entry {
+    int64_t value;
+    uint64_t version;
+  };
+
+  uint64_t makeToken(uint64_t version) const {
+    return (epoch_ << 32) | version;
+  }
+
+  const uint64_t epoch_;
+  const size_t maxRemovals_;
+  folly::F14NodeMap<std::string, Entry> counters_;
+  // The removed counters, along with the version that removed them, oldest
+  // first.
+  std::deque<std::pair<uint64_t, std::string>> removals_;
+  uint64_t version_{0};
+  // Tokens older than this version may have missed forgotten removals.
+  uint64_t oldestIncrementalVersion_{0};
+};
+
+} // namespace eden
+} // namespace facebook
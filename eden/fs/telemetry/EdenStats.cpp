@@ -33,6 +33,14 @@ JournalThreadStats& EdenStats::getJournalStatsForCurrentThread() {
   return *threadLocalJournalStats_.get();
 }
 
+ThriftThreadStats& EdenStats::getThriftStatsForCurrentThread() {
+  return *threadLocalThriftStats_.get();
+}
+
+ExecutorThreadStats& EdenStats::getExecutorStatsForCurrentThread() {
+  return *threadLocalExecutorStats_.get();
+}
+
 void EdenStats::flush() {
   // This method is only really useful while testing to ensure that the service
   // data singleton instance has the latest stats. Since all our stats are now
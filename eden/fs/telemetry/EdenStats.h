@@ -22,6 +22,8 @@ class ObjectStoreThreadStats;
 class HgBackingStoreThreadStats;
 class HgImporterThreadStats;
 class JournalThreadStats;
+class ThriftThreadStats;
+class ExecutorThreadStats;
 
 class EdenStats {
  public:
@@ -60,6 +62,20 @@ class EdenStats {
    */
   JournalThreadStats& getJournalStatsForCurrentThread();
 
+  /**
+   * This function can be called on any thread.
+   *
+   * The returned object can be used only on the current thread.
+   */
+  ThriftThreadStats& getThriftStatsForCurrentThread();
+
+  /**
+   * This function can be called on any thread.
+   *
+   * The returned object can be used only on the current thread.
+   */
+  ExecutorThreadStats& getExecutorStatsForCurrentThread();
+
   /**
    * This function can be called on any thread.
    */
@@ -78,6 +94,10 @@ class EdenStats {
       threadLocalHgImporterStats_;
   folly::ThreadLocal<JournalThreadStats, ThreadLocalTag, void>
       threadLocalJournalStats_;
+  folly::ThreadLocal<ThriftThreadStats, ThreadLocalTag, void>
+      threadLocalThriftStats_;
+  folly::ThreadLocal<ExecutorThreadStats, ThreadLocalTag, void>
+      threadLocalExecutorStats_;
 };
 
 std::shared_ptr<HgImporterThreadStats> getSharedHgImporterStatsForCurrentThread(
@@ -127,6 +147,7 @@ class ChannelThreadStats : public EdenThreadStatsBase {
   Stat fsync{createStat("fuse.fsync_us")};
   Stat opendir{createStat("fuse.opendir_us")};
   Stat readdir{createStat("fuse.readdir_us")};
+  Stat readdirplus{createStat("fuse.readdirplus_us")};
   Stat releasedir{createStat("fuse.releasedir_us")};
   Stat fsyncdir{createStat("fuse.fsyncdir_us")};
   Stat statfs{createStat("fuse.statfs_us")};
@@ -141,6 +162,21 @@ class ChannelThreadStats : public EdenThreadStatsBase {
   Stat poll{createStat("fuse.poll_us")};
   Stat forgetmulti{createStat("fuse.forgetmulti_us")};
   Stat fallocate{createStat("fuse.fallocate_us")};
+  Stat lseek{createStat("fuse.lseek_us")};
+  Stat copyfilerange{createStat("fuse.copyfilerange_us")};
+
+  // Count the FuseRequestContext allocations that had to go to the heap and
+  // the ones that reused a block from the FuseChannel's request pool.
+  Stat requestAllocated{createStat("fuse.request_allocated")};
+  Stat requestRecycled{createStat("fuse.request_recycled")};
+
+  // Same as above, for the buffers of READDIR and READDIRPLUS replies.
+  Stat bufferAllocated{createStat("fuse.buffer_allocated")};
+  Stat bufferRecycled{createStat("fuse.buffer_recycled")};
+
+  // Number of ImmediateFuture continuations that had to allocate a SemiFuture
+  // while dispatching a request, see getImmediateFutureAllocationCount().
+  Stat futureAllocations{createStat("fuse.future_allocations")};
 
   Stat nfsNull{createStat("nfs.null_us")};
   Stat nfsGetattr{createStat("nfs.getattr_us")};
@@ -164,6 +200,14 @@ class ChannelThreadStats : public EdenThreadStatsBase {
   Stat nfsFsinfo{createStat("nfs.fsinfo_us")};
   Stat nfsPathconf{createStat("nfs.pathconf_us")};
   Stat nfsCommit{createStat("nfs.commit_us")};
+  Stat nfs4Compound{createStat("nfs4.compound_us")};
+
+  // Number of replies the NFS server wrote to a socket at once.
+  Stat nfsRepliesPerWrite{createStat("nfs.replies_per_write")};
+
+  // Number of ImmediateFuture continuations that had to allocate a SemiFuture
+  // while dispatching a request, see getImmediateFutureAllocationCount().
+  Stat nfsFutureAllocations{createStat("nfs.future_allocations")};
 #else
   Stat outOfOrderCreate{createStat("prjfs.out_of_order_create")};
 
@@ -184,6 +228,12 @@ class ChannelThreadStats : public EdenThreadStatsBase {
   Stat read{createStat("prjfs.read_us")};
 #endif
 
+  // Count the lookups of a directory child from the FUSE and NFS channels
+  // that found it and the ones that didn't, the latter are mostly build
+  // systems probing for files.
+  Stat lookupChildFound{createStat("inodes.lookup_child_found")};
+  Stat lookupChildMissing{createStat("inodes.lookup_child_missing")};
+
   // Since we can potentially finish a request in a different thread from the
   // one used to initiate it, we use StatPtr as a helper for referencing the
   // pointer-to-member that we want to update at the end of the request.
@@ -218,6 +268,15 @@ class ObjectStoreThreadStats : public EdenThreadStatsBase {
       createStat("object_store.get_blob_size.local_store")};
   Stat getBlobSizeFromBackingStore{
       createStat("object_store.get_blob_size.backing_store")};
+
+  // Requests that waited for a fetch of the same object already in progress
+  // rather than starting their own.
+  Stat getBlobCoalesced{createStat("object_store.get_blob.coalesced")};
+  Stat getTreeCoalesced{createStat("object_store.get_tree.coalesced")};
+  Stat getBlobMetadataCoalesced{
+      createStat("object_store.get_blob_metadata.coalesced")};
+
+  using StatPtr = Stat ObjectStoreThreadStats::*;
 };
 
 /**
@@ -229,6 +288,15 @@ class HgBackingStoreThreadStats : public EdenThreadStatsBase {
   Stat hgBackingStoreImportBlob{createStat("store.hg.import_blob")};
   Stat hgBackingStoreGetTree{createStat("store.hg.get_tree")};
   Stat hgBackingStoreImportTree{createStat("store.hg.import_tree")};
+  Stat importQueueWaitLow{createStat("store.hg.import_queue_wait_us.low")};
+  Stat importQueueWaitNormal{
+      createStat("store.hg.import_queue_wait_us.normal")};
+  Stat importQueueWaitHigh{createStat("store.hg.import_queue_wait_us.high")};
+  Stat importBatchSizeBlob{createStat("store.hg.import_batch_size.blob")};
+  Stat importBatchSizeTree{createStat("store.hg.import_batch_size.tree")};
+  Stat missingObjectCacheHit{createStat("store.hg.missing_object_cache.hit")};
+  Stat missingObjectCacheInsert{
+      createStat("store.hg.missing_object_cache.insert")};
 };
 
 /**
@@ -251,5 +319,41 @@ class JournalThreadStats : public EdenThreadStatsBase {
   Stat filesAccumulated{createStat("journal.files_accumulated")};
 };
 
+/**
+ * @see EdenServiceHandler
+ */
+class ThriftThreadStats : public EdenThreadStatsBase {
+ public:
+  // Where the SHA-1s returned by getSHA1 came from: hashed from the contents
+  // of a materialized file, or from the blob metadata in memory, in the local
+  // store or fetched from the backing store.
+  Stat getSha1FromOverlay{createStat("thrift.get_sha1.overlay")};
+  Stat getSha1FromMemory{createStat("thrift.get_sha1.memory")};
+  Stat getSha1FromLocalStore{createStat("thrift.get_sha1.local_store")};
+  Stat getSha1FromBackingStore{createStat("thrift.get_sha1.backing_store")};
+
+  // Requests rejected because their client was over its budget.
+  Stat rejectedOverloaded{createStat("thrift.rejected_overloaded")};
+
+  // Streams failed because they reached the most batches a stream may
+  // publish, which are held until the client reads them.
+  Stat streamOverflow{createStat("thrift.stream_overflow")};
+
+  // How long checking the credentials of the caller took, in microseconds.
+  Stat permissionCheck{createStat("thrift.permission_check_us")};
+};
+
+/**
+ * @see EdenCPUThreadPool
+ */
+class ExecutorThreadStats : public EdenThreadStatsBase {
+ public:
+  // How long the tasks of each class waited in the queue, in microseconds.
+  Stat interactiveQueueLatency{
+      createStat("eden_cpu_pool.interactive_queue_latency_us")};
+  Stat backgroundQueueLatency{
+      createStat("eden_cpu_pool.background_queue_latency_us")};
+};
+
 } // namespace eden
 } // namespace facebook
@@ -8,6 +8,10 @@
 #include "eden/fs/telemetry/FsEventLogger.h"
 
 #include <folly/Random.h>
+#include <folly/logging/xlog.h>
+#include <folly/system/ThreadName.h>
+#include <algorithm>
+#include <utility>
 
 #include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/config/ReloadableConfig.h"
@@ -18,6 +22,8 @@ namespace facebook::eden {
 namespace {
 constexpr size_t kConfigsStringBufferSize = 500;
 constexpr auto kConfigsStringRefreshInterval = std::chrono::minutes(30);
+// How long each thread uses its copy of the sampling config.
+constexpr auto kSamplerConfigRefreshInterval = std::chrono::seconds(1);
 
 std::string getConfigsString(std::shared_ptr<const EdenConfig> config) {
   fmt::memory_buffer buffer;
@@ -45,59 +51,160 @@ std::string getConfigsString(std::shared_ptr<const EdenConfig> config) {
 FsEventLogger::FsEventLogger(
     ReloadableConfig& edenConfig,
     std::shared_ptr<IHiveLogger> logger)
-    : edenConfig_{edenConfig},
-      logger_{std::move(logger)},
-      counterStartTime_{std::chrono::steady_clock::now()},
-      configsString_{getConfigsString(edenConfig_.getEdenConfig())},
-      configsStringUpdateTime_{std::chrono::steady_clock::now()} {}
+    : edenConfig_{edenConfig}, logger_{std::move(logger)} {
+  writerThread_ = std::thread([this] {
+    folly::setThreadName("FsEventLogger");
+    writerThread();
+  });
+}
 
-void FsEventLogger::log(Event event) {
-  if (event.samplingGroup == SamplingGroup::DropAll) {
-    return;
-  }
+FsEventLogger::~FsEventLogger() {
+  state_.lock()->shouldStop = true;
+  newRecordOrStop_.notify_one();
+  writerThread_.join();
+}
 
-  auto config = edenConfig_.getEdenConfig(ConfigReloadBehavior::NoReload);
+void FsEventLogger::flush() {
+  auto state = state_.lock();
+  auto queuedCount = state->queuedCount;
+  recordsWritten_.wait(
+      state.as_lock(), [&] { return state->writtenCount >= queuedCount; });
+}
 
-  const auto& denominators =
-      config->requestSamplingGroupDenominators.getValue();
-  auto samplingGroup = folly::to_underlying(event.samplingGroup);
-  if (samplingGroup > denominators.size()) {
-    // sampling group does not exist
-    return;
-  }
-  if (auto sampleDenominator = denominators.at(samplingGroup);
-      sampleDenominator && 0 != folly::Random::rand32(sampleDenominator)) {
-    // failed sampling
+void FsEventLogger::log(Event event) {
+  if (event.samplingGroup == SamplingGroup::DropAll) {
     return;
   }
 
-  // Multiple threads could enter the branches at the same time
-  // resulting in samplesCount_ undercounting, but this should rarely happen
-  // given the sampling above.
+  auto& sampler = *samplers_;
   auto now = std::chrono::steady_clock::now();
-  if ((now - counterStartTime_.load()) > std::chrono::minutes(1)) {
-    // reset counter for this minute
-    counterStartTime_.store(now);
-    samplesCount_.store(1);
-  } else if (
-      samplesCount_.load() < config->requestSamplesPerMinute.getValue()) {
-    // not throttled so bump counter
-    samplesCount_.fetch_add(1, std::memory_order_relaxed);
-  } else {
-    // throttled
-    return;
+  if (now - sampler.configTime >= kSamplerConfigRefreshInterval ||
+      sampler.configTime == std::chrono::steady_clock::time_point{}) {
+    updateSampler(sampler, now);
   }
 
-  if ((now - configsStringUpdateTime_.load()) > kConfigsStringRefreshInterval) {
-    configsStringUpdateTime_.store(now);
-    *configsString_.wlock() = getConfigsString(edenConfig_.getEdenConfig());
+  bool slow = sampler.slowThreshold.count() > 0 &&
+      event.durationNs >= sampler.slowThreshold;
+  if (!slow) {
+    auto samplingGroup = folly::to_underlying(event.samplingGroup);
+    if (samplingGroup >= sampler.denominators.size()) {
+      // sampling group does not exist
+      return;
+    }
+    if (auto sampleDenominator = sampler.denominators[samplingGroup];
+        sampleDenominator && 0 != folly::Random::rand32(sampleDenominator)) {
+      // failed sampling
+      return;
+    }
+    if (!takeToken(sampler.samplesPerMinute, now)) {
+      // throttled
+      return;
+    }
   }
 
-  auto configString = configsString_.rlock();
   uint64_t durationUs =
       std::chrono::duration_cast<std::chrono::microseconds>(event.durationNs)
           .count();
-  logger_->logFsEventSample({durationUs, event.cause, *configString});
+  bool wakeWriter;
+  {
+    auto state = state_.lock();
+    if (state->records.size() >= kQueueCapacity) {
+      droppedEvents_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+    state->records.push_back(Record{durationUs, event.cause, slow});
+    ++state->queuedCount;
+    wakeWriter = std::exchange(state->writerWaiting, false);
+  }
+  if (wakeWriter) {
+    newRecordOrStop_.notify_one();
+  }
+}
+
+void FsEventLogger::updateSampler(
+    Sampler& sampler,
+    std::chrono::steady_clock::time_point now) {
+  auto config = edenConfig_.getEdenConfig(ConfigReloadBehavior::NoReload);
+  sampler.denominators = config->requestSamplingGroupDenominators.getValue();
+  sampler.slowThreshold = config->requestSlowThreshold.getValue();
+  sampler.samplesPerMinute = config->requestSamplesPerMinute.getValue();
+  sampler.configTime = now;
+}
+
+bool FsEventLogger::takeToken(
+    uint32_t samplesPerMinute,
+    std::chrono::steady_clock::time_point now) {
+  if (samplesPerMinute == 0) {
+    return false;
+  }
+  // Each sample moves the time at which the bucket is full again one
+  // interval later, and a sample is allowed while that leaves it at most a
+  // minute away.
+  constexpr int64_t kBucketDuration =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::minutes(1))
+          .count();
+  int64_t interval = kBucketDuration / samplesPerMinute;
+  int64_t nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      now.time_since_epoch())
+                      .count();
+  auto fullTime = bucketFullTime_.load(std::memory_order_relaxed);
+  while (true) {
+    auto newFullTime = std::max(fullTime, nowNs) + interval;
+    if (newFullTime - nowNs > kBucketDuration) {
+      return false;
+    }
+    if (bucketFullTime_.compare_exchange_weak(
+            fullTime, newFullTime, std::memory_order_relaxed)) {
+      return true;
+    }
+  }
+}
+
+void FsEventLogger::writerThread() {
+  std::vector<Record> records;
+  std::string configsString;
+  std::chrono::steady_clock::time_point configsStringTime;
+
+  for (;;) {
+    records.clear();
+
+    bool shouldStop;
+    {
+      auto state = state_.lock();
+      state->writerWaiting = true;
+      newRecordOrStop_.wait(state.as_lock(), [&] {
+        return state->shouldStop || !state->records.empty();
+      });
+      state->writerWaiting = false;
+      records.swap(state->records);
+      shouldStop = state->shouldStop;
+    }
+
+    if (!records.empty()) {
+      auto now = std::chrono::steady_clock::now();
+      if (configsStringTime == std::chrono::steady_clock::time_point{} ||
+          now - configsStringTime > kConfigsStringRefreshInterval) {
+        configsString = getConfigsString(edenConfig_.getEdenConfig());
+        configsStringTime = now;
+      }
+    }
+    for (const auto& record : records) {
+      logger_->logFsEventSample(
+          {record.durationUs, record.cause, configsString, record.slow});
+    }
+
+    {
+      auto state = state_.lock();
+      state->writtenCount += records.size();
+    }
+    recordsWritten_.notify_all();
+
+    if (shouldStop) {
+      // Events cannot be logged during destruction, so the queue is empty.
+      return;
+    }
+  }
 }
 
 } // namespace facebook::eden
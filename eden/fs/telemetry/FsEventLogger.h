@@ -9,9 +9,13 @@
 
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include <folly/Synchronized.h>
+#include <folly/ThreadLocal.h>
 #include "folly/Range.h"
 
 namespace facebook::eden {
@@ -31,28 +35,108 @@ enum class SamplingGroup : uint32_t {
 class ReloadableConfig;
 class IHiveLogger;
 
+/**
+ * Logs a sample of the filesystem requests, and every request slower than
+ * `telemetry:request-slow-threshold`.
+ *
+ * Each thread keeps a copy of the sampling config. The token bucket of
+ * `telemetry:request-samples-per-minute` is shared by every thread, and taken
+ * from with a compare-and-swap rather than a lock. The logged events are
+ * queued and handed to the IHiveLogger by a background thread.
+ */
 class FsEventLogger {
  public:
+  static constexpr size_t kQueueCapacity = 1024;
+
   struct Event {
     std::chrono::nanoseconds durationNs;
     SamplingGroup samplingGroup;
+    // Must outlive the FsEventLogger, e.g. a string literal.
     folly::StringPiece cause;
   };
 
   FsEventLogger(
       ReloadableConfig& edenConfig,
       std::shared_ptr<IHiveLogger> logger);
+
+  /**
+   * Logs the events still queued before returning.
+   */
+  ~FsEventLogger();
+
   void log(Event event);
 
+  /**
+   * Wait until the events logged so far have been handed to the IHiveLogger
+   * or dropped.
+   */
+  void flush();
+
+  /**
+   * The number of sampled events dropped because the queue was full.
+   */
+  uint64_t getDroppedEventCount() const {
+    return droppedEvents_.load(std::memory_order_relaxed);
+  }
+
  private:
+  /**
+   * What the background thread needs to log an event, copied into the
+   * queue.
+   */
+  struct Record {
+    uint64_t durationUs;
+    folly::StringPiece cause;
+    bool slow;
+  };
+
+  /**
+   * The sampling config, as last read by one thread.
+   */
+  struct Sampler {
+    std::vector<uint32_t> denominators;
+    uint32_t samplesPerMinute{0};
+    std::chrono::nanoseconds slowThreshold{0};
+    std::chrono::steady_clock::time_point configTime;
+  };
+
+  struct State {
+    bool shouldStop = false;
+    bool writerWaiting = false;
+    std::vector<Record> records;
+    uint64_t queuedCount = 0;
+    uint64_t writtenCount = 0;
+  };
+
+  void updateSampler(
+      Sampler& sampler,
+      std::chrono::steady_clock::time_point now);
+
+  /**
+   * Takes one of the samplesPerMinute samples allowed across all threads.
+   */
+  bool takeToken(
+      uint32_t samplesPerMinute,
+      std::chrono::steady_clock::time_point now);
+  void writerThread();
+
   ReloadableConfig& edenConfig_;
   std::shared_ptr<IHiveLogger> logger_;
 
-  std::atomic<uint32_t> samplesCount_{0};
-  std::atomic<std::chrono::steady_clock::time_point> counterStartTime_;
+  folly::ThreadLocal<Sampler> samplers_;
+
+  /**
+   * The token bucket shared by every thread, as the time since the epoch of
+   * steady_clock, in nanoseconds, at which it will be full again. The bucket
+   * holds up to a minute worth of samples.
+   */
+  std::atomic<int64_t> bucketFullTime_{0};
 
-  folly::Synchronized<std::string> configsString_;
-  std::atomic<std::chrono::steady_clock::time_point> configsStringUpdateTime_;
+  std::atomic<uint64_t> droppedEvents_{0};
+  folly::Synchronized<State, std::mutex> state_;
+  std::condition_variable newRecordOrStop_;
+  std::condition_variable recordsWritten_;
+  std::thread writerThread_;
 };
 
 } // namespace facebook::eden
@@ -34,6 +34,9 @@ struct FsEventSample {
   uint64_t durationUs;
   folly::StringPiece cause;
   folly::StringPiece configList;
+  // Logged for being slower than telemetry:request-slow-threshold, rather
+  // than sampled.
+  bool slow{false};
 };
 
 // TODO: Deprecate ScribeLogger and rename this class ScribeLogger.
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/telemetry/LatencyHistogram.h"
+
+#include <folly/lang/Bits.h>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace facebook {
+namespace eden {
+
+size_t LatencyHistogram::bucketIndex(uint64_t value) {
+  value = std::min(value, kMaxValue);
+  if (value < kLinearBuckets) {
+    return value;
+  }
+  // The position of the highest set bit selects the power of two, and the
+  // kSubBucketBits bits below it select the linear bucket within it.
+  size_t exponent = folly::findLastSet(value) - 1;
+  size_t shift = exponent - kSubBucketBits;
+  size_t subBucket = (value >> shift) & (kSubBuckets - 1);
+  return kLinearBuckets + (shift - 1) * kSubBuckets + subBucket;
+}
+
+uint64_t LatencyHistogram::bucketMaxValue(size_t index) {
+  if (index < kLinearBuckets) {
+    return index;
+  }
+  size_t shift = (index - kLinearBuckets) / kSubBuckets + 1;
+  size_t subBucket = (index - kLinearBuckets) % kSubBuckets;
+  uint64_t minValue = (kSubBuckets + subBucket) << shift;
+  return minValue + (uint64_t{1} << shift) - 1;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    auto count = other.buckets_[i].load(std::memory_order_relaxed);
+    if (count) {
+      buckets_[i].fetch_add(count, std::memory_order_relaxed);
+    }
+  }
+}
+
+uint64_t LatencyHistogram::count() const {
+  uint64_t total = 0;
+  for (auto& bucket : buckets_) {
+    total += bucket.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+LatencyHistogram::Counts LatencyHistogram::snapshot() const {
+  Counts counts;
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    counts[i] = buckets_[i].load(std::memory_order_relaxed);
+  }
+  return counts;
+}
+
+std::chrono::microseconds LatencyHistogram::percentileOf(
+    const Counts& counts,
+    uint64_t total,
+    double fraction) {
+  if (total == 0) {
+    return std::chrono::microseconds{0};
+  }
+
+  fraction = std::clamp(fraction, 0.0, 1.0);
+  auto rank = std::max<uint64_t>(1, std::ceil(fraction * total));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    seen += counts[i];
+    if (seen >= rank) {
+      return std::chrono::microseconds(bucketMaxValue(i));
+    }
+  }
+  return std::chrono::microseconds(kMaxValue);
+}
+
+std::chrono::microseconds LatencyHistogram::getPercentile(
+    double fraction) const {
+  auto counts = snapshot();
+  auto total = std::accumulate(counts.begin(), counts.end(), uint64_t{0});
+  return percentileOf(counts, total, fraction);
+}
+
+LatencyHistogram::Percentiles LatencyHistogram::getPercentiles() const {
+  // Compute every percentile from the same snapshot so that they are
+  // consistent with each other and with the count.
+  auto counts = snapshot();
+  Percentiles result;
+  result.count = std::accumulate(counts.begin(), counts.end(), uint64_t{0});
+  result.p50 = percentileOf(counts, result.count, 0.5);
+  result.p90 = percentileOf(counts, result.count, 0.9);
+  result.p99 = percentileOf(counts, result.count, 0.99);
+  result.p999 = percentileOf(counts, result.count, 0.999);
+  return result;
+}
+
+} // namespace eden
+} // namespace facebook
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace facebook {
+namespace eden {
+
+/**
+ * A fixed-size histogram of latencies, bucketed like HdrHistogram: every
+ * power of two is split into kSubBuckets linear buckets, so a recorded value
+ * is off by at most 1/kSubBuckets of itself.  Latencies are recorded in
+ * microseconds and clamped to kMaxValue.
+ *
+ * record() is a relaxed atomic increment and never blocks.  The histogram is
+ * intended to be kept per thread and combined with merge() when read, but it
+ * is safe to record and read from any number of threads.
+ */
+class LatencyHistogram {
+ public:
+  static constexpr size_t kSubBucketBits = 3;
+  static constexpr size_t kSubBuckets = size_t{1} << kSubBucketBits;
+  // About 134 seconds, comfortably above the FUSE request timeout.
+  static constexpr uint64_t kMaxValue = (uint64_t{1} << 27) - 1;
+
+  struct Percentiles {
+    uint64_t count{0};
+    std::chrono::microseconds p50{0};
+    std::chrono::microseconds p90{0};
+    std::chrono::microseconds p99{0};
+    std::chrono::microseconds p999{0};
+  };
+
+  void record(std::chrono::microseconds latency) {
+    auto value = latency.count() < 0 ? 0 : uint64_t(latency.count());
+    buckets_[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * Add the counts recorded in other to this histogram.
+   */
+  void merge(const LatencyHistogram& other);
+
+  uint64_t count() const;
+
+  /**
+   * Returns the latency below which the given fraction (between 0 and 1) of
+   * the recorded values fall, rounded up to the end of its bucket.  Returns 0
+   * if nothing was recorded.
+   */
+  std::chrono::microseconds getPercentile(double fraction) const;
+
+  Percentiles getPercentiles() const;
+
+  static size_t bucketIndex(uint64_t value);
+
+  /**
+   * Returns the largest value that falls into the bucket at index.
+   */
+  static uint64_t bucketMaxValue(size_t index);
+
+ private:
+  // Values below 2 * kSubBuckets get a bucket each.  Each power of two above
+  // that, up to kMaxValue, gets kSubBuckets buckets.
+  static constexpr size_t kLinearBuckets = 2 * kSubBuckets;
+  static constexpr size_t kNumBuckets =
+      kLinearBuckets + (27 - kSubBucketBits - 1) * kSubBuckets;
+
+  using Counts = std::array<uint64_t, kNumBuckets>;
+
+  Counts snapshot() const;
+  static std::chrono::microseconds
+  percentileOf(const Counts& counts, uint64_t total, double fraction);
+
+  std::array<std::atomic<uint64_t>, kNumBuckets> buckets_{};
+};
+
+} // namespace eden
+} // namespace facebook
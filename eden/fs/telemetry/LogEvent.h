@@ -132,6 +132,28 @@ struct DaemonStop {
   }
 };
 
+struct TakeoverShutdown {
+  static constexpr const char* type = "takeover_shutdown";
+
+  // Compacting the local store and stopping the thrift server.
+  double prepare_duration = 0.0;
+  // Stopping the channels, then unloading and serializing the inodes of all
+  // the mounts, which run concurrently.
+  double stop_mounts_duration = 0.0;
+  // Sending the takeover data to the new process.
+  double send_duration = 0.0;
+  int64_t mount_count = 0;
+  bool success = false;
+
+  void populate(DynamicEvent& event) const {
+    event.addDouble("prepare_duration", prepare_duration);
+    event.addDouble("stop_mounts_duration", stop_mounts_duration);
+    event.addDouble("send_duration", send_duration);
+    event.addInt("mount_count", mount_count);
+    event.addBool("success", success);
+  }
+};
+
 struct FinishedCheckout {
   static constexpr const char* type = "checkout";
 
@@ -189,12 +211,14 @@ struct RocksDbAutomaticGc {
   bool success = false;
   int64_t size_before = 0;
   int64_t size_after = 0;
+  int64_t reclaimed = 0;
 
   void populate(DynamicEvent& event) const {
     event.addDouble("duration", duration);
     event.addBool("success", success);
     event.addInt("size_before", size_before);
     event.addInt("size_after", size_after);
+    event.addInt("reclaimed", reclaimed);
   }
 };
 
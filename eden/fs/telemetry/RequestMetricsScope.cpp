@@ -11,6 +11,7 @@
 #include <numeric>
 
 #include <folly/String.h>
+#include <folly/logging/xlog.h>
 
 #include "eden/fs/utils/Bug.h"
 #include "eden/fs/utils/EnumValue.h"
@@ -18,36 +19,96 @@
 namespace facebook {
 namespace eden {
 
+namespace {
+std::atomic<size_t> nextShard{0};
+} // namespace
+
+RequestWatchList::RequestWatchList(uint32_t sampleRate)
+    : sampleRate_{sampleRate} {
+  XCHECK_GT(sampleRate_, 0u);
+}
+
+RequestWatchList::Shard& RequestWatchList::getShard() {
+  static thread_local size_t shard =
+      nextShard.fetch_add(1, std::memory_order_relaxed) % kShardCount;
+  return shards_[shard];
+}
+
+bool RequestWatchList::start(SampleList::iterator& sample) {
+  getShard().count.fetch_add(1, std::memory_order_relaxed);
+
+  static thread_local uint32_t countdown = 0;
+  bool sampled = countdown == 0 ||
+      sampledCount_.load(std::memory_order_relaxed) == 0;
+  if (!sampled) {
+    --countdown;
+    return false;
+  }
+  countdown = sampleRate_ - 1;
+
+  sampledCount_.fetch_add(1, std::memory_order_relaxed);
+  auto samples = samples_.lock();
+  sample = samples->insert(samples->end(), folly::stop_watch<>{});
+  return true;
+}
+
+void RequestWatchList::finish(bool sampled, SampleList::iterator sample) {
+  getShard().count.fetch_sub(1, std::memory_order_relaxed);
+  if (sampled) {
+    samples_.lock()->erase(sample);
+    sampledCount_.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+size_t RequestWatchList::getCount() const {
+  int64_t count = 0;
+  for (const auto& shard : shards_) {
+    count += shard.count.load(std::memory_order_relaxed);
+  }
+  // The shards are read one at a time, so a request moving between them may
+  // be missed or seen twice.
+  return count > 0 ? static_cast<size_t>(count) : 0;
+}
+
+RequestWatchList::Duration RequestWatchList::getMaxSampledDuration() const {
+  // The list is in start order, so the oldest sample is the first one.
+  auto samples = samples_.lock();
+  return samples->empty() ? Duration{0} : samples->front().elapsed();
+}
+
 RequestMetricsScope::RequestMetricsScope(
-    LockedRequestWatchList* pendingRequestWatches)
+    RequestWatchList* pendingRequestWatches)
     : pendingRequestWatches_(pendingRequestWatches) {
-  folly::stop_watch<> watch;
-  {
-    auto startTimes = pendingRequestWatches_->wlock();
-    requestWatch_ = startTimes->insert(startTimes->end(), watch);
-  }
+  sampled_ = pendingRequestWatches_->start(requestWatch_);
 }
 
 RequestMetricsScope::RequestMetricsScope() : pendingRequestWatches_(nullptr) {}
 
 RequestMetricsScope::RequestMetricsScope(RequestMetricsScope&& other) noexcept
     : pendingRequestWatches_(std::move(other.pendingRequestWatches_)),
-      requestWatch_(std::move(other.requestWatch_)) {
+      requestWatch_(std::move(other.requestWatch_)),
+      sampled_(other.sampled_) {
   other.pendingRequestWatches_ = nullptr;
 }
 
 RequestMetricsScope& RequestMetricsScope::operator=(
     RequestMetricsScope&& other) {
+  reset();
   this->pendingRequestWatches_ = std::move(other.pendingRequestWatches_);
   this->requestWatch_ = std::move(other.requestWatch_);
+  this->sampled_ = other.sampled_;
   other.pendingRequestWatches_ = nullptr;
   return *this;
 }
 
 RequestMetricsScope::~RequestMetricsScope() {
+  reset();
+}
+
+void RequestMetricsScope::reset() {
   if (pendingRequestWatches_ != nullptr) {
-    auto startTimes = pendingRequestWatches_->wlock();
-    startTimes->erase(requestWatch_);
+    pendingRequestWatches_->finish(sampled_, requestWatch_);
+    pendingRequestWatches_ = nullptr;
   }
 }
 
@@ -99,10 +160,10 @@ size_t RequestMetricsScope::aggregateMetricCounters(
 
 size_t RequestMetricsScope::getMetricFromWatches(
     RequestMetric metric,
-    const LockedRequestWatchList& watches) {
+    const RequestWatchList& watches) {
   switch (metric) {
     case COUNT:
-      return watches.rlock()->size();
+      return watches.getCount();
     case MAX_DURATION_US:
       return static_cast<size_t>(
           std::chrono::duration_cast<std::chrono::microseconds>(
@@ -113,15 +174,8 @@ size_t RequestMetricsScope::getMetricFromWatches(
 }
 
 RequestMetricsScope::DefaultRequestDuration RequestMetricsScope::getMaxDuration(
-    const LockedRequestWatchList& watches) {
-  DefaultRequestDuration maxDurationImport{0};
-  {
-    auto lockedWatches = watches.rlock();
-    for (const auto& watch : *lockedWatches) {
-      maxDurationImport = std::max(maxDurationImport, watch.elapsed());
-    }
-  }
-  return maxDurationImport;
+    const RequestWatchList& watches) {
+  return watches.getMaxSampledDuration();
 }
 
 } // namespace eden
@@ -7,33 +7,94 @@
 
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <string>
 
 #include <folly/String.h>
 #include <folly/Synchronized.h>
+#include <folly/lang/Align.h>
 #include <folly/stop_watch.h>
 
 namespace facebook {
 namespace eden {
 
 /**
- * Represents a request tracked in a RequestMetricsScope::RequestWatchList.
- * To track a request a RequestMetricsScope object should be in scope for the
- * duration of the request.
+ * The requests of one kind in flight, such as the live blob imports.
  *
- * The scope inserts a watch into the given list on construction and removes
- * that watch on destruction.
+ * The number of requests is exact, and kept in sharded counters, so starting
+ * and finishing a request takes no lock. The age of the oldest request is
+ * estimated from a sample of the requests, which are the only ones taking a
+ * lock: every request is sampled while none of the sampled requests are in
+ * flight, so that a lone stuck request is always seen, and otherwise one in
+ * `sampleRate` requests started by a thread is.
+ */
+class RequestWatchList {
+ public:
+  using Duration = std::chrono::steady_clock::duration;
+
+  static constexpr uint32_t kDefaultSampleRate = 16;
+
+  explicit RequestWatchList(uint32_t sampleRate = kDefaultSampleRate);
+
+  RequestWatchList(const RequestWatchList&) = delete;
+  RequestWatchList& operator=(const RequestWatchList&) = delete;
+
+  /**
+   * The number of requests in flight.
+   */
+  size_t getCount() const;
+
+  /**
+   * The time elapsed since the oldest sampled request in flight started.
+   */
+  Duration getMaxSampledDuration() const;
+
+ private:
+  using SampleList = std::list<folly::stop_watch<>>;
+
+  struct alignas(folly::hardware_destructive_interference_size) Shard {
+    // May be negative, as requests can finish on other threads than the one
+    // they started on, but the sum of the shards is exact.
+    std::atomic<int64_t> count{0};
+  };
+
+  static constexpr size_t kShardCount = 16;
+
+  Shard& getShard();
+
+  /**
+   * Count a new request, and return whether it was sampled, in which case
+   * `sample` is set to its watch.
+   */
+  bool start(SampleList::iterator& sample);
+  void finish(bool sampled, SampleList::iterator sample);
+
+  const uint32_t sampleRate_;
+  std::array<Shard, kShardCount> shards_;
+  std::atomic<size_t> sampledCount_{0};
+  folly::Synchronized<SampleList, std::mutex> samples_;
+
+  friend class RequestMetricsScope;
+};
+
+/**
+ * Represents a request tracked in a RequestWatchList. To track a request a
+ * RequestMetricsScope object should be in scope for the duration of the
+ * request.
+ *
+ * The scope counts the request in the given list on construction and
+ * uncounts it on destruction.
  */
 class RequestMetricsScope {
  public:
-  using RequestWatchList = std::list<folly::stop_watch<>>;
-  using LockedRequestWatchList = folly::Synchronized<RequestWatchList>;
-  using DefaultRequestDuration =
-      std::chrono::steady_clock::steady_clock::duration;
+  using DefaultRequestDuration = RequestWatchList::Duration;
 
-  RequestMetricsScope(LockedRequestWatchList* pendingRequestWatches);
+  explicit RequestMetricsScope(RequestWatchList* pendingRequestWatches);
   RequestMetricsScope();
   RequestMetricsScope(RequestMetricsScope&&) noexcept;
   RequestMetricsScope& operator=(RequestMetricsScope&&);
@@ -95,18 +156,20 @@ class RequestMetricsScope {
    */
   static size_t getMetricFromWatches(
       RequestMetric metric,
-      const LockedRequestWatchList& watches);
+      const RequestWatchList& watches);
 
   /**
-   * finds the watch in `watches` for which the time that has elapsed
-   * is the greatest and returns the duration of time that has elapsed
+   * returns the duration of time that has elapsed since the oldest sampled
+   * request of `watches` started
    */
-  static DefaultRequestDuration getMaxDuration(
-      const LockedRequestWatchList& watches);
+  static DefaultRequestDuration getMaxDuration(const RequestWatchList& watches);
 
  private:
-  LockedRequestWatchList* pendingRequestWatches_;
-  RequestWatchList::iterator requestWatch_;
+  void reset();
+
+  RequestWatchList* pendingRequestWatches_;
+  RequestWatchList::SampleList::iterator requestWatch_;
+  bool sampled_{false};
 }; // namespace eden
 } // namespace eden
 } // namespace facebook
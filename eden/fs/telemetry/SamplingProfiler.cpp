@@ -0,0 +1,400 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/telemetry/SamplingProfiler.h"
+
+#include <folly/Conv.h>
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <folly/Synchronized.h>
+#include <folly/container/F14Map.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <folly/experimental/symbolizer/StackTrace.h>
+#include <folly/experimental/symbolizer/Symbolizer.h>
+#include <signal.h>
+#include <time.h>
+#endif
+
+namespace facebook::eden {
+
+namespace {
+thread_local const char* currentTag = nullptr;
+} // namespace
+
+ProfilerTag::ProfilerTag(const char* tag) noexcept
+    : slot_{&currentTag}, previous_{currentTag} {
+  currentTag = tag;
+}
+
+ProfilerTag::ProfilerTag(ProfilerTag&& other) noexcept
+    : slot_{std::exchange(other.slot_, nullptr)}, previous_{other.previous_} {}
+
+ProfilerTag::~ProfilerTag() noexcept {
+  if (slot_ == &currentTag) {
+    currentTag = previous_;
+  }
+}
+
+const char* ProfilerTag::current() noexcept {
+  return currentTag;
+}
+
+#ifdef __linux__
+
+namespace {
+
+constexpr size_t kMaxFrames = 64;
+// The frames of the signal handler and of the signal trampoline.
+constexpr size_t kSkippedFrames = 2;
+
+struct Sample {
+  const char* tag;
+  size_t depth;
+  uintptr_t frames[kMaxFrames];
+};
+
+struct Profile {
+  timer_t timer;
+  std::chrono::nanoseconds period;
+  std::chrono::system_clock::time_point startTime;
+  std::chrono::steady_clock::time_point start;
+  std::unique_ptr<Sample[]> samples{new Sample[SamplingProfiler::kMaxSamples]};
+  std::atomic<size_t> next{0};
+};
+
+// Read by the signal handler, which can't take locks.
+std::atomic<Profile*> activeProfile{nullptr};
+std::atomic<size_t> handlersInFlight{0};
+
+folly::Synchronized<std::unique_ptr<Profile>> runningProfile;
+
+void handleSigprof(int, siginfo_t*, void*) {
+  auto savedErrno = errno;
+  handlersInFlight.fetch_add(1, std::memory_order_seq_cst);
+  if (auto* profile = activeProfile.load(std::memory_order_seq_cst)) {
+    auto index = profile->next.fetch_add(1, std::memory_order_relaxed);
+    if (index < SamplingProfiler::kMaxSamples) {
+      auto& sample = profile->samples[index];
+      sample.tag = currentTag;
+      auto depth =
+          folly::symbolizer::getStackTraceSafe(sample.frames, kMaxFrames);
+      sample.depth = depth > 0 ? static_cast<size_t>(depth) : 0;
+    }
+  }
+  handlersInFlight.fetch_sub(1, std::memory_order_release);
+  errno = savedErrno;
+}
+
+/**
+ * The handler stays installed once profiling started, as a SIGPROF pending
+ * when the timer is deleted would otherwise kill the process.
+ */
+void installHandler() {
+  static const bool installed = [] {
+    struct sigaction action {};
+    action.sa_sigaction = handleSigprof;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    folly::checkUnixError(
+        sigaction(SIGPROF, &action, nullptr), "unable to handle SIGPROF");
+    return true;
+  }();
+  (void)installed;
+}
+
+/**
+ * Just enough of the protobuf wire format to write a pprof profile, as
+ * described by https://github.com/google/pprof/blob/main/proto/profile.proto
+ */
+class ProtoWriter {
+ public:
+  void uint64Field(uint32_t field, uint64_t value) {
+    key(field, kVarint);
+    varint(value);
+  }
+
+  void bytesField(uint32_t field, folly::StringPiece value) {
+    key(field, kLengthDelimited);
+    varint(value.size());
+    out_.append(value.data(), value.size());
+  }
+
+  void messageField(uint32_t field, const ProtoWriter& message) {
+    bytesField(field, message.out_);
+  }
+
+  void packedField(uint32_t field, const std::vector<uint64_t>& values) {
+    ProtoWriter packed;
+    for (auto value : values) {
+      packed.varint(value);
+    }
+    bytesField(field, packed.out_);
+  }
+
+  const std::string& str() const {
+    return out_;
+  }
+
+ private:
+  static constexpr uint32_t kVarint = 0;
+  static constexpr uint32_t kLengthDelimited = 2;
+
+  void key(uint32_t field, uint32_t wireType) {
+    varint((field << 3) | wireType);
+  }
+
+  void varint(uint64_t value) {
+    while (value >= 0x80) {
+      out_.push_back(static_cast<char>((value & 0x7f) | 0x80));
+      value >>= 7;
+    }
+    out_.push_back(static_cast<char>(value));
+  }
+
+  std::string out_;
+};
+
+class StringTable {
+ public:
+  StringTable() {
+    indexOf("");
+  }
+
+  uint64_t indexOf(const std::string& str) {
+    auto [it, inserted] = indices_.emplace(str, strings_.size());
+    if (inserted) {
+      strings_.push_back(str);
+    }
+    return it->second;
+  }
+
+  void write(ProtoWriter& profile) const {
+    for (const auto& str : strings_) {
+      profile.bytesField(6, str);
+    }
+  }
+
+ private:
+  folly::F14FastMap<std::string, uint64_t> indices_;
+  std::vector<std::string> strings_;
+};
+
+struct StackKey {
+  std::vector<uintptr_t> frames;
+  const char* tag;
+
+  bool operator<(const StackKey& other) const {
+    return std::tie(frames, tag) < std::tie(other.frames, other.tag);
+  }
+};
+
+ProtoWriter
+valueType(StringTable& strings, const char* type, const char* unit) {
+  ProtoWriter valueType;
+  valueType.uint64Field(1, strings.indexOf(type));
+  valueType.uint64Field(2, strings.indexOf(unit));
+  return valueType;
+}
+
+/**
+ * Symbolize the stacks of the samples and serialize them as a pprof profile,
+ * with one location per address, one function per symbol and the tags of the
+ * samples as "request" labels.
+ */
+std::string serializeProfile(const Profile& profile, size_t sampleCount) {
+  std::map<StackKey, uint64_t> stacks;
+  for (size_t i = 0; i < sampleCount; ++i) {
+    const auto& sample = profile.samples[i];
+    if (sample.depth <= kSkippedFrames) {
+      continue;
+    }
+    StackKey key{
+        {sample.frames + kSkippedFrames, sample.frames + sample.depth},
+        sample.tag};
+    // Except for the interrupted instruction, the frames are return
+    // addresses, which may belong to the next line or inlined function.
+    for (size_t frame = 1; frame < key.frames.size(); ++frame) {
+      --key.frames[frame];
+    }
+    ++stacks[std::move(key)];
+  }
+
+  folly::F14FastMap<uintptr_t, uint64_t> locationIds;
+  std::vector<uintptr_t> addresses;
+  for (const auto& [key, count] : stacks) {
+    for (auto address : key.frames) {
+      if (locationIds.emplace(address, addresses.size() + 1).second) {
+        addresses.push_back(address);
+      }
+    }
+  }
+  std::vector<folly::symbolizer::SymbolizedFrame> frames(addresses.size());
+  folly::symbolizer::Symbolizer symbolizer{
+      folly::symbolizer::LocationInfoMode::FAST};
+  symbolizer.symbolize(addresses.data(), frames.data(), addresses.size());
+
+  StringTable strings;
+  ProtoWriter out;
+  out.messageField(1, valueType(strings, "samples", "count"));
+  out.messageField(1, valueType(strings, "cpu", "nanoseconds"));
+
+  auto period = static_cast<uint64_t>(profile.period.count());
+  for (const auto& [key, count] : stacks) {
+    ProtoWriter sample;
+    std::vector<uint64_t> ids;
+    ids.reserve(key.frames.size());
+    for (auto address : key.frames) {
+      ids.push_back(locationIds[address]);
+    }
+    sample.packedField(1, ids);
+    sample.packedField(2, {count, count * period});
+    if (key.tag) {
+      ProtoWriter label;
+      label.uint64Field(1, strings.indexOf("request"));
+      label.uint64Field(2, strings.indexOf(key.tag));
+      sample.messageField(3, label);
+    }
+    out.messageField(2, sample);
+  }
+
+  folly::F14FastMap<std::string, uint64_t> functionIds;
+  std::vector<ProtoWriter> functions;
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    const auto& frame = frames[i];
+    ProtoWriter location;
+    location.uint64Field(1, i + 1);
+    location.uint64Field(3, addresses[i]);
+    if (frame.found) {
+      auto name = frame.demangledName().toStdString();
+      auto functionId = functionIds.size() + 1;
+      auto [it, inserted] = functionIds.emplace(name, functionId);
+      if (inserted) {
+        ProtoWriter function;
+        function.uint64Field(1, functionId);
+        function.uint64Field(2, strings.indexOf(name));
+        function.uint64Field(3, strings.indexOf(frame.name));
+        if (frame.location.hasFileAndLine) {
+          function.uint64Field(
+              4, strings.indexOf(frame.location.file.toString()));
+        }
+        functions.push_back(std::move(function));
+      }
+      ProtoWriter line;
+      line.uint64Field(1, it->second);
+      if (frame.location.hasFileAndLine) {
+        line.uint64Field(2, frame.location.line);
+      }
+      location.messageField(4, line);
+    }
+    out.messageField(4, location);
+  }
+  for (const auto& function : functions) {
+    out.messageField(5, function);
+  }
+
+  auto startTime = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      profile.startTime.time_since_epoch());
+  auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - profile.start);
+  out.uint64Field(9, startTime.count());
+  out.uint64Field(10, duration.count());
+  out.messageField(11, valueType(strings, "cpu", "nanoseconds"));
+  out.uint64Field(12, period);
+  strings.write(out);
+  return out.str();
+}
+
+} // namespace
+
+void SamplingProfiler::start(uint32_t frequencyHz) {
+  if (frequencyHz == 0 || frequencyHz > 1000) {
+    throw std::invalid_argument(folly::to<std::string>(
+        "profiling frequency must be between 1 and 1000 Hz, not ",
+        frequencyHz));
+  }
+  auto running = runningProfile.wlock();
+  if (*running) {
+    throw std::logic_error("a profile is already being taken");
+  }
+  installHandler();
+
+  auto profile = std::make_unique<Profile>();
+  profile->period = std::chrono::nanoseconds{std::chrono::seconds{1}} /
+      frequencyHz;
+  profile->startTime = std::chrono::system_clock::now();
+  profile->start = std::chrono::steady_clock::now();
+
+  struct sigevent event {};
+  event.sigev_notify = SIGEV_SIGNAL;
+  event.sigev_signo = SIGPROF;
+  folly::checkUnixError(
+      timer_create(CLOCK_PROCESS_CPUTIME_ID, &event, &profile->timer),
+      "unable to create the profiling timer");
+  activeProfile.store(profile.get(), std::memory_order_release);
+
+  struct itimerspec interval {};
+  interval.it_interval.tv_sec = profile->period.count() / 1000000000;
+  interval.it_interval.tv_nsec = profile->period.count() % 1000000000;
+  interval.it_value = interval.it_interval;
+  if (timer_settime(profile->timer, 0, &interval, nullptr) != 0) {
+    auto err = errno;
+    activeProfile.store(nullptr, std::memory_order_release);
+    timer_delete(profile->timer);
+    folly::throwSystemErrorExplicit(err, "unable to start the profiling timer");
+  }
+  *running = std::move(profile);
+}
+
+SamplingProfiler::Result SamplingProfiler::stop(AbsolutePathPiece outputPath) {
+  std::unique_ptr<Profile> profile;
+  {
+    auto running = runningProfile.wlock();
+    if (!*running) {
+      throw std::logic_error("no profile is being taken");
+    }
+    profile = std::move(*running);
+  }
+
+  timer_delete(profile->timer);
+  activeProfile.store(nullptr, std::memory_order_seq_cst);
+  // A handler may have loaded the profile before it was cleared.
+  while (handlersInFlight.load(std::memory_order_seq_cst) != 0) {
+    std::this_thread::yield();
+  }
+
+  auto taken = profile->next.load();
+  Result result;
+  result.samples = std::min(taken, kMaxSamples);
+  result.droppedSamples = taken - result.samples;
+  folly::writeFileAtomic(
+      outputPath.stringPiece(), serializeProfile(*profile, result.samples));
+  return result;
+}
+
+#else
+
+void SamplingProfiler::start(uint32_t) {
+  throw std::runtime_error("CPU profiling is only supported on Linux");
+}
+
+SamplingProfiler::Result SamplingProfiler::stop(AbsolutePathPiece) {
+  throw std::logic_error("no profile is being taken");
+}
+
+#endif // __linux__
+
+} // namespace facebook::eden
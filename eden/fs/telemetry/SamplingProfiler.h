@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include "eden/fs/utils/PathFuncs.h"
+
+namespace facebook::eden {
+
+/**
+ * Tags the CPU samples taken on the current thread with a description of
+ * what it is doing, such as the FUSE opcode or thrift method it is serving,
+ * until destroyed.
+ *
+ * The tag must be a string with static storage duration, as it is read from
+ * the signal handler of the profiler. Work continued on another thread by a
+ * future isn't tagged, and if the ProfilerTag is destroyed on another thread,
+ * the tag of its thread is left until replaced.
+ */
+class ProfilerTag {
+ public:
+  explicit ProfilerTag(const char* tag) noexcept;
+  ~ProfilerTag() noexcept;
+
+  ProfilerTag(ProfilerTag&& other) noexcept;
+  ProfilerTag& operator=(ProfilerTag&&) = delete;
+
+  /**
+   * The tag of the current thread, or nullptr if it isn't tagged.
+   */
+  static const char* current() noexcept;
+
+ private:
+  // The tag of the thread this was created on, or nullptr if moved from.
+  const char** slot_;
+  const char* previous_;
+};
+
+/**
+ * An in-process CPU profiler: while running, it samples the stack of the
+ * thread using the CPU at the given frequency of CPU time, with its
+ * ProfilerTag, and writes them as a pprof profile when stopped. The stacks
+ * are only symbolized when stopping.
+ *
+ * Only one profile can be taken at a time in the process, and only Linux is
+ * supported.
+ */
+class SamplingProfiler {
+ public:
+  static constexpr uint32_t kDefaultFrequencyHz = 99;
+  /**
+   * The samples beyond this are dropped, to bound the memory used.
+   */
+  static constexpr size_t kMaxSamples = 1 << 15;
+
+  struct Result {
+    size_t samples{0};
+    size_t droppedSamples{0};
+  };
+
+  /**
+   * Start sampling. Throws if a profile is already being taken, or if
+   * profiling isn't supported.
+   */
+  static void start(uint32_t frequencyHz = kDefaultFrequencyHz);
+
+  /**
+   * Stop sampling and write the profile to outputPath. Throws if no profile
+   * is being taken.
+   */
+  static Result stop(AbsolutePathPiece outputPath);
+};
+
+} // namespace facebook::eden
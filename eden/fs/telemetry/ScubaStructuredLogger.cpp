@@ -9,6 +9,8 @@
 
 #include <folly/json.h>
 #include <folly/logging/xlog.h>
+#include <folly/system/ThreadName.h>
+#include <utility>
 #include "eden/fs/config/EdenConfig.h"
 #include "eden/fs/telemetry/SubprocessScribeLogger.h"
 
@@ -26,15 +28,7 @@ folly::dynamic dynamicMap(const std::unordered_map<Key, Value>& map) {
   return o;
 }
 
-} // namespace
-
-ScubaStructuredLogger::ScubaStructuredLogger(
-    std::shared_ptr<ScribeLogger> scribeLogger,
-    SessionInfo sessionInfo)
-    : StructuredLogger{true, std::move(sessionInfo)},
-      scribeLogger_{std::move(scribeLogger)} {}
-
-void ScubaStructuredLogger::logDynamicEvent(DynamicEvent event) {
+std::string serialize(const DynamicEvent& event) {
   folly::dynamic document = folly::dynamic::object;
 
   const auto& intMap = event.getIntMap();
@@ -52,7 +46,99 @@ void ScubaStructuredLogger::logDynamicEvent(DynamicEvent event) {
     document["double"] = dynamicMap(doubleMap);
   }
 
-  scribeLogger_->log(folly::toJson(document));
+  return folly::toJson(document);
+}
+
+} // namespace
+
+ScubaStructuredLogger::ScubaStructuredLogger(
+    std::shared_ptr<ScribeLogger> scribeLogger,
+    SessionInfo sessionInfo,
+    size_t queueCapacity)
+    : StructuredLogger{true, std::move(sessionInfo)},
+      scribeLogger_{std::move(scribeLogger)},
+      queueCapacity_{queueCapacity} {
+  writerThread_ = std::thread([this] {
+    folly::setThreadName("StructuredLoggerWriter");
+    writerThread();
+  });
+}
+
+ScubaStructuredLogger::~ScubaStructuredLogger() {
+  state_.lock()->shouldStop = true;
+  newEventOrStop_.notify_one();
+  writerThread_.join();
+}
+
+void ScubaStructuredLogger::flush() {
+  auto state = state_.lock();
+  auto queuedCount = state->queuedCount;
+  eventsWritten_.wait(
+      state.as_lock(), [&] { return state->writtenCount >= queuedCount; });
+}
+
+void ScubaStructuredLogger::logDynamicEvent(DynamicEvent event) {
+  bool wakeWriter;
+  {
+    auto state = state_.lock();
+    if (state->events.size() >= queueCapacity_) {
+      droppedEvents_.fetch_add(1, std::memory_order_relaxed);
+      XLOG_EVERY_MS(DBG7, 10000)
+          << "StructuredLogger queue full, dropping event";
+      return;
+    }
+    state->events.push_back(std::move(event));
+    ++state->queuedCount;
+    // The writer only waits once it has taken all the events, so it only
+    // needs waking up for the first one.
+    wakeWriter = std::exchange(state->writerWaiting, false);
+  }
+  if (wakeWriter) {
+    newEventOrStop_.notify_one();
+  }
+}
+
+void ScubaStructuredLogger::writerThread() {
+  std::vector<DynamicEvent> events;
+  std::vector<std::string> messages;
+
+  for (;;) {
+    events.clear();
+    messages.clear();
+
+    bool shouldStop;
+    {
+      auto state = state_.lock();
+      state->writerWaiting = true;
+      newEventOrStop_.wait(state.as_lock(), [&] {
+        return state->shouldStop || !state->events.empty();
+      });
+      state->writerWaiting = false;
+      events.swap(state->events);
+      shouldStop = state->shouldStop;
+    }
+
+    // Serialize the whole batch outside of the lock, and hand it over at
+    // once.
+    messages.reserve(events.size());
+    for (const auto& event : events) {
+      messages.push_back(serialize(event));
+    }
+    if (!messages.empty()) {
+      scribeLogger_->logBatch(std::move(messages));
+    }
+
+    {
+      auto state = state_.lock();
+      state->writtenCount += events.size();
+    }
+    eventsWritten_.notify_all();
+
+    if (shouldStop) {
+      // Events cannot be logged during destruction, so the queue is empty.
+      return;
+    }
+  }
 }
 
 } // namespace eden
@@ -7,7 +7,13 @@
 
 #pragma once
 
+#include <folly/Synchronized.h>
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include "eden/fs/telemetry/StructuredLogger.h"
 
 namespace facebook {
@@ -16,16 +22,63 @@ namespace eden {
 class EdenConfig;
 class ScribeLogger;
 
+/**
+ * Serializes events to JSON and forwards them to a ScribeLogger.
+ *
+ * Logging an event only queues it: a background thread takes all the queued
+ * events at once, serializes them and hands them to the ScribeLogger in one
+ * batch. The queue is bounded, and the events logged while it is full are
+ * dropped and counted, so that a slow logger never stalls the threads
+ * logging, such as the FUSE ones.
+ */
 class ScubaStructuredLogger final : public StructuredLogger {
  public:
+  static constexpr size_t kDefaultQueueCapacity = 4096;
+
   ScubaStructuredLogger(
       std::shared_ptr<ScribeLogger> scribeLogger,
-      SessionInfo sessionInfo);
+      SessionInfo sessionInfo,
+      size_t queueCapacity = kDefaultQueueCapacity);
+
+  /**
+   * Forwards the events still queued before returning.
+   */
+  ~ScubaStructuredLogger() override;
+
+  /**
+   * Wait until the events logged so far have been handed to the ScribeLogger
+   * or dropped.
+   */
+  void flush();
+
+  /**
+   * The number of events dropped because the queue was full.
+   */
+  uint64_t getDroppedEventCount() const {
+    return droppedEvents_.load(std::memory_order_relaxed);
+  }
 
  private:
+  struct State {
+    bool shouldStop = false;
+    bool writerWaiting = false;
+    std::vector<DynamicEvent> events;
+    /// The number of events queued, and the number of those already written.
+    uint64_t queuedCount = 0;
+    uint64_t writtenCount = 0;
+  };
+
   void logDynamicEvent(DynamicEvent event) override;
+  void writerThread();
 
   std::shared_ptr<ScribeLogger> scribeLogger_;
+  const size_t queueCapacity_;
+  std::atomic<uint64_t> droppedEvents_{0};
+
+  folly::Synchronized<State, std::mutex> state_;
+  std::condition_variable newEventOrStop_;
+  std::condition_variable eventsWritten_;
+  std::thread writerThread_;
 };
 
 } // namespace eden
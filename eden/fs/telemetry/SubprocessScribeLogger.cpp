@@ -9,6 +9,7 @@
 
 #include <folly/logging/xlog.h>
 #include <folly/system/ThreadName.h>
+#include <algorithm>
 
 namespace {
 /**
@@ -88,33 +89,79 @@ void SubprocessScribeLogger::closeProcess() {
   process_.waitOrTerminateOrKill(kProcessExitTimeout, kProcessTerminateTimeout);
 }
 
-void SubprocessScribeLogger::log(std::string message) {
+bool SubprocessScribeLogger::enqueue(State& state, std::string& message) {
   size_t messageSize = message.size();
+  if (state.totalBytes + messageSize > kQueueLimitBytes) {
+    XLOG_EVERY_MS(DBG7, 10000) << "ScribeLogger queue full, dropping message";
+    // queue full, dropping!
+    droppedMessages_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  // This order is important in order to be atomic under std::bad_alloc.
+  state.messages.emplace_back(std::move(message));
+  state.totalBytes += messageSize;
+  return true;
+}
 
+void SubprocessScribeLogger::log(std::string message) {
   {
     auto state = state_.lock();
     XCHECK(!state->shouldStop) << "log() called during destruction - that's UB";
-    if (state->didStop) {
+    if (state->didStop || !enqueue(*state, message)) {
       return;
     }
-    if (state->totalBytes + messageSize > kQueueLimitBytes) {
-      XLOG_EVERY_MS(DBG7, 10000) << "ScribeLogger queue full, dropping message";
-      // queue full, dropping!
+  }
+  newMessageOrStop_.notify_one();
+}
+
+void SubprocessScribeLogger::logBatch(std::vector<std::string> messages) {
+  bool queued = false;
+  {
+    auto state = state_.lock();
+    XCHECK(!state->shouldStop)
+        << "logBatch() called during destruction - that's UB";
+    if (state->didStop) {
       return;
     }
+    for (auto& message : messages) {
+      queued |= enqueue(*state, message);
+    }
+  }
+  if (queued) {
+    newMessageOrStop_.notify_one();
+  }
+}
 
-    // This order is important in order to be atomic under std::bad_alloc.
-    state->messages.emplace_back(std::move(message));
-    state->totalBytes += messageSize;
+bool SubprocessScribeLogger::writeMessages(
+    const FileDescriptor& fd,
+    std::vector<std::string>& messages) {
+  // Two iovecs per message, staying well under IOV_MAX.
+  constexpr size_t kMessagesPerWrite = 256;
+  char newline = '\n';
+  std::vector<iovec> iov;
+  iov.reserve(2 * std::min(messages.size(), kMessagesPerWrite));
+  for (size_t start = 0; start < messages.size();
+       start += kMessagesPerWrite) {
+    iov.clear();
+    auto end = std::min(messages.size(), start + kMessagesPerWrite);
+    for (size_t i = start; i < end; ++i) {
+      iov.push_back({messages[i].data(), messages[i].size()});
+      iov.push_back({&newline, sizeof(newline)});
+    }
+    if (fd.writevFull(iov.data(), iov.size()).hasException()) {
+      return false;
+    }
   }
-  newMessageOrStop_.notify_one();
+  return true;
 }
 
 void SubprocessScribeLogger::writerThread() {
   auto fd = process_.stdinFd();
+  std::vector<std::string> messages;
 
   for (;;) {
-    std::string message;
+    messages.clear();
 
     {
       auto state = state_.lock();
@@ -122,13 +169,9 @@ void SubprocessScribeLogger::writerThread() {
         return state->shouldStop || !state->messages.empty();
       });
       if (!state->messages.empty()) {
-        XCHECK_LE(state->messages.front().size(), state->totalBytes)
-            << "totalSize accounting fell out of sync!";
-
         // The below statements are all noexcept.
-        std::swap(message, state->messages.front());
-        state->messages.pop_front();
-        state->totalBytes -= message.size();
+        messages.swap(state->messages);
+        state->totalBytes = 0;
       } else {
         // If the predicate succeeded but we have no messages, then we're
         // shutting down cleanly.
@@ -142,13 +185,7 @@ void SubprocessScribeLogger::writerThread() {
       }
     }
 
-    char newline = '\n';
-    std::array<iovec, 2> iov;
-    iov[0].iov_base = message.data();
-    iov[0].iov_len = message.size();
-    iov[1].iov_base = &newline;
-    iov[1].iov_len = sizeof(newline);
-    if (fd.writevFull(iov.data(), iov.size()).hasException()) {
+    if (!writeMessages(fd, messages)) {
       // TODO: We could attempt to restart the process here.
       XLOG(ERR) << "Failed to writev to logger process stdin: "
                 << folly::errnoStr(errno) << ". Giving up!";
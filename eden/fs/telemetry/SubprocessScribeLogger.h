@@ -8,7 +8,8 @@
 #pragma once
 
 #include <folly/Synchronized.h>
-#include <list>
+#include <atomic>
+#include <vector>
 #include "eden/fs/telemetry/ScribeLogger.h"
 #include "eden/fs/utils/SpawnedProcess.h"
 
@@ -18,6 +19,9 @@ namespace eden {
 /**
  * SubprocessScribeLogger manages an external unix process and asynchronously
  * forwards newline-delimited messages to its stdin.
+ *
+ * The writer thread takes all the queued messages at once and writes them
+ * with as few writev calls as possible.
  */
 class SubprocessScribeLogger : public ScribeLogger {
  public:
@@ -51,10 +55,31 @@ class SubprocessScribeLogger : public ScribeLogger {
   void log(std::string message) override;
   using ScribeLogger::log;
 
+  /**
+   * Forwards several messages, queuing them under a single lock.
+   */
+  void logBatch(std::vector<std::string> messages) override;
+
+  /**
+   * The number of messages dropped because the writer process was not
+   * keeping up.
+   */
+  uint64_t getDroppedMessageCount() const {
+    return droppedMessages_.load(std::memory_order_relaxed);
+  }
+
  private:
   void closeProcess();
   void writerThread();
 
+  /**
+   * Write the messages, each followed by a newline. Returns false if the
+   * process stdin could not be written to.
+   */
+  bool writeMessages(
+      const FileDescriptor& fd,
+      std::vector<std::string>& messages);
+
   struct State {
     bool shouldStop = false;
     bool didStop = false;
@@ -62,12 +87,19 @@ class SubprocessScribeLogger : public ScribeLogger {
     /// Sum of sizes of queued messages.
     size_t totalBytes = 0;
     /// Invariant: empty if didStop is true
-    std::list<std::string> messages;
+    std::vector<std::string> messages;
   };
 
+  /**
+   * Queue the message unless the queue is full. Returns whether it was
+   * queued.
+   */
+  bool enqueue(State& state, std::string& message);
+
   SpawnedProcess process_;
   std::thread writerThread_;
 
+  std::atomic<uint64_t> droppedMessages_{0};
   folly::Synchronized<State, std::mutex> state_;
   std::condition_variable newMessageOrStop_;
   std::condition_variable allMessagesWritten_;
@@ -7,27 +7,31 @@
 
 #include <folly/logging/xlog.h>
 #include <folly/system/ThreadName.h>
+#include <algorithm>
+#include <iterator>
 
 namespace facebook::eden {
 
 template <typename TraceEvent>
 std::shared_ptr<TraceBus<TraceEvent>> TraceBus<TraceEvent>::create(
     std::string name,
-    size_t bufferCapacity) {
+    size_t bufferCapacity,
+    TraceBusOverflowPolicy overflowPolicy) {
   return std::make_shared<TraceBus<TraceEvent>>(
-      PrivateConstructorTag{}, std::move(name), bufferCapacity);
+      PrivateConstructorTag{}, std::move(name), bufferCapacity, overflowPolicy);
 }
 
 template <typename TraceEvent>
 TraceBus<TraceEvent>::TraceBus(
     PrivateConstructorTag,
     std::string name,
-    size_t bufferCapacity)
-    : name_{std::move(name)}, bufferCapacity_{bufferCapacity} {
+    size_t bufferCapacity,
+    TraceBusOverflowPolicy overflowPolicy)
+    : name_{std::move(name)},
+      bufferCapacity_{bufferCapacity},
+      overflowPolicy_{overflowPolicy} {
   XCHECK_GT(bufferCapacity_, 0u) << "Buffer capacity must not be zero";
 
-  state_.unsafeGetUnlocked().writeBuffer.reserve(bufferCapacity_);
-
   // Allocate the backbuffer here rather than in the thread so std::bad_alloc
   // can be caught.
   std::vector<TraceEvent> readBuffer;
@@ -45,8 +49,8 @@ TraceBus<TraceEvent>::TraceBus(
 
 template <typename TraceEvent>
 TraceBus<TraceEvent>::~TraceBus() {
-  state_.lock()->done = true;
-  emptyCV_.notify_one();
+  done_.store(true, std::memory_order_release);
+  publishedEvent_.notifyAll();
   thread_.join();
 
   auto& state = state_.unsafeGetUnlocked();
@@ -67,27 +71,53 @@ void TraceBus<TraceEvent>::publish(const TraceEvent& event) noexcept {
 template <typename TraceEvent>
 void TraceBus<TraceEvent>::publish(TraceEvent&& event) noexcept {
   static_assert(std::is_nothrow_move_constructible_v<TraceEvent>);
+  XCHECK(!done_.load(std::memory_order_relaxed))
+      << "Illegal to publish concurrently with destruction";
+
+  auto& ring = getThreadRing();
+  if (ring.queue.isFull()) {
+    if (overflowPolicy_ == TraceBusOverflowPolicy::Drop) {
+      // Only this thread writes the counter. Dropped events take no sequence
+      // number, so that the background thread never waits for them.
+      ring.droppedEvents.store(
+          ring.droppedEvents.load(std::memory_order_relaxed) + 1,
+          std::memory_order_relaxed);
+      publishedEvent_.notify();
+      return;
+    }
 
-  bool wake;
-  {
-    auto state = state_.lock();
-    XCHECK(!state->done) << "Illegal to publish concurrently with destruction";
-    if (state->writeBuffer.size() == bufferCapacity_) {
-      // If the buffer is full then the capacity is potentially set too low. Log
-      // an appropriate warning and then block until we have room to append the
-      // current event.
-      logFullOnce();
-      fullCV_.wait(state.as_lock(), [&] {
-        return state->writeBuffer.size() < bufferCapacity_;
-      });
+    // If the ring is full then the capacity is potentially set too low. Log an
+    // appropriate warning and then block until we have room to append the
+    // current event.
+    logFullOnce();
+    publishedEvent_.notify();
+    while (true) {
+      auto key = freedSpace_.prepareWait();
+      if (!ring.queue.isFull()) {
+        freedSpace_.cancelWait();
+        break;
+      }
+      freedSpace_.wait(key);
     }
-    wake = state->writeBuffer.empty();
-    state->writeBuffer.push_back(std::move(event));
-    state->sequenceNumber++;
   }
-  if (wake) {
-    emptyCV_.notify_one();
+
+  // Number the event only once there is room for it: the background thread
+  // stops at the number until the event is written, so the write must follow
+  // right after. It can't fail, as only this thread writes to the ring and the
+  // background thread only ever makes room.
+  auto sequence = publishedSequence_.fetch_add(1, std::memory_order_relaxed);
+  XCHECK(ring.queue.write(sequence, std::move(event)));
+  publishedEvent_.notify();
+}
+
+template <typename TraceEvent>
+typename TraceBus<TraceEvent>::Ring& TraceBus<TraceEvent>::getThreadRing() {
+  auto& ring = *threadRing_;
+  if (!ring) {
+    ring = std::make_shared<Ring>(bufferCapacity_);
+    state_.lock()->newRings.push_back(ring);
   }
+  return *ring;
 }
 
 template <typename TraceEvent>
@@ -108,7 +138,7 @@ void TraceBus<TraceEvent>::unsubscribe(void* subscription) noexcept {
 
   auto state = state_.lock();
   // Signal to threadLoop that `sub` should be deleted.
-  sub->unsubscribe = state->sequenceNumber;
+  sub->unsubscribe = true;
 
   // At this point, the memory referenced by `sub` must not be accessed as it
   // may be deleted at any moment.
@@ -134,14 +164,75 @@ void TraceBus<TraceEvent>::logFullOnce() noexcept {
   });
 }
 
+template <typename TraceEvent>
+typename TraceBus<TraceEvent>::Ring* TraceBus<TraceEvent>::findNextRing(
+    const std::vector<std::shared_ptr<Ring>>& rings) const noexcept {
+  for (const auto& ring : rings) {
+    auto* front = ring->queue.frontPtr();
+    if (front && front->sequence == observedSequence_) {
+      return ring.get();
+    }
+  }
+  return nullptr;
+}
+
+template <typename TraceEvent>
+bool TraceBus<TraceEvent>::drainRings(
+    std::vector<std::shared_ptr<Ring>>& rings,
+    std::vector<TraceEvent>& readBuffer,
+    uint64_t& droppedEvents) noexcept {
+  for (auto& ring : rings) {
+    auto dropped = ring->droppedEvents.load(std::memory_order_relaxed);
+    droppedEvents += dropped - ring->observedDroppedEvents;
+    ring->observedDroppedEvents = dropped;
+  }
+
+  // Each ring is ordered, so this is a merge of the rings by sequence number.
+  // A thread usually publishes several events in a row, so keep taking from
+  // the same ring while it holds the next one before searching the others.
+  Ring* ring = nullptr;
+  while (readBuffer.size() < bufferCapacity_) {
+    auto* front = ring ? ring->queue.frontPtr() : nullptr;
+    if (!front || front->sequence != observedSequence_) {
+      ring = findNextRing(rings);
+      if (!ring) {
+        break;
+      }
+      front = ring->queue.frontPtr();
+    }
+    readBuffer.push_back(std::move(front->event));
+    ring->queue.popFront();
+    ++observedSequence_;
+  }
+  bool remaining = findNextRing(rings) != nullptr;
+
+  // Forget the rings whose thread has exited once they are drained. The fence
+  // orders the exited thread's last writes before the emptiness check.
+  rings.erase(
+      std::remove_if(
+          rings.begin(),
+          rings.end(),
+          [](const std::shared_ptr<Ring>& ring) {
+            if (ring.use_count() != 1) {
+              return false;
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return ring->queue.isEmpty() &&
+                ring->droppedEvents.load(std::memory_order_relaxed) ==
+                ring->observedDroppedEvents;
+          }),
+      rings.end());
+  return remaining;
+}
+
 template <typename TraceEvent>
 void TraceBus<TraceEvent>::threadLoop(
     std::vector<TraceEvent>& readBuffer) noexcept {
-  // This function does no allocation and throws no exceptions.
+  // This function throws no exceptions. It only allocates to track the rings
+  // of new publishing threads.
 
-  bool done = false;
-  uint64_t lastObservedSequenceNumber = 0;
-  while (!done) {
+  std::vector<std::shared_ptr<Ring>> rings;
+  while (true) {
     XCHECK(readBuffer.empty())
         << "Avoid waiting while holding references to things";
 
@@ -149,7 +240,6 @@ void TraceBus<TraceEvent>::threadLoop(
     {
       auto state = state_.lock();
 
-      // Deallocate before we wait.
       // While the lock is held, delete all unsubscribed subscriptions.
       // plink is pointer to current node pointer.
       // nlink is pointer to next node pointer.
@@ -159,49 +249,59 @@ void TraceBus<TraceEvent>::threadLoop(
       while (p) {
         Subscription** nlink = &p->next;
         Subscription* next = *nlink;
-        if (p->unsubscribe && p->unsubscribe <= lastObservedSequenceNumber) {
-          // Here, we know this subscription has seen events up to (and possibly
-          // beyond) its unsubscription request, so unlink it.
+        if (p->drained) {
+          // Here, we know this subscription has seen every event published
+          // before (and possibly after) its unsubscription request, so unlink
+          // it.
           *plink = *nlink;
           delete p;
         } else {
           // Otherwise, if the subscription has requested unsubscription, then
-          // it needs to make one more iteration through the loop and will be
-          // deleted after.
+          // it is given the events left in the rings and will be deleted
+          // after.
+          p->unsubscribing = p->unsubscribe;
           plink = nlink;
         }
         p = next;
       }
 
-      // TODO: If it were safe to access Subscription::unsubscribe when the lock
-      // weren't held, it would be possible to check the unsubscribe sequence
-      // number in the event iteration loop below and short-circuit observation
-      // of events published after unsubscription.
-      //
-      // This probably isn't important.
-      lastObservedSequenceNumber = state->sequenceNumber;
-
-      // If no events are buffered, sleep until events are delivered or we are
-      // signaled to terminate.
-      emptyCV_.wait(state.as_lock(), [&] {
-        return state->done || !state->writeBuffer.empty();
-      });
-      std::swap(state->writeBuffer, readBuffer);
-      done = state->done;
+      rings.insert(
+          rings.end(),
+          std::make_move_iterator(state->newRings.begin()),
+          std::make_move_iterator(state->newRings.end()));
+      state->newRings.clear();
 
       head = state->subscriptions;
     }
 
-    // If the publish buffer filled, it's possible a publisher is waiting for
-    // space, so wake them.
-    if (readBuffer.size() == bufferCapacity_) {
-      fullCV_.notify_all();
+    // Read done_ before draining, so that the events published before
+    // destruction are all delivered.
+    bool done = done_.load(std::memory_order_acquire);
+    uint64_t droppedEvents = 0;
+    bool remaining = drainRings(rings, readBuffer, droppedEvents);
+
+    if (!readBuffer.empty()) {
+      // A publisher may be waiting for space, so wake them.
+      freedSpace_.notifyAll();
+    }
+    if (droppedEvents) {
+      droppedEvents_.fetch_add(droppedEvents, std::memory_order_relaxed);
     }
 
     for (auto* sub = head; sub; sub = sub->next) {
+      if (!remaining && sub->unsubscribing) {
+        sub->drained = true;
+      }
       if (sub->hasThrownException) {
         continue;
       }
+      if (droppedEvents) {
+        sub->subscriber->droppedEvents_.fetch_add(
+            droppedEvents, std::memory_order_relaxed);
+      }
+      if (readBuffer.empty()) {
+        continue;
+      }
       const TraceEvent* begin = readBuffer.data();
       const TraceEvent* end = begin + readBuffer.size();
       try {
@@ -213,7 +313,25 @@ void TraceBus<TraceEvent>::threadLoop(
       }
     }
 
+    bool delivered = !readBuffer.empty();
     readBuffer.clear();
+    if (delivered || remaining) {
+      continue;
+    }
+    if (done) {
+      break;
+    }
+
+    // If no events are buffered, sleep until events are published or we are
+    // signaled to terminate.
+    auto key = publishedEvent_.prepareWait();
+    bool pending = done_.load(std::memory_order_acquire) ||
+        !state_.lock()->newRings.empty() || findNextRing(rings) != nullptr;
+    if (pending) {
+      publishedEvent_.cancelWait();
+    } else {
+      publishedEvent_.wait(key);
+    }
   }
 }
 
@@ -7,13 +7,18 @@
 
 #pragma once
 
+#include <folly/ProducerConsumerQueue.h>
 #include <folly/Synchronized.h>
+#include <folly/ThreadLocal.h>
+#include <folly/experimental/EventCount.h>
 #include <folly/synchronization/CallOnce.h>
 #include <stdint.h>
+#include <atomic>
 #include <chrono>
 #include <memory>
 #include <thread>
 #include <utility>
+#include <vector>
 
 namespace facebook::eden {
 
@@ -31,6 +36,17 @@ struct TraceEventBase {
 template <typename TraceEvent>
 class TraceBus;
 
+/**
+ * What publish() does when the buffer of the publishing thread is full.
+ */
+enum class TraceBusOverflowPolicy {
+  // Wait for the background thread to make room, so that no event is lost.
+  // Required when a subscriber tracks state across events.
+  Block,
+  // Drop the event, counting it against every subscriber.
+  Drop,
+};
+
 /**
  * Base class for subscribers.
  */
@@ -56,8 +72,20 @@ class TraceEventSubscriber {
    */
   virtual void observeBatch(const TraceEvent* begin, const TraceEvent* end) = 0;
 
+  /**
+   * The number of events dropped by a TraceBus with the Drop policy while
+   * this subscriber was subscribed, which it will never observe.
+   */
+  uint64_t getDroppedEventCount() const noexcept {
+    return droppedEvents_.load(std::memory_order_relaxed);
+  }
+
  private:
   const std::string name_;
+  // Only written by the background thread of the TraceBus.
+  std::atomic<uint64_t> droppedEvents_{0};
+
+  friend TraceBus<TraceEvent>;
 };
 
 /**
@@ -137,13 +165,22 @@ class TraceSubscriptionHandle {
 };
 
 /**
- * TraceBus is a reliable, fixed-capacity event trace that runs subscription
- * callbacks on a background thread. It is intended for lightweight telemetry
- * computation: if the subscriptions perform heavy computation and events are
- * submitted more frequently than they're processed, publish() will block.
+ * TraceBus is a fixed-capacity event trace that runs subscription callbacks on
+ * a background thread. It is intended for lightweight telemetry computation:
+ * if the subscriptions perform heavy computation and events are submitted more
+ * frequently than they're processed, publish() will block, or drop events with
+ * the Drop policy.
+ *
+ * Each publishing thread has its own single-producer single-consumer ring, and
+ * the background thread drains all the rings in batches. Every event is
+ * numbered from a bus-wide sequence as it is written to its ring, and the rings
+ * are merged in that order, so that an event published after another one, on
+ * any thread, is always observed after it. Subscribers such as the FUSE
+ * request tracker rely on this to see a request's start before its finish.
  *
- * The capacity should be selected based on the expected usage in context.
- * Memory usage will be capacity * sizeof(TraceEvent) * 2, but a capacity too
+ * The capacity is that of each thread's ring, and should be selected based on
+ * the expected usage in context. Memory usage will be about capacity *
+ * sizeof(TraceEvent) per publishing thread, plus one batch, but a capacity too
  * small will block publishers. The buffer is not intended to prevent all
  * publishers from blocking, but to absorb latency in the case that subscribers
  * briefly cannot keep up.
@@ -168,7 +205,8 @@ class TraceBus : public std::enable_shared_from_this<TraceBus<TraceEvent>> {
    */
   static std::shared_ptr<TraceBus> create(
       std::string name,
-      size_t bufferCapacity);
+      size_t bufferCapacity,
+      TraceBusOverflowPolicy overflowPolicy = TraceBusOverflowPolicy::Block);
 
   /**
    * Use `create` instead. TraceBus must be managed by shared_ptr.
@@ -176,7 +214,8 @@ class TraceBus : public std::enable_shared_from_this<TraceBus<TraceEvent>> {
   TraceBus(
       PrivateConstructorTag,
       std::string threadName,
-      size_t bufferCapacity);
+      size_t bufferCapacity,
+      TraceBusOverflowPolicy overflowPolicy);
 
   /**
    * Blocks until all published events have been observed by all registered
@@ -187,6 +226,8 @@ class TraceBus : public std::enable_shared_from_this<TraceBus<TraceEvent>> {
   /**
    * Publishes an event into the trace queue. The copy constructor must not
    * throw.
+   *
+   * The first event published by a thread allocates its ring.
    */
   void publish(const TraceEvent& event) noexcept;
 
@@ -196,6 +237,14 @@ class TraceBus : public std::enable_shared_from_this<TraceBus<TraceEvent>> {
    */
   void publish(TraceEvent&& event) noexcept;
 
+  /**
+   * The number of events dropped so far, as observed by the background
+   * thread.
+   */
+  uint64_t getDroppedEventCount() const noexcept {
+    return droppedEvents_.load(std::memory_order_relaxed);
+  }
+
   /**
    * Subscribe to published events. If the subscriber throws, it will
    * automatically be unsubscribed.
@@ -241,16 +290,74 @@ class TraceBus : public std::enable_shared_from_this<TraceBus<TraceEvent>> {
 
   void threadLoop(std::vector<TraceEvent>& readbuffer) noexcept;
 
+  /**
+   * An event and its position in the bus-wide order of publication.
+   */
+  struct SequencedEvent {
+    SequencedEvent(uint64_t sequence, TraceEvent&& event) noexcept
+        : sequence{sequence}, event{std::move(event)} {}
+
+    uint64_t sequence;
+    TraceEvent event;
+  };
+
+  /**
+   * The ring of one publishing thread. It is shared by the thread and by the
+   * background thread, which forgets it once the publishing thread has exited
+   * and the ring is drained.
+   */
+  struct Ring {
+    explicit Ring(size_t capacity)
+        : queue{static_cast<uint32_t>(capacity + 1)} {}
+
+    folly::ProducerConsumerQueue<SequencedEvent> queue;
+    // Only written by the publishing thread.
+    std::atomic<uint64_t> droppedEvents{0};
+    // Accessed only on background thread.
+    uint64_t observedDroppedEvents = 0;
+  };
+
+  Ring& getThreadRing();
+
+  /**
+   * Move the events of the rings into readBuffer in sequence order, up to
+   * bufferCapacity_ of them, add the events dropped since the last call to
+   * droppedEvents, and return whether the next event in sequence is ready in
+   * the rings.
+   *
+   * Draining stops at a gap in the sequence: the event filling it has been
+   * numbered by a publisher that has not written it to its ring yet, and
+   * will notify publishedEvent_ once it has.
+   */
+  bool drainRings(
+      std::vector<std::shared_ptr<Ring>>& rings,
+      std::vector<TraceEvent>& readBuffer,
+      uint64_t& droppedEvents) noexcept;
+
+  /**
+   * The ring whose oldest event is the next one in sequence, if any.
+   */
+  Ring* findNextRing(const std::vector<std::shared_ptr<Ring>>& rings) const
+      noexcept;
+
   struct Subscription {
     const std::shared_ptr<Subscriber> subscriber;
 
     // Accessed only on background thread. Set if the subscriber throws.
     bool hasThrownException = false;
 
-    // If nonzero, unsubscription has been requested after the corresponding
-    // sequenceNumber events have been observed. Only written or read while the
-    // lock is held.
-    uint64_t unsubscribe = 0;
+    // Set when unsubscription has been requested. Only written or read while
+    // the lock is held.
+    bool unsubscribe = false;
+
+    // Accessed only on background thread. A copy of unsubscribe taken while
+    // the lock is held.
+    bool unsubscribing = false;
+
+    // Accessed only on background thread. Set once the subscription has been
+    // given the events published before its unsubscription, after which it
+    // is deleted.
+    bool drained = false;
 
     // Subscriptions form a linked list. Subscriptions insert to the head of the
     // list, and only while the lock is held. `threadLoop` is responsible for
@@ -261,22 +368,29 @@ class TraceBus : public std::enable_shared_from_this<TraceBus<TraceEvent>> {
   };
 
   struct State {
-    bool done = false;
     Subscription* subscriptions = nullptr;
-    std::vector<TraceEvent> writeBuffer;
-    // Incremented every publish()
-    uint64_t sequenceNumber = 1;
+    // The rings created since the background thread last took them.
+    std::vector<std::shared_ptr<Ring>> newRings;
   };
 
   const std::string name_;
   const size_t bufferCapacity_;
+  const TraceBusOverflowPolicy overflowPolicy_;
 
   folly::Synchronized<State, std::mutex> state_;
-  // Encodes the condition done || !writeBuffer.empty()
-  std::condition_variable emptyCV_;
-  // Encodes the condition writeBuffer.size() < bufferCapacity_
-  std::condition_variable fullCV_;
+  std::atomic<bool> done_{false};
+  std::atomic<uint64_t> droppedEvents_{0};
+  // The sequence number of the next event written to a ring.
+  std::atomic<uint64_t> publishedSequence_{0};
+  // Accessed only on background thread. The sequence number of the next event
+  // to observe.
+  uint64_t observedSequence_ = 0;
+  // Notified when an event is published, or done_ is set.
+  folly::EventCount publishedEvent_;
+  // Notified when the background thread has made room in the rings.
+  folly::EventCount freedSpace_;
   folly::once_flag logIfFullFlag_;
+  folly::ThreadLocal<std::shared_ptr<Ring>> threadRing_;
   std::thread thread_;
 
   // For unsubscribe.
@@ -7,11 +7,23 @@
 
 #include "Tracing.h"
 
+#include <folly/Conv.h>
+#include <folly/system/ThreadId.h>
+#include <folly/system/ThreadName.h>
+
 namespace facebook {
 namespace eden {
 namespace detail {
 Tracer globalTracer;
 
+ThreadLocalTracePoints::ThreadLocalTracePoints()
+    : threadId_{static_cast<uint32_t>(folly::getOSThreadID())} {
+  auto name = folly::getCurrentThreadName();
+  globalTracer.threadNames_.wlock()->insert_or_assign(
+      threadId_,
+      name ? std::move(*name) : folly::to<std::string>("thread ", threadId_));
+}
+
 void ThreadLocalTracePoints::flush() {
   auto points = globalTracer.tracepoints_.wlock();
   auto state = state_.lock();
@@ -8,8 +8,10 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
 
 #include <folly/ClockGettimeWrappers.h>
+#include <folly/container/F14Map.h>
 #include <folly/Singleton.h>
 #include <folly/SpinLock.h>
 #include <folly/ThreadLocal.h>
@@ -39,6 +41,8 @@ struct CompactTracePoint {
   // The name of the block, only set on the tracepoint starting the
   // block, must point to a statically allocated cstring
   const char* name;
+  // The OS identifier of the thread which recorded the tracepoint
+  uint32_t threadId;
   // Flags indicating whether this block is starting, stopping, or neither
   uint8_t start : 1;
   uint8_t stop : 1;
@@ -54,7 +58,7 @@ class ThreadLocalTracePoints {
   static constexpr size_t kBufferPoints = 16 * 1024;
 
  public:
-  ThreadLocalTracePoints() = default;
+  ThreadLocalTracePoints();
   ~ThreadLocalTracePoints() {
     flush();
   }
@@ -74,6 +78,7 @@ class ThreadLocalTracePoints {
     tp.blockId = blockId;
     tp.parentBlockId = parentBlockId;
     tp.name = name;
+    tp.threadId = threadId_;
     tp.start = start;
     tp.stop = stop;
     tp.timestamp = std::chrono::nanoseconds(
@@ -86,6 +91,7 @@ class ThreadLocalTracePoints {
     std::array<CompactTracePoint, kBufferPoints> tracePoints_;
   };
 
+  const uint32_t threadId_;
   folly::Synchronized<State, folly::SpinLock> state_;
 };
 
@@ -122,6 +128,13 @@ class Tracer {
 
   std::vector<CompactTracePoint> getAllTracepoints();
 
+  /**
+   * The names of the threads which recorded tracepoints, by thread id.
+   */
+  folly::F14FastMap<uint32_t, std::string> getThreadNames() {
+    return threadNames_.copy();
+  }
+
   bool isEnabled() noexcept {
     return enabled_->load(std::memory_order_acquire);
   }
@@ -146,6 +159,9 @@ class Tracer {
   // empty. As long as threads aren't continuously being created and
   // destroyed while tracing is on, this shouldn't grow large
   folly::Synchronized<std::vector<CompactTracePoint>> tracepoints_;
+  // Captured when a thread records its first tracepoint, and never removed,
+  // as thread ids are only reused once many threads have been created.
+  folly::Synchronized<folly::F14FastMap<uint32_t, std::string>> threadNames_;
 };
 
 extern Tracer globalTracer;
@@ -174,6 +190,10 @@ inline std::vector<CompactTracePoint> getAllTracepoints() {
   return detail::globalTracer.getAllTracepoints();
 }
 
+inline folly::F14FastMap<uint32_t, std::string> getTraceThreadNames() {
+  return detail::globalTracer.getThreadNames();
+}
+
 /*
  * TraceBlocks demark sections of eden's execution so we can analyze
  * the behavior of a request in a fine-grained fashion.
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/telemetry/ChromeTraceWriter.h"
+
+#include <folly/FileUtil.h>
+#include <folly/experimental/TestUtil.h>
+#include <folly/json.h>
+#include <folly/portability/GTest.h>
+
+using namespace facebook::eden;
+using namespace std::chrono_literals;
+
+namespace {
+CompactTracePoint makePoint(
+    std::chrono::nanoseconds timestamp,
+    uint64_t blockId,
+    uint64_t parentBlockId,
+    const char* name,
+    bool start) {
+  CompactTracePoint point{};
+  point.timestamp = timestamp;
+  point.traceId = 7;
+  point.blockId = blockId;
+  point.parentBlockId = parentBlockId;
+  point.name = name;
+  point.threadId = 42;
+  point.start = start;
+  point.stop = !start;
+  return point;
+}
+
+folly::dynamic readTrace(const folly::test::TemporaryFile& file) {
+  std::string contents;
+  EXPECT_TRUE(folly::readFile(file.path().c_str(), contents));
+  // Terminate the array the way a viewer would.
+  if (folly::StringPiece{contents}.endsWith(",\n")) {
+    contents.resize(contents.size() - 2);
+  }
+  contents += "]";
+  return folly::parseJson(contents);
+}
+} // namespace
+
+TEST(ChromeTraceWriter, writes_nested_async_spans) {
+  folly::test::TemporaryFile file;
+  ChromeTraceWriter writer{folly::File{file.fd(), /*ownsFd=*/false}};
+  writer.write(
+      {makePoint(1000ns, 1, 0, "checkout", true),
+       makePoint(2000ns, 2, 1, "import", true),
+       makePoint(3000ns, 2, 1, nullptr, false)},
+      {{42, "EdenCPUThread"}});
+  EXPECT_EQ(1, writer.getOpenBlockCount());
+  writer.write({makePoint(4000ns, 1, 0, nullptr, false)}, {});
+  EXPECT_EQ(0, writer.getOpenBlockCount());
+
+  auto trace = readTrace(file);
+  ASSERT_EQ(5, trace.size());
+
+  EXPECT_EQ("M", trace[0]["ph"].asString());
+  EXPECT_EQ("thread_name", trace[0]["name"].asString());
+  EXPECT_EQ("EdenCPUThread", trace[0]["args"]["name"].asString());
+  EXPECT_EQ(42, trace[0]["tid"].asInt());
+
+  EXPECT_EQ("b", trace[1]["ph"].asString());
+  EXPECT_EQ("checkout", trace[1]["name"].asString());
+  EXPECT_EQ("0x7", trace[1]["id"].asString());
+  EXPECT_DOUBLE_EQ(1.0, trace[1]["ts"].asDouble());
+  EXPECT_EQ("b", trace[2]["ph"].asString());
+  EXPECT_EQ("import", trace[2]["name"].asString());
+  EXPECT_EQ("0x1", trace[2]["args"]["parentBlockId"].asString());
+
+  // The stop tracepoints take the name of their block.
+  EXPECT_EQ("e", trace[3]["ph"].asString());
+  EXPECT_EQ("import", trace[3]["name"].asString());
+  EXPECT_EQ("e", trace[4]["ph"].asString());
+  EXPECT_EQ("checkout", trace[4]["name"].asString());
+  EXPECT_EQ("0x7", trace[4]["id"].asString());
+}
+
+TEST(ChromeTraceWriter, skips_blocks_started_before_the_writer) {
+  folly::test::TemporaryFile file;
+  ChromeTraceWriter writer{folly::File{file.fd(), /*ownsFd=*/false}};
+  writer.write({makePoint(1000ns, 3, 0, nullptr, false)}, {});
+
+  // The name of the thread is unknown, so nothing is written.
+  EXPECT_EQ(0, readTrace(file).size());
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/telemetry/CounterDeltaTable.h"
+
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+
+using namespace facebook::eden;
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+using ::testing::Pair;
+using ::testing::UnorderedElementsAre;
+
+TEST(CounterDeltaTableTest, returnsOnlyTheCountersChangedSinceTheToken) {
+  CounterDeltaTable table;
+  auto first = table.update({{"a", 1}, {"b", 2}});
+  auto second = table.update({{"a", 1}, {"b", 3}, {"c", 4}});
+
+  auto delta = table.getChangesSince(first);
+  EXPECT_FALSE(delta.full);
+  EXPECT_EQ(second, delta.token);
+  EXPECT_THAT(delta.changed, UnorderedElementsAre(Pair("b", 3), Pair("c", 4)));
+  EXPECT_THAT(delta.removed, IsEmpty());
+
+  delta = table.getChangesSince(second);
+  EXPECT_FALSE(delta.full);
+  EXPECT_THAT(delta.changed, IsEmpty());
+}
+
+TEST(CounterDeltaTableTest, reportsRemovedCounters) {
+  CounterDeltaTable table;
+  auto first = table.update({{"a", 1}, {"b", 2}});
+  table.update({{"a", 1}});
+
+  auto delta = table.getChangesSince(first);
+  EXPECT_FALSE(delta.full);
+  EXPECT_THAT(delta.changed, IsEmpty());
+  EXPECT_THAT(delta.removed, ElementsAre("b"));
+
+  // A counter added back is only reported as changed.
+  table.update({{"a", 1}, {"b", 5}});
+  delta = table.getChangesSince(first);
+  EXPECT_THAT(delta.changed, ElementsAre(Pair("b", 5)));
+  EXPECT_THAT(delta.removed, IsEmpty());
+}
+
+TEST(CounterDeltaTableTest, unknownTokensGetEveryCounter) {
+  CounterDeltaTable table;
+  CounterDeltaTable other;
+  table.update({{"a", 1}, {"b", 2}});
+  auto otherToken = other.update({{"a", 1}});
+
+  for (auto token : {uint64_t{0}, otherToken, table.getToken() + 1}) {
+    auto delta = table.getChangesSince(token);
+    EXPECT_TRUE(delta.full);
+    EXPECT_THAT(
+        delta.changed, UnorderedElementsAre(Pair("a", 1), Pair("b", 2)));
+  }
+}
+
+TEST(CounterDeltaTableTest, tokensOlderThanRememberedRemovalsGetAllCounters) {
+  CounterDeltaTable table{/*maxRemovals=*/1};
+  auto first = table.update({{"a", 1}, {"b", 2}, {"c", 3}});
+  auto second = table.update({{"a", 1}, {"c", 3}});
+  table.update({{"a", 1}});
+
+  EXPECT_TRUE(table.getChangesSince(first).full);
+  auto delta = table.getChangesSince(second);
+  EXPECT_FALSE(delta.full);
+  EXPECT_THAT(delta.removed, ElementsAre("c"));
+}
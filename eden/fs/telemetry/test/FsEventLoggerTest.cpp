@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/telemetry/FsEventLogger.h"
+#include <folly/portability/GTest.h>
+#include <thread>
+#include "eden/fs/config/EdenConfig.h"
+#include "eden/fs/config/ReloadableConfig.h"
+#include "eden/fs/telemetry/IHiveLogger.h"
+
+using namespace facebook::eden;
+using namespace std::chrono_literals;
+
+namespace {
+
+struct TestHiveLogger : public NullHiveLogger {
+  struct Sample {
+    uint64_t durationUs;
+    std::string cause;
+    bool slow;
+  };
+  std::vector<Sample> samples;
+
+  void logFsEventSample(FsEventSample event) override {
+    samples.push_back({event.durationUs, event.cause.str(), event.slow});
+  }
+};
+
+class FsEventLoggerTest : public ::testing::Test {
+ protected:
+  FsEventLoggerTest() {
+    config_->requestSamplingGroupDenominators.setValue(
+        std::vector<uint32_t>{0, 1, 0, 0, 0}, ConfigSource::CommandLine);
+    config_->requestSamplesPerMinute.setValue(3, ConfigSource::CommandLine);
+  }
+
+  std::shared_ptr<EdenConfig> config_{EdenConfig::createTestEdenConfig()};
+  std::shared_ptr<TestHiveLogger> hiveLogger_{
+      std::make_shared<TestHiveLogger>()};
+};
+
+} // namespace
+
+TEST_F(FsEventLoggerTest, samplesAreCappedPerMinute) {
+  ReloadableConfig reloadableConfig{config_};
+  FsEventLogger logger{reloadableConfig, hiveLogger_};
+  for (int i = 0; i < 10; ++i) {
+    logger.log({1ms, SamplingGroup::One, "read"});
+  }
+  logger.flush();
+  ASSERT_EQ(3, hiveLogger_->samples.size());
+  EXPECT_EQ(1000, hiveLogger_->samples[0].durationUs);
+  EXPECT_EQ("read", hiveLogger_->samples[0].cause);
+  EXPECT_FALSE(hiveLogger_->samples[0].slow);
+}
+
+TEST_F(FsEventLoggerTest, groupsWithoutDenominatorAreDropped) {
+  ReloadableConfig reloadableConfig{config_};
+  FsEventLogger logger{reloadableConfig, hiveLogger_};
+  logger.log({1ms, SamplingGroup::DropAll, "read"});
+  logger.log({1ms, SamplingGroup::Two, "write"});
+  logger.flush();
+  EXPECT_EQ(0, hiveLogger_->samples.size());
+}
+
+TEST_F(FsEventLoggerTest, slowRequestsAreAlwaysLogged) {
+  config_->requestSlowThreshold.setValue(100ms, ConfigSource::CommandLine);
+  ReloadableConfig reloadableConfig{config_};
+  FsEventLogger logger{reloadableConfig, hiveLogger_};
+  for (int i = 0; i < 10; ++i) {
+    logger.log({200ms, SamplingGroup::Two, "write"});
+  }
+  // Fast requests are still sampled.
+  logger.log({1ms, SamplingGroup::Two, "write"});
+  // DropAll requests are never logged.
+  logger.log({200ms, SamplingGroup::DropAll, "forget"});
+  logger.flush();
+  ASSERT_EQ(10, hiveLogger_->samples.size());
+  for (const auto& sample : hiveLogger_->samples) {
+    EXPECT_TRUE(sample.slow);
+    EXPECT_EQ("write", sample.cause);
+  }
+}
+
+TEST_F(FsEventLoggerTest, threadsShareTheCap) {
+  ReloadableConfig reloadableConfig{config_};
+  FsEventLogger logger{reloadableConfig, hiveLogger_};
+  for (int i = 0; i < 10; ++i) {
+    logger.log({1ms, SamplingGroup::One, "read"});
+  }
+  std::thread{[&] {
+    for (int i = 0; i < 10; ++i) {
+      logger.log({1ms, SamplingGroup::One, "read"});
+    }
+  }}.join();
+  logger.flush();
+  EXPECT_EQ(3, hiveLogger_->samples.size());
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/telemetry/LatencyHistogram.h"
+#include <folly/portability/GTest.h>
+
+using namespace std::literals;
+using namespace facebook::eden;
+
+TEST(LatencyHistogramTest, empty_histogram_reports_zero) {
+  LatencyHistogram histogram;
+  auto percentiles = histogram.getPercentiles();
+  EXPECT_EQ(0, percentiles.count);
+  EXPECT_EQ(0us, percentiles.p50);
+  EXPECT_EQ(0us, percentiles.p999);
+}
+
+TEST(LatencyHistogramTest, bucket_bounds_contain_their_values) {
+  for (uint64_t value :
+       {0ul, 1ul, 15ul, 16ul, 17ul, 31ul, 32ul, 1000ul, 123456ul, 1ul << 26}) {
+    auto index = LatencyHistogram::bucketIndex(value);
+    EXPECT_LE(value, LatencyHistogram::bucketMaxValue(index)) << value;
+    if (index > 0) {
+      EXPECT_GT(value, LatencyHistogram::bucketMaxValue(index - 1)) << value;
+    }
+    // Buckets are never wider than 1/8 of the values they hold.
+    EXPECT_LE(LatencyHistogram::bucketMaxValue(index) - value, value / 8)
+        << value;
+  }
+}
+
+TEST(LatencyHistogramTest, values_are_clamped) {
+  LatencyHistogram histogram;
+  histogram.record(-5us);
+  histogram.record(1h);
+  EXPECT_EQ(0us, histogram.getPercentile(0));
+  EXPECT_EQ(
+      std::chrono::microseconds(LatencyHistogram::kMaxValue),
+      histogram.getPercentile(1));
+}
+
+TEST(LatencyHistogramTest, percentiles) {
+  LatencyHistogram histogram;
+  for (int i = 1; i <= 1000; ++i) {
+    histogram.record(std::chrono::microseconds(i));
+  }
+  auto percentiles = histogram.getPercentiles();
+  EXPECT_EQ(1000, percentiles.count);
+  EXPECT_GE(percentiles.p50, 500us);
+  EXPECT_LE(percentiles.p50, 500us + 500us / 8);
+  EXPECT_GE(percentiles.p99, 990us);
+  EXPECT_LE(percentiles.p99, 990us + 990us / 8);
+  EXPECT_GE(percentiles.p999, 999us);
+}
+
+TEST(LatencyHistogramTest, merge_adds_counts) {
+  LatencyHistogram a;
+  LatencyHistogram b;
+  a.record(10us);
+  b.record(10us);
+  b.record(2000us);
+  a.merge(b);
+  EXPECT_EQ(3, a.count());
+  EXPECT_EQ(10us, a.getPercentile(0.5));
+  EXPECT_GE(a.getPercentile(1), 2000us);
+}
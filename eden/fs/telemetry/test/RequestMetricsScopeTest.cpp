@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/telemetry/RequestMetricsScope.h"
+
+#include <folly/portability/GTest.h>
+#include <thread>
+#include <vector>
+
+using namespace facebook::eden;
+using namespace std::chrono_literals;
+
+TEST(RequestMetricsScope, counts_requests_in_flight) {
+  RequestWatchList watches;
+  EXPECT_EQ(0, watches.getCount());
+  {
+    RequestMetricsScope first{&watches};
+    RequestMetricsScope second{&watches};
+    EXPECT_EQ(2, watches.getCount());
+
+    RequestMetricsScope moved{std::move(second)};
+    EXPECT_EQ(2, watches.getCount());
+  }
+  EXPECT_EQ(0, watches.getCount());
+  EXPECT_EQ(0us, watches.getMaxSampledDuration());
+}
+
+TEST(RequestMetricsScope, move_assignment_finishes_the_previous_request) {
+  RequestWatchList watches;
+  RequestMetricsScope scope{&watches};
+  scope = RequestMetricsScope{&watches};
+  EXPECT_EQ(1, watches.getCount());
+}
+
+TEST(RequestMetricsScope, lone_request_is_always_sampled) {
+  RequestWatchList watches{1000};
+  // Use up the thread's sampling countdown.
+  { RequestMetricsScope first{&watches}; }
+
+  RequestMetricsScope stuck{&watches};
+  std::this_thread::sleep_for(10ms);
+  EXPECT_GE(watches.getMaxSampledDuration(), 10ms);
+  EXPECT_GE(
+      RequestMetricsScope::getMetricFromWatches(
+          RequestMetricsScope::MAX_DURATION_US, watches),
+      10000);
+}
+
+TEST(RequestMetricsScope, requests_may_finish_on_other_threads) {
+  RequestWatchList watches;
+  std::vector<RequestMetricsScope> scopes;
+  for (int i = 0; i < 100; ++i) {
+    scopes.emplace_back(&watches);
+  }
+  std::thread{[&] { scopes.clear(); }}.join();
+  EXPECT_EQ(0, watches.getCount());
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/telemetry/SamplingProfiler.h"
+#include <folly/FileUtil.h>
+#include <folly/portability/GTest.h>
+#include <folly/stop_watch.h>
+#include <folly/testing/TestUtil.h>
+#include <thread>
+
+using namespace std::literals;
+using namespace facebook::eden;
+
+TEST(ProfilerTagTest, nested_tags_restore_the_outer_tag) {
+  EXPECT_EQ(nullptr, ProfilerTag::current());
+  {
+    ProfilerTag outer{"outer"};
+    EXPECT_STREQ("outer", ProfilerTag::current());
+    {
+      ProfilerTag inner{"inner"};
+      EXPECT_STREQ("inner", ProfilerTag::current());
+    }
+    EXPECT_STREQ("outer", ProfilerTag::current());
+  }
+  EXPECT_EQ(nullptr, ProfilerTag::current());
+}
+
+TEST(ProfilerTagTest, moved_tag_restores_once) {
+  ProfilerTag outer{"outer"};
+  {
+    ProfilerTag inner{"inner"};
+    ProfilerTag moved{std::move(inner)};
+    EXPECT_STREQ("inner", ProfilerTag::current());
+  }
+  EXPECT_STREQ("outer", ProfilerTag::current());
+}
+
+TEST(ProfilerTagTest, tag_destroyed_on_another_thread_leaves_it_alone) {
+  std::thread{[] {
+    auto tag = std::make_unique<ProfilerTag>("request");
+    std::thread{[&] {
+      ProfilerTag other{"other"};
+      tag.reset();
+      EXPECT_STREQ("other", ProfilerTag::current());
+    }}.join();
+    EXPECT_STREQ("request", ProfilerTag::current());
+  }}.join();
+}
+
+#ifdef __linux__
+
+TEST(SamplingProfilerTest, writes_the_samples_of_a_busy_thread) {
+  folly::test::TemporaryDirectory dir{"eden_sampling_profiler_test"};
+  auto path = normalizeBestEffort((dir.path() / "cpu.pprof").string());
+
+  SamplingProfiler::start(1000);
+  EXPECT_THROW(SamplingProfiler::start(), std::logic_error);
+  {
+    ProfilerTag tag{"busy"};
+    folly::stop_watch<> watch;
+    volatile uint64_t sum = 0;
+    while (watch.elapsed() < 200ms) {
+      sum = sum + 1;
+    }
+  }
+  auto result = SamplingProfiler::stop(path);
+  EXPECT_GT(result.samples, 0);
+  EXPECT_EQ(0, result.droppedSamples);
+  EXPECT_THROW(SamplingProfiler::stop(path), std::logic_error);
+
+  std::string profile;
+  ASSERT_TRUE(folly::readFile(path.stringPiece().str().c_str(), profile));
+  EXPECT_NE(std::string::npos, profile.find("busy"));
+  EXPECT_NE(std::string::npos, profile.find("nanoseconds"));
+}
+
+TEST(SamplingProfilerTest, rejects_invalid_frequencies) {
+  EXPECT_THROW(SamplingProfiler::start(0), std::invalid_argument);
+  EXPECT_THROW(SamplingProfiler::start(100000), std::invalid_argument);
+}
+
+#endif // __linux__
@@ -9,6 +9,8 @@
 #include <folly/json.h>
 #include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
+#include <folly/synchronization/Baton.h>
+#include <utility>
 #include "eden/fs/telemetry/ScribeLogger.h"
 
 using namespace facebook::eden;
@@ -46,6 +48,7 @@ struct ScubaStructuredLoggerTest : public ::testing::Test {
 
 TEST_F(ScubaStructuredLoggerTest, json_is_written_in_one_line) {
   logger.logEvent(TestLogEvent{"name", 10});
+  logger.flush();
   EXPECT_EQ(1, scribe->lines.size());
   const auto& line = scribe->lines[0];
   auto index = line.find('\n');
@@ -62,6 +65,7 @@ std::vector<std::string> keysOf(const folly::dynamic& d) {
 
 TEST_F(ScubaStructuredLoggerTest, json_contains_types_at_top_level_and_values) {
   logger.logEvent(TestLogEvent{"name", 10});
+  logger.flush();
   EXPECT_EQ(1, scribe->lines.size());
   const auto& line = scribe->lines[0];
   auto doc = folly::parseJson(line);
@@ -80,3 +84,50 @@ TEST_F(ScubaStructuredLoggerTest, json_contains_types_at_top_level_and_values) {
       UnorderedElementsAre(
           "str", "user", "host", "type", "os", "osver", "edenver"));
 }
+
+TEST_F(ScubaStructuredLoggerTest, events_are_written_in_order) {
+  for (int i = 0; i < 100; ++i) {
+    logger.logEvent(TestLogEvent{"name", i});
+  }
+  logger.flush();
+  ASSERT_EQ(100, scribe->lines.size());
+  for (int i = 0; i < 100; ++i) {
+    auto doc = folly::parseJson(scribe->lines[i]);
+    EXPECT_EQ(i, doc["int"]["number"].asInt());
+  }
+  EXPECT_EQ(0, logger.getDroppedEventCount());
+}
+
+namespace {
+struct BlockingScribeLogger : public ScribeLogger {
+  folly::Baton<> entered;
+  folly::Baton<> release;
+  bool blocked = false;
+  std::vector<std::string> lines;
+
+  void log(std::string line) override {
+    if (!std::exchange(blocked, true)) {
+      entered.post();
+    }
+    release.wait();
+    lines.emplace_back(std::move(line));
+  }
+};
+} // namespace
+
+TEST(ScubaStructuredLogger, events_are_dropped_while_the_queue_is_full) {
+  auto scribe = std::make_shared<BlockingScribeLogger>();
+  ScubaStructuredLogger logger{scribe, SessionInfo{}, 2};
+
+  logger.logEvent(TestLogEvent{"name", 0});
+  // The writer thread is now stuck in the scribe logger.
+  scribe->entered.wait();
+  for (int i = 1; i <= 5; ++i) {
+    logger.logEvent(TestLogEvent{"name", i});
+  }
+  EXPECT_EQ(3, logger.getDroppedEventCount());
+
+  scribe->release.post();
+  logger.flush();
+  EXPECT_EQ(3, scribe->lines.size());
+}
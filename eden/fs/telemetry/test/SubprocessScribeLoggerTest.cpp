@@ -31,3 +31,23 @@ TEST(ScribeLogger, log_messages_are_written_with_newlines) {
   folly::readFile(output.fd(), contents);
   EXPECT_EQ("foo\nbar\n", contents);
 }
+
+TEST(ScribeLogger, batches_are_written_in_order) {
+  folly::test::TemporaryFile output;
+
+  {
+    SubprocessScribeLogger logger{
+        std::vector<std::string>{"/bin/cat"},
+        FileDescriptor(
+            ::dup(output.fd()), "dup", FileDescriptor::FDType::Generic)};
+    logger.log("foo"_sp);
+    logger.logBatch({"bar", "baz"});
+    logger.log("qux"_sp);
+    EXPECT_EQ(0, logger.getDroppedMessageCount());
+  }
+
+  folly::checkUnixError(lseek(output.fd(), 0, SEEK_SET));
+  std::string contents;
+  folly::readFile(output.fd(), contents);
+  EXPECT_EQ("foo\nbar\nbaz\nqux\n", contents);
+}
@@ -8,6 +8,10 @@
 #include "eden/fs/telemetry/TraceBus.h"
 #include <folly/futures/Promise.h>
 #include <folly/portability/GTest.h>
+#include <folly/synchronization/Baton.h>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 using namespace std::literals;
 using namespace facebook::eden;
@@ -100,3 +104,105 @@ TEST(TraceBusTest, unsubscribe_before_publish) {
   // of events.
   XCHECK(1 == i || i == 3) << i << " must be 1 or 3";
 }
+
+TEST(TraceBusTest, publishes_from_many_threads_keep_their_order) {
+  constexpr int kThreads = 8;
+  constexpr int kEvents = 1000;
+  std::vector<std::pair<int, int>> values;
+  {
+    auto bus = TraceBus<std::pair<int, int>>::create("bus", 4);
+    auto handle = bus->subscribeFunction(
+        "sub", [&](std::pair<int, int> v) { values.push_back(v); });
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+      threads.emplace_back([&, t] {
+        for (int i = 0; i < kEvents; ++i) {
+          bus->publish(std::make_pair(t, i));
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+
+  XCHECK_EQ(size_t{kThreads * kEvents}, values.size());
+  std::vector<int> next(kThreads, 0);
+  for (auto [t, i] : values) {
+    XCHECK_EQ(next[t], i);
+    ++next[t];
+  }
+}
+
+TEST(TraceBusTest, publishes_are_observed_in_order_across_threads) {
+  constexpr int kThreads = 8;
+  constexpr int kEvents = 1000;
+  std::vector<int> values;
+  {
+    auto bus = TraceBus<int>::create("bus", 4);
+    auto handle =
+        bus->subscribeFunction("sub", [&](int v) { values.push_back(v); });
+
+    // Each event is published after the previous one, on whichever thread
+    // takes the lock, like the start and finish events of a request.
+    std::mutex mutex;
+    int next = 0;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+      threads.emplace_back([&] {
+        for (int i = 0; i < kEvents; ++i) {
+          std::lock_guard<std::mutex> lock{mutex};
+          bus->publish(next++);
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+
+  XCHECK_EQ(size_t{kThreads * kEvents}, values.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    XCHECK_EQ(static_cast<int>(i), values[i]);
+  }
+}
+
+namespace {
+class BlockingSubscriber final : public TraceEventSubscriber<int> {
+ public:
+  BlockingSubscriber() : TraceEventSubscriber<int>{"blocking"} {}
+
+  void observeBatch(const int* begin, const int* end) override {
+    if (begin != end && *begin == 0) {
+      started.post();
+      unblock.wait();
+    }
+    observed += end - begin;
+  }
+
+  folly::Baton<> started;
+  folly::Baton<> unblock;
+  size_t observed = 0;
+};
+} // namespace
+
+TEST(TraceBusTest, drops_are_counted_against_subscribers) {
+  auto subscriber = std::make_shared<BlockingSubscriber>();
+  {
+    auto bus = TraceBus<int>::create("bus", 2, TraceBusOverflowPolicy::Drop);
+    auto handle = bus->subscribe(subscriber);
+
+    // Block the background thread in the subscriber, so that the ring fills.
+    bus->publish(0);
+    subscriber->started.wait();
+    for (int i = 1; i < 100; ++i) {
+      bus->publish(i);
+    }
+    subscriber->unblock.post();
+    bus.reset();
+  }
+
+  EXPECT_LE(97u, subscriber->getDroppedEventCount());
+  EXPECT_EQ(100u, subscriber->observed + subscriber->getDroppedEventCount());
+}
@@ -55,6 +55,16 @@ TEST(Tracing, records_block) {
   ensureValidBlock();
 }
 
+TEST(Tracing, records_thread_of_block) {
+  enableTracing();
+  { TraceBlock block{"my_block"}; }
+
+  auto points = getAllTracepoints();
+  ASSERT_EQ(points.size(), 2);
+  EXPECT_EQ(points[0].threadId, points[1].threadId);
+  EXPECT_EQ(1, getTraceThreadNames().count(points[0].threadId));
+}
+
 TEST(Tracing, records_block_explicit_close) {
   enableTracing();
   {
@@ -10,6 +10,7 @@
 #include <folly/Format.h>
 #include <folly/MapUtil.h>
 #include <folly/futures/Future.h>
+#include <folly/io/Cursor.h>
 #include <folly/logging/xlog.h>
 #include <folly/ssl/OpenSSLHash.h>
 
@@ -27,11 +28,24 @@ using folly::makeFuture;
 using folly::SemiFuture;
 using folly::StringPiece;
 using std::make_unique;
+using std::shared_ptr;
 using std::unique_ptr;
 
 namespace facebook {
 namespace eden {
 
+namespace {
+template <typename T>
+SemiFuture<T> withLatency(
+    std::chrono::microseconds latency,
+    folly::Future<T> future) {
+  if (latency.count() == 0) {
+    return std::move(future).semi();
+  }
+  return std::move(future).semi().delayed(latency);
+}
+} // namespace
+
 FakeBackingStore::FakeBackingStore() = default;
 
 FakeBackingStore::~FakeBackingStore() = default;
@@ -61,7 +75,7 @@ SemiFuture<unique_ptr<Tree>> FakeBackingStore::getRootTree(
     storedTreeHash = commitIter->second.get();
   }
 
-  return storedTreeHash->getFuture().thenValue(
+  auto future = storedTreeHash->getFuture().thenValue(
       [this, commitID](const std::unique_ptr<Hash>& hash) {
         auto data = data_.rlock();
         auto treeIter = data->trees.find(*hash);
@@ -77,9 +91,11 @@ SemiFuture<unique_ptr<Tree>> FakeBackingStore::getRootTree(
 
         return treeIter->second->getFuture();
       });
+  return withLatency(
+      latency_.load(std::memory_order_relaxed), std::move(future));
 }
 
-SemiFuture<unique_ptr<Tree>> FakeBackingStore::getTree(
+SemiFuture<shared_ptr<const Tree>> FakeBackingStore::getTree(
     const Hash& id,
     ObjectFetchContext& /*context*/) {
   auto data = data_.wlock();
@@ -95,10 +111,14 @@ SemiFuture<unique_ptr<Tree>> FakeBackingStore::getTree(
     throw std::domain_error("tree " + id.toString() + " not found");
   }
 
-  return it->second->getFuture();
+  return withLatency(
+      latency_.load(std::memory_order_relaxed),
+      it->second->getFuture().thenValue([](unique_ptr<Tree> tree) {
+        return shared_ptr<const Tree>{std::move(tree)};
+      }));
 }
 
-SemiFuture<unique_ptr<Blob>> FakeBackingStore::getBlob(
+SemiFuture<shared_ptr<const Blob>> FakeBackingStore::getBlob(
     const Hash& id,
     ObjectFetchContext& /*context*/) {
   auto data = data_.wlock();
@@ -109,7 +129,38 @@ SemiFuture<unique_ptr<Blob>> FakeBackingStore::getBlob(
     throw std::domain_error("blob " + id.toString() + " not found");
   }
 
-  return it->second->getFuture();
+  return withLatency(
+      latency_.load(std::memory_order_relaxed),
+      it->second->getFuture().thenValue([](unique_ptr<Blob> blob) {
+        return shared_ptr<const Blob>{std::move(blob)};
+      }));
+}
+
+SemiFuture<unique_ptr<IOBuf>> FakeBackingStore::getBlobRange(
+    const Hash& id,
+    uint64_t offset,
+    uint64_t length,
+    ObjectFetchContext& /*context*/) {
+  auto data = data_.wlock();
+  ++data->accessCounts[id];
+  auto it = data->blobs.find(id);
+  if (it == data->blobs.end()) {
+    throw std::domain_error("blob " + id.toString() + " not found");
+  }
+
+  auto future = it->second->getFuture().thenValue(
+      [offset, length](unique_ptr<Blob> blob) {
+        folly::io::Cursor cursor(&blob->getContents());
+        if (!cursor.canAdvance(offset)) {
+          return IOBuf::create(0);
+        }
+        cursor.skip(offset);
+        unique_ptr<IOBuf> range;
+        cursor.cloneAtMost(range, length);
+        return range;
+      });
+  return withLatency(
+      latency_.load(std::memory_order_relaxed), std::move(future));
 }
 
 Blob FakeBackingStore::makeBlob(folly::StringPiece contents) {
@@ -377,5 +428,17 @@ void FakeBackingStore::discardOutstandingRequests() {
 size_t FakeBackingStore::getAccessCount(const Hash& hash) const {
   return folly::get_default(data_.rlock()->accessCounts, hash, 0);
 }
+
+size_t FakeBackingStore::getTotalAccessCount() const {
+  auto data = data_.rlock();
+  size_t total = 0;
+  for (const auto& [hash, count] : data->accessCounts) {
+    total += count;
+  }
+  for (const auto& [commit, count] : data->commitAccessCounts) {
+    total += count;
+  }
+  return total;
+}
 } // namespace eden
 } // namespace facebook
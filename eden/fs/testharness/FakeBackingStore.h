@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <initializer_list>
 #include <memory>
 #include <unordered_map>
@@ -51,12 +53,36 @@ class FakeBackingStore final : public BackingStore {
       ObjectFetchContext& /* context */) override {
     throw std::domain_error("unimplemented");
   }
-  folly::SemiFuture<std::unique_ptr<Tree>> getTree(
+  folly::SemiFuture<std::shared_ptr<const Tree>> getTree(
       const Hash& id,
       ObjectFetchContext& context) override;
-  folly::SemiFuture<std::unique_ptr<Blob>> getBlob(
+  folly::SemiFuture<std::shared_ptr<const Blob>> getBlob(
       const Hash& id,
       ObjectFetchContext& context) override;
+  bool supportsBlobRanges() const override {
+    return supportsBlobRanges_.load(std::memory_order_relaxed);
+  }
+  folly::SemiFuture<std::unique_ptr<folly::IOBuf>> getBlobRange(
+      const Hash& id,
+      uint64_t offset,
+      uint64_t length,
+      ObjectFetchContext& context) override;
+
+  /**
+   * Make getBlobRange() available to the ObjectStore. Off by default, like
+   * in the production backing stores.
+   */
+  void setSupportsBlobRanges(bool supportsBlobRanges) {
+    supportsBlobRanges_.store(supportsBlobRanges, std::memory_order_relaxed);
+  }
+
+  /**
+   * Delay the completion of every fetch by `latency`, to stand in for the
+   * round trips of a remote backing store. No delay by default.
+   */
+  void setLatency(std::chrono::microseconds latency) {
+    latency_.store(latency, std::memory_order_relaxed);
+  }
 
   /**
    * Add a Blob to the backing store
@@ -151,6 +177,11 @@ class FakeBackingStore final : public BackingStore {
    */
   size_t getAccessCount(const Hash& hash) const;
 
+  /**
+   * Returns the number of times any commit, tree or blob has been queried.
+   */
+  size_t getTotalAccessCount() const;
+
  private:
   struct Data {
     std::unordered_map<RootId, std::unique_ptr<StoredHash>> commits;
@@ -171,6 +202,8 @@ class FakeBackingStore final : public BackingStore {
       std::vector<TreeEntry>&& sortedEntries);
 
   folly::Synchronized<Data> data_;
+  std::atomic<bool> supportsBlobRanges_{false};
+  std::atomic<std::chrono::microseconds> latency_{};
 };
 
 enum class FakeBlobType {
@@ -340,7 +340,7 @@ void TestMount::remount() {
 }
 
 #ifndef _WIN32
-void TestMount::remountGracefully() {
+void TestMount::remountGracefully(bool throughSnapshot) {
   // Create a new copy of the CheckoutConfig
   auto config = make_unique<CheckoutConfig>(*edenMount_->getCheckoutConfig());
   // Create a new ObjectStore pointing to our local store and backing store
@@ -381,7 +381,14 @@ void TestMount::remountGracefully() {
       blobCache_,
       serverState_,
       std::move(journal));
-  edenMount_->initialize([](auto) {}, takeoverData)
+  std::optional<SerializedInodeMap> inodeMap{std::move(takeoverData)};
+  std::shared_ptr<const InodeMapSnapshot> snapshot;
+  if (throughSnapshot && InodeMapSnapshot::isSupported()) {
+    snapshot =
+        std::make_shared<InodeMapSnapshot>(InodeMapSnapshot::write(*inodeMap));
+    inodeMap = std::nullopt;
+  }
+  edenMount_->initialize([](auto) {}, inodeMap, std::move(snapshot))
       .getVia(serverExecutor_.get());
 }
 #endif
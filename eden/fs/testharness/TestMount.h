@@ -173,6 +173,13 @@ class TestMount {
     return config_.get();
   }
 
+  /**
+   * Get the EdenConfig shared by the mount, so tests can change its settings.
+   */
+  const std::shared_ptr<EdenConfig>& getEdenConfig() const {
+    return edenConfig_;
+  }
+
   /**
    * Callers can use this to populate the LocalStore before calling build().
    */
@@ -221,8 +228,12 @@ class TestMount {
 #ifndef _WIN32
   /**
    * Simulate an edenfs daemon takeover for this mount.
+   *
+   * With throughSnapshot, the inode map is handed over as an
+   * InodeMapSnapshot, like version 6 of the takeover protocol does. This is
+   * ignored on platforms where snapshots aren't supported.
    */
-  void remountGracefully();
+  void remountGracefully(bool throughSnapshot = false);
 #endif
 
   /**
@@ -51,6 +51,21 @@ class BucketedLog {
     buckets_[now % Size].add(std::forward<Args>(args)...);
   }
 
+  /**
+   * Advances the internal clock to `now`, clearing buckets that have rolled out
+   * of the `Size` window. Then returns the most recent bucket, which stays
+   * valid until the clock advances or the log is cleared.
+   *
+   * If the internal clock has already advanced beyond `now`, returns nullptr.
+   */
+  Bucket* getCurrent(uint64_t now) {
+    if (now < windowStart_) {
+      return nullptr;
+    }
+    advanceWindow(now);
+    return &buckets_[now % Size];
+  }
+
   /**
    * Advances the internal clock to `now`, clearing buckets that have rolled
    * out of the `Size` window, and then returns them all. The last bucket in the
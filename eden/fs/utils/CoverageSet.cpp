@@ -12,11 +12,11 @@ namespace facebook {
 namespace eden {
 
 void CoverageSet::clear() {
-  set_.clear();
+  set_.reset();
 }
 
 bool CoverageSet::empty() const noexcept {
-  return set_.empty();
+  return !set_ || set_->empty();
 }
 
 void CoverageSet::add(size_t begin, size_t end) {
@@ -29,15 +29,20 @@ void CoverageSet::add(size_t begin, size_t end) {
     return;
   }
 
-  Iter right = set_.lower_bound(Interval{begin, end});
-  Iter left = right == set_.begin() ? set_.end() : std::prev(right);
+  if (!set_) {
+    set_ = std::make_unique<Set>();
+  }
+  auto& set = *set_;
+
+  Iter right = set.lower_bound(Interval{begin, end});
+  Iter left = right == set.begin() ? set.end() : std::prev(right);
 
   // While the xcode 10 clang compiler is C++17, its libc++ doesn't
   // implement node_type/extract from C++17, so we need to live
   // without it for now.  When that support is available, we can
   // remove this ifdef.
 #ifdef __APPLE__
-  auto erase = [&](Iter iter) -> void { set_.erase(iter); };
+  auto erase = [&](Iter iter) -> void { set.erase(iter); };
 #else
   // To avoid allocation when possible, save up to one node that can be
   // modified before reinsertion.
@@ -45,9 +50,9 @@ void CoverageSet::add(size_t begin, size_t end) {
 
   auto erase = [&](Iter iter) -> void {
     if (reuse_handle) {
-      set_.erase(iter);
+      set.erase(iter);
     } else {
-      reuse_handle = set_.extract(iter);
+      reuse_handle = set.extract(iter);
     }
   };
 #endif
@@ -57,11 +62,11 @@ void CoverageSet::add(size_t begin, size_t end) {
   // reinsertion. At the cost of some additional checks, the rebalances could be
   // avoided. This optimization probably isn't worth much under typical usage.
 
-  if (left != set_.end() && left->end == begin) {
+  if (left != set.end() && left->end == begin) {
     begin = left->begin;
     erase(left);
   }
-  while (right != set_.end() && end >= right->begin) {
+  while (right != set.end() && end >= right->begin) {
     auto next = std::next(right);
     end = std::max(end, right->end);
     erase(right);
@@ -72,11 +77,11 @@ void CoverageSet::add(size_t begin, size_t end) {
   if (reuse_handle) {
     reuse_handle.value().begin = begin;
     reuse_handle.value().end = end;
-    set_.insert(std::move(reuse_handle));
+    set.insert(std::move(reuse_handle));
   } else
 #endif
   {
-    set_.insert(Interval{begin, end});
+    set.insert(Interval{begin, end});
   }
 }
 
@@ -86,9 +91,12 @@ bool CoverageSet::covers(size_t begin, size_t end) const noexcept {
   if (begin == end) {
     return true;
   }
+  if (!set_) {
+    return false;
+  }
 
-  auto right = set_.upper_bound(Interval{begin, end});
-  if (right == set_.begin()) {
+  auto right = set_->upper_bound(Interval{begin, end});
+  if (right == set_->begin()) {
     return false;
   }
   auto left = std::prev(right);
@@ -96,7 +104,16 @@ bool CoverageSet::covers(size_t begin, size_t end) const noexcept {
 }
 
 size_t CoverageSet::getIntervalCount() const noexcept {
-  return set_.size();
+  return set_ ? set_->size() : 0;
+}
+
+size_t CoverageSet::estimateIndirectMemoryUsage() const noexcept {
+  if (!set_) {
+    return 0;
+  }
+  // Each node of the red-black tree has three pointers and its color.
+  constexpr size_t kNodeOverhead = 4 * sizeof(void*);
+  return sizeof(*set_) + set_->size() * (sizeof(Interval) + kNodeOverhead);
 }
 
 } // namespace eden
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <cstddef>
+#include <memory>
 #include <set>
 
 namespace facebook {
@@ -16,6 +17,9 @@ namespace eden {
 /**
  * Tracks contiguous coverage of intervals. Intervals are added dynamically.
  * Then whether a given interval is fully covered can be queried.
+ *
+ * Every loaded FileInode holds a CoverageSet, most of which are never added
+ * to, so an empty CoverageSet is kept to the size of a pointer.
  */
 class CoverageSet {
  public:
@@ -46,6 +50,12 @@ class CoverageSet {
    */
   size_t getIntervalCount() const noexcept;
 
+  /**
+   * Estimates the memory allocated for the intervals, not counting the
+   * CoverageSet itself.
+   */
+  size_t estimateIndirectMemoryUsage() const noexcept;
+
  private:
   struct Interval {
     size_t begin;
@@ -59,8 +69,10 @@ class CoverageSet {
   /**
    * The intervals are non-overlapping and non-adjacent. begin < end for all
    * intervals.
+   *
+   * Only allocated once an interval is added, and freed by clear().
    */
-  std::set<Interval> set_;
+  std::unique_ptr<std::set<Interval>> set_;
 };
 
 } // namespace eden
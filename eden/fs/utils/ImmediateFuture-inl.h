@@ -41,6 +41,12 @@ ImmediateFuture<T>::thenTry(Func&& func) && {
   using RetType = ImmediateFuture<NewType>;
   using FuncRetType = std::invoke_result_t<Func, folly::Try<T>>;
 
+  // Chain in place on a ready SemiFuture, as if it was an immediate value.
+  if (auto* semi = std::get_if<folly::SemiFuture<T>>(&inner_);
+      semi && semi->isReady()) {
+    inner_ = std::move(*semi).getTry();
+  }
+
   return std::visit(
       [func = std::forward<Func>(func)](auto&& inner) mutable -> RetType {
         using Type = std::decay_t<decltype(inner)>;
@@ -63,6 +69,7 @@ ImmediateFuture<T>::thenTry(Func&& func) && {
           // transform that return value into a SemiFuture so that the return
           // type is a SemiFuture<NewType> and not a
           // SemiFuture<ImmediateFuture<NewType>>.
+          ++detail::immediateFutureAllocations;
           auto semiFut = std::move(inner).defer(std::forward<Func>(func));
           if constexpr (detail::isImmediateFuture<FuncRetType>::value) {
             return std::move(semiFut).deferValue(
@@ -106,7 +113,13 @@ folly::Try<T> ImmediateFuture<T>::getTry(folly::HighResDuration timeout) && {
 template <typename T>
 folly::SemiFuture<T> ImmediateFuture<T>::semi() && {
   return std::visit(
-      [](auto&& inner) -> folly::SemiFuture<T> { return std::move(inner); },
+      [](auto&& inner) -> folly::SemiFuture<T> {
+        using Type = std::decay_t<decltype(inner)>;
+        if constexpr (std::is_same_v<Type, folly::Try<T>>) {
+          ++detail::immediateFutureAllocations;
+        }
+        return std::move(inner);
+      },
       std::move(inner_));
 }
 
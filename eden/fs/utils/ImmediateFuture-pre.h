@@ -67,5 +67,11 @@ struct continuation_result
 template <typename Func, typename Arg>
 using continuation_result_t = typename continuation_result<Func, Arg>::type;
 
+/**
+ * The number of SemiFuture cores that ImmediateFuture allocated on this
+ * thread. See getImmediateFutureAllocationCount().
+ */
+inline thread_local uint64_t immediateFutureAllocations = 0;
+
 } // namespace detail
 } // namespace facebook::eden
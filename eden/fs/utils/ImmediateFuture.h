@@ -19,6 +19,9 @@ namespace facebook::eden {
  * or a folly::Try<T>. This allows code to not pay the overhead of
  * folly::SemiFuture for when an immediate value is available. In particular, an
  * ImmediateFuture will not allocate memory in this case.
+ *
+ * A continuation chained on a SemiFuture that is already ready is also run
+ * immediately, rather than deferred onto a new SemiFuture core.
  */
 template <typename T>
 class ImmediateFuture {
@@ -68,9 +71,10 @@ class ImmediateFuture {
   /**
    * Queue the func continuation once this future is ready.
    *
-   * When the ImmediateFuture is an immediate value, the passed in function
-   * will be called without waiting. When a SemiFuture value, the function will
-   * be called in the same executor as the previous future executor.
+   * When the ImmediateFuture is an immediate value, or a SemiFuture that is
+   * ready, the passed in function will be called without waiting. Otherwise,
+   * the function will be called in the same executor as the previous future
+   * executor.
    *
    * Func must be a function taking a T as the only argument, its return value
    * must be of a type that an ImmediateFuture can be constructed from
@@ -89,9 +93,10 @@ class ImmediateFuture {
   /**
    * Queue the func continuation once this future is ready.
    *
-   * When the ImmediateFuture is an immediate value, the passed in function
-   * will be called without waiting. When a SemiFuture value, the function will
-   * be called in the same executor as the previous future executor.
+   * When the ImmediateFuture is an immediate value, or a SemiFuture that is
+   * ready, the passed in function will be called without waiting. Otherwise,
+   * the function will be called in the same executor as the previous future
+   * executor.
    *
    * Func must be a function taking a Try<T> as the only argument, its return
    * value must be of a type that an ImmediateFuture can be constructed from
@@ -177,6 +182,18 @@ class ImmediateFuture {
 template <typename Func>
 auto makeImmediateFutureWith(Func&& func);
 
+/**
+ * The number of SemiFuture cores ImmediateFuture allocated on the calling
+ * thread: one per continuation deferred because its future was not ready,
+ * and one per semi() of an immediate value.
+ *
+ * The difference between two calls tells how many a piece of code, like the
+ * dispatch of a filesystem request, allocated.
+ */
+inline uint64_t getImmediateFutureAllocationCount() {
+  return detail::immediateFutureAllocations;
+}
+
 } // namespace facebook::eden
 
 #include "eden/fs/utils/ImmediateFuture-inl.h"
@@ -9,10 +9,21 @@
 #include <folly/container/EvictingCacheMap.h>
 #include <folly/futures/Future.h>
 #include <folly/futures/SharedPromise.h>
+#include <folly/hash/Hash.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 namespace facebook {
 namespace eden {
 
+/**
+ * An LRU cache of values fetched asynchronously.
+ *
+ * A missing key is fetched once: the callers asking for it while the fetch
+ * is in flight all get a future attached to that fetch, and so do the
+ * callers asking for it later, until it is evicted or erased.
+ */
 template <typename KEY, typename VAL, typename HASH = std::hash<KEY>>
 class LeaseCache {
  public:
@@ -43,6 +54,7 @@ class LeaseCache {
   }
 
   void setMaxSize(size_t size) {
+    std::lock_guard<std::mutex> g(lock_);
     cache_.setMaxSize(size);
   }
 
@@ -71,9 +83,77 @@ class LeaseCache {
   }
 
   bool exists(const KEY& key) {
+    std::lock_guard<std::mutex> g(lock_);
     return cache_.exists(key);
   }
 };
 
+/**
+ * A LeaseCache split into shards by the hash of the keys, each with its own
+ * lock and LRU, so that concurrent lookups of different keys rarely contend.
+ *
+ * The capacity is divided evenly between the shards, so the evictions only
+ * approximate a global LRU.
+ */
+template <typename KEY, typename VAL, typename HASH = std::hash<KEY>>
+class ShardedLeaseCache {
+ public:
+  using Shard = LeaseCache<KEY, VAL, HASH>;
+  using ValuePtr = typename Shard::ValuePtr;
+  using FutureType = typename Shard::FutureType;
+  using FetchFunc = typename Shard::FetchFunc;
+
+  static constexpr size_t kDefaultShardCount = 16;
+
+  ShardedLeaseCache(
+      size_t maxSize,
+      FetchFunc fetcher,
+      size_t shardCount = kDefaultShardCount,
+      size_t clearSize = 1) {
+    shardCount = std::max<size_t>(shardCount, 1);
+    shards_.reserve(shardCount);
+    for (size_t i = 0; i < shardCount; ++i) {
+      shards_.push_back(std::make_unique<Shard>(
+          getShardMaxSize(maxSize, shardCount), fetcher, clearSize));
+    }
+  }
+
+  void set(const KEY& key, ValuePtr val) {
+    getShard(key).set(key, std::move(val));
+  }
+
+  void erase(const KEY& key) {
+    getShard(key).erase(key);
+  }
+
+  void setMaxSize(size_t size) {
+    for (auto& shard : shards_) {
+      shard->setMaxSize(getShardMaxSize(size, shards_.size()));
+    }
+  }
+
+  FutureType get(const KEY& key) {
+    return getShard(key).get(key);
+  }
+
+  bool exists(const KEY& key) {
+    return getShard(key).exists(key);
+  }
+
+ private:
+  static size_t getShardMaxSize(size_t maxSize, size_t shardCount) {
+    // EvictingCacheMap treats 0 as unbounded, keep it that way.
+    return (maxSize + shardCount - 1) / shardCount;
+  }
+
+  Shard& getShard(const KEY& key) {
+    // Mix the hash, std::hash is the identity for integers.
+    auto hash = folly::hash::twang_mix64(HASH{}(key));
+    return *shards_[hash % shards_.size()];
+  }
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
 } // namespace eden
 } // namespace facebook
@@ -9,6 +9,7 @@
 
 #include <sys/mman.h>
 #include <unistd.h>
+#include <algorithm>
 #include <type_traits>
 
 #include <eden/fs/utils/Bug.h>
@@ -16,6 +17,7 @@
 #include <folly/File.h>
 #include <folly/FileUtil.h>
 #include <folly/Range.h>
+#include <folly/String.h>
 #include <folly/logging/xlog.h>
 
 namespace facebook {
@@ -36,6 +38,20 @@ inline size_t roundUpToNonzeroPageSize(size_t s) {
   return std::max(kPageSize, (s + kPageSize - 1) & ~(kPageSize - 1));
 }
 
+/**
+ * The size of a transparent huge page on x86-64 and most aarch64 kernels.
+ * Like kPageSize, it only needs to be right for the mapping to be efficient.
+ */
+constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
+inline size_t roundUpToNonzeroHugePageSize(size_t s) {
+  static_assert(
+      0 == (kHugePageSize & (kHugePageSize - 1)),
+      "kHugePageSize must be power of two");
+  return std::max(
+      kHugePageSize, (s + kHugePageSize - 1) & ~(kHugePageSize - 1));
+}
+
 /**
  * Enforce required properties of
  */
@@ -84,6 +100,10 @@ struct Migrator;
  * While alive, MappedDiskVector does acquire an exclusive flock on the
  * underlying fd to avoid multiple processes manipulating it at the same time.
  *
+ * The file grows geometrically, by half of its size and at least
+ * GROWTH_IN_PAGES pages at a time, so that appending millions of records
+ * remaps it a few dozen times rather than thousands.
+ *
  * MappedDiskVector supports migrating from old formats to new formats via the
  * OldVersions template parameter. For any given type T, T::VERSION is written
  * into the header and used for version negotiation. sizeof(T) is also recorded
@@ -244,6 +264,7 @@ class MappedDiskVector {
     end_ = other.end_;
     map_ = other.map_;
     mapSizeInBytes_ = other.mapSizeInBytes_;
+    hugePages_ = other.hugePages_;
 
     other.begin_ = nullptr;
     other.end_ = nullptr;
@@ -261,11 +282,13 @@ class MappedDiskVector {
     end_ = other.end_;
     map_ = other.map_;
     mapSizeInBytes_ = other.mapSizeInBytes_;
+    hugePages_ = other.hugePages_;
 
     other.begin_ = nullptr;
     other.end_ = nullptr;
     other.map_ = nullptr;
     other.mapSizeInBytes_ = 0;
+    return *this;
   }
 
   ~MappedDiskVector() {
@@ -291,6 +314,16 @@ class MappedDiskVector {
     return begin_[index];
   }
 
+  /**
+   * Grow the file so that it holds at least count records without being
+   * remapped again.
+   */
+  void reserve(size_t count) {
+    if (count > capacity()) {
+      growTo(sizeof(Header) + count * sizeof(T));
+    }
+  }
+
   template <typename... Args>
   void emplace_back(Args&&... args) {
     if (!hasRoom(1)) {
@@ -298,44 +331,9 @@ class MappedDiskVector {
           sizeof(GROWTH_IN_PAGES) * detail::kPageSize >= sizeof(T),
           "Growth must expand the file more than a single record");
 
-      size_t oldSize = size();
-      size_t newFileSize =
-          mapSizeInBytes_ + GROWTH_IN_PAGES * detail::kPageSize;
-
-      // Always keep the file size a whole number of pages.
-      XCHECK_EQ(0ul, newFileSize % detail::kPageSize);
-
-      if (-1 == folly::ftruncateNoInt(file_.fd(), newFileSize)) {
-        folly::throwSystemError("ftruncateNoInt failed when growing capacity");
-      }
-
-#ifdef __APPLE__
-      auto newMap = mmap(
-          nullptr,
-          newFileSize,
-          PROT_READ | PROT_WRITE,
-          MAP_SHARED,
-          file_.fd(),
-          0);
-#else
-      auto newMap = mremap(map_, mapSizeInBytes_, newFileSize, MREMAP_MAYMOVE);
-#endif
-      if (newMap == MAP_FAILED) {
-        folly::throwSystemError(folly::to<std::string>(
-            "mremap failed when growing capacity from ",
-            mapSizeInBytes_,
-            " to ",
-            newFileSize));
-      }
-
-#ifdef __APPLE__
-      munmap(map_, mapSizeInBytes_);
-#endif
-      map_ = newMap;
-      mapSizeInBytes_ = newFileSize;
-
-      begin_ = reinterpret_cast<T*>(static_cast<Header*>(newMap) + 1);
-      end_ = begin_ + oldSize;
+      growTo(
+          mapSizeInBytes_ +
+          std::max(GROWTH_IN_PAGES * detail::kPageSize, mapSizeInBytes_ / 2));
     }
 
     T* out = end_;
@@ -363,6 +361,33 @@ class MappedDiskVector {
     return end_[-1];
   }
 
+  /**
+   * Ask the kernel to back the mapping with transparent huge pages, to cut
+   * the TLB misses of random accesses to large vectors. From then on, the
+   * file grows by whole huge pages.
+   *
+   * The kernel only uses huge pages for the shared mappings of some
+   * filesystems, like tmpfs. Elsewhere, this only rounds the growth up.
+   */
+  void adviseHugePages() {
+    hugePages_ = true;
+    adviseMapping();
+  }
+
+  /**
+   * Write the modified records back to the file in one batch, rather than
+   * leaving it to the kernel's writeback. Unless synchronous, this starts the
+   * writes without waiting for them.
+   *
+   * The records may be modified concurrently, in which case their new value
+   * may or may not be written.
+   */
+  void flush(bool synchronous = true) {
+    folly::checkUnixError(
+        msync(map_, mapSizeInBytes_, synchronous ? MS_SYNC : MS_ASYNC),
+        "msync failed when flushing MappedDiskVector");
+  }
+
  private:
   static constexpr uint32_t kMagic = 0x0056444d; // "MDV\0"
 
@@ -475,6 +500,62 @@ class MappedDiskVector {
         static_cast<char*>(map_) + mapSizeInBytes_);
   }
 
+  /**
+   * Resize the file and its mapping to hold at least newFileSize bytes.
+   */
+  void growTo(size_t newFileSize) {
+    size_t oldSize = size();
+    // Always keep the file size a whole number of pages.
+    newFileSize = hugePages_ ? detail::roundUpToNonzeroHugePageSize(newFileSize)
+                             : detail::roundUpToNonzeroPageSize(newFileSize);
+
+    if (-1 == folly::ftruncateNoInt(file_.fd(), newFileSize)) {
+      folly::throwSystemError("ftruncateNoInt failed when growing capacity");
+    }
+
+#ifdef __APPLE__
+    auto newMap = mmap(
+        nullptr,
+        newFileSize,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED,
+        file_.fd(),
+        0);
+#else
+    auto newMap = mremap(map_, mapSizeInBytes_, newFileSize, MREMAP_MAYMOVE);
+#endif
+    if (newMap == MAP_FAILED) {
+      folly::throwSystemError(folly::to<std::string>(
+          "mremap failed when growing capacity from ",
+          mapSizeInBytes_,
+          " to ",
+          newFileSize));
+    }
+
+#ifdef __APPLE__
+    munmap(map_, mapSizeInBytes_);
+#endif
+    map_ = newMap;
+    mapSizeInBytes_ = newFileSize;
+
+    begin_ = reinterpret_cast<T*>(static_cast<Header*>(newMap) + 1);
+    end_ = begin_ + oldSize;
+
+    if (hugePages_) {
+      adviseMapping();
+    }
+  }
+
+  void adviseMapping() {
+#ifdef MADV_HUGEPAGE
+    if (madvise(map_, mapSizeInBytes_, MADV_HUGEPAGE) != 0) {
+      // Kernels without transparent huge pages reject the advice.
+      XLOG(DBG3) << "madvise(MADV_HUGEPAGE) failed: "
+                 << folly::errnoStr(errno);
+    }
+#endif
+  }
+
   bool hasRoom(size_t amount) const {
     // Technically, the expression (end_ + amount) is constructing a pointer
     // past the end of the "object" (mmap) and is thus UB.  But hopefully no
@@ -517,6 +598,7 @@ class MappedDiskVector {
 
   void* map_{nullptr};
   size_t mapSizeInBytes_{0}; // must be nonzero, multiple of page size
+  bool hugePages_{false};
 
   folly::File file_;
 
@@ -565,7 +647,7 @@ struct Migrator<T, First, Rest...> {
       auto tmpPath = folly::to<std::string>(path, ".tmp");
       auto newVector = MappedDiskVector<T>::createOrOverwrite(tmpPath);
       try {
-        // TODO: newVector.reserve
+        newVector.reserve(original.size());
         for (size_t i = 0; i < original.size(); ++i) {
           newVector.emplace_back(convert(original[i]));
         }
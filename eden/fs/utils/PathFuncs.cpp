@@ -10,8 +10,10 @@
 #include <boost/filesystem/operations.hpp>
 
 #include <folly/Exception.h>
+#include <folly/lang/Bits.h>
 #include <folly/logging/xlog.h>
 #include <folly/portability/Stdlib.h>
+#include <limits>
 #include <optional>
 #ifdef _WIN32
 #include <folly/portability/Unistd.h>
@@ -23,12 +25,241 @@
 #include <mach-o/dyld.h> // @manual
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define EDEN_PATH_FUNCS_SSE2
+#endif
+
 using folly::Expected;
 using folly::StringPiece;
 
 namespace facebook {
 namespace eden {
 
+namespace detail {
+
+void CompactPathStorage::assign(const char* data, size_t size) {
+  if (size <= kInlineCapacity) {
+    std::memcpy(bytes_, data, size);
+    std::memset(bytes_ + size, 0, kTagIndex - size);
+    setInlineSize(size);
+    return;
+  }
+
+  XCHECK_LE(size, std::numeric_limits<uint32_t>::max());
+  auto heap = new char[size];
+  std::memcpy(heap, data, size);
+  auto heapSize = static_cast<uint32_t>(size);
+  std::memcpy(bytes_, &heap, sizeof(heap));
+  std::memcpy(bytes_ + sizeof(heap), &heapSize, sizeof(heapSize));
+  bytes_[kTagIndex] = static_cast<char>(kHeapTag);
+}
+
+CompactPathStorage::CompactPathStorage(
+    PathArenaBlock* block,
+    uint32_t offset,
+    uint16_t size) {
+  block->refCount.fetch_add(1, std::memory_order_relaxed);
+  std::memcpy(bytes_, &block, sizeof(block));
+  std::memcpy(bytes_ + sizeof(block), &offset, sizeof(offset));
+  std::memcpy(bytes_ + sizeof(block) + sizeof(offset), &size, sizeof(size));
+  bytes_[kTagIndex] = static_cast<char>(kArenaTag);
+}
+
+void CompactPathStorage::releaseArenaBlock(PathArenaBlock* block) {
+  if (block->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    block->~PathArenaBlock();
+    free(block);
+  }
+}
+
+namespace {
+
+constexpr bool isNonAscii(char c) {
+  return static_cast<unsigned char>(c) >= 0x80;
+}
+
+constexpr char toLowerAscii(char c) {
+  return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c;
+}
+
+#ifdef EDEN_PATH_FUNCS_SSE2
+constexpr size_t kChunkSize = sizeof(__m128i);
+
+__m128i loadChunk(const char* data) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+}
+
+/**
+ * The bytes of chunk equal to a directory separator are set to 0xff.
+ */
+__m128i matchDirSeparators(__m128i chunk) {
+  auto matches = _mm_cmpeq_epi8(chunk, _mm_set1_epi8(kDirSeparator));
+  if (folly::kIsWindows) {
+    matches = _mm_or_si128(
+        matches, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(kWinDirSeparator)));
+  }
+  return matches;
+}
+
+/**
+ * Sets 0x20 on the uppercase ASCII letters of chunk.
+ */
+__m128i toLowerAscii(__m128i chunk) {
+  // Shift 'A' to -128, so that a single signed comparison finds the 26
+  // letters.
+  auto shifted = _mm_add_epi8(chunk, _mm_set1_epi8(0x80 - 'A'));
+  auto isUpper = _mm_cmplt_epi8(shifted, _mm_set1_epi8(-128 + 26));
+  return _mm_or_si128(chunk, _mm_and_si128(isUpper, _mm_set1_epi8(0x20)));
+}
+#endif
+
+/**
+ * Whether str holds a nul or non-ASCII byte, or a directory separator when
+ * allowSeparators is false.
+ */
+bool hasSpecialByte(StringPiece str, bool allowSeparators) {
+  const char* data = str.data();
+  size_t size = str.size();
+  size_t i = 0;
+#ifdef EDEN_PATH_FUNCS_SSE2
+  const auto zero = _mm_setzero_si128();
+  for (; i + kChunkSize <= size; i += kChunkSize) {
+    auto chunk = loadChunk(data + i);
+    auto special = _mm_cmpeq_epi8(chunk, zero);
+    if (!allowSeparators) {
+      special = _mm_or_si128(special, matchDirSeparators(chunk));
+    }
+    // The mask holds the top bit of each byte: the one of the non-ASCII
+    // bytes, and the one of the bytes matched above.
+    if (_mm_movemask_epi8(_mm_or_si128(special, chunk)) != 0) {
+      return true;
+    }
+  }
+#endif
+  for (; i < size; ++i) {
+    char c = data[i];
+    if (c == '\0' || isNonAscii(c) ||
+        (!allowSeparators && isDirSeparator(c))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+bool isPlainPathComponent(StringPiece str) {
+  return !hasSpecialByte(str, /*allowSeparators=*/false);
+}
+
+bool isPlainComposedPath(StringPiece str) {
+  return !hasSpecialByte(str, /*allowSeparators=*/true);
+}
+
+size_t rfindPathSeparator(StringPiece str) {
+  const char* data = str.data();
+  size_t end = str.size();
+#ifdef EDEN_PATH_FUNCS_SSE2
+  for (; end >= kChunkSize; end -= kChunkSize) {
+    auto mask = static_cast<uint32_t>(_mm_movemask_epi8(
+        matchDirSeparators(loadChunk(data + end - kChunkSize))));
+    if (mask != 0) {
+      // The highest set bit is the last separator of the chunk.
+      return end - kChunkSize + folly::findLastSet(mask) - 1;
+    }
+  }
+#endif
+  while (end > 0) {
+    --end;
+    if (isDirSeparator(data[end])) {
+      return end;
+    }
+  }
+  return StringPiece::npos;
+}
+
+} // namespace detail
+
+PathComponentArena::PathComponentArena(size_t capacity)
+    : capacity_{std::min<size_t>(
+          capacity,
+          std::numeric_limits<uint32_t>::max())} {
+  if (capacity_ == 0) {
+    return;
+  }
+  auto* memory = malloc(sizeof(detail::PathArenaBlock) + capacity_);
+  if (!memory) {
+    throw std::bad_alloc();
+  }
+  // The arena holds a reference until it is destroyed.
+  block_ = new (memory) detail::PathArenaBlock{{1}};
+}
+
+PathComponentArena::~PathComponentArena() {
+  if (block_) {
+    detail::CompactPathStorage::releaseArenaBlock(block_);
+  }
+}
+
+size_t PathComponentArena::getReservation(StringPiece name) {
+  return name.size() > detail::CompactPathStorage::kInlineCapacity
+      ? name.size()
+      : 0;
+}
+
+CompactPathComponent PathComponentArena::copy(PathComponentPiece name) {
+  auto piece = name.stringPiece();
+  if (piece.size() <= detail::CompactPathStorage::kInlineCapacity ||
+      piece.size() > std::numeric_limits<uint16_t>::max() ||
+      piece.size() > capacity_ - used_) {
+    return CompactPathComponent{name};
+  }
+  auto offset = used_;
+  std::memcpy(block_->names() + offset, piece.data(), piece.size());
+  used_ += piece.size();
+  return CompactPathComponent{
+      detail::CompactPathStorage{
+          block_,
+          static_cast<uint32_t>(offset),
+          static_cast<uint16_t>(piece.size())},
+      detail::SkipPathSanityCheck{}};
+}
+
+bool equalsCaseInsensitive(StringPiece a, StringPiece b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  size_t size = a.size();
+  size_t i = 0;
+#ifdef EDEN_PATH_FUNCS_SSE2
+  for (; i + detail::kChunkSize <= size; i += detail::kChunkSize) {
+    auto equal = _mm_cmpeq_epi8(
+        detail::toLowerAscii(detail::loadChunk(a.data() + i)),
+        detail::toLowerAscii(detail::loadChunk(b.data() + i)));
+    if (_mm_movemask_epi8(equal) != 0xffff) {
+      return false;
+    }
+  }
+#endif
+  for (; i < size; ++i) {
+    if (detail::toLowerAscii(a[i]) != detail::toLowerAscii(b[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64_t hashCaseInsensitive(StringPiece s) {
+  // FNV-1a over the lowercased bytes.
+  uint64_t hash = 0xcbf29ce484222325;
+  for (char c : s) {
+    hash ^= static_cast<uint8_t>(detail::toLowerAscii(c));
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
 StringPiece dirname(StringPiece path) {
   auto dirSeparator = detail::rfindPathSeparator(path);
 
@@ -383,8 +614,7 @@ CompareResult comparePathComponent(
     PathComponentPiece right,
     CaseSensitivity caseSensitivity) {
   if (caseSensitivity == CaseSensitivity::Insensitive) {
-    if (left.stringPiece().equals(
-            right.stringPiece(), folly::AsciiCaseInsensitive())) {
+    if (equalsCaseInsensitive(left.stringPiece(), right.stringPiece())) {
       return CompareResult::EQUAL;
     }
   } else {
@@ -21,6 +21,8 @@
 #include <folly/String.h>
 #include <folly/hash/Hash.h>
 #include <folly/logging/xlog.h>
+#include <atomic>
+#include <cstring>
 #include <iterator>
 #include <optional>
 #include <type_traits>
@@ -78,21 +80,26 @@ inline size_t findPathSeparator(folly::StringPiece str, size_t start = 0) {
   return index;
 }
 
-inline size_t rfindPathSeparator(folly::StringPiece str) {
-  auto index = str.rfind(kDirSeparator);
-  if (folly::kIsWindows) {
-    auto winIndex = str.rfind(kWinDirSeparator);
-    if (winIndex != folly::StringPiece::npos) {
-      if (index == folly::StringPiece::npos) {
-        return winIndex;
-      } else {
-        return std::max(index, winIndex);
-      }
-    }
-  }
+/**
+ * The index of the last directory separator of str, or npos. On x86-64, this
+ * scans 16 bytes at a time with SSE2.
+ */
+size_t rfindPathSeparator(folly::StringPiece str);
 
-  return index;
-}
+/**
+ * Whether str only holds ASCII bytes other than nul and the directory
+ * separators. Such a string is valid UTF-8, so only the empty, "." and ".."
+ * names remain to be rejected for it to be a valid PathComponent.
+ *
+ * On x86-64, this scans 16 bytes at a time with SSE2.
+ */
+bool isPlainPathComponent(folly::StringPiece str);
+
+/**
+ * Whether str only holds ASCII bytes other than nul. The directory
+ * separators are allowed.
+ */
+bool isPlainComposedPath(folly::StringPiece str);
 
 } // namespace detail
 
@@ -184,12 +191,223 @@ class PathComponentNotUtf8 : public PathComponentValidationError {
       : PathComponentValidationError(s) {}
 };
 
+class PathComponentArena;
+
+namespace detail {
+
+/**
+ * A reference counted block holding the long names of a PathComponentArena,
+ * followed by the names. It is freed with its last name.
+ */
+struct PathArenaBlock {
+  std::atomic<uint32_t> refCount;
+
+  char* names() {
+    return reinterpret_cast<char*>(this + 1);
+  }
+};
+
+/**
+ * A 16 bytes string storage for the names held by long lived containers, like
+ * the entries of a TreeInode.
+ *
+ * Names of up to kInlineCapacity bytes, which covers the vast majority of file
+ * names, are stored inline and thus do not require any allocation. Longer
+ * names live in a heap allocation of exactly their size, or in the block of
+ * a PathComponentArena.
+ *
+ * When inline, the last byte holds the remaining capacity, and thus doubles as
+ * the NUL terminator of a full name. When on the heap, the first 8 bytes hold
+ * the pointer, the next 4 the size and the last byte is kHeapTag. When in an
+ * arena, the first 8 bytes hold the block, the next 4 the offset of the name
+ * in the block, the next 2 the size and the last byte is kArenaTag.
+ */
+class CompactPathStorage {
+ public:
+  static constexpr size_t kInlineCapacity = 15;
+
+  CompactPathStorage() noexcept {
+    setInlineSize(0);
+  }
+
+  CompactPathStorage(const char* data, size_t size) {
+    assign(data, size);
+  }
+
+  CompactPathStorage(const CompactPathStorage& other) {
+    if (other.tag() == kArenaTag) {
+      // Share the block rather than copying the name.
+      std::memcpy(bytes_, other.bytes_, sizeof(bytes_));
+      arenaBlock()->refCount.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      assign(other.data(), other.size());
+    }
+  }
+
+  CompactPathStorage(CompactPathStorage&& other) noexcept {
+    std::memcpy(bytes_, other.bytes_, sizeof(bytes_));
+    other.setInlineSize(0);
+  }
+
+  CompactPathStorage& operator=(const CompactPathStorage& other) {
+    if (this != &other) {
+      *this = CompactPathStorage{other};
+    }
+    return *this;
+  }
+
+  CompactPathStorage& operator=(CompactPathStorage&& other) noexcept {
+    if (this != &other) {
+      freeHeap();
+      std::memcpy(bytes_, other.bytes_, sizeof(bytes_));
+      other.setInlineSize(0);
+    }
+    return *this;
+  }
+
+  ~CompactPathStorage() {
+    freeHeap();
+  }
+
+  bool isInline() const {
+    return tag() <= kInlineCapacity;
+  }
+
+  const char* data() const {
+    if (isInline()) {
+      return bytes_;
+    }
+    if (tag() == kArenaTag) {
+      return arenaBlock()->names() + field<uint32_t>(sizeof(char*));
+    }
+    return heapData();
+  }
+
+  size_t size() const {
+    if (isInline()) {
+      return kInlineCapacity - tag();
+    }
+    if (tag() == kArenaTag) {
+      return field<uint16_t>(sizeof(char*) + sizeof(uint32_t));
+    }
+    return field<uint32_t>(sizeof(char*));
+  }
+
+  /* implicit */ operator folly::StringPiece() const {
+    return folly::StringPiece{data(), size()};
+  }
+
+ private:
+  friend class facebook::eden::PathComponentArena;
+
+  static constexpr size_t kTagIndex = 15;
+  static constexpr uint8_t kHeapTag = 0xff;
+  static constexpr uint8_t kArenaTag = 0xfe;
+
+  /**
+   * Reference a name of an arena block, taking a reference on the block.
+   */
+  CompactPathStorage(PathArenaBlock* block, uint32_t offset, uint16_t size);
+
+  void assign(const char* data, size_t size);
+
+  uint8_t tag() const {
+    return static_cast<uint8_t>(bytes_[kTagIndex]);
+  }
+
+  template <typename T>
+  T field(size_t offset) const {
+    T value;
+    std::memcpy(&value, bytes_ + offset, sizeof(value));
+    return value;
+  }
+
+  PathArenaBlock* arenaBlock() const {
+    return field<PathArenaBlock*>(0);
+  }
+
+  void setInlineSize(size_t size) {
+    bytes_[kTagIndex] = static_cast<char>(kInlineCapacity - size);
+  }
+
+  char* heapData() const {
+    return field<char*>(0);
+  }
+
+  void freeHeap() {
+    if (isInline()) {
+      return;
+    }
+    if (tag() == kArenaTag) {
+      releaseArenaBlock(arenaBlock());
+    } else {
+      delete[] heapData();
+    }
+    setInlineSize(0);
+  }
+
+  static void releaseArenaBlock(PathArenaBlock* block);
+
+  char bytes_[16];
+};
+
+static_assert(sizeof(CompactPathStorage) == 16);
+
+} // namespace detail
+
 // Intentionally use folly::fbstring because Dir entries are keyed on
 // PathComponent and the fact that folly::fbstring is 24 bytes and std::string
 // is 32 bytes adds up.
 using PathComponent = detail::PathComponentBase<folly::fbstring>;
 using PathComponentPiece = detail::PathComponentBase<folly::StringPiece>;
 
+/**
+ * A PathComponent that uses CompactPathStorage, for containers that hold a
+ * large number of names, like the TreeInode entries. It converts to a
+ * PathComponentPiece and compares like a PathComponent.
+ */
+using CompactPathComponent =
+    detail::PathComponentBase<detail::CompactPathStorage>;
+
+/**
+ * Copies the names of a directory loaded at once, like the entries of a Tree
+ * loaded into a TreeInode, into CompactPathComponents.
+ *
+ * The names that do not fit inline are packed into a single block, rather
+ * than one heap allocation each. Each name holds a reference on the block,
+ * so that the names remain valid when entries are moved to other directories
+ * or outlive the arena, and the block is freed in one shot with its last
+ * name.
+ */
+class PathComponentArena {
+ public:
+  /**
+   * Reserve room for `capacity` bytes of long names. Use
+   * getReservation() to compute it.
+   */
+  explicit PathComponentArena(size_t capacity);
+  ~PathComponentArena();
+
+  PathComponentArena(const PathComponentArena&) = delete;
+  PathComponentArena& operator=(const PathComponentArena&) = delete;
+
+  /**
+   * The number of bytes of the arena that `name` would use.
+   */
+  static size_t getReservation(folly::StringPiece name);
+
+  /**
+   * Copy a name, inline if it fits, into the block if there is room left, or
+   * on the heap otherwise.
+   */
+  CompactPathComponent copy(PathComponentPiece name);
+
+ private:
+  detail::PathArenaBlock* block_{nullptr};
+  size_t capacity_;
+  size_t used_{0};
+};
+
 using RelativePath = detail::RelativePathBase<std::string>;
 using RelativePathPiece = detail::RelativePathBase<folly::StringPiece>;
 
@@ -200,14 +418,17 @@ namespace detail {
 
 // Helper for equality testing, borrowed from
 // folly::detail::ComparableAsStringPiece in folly/Range.h
+//
+// Stored, and other storages like CompactPathComponent, are implicitly
+// convertible to Piece and compare the same way.
 template <typename A, typename B, typename Stored, typename Piece>
 struct StoredOrPieceComparableAsStringPiece {
   enum {
     value =
         (std::is_convertible<A, folly::StringPiece>::value &&
-         (std::is_same<B, Stored>::value || std::is_same<B, Piece>::value)) ||
+         std::is_convertible<B, Piece>::value) ||
         (std::is_convertible<B, folly::StringPiece>::value &&
-         (std::is_same<A, Stored>::value || std::is_same<A, Piece>::value))
+         std::is_convertible<A, Piece>::value)
   };
 };
 
@@ -364,6 +585,17 @@ class PathBase :
   constexpr explicit PathBase(folly::StringPiece src, SkipPathSanityCheck)
       : path_(src.data(), src.size()) {}
 
+  /** Move construct from a CompactPathStorage built by a
+   * PathComponentArena.
+   * Skips sanity checks.
+   * */
+  template <
+      typename StorageAlias = Storage,
+      typename = typename std::enable_if<
+          std::is_same<StorageAlias, CompactPathStorage>::value>::type>
+  explicit PathBase(CompactPathStorage&& storage, SkipPathSanityCheck)
+      : path_(std::move(storage)) {}
+
   /** Construct from a stored variation of this type.
    * Skips sanity checks. */
   explicit PathBase(const Stored& other)
@@ -465,22 +697,40 @@ class PathBase :
 /// Asserts that val is a well formed path component
 struct PathComponentSanityCheck {
   constexpr void operator()(folly::StringPiece val) const {
-    for (auto c : val) {
-      if (isDirSeparator(c)) {
-        throw PathComponentContainsDirectorySeparator(folly::to<std::string>(
-            "attempt to construct a PathComponent from a string containing a "
-            "directory separator: ",
-            val));
-      }
+    // Most names are plain ASCII, which a vectorized scan recognizes without
+    // the byte at a time loop and UTF-8 validation below.
+    bool isPlain = !isConstantEvaluated() && isPlainPathComponent(val);
+    if (!isPlain) {
+      for (auto c : val) {
+        if (isDirSeparator(c)) {
+          throw PathComponentContainsDirectorySeparator(folly::to<std::string>(
+              "attempt to construct a PathComponent from a string containing "
+              "a directory separator: ",
+              val));
+        }
 
-      if (c == '\0') {
-        throw PathComponentValidationError(folly::to<std::string>(
-            "attempt to construct a PathComponent from a string containing a "
-            "nul byte: ",
-            val));
+        if (c == '\0') {
+          throw PathComponentValidationError(folly::to<std::string>(
+              "attempt to construct a PathComponent from a string containing "
+              "a nul byte: ",
+              val));
+        }
       }
     }
 
+    checkName(val);
+
+    if (!isPlain && !isValidUtf8(val)) {
+      throw PathComponentNotUtf8(folly::to<std::string>(
+          "attempt to construct a PathComponent from non valid UTF8 data: ",
+          val));
+    }
+  }
+
+  /**
+   * Reject the empty, "." and ".." names.
+   */
+  static constexpr void checkName(folly::StringPiece val) {
     switch (val.size()) {
       case 0:
         throw PathComponentValidationError(
@@ -496,12 +746,6 @@ struct PathComponentSanityCheck {
         }
         break;
     }
-
-    if (!isValidUtf8(val)) {
-      throw PathComponentNotUtf8(folly::to<std::string>(
-          "attempt to construct a PathComponent from non valid UTF8 data: ",
-          val));
-    }
   }
 };
 
@@ -989,6 +1233,23 @@ struct ComposedPathSanityCheck {
   }
 
   constexpr void operator()(folly::StringPiece val) const {
+    if (!isConstantEvaluated() && isPlainComposedPath(val)) {
+      // Only the names of the components remain to be checked, which the
+      // separators found with memchr delimit.
+      size_t start = 0;
+      while (true) {
+        auto next = findPathSeparator(val, start);
+        if (next == folly::StringPiece::npos) {
+          PathComponentSanityCheck::checkName(
+              folly::StringPiece{val.begin() + start, val.end()});
+          return;
+        }
+        PathComponentSanityCheck::checkName(
+            folly::StringPiece{val.begin() + start, next - start});
+        start = next + 1;
+      }
+    }
+
     size_t start = 0;
     while (true) {
       auto next = nextSeparator(val, start);
@@ -1982,6 +2243,18 @@ enum class CompareResult {
   AFTER,
 };
 
+/**
+ * Whether a and b are equal, ignoring the case of the ASCII letters. Scans 16
+ * bytes at a time with SSE2 on x86-64.
+ */
+bool equalsCaseInsensitive(folly::StringPiece a, folly::StringPiece b);
+
+/**
+ * A hash of s that ignores the case of the ASCII letters, so that the strings
+ * equalsCaseInsensitive() considers equal hash the same.
+ */
+uint64_t hashCaseInsensitive(folly::StringPiece s);
+
 /**
  * Compare the 2 passed in path based on the case sensitivity.
  *
@@ -2027,6 +2300,24 @@ size_t estimateIndirectMemoryUsage(
     const detail::RelativePathBase<StringType>& path) {
   return estimateIndirectMemoryUsage(path.value());
 }
+
+/**
+ * Gets memory usage of the name outside of the CompactPathStorage. The names
+ * sharing an arena block are each counted for their own bytes.
+ */
+inline size_t estimateIndirectMemoryUsage(
+    const detail::CompactPathStorage& name) {
+  return name.isInline() ? 0 : name.size();
+}
+
+/**
+ * Gets memory usage of the name inside the PathComponentBase
+ */
+template <typename StringType>
+size_t estimateIndirectMemoryUsage(
+    const detail::PathComponentBase<StringType>& name) {
+  return estimateIndirectMemoryUsage(name.value());
+}
 } // namespace eden
 } // namespace facebook
 
@@ -31,6 +31,9 @@ namespace eden {
  *   it is better to pre-sort the data to be inserted.
  * - Since insert and erase operations move the vector contents around,
  *   those operations invalidate iterators.
+ * - Case insensitive maps keep the case-folded hash of each key alongside it,
+ *   so that their case insensitive lookups compare integers rather than fold
+ *   the case of every key they probe.
  */
 template <typename Value, typename Key = PathComponent>
 class PathMap : private folly::fbvector<std::pair<Key, Value>> {
@@ -77,6 +80,10 @@ class PathMap : private folly::fbvector<std::pair<Key, Value>> {
   Compare compare_;
   CaseSensitivity caseSensitive_{kPathMapDefaultCaseSensitive};
 
+  // For case insensitive maps, hashCaseInsensitive() of each key, in the same
+  // order as the entries. Empty for case sensitive maps.
+  folly::fbvector<uint64_t> foldedHashes_;
+
  public:
   // Various type aliases to satisfy container concepts.
   using key_type = Key;
@@ -113,7 +120,7 @@ class PathMap : private folly::fbvector<std::pair<Key, Value>> {
     // O(n) otherwise.  We're fine with the O(n) on the basis that if n is large
     // enough to matter, the cost of iterating will be dwarfed by the cost
     // of growing the storage several times during population.
-    this->reserve(std::distance(first, last));
+    reserve(std::distance(first, last));
     for (; first != last; ++first) {
       insert(*first);
     }
@@ -121,7 +128,9 @@ class PathMap : private folly::fbvector<std::pair<Key, Value>> {
 
   // Inherit the underlying vector copy/assignment.
   PathMap(const PathMap& other)
-      : Vector(other), caseSensitive_(other.caseSensitive_) {}
+      : Vector(other),
+        caseSensitive_(other.caseSensitive_),
+        foldedHashes_(other.foldedHashes_) {}
   PathMap& operator=(const PathMap& other) {
     PathMap(other).swap(*this);
     return *this;
@@ -129,7 +138,9 @@ class PathMap : private folly::fbvector<std::pair<Key, Value>> {
 
   // inherit Move construction.
   PathMap(PathMap&& other) noexcept
-      : Vector(std::move(other)), caseSensitive_(other.caseSensitive_) {}
+      : Vector(std::move(other)),
+        caseSensitive_(other.caseSensitive_),
+        foldedHashes_(std::move(other.foldedHashes_)) {}
   PathMap& operator=(PathMap&& other) {
     other.swap(*this);
     return *this;
@@ -137,23 +148,51 @@ class PathMap : private folly::fbvector<std::pair<Key, Value>> {
 
   // inherit these methods from the underlying vector.
   using Vector::begin;
+  using Vector::capacity;
   using Vector::cbegin;
   using Vector::cend;
-  using Vector::clear;
   using Vector::crbegin;
   using Vector::crend;
   using Vector::empty;
   using Vector::end;
-  using Vector::erase;
   using Vector::max_size;
   using Vector::rbegin;
   using Vector::rend;
   using Vector::size;
 
+  void clear() {
+    Vector::clear();
+    foldedHashes_.clear();
+  }
+
+  void reserve(size_type n) {
+    Vector::reserve(n);
+    if (caseSensitive_ == CaseSensitivity::Insensitive) {
+      foldedHashes_.reserve(n);
+    }
+  }
+
+  iterator erase(const_iterator pos) {
+    if (caseSensitive_ == CaseSensitivity::Insensitive) {
+      foldedHashes_.erase(foldedHashes_.begin() + (pos - cbegin()));
+    }
+    return Vector::erase(pos);
+  }
+
+  iterator erase(const_iterator first, const_iterator last) {
+    if (caseSensitive_ == CaseSensitivity::Insensitive) {
+      foldedHashes_.erase(
+          foldedHashes_.begin() + (first - cbegin()),
+          foldedHashes_.begin() + (last - cbegin()));
+    }
+    return Vector::erase(first, last);
+  }
+
   // Swap contents with another map.
   void swap(PathMap& other) noexcept {
     Vector::swap(other);
     std::swap(caseSensitive_, other.caseSensitive_);
+    foldedHashes_.swap(other.foldedHashes_);
   }
 
   // lower_bound performs the binary search for locating keys.
@@ -178,12 +217,7 @@ class PathMap : private folly::fbvector<std::pair<Key, Value>> {
       // When !caseSensitive_, for performance, we will do a case sensitive
       // search first which should cover most of the cases and if not found then
       // do a case insensitive search.
-      for (iter = begin(); iter != end(); ++iter) {
-        if (key.stringPiece().equals(
-                iter->first.stringPiece(), folly::AsciiCaseInsensitive())) {
-          return iter;
-        }
-      }
+      return begin() + findCaseInsensitive(key);
     }
     return end();
   }
@@ -198,12 +232,7 @@ class PathMap : private folly::fbvector<std::pair<Key, Value>> {
       return iter;
     }
     if (caseSensitive_ == CaseSensitivity::Insensitive) {
-      for (iter = begin(); iter != end(); ++iter) {
-        if (key.stringPiece().equals(
-                iter->first.stringPiece(), folly::AsciiCaseInsensitive())) {
-          return iter;
-        }
-      }
+      return begin() + findCaseInsensitive(key);
     }
     return end();
   }
@@ -221,17 +250,15 @@ class PathMap : private folly::fbvector<std::pair<Key, Value>> {
     }
 
     if (caseSensitive_ == CaseSensitivity::Insensitive) {
-      for (auto insens = begin(); insens != end(); ++insens) {
-        if (val.first.stringPiece().equals(
-                insens->first.stringPiece(), folly::AsciiCaseInsensitive())) {
-          // Found it; leave it alone
-          return std::make_pair(insens, false);
-        }
+      auto insens = begin() + findCaseInsensitive(val.first);
+      if (insens != end()) {
+        // Found it; leave it alone
+        return std::make_pair(insens, false);
       }
     }
 
     // Otherwise, iter is the insertion point
-    return std::make_pair(Vector::insert(iter, val), true);
+    return std::make_pair(insertAt(iter, val), true);
   }
 
   /** Emplace a new key-value pair by constructing it in-place.
@@ -242,26 +269,29 @@ class PathMap : private folly::fbvector<std::pair<Key, Value>> {
    * a boolean that is true if an insert took place. */
   template <typename... Args>
   std::pair<iterator, bool> emplace(Piece key, Args&&... args) {
-    auto iter = lower_bound(key);
-
-    if (iter != end() && !compare_(key, iter->first)) {
+    auto [iter, found] = findInsertionPoint(key);
+    if (found) {
       // Found it; leave it alone
       return std::make_pair(iter, false);
     }
+    iter = insertAt(
+        iter, std::make_pair(Key(key), Value(std::forward<Args>(args)...)));
+    return std::make_pair(iter, true);
+  }
 
-    if (caseSensitive_ == CaseSensitivity::Insensitive) {
-      for (auto insens = begin(); insens != end(); ++insens) {
-        if (key.stringPiece().equals(
-                insens->first.stringPiece(), folly::AsciiCaseInsensitive())) {
-          // Found it; leave it alone
-          return std::make_pair(insens, false);
-        }
-      }
+  /** Emplace a new key-value pair, moving an already built key, such as one
+   * copied by a PathComponentArena, into the map.
+   * Otherwise behaves like emplace(Piece, ...). */
+  template <typename... Args>
+  std::pair<iterator, bool> emplace(Key&& key, Args&&... args) {
+    auto [iter, found] = findInsertionPoint(Piece{key});
+    if (found) {
+      // Found it; leave it alone
+      return std::make_pair(iter, false);
     }
-
-    // Otherwise, iter is the insertion point
-    iter = Vector::emplace(
-        iter, std::make_pair(Key(key), Value(std::forward<Args>(args)...)));
+    iter = insertAt(
+        iter,
+        std::make_pair(std::move(key), Value(std::forward<Args>(args)...)));
     return std::make_pair(iter, true);
   }
 
@@ -277,17 +307,15 @@ class PathMap : private folly::fbvector<std::pair<Key, Value>> {
 
     if (caseSensitive_ == CaseSensitivity::Insensitive) {
       // Case insensitive lookup
-      for (auto insens = begin(); insens != end(); ++insens) {
-        if (key.stringPiece().equals(
-                insens->first.stringPiece(), folly::AsciiCaseInsensitive())) {
-          // Found it
-          return insens->second;
-        }
+      auto insens = begin() + findCaseInsensitive(key);
+      if (insens != end()) {
+        // Found it
+        return insens->second;
       }
     }
 
     // Not yet present, make a new one at the insertion point
-    iter = Vector::insert(iter, std::make_pair(Key(key), mapped_type()));
+    iter = insertAt(iter, std::make_pair(Key(key), mapped_type()));
     return iter->second;
   }
 
@@ -337,6 +365,51 @@ class PathMap : private folly::fbvector<std::pair<Key, Value>> {
     return iter != end();
   }
 
+ private:
+  /** Returns the entry for key and true if it is present, according to the
+   * case sensitivity, or the position to insert it at and false. */
+  std::pair<iterator, bool> findInsertionPoint(Piece key) {
+    auto iter = lower_bound(key);
+
+    if (iter != end() && !compare_(key, iter->first)) {
+      return std::make_pair(iter, true);
+    }
+
+    if (caseSensitive_ == CaseSensitivity::Insensitive) {
+      auto insens = begin() + findCaseInsensitive(key);
+      if (insens != end()) {
+        return std::make_pair(insens, true);
+      }
+    }
+
+    // Otherwise, iter is the insertion point
+    return std::make_pair(iter, false);
+  }
+
+  /** Returns the index of the entry whose key equals key ignoring case, or
+   * size() if there is none. Only valid for case insensitive maps. */
+  size_type findCaseInsensitive(Piece key) const {
+    auto hash = hashCaseInsensitive(key.stringPiece());
+    for (size_type i = 0; i < foldedHashes_.size(); ++i) {
+      if (foldedHashes_[i] == hash &&
+          equalsCaseInsensitive(
+              key.stringPiece(), (cbegin() + i)->first.stringPiece())) {
+        return i;
+      }
+    }
+    return size();
+  }
+
+  /** Inserts pair before pos, keeping foldedHashes_ in step. */
+  iterator insertAt(iterator pos, Pair pair) {
+    if (caseSensitive_ == CaseSensitivity::Insensitive) {
+      foldedHashes_.insert(
+          foldedHashes_.begin() + (pos - begin()),
+          hashCaseInsensitive(Piece{pair.first}.stringPiece()));
+    }
+    return Vector::insert(pos, std::move(pair));
+  }
+
   /// Equality operator.
   template <typename V, typename K>
   friend bool operator==(const PathMap<V, K>& lhs, const PathMap<V, K>& rhs);
@@ -11,6 +11,7 @@
 #include <folly/MapUtil.h>
 #include <folly/MicroLock.h>
 #include <folly/ThreadLocal.h>
+#include <folly/chrono/Clock.h>
 
 #include "eden/fs/utils/ProcessNameCache.h"
 
@@ -19,7 +20,7 @@ namespace eden {
 
 struct ThreadLocalBucket {
   explicit ThreadLocalBucket(ProcessAccessLog* processAccessLog)
-      : state_{folly::in_place, processAccessLog} {}
+      : owner_{processAccessLog} {}
 
   ~ThreadLocalBucket() {
     // This thread is going away, so merge our data into the parent.
@@ -34,12 +35,10 @@ struct ThreadLocalBucket {
       pid_t pid,
       ProcessAccessLog::AccessType type) {
     auto state = state_.lock();
-
-    // isNewPid must be initialized because BucketedLog::add will not call
-    // Bucket::add if secondsSinceStart is too old and the sample is dropped.
-    // (In that case, it's unnecessary to record the process name.)
     bool isNewPid = false;
-    state->buckets.add(secondsSinceStart, pid, isNewPid, type);
+    if (auto* counts = state->getCounts(secondsSinceStart, pid, isNewPid)) {
+      (*counts)[type]++;
+    }
     return isNewPid;
   }
 
@@ -48,27 +47,19 @@ struct ThreadLocalBucket {
       pid_t pid,
       std::chrono::nanoseconds duration) {
     auto state = state_.lock();
-
     bool isNewPid = false;
-    state->buckets.add(secondsSinceStart, pid, isNewPid, duration);
+    if (auto* counts = state->getCounts(secondsSinceStart, pid, isNewPid)) {
+      counts->duration += duration;
+    }
     return isNewPid;
   }
 
   void mergeUpstream() {
     auto state = state_.lock();
-    if (!state->owner) {
-      return;
-    }
-    state->owner->state_.withWLock(
+    owner_->state_.withWLock(
         [&](auto& ownerState) { ownerState.buckets.merge(state->buckets); });
     state->buckets.clear();
-  }
-
-  void clearOwnerIfMe(ProcessAccessLog* owner) {
-    auto state = state_.lock();
-    if (state->owner == owner) {
-      state->owner = nullptr;
-    }
+    state->cachedCounts = nullptr;
   }
 
  private:
@@ -77,17 +68,49 @@ struct ThreadLocalBucket {
    * needs a mechanism to stop writers for the duration of the read.
    *
    * Reading the data (merging up-stream from all of the threads) is
-   * exceptionally rare, so this lock should largely stay uncontended. I
-   * considered using folly::SpinLock, but the documentation strongly suggests
-   * not. I am hoping that acquiring an uncontended MicroLock
-   * boils down to a single CAS, even though lock xchg can be painful by itself.
+   * exceptionally rare, so this lock should largely stay uncontended, and it
+   * lives in memory only this thread writes otherwise. I considered using
+   * folly::SpinLock, but the documentation strongly suggests not. I am hoping
+   * that acquiring an uncontended MicroLock boils down to a single CAS, even
+   * though lock xchg can be painful by itself.
    *
    * This lock must always be acquired before the owner's buckets lock.
    */
   struct State {
-    explicit State(ProcessAccessLog* pal) : owner{pal} {}
+    /**
+     * Return the counts of the pid in the bucket of the given second, or
+     * nullptr if that second is before the window.
+     *
+     * A filesystem request records several accesses of the same pid, so the
+     * counts of the last pid are remembered until the second changes, saving
+     * a hash table lookup.
+     */
+    ProcessAccessLog::PerBucketAccessCounts*
+    getCounts(uint64_t secondsSinceStart, pid_t pid, bool& isNewPid) {
+      if (cachedCounts && cachedSecond == secondsSinceStart &&
+          cachedPid == pid) {
+        return cachedCounts;
+      }
+      auto* bucket = buckets.getCurrent(secondsSinceStart);
+      if (!bucket) {
+        // The sample is dropped, so it's unnecessary to record the process
+        // name.
+        return nullptr;
+      }
+      auto [it, inserted] = bucket->accessCountsByPid.emplace(
+          pid, ProcessAccessLog::PerBucketAccessCounts{});
+      isNewPid = inserted;
+      cachedSecond = secondsSinceStart;
+      cachedPid = pid;
+      // The map is node-based, so the counts don't move on rehash.
+      cachedCounts = &it->second;
+      return cachedCounts;
+    }
+
     ProcessAccessLog::Buckets buckets;
-    ProcessAccessLog* owner;
+    uint64_t cachedSecond = 0;
+    pid_t cachedPid = 0;
+    ProcessAccessLog::PerBucketAccessCounts* cachedCounts = nullptr;
   };
 
   struct InitedMicroLock : folly::MicroLock {
@@ -95,36 +118,15 @@ struct ThreadLocalBucket {
       init();
     }
   };
+
+  ProcessAccessLog* const owner_;
   folly::Synchronized<State, InitedMicroLock> state_;
 };
 
-namespace {
-struct BucketTag;
-folly::ThreadLocalPtr<ThreadLocalBucket, BucketTag> threadLocalBucketPtr;
-} // namespace
-
 void ProcessAccessLog::Bucket::clear() {
   accessCountsByPid.clear();
 }
 
-void ProcessAccessLog::Bucket::add(
-    pid_t pid,
-    bool& isNewPid,
-    ProcessAccessLog::AccessType type) {
-  auto [it, contains] = accessCountsByPid.emplace(pid, PerBucketAccessCounts{});
-  it->second[type]++;
-  isNewPid = contains;
-}
-
-void ProcessAccessLog::Bucket::add(
-    pid_t pid,
-    bool& isNewPid,
-    std::chrono::nanoseconds duration) {
-  auto [it, contains] = accessCountsByPid.emplace(pid, PerBucketAccessCounts{});
-  it->second.duration += duration;
-  isNewPid = contains;
-}
-
 void ProcessAccessLog::Bucket::merge(const Bucket& other) {
   for (auto [pid, otherAccessCounts] : other.accessCountsByPid) {
     for (std::underlying_type_t<AccessType> type = 0;
@@ -138,28 +140,18 @@ void ProcessAccessLog::Bucket::merge(const Bucket& other) {
 
 ProcessAccessLog::ProcessAccessLog(
     std::shared_ptr<ProcessNameCache> processNameCache)
-    : processNameCache_{std::move(processNameCache)} {
+    : processNameCache_{std::move(processNameCache)},
+      threadLocalBuckets_{[this] { return new ThreadLocalBucket{this}; }} {
   XCHECK(processNameCache_) << "Process name cache is mandatory";
 }
 
-ProcessAccessLog::~ProcessAccessLog() {
-  for (auto& tlb : threadLocalBucketPtr.accessAllThreads()) {
-    tlb.clearOwnerIfMe(this);
-  }
-}
-
-ThreadLocalBucket* ProcessAccessLog::getTlb() {
-  auto tlb = threadLocalBucketPtr.get();
-  if (!tlb) {
-    threadLocalBucketPtr.reset(std::make_unique<ThreadLocalBucket>(this));
-    tlb = threadLocalBucketPtr.get();
-  }
-  return tlb;
-}
+ProcessAccessLog::~ProcessAccessLog() = default;
 
 uint64_t ProcessAccessLog::getSecondsSinceEpoch() {
+  // Buckets are whole seconds, so the coarse clock is precise enough, and it
+  // is read without a system call.
   return std::chrono::duration_cast<std::chrono::seconds>(
-             std::chrono::steady_clock::now().time_since_epoch())
+             folly::chrono::coarse_steady_clock::now().time_since_epoch())
       .count();
 }
 
@@ -170,7 +162,7 @@ void ProcessAccessLog::recordAccess(
   // write-often, read-rarely use case, so, to avoid synchronization overhead,
   // record to thread-local storage and only merge into the access log when the
   // calling thread dies or when the data must be read.
-  bool isNewPid = getTlb()->add(getSecondsSinceEpoch(), pid, type);
+  bool isNewPid = threadLocalBuckets_->add(getSecondsSinceEpoch(), pid, type);
 
   // Many processes are short-lived, so grab the executable name during the
   // access. We could potentially get away with grabbing executable names a
@@ -193,7 +185,8 @@ void ProcessAccessLog::recordAccess(
 void ProcessAccessLog::recordDuration(
     pid_t pid,
     std::chrono::nanoseconds duration) {
-  bool isNewPid = getTlb()->add(getSecondsSinceEpoch(), pid, duration);
+  bool isNewPid =
+      threadLocalBuckets_->add(getSecondsSinceEpoch(), pid, duration);
   if (pid != 0 && isNewPid) {
     processNameCache_->add(pid);
   }
@@ -202,8 +195,8 @@ void ProcessAccessLog::recordDuration(
 std::unordered_map<pid_t, AccessCounts> ProcessAccessLog::getAccessCounts(
     std::chrono::seconds lastNSeconds) {
   auto secondCount = lastNSeconds.count();
-  // First, merge all the thread-local buckets into their owners, including us.
-  for (auto& tlb : threadLocalBucketPtr.accessAllThreads()) {
+  // First, merge all the thread-local buckets into ours.
+  for (auto& tlb : threadLocalBuckets_.accessAllThreads()) {
     // This must be done outside of acquiring our own state_ lock.
     tlb.mergeUpstream();
   }
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <folly/Synchronized.h>
+#include <folly/ThreadLocal.h>
 #include <type_traits>
 
 #include "eden/fs/service/gen-cpp2/eden_types.h"
@@ -24,10 +25,9 @@ struct ThreadLocalBucket;
  * An inexpensive mechanism for counting accesses by pids. Intended for counting
  * channel and Thrift calls from external processes.
  *
- * The first time a thread calls recordAccess, that thread is then coupled to
- * this particular ProcessAccessLog, even if it calls recordAccess on another
- * ProcessAccessLog instance. Thus, use one ProcessAccessLog per pool of
- * threads.
+ * Each thread records into its own buckets, which are only merged into the
+ * log when the thread exits or when the counts are read, so that recording
+ * never touches a cache line shared with other threads.
  */
 class ProcessAccessLog {
  public:
@@ -44,10 +44,11 @@ class ProcessAccessLog {
   explicit ProcessAccessLog(std::shared_ptr<ProcessNameCache> processNameCache);
   ~ProcessAccessLog();
 
+  ProcessAccessLog(const ProcessAccessLog&) = delete;
+  ProcessAccessLog& operator=(const ProcessAccessLog&) = delete;
+
   /**
-   * Records an access by a process ID. The first call to recordAccess by a
-   * particular thread binds that thread to this access log. Future recordAccess
-   * calls on that thread will accumulate within this access log.
+   * Records an access by a process ID.
    *
    * Process IDs passed to recordAccess are also inserted into the
    * ProcessNameCache.
@@ -81,8 +82,6 @@ class ProcessAccessLog {
   // Data for one second.
   struct Bucket {
     void clear();
-    void add(pid_t pid, bool& isNew, AccessType type);
-    void add(pid_t pid, bool& isNew, std::chrono::nanoseconds duration);
     void merge(const Bucket& other);
 
     std::unordered_map<pid_t, PerBucketAccessCounts> accessCountsByPid;
@@ -97,11 +96,15 @@ class ProcessAccessLog {
     Buckets buckets;
   };
 
+  struct BucketTag;
+
   const std::shared_ptr<ProcessNameCache> processNameCache_;
   folly::Synchronized<State> state_;
+  // Declared after state_, so that the buckets of the live threads are merged
+  // into it on destruction.
+  folly::ThreadLocal<ThreadLocalBucket, BucketTag> threadLocalBuckets_;
 
   uint64_t getSecondsSinceEpoch();
-  ThreadLocalBucket* getTlb();
 
   friend struct ThreadLocalBucket;
 };
@@ -7,6 +7,8 @@
 
 #include "eden/fs/utils/ProcessNameCache.h"
 
+#include <algorithm>
+#include <deque>
 #include <optional>
 #include <vector>
 
@@ -218,8 +220,14 @@ std::string readPidName(pid_t pid) {
 namespace facebook {
 namespace eden {
 
-ProcessNameCache::ProcessNameCache(std::chrono::nanoseconds expiry)
-    : expiry_{expiry}, startPoint_{std::chrono::steady_clock::now()} {
+ProcessNameCache::ProcessNameCache(
+    std::chrono::nanoseconds expiry,
+    size_t maxSize,
+    size_t maxResolutionsPerSecond)
+    : expiry_{expiry},
+      maxSize_{std::max<size_t>(maxSize, 1)},
+      maxResolutionsPerSecond_{maxResolutionsPerSecond},
+      startPoint_{std::chrono::steady_clock::now()} {
   workerThread_ = std::thread{[this] {
     folly::setThreadName("ProcessNameCacheWorker");
     processActions();
@@ -281,7 +289,10 @@ void ProcessNameCache::add(pid_t pid) {
         return std::nullopt;
       },
       [&](auto& wlock) -> folly::Unit {
-        auto [iter, inserted] = wlock->addQueue.insert(pid);
+        auto [iter, inserted] = wlock->queuedPids.insert(pid);
+        if (inserted) {
+          wlock->addQueue.push_back(pid);
+        }
         wlock.unlock();
         if (inserted) {
           sem_.post();
@@ -317,16 +328,56 @@ void ProcessNameCache::clearExpired(
   }
 }
 
+void ProcessNameCache::evictLeastRecentlyUsed(State& state) {
+  std::vector<std::pair<std::chrono::steady_clock::duration, pid_t>> byAccess;
+  byAccess.reserve(state.names.size());
+  for (const auto& [pid, name] : state.names) {
+    byAccess.emplace_back(
+        name.lastAccess.load(std::memory_order_seq_cst), pid);
+  }
+
+  auto keep = maxSize_ - maxSize_ / 8;
+  if (byAccess.size() <= keep) {
+    return;
+  }
+  auto evicted = byAccess.begin() + (byAccess.size() - keep);
+  std::nth_element(byAccess.begin(), evicted, byAccess.end());
+  for (auto it = byAccess.begin(); it != evicted; ++it) {
+    state.names.erase(it->second);
+  }
+}
+
 void ProcessNameCache::processActions() {
   // Double-buffered work queues.
-  folly::F14FastSet<pid_t> addQueue;
+  std::vector<pid_t> addQueue;
   std::vector<folly::Promise<std::map<pid_t, std::string>>> getQueue;
 
+  // The pids waiting to be read, the ones seen most recently last. They are
+  // read newest first: the usual reason for failing to read a name is that
+  // the process already exited, and the pids seen first are the likeliest to
+  // be gone.
+  std::deque<pid_t> pending;
+
+  // A token bucket holding up to one second worth of reads.
+  const bool rateLimited = maxResolutionsPerSecond_ != 0;
+  const double rate = maxResolutionsPerSecond_;
+  double tokens = rate;
+  auto lastRefill = std::chrono::steady_clock::now();
+
   for (;;) {
     addQueue.clear();
     getQueue.clear();
 
-    sem_.wait();
+    // With pids left over from the previous pass, only sleep until the next
+    // read is allowed.
+    bool woken = true;
+    if (pending.empty()) {
+      sem_.wait();
+    } else {
+      woken = sem_.try_wait_for(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::duration<double>{(1 - tokens) / rate}));
+    }
 
     {
       auto state = state_.wlock();
@@ -342,16 +393,40 @@ void ProcessNameCache::processActions() {
       getQueue.swap(state->getQueue);
     }
 
-    // sem_.wait() consumed one count, but we know addQueue.size() +
-    // getQueue.size() + (maybe done) were added. Since we will process all
+    // addQueue.size() + getQueue.size() + (maybe done) were posted, and
+    // sem_.wait() consumed one count if it woke up. Since we will process all
     // entries at once, rather than waking repeatedly, consume the rest.
-    if (addQueue.size() + getQueue.size()) {
-      (void)sem_.tryWait(addQueue.size() + getQueue.size() - 1);
+    size_t posted = addQueue.size() + getQueue.size();
+    if (woken && posted > 0) {
+      --posted;
+    }
+    if (posted > 0) {
+      (void)sem_.tryWait(posted);
+    }
+
+    pending.insert(pending.end(), addQueue.begin(), addQueue.end());
+    std::vector<pid_t> droppedPids;
+    while (pending.size() > maxSize_) {
+      droppedPids.push_back(pending.front());
+      pending.pop_front();
+    }
+    droppedPids_.fetch_add(droppedPids.size(), std::memory_order_relaxed);
+
+    size_t readCount = pending.size();
+    if (rateLimited) {
+      auto now = std::chrono::steady_clock::now();
+      tokens = std::min(
+          rate,
+          tokens + std::chrono::duration<double>{now - lastRefill}.count() *
+              rate);
+      lastRefill = now;
+      readCount = std::min(readCount, static_cast<size_t>(tokens));
+      tokens -= readCount;
     }
 
-    // Process all additions before any gets so none are missed. It does mean
-    // add(1), get(), add(2), get() processed all at once would return both
-    // 1 and 2 from both get() calls.
+    // Process all the additions allowed by the rate before any gets so none
+    // are missed. It does mean add(1), get(), add(2), get() processed all at
+    // once would return both 1 and 2 from both get() calls.
     //
     // TODO: It might be worth skipping this during ProcessNameCache shutdown,
     // even if it did mean any pending get() calls could miss pids added prior.
@@ -359,16 +434,23 @@ void ProcessNameCache::processActions() {
     // As described in ProcessNameCache::add() above, it is critical this work
     // be done outside of the state lock.
     std::vector<std::pair<pid_t, std::string>> addedNames;
-    for (auto pid : addQueue) {
+    addedNames.reserve(readCount);
+    for (size_t i = 0; i < readCount; ++i) {
+      auto pid = pending.back();
+      pending.pop_back();
       addedNames.emplace_back(pid, detail::readPidName(pid));
     }
 
     auto now = std::chrono::steady_clock::now() - startPoint_;
 
     // Now insert any new names into the synchronized data structure.
-    if (!addedNames.empty()) {
+    if (!addedNames.empty() || !droppedPids.empty()) {
       auto state = state_.wlock();
+      for (auto pid : droppedPids) {
+        state->queuedPids.erase(pid);
+      }
       for (auto& [pid, name] : addedNames) {
+        state->queuedPids.erase(pid);
         state->names.emplace(pid, ProcessName{std::move(name), now});
       }
 
@@ -382,6 +464,9 @@ void ProcessNameCache::processActions() {
         clearExpired(now, *state);
         state->waterLevel = 0;
       }
+      if (state->names.size() > maxSize_) {
+        evictLeastRecentlyUsed(*state);
+      }
     }
 
     if (!getQueue.empty()) {
@@ -12,6 +12,7 @@
 #include <folly/futures/Promise.h>
 #include <folly/synchronization/LifoSem.h>
 #include <sys/types.h>
+#include <atomic>
 #include <chrono>
 #include <map>
 #include <optional>
@@ -23,12 +24,22 @@ namespace eden {
 
 class ProcessNameCache {
  public:
+  static constexpr size_t kDefaultMaxSize = 4096;
+  static constexpr size_t kDefaultMaxResolutionsPerSecond = 1000;
+
   /**
    * Create a cache that maintains process names until `expiry` has elapsed
    * without them being referenced or observed.
+   *
+   * At most `maxSize` names are kept, the ones referenced least recently
+   * being forgotten first, and at most `maxResolutionsPerSecond` names are
+   * read, or any number if it is 0. The pids waiting to be read are bounded
+   * to `maxSize` too: past it, the pids seen first are dropped.
    */
   explicit ProcessNameCache(
-      std::chrono::nanoseconds expiry = std::chrono::minutes{5});
+      std::chrono::nanoseconds expiry = std::chrono::minutes{5},
+      size_t maxSize = kDefaultMaxSize,
+      size_t maxResolutionsPerSecond = kDefaultMaxResolutionsPerSecond);
 
   ~ProcessNameCache();
 
@@ -61,6 +72,14 @@ class ProcessNameCache {
    */
   std::optional<std::string> getSpacedProcessName(pid_t pid);
 
+  /**
+   * The number of pids dropped unread because more new pids were seen than
+   * could be read at the configured rate.
+   */
+  uint64_t getDroppedPidCount() const {
+    return droppedPids_.load(std::memory_order_relaxed);
+  }
+
  private:
   struct ProcessName {
     ProcessName(std::string n, std::chrono::steady_clock::duration d)
@@ -87,17 +106,31 @@ class ProcessNameCache {
     size_t waterLevel = 0;
 
     bool workerThreadShouldStop = false;
-    folly::F14FastSet<pid_t> addQueue;
+
+    // The pids seen in their order, and all the pids waiting to be read,
+    // including the ones the worker thread took from addQueue.
+    std::vector<pid_t> addQueue;
+    folly::F14FastSet<pid_t> queuedPids;
     std::vector<folly::Promise<std::map<pid_t, std::string>>> getQueue;
   };
 
   void clearExpired(std::chrono::steady_clock::duration now, State& state);
+
+  /**
+   * Forget the names referenced least recently, down to 7/8 of maxSize_ so
+   * that the cost of the pass is amortized over many insertions.
+   */
+  void evictLeastRecentlyUsed(State& state);
+
   void processActions();
 
   const std::chrono::nanoseconds expiry_;
+  const size_t maxSize_;
+  const size_t maxResolutionsPerSecond_;
   const std::chrono::steady_clock::time_point startPoint_;
   folly::Synchronized<State> state_;
   folly::LifoSem sem_;
+  std::atomic<uint64_t> droppedPids_{0};
   std::thread workerThread_;
 };
 
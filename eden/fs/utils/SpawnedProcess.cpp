@@ -443,21 +443,37 @@ SpawnedProcess::SpawnedProcess(
     posix_spawn_file_actions_destroy(&actions);
   };
 
-  // Reset signals to default for the child process
-  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGDEF);
+  // Reset signals to default for the child process.
+  short flags = POSIX_SPAWN_SETSIGDEF;
+#ifdef POSIX_SPAWN_USEVFORK
+  // glibc older than 2.24 forks unless asked otherwise, which copies the page
+  // tables of our large address space. Newer versions always use a vfork
+  // style clone and ignore this flag.
+  flags |= POSIX_SPAWN_USEVFORK;
+#endif
+  posix_spawnattr_setflags(&attr, flags);
 
   // We make a copy because posix_spawnp requires that the argv be non-const.
   // In addition, if combining chdir and executablePath we need to modify the
   // argv array.
   std::vector<std::string> argStrings = args;
 
+  bool chdirWithShell = options.cwd_.has_value();
+#if defined(__GLIBC__) && \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29))
   if (options.cwd_.has_value()) {
+    // glibc 2.29 added posix_spawn_file_actions_addchdir_np, following
+    // Solaris 11.3, which saves spawning a shell to change directory.
+    checkPosixError(
+        posix_spawn_file_actions_addchdir_np(&actions, options.cwd_->c_str()),
+        "posix_spawn_file_actions_addchdir_np");
+    chdirWithShell = false;
+  }
+#endif
+
+  if (chdirWithShell) {
     // There isn't a portably defined way to inform posix_spawn to use an
-    // alternate cwd.
-    //
-    // Solaris 11.3 lead the way with posix_spawn_file_actions_addchdir_np(3C).
-    // glibc added support for this same function in 2.29, but that isn't yet
-    // in wide circulation.  macOS doesn't have any functions for this.
+    // alternate cwd, and macOS doesn't have any functions for this.
     //
     // Instead, the recommendation for a multi-threaded program is to spawn a
     // helper child process that will perform the chdir and then exec the final
@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/utils/ThreadPlacement.h"
+
+#ifdef __linux__
+#include <sched.h>
+#endif // __linux__
+
+#include <array>
+#include <atomic>
+#include <utility>
+
+#include <fmt/format.h>
+#include <folly/Conv.h>
+#include <folly/FileUtil.h>
+#include <folly/String.h>
+#include <folly/logging/xlog.h>
+
+namespace facebook::eden {
+
+namespace {
+
+constexpr std::array<std::pair<ThreadPlacement, folly::StringPiece>, 4>
+    kThreadPlacementNames{{
+        {ThreadPlacement::None, "none"},
+        {ThreadPlacement::Spread, "spread"},
+        {ThreadPlacement::Pack, "pack"},
+        {ThreadPlacement::PerNode, "per-node"},
+    }};
+
+#ifdef __linux__
+/**
+ * Parse a sysfs CPU or node list, such as "0-23,48-71".
+ */
+std::vector<int> parseCpuList(folly::StringPiece list) {
+  std::vector<int> cpus;
+  std::vector<folly::StringPiece> ranges;
+  folly::split(',', folly::trimWhitespace(list), ranges);
+  for (auto range : ranges) {
+    if (range.empty()) {
+      continue;
+    }
+    folly::StringPiece first, last;
+    if (!folly::split('-', range, first, last)) {
+      first = last = range;
+    }
+    auto begin = folly::tryTo<int>(first);
+    auto end = folly::tryTo<int>(last);
+    if (!begin || !end) {
+      return {};
+    }
+    for (int cpu = *begin; cpu <= *end; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+std::vector<int> readCpuList(const std::string& path) {
+  std::string contents;
+  if (!folly::readFile(path.c_str(), contents)) {
+    return {};
+  }
+  return parseCpuList(contents);
+}
+
+CpuTopology detectTopology() {
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    return CpuTopology{std::vector<std::vector<int>>{}};
+  }
+  auto isAllowed = [&](int cpu) {
+    return cpu >= 0 && cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed);
+  };
+
+  std::vector<std::vector<int>> nodes;
+  for (auto node : readCpuList("/sys/devices/system/node/online")) {
+    std::vector<int> cpus;
+    for (auto cpu : readCpuList(
+             fmt::format("/sys/devices/system/node/node{}/cpulist", node))) {
+      if (isAllowed(cpu)) {
+        cpus.push_back(cpu);
+      }
+    }
+    nodes.push_back(std::move(cpus));
+  }
+
+  if (nodes.empty()) {
+    // Kernels built without NUMA support have no node directory.
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (isAllowed(cpu)) {
+        cpus.push_back(cpu);
+      }
+    }
+    nodes.push_back(std::move(cpus));
+  }
+  return CpuTopology{std::move(nodes)};
+}
+#else
+CpuTopology detectTopology() {
+  return CpuTopology{std::vector<std::vector<int>>{}};
+}
+#endif // __linux__
+
+} // namespace
+
+folly::Expected<ThreadPlacement, std::string> parseThreadPlacement(
+    folly::StringPiece name) {
+  for (const auto& [placement, placementName] : kThreadPlacementNames) {
+    if (name.equals(placementName, folly::AsciiCaseInsensitive())) {
+      return placement;
+    }
+  }
+  return folly::makeUnexpected(fmt::format(
+      "Failed to convert value '{}' to a ThreadPlacement; expected none, "
+      "spread, pack or per-node.",
+      name));
+}
+
+folly::StringPiece threadPlacementName(ThreadPlacement placement) {
+  for (const auto& [value, name] : kThreadPlacementNames) {
+    if (value == placement) {
+      return name;
+    }
+  }
+  return "unknown";
+}
+
+CpuTopology::CpuTopology(std::vector<std::vector<int>> nodes) {
+  for (auto& node : nodes) {
+    if (!node.empty()) {
+      nodes_.push_back(std::move(node));
+    }
+  }
+
+  for (const auto& node : nodes_) {
+    packed_.insert(packed_.end(), node.begin(), node.end());
+  }
+  for (size_t i = 0; spread_.size() < packed_.size(); ++i) {
+    for (const auto& node : nodes_) {
+      if (i < node.size()) {
+        spread_.push_back(node[i]);
+      }
+    }
+  }
+}
+
+const CpuTopology& CpuTopology::get() {
+  static const CpuTopology topology = detectTopology();
+  return topology;
+}
+
+std::vector<int> CpuTopology::cpusForThread(
+    ThreadPlacement placement,
+    size_t index) const {
+  if (nodes_.empty()) {
+    return {};
+  }
+  switch (placement) {
+    case ThreadPlacement::None:
+      return {};
+    case ThreadPlacement::Spread:
+      return {spread_[index % spread_.size()]};
+    case ThreadPlacement::Pack:
+      return {packed_[index % packed_.size()]};
+    case ThreadPlacement::PerNode:
+      return nodes_[index % nodes_.size()];
+  }
+  return {};
+}
+
+void placeCurrentThread(ThreadPlacement placement) {
+  if (placement == ThreadPlacement::None) {
+    return;
+  }
+  static std::atomic<size_t> nextIndex{0};
+  auto index = nextIndex.fetch_add(1, std::memory_order_relaxed);
+  auto cpus = CpuTopology::get().cpusForThread(placement, index);
+  if (cpus.empty()) {
+    return;
+  }
+#ifdef __linux__
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto cpu : cpus) {
+    CPU_SET(cpu, &set);
+  }
+  if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+    // The thread keeps running wherever the kernel schedules it.
+    XLOG(WARN) << "unable to apply the " << threadPlacementName(placement)
+               << " thread placement: " << folly::errnoStr(errno);
+  }
+#endif // __linux__
+}
+
+std::thread PlacedThreadFactory::newThread(folly::Func&& func) {
+  return delegate_->newThread(
+      [placement = placement_, func = std::move(func)]() mutable {
+        placeCurrentThread(placement);
+        func();
+      });
+}
+
+} // namespace facebook::eden
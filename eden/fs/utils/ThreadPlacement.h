@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Expected.h>
+#include <folly/Range.h>
+#include <folly/executors/thread_factory/ThreadFactory.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace facebook::eden {
+
+/**
+ * Where the threads of a pool run on a host with several NUMA nodes. A
+ * request handled on one socket and continued on another misses in the
+ * caches the first one warmed, such as the ObjectCache's entries.
+ */
+enum class ThreadPlacement {
+  /**
+   * Let the kernel schedule the threads anywhere.
+   */
+  None,
+  /**
+   * Pin each thread to its own CPU, alternating between the NUMA nodes, so
+   * that a pool uses the memory bandwidth of every node.
+   */
+  Spread,
+  /**
+   * Pin each thread to its own CPU, filling a NUMA node before using the
+   * next one, so that a small pool shares one node's caches.
+   */
+  Pack,
+  /**
+   * Split the pool into one group of threads per NUMA node, each of which
+   * may run on any CPU of its node.
+   */
+  PerNode,
+};
+
+folly::Expected<ThreadPlacement, std::string> parseThreadPlacement(
+    folly::StringPiece name);
+
+folly::StringPiece threadPlacementName(ThreadPlacement placement);
+
+/**
+ * The CPUs of each NUMA node that this process may run on.
+ */
+class CpuTopology {
+ public:
+  /**
+   * Nodes without any CPU are ignored.
+   */
+  explicit CpuTopology(std::vector<std::vector<int>> nodes);
+
+  /**
+   * The topology of this host, read once from sysfs. Hosts on which it
+   * cannot be read have a single node, or none outside of Linux.
+   */
+  static const CpuTopology& get();
+
+  const std::vector<std::vector<int>>& nodes() const {
+    return nodes_;
+  }
+
+  /**
+   * The CPUs the index'th placed thread may run on, or an empty vector
+   * when it may run anywhere. Indices past the number of CPUs, or of nodes
+   * for PerNode, wrap around.
+   */
+  std::vector<int> cpusForThread(ThreadPlacement placement, size_t index)
+      const;
+
+ private:
+  std::vector<std::vector<int>> nodes_;
+  // Every CPU, one node after the other.
+  std::vector<int> packed_;
+  // Every CPU, taking one from each node in turn.
+  std::vector<int> spread_;
+};
+
+/**
+ * Restrict the calling thread to the CPUs of cpusForThread(placement, index)
+ * on this host, where index is taken from a cursor shared by every thread of
+ * the process, so that the threads of different pools are not all placed on
+ * the first CPUs. Does nothing for ThreadPlacement::None, or where thread
+ * affinity is not supported.
+ */
+void placeCurrentThread(ThreadPlacement placement);
+
+/**
+ * Places each of the threads it creates through a delegate factory.
+ */
+class PlacedThreadFactory : public folly::ThreadFactory {
+ public:
+  PlacedThreadFactory(
+      std::shared_ptr<folly::ThreadFactory> delegate,
+      ThreadPlacement placement)
+      : delegate_{std::move(delegate)}, placement_{placement} {}
+
+  std::thread newThread(folly::Func&& func) override;
+
+ private:
+  std::shared_ptr<folly::ThreadFactory> delegate_;
+  const ThreadPlacement placement_;
+};
+
+} // namespace facebook::eden
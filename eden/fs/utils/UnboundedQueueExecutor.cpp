@@ -24,6 +24,11 @@ UnboundedQueueExecutor::UnboundedQueueExecutor(
               folly::CPUThreadPoolExecutor::CPUTask>>(),
           std::make_unique<folly::NamedThreadFactory>(threadNamePrefix))} {}
 
+UnboundedQueueExecutor::UnboundedQueueExecutor(
+    std::unique_ptr<folly::CPUThreadPoolExecutor> executor)
+    : executor_{std::move(executor)},
+      numPriorities_{executor_->getNumPriorities()} {}
+
 UnboundedQueueExecutor::UnboundedQueueExecutor(
     std::shared_ptr<folly::ManualExecutor> executor)
     : executor_{std::move(executor)} {}
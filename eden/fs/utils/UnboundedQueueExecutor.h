@@ -11,8 +11,9 @@
 #include <folly/Range.h>
 
 namespace folly {
+class CPUThreadPoolExecutor;
 class ManualExecutor;
-}
+} // namespace folly
 
 namespace facebook {
 namespace eden {
@@ -34,6 +35,13 @@ class UnboundedQueueExecutor : public folly::Executor {
       size_t threadCount,
       folly::StringPiece threadNamePrefix);
 
+  /**
+   * Takes over a CPUThreadPoolExecutor, which must have been created with an
+   * unbounded queue.
+   */
+  explicit UnboundedQueueExecutor(
+      std::unique_ptr<folly::CPUThreadPoolExecutor> executor);
+
   /**
    * ManualExecutors are unbounded too.
    *
@@ -51,8 +59,24 @@ class UnboundedQueueExecutor : public folly::Executor {
     executor_->add(std::move(func));
   }
 
+  /**
+   * Executors without priorities run the function like add().
+   */
+  void addWithPriority(folly::Func func, int8_t priority) override {
+    if (numPriorities_ > 1) {
+      executor_->addWithPriority(std::move(func), priority);
+    } else {
+      executor_->add(std::move(func));
+    }
+  }
+
+  uint8_t getNumPriorities() const override {
+    return numPriorities_;
+  }
+
  private:
   std::shared_ptr<folly::Executor> executor_;
+  uint8_t numPriorities_{1};
 };
 
 } // namespace eden
@@ -7,10 +7,50 @@
 
 #include "eden/fs/utils/Utf8.h"
 #include <folly/Unicode.h>
+#include <folly/lang/Bits.h>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define EDEN_UTF8_SSE2
+#endif
 
 namespace facebook {
 namespace eden {
 
+namespace detail {
+
+size_t asciiPrefixLength(folly::StringPiece str) noexcept {
+  const char* data = str.data();
+  size_t size = str.size();
+  size_t i = 0;
+#ifdef EDEN_UTF8_SSE2
+  // The mask gathers the most significant bit of every byte, which is only
+  // set on the non-ASCII ones.
+  for (; i + sizeof(__m128i) <= size; i += sizeof(__m128i)) {
+    auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+    auto mask = static_cast<uint32_t>(_mm_movemask_epi8(chunk));
+    if (mask) {
+      return i + folly::findFirstSet(mask) - 1;
+    }
+  }
+#else
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, data + i, sizeof(word));
+    if (word & 0x8080808080808080ull) {
+      break;
+    }
+  }
+#endif
+  while (i < size && !isBitSet(data[i], 7)) {
+    ++i;
+  }
+  return i;
+}
+
+} // namespace detail
+
 std::string ensureValidUtf8(folly::ByteRange str) {
   std::string output;
   output.reserve(str.size());
@@ -18,6 +58,14 @@ std::string ensureValidUtf8(folly::ByteRange str) {
   const unsigned char* begin = str.begin();
   const unsigned char* const end = str.end();
   while (begin != end) {
+    // Copy the runs of ASCII characters as they are.
+    auto ascii = detail::asciiPrefixLength(
+        folly::StringPiece{folly::ByteRange{begin, end}});
+    output.append(reinterpret_cast<const char*>(begin), ascii);
+    begin += ascii;
+    if (begin == end) {
+      break;
+    }
     // codePointToUtf8 returns a std::string which is inefficient for something
     // that always fits in 32 bits, but with SSO it probably never allocates at
     // least.
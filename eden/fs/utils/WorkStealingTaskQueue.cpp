@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/utils/WorkStealingTaskQueue.h"
+
+#include <folly/logging/xlog.h>
+
+namespace facebook::eden {
+
+namespace {
+
+class BackgroundWorkData : public folly::RequestData {
+ public:
+  bool hasCallback() override {
+    return false;
+  }
+};
+
+const folly::RequestToken& getBackgroundWorkToken() {
+  static const folly::RequestToken token{"eden::BackgroundWork"};
+  return token;
+}
+
+std::atomic<uint64_t> nextQueueId{1};
+
+/**
+ * Which queue the current thread is a worker of, and its slot there.
+ */
+struct WorkerState {
+  uint64_t queueId{0};
+  size_t slot{0};
+  uint64_t takes{0};
+};
+
+thread_local WorkerState workerState;
+
+size_t getIndex(WorkPriority priority) {
+  return static_cast<size_t>(priority);
+}
+
+} // namespace
+
+BackgroundWorkGuard::BackgroundWorkGuard()
+    : guard_{
+          getBackgroundWorkToken(), std::make_unique<BackgroundWorkData>()} {}
+
+WorkPriority BackgroundWorkGuard::getCurrentPriority() {
+  auto* context = folly::RequestContext::get();
+  return context && context->hasContextData(getBackgroundWorkToken())
+      ? WorkPriority::Background
+      : WorkPriority::Interactive;
+}
+
+WorkStealingTaskQueue::WorkStealingTaskQueue(
+    size_t threadCount,
+    LatencyObserver latencyObserver)
+    : id_{nextQueueId.fetch_add(1, std::memory_order_relaxed)},
+      slots_(std::max<size_t>(threadCount, 1)),
+      latencyObserver_{std::move(latencyObserver)} {}
+
+folly::BlockingQueueAddResult WorkStealingTaskQueue::add(CPUTask item) {
+  return enqueue(std::move(item), BackgroundWorkGuard::getCurrentPriority());
+}
+
+folly::BlockingQueueAddResult WorkStealingTaskQueue::addWithPriority(
+    CPUTask item,
+    int8_t priority) {
+  return enqueue(
+      std::move(item),
+      priority < folly::Executor::MID_PRI ? WorkPriority::Background
+                                          : WorkPriority::Interactive);
+}
+
+WorkStealingTaskQueue::CPUTask WorkStealingTaskQueue::take() {
+  sem_.wait();
+  return dequeue();
+}
+
+folly::Optional<WorkStealingTaskQueue::CPUTask>
+WorkStealingTaskQueue::try_take_for(std::chrono::milliseconds time) {
+  if (!sem_.try_wait_for(time)) {
+    return folly::none;
+  }
+  return dequeue();
+}
+
+folly::BlockingQueueAddResult WorkStealingTaskQueue::enqueue(
+    CPUTask item,
+    WorkPriority priority) {
+  auto workerSlot = getWorkerSlot();
+  auto slot = workerSlot
+      ? *workerSlot
+      : nextSlot_.fetch_add(1, std::memory_order_relaxed) % slots_.size();
+  slots_[slot].deques[getIndex(priority)].lock()->push_back(
+      Item{std::move(item), priority, std::chrono::steady_clock::now()});
+  size_.fetch_add(1, std::memory_order_relaxed);
+  return sem_.post();
+}
+
+WorkStealingTaskQueue::CPUTask WorkStealingTaskQueue::dequeue() {
+  auto workerSlot = getWorkerSlot();
+  auto start = workerSlot ? *workerSlot : registerWorker();
+  auto backgroundFirst = ++workerState.takes % kBackgroundShare == 0;
+  const WorkPriority order[] = {
+      backgroundFirst ? WorkPriority::Background : WorkPriority::Interactive,
+      backgroundFirst ? WorkPriority::Interactive : WorkPriority::Background,
+  };
+
+  // Our semaphore token guarantees that a task is queued, but it may be
+  // added to a deque we already looked at while we look at the others.
+  for (;;) {
+    for (auto priority : order) {
+      for (size_t n = 0; n < slots_.size(); ++n) {
+        auto& deque = slots_[(start + n) % slots_.size()].deques[getIndex(
+            priority)];
+        auto locked = deque.lock();
+        if (locked->empty()) {
+          continue;
+        }
+        auto item = std::move(locked->front());
+        locked->pop_front();
+        locked.unlock();
+
+        size_.fetch_sub(1, std::memory_order_relaxed);
+        if (latencyObserver_) {
+          latencyObserver_(
+              item.priority,
+              std::chrono::steady_clock::now() - item.enqueueTime);
+        }
+        return std::move(item.task);
+      }
+    }
+  }
+}
+
+std::optional<size_t> WorkStealingTaskQueue::getWorkerSlot() const {
+  if (workerState.queueId != id_) {
+    return std::nullopt;
+  }
+  return workerState.slot;
+}
+
+size_t WorkStealingTaskQueue::registerWorker() {
+  auto slot = nextWorker_.fetch_add(1, std::memory_order_relaxed) %
+      slots_.size();
+  XLOG(DBG5) << "worker thread registered in slot " << slot;
+  workerState = WorkerState{id_, slot, 0};
+  return slot;
+}
+
+} // namespace facebook::eden
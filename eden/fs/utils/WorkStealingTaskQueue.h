@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#pragma once
+
+#include <folly/Synchronized.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/io/async/Request.h>
+#include <folly/lang/Align.h>
+#include <folly/synchronization/LifoSem.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace facebook::eden {
+
+/**
+ * The classes of work of a WorkStealingTaskQueue. Interactive work, such as
+ * the continuations of filesystem requests, is always taken before the
+ * background work, such as checkouts, diffs and globs.
+ */
+enum class WorkPriority : uint8_t {
+  Interactive,
+  Background,
+};
+
+constexpr size_t kWorkPriorityCount = 2;
+
+/**
+ * Marks the work queued while it is alive as background work, along with the
+ * work queued by the continuations of that work: folly carries the request
+ * context over to the tasks and future callbacks it runs.
+ */
+class BackgroundWorkGuard {
+ public:
+  BackgroundWorkGuard();
+
+  BackgroundWorkGuard(const BackgroundWorkGuard&) = delete;
+  BackgroundWorkGuard& operator=(const BackgroundWorkGuard&) = delete;
+
+  /**
+   * The class of the work queued from the current request context.
+   */
+  static WorkPriority getCurrentPriority();
+
+ private:
+  folly::ShallowCopyRequestContextScopeGuard guard_;
+};
+
+/**
+ * An unbounded task queue for a CPUThreadPoolExecutor, holding one deque per
+ * worker thread and per class of work.
+ *
+ * Work queued by a worker goes to its own deques, to keep the continuations
+ * of a task on the thread whose caches hold its data, and the other work is
+ * spread over all the deques. A worker takes the oldest task of its own
+ * deques, and steals from the other deques when its own are empty.
+ *
+ * The interactive work of every deque is taken before any background work,
+ * except for one take out of kBackgroundShare which looks for background
+ * work first, so that a steady stream of interactive work doesn't starve
+ * checkouts.
+ *
+ * The class of a task is the one of its explicit priority, if queued with
+ * Executor::addWithPriority(): below MID_PRI is background work. Otherwise,
+ * it is the class of its request context, see BackgroundWorkGuard.
+ */
+class WorkStealingTaskQueue
+    : public folly::BlockingQueue<folly::CPUThreadPoolExecutor::CPUTask> {
+ public:
+  using CPUTask = folly::CPUThreadPoolExecutor::CPUTask;
+
+  /**
+   * Invoked by the worker threads with how long each task they take sat in
+   * the queue.
+   */
+  using LatencyObserver =
+      std::function<void(WorkPriority, std::chrono::steady_clock::duration)>;
+
+  static constexpr uint64_t kBackgroundShare = 8;
+
+  explicit WorkStealingTaskQueue(
+      size_t threadCount,
+      LatencyObserver latencyObserver = nullptr);
+
+  folly::BlockingQueueAddResult add(CPUTask item) override;
+
+  folly::BlockingQueueAddResult addWithPriority(CPUTask item, int8_t priority)
+      override;
+
+  uint8_t getNumPriorities() override {
+    return kWorkPriorityCount;
+  }
+
+  CPUTask take() override;
+
+  folly::Optional<CPUTask> try_take_for(
+      std::chrono::milliseconds time) override;
+
+  size_t size() override {
+    return size_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Item {
+    CPUTask task;
+    WorkPriority priority;
+    std::chrono::steady_clock::time_point enqueueTime;
+  };
+
+  using Deque = folly::Synchronized<std::deque<Item>, std::mutex>;
+
+  struct alignas(folly::hardware_destructive_interference_size) Slot {
+    Deque deques[kWorkPriorityCount];
+  };
+
+  folly::BlockingQueueAddResult enqueue(CPUTask item, WorkPriority priority);
+
+  /**
+   * Take a task once sem_ guarantees there is one to take.
+   */
+  CPUTask dequeue();
+
+  /**
+   * The slot of the calling thread, if it is one of the workers.
+   */
+  std::optional<size_t> getWorkerSlot() const;
+  size_t registerWorker();
+
+  const uint64_t id_;
+  std::vector<Slot> slots_;
+  std::atomic<size_t> nextWorker_{0};
+  std::atomic<size_t> nextSlot_{0};
+  std::atomic<size_t> size_{0};
+  folly::LifoSem sem_;
+  LatencyObserver latencyObserver_;
+};
+
+} // namespace facebook::eden
@@ -92,6 +92,19 @@ void fsetxattr(int fd, folly::StringPiece name, folly::StringPiece value) {
       ));
 }
 
+void fremovexattr(int fd, folly::StringPiece name) {
+  auto namestr = name.str();
+
+  folly::checkUnixError(::fremovexattr(
+      fd,
+      namestr.c_str()
+#ifdef __APPLE__
+          ,
+      0 // options
+#endif
+      ));
+}
+
 std::vector<std::string> listxattr(folly::StringPiece path) {
   std::string buf;
   auto pathStr = path.str();
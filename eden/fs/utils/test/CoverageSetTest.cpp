@@ -95,3 +95,8 @@ TEST(CoverageSetTest, merge_can_replace_many_nodes) {
   EXPECT_FALSE(s.covers(7, 9));
   EXPECT_TRUE(s.covers(1, 8));
 }
+
+TEST(CoverageSetTest, empty_set_is_the_size_of_a_pointer) {
+  // Every loaded FileInode holds a CoverageSet.
+  EXPECT_EQ(sizeof(void*), sizeof(CoverageSet));
+}
@@ -158,6 +158,38 @@ TEST(ImmediateFuture, hasImmediate) {
   EXPECT_EQ(std::move(fortyFive).get(), 45);
 }
 
+TEST(ImmediateFuture, continuationOnReadySemiFutureRunsImmediately) {
+  ImmediateFuture<int> fut{folly::makeSemiFuture(42)};
+  EXPECT_FALSE(fut.hasImmediate());
+
+  auto allocations = getImmediateFutureAllocationCount();
+  bool called = false;
+  auto fortyThree = std::move(fut).thenValue([&](int v) {
+    called = true;
+    return v + 1;
+  });
+  EXPECT_TRUE(called);
+  EXPECT_TRUE(fortyThree.hasImmediate());
+  EXPECT_EQ(allocations, getImmediateFutureAllocationCount());
+  EXPECT_EQ(std::move(fortyThree).get(), 43);
+}
+
+TEST(ImmediateFuture, countsAllocations) {
+  auto [promise, semiFut] = folly::makePromiseContract<int>();
+  auto allocations = getImmediateFutureAllocationCount();
+
+  auto fut = ImmediateFuture<int>{std::move(semiFut)}.thenValue(
+      [](int v) { return v + 1; });
+  EXPECT_EQ(allocations + 1, getImmediateFutureAllocationCount());
+
+  auto semi = ImmediateFuture<int>{42}.semi();
+  EXPECT_EQ(allocations + 2, getImmediateFutureAllocationCount());
+
+  promise.setValue(42);
+  EXPECT_EQ(std::move(fut).get(), 43);
+  EXPECT_EQ(std::move(semi).get(), 42);
+}
+
 ImmediateFuture<folly::Unit> unitFunc() {
   return folly::unit;
 }
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/utils/LeaseCache.h"
+#include <folly/Synchronized.h>
+#include <folly/portability/GTest.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace facebook::eden;
+
+namespace {
+using Cache = ShardedLeaseCache<int, std::string>;
+
+struct Fetcher {
+  folly::Future<std::shared_ptr<std::string>> fetch(int key) {
+    folly::Promise<std::shared_ptr<std::string>> promise;
+    auto future = promise.getFuture();
+    promises.lock()->emplace_back(key, std::move(promise));
+    return future;
+  }
+
+  void fulfillAll() {
+    auto promises = std::move(*this->promises.lock());
+    for (auto& [key, promise] : promises) {
+      promise.setValue(std::make_shared<std::string>(std::to_string(key)));
+    }
+  }
+
+  size_t pendingCount() {
+    return promises.lock()->size();
+  }
+
+  folly::Synchronized<
+      std::vector<std::pair<int, folly::Promise<std::shared_ptr<std::string>>>>,
+      std::mutex>
+      promises;
+};
+} // namespace
+
+TEST(ShardedLeaseCache, concurrentGetsShareOneFetch) {
+  Fetcher fetcher;
+  Cache cache{100, [&](const int& key) { return fetcher.fetch(key); }};
+
+  auto first = cache.get(1);
+  auto second = cache.get(1);
+  EXPECT_EQ(1, fetcher.pendingCount());
+  EXPECT_FALSE(first.isReady());
+
+  fetcher.fulfillAll();
+  EXPECT_EQ("1", *std::move(first).get());
+  EXPECT_EQ("1", *std::move(second).get());
+
+  auto third = cache.get(1);
+  EXPECT_TRUE(third.isReady());
+  EXPECT_EQ(0, fetcher.pendingCount());
+}
+
+TEST(ShardedLeaseCache, setEraseAndExists) {
+  Fetcher fetcher;
+  Cache cache{100, [&](const int& key) { return fetcher.fetch(key); }};
+
+  cache.set(7, std::make_shared<std::string>("seven"));
+  EXPECT_TRUE(cache.exists(7));
+  EXPECT_EQ("seven", *cache.get(7).get());
+
+  cache.erase(7);
+  EXPECT_FALSE(cache.exists(7));
+  auto refetched = cache.get(7);
+  EXPECT_EQ(1, fetcher.pendingCount());
+  fetcher.fulfillAll();
+  EXPECT_EQ("7", *std::move(refetched).get());
+}
+
+TEST(ShardedLeaseCache, evictsWithinEachShard) {
+  Fetcher fetcher;
+  Cache cache{
+      8, [&](const int& key) { return fetcher.fetch(key); }, /*shardCount=*/2};
+
+  for (int key = 0; key < 100; ++key) {
+    cache.set(key, std::make_shared<std::string>(std::to_string(key)));
+  }
+  size_t cached = 0;
+  for (int key = 0; key < 100; ++key) {
+    cached += cache.exists(key);
+  }
+  EXPECT_EQ(8, cached);
+}
+
+TEST(ShardedLeaseCache, fetchesEachKeyOnceFromManyThreads) {
+  Fetcher fetcher;
+  Cache cache{1000, [&](const int& key) { return fetcher.fetch(key); }};
+
+  constexpr int kKeys = 100;
+  std::vector<std::thread> threads;
+  std::vector<std::vector<Cache::FutureType>> futures(8);
+  for (auto& threadFutures : futures) {
+    threads.emplace_back([&] {
+      for (int key = 0; key < kKeys; ++key) {
+        threadFutures.push_back(cache.get(key));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(kKeys, fetcher.pendingCount());
+  fetcher.fulfillAll();
+  for (auto& threadFutures : futures) {
+    for (int key = 0; key < kKeys; ++key) {
+      EXPECT_EQ(std::to_string(key), *std::move(threadFutures[key]).get());
+    }
+  }
+}
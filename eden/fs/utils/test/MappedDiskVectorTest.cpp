@@ -66,6 +66,65 @@ TEST_F(MappedDiskVectorTest, grows_file) {
   EXPECT_GT(new_size, old_size);
 }
 
+TEST_F(MappedDiskVectorTest, grows_geometrically) {
+  auto mdv = MappedDiskVector<U64>::open(mdvPath);
+  auto capacity = mdv.capacity();
+  size_t growths = 0;
+
+  // 32 MB
+  constexpr uint64_t N = 4000000;
+  for (uint64_t i = 0; i < N; ++i) {
+    mdv.emplace_back(i);
+    if (mdv.capacity() != capacity) {
+      EXPECT_GE(mdv.capacity(), capacity + capacity / 2);
+      capacity = mdv.capacity();
+      ++growths;
+    }
+  }
+  EXPECT_LT(growths, 20);
+  EXPECT_EQ(N - 1, mdv.back());
+}
+
+TEST_F(MappedDiskVectorTest, reserve) {
+  auto mdv = MappedDiskVector<U64>::open(mdvPath);
+  mdv.emplace_back(1ull);
+  mdv.reserve(1000000);
+  EXPECT_GE(mdv.capacity(), 1000000);
+  EXPECT_EQ(1, mdv.size());
+  EXPECT_EQ(1, mdv[0]);
+
+  struct stat st;
+  ASSERT_EQ(0, stat(mdvPath.c_str(), &st));
+  EXPECT_GE(st.st_size, 1000000 * sizeof(U64));
+}
+
+TEST_F(MappedDiskVectorTest, huge_pages_round_growth) {
+  auto mdv = MappedDiskVector<U64>::open(mdvPath);
+  mdv.adviseHugePages();
+  mdv.reserve(mdv.capacity() + 1);
+
+  struct stat st;
+  ASSERT_EQ(0, stat(mdvPath.c_str(), &st));
+  EXPECT_EQ(0, st.st_size % facebook::eden::detail::kHugePageSize);
+}
+
+TEST_F(MappedDiskVectorTest, flush_writes_records_to_file) {
+  auto mdv = MappedDiskVector<U64>::open(mdvPath);
+  mdv.emplace_back(15ull);
+  mdv.emplace_back(25ull);
+  mdv[0] = 35ull;
+  mdv.flush();
+
+  // The records follow the 32-byte header.
+  std::string contents;
+  ASSERT_TRUE(folly::readFile(mdvPath.c_str(), contents));
+  ASSERT_GE(contents.size(), 32 + 2 * sizeof(uint64_t));
+  uint64_t records[2];
+  memcpy(records, contents.data() + 32, sizeof(records));
+  EXPECT_EQ(35, records[0]);
+  EXPECT_EQ(25, records[1]);
+}
+
 TEST_F(MappedDiskVectorTest, remembers_contents_on_reopen) {
   {
     auto mdv = MappedDiskVector<U64>::open(mdvPath);
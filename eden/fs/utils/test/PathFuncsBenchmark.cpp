@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/utils/PathFuncs.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace facebook::eden;
+
+namespace {
+
+/**
+ * Names of increasing length: most are shorter than 16 bytes, but generated
+ * and vendored files often have much longer ones.
+ */
+const std::vector<std::string> kNames{
+    "a",
+    "README.md",
+    "PathFuncs.cpp",
+    "ProcessNameCacheBenchmark.cpp",
+    "libfoo_generated_bindings_for_the_thrift_service_definitions.h",
+};
+
+std::string makePath(size_t depth) {
+  std::string path;
+  for (size_t i = 0; i < depth; ++i) {
+    if (!path.empty()) {
+      path.push_back(kDirSeparator);
+    }
+    path.append(kNames[i % kNames.size()]);
+  }
+  return path;
+}
+
+} // namespace
+
+static void BM_PathComponentSanityCheck(benchmark::State& state) {
+  const auto& name = kNames[state.range(0)];
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(PathComponentPiece{name});
+  }
+}
+BENCHMARK(BM_PathComponentSanityCheck)->DenseRange(0, 4);
+
+static void BM_RelativePathSanityCheck(benchmark::State& state) {
+  auto path = makePath(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(RelativePathPiece{path});
+  }
+}
+BENCHMARK(BM_RelativePathSanityCheck)->Arg(1)->Arg(4)->Arg(16);
+
+static void BM_basename(benchmark::State& state) {
+  auto path = makePath(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(basename(path));
+  }
+}
+BENCHMARK(BM_basename)->Arg(1)->Arg(4)->Arg(16);
+
+static void BM_dirname(benchmark::State& state) {
+  auto path = makePath(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(dirname(path));
+  }
+}
+BENCHMARK(BM_dirname)->Arg(1)->Arg(4)->Arg(16);
+
+static void BM_equalsCaseInsensitive(benchmark::State& state) {
+  const auto& name = kNames[state.range(0)];
+  std::string upper = name;
+  for (auto& c : upper) {
+    c = toupper(c);
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(equalsCaseInsensitive(name, upper));
+  }
+}
+BENCHMARK(BM_equalsCaseInsensitive)->DenseRange(0, 4);
+
+static void BM_AsciiCaseInsensitive(benchmark::State& state) {
+  const auto& name = kNames[state.range(0)];
+  std::string upper = name;
+  for (auto& c : upper) {
+    c = toupper(c);
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(folly::StringPiece{name}.equals(
+        upper, folly::AsciiCaseInsensitive()));
+  }
+}
+BENCHMARK(BM_AsciiCaseInsensitive)->DenseRange(0, 4);
@@ -17,6 +17,7 @@
 #include <folly/portability/SysStat.h>
 #include <folly/portability/Unistd.h>
 #include <folly/test/TestUtils.h>
+#include <optional>
 #include <sstream>
 
 #include "eden/fs/testharness/TempFile.h"
@@ -46,6 +47,48 @@ TEST(PathFuncs, Sanity) {
   }
 }
 
+TEST(PathFuncs, SanityOfLongNames) {
+  // Long enough to go through the vectorized scans, with the invalid byte
+  // both in the vectorized part and in the tail.
+  std::string name(40, 'a');
+  EXPECT_NO_THROW(PathComponentPiece{name});
+  for (size_t i : {0, 7, 16, 31, 39}) {
+    for (char c : {'/', '\0'}) {
+      auto invalid = name;
+      invalid[i] = c;
+      EXPECT_THROW(PathComponentPiece{invalid}, std::domain_error)
+          << "byte " << int(c) << " at " << i;
+    }
+  }
+
+  auto utf8 = name;
+  utf8.replace(20, 2, "\xc3\xa9");
+  EXPECT_NO_THROW(PathComponentPiece{utf8});
+  auto notUtf8 = name;
+  notUtf8[20] = '\xff';
+  EXPECT_THROW(PathComponentPiece{notUtf8}, std::domain_error);
+
+  auto path = name + "/" + name + "/" + name;
+  EXPECT_NO_THROW(RelativePathPiece{path});
+  EXPECT_THROW(RelativePathPiece{name + "/./" + name}, std::domain_error);
+  EXPECT_THROW(RelativePathPiece{name + "//" + name}, std::domain_error);
+  EXPECT_THROW(RelativePathPiece{name + "/" + name + "/.."}, std::domain_error);
+  EXPECT_THROW(RelativePathPiece{name + "/\xff"}, std::domain_error);
+}
+
+TEST(PathFuncs, equalsCaseInsensitive) {
+  EXPECT_TRUE(equalsCaseInsensitive("", ""));
+  EXPECT_TRUE(equalsCaseInsensitive("Foo", "fOO"));
+  EXPECT_FALSE(equalsCaseInsensitive("foo", "foo2"));
+  EXPECT_FALSE(equalsCaseInsensitive("foo@", "foo`"));
+  EXPECT_TRUE(equalsCaseInsensitive(
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZ[]@`", "abcdefghijklmnopqrstuvwxyz[]@`"));
+  EXPECT_FALSE(equalsCaseInsensitive(
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZ[]@`", "abcdefghijklmnopqrstuvwxyz[]`@"));
+  EXPECT_FALSE(equalsCaseInsensitive(
+      "abcdefghijklmnop\xc3\x89", "ABCDEFGHIJKLMNOP\xc3\xa9"));
+}
+
 TEST(PathFuncs, StringCompare) {
   PathComponentPiece piece("foo");
 
@@ -549,6 +592,82 @@ TEST(PathFuncs, PathComponent) {
   EXPECT_THROW_RE(PathComponent(".."), std::domain_error, "must not be \\.\\.");
 }
 
+TEST(PathFuncs, CompactPathComponent) {
+  static_assert(sizeof(CompactPathComponent) == 16);
+
+  CompactPathComponent small{"hello"_pc};
+  EXPECT_TRUE(small.value().isInline());
+  EXPECT_EQ("hello", small.stringPiece());
+  EXPECT_EQ("hello"_pc, small);
+  EXPECT_EQ(PathComponent{"hello"}, small);
+
+  CompactPathComponent full{"fifteen_chars__"_pc};
+  EXPECT_TRUE(full.value().isInline());
+  EXPECT_EQ("fifteen_chars__", full.stringPiece());
+
+  CompactPathComponent large{"a_name_that_does_not_fit_inline"_pc};
+  EXPECT_FALSE(large.value().isInline());
+  EXPECT_EQ("a_name_that_does_not_fit_inline", large.stringPiece());
+
+  CompactPathComponent copied{large};
+  EXPECT_EQ(large, copied);
+  EXPECT_NE(large.stringPiece().data(), copied.stringPiece().data());
+
+  auto data = large.stringPiece().data();
+  CompactPathComponent moved{std::move(large)};
+  EXPECT_EQ(data, moved.stringPiece().data());
+
+  copied = small;
+  EXPECT_EQ("hello", copied.stringPiece());
+  EXPECT_TRUE(copied.value().isInline());
+
+  EXPECT_LT(small, moved);
+  EXPECT_EQ(PathComponent{"hello"}, small.copy());
+  EXPECT_EQ("hello/fifteen_chars__"_relpath, small + full);
+}
+
+TEST(PathFuncs, PathComponentArena) {
+  auto first = "a_name_that_does_not_fit_inline"_pc;
+  auto second = "another_name_that_does_not_fit_inline"_pc;
+  std::optional<CompactPathComponent> longName;
+  CompactPathComponent small;
+  CompactPathComponent overflow;
+  {
+    PathComponentArena arena{
+        PathComponentArena::getReservation(first.stringPiece()) +
+        PathComponentArena::getReservation(second.stringPiece()) +
+        PathComponentArena::getReservation("small")};
+    longName = arena.copy(first);
+    auto next = arena.copy(second);
+    small = arena.copy("small"_pc);
+    // The block is full, the name goes to the heap.
+    overflow = arena.copy(first);
+
+    EXPECT_EQ(first, *longName);
+    EXPECT_EQ(second, next);
+    EXPECT_EQ(longName->stringPiece().end(), next.stringPiece().begin());
+    EXPECT_TRUE(small.value().isInline());
+    EXPECT_EQ(first, overflow);
+    EXPECT_NE(longName->stringPiece().data(), overflow.stringPiece().data());
+  }
+
+  // The names hold the block alive after the arena is gone, and copies share
+  // it.
+  CompactPathComponent copied{*longName};
+  EXPECT_EQ(longName->stringPiece().data(), copied.stringPiece().data());
+  longName.reset();
+  EXPECT_EQ(first, copied);
+
+  auto data = copied.stringPiece().data();
+  CompactPathComponent moved{std::move(copied)};
+  EXPECT_EQ(data, moved.stringPiece().data());
+  moved = small;
+  EXPECT_EQ("small"_pc, moved);
+
+  PathComponentArena empty{0};
+  EXPECT_EQ(first, empty.copy(first));
+}
+
 TEST(PathFuncs, RelativePath) {
   RelativePath emptyRel;
   EXPECT_EQ("", emptyRel.stringPiece());
@@ -654,6 +773,25 @@ TEST(PathFuncs, basename) {
   EXPECT_EQ("foo", basename(StringPiece("foo")));
 }
 
+TEST(PathFuncs, dirnameAndBasenameOfLongPaths) {
+  // Separators before, in, and after the chunks scanned 16 bytes at a time.
+  std::string path = "a/" + std::string(40, 'b');
+  EXPECT_EQ("a", dirname(path));
+  EXPECT_EQ(std::string(40, 'b'), basename(StringPiece(path)));
+
+  path = std::string(40, 'a') + "/b";
+  EXPECT_EQ(std::string(40, 'a'), dirname(path));
+  EXPECT_EQ("b", basename(StringPiece(path)));
+
+  path = std::string(20, 'a') + "/" + std::string(20, 'b');
+  EXPECT_EQ(std::string(20, 'a'), dirname(path));
+  EXPECT_EQ(std::string(20, 'b'), basename(StringPiece(path)));
+
+  path = std::string(40, 'a');
+  EXPECT_EQ("", dirname(path));
+  EXPECT_EQ(path, basename(StringPiece(path)));
+}
+
 TEST(PathFuncs, isSubDir) {
   // Helper functions that convert string arguments to RelativePathPiece
   auto isSubdir = [](StringPiece a, StringPiece b) {
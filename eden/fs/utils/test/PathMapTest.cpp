@@ -240,3 +240,69 @@ TEST(PathMap, swap) {
   EXPECT_EQ(0, b.size()) << "b now has 0 elements";
   EXPECT_EQ("foo", a.at("foo"_pc));
 }
+
+TEST(PathMap, compactKeys) {
+  PathMap<int, CompactPathComponent> map(CaseSensitivity::Insensitive);
+
+  EXPECT_TRUE(map.emplace("short"_pc, 1).second);
+  EXPECT_TRUE(
+      map.emplace("a_much_longer_name_stored_on_the_heap"_pc, 2).second);
+  EXPECT_FALSE(map.emplace("SHORT"_pc, 3).second);
+  EXPECT_EQ(2, map.size());
+
+  EXPECT_EQ(1, map.at("short"_pc));
+  EXPECT_EQ(1, map.at("Short"_pc));
+  EXPECT_EQ(2, map.at("A_MUCH_LONGER_NAME_STORED_ON_THE_HEAP"_pc));
+
+  // Growing the map moves the keys around.
+  for (int i = 0; i < 100; ++i) {
+    map.emplace(PathComponent{folly::to<std::string>("file", i)}, i);
+  }
+  EXPECT_EQ(102, map.size());
+  EXPECT_EQ("a_much_longer_name_stored_on_the_heap", map.begin()->first);
+  EXPECT_EQ(2, map.at("a_much_longer_name_stored_on_the_heap"_pc));
+
+  EXPECT_EQ(1, map.erase("SHORT"_pc));
+  EXPECT_EQ(map.end(), map.find("short"_pc));
+}
+
+TEST(PathMap, emplaceArenaKeys) {
+  auto longName = "a_name_long_enough_to_go_into_the_arena"_pc;
+  PathComponentArena arena{PathComponentArena::getReservation(
+      longName.stringPiece())};
+  PathMap<int, CompactPathComponent> map(CaseSensitivity::Insensitive);
+
+  auto key = arena.copy(longName);
+  auto data = key.stringPiece().data();
+  EXPECT_TRUE(map.emplace(std::move(key), 1).second);
+  // The key was moved into the map rather than copied.
+  EXPECT_EQ(data, map.begin()->first.stringPiece().data());
+
+  auto upper = arena.copy("A_NAME_LONG_ENOUGH_TO_GO_INTO_THE_ARENA"_pc);
+  EXPECT_FALSE(map.emplace(std::move(upper), 2).second);
+  EXPECT_EQ(1, map.at(longName));
+}
+
+TEST(PathMap, caseInSensitiveAfterInsertsAndErases) {
+  PathMap<int> map(CaseSensitivity::Insensitive);
+  for (int i = 0; i < 20; ++i) {
+    map.emplace(PathComponent{folly::to<std::string>("File", i)}, i);
+  }
+  map.erase(map.begin(), map.begin() + 5);
+  map.erase(map.find("file7"_pc));
+  EXPECT_EQ(14, map.size());
+
+  // The case insensitive lookups still find the entries that shifted.
+  for (const auto& [name, value] : map) {
+    auto upper = folly::to<std::string>("FILE", value);
+    EXPECT_EQ(value, map.at(PathComponentPiece{upper}));
+  }
+  EXPECT_EQ(map.end(), map.find("file7"_pc));
+  EXPECT_FALSE(map.insert(std::make_pair(PathComponent("FILE19"), 0)).second);
+  EXPECT_TRUE(map.insert(std::make_pair(PathComponent("file7"), 7)).second);
+  EXPECT_EQ(7, map["FILE7"_pc]);
+
+  map.clear();
+  EXPECT_TRUE(map.emplace("File1"_pc, 1).second);
+  EXPECT_EQ(1, map.at("fILE1"_pc));
+}
@@ -8,6 +8,7 @@
 #include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
 #include <sys/types.h>
+#include <thread>
 #include <utility>
 
 #include "eden/fs/utils/ProcessAccessLog.h"
@@ -51,3 +52,33 @@ TEST(ProcessAccessLog, accessAddsProcessToProcessNameCache) {
   log.recordAccess(pid, ProcessAccessLog::AccessType::FsChannelOther);
   EXPECT_THAT(processNameCache->getAllProcessNames(), Contains(Key(Eq(pid))));
 }
+
+TEST(ProcessAccessLog, logsSharingThreadsKeepTheirOwnCounts) {
+  auto processNameCache = std::make_shared<ProcessNameCache>();
+  auto first = ProcessAccessLog{processNameCache};
+  auto second = ProcessAccessLog{processNameCache};
+
+  first.recordAccess(10, ProcessAccessLog::AccessType::FsChannelRead);
+  second.recordAccess(10, ProcessAccessLog::AccessType::FsChannelWrite);
+  second.recordAccess(10, ProcessAccessLog::AccessType::FsChannelWrite);
+
+  auto firstCounts = first.getAccessCounts(10s);
+  auto secondCounts = second.getAccessCounts(10s);
+  EXPECT_EQ(1, *firstCounts[10].fsChannelTotal_ref());
+  EXPECT_EQ(1, *firstCounts[10].fsChannelReads_ref());
+  EXPECT_EQ(2, *secondCounts[10].fsChannelTotal_ref());
+  EXPECT_EQ(2, *secondCounts[10].fsChannelWrites_ref());
+}
+
+TEST(ProcessAccessLog, accessesOfExitedThreadsAreKept) {
+  auto log = ProcessAccessLog{std::make_shared<ProcessNameCache>()};
+  std::thread{[&] {
+    log.recordAccess(10, ProcessAccessLog::AccessType::FsChannelRead);
+    log.recordDuration(10, 5ns);
+  }}.join();
+  log.recordAccess(10, ProcessAccessLog::AccessType::FsChannelRead);
+
+  auto counts = log.getAccessCounts(10s);
+  EXPECT_EQ(2, *counts[10].fsChannelReads_ref());
+  EXPECT_EQ(5, *counts[10].fsChannelDurationNs_ref());
+}
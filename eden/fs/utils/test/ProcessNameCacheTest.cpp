@@ -52,3 +52,31 @@ TEST(ProcessNameCache, addFromMultipleThreads) {
   }
   EXPECT_EQ(1, results.size());
 }
+
+TEST(ProcessNameCache, evictsLeastRecentlyUsedNames) {
+  ProcessNameCache processNameCache{5min, 8};
+  // Pids that are unlikely to exist still get a name, an <err:...> one.
+  constexpr pid_t kFirstPid = std::numeric_limits<pid_t>::max() - 100;
+  for (pid_t pid = kFirstPid; pid < kFirstPid + 100; ++pid) {
+    processNameCache.add(pid);
+  }
+
+  auto results = processNameCache.getAllProcessNames();
+  EXPECT_LE(results.size(), 8u);
+  EXPECT_FALSE(results.empty());
+}
+
+TEST(ProcessNameCache, limitsResolutionRate) {
+  auto start = std::chrono::steady_clock::now();
+  ProcessNameCache processNameCache{5min, 4096, 10};
+  constexpr pid_t kFirstPid = std::numeric_limits<pid_t>::max() - 100;
+  for (pid_t pid = kFirstPid; pid < kFirstPid + 100; ++pid) {
+    processNameCache.add(pid);
+  }
+
+  auto results = processNameCache.getAllProcessNames();
+  auto elapsed = std::chrono::duration<double>{
+      std::chrono::steady_clock::now() - start};
+  EXPECT_LE(results.size(), 10 + static_cast<size_t>(elapsed.count() * 10));
+  EXPECT_EQ(0u, processNameCache.getDroppedPidCount());
+}
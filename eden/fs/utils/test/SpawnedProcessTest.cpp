@@ -30,6 +30,20 @@ TEST(SpawnedProcess, cwd_slash) {
   EXPECT_EQ("/\n", outputs.first);
 }
 
+TEST(SpawnedProcess, cwd_with_executable_path) {
+  Options opts;
+  opts.nullStdin();
+  opts.pipeStdout();
+  opts.chdir("/"_abspath);
+  opts.executablePath("/bin/sh"_abspath);
+  SpawnedProcess proc({"sh", "-c", "pwd"}, std::move(opts));
+
+  auto outputs = proc.communicate();
+  proc.wait();
+
+  EXPECT_EQ("/\n", outputs.first);
+}
+
 TEST(SpawnedProcess, cwd_inherit) {
   Options opts;
   opts.nullStdin();
@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/utils/ThreadPlacement.h"
+
+#include <folly/portability/GTest.h>
+
+using namespace facebook::eden;
+
+namespace {
+using Cpus = std::vector<std::vector<int>>;
+
+Cpus placements(
+    const CpuTopology& topology,
+    ThreadPlacement placement,
+    size_t count) {
+  Cpus result;
+  for (size_t index = 0; index < count; ++index) {
+    result.push_back(topology.cpusForThread(placement, index));
+  }
+  return result;
+}
+} // namespace
+
+TEST(ThreadPlacementTest, parse) {
+  EXPECT_EQ(ThreadPlacement::None, parseThreadPlacement("none").value());
+  EXPECT_EQ(ThreadPlacement::Spread, parseThreadPlacement("Spread").value());
+  EXPECT_EQ(ThreadPlacement::Pack, parseThreadPlacement("pack").value());
+  EXPECT_EQ(
+      ThreadPlacement::PerNode, parseThreadPlacement("per-node").value());
+  EXPECT_TRUE(parseThreadPlacement("numa").hasError());
+  EXPECT_EQ("per-node", threadPlacementName(ThreadPlacement::PerNode));
+}
+
+TEST(ThreadPlacementTest, placesThreadsAcrossNodes) {
+  CpuTopology topology{{{0, 1, 2}, {}, {4, 5}}};
+  ASSERT_EQ(2, topology.nodes().size());
+
+  EXPECT_EQ((Cpus{{}, {}}), placements(topology, ThreadPlacement::None, 2));
+  EXPECT_EQ(
+      (Cpus{{0}, {4}, {1}, {5}, {2}, {0}}),
+      placements(topology, ThreadPlacement::Spread, 6));
+  EXPECT_EQ(
+      (Cpus{{0}, {1}, {2}, {4}, {5}, {0}}),
+      placements(topology, ThreadPlacement::Pack, 6));
+  EXPECT_EQ(
+      (Cpus{{0, 1, 2}, {4, 5}, {0, 1, 2}}),
+      placements(topology, ThreadPlacement::PerNode, 3));
+}
+
+TEST(ThreadPlacementTest, unknownTopologyLeavesThreadsUnplaced) {
+  CpuTopology topology{Cpus{}};
+  EXPECT_TRUE(topology.cpusForThread(ThreadPlacement::Pack, 3).empty());
+  EXPECT_TRUE(topology.cpusForThread(ThreadPlacement::PerNode, 0).empty());
+}
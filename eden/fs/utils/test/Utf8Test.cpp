@@ -48,3 +48,38 @@ TEST(Utf8String, ensureValidUtf8) {
                       "bar"));
   EXPECT_EQ(u8"\uFFFDprefix\uFFFD", ensureValidUtf8("\xA0prefix\xB0"));
 }
+
+TEST(Utf8Test, isValidUtf8OfLongStrings) {
+  // Place a multi-byte character or an invalid byte at every position of a
+  // string spanning several vectorized chunks.
+  for (size_t pos = 0; pos < 40; ++pos) {
+    std::string str(40, 'a');
+    str.insert(pos, u8"\u00A2");
+    EXPECT_TRUE(isValidUtf8(str)) << pos;
+    EXPECT_EQ(str, ensureValidUtf8(folly::StringPiece{str}));
+
+    str = std::string(40, 'a');
+    str[pos] = '\xff';
+    EXPECT_FALSE(isValidUtf8(str)) << pos;
+    auto expected =
+        std::string(pos, 'a') + u8"\uFFFD" + std::string(39 - pos, 'a');
+    EXPECT_EQ(expected, ensureValidUtf8(folly::StringPiece{str}));
+  }
+}
+
+TEST(Utf8Test, isValidUtf8OfTruncatedSequences) {
+  EXPECT_FALSE(isValidUtf8("\xC2"));
+  EXPECT_FALSE(isValidUtf8("abc\xE0\xA4"));
+  EXPECT_FALSE(isValidUtf8(folly::StringPiece{"\xF0\x90\x8D\x88", 3}));
+}
+
+TEST(Utf8Test, asciiPrefixLength) {
+  using detail::asciiPrefixLength;
+  EXPECT_EQ(0, asciiPrefixLength(""));
+  EXPECT_EQ(3, asciiPrefixLength("abc"));
+  EXPECT_EQ(0, asciiPrefixLength("\x80abc"));
+  std::string str(100, 'x');
+  EXPECT_EQ(100, asciiPrefixLength(str));
+  str[77] = '\xC3';
+  EXPECT_EQ(77, asciiPrefixLength(str));
+}
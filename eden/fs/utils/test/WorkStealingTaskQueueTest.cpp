@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include "eden/fs/utils/WorkStealingTaskQueue.h"
+
+#include <folly/Synchronized.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/portability/GTest.h>
+#include <folly/synchronization/Baton.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+using namespace facebook::eden;
+using namespace std::chrono_literals;
+
+namespace {
+std::unique_ptr<folly::CPUThreadPoolExecutor> makeExecutor(
+    size_t threadCount,
+    WorkStealingTaskQueue::LatencyObserver observer = nullptr) {
+  return std::make_unique<folly::CPUThreadPoolExecutor>(
+      threadCount,
+      std::make_unique<WorkStealingTaskQueue>(
+          threadCount, std::move(observer)));
+}
+
+/**
+ * Occupy the single thread of the executor until the returned baton is
+ * posted, so that the work queued meanwhile is taken in priority order.
+ */
+std::shared_ptr<folly::Baton<>> blockExecutor(folly::Executor& executor) {
+  auto release = std::make_shared<folly::Baton<>>();
+  folly::Baton<> started;
+  executor.add([&started, release] {
+    started.post();
+    release->wait();
+  });
+  started.wait();
+  return release;
+}
+} // namespace
+
+TEST(WorkStealingTaskQueueTest, interactiveWorkRunsBeforeBackgroundWork) {
+  auto executor = makeExecutor(1);
+  auto release = blockExecutor(*executor);
+
+  folly::Synchronized<std::vector<std::string>> order;
+  {
+    BackgroundWorkGuard backgroundWork;
+    executor->add([&] { order.wlock()->push_back("background"); });
+  }
+  executor->addWithPriority(
+      [&] { order.wlock()->push_back("low priority"); },
+      folly::Executor::LO_PRI);
+  executor->add([&] { order.wlock()->push_back("interactive"); });
+
+  release->post();
+  executor->join();
+  EXPECT_EQ(
+      (std::vector<std::string>{"interactive", "background", "low priority"}),
+      *order.rlock());
+}
+
+TEST(WorkStealingTaskQueueTest, backgroundWorkIsNotStarved) {
+  auto executor = makeExecutor(1);
+  auto release = blockExecutor(*executor);
+
+  folly::Synchronized<std::vector<std::string>> order;
+  {
+    BackgroundWorkGuard backgroundWork;
+    executor->add([&] { order.wlock()->push_back("background"); });
+  }
+  for (uint64_t i = 0; i < 2 * WorkStealingTaskQueue::kBackgroundShare; ++i) {
+    executor->add([&] { order.wlock()->push_back("interactive"); });
+  }
+
+  release->post();
+  executor->join();
+  auto ran = order.rlock();
+  auto background = std::find(ran->begin(), ran->end(), "background");
+  ASSERT_NE(ran->end(), background);
+  EXPECT_LT(
+      background - ran->begin(),
+      static_cast<ptrdiff_t>(WorkStealingTaskQueue::kBackgroundShare));
+}
+
+TEST(WorkStealingTaskQueueTest, idleWorkerStealsQueuedWork) {
+  auto executor = makeExecutor(2);
+  folly::Baton<> stolen;
+  folly::Baton<> done;
+  executor->add([&] {
+    // This task is queued in the deque of the current worker, which only
+    // takes it once this task is done.
+    executor->add([&] { stolen.post(); });
+    EXPECT_TRUE(stolen.try_wait_for(10s));
+    done.post();
+  });
+  EXPECT_TRUE(done.try_wait_for(10s));
+  executor->join();
+}
+
+TEST(WorkStealingTaskQueueTest, reportsTheQueueLatencyOfEachClass) {
+  folly::Synchronized<std::vector<WorkPriority>> observed;
+  auto executor =
+      makeExecutor(1, [&](WorkPriority priority, auto /* latency */) {
+        observed.wlock()->push_back(priority);
+      });
+  executor->add([] {});
+  {
+    BackgroundWorkGuard backgroundWork;
+    executor->add([] {});
+  }
+  executor->join();
+  EXPECT_EQ(
+      (std::vector<WorkPriority>{
+          WorkPriority::Interactive, WorkPriority::Background}),
+      *observed.rlock());
+}
@@ -48,8 +48,12 @@ struct FrameInfo {
   }
 
   void assign(PyFrameObject* frame, frameid_t backfid) {
+    assign(frame->f_code, backfid);
+  }
+
+  void assign(PyCodeObject* c, frameid_t backfid) {
     back = backfid;
-    code = frame->f_code;
+    code = c;
     Py_XINCREF(code);
   }
 
@@ -169,14 +173,81 @@ static int tracefunc(PyObject* o, PyFrameObject* frame, int op, PyObject* a) {
   return 0;
 }
 
-static void enable() {
+/* sampling ----------------------------------------------------------------- */
+
+/* Instead of tracing every call, the stack can be sampled from a timer
+ * signal. Each sample adds the time since the previous one to every node on
+ * its path in a call tree. The tree is kept in a flat array, linked by
+ * indexes, with node 0 as the root. */
+struct SampleNode {
+  PyCodeObject* code;
+  uint32_t parent;
+  uint32_t child; /* first child, 0 if none */
+  uint32_t next; /* next sibling, 0 if none */
+  unsigned int count; /* samples with this node on the stack */
+  rdtsc_t time;
+};
+
+static int sampling = 0;
+static rdtsc_t lastsample;
+static std::vector<SampleNode> sampletree;
+static std::vector<PyCodeObject*> samplestack; /* reused for each sample */
+
+/* find or insert the child node running "code" */
+static uint32_t samplechild(uint32_t parent, PyCodeObject* code) {
+  uint32_t* link = &sampletree[parent].child;
+  while (*link) {
+    if (sampletree[*link].code == code)
+      return *link;
+    link = &sampletree[*link].next;
+  }
+  uint32_t index = (uint32_t)sampletree.size();
+  *link = index;
+  Py_INCREF(code);
+  sampletree.push_back({code, parent, 0, 0, 0, 0});
+  return index;
+}
+
+/* record the stack of the frame a timer signal interrupted */
+static void sample(PyObject* obj) {
+  rdtsc_t now = rdtsc();
+  rdtsc_t elapsed = now - lastsample;
+  lastsample = now;
+  if (!sampling || !obj || !PyFrame_Check(obj))
+    return;
+
+  samplestack.clear();
+  for (PyFrameObject* frame = (PyFrameObject*)obj; frame;
+       frame = frame->f_back) {
+    samplestack.push_back(frame->f_code);
+  }
+
+  uint32_t node = 0;
+  sampletree[node].count++;
+  sampletree[node].time += elapsed;
+  for (auto it = samplestack.rbegin(); it != samplestack.rend(); ++it) {
+    node = samplechild(node, *it);
+    sampletree[node].count++;
+    sampletree[node].time += elapsed;
+  }
+}
+
+static void enable(int usesampling = 0) {
   r1 = rdtsc();
   t1 = now_microseconds() / 1000;
-  PyEval_SetProfile((Py_tracefunc)tracefunc, NULL);
+  sampling = usesampling;
+  if (sampling) {
+    lastsample = r1;
+    sampletree.clear();
+    sampletree.push_back({NULL, 0, 0, 0, 0, 0});
+  } else {
+    PyEval_SetProfile((Py_tracefunc)tracefunc, NULL);
+  }
 }
 
 static void disable() {
-  PyEval_SetProfile(NULL, NULL);
+  if (!sampling)
+    PyEval_SetProfile(NULL, NULL);
   r2 = rdtsc();
   t2 = now_microseconds() / 1000;
   /* calculate rdtscratio */
@@ -395,7 +466,7 @@ static void fprintframetree(
     ncol += fprintf(fp, "%s ", f.name());
 
     /* call count */
-    if (s.count >= countthreshold) {
+    if (!sampling && s.count >= countthreshold) {
       ncol += fprintf(fp, "(%d times) ", s.count);
     }
 
@@ -421,7 +492,23 @@ static void fprintframetree(
   }
 }
 
+/* fill frames, summaries and framechildren from the sampled call tree, so
+ * it is printed like a traced one. The frame ID of a node is its index. */
+static void buildsampledframes() {
+  for (uint32_t i = 1; i < sampletree.size(); i++) {
+    auto& node = sampletree[i];
+    frames[i].assign(node.code, node.parent);
+    summaries[i] = {node.time, node.count};
+    framechildren[node.parent].push_back(i);
+  }
+  summaries[0] = {sampletree[0].time, sampletree[0].count};
+}
+
 static void clear() {
+  for (auto& node : sampletree)
+    Py_XDECREF(node.code);
+  sampletree.clear();
+  samplestack.clear();
   summaries.clear();
   framechildren.clear();
   fid2hash.clear();
@@ -431,6 +518,13 @@ static void clear() {
 }
 
 static void report(FILE* fp = stderr) {
+  if (sampling) {
+    /* the tree is already merged by code, and call counts are unknown */
+    buildsampledframes();
+    fprintframetree(fp, 0);
+    fprintf(fp, "Total time: %.0f ms\n", (double)(r2 - r1) * rdtscratio);
+    return;
+  }
   if (dedup)
     buildframededup();
   buildsummaries();
@@ -24,6 +24,13 @@
 #include "eden/scm/edenscm/mercurial/bitmanipulation.h"
 #include "eden/scm/edenscm/mercurial/compat.h"
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
 /* Hash implementation from diffutils */
 #define ROL(v, n) ((v) << (n) | (v) >> (sizeof(v) * CHAR_BIT - (n)))
 #define HASH(h, c) ((c) + ROL(h, 7))
@@ -267,6 +274,37 @@ static struct bdiff_hunk* recurse(
   }
 }
 
+/* normalize the hunk list, try to push each hunk towards the end */
+static int normalize(
+    struct bdiff_line* a,
+    int an,
+    struct bdiff_line* b,
+    int bn,
+    struct bdiff_hunk* base) {
+  struct bdiff_hunk* curr;
+  int count = 0;
+
+  for (curr = base->next; curr; curr = curr->next) {
+    struct bdiff_hunk* next = curr->next;
+
+    if (!next)
+      break;
+
+    if (curr->a2 == next->a1 || curr->b2 == next->b1)
+      while (curr->a2 < an && curr->b2 < bn && next->a1 < next->a2 &&
+             next->b1 < next->b2 && !cmp(a + curr->a2, b + curr->b2)) {
+        curr->a2++;
+        next->a1++;
+        curr->b2++;
+        next->b1++;
+      }
+  }
+
+  for (curr = base->next; curr; curr = curr->next)
+    count++;
+  return count;
+}
+
 int bdiff_diff(
     struct bdiff_line* a,
     int an,
@@ -275,7 +313,7 @@ int bdiff_diff(
     struct bdiff_hunk* base) {
   struct bdiff_hunk* curr;
   struct pos* pos;
-  int t, count = 0;
+  int t;
 
   /* allocate and fill arrays */
   t = equatelines(a, an, b, bn);
@@ -300,25 +338,329 @@ int bdiff_diff(
 
   free(pos);
 
-  /* normalize the hunk list, try to push each hunk towards the end */
-  for (curr = base->next; curr; curr = curr->next) {
-    struct bdiff_hunk* next = curr->next;
+  return normalize(a, an, b, bn, base);
+}
 
-    if (!next)
+/* inputs with fewer lines than this on either side are diffed in one piece */
+#define CHUNKED_MIN_LINES 65536
+/* the chunks have at least this many lines of a and b on average */
+#define CHUNK_LINES 16384
+#define MAX_THREADS 8
+/* the hunks are found recursively, so give the threads a main-sized stack */
+#define THREAD_STACK_SIZE (8 * 1024 * 1024)
+
+struct uniq {
+  int a, b; /* first occurrence in a and b, or -1 */
+  int an, bn; /* occurrences in a and b, counting up to 2 */
+};
+
+struct chunk {
+  int a1, a2, b1, b2;
+  int count;
+  struct bdiff_hunk base;
+};
+
+struct chunkjob {
+  struct bdiff_line *a, *b;
+  struct chunk* chunks;
+  int nchunks, first, step;
+};
+
+static size_t uniqslot(
+    struct uniq* h,
+    size_t mask,
+    struct bdiff_line* a,
+    struct bdiff_line* b,
+    struct bdiff_line* l) {
+  unsigned x = (unsigned)l->hash;
+  size_t j;
+
+  /* the low bits of the line hashes are poorly distributed */
+  x = (x ^ (x >> 16)) * 0x45d9f3bu;
+  x ^= x >> 16;
+  for (j = x & mask; h[j].a != -1 || h[j].b != -1; j = (j + 1) & mask)
+    if (!cmp(l, h[j].a != -1 ? a + h[j].a : b + h[j].b))
       break;
+  return j;
+}
 
-    if (curr->a2 == next->a1 || curr->b2 == next->b1)
-      while (curr->a2 < an && curr->b2 < bn && next->a1 < next->a2 &&
-             next->b1 < next->b2 && !cmp(a + curr->a2, b + curr->b2)) {
-        curr->a2++;
-        next->a1++;
-        curr->b2++;
-        next->b1++;
+/*
+ * Split a and b into chunks at lines that occur exactly once in each of
+ * them, keeping the longest run of such lines that match in order as
+ * patience diff does. Only the anchors closing a chunk of about CHUNK_LINES
+ * lines are used, so that the output loses little to the chunk boundaries.
+ */
+static int findchunks(
+    struct bdiff_line* a,
+    int an,
+    struct bdiff_line* b,
+    int bn,
+    struct chunk** cr) {
+  struct uniq* h = NULL;
+  struct chunk* c = NULL;
+  int *pa = NULL, *pb = NULL, *tails = NULL, *prev = NULL;
+  int i, k = 0, n = 0, p, lo, hi, mid, a1 = 0, b1 = 0, nchunks = -1;
+  size_t j, buckets = 1;
+
+  /* keep the hash table at most half full */
+  while (buckets < (size_t)an + bn + 1)
+    buckets *= 2;
+  buckets *= 2;
+
+  h = (struct uniq*)malloc(buckets * sizeof(struct uniq));
+  pa = (int*)malloc(an * sizeof(int));
+  pb = (int*)malloc(an * sizeof(int));
+  tails = (int*)malloc(an * sizeof(int));
+  prev = (int*)malloc(an * sizeof(int));
+  if (!h || !pa || !pb || !tails || !prev)
+    goto done;
+
+  for (j = 0; j < buckets; j++) {
+    h[j].a = h[j].b = -1;
+    h[j].an = h[j].bn = 0;
+  }
+
+  /* count the occurrences of each line, remembering the slots of a */
+  for (i = 0; i < an; i++) {
+    j = uniqslot(h, buckets - 1, a, b, a + i);
+    if (h[j].a == -1)
+      h[j].a = i;
+    if (h[j].an < 2)
+      h[j].an++;
+    pa[i] = (int)j;
+  }
+  for (i = 0; i < bn; i++) {
+    j = uniqslot(h, buckets - 1, a, b, b + i);
+    if (h[j].b == -1)
+      h[j].b = i;
+    if (h[j].bn < 2)
+      h[j].bn++;
+  }
+
+  /* pair the unique lines, in the order of a */
+  for (i = 0; i < an; i++) {
+    j = pa[i];
+    if (h[j].an == 1 && h[j].bn == 1) {
+      pa[k] = i;
+      pb[k] = h[j].b;
+      k++;
+    }
+  }
+
+  /* find the longest increasing run of their positions in b */
+  for (p = 0; p < k; p++) {
+    lo = 0;
+    hi = n;
+    while (lo < hi) {
+      mid = (lo + hi) / 2;
+      if (pb[tails[mid]] < pb[p])
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    prev[p] = lo ? tails[lo - 1] : -1;
+    tails[lo] = p;
+    if (lo == n)
+      n++;
+  }
+  for (i = n - 1, p = n ? tails[n - 1] : -1; i >= 0; i--, p = prev[p])
+    tails[i] = p;
+
+  c = (struct chunk*)malloc((n + 1) * sizeof(struct chunk));
+  if (!c)
+    goto done;
+
+  nchunks = 0;
+  for (i = 0; i < n; i++) {
+    int ia = pa[tails[i]], ib = pb[tails[i]];
+
+    if ((ia - a1) + (ib - b1) < 2 * CHUNK_LINES)
+      continue;
+    c[nchunks].a1 = a1;
+    c[nchunks].a2 = ia;
+    c[nchunks].b1 = b1;
+    c[nchunks].b2 = ib;
+    nchunks++;
+    a1 = ia;
+    b1 = ib;
+  }
+  c[nchunks].a1 = a1;
+  c[nchunks].a2 = an;
+  c[nchunks].b1 = b1;
+  c[nchunks].b2 = bn;
+  nchunks++;
+
+  for (i = 0; i < nchunks; i++) {
+    c[i].count = 0;
+    c[i].base.next = NULL;
+  }
+  *cr = c;
+
+done:
+  free(h);
+  free(pa);
+  free(pb);
+  free(tails);
+  free(prev);
+  return nchunks;
+}
+
+static void diffchunks(struct chunkjob* job) {
+  int i;
+
+  for (i = job->first; i < job->nchunks; i += job->step) {
+    struct chunk* c = job->chunks + i;
+    c->count = bdiff_diff(
+        job->a + c->a1,
+        c->a2 - c->a1,
+        job->b + c->b1,
+        c->b2 - c->b1,
+        &c->base);
+  }
+}
+
+#ifdef _WIN32
+typedef HANDLE chunkthread;
+
+static DWORD WINAPI chunkmain(LPVOID job) {
+  diffchunks((struct chunkjob*)job);
+  return 0;
+}
+
+static int startthread(chunkthread* t, struct chunkjob* job) {
+  *t = CreateThread(NULL, THREAD_STACK_SIZE, chunkmain, job, 0, NULL);
+  return *t != NULL;
+}
+
+static void jointhread(chunkthread t) {
+  WaitForSingleObject(t, INFINITE);
+  CloseHandle(t);
+}
+
+static int cpucount(void) {
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return (int)info.dwNumberOfProcessors;
+}
+#else
+typedef pthread_t chunkthread;
+
+static void* chunkmain(void* job) {
+  diffchunks((struct chunkjob*)job);
+  return NULL;
+}
+
+static int startthread(chunkthread* t, struct chunkjob* job) {
+  pthread_attr_t attr;
+  int r;
+
+  if (pthread_attr_init(&attr))
+    return 0;
+  pthread_attr_setstacksize(&attr, THREAD_STACK_SIZE);
+  r = pthread_create(t, &attr, chunkmain, job);
+  pthread_attr_destroy(&attr);
+  return r == 0;
+}
+
+static void jointhread(chunkthread t) {
+  pthread_join(t, NULL);
+}
+
+static int cpucount(void) {
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (int)n : 1;
+}
+#endif
+
+int bdiff_diff_chunked(
+    struct bdiff_line* a,
+    int an,
+    struct bdiff_line* b,
+    int bn,
+    struct bdiff_hunk* base) {
+  struct chunk* chunks = NULL;
+  struct chunkjob jobs[MAX_THREADS];
+  chunkthread threads[MAX_THREADS];
+  int started[MAX_THREADS];
+  struct bdiff_hunk *curr, *h, *next;
+  int i, nchunks, nthreads, count = -1;
+
+  if (an < CHUNKED_MIN_LINES || bn < CHUNKED_MIN_LINES)
+    return bdiff_diff(a, an, b, bn, base);
+
+  nchunks = findchunks(a, an, b, bn, &chunks);
+  if (nchunks < 0)
+    return -1;
+  if (nchunks == 1) {
+    free(chunks);
+    return bdiff_diff(a, an, b, bn, base);
+  }
+
+  nthreads = cpucount();
+  if (nthreads > MAX_THREADS)
+    nthreads = MAX_THREADS;
+  if (nthreads > nchunks)
+    nthreads = nchunks;
+
+  for (i = 0; i < nthreads; i++) {
+    jobs[i].a = a;
+    jobs[i].b = b;
+    jobs[i].chunks = chunks;
+    jobs[i].nchunks = nchunks;
+    jobs[i].first = i;
+    jobs[i].step = nthreads;
+  }
+
+  /* this thread takes the first job, and those no thread could start for */
+  for (i = 1; i < nthreads; i++)
+    started[i] = startthread(&threads[i], &jobs[i]);
+  diffchunks(&jobs[0]);
+  for (i = 1; i < nthreads; i++) {
+    if (started[i])
+      jointhread(threads[i]);
+    else
+      diffchunks(&jobs[i]);
+  }
+
+  for (i = 0; i < nchunks; i++)
+    if (chunks[i].count <= 0)
+      goto done;
+
+  /* join the hunks of the chunks, which all end with a sentinel */
+  curr = base;
+  for (i = 0; i < nchunks; i++) {
+    for (h = chunks[i].base.next; h; h = next) {
+      next = h->next;
+      h->a1 += chunks[i].a1;
+      h->a2 += chunks[i].a1;
+      h->b1 += chunks[i].b1;
+      h->b2 += chunks[i].b1;
+
+      if (!next && i < nchunks - 1) {
+        /* only the last sentinel is kept */
+        free(h);
+      } else if (
+          curr != base && h->a1 < h->a2 && curr->a2 == h->a1 &&
+          curr->b2 == h->b1) {
+        /* a match running across chunks */
+        curr->a2 = h->a2;
+        curr->b2 = h->b2;
+        free(h);
+      } else {
+        curr->next = h;
+        curr = h;
       }
+    }
+    chunks[i].base.next = NULL;
+    curr->next = NULL;
   }
 
-  for (curr = base->next; curr; curr = curr->next)
-    count++;
+  count = normalize(a, an, b, bn, base);
+
+done:
+  for (i = 0; i < nchunks; i++)
+    bdiff_freehunks(chunks[i].base.next);
+  free(chunks);
   return count;
 }
 
@@ -36,6 +36,17 @@ int bdiff_diff(
     struct bdiff_line* b,
     int bn,
     struct bdiff_hunk* base);
+/*
+ * Like bdiff_diff, but large inputs are split at matching unique lines and
+ * the pieces are diffed on several threads. The hunks may differ slightly
+ * from those of bdiff_diff.
+ */
+int bdiff_diff_chunked(
+    struct bdiff_line* a,
+    int an,
+    struct bdiff_line* b,
+    int bn,
+    struct bdiff_hunk* base);
 void bdiff_freehunks(struct bdiff_hunk* l);
 
 #endif
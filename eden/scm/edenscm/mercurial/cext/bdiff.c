@@ -106,7 +106,7 @@ static PyObject* bdiff(PyObject* self, PyObject* args) {
   if (!al || !bl)
     goto nomem;
 
-  count = bdiff_diff(al, an, bl, bn, &l);
+  count = bdiff_diff_chunked(al, an, bl, bn, &l);
   if (count < 0)
     goto nomem;
 
@@ -123,6 +123,359 @@ static const char hexchartable[16] = {
     'f',
 };
 
+/*
+ * Vectorized kernels for the loops below. Each one handles a prefix of its
+ * input in whole blocks and returns the length of that prefix. It stops at
+ * the first block needing per-byte handling, which the table-driven loops
+ * then take over. The best implementation for the CPU is picked once when
+ * the module is loaded.
+ */
+typedef struct {
+  const char* name;
+  /* length of a prefix without bytes >= 0x80 */
+  Py_ssize_t (*asciiprefix)(const char* buf, Py_ssize_t len);
+  /* same, case-folding the prefix from src into dst */
+  Py_ssize_t (*foldprefix)(
+      char* dst,
+      const char* src,
+      Py_ssize_t len,
+      bool upper);
+  /* length of a prefix that needs no JSON escaping */
+  Py_ssize_t (*jsonprefix)(const char* buf, Py_ssize_t len, bool paranoid);
+} charencodekernels;
+
+/* the per-byte loops process this many bytes before retrying a kernel */
+#define KERNEL_RESUME 32
+
+#define ONES64 0x0101010101010101ULL
+#define HIGHS64 0x8080808080808080ULL
+
+static Py_ssize_t asciiprefix_word(const char* buf, Py_ssize_t len) {
+  Py_ssize_t i;
+  for (i = 0; i + 8 <= len; i += 8) {
+    uint64_t w;
+    memcpy(&w, buf + i, 8);
+    if (w & HIGHS64)
+      break;
+  }
+  return i;
+}
+
+static Py_ssize_t
+foldprefix_word(char* dst, const char* src, Py_ssize_t len, bool upper) {
+  /* with no byte >= 0x80, adding these cannot carry across bytes, and
+     bit 7 of each byte ends up set in (w + from) ^ (w + to) if it is in
+     the range to fold */
+  const uint64_t from = (0x80 - (upper ? 'a' : 'A')) * ONES64;
+  const uint64_t to = (0x80 - (upper ? 'z' : 'Z') - 1) * ONES64;
+  Py_ssize_t i;
+  for (i = 0; i + 8 <= len; i += 8) {
+    uint64_t w, inrange;
+    memcpy(&w, src + i, 8);
+    if (w & HIGHS64)
+      break;
+    inrange = ((w + from) ^ (w + to)) & HIGHS64;
+    w ^= inrange >> 2;
+    memcpy(dst + i, &w, 8);
+  }
+  return i;
+}
+
+static Py_ssize_t
+jsonprefix_word(const char* buf, Py_ssize_t len, bool paranoid) {
+  return 0;
+}
+
+static const charencodekernels wordkernels = {
+    "word",
+    asciiprefix_word,
+    foldprefix_word,
+    jsonprefix_word,
+};
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+
+static Py_ssize_t asciiprefix_sse2(const char* buf, Py_ssize_t len) {
+  Py_ssize_t i;
+  for (i = 0; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(buf + i));
+    if (_mm_movemask_epi8(v))
+      break;
+  }
+  return i;
+}
+
+static Py_ssize_t
+foldprefix_sse2(char* dst, const char* src, Py_ssize_t len, bool upper) {
+  /* bytes >= 0x80 compare as negative, and are never in range */
+  const __m128i lo = _mm_set1_epi8((upper ? 'a' : 'A') - 1);
+  const __m128i hi = _mm_set1_epi8((upper ? 'z' : 'Z') + 1);
+  const __m128i bit = _mm_set1_epi8(0x20);
+  Py_ssize_t i;
+  for (i = 0; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+    __m128i inrange;
+    if (_mm_movemask_epi8(v))
+      break;
+    inrange = _mm_and_si128(_mm_cmpgt_epi8(v, lo), _mm_cmplt_epi8(v, hi));
+    v = _mm_xor_si128(v, _mm_and_si128(inrange, bit));
+    _mm_storeu_si128((__m128i*)(dst + i), v);
+  }
+  return i;
+}
+
+static Py_ssize_t
+jsonprefix_sse2(const char* buf, Py_ssize_t len, bool paranoid) {
+  const __m128i ctl = _mm_set1_epi8(0x1f);
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i del = _mm_set1_epi8(0x7f);
+  const __m128i lt = _mm_set1_epi8('<');
+  const __m128i gt = _mm_set1_epi8('>');
+  Py_ssize_t i;
+  for (i = 0; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(buf + i));
+    __m128i esc = _mm_or_si128(
+        _mm_or_si128(
+            _mm_cmpeq_epi8(_mm_min_epu8(v, ctl), v),
+            _mm_cmpeq_epi8(v, quote)),
+        _mm_or_si128(_mm_cmpeq_epi8(v, backslash), _mm_cmpeq_epi8(v, del)));
+    if (paranoid) {
+      esc = _mm_or_si128(
+          _mm_or_si128(esc, v),
+          _mm_or_si128(_mm_cmpeq_epi8(v, lt), _mm_cmpeq_epi8(v, gt)));
+    }
+    if (_mm_movemask_epi8(esc))
+      break;
+  }
+  return i;
+}
+
+static const charencodekernels sse2kernels = {
+    "sse2",
+    asciiprefix_sse2,
+    foldprefix_sse2,
+    jsonprefix_sse2,
+};
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define HAVE_AVX2_KERNELS
+#include <immintrin.h>
+
+/* Compiled for AVX2 regardless of the build flags. These are only called
+   after checking the CPU, and hand the tail over to SSE2. */
+#define AVX2_TARGET __attribute__((target("avx2")))
+
+AVX2_TARGET static Py_ssize_t asciiprefix_avx2(
+    const char* buf,
+    Py_ssize_t len) {
+  Py_ssize_t i;
+  for (i = 0; i + 32 <= len; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(buf + i));
+    if (_mm256_movemask_epi8(v))
+      return i;
+  }
+  return i + asciiprefix_sse2(buf + i, len - i);
+}
+
+AVX2_TARGET static Py_ssize_t
+foldprefix_avx2(char* dst, const char* src, Py_ssize_t len, bool upper) {
+  const __m256i lo = _mm256_set1_epi8((upper ? 'a' : 'A') - 1);
+  const __m256i hi = _mm256_set1_epi8((upper ? 'z' : 'Z') + 1);
+  const __m256i bit = _mm256_set1_epi8(0x20);
+  Py_ssize_t i;
+  for (i = 0; i + 32 <= len; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(src + i));
+    __m256i inrange;
+    if (_mm256_movemask_epi8(v))
+      return i;
+    inrange = _mm256_and_si256(
+        _mm256_cmpgt_epi8(v, lo), _mm256_cmpgt_epi8(hi, v));
+    v = _mm256_xor_si256(v, _mm256_and_si256(inrange, bit));
+    _mm256_storeu_si256((__m256i*)(dst + i), v);
+  }
+  return i + foldprefix_sse2(dst + i, src + i, len - i, upper);
+}
+
+AVX2_TARGET static Py_ssize_t
+jsonprefix_avx2(const char* buf, Py_ssize_t len, bool paranoid) {
+  const __m256i ctl = _mm256_set1_epi8(0x1f);
+  const __m256i quote = _mm256_set1_epi8('"');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  const __m256i del = _mm256_set1_epi8(0x7f);
+  const __m256i lt = _mm256_set1_epi8('<');
+  const __m256i gt = _mm256_set1_epi8('>');
+  Py_ssize_t i;
+  for (i = 0; i + 32 <= len; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i*)(buf + i));
+    __m256i esc = _mm256_or_si256(
+        _mm256_or_si256(
+            _mm256_cmpeq_epi8(_mm256_min_epu8(v, ctl), v),
+            _mm256_cmpeq_epi8(v, quote)),
+        _mm256_or_si256(
+            _mm256_cmpeq_epi8(v, backslash), _mm256_cmpeq_epi8(v, del)));
+    if (paranoid) {
+      esc = _mm256_or_si256(
+          _mm256_or_si256(esc, v),
+          _mm256_or_si256(
+              _mm256_cmpeq_epi8(v, lt), _mm256_cmpeq_epi8(v, gt)));
+    }
+    if (_mm256_movemask_epi8(esc))
+      return i;
+  }
+  return i + jsonprefix_sse2(buf + i, len - i, paranoid);
+}
+
+static const charencodekernels avx2kernels = {
+    "avx2",
+    asciiprefix_avx2,
+    foldprefix_avx2,
+    jsonprefix_avx2,
+};
+#endif /* __x86_64__ */
+
+#define DEFAULT_KERNELS sse2kernels
+
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+
+static Py_ssize_t asciiprefix_neon(const char* buf, Py_ssize_t len) {
+  Py_ssize_t i;
+  for (i = 0; i + 16 <= len; i += 16) {
+    uint8x16_t v = vld1q_u8((const uint8_t*)(buf + i));
+    if (vmaxvq_u8(v) & 0x80)
+      break;
+  }
+  return i;
+}
+
+static Py_ssize_t
+foldprefix_neon(char* dst, const char* src, Py_ssize_t len, bool upper) {
+  const uint8x16_t lo = vdupq_n_u8(upper ? 'a' : 'A');
+  const uint8x16_t hi = vdupq_n_u8(upper ? 'z' : 'Z');
+  const uint8x16_t bit = vdupq_n_u8(0x20);
+  Py_ssize_t i;
+  for (i = 0; i + 16 <= len; i += 16) {
+    uint8x16_t v = vld1q_u8((const uint8_t*)(src + i));
+    uint8x16_t inrange;
+    if (vmaxvq_u8(v) & 0x80)
+      break;
+    inrange = vandq_u8(vcgeq_u8(v, lo), vcleq_u8(v, hi));
+    v = veorq_u8(v, vandq_u8(inrange, bit));
+    vst1q_u8((uint8_t*)(dst + i), v);
+  }
+  return i;
+}
+
+static Py_ssize_t
+jsonprefix_neon(const char* buf, Py_ssize_t len, bool paranoid) {
+  const uint8x16_t ctl = vdupq_n_u8(0x20);
+  const uint8x16_t quote = vdupq_n_u8('"');
+  const uint8x16_t backslash = vdupq_n_u8('\\');
+  const uint8x16_t del = vdupq_n_u8(0x7f);
+  const uint8x16_t lt = vdupq_n_u8('<');
+  const uint8x16_t gt = vdupq_n_u8('>');
+  const uint8x16_t high = vdupq_n_u8(0x80);
+  Py_ssize_t i;
+  for (i = 0; i + 16 <= len; i += 16) {
+    uint8x16_t v = vld1q_u8((const uint8_t*)(buf + i));
+    uint8x16_t esc = vorrq_u8(
+        vorrq_u8(vcltq_u8(v, ctl), vceqq_u8(v, quote)),
+        vorrq_u8(vceqq_u8(v, backslash), vceqq_u8(v, del)));
+    if (paranoid) {
+      esc = vorrq_u8(
+          vorrq_u8(esc, vcgeq_u8(v, high)),
+          vorrq_u8(vceqq_u8(v, lt), vceqq_u8(v, gt)));
+    }
+    if (vmaxvq_u8(esc))
+      break;
+  }
+  return i;
+}
+
+static const charencodekernels neonkernels = {
+    "neon",
+    asciiprefix_neon,
+    foldprefix_neon,
+    jsonprefix_neon,
+};
+
+#define DEFAULT_KERNELS neonkernels
+
+#else
+#define DEFAULT_KERNELS wordkernels
+#endif
+
+/* in order of preference */
+static const charencodekernels* const allkernels[] = {
+#ifdef HAVE_AVX2_KERNELS
+    &avx2kernels,
+#endif
+    &DEFAULT_KERNELS,
+    &wordkernels,
+};
+
+static const charencodekernels* kernels = &DEFAULT_KERNELS;
+
+static bool kernelssupported(const charencodekernels* k) {
+#ifdef HAVE_AVX2_KERNELS
+  if (k == &avx2kernels)
+    return __builtin_cpu_supports("avx2");
+#endif
+  return true;
+}
+
+/* select kernels by name, to compare implementations in tests */
+PyObject* setcharencodekernels(PyObject* self, PyObject* args) {
+  const char* name;
+  size_t i;
+  if (!PyArg_ParseTuple(args, "s:setcharencodekernels", &name))
+    return NULL;
+  for (i = 0; i < sizeof(allkernels) / sizeof(allkernels[0]); i++) {
+    if (strcmp(allkernels[i]->name, name) == 0 &&
+        kernelssupported(allkernels[i])) {
+      kernels = allkernels[i];
+      Py_RETURN_NONE;
+    }
+  }
+  PyErr_Format(PyExc_ValueError, "unsupported kernels: %s", name);
+  return NULL;
+}
+
+void charencode_module_init(PyObject* mod) {
+  PyObject* names;
+  size_t i;
+
+  for (i = 0; i < sizeof(allkernels) / sizeof(allkernels[0]); i++) {
+    if (kernelssupported(allkernels[i])) {
+      kernels = allkernels[i];
+      break;
+    }
+  }
+
+  names = PyList_New(0);
+  if (!names)
+    return;
+  for (i = 0; i < sizeof(allkernels) / sizeof(allkernels[0]); i++) {
+    PyObject* name;
+    /* the default kernels may also be the word ones */
+    if (i > 0 && allkernels[i] == allkernels[i - 1])
+      continue;
+    if (!kernelssupported(allkernels[i]))
+      continue;
+    name = PyUnicode_FromString(allkernels[i]->name);
+    if (!name || PyList_Append(names, name) == -1) {
+      Py_XDECREF(name);
+      Py_DECREF(names);
+      return;
+    }
+    Py_DECREF(name);
+  }
+  /* names of the usable kernels, the one in use first */
+  PyModule_AddObject(mod, "charencodekernels", names);
+}
+
 /*
  * Turn a hex-encoded string into binary.
  */
@@ -152,42 +505,44 @@ PyObject* isasciistr(PyObject* self, PyObject* args) {
   Py_ssize_t i, len;
   if (!PyArg_ParseTuple(args, "s#:isasciistr", &buf, &len))
     return NULL;
-  i = 0;
-  /* char array in PyStringObject should be at least 4-byte aligned */
-  if (((uintptr_t)buf & 3) == 0) {
-    const uint32_t* p = (const uint32_t*)buf;
-    for (; i < len / 4; i++) {
-      if (p[i] & 0x80808080U)
-        Py_RETURN_FALSE;
-    }
-    i *= 4;
-  }
-  for (; i < len; i++) {
+  for (i = kernels->asciiprefix(buf, len); i < len; i++) {
     if (buf[i] & 0x80)
       Py_RETURN_FALSE;
   }
   Py_RETURN_TRUE;
 }
 
-static inline PyObject* _asciitransform(
-    PyObject* str_obj,
-    const char table[128],
-    PyObject* fallback_fn) {
-  char *str, *newstr;
+static inline PyObject*
+_asciitransform(PyObject* str_obj, bool upper, PyObject* fallback_fn) {
+  const char* table = upper ? uppertable : lowertable;
+  const char* str;
+  char* newstr;
   Py_ssize_t i, len;
   PyObject* newobj = NULL;
   PyObject* ret = NULL;
 
-  str = PyBytes_AS_STRING(str_obj);
-  len = PyBytes_GET_SIZE(str_obj);
-
-  newobj = PyBytes_FromStringAndSize(NULL, len);
-  if (!newobj)
-    goto quit;
-
-  newstr = PyBytes_AS_STRING(newobj);
+#ifdef IS_PY3K
+  if (PyUnicode_Check(str_obj)) {
+    /* the UTF-8 form of an ASCII str is its data, with no copy made */
+    str = PyUnicode_AsUTF8AndSize(str_obj, &len);
+    if (!str)
+      goto quit;
+    newobj = PyUnicode_New(len, 127);
+    if (!newobj)
+      goto quit;
+    newstr = (char*)PyUnicode_1BYTE_DATA(newobj);
+  } else
+#endif
+  {
+    str = PyBytes_AS_STRING(str_obj);
+    len = PyBytes_GET_SIZE(str_obj);
+    newobj = PyBytes_FromStringAndSize(NULL, len);
+    if (!newobj)
+      goto quit;
+    newstr = PyBytes_AS_STRING(newobj);
+  }
 
-  for (i = 0; i < len; i++) {
+  for (i = kernels->foldprefix(newstr, str, len, upper); i < len; i++) {
     char c = str[i];
     if (c & 0x80) {
       if (fallback_fn != NULL) {
@@ -214,14 +569,77 @@ PyObject* asciilower(PyObject* self, PyObject* args) {
   PyObject* str_obj;
   if (!PyArg_ParseTuple(args, "O!:asciilower", &PyBytes_Type, &str_obj))
     return NULL;
-  return _asciitransform(str_obj, lowertable, NULL);
+  return _asciitransform(str_obj, false, NULL);
 }
 
 PyObject* asciiupper(PyObject* self, PyObject* args) {
   PyObject* str_obj;
   if (!PyArg_ParseTuple(args, "O!:asciiupper", &PyBytes_Type, &str_obj))
     return NULL;
-  return _asciitransform(str_obj, uppertable, NULL);
+  return _asciitransform(str_obj, true, NULL);
+}
+
+static PyObject* _asciitransformmany(PyObject* args, bool upper) {
+  PyObject *paths, *seq, *result = NULL;
+  PyObject* fallback_fn = Py_None;
+  PyObject** items;
+  Py_ssize_t i, len;
+
+  if (!PyArg_ParseTuple(
+          args,
+          upper ? "O|O:asciiuppermany" : "O|O:asciilowermany",
+          &paths,
+          &fallback_fn))
+    return NULL;
+  if (fallback_fn == Py_None) {
+    fallback_fn = NULL;
+  } else if (!PyCallable_Check(fallback_fn)) {
+    PyErr_SetString(PyExc_TypeError, "fallback must be callable");
+    return NULL;
+  }
+
+  seq = PySequence_Fast(paths, "expected a sequence of paths");
+  if (!seq)
+    return NULL;
+  len = PySequence_Fast_GET_SIZE(seq);
+  items = PySequence_Fast_ITEMS(seq);
+
+  result = PyList_New(len);
+  if (!result)
+    goto bail;
+  for (i = 0; i < len; i++) {
+    PyObject* normed;
+#ifdef IS_PY3K
+    if (!PyBytes_Check(items[i]) && !PyUnicode_Check(items[i])) {
+      PyErr_SetString(PyExc_TypeError, "expected bytes or str");
+      goto bail;
+    }
+#else
+    if (!PyBytes_Check(items[i])) {
+      PyErr_SetString(PyExc_TypeError, "expected a string");
+      goto bail;
+    }
+#endif
+    normed = _asciitransform(items[i], upper, fallback_fn);
+    if (!normed)
+      goto bail;
+    PyList_SET_ITEM(result, i, normed);
+  }
+  Py_DECREF(seq);
+  return result;
+
+bail:
+  Py_XDECREF(result);
+  Py_DECREF(seq);
+  return NULL;
+}
+
+PyObject* asciilowermany(PyObject* self, PyObject* args) {
+  return _asciitransformmany(args, false);
+}
+
+PyObject* asciiuppermany(PyObject* self, PyObject* args) {
+  return _asciitransformmany(args, true);
 }
 
 PyObject* make_file_foldmap(PyObject* self, PyObject* args) {
@@ -231,7 +649,6 @@ PyObject* make_file_foldmap(PyObject* self, PyObject* args) {
   PyObject *k, *v;
   dirstateTupleObject* tuple;
   Py_ssize_t pos = 0;
-  const char* table;
 
   if (!PyArg_ParseTuple(
           args,
@@ -247,13 +664,8 @@ PyObject* make_file_foldmap(PyObject* self, PyObject* args) {
   spec = (int)PyInt_AS_LONG(spec_obj);
   switch (spec) {
     case NORMCASE_LOWER:
-      table = lowertable;
-      break;
     case NORMCASE_UPPER:
-      table = uppertable;
-      break;
     case NORMCASE_OTHER:
-      table = NULL;
       break;
     default:
       PyErr_SetString(PyExc_TypeError, "invalid normcasespec");
@@ -275,8 +687,9 @@ PyObject* make_file_foldmap(PyObject* self, PyObject* args) {
     tuple = (dirstateTupleObject*)v;
     if (tuple->state != 'r') {
       PyObject* normed;
-      if (table != NULL) {
-        normed = _asciitransform(k, table, normcase_fallback);
+      if (spec != NORMCASE_OTHER) {
+        normed =
+            _asciitransform(k, spec == NORMCASE_UPPER, normcase_fallback);
       } else {
         normed = PyObject_CallFunctionObjArgs(normcase_fallback, k, NULL);
       }
@@ -299,26 +712,22 @@ quit:
 /* calculate length of JSON-escaped string; returns -1 if unsupported */
 static Py_ssize_t
 jsonescapelen(const char* buf, Py_ssize_t len, bool paranoid) {
-  Py_ssize_t i, esclen = 0;
-
-  if (paranoid) {
-    /* don't want to process multi-byte escapes in C */
-    for (i = 0; i < len; i++) {
+  const uint8_t* lentable = (paranoid) ? jsonparanoidlentable : jsonlentable;
+  Py_ssize_t i = 0, esclen = 0;
+
+  while (i < len) {
+    Py_ssize_t end, plain = kernels->jsonprefix(buf + i, len - i, paranoid);
+    i += plain;
+    esclen += plain;
+    end = (len - i > KERNEL_RESUME) ? i + KERNEL_RESUME : len;
+    for (; i < end; i++) {
       char c = buf[i];
-      if (c & 0x80) {
+      if (paranoid && (c & 0x80)) {
+        /* don't want to process multi-byte escapes in C */
         PyErr_SetString(PyExc_ValueError, "cannot process non-ascii str");
         return -1;
       }
-      esclen += jsonparanoidlentable[(unsigned char)c];
-      if (esclen < 0) {
-        PyErr_SetString(PyExc_MemoryError, "overflow in jsonescapelen");
-        return -1;
-      }
-    }
-  } else {
-    for (i = 0; i < len; i++) {
-      char c = buf[i];
-      esclen += jsonlentable[(unsigned char)c];
+      esclen += lentable[(unsigned char)c];
       if (esclen < 0) {
         PyErr_SetString(PyExc_MemoryError, "overflow in jsonescapelen");
         return -1;
@@ -359,27 +768,36 @@ static void encodejsonescape(
     Py_ssize_t origlen,
     bool paranoid) {
   const uint8_t* lentable = (paranoid) ? jsonparanoidlentable : jsonlentable;
-  Py_ssize_t i, j;
-
-  for (i = 0, j = 0; i < origlen; i++) {
-    char c = origbuf[i];
-    uint8_t l = lentable[(unsigned char)c];
-    assert(j + l <= esclen);
-    switch (l) {
-      case 1:
-        escbuf[j] = c;
-        break;
-      case 2:
-        escbuf[j] = '\\';
-        escbuf[j + 1] = jsonescapechar2(c);
-        break;
-      case 6:
-        memcpy(escbuf + j, "\\u00", 4);
-        escbuf[j + 4] = hexchartable[(unsigned char)c >> 4];
-        escbuf[j + 5] = hexchartable[(unsigned char)c & 0xf];
-        break;
+  Py_ssize_t i = 0, j = 0;
+
+  while (i < origlen) {
+    Py_ssize_t end, plain;
+    plain = kernels->jsonprefix(origbuf + i, origlen - i, paranoid);
+    assert(j + plain <= esclen);
+    memcpy(escbuf + j, origbuf + i, plain);
+    i += plain;
+    j += plain;
+    end = (origlen - i > KERNEL_RESUME) ? i + KERNEL_RESUME : origlen;
+    for (; i < end; i++) {
+      char c = origbuf[i];
+      uint8_t l = lentable[(unsigned char)c];
+      assert(j + l <= esclen);
+      switch (l) {
+        case 1:
+          escbuf[j] = c;
+          break;
+        case 2:
+          escbuf[j] = '\\';
+          escbuf[j + 1] = jsonescapechar2(c);
+          break;
+        case 6:
+          memcpy(escbuf + j, "\\u00", 4);
+          escbuf[j + 4] = hexchartable[(unsigned char)c >> 4];
+          escbuf[j + 5] = hexchartable[(unsigned char)c & 0xf];
+          break;
+      }
+      j += l;
     }
-    j += l;
   }
 }
 
@@ -31,8 +31,11 @@ PyObject* unhexlify(const char* str, Py_ssize_t len);
 PyObject* isasciistr(PyObject* self, PyObject* args);
 PyObject* asciilower(PyObject* self, PyObject* args);
 PyObject* asciiupper(PyObject* self, PyObject* args);
+PyObject* asciilowermany(PyObject* self, PyObject* args);
+PyObject* asciiuppermany(PyObject* self, PyObject* args);
 PyObject* make_file_foldmap(PyObject* self, PyObject* args);
 PyObject* jsonescapeu8fast(PyObject* self, PyObject* args);
+PyObject* setcharencodekernels(PyObject* self, PyObject* args);
 
 static const int8_t hextable[256] = {
     -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
@@ -16,145 +16,243 @@
 
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "eden/scm/edenscm/mercurial/cext/util.h"
 
-#ifdef IS_PY3K
-#define PYLONG_VALUE(o) ((PyLongObject*)o)->ob_digit[1]
-#else
-#define PYLONG_VALUE(o) PyInt_AS_LONG(o)
-#endif
-
 /*
  * This is a multiset of directory names, built from the files that
  * appear in a dirstate or manifest.
  *
  * A few implementation notes:
  *
- * We modify Python integers for refcounting, but those integers are
- * never visible to Python code.
+ * Directories live in an open-addressing hash table of our own rather
+ * than in a dict, so that adding a path whose directories are already
+ * known creates no Python objects at all. An entry does not copy its
+ * name: it points into the first path the directory was seen in, and
+ * holds a reference to that path.
  *
- * We mutate strings in-place, but leave them immutable once they can
- * be seen by Python code.
+ * All the prefix hashes of a path are taken in a single forward pass
+ * over it, stopping at its last slash.
  */
 typedef struct {
-  PyObject_HEAD PyObject* dict;
+  uint64_t hash; /* of the name, 0 if the slot is free */
+  const char* name; /* points into owner, not NUL-terminated */
+  Py_ssize_t len;
+  Py_ssize_t count;
+  PyObject* owner; /* path the name was first seen in */
+} dirsEntry;
+
+typedef struct {
+  PyObject_HEAD dirsEntry* table;
+  size_t capacity; /* # slots, a power of two */
+  size_t length; /* # slots in use */
 } dirsObject;
 
-static inline Py_ssize_t _finddir(const char* path, Py_ssize_t pos) {
-  while (pos != -1) {
-    if (path[pos] == '/')
-      break;
-    pos -= 1;
+/* A directory of a path being added or removed. */
+typedef struct {
+  Py_ssize_t len;
+  uint64_t hash;
+} dirsPrefix;
+
+static const size_t dirs_mincapacity = 64;
+
+/* Deep enough for the paths seen in practice, which avoids a malloc. */
+#define DIRS_STACKDEPTH 64
+
+#define DIRS_FNV_OFFSET 0xcbf29ce484222325ULL
+#define DIRS_FNV_PRIME 0x100000001b3ULL
+
+static inline uint64_t _hashfinish(uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return h ? h : 1;
+}
+
+static uint64_t _hash(const char* name, Py_ssize_t len) {
+  uint64_t h = DIRS_FNV_OFFSET;
+  Py_ssize_t i;
+
+  for (i = 0; i < len; i++)
+    h = (h ^ (unsigned char)name[i]) * DIRS_FNV_PRIME;
+  return _hashfinish(h);
+}
+
+/*
+ * Fill prefixes with the directories of path, from the root ("") down
+ * to the longest. Return how many there are, or -1 on error. If there
+ * are more than fit in the caller's stack buffer, *prefixes is replaced
+ * with memory the caller must free.
+ */
+static Py_ssize_t
+_prefixes(const char* path, Py_ssize_t len, dirsPrefix** prefixes) {
+  uint64_t h = DIRS_FNV_OFFSET;
+  Py_ssize_t i, n = 0, last = len - 1;
+  Py_ssize_t room = DIRS_STACKDEPTH;
+
+  while (last >= 0 && path[last] != '/')
+    last--;
+
+  (*prefixes)[n].len = 0;
+  (*prefixes)[n++].hash = _hashfinish(h);
+  for (i = 0; i <= last; i++) {
+    if (path[i] == '/') {
+      if (n == room) {
+        dirsPrefix* heap = PyMem_Malloc((len + 1) * sizeof(dirsPrefix));
+        if (heap == NULL) {
+          PyErr_NoMemory();
+          return -1;
+        }
+        memcpy(heap, *prefixes, n * sizeof(dirsPrefix));
+        *prefixes = heap;
+        room = len + 1;
+      }
+      (*prefixes)[n].len = i;
+      (*prefixes)[n++].hash = _hashfinish(h);
+    }
+    h = (h ^ (unsigned char)path[i]) * DIRS_FNV_PRIME;
   }
-  if (pos == -1) {
-    return 0;
+  return n;
+}
+
+/* Return the entry for name, or the free slot where it belongs. */
+static inline dirsEntry* _lookup(
+    const dirsObject* self,
+    const char* name,
+    Py_ssize_t len,
+    uint64_t hash) {
+  size_t mask = self->capacity - 1;
+  size_t i = (size_t)hash & mask;
+
+  for (;; i = (i + 1) & mask) {
+    dirsEntry* e = &self->table[i];
+    if (e->hash == 0 ||
+        (e->hash == hash && e->len == len && memcmp(e->name, name, len) == 0))
+      return e;
   }
+}
 
-  return pos;
+static int _resize(dirsObject* self, size_t capacity) {
+  dirsEntry* old = self->table;
+  size_t i, oldcapacity = self->capacity;
+
+  self->table = calloc(capacity, sizeof(dirsEntry));
+  if (self->table == NULL) {
+    self->table = old;
+    PyErr_NoMemory();
+    return -1;
+  }
+  self->capacity = capacity;
+
+  for (i = 0; i < oldcapacity; i++) {
+    if (old[i].hash) {
+      size_t mask = capacity - 1, j = (size_t)old[i].hash & mask;
+      while (self->table[j].hash)
+        j = (j + 1) & mask;
+      self->table[j] = old[i];
+    }
+  }
+  free(old);
+  return 0;
 }
 
-static int _addpath(PyObject* dirs, PyObject* path) {
+/* Free a slot, shifting back the entries that probed past it. */
+static void _remove(dirsObject* self, dirsEntry* e) {
+  dirsEntry* table = self->table;
+  size_t mask = self->capacity - 1;
+  size_t i = (size_t)(e - table), j = i;
+
+  Py_DECREF(e->owner);
+  for (;;) {
+    size_t k;
+
+    j = (j + 1) & mask;
+    if (table[j].hash == 0)
+      break;
+    /* Move table[j] to i unless its home slot k is in (i, j]. */
+    k = (size_t)table[j].hash & mask;
+    if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+      continue;
+    table[i] = table[j];
+    i = j;
+  }
+  memset(&table[i], 0, sizeof(dirsEntry));
+  self->length--;
+}
+
+static int _addpath(dirsObject* self, PyObject* path) {
   const char* cpath = PyBytes_AS_STRING(path);
-  Py_ssize_t pos = PyBytes_GET_SIZE(path);
-  PyObject* key = NULL;
+  dirsPrefix stack[DIRS_STACKDEPTH], *prefixes = stack;
+  Py_ssize_t n;
   int ret = -1;
 
-  /* This loop is super critical for performance. That's why we inline
-   * access to Python structs instead of going through a supported API.
-   * The implementation, therefore, is heavily dependent on CPython
-   * implementation details. We also commit violations of the Python
-   * "protocol" such as mutating immutable objects. But since we only
-   * mutate objects created in this function or in other well-defined
-   * locations, the references are known so these violations should go
-   * unnoticed. The code for adjusting the length of a PyBytesObject is
-   * essentially a minimal version of _PyBytes_Resize. */
-  while ((pos = _finddir(cpath, pos - 1)) != -1) {
-    PyObject* val;
-
-    /* It's likely that every prefix already has an entry
-       in our dict. Try to avoid allocating and
-       deallocating a string for each prefix we check. */
-    if (key != NULL)
-      ((PyBytesObject*)key)->ob_shash = -1;
-    else {
-      /* Force Python to not reuse a small shared string. */
-      key = PyBytes_FromStringAndSize(cpath, pos < 2 ? 2 : pos);
-      if (key == NULL)
-        goto bail;
-    }
-    /* Py_SIZE(o) refers to the ob_size member of the struct. Yes,
-     * assigning to what looks like a function seems wrong. */
-    Py_SIZE(key) = pos;
-    ((PyBytesObject*)key)->ob_sval[pos] = '\0';
-
-    val = PyDict_GetItem(dirs, key);
-    if (val != NULL) {
-      PYLONG_VALUE(val) += 1;
-      break;
-    }
+  n = _prefixes(cpath, PyBytes_GET_SIZE(path), &prefixes);
+  if (n == -1)
+    return -1;
 
-    /* Force Python to not reuse a small shared int. */
-#ifdef IS_PY3K
-    val = PyLong_FromLong(0x1eadbeef);
-#else
-    val = PyInt_FromLong(0x1eadbeef);
-#endif
+  /* Most of the time, the longest directory is already known. */
+  while (n-- > 0) {
+    dirsEntry* e;
 
-    if (val == NULL)
+    if ((self->length + 1) * 2 > self->capacity &&
+        _resize(self, self->capacity * 2) == -1)
       goto bail;
 
-    PYLONG_VALUE(val) = 1;
-    ret = PyDict_SetItem(dirs, key, val);
-    Py_DECREF(val);
-    if (ret == -1)
-      goto bail;
-    Py_CLEAR(key);
+    e = _lookup(self, cpath, prefixes[n].len, prefixes[n].hash);
+    if (e->hash) {
+      e->count += 1;
+      break;
+    }
+    e->hash = prefixes[n].hash;
+    e->name = cpath;
+    e->len = prefixes[n].len;
+    e->count = 1;
+    e->owner = path;
+    Py_INCREF(path);
+    self->length++;
   }
   ret = 0;
 
 bail:
-  Py_XDECREF(key);
-
+  if (prefixes != stack)
+    PyMem_Free(prefixes);
   return ret;
 }
 
-static int _delpath(PyObject* dirs, PyObject* path) {
-  char* cpath = PyBytes_AS_STRING(path);
-  Py_ssize_t pos = PyBytes_GET_SIZE(path);
-  PyObject* key = NULL;
+static int _delpath(dirsObject* self, PyObject* path) {
+  const char* cpath = PyBytes_AS_STRING(path);
+  dirsPrefix stack[DIRS_STACKDEPTH], *prefixes = stack;
+  Py_ssize_t n;
   int ret = -1;
 
-  while ((pos = _finddir(cpath, pos - 1)) != -1) {
-    PyObject* val;
-
-    key = PyBytes_FromStringAndSize(cpath, pos);
+  n = _prefixes(cpath, PyBytes_GET_SIZE(path), &prefixes);
+  if (n == -1)
+    return -1;
 
-    if (key == NULL)
-      goto bail;
+  while (n-- > 0) {
+    dirsEntry* e = _lookup(self, cpath, prefixes[n].len, prefixes[n].hash);
 
-    val = PyDict_GetItem(dirs, key);
-    if (val == NULL) {
+    if (e->hash == 0) {
       PyErr_SetString(PyExc_ValueError, "expected a value, found none");
       goto bail;
     }
 
-    if (--PYLONG_VALUE(val) <= 0) {
-      if (PyDict_DelItem(dirs, key) == -1)
-        goto bail;
-    } else
+    if (--e->count > 0)
       break;
-    Py_CLEAR(key);
+    _remove(self, e);
   }
   ret = 0;
 
 bail:
-  Py_XDECREF(key);
-
+  if (prefixes != stack)
+    PyMem_Free(prefixes);
   return ret;
 }
 
-static int dirs_fromdict(PyObject* dirs, PyObject* source, char skipchar) {
+static int dirs_fromdict(dirsObject* dirs, PyObject* source, char skipchar) {
   PyObject *key, *value;
   Py_ssize_t pos = 0;
 
@@ -179,10 +277,31 @@ static int dirs_fromdict(PyObject* dirs, PyObject* source, char skipchar) {
   return 0;
 }
 
-static int dirs_fromiter(PyObject* dirs, PyObject* source) {
+static int dirs_fromiter(dirsObject* dirs, PyObject* source) {
   PyObject *iter, *item = NULL;
   int ret;
 
+  /* Lists and tuples are common, and faster to walk directly. */
+  if (PyList_Check(source) || PyTuple_Check(source)) {
+    PyObject* seq = PySequence_Fast(source, "expected a sequence");
+    Py_ssize_t i, len;
+
+    if (seq == NULL)
+      return -1;
+    len = PySequence_Fast_GET_SIZE(seq);
+    for (i = 0; i < len; i++) {
+      item = PySequence_Fast_GET_ITEM(seq, i);
+      if (!PyBytes_Check(item)) {
+        PyErr_SetString(PyExc_TypeError, "expected string");
+        break;
+      }
+      if (_addpath(dirs, item) == -1)
+        break;
+    }
+    Py_DECREF(seq);
+    return PyErr_Occurred() ? -1 : 0;
+  }
+
   iter = PyObject_GetIter(source);
   if (iter == NULL)
     return -1;
@@ -204,41 +323,56 @@ static int dirs_fromiter(PyObject* dirs, PyObject* source) {
   return ret;
 }
 
+static void dirs_clear(dirsObject* self) {
+  size_t i;
+
+  if (self->table == NULL)
+    return;
+  for (i = 0; i < self->capacity; i++) {
+    if (self->table[i].hash)
+      Py_DECREF(self->table[i].owner);
+  }
+  free(self->table);
+  self->table = NULL;
+  self->capacity = self->length = 0;
+}
+
 /*
  * Calculate a refcounted set of directory names for the files in a
  * dirstate.
  */
 static int dirs_init(dirsObject* self, PyObject* args) {
-  PyObject *dirs = NULL, *source = NULL;
+  PyObject* source = NULL;
   char skipchar = 0;
   int ret = -1;
 
-  self->dict = NULL;
+  self->table = NULL;
+  self->capacity = self->length = 0;
 
   if (!PyArg_ParseTuple(args, "|Oc:__init__", &source, &skipchar))
     return -1;
 
-  dirs = PyDict_New();
-
-  if (dirs == NULL)
+  self->table = calloc(dirs_mincapacity, sizeof(dirsEntry));
+  if (self->table == NULL) {
+    PyErr_NoMemory();
     return -1;
+  }
+  self->capacity = dirs_mincapacity;
 
   if (source == NULL)
     ret = 0;
   else if (PyDict_Check(source))
-    ret = dirs_fromdict(dirs, source, skipchar);
+    ret = dirs_fromdict(self, source, skipchar);
   else if (skipchar)
     PyErr_SetString(
         PyExc_ValueError,
         "skip character is only supported "
         "with a dict source");
   else
-    ret = dirs_fromiter(dirs, source);
+    ret = dirs_fromiter(self, source);
 
   if (ret == -1)
-    Py_XDECREF(dirs);
-  else
-    self->dict = dirs;
+    dirs_clear(self);
 
   return ret;
 }
@@ -249,7 +383,19 @@ PyObject* dirs_addpath(dirsObject* self, PyObject* args) {
   if (!PyArg_ParseTuple(args, "O!:addpath", &PyBytes_Type, &path))
     return NULL;
 
-  if (_addpath(self->dict, path) == -1)
+  if (_addpath(self, path) == -1)
+    return NULL;
+
+  Py_RETURN_NONE;
+}
+
+static PyObject* dirs_addpaths(dirsObject* self, PyObject* args) {
+  PyObject* paths;
+
+  if (!PyArg_ParseTuple(args, "O:addpaths", &paths))
+    return NULL;
+
+  if (dirs_fromiter(self, paths) == -1)
     return NULL;
 
   Py_RETURN_NONE;
@@ -261,29 +407,63 @@ static PyObject* dirs_delpath(dirsObject* self, PyObject* args) {
   if (!PyArg_ParseTuple(args, "O!:delpath", &PyBytes_Type, &path))
     return NULL;
 
-  if (_delpath(self->dict, path) == -1)
+  if (_delpath(self, path) == -1)
     return NULL;
 
   Py_RETURN_NONE;
 }
 
 static int dirs_contains(dirsObject* self, PyObject* value) {
-  return PyBytes_Check(value) ? PyDict_Contains(self->dict, value) : 0;
+  const char* name;
+  Py_ssize_t len;
+
+  if (!PyBytes_Check(value))
+    return 0;
+  name = PyBytes_AS_STRING(value);
+  len = PyBytes_GET_SIZE(value);
+  return _lookup(self, name, len, _hash(name, len))->hash != 0;
 }
 
 static void dirs_dealloc(dirsObject* self) {
-  Py_XDECREF(self->dict);
+  dirs_clear(self);
   PyObject_Del(self);
 }
 
 static PyObject* dirs_iter(dirsObject* self) {
-  return PyObject_GetIter(self->dict);
+  PyObject *list, *iter;
+  size_t i;
+  Py_ssize_t n = 0;
+
+  list = PyList_New(self->length);
+  if (list == NULL)
+    return NULL;
+  for (i = 0; i < self->capacity; i++) {
+    const dirsEntry* e = &self->table[i];
+    PyObject* name;
+
+    if (e->hash == 0)
+      continue;
+    name = PyBytes_FromStringAndSize(e->name, e->len);
+    if (name == NULL) {
+      Py_DECREF(list);
+      return NULL;
+    }
+    PyList_SET_ITEM(list, n++, name);
+  }
+
+  iter = PyObject_GetIter(list);
+  Py_DECREF(list);
+  return iter;
 }
 
 static PySequenceMethods dirs_sequence_methods;
 
 static PyMethodDef dirs_methods[] = {
     {"addpath", (PyCFunction)dirs_addpath, METH_VARARGS, "add a path"},
+    {"addpaths",
+     (PyCFunction)dirs_addpaths,
+     METH_VARARGS,
+     "add an iterable of paths"},
     {"delpath", (PyCFunction)dirs_delpath, METH_VARARGS, "remove a path"},
     {NULL} /* Sentinel */
 };
@@ -39,11 +39,12 @@ typedef struct {
 
 typedef struct {
   PyObject_HEAD PyObject* pydata;
-  line* lines;
+  line* lines; /* NULL until a lazy manifest is indexed */
   int numlines; /* number of line entries */
   int livelines; /* number of non-deleted lines */
   int maxlines; /* allocated number of lines */
   bool dirty;
+  bool suffixed; /* whether some line has a hash_suffix */
 } lazymanifest;
 
 #define MANIFEST_OOM -1
@@ -145,21 +146,58 @@ static int find_lines(lazymanifest* self, char* data, Py_ssize_t len) {
   return 0;
 }
 
+static int linecmp(const void* left, const void* right) {
+  return strcmp(((const line*)left)->start, ((const line*)right)->start);
+}
+
+static int set_parse_error(int ret) {
+  switch (ret) {
+    case 0:
+      break;
+    case MANIFEST_OOM:
+      PyErr_NoMemory();
+      break;
+    case MANIFEST_NOT_SORTED:
+      PyErr_Format(PyExc_ValueError, "Manifest lines not in sorted order.");
+      break;
+    case MANIFEST_MALFORMED:
+      PyErr_Format(PyExc_ValueError, "Manifest did not end in a newline.");
+      break;
+    default:
+      PyErr_Format(PyExc_ValueError, "Unknown problem parsing manifest.");
+  }
+  return ret == 0 ? 0 : -1;
+}
+
+/*
+ * With lazy set, the lines are only indexed when first needed, and until
+ * then lookups and diffs work on the sorted text directly. Only whether the
+ * text ends with a newline is checked up front: the order of the lines is
+ * checked when indexing them.
+ */
 static int lazymanifest_init(lazymanifest* self, PyObject* args) {
   char* data;
   Py_ssize_t len;
   int err, ret;
   PyObject* pydata;
-  if (!PyArg_ParseTuple(args, "S", &pydata)) {
+  PyObject* pylazy = NULL;
+  if (!PyArg_ParseTuple(args, "S|O", &pydata, &pylazy)) {
     return -1;
   }
   err = PyBytes_AsStringAndSize(pydata, &data, &len);
 
   self->dirty = false;
+  self->suffixed = false;
+  self->lines = NULL;
+  self->numlines = self->livelines = self->maxlines = 0;
   if (err == -1)
     return -1;
   self->pydata = pydata;
   Py_INCREF(self->pydata);
+  if (pylazy && PyObject_IsTrue(pylazy)) {
+    ret = len > 0 && data[len - 1] != '\n' ? MANIFEST_MALFORMED : 0;
+    return set_parse_error(ret);
+  }
   Py_BEGIN_ALLOW_THREADS self->lines = malloc(DEFAULT_LINES * sizeof(line));
   self->maxlines = DEFAULT_LINES;
   self->numlines = 0;
@@ -167,28 +205,97 @@ static int lazymanifest_init(lazymanifest* self, PyObject* args) {
     ret = MANIFEST_OOM;
   else
     ret = find_lines(self, data, len);
-  Py_END_ALLOW_THREADS switch (ret) {
-    case 0:
-      break;
-    case MANIFEST_OOM:
-      PyErr_NoMemory();
-      break;
-    case MANIFEST_NOT_SORTED:
-      PyErr_Format(PyExc_ValueError, "Manifest lines not in sorted order.");
-      break;
-    case MANIFEST_MALFORMED:
-      PyErr_Format(PyExc_ValueError, "Manifest did not end in a newline.");
-      break;
-    default:
-      PyErr_Format(PyExc_ValueError, "Unknown problem parsing manifest.");
+  Py_END_ALLOW_THREADS return set_parse_error(ret);
+}
+
+/* Index the lines of a lazy manifest, if it hasn't been yet. */
+static int ensure_lines(lazymanifest* self) {
+  char* data;
+  Py_ssize_t len;
+  int ret;
+  if (self->lines)
+    return 0;
+  if (PyBytes_AsStringAndSize(self->pydata, &data, &len) == -1)
+    return -1;
+  self->lines = malloc(DEFAULT_LINES * sizeof(line));
+  self->maxlines = DEFAULT_LINES;
+  self->numlines = 0;
+  if (!self->lines)
+    ret = MANIFEST_OOM;
+  else
+    ret = find_lines(self, data, len);
+  if (ret != 0) {
+    free(self->lines);
+    self->lines = NULL;
+    self->numlines = self->livelines = self->maxlines = 0;
   }
-  return ret == 0 ? 0 : -1;
+  return set_parse_error(ret);
+}
+
+/* Find the start of the line of the manifest text containing data[pos]. */
+static Py_ssize_t text_linestart(const char* data, Py_ssize_t pos) {
+  while (pos > 0 && data[pos - 1] != '\n')
+    pos--;
+  return pos;
+}
+
+/*
+ * Bisect the sorted lines of the manifest text in [lo, hi), which must
+ * start and end on line boundaries, for the first line whose path is not
+ * less than key. If keylen isn't 0, find the first line whose path is past
+ * all the paths starting with the first keylen bytes of key instead.
+ */
+static Py_ssize_t text_bisect(
+    const char* data,
+    Py_ssize_t lo,
+    Py_ssize_t hi,
+    const char* key,
+    size_t keylen) {
+  while (lo < hi) {
+    Py_ssize_t mid = text_linestart(data, lo + (hi - lo) / 2);
+    const char* l = data + mid;
+    bool past = keylen ? strncmp(l, key, keylen) > 0 : strcmp(l, key) >= 0;
+    if (past) {
+      hi = mid;
+    } else {
+      lo = (const char*)memchr(l, '\n', hi - mid) - data + 1;
+    }
+  }
+  return lo;
+}
+
+/* Describe the line of the manifest text starting at data[pos]. */
+static void text_line(char* data, Py_ssize_t len, Py_ssize_t pos, line* l) {
+  l->start = data + pos;
+  l->len = (char*)memchr(data + pos, '\n', len - pos) - (data + pos) + 1;
+  l->hash_suffix = '\0';
+  l->from_malloc = false;
+  l->deleted = false;
+}
+
+/*
+ * Find the line for the path of needle, in the text of the manifest if it
+ * hasn't been indexed. tmp holds the line found in the text.
+ */
+static line* lookup(lazymanifest* self, line* needle, line* tmp) {
+  line* hit;
+  if (!self->lines) {
+    char* data = PyBytes_AS_STRING(self->pydata);
+    Py_ssize_t len = PyBytes_GET_SIZE(self->pydata);
+    Py_ssize_t pos = text_bisect(data, 0, len, needle->start, 0);
+    if (pos == len || strcmp(data + pos, needle->start) != 0)
+      return NULL;
+    text_line(data, len, pos, tmp);
+    return tmp;
+  }
+  hit = bsearch(needle, self->lines, self->numlines, sizeof(line), &linecmp);
+  return hit && !hit->deleted ? hit : NULL;
 }
 
 static void lazymanifest_dealloc(lazymanifest* self) {
   /* free any extra lines we had to allocate */
   int i;
-  for (i = 0; i < self->numlines; i++) {
+  for (i = 0; self->lines && i < self->numlines; i++) {
     if (self->lines[i].from_malloc) {
       free((void*)self->lines[i].start);
     }
@@ -354,7 +461,11 @@ static lazymanifest* lazymanifest_copy(lazymanifest* self);
 
 static PyObject* lazymanifest_getentriesiter(lazymanifest* self) {
   lmIter* i = NULL;
-  lazymanifest* t = lazymanifest_copy(self);
+  lazymanifest* t;
+  if (ensure_lines(self) != 0) {
+    return NULL;
+  }
+  t = lazymanifest_copy(self);
   if (!t) {
     PyErr_NoMemory();
     return NULL;
@@ -372,7 +483,11 @@ static PyObject* lazymanifest_getentriesiter(lazymanifest* self) {
 
 static PyObject* lazymanifest_getkeysiter(lazymanifest* self) {
   lmIter* i = NULL;
-  lazymanifest* t = lazymanifest_copy(self);
+  lazymanifest* t;
+  if (ensure_lines(self) != 0) {
+    return NULL;
+  }
+  t = lazymanifest_copy(self);
   if (!t) {
     PyErr_NoMemory();
     return NULL;
@@ -391,15 +506,15 @@ static PyObject* lazymanifest_getkeysiter(lazymanifest* self) {
 /* __getitem__ and __setitem__ support */
 
 static Py_ssize_t lazymanifest_size(lazymanifest* self) {
+  if (ensure_lines(self) != 0) {
+    return -1;
+  }
   return self->livelines;
 }
 
-static int linecmp(const void* left, const void* right) {
-  return strcmp(((const line*)left)->start, ((const line*)right)->start);
-}
 
 static PyObject* lazymanifest_getitem(lazymanifest* self, PyObject* key) {
-  line needle;
+  line needle, tmp;
   line* hit;
 #ifdef IS_PY3K
   if (!PyUnicode_Check(key)) {
@@ -415,8 +530,8 @@ static PyObject* lazymanifest_getitem(lazymanifest* self, PyObject* key) {
   }
   needle.start = PyBytes_AsString(key);
 #endif
-  hit = bsearch(&needle, self->lines, self->numlines, sizeof(line), &linecmp);
-  if (!hit || hit->deleted) {
+  hit = lookup(self, &needle, &tmp);
+  if (!hit) {
     PyErr_Format(PyExc_KeyError, "No such manifest entry.");
     return NULL;
   }
@@ -439,6 +554,8 @@ static int lazymanifest_delitem(lazymanifest* self, PyObject* key) {
   }
   needle.start = PyBytes_AsString(key);
 #endif
+  if (ensure_lines(self) != 0)
+    return -1;
   hit = bsearch(&needle, self->lines, self->numlines, sizeof(line), &linecmp);
   if (!hit || hit->deleted) {
     PyErr_Format(PyExc_KeyError, "Tried to delete nonexistent manifest entry.");
@@ -515,6 +632,9 @@ lazymanifest_setitem(lazymanifest* self, PyObject* key, PyObject* value) {
   if (!value) {
     return lazymanifest_delitem(self, key);
   }
+  if (ensure_lines(self) != 0) {
+    return -1;
+  }
   if (!PyTuple_Check(value) || PyTuple_Size(value) != 2) {
     PyErr_Format(
         PyExc_TypeError, "Manifest values must be a tuple of (node, flags).");
@@ -586,6 +706,7 @@ lazymanifest_setitem(lazymanifest* self, PyObject* key, PyObject* value) {
   new.hash_suffix = '\0';
   if (hlen > 20) {
     new.hash_suffix = hash[20];
+    self->suffixed = true;
   }
   new.from_malloc = true; /* is `start` a pointer we allocated? */
   new.deleted = false; /* is this entry deleted? */
@@ -604,8 +725,7 @@ static PyMappingMethods lazymanifest_mapping_methods = {
 /* sequence methods (important or __contains__ builds an iterator) */
 
 static int lazymanifest_contains(lazymanifest* self, PyObject* key) {
-  line needle;
-  line* hit;
+  line needle, tmp;
   if (
 #ifdef IS_PY3K
       !PyUnicode_Check(key)
@@ -622,11 +742,7 @@ static int lazymanifest_contains(lazymanifest* self, PyObject* key) {
 #else
   needle.start = PyBytes_AsString(key);
 #endif
-  hit = bsearch(&needle, self->lines, self->numlines, sizeof(line), &linecmp);
-  if (!hit || hit->deleted) {
-    return 0;
-  }
-  return 1;
+  return lookup(self, &needle, &tmp) != NULL;
 }
 
 static PySequenceMethods lazymanifest_seq_meths = {
@@ -711,12 +827,17 @@ static lazymanifest* lazymanifest_copy(lazymanifest* self) {
   copy->numlines = self->numlines;
   copy->livelines = self->livelines;
   copy->dirty = false;
-  copy->lines = malloc(self->maxlines * sizeof(line));
-  if (!copy->lines) {
-    goto nomem;
-  }
-  memcpy(copy->lines, self->lines, self->numlines * sizeof(line));
+  copy->suffixed = self->suffixed;
+  copy->pydata = NULL;
+  copy->lines = NULL;
   copy->maxlines = self->maxlines;
+  if (self->lines) {
+    copy->lines = malloc(self->maxlines * sizeof(line));
+    if (!copy->lines) {
+      goto nomem;
+    }
+    memcpy(copy->lines, self->lines, self->numlines * sizeof(line));
+  }
   copy->pydata = self->pydata;
   Py_INCREF(copy->pydata);
   return copy;
@@ -738,6 +859,9 @@ static lazymanifest* lazymanifest_filtercopy(
   /* compact ourselves first to avoid double-frees later when we
    * compact tmp so that it doesn't have random pointers to our
    * underlying from_malloc-data (self->pydata is safe) */
+  if (ensure_lines(self) != 0) {
+    return NULL;
+  }
   if (compact(self) != 0) {
     goto nomem;
   }
@@ -746,6 +870,7 @@ static lazymanifest* lazymanifest_filtercopy(
     goto nomem;
   }
   copy->dirty = true;
+  copy->suffixed = self->suffixed;
   copy->lines = malloc(self->maxlines * sizeof(line));
   if (!copy->lines) {
     goto nomem;
@@ -783,6 +908,181 @@ nomem:
   return NULL;
 }
 
+/*
+ * Add the difference between the lines left and right to ret, result
+ * telling how their paths compare: only left is valid if it is negative,
+ * and only right if it is positive.
+ */
+static int diff_entry(
+    PyObject* ret,
+    line* left,
+    line* right,
+    int result,
+    PyObject* emptyTup,
+    bool listclean) {
+  PyObject* key;
+  PyObject* outer = NULL;
+#ifdef IS_PY3K
+  key = result <= 0 ? PyUnicode_FromString(left->start)
+                    : PyUnicode_FromString(right->start);
+#else
+  key = result <= 0 ? PyBytes_FromString(left->start)
+                    : PyBytes_FromString(right->start);
+#endif
+  if (!key)
+    return -1;
+  if (result < 0) {
+    PyObject* l = hashflags(left);
+    if (!l) {
+      goto nomem;
+    }
+    outer = PyTuple_Pack(2, l, emptyTup);
+    Py_DECREF(l);
+  } else if (result > 0) {
+    PyObject* r = hashflags(right);
+    if (!r) {
+      goto nomem;
+    }
+    outer = PyTuple_Pack(2, emptyTup, r);
+    Py_DECREF(r);
+  } else {
+    /* file exists in both manifests */
+    if (left->len != right->len ||
+        memcmp(left->start, right->start, left->len) ||
+        left->hash_suffix != right->hash_suffix) {
+      PyObject* l = hashflags(left);
+      PyObject* r;
+      if (!l) {
+        goto nomem;
+      }
+      r = hashflags(right);
+      if (!r) {
+        Py_DECREF(l);
+        goto nomem;
+      }
+      outer = PyTuple_Pack(2, l, r);
+      Py_DECREF(l);
+      Py_DECREF(r);
+    } else {
+      if (listclean) {
+        PyDict_SetItem(ret, key, Py_None);
+      }
+      Py_DECREF(key);
+      return 0;
+    }
+  }
+  if (!outer) {
+    goto nomem;
+  }
+  PyDict_SetItem(ret, key, outer);
+  Py_DECREF(outer);
+  Py_DECREF(key);
+  return 0;
+nomem:
+  Py_DECREF(key);
+  return -1;
+}
+
+/*
+ * Whether the line at data[pos] is the first of the directory path[0..len)
+ * in its manifest text.
+ */
+static bool text_entersdir(
+    const char* data,
+    Py_ssize_t pos,
+    const char* path,
+    size_t len) {
+  return pos == 0 ||
+      strncmp(data + text_linestart(data, pos - 1), path, len) != 0;
+}
+
+/*
+ * If the lines at lpos and rpos are in the same directory, and the rest of
+ * that directory is byte for byte the same in both texts, skip over it.
+ * The directories are tried from the outermost, and only when entered on
+ * either side, so that the costs of finding their ends and comparing them
+ * are paid about once per directory.
+ */
+static bool text_skipsamedir(
+    const char* ldata,
+    Py_ssize_t* lpos,
+    Py_ssize_t llen,
+    const char* rdata,
+    Py_ssize_t* rpos,
+    Py_ssize_t rlen) {
+  const char* l = ldata + *lpos;
+  const char* r = rdata + *rpos;
+  size_t i;
+  for (i = 0; l[i] == r[i] && l[i] != '\0'; i++) {
+    Py_ssize_t lend, rend;
+    if (l[i] != '/') {
+      continue;
+    }
+    if (!text_entersdir(ldata, *lpos, l, i + 1) &&
+        !text_entersdir(rdata, *rpos, r, i + 1)) {
+      continue;
+    }
+    lend = text_bisect(ldata, *lpos, llen, l, i + 1);
+    rend = text_bisect(rdata, *rpos, rlen, r, i + 1);
+    if (lend - *lpos == rend - *rpos && !memcmp(l, r, lend - *lpos)) {
+      *lpos = lend;
+      *rpos = rend;
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+ * Diff two manifests whose texts describe them fully, without indexing
+ * their lines. Unless the clean files are listed, the directories that are
+ * the same in both are skipped, so that diffing large manifests with few
+ * changes mostly costs comparing their texts.
+ */
+static int text_diff(
+    lazymanifest* self,
+    lazymanifest* other,
+    PyObject* ret,
+    PyObject* emptyTup,
+    bool listclean) {
+  char* ldata = PyBytes_AS_STRING(self->pydata);
+  char* rdata = PyBytes_AS_STRING(other->pydata);
+  Py_ssize_t llen = PyBytes_GET_SIZE(self->pydata);
+  Py_ssize_t rlen = PyBytes_GET_SIZE(other->pydata);
+  Py_ssize_t lpos = 0, rpos = 0;
+  while (lpos != llen || rpos != rlen) {
+    line left, right;
+    int result;
+    if (lpos == llen) {
+      result = 1;
+    } else if (rpos == rlen) {
+      result = -1;
+    } else {
+      if (!listclean &&
+          text_skipsamedir(ldata, &lpos, llen, rdata, &rpos, rlen)) {
+        continue;
+      }
+      result = strcmp(ldata + lpos, rdata + rpos);
+    }
+    if (result <= 0) {
+      text_line(ldata, llen, lpos, &left);
+    }
+    if (result >= 0) {
+      text_line(rdata, rlen, rpos, &right);
+    }
+    if (diff_entry(ret, &left, &right, result, emptyTup, listclean) != 0) {
+      return -1;
+    }
+    if (result <= 0) {
+      lpos += left.len;
+    }
+    if (result >= 0) {
+      rpos += right.len;
+    }
+  }
+  return 0;
+}
+
 static PyObject* lazymanifest_diff(lazymanifest* self, PyObject* args) {
   lazymanifest* other;
   PyObject* pyclean = NULL;
@@ -811,12 +1111,22 @@ static PyObject* lazymanifest_diff(lazymanifest* self, PyObject* args) {
   if (!ret) {
     goto nomem;
   }
+  if (!self->dirty && !self->suffixed && !other->dirty && !other->suffixed) {
+    if (text_diff(self, other, ret, emptyTup, listclean) != 0) {
+      goto nomem;
+    }
+    Py_DECREF(emptyTup);
+    return ret;
+  }
+  if (ensure_lines(self) != 0 || ensure_lines(other) != 0) {
+    Py_DECREF(ret);
+    Py_DECREF(emptyTup);
+    return NULL;
+  }
   while (sneedle != self->numlines || oneedle != other->numlines) {
     line* left = self->lines + sneedle;
     line* right = other->lines + oneedle;
     int result;
-    PyObject* key;
-    PyObject* outer;
     /* If we're looking at a deleted entry and it's not
      * the end of the manifest, just skip it. */
     if (sneedle < self->numlines && left->deleted) {
@@ -837,71 +1147,15 @@ static PyObject* lazymanifest_diff(lazymanifest* self, PyObject* args) {
     } else {
       result = linecmp(left, right);
     }
-#ifdef IS_PY3K
-    key = result <= 0 ? PyUnicode_FromString(left->start)
-                      : PyUnicode_FromString(right->start);
-#else
-    key = result <= 0 ? PyBytes_FromString(left->start)
-                      : PyBytes_FromString(right->start);
-#endif
-    if (!key)
+    if (diff_entry(ret, left, right, result, emptyTup, listclean) != 0) {
       goto nomem;
-    if (result < 0) {
-      PyObject* l = hashflags(left);
-      if (!l) {
-        goto nomem;
-      }
-      outer = PyTuple_Pack(2, l, emptyTup);
-      Py_DECREF(l);
-      if (!outer) {
-        goto nomem;
-      }
-      PyDict_SetItem(ret, key, outer);
-      Py_DECREF(outer);
-      sneedle++;
-    } else if (result > 0) {
-      PyObject* r = hashflags(right);
-      if (!r) {
-        goto nomem;
-      }
-      outer = PyTuple_Pack(2, emptyTup, r);
-      Py_DECREF(r);
-      if (!outer) {
-        goto nomem;
-      }
-      PyDict_SetItem(ret, key, outer);
-      Py_DECREF(outer);
-      oneedle++;
-    } else {
-      /* file exists in both manifests */
-      if (left->len != right->len ||
-          memcmp(left->start, right->start, left->len) ||
-          left->hash_suffix != right->hash_suffix) {
-        PyObject* l = hashflags(left);
-        PyObject* r;
-        if (!l) {
-          goto nomem;
-        }
-        r = hashflags(right);
-        if (!r) {
-          Py_DECREF(l);
-          goto nomem;
-        }
-        outer = PyTuple_Pack(2, l, r);
-        Py_DECREF(l);
-        Py_DECREF(r);
-        if (!outer) {
-          goto nomem;
-        }
-        PyDict_SetItem(ret, key, outer);
-        Py_DECREF(outer);
-      } else if (listclean) {
-        PyDict_SetItem(ret, key, Py_None);
-      }
+    }
+    if (result <= 0) {
       sneedle++;
+    }
+    if (result >= 0) {
       oneedle++;
     }
-    Py_DECREF(key);
   }
   Py_DECREF(emptyTup);
   return ret;
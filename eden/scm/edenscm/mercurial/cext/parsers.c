@@ -777,6 +777,7 @@ static char parsers_doc[] = "Efficient content parsing.";
 
 PyObject* encodedir(PyObject* self, PyObject* args);
 PyObject* pathencode(PyObject* self, PyObject* args);
+PyObject* pathencodemany(PyObject* self, PyObject* args);
 PyObject* lowerencode(PyObject* self, PyObject* args);
 PyObject* parse_index2(PyObject* self, PyObject* args);
 
@@ -793,6 +794,14 @@ static PyMethodDef methods[] = {
     {"isasciistr", isasciistr, METH_VARARGS, "check if an ASCII string\n"},
     {"asciilower", asciilower, METH_VARARGS, "lowercase an ASCII string\n"},
     {"asciiupper", asciiupper, METH_VARARGS, "uppercase an ASCII string\n"},
+    {"asciilowermany",
+     asciilowermany,
+     METH_VARARGS,
+     "lowercase a list of strings, with a fallback for non-ASCII ones\n"},
+    {"asciiuppermany",
+     asciiuppermany,
+     METH_VARARGS,
+     "uppercase a list of strings, with a fallback for non-ASCII ones\n"},
     {"dict_new_presized",
      dict_new_presized,
      METH_VARARGS,
@@ -805,8 +814,16 @@ static PyMethodDef methods[] = {
      jsonescapeu8fast,
      METH_VARARGS,
      "escape a UTF-8 byte string to JSON (fast path)\n"},
+    {"setcharencodekernels",
+     setcharencodekernels,
+     METH_VARARGS,
+     "select the vectorized character encoding kernels by name\n"},
     {"encodedir", encodedir, METH_VARARGS, "encodedir a path\n"},
     {"pathencode", pathencode, METH_VARARGS, "fncache-encode a path\n"},
+    {"pathencodemany",
+     pathencodemany,
+     METH_VARARGS,
+     "fncache-encode a list of paths\n"},
     {"lowerencode", lowerencode, METH_VARARGS, "lower-encode a path\n"},
     {"fm1readmarkers",
      fm1readmarkers,
@@ -814,6 +831,7 @@ static PyMethodDef methods[] = {
      "parse v1 obsolete markers\n"},
     {NULL, NULL}};
 
+void charencode_module_init(PyObject* mod);
 void dirs_module_init(PyObject* mod);
 void manifest_module_init(PyObject* mod);
 void revlog_module_init(PyObject* mod);
@@ -833,6 +851,7 @@ static void module_init(PyObject* mod) {
    * should not have this module constant. */
   PyModule_AddStringConstant(mod, "versionerrortext", versionerrortext);
 
+  charencode_module_init(mod);
   dirs_module_init(mod);
   manifest_module_init(mod);
   revlog_module_init(mod);
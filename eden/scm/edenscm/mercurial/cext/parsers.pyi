@@ -33,7 +33,7 @@ def nonnormalotherparententries(
 ) -> Tuple[Set[str], Set[str]]: ...
 
 class lazymanifest:
-    def __init__(self, data: bytes) -> None: ...
+    def __init__(self, data: bytes, lazy: bool = False) -> None: ...
     def __len__(self) -> int: ...
     def __getitem__(self, key: str) -> Tuple[bytes, str]: ...
     def __setitem__(self, key: str, hash_and_flags: Tuple[bytes, str]) -> None: ...
@@ -753,57 +753,157 @@ static PyObject* hashencode(const char* src, Py_ssize_t len) {
   return hashmangle(auxed, auxlen, sha);
 }
 
+static const char* pathstring(PyObject* pathobj, Py_ssize_t* len) {
+  const char* path;
+
+#ifdef IS_PY3K
+  path = PyUnicode_AsUTF8AndSize(pathobj, len);
+  if (!path)
+    PyErr_SetString(PyExc_TypeError, "expected a str");
+#else
+  if (PyBytes_AsStringAndSize(pathobj, (char**)&path, len) == -1) {
+    PyErr_SetString(PyExc_TypeError, "expected a string");
+    path = NULL;
+  }
+#endif
+  return path;
+}
+
+/*
+ * Encode path into dest, which has room for MAXENCODE bytes, in a single
+ * pass. Return the length of the encoding including the trailing zero byte,
+ * or maxstorepathlen + 2 if path needs hashencode instead. A byte expands to
+ * at most 3, so a path short enough to not need hashing always fits.
+ */
+static Py_ssize_t encodeinto(char* dest, const char* path, Py_ssize_t len) {
+  Py_ssize_t newlen;
+
+  if (len > maxstorepathlen)
+    return maxstorepathlen + 2;
+  newlen = len ? basicencode(dest, MAXENCODE, path, len + 1) : 1;
+  return newlen > maxstorepathlen + 1 ? maxstorepathlen + 2 : newlen;
+}
+
 PyObject* pathencode(PyObject* self, PyObject* args) {
   Py_ssize_t len, newlen;
-  PyObject *pathobj, *newobj = NULL;
+  PyObject* pathobj;
   const char* path;
+  char encoded[MAXENCODE];
 
   if (!PyArg_ParseTuple(args, "O:pathencode", &pathobj))
     return NULL;
 
-#ifdef IS_PY3K
-  char* newpath;
-  path = PyUnicode_AsUTF8AndSize(pathobj, &len);
-  if (!path) {
-    PyErr_SetString(PyExc_TypeError, "expected a str");
+  path = pathstring(pathobj, &len);
+  if (!path)
     return NULL;
+
+  newlen = encodeinto(encoded, path, len);
+  if (newlen > maxstorepathlen + 1)
+    return hashencode(path, len + 1);
+
+  if (newlen == len + 1) {
+    Py_INCREF(pathobj);
+    return pathobj;
   }
+
+#ifdef IS_PY3K
+  return PyUnicode_FromStringAndSize(encoded, newlen - 1);
 #else
-  if (PyBytes_AsStringAndSize(pathobj, (char**)&path, &len) == -1) {
-    PyErr_SetString(PyExc_TypeError, "expected a string");
+  return PyBytes_FromStringAndSize(encoded, newlen - 1);
+#endif
+}
+
+/*
+ * pathencode over a list of paths. The basic encodings, which are most of
+ * them, are computed into one buffer with the GIL released. Paths that need
+ * hashing go through hashencode afterwards, since it hashes in Python.
+ */
+PyObject* pathencodemany(PyObject* self, PyObject* args) {
+  PyObject *pathsobj, *paths, *result = NULL;
+  const char** srcs = NULL;
+  Py_ssize_t *lens = NULL, *newlens = NULL;
+  Py_ssize_t i, count, offset = 0, capacity = 0;
+  char *encoded = NULL, *newencoded;
+  char scratch[MAXENCODE];
+  int nomem = 0;
+
+  if (!PyArg_ParseTuple(args, "O:pathencodemany", &pathsobj))
     return NULL;
+
+  paths = PySequence_Fast(pathsobj, "expected a list of paths");
+  if (!paths)
+    return NULL;
+
+  count = PySequence_Fast_GET_SIZE(paths);
+  srcs = PyMem_Malloc(sizeof(*srcs) * (count ? count : 1));
+  lens = PyMem_Malloc(sizeof(*lens) * (count ? count : 1));
+  newlens = PyMem_Malloc(sizeof(*newlens) * (count ? count : 1));
+  if (!srcs || !lens || !newlens) {
+    PyErr_NoMemory();
+    goto bail;
   }
-#endif
 
-  if (len > maxstorepathlen)
-    newlen = maxstorepathlen + 2;
-  else
-    newlen = len ? basicencode(NULL, 0, path, len + 1) : 1;
-
-  if (newlen <= maxstorepathlen + 1) {
-    if (newlen == len + 1) {
-      Py_INCREF(pathobj);
-      return pathobj;
+  for (i = 0; i < count; i++) {
+    srcs[i] = pathstring(PySequence_Fast_GET_ITEM(paths, i), &lens[i]);
+    if (!srcs[i])
+      goto bail;
+  }
+
+  /* The strings stay alive and unchanged while paths holds them. */
+  Py_BEGIN_ALLOW_THREADS;
+  for (i = 0; i < count; i++) {
+    newlens[i] = encodeinto(scratch, srcs[i], lens[i]);
+    if (newlens[i] > maxstorepathlen + 1 || newlens[i] == lens[i] + 1)
+      continue;
+    if (offset + newlens[i] > capacity) {
+      capacity = capacity * 2 + MAXENCODE;
+      newencoded = realloc(encoded, capacity);
+      if (!newencoded) {
+        nomem = 1;
+        break;
+      }
+      encoded = newencoded;
     }
+    memcpy(encoded + offset, scratch, newlens[i]);
+    offset += newlens[i];
+  }
+  Py_END_ALLOW_THREADS;
+  if (nomem) {
+    PyErr_NoMemory();
+    goto bail;
+  }
 
+  result = PyList_New(count);
+  if (!result)
+    goto bail;
+  offset = 0;
+  for (i = 0; i < count; i++) {
+    PyObject* newobj;
+    if (newlens[i] > maxstorepathlen + 1) {
+      newobj = hashencode(srcs[i], lens[i] + 1);
+    } else if (newlens[i] == lens[i] + 1) {
+      newobj = PySequence_Fast_GET_ITEM(paths, i);
+      Py_INCREF(newobj);
+    } else {
 #ifdef IS_PY3K
-    newpath = PyMem_Malloc(newlen);
-    if (newpath) {
-      basicencode(newpath, newlen, path, len + 1);
-      newobj = PyUnicode_FromStringAndSize(newpath, newlen - 1);
-      PyMem_Free(newpath);
-    }
+      newobj = PyUnicode_FromStringAndSize(encoded + offset, newlens[i] - 1);
 #else
-    newobj = PyBytes_FromStringAndSize(NULL, newlen);
-    if (newobj) {
-      assert(PyBytes_Check(newobj));
-      Py_SIZE(newobj)--;
-      basicencode(PyBytes_AS_STRING(newobj), newlen, path, len + 1);
-    }
+      newobj = PyBytes_FromStringAndSize(encoded + offset, newlens[i] - 1);
 #endif
-  } else {
-    newobj = hashencode(path, len + 1);
+      offset += newlens[i];
+    }
+    if (!newobj) {
+      Py_CLEAR(result);
+      goto bail;
+    }
+    PyList_SET_ITEM(result, i, newobj);
   }
 
-  return newobj;
+bail:
+  free(encoded);
+  PyMem_Free(newlens);
+  PyMem_Free(lens);
+  PyMem_Free(srcs);
+  Py_DECREF(paths);
+  return result;
 }
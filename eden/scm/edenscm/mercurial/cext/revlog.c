@@ -43,6 +43,13 @@
  * Positive value is index of the next node in the trie
  * Negative value is a leaf: -(rev + 1)
  * Zero is empty
+ *
+ * The trie can be persisted and loaded back from a buffer (usually an
+ * mmap of the persisted file). Nodes below ntbase are then on disk and
+ * are never modified in place: an insert copies the path from the root
+ * down to the changed node instead, so that the new nodes can be
+ * appended to the file without disturbing readers of the old ones.
+ * The root moves with each such copy, hence ntroot.
  */
 typedef struct {
   int children[16];
@@ -72,8 +79,12 @@ typedef struct {
   PyObject* added; /* populated on demand */
   PyObject* headrevs; /* cache, invalidated on changes */
   nodetree* nt; /* base-16 trie */
+  Py_buffer ntbuf; /* persisted trie, used in place until first write */
   size_t ntlength; /* # nodes in use */
   size_t ntcapacity; /* # nodes allocated */
+  size_t ntbase; /* # nodes persisted, copied rather than modified */
+  int ntroot; /* index of the root node */
+  int ntcloned; /* # persisted nodes copied since last persisted */
   int ntdepth; /* maximum depth of tree */
   int ntsplits; /* # splits performed */
   int ntrev; /* last rev scanned */
@@ -265,6 +276,7 @@ static const char* index_node(indexObject* self, Py_ssize_t pos) {
 }
 
 static int nt_insert(indexObject* self, const char* node, int rev);
+static void nt_clear(indexObject* self);
 
 static int node_check(PyObject* obj, char** node, Py_ssize_t* nodelen) {
   if (PyBytes_AsStringAndSize(obj, node, nodelen) == -1)
@@ -331,18 +343,13 @@ static void _index_clearcaches(indexObject* self) {
     PyMem_Free(self->offsets);
     self->offsets = NULL;
   }
-  if (self->nt) {
-    free(self->nt);
-    self->nt = NULL;
-  }
+  nt_clear(self);
   Py_CLEAR(self->headrevs);
 }
 
 static PyObject* index_clearcaches(indexObject* self) {
   _index_clearcaches(self);
-  self->ntlength = self->ntcapacity = 0;
   self->ntdepth = self->ntsplits = 0;
-  self->ntrev = -1;
   self->ntlookups = self->ntmisses = 0;
   Py_RETURN_NONE;
 }
@@ -380,6 +387,7 @@ static PyObject* index_stats(indexObject* self) {
   istat(ntcapacity, "node trie capacity");
   istat(ntdepth, "node trie depth");
   istat(ntlength, "node trie count");
+  istat(ntbase, "node trie persisted");
   istat(ntlookups, "node trie lookups");
   istat(ntmisses, "node trie misses");
   istat(ntrev, "node trie last rev scanned");
@@ -903,6 +911,7 @@ static inline int nt_level(const char* node, Py_ssize_t level) {
 /*
  * Return values:
  *
+ *   -5: trie is corrupt
  *   -4: match is ambiguous (multiple candidates)
  *   -2: not found
  * rest: valid rev
@@ -923,7 +932,7 @@ nt_find(indexObject* self, const char* node, Py_ssize_t nodelen, int hex) {
   else
     maxlevel = nodelen > 20 ? 40 : ((int)nodelen * 2);
 
-  for (level = off = 0; level < maxlevel; level++) {
+  for (level = 0, off = self->ntroot; level < maxlevel; level++) {
     int k = getnybble(node, level);
     nodetree* n = &self->nt[off];
     int v = n->children[k];
@@ -943,6 +952,9 @@ nt_find(indexObject* self, const char* node, Py_ssize_t nodelen, int hex) {
     }
     if (v == 0)
       return -2;
+    /* only a persisted trie can point past its end */
+    if ((size_t)v >= self->ntlength)
+      return -5;
     off = v;
   }
   /* multiple matches against an ambiguous prefix */
@@ -969,15 +981,152 @@ static int nt_new(indexObject* self) {
   return self->ntlength++;
 }
 
+static inline int nt_borrowed(const indexObject* self) {
+  return self->nt != NULL && self->nt == self->ntbuf.buf;
+}
+
+static void nt_clear(indexObject* self) {
+  if (self->nt && !nt_borrowed(self))
+    free(self->nt);
+  self->nt = NULL;
+  if (self->ntbuf.buf) {
+    PyBuffer_Release(&self->ntbuf);
+    memset(&self->ntbuf, 0, sizeof(self->ntbuf));
+  }
+  self->ntlength = self->ntcapacity = self->ntbase = 0;
+  self->ntroot = self->ntcloned = 0;
+  self->ntrev = -1;
+}
+
+static int nt_init(indexObject* self);
+
+/*
+ * Check that the nodes reachable from the root of a persisted trie form
+ * a tree: every link is within the trie, no node is reached twice, and
+ * no path is deeper than the 40 nybbles of a node.
+ *
+ * Return values:
+ *
+ *   -1: out of memory
+ *    0: the trie is corrupt
+ *    1: the trie is valid
+ */
+static int nt_valid(const nodetree* nt, size_t length, int root) {
+  /* each level pushes at most 16 children and pops its own node */
+  struct {
+    int off;
+    int level;
+  } stack[40 * 15 + 1];
+  unsigned char* seen;
+  int top = 0, valid = 1;
+
+  seen = calloc(length / 8 + 1, 1);
+  if (seen == NULL)
+    return -1;
+  stack[top].off = root;
+  stack[top++].level = 0;
+  seen[root >> 3] |= 1 << (root & 7);
+
+  while (valid && top > 0) {
+    int off, level, k;
+
+    top--;
+    off = stack[top].off;
+    level = stack[top].level;
+
+    for (k = 0; k < 16; k++) {
+      int v = nt[off].children[k];
+
+      if (v <= 0)
+        continue;
+      if ((size_t)v >= length || level + 1 >= 40 ||
+          (seen[v >> 3] & (1 << (v & 7)))) {
+        valid = 0;
+        break;
+      }
+      seen[v >> 3] |= 1 << (v & 7);
+      stack[top].off = v;
+      stack[top++].level = level + 1;
+    }
+  }
+
+  free(seen);
+  return valid;
+}
+
+/*
+ * Copy a persisted trie into memory we own, before its first write.
+ * A trie that is not a valid tree, see nt_valid, is replaced by an
+ * empty one, to be repopulated from the index like any other.
+ */
+static int nt_own(indexObject* self) {
+  const nodetree* src = self->nt;
+  size_t length = self->ntlength;
+
+  if (!nt_borrowed(self))
+    return 0;
+
+  switch (nt_valid(src, length, self->ntroot)) {
+    case -1:
+      PyErr_NoMemory();
+      return -1;
+    case 0:
+      nt_clear(self);
+      return nt_init(self);
+  }
+
+  if (length >= SIZE_MAX / (sizeof(nodetree) * 2)) {
+    PyErr_SetString(PyExc_MemoryError, "overflow in nt_own");
+    return -1;
+  }
+  self->ntcapacity = length * 2;
+  self->nt = calloc(self->ntcapacity, sizeof(nodetree));
+  if (self->nt == NULL) {
+    self->nt = (nodetree*)src;
+    self->ntcapacity = length;
+    PyErr_NoMemory();
+    return -1;
+  }
+  memcpy(self->nt, src, length * sizeof(nodetree));
+  return 0;
+}
+
+/*
+ * Return a copy of persisted node off, linked in its place from parent
+ * (or as the root, if parent is -1).
+ */
+static int nt_clone(indexObject* self, int off, int parent, int k) {
+  int noff = nt_new(self);
+
+  if (noff == -1)
+    return -1;
+  memcpy(&self->nt[noff], &self->nt[off], sizeof(nodetree));
+  if (parent == -1)
+    self->ntroot = noff;
+  else
+    self->nt[parent].children[k] = noff;
+  self->ntcloned += 1;
+  return noff;
+}
+
 static int nt_insert(indexObject* self, const char* node, int rev) {
   int level = 0;
-  int off = 0;
+  int off, parent = -1, pk = 0;
+
+  if (nt_own(self) == -1)
+    return -1;
+  off = self->ntroot;
 
   while (level < 40) {
     int k = nt_level(node, level);
     nodetree* n;
     int v;
 
+    if ((size_t)off < self->ntbase) {
+      off = nt_clone(self, off, parent, pk);
+      if (off == -1)
+        return -1;
+    }
     n = &self->nt[off];
     v = n->children[k];
 
@@ -1006,6 +1155,8 @@ static int nt_insert(indexObject* self, const char* node, int rev) {
       self->ntsplits += 1;
     } else {
       level += 1;
+      parent = off;
+      pk = k;
       off = v;
     }
   }
@@ -1051,6 +1202,8 @@ index_find_node(indexObject* self, const char* node, Py_ssize_t nodelen) {
   rev = nt_find(self, node, nodelen, 0);
   if (rev >= -1)
     return rev;
+  if (rev == -5)
+    nt_clear(self);
 
   if (nt_init(self) == -1)
     return -3;
@@ -1144,15 +1297,22 @@ static PyObject* index_getitem(indexObject* self, PyObject* value) {
   return NULL;
 }
 
-static int
-nt_partialmatch(indexObject* self, const char* node, Py_ssize_t nodelen) {
+/*
+ * Ensure that the radix tree is fully populated.
+ *
+ * Return values:
+ *
+ *   -3: error (exception set)
+ *   -2: a rev could not be read (no exception set)
+ *    0: success
+ */
+static int nt_populate(indexObject* self) {
   int rev;
 
   if (nt_init(self) == -1)
     return -3;
 
   if (self->ntrev > 0) {
-    /* ensure that the radix tree is fully populated */
     for (rev = self->ntrev - 1; rev >= 0; rev--) {
       const char* n = index_node(self, rev);
       if (n == NULL)
@@ -1162,8 +1322,24 @@ nt_partialmatch(indexObject* self, const char* node, Py_ssize_t nodelen) {
     }
     self->ntrev = rev;
   }
+  return 0;
+}
+
+static int
+nt_partialmatch(indexObject* self, const char* node, Py_ssize_t nodelen) {
+  int rev = nt_populate(self);
 
-  return nt_find(self, node, nodelen, 1);
+  if (rev < 0)
+    return rev;
+  rev = nt_find(self, node, nodelen, 1);
+  if (rev == -5) {
+    nt_clear(self);
+    rev = nt_populate(self);
+    if (rev < 0)
+      return rev;
+    rev = nt_find(self, node, nodelen, 1);
+  }
+  return rev;
 }
 
 static PyObject* index_partialmatch(indexObject* self, PyObject* args) {
@@ -1791,6 +1967,7 @@ static int index_init(indexObject* self, PyObject* args) {
   self->headrevs = NULL;
   Py_INCREF(Py_None);
   self->nt = NULL;
+  memset(&self->ntbuf, 0, sizeof(self->ntbuf));
   self->offsets = NULL;
 
   if (!PyArg_ParseTuple(args, "OO", &data_obj, &inlined_obj))
@@ -1807,7 +1984,8 @@ static int index_init(indexObject* self, PyObject* args) {
   self->inlined = inlined_obj && PyObject_IsTrue(inlined_obj);
   self->data = data_obj;
 
-  self->ntlength = self->ntcapacity = 0;
+  self->ntlength = self->ntcapacity = self->ntbase = 0;
+  self->ntroot = self->ntcloned = 0;
   self->ntdepth = self->ntsplits = 0;
   self->ntlookups = self->ntmisses = 0;
   self->ntrev = -1;
@@ -1833,6 +2011,158 @@ bail:
   return -1;
 }
 
+/*
+ * Use a persisted trie, as returned by nodetreedata, in place of the one
+ * built in memory. The buffer must hold the trie's nodes and stays in
+ * use until the first write; revs from revcount on are inserted on top.
+ *
+ * The caller is responsible for checking that the first revcount revs
+ * of the index are the ones the trie was persisted with.
+ */
+static PyObject* index_loadnodetree(indexObject* self, PyObject* args) {
+  PyObject* data;
+  Py_buffer buf;
+  Py_ssize_t nodes, revcount, rev;
+  int root;
+
+  if (!PyArg_ParseTuple(args, "Oin", &data, &root, &revcount))
+    return NULL;
+  if (PyObject_GetBuffer(data, &buf, PyBUF_SIMPLE) == -1)
+    return NULL;
+
+  nodes = buf.len / (Py_ssize_t)sizeof(nodetree);
+  if (buf.len % sizeof(nodetree) || ((uintptr_t)buf.buf % sizeof(int)) ||
+      nodes == 0 || nodes > INT_MAX || root < 0 || root >= nodes ||
+      revcount < 0 || revcount > index_length(self) - 1) {
+    PyBuffer_Release(&buf);
+    PyErr_SetString(PyExc_ValueError, "invalid node tree");
+    return NULL;
+  }
+
+  nt_clear(self);
+  self->ntbuf = buf;
+  self->nt = (nodetree*)buf.buf;
+  self->ntlength = self->ntcapacity = self->ntbase = nodes;
+  self->ntroot = root;
+  self->ntrev = -1;
+
+  for (rev = revcount; rev < index_length(self) - 1; rev++) {
+    const char* n = index_node(self, rev);
+    if (n == NULL || nt_insert(self, n, (int)rev) == -1) {
+      nt_clear(self);
+      if (!PyErr_Occurred())
+        PyErr_SetString(PyExc_ValueError, "could not read index");
+      return NULL;
+    }
+  }
+
+  Py_RETURN_NONE;
+}
+
+/*
+ * Copy the reachable nodes of the subtrie at off, at the given level, to
+ * dst, depth first. Return the new index of off, or -1 if the subtrie is
+ * deeper than a node or does not fit in the capacity of dst; nt_own has
+ * already checked that neither happens.
+ */
+static int nt_compact(
+    const nodetree* src,
+    nodetree* dst,
+    size_t capacity,
+    size_t* length,
+    int off,
+    int level) {
+  int k, noff;
+
+  if (level >= 40 || *length >= capacity)
+    return -1;
+  noff = (int)(*length)++;
+  for (k = 0; k < 16; k++) {
+    int v = src[off].children[k];
+    if (v > 0) {
+      v = nt_compact(src, dst, capacity, length, v, level + 1);
+      if (v == -1)
+        return -1;
+    }
+    dst[noff].children[k] = v;
+  }
+  return noff;
+}
+
+/*
+ * Return (data, root, revcount, unused, full) to persist the fully
+ * populated trie.
+ *
+ * ondisk is the number of nodes already persisted and unused the number
+ * of those no longer reachable. If ondisk matches what this trie was
+ * loaded or last persisted with, data is only the nodes to append and
+ * unused is updated for them. Otherwise, or if more than half of the
+ * nodes would be unreachable, data is a compacted copy of the trie to
+ * replace the persisted one, and full is True.
+ *
+ * From then on, the returned nodes are treated as persisted.
+ */
+static PyObject* index_nodetreedata(indexObject* self, PyObject* args) {
+  Py_ssize_t ondisk, unused;
+  PyObject* data;
+  int full;
+
+  if (!PyArg_ParseTuple(args, "nn", &ondisk, &unused))
+    return NULL;
+
+  if (nt_own(self) == -1)
+    return NULL;
+  switch (nt_populate(self)) {
+    case -3:
+      return NULL;
+    case -2:
+      PyErr_SetString(PyExc_ValueError, "could not read index");
+      return NULL;
+  }
+
+  unused += self->ntcloned;
+  full = self->ntbase == 0 || (size_t)ondisk != self->ntbase ||
+      (size_t)unused * 2 > self->ntlength;
+
+  if (full) {
+    nodetree* dst = calloc(self->ntcapacity, sizeof(nodetree));
+    size_t length = 0;
+
+    if (dst == NULL)
+      return PyErr_NoMemory();
+    if (nt_compact(
+            self->nt, dst, self->ntcapacity, &length, self->ntroot, 0) ==
+        -1) {
+      free(dst);
+      PyErr_SetString(PyExc_ValueError, "invalid node tree");
+      return NULL;
+    }
+    free(self->nt);
+    self->nt = dst;
+    self->ntlength = length;
+    self->ntroot = 0;
+    unused = 0;
+    data = PyBytes_FromStringAndSize(
+        (const char*)self->nt, length * sizeof(nodetree));
+  } else {
+    data = PyBytes_FromStringAndSize(
+        (const char*)&self->nt[self->ntbase],
+        (self->ntlength - self->ntbase) * sizeof(nodetree));
+  }
+  if (data == NULL)
+    return NULL;
+
+  self->ntbase = self->ntlength;
+  self->ntcloned = 0;
+  return Py_BuildValue(
+      "NinnN",
+      data,
+      self->ntroot,
+      index_length(self) - 1,
+      unused,
+      PyBool_FromLong(full));
+}
+
 static PyObject* index_nodemap(indexObject* self) {
   Py_INCREF(self);
   return (PyObject*)self;
@@ -1900,6 +2230,14 @@ static PyMethodDef index_methods[] = {
      (PyCFunction)index_insert,
      METH_VARARGS,
      "insert an index entry"},
+    {"loadnodetree",
+     (PyCFunction)index_loadnodetree,
+     METH_VARARGS,
+     "use a persisted node trie"},
+    {"nodetreedata",
+     (PyCFunction)index_nodetreedata,
+     METH_VARARGS,
+     "get the node trie data to persist"},
     {"partialmatch",
      (PyCFunction)index_partialmatch,
      METH_VARARGS,
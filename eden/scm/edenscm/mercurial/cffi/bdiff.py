@@ -65,7 +65,7 @@ def bdiff(sa, sb):
         bn = lib.bdiff_splitlines(bc, len(sb), b)
         if not a[0] or not b[0]:
             raise MemoryError
-        count = lib.bdiff_diff(a[0], an, b[0], bn, l)
+        count = lib.bdiff_diff_chunked(a[0], an, b[0], bn, l)
         if count < 0:
             raise MemoryError
         rl = []
@@ -35,6 +35,8 @@ struct bdiff_hunk {
 int bdiff_splitlines(const char *a, ssize_t len, struct bdiff_line **lr);
 int bdiff_diff(struct bdiff_line *a, int an, struct bdiff_line *b, int bn,
     struct bdiff_hunk *base);
+int bdiff_diff_chunked(struct bdiff_line *a, int an, struct bdiff_line *b,
+    int bn, struct bdiff_hunk *base);
 void bdiff_freehunks(struct bdiff_hunk *l);
 void free(void*);
 """
@@ -41,6 +41,10 @@ Config
 
   # whether to skip config or env change checks
   skiphash = False
+
+  # how many idle workers to fork ahead of connections, so that concurrent
+  # commands do not wait for a fork. 0 forks a worker per connection.
+  prefork = 2
 """
 
 from __future__ import absolute_import
@@ -322,6 +326,7 @@ class chgunixservicehandler(object):
     def __init__(self, ui):
         self.ui = ui
         self._idletimeout = ui.configint("chgserver", "idletimeout")
+        self.prefork = ui.configint("chgserver", "prefork")
         self._lastactive = time.time()
 
     def bindsocket(self, sock, address):
@@ -456,6 +456,7 @@ class unixservicehandler(object):
     """
 
     pollinterval = None
+    prefork = 0  # number of idle workers forked ahead of connections
 
     def __init__(self, ui):
         self.ui = ui
@@ -499,6 +500,9 @@ class unixforkingservice(object):
         self._sock = None
         self._oldsigchldhandler = None
         self._workerpids = set()  # updated by signal handler; do not iterate
+        self._idlepids = set()  # pre-forked workers yet to accept a connection
+        self._acceptedpipe = None  # workers report accepting here
+        self._quitpipe = None  # closed to ask idle workers to exit
         self._socketunlinked = None
 
     def init(self):
@@ -529,6 +533,10 @@ class unixforkingservice(object):
         util.signal(signal.SIGCHLD, self._oldsigchldhandler)
         self._sock.close()
         self._unlinksocket()
+        for fds in (self._acceptedpipe, self._quitpipe):
+            for fd in fds or ():
+                if fd is not None:
+                    os.close(fd)
         # don't kill child processes as they have active clients, just wait
         self._reapworkers(0)
 
@@ -539,6 +547,8 @@ class unixforkingservice(object):
             self._cleanup()
 
     def _mainloop(self):
+        if self._servicehandler.prefork > 0:
+            return self._preforkmainloop()
         exiting = False
         h = self._servicehandler
         selector = selectors2.DefaultSelector()
@@ -587,6 +597,124 @@ class unixforkingservice(object):
                         os._exit(255)
         selector.close()
 
+    def _preforkmainloop(self):
+        """Keep a pool of idle workers that accept connections themselves
+
+        Workers are forked before a client connects, so commands do not wait
+        for the fork. A worker serves one connection and exits, like those
+        forked per connection. It reports accepting one on a pipe, and the
+        main process forks a replacement right away.
+        """
+        exiting = False
+        h = self._servicehandler
+        self._acceptedpipe = list(os.pipe())
+        self._quitpipe = list(os.pipe())
+        acceptedr = self._acceptedpipe[0]
+        selector = selectors2.DefaultSelector()
+        selector.register(acceptedr, selectors2.EVENT_READ)
+        try:
+            while True:
+                if not exiting and h.shouldexit():
+                    # clients can no longer connect() to the domain socket.
+                    # idle workers handle the queued requests, then exit
+                    # as they see the quit pipe closed.
+                    self._unlinksocket()
+                    os.close(self._quitpipe[1])
+                    self._quitpipe[1] = None
+                    exiting = True
+                # once exiting, only fork for requests still queued
+                while len(self._idlepids) < h.prefork and (
+                    not exiting or self._hasqueuedrequest()
+                ):
+                    self._forkidleworker(selector)
+                if exiting and not self._idlepids and not self._hasqueuedrequest():
+                    break
+                if not selector.select(timeout=h.pollinterval):
+                    continue
+                # pids are written 4 bytes at a time, which is atomic
+                data = os.read(acceptedr, 4096)
+                for i in range(0, len(data), 4):
+                    (pid,) = struct.unpack(">I", data[i : i + 4])
+                    self.ui.debug("worker process accepted (pid=%d)\n" % pid)
+                    self._idlepids.discard(pid)
+                    h.newconnection()
+        finally:
+            selector.close()
+
+    def _hasqueuedrequest(self):
+        selector = selectors2.DefaultSelector()
+        try:
+            selector.register(self._sock, selectors2.EVENT_READ)
+            return bool(selector.select(timeout=0))
+        finally:
+            selector.close()
+
+    def _forkidleworker(self, selector):
+        # a worker may exit before its pid is recorded. hold off SIGCHLD so
+        # it is not reaped early and left in _idlepids forever.
+        sigmask = getattr(signal, "pthread_sigmask", None)
+        if sigmask:
+            sigmask(signal.SIG_BLOCK, [signal.SIGCHLD])
+        try:
+            pid = os.fork()
+            if pid:
+                self.ui.debug("forked idle worker process (pid=%d)\n" % pid)
+                self._workerpids.add(pid)
+                self._idlepids.add(pid)
+                return
+            # do not reap children of this worker as pool workers
+            util.signal(signal.SIGCHLD, self._oldsigchldhandler)
+        finally:
+            if sigmask:
+                sigmask(signal.SIG_UNBLOCK, [signal.SIGCHLD])
+        try:
+            selector.close()
+            os.close(self._acceptedpipe[0])
+            if self._quitpipe[1] is not None:
+                os.close(self._quitpipe[1])
+            conn = self._acceptorquit()
+            if conn is not None:
+                os.write(self._acceptedpipe[1], struct.pack(">I", os.getpid()))
+                self._sock.close()
+                self._runworker(conn)
+                conn.close()
+            os._exit(0)
+        except:  # never return, hence no re-raises
+            try:
+                self.ui.traceback(force=True)
+            finally:
+                os._exit(255)
+
+    def _acceptorquit(self):
+        """Wait for a connection in a pre-forked worker
+
+        Return None if the main process closed the quit pipe and there is no
+        queued connection left.
+        """
+        quitr = self._quitpipe[0]
+        # idle workers race to accept. this only changes the socket for
+        # workers, since the main process does not accept in this mode.
+        self._sock.setblocking(False)
+        selector = selectors2.DefaultSelector()
+        selector.register(self._sock, selectors2.EVENT_READ)
+        selector.register(quitr, selectors2.EVENT_READ)
+        try:
+            while True:
+                ready = set(key.fileobj for key, _events in selector.select())
+                if self._sock in ready:
+                    try:
+                        conn, _addr = self._sock.accept()
+                    except socket.error as inst:
+                        if inst.args[0] in (errno.EAGAIN, errno.EINTR):
+                            continue
+                        raise
+                    conn.setblocking(True)
+                    return conn
+                if quitr in ready:
+                    return None
+        finally:
+            selector.close()
+
     def _sigchldhandler(self, signal, frame):
         self._reapworkers(os.WNOHANG)
 
@@ -606,6 +734,8 @@ class unixforkingservice(object):
                 # no waitable child processes
                 return
             self._workerpids.discard(pid)
+            # replaced by the main loop if it died without accepting
+            self._idlepids.discard(pid)
 
     def _runworker(self, conn):
         util.signal(signal.SIGCHLD, self._oldsigchldhandler)
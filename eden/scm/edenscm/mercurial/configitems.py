@@ -149,6 +149,7 @@ coreconfigitem("bundle", "reorder", default="auto")
 coreconfigitem("censor", "policy", default="abort")
 coreconfigitem("checkout", "resumable", default=True)
 coreconfigitem("chgserver", "idletimeout", default=3600)
+coreconfigitem("chgserver", "prefork", default=2)
 coreconfigitem("chgserver", "skiphash", default=False)
 coreconfigitem("cmdserver", "log", default=None)
 coreconfigitem("color", ".*", default=None, generic=True)
@@ -281,6 +282,7 @@ coreconfigitem("experimental", "evolution.track-operation", default=True)
 coreconfigitem("experimental", "worddiff", default=False)
 coreconfigitem("experimental", "mmapindexthreshold", default=1)
 coreconfigitem("experimental", "nonnormalparanoidcheck", default=False)
+coreconfigitem("experimental", "persistent-nodetree", default=False)
 coreconfigitem("experimental", "exportableenviron", default=list)
 coreconfigitem("experimental", "extendedheader.index", default=None)
 coreconfigitem("experimental", "extendedheader.similarity", default=False)
@@ -1614,11 +1614,8 @@ class dirstatemap(object):
         else:
             return makefilefoldmap(self._map, util.normcasespec, util.normcasefallback)
 
-        f = {}
-        normcase = util.normcase
-        for name, s in pycompat.iteritems(self._map):
-            if s[0] != "r":
-                f[normcase(name)] = name
+        names = [name for name, s in pycompat.iteritems(self._map) if s[0] != "r"]
+        f = dict(zip(util.normcasemany(names), names))
         f["."] = "."  # prevents useless util.fspath() invocation
         return f
 
@@ -1777,9 +1774,8 @@ class dirstatemap(object):
     def dirfoldmap(self):
         # type: () -> Dict[str, str]
         f = {}
-        normcase = util.normcase
         if "_dirs" in self.__dict__:
             # pyre-fixme[16]: Iterable has no attribute __next__
-            for name in self._dirs:
-                f[normcase(name)] = name
+            names = list(self._dirs)
+            f = dict(zip(util.normcasemany(names), names))
         return f
@@ -28,6 +28,8 @@ from .pycompat import range
 isasciistr = charencode.isasciistr
 asciilower = charencode.asciilower
 asciiupper = charencode.asciiupper
+asciilowermany = charencode.asciilowermany
+asciiuppermany = charencode.asciiuppermany
 _jsonescapeu8fast = charencode.jsonescapeu8fast
 
 if sys.version_info[0] >= 3:
@@ -831,6 +831,10 @@ class localrepository(object):
         mmapindexthreshold = self.ui.configbytes("experimental", "mmapindexthreshold")
         if mmapindexthreshold is not None:
             self.svfs.options["mmapindexthreshold"] = mmapindexthreshold
+        # experimental config: experimental.persistent-nodetree
+        self.svfs.options["persistent-nodetree"] = self.ui.configbool(
+            "experimental", "persistent-nodetree"
+        )
         withsparseread = self.ui.configbool("experimental", "sparse-read")
         srdensitythres = float(
             self.ui.config("experimental", "sparse-read.density-threshold")
@@ -80,8 +80,10 @@ _lazymanifest = parsers.lazymanifest
 
 
 class manifestdict(object):
-    def __init__(self, data=b""):
-        self._lm = _lazymanifest(data)
+    def __init__(self, data=b"", lazy=False):
+        # With lazy, the manifest is only indexed when modified or iterated,
+        # and the order of its lines isn't checked until then.
+        self._lm = _lazymanifest(data, lazy)
 
     def __getitem__(self, key):
         return self._lm[key][0]
@@ -750,7 +752,7 @@ class manifestctx(object):
                 text = rl.revision(self._node)
                 arraytext = bytearray(text)
                 rl._fulltextcache[self._node] = arraytext
-                self._data = manifestdict(text)
+                self._data = manifestdict(text, lazy=True)
         return self._data
 
     def readnew(self, shallow=False):
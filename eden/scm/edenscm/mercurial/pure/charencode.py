@@ -42,6 +42,36 @@ def asciiupper(s):
     return s.upper()
 
 
+def _asciitransformmany(paths, fold, fallback):
+    result = []
+    for s in paths:
+        try:
+            (s if isinstance(s, bytes) else s.encode("utf-8")).decode("ascii")
+        except UnicodeDecodeError:
+            if fallback is None:
+                raise
+            result.append(fallback(s))
+        else:
+            result.append(fold(s))
+    return result
+
+
+def asciilowermany(paths, fallback=None):
+    """convert strings to lowercase if ASCII
+
+    Non-ASCII strings are passed to fallback, or raise UnicodeDecodeError if
+    there is none."""
+    return _asciitransformmany(paths, lambda s: s.lower(), fallback)
+
+
+def asciiuppermany(paths, fallback=None):
+    """convert strings to uppercase if ASCII
+
+    Non-ASCII strings are passed to fallback, or raise UnicodeDecodeError if
+    there is none."""
+    return _asciitransformmany(paths, lambda s: s.upper(), fallback)
+
+
 _jsonmap = []
 _jsonmap.extend("\\u%04x" % x for x in range(32))
 _jsonmap.extend(pycompat.bytechr(x) for x in range(32, 127))
@@ -24,7 +24,9 @@ import errno
 import hashlib
 import heapq
 import os
+import random
 import struct
+import sys
 import zlib
 from typing import IO, Any, List, Optional, Tuple, Union
 
@@ -278,6 +280,21 @@ versionformat_unpack = versionformat.unpack
 # signed integer)
 _maxentrysize = 0x7FFFFFFF
 
+# The persisted node trie of the C index is a "<name>.nt" docket pointing
+# to a "<name>-<uid>.ntd" data file, which only ever grows until it is
+# replaced by a compacted copy under a new uid.
+#  1 byte: version
+#  1 byte: whether the data is big-endian
+# 16 bytes: uid of the data file
+#  4 bytes: number of nodes in the data file
+#  4 bytes: number of those nodes that are unreachable
+#  4 bytes: index of the root node
+#  4 bytes: number of revs in the trie
+# 20 bytes: node of the last of those revs
+nodetreedocket = struct.Struct(">BB16sIIII20s")
+NODETREE_VERSION = 1
+NODETREE_NODESIZE = 64
+
 
 class revlogio(object):
     def __init__(self):
@@ -486,6 +503,117 @@ class revlog(object):
         # like visibleheads and bookmarks control the commit graph.
         self._bypasstransaction = bool(opts and opts.get("bypass-revlog-transaction"))
 
+        # (uid, nodes, unused) of the persisted node trie in use, if any.
+        # Only the root-level revlogs that are large enough to be mmapped
+        # keep one, and only with the C index.
+        self._persistnodetree = bool(
+            opts
+            and opts.get("persistent-nodetree")
+            and mmaplargeindex
+            and not index2
+            and "/" not in indexfile
+            and util.safehasattr(self.index, "loadnodetree")
+        )
+        self._nodetree = None
+        if self._persistnodetree:
+            self._nodetree = self._loadnodetree()
+
+    def _nodetreedocketfile(self):
+        return self.indexfile[:-2] + ".nt"
+
+    def _nodetreedatafile(self, uid):
+        return "%s-%s.ntd" % (self.indexfile[:-2], uid)
+
+    def _readnodetreedocket(self):
+        data = self.opener.tryread(self._nodetreedocketfile())
+        if len(data) != nodetreedocket.size:
+            return None
+        docket = nodetreedocket.unpack(data)
+        if docket[0] != NODETREE_VERSION or docket[1] != (sys.byteorder == "big"):
+            return None
+        return docket
+
+    def _loadnodetree(self):
+        """Use the persisted node trie, if it matches the index"""
+        docket = self._readnodetreedocket()
+        if docket is None:
+            return None
+        _version, _bigendian, uid, nodes, unused, root, revcount, tipnode = docket
+        if revcount > len(self):
+            return None
+        if revcount and self.node(revcount - 1) != tipnode:
+            return None
+        uid = pycompat.decodeutf8(uid)
+        try:
+            with self.opener(self._nodetreedatafile(uid)) as fp:
+                data = util.mmapread(fp)
+            if len(data) < nodes * NODETREE_NODESIZE:
+                return None
+            self.index.loadnodetree(
+                memoryview(data)[: nodes * NODETREE_NODESIZE], root, revcount
+            )
+        except (IOError, OSError, ValueError):
+            return None
+        return (uid, nodes, unused)
+
+    def _writenodetree(self, tr):
+        """Persist the node trie, appending to the data file if possible"""
+        docket = self._readnodetreedocket()
+        uid, ondisk, unused = None, -1, 0
+        if docket is not None:
+            uid = pycompat.decodeutf8(docket[2])
+            ondisk, unused = docket[3], docket[4]
+            # Someone else replaced the trie, or an earlier append failed.
+            if self._nodetree != (uid, ondisk, unused):
+                ondisk = -1
+        try:
+            data, root, revcount, unused, full = self.index.nodetreedata(
+                ondisk, unused
+            )
+            if full:
+                olduid = uid
+                uid = "%016x" % random.getrandbits(64)
+                nodes = 0
+                with self.opener(self._nodetreedatafile(uid), "wb") as fp:
+                    fp.write(data)
+            else:
+                olduid = None
+                nodes = ondisk
+                # Anything past the nodes in the docket is left over from a
+                # failed append, and not read by anyone.
+                with self.opener(self._nodetreedatafile(uid), "r+b") as fp:
+                    fp.seek(nodes * NODETREE_NODESIZE)
+                    fp.write(data)
+            nodes += len(data) // NODETREE_NODESIZE
+            tipnode = self.node(revcount - 1) if revcount else nullid
+            docketfile = self._nodetreedocketfile()
+            with self.opener(docketfile, "wb", atomictemp=True) as fp:
+                fp.write(
+                    nodetreedocket.pack(
+                        NODETREE_VERSION,
+                        sys.byteorder == "big",
+                        pycompat.encodeutf8(uid),
+                        nodes,
+                        unused,
+                        root,
+                        revcount,
+                        tipnode,
+                    )
+                )
+            self._nodetree = (uid, nodes, unused)
+        except (IOError, OSError, ValueError):
+            # The trie is only a cache. Failing to persist it must not fail
+            # the transaction.
+            self._nodetree = None
+            return
+        if olduid is not None:
+            # Readers may still have the old data mmapped. That is fine on
+            # POSIX, while Windows refuses and the file is left behind.
+            try:
+                self.opener.tryunlink(self._nodetreedatafile(olduid))
+            except (IOError, OSError):
+                pass
+
     @util.propertycache
     def _compressor(self):
         return util.compengines[self._compengine].revlogcompressor()
@@ -2113,6 +2241,8 @@ class revlog(object):
             dfh.seek(0, os.SEEK_END)
 
         curr = len(self) - 1
+        if self._persistnodetree and not self._bypasstransaction:
+            transaction.addfinalize("nodetree-" + self.indexfile, self._writenodetree)
         if not self._inline:
             if not self._bypasstransaction:
                 transaction.add(self.datafile, offset)
@@ -2309,6 +2439,8 @@ class revlog(object):
             end += rev * self._io.size
 
         transaction.add(self.indexfile, end)
+        if self._persistnodetree:
+            transaction.addfinalize("nodetree-" + self.indexfile, self._writenodetree)
 
         # then reset internal state in memory to forget those revisions
         self._cache = None
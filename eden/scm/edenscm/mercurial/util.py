@@ -1502,6 +1502,19 @@ class _re(object):
 
 re = _re()
 
+def normcasemany(paths):
+    """normcase a list of paths
+
+    ASCII paths are case-folded in one native call, and the rest fall back
+    to normcase.
+    """
+    if normcasespec == encoding.normcasespecs.lower:
+        return encoding.asciilowermany(paths, normcase)
+    if normcasespec == encoding.normcasespecs.upper:
+        return encoding.asciiuppermany(paths, normcase)
+    return [normcase(p) for p in paths]
+
+
 _fspathcache = {}
 
 
@@ -1517,7 +1530,8 @@ def fspath(name, root):
     """
 
     def _makefspathcacheentry(dir):
-        return dict((normcase(n), n) for n in os.listdir(dir))
+        names = os.listdir(dir)
+        return dict(zip(normcasemany(names), names))
 
     seps = pycompat.ossep
     if pycompat.osaltsep:
@@ -4972,6 +4986,7 @@ def preregistersighandlers():
         "SIGBREAK": term,
         # Following POSIX-ish signals can be missing on Windows,
         # or some POSIX platforms.
+        "SIGALRM": term,
         "SIGCHLD": ignore,
         "SIGHUP": term,
         "SIGINT": term,
@@ -143,7 +143,11 @@ cdef class _buffer: # thin wrapper around linelog_buf
             if result == LINELOG_RESULT_OK:
                 return
             elif result == LINELOG_RESULT_ENEEDRESIZE:
-                self.resize((self.buf.neededsize // unitsize + 1) * unitsize)
+                # grow geometrically so appending many revisions only
+                # resizes (and copies, or remaps) O(log n) times
+                newsize = max(self.buf.neededsize,
+                              self.buf.size + self.buf.size // 2)
+                self.resize((newsize // unitsize + 1) * unitsize)
             else:
                 raise LinelogError(result)
 
@@ -173,12 +177,14 @@ cdef _excwitherrno(exctype, hint=None, filename=None):
 IF UNAME_SYSNAME != "Windows":
     cdef class _filebuffer(_buffer): # linelog_buf backed by filesystem
         cdef int fd
-        cdef size_t maplen
+        cdef size_t maplen # can exceed buf.size, the file grows into it
         cdef char *path
+        cdef bint writable
 
-        def __cinit__(self, path):
+        def __cinit__(self, path, writable=True):
             self.fd = -1
             self.maplen = 0
+            self.writable = writable
             self.path = strdup(path)
             if self.path == NULL:
                 raise MemoryError()
@@ -189,16 +195,22 @@ IF UNAME_SYSNAME != "Windows":
             self.close()
 
         cdef resize(self, size_t newsize):
+            if not self.writable:
+                raise IOError(b'linelog is read-only')
             if self.fd == -1:
                 self._open()
-            self._unmap()
             r = unistd.ftruncate(self.fd, <off_t>newsize)
             if r != 0:
                 raise _excwitherrno(IOError, b'ftruncate')
-            self._map()
+            if newsize > self.maplen:
+                # reserve room so following appends do not remap
+                self._map(newsize * 2)
+            else:
+                # pages past the end of the file are not accessed
+                self.buf.size = newsize
 
         cdef flush(self):
-            if self.buf.data == NULL:
+            if self.buf.data == NULL or not self.writable:
                 return
             r = mman.msync(self.buf.data, self.buf.size, mman.MS_ASYNC)
             if r != 0:
@@ -214,13 +226,16 @@ IF UNAME_SYSNAME != "Windows":
 
         cdef _open(self):
             self.close()
-            fd = fcntl.open(self.path, fcntl.O_RDWR | fcntl.O_CREAT, 0o644)
+            if self.writable:
+                fd = fcntl.open(self.path, fcntl.O_RDWR | fcntl.O_CREAT, 0o644)
+            else:
+                fd = fcntl.open(self.path, fcntl.O_RDONLY)
             if fd == -1:
                 raise _excwitherrno(IOError, None, self.path)
             self.fd = fd
-            self._map()
+            self._map(0)
 
-        cdef _map(self):
+        cdef _map(self, size_t reserve):
             assert self.fd != -1
             self._unmap()
 
@@ -230,10 +245,12 @@ IF UNAME_SYSNAME != "Windows":
                 raise _excwitherrno(IOError, b'fstat')
 
             cdef size_t filelen = <size_t>st.st_size
-            self.maplen = (1 if filelen == 0 else filelen) # cannot be 0
-            p = mman.mmap(NULL, self.maplen, mman.PROT_READ | mman.PROT_WRITE,
-                          mman.MAP_SHARED, self.fd, 0)
-            if p == NULL:
+            self.maplen = max(filelen, reserve, 1) # cannot be 0
+            cdef int prot = mman.PROT_READ
+            if self.writable:
+                prot |= mman.PROT_WRITE
+            p = mman.mmap(NULL, self.maplen, prot, mman.MAP_SHARED, self.fd, 0)
+            if p == mman.MAP_FAILED:
                 raise _excwitherrno(OSError, b'mmap')
 
             self.buf.data = <uint8_t *>p
@@ -263,30 +280,38 @@ cdef class linelog:
     cdef readonly _buffer buf
     cdef readonly bint closed
     cdef readonly object path
+    cdef readonly bint writable
 
     def __cinit__(self):
         self.closed = 0
         memset(&self.ar, 0, sizeof(linelog_annotateresult))
 
-    def __init__(self, path=None):
-        """L(path : str?). Open a linelog.
+    def __init__(self, path=None, readonly=False):
+        """L(path : str?, readonly : bool). Open a linelog.
 
         If path is empty or None, the linelog will be in-memory. Otherwise
         it's based on an on-disk file.
 
+        If readonly is True, the file is mapped read-only and annotated in
+        place, without being copied. It must exist, and methods modifying
+        the linelog raise IOError.
+
         The linelog object does not protect concurrent accesses to a same
         file. The caller should have some lock mechanism (like flock) to
         ensure one file is only accessed by one linelog object.
         """
         self.path = path
+        self.writable = not readonly
         if path:
             IF UNAME_SYSNAME == 'Windows':
                 raise RuntimeError(b'on-disk linelog is unavailable on Windows')
             ELSE:
-                self.buf = _filebuffer(path)
+                self.buf = _filebuffer(path, self.writable)
         else:
             self.buf = _memorybuffer()
         if self.buf.getactualsize() == 0:
+            if readonly:
+                raise IOError(b'empty linelog cannot be opened read-only')
             # initialize empty linelog automatically
             self.clear()
             self.annotate(0)
@@ -296,7 +321,7 @@ cdef class linelog:
 
     def clear(self):
         """L.close() -> None. Close the file and free resources."""
-        self._checkclosed()
+        self._checkwritable()
         self._clearannotateresult()
         self.buf.clear()
 
@@ -309,7 +334,8 @@ cdef class linelog:
         """L.close() -> None. Close the file."""
         if self.closed:
             return
-        self.buf.resize(self.buf.getactualsize())
+        if self.writable:
+            self.buf.resize(self.buf.getactualsize())
         self.buf.close()
         self.closed = 1
 
@@ -318,7 +344,7 @@ cdef class linelog:
 
         Copy content from another linelog object."""
         assert isinstance(rhs, linelog)
-        self._checkclosed()
+        self._checkwritable()
         self.buf.copyfrom(rhs.buf)
 
     @property
@@ -352,7 +378,7 @@ cdef class linelog:
         Replace lines[a1:a2] with lines[b1:b2] in rev. See comments above
         linelog_replacelines in linelog.h for details.
         """
-        self._checkclosed()
+        self._checkwritable()
         try:
             self.buf.replacelines(&self.ar, rev, a1, a2, b1, b2)
         except LinelogError:
@@ -366,7 +392,7 @@ cdef class linelog:
         by rev. See comments above linelog_replacelines_vec in linelog.h for
         details.
         """
-        self._checkclosed()
+        self._checkwritable()
         # prepare blinecount, brevs, blinenums
         cdef linelog_linenum i = 0, blinecount = <linelog_linenum>len(blines)
         cdef linelog_revnum *brevs = <linelog_revnum *>malloc(
@@ -412,6 +438,11 @@ cdef class linelog:
         if self.closed:
             raise ValueError(b'I/O operation on closed linelog')
 
+    cdef _checkwritable(self):
+        self._checkclosed()
+        if not self.writable:
+            raise IOError(b'linelog is read-only')
+
     cdef _clearannotateresult(self):
         linelog_annotateresult_clear(&self.ar)
 
@@ -26,6 +26,12 @@ Config::
 
     # frame de-duplication (slower to print outputs)
     framededup = yes
+
+    # sample the Python stack this many times per second from a timer
+    # signal, instead of tracing every call. much lower overhead, but
+    # times are estimates and call counts are not shown. 0 traces every
+    # call. not available on Windows.
+    samplefreq = 0
 """
 
 from libc.stdio cimport fopen, fclose, FILE
@@ -34,13 +40,16 @@ from cpython.object cimport PyObject
 import contextlib
 import gc
 import os
+import signal
 import tempfile
 
-from edenscm.mercurial import pycompat
+from edenscm.mercurial import pycompat, util
+from edenscm.mercurial.i18n import _
 
 cdef extern from "edenscm/hgext/extlib/traceprofimpl.cpp":
-    void enable()
+    void enable(int)
     void disable()
+    void sample(PyObject *)
     void report(FILE *)
     void settimethreshold(double)
     void setcountthreshold(size_t)
@@ -50,8 +59,12 @@ cdef extern from "edenscm/hgext/extlib/traceprofimpl.cpp":
 cdef extern from "Python.h":
     FILE* PyFile_AsFile(PyObject *p)
 
+def _samplehandler(signum, frame):
+    sample(<PyObject *>frame)
+
 @contextlib.contextmanager
 def profile(ui, fp, section="profiling"):
+    freq = 0
     if ui is not None:
         if ui.configbool('traceprof', 'disablegc'):
             gc.disable() # slightly more predictable
@@ -63,10 +76,25 @@ def profile(ui, fp, section="profiling"):
             setcountthreshold(count)
         dedup = ui.configbool('traceprof', 'framededup', True)
         setdedup(<int>dedup)
-    enable()
+        freq = ui.configint('traceprof', 'samplefreq', 0)
+        if freq and not util.safehasattr(signal, 'setitimer'):
+            ui.warn(_("traceprof sampling is not supported - tracing calls\n"))
+            freq = 0
+    if freq > 0:
+        # SIGALRM follows wall time, which the report shows. The handler
+        # runs between bytecodes, so walking the stack is safe there.
+        oldhandler = util.signal(signal.SIGALRM, _samplehandler)
+        signal.siginterrupt(signal.SIGALRM, False)
+        enable(1)
+        signal.setitimer(signal.ITIMER_REAL, 1.0 / freq, 1.0 / freq)
+    else:
+        enable(0)
     try:
         yield
     finally:
+        if freq > 0:
+            signal.setitimer(signal.ITIMER_REAL, 0, 0)
+            util.signal(signal.SIGALRM, oldhandler)
         disable()
         # "report" only accepts a real file. "fp" could be stringio.
         # Therefore always use a temporary file as a buffer.
@@ -22,6 +22,11 @@ class HgNativeBackingStore {
  public:
   HgNativeBackingStore(folly::StringPiece repository, bool useEdenApi);
 
+  /**
+   * Imports a file from Rust contentstore. The returned IOBuf takes ownership
+   * of the buffer allocated by Rust, and frees it through rust_cbytes_free
+   * once the last reference to the content goes away.
+   */
   std::unique_ptr<folly::IOBuf>
   getBlob(folly::ByteRange name, folly::ByteRange node, bool local);
 
@@ -55,7 +55,8 @@ impl TreeEntry {
 
         Ok(TreeEntry {
             hash: hash.into(),
-            name: path.as_ref().as_byte_slice().to_vec().into(),
+            // Hand the path's own buffer over to C++ instead of copying it.
+            name: path.into_string().into_bytes().into(),
             ttype,
             // TODO: we currently do not have these information stored in Mercurial.
             size: std::ptr::null_mut(),
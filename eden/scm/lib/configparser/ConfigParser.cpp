@@ -5,6 +5,17 @@
  * GNU General Public License version 2.
  */
 #include "ConfigParser.h"
+
+#include <folly/FileUtil.h>
+#include <folly/Format.h>
+#include <folly/hash/SpookyHashV2.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <tuple>
+#include <vector>
+
 using namespace facebook::eden;
 
 // The following functions are exported from this rust library:
@@ -33,6 +44,11 @@ extern "C" HgRcBytesStruct* hgrc_configset_get(
     const uint8_t* name,
     size_t name_len) noexcept;
 
+extern "C" HgRcBytesStruct* hgrc_configset_values(
+    HgRcConfigSetStruct* ptr) noexcept;
+extern "C" HgRcBytesStruct* hgrc_configset_files(
+    HgRcConfigSetStruct* ptr) noexcept;
+
 extern "C" void hgrc_bytes_free(HgRcBytesStruct* bytes) noexcept;
 extern "C" BytesData hgrc_bytes_data(HgRcBytesStruct* bytes) noexcept;
 
@@ -94,5 +110,365 @@ folly::Optional<HgRcBytes> HgRcConfigSet::get(
   return folly::none;
 }
 
+namespace {
+
+/**
+ * A snapshot is a header, a table of the hgrc files it was built from, a
+ * table of values sorted by section and name, and the strings both tables
+ * refer to. It is only read back on the machine that wrote it, so integers
+ * are stored in native byte order.
+ */
+constexpr uint64_t kSnapshotMagic = 0x31504e5343524748; // "HGRCSNP1"
+
+struct SnapshotHeader {
+  uint64_t magic;
+  // SpookyHashV2 of everything after the header.
+  uint64_t checksum;
+  uint32_t fileCount;
+  uint32_t entryCount;
+};
+
+struct SnapshotFile {
+  // -1 if the file did not exist.
+  int64_t size;
+  int64_t mtime;
+  uint64_t contentHash;
+  uint32_t pathOffset;
+  uint32_t pathLength;
+};
+
+struct SnapshotEntry {
+  uint32_t sectionOffset;
+  uint32_t sectionLength;
+  uint32_t nameOffset;
+  uint32_t nameLength;
+  uint32_t valueOffset;
+  uint32_t valueLength;
+};
+
+static_assert(sizeof(SnapshotHeader) == 24);
+static_assert(sizeof(SnapshotFile) == 32);
+static_assert(sizeof(SnapshotEntry) == 24);
+
+std::vector<folly::StringPiece> splitNulTerminated(folly::StringPiece text) {
+  std::vector<folly::StringPiece> parts;
+  while (!text.empty()) {
+    auto end = text.find('\0');
+    if (end == folly::StringPiece::npos) {
+      break;
+    }
+    parts.push_back(text.subpiece(0, end));
+    text.advance(end + 1);
+  }
+  return parts;
+}
+
+struct FileState {
+  int64_t size{-1};
+  int64_t mtime{0};
+};
+
+FileState statFile(const std::string& path) {
+  std::error_code ec;
+  auto size = std::filesystem::file_size(path, ec);
+  if (ec) {
+    return FileState{};
+  }
+  auto mtime = std::filesystem::last_write_time(path, ec);
+  if (ec) {
+    return FileState{};
+  }
+  return FileState{
+      static_cast<int64_t>(size),
+      static_cast<int64_t>(mtime.time_since_epoch().count())};
+}
+
+uint64_t hashFile(const std::string& path) {
+  std::string contents;
+  if (!folly::readFile(path.c_str(), contents)) {
+    return 0;
+  }
+  return folly::hash::SpookyHashV2::Hash64(
+      contents.data(), contents.size(), 0);
+}
+
+uint64_t checksum(folly::ByteRange data) {
+  data.advance(sizeof(SnapshotHeader));
+  return folly::hash::SpookyHashV2::Hash64(data.data(), data.size(), 0);
+}
+
+/**
+ * The tables of a snapshot whose bounds have been checked.
+ */
+struct SnapshotView {
+  const SnapshotHeader* header;
+  const SnapshotFile* files;
+  const SnapshotEntry* entries;
+  folly::StringPiece strings;
+
+  explicit SnapshotView(folly::ByteRange data)
+      : header{reinterpret_cast<const SnapshotHeader*>(data.data())},
+        files{reinterpret_cast<const SnapshotFile*>(header + 1)},
+        entries{reinterpret_cast<const SnapshotEntry*>(
+            files + header->fileCount)},
+        strings{folly::StringPiece{data}.subpiece(
+            sizeof(SnapshotHeader) +
+            header->fileCount * sizeof(SnapshotFile) +
+            header->entryCount * sizeof(SnapshotEntry))} {}
+
+  folly::StringPiece string(uint32_t offset, uint32_t length) const {
+    return strings.subpiece(offset, length);
+  }
+
+  bool inBounds(uint32_t offset, uint32_t length) const {
+    return uint64_t{offset} + length <= strings.size();
+  }
+};
+
+/**
+ * Check that data holds a complete snapshot whose tables only refer to
+ * strings inside it.
+ */
+bool isWellFormed(folly::ByteRange data) {
+  if (data.size() < sizeof(SnapshotHeader)) {
+    return false;
+  }
+  auto header = reinterpret_cast<const SnapshotHeader*>(data.data());
+  if (header->magic != kSnapshotMagic || header->checksum != checksum(data)) {
+    return false;
+  }
+  uint64_t tablesSize = sizeof(SnapshotHeader) +
+      uint64_t{header->fileCount} * sizeof(SnapshotFile) +
+      uint64_t{header->entryCount} * sizeof(SnapshotEntry);
+  if (tablesSize > data.size()) {
+    return false;
+  }
+
+  SnapshotView view{data};
+  for (uint32_t i = 0; i < header->fileCount; ++i) {
+    const auto& file = view.files[i];
+    if (!view.inBounds(file.pathOffset, file.pathLength)) {
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < header->entryCount; ++i) {
+    const auto& entry = view.entries[i];
+    if (!view.inBounds(entry.sectionOffset, entry.sectionLength) ||
+        !view.inBounds(entry.nameOffset, entry.nameLength) ||
+        !view.inBounds(entry.valueOffset, entry.valueLength)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Check that none of the hgrc files a snapshot was built from has changed.
+ * A file whose modification time changed is still current if its content
+ * is the same, as when a configuration management tool rewrites it.
+ */
+bool filesAreCurrent(const SnapshotView& view) {
+  for (uint32_t i = 0; i < view.header->fileCount; ++i) {
+    const auto& file = view.files[i];
+    auto path = view.string(file.pathOffset, file.pathLength).str();
+    auto state = statFile(path);
+    if (state.size != file.size) {
+      return false;
+    }
+    if (state.size >= 0 && state.mtime != file.mtime &&
+        hashFile(path) != file.contentHash) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Check that two snapshots recorded the same state for the same hgrc files.
+ */
+bool sameFiles(const SnapshotView& a, const SnapshotView& b) {
+  if (a.header->fileCount != b.header->fileCount) {
+    return false;
+  }
+  for (uint32_t i = 0; i < a.header->fileCount; ++i) {
+    const auto& fileA = a.files[i];
+    const auto& fileB = b.files[i];
+    if (fileA.size != fileB.size || fileA.mtime != fileB.mtime ||
+        fileA.contentHash != fileB.contentHash ||
+        a.string(fileA.pathOffset, fileA.pathLength) !=
+            b.string(fileB.pathOffset, fileB.pathLength)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+} // namespace
+
+HgRcConfigSnapshot::HgRcConfigSnapshot(const HgRcConfigSet& config) {
+  auto filesResult = hgrc_configset_files(config.ptr_.get());
+  if (!filesResult) {
+    throw HgRcConfigError("hgrc file path is not valid UTF-8");
+  }
+  HgRcBytes files(filesResult);
+  HgRcBytes values(hgrc_configset_values(config.ptr_.get()));
+
+  auto paths = splitNulTerminated(files.stringPiece());
+  auto parts = splitNulTerminated(values.stringPiece());
+  std::vector<std::tuple<folly::StringPiece, folly::StringPiece, size_t>>
+      order;
+  order.reserve(parts.size() / 3);
+  for (size_t i = 0; i + 2 < parts.size(); i += 3) {
+    order.emplace_back(parts[i], parts[i + 1], i);
+  }
+  std::sort(order.begin(), order.end());
+
+  std::string strings;
+  auto addString = [&](folly::StringPiece str) {
+    auto offset = strings.size();
+    strings.append(str.data(), str.size());
+    return static_cast<uint32_t>(offset);
+  };
+
+  std::vector<SnapshotFile> fileTable;
+  fileTable.reserve(paths.size());
+  for (auto path : paths) {
+    auto pathStr = path.str();
+    auto state = statFile(pathStr);
+    fileTable.push_back(SnapshotFile{
+        state.size,
+        state.mtime,
+        state.size >= 0 ? hashFile(pathStr) : 0,
+        addString(path),
+        static_cast<uint32_t>(path.size())});
+  }
+
+  std::vector<SnapshotEntry> entryTable;
+  entryTable.reserve(order.size());
+  for (const auto& [section, name, index] : order) {
+    auto value = parts[index + 2];
+    entryTable.push_back(SnapshotEntry{
+        addString(section),
+        static_cast<uint32_t>(section.size()),
+        addString(name),
+        static_cast<uint32_t>(name.size()),
+        addString(value),
+        static_cast<uint32_t>(value.size())});
+  }
+  if (strings.size() > std::numeric_limits<uint32_t>::max()) {
+    throw HgRcConfigError("configuration is too large to snapshot");
+  }
+
+  SnapshotHeader header{
+      kSnapshotMagic,
+      0,
+      static_cast<uint32_t>(fileTable.size()),
+      static_cast<uint32_t>(entryTable.size())};
+  buffer_.reserve(
+      sizeof(header) + fileTable.size() * sizeof(SnapshotFile) +
+      entryTable.size() * sizeof(SnapshotEntry) + strings.size());
+  buffer_.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  buffer_.append(
+      reinterpret_cast<const char*>(fileTable.data()),
+      fileTable.size() * sizeof(SnapshotFile));
+  buffer_.append(
+      reinterpret_cast<const char*>(entryTable.data()),
+      entryTable.size() * sizeof(SnapshotEntry));
+  buffer_.append(strings);
+
+  header.checksum = checksum(data());
+  std::memcpy(buffer_.data(), &header, sizeof(header));
+}
+
+HgRcConfigSnapshot::HgRcConfigSnapshot(folly::MemoryMapping mapping)
+    : mapping_{std::make_unique<folly::MemoryMapping>(std::move(mapping))} {}
+
+folly::ByteRange HgRcConfigSnapshot::data() const {
+  if (mapping_) {
+    return mapping_->range();
+  }
+  return folly::ByteRange{folly::StringPiece{buffer_}};
+}
+
+void HgRcConfigSnapshot::save(folly::StringPiece path) const {
+  folly::writeFileAtomic(path, data(), 0644);
+}
+
+folly::Optional<HgRcConfigSnapshot> HgRcConfigSnapshot::load(
+    folly::StringPiece path) noexcept {
+  try {
+    folly::MemoryMapping mapping{path.str().c_str()};
+    auto data = mapping.range();
+    if (!isWellFormed(data) || !filesAreCurrent(SnapshotView{data})) {
+      return folly::none;
+    }
+    return HgRcConfigSnapshot{std::move(mapping)};
+  } catch (const std::exception&) {
+    // A missing or unreadable snapshot only means the caller must parse
+    // the configuration again.
+    return folly::none;
+  }
+}
+
+HgRcConfigSnapshot HgRcConfigSnapshot::loadCached(
+    folly::StringPiece cacheDir,
+    folly::StringPiece key,
+    folly::FunctionRef<void(HgRcConfigSet&)> loadConfig) {
+  auto path = folly::sformat(
+      "{}/hgrc-{:016x}.snapshot",
+      cacheDir,
+      folly::hash::SpookyHashV2::Hash64(key.data(), key.size(), 0));
+  if (auto snapshot = load(path)) {
+    return std::move(*snapshot);
+  }
+
+  // A snapshot records the state of the hgrc files once they have been
+  // parsed. A file changed during the parse would be recorded with its new
+  // state but its old values, which would then be served until the file
+  // changed again. The files are only known once parsed, so a first parse
+  // records their state before the one the snapshot is built from, and the
+  // snapshot is only cached if that state still holds after it.
+  HgRcConfigSet before;
+  loadConfig(before);
+  HgRcConfigSnapshot beforeSnapshot{before};
+
+  HgRcConfigSet config;
+  loadConfig(config);
+  HgRcConfigSnapshot snapshot{config};
+  if (!sameFiles(
+          SnapshotView{beforeSnapshot.data()}, SnapshotView{snapshot.data()})) {
+    return snapshot;
+  }
+  try {
+    std::filesystem::create_directories(cacheDir.str());
+    snapshot.save(path);
+  } catch (const std::exception&) {
+    // The cache only saves the next caller from parsing the configuration;
+    // this one already has it.
+  }
+  return snapshot;
+}
+
+folly::Optional<folly::StringPiece> HgRcConfigSnapshot::get(
+    folly::StringPiece section,
+    folly::StringPiece name) const noexcept {
+  SnapshotView view{data()};
+  auto key = std::make_tuple(section, name);
+  auto begin = view.entries;
+  auto end = view.entries + view.header->entryCount;
+  auto it = std::lower_bound(
+      begin, end, key, [&](const SnapshotEntry& entry, const auto& target) {
+        return std::make_tuple(
+                   view.string(entry.sectionOffset, entry.sectionLength),
+                   view.string(entry.nameOffset, entry.nameLength)) < target;
+      });
+  if (it == end ||
+      view.string(it->sectionOffset, it->sectionLength) != section ||
+      view.string(it->nameOffset, it->nameLength) != name) {
+    return folly::none;
+  }
+  return view.string(it->valueOffset, it->valueLength);
+}
+
 } // namespace eden
 } // namespace facebook
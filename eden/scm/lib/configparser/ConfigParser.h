@@ -1,7 +1,11 @@
 // Copyright 2004-present Facebook. All Rights Reserved
 #pragma once
+#include <folly/Function.h>
 #include <folly/Optional.h>
 #include <folly/Range.h>
+#include <folly/system/MemoryMapping.h>
+#include <memory>
+#include <string>
 
 /** This module makes available to C++ some of the Rust ConfigSet API */
 namespace facebook {
@@ -77,11 +81,62 @@ class HgRcConfigSet {
   }
 
  private:
+  friend class HgRcConfigSnapshot;
+
   struct Deleter {
     void operator()(HgRcConfigSetStruct*) const;
   };
   std::unique_ptr<HgRcConfigSetStruct, Deleter> ptr_;
 };
 
+/** A read-only copy of the values in an HgRcConfigSet that can be saved to
+ * a file and mapped by later processes instead of parsing every hgrc file
+ * again.
+ * The file records the size, modification time and content hash of each
+ * hgrc file the configuration read, including %include'd and missing ones,
+ * and is only loaded while all of them are unchanged.
+ */
+class HgRcConfigSnapshot {
+ public:
+  // Throws HgRcConfigError if config read a file whose path is not UTF-8
+  explicit HgRcConfigSnapshot(const HgRcConfigSet& config);
+
+  // Write the snapshot to path, replacing any existing file atomically.
+  // Throws if the file cannot be written.
+  void save(folly::StringPiece path) const;
+
+  // Map the snapshot saved at path.
+  // Returns folly::none if it does not exist, is corrupt, or any of the
+  // hgrc files it was built from has changed since.
+  static folly::Optional<HgRcConfigSnapshot> load(
+      folly::StringPiece path) noexcept;
+
+  // Return the snapshot cached under cacheDir for key, or build one by
+  // passing an empty HgRcConfigSet to loadConfig and cache it there.
+  // The key names the sequence of loads loadConfig performs.
+  // When building a snapshot, loadConfig is called twice so that the state
+  // of the hgrc files is checked both before and after the parse the
+  // snapshot holds; it is not cached if a file changed in between.
+  // Throws HgRcConfigError if loadConfig does.
+  static HgRcConfigSnapshot loadCached(
+      folly::StringPiece cacheDir,
+      folly::StringPiece key,
+      folly::FunctionRef<void(HgRcConfigSet&)> loadConfig);
+
+  // Return the configuration value for the specified section/name
+  folly::Optional<folly::StringPiece> get(
+      folly::StringPiece section,
+      folly::StringPiece name) const noexcept;
+
+ private:
+  explicit HgRcConfigSnapshot(folly::MemoryMapping mapping);
+
+  folly::ByteRange data() const;
+
+  // Exactly one of these holds the serialized snapshot.
+  std::string buffer_;
+  std::unique_ptr<folly::MemoryMapping> mapping_;
+};
+
 } // namespace eden
 } // namespace facebook
@@ -124,6 +124,54 @@ pub extern "C" fn hgrc_configset_get(
     }
 }
 
+/// Returns a Text object holding every configuration value that is set, as a
+/// sequence of NUL terminated section, name and value triples. Values
+/// containing a NUL byte are omitted.
+#[no_mangle]
+pub extern "C" fn hgrc_configset_values(cfg: *const ConfigSet) -> *mut Text {
+    debug_assert!(!cfg.is_null());
+    let cfg = unsafe { &*cfg };
+
+    let mut values = String::new();
+    for section in cfg.sections() {
+        for name in cfg.keys(&section) {
+            let value = match cfg.get(&section, &name) {
+                Some(value) => value,
+                None => continue,
+            };
+            if section.contains('\0') || name.contains('\0') || value.contains('\0') {
+                continue;
+            }
+            for part in &[&section, &name, &value] {
+                values.push_str(part);
+                values.push('\0');
+            }
+        }
+    }
+
+    Box::into_raw(Box::new(values.into()))
+}
+
+/// Returns a Text object holding the paths of all the files the ConfigSet
+/// attempted to read, each NUL terminated.
+/// Returns nullptr if a path is not valid UTF-8.
+#[no_mangle]
+pub extern "C" fn hgrc_configset_files(cfg: *const ConfigSet) -> *mut Text {
+    debug_assert!(!cfg.is_null());
+    let cfg = unsafe { &*cfg };
+
+    let mut files = String::new();
+    for path in cfg.files() {
+        match path.to_str() {
+            Some(path) => files.push_str(path),
+            None => return ptr::null_mut(),
+        }
+        files.push('\0');
+    }
+
+    Box::into_raw(Box::new(files.into()))
+}
+
 #[repr(C)]
 pub struct ByteData {
     ptr: *const u8,
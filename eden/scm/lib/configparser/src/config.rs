@@ -30,6 +30,7 @@ type Pair<'a> = pest::iterators::Pair<'a, Rule>;
 #[derive(Clone, Default, Debug)]
 pub struct ConfigSet {
     sections: IndexMap<Text, Section>,
+    files: Vec<PathBuf>,
 }
 
 /// Internal representation of a config section.
@@ -128,6 +129,13 @@ impl ConfigSet {
         errors
     }
 
+    /// Return the paths of all config files this `ConfigSet` attempted to read, including
+    /// `%include`d files and paths that did not exist. A cached copy of this `ConfigSet` is
+    /// out of date once any of them changes.
+    pub fn files(&self) -> &[PathBuf] {
+        &self.files
+    }
+
     /// Get config sections.
     pub fn sections(&self) -> Vec<Text> {
         self.sections.keys().cloned().collect()
@@ -248,6 +256,10 @@ impl ConfigSet {
         visited: &mut HashSet<PathBuf>,
         errors: &mut Vec<Error>,
     ) {
+        if !self.files.iter().any(|p| p == path) {
+            self.files.push(path.to_path_buf());
+        }
+
         if let Ok(path) = path.canonicalize() {
             let path = &path;
             debug_assert!(path.is_absolute());
@@ -1087,6 +1099,29 @@ pub(crate) mod tests {
         assert_eq!(cfg.get("y", "b"), Some(Text::from("1")));
     }
 
+    #[test]
+    fn test_files() {
+        let dir = TempDir::new("test_files").unwrap();
+        write_file(
+            dir.path().join("rootrc"),
+            "[x]\na=1\n%include a.rc\n%include missing.rc\n%include rootrc",
+        );
+        write_file(dir.path().join("a.rc"), "%include rootrc");
+
+        let mut cfg = ConfigSet::new();
+        let errors = cfg.load_path(dir.path().join("rootrc"), &"test_files".into());
+        assert!(errors.is_empty());
+
+        assert_eq!(
+            cfg.files(),
+            &[
+                dir.path().join("rootrc"),
+                dir.path().join("a.rc"),
+                dir.path().join("missing.rc"),
+            ][..]
+        );
+    }
+
     #[test]
     fn test_parse_include_expand() {
         use std::env;
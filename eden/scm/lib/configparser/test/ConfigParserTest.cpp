@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+#include <folly/FileUtil.h>
+#include <folly/testing/TestUtil.h>
+#include <gtest/gtest.h>
+#include <chrono>
+#include <filesystem>
+#include <string>
+
+#include "eden/scm/lib/configparser/ConfigParser.h"
+
+using namespace facebook::eden;
+
+namespace {
+
+class HgRcConfigSnapshotTest : public ::testing::Test {
+ protected:
+  void writeHgrc(folly::StringPiece contents) {
+    ASSERT_TRUE(folly::writeFile(contents, hgrcPath_.c_str()));
+  }
+
+  HgRcConfigSnapshot parse() {
+    HgRcConfigSet config;
+    config.loadPath(hgrcPath_.c_str());
+    return HgRcConfigSnapshot{config};
+  }
+
+  folly::test::TemporaryDirectory dir_;
+  std::string hgrcPath_{(dir_.path() / "hgrc").string()};
+  std::string snapshotPath_{(dir_.path() / "hgrc.snapshot").string()};
+};
+
+} // namespace
+
+TEST_F(HgRcConfigSnapshotTest, savedSnapshotIsLoaded) {
+  writeHgrc("[foo]\nbar = baz\n");
+  auto snapshot = parse();
+  EXPECT_EQ("baz", snapshot.get("foo", "bar").value_or(""));
+  EXPECT_FALSE(snapshot.get("foo", "missing").hasValue());
+
+  snapshot.save(snapshotPath_);
+  auto loaded = HgRcConfigSnapshot::load(snapshotPath_);
+  ASSERT_TRUE(loaded.hasValue());
+  EXPECT_EQ("baz", loaded->get("foo", "bar").value_or(""));
+}
+
+TEST_F(HgRcConfigSnapshotTest, changedFileMakesSnapshotStale) {
+  writeHgrc("[foo]\nbar = baz\n");
+  parse().save(snapshotPath_);
+
+  writeHgrc("[foo]\nbar = quux\n");
+  EXPECT_FALSE(HgRcConfigSnapshot::load(snapshotPath_).hasValue());
+}
+
+TEST_F(HgRcConfigSnapshotTest, rewrittenIdenticalFileKeepsSnapshot) {
+  writeHgrc("[foo]\nbar = baz\n");
+  parse().save(snapshotPath_);
+
+  writeHgrc("[foo]\nbar = baz\n");
+  auto mtime = std::filesystem::last_write_time(hgrcPath_);
+  std::filesystem::last_write_time(hgrcPath_, mtime + std::chrono::hours{1});
+  auto loaded = HgRcConfigSnapshot::load(snapshotPath_);
+  ASSERT_TRUE(loaded.hasValue());
+  EXPECT_EQ("baz", loaded->get("foo", "bar").value_or(""));
+}
+
+TEST_F(HgRcConfigSnapshotTest, corruptSnapshotIsNotLoaded) {
+  ASSERT_TRUE(
+      folly::writeFile(std::string{"not a snapshot"}, snapshotPath_.c_str()));
+  EXPECT_FALSE(HgRcConfigSnapshot::load(snapshotPath_).hasValue());
+}
+
+TEST_F(HgRcConfigSnapshotTest, loadCachedOnlyParsesStaleConfigs) {
+  writeHgrc("[foo]\nbar = baz\n");
+  auto cacheDir = (dir_.path() / "cache").string();
+  size_t parses = 0;
+  auto loadConfig = [&](HgRcConfigSet& config) {
+    ++parses;
+    config.loadPath(hgrcPath_.c_str());
+  };
+
+  auto first = HgRcConfigSnapshot::loadCached(cacheDir, "key", loadConfig);
+  EXPECT_EQ("baz", first.get("foo", "bar").value_or(""));
+  auto parsesToBuild = parses;
+  EXPECT_GT(parsesToBuild, 0u);
+
+  auto cached = HgRcConfigSnapshot::loadCached(cacheDir, "key", loadConfig);
+  EXPECT_EQ("baz", cached.get("foo", "bar").value_or(""));
+  EXPECT_EQ(parsesToBuild, parses);
+
+  writeHgrc("[foo]\nbar = quux\n");
+  auto rebuilt = HgRcConfigSnapshot::loadCached(cacheDir, "key", loadConfig);
+  EXPECT_EQ("quux", rebuilt.get("foo", "bar").value_or(""));
+  EXPECT_GT(parses, parsesToBuild);
+}
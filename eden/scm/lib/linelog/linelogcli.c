@@ -22,6 +22,7 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 #include "linelog.c" /* unusual but we want to access some private structs */
 
@@ -47,20 +48,24 @@ const size_t UNIT_SIZE = 0x1000; /* 4KB, used when resizing the file */
 static linelog_buf buf;
 static linelog_annotateresult ar;
 static int fd = -1;
-static size_t maplen;
+static size_t maplen; /* may be larger than buf.size, see resizefile */
 static const char* filename;
+static int readonly;
+static unsigned resizecount, remapcount;
 
 static const char helptext[] =
 #ifdef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
     "(built for fuzz testing)\n"
 #endif
-    "usage: linelogcli FILE CMDLIST\n"
+    "usage: linelogcli [-r] FILE CMDLIST\n"
     "where  CMDLIST := CMD | CMDLIST CMD\n"
     "       CMD := init | info | dump | ANNOTATECMD | REPLACELINESCMD | "
-    "GETALLLINESCMD\n"
+    "GETALLLINESCMD | BENCHCMD\n"
     "       ANNOTATECMD := annotate REV | annotate -\n"
     "       REPLACELINESCMD := replacelines rev a1:a2 b1:b2\n"
-    "       GETALLLINESCMD := getalllines offset1:offset2\n";
+    "       GETALLLINESCMD := getalllines offset1:offset2\n"
+    "       BENCHCMD := bench revcount\n"
+    "  -r maps FILE read-only and refuses commands writing to it\n";
 
 static void closefile(void) {
   if (buf.data) {
@@ -75,35 +80,61 @@ static void closefile(void) {
   }
 }
 
+/* map len bytes of the file, which has filelen bytes. len can exceed filelen
+   so the file can grow into the mapping without remapping it. */
+static void mapfile(size_t filelen, size_t len) {
+  if (buf.data)
+    ensure(munmap(buf.data, maplen) == 0);
+  maplen = (len == 0 ? 1 : len);
+  int prot = readonly ? PROT_READ : PROT_READ | PROT_WRITE;
+  void* p = mmap(NULL, maplen, prot, MAP_SHARED, fd, 0);
+  ensure(p != MAP_FAILED);
+
+  buf.data = p;
+  buf.size = filelen;
+  remapcount++;
+}
+
 static void openfile(void) {
   closefile();
-  ensure((fd = open(filename, O_RDWR | O_CREAT, 0644)) != -1);
+  int flags = readonly ? O_RDONLY : O_RDWR | O_CREAT;
+  ensure((fd = open(filename, flags, 0644)) != -1);
 
   struct stat st;
   ensure(fstat(fd, &st) == 0);
-
-  maplen = (st.st_size == 0 ? 1 : (size_t)st.st_size);
-  void* p = mmap(NULL, maplen, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-  ensure(p != MAP_FAILED);
-
-  buf.data = p;
-  buf.size = (size_t)st.st_size;
+  mapfile((size_t)st.st_size, (size_t)st.st_size);
 }
 
+/* appending to the file only remaps it if it outgrows the mapping. pages
+   past the end of the file are never accessed since buf.size is the file
+   size. */
 static void resizefile(size_t size) {
-  closefile();
-  ensure((fd = open(filename, O_RDWR | O_CREAT, 0644)) != -1);
+  ensure(!readonly);
   ensure(ftruncate(fd, (off_t)size) == 0);
-  openfile();
+  resizecount++;
+  if (size > maplen)
+    mapfile(size, size * 2);
+  else
+    buf.size = size;
+}
+
+/* grow the file geometrically so a long series of replacelines only resizes
+   it O(log n) times. fuzzing uses exact sizes to catch overruns. */
+static size_t growsize(size_t neededsize) {
+#ifndef FUZZING_BUILD_MODE_UNSAFE_FOR_PRODUCTION
+  if (neededsize < buf.size + buf.size / 2)
+    neededsize = buf.size + buf.size / 2;
+#endif
+  return (neededsize / UNIT_SIZE + 1) * UNIT_SIZE;
 }
 
 /* handle LINELOG_RESULT_ENEEDRESIZE automatically */
-#define eval(result, expr)                                    \
-  while (1) {                                                 \
-    result = (expr);                                          \
-    if (result != LINELOG_RESULT_ENEEDRESIZE)                 \
-      break;                                                  \
-    resizefile((buf.neededsize / UNIT_SIZE + 1) * UNIT_SIZE); \
+#define eval(result, expr)                    \
+  while (1) {                                 \
+    result = (expr);                          \
+    if (result != LINELOG_RESULT_ENEEDRESIZE) \
+      break;                                  \
+    resizefile(growsize(buf.neededsize));     \
   }
 
 int cmdinit(const char* args[]) {
@@ -286,21 +317,114 @@ int cmdgetalllines(const char* args[]) {
   return r;
 }
 
+static double now(void) {
+  struct timespec ts;
+  ensure(clock_gettime(CLOCK_MONOTONIC, &ts) == 0);
+  return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint32_t benchrand(void) {
+  /* xorshift32, deterministic so runs are comparable */
+  static uint32_t x = 2463534242u;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return x;
+}
+
+/* annotate 100 revisions spread over the history, and maxrev */
+static double benchannotate(linelog_buf* b) {
+  linelog_revnum maxrev = linelog_getmaxrev(b);
+  linelog_annotateresult lines;
+  memset(&lines, 0, sizeof(lines));
+  double start = now();
+  for (linelog_revnum i = 0; i <= 100; ++i) {
+    linelog_revnum rev = (linelog_revnum)((uint64_t)maxrev * i / 100);
+    ensure(linelog_annotate(b, &lines, rev) == LINELOG_RESULT_OK);
+  }
+  double elapsed = now() - start;
+  linelog_annotateresult_clear(&lines);
+  return elapsed;
+}
+
+int cmdbench(const char* args[]) {
+  unsigned revcount = 0;
+  sscanf(args[0], "%u", &revcount);
+
+  /* build a history of small random edits, like fastannotate would */
+  linelog_result r;
+  double start = now();
+  resizecount = remapcount = 0;
+  eval(r, linelog_clear(&buf));
+  if (r != LINELOG_RESULT_OK)
+    return r;
+  eval(r, linelog_annotate(&buf, &ar, 0));
+  for (unsigned rev = 1; r == LINELOG_RESULT_OK && rev <= revcount; ++rev) {
+    linelog_linenum linecount = ar.linecount;
+    linelog_linenum a1 = benchrand() % (linecount + 1);
+    linelog_linenum a2 = a1 + benchrand() % (linecount - a1 + 1) % 4;
+    /* keep the file around 1000 lines */
+    linelog_linenum b2 = benchrand() % (linecount > 1000 ? 3 : 5);
+    eval(r, linelog_replacelines(&buf, &ar, rev, a1, a2, 0, b2));
+  }
+  if (r != LINELOG_RESULT_OK)
+    return r;
+  size_t size = linelog_getactualsize(&buf);
+  printf(
+      "bench: %u revs, %u lines, size %lu, %u resizes, %u remaps, %.3fs\n",
+      revcount,
+      ar.linecount,
+      (unsigned long)size,
+      resizecount,
+      remapcount,
+      now() - start);
+
+  /* annotate straight from a read-only mapping */
+  resizefile(size);
+  int wasreadonly = readonly;
+  readonly = 1;
+  start = now();
+  openfile();
+  double elapsed = now() - start;
+  printf(
+      "bench: map read-only %.3fms, annotate %.3fms\n",
+      elapsed * 1e3,
+      benchannotate(&buf) * 1e3);
+
+  /* compare with loading a private copy first */
+  linelog_buf copy = {NULL, size, 0};
+  start = now();
+  ensure((copy.data = malloc(size)) != NULL);
+  ensure(pread(fd, copy.data, size, 0) == (ssize_t)size);
+  elapsed = now() - start;
+  printf(
+      "bench: read into memory %.3fms, annotate %.3fms\n",
+      elapsed * 1e3,
+      benchannotate(&copy) * 1e3);
+  free(copy.data);
+
+  readonly = wasreadonly;
+  openfile();
+  return LINELOG_RESULT_OK;
+}
+
 typedef int cmdfunc(const char* args[]);
 typedef struct {
   const char* name;
   const char shortname;
   int argcount;
+  int writes; /* refused with -r */
   cmdfunc* func;
 } cmdentry;
 
 static cmdentry cmdtable[] = {
-    {"init", 'i', 0, cmdinit},
-    {"info", 'f', 0, cmdinfo},
-    {"annotate", 'a', 1, cmdannotate},
-    {"replacelines", 'r', 3, cmdreplacelines},
-    {"dump", 'd', 0, cmddump},
-    {"getalllines", 'l', 1, cmdgetalllines},
+    {"init", 'i', 0, 1, cmdinit},
+    {"info", 'f', 0, 0, cmdinfo},
+    {"annotate", 'a', 1, 0, cmdannotate},
+    {"replacelines", 'r', 3, 1, cmdreplacelines},
+    {"dump", 'd', 0, 0, cmddump},
+    {"getalllines", 'l', 1, 0, cmdgetalllines},
+    {"bench", 'b', 1, 1, cmdbench},
 };
 
 const cmdentry* findcmd(const char* name) {
@@ -326,16 +450,21 @@ const char* translateerror(linelog_result result) {
 }
 
 int main(int argc, char const* argv[]) {
-  if (argc < 3) {
+  int argi = 1;
+  if (argc > 1 && strcmp(argv[1], "-r") == 0) {
+    readonly = 1;
+    argi++;
+  }
+  if (argc - argi < 2) {
     puts(helptext);
     return 1;
   }
 
-  filename = argv[1];
+  filename = argv[argi];
   openfile();
   linelog_annotateresult_clear(&ar);
 
-  for (int i = 2; i < argc; i++) {
+  for (int i = argi + 1; i < argc; i++) {
     const cmdentry* cmd = findcmd(argv[i]);
     if (!cmd) {
       fprintf(stderr, "%s: unknown command\n", argv[i]);
@@ -345,6 +474,11 @@ int main(int argc, char const* argv[]) {
       fprintf(stderr, "%s: missing argument\n", argv[i++]);
       break;
     }
+    if (readonly && cmd->writes) {
+      fprintf(stderr, "%s: file is read-only\n", cmd->name);
+      i += cmd->argcount;
+      continue;
+    }
     linelog_result r = cmd->func(argv + i + 1);
     if (r != LINELOG_RESULT_OK)
       fprintf(
@@ -354,7 +488,7 @@ int main(int argc, char const* argv[]) {
 
   /* truncate the file to actual used size */
   size_t size = linelog_getactualsize(&buf);
-  if (size && size != buf.size)
+  if (!readonly && size && size != buf.size)
     resizefile(size);
 
   closefile();
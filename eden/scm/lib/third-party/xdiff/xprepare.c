@@ -156,6 +156,60 @@ static int xdl_classify_record(unsigned int pass, xdlclassifier_t *cf, xrecord_t
 }
 
 
+/*
+ * The length of the common prefix of a and b, of at most size bytes. The
+ * bytes are compared 8 at a time, as the files often share most of their
+ * contents.
+ */
+static int64_t xdl_common_prefix(char const *a, char const *b, int64_t size) {
+	int64_t i = 0;
+	uint64_t wa, wb;
+
+	for (; size - i >= 8; i += 8) {
+		memcpy(&wa, a + i, 8);
+		memcpy(&wb, b + i, 8);
+		if (wa != wb)
+			break;
+	}
+	while (i < size && a[i] == b[i])
+		i++;
+	return i;
+}
+
+
+/*
+ * The length of the common suffix of the bytes ending before aend and bend,
+ * of at most size bytes.
+ */
+static int64_t xdl_common_suffix(char const *aend, char const *bend,
+		int64_t size) {
+	int64_t i = 0;
+	uint64_t wa, wb;
+
+	for (; size - i >= 8; i += 8) {
+		memcpy(&wa, aend - i - 8, 8);
+		memcpy(&wb, bend - i - 8, 8);
+		if (wa != wb)
+			break;
+	}
+	while (i < size && aend[-i - 1] == bend[-i - 1])
+		i++;
+	return i;
+}
+
+
+static int64_t xdl_count_newlines(char const *ptr, int64_t size) {
+	char const *top = ptr + size;
+	int64_t nl = 0;
+
+	while ((ptr = memchr(ptr, '\n', top - ptr)) != NULL) {
+		nl++;
+		ptr++;
+	}
+	return nl;
+}
+
+
 /*
  * Trim common prefix from files.
  *
@@ -186,15 +240,15 @@ static void xdl_trim_files(mmfile_t *mf1, mmfile_t *mf2, int64_t reserved,
 	}
 
 	pp1 = msmall.ptr, pp2 = mlarge.ptr;
-	for (i = 0; i < msmall.size && *pp1 == *pp2; ++i) {
-		plines += (*pp1 == '\n');
-		pp1++, pp2++;
-	}
+	i = xdl_common_prefix(pp1, pp2, msmall.size);
+	plines = xdl_count_newlines(pp1, i);
+	pp1 += i, pp2 += i;
 
 	ps1 = msmall.ptr + msmall.size - 1, ps2 = mlarge.ptr + mlarge.size - 1;
-	while (ps1 > pp1 && *ps1 == *ps2) {
-		slines += (*ps1 == '\n');
-		ps1--, ps2--;
+	if (ps1 > pp1) {
+		i = xdl_common_suffix(ps1 + 1, ps2 + 1, ps1 - pp1);
+		slines = xdl_count_newlines(ps1 + 1 - i, i);
+		ps1 -= i, ps2 -= i;
 	}
 
 	/* Retract common prefix and suffix boundaries for reserved lines */
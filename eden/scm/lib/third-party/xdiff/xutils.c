@@ -128,17 +128,42 @@ int xdl_recmatch_vendored(const char *l1, int64_t s1, const char *l2, int64_t s2
 	return 0;
 }
 
+/*
+ * Hash the bytes of a line 8 at a time. The hashes only need to be stable
+ * within a diff, so they are allowed to differ across byte orders.
+ */
+static uint64_t xdl_hash_bytes(char const *ptr, char const *end) {
+	const uint64_t k = 0x9e3779b97f4a7c15ULL;
+	uint64_t ha = 5381 ^ ((uint64_t) (end - ptr) * k);
+	uint64_t w;
+
+	for (; end - ptr >= 8; ptr += 8) {
+		memcpy(&w, ptr, 8);
+		ha = (ha ^ w) * k;
+		ha ^= ha >> 29;
+	}
+	if (ptr < end) {
+		w = 0;
+		memcpy(&w, ptr, end - ptr);
+		ha = (ha ^ w) * k;
+	}
+
+	/* XDL_HASHLONG uses the low bits, which need the high bits mixed in */
+	ha ^= ha >> 32;
+	ha *= k;
+	ha ^= ha >> 29;
+	return ha;
+}
+
 uint64_t xdl_hash_record_vendored(char const **data, char const *top) {
-	uint64_t ha = 5381;
 	char const *ptr = *data;
+	/* memchr is vectorized by the C libraries */
+	char const *eol = memchr(ptr, '\n', top - ptr);
+	char const *end = eol ? eol: top;
 
-	for (; ptr < top && *ptr != '\n'; ptr++) {
-		ha += (ha << 5);
-		ha ^= (unsigned long) *ptr;
-	}
-	*data = ptr < top ? ptr + 1: ptr;
+	*data = eol ? eol + 1: top;
 
-	return ha;
+	return xdl_hash_bytes(ptr, end);
 }
 
 unsigned int xdl_hashbits_vendored(int64_t size) {
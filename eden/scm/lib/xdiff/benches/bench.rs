@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) Facebook, Inc. and its affiliates.
+ *
+ * This software may be used and distributed according to the terms of the
+ * GNU General Public License version 2.
+ */
+
+use std::fmt::Write;
+
+use minibench::{bench, elapsed};
+use xdiff::diff_hunks;
+
+/// A generated source file of `lines` lines, with every `change_every`th
+/// line changed if `change_every` is not 0.
+fn generated_source(lines: usize, line_len: usize, change_every: usize) -> String {
+    let mut text = String::with_capacity(lines * (line_len + 32));
+    let padding = "x".repeat(line_len);
+    for i in 0..lines {
+        let changed = change_every != 0 && i % change_every == 0;
+        writeln!(
+            text,
+            "    value_{} = compute({}, \"{}\");",
+            i,
+            if changed { i + 1 } else { i },
+            padding
+        )
+        .unwrap();
+    }
+    text
+}
+
+fn main() {
+    for &(lines, line_len) in &[(100_000, 16), (400_000, 16), (50_000, 400)] {
+        let old = generated_source(lines, line_len, 0);
+        for &change_every in &[1000, 10] {
+            let new = generated_source(lines, line_len, change_every);
+            let name = format!(
+                "diff_hunks {:.1}MB, {} byte lines, 1/{} changed",
+                old.len() as f64 / 1e6,
+                line_len,
+                change_every
+            );
+            bench(name, || {
+                elapsed(|| {
+                    diff_hunks(&old, &new);
+                })
+            });
+        }
+
+        // Only one line differs, so most of the files are trimmed as their
+        // common prefix and suffix.
+        let mut new = old.clone();
+        let middle = old.len() / 2;
+        let line_start = middle + old[middle..].find('\n').unwrap() + 1;
+        new.insert_str(line_start, "an inserted line\n");
+        bench(
+            format!(
+                "diff_hunks {:.1}MB, one inserted line",
+                old.len() as f64 / 1e6
+            ),
+            || {
+                elapsed(|| {
+                    diff_hunks(&old, &new);
+                })
+            },
+        );
+    }
+}
@@ -329,6 +329,7 @@ segmentedchangelogcompatiblelist = """
     test-narrow-heads-migration.t
     test-nested-repo-t.py
     test-origbackup-conflict.t
+    test-parsers-dirs.py
     test-patch-offset.t
     test-pathconflicts-update.t
     test-pathencode.py
@@ -361,6 +362,7 @@ segmentedchangelogcompatiblelist = """
     test-revert-flags.t
     test-revert-interactive.t
     test-revert-status.t
+    test-revlog-nodetree.py
     test-revlog-packentry.t
     test-revlog-raw.py
     test-revset-dirstate-parents.t
@@ -60,6 +60,17 @@ class BdiffTests(unittest.TestCase):
         for a, b in cases:
             self.assert_bdiff(a, b)
 
+    def test_bdiff_large(self):
+        # large enough to be split into chunks diffed on several threads
+        a = "".join("line %d\n" % i for i in range(200000))
+        b = a.replace("line 100\n", "").replace("line 150000\n", "changed\n")
+        b = "".join(
+            "inserted %d\n" % i + l if i % 30000 == 0 else l
+            for i, l in enumerate(b.splitlines(True))
+        )
+        self.assert_bdiff(a, b)
+        self.assertLess(len(mdiff.textdiff(a, b)), 1000)
+
     def showdiff(self, a, b):
         bin = mdiff.textdiff(a, b)
         pos = 0
@@ -1,8 +1,11 @@
 from __future__ import absolute_import
 
+import random
 import unittest
 
 from edenscm.mercurial import encoding
+from edenscm.mercurial.pure import charencode as charencodepure
+from edenscmnative import parsers
 from hghave import require
 
 
@@ -35,6 +38,96 @@ class Utf8bEncodingTest(unittest.TestCase):
         self.assertTrue(s is encoding.fromutf8b(s))
 
 
+class CharencodeKernelsTest(unittest.TestCase):
+    """compare each set of vectorized kernels with the pure implementation"""
+
+    def setUp(self):
+        self.addCleanup(parsers.setcharencodekernels, parsers.charencodekernels[0])
+
+    def randstrs(self):
+        rand = random.Random(0)
+        alphabets = [
+            b"abcxyzABCXYZ@[`{/._-09",
+            b"abcdefghijklmnopqrstuvwxyz" * 3 + b'"\\\n\x01<>\x7f',
+            bytes(bytearray(range(256))),
+        ]
+        for length in list(range(80)) + [200, 1000]:
+            for alphabet in alphabets:
+                yield bytes(
+                    bytearray(rand.choice(bytearray(alphabet)) for i in range(length))
+                )
+            # a single odd byte at every position
+            if length < 70:
+                for c in (b"\x80", b"\xff", b"\n", b"<"):
+                    for i in range(length):
+                        yield b"a" * i + c + b"B" * (length - i - 1)
+
+    def puretransform(self, func, s):
+        try:
+            return func(s)
+        except UnicodeDecodeError:
+            return None
+
+    def nativetransform(self, func, s):
+        try:
+            return func(s)
+        except UnicodeDecodeError:
+            return None
+
+    def purejson(self, s, paranoid):
+        try:
+            return charencodepure.jsonescapeu8fast(s, paranoid)
+        except ValueError:
+            return None
+
+    def nativejson(self, s, paranoid):
+        try:
+            return parsers.jsonescapeu8fast(s, paranoid)
+        except ValueError:
+            return None
+
+    def testkernels(self):
+        self.assertRaises(ValueError, parsers.setcharencodekernels, "nonexistent")
+        strs = list(self.randstrs())
+        for name in parsers.charencodekernels:
+            parsers.setcharencodekernels(name)
+            for s in strs:
+                self.assertEqual(
+                    parsers.isasciistr(s), charencodepure.isasciistr(s), (name, s)
+                )
+                for native, pure in [
+                    (parsers.asciilower, charencodepure.asciilower),
+                    (parsers.asciiupper, charencodepure.asciiupper),
+                ]:
+                    self.assertEqual(
+                        self.nativetransform(native, s),
+                        self.puretransform(pure, s),
+                        (name, s),
+                    )
+                for paranoid in (False, True):
+                    expected = self.purejson(s, paranoid)
+                    if expected is not None:
+                        expected = expected.encode("latin-1")
+                    self.assertEqual(
+                        self.nativejson(s, paranoid), expected, (name, s, paranoid)
+                    )
+
+    def testmany(self):
+        paths = [b"Foo/BAR", b"caf\xc3\xa9/X", b"", u"Dir/File.TXT", u"Caf\xe9/X"]
+        self.assertEqual(
+            parsers.asciilowermany(paths, lambda p: (p,)),
+            [b"foo/bar", (b"caf\xc3\xa9/X",), b"", u"dir/file.txt", (u"Caf\xe9/X",)],
+        )
+        self.assertEqual(
+            parsers.asciiuppermany(iter(paths[:1] + paths[3:4])),
+            [b"FOO/BAR", u"DIR/FILE.TXT"],
+        )
+        self.assertRaises(UnicodeDecodeError, parsers.asciilowermany, paths)
+        self.assertRaises(UnicodeDecodeError, parsers.asciilowermany, paths[4:], None)
+        self.assertRaises(TypeError, parsers.asciilowermany, [1])
+        self.assertRaises(TypeError, parsers.asciilowermany, paths, 1)
+
+
 if __name__ == "__main__":
     import silenttestrunner
 
@@ -1,8 +1,11 @@
 #!/usr/bin/env python
 from __future__ import absolute_import
 
+import os
 import random
+import shutil
 import sys
+import tempfile
 
 from edenscmnative import linelog
 
@@ -66,3 +69,23 @@ for lines, rev, a1, a2, b1, b2, blines, usevec in generator(seed, endrev):
 for lines, rev, a1, a2, b1, b2, blines, usevec in generator(seed, endrev):
     log.annotate(rev)
     ensure(lines == log.annotateresult)
+
+# the same history written to a file, and annotated from a read-only mapping
+if os.name != "nt":
+    path = os.path.join(tempfile.mkdtemp(prefix="linelog"), "log").encode()
+    filelog = linelog.linelog(path)
+    filelog.copyfrom(log)
+    filelog.close()
+    ensure(os.path.getsize(path) == log.actualsize)
+    filelog = linelog.linelog(path, readonly=True)
+    ensure(filelog.maxrev == endrev)
+    for lines, rev, a1, a2, b1, b2, blines, usevec in generator(seed, endrev):
+        filelog.annotate(rev)
+        ensure(lines == filelog.annotateresult)
+    try:
+        filelog.replacelines(endrev + 1, 0, 0, 0, 1)
+        ensure(False)
+    except IOError:
+        pass
+    filelog.close()
+    shutil.rmtree(os.path.dirname(path))
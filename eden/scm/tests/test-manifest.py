@@ -426,5 +426,35 @@ class testmanifestdict(unittest.TestCase, basemanifesttests):
         return manifestmod.manifestdict(text)
 
 
+class testlazymanifestdict(testmanifestdict):
+    def parsemanifest(self, text):
+        return manifestmod.manifestdict(text, lazy=True)
+
+    def testReversedLines(self):
+        backwards = b"".join(
+            l + b"\n" for l in reversed(A_SHORT_MANIFEST.split(b"\n")) if l
+        )
+        # the order is only checked when the lines are indexed
+        m = self.parsemanifest(backwards)
+        try:
+            len(m)
+            self.fail("Should have raised ValueError")
+        except ValueError as v:
+            self.assertIn("Manifest lines not in sorted order.", str(v))
+
+    def testDiffSkipsSameDirectories(self):
+        left = self.parsemanifest(A_DEEPER_MANIFEST)
+        changed = A_DEEPER_MANIFEST.replace(
+            b"a/b/d/qux.py\0%s" % HASH_1, b"a/b/d/qux.py\0%s" % HASH_2
+        )
+        right = self.parsemanifest(changed + b"z/new.py\0%s\n" % HASH_1)
+        want = {
+            "a/b/d/qux.py": ((BIN_HASH_1, "l"), (BIN_HASH_2, "l")),
+            "z/new.py": ((None, ""), (BIN_HASH_1, "")),
+        }
+        self.assertEqual(want, left.diff(right))
+        self.assertEqual({}, left.diff(self.parsemanifest(A_DEEPER_MANIFEST)))
+
+
 if __name__ == "__main__":
     silenttestrunner.main(__name__)
@@ -0,0 +1,102 @@
+from __future__ import absolute_import
+
+import random
+import unittest
+
+import silenttestrunner
+from edenscmnative import parsers
+
+
+def finddirs(path):
+    pos = path.rfind(b"/")
+    while pos != -1:
+        yield path[:pos]
+        pos = path.rfind(b"/", 0, pos)
+    yield b""
+
+
+class refdirs(object):
+    """the multiset semantics of util.puredirs, on bytes"""
+
+    def __init__(self, paths=()):
+        self._dirs = {}
+        for path in paths:
+            self.addpath(path)
+
+    def addpath(self, path):
+        for base in finddirs(path):
+            if base in self._dirs:
+                self._dirs[base] += 1
+                return
+            self._dirs[base] = 1
+
+    def delpath(self, path):
+        for base in finddirs(path):
+            if self._dirs[base] > 1:
+                self._dirs[base] -= 1
+                return
+            del self._dirs[base]
+
+    def __iter__(self):
+        return iter(self._dirs)
+
+
+class dirstests(unittest.TestCase):
+    def testbasic(self):
+        d = parsers.dirs([b"a/b/c", b"a/d", b"e"])
+        self.assertEqual(sorted(d), [b"", b"a", b"a/b"])
+        self.assertIn(b"a/b", d)
+        self.assertNotIn(b"a/b/c", d)
+        self.assertNotIn(u"a", d)
+
+        d.delpath(b"a/b/c")
+        self.assertEqual(sorted(d), [b"", b"a"])
+        d.addpaths(iter([b"f/g", b"a/h/i"]))
+        self.assertEqual(sorted(d), [b"", b"a", b"a/h", b"f"])
+        d.delpath(b"a/d")
+        d.delpath(b"a/h/i")
+        d.delpath(b"f/g")
+        d.delpath(b"e")
+        self.assertEqual(list(d), [])
+
+    def testerrors(self):
+        d = parsers.dirs([b"a/b"])
+        self.assertRaises(ValueError, d.delpath, b"c/d")
+        self.assertRaises(TypeError, d.addpaths, [u"a/b"])
+        self.assertRaises(TypeError, parsers.dirs, [u"a/b"])
+
+    def testskipchar(self):
+        dmap = {
+            b"a/b": parsers.dirstatetuple("n", 0, 0, 0),
+            b"c/d": parsers.dirstatetuple("r", 0, 0, 0),
+        }
+        self.assertEqual(sorted(parsers.dirs(dmap, b"r")), [b"", b"a"])
+
+    def testrandom(self):
+        rand = random.Random(0)
+        names = [b"a", b"b", b"cc", b"d\xff", b"e" * 100]
+
+        def randpath():
+            depth = rand.choice([0, 1, 2, 3, 4, 100])
+            return b"/".join(rand.choice(names) for i in range(depth + 1))
+
+        for i in range(20):
+            paths = [randpath() for i in range(rand.randint(0, 500))]
+            ref, d = refdirs(paths), parsers.dirs(paths)
+            for i in range(1000):
+                if paths and rand.random() < 0.5:
+                    path = paths.pop(rand.randrange(len(paths)))
+                    ref.delpath(path)
+                    d.delpath(path)
+                else:
+                    path = randpath()
+                    paths.append(path)
+                    ref.addpath(path)
+                    d.addpaths([path])
+            self.assertEqual(sorted(d), sorted(ref))
+            for path in paths:
+                self.assertEqual(path in d, path in ref._dirs)
+
+
+if __name__ == "__main__":
+    silenttestrunner.main(__name__)
@@ -234,8 +234,12 @@ def genpath(rng, count):
 
 def runtests(rng, seed, count):
     nerrs = 0
-    for p in genpath(rng, count):
+    paths = list(genpath(rng, count))
+    for p, m in zip(paths, store._pathencodemany(paths)):
         h = store._pathencode(p)  # uses C implementation, if available
+        if h != m:
+            print("\np: '%s' encoded differently in a batch" % p, file=sys.stderr)
+            nerrs += 1
         r = store._hybridencode(p, True)  # reference implementation in Python
         if h != r:
             if nerrs == 0:
@@ -0,0 +1,157 @@
+from __future__ import absolute_import
+
+import os
+import shutil
+import struct
+import tempfile
+import unittest
+
+import silenttestrunner
+from edenscm.mercurial import revlog, transaction, vfs as vfsmod
+from edenscm.mercurial.node import hex, nullid
+from edenscm.mercurial.pycompat import encodeutf8
+
+
+class nodetreetests(unittest.TestCase):
+    def setUp(self):
+        self.path = tempfile.mkdtemp(prefix="nodetree")
+        self.vfs = vfsmod.vfs(self.path)
+        self.vfs.options = {"revlogv1": True, "persistent-nodetree": True}
+        self.batch = 0
+
+    def tearDown(self):
+        shutil.rmtree(self.path)
+
+    def newrevlog(self):
+        return revlog.revlog(self.vfs, "00test.i", mmaplargeindex=True)
+
+    def addrevs(self, rl, count):
+        tr = transaction.transaction(
+            lambda msg: None, self.vfs, {"plain": self.vfs}, "journal"
+        )
+        start = len(rl)
+        p1 = rl.tip() if start else nullid
+        # Make texts unique, so that revs re-added after a strip differ.
+        self.batch += 1
+        for i in range(start, start + count):
+            text = encodeutf8("batch %d rev %d\n" % (self.batch, i))
+            p1 = rl.addrevision(text, tr, i, p1, nullid)
+        tr.close()
+
+    def strip(self, rl, rev):
+        # Duplicating some logic from repair.py
+        tr = transaction.transaction(
+            lambda msg: None, self.vfs, {"plain": self.vfs}, "journal"
+        )
+        tr.startgroup()
+        rl.strip(rev, tr)
+        tr.endgroup()
+        for file, troffset, ignore in tr.entries:
+            with self.vfs(file, "a") as fp:
+                fp.truncate(troffset)
+        tr.close()
+
+    def datafiles(self):
+        return sorted(f for f in self.vfs.listdir() if f.endswith(".ntd"))
+
+    def persisted(self, rl):
+        return rl.index.stats().get("node trie persisted", 0)
+
+    def checklookups(self, rl):
+        for rev in range(len(rl)):
+            node = rl.node(rev)
+            self.assertEqual(rl.rev(node), rev)
+            self.assertEqual(rl.index.partialmatch(hex(node)[:12]), node)
+        self.assertFalse(rl.hasnode(b"\x01" * 20))
+
+    def testpersistandload(self):
+        self.addrevs(self.newrevlog(), 300)
+        self.assertTrue(self.vfs.exists("00test.nt"))
+        self.assertEqual(len(self.datafiles()), 1)
+
+        rl = self.newrevlog()
+        self.assertGreater(self.persisted(rl), 0)
+        self.checklookups(rl)
+
+    def testappend(self):
+        self.addrevs(self.newrevlog(), 300)
+        datafile = self.datafiles()[0]
+        size = self.vfs.stat(datafile).st_size
+
+        rl = self.newrevlog()
+        self.addrevs(rl, 20)
+        self.checklookups(rl)
+        # Appended to, not replaced.
+        self.assertEqual(self.datafiles(), [datafile])
+        self.assertGreater(self.vfs.stat(datafile).st_size, size)
+
+        rl = self.newrevlog()
+        self.assertGreater(self.persisted(rl), 0)
+        self.assertEqual(len(rl), 320)
+        self.checklookups(rl)
+
+    def teststale(self):
+        self.addrevs(self.newrevlog(), 300)
+
+        # Revs added without updating the trie are inserted on load.
+        self.vfs.options = {"revlogv1": True}
+        self.addrevs(revlog.revlog(self.vfs, "00test.i"), 20)
+        self.vfs.options["persistent-nodetree"] = True
+        rl = self.newrevlog()
+        self.assertGreater(self.persisted(rl), 0)
+        self.checklookups(rl)
+
+        # A trie that does not match the index is not used.
+        stripped = rl.node(250)
+        self.vfs.options = {"revlogv1": True}
+        self.strip(revlog.revlog(self.vfs, "00test.i"), 250)
+        self.vfs.options["persistent-nodetree"] = True
+        rl = self.newrevlog()
+        self.assertEqual(self.persisted(rl), 0)
+        self.assertEqual(len(rl), 250)
+        self.assertFalse(rl.hasnode(stripped))
+        self.checklookups(rl)
+
+        # The next write replaces it.
+        self.addrevs(rl, 10)
+        self.assertEqual(len(self.datafiles()), 1)
+        rl = self.newrevlog()
+        self.assertGreater(self.persisted(rl), 0)
+        self.assertFalse(rl.hasnode(stripped))
+        self.checklookups(rl)
+
+    def teststrip(self):
+        self.addrevs(self.newrevlog(), 300)
+        rl = self.newrevlog()
+        stripped = rl.node(250)
+        self.strip(rl, 250)
+
+        rl = self.newrevlog()
+        self.assertGreater(self.persisted(rl), 0)
+        self.assertFalse(rl.hasnode(stripped))
+        self.checklookups(rl)
+
+    def testcorrupt(self):
+        self.addrevs(self.newrevlog(), 300)
+
+        # Links past the end of the trie are detected.
+        datafile = self.datafiles()[0]
+        with self.vfs(datafile, "r+b") as fp:
+            size = os.fstat(fp.fileno()).st_size
+            for offset in range(0, size, 256):
+                fp.seek(offset)
+                fp.write(struct.pack("=i", 1 << 30))
+        rl = self.newrevlog()
+        self.checklookups(rl)
+        self.addrevs(rl, 10)
+        self.checklookups(rl)
+
+        # An unreadable docket is ignored.
+        self.vfs.write("00test.nt", b"garbage")
+        rl = self.newrevlog()
+        self.assertEqual(self.persisted(rl), 0)
+        self.checklookups(rl)
+
+
+if __name__ == "__main__":
+    silenttestrunner.main(__name__)